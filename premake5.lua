@@ -323,6 +323,7 @@ workspace("xenia")
   include("src/xenia/gpu/vulkan")
   include("src/xenia/hid")
   include("src/xenia/hid/nop")
+  include("src/xenia/hid/replay")
   include("src/xenia/kernel")
   include("src/xenia/patcher")
   include("src/xenia/ui")
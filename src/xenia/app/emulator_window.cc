@@ -9,12 +9,14 @@
 
 #include "xenia/app/emulator_window.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "third_party/fmt/include/fmt/chrono.h"
 #include "third_party/fmt/include/fmt/format.h"
@@ -27,6 +29,7 @@
 #include "xenia/base/cvar.h"
 #include "xenia/base/debugging.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/math.h"
 #include "xenia/base/platform.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/system.h"
@@ -36,6 +39,8 @@
 #include "xenia/gpu/command_processor.h"
 #include "xenia/gpu/graphics_system.h"
 #include "xenia/hid/input_system.h"
+#include "xenia/kernel/util/allocation_stats.h"
+#include "xenia/kernel/util/export_stats.h"
 #include "xenia/kernel/xam/profile_manager.h"
 #include "xenia/kernel/xam/xam_module.h"
 #include "xenia/kernel/xam/xam_state.h"
@@ -56,6 +61,11 @@
 #include "build/version.h"
 
 DECLARE_bool(debug);
+DECLARE_bool(debug_on_demand);
+
+DECLARE_uint32(benchmark_frames);
+
+DECLARE_bool(benchmark_offscreen);
 
 DECLARE_string(hid);
 
@@ -243,6 +253,11 @@ void EmulatorWindow::SetupGraphicsSystemPresenterPainting() {
     return;
   }
 
+  if (cvars::benchmark_frames && cvars::benchmark_offscreen) {
+    // Still rendering with the GPU backend, just not presenting.
+    return;
+  }
+
   ui::Presenter* presenter = GetGraphicsSystemPresenter();
   if (!presenter) {
     return;
@@ -546,6 +561,244 @@ void EmulatorWindow::DisplayConfigDialog::OnDraw(ImGuiIO& io) {
       ImGui::TreePop();
     }
 
+    if (ImGui::TreeNodeEx("Frame pacing", ImGuiTreeNodeFlags_Framed)) {
+      ui::Presenter::FramePacingStats frame_pacing_stats;
+      presenter->GetFramePacingStats(frame_pacing_stats);
+      ImGui::PlotLines("Frame time", frame_pacing_stats.frame_times_ms.data(),
+                       int(frame_pacing_stats.frame_time_count), 0, nullptr,
+                       0.0f, 50.0f, ImVec2(0.0f, 60.0f));
+      ImGui::Text("Mean %.2f ms, standard deviation %.2f ms",
+                  frame_pacing_stats.frame_time_mean_ms,
+                  frame_pacing_stats.frame_time_std_dev_ms);
+      ImGui::PlotLines("Refresh to present",
+                       frame_pacing_stats.latencies_ms.data(),
+                       int(frame_pacing_stats.latency_count), 0, nullptr, 0.0f,
+                       50.0f, ImVec2(0.0f, 60.0f));
+      ImGui::Text("Mean %.2f ms, maximum %.2f ms",
+                  frame_pacing_stats.latency_mean_ms,
+                  frame_pacing_stats.latency_max_ms);
+      ImGui::TextUnformatted(
+          cvars::present_low_latency
+              ? "Low-latency presentation is enabled"
+              : "Low-latency presentation is disabled (present_low_latency)");
+
+      ImGui::TreePop();
+    }
+
+    FrameTimeline* frame_timeline =
+        emulator_window_.emulator_->frame_timeline();
+    if (frame_timeline &&
+        ImGui::TreeNodeEx("Frame timeline", ImGuiTreeNodeFlags_Framed)) {
+      static const ImU32 kComponentColors[] = {
+          IM_COL32(80, 160, 255, 255),  IM_COL32(160, 160, 160, 255),
+          IM_COL32(255, 200, 64, 255),  IM_COL32(96, 208, 96, 255),
+          IM_COL32(224, 96, 96, 255),   IM_COL32(192, 112, 224, 255),
+      };
+      size_t component_count = frame_timeline->component_count();
+      std::vector<float> durations_ms;
+      std::vector<float> component_times_ms;
+      frame_timeline->GetHistory(durations_ms, component_times_ms);
+
+      // Stacked bars of the component times of each frame, with the duration
+      // of the frame as a white tick. The components are sums of thread time,
+      // so they may go beyond the tick when threads run in parallel.
+      constexpr float kScaleMaxMs = 50.0f;
+      ImVec2 plot_size(
+          std::max(ImGui::GetContentRegionAvail().x, 1.0f), 100.0f);
+      ImVec2 plot_min = ImGui::GetCursorScreenPos();
+      ImVec2 plot_max(plot_min.x + plot_size.x, plot_min.y + plot_size.y);
+      ImDrawList* draw_list = ImGui::GetWindowDrawList();
+      draw_list->AddRectFilled(plot_min, plot_max, IM_COL32(0, 0, 0, 160));
+      float bar_width = plot_size.x / float(FrameTimeline::kHistoryLength);
+      float pixels_per_ms = plot_size.y / kScaleMaxMs;
+      for (size_t i = 0; i < durations_ms.size(); ++i) {
+        float bar_left = plot_min.x + bar_width * float(i);
+        float bar_right = bar_left + std::max(bar_width - 1.0f, 1.0f);
+        float bar_bottom = plot_max.y;
+        for (size_t j = 0; j < component_count && bar_bottom > plot_min.y;
+             ++j) {
+          float component_height =
+              component_times_ms[i * component_count + j] * pixels_per_ms;
+          float bar_top = std::max(bar_bottom - component_height, plot_min.y);
+          draw_list->AddRectFilled(
+              ImVec2(bar_left, bar_top), ImVec2(bar_right, bar_bottom),
+              kComponentColors[j % xe::countof(kComponentColors)]);
+          bar_bottom = bar_top;
+        }
+        float duration_y =
+            std::max(plot_max.y - durations_ms[i] * pixels_per_ms, plot_min.y);
+        draw_list->AddLine(ImVec2(bar_left, duration_y),
+                           ImVec2(bar_right, duration_y),
+                           IM_COL32(255, 255, 255, 255));
+      }
+      ImGui::Dummy(plot_size);
+
+      float mean_duration_ms = 0.0f;
+      for (float duration_ms : durations_ms) {
+        mean_duration_ms += duration_ms;
+      }
+      if (!durations_ms.empty()) {
+        mean_duration_ms /= float(durations_ms.size());
+      }
+      ImGui::Text("Frame: mean %.2f ms over %zu frames", mean_duration_ms,
+                  durations_ms.size());
+      for (size_t i = 0; i < component_count; ++i) {
+        float mean_ms = 0.0f;
+        for (size_t j = 0; j < durations_ms.size(); ++j) {
+          mean_ms += component_times_ms[j * component_count + i];
+        }
+        if (!durations_ms.empty()) {
+          mean_ms /= float(durations_ms.size());
+        }
+        ImGui::ColorButton(
+            frame_timeline->component_label(i).c_str(),
+            ImGui::ColorConvertU32ToFloat4(
+                kComponentColors[i % xe::countof(kComponentColors)]),
+            ImGuiColorEditFlags_NoTooltip,
+            ImVec2(ImGui::GetTextLineHeight(), ImGui::GetTextLineHeight()));
+        ImGui::SameLine();
+        ImGui::Text("%s: mean %.2f ms",
+                    frame_timeline->component_label(i).c_str(), mean_ms);
+      }
+
+      if (ImGui::Button("Export CSV")) {
+        std::filesystem::path csv_path =
+            emulator_window_.emulator_->storage_root() / "frame_timeline.csv";
+        if (frame_timeline->ExportCsv(csv_path)) {
+          XELOGI("Exported the frame timeline to {}", csv_path);
+        } else {
+          XELOGE("Failed to export the frame timeline to {}", csv_path);
+        }
+      }
+
+      ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNodeEx("Kernel export statistics",
+                          ImGuiTreeNodeFlags_Framed)) {
+      ImGui::Checkbox("Gather", &cvars::kernel_export_stats);
+      ImGui::SameLine();
+      if (ImGui::Button("Reset")) {
+        xe::kernel::util::ResetExportStats();
+      }
+      std::vector<xe::kernel::util::ExportStats> export_stats;
+      xe::kernel::util::SnapshotExportStats(export_stats);
+      // Prints the bounds of the histogram bucket containing the percentile.
+      auto text_percentile_us = [](const xe::kernel::util::ExportStats& stats,
+                                   uint64_t percent) {
+        constexpr uint32_t kLastBucket =
+            xe::kernel::util::kExportStatsHistogramBucketCount - 1;
+        uint64_t threshold = (stats.call_count * percent + 99) / 100;
+        uint32_t bucket = 0;
+        for (uint64_t count = stats.histogram[0];
+             count < threshold && bucket < kLastBucket;
+             count += stats.histogram[++bucket]) {
+        }
+        if (bucket == kLastBucket) {
+          ImGui::Text(">= %u", 1u << (kLastBucket - 1));
+        } else {
+          ImGui::Text("< %u", 1u << bucket);
+        }
+      };
+      // Sorted by the total time.
+      if (ImGui::BeginTable("##kernel_export_stats", 6,
+                            ImGuiTableFlags_BordersInnerH |
+                                ImGuiTableFlags_SizingFixedFit |
+                                ImGuiTableFlags_ScrollY,
+                            ImVec2(0.0f, 300.0f))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Export", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Total ms");
+        ImGui::TableSetupColumn("Mean us");
+        ImGui::TableSetupColumn("p50 us");
+        ImGui::TableSetupColumn("p99 us");
+        ImGui::TableHeadersRow();
+        for (const xe::kernel::util::ExportStats& stats : export_stats) {
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::Text("%s!%s", stats.module_name, stats.export_entry->name);
+          ImGui::TableNextColumn();
+          ImGui::Text("%llu", (unsigned long long)stats.call_count);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.3f", double(stats.total_us) * 0.001);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.2f",
+                      double(stats.total_us) / double(stats.call_count));
+          ImGui::TableNextColumn();
+          text_percentile_us(stats, 50);
+          ImGui::TableNextColumn();
+          text_percentile_us(stats, 99);
+        }
+        ImGui::EndTable();
+      }
+      ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNodeEx("Guest allocations", ImGuiTreeNodeFlags_Framed)) {
+      ImGui::Checkbox("Gather", &cvars::kernel_allocation_stats);
+      ImGui::SameLine();
+      if (ImGui::Button("Reset")) {
+        xe::kernel::util::ResetAllocationStats();
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Export CSV")) {
+        std::filesystem::path csv_path =
+            emulator_window_.emulator_->storage_root() /
+            "guest_allocations.csv";
+        if (xe::kernel::util::ExportAllocationStatsCsv(csv_path)) {
+          XELOGI("Exported the guest allocations to {}", csv_path);
+        } else {
+          XELOGE("Failed to export the guest allocations to {}", csv_path);
+        }
+      }
+      std::vector<xe::kernel::util::AllocationSiteStats> allocation_stats;
+      xe::kernel::util::SnapshotAllocationStats(allocation_stats);
+      uint64_t total_live_bytes = 0;
+      for (const xe::kernel::util::AllocationSiteStats& stats :
+           allocation_stats) {
+        total_live_bytes += stats.live_bytes;
+      }
+      ImGui::Text("Live: %.2f MB in %zu call sites",
+                  double(total_live_bytes) / (1024.0 * 1024.0),
+                  allocation_stats.size());
+      // Sorted by the live bytes, churn is allocated since the last reset.
+      if (ImGui::BeginTable("##guest_allocation_stats", 6,
+                            ImGuiTableFlags_BordersInnerH |
+                                ImGuiTableFlags_SizingFixedFit |
+                                ImGuiTableFlags_ScrollY,
+                            ImVec2(0.0f, 300.0f))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Call site",
+                                ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Kind");
+        ImGui::TableSetupColumn("Live");
+        ImGui::TableSetupColumn("Live KB");
+        ImGui::TableSetupColumn("Allocations");
+        ImGui::TableSetupColumn("Churn KB");
+        ImGui::TableHeadersRow();
+        for (const xe::kernel::util::AllocationSiteStats& stats :
+             allocation_stats) {
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::Text("%08X", stats.call_site);
+          ImGui::TableNextColumn();
+          ImGui::TextUnformatted(
+              xe::kernel::util::GetAllocationKindName(stats.kind));
+          ImGui::TableNextColumn();
+          ImGui::Text("%u", stats.live_count);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.1f", double(stats.live_bytes) / 1024.0);
+          ImGui::TableNextColumn();
+          ImGui::Text("%llu", (unsigned long long)stats.allocation_count);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.1f", double(stats.allocated_bytes) / 1024.0);
+        }
+        ImGui::EndTable();
+      }
+      ImGui::TreePop();
+    }
+
     presenter->SetGuestOutputPaintConfigFromUIThread(new_presenter_config);
 
     // Override the values in the cvars to save them to the config at exit if
@@ -1447,11 +1700,11 @@ void EmulatorWindow::CpuTimeScalarSetDouble() {
 }
 
 void EmulatorWindow::CpuBreakIntoDebugger() {
-  if (!cvars::debug) {
+  if (!cvars::debug && !cvars::debug_on_demand) {
     xe::ui::ImGuiDialog::ShowMessageBox(imgui_drawer_.get(), "Xenia Debugger",
                                         "Xenia must be launched with the "
-                                        "--debug flag in order to enable "
-                                        "debugging.");
+                                        "--debug or the --debug_on_demand "
+                                        "flag in order to enable debugging.");
     return;
   }
   auto processor = emulator()->processor();
@@ -2153,6 +2406,9 @@ void EmulatorWindow::NetplayStatus() {
       cvars::upnp) {
     if (xe::kernel::XLiveAPI::upnp_handler->is_active()) {
       msg += "UPnP: Device found";
+    } else if (xe::kernel::XLiveAPI::upnp_handler->status() ==
+               xe::kernel::UPnP::Status::kSearching) {
+      msg += "UPnP: Searching for device";
     } else {
       msg += "UPnP: Device search failed";
     }
@@ -53,6 +53,7 @@
 
 // Available input drivers:
 #include "xenia/hid/nop/nop_hid.h"
+#include "xenia/hid/replay/replay_hid.h"
 #if !XE_PLATFORM_ANDROID
 #include "xenia/hid/sdl/sdl_hid.h"
 #endif  // !XE_PLATFORM_ANDROID
@@ -68,7 +69,8 @@
 DEFINE_string(apu, "any", "Audio system. Use: [any, nop, sdl, xaudio2]", "APU");
 DEFINE_string(gpu, "any", "Graphics system. Use: [any, d3d12, vulkan, null]",
               "GPU");
-DEFINE_string(hid, "any", "Input system. Use: [any, nop, sdl, winkey, xinput]",
+DEFINE_string(hid, "any",
+              "Input system. Use: [any, nop, replay, sdl, winkey, xinput]",
               "HID");
 
 DEFINE_path(
@@ -104,6 +106,7 @@ DEFINE_transient_bool(portable, true,
                       "General");
 
 DECLARE_bool(debug);
+DECLARE_bool(debug_on_demand);
 
 DEFINE_bool(discord, true, "Enable Discord rich presence", "General");
 
@@ -388,6 +391,9 @@ std::vector<std::unique_ptr<hid::InputDriver>> EmulatorApp::CreateInputDrivers(
         xe::hid::nop::Create(window, EmulatorWindow::kZOrderHidInput));
   } else {
     Factory<hid::InputDriver, ui::Window*, size_t> factory;
+    // Only created with hid_replay_path, and taking precedence over the real
+    // controllers then.
+    factory.Add("replay", xe::hid::replay::Create);
 #if XE_PLATFORM_WIN32
     factory.Add("xinput", xe::hid::xinput::Create);
 #endif  // XE_PLATFORM_WIN32
@@ -529,6 +535,7 @@ void EmulatorApp::OnDestroy() {
   // Delete sessions on shutdown.
   xe::kernel::XLiveAPI::DeleteAllSessionsByMac();
 
+  xe::kernel::XLiveAPI::Shutdown();
   curl_global_cleanup();
 #pragma endregion
 
@@ -633,7 +640,7 @@ void EmulatorApp::EmulatorThread() {
 
   // Set a debug handler.
   // This will respond to debugging requests so we can open the debug UI.
-  if (cvars::debug) {
+  if (cvars::debug || cvars::debug_on_demand) {
     emulator_->processor()->set_debug_listener_request_handler(
         [this](xe::cpu::Processor* processor) {
           if (debug_window_) {
@@ -670,6 +677,9 @@ void EmulatorApp::EmulatorThread() {
     app_context().CallInUIThread([this]() { emulator_window_->UpdateTitle(); });
   });
 
+  emulator_->on_benchmark_complete.AddListener(
+      [this]() { app_context().RequestDeferredQuit(); });
+
   emulator_->on_terminate.AddListener([]() {
     if (cvars::discord) {
       discord::DiscordPresence::NotPlaying();
@@ -10,6 +10,9 @@
 #ifndef XENIA_APU_AUDIO_DRIVER_H_
 #define XENIA_APU_AUDIO_DRIVER_H_
 
+#include <atomic>
+#include <cstdint>
+
 #include "xenia/memory.h"
 #include "xenia/xbox.h"
 
@@ -34,6 +37,21 @@ class AudioDriver {
   virtual void Pause() = 0;
   virtual void Resume() = 0;
   virtual void SetVolume(float volume) = 0;
+
+  // Telemetry, updated by the implementations, readable from any thread.
+  // Number of times the host has run out of submitted frames to play.
+  uint64_t underrun_count() const {
+    return underrun_count_.load(std::memory_order_relaxed);
+  }
+  // Number of submitted frames not played by the host yet, as of the last
+  // update by the implementation.
+  uint32_t queued_frame_count() const {
+    return queued_frame_count_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  std::atomic<uint64_t> underrun_count_{0};
+  std::atomic<uint32_t> queued_frame_count_{0};
 };
 
 }  // namespace apu
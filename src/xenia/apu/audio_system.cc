@@ -14,6 +14,7 @@
 #include "xenia/apu/xma_decoder.h"
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_stream.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
@@ -42,6 +43,13 @@ DEFINE_uint32(apu_max_queued_frames, 8,
               "APU");
 UPDATE_from_uint32(apu_max_queued_frames, 2024, 8, 31, 20, 64);
 
+DEFINE_bool(apu_adaptive_queued_frames, false,
+            "Adjust the number of buffered audio frames at runtime starting "
+            "from apu_max_queued_frames - increase it when the host runs out "
+            "of audio to play, and slowly decrease it back while the playback "
+            "is stable, to balance the audio delay against crackling.",
+            "APU");
+
 namespace xe {
 namespace apu {
 
@@ -55,8 +63,12 @@ AudioSystem::AudioSystem(cpu::Processor* processor)
       std::max(cvars::apu_max_queued_frames, static_cast<uint32_t>(4)));
 
   for (size_t i = 0; i < kMaximumClientCount; ++i) {
-    client_semaphores_[i] = xe::threading::Semaphore::Create(0, queued_frames_);
+    // The maximum count is larger than queued_frames_ for the adaptive queue
+    // depth.
+    client_semaphores_[i] =
+        xe::threading::Semaphore::Create(0, uint32_t(kMaximumQueuedFrames));
     wait_handles_[i] = client_semaphores_[i].get();
+    ResetClientQueue(i);
   }
   shutdown_event_ = xe::threading::Event::CreateAutoResetEvent(false);
   assert_not_null(shutdown_event_);
@@ -132,13 +144,24 @@ void AudioSystem::WorkerThreadMain() {
       auto global_lock = global_critical_region_.Acquire();
       uint32_t client_callback = clients_[index].callback;
       uint32_t client_callback_arg = clients_[index].wrapped_callback_arg;
+      if (clients_[index].driver && !UpdateClientQueue(index)) {
+        // The slot has been taken away to reduce the queue depth.
+        client_callback = 0;
+      }
       global_lock.unlock();
 
       if (client_callback) {
         SCOPE_profile_cpu_i("apu", "xe::apu::AudioSystem->client_callback");
+        uint64_t callback_start_tick = Clock::QueryHostTickCount();
         uint64_t args[] = {client_callback_arg};
         processor_->Execute(worker_thread_->thread_state(), client_callback,
                             args, xe::countof(args));
+        // The time the guest has taken to produce the frame, including the
+        // waits for the XMA decoding.
+        COUNT_profile_set(
+            "apu/frame_callback_us",
+            uint32_t((Clock::QueryHostTickCount() - callback_start_tick) *
+                     1000000 / Clock::QueryHostTickFrequency()));
       }
 
       pumped = true;
@@ -171,6 +194,66 @@ int AudioSystem::FindFreeClient() {
 
 void AudioSystem::Initialize() {}
 
+void AudioSystem::ResetClientQueue(size_t index) {
+  ClientQueue& queue = client_queues_[index];
+  queue.capacity = queued_frames_;
+  queue.depth = queued_frames_;
+  queue.last_underrun_count = 0;
+  queue.frames_since_depth_change = 0;
+  queue.min_queued_frames_since_depth_change = UINT32_MAX;
+}
+
+bool AudioSystem::UpdateClientQueue(size_t index) {
+  // At 48 kHz, a frame is 256 samples - 5.3 ms, so the depth is reduced by one
+  // frame after about 5 seconds of stable playback.
+  constexpr uint32_t kDepthShrinkIntervalFrames = 1024;
+  constexpr uint32_t kDepthGrowStep = 2;
+  constexpr uint32_t kDepthMin = 4;
+
+  ClientQueue& queue = client_queues_[index];
+  const AudioDriver& driver = *clients_[index].driver;
+  uint64_t underrun_count = driver.underrun_count();
+  uint32_t queued_frame_count = driver.queued_frame_count();
+
+  if (cvars::apu_adaptive_queued_frames) {
+    if (underrun_count != queue.last_underrun_count) {
+      // Not enough frames were in flight to hide the host-side jitter.
+      queue.depth = std::min(queue.depth + kDepthGrowStep,
+                             uint32_t(kMaximumQueuedFrames));
+      queue.frames_since_depth_change = 0;
+      queue.min_queued_frames_since_depth_change = UINT32_MAX;
+    } else {
+      queue.min_queued_frames_since_depth_change = std::min(
+          queue.min_queued_frames_since_depth_change, queued_frame_count);
+      if (++queue.frames_since_depth_change >= kDepthShrinkIntervalFrames) {
+        // Only shrink if the queue has never been close to running out.
+        if (queue.depth > kDepthMin &&
+            queue.min_queued_frames_since_depth_change >= 2) {
+          --queue.depth;
+        }
+        queue.frames_since_depth_change = 0;
+        queue.min_queued_frames_since_depth_change = UINT32_MAX;
+      }
+    }
+    if (queue.capacity < queue.depth) {
+      client_semaphores_[index]->Release(
+          int(queue.depth - queue.capacity), nullptr);
+      queue.capacity = queue.depth;
+    }
+  }
+  queue.last_underrun_count = underrun_count;
+
+  COUNT_profile_set("apu/underruns", underrun_count);
+  COUNT_profile_set("apu/queued_frames", queued_frame_count);
+  COUNT_profile_set("apu/queue_depth", queue.depth);
+
+  if (queue.capacity > queue.depth) {
+    --queue.capacity;
+    return false;
+  }
+  return true;
+}
+
 void AudioSystem::Shutdown() {
   worker_running_ = false;
   shutdown_event_->Set();
@@ -187,6 +270,7 @@ X_STATUS AudioSystem::RegisterClient(uint32_t callback, uint32_t callback_arg,
   auto index = FindFreeClient();
   assert_true(index >= 0);
 
+  ResetClientQueue(index);
   auto client_semaphore = client_semaphores_[index].get();
   auto ret = client_semaphore->Release(queued_frames_, nullptr);
   assert_true(ret);
@@ -201,7 +285,10 @@ X_STATUS AudioSystem::RegisterClient(uint32_t callback, uint32_t callback_arg,
   uint32_t ptr = memory()->SystemHeapAlloc(0x4);
   xe::store_and_swap<uint32_t>(memory()->TranslateVirtual(ptr), callback_arg);
 
-  clients_[index] = {driver, callback, callback_arg, ptr, true};
+  {
+    std::lock_guard<std::mutex> driver_lock(client_driver_mutexes_[index]);
+    clients_[index] = {driver, callback, callback_arg, ptr, true};
+  }
 
   if (out_index) {
     *out_index = index;
@@ -213,10 +300,13 @@ X_STATUS AudioSystem::RegisterClient(uint32_t callback, uint32_t callback_arg,
 void AudioSystem::SubmitFrame(size_t index, float* samples) {
   SCOPE_profile_cpu_f("apu");
 
-  auto global_lock = global_critical_region_.Acquire();
   assert_true(index < kMaximumClientCount);
-  assert_true(clients_[index].driver != NULL);
-  (clients_[index].driver)->SubmitFrame(samples);
+  std::lock_guard<std::mutex> driver_lock(client_driver_mutexes_[index]);
+  AudioDriver* driver = clients_[index].driver;
+  assert_not_null(driver);
+  if (driver) {
+    driver->SubmitFrame(samples);
+  }
 }
 
 void AudioSystem::UnregisterClient(size_t index) {
@@ -224,9 +314,12 @@ void AudioSystem::UnregisterClient(size_t index) {
 
   auto global_lock = global_critical_region_.Acquire();
   assert_true(index < kMaximumClientCount);
-  DestroyDriver(clients_[index].driver);
-  memory()->SystemHeapFree(clients_[index].wrapped_callback_arg);
-  clients_[index] = {0};
+  {
+    std::lock_guard<std::mutex> driver_lock(client_driver_mutexes_[index]);
+    DestroyDriver(clients_[index].driver);
+    memory()->SystemHeapFree(clients_[index].wrapped_callback_arg);
+    clients_[index] = {0};
+  }
 
   // Drain the semaphore of its count.
   auto client_semaphore = client_semaphores_[index].get();
@@ -290,6 +383,7 @@ bool AudioSystem::Restore(ByteStream* stream) {
 
     client.in_use = true;
 
+    ResetClientQueue(id);
     auto client_semaphore = client_semaphores_[id].get();
     auto ret = client_semaphore->Release(queued_frames_, nullptr);
     assert_true(ret);
@@ -305,6 +399,7 @@ bool AudioSystem::Restore(ByteStream* stream) {
     }
 
     assert_not_null(driver);
+    std::lock_guard<std::mutex> driver_lock(client_driver_mutexes_[id]);
     client.driver = driver;
   }
 
@@ -11,6 +11,7 @@
 #define XENIA_APU_AUDIO_SYSTEM_H_
 
 #include <atomic>
+#include <mutex>
 #include <queue>
 
 #include "xenia/base/mutex.h"
@@ -89,9 +90,32 @@ class AudioSystem {
     uint32_t wrapped_callback_arg;
     bool in_use;
   } clients_[kMaximumClientCount];
+  // Held, in addition to global_critical_region_, while the driver of the
+  // client is created or destroyed, so SubmitFrame, called on the guest audio
+  // thread for every frame, only needs this lock and doesn't contend with the
+  // rest of the kernel while the driver queues the frame.
+  std::mutex client_driver_mutexes_[kMaximumClientCount];
 
   int FindFreeClient();
 
+  // Flow control of the frames in flight for each client, in slots of the
+  // client semaphore. Protected by global_critical_region_.
+  struct ClientQueue {
+    // Number of slots currently released to the semaphore and the driver.
+    uint32_t capacity;
+    // Number of slots desired, capacity is reduced towards it by absorbing the
+    // freed slots without calling the client.
+    uint32_t depth;
+    uint64_t last_underrun_count;
+    uint32_t frames_since_depth_change;
+    uint32_t min_queued_frames_since_depth_change;
+  };
+  ClientQueue client_queues_[kMaximumClientCount];
+  void ResetClientQueue(size_t index);
+  // Called when a slot of the client semaphore has been freed, returns whether
+  // the client should be called to submit a new frame into it.
+  bool UpdateClientQueue(size_t index);
+
   std::unique_ptr<xe::threading::Semaphore>
       client_semaphores_[kMaximumClientCount];
   // Event is always there in case we have no clients.
@@ -10,98 +10,155 @@
 #ifndef XENIA_APU_CONVERSION_H_
 #define XENIA_APU_CONVERSION_H_
 
+#include <cstddef>
 #include <cstdint>
 
+#include "xenia/base/assert.h"
 #include "xenia/base/byte_order.h"
 #include "xenia/base/platform.h"
 
+#if XE_ARCH_ARM64
+#include <arm_neon.h>
+#endif  // XE_ARCH
+
 namespace xe {
 namespace apu {
 namespace conversion {
 
+// The guest frames are planar big endian 5.1 - default 5.1 channel mapping is
+// fl, fr, fc, lf, bl, br:
+// https://docs.microsoft.com/en-us/windows/win32/xaudio2/xaudio2-default-channel-mapping
+// The host layouts are interleaved little endian:
+// - 2: fl, fr.
+// - 4: fl, fr, bl, br.
+// - 6: fl, fr, fc, lf, bl, br.
+// - 8: fl, fr, fc, lf, bl, br, sl, sr.
+// Downmixing puts the center on the front speakers and discards the low
+// frequency channel.
+
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+#define XE_APU_CONVERSION_SIMD 1
+
+// 4 channel samples at once.
 #if XE_ARCH_AMD64
+using SimdF32 = __m128;
+
+inline SimdF32 LoadBigEndianF32x4(const float* source) {
+  const __m128i byte_swap_shuffle =
+      _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  return _mm_castsi128_ps(_mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)),
+      byte_swap_shuffle));
+}
+inline SimdF32 ReplicateF32(float value) { return _mm_set1_ps(value); }
+inline SimdF32 ZeroF32() { return _mm_setzero_ps(); }
+inline SimdF32 AddF32(SimdF32 a, SimdF32 b) { return _mm_add_ps(a, b); }
+inline SimdF32 MulF32(SimdF32 a, SimdF32 b) { return _mm_mul_ps(a, b); }
+// Writes 2 adjacent channels of 4 interleaved samples.
+inline void StoreChannelPairF32x4(float* output, size_t output_channels,
+                                  SimdF32 a, SimdF32 b) {
+  __m128 samples_01 = _mm_unpacklo_ps(a, b);
+  __m128 samples_23 = _mm_unpackhi_ps(a, b);
+  _mm_storel_pi(reinterpret_cast<__m64*>(output), samples_01);
+  _mm_storeh_pi(reinterpret_cast<__m64*>(output + output_channels),
+                samples_01);
+  _mm_storel_pi(reinterpret_cast<__m64*>(output + output_channels * 2),
+                samples_23);
+  _mm_storeh_pi(reinterpret_cast<__m64*>(output + output_channels * 3),
+                samples_23);
+}
+#elif XE_ARCH_ARM64
+using SimdF32 = float32x4_t;
+
+inline SimdF32 LoadBigEndianF32x4(const float* source) {
+  return vreinterpretq_f32_u8(
+      vrev32q_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(source))));
+}
+inline SimdF32 ReplicateF32(float value) { return vdupq_n_f32(value); }
+inline SimdF32 ZeroF32() { return vdupq_n_f32(0.0f); }
+inline SimdF32 AddF32(SimdF32 a, SimdF32 b) { return vaddq_f32(a, b); }
+inline SimdF32 MulF32(SimdF32 a, SimdF32 b) { return vmulq_f32(a, b); }
+// Writes 2 adjacent channels of 4 interleaved samples.
+inline void StoreChannelPairF32x4(float* output, size_t output_channels,
+                                  SimdF32 a, SimdF32 b) {
+  float32x4x2_t samples = vzipq_f32(a, b);
+  vst1_f32(output, vget_low_f32(samples.val[0]));
+  vst1_f32(output + output_channels, vget_high_f32(samples.val[0]));
+  vst1_f32(output + output_channels * 2, vget_low_f32(samples.val[1]));
+  vst1_f32(output + output_channels * 3, vget_high_f32(samples.val[1]));
+}
+#endif  // XE_ARCH
 
-XE_NOINLINE
-static void _generic_sequential_6_BE_to_interleaved_6_LE(
-    float* XE_RESTRICT output, const float* XE_RESTRICT input,
-    unsigned ch_sample_count) {
-  for (unsigned sample = 0; sample < ch_sample_count; sample++) {
-    for (unsigned channel = 0; channel < 6; channel++) {
-      unsigned int value = *reinterpret_cast<const unsigned int*>(
-          &input[channel * ch_sample_count + sample]);
-
-      *reinterpret_cast<unsigned int*>(&output[sample * 6 + channel]) =
-          xe::byte_swap(value);
+inline void sequential_6_BE_to_interleaved_6_LE(float* output,
+                                                const float* input,
+                                                size_t ch_sample_count) {
+  assert_true(ch_sample_count % 4 == 0);
+  for (size_t sample = 0; sample < ch_sample_count; sample += 4) {
+    float* sample_output = &output[sample * 6];
+    for (size_t channel = 0; channel < 6; channel += 2) {
+      StoreChannelPairF32x4(
+          sample_output + channel, 6,
+          LoadBigEndianF32x4(&input[channel * ch_sample_count + sample]),
+          LoadBigEndianF32x4(&input[(channel + 1) * ch_sample_count + sample]));
     }
   }
 }
-#if XE_COMPILER_CLANG_CL != 1 && !XE_PLATFORM_LINUX
-// load_be_u32 unavailable on clang-cl
-XE_NOINLINE
-static void _movbe_sequential_6_BE_to_interleaved_6_LE(
-    float* XE_RESTRICT output, const float* XE_RESTRICT input,
-    unsigned ch_sample_count) {
-  for (unsigned sample = 0; sample < ch_sample_count; sample++) {
-    for (unsigned channel = 0; channel < 6; channel++) {
-      *reinterpret_cast<unsigned int*>(&output[sample * 6 + channel]) =
-          _load_be_u32(reinterpret_cast<const unsigned int*>(
-              &input[channel * ch_sample_count + sample]));
+
+inline void sequential_6_BE_to_interleaved_8_LE(float* output,
+                                                const float* input,
+                                                size_t ch_sample_count) {
+  assert_true(ch_sample_count % 4 == 0);
+  const SimdF32 zero = ZeroF32();
+  for (size_t sample = 0; sample < ch_sample_count; sample += 4) {
+    float* sample_output = &output[sample * 8];
+    for (size_t channel = 0; channel < 6; channel += 2) {
+      StoreChannelPairF32x4(
+          sample_output + channel, 8,
+          LoadBigEndianF32x4(&input[channel * ch_sample_count + sample]),
+          LoadBigEndianF32x4(&input[(channel + 1) * ch_sample_count + sample]));
     }
+    // No side channels in the source.
+    StoreChannelPairF32x4(sample_output + 6, 8, zero, zero);
   }
 }
 
-inline static void sequential_6_BE_to_interleaved_6_LE(
-    float* output, const float* input, unsigned ch_sample_count) {
-  if (amd64::GetFeatureFlags() & amd64::kX64EmitMovbe) {
-    _movbe_sequential_6_BE_to_interleaved_6_LE(output, input, ch_sample_count);
-  } else {
-    _generic_sequential_6_BE_to_interleaved_6_LE(output, input,
-                                                 ch_sample_count);
+inline void sequential_6_BE_to_interleaved_4_LE(float* output,
+                                                const float* input,
+                                                size_t ch_sample_count) {
+  assert_true(ch_sample_count % 4 == 0);
+  const SimdF32 half = ReplicateF32(0.5f);
+  const SimdF32 two_thirds = ReplicateF32(1.0f / 1.5f);
+  for (size_t sample = 0; sample < ch_sample_count; sample += 4) {
+    SimdF32 fl = LoadBigEndianF32x4(&input[0 * ch_sample_count + sample]);
+    SimdF32 fr = LoadBigEndianF32x4(&input[1 * ch_sample_count + sample]);
+    SimdF32 fc = LoadBigEndianF32x4(&input[2 * ch_sample_count + sample]);
+    SimdF32 bl = LoadBigEndianF32x4(&input[4 * ch_sample_count + sample]);
+    SimdF32 br = LoadBigEndianF32x4(&input[5 * ch_sample_count + sample]);
+    SimdF32 center_halved = MulF32(fc, half);
+    StoreChannelPairF32x4(&output[sample * 4], 4,
+                          MulF32(AddF32(fl, center_halved), two_thirds),
+                          MulF32(AddF32(fr, center_halved), two_thirds));
+    StoreChannelPairF32x4(&output[sample * 4 + 2], 4, bl, br);
   }
 }
-#else
-inline static void sequential_6_BE_to_interleaved_6_LE(
-    float* output, const float* input, unsigned ch_sample_count) {
-  _generic_sequential_6_BE_to_interleaved_6_LE(output, input, ch_sample_count);
-}
-#endif
 
 inline void sequential_6_BE_to_interleaved_2_LE(float* output,
                                                 const float* input,
                                                 size_t ch_sample_count) {
   assert_true(ch_sample_count % 4 == 0);
-  const __m128i byte_swap_shuffle =
-      _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
-  const __m128 half = _mm_set1_ps(0.5f);
-  const __m128 two_fifths = _mm_set1_ps(1.0f / 2.5f);
-
-  // put center on left and right, discard low frequency
+  const SimdF32 half = ReplicateF32(0.5f);
+  const SimdF32 two_fifths = ReplicateF32(1.0f / 2.5f);
   for (size_t sample = 0; sample < ch_sample_count; sample += 4) {
-    // load 4 samples from 6 channels each
-    __m128 fl = _mm_loadu_ps(&input[0 * ch_sample_count + sample]);
-    __m128 fr = _mm_loadu_ps(&input[1 * ch_sample_count + sample]);
-    __m128 fc = _mm_loadu_ps(&input[2 * ch_sample_count + sample]);
-    __m128 bl = _mm_loadu_ps(&input[4 * ch_sample_count + sample]);
-    __m128 br = _mm_loadu_ps(&input[5 * ch_sample_count + sample]);
-    // byte swap
-    fl = _mm_castsi128_ps(
-        _mm_shuffle_epi8(_mm_castps_si128(fl), byte_swap_shuffle));
-    fr = _mm_castsi128_ps(
-        _mm_shuffle_epi8(_mm_castps_si128(fr), byte_swap_shuffle));
-    fc = _mm_castsi128_ps(
-        _mm_shuffle_epi8(_mm_castps_si128(fc), byte_swap_shuffle));
-    bl = _mm_castsi128_ps(
-        _mm_shuffle_epi8(_mm_castps_si128(bl), byte_swap_shuffle));
-    br = _mm_castsi128_ps(
-        _mm_shuffle_epi8(_mm_castps_si128(br), byte_swap_shuffle));
-
-    __m128 center_halved = _mm_mul_ps(fc, half);
-    __m128 left = _mm_add_ps(_mm_add_ps(fl, bl), center_halved);
-    __m128 right = _mm_add_ps(_mm_add_ps(fr, br), center_halved);
-    left = _mm_mul_ps(left, two_fifths);
-    right = _mm_mul_ps(right, two_fifths);
-    _mm_storeu_ps(&output[sample * 2], _mm_unpacklo_ps(left, right));
-    _mm_storeu_ps(&output[(sample + 2) * 2], _mm_unpackhi_ps(left, right));
+    SimdF32 fl = LoadBigEndianF32x4(&input[0 * ch_sample_count + sample]);
+    SimdF32 fr = LoadBigEndianF32x4(&input[1 * ch_sample_count + sample]);
+    SimdF32 fc = LoadBigEndianF32x4(&input[2 * ch_sample_count + sample]);
+    SimdF32 bl = LoadBigEndianF32x4(&input[4 * ch_sample_count + sample]);
+    SimdF32 br = LoadBigEndianF32x4(&input[5 * ch_sample_count + sample]);
+    SimdF32 center_halved = MulF32(fc, half);
+    StoreChannelPairF32x4(
+        &output[sample * 2], 2,
+        MulF32(AddF32(AddF32(fl, bl), center_halved), two_fifths),
+        MulF32(AddF32(AddF32(fr, br), center_halved), two_fifths));
   }
 }
 #else
@@ -115,24 +172,77 @@ inline void sequential_6_BE_to_interleaved_6_LE(float* output,
     }
   }
 }
+inline void sequential_6_BE_to_interleaved_8_LE(float* output,
+                                                const float* input,
+                                                size_t ch_sample_count) {
+  for (size_t sample = 0; sample < ch_sample_count; sample++) {
+    for (size_t channel = 0; channel < 6; channel++) {
+      output[sample * 8 + channel] =
+          xe::byte_swap(input[channel * ch_sample_count + sample]);
+    }
+    output[sample * 8 + 6] = 0.0f;
+    output[sample * 8 + 7] = 0.0f;
+  }
+}
+inline void sequential_6_BE_to_interleaved_4_LE(float* output,
+                                                const float* input,
+                                                size_t ch_sample_count) {
+  for (size_t sample = 0; sample < ch_sample_count; sample++) {
+    float fl = xe::byte_swap(input[0 * ch_sample_count + sample]);
+    float fr = xe::byte_swap(input[1 * ch_sample_count + sample]);
+    float fc = xe::byte_swap(input[2 * ch_sample_count + sample]);
+    float bl = xe::byte_swap(input[4 * ch_sample_count + sample]);
+    float br = xe::byte_swap(input[5 * ch_sample_count + sample]);
+    float center_halved = fc * 0.5f;
+    output[sample * 4] = (fl + center_halved) * (1.0f / 1.5f);
+    output[sample * 4 + 1] = (fr + center_halved) * (1.0f / 1.5f);
+    output[sample * 4 + 2] = bl;
+    output[sample * 4 + 3] = br;
+  }
+}
 inline void sequential_6_BE_to_interleaved_2_LE(float* output,
                                                 const float* input,
                                                 size_t ch_sample_count) {
-  // Default 5.1 channel mapping is fl, fr, fc, lf, bl, br
-  // https://docs.microsoft.com/en-us/windows/win32/xaudio2/xaudio2-default-channel-mapping
   for (size_t sample = 0; sample < ch_sample_count; sample++) {
-    // put center on left and right, discard low frequency
     float fl = xe::byte_swap(input[0 * ch_sample_count + sample]);
     float fr = xe::byte_swap(input[1 * ch_sample_count + sample]);
     float fc = xe::byte_swap(input[2 * ch_sample_count + sample]);
-    float br = xe::byte_swap(input[4 * ch_sample_count + sample]);
-    float bl = xe::byte_swap(input[5 * ch_sample_count + sample]);
+    float bl = xe::byte_swap(input[4 * ch_sample_count + sample]);
+    float br = xe::byte_swap(input[5 * ch_sample_count + sample]);
     float center_halved = fc * 0.5f;
     output[sample * 2] = (fl + bl + center_halved) * (1.0f / 2.5f);
     output[sample * 2 + 1] = (fr + br + center_halved) * (1.0f / 2.5f);
   }
 }
-#endif
+#endif  // XE_ARCH
+
+// Returns whether the host channel count is supported by
+// sequential_6_BE_to_interleaved.
+constexpr bool IsInterleavedLEChannelCountSupported(uint32_t channels) {
+  return channels == 2 || channels == 4 || channels == 6 || channels == 8;
+}
+
+inline void sequential_6_BE_to_interleaved_LE(float* output, const float* input,
+                                              size_t ch_sample_count,
+                                              uint32_t output_channels) {
+  switch (output_channels) {
+    case 2:
+      sequential_6_BE_to_interleaved_2_LE(output, input, ch_sample_count);
+      break;
+    case 4:
+      sequential_6_BE_to_interleaved_4_LE(output, input, ch_sample_count);
+      break;
+    case 6:
+      sequential_6_BE_to_interleaved_6_LE(output, input, ch_sample_count);
+      break;
+    case 8:
+      sequential_6_BE_to_interleaved_8_LE(output, input, ch_sample_count);
+      break;
+    default:
+      assert_unhandled_case(output_channels);
+      break;
+  }
+}
 
 }  // namespace conversion
 }  // namespace apu
@@ -13,6 +13,7 @@
 #include <cstring>
 
 #include "xenia/apu/apu_flags.h"
+#include "xenia/apu/audio_system.h"
 #include "xenia/apu/conversion.h"
 #include "xenia/base/assert.h"
 #include "xenia/base/logging.h"
@@ -43,12 +44,14 @@ SDLAudioDriver::SDLAudioDriver(xe::threading::Semaphore* semaphore,
   frame_size_ = sizeof(float) * frame_channels_ * channel_samples_;
   assert_true(frame_size_ <= kFrameSizeMax);
   assert_true(!need_format_conversion_ || frame_channels_ == 6);
+  // No more frames can be in flight than the semaphore allows.
+  size_t frame_ring_capacity = frame_size_ * AudioSystem::kMaximumQueuedFrames;
+  frame_ring_data_ = std::make_unique<uint8_t[]>(frame_ring_capacity);
+  frame_ring_ = std::make_unique<SpscRingBuffer>(frame_ring_data_.get(),
+                                                 frame_ring_capacity);
 }
 
-SDLAudioDriver::~SDLAudioDriver() {
-  assert_true(frames_queued_.empty());
-  assert_true(frames_unused_.empty());
-};
+SDLAudioDriver::~SDLAudioDriver() = default;
 
 bool SDLAudioDriver::Initialize() {
   SDL_version ver = {};
@@ -76,8 +79,8 @@ bool SDLAudioDriver::Initialize() {
   desired_spec.samples = channel_samples_;
   desired_spec.callback = SDLCallback;
   desired_spec.userdata = this;
-  // Allow the hardware to decide between 5.1 and stereo,
-  // unless the input is stereo
+  // Allow the hardware to decide the speaker layout, unless the input is
+  // stereo
   int allowed_change =
       frame_channels_ != 2 ? SDL_AUDIO_ALLOW_CHANNELS_CHANGE : 0;
   for (int i = 0; i < 2; i++) {
@@ -87,10 +90,13 @@ bool SDLAudioDriver::Initialize() {
       XELOGE("SDL_OpenAudioDevice() failed.");
       return false;
     }
-    if (obtained_spec.channels == 2 || obtained_spec.channels == 6) {
+    if (obtained_spec.channels == frame_channels_ ||
+        (need_format_conversion_ &&
+         conversion::IsInterleavedLEChannelCountSupported(
+             obtained_spec.channels))) {
       break;
     }
-    // If the system is 4 or 7.1, let SDL convert
+    // If the layout is not supported by the conversion, let SDL convert
     allowed_change = 0;
     SDL_CloseAudioDevice(sdl_device_id_);
     sdl_device_id_ = -1;
@@ -107,23 +113,16 @@ bool SDLAudioDriver::Initialize() {
 }
 
 void SDLAudioDriver::SubmitFrame(float* frame) {
-  float* output_frame;
-  {
-    std::unique_lock<std::mutex> guard(frames_mutex_);
-    if (frames_unused_.empty()) {
-      output_frame = new float[frame_channels_ * channel_samples_];
-    } else {
-      output_frame = frames_unused_.top();
-      frames_unused_.pop();
-    }
-  }
-
-  std::memcpy(output_frame, frame, frame_size_);
-
-  {
-    std::unique_lock<std::mutex> guard(frames_mutex_);
-    frames_queued_.push(output_frame);
+  SpscRingBuffer::WriteRange range = frame_ring_->BeginWrite(frame_size_);
+  if (range.first_length < frame_size_) {
+    assert_always("More audio frames submitted than the semaphore allows");
+    return;
   }
+  std::memcpy(range.first, frame, frame_size_);
+  frame_ring_->EndWrite(frame_size_);
+  queued_frame_count_.store(
+      (frame_ring_->capacity() - frame_ring_->write_count()) / frame_size_,
+      std::memory_order_relaxed);
 }
 
 void SDLAudioDriver::Pause() { SDL_PauseAudioDevice(sdl_device_id_, 1); }
@@ -139,15 +138,6 @@ void SDLAudioDriver::Shutdown() {
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
     sdl_initialized_ = false;
   }
-  std::unique_lock<std::mutex> guard(frames_mutex_);
-  while (!frames_unused_.empty()) {
-    delete[] frames_unused_.top();
-    frames_unused_.pop();
-  };
-  while (!frames_queued_.empty()) {
-    delete[] frames_queued_.front();
-    frames_queued_.pop();
-  };
 }
 
 void SDLAudioDriver::SDLCallback(void* userdata, Uint8* stream, int len) {
@@ -160,42 +150,40 @@ void SDLAudioDriver::SDLCallback(void* userdata, Uint8* stream, int len) {
   assert_true(len == sizeof(float) * driver->channel_samples_ *
                          driver->sdl_device_channels_);
 
-  std::unique_lock<std::mutex> guard(driver->frames_mutex_);
-  if (driver->frames_queued_.empty()) {
+  // Frames are written whole, and the capacity is a multiple of the frame
+  // size, so they never wrap around.
+  RingBuffer::ReadRange range =
+      driver->frame_ring_->BeginRead(driver->frame_size_);
+  if (range.first_length < driver->frame_size_) {
     std::memset(stream, 0, len);
+    // Waiting for the first frame is not an underrun.
+    if (driver->frame_consumed_) {
+      driver->underrun_count_.fetch_add(1, std::memory_order_relaxed);
+    }
   } else {
-    auto buffer = driver->frames_queued_.front();
-    driver->frames_queued_.pop();
+    auto buffer = reinterpret_cast<const float*>(range.first);
     if (cvars::mute) {
       std::memset(stream, 0, len);
     } else if (driver->need_format_conversion_) {
-      switch (driver->sdl_device_channels_) {
-        case 2:
-          conversion::sequential_6_BE_to_interleaved_2_LE(
-              reinterpret_cast<float*>(stream), buffer,
-              driver->channel_samples_);
-          break;
-        case 6:
-          conversion::sequential_6_BE_to_interleaved_6_LE(
-              reinterpret_cast<float*>(stream), buffer,
-              driver->channel_samples_);
-          break;
-        default:
-          assert_unhandled_case(driver->sdl_device_channels_);
-          break;
-      }
+      conversion::sequential_6_BE_to_interleaved_LE(
+          reinterpret_cast<float*>(stream), buffer, driver->channel_samples_,
+          driver->sdl_device_channels_);
     } else {
       assert_true(driver->sdl_device_channels_ == driver->frame_channels_);
       if (driver->volume_ != 1.0f) {
         std::memset(stream, 0, len);
         SDL_MixAudioFormat(
-            stream, reinterpret_cast<Uint8*>(buffer), AUDIO_F32, len,
+            stream, reinterpret_cast<const Uint8*>(buffer), AUDIO_F32, len,
             static_cast<int>(driver->volume_ * SDL_MIX_MAXVOLUME));
       } else {
         std::memcpy(stream, buffer, len);
       }
     }
-    driver->frames_unused_.push(buffer);
+    driver->frame_ring_->EndRead(driver->frame_size_);
+    driver->frame_consumed_ = true;
+    driver->queued_frame_count_.store(
+        driver->frame_ring_->read_count() / driver->frame_size_,
+        std::memory_order_relaxed);
 
     auto ret = driver->semaphore_->Release(1, nullptr);
     assert_true(ret);
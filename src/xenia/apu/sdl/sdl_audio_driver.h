@@ -10,12 +10,12 @@
 #ifndef XENIA_APU_SDL_SDL_AUDIO_DRIVER_H_
 #define XENIA_APU_SDL_SDL_AUDIO_DRIVER_H_
 
-#include <mutex>
-#include <queue>
-#include <stack>
+#include <cstdint>
+#include <memory>
 
 #include "SDL.h"
 #include "xenia/apu/audio_driver.h"
+#include "xenia/base/ring_buffer.h"
 #include "xenia/base/threading.h"
 
 namespace xe {
@@ -53,9 +53,12 @@ class SDLAudioDriver : public AudioDriver {
   uint32_t channel_samples_;
   uint32_t frame_size_;
   bool need_format_conversion_;
-  std::queue<float*> frames_queued_ = {};
-  std::stack<float*> frames_unused_ = {};
-  std::mutex frames_mutex_ = {};
+  // Whole frames, from the thread submitting them to the SDL callback, which
+  // converts them in place.
+  std::unique_ptr<uint8_t[]> frame_ring_data_;
+  std::unique_ptr<SpscRingBuffer> frame_ring_;
+  // SDL callback only.
+  bool frame_consumed_ = false;
 };
 
 }  // namespace sdl
@@ -213,6 +213,12 @@ void XAudio2AudioDriver::SubmitFrame(float* frame) {
     objects_.api_2_7.pcm_voice->GetState(&state);
   }
   assert_true(state.BuffersQueued < frame_count_);
+  if (!state.BuffersQueued && has_submitted_frame_) {
+    // The voice has played everything before this frame arrived.
+    underrun_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  has_submitted_frame_ = true;
+  queued_frame_count_.store(state.BuffersQueued + 1, std::memory_order_relaxed);
 
   auto output_frame = reinterpret_cast<float*>(frames_[current_frame_]);
 
@@ -247,12 +253,16 @@ void XAudio2AudioDriver::SubmitFrame(float* frame) {
   current_frame_ = (current_frame_ + 1) % frame_count_;
 
   // Update playback ratio to our time scalar.
-  // This will keep audio in sync with the game clock.
+  // This will keep audio in sync with the game clock. The scalar rarely
+  // changes, so not queueing a voice parameter change for every frame.
   float frequency_ratio = static_cast<float>(xe::Clock::guest_time_scalar());
-  if (api_minor_version_ >= 8) {
-    objects_.api_2_8.pcm_voice->SetFrequencyRatio(frequency_ratio);
-  } else {
-    objects_.api_2_7.pcm_voice->SetFrequencyRatio(frequency_ratio);
+  if (frequency_ratio != frequency_ratio_) {
+    if (api_minor_version_ >= 8) {
+      objects_.api_2_8.pcm_voice->SetFrequencyRatio(frequency_ratio);
+    } else {
+      objects_.api_2_7.pcm_voice->SetFrequencyRatio(frequency_ratio);
+    }
+    frequency_ratio_ = frequency_ratio;
   }
 }
 
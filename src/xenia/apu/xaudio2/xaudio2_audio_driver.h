@@ -109,7 +109,10 @@ class XAudio2AudioDriver : public AudioDriver {
   static const uint32_t frame_count_ = api::XE_XAUDIO2_MAX_QUEUED_BUFFERS;
 
   float frames_[frame_count_][kFrameSamplesMax];
+  bool has_submitted_frame_ = false;
   uint32_t current_frame_ = 0;
+  // Last passed to SetFrequencyRatio, the voice is created with 1.
+  float frequency_ratio_ = 1.0f;
 };
 
 }  // namespace xaudio2
@@ -14,11 +14,16 @@
 
 #include "xenia/apu/xma_decoder.h"
 #include "xenia/base/bit_stream.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/platform.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/ring_buffer.h"
 
+#if XE_ARCH_ARM64
+#include <arm_neon.h>
+#endif  // XE_ARCH
+
 extern "C" {
 #if XE_COMPILER_MSVC
 #pragma warning(push)
@@ -36,6 +41,9 @@ extern "C" {
 namespace xe {
 namespace apu {
 
+static xe::counters::Counter& decoded_frames_counter =
+    xe::counters::GetCounter("apu/xma/decoded_frames");
+
 XmaContext::XmaContext() = default;
 
 XmaContext::~XmaContext() {}
@@ -57,6 +65,8 @@ void XmaContext::DumpRaw(AVFrame* frame, int id) {
 
 void XmaContext::ConvertFrame(const uint8_t** samples, bool is_two_channel,
                               uint8_t* output_buffer) {
+  decoded_frames_counter.Increment();
+
   // Loop through every sample, convert and drop it into the output array.
   // If more than one channel, we need to interleave the samples from each
   // channel next to each other. Always saturate because FFmpeg output is
@@ -114,6 +124,35 @@ void XmaContext::ConvertFrame(const uint8_t** samples, bool is_two_channel,
       _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), out_mm);
     }
   }
+#elif XE_ARCH_ARM64
+  static_assert(kSamplesPerFrame % 8 == 0);
+  const auto in_channel_0 = reinterpret_cast<const float*>(samples[0]);
+  const auto in_channel_1 =
+      is_two_channel ? reinterpret_cast<const float*>(samples[1]) : nullptr;
+  const float32x4_t scale_v = vdupq_n_f32(scale);
+  // Rescale, round to the nearest like cvtps2dq, saturate to int16 and byte
+  // swap 8 samples.
+  auto convert_8 = [scale_v](const float* in) {
+    int32x4_t samples_0 = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in), scale_v));
+    int32x4_t samples_1 =
+        vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + 4), scale_v));
+    int16x8_t samples_16 =
+        vcombine_s16(vqmovn_s32(samples_0), vqmovn_s32(samples_1));
+    return vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_s16(samples_16)));
+  };
+  if (in_channel_1) {
+    for (uint32_t i = 0; i < kSamplesPerFrame; i += 8) {
+      int16x8x2_t out_v;
+      out_v.val[0] = convert_8(&in_channel_0[i]);
+      out_v.val[1] = convert_8(&in_channel_1[i]);
+      // Interleave the channels.
+      vst2q_s16(&out[i * 2], out_v);
+    }
+  } else {
+    for (uint32_t i = 0; i < kSamplesPerFrame; i += 8) {
+      vst1q_s16(&out[i], convert_8(&in_channel_0[i]));
+    }
+  }
 #else
   uint32_t o = 0;
   for (uint32_t i = 0; i < kSamplesPerFrame; i++) {
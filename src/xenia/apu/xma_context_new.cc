@@ -309,8 +309,6 @@ void XmaContextNew::Decode(XMA_CONTEXT_DATA* data) {
     return;
   }
 
-  input_buffer_.fill(0);
-
   UpdateLoopStatus(data);
 
   if (!data->output_buffer_block_count) {
@@ -366,34 +364,40 @@ void XmaContextNew::Decode(XMA_CONTEXT_DATA* data) {
     return;
   }
 
-  if (packet_info.isLastFrameInPacket()) {
-    // Frame is a splitted frame
-    if (stream.BitsRemaining() < packet_info.current_frame_size_) {
-      const uint8_t* next_packet =
-          GetNextPacket(data, next_packet_index, current_input_packet_count);
+  if (packet_info.isLastFrameInPacket() &&
+      stream.BitsRemaining() < packet_info.current_frame_size_) {
+    // Frame is a splitted frame, join the data of the two packets.
+    const uint8_t* next_packet =
+        GetNextPacket(data, next_packet_index, current_input_packet_count);
 
-      if (!next_packet) {
-        // Error path
-        // Decoder probably should return error here
-        // Not sure what error code should be returned
-        data->error_status = 4;
-        return;
-      }
-      // Copy next packet to buffer
-      std::memcpy(input_buffer_.data() + kBytesPerPacketData,
-                  next_packet + kBytesPerPacketHeader, kBytesPerPacketData);
+    if (!next_packet) {
+      // Error path
+      // Decoder probably should return error here
+      // Not sure what error code should be returned
+      data->error_status = 4;
+      return;
     }
+    std::memcpy(input_buffer_.data(), packet + kBytesPerPacketHeader,
+                kBytesPerPacketData);
+    std::memcpy(input_buffer_.data() + kBytesPerPacketData,
+                next_packet + kBytesPerPacketHeader, kBytesPerPacketData);
+    stream = BitStream(input_buffer_.data(),
+                       (kBitsPerPacket - kBitsPerPacketHeader) * 2);
+  } else {
+    // The whole frame is in the current packet, read it directly from the
+    // guest input buffer.
+    stream = BitStream(packet + kBytesPerPacketHeader,
+                       kBitsPerPacket - kBitsPerPacketHeader);
   }
-
-  // Copy current packet to buffer
-  std::memcpy(input_buffer_.data(), packet + kBytesPerPacketHeader,
-              kBytesPerPacketData);
-
-  stream = BitStream(input_buffer_.data(),
-                     (kBitsPerPacket - kBitsPerPacketHeader) * 2);
   stream.SetOffset(relative_offset - kBitsPerPacketHeader);
 
-  xma_frame_.fill(0);
+  // Copy merges the partial bytes at the ends with the existing contents, so
+  // only the bytes to be written and the padding FFmpeg may read need to be
+  // cleared, not the whole maximum-sized frame.
+  std::memset(xma_frame_.data(), 0,
+              std::min(xma_frame_.size(),
+                       size_t(1 + (packet_info.current_frame_size_ + 7) / 8 +
+                              1 + AV_INPUT_BUFFER_PADDING_SIZE)));
 
   XELOGAPU(
       "XmaContext {}: Reading Frame {}/{} (size: {}) From Packet "
@@ -405,14 +409,20 @@ void XmaContextNew::Decode(XMA_CONTEXT_DATA* data) {
   const uint32_t padding_start = static_cast<uint8_t>(
       stream.Copy(xma_frame_.data() + 1, packet_info.current_frame_size_));
 
-  raw_frame_.fill(0);
-
   PrepareDecoder(data->sample_rate, bool(data->is_stereo));
   PreparePacket(packet_info.current_frame_size_, padding_start);
   if (DecodePacket(av_context_, av_packet_, av_frame_)) {
     // dump_raw(av_frame_, id());
+    // Converting overwrites the whole frame, unless the decoder has returned
+    // fewer channels than expected.
+    if (data->is_stereo && !av_frame_->data[1]) {
+      raw_frame_.fill(0);
+    }
     ConvertFrame(reinterpret_cast<const uint8_t**>(&av_frame_->data),
                  bool(data->is_stereo), raw_frame_.data());
+  } else {
+    // Output silence for the frame that failed to decode.
+    raw_frame_.fill(0);
   }
 
   // TODO: Write function to regenerate decoder
@@ -571,7 +581,7 @@ const kPacketInfo XmaContextNew::GetPacketInfo(uint8_t* packet,
   kPacketInfo packet_info = {};
 
   const uint32_t first_frame_offset = xma::GetPacketFrameOffset(packet);
-  BitStream stream(packet, kBitsPerPacket);
+  BitReader stream(packet, kBitsPerPacket);
   stream.SetOffset(first_frame_offset);
 
   // Handling of splitted frame
@@ -254,7 +254,7 @@ bool XmaContextOld::ValidFrameOffset(uint8_t* block, size_t size_bytes,
     return false;
   }
 
-  BitStream stream(packet, kBitsPerPacket);
+  BitReader stream(packet, kBitsPerPacket);
   stream.SetOffset(first_frame_offset);
   while (true) {
     if (stream.offset_bits() == relative_offset_bits) {
@@ -782,7 +782,7 @@ size_t XmaContextOld::GetNextFrame(uint8_t* block, size_t size,
   // kBitsPerPacket;
   auto packet_idx = GetFramePacketNumber(block, size, bit_offset);
 
-  BitStream stream(block, size * 8);
+  BitReader stream(block, size * 8);
   stream.SetOffset(bit_offset);
 
   if (stream.BitsRemaining() < 15) {
@@ -847,7 +847,7 @@ std::tuple<int, int> XmaContextOld::GetFrameNumber(uint8_t* block, size_t size,
 
   uint8_t* packet = block + (packet_idx * kBytesPerPacket);
   auto first_frame_offset = xma::GetPacketFrameOffset(packet);
-  BitStream stream(block, size * 8);
+  BitReader stream(block, size * 8);
   stream.SetOffset(packet_idx * kBitsPerPacket + first_frame_offset);
 
   int frame_idx = 0;
@@ -887,7 +887,7 @@ std::tuple<int, bool> XmaContextOld::GetPacketFrameCount(uint8_t* packet) {
     return {0, false};
   }
 
-  BitStream stream(packet, kBitsPerPacket);
+  BitReader stream(packet, kBitsPerPacket);
   stream.SetOffset(first_frame_offset);
   int frame_count = 0;
 
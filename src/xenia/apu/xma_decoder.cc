@@ -9,16 +9,20 @@
 
 #include "xenia/apu/xma_decoder.h"
 
+#include <algorithm>
+
 #include "xenia/apu/xma_context.h"
 #include "xenia/apu/xma_context_new.h"
 #include "xenia/apu/xma_context_old.h"
 
+#include "xenia/base/counters.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/ring_buffer.h"
 #include "xenia/base/string_buffer.h"
+#include "xenia/base/threading.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/cpu/thread_state.h"
 #include "xenia/kernel/kernel_state.h"
@@ -62,9 +66,18 @@ DEFINE_bool(use_dedicated_xma_thread, true,
             "better results, but decrease performance a bit.",
             "APU");
 
+DEFINE_int32(xma_decoder_threads, 0,
+             "Number of threads decoding XMA contexts in parallel when "
+             "use_dedicated_xma_thread is enabled, or 0 to choose based on the "
+             "number of logical processors.",
+             "APU");
+
 namespace xe {
 namespace apu {
 
+static xe::counters::Counter& work_time_counter =
+    xe::counters::GetCounter("apu/xma/work_us");
+
 XmaDecoder::XmaDecoder(cpu::Processor* processor)
     : memory_(processor->memory()), processor_(processor) {}
 
@@ -153,45 +166,69 @@ X_STATUS XmaDecoder::Setup(kernel::KernelState* kernel_state) {
   register_file_[XmaRegister::NextContextIndex] = 1;
   context_bitmap_.Resize(kContextCount);
 
+  worker_count_ = 1;
+  if (cvars::use_dedicated_xma_thread) {
+    if (cvars::xma_decoder_threads > 0) {
+      worker_count_ = uint32_t(cvars::xma_decoder_threads);
+    } else {
+      worker_count_ = xe::threading::logical_processor_count() / 4;
+    }
+    worker_count_ = std::clamp(worker_count_, uint32_t(1), uint32_t(16));
+  }
   worker_running_ = true;
-  work_event_ = xe::threading::Event::CreateAutoResetEvent(false);
-  assert_not_null(work_event_);
-  worker_thread_ =
-      kernel::object_ref<kernel::XHostThread>(new kernel::XHostThread(
-          kernel_state, 128 * 1024, 0,
-          [this]() {
-            if (cvars::use_dedicated_xma_thread) {
-              WorkerThreadMain();
-            }
-            return 0;
-          },
-          kernel_state
-              ->GetIdleProcess()));  // this one doesnt need any process
-                                     // actually. never calls any guest code
-  worker_thread_->set_name("XMA Decoder");
-  worker_thread_->set_can_debugger_suspend(true);
-  worker_thread_->Create();
+  for (uint32_t i = 0; i < worker_count_; ++i) {
+    work_events_.push_back(xe::threading::Event::CreateAutoResetEvent(false));
+    assert_not_null(work_events_.back());
+    pause_fences_.push_back(std::make_unique<xe::threading::Fence>());
+    resume_fences_.push_back(std::make_unique<xe::threading::Fence>());
+  }
+  for (uint32_t i = 0; i < worker_count_; ++i) {
+    auto worker_thread =
+        kernel::object_ref<kernel::XHostThread>(new kernel::XHostThread(
+            kernel_state, 128 * 1024, 0,
+            [this, i]() {
+              if (cvars::use_dedicated_xma_thread) {
+                WorkerThreadMain(i);
+              }
+              return 0;
+            },
+            kernel_state
+                ->GetIdleProcess()));  // this one doesnt need any process
+                                       // actually. never calls any guest code
+    worker_thread->set_name(i ? fmt::format("XMA Decoder {}", i)
+                              : std::string("XMA Decoder"));
+    worker_thread->set_can_debugger_suspend(true);
+    worker_thread->Create();
+    worker_threads_.push_back(std::move(worker_thread));
+  }
+  if (worker_count_ > 1) {
+    XELOGI("XMA: Decoding contexts on {} threads", worker_count_);
+  }
 
   return X_STATUS_SUCCESS;
 }
 
-void XmaDecoder::WorkerThreadMain() {
+void XmaDecoder::WorkerThreadMain(uint32_t worker_index) {
+  xe::threading::Event& work_event = *work_events_[worker_index];
   uint32_t idle_loop_count = 0;
   while (worker_running_) {
     // Okay, let's loop through XMA contexts to find ones we need to decode!
     bool did_work = false;
-    for (uint32_t n = 0; n < kContextCount; n++) {
-      did_work = contexts_[n]->Work() || did_work;
-
-      // TODO: Need thread safety to do this.
-      // Probably not too important though.
-      // registers_.current_context = n;
-      // registers_.next_context = (n + 1) % kContextCount;
+    {
+      xe::counters::ScopedTimer work_timer(work_time_counter);
+      for (uint32_t n = worker_index; n < kContextCount; n += worker_count_) {
+        did_work = contexts_[n]->Work() || did_work;
+
+        // TODO: Need thread safety to do this.
+        // Probably not too important though.
+        // registers_.current_context = n;
+        // registers_.next_context = (n + 1) % kContextCount;
+      }
     }
 
     if (paused_) {
-      pause_fence_.Signal();
-      resume_fence_.Wait();
+      pause_fences_[worker_index]->Signal();
+      resume_fences_[worker_index]->Wait();
     }
 
     if (!did_work) {
@@ -199,26 +236,29 @@ void XmaDecoder::WorkerThreadMain() {
     } else {
       idle_loop_count = 0;
     }
-    xe::threading::Wait(work_event_.get(), false);
+    xe::threading::Wait(&work_event, false);
   }
 }
 
 void XmaDecoder::Shutdown() {
   worker_running_ = false;
 
-  if (work_event_) {
-    work_event_->Set();
+  for (auto& work_event : work_events_) {
+    work_event->Set();
   }
 
   if (paused_) {
     Resume();
   }
 
-  if (worker_thread_) {
-    // Wait for work thread.
-    xe::threading::Wait(worker_thread_->thread(), false);
-    worker_thread_.reset();
+  // Wait for work threads.
+  for (auto& worker_thread : worker_threads_) {
+    xe::threading::Wait(worker_thread->thread(), false);
   }
+  worker_threads_.clear();
+  work_events_.clear();
+  pause_fences_.clear();
+  resume_fences_.clear();
 
   if (context_data_first_ptr_) {
     memory()->SystemHeapFree(context_data_first_ptr_);
@@ -323,6 +363,7 @@ void XmaDecoder::WriteRegister(uint32_t addr, uint32_t value) {
 
     // The context ID is a bit in the range of the entire context array.
     uint32_t base_context_id = (r - XmaRegister::Context0Kick) * 32;
+    uint32_t kicked_worker_mask = 0;
     for (int i = 0; value && i < 32; ++i, value >>= 1) {
       if (value & 1) {
         uint32_t context_id = base_context_id + i;
@@ -331,10 +372,15 @@ void XmaDecoder::WriteRegister(uint32_t addr, uint32_t value) {
         if (!cvars::use_dedicated_xma_thread) {
           context.Work();
         }
+        kicked_worker_mask |= uint32_t(1) << GetContextWorkerIndex(context_id);
+      }
+    }
+    // Signal the decoder threads owning the contexts to start processing.
+    for (uint32_t i = 0; i < worker_count_; ++i) {
+      if (kicked_worker_mask & (uint32_t(1) << i)) {
+        work_events_[i]->SetBoostPriority();
       }
     }
-    // Signal the decoder thread to start processing.
-    work_event_->SetBoostPriority();
   } else if (r >= XmaRegister::Context0Lock && r <= XmaRegister::Context9Lock) {
     // Context lock command.
     // This requests a lock by flagging the context.
@@ -388,7 +434,13 @@ void XmaDecoder::Pause() {
   }
   paused_ = true;
 
-  pause_fence_.Wait();
+  // Wake up the idle workers too so they all reach the pause point.
+  for (auto& work_event : work_events_) {
+    work_event->Set();
+  }
+  for (auto& pause_fence : pause_fences_) {
+    pause_fence->Wait();
+  }
 }
 
 void XmaDecoder::Resume() {
@@ -397,7 +449,9 @@ void XmaDecoder::Resume() {
   }
   paused_ = false;
 
-  resume_fence_.Signal();
+  for (auto& resume_fence : resume_fences_) {
+    resume_fence->Signal();
+  }
 }
 
 }  // namespace apu
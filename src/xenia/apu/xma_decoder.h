@@ -13,6 +13,7 @@
 #include <atomic>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 #include "xenia/apu/xma_context.h"
 #include "xenia/apu/xma_register_file.h"
@@ -55,7 +56,12 @@ class XmaDecoder {
   int GetContextId(uint32_t guest_ptr);
 
  private:
-  void WorkerThreadMain();
+  void WorkerThreadMain(uint32_t worker_index);
+  // Each context is always decoded by the same worker, so the kicks of a
+  // context are processed in order.
+  uint32_t GetContextWorkerIndex(uint32_t context_id) const {
+    return context_id % worker_count_;
+  }
 
   static uint32_t MMIOReadRegisterThunk(void* ppc_context, XmaDecoder* as,
                                         uint32_t addr) {
@@ -71,12 +77,15 @@ class XmaDecoder {
   cpu::Processor* processor_ = nullptr;
 
   std::atomic<bool> worker_running_ = {false};
-  kernel::object_ref<kernel::XHostThread> worker_thread_;
-  std::unique_ptr<xe::threading::Event> work_event_ = nullptr;
+  uint32_t worker_count_ = 1;
+  std::vector<kernel::object_ref<kernel::XHostThread>> worker_threads_;
+  std::vector<std::unique_ptr<xe::threading::Event>> work_events_;
 
   bool paused_ = false;
-  xe::threading::Fence pause_fence_;   // Signaled when worker paused.
-  xe::threading::Fence resume_fence_;  // Signaled when resume requested.
+  // Signaled when each worker paused.
+  std::vector<std::unique_ptr<xe::threading::Fence>> pause_fences_;
+  // Signaled when resume requested.
+  std::vector<std::unique_ptr<xe::threading::Fence>> resume_fences_;
 
   XmaRegisterFile register_file_;
 
@@ -0,0 +1,196 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <string_view>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/filesystem.h"
+
+namespace xe {
+
+Benchmark::Benchmark(uint32_t frame_count) : frame_count_(frame_count) {
+  frame_times_ms_.reserve(frame_count);
+}
+
+bool Benchmark::OnFrameBoundary() {
+  uint64_t ticks = Clock::QueryHostTickCount();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (complete_) {
+    return false;
+  }
+  if (!last_boundary_ticks_) {
+    // The time before the first frame, such as the boot, is not measured.
+    last_boundary_ticks_ = ticks;
+    counters::Snapshot(start_samples_);
+    return false;
+  }
+  frame_times_ms_.push_back(double(ticks - last_boundary_ticks_) * 1000.0 /
+                            double(Clock::QueryHostTickFrequency()));
+  last_boundary_ticks_ = ticks;
+  if (frame_times_ms_.size() < frame_count_) {
+    return false;
+  }
+  counters::Snapshot(end_samples_);
+  complete_ = true;
+  return true;
+}
+
+bool Benchmark::is_complete() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return complete_;
+}
+
+double Benchmark::GetPercentile(const std::vector<double>& sorted_values,
+                                double percentile) {
+  if (sorted_values.empty()) {
+    return 0.0;
+  }
+  size_t rank = size_t(
+      std::ceil(percentile * 0.01 * double(sorted_values.size())));
+  return sorted_values[std::clamp(rank, size_t(1), sorted_values.size()) - 1];
+}
+
+Benchmark::FrameTimeStatistics Benchmark::GetFrameTimeStatistics() const {
+  std::vector<double> sorted_frame_times_ms;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sorted_frame_times_ms = frame_times_ms_;
+  }
+  std::sort(sorted_frame_times_ms.begin(), sorted_frame_times_ms.end());
+  FrameTimeStatistics statistics = {};
+  for (double frame_time_ms : sorted_frame_times_ms) {
+    statistics.total_ms += frame_time_ms;
+  }
+  if (!sorted_frame_times_ms.empty()) {
+    statistics.average_ms =
+        statistics.total_ms / double(sorted_frame_times_ms.size());
+    statistics.min_ms = sorted_frame_times_ms.front();
+    statistics.max_ms = sorted_frame_times_ms.back();
+  }
+  statistics.p50_ms = GetPercentile(sorted_frame_times_ms, 50.0);
+  statistics.p90_ms = GetPercentile(sorted_frame_times_ms, 90.0);
+  statistics.p95_ms = GetPercentile(sorted_frame_times_ms, 95.0);
+  statistics.p99_ms = GetPercentile(sorted_frame_times_ms, 99.0);
+  return statistics;
+}
+
+std::string Benchmark::FormatReportJson() const {
+  FrameTimeStatistics statistics = GetFrameTimeStatistics();
+  std::vector<counters::Sample> samples;
+  size_t frames_measured;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frames_measured = frame_times_ms_.size();
+    // Counter deltas over the measured frames, gauges as they were at the end.
+    if (complete_) {
+      samples = end_samples_;
+    } else {
+      counters::Snapshot(samples);
+    }
+    for (counters::Sample& sample : samples) {
+      if (sample.is_gauge) {
+        continue;
+      }
+      auto start_it = std::lower_bound(
+          start_samples_.begin(), start_samples_.end(), sample.name,
+          [](const counters::Sample& start_sample, const std::string& name) {
+            return start_sample.name < name;
+          });
+      for (; start_it != start_samples_.end() && start_it->name == sample.name;
+           ++start_it) {
+        if (!start_it->is_gauge) {
+          sample.value -= start_it->value;
+          break;
+        }
+      }
+    }
+  }
+
+  std::string json;
+  auto json_out = std::back_inserter(json);
+  fmt::format_to(json_out,
+                 "{{\n  \"frames\": {},\n  \"complete\": {},\n"
+                 "  \"total_ms\": {:.3f},\n  \"average_fps\": {:.3f},\n",
+                 frames_measured, frames_measured >= frame_count_,
+                 statistics.total_ms,
+                 statistics.average_ms > 0.0 ? 1000.0 / statistics.average_ms
+                                             : 0.0);
+  fmt::format_to(json_out,
+                 "  \"frame_time_ms\": {{\"average\": {:.3f}, \"min\": {:.3f}, "
+                 "\"p50\": {:.3f}, \"p90\": {:.3f}, \"p95\": {:.3f}, "
+                 "\"p99\": {:.3f}, \"max\": {:.3f}}},\n",
+                 statistics.average_ms, statistics.min_ms, statistics.p50_ms,
+                 statistics.p90_ms, statistics.p95_ms, statistics.p99_ms,
+                 statistics.max_ms);
+
+  json += "  \"hit_rates\": {";
+  bool first = true;
+  constexpr std::string_view kHitsSuffix = "/hits";
+  for (const counters::Sample& hits_sample : samples) {
+    std::string_view name = hits_sample.name;
+    if (hits_sample.is_gauge || name.size() < kHitsSuffix.size() ||
+        name.substr(name.size() - kHitsSuffix.size()) != kHitsSuffix) {
+      continue;
+    }
+    std::string_view prefix = name.substr(0, name.size() - kHitsSuffix.size());
+    std::string misses_name = std::string(prefix) + "/misses";
+    auto misses_it = std::find_if(
+        samples.begin(), samples.end(), [&](const counters::Sample& sample) {
+          return !sample.is_gauge && sample.name == misses_name;
+        });
+    if (misses_it == samples.end()) {
+      continue;
+    }
+    int64_t lookups = hits_sample.value + misses_it->value;
+    // The names are identifiers from the code, no escaping needed.
+    fmt::format_to(json_out, "{}\n    \"{}\": {:.6f}", first ? "" : ",",
+                   prefix,
+                   lookups > 0 ? double(hits_sample.value) / double(lookups)
+                               : 0.0);
+    first = false;
+  }
+  json += first ? "},\n" : "\n  },\n";
+
+  for (bool gauges : {false, true}) {
+    fmt::format_to(json_out, "  \"{}\": {{", gauges ? "gauges" : "counters");
+    first = true;
+    for (const counters::Sample& sample : samples) {
+      if (sample.is_gauge != gauges) {
+        continue;
+      }
+      fmt::format_to(json_out, "{}\n    \"{}\": {}", first ? "" : ",",
+                     sample.name, sample.value);
+      first = false;
+    }
+    json += first ? "}" : "\n  }";
+    json += gauges ? "\n" : ",\n";
+  }
+  json += "}\n";
+  return json;
+}
+
+bool Benchmark::WriteReport(const std::filesystem::path& path) const {
+  std::string json = FormatReportJson();
+  FILE* file = xe::filesystem::OpenFile(path, "wb");
+  if (!file) {
+    return false;
+  }
+  bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+  fclose(file);
+  return written;
+}
+
+}  // namespace xe
@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_BENCHMARK_H_
+#define XENIA_BASE_BENCHMARK_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xenia/base/counters.h"
+
+namespace xe {
+
+// Host time of each of a fixed number of guest frames, and the changes of the
+// performance counters over them, for catching performance regressions with
+// deterministic runs of a title.
+//
+// The report is a JSON object with the frame count, the total time, the frame
+// time percentiles, the hit rate of every counter pair named .../hits and
+// .../misses, and the counter deltas and the final gauge values.
+class Benchmark {
+ public:
+  struct FrameTimeStatistics {
+    double total_ms;
+    double average_ms;
+    double min_ms;
+    double p50_ms;
+    double p90_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+  };
+
+  explicit Benchmark(uint32_t frame_count);
+
+  uint32_t frame_count() const { return frame_count_; }
+
+  // Called by the emulated system at the end of each guest frame, from any
+  // thread. The first boundary starts the measurement, so the frames are
+  // counted from it. Returns true once, when frame_count frames have been
+  // measured.
+  bool OnFrameBoundary();
+  bool is_complete() const;
+
+  // Nearest-rank percentile of the ascending values, 0 if there are none.
+  static double GetPercentile(const std::vector<double>& sorted_values,
+                              double percentile);
+  FrameTimeStatistics GetFrameTimeStatistics() const;
+
+  std::string FormatReportJson() const;
+  bool WriteReport(const std::filesystem::path& path) const;
+
+ private:
+  uint32_t frame_count_;
+
+  mutable std::mutex mutex_;
+  uint64_t last_boundary_ticks_ = 0;
+  bool complete_ = false;
+  std::vector<double> frame_times_ms_;
+  std::vector<counters::Sample> start_samples_;
+  std::vector<counters::Sample> end_samples_;
+};
+
+}  // namespace xe
+
+#endif  // XENIA_BASE_BENCHMARK_H_
@@ -10,8 +10,13 @@
 #ifndef XENIA_BASE_BIT_STREAM_H_
 #define XENIA_BASE_BIT_STREAM_H_
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/byte_order.h"
 
 namespace xe {
 
@@ -43,6 +48,86 @@ class BitStream {
   size_t size_bits_ = 0;
 };
 
+// Read-only counterpart of BitStream for parsing on hot paths, inline and
+// keeping the last loaded 64 bits so consecutive small reads and peeks don't
+// reload and byte swap the buffer every time.
+class BitReader {
+ public:
+  // The buffer must be at least 64 bits long, and the bits after the last
+  // whole byte can't be read.
+  BitReader(const uint8_t* buffer, size_t size_in_bits)
+      : buffer_(buffer), size_bits_(size_in_bits) {
+    assert_true(size_in_bits >= 64);
+    Refill();
+  }
+
+  size_t offset_bits() const { return offset_bits_; }
+  size_t size_bits() const { return size_bits_; }
+  size_t BitsRemaining() const { return size_bits_ - offset_bits_; }
+
+  void SetOffset(size_t offset_bits) {
+    assert_false(offset_bits > size_bits_);
+    offset_bits_ = std::min(offset_bits, size_bits_);
+  }
+  void Advance(size_t num_bits) { SetOffset(offset_bits_ + num_bits); }
+
+  // num_bits MUST be in the range 1-57 (inclusive).
+  uint64_t Peek(size_t num_bits) {
+    assert_true(num_bits >= 1 && num_bits <= 57);
+    assert_false(offset_bits_ + num_bits > size_bits_);
+    // Wraps around if the offset is before the window.
+    size_t window_offset_bits = offset_bits_ - (window_offset_bytes_ << 3);
+    if (window_offset_bits > 64 - num_bits) {
+      Refill();
+      window_offset_bits = offset_bits_ - (window_offset_bytes_ << 3);
+    }
+    return (window_ << window_offset_bits) >> (64 - num_bits);
+  }
+  uint64_t Read(size_t num_bits) {
+    uint64_t value = Peek(num_bits);
+    Advance(num_bits);
+    return value;
+  }
+  // Reads consecutive fields of the specified widths (each 1-57 bits), with a
+  // single Peek for as many adjacent ones as fit in 57 bits.
+  void ReadBits(const uint8_t* field_widths, uint64_t* values_out,
+                size_t field_count) {
+    size_t group_start = 0;
+    while (group_start < field_count) {
+      size_t group_end = group_start + 1;
+      size_t group_bits = field_widths[group_start];
+      while (group_end < field_count &&
+             group_bits + field_widths[group_end] <= 57) {
+        group_bits += field_widths[group_end++];
+      }
+      uint64_t bits = Read(group_bits);
+      for (size_t i = group_end; i-- > group_start;) {
+        values_out[i] = bits & ((uint64_t(1) << field_widths[i]) - 1);
+        bits >>= field_widths[i];
+      }
+      group_start = group_end;
+    }
+  }
+
+ private:
+  // Loads the 64 bits containing the byte at the offset, clamped to the end
+  // of the buffer, so any read of up to 57 bits after it is in the window.
+  void Refill() {
+    window_offset_bytes_ =
+        std::min(offset_bits_ >> 3, (size_bits_ >> 3) - sizeof(uint64_t));
+    uint64_t window;
+    std::memcpy(&window, buffer_ + window_offset_bytes_, sizeof(window));
+    window_ = xe::byte_swap(window);
+  }
+
+  const uint8_t* buffer_;
+  size_t offset_bits_ = 0;
+  size_t size_bits_;
+  // Big-endian, the first byte in the most significant bits.
+  uint64_t window_ = 0;
+  size_t window_offset_bytes_ = 0;
+};
+
 }  // namespace xe
 
 #endif  // XENIA_BASE_BIT_STREAM_H_
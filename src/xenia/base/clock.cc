@@ -10,8 +10,10 @@
 #include "xenia/base/clock.h"
 
 #include <algorithm>
+#include <chrono>
 #include <limits>
 #include <mutex>
+#include <thread>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/math.h"
@@ -21,6 +23,8 @@
 
 #include "xenia/base/platform_win.h"
 
+#include <intrin.h>
+
 #endif
 
 DEFINE_bool(clock_no_scaling, false,
@@ -31,6 +35,12 @@ DEFINE_bool(clock_source_raw, false,
             "Use the RDTSC instruction as the time source. "
             "Host CPU must support invariant TSC.",
             "CPU");
+DEFINE_bool(clock_tsc_timebase, true,
+            "Count the guest ticks from the RDTSC instruction, calibrated "
+            "against the platform clock, if the host CPU has an invariant TSC. "
+            "Makes reading the guest clock a few instructions instead of a "
+            "system call and locking. Ignored with clock_no_scaling.",
+            "CPU");
 
 namespace xe {
 
@@ -45,17 +55,144 @@ uint64_t guest_system_time_base_ = Clock::QueryHostSystemTime();
 // Computed by RecomputeGuestTickScalar.
 std::pair<uint64_t, uint64_t> guest_tick_ratio_ = std::make_pair(1, 1);
 
-// Native guest ticks.
-uint64_t last_guest_tick_count_ = 0;
-// Last sampled host tick count.
-uint64_t last_host_tick_count_ = Clock::QueryHostTickCount();
+// Last guest tick count returned, for the inline_loadclock JIT path.
+std::atomic<uint64_t> last_guest_tick_count_{0};
+static_assert(sizeof(last_guest_tick_count_) == sizeof(uint64_t));
 
 using tick_mutex_type = std::mutex;
 
-// Mutex to ensure last_host_tick_count_ and last_guest_tick_count_ are in sync
-// std::mutex tick_mutex_;
+// Serializes the writers of guest_tick_ratio_ and the timebase.
 static tick_mutex_type tick_mutex_;
 
+static GuestTimebase guest_timebase_;
+// Whether the timebase is frozen, with 0 guest ticks per host tick, between
+// the calls of AdvanceLockedGuestTickCount.
+static bool guest_tick_count_locked_ = false;
+// Frequency of the timebase host ticks.
+static uint64_t timebase_host_tick_frequency_;
+
+inline uint64_t MultiplyFixed32(uint64_t a, uint64_t b) {
+#if XE_COMPILER_MSVC
+  uint64_t low = a * b;
+  uint64_t high = __umulh(a, b);
+  return (low >> 32) | (high << 32);
+#else
+  return uint64_t((unsigned __int128)a * b >> 32);
+#endif
+}
+
+inline uint64_t QueryTimebaseHostTickCount() {
+#if XE_CLOCK_RAW_AVAILABLE
+  if (guest_timebase_.host_ticks_raw) {
+    return Clock::host_tick_count_raw();
+  }
+#endif
+  return Clock::QueryHostTickCount();
+}
+
+// With tick_mutex_ locked or before the timebase is published.
+inline uint64_t TranslateTimebaseHostTickCount(uint64_t host_tick_count) {
+  uint64_t host_tick_base =
+      guest_timebase_.host_tick_base.load(std::memory_order_relaxed);
+  // The TSC of different cores may be slightly apart, never go backwards.
+  uint64_t host_tick_delta = host_tick_count > host_tick_base
+                                 ? host_tick_count - host_tick_base
+                                 : 0;
+  return guest_timebase_.guest_tick_base.load(std::memory_order_relaxed) +
+         MultiplyFixed32(host_tick_delta,
+                         guest_timebase_.guest_ticks_per_host_tick.load(
+                             std::memory_order_relaxed));
+}
+
+// With tick_mutex_ locked. Continues counting the guest ticks from the current
+// time at the current time scalar and guest tick frequency.
+void RebaseGuestTimebase() {
+  uint64_t host_tick_count = QueryTimebaseHostTickCount();
+  uint64_t guest_tick_count = TranslateTimebaseHostTickCount(host_tick_count);
+  uint64_t guest_ticks_per_host_tick =
+      guest_tick_count_locked_
+          ? 0
+          : static_cast<uint64_t>(double(guest_tick_frequency_) *
+                                  guest_time_scalar_ /
+                                  double(timebase_host_tick_frequency_) *
+                                  double(uint64_t(1) << 32));
+  uint32_t sequence =
+      guest_timebase_.sequence.load(std::memory_order_relaxed);
+  guest_timebase_.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  guest_timebase_.host_tick_base.store(host_tick_count,
+                                       std::memory_order_relaxed);
+  guest_timebase_.guest_tick_base.store(guest_tick_count,
+                                        std::memory_order_relaxed);
+  guest_timebase_.guest_ticks_per_host_tick.store(guest_ticks_per_host_tick,
+                                                  std::memory_order_relaxed);
+  guest_timebase_.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+#if XE_CLOCK_RAW_AVAILABLE
+// Measures the TSC against the platform clock.
+uint64_t CalibrateRawTickFrequency() {
+  // Readings of the platform clock between two TSC readings as close together
+  // as possible, to not count a preemption in between.
+  auto sample = [](uint64_t& raw_out, uint64_t& platform_out) {
+    uint64_t best_raw_delta = UINT64_MAX;
+    for (uint32_t i = 0; i < 8; ++i) {
+      uint64_t raw_before = Clock::host_tick_count_raw();
+      uint64_t platform = Clock::host_tick_count_platform();
+      uint64_t raw_after = Clock::host_tick_count_raw();
+      if (raw_after - raw_before < best_raw_delta) {
+        best_raw_delta = raw_after - raw_before;
+        raw_out = raw_before + best_raw_delta / 2;
+        platform_out = platform;
+      }
+    }
+  };
+  uint64_t raw_start, platform_start, raw_end, platform_end;
+  sample(raw_start, platform_start);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  sample(raw_end, platform_end);
+  if (raw_end <= raw_start || platform_end <= platform_start) {
+    return 0;
+  }
+  return static_cast<uint64_t>(double(raw_end - raw_start) *
+                               double(Clock::host_tick_frequency_platform()) /
+                               double(platform_end - platform_start));
+}
+#endif
+
+// Chooses the host ticks and starts the guest ticks from 0 on the first use,
+// after the cvars have been loaded.
+GuestTimebase& GetGuestTimebase() {
+  static GuestTimebase& timebase = []() -> GuestTimebase& {
+    timebase_host_tick_frequency_ = 0;
+#if XE_CLOCK_RAW_AVAILABLE
+    if (cvars::clock_source_raw) {
+      // QueryHostTickCount is the TSC already, with the frequency the user
+      // asked for.
+    } else if (cvars::clock_tsc_timebase && Clock::host_tick_invariant_raw()) {
+      timebase_host_tick_frequency_ =
+          Clock::host_tick_frequency_raw_reported();
+      if (!timebase_host_tick_frequency_) {
+        timebase_host_tick_frequency_ = CalibrateRawTickFrequency();
+      }
+    }
+#endif
+    if (timebase_host_tick_frequency_) {
+      guest_timebase_.host_ticks_raw = 1;
+    } else {
+      guest_timebase_.host_ticks_raw = 0;
+      timebase_host_tick_frequency_ = Clock::QueryHostTickFrequency();
+    }
+    guest_timebase_.host_tick_base.store(QueryTimebaseHostTickCount(),
+                                         std::memory_order_relaxed);
+    guest_timebase_.guest_tick_base.store(0, std::memory_order_relaxed);
+    std::lock_guard<tick_mutex_type> lock(tick_mutex_);
+    RebaseGuestTimebase();
+    return guest_timebase_;
+  }();
+  return timebase;
+}
+
 void RecomputeGuestTickScalar() {
   // Create a rational number with numerator (first) and denominator (second)
   auto frac =
@@ -72,36 +209,44 @@ void RecomputeGuestTickScalar() {
   // Keep this a rational calculation and reduce the fraction
   reduce_fraction(frac);
 
+  // Make sure the timebase host ticks are chosen before rebasing it.
+  GetGuestTimebase();
   std::lock_guard<tick_mutex_type> lock(tick_mutex_);
   guest_tick_ratio_ = frac;
+  RebaseGuestTimebase();
 }
 
-// Update the guest timer for all threads.
-// Return a copy of the value so locking is reduced.
+// Translates the current host tick count to the guest tick count, without
+// locking.
 uint64_t UpdateGuestClock() {
-  uint64_t host_tick_count = Clock::QueryHostTickCount();
-
   if (cvars::clock_no_scaling) {
     // Nothing to update, calculate on the fly
-    return host_tick_count * guest_tick_ratio_.first / guest_tick_ratio_.second;
+    return Clock::QueryHostTickCount() * guest_tick_ratio_.first /
+           guest_tick_ratio_.second;
   }
 
-  std::unique_lock<tick_mutex_type> lock(tick_mutex_, std::defer_lock);
-  if (lock.try_lock()) {
-    // Translate host tick count to guest tick count.
-    uint64_t host_tick_delta = host_tick_count > last_host_tick_count_
-                                   ? host_tick_count - last_host_tick_count_
-                                   : 0;
-    last_host_tick_count_ = host_tick_count;
-    uint64_t guest_tick_delta =
-        host_tick_delta * guest_tick_ratio_.first / guest_tick_ratio_.second;
-    last_guest_tick_count_ += guest_tick_delta;
-    return last_guest_tick_count_;
-  } else {
-    // Wait until another thread has finished updating the clock.
-    lock.lock();
-    return last_guest_tick_count_;
+  const GuestTimebase& timebase = GetGuestTimebase();
+  uint64_t guest_tick_count;
+  while (true) {
+    uint32_t sequence = timebase.sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      // Being rebased right now.
+      continue;
+    }
+    guest_tick_count =
+        TranslateTimebaseHostTickCount(QueryTimebaseHostTickCount());
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (timebase.sequence.load(std::memory_order_relaxed) == sequence) {
+      break;
+    }
   }
+  // Only an approximation of the latest value for inline_loadclock, no need
+  // for the ordering between the threads.
+  if (guest_tick_count >
+      last_guest_tick_count_.load(std::memory_order_relaxed)) {
+    last_guest_tick_count_.store(guest_tick_count, std::memory_order_relaxed);
+  }
+  return guest_tick_count;
 }
 
 // Offset of the current guest system file time relative to the guest base time.
@@ -169,7 +314,55 @@ uint64_t Clock::QueryGuestTickCount() {
   return guest_tick_count;
 }
 
-uint64_t* Clock::GetGuestTickCountPointer() { return &last_guest_tick_count_; }
+void Clock::set_guest_tick_count_locked(bool locked) {
+  if (cvars::clock_no_scaling) {
+    return;
+  }
+  GetGuestTimebase();
+  std::lock_guard<tick_mutex_type> lock(tick_mutex_);
+  if (guest_tick_count_locked_ == locked) {
+    return;
+  }
+  guest_tick_count_locked_ = locked;
+  RebaseGuestTimebase();
+}
+
+bool Clock::guest_tick_count_locked() {
+  std::lock_guard<tick_mutex_type> lock(tick_mutex_);
+  return guest_tick_count_locked_;
+}
+
+void Clock::AdvanceLockedGuestTickCount(uint64_t guest_ticks) {
+  if (cvars::clock_no_scaling) {
+    return;
+  }
+  GetGuestTimebase();
+  std::lock_guard<tick_mutex_type> lock(tick_mutex_);
+  if (!guest_tick_count_locked_) {
+    return;
+  }
+  uint64_t guest_tick_count =
+      guest_timebase_.guest_tick_base.load(std::memory_order_relaxed) +
+      guest_ticks;
+  uint32_t sequence =
+      guest_timebase_.sequence.load(std::memory_order_relaxed);
+  guest_timebase_.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  guest_timebase_.guest_tick_base.store(guest_tick_count,
+                                        std::memory_order_relaxed);
+  guest_timebase_.sequence.store(sequence + 2, std::memory_order_release);
+  if (guest_tick_count >
+      last_guest_tick_count_.load(std::memory_order_relaxed)) {
+    last_guest_tick_count_.store(guest_tick_count, std::memory_order_relaxed);
+  }
+}
+
+uint64_t* Clock::GetGuestTickCountPointer() {
+  return reinterpret_cast<uint64_t*>(&last_guest_tick_count_);
+}
+
+const GuestTimebase& Clock::guest_timebase() { return GetGuestTimebase(); }
+
 uint64_t Clock::QueryGuestSystemTime() {
   if (cvars::clock_no_scaling) {
     return Clock::QueryHostSystemTime();
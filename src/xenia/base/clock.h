@@ -10,6 +10,7 @@
 #ifndef XENIA_BASE_CLOCK_H_
 #define XENIA_BASE_CLOCK_H_
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 
@@ -27,6 +28,22 @@ namespace xe {
 
 // chrono APIs in xenia/base/chrono.h are preferred
 
+// Parameters for translating host ticks to guest ticks without locking, in a
+// cache line of their own like the data page of a vDSO, for the JIT to read
+// directly. Only the Clock class writes it, as a sequence lock: the sequence is
+// odd while the rest is being written, and readers retry if it was odd or has
+// changed while they were reading.
+struct alignas(64) GuestTimebase {
+  std::atomic<uint32_t> sequence;
+  // Nonzero if the host ticks are the raw TSC, otherwise they are the ticks of
+  // Clock::QueryHostTickCount.
+  uint32_t host_ticks_raw;
+  std::atomic<uint64_t> host_tick_base;
+  std::atomic<uint64_t> guest_tick_base;
+  // Guest ticks per host tick as 32.32 fixed point, including the time scalar.
+  std::atomic<uint64_t> guest_ticks_per_host_tick;
+};
+
 class Clock {
  public:
   // Host ticks-per-second. Generally QueryHostTickFrequency should be used.
@@ -43,6 +60,11 @@ class Clock {
   // speculatively executed each time the branch history was lost
   XE_NOINLINE
   static uint64_t host_tick_count_raw();
+  // Whether the TSC runs at a constant rate in all power states and on all
+  // cores.
+  static bool host_tick_invariant_raw();
+  // The TSC frequency if CPUID reports it exactly, 0 otherwise.
+  static uint64_t host_tick_frequency_raw_reported();
 #endif
 
   // Queries the host tick frequency.
@@ -77,7 +99,17 @@ class Clock {
   // and scaling.
   static uint64_t QueryGuestTickCount();
 
+  // Stops the guest ticks from following the host time, for deterministic
+  // runs, so they only move forward by AdvanceLockedGuestTickCount, such as by
+  // exactly one refresh interval on every vblank. Ignored with
+  // clock_no_scaling.
+  static void set_guest_tick_count_locked(bool locked);
+  static bool guest_tick_count_locked();
+  static void AdvanceLockedGuestTickCount(uint64_t guest_ticks);
+
   static uint64_t* GetGuestTickCountPointer();
+  // The timebase QueryGuestTickCount uses when scaling is enabled.
+  static const GuestTimebase& guest_timebase();
   // Queries the guest time, in FILETIME format, accounting for scaling.
   static uint64_t QueryGuestSystemTime();
   // Queries the milliseconds since the guest began, accounting for scaling.
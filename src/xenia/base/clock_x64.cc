@@ -47,44 +47,22 @@ namespace xe {
 // on AMD, so we fail gracefully if not possible.
 XE_NOINLINE
 uint64_t Clock::host_tick_frequency_raw() {
-  uint32_t eax, ebx, ecx, edx;
-
-  // 00H Get max supported cpuid level.
-  xe_cpu_cpuid(0x0, eax, ebx, ecx, edx);
-  auto max_cpuid = eax;
-  // 80000000H Get max extended cpuid level
-  xe_cpu_cpuid(0x80000000, eax, ebx, ecx, edx);
-  auto max_cpuid_ex = eax;
-
-  // 80000007H Get extended power feature info
-  if (max_cpuid_ex >= 0x80000007) {
-    xe_cpu_cpuid(0x80000007, eax, ebx, ecx, edx);
-    // Invariant TSC bit at position 8
-    auto tsc_invariant = edx & (1 << 8);
-    // If the TSC is not invariant it will change its frequency with power
-    // states and across cores.
-    if (!tsc_invariant) {
-      CLOCK_FATAL("The CPU has no invariant TSC.");
-      return 0;
-    }
-  } else {
-    CLOCK_FATAL("Unclear if the CPU has an invariant TSC.")
+  // If the TSC is not invariant it will change its frequency with power
+  // states and across cores.
+  if (!host_tick_invariant_raw()) {
+    CLOCK_FATAL("The CPU has no invariant TSC.");
     return 0;
   }
 
-  if (max_cpuid >= 0x15) {
-    // 15H Get TSC/Crystal ratio and Crystal Hz.
-    xe_cpu_cpuid(0x15, eax, ebx, ecx, edx);
-    uint64_t ratio_num = ebx;
-    uint64_t ratio_den = eax;
-    uint64_t cryst_freq = ecx;
-    // For some CPUs, Crystal frequency is not reported.
-    if (ratio_num && ratio_den && cryst_freq) {
-      // If it is, calculate the TSC frequency
-      return cryst_freq * ratio_num / ratio_den;
-    }
+  uint64_t reported_freq = host_tick_frequency_raw_reported();
+  if (reported_freq) {
+    return reported_freq;
   }
 
+  uint32_t eax, ebx, ecx, edx;
+  // 00H Get max supported cpuid level.
+  xe_cpu_cpuid(0x0, eax, ebx, ecx, edx);
+  auto max_cpuid = eax;
   if (max_cpuid >= 0x16) {
     // 16H Get CPU base frequency MHz in EAX.
     xe_cpu_cpuid(0x16, eax, ebx, ecx, edx);
@@ -99,6 +77,37 @@ uint64_t Clock::host_tick_frequency_raw() {
 XE_NOINLINE
 uint64_t Clock::host_tick_count_raw() { return xe_cpu_rdtsc(); }
 
+bool Clock::host_tick_invariant_raw() {
+  uint32_t eax, ebx, ecx, edx;
+  // 80000000H Get max extended cpuid level
+  xe_cpu_cpuid(0x80000000, eax, ebx, ecx, edx);
+  if (eax < 0x80000007) {
+    return false;
+  }
+  // 80000007H Get extended power feature info, invariant TSC bit at position 8
+  xe_cpu_cpuid(0x80000007, eax, ebx, ecx, edx);
+  return (edx & (1 << 8)) != 0;
+}
+
+uint64_t Clock::host_tick_frequency_raw_reported() {
+  uint32_t eax, ebx, ecx, edx;
+  // 00H Get max supported cpuid level.
+  xe_cpu_cpuid(0x0, eax, ebx, ecx, edx);
+  if (eax < 0x15) {
+    return 0;
+  }
+  // 15H Get TSC/Crystal ratio and Crystal Hz.
+  xe_cpu_cpuid(0x15, eax, ebx, ecx, edx);
+  uint64_t ratio_num = ebx;
+  uint64_t ratio_den = eax;
+  uint64_t cryst_freq = ecx;
+  // For some CPUs, Crystal frequency is not reported.
+  if (!ratio_num || !ratio_den || !cryst_freq) {
+    return 0;
+  }
+  return cryst_freq * ratio_num / ratio_den;
+}
+
 }  // namespace xe
 
 #endif
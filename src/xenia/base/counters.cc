@@ -0,0 +1,263 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/counters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/platform.h"
+#include "xenia/base/threading.h"
+
+#if XE_PLATFORM_WIN32
+#include "xenia/base/socket.h"
+#endif  // XE_PLATFORM_WIN32
+
+DEFINE_path(counters_export_path, "",
+            "File to periodically append the values of the performance "
+            "counters to, as JSON lines.",
+            "General");
+DEFINE_uint32(counters_export_interval_ms, 1000,
+              "Interval between exports of the performance counters.",
+              "General");
+DEFINE_uint32(counters_export_port, 0,
+              "Local TCP port to send the performance counters to every "
+              "connected client at, as JSON lines (Windows only). 0 to "
+              "disable.",
+              "General");
+
+namespace xe {
+namespace counters {
+
+namespace {
+
+struct Registry {
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<Counter>, std::less<>> counters;
+  std::map<std::string, std::unique_ptr<Gauge>, std::less<>> gauges;
+};
+
+Registry& GetRegistry() {
+  // Never destroyed so the metrics can be used during static destruction.
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+struct ExportState {
+  std::unique_ptr<xe::threading::Event> shutdown_event;
+  std::unique_ptr<xe::threading::Thread> thread;
+  FILE* file = nullptr;
+#if XE_PLATFORM_WIN32
+  std::unique_ptr<SocketServer> socket_server;
+  std::mutex clients_mutex;
+  std::vector<std::unique_ptr<Socket>> clients;
+#endif  // XE_PLATFORM_WIN32
+};
+
+std::unique_ptr<ExportState> export_state;
+
+void Export(ExportState& state) {
+  std::vector<Sample> samples;
+  Snapshot(samples);
+  std::string line =
+      FormatSnapshotJson(samples, Clock::QueryHostUptimeMillis());
+  line.push_back('\n');
+  if (state.file) {
+    fwrite(line.data(), 1, line.size(), state.file);
+    fflush(state.file);
+  }
+#if XE_PLATFORM_WIN32
+  std::lock_guard<std::mutex> lock(state.clients_mutex);
+  for (auto it = state.clients.begin(); it != state.clients.end();) {
+    if (!(*it)->is_connected() || !(*it)->Send(line)) {
+      it = state.clients.erase(it);
+    } else {
+      ++it;
+    }
+  }
+#endif  // XE_PLATFORM_WIN32
+}
+
+}  // namespace
+
+size_t Counter::GetCurrentThreadShardIndex() {
+  static std::atomic<size_t> next_shard_index{0};
+  thread_local size_t shard_index =
+      next_shard_index.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+  return shard_index;
+}
+
+uint64_t Counter::Read() const {
+  uint64_t value = 0;
+  for (const Shard& shard : shards_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+void ScopedTimer::AddElapsedMicroseconds(Counter& counter,
+                                         uint64_t start_ticks) {
+  uint64_t elapsed_ticks = Clock::QueryHostTickCount() - start_ticks;
+  uint64_t frequency = Clock::QueryHostTickFrequency();
+  // Split to avoid overflow in long waits.
+  counter.Increment(elapsed_ticks / frequency * 1000000 +
+                    elapsed_ticks % frequency * 1000000 / frequency);
+}
+
+Counter& GetCounter(std::string_view name) {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.counters.find(name);
+  if (it == registry.counters.end()) {
+    it = registry.counters
+             .emplace(std::string(name), std::make_unique<Counter>(name))
+             .first;
+  }
+  return *it->second;
+}
+
+Gauge& GetGauge(std::string_view name) {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.gauges.find(name);
+  if (it == registry.gauges.end()) {
+    it = registry.gauges
+             .emplace(std::string(name), std::make_unique<Gauge>(name))
+             .first;
+  }
+  return *it->second;
+}
+
+void Snapshot(std::vector<Sample>& samples_out) {
+  samples_out.clear();
+  Registry& registry = GetRegistry();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    samples_out.reserve(registry.counters.size() + registry.gauges.size());
+    for (const auto& counter : registry.counters) {
+      samples_out.push_back(
+          {counter.first, false, int64_t(counter.second->Read())});
+    }
+    for (const auto& gauge : registry.gauges) {
+      samples_out.push_back({gauge.first, true, gauge.second->Read()});
+    }
+  }
+  std::sort(samples_out.begin(), samples_out.end(),
+            [](const Sample& a, const Sample& b) { return a.name < b.name; });
+}
+
+std::string FormatSnapshotJson(const std::vector<Sample>& samples,
+                               uint64_t time_ms) {
+  std::string json;
+  auto json_out = std::back_inserter(json);
+  fmt::format_to(json_out, "{{\"time_ms\":{}", time_ms);
+  for (bool gauges : {false, true}) {
+    fmt::format_to(json_out, ",\"{}\":{{", gauges ? "gauges" : "counters");
+    bool first = true;
+    for (const Sample& sample : samples) {
+      if (sample.is_gauge != gauges) {
+        continue;
+      }
+      // The names are identifiers from the code, no escaping needed.
+      fmt::format_to(json_out, "{}\"{}\":{}", first ? "" : ",", sample.name,
+                     sample.value);
+      first = false;
+    }
+    json.push_back('}');
+  }
+  json.push_back('}');
+  return json;
+}
+
+void InitializeExport() {
+  if (export_state) {
+    return;
+  }
+  bool export_to_file = !cvars::counters_export_path.empty();
+  uint16_t port = uint16_t(std::min(cvars::counters_export_port, 0xFFFFu));
+  if (!export_to_file && !port) {
+    return;
+  }
+
+  auto state = std::make_unique<ExportState>();
+  if (export_to_file) {
+    state->file = xe::filesystem::OpenFile(cvars::counters_export_path, "ab");
+    if (!state->file) {
+      XELOGE("Failed to open the performance counter export file {}",
+             cvars::counters_export_path);
+    }
+  }
+  if (port) {
+#if XE_PLATFORM_WIN32
+    ExportState* state_ptr = state.get();
+    state->socket_server = SocketServer::Create(
+        port, [state_ptr](std::unique_ptr<Socket> client) {
+          std::lock_guard<std::mutex> lock(state_ptr->clients_mutex);
+          state_ptr->clients.push_back(std::move(client));
+        });
+    if (!state->socket_server) {
+      XELOGE("Failed to listen for performance counter clients on port {}",
+             port);
+    }
+#else
+    XELOGW(
+        "Exporting the performance counters over a socket is not supported "
+        "on this platform");
+#endif  // XE_PLATFORM_WIN32
+  }
+
+  state->shutdown_event = xe::threading::Event::CreateManualResetEvent(false);
+  ExportState* state_ptr = state.get();
+  state->thread = xe::threading::Thread::Create({}, [state_ptr]() {
+    auto interval = std::chrono::milliseconds(
+        std::max(cvars::counters_export_interval_ms, uint32_t(1)));
+    while (xe::threading::Wait(state_ptr->shutdown_event.get(), false,
+                               interval) ==
+           xe::threading::WaitResult::kTimeout) {
+      Export(*state_ptr);
+    }
+    // Include everything up to the shutdown.
+    Export(*state_ptr);
+  });
+  assert_not_null(state->thread);
+  state->thread->set_name("Performance Counter Export");
+  export_state = std::move(state);
+}
+
+void ShutdownExport() {
+  if (!export_state) {
+    return;
+  }
+  export_state->shutdown_event->Set();
+  xe::threading::Wait(export_state->thread.get(), false);
+#if XE_PLATFORM_WIN32
+  // Stop accepting clients before disconnecting the existing ones.
+  export_state->socket_server.reset();
+  export_state->clients.clear();
+#endif  // XE_PLATFORM_WIN32
+  if (export_state->file) {
+    fclose(export_state->file);
+  }
+  export_state.reset();
+}
+
+}  // namespace counters
+}  // namespace xe
@@ -0,0 +1,125 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_COUNTERS_H_
+#define XENIA_BASE_COUNTERS_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "xenia/base/clock.h"
+
+namespace xe {
+namespace counters {
+
+// Process-wide named metrics, independent of the profiler, for tracking the
+// behavior of subsystems (cache hits, JIT compilations, uploads, decoded
+// frames) over time. Names are slash-separated paths like the profiler counter
+// names, for instance "gpu/texture_cache/hits".
+//
+// The objects are owned by the registry and live until the process exits, so
+// references to them can be kept in function or file scope statics:
+//   static xe::counters::Counter& hits_counter =
+//       xe::counters::GetCounter("gpu/texture_cache/hits");
+
+// A monotonically increasing value. Increments from different threads go to
+// different shards to avoid contention on a single cache line.
+class Counter {
+ public:
+  static constexpr size_t kShardCount = 16;
+
+  explicit Counter(std::string_view name) : name_(name) {}
+  Counter(const Counter& counter) = delete;
+  Counter& operator=(const Counter& counter) = delete;
+
+  const std::string& name() const { return name_; }
+
+  void Increment(uint64_t amount = 1) {
+    shards_[GetCurrentThreadShardIndex()].value.fetch_add(
+        amount, std::memory_order_relaxed);
+  }
+  uint64_t Read() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value{0};
+  };
+
+  static size_t GetCurrentThreadShardIndex();
+
+  std::string name_;
+  std::array<Shard, kShardCount> shards_;
+};
+
+// An instantaneous value, such as the number of objects currently alive.
+class Gauge {
+ public:
+  explicit Gauge(std::string_view name) : name_(name) {}
+  Gauge(const Gauge& gauge) = delete;
+  Gauge& operator=(const Gauge& gauge) = delete;
+
+  const std::string& name() const { return name_; }
+
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t delta) {
+    value_.fetch_add(delta, std::memory_order_relaxed);
+  }
+  int64_t Read() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::string name_;
+  std::atomic<int64_t> value_{0};
+};
+
+// Adds the host time spent in the scope, in microseconds, to the counter.
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Counter& counter)
+      : counter_(counter), start_ticks_(Clock::QueryHostTickCount()) {}
+  ScopedTimer(const ScopedTimer& timer) = delete;
+  ScopedTimer& operator=(const ScopedTimer& timer) = delete;
+  ~ScopedTimer() { AddElapsedMicroseconds(counter_, start_ticks_); }
+
+  static void AddElapsedMicroseconds(Counter& counter, uint64_t start_ticks);
+
+ private:
+  Counter& counter_;
+  uint64_t start_ticks_;
+};
+
+// Returns the metric with the name, creating it if it doesn't exist yet.
+Counter& GetCounter(std::string_view name);
+Gauge& GetGauge(std::string_view name);
+
+struct Sample {
+  std::string name;
+  bool is_gauge;
+  int64_t value;
+};
+// Reads all metrics, sorted by name.
+void Snapshot(std::vector<Sample>& samples_out);
+// Formats a snapshot as a single-line JSON object.
+std::string FormatSnapshotJson(const std::vector<Sample>& samples,
+                               uint64_t time_ms);
+
+// Starts periodically exporting the metrics to the file and the local socket
+// specified in the configuration, if any. May be called again after
+// ShutdownExport.
+void InitializeExport();
+void ShutdownExport();
+
+}  // namespace counters
+}  // namespace xe
+
+#endif  // XENIA_BASE_COUNTERS_H_
@@ -8,7 +8,10 @@
  */
 
 #include "xenia/base/cvar.h"
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #define UTF_CPP_CPLUSPLUS 202002L
 #include "third_party/utfcpp/source/utf8.h"
 
@@ -28,6 +31,81 @@ std::map<std::string, ICommandVar*>* CmdVars;
 std::map<std::string, IConfigVar*>* ConfigVars;
 std::multimap<uint32_t, const IConfigVarUpdate*>* IConfigVarUpdate::updates_;
 
+namespace internal {
+std::atomic<uint64_t> change_version{0};
+}  // namespace internal
+
+namespace {
+
+struct Subscriber {
+  std::vector<const void*> values;
+  std::shared_ptr<std::function<void()>> callback;
+};
+
+struct SubscriberRegistry {
+  std::mutex mutex;
+  uint64_t next_id = 1;
+  std::map<uint64_t, Subscriber> subscribers;
+  // Held while calling the callbacks, so unsubscribing waits for the ones
+  // running on other threads. Recursive for the callbacks changing other
+  // variables.
+  std::recursive_mutex callback_mutex;
+};
+
+// Variables may be changed during static initialization.
+SubscriberRegistry& GetSubscriberRegistry() {
+  static SubscriberRegistry registry;
+  return registry;
+}
+
+}  // namespace
+
+void ChangeSubscription::Reset() {
+  if (!id_) {
+    return;
+  }
+  SubscriberRegistry& registry = GetSubscriberRegistry();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.subscribers.erase(id_);
+  }
+  id_ = 0;
+  // Wait for the callback if it's being called.
+  std::lock_guard<std::recursive_mutex> callback_lock(registry.callback_mutex);
+}
+
+ChangeSubscription SubscribeToChanges(std::initializer_list<const void*> values,
+                                      std::function<void()> callback) {
+  SubscriberRegistry& registry = GetSubscriberRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  uint64_t id = registry.next_id++;
+  registry.subscribers.emplace(
+      id, Subscriber{std::vector<const void*>(values),
+                     std::make_shared<std::function<void()>>(
+                         std::move(callback))});
+  return ChangeSubscription(id);
+}
+
+void NotifyValueChanged(const void* value) {
+  internal::change_version.fetch_add(1, std::memory_order_release);
+  SubscriberRegistry& registry = GetSubscriberRegistry();
+  std::lock_guard<std::recursive_mutex> callback_lock(registry.callback_mutex);
+  std::vector<std::shared_ptr<std::function<void()>>> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& subscriber : registry.subscribers) {
+      const std::vector<const void*>& values = subscriber.second.values;
+      if (std::find(values.cbegin(), values.cend(), value) != values.cend()) {
+        callbacks.push_back(subscriber.second.callback);
+      }
+    }
+  }
+  // Not holding the registry lock so the callbacks can subscribe.
+  for (const auto& callback : callbacks) {
+    (*callback)();
+  }
+}
+
 void PrintHelpAndExit() {
   std::cout << options.help({""}) << std::endl;
   std::cout << "For the full list of command line arguments, see xenia.cfg."
@@ -10,7 +10,11 @@
 #ifndef XENIA_CVAR_H_
 #define XENIA_CVAR_H_
 
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <initializer_list>
 #include <map>
 #include <string>
 #include <vector>
@@ -33,6 +37,71 @@ namespace toml_internal {
 std::string EscapeString(const std::string_view str);
 }
 
+// Notification of changes of the values of the variables at runtime, by the
+// config UI, OVERRIDE_ or loading a game config, for subsystems that derive
+// state from them once rather than reading the cvars:: globals every time.
+//
+// The values themselves are still plain globals, only written on the thread
+// making the change - subscribers must not rely on reading a consistent set of
+// multiple variables while they're being changed, but will be notified again
+// after every one of them.
+
+namespace internal {
+extern std::atomic<uint64_t> change_version;
+}  // namespace internal
+
+// Increased after the value of any variable has been changed. Cheap to poll on
+// hot paths - comparing it to the version that the derived state has been
+// built for is enough to know whether to rebuild it.
+inline uint64_t GetChangeVersion() {
+  return internal::change_version.load(std::memory_order_acquire);
+}
+
+// Unsubscribes on destruction.
+class ChangeSubscription {
+ public:
+  ChangeSubscription() = default;
+  ChangeSubscription(const ChangeSubscription& other) = delete;
+  ChangeSubscription& operator=(const ChangeSubscription& other) = delete;
+  ChangeSubscription(ChangeSubscription&& other) noexcept : id_(other.id_) {
+    other.id_ = 0;
+  }
+  ChangeSubscription& operator=(ChangeSubscription&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      id_ = other.id_;
+      other.id_ = 0;
+    }
+    return *this;
+  }
+  ~ChangeSubscription() { Reset(); }
+
+  explicit operator bool() const { return id_ != 0; }
+  // After this returns, the callback is not running on any other thread and
+  // will not be called anymore, so it's safe to destroy what it references.
+  // Must not be called with locks held that the callbacks may take.
+  void Reset();
+
+ private:
+  friend ChangeSubscription SubscribeToChanges(
+      std::initializer_list<const void*> values,
+      std::function<void()> callback);
+  explicit ChangeSubscription(uint64_t id) : id_(id) {}
+
+  uint64_t id_ = 0;
+};
+
+// Calls the callback, on the thread changing the value, after any of the
+// variables (specified by the addresses of their cvars:: globals, such as
+// &cvars::vsync) has been changed to a different value. The callback may
+// change other variables and subscribe, but must not reset its own
+// subscription.
+ChangeSubscription SubscribeToChanges(std::initializer_list<const void*> values,
+                                      std::function<void()> callback);
+
+// Called after the current value of a variable has been changed.
+void NotifyValueChanged(const void* value);
+
 class ICommandVar {
  public:
   virtual ~ICommandVar() = default;
@@ -48,8 +117,11 @@ class IConfigVar : virtual public ICommandVar {
   virtual const std::string& category() const = 0;
   virtual bool is_transient() const = 0;
   virtual std::string config_value() const = 0;
+  // The value actually used, from whichever source has the highest priority.
+  virtual std::string current_config_value() const = 0;
   virtual void LoadConfigValue(const toml::node* result) = 0;
   virtual void LoadGameConfigValue(const toml::node* result) = 0;
+  virtual void ResetGameConfigValue() = 0;
   virtual void ResetConfigValueToDefault() = 0;
 };
 
@@ -83,12 +155,14 @@ class ConfigVar : public CommandVar<T>, virtual public IConfigVar {
   ConfigVar<T>(const char* name, T* default_value, const char* description,
                const char* category, bool is_transient);
   std::string config_value() const override;
+  std::string current_config_value() const override;
   const T& GetTypedConfigValue() const;
   const std::string& category() const override;
   bool is_transient() const override;
   void AddToLaunchOptions(cxxopts::Options* options) override;
   void LoadConfigValue(const toml::node* result) override;
   void LoadGameConfigValue(const toml::node* result) override;
+  void ResetGameConfigValue() override;
   void SetConfigValue(T val);
   void SetGameConfigValue(T val);
   // Changes the actual value used to the one specified, and also makes it the
@@ -235,7 +309,11 @@ std::string CommandVar<T>::ToString(T val) {
 
 template <class T>
 void CommandVar<T>::SetValue(T val) {
+  if (*current_value_ == val) {
+    return;
+  }
   *current_value_ = val;
+  NotifyValueChanged(current_value_);
 }
 template <class T>
 const std::string& ConfigVar<T>::category() const {
@@ -251,6 +329,10 @@ std::string ConfigVar<T>::config_value() const {
   return this->ToString(this->default_value_);
 }
 template <class T>
+std::string ConfigVar<T>::current_config_value() const {
+  return this->ToString(*this->current_value_);
+}
+template <class T>
 const T& ConfigVar<T>::GetTypedConfigValue() const {
   return config_value_ ? *config_value_ : this->default_value_;
 }
@@ -270,6 +352,11 @@ void ConfigVar<T>::SetGameConfigValue(T val) {
   UpdateValue();
 }
 template <class T>
+void ConfigVar<T>::ResetGameConfigValue() {
+  game_config_value_.reset();
+  UpdateValue();
+}
+template <class T>
 void ConfigVar<T>::OverrideConfigValue(T val) {
   config_value_ = std::make_unique<T>(val);
   // The user explicitly changes the value at runtime and wants it to take
@@ -0,0 +1,167 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/epoch.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace xe {
+
+namespace {
+
+// Reader slot indices are per thread and shared by all domains, each domain
+// having its own slot for every index.
+struct ReaderSlotAllocator {
+  std::mutex mutex;
+  std::vector<bool> used = std::vector<bool>(EpochDomain::kMaxReaderThreads);
+  // One past the highest index that has ever been allocated, so reclamation
+  // only scans the slots that may be in use.
+  std::atomic<uint32_t> high_water{0};
+};
+
+ReaderSlotAllocator& GetReaderSlotAllocator() {
+  // Never destroyed since threads may exit during static destruction.
+  static ReaderSlotAllocator* allocator = new ReaderSlotAllocator;
+  return *allocator;
+}
+
+constexpr uint32_t kNoReaderSlot = std::numeric_limits<uint32_t>::max();
+
+class ThreadReaderSlot {
+ public:
+  ThreadReaderSlot() {
+    ReaderSlotAllocator& allocator = GetReaderSlotAllocator();
+    std::lock_guard<std::mutex> lock(allocator.mutex);
+    auto it = std::find(allocator.used.begin(), allocator.used.end(), false);
+    if (it == allocator.used.end()) {
+      return;
+    }
+    *it = true;
+    index_ = uint32_t(it - allocator.used.begin());
+    if (index_ >= allocator.high_water.load(std::memory_order_relaxed)) {
+      allocator.high_water.store(index_ + 1, std::memory_order_release);
+    }
+  }
+  ~ThreadReaderSlot() {
+    if (index_ == kNoReaderSlot) {
+      return;
+    }
+    ReaderSlotAllocator& allocator = GetReaderSlotAllocator();
+    std::lock_guard<std::mutex> lock(allocator.mutex);
+    allocator.used[index_] = false;
+  }
+
+  uint32_t index() const { return index_; }
+
+ private:
+  uint32_t index_ = kNoReaderSlot;
+};
+
+uint32_t GetThreadReaderSlotIndex() {
+  thread_local ThreadReaderSlot slot;
+  return slot.index();
+}
+
+}  // namespace
+
+EpochDomain::Reader::Reader(EpochDomain& domain) : domain_(domain) {
+  uint32_t index = GetThreadReaderSlotIndex();
+  if (index == kNoReaderSlot) {
+    return;
+  }
+  slot_ = &domain_.reader_slots_[index].epoch;
+  if (slot_->load(std::memory_order_relaxed)) {
+    return;
+  }
+  owns_slot_ = true;
+  // The epoch may be stale by the time the slot is published, which only
+  // delays the reclamation. What matters is that either Reclaim sees the slot,
+  // or the reads that follow see everything unlinked before it.
+  slot_->store(domain_.epoch_.load(std::memory_order_acquire),
+               std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+EpochDomain::Reader::~Reader() {
+  if (!owns_slot_) {
+    return;
+  }
+  slot_->store(0, std::memory_order_release);
+  if (domain_.has_retired_.load(std::memory_order_relaxed)) {
+    domain_.Reclaim();
+  }
+}
+
+EpochDomain::EpochDomain()
+    : reader_slots_(std::make_unique<ReaderSlot[]>(kMaxReaderThreads)) {}
+
+EpochDomain::~EpochDomain() {
+  for (auto& retired : retired_) {
+    retired.second();
+  }
+}
+
+void EpochDomain::Retire(std::function<void()> destroy, bool reclaim) {
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    // Readers that have entered after the increment can't have seen what has
+    // been unlinked before the call.
+    retired_.emplace_back(epoch_.fetch_add(1, std::memory_order_acq_rel),
+                          std::move(destroy));
+    has_retired_.store(true, std::memory_order_relaxed);
+  }
+  if (reclaim) {
+    Reclaim();
+  }
+}
+
+void EpochDomain::Reclaim() {
+  std::vector<std::function<void()>> reclaimable;
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    if (retired_.empty()) {
+      return;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t oldest_reader_epoch = std::numeric_limits<uint64_t>::max();
+    uint32_t slot_count = GetReaderSlotAllocator().high_water.load(
+        std::memory_order_acquire);
+    for (uint32_t i = 0; i < slot_count; ++i) {
+      uint64_t reader_epoch =
+          reader_slots_[i].epoch.load(std::memory_order_acquire);
+      if (reader_epoch) {
+        oldest_reader_epoch = std::min(oldest_reader_epoch, reader_epoch);
+      }
+    }
+    // Retired in the order of the epochs.
+    auto reclaimable_end = std::find_if(
+        retired_.begin(), retired_.end(),
+        [oldest_reader_epoch](const auto& retired) {
+          return retired.first >= oldest_reader_epoch;
+        });
+    reclaimable.reserve(size_t(reclaimable_end - retired_.begin()));
+    for (auto it = retired_.begin(); it != reclaimable_end; ++it) {
+      reclaimable.push_back(std::move(it->second));
+    }
+    retired_.erase(retired_.begin(), reclaimable_end);
+    has_retired_.store(!retired_.empty(), std::memory_order_relaxed);
+  }
+  // Outside the lock as the functions may retire more.
+  for (auto& destroy : reclaimable) {
+    destroy();
+  }
+}
+
+size_t EpochDomain::retired_count() const {
+  std::lock_guard<std::mutex> lock(retired_mutex_);
+  return retired_.size();
+}
+
+}  // namespace xe
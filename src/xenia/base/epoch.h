@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_EPOCH_H_
+#define XENIA_BASE_EPOCH_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace xe {
+
+// Epoch-based reclamation for structures that are read without a lock.
+// Readers pin the domain with an EpochDomain::Reader for the duration of their
+// access. Writers, after unlinking something from the structure (under their
+// own lock), retire it with a function that destroys it, and the function is
+// called once no reader that might have seen it is left.
+class EpochDomain {
+ public:
+  // Threads beyond this many reading at the same time can't be pinned, and
+  // must use a locked path instead.
+  static constexpr uint32_t kMaxReaderThreads = 256;
+
+  class Reader {
+   public:
+    explicit Reader(EpochDomain& domain);
+    Reader(const Reader& reader) = delete;
+    Reader& operator=(const Reader& reader) = delete;
+    ~Reader();
+
+    bool is_pinned() const { return slot_ != nullptr; }
+
+   private:
+    EpochDomain& domain_;
+    std::atomic<uint64_t>* slot_ = nullptr;
+    // Nested readers on the same thread leave the slot to the outermost one.
+    bool owns_slot_ = false;
+  };
+
+  EpochDomain();
+  EpochDomain(const EpochDomain& domain) = delete;
+  EpochDomain& operator=(const EpochDomain& domain) = delete;
+  // Calls all the remaining retired functions, there must be no readers.
+  ~EpochDomain();
+
+  // May call the function immediately if there are no readers, along with
+  // other functions retired earlier. Writers retiring with a lock held that
+  // those functions must not be called with can pass reclaim = false, and
+  // call Reclaim once the lock has been released.
+  void Retire(std::function<void()> destroy, bool reclaim = true);
+  // Calls the retired functions that can't be accessed by readers anymore.
+  // Called automatically by Retire and when the last reader of an epoch with
+  // retired functions leaves.
+  void Reclaim();
+
+  size_t retired_count() const;
+
+ private:
+  struct alignas(64) ReaderSlot {
+    // 0 when the thread isn't reading.
+    std::atomic<uint64_t> epoch{0};
+  };
+
+  std::atomic<uint64_t> epoch_{1};
+  std::unique_ptr<ReaderSlot[]> reader_slots_;
+
+  mutable std::mutex retired_mutex_;
+  std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+  std::atomic<bool> has_retired_{false};
+};
+
+}  // namespace xe
+
+#endif  // XENIA_BASE_EPOCH_H_
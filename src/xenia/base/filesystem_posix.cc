@@ -221,6 +221,9 @@ std::vector<FileInfo> ListFiles(const std::filesystem::path& path) {
   if (!dir) {
     return result;
   }
+  // Relative to the directory, not resolving the whole path again for every
+  // entry, which is slow on network filesystems.
+  int dir_fd = dirfd(dir);
 
   while (auto ent = readdir(dir)) {
     if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
@@ -231,12 +234,16 @@ std::vector<FileInfo> ListFiles(const std::filesystem::path& path) {
 
     info.name = ent->d_name;
     struct stat st;
-    stat((path / info.name).c_str(), &st);
+    if (fstatat(dir_fd, ent->d_name, &st, 0) != 0) {
+      continue;
+    }
     info.create_timestamp = convertUnixtimeToWinFiletime(st.st_ctime);
     info.access_timestamp = convertUnixtimeToWinFiletime(st.st_atime);
     info.write_timestamp = convertUnixtimeToWinFiletime(st.st_mtime);
     info.path = path;
-    if (ent->d_type == DT_DIR) {
+    // Some filesystems, including network ones, don't provide the type.
+    if (ent->d_type == DT_DIR ||
+        (ent->d_type == DT_UNKNOWN && S_ISDIR(st.st_mode))) {
       info.type = FileInfo::Type::kDirectory;
       info.total_size = 0;
     } else {
@@ -0,0 +1,122 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/frame_timeline.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/filesystem.h"
+
+namespace xe {
+
+FrameTimeline::FrameTimeline(
+    const std::vector<ComponentDefinition>& components) {
+  components_.reserve(components.size());
+  for (const ComponentDefinition& definition : components) {
+    Component& component = components_.emplace_back();
+    component.label = definition.label;
+    component.counter = &counters::GetCounter(definition.counter_name);
+    component.last_us = component.counter->Read();
+    if (!definition.exclusive_of_counter_name.empty()) {
+      component.exclusive_of_counter =
+          &counters::GetCounter(definition.exclusive_of_counter_name);
+      component.last_exclusive_of_us = component.exclusive_of_counter->Read();
+    } else {
+      component.exclusive_of_counter = nullptr;
+      component.last_exclusive_of_us = 0;
+    }
+  }
+  durations_ms_.resize(kHistoryLength);
+  component_times_ms_.resize(kHistoryLength * components_.size());
+}
+
+void FrameTimeline::OnFrameBoundary() {
+  uint64_t ticks = Clock::QueryHostTickCount();
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool has_previous_boundary = last_boundary_ticks_ != 0;
+  float* component_times_ms =
+      component_times_ms_.data() + history_next_ * components_.size();
+  for (size_t i = 0; i < components_.size(); ++i) {
+    Component& component = components_[i];
+    uint64_t us = component.counter->Read();
+    int64_t delta_us = int64_t(us - component.last_us);
+    component.last_us = us;
+    if (component.exclusive_of_counter) {
+      uint64_t exclusive_of_us = component.exclusive_of_counter->Read();
+      delta_us -= int64_t(exclusive_of_us - component.last_exclusive_of_us);
+      component.last_exclusive_of_us = exclusive_of_us;
+    }
+    // The nested time may be attributed at a different boundary than the
+    // outer time it's a part of.
+    component_times_ms[i] = float(std::max(delta_us, int64_t(0))) * 0.001f;
+  }
+  uint64_t previous_boundary_ticks = last_boundary_ticks_;
+  last_boundary_ticks_ = ticks;
+  if (!has_previous_boundary) {
+    // The time before the first frame is not a frame.
+    return;
+  }
+  durations_ms_[history_next_] =
+      float(double(ticks - previous_boundary_ticks) * 1000.0 /
+            double(Clock::QueryHostTickFrequency()));
+  history_next_ = (history_next_ + 1) % kHistoryLength;
+  history_count_ = std::min(history_count_ + 1, kHistoryLength);
+}
+
+void FrameTimeline::GetHistory(
+    std::vector<float>& durations_ms_out,
+    std::vector<float>& component_times_ms_out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t component_count = components_.size();
+  durations_ms_out.resize(history_count_);
+  component_times_ms_out.resize(history_count_ * component_count);
+  size_t first = (history_next_ + kHistoryLength - history_count_) %
+                 kHistoryLength;
+  for (size_t i = 0; i < history_count_; ++i) {
+    size_t index = (first + i) % kHistoryLength;
+    durations_ms_out[i] = durations_ms_[index];
+    std::copy_n(component_times_ms_.data() + index * component_count,
+                component_count,
+                component_times_ms_out.data() + i * component_count);
+  }
+}
+
+bool FrameTimeline::ExportCsv(const std::filesystem::path& path) const {
+  std::vector<float> durations_ms;
+  std::vector<float> component_times_ms;
+  GetHistory(durations_ms, component_times_ms);
+  FILE* file = xe::filesystem::OpenFile(path, "wb");
+  if (!file) {
+    return false;
+  }
+  std::string line = "frame,duration_ms";
+  for (const Component& component : components_) {
+    line += ',';
+    line += component.label;
+  }
+  line += '\n';
+  fwrite(line.data(), 1, line.size(), file);
+  size_t component_count = components_.size();
+  for (size_t i = 0; i < durations_ms.size(); ++i) {
+    line = fmt::format("{},{:.3f}", i, durations_ms[i]);
+    for (size_t j = 0; j < component_count; ++j) {
+      line +=
+          fmt::format(",{:.3f}", component_times_ms[i * component_count + j]);
+    }
+    line += '\n';
+    fwrite(line.data(), 1, line.size(), file);
+  }
+  fclose(file);
+  return true;
+}
+
+}  // namespace xe
@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_FRAME_TIMELINE_H_
+#define XENIA_BASE_FRAME_TIMELINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xenia/base/counters.h"
+
+namespace xe {
+
+// Breakdown of where the time of each guest frame goes, built from time
+// counters (in microseconds, accumulated with counters::ScopedTimer) sampled at
+// frame boundaries. The components are sums of thread time, so they may exceed
+// the duration of the frame when multiple threads are busy.
+class FrameTimeline {
+ public:
+  static constexpr size_t kHistoryLength = 240;
+
+  struct ComponentDefinition {
+    std::string label;
+    std::string counter_name;
+    // Optional counter of time nested within counter_name to exclude from this
+    // component, if it is a component itself.
+    std::string exclusive_of_counter_name;
+  };
+
+  explicit FrameTimeline(const std::vector<ComponentDefinition>& components);
+
+  size_t component_count() const { return components_.size(); }
+  const std::string& component_label(size_t index) const {
+    return components_[index].label;
+  }
+
+  // Called by the emulated system at the end of each guest frame, from any
+  // thread.
+  void OnFrameBoundary();
+
+  // Returns the recorded frames from the oldest to the newest. The component
+  // times are frame-major.
+  void GetHistory(std::vector<float>& durations_ms_out,
+                  std::vector<float>& component_times_ms_out) const;
+
+  bool ExportCsv(const std::filesystem::path& path) const;
+
+ private:
+  struct Component {
+    std::string label;
+    counters::Counter* counter;
+    counters::Counter* exclusive_of_counter;
+    uint64_t last_us;
+    uint64_t last_exclusive_of_us;
+  };
+
+  mutable std::mutex mutex_;
+  std::vector<Component> components_;
+  uint64_t last_boundary_ticks_ = 0;
+  // Ring buffers of kHistoryLength entries (times component_count for the
+  // component times).
+  std::vector<float> durations_ms_;
+  std::vector<float> component_times_ms_;
+  size_t history_next_ = 0;
+  size_t history_count_ = 0;
+};
+
+}  // namespace xe
+
+#endif  // XENIA_BASE_FRAME_TIMELINE_H_
@@ -0,0 +1,357 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/lock_profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/counters.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/profiling.h"
+
+DEFINE_path(lock_profile_path, "",
+            "File to write the lock contention statistics to on exit, in "
+            "builds with XE_OPTION_LOCK_PROFILING.",
+            "General");
+
+namespace xe {
+namespace lock_profiler {
+
+namespace {
+
+using SiteKey = std::tuple<LockKind, const char*, uint32_t, uint32_t>;
+
+struct Registry {
+  std::mutex mutex;
+  std::map<SiteKey, std::unique_ptr<SiteStats>> sites;
+};
+
+Registry& GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+struct KindCounters {
+  counters::Counter* acquisitions;
+  counters::Counter* contended_acquisitions;
+  counters::Counter* wait_us;
+};
+
+KindCounters& GetKindCounters(LockKind kind) {
+  using KindCounterArray = std::array<KindCounters, size_t(LockKind::kCount)>;
+  static KindCounterArray kind_counters = []() {
+    KindCounterArray result;
+    for (size_t i = 0; i < result.size(); ++i) {
+      std::string prefix =
+          fmt::format("locks/{}/", GetLockKindName(LockKind(i)));
+      result[i].acquisitions = &counters::GetCounter(prefix + "acquisitions");
+      result[i].contended_acquisitions =
+          &counters::GetCounter(prefix + "contended");
+      result[i].wait_us = &counters::GetCounter(prefix + "wait_us");
+    }
+    return result;
+  }();
+  return kind_counters[size_t(kind)];
+}
+
+// The profiler counter names must be literals.
+void AddProfilerCounters(LockKind kind, uint64_t wait_us) {
+  switch (kind) {
+    case LockKind::kGlobal:
+      COUNT_profile_add("locks/global/contended", 1);
+      COUNT_profile_add("locks/global/wait_us", wait_us);
+      break;
+    case LockKind::kUnlikely:
+      COUNT_profile_add("locks/unlikely/contended", 1);
+      COUNT_profile_add("locks/unlikely/wait_us", wait_us);
+      break;
+    case LockKind::kGuestSpinLock:
+      COUNT_profile_add("locks/guest_spin_lock/contended", 1);
+      COUNT_profile_add("locks/guest_spin_lock/wait_us", wait_us);
+      break;
+    case LockKind::kGuestCriticalSection:
+      COUNT_profile_add("locks/guest_critical_section/contended", 1);
+      COUNT_profile_add("locks/guest_critical_section/wait_us", wait_us);
+      break;
+    default:
+      break;
+  }
+}
+
+uint64_t TicksToNs(uint64_t ticks) {
+  uint64_t frequency = Clock::QueryHostTickFrequency();
+  // Split to avoid overflow in long waits.
+  return ticks / frequency * 1000000000 +
+         ticks % frequency * 1000000000 / frequency;
+}
+
+struct HeldLock {
+  const void* lock;
+  SiteStats* site;
+  uint64_t acquire_ticks;
+  uint32_t depth;
+};
+
+struct ThreadState {
+  const char* next_file = nullptr;
+  uint32_t next_line = 0;
+  // Usually released in the reverse order.
+  std::vector<HeldLock> held_locks;
+  // Not to take the registry lock on every acquisition.
+  std::map<SiteKey, SiteStats*> site_cache;
+};
+
+ThreadState& GetThreadState() {
+  thread_local ThreadState state;
+  return state;
+}
+
+SiteStats* GetSite(ThreadState& state, LockKind kind, const char* file,
+                   uint32_t line, uint32_t guest_address) {
+  SiteKey key(kind, file, line, guest_address);
+  SiteStats*& cached_site = state.site_cache[key];
+  if (cached_site) {
+    return cached_site;
+  }
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto& site = registry.sites[key];
+  if (!site) {
+    site = std::make_unique<SiteStats>();
+    site->kind = kind;
+    site->file = file;
+    site->line = line;
+    site->guest_address = guest_address;
+  }
+  cached_site = site.get();
+  return cached_site;
+}
+
+void OnLockAcquired(ThreadState& state, const void* lock, SiteStats* site,
+                    bool contended, uint64_t wait_start_ticks) {
+  for (auto it = state.held_locks.rbegin(); it != state.held_locks.rend();
+       ++it) {
+    if (it->lock == lock) {
+      // Recursive, the outermost acquisition is timed.
+      ++it->depth;
+      site->acquisitions.fetch_add(1, std::memory_order_relaxed);
+      GetKindCounters(site->kind).acquisitions->Increment();
+      return;
+    }
+  }
+  uint64_t now_ticks = Clock::QueryHostTickCount();
+  site->acquisitions.fetch_add(1, std::memory_order_relaxed);
+  KindCounters& kind_counters = GetKindCounters(site->kind);
+  kind_counters.acquisitions->Increment();
+  if (contended) {
+    uint64_t wait_ns = TicksToNs(now_ticks - wait_start_ticks);
+    site->contended_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    site->wait.Add(wait_ns);
+    kind_counters.contended_acquisitions->Increment();
+    kind_counters.wait_us->Increment(wait_ns / 1000);
+    AddProfilerCounters(site->kind, wait_ns / 1000);
+  }
+  state.held_locks.push_back({lock, site, now_ticks, 1});
+}
+
+std::string FormatSiteName(const SiteStats& site) {
+  if (site.file) {
+    return fmt::format("{}:{}", site.file, site.line);
+  }
+  if (site.kind == LockKind::kGuestSpinLock ||
+      site.kind == LockKind::kGuestCriticalSection) {
+    return fmt::format("guest {:08X}", site.guest_address);
+  }
+  return "(unattributed)";
+}
+
+std::vector<const SiteStats*> GetSortedSites() {
+  std::vector<const SiteStats*> sites;
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    sites.reserve(registry.sites.size());
+    for (const auto& site : registry.sites) {
+      sites.push_back(site.second.get());
+    }
+  }
+  std::stable_sort(sites.begin(), sites.end(),
+                   [](const SiteStats* a, const SiteStats* b) {
+                     return a->wait.total_ns() > b->wait.total_ns();
+                   });
+  return sites;
+}
+
+}  // namespace
+
+const char* GetLockKindName(LockKind kind) {
+  switch (kind) {
+    case LockKind::kGlobal:
+      return "global";
+    case LockKind::kUnlikely:
+      return "unlikely";
+    case LockKind::kGuestSpinLock:
+      return "guest_spin_lock";
+    case LockKind::kGuestCriticalSection:
+      return "guest_critical_section";
+    default:
+      return "unknown";
+  }
+}
+
+void Histogram::Add(uint64_t duration_ns) {
+  size_t index = 0;
+  while (index + 1 < kBucketCount && (uint64_t(1) << index) <= duration_ns) {
+    ++index;
+  }
+  buckets_[index].fetch_add(1, std::memory_order_relaxed);
+  total_ns_.fetch_add(duration_ns, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::count() const {
+  uint64_t count = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    count += bucket(i);
+  }
+  return count;
+}
+
+uint64_t Histogram::GetPercentileNs(double percentile) const {
+  uint64_t total_count = count();
+  if (!total_count) {
+    return 0;
+  }
+  uint64_t target = std::max(uint64_t(1), uint64_t(double(total_count) *
+                                                   percentile / 100.0));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    seen += bucket(i);
+    if (seen >= target) {
+      return uint64_t(1) << i;
+    }
+  }
+  return uint64_t(1) << (kBucketCount - 1);
+}
+
+void SetNextCallSite(const char* file, uint32_t line) {
+  ThreadState& state = GetThreadState();
+  state.next_file = file;
+  state.next_line = line;
+}
+
+uint64_t GetWaitStartTicks() { return Clock::QueryHostTickCount(); }
+
+void OnHostLockAcquired(const void* lock, LockKind kind, bool contended,
+                        uint64_t wait_start_ticks) {
+  ThreadState& state = GetThreadState();
+  const char* file = state.next_file;
+  uint32_t line = state.next_line;
+  state.next_file = nullptr;
+  state.next_line = 0;
+  OnLockAcquired(state, lock, GetSite(state, kind, file, line, 0), contended,
+                 wait_start_ticks);
+}
+
+void OnGuestLockAcquired(const void* lock, LockKind kind,
+                         uint32_t guest_call_site, bool contended,
+                         uint64_t wait_start_ticks) {
+  ThreadState& state = GetThreadState();
+  OnLockAcquired(state, lock,
+                 GetSite(state, kind, nullptr, 0, guest_call_site), contended,
+                 wait_start_ticks);
+}
+
+void OnLockReleasing(const void* lock) {
+  ThreadState& state = GetThreadState();
+  for (auto it = state.held_locks.rbegin(); it != state.held_locks.rend();
+       ++it) {
+    if (it->lock != lock) {
+      continue;
+    }
+    if (--it->depth == 0) {
+      it->site->hold.Add(
+          TicksToNs(Clock::QueryHostTickCount() - it->acquire_ticks));
+      state.held_locks.erase(std::next(it).base());
+    }
+    return;
+  }
+  // Acquired before the profiler was tracking the thread, or on another
+  // thread.
+}
+
+std::string FormatReport() {
+  std::string report = fmt::format(
+      "{:<24} {:<48} {:>12} {:>10} {:>12} {:>10} {:>12} {:>10}\n", "Kind",
+      "Site", "Acquired", "Contended", "Wait us", "Wait p99", "Hold us",
+      "Hold p99");
+  for (const SiteStats* site : GetSortedSites()) {
+    report += fmt::format(
+        "{:<24} {:<48} {:12} {:10} {:12} {:10} {:12} {:10}\n",
+        GetLockKindName(site->kind), FormatSiteName(*site),
+        site->acquisitions.load(std::memory_order_relaxed),
+        site->contended_acquisitions.load(std::memory_order_relaxed),
+        site->wait.total_ns() / 1000, site->wait.GetPercentileNs(99.0) / 1000,
+        site->hold.total_ns() / 1000, site->hold.GetPercentileNs(99.0) / 1000);
+  }
+  return report;
+}
+
+bool DumpToFile(const std::filesystem::path& path) {
+  FILE* file = xe::filesystem::OpenFile(path, "wb");
+  if (!file) {
+    return false;
+  }
+  std::string text = FormatReport();
+  text += "\nkind,site,histogram";
+  for (size_t i = 0; i < Histogram::kBucketCount; ++i) {
+    text += fmt::format(",lt_{}ns", uint64_t(1) << i);
+  }
+  text += '\n';
+  for (const SiteStats* site : GetSortedSites()) {
+    const char* kind_name = GetLockKindName(site->kind);
+    std::string site_name = FormatSiteName(*site);
+    for (const Histogram* histogram : {&site->wait, &site->hold}) {
+      text += fmt::format("{},\"{}\",{}", kind_name, site_name,
+                          histogram == &site->wait ? "wait" : "hold");
+      for (size_t i = 0; i < Histogram::kBucketCount; ++i) {
+        text += fmt::format(",{}", histogram->bucket(i));
+      }
+      text += '\n';
+    }
+  }
+  bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+  fclose(file);
+  return written;
+}
+
+void DumpToConfiguredFile() {
+#if XE_OPTION_LOCK_PROFILING
+  if (cvars::lock_profile_path.empty()) {
+    return;
+  }
+  if (!DumpToFile(cvars::lock_profile_path)) {
+    XELOGE("Failed to write the lock contention statistics to {}",
+           xe::path_to_utf8(cvars::lock_profile_path));
+  }
+#endif  // XE_OPTION_LOCK_PROFILING
+}
+
+}  // namespace lock_profiler
+}  // namespace xe
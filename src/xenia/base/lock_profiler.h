@@ -0,0 +1,139 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_LOCK_PROFILER_H_
+#define XENIA_BASE_LOCK_PROFILER_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Instruments the global critical region mutex, xe_unlikely_mutex and the
+// guest spinlocks and critical sections when defined to 1, for finding which
+// call sites contend on them. Off by default, as it adds a thread-local
+// bookkeeping step to every acquisition.
+#ifndef XE_OPTION_LOCK_PROFILING
+#define XE_OPTION_LOCK_PROFILING 0
+#endif
+
+namespace xe {
+namespace lock_profiler {
+
+enum class LockKind : uint32_t {
+  kGlobal,
+  kUnlikely,
+  kGuestSpinLock,
+  kGuestCriticalSection,
+
+  kCount,
+};
+
+const char* GetLockKindName(LockKind kind);
+
+// Durations in nanoseconds, bucket i holding the ones below 2^i ns (the last
+// one holding everything longer).
+class Histogram {
+ public:
+  static constexpr size_t kBucketCount = 32;
+
+  void Add(uint64_t duration_ns);
+  uint64_t bucket(size_t index) const {
+    return buckets_[index].load(std::memory_order_relaxed);
+  }
+  uint64_t total_ns() const {
+    return total_ns_.load(std::memory_order_relaxed);
+  }
+  uint64_t count() const;
+  // Upper bound of the bucket containing the percentile, 0 if empty.
+  uint64_t GetPercentileNs(double percentile) const;
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_ = {};
+  std::atomic<uint64_t> total_ns_{0};
+};
+
+// Statistics of acquiring a kind of lock from a single call site, a host
+// source location or a guest return address.
+struct SiteStats {
+  LockKind kind;
+  // nullptr for guest call sites and host acquisitions not going through the
+  // critical region helpers.
+  const char* file;
+  uint32_t line;
+  uint32_t guest_address;
+
+  std::atomic<uint64_t> acquisitions{0};
+  std::atomic<uint64_t> contended_acquisitions{0};
+  // Only of the contended acquisitions.
+  Histogram wait;
+  // Of the outermost acquisitions of recursive locks.
+  Histogram hold;
+};
+
+// The call site the next host lock acquisition on the thread is attributed
+// to, set by the critical region helpers.
+void SetNextCallSite(const char* file, uint32_t line);
+
+// The host tick count to pass as the start of waiting for a contended lock.
+uint64_t GetWaitStartTicks();
+// Called after acquiring, with the host tick count of when waiting started if
+// the lock was contended. Recursive acquisitions of a lock already held by
+// the thread are counted without timing.
+void OnHostLockAcquired(const void* lock, LockKind kind, bool contended,
+                        uint64_t wait_start_ticks);
+void OnGuestLockAcquired(const void* lock, LockKind kind,
+                         uint32_t guest_call_site, bool contended,
+                         uint64_t wait_start_ticks);
+// Called before releasing.
+void OnLockReleasing(const void* lock);
+
+// Per-site statistics of all the call sites seen so far, sorted by the total
+// time spent waiting, as a table for the log.
+std::string FormatReport();
+// The report, followed by the histogram buckets of every site as CSV.
+bool DumpToFile(const std::filesystem::path& path);
+// Dumps to the file in the configuration, if any, in profiling builds.
+void DumpToConfiguredFile();
+
+// Wraps a mutex to record the acquisitions of it.
+template <typename Mutex, LockKind kKind>
+class ProfiledMutex {
+ public:
+  void lock() {
+    if (mutex_.try_lock()) {
+      OnHostLockAcquired(this, kKind, false, 0);
+      return;
+    }
+    uint64_t wait_start_ticks = GetWaitStartTicks();
+    mutex_.lock();
+    OnHostLockAcquired(this, kKind, true, wait_start_ticks);
+  }
+  void unlock() {
+    OnLockReleasing(this);
+    mutex_.unlock();
+  }
+  bool try_lock() {
+    if (!mutex_.try_lock()) {
+      return false;
+    }
+    OnHostLockAcquired(this, kKind, false, 0);
+    return true;
+  }
+
+ private:
+  Mutex mutex_;
+};
+
+}  // namespace lock_profiler
+}  // namespace xe
+
+#endif  // XENIA_BASE_LOCK_PROFILER_H_
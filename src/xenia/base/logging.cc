@@ -13,7 +13,9 @@
 #include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include "third_party/disruptorplus/include/disruptorplus/multi_threaded_claim_strategy.hpp"
@@ -43,6 +45,7 @@
 #include "xenia/base/platform_win.h"
 #endif  // XE_PLATFORM
 
+#include "third_party/fmt/include/fmt/args.h"
 #include "third_party/fmt/include/fmt/format.h"
 
 #if XE_PLATFORM_ANDROID
@@ -61,6 +64,12 @@ DEFINE_uint32(log_mask, 0,
               "Kernel = 1, Apu = 2, Cpu = 4.",
               "Logging");
 
+DEFINE_bool(log_deferred_formatting, false,
+            "Format the log lines on the logging thread instead of the threads "
+            "logging them, for the lines with only numbers and strings as "
+            "arguments, making logging cheaper for the emulation threads.",
+            "Logging");
+
 DEFINE_int32(
     log_level, 2,
     "Maximum level to be logged. (0=error, 1=warning, 2=info, 3=debug)",
@@ -78,7 +87,10 @@ Logger* logger_ = nullptr;
 struct LogLine {
   size_t buffer_length;
   uint32_t thread_id;
-  uint16_t _pad_0;  // (2b) padding
+  // The buffer is a line serialized by logging::internal::DeferredLineWriter
+  // that is yet to be formatted.
+  bool deferred;
+  uint8_t _pad_0;  // (1b) padding
   bool terminate;
   char prefix_char;
 };
@@ -270,6 +282,10 @@ class Logger {
 
   std::unique_ptr<xe::threading::Thread> write_thread_;
 
+  // Writer thread only.
+  std::vector<char> deferred_line_data_;
+  std::string deferred_line_text_;
+
   void Write(const char* buf, size_t size) {
     for (const auto& sink : sinks_) {
       sink->Write(buf, size);
@@ -336,7 +352,23 @@ class Logger {
             Write(prefix, sizeof(prefix) - 1);
           }
 
-          if (line.buffer_length) {
+          if (line.buffer_length && line.deferred) {
+            // Formatted from contiguous data, the line may be split in the
+            // ring buffer.
+            deferred_line_data_.resize(line.buffer_length);
+            rb.Read(deferred_line_data_.data(), line.buffer_length);
+            deferred_line_text_.clear();
+            if (!logging::internal::FormatDeferredLine(
+                    deferred_line_data_.data(), deferred_line_data_.size(),
+                    deferred_line_text_)) {
+              deferred_line_text_ += "(malformed deferred log line)";
+            }
+            if (deferred_line_text_.empty() ||
+                deferred_line_text_.back() != '\n') {
+              deferred_line_text_ += '\n';
+            }
+            Write(deferred_line_text_.data(), deferred_line_text_.size());
+          } else if (line.buffer_length) {
             // Get access to the line data - which may be split in the ring
             // buffer - and write it out in parts.
             auto line_range = rb.BeginRead(line.buffer_length);
@@ -405,7 +437,7 @@ class Logger {
  public:
   void AppendLine(uint32_t thread_id, const char prefix_char,
                   const char* buffer_data, size_t buffer_length,
-                  bool terminate = false) {
+                  bool terminate = false, bool deferred = false) {
     size_t count = BlockCount(sizeof(LogLine) + buffer_length);
 
     auto range = claim_strategy_.claim(count);
@@ -420,6 +452,7 @@ class Logger {
     line.thread_id = thread_id;
     line.prefix_char = prefix_char;
     line.terminate = terminate;
+    line.deferred = deferred;
 
     rb.Write(&line, sizeof(LogLine));
     if (buffer_length) {
@@ -497,6 +530,121 @@ void logging::internal::AppendLogLine(LogLevel log_level,
                       thread_log_buffer_, written);
 }
 
+bool logging::internal::ShouldDeferFormatting() {
+  return cvars::log_deferred_formatting;
+}
+
+XE_NOALIAS
+void logging::internal::AppendDeferredLogLine(LogLevel log_level,
+                                              const char prefix_char,
+                                              size_t written) {
+  if (!logger_ || !ShouldLog(log_level) || !written) {
+    return;
+  }
+  logger_->AppendLine(xe::threading::current_thread_id(), prefix_char,
+                      thread_log_buffer_, written, false, true);
+}
+
+bool logging::internal::FormatDeferredLine(const char* data, size_t size,
+                                           std::string& out) {
+  size_t offset = 0;
+  auto read = [&](void* value, size_t value_size) {
+    if (value_size > size - offset) {
+      return false;
+    }
+    std::memcpy(value, data + offset, value_size);
+    offset += value_size;
+    return true;
+  };
+  auto read_string = [&](std::string_view& str) {
+    uint32_t length;
+    if (!read(&length, sizeof(length)) || length > size - offset) {
+      return false;
+    }
+    str = std::string_view(data + offset, length);
+    offset += length;
+    return true;
+  };
+
+  std::string_view format;
+  if (!read_string(format)) {
+    return false;
+  }
+  // String views aren't copied by the store, and point into the data.
+  fmt::dynamic_format_arg_store<fmt::format_context> args;
+  // Reads a value of the type of the argument and adds it to the store.
+  auto read_value = [&](auto value) {
+    if (!read(&value, sizeof(value))) {
+      return false;
+    }
+    args.push_back(value);
+    return true;
+  };
+  while (offset < size) {
+    DeferredArgType type;
+    if (!read(&type, sizeof(type))) {
+      return false;
+    }
+    switch (type) {
+      case DeferredArgType::kSigned:
+        if (!read_value(int64_t())) {
+          return false;
+        }
+        break;
+      case DeferredArgType::kUnsigned:
+        if (!read_value(uint64_t())) {
+          return false;
+        }
+        break;
+      case DeferredArgType::kFloat:
+        if (!read_value(float())) {
+          return false;
+        }
+        break;
+      case DeferredArgType::kDouble:
+        if (!read_value(double())) {
+          return false;
+        }
+        break;
+      case DeferredArgType::kBool: {
+        uint8_t value;
+        if (!read(&value, sizeof(value))) {
+          return false;
+        }
+        args.push_back(value != 0);
+      } break;
+      case DeferredArgType::kChar:
+        if (!read_value(char())) {
+          return false;
+        }
+        break;
+      case DeferredArgType::kPointer: {
+        uint64_t value;
+        if (!read(&value, sizeof(value))) {
+          return false;
+        }
+        args.push_back(reinterpret_cast<const void*>(uintptr_t(value)));
+      } break;
+      case DeferredArgType::kString: {
+        std::string_view value;
+        if (!read_string(value)) {
+          return false;
+        }
+        args.push_back(value);
+      } break;
+      default:
+        return false;
+    }
+  }
+
+  try {
+    fmt::vformat_to(std::back_inserter(out), format, args);
+  } catch (const fmt::format_error&) {
+    return false;
+  }
+  return true;
+}
+
 void logging::AppendLogLine(LogLevel log_level, const char prefix_char,
                             const std::string_view str, uint32_t log_mask) {
   if (!internal::ShouldLog(log_level, log_mask) || !str.size()) {
@@ -12,7 +12,10 @@
 
 #include <cstdarg>
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "third_party/fmt/include/fmt/std.h"
@@ -92,6 +95,122 @@ std::pair<char*, size_t> GetThreadBuffer();
 XE_NOALIAS
 void AppendLogLine(LogLevel log_level, const char prefix_char, size_t written);
 
+// Deferred formatting: the format string and the arguments are copied to the
+// log ring buffer, and formatted on the writer thread, for lines with only
+// arguments that can be copied as plain values (numbers, characters, strings
+// and void pointers). Lines with other arguments are formatted immediately.
+bool ShouldDeferFormatting();
+XE_NOALIAS
+void AppendDeferredLogLine(LogLevel log_level, const char prefix_char,
+                           size_t written);
+
+enum class DeferredArgType : uint8_t {
+  kSigned,
+  kUnsigned,
+  kFloat,
+  kDouble,
+  kBool,
+  kChar,
+  kPointer,
+  kString,
+};
+
+template <typename T>
+constexpr bool IsDeferrableArg() {
+  using U = std::remove_cvref_t<T>;
+  using D = std::decay_t<U>;
+  if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, char> ||
+                std::is_same_v<U, float> || std::is_same_v<U, double>) {
+    return true;
+  } else if constexpr (std::is_same_v<U, wchar_t> ||
+                       std::is_same_v<U, char8_t> ||
+                       std::is_same_v<U, char16_t> ||
+                       std::is_same_v<U, char32_t>) {
+    return false;
+  } else if constexpr (std::is_integral_v<U>) {
+    return sizeof(U) <= sizeof(uint64_t);
+  } else {
+    return std::is_same_v<D, const void*> || std::is_same_v<D, void*> ||
+           std::is_same_v<D, const char*> || std::is_same_v<D, char*> ||
+           std::is_same_v<U, std::string> ||
+           std::is_same_v<U, std::string_view>;
+  }
+}
+
+// Serializes a deferred line into a buffer, failing if it doesn't fit.
+class DeferredLineWriter {
+ public:
+  DeferredLineWriter(char* buffer, size_t capacity)
+      : buffer_(buffer), capacity_(capacity) {}
+
+  size_t size() const { return size_; }
+
+  bool WriteFormat(std::string_view format) { return WriteString(format); }
+
+  template <typename T>
+  bool WriteArg(const T& arg) {
+    using U = std::remove_cvref_t<T>;
+    using D = std::decay_t<U>;
+    if constexpr (std::is_same_v<U, bool>) {
+      return WriteValue(DeferredArgType::kBool, uint8_t(arg));
+    } else if constexpr (std::is_same_v<U, char>) {
+      return WriteValue(DeferredArgType::kChar, arg);
+    } else if constexpr (std::is_same_v<U, float>) {
+      return WriteValue(DeferredArgType::kFloat, arg);
+    } else if constexpr (std::is_same_v<U, double>) {
+      return WriteValue(DeferredArgType::kDouble, arg);
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+      return WriteValue(DeferredArgType::kSigned, int64_t(arg));
+    } else if constexpr (std::is_integral_v<U>) {
+      return WriteValue(DeferredArgType::kUnsigned, uint64_t(arg));
+    } else if constexpr (std::is_same_v<D, const void*> ||
+                         std::is_same_v<D, void*>) {
+      return WriteValue(DeferredArgType::kPointer, uint64_t(uintptr_t(arg)));
+    } else if constexpr (!std::is_array_v<U> &&
+                         (std::is_same_v<D, const char*> ||
+                          std::is_same_v<D, char*>)) {
+      // Left to the immediate path to report.
+      if (!arg) {
+        return false;
+      }
+      return WriteType(DeferredArgType::kString) &&
+             WriteString(std::string_view(arg));
+    } else {
+      // Strings and character arrays.
+      return WriteType(DeferredArgType::kString) &&
+             WriteString(std::string_view(arg));
+    }
+  }
+
+ private:
+  bool Write(const void* data, size_t size) {
+    if (size > capacity_ - size_) {
+      return false;
+    }
+    std::memcpy(buffer_ + size_, data, size);
+    size_ += size;
+    return true;
+  }
+  bool WriteType(DeferredArgType type) { return Write(&type, sizeof(type)); }
+  template <typename T>
+  bool WriteValue(DeferredArgType type, T value) {
+    return WriteType(type) && Write(&value, sizeof(value));
+  }
+  bool WriteString(std::string_view str) {
+    uint32_t length = uint32_t(str.size());
+    return str.size() <= UINT32_MAX && Write(&length, sizeof(length)) &&
+           Write(str.data(), str.size());
+  }
+
+  char* buffer_;
+  size_t capacity_;
+  size_t size_ = 0;
+};
+
+// Formats a line serialized by DeferredLineWriter, appending it to the
+// string. Returns false if the data is malformed or the format is invalid.
+bool FormatDeferredLine(const char* data, size_t size, std::string& out);
+
 }  // namespace internal
 // technically, noalias is incorrect here, these functions do in fact alias
 // global memory, but msvc will not optimize the calls away, and the global
@@ -101,6 +220,16 @@ template <typename... Args>
 XE_NOALIAS XE_NOINLINE XE_COLD static void AppendLogLineFormat_Impl(
     LogLevel log_level, const char prefix_char, std::string_view format,
     const Args&... args) noexcept {
+  if constexpr ((internal::IsDeferrableArg<Args>() && ...)) {
+    if (internal::ShouldDeferFormatting()) {
+      auto target = internal::GetThreadBuffer();
+      internal::DeferredLineWriter writer(target.first, target.second);
+      if (writer.WriteFormat(format) && (writer.WriteArg(args) && ...)) {
+        internal::AppendDeferredLogLine(log_level, prefix_char, writer.size());
+        return;
+      }
+    }
+  }
   auto target = internal::GetThreadBuffer();
   auto result = fmt::format_to_n(target.first, target.second,
                                  fmt::runtime(format), args...);
@@ -23,6 +23,9 @@ class MappedMemory {
   enum class Mode {
     kRead,
     kReadWrite,
+    // Writable while other processes have the file open and mapped too, for
+    // exchanging data between them.
+    kReadWriteShared,
   };
 
   static std::unique_ptr<MappedMemory> Open(const std::filesystem::path& path,
@@ -220,7 +220,7 @@ void vastcpy(uint8_t* XE_RESTRICT physaddr, uint8_t* XE_RESTRICT rdmapping,
 }
 }  // namespace memory
 
-// TODO(benvanik): fancy AVX versions.
+// Based on the SSSE3 kernels from VOLK:
 // https://github.com/gnuradio/volk/blob/master/kernels/volk/volk_16u_byteswap.h
 // https://github.com/gnuradio/volk/blob/master/kernels/volk/volk_32u_byteswap.h
 // https://github.com/gnuradio/volk/blob/master/kernels/volk/volk_64u_byteswap.h
@@ -235,225 +235,283 @@ void copy_128_aligned(void* dest, const void* src, size_t count) {
 
 #if XE_ARCH_AMD64
 
-// This works around a GCC bug
-// https://gcc.gnu.org/bugzilla/show_bug.cgi?id=100801
-// TODO(Joel Linn): Remove this when fixed GCC versions are common place.
-#if XE_COMPILER_GNUC
-#define XE_WORKAROUND_CONSTANT_RETURN_IF(x) \
-  if (__builtin_constant_p(x) && (x)) return;
+// The baseline is AVX on Windows and AVX2 on Linux, the wider kernels are
+// compiled for their instruction sets and selected at runtime.
+#if XE_COMPILER_GNUC || XE_COMPILER_CLANG
+#define XE_COPY_AND_SWAP_AVX2_TARGET __attribute__((target("avx2")))
+#define XE_COPY_AND_SWAP_AVX512_TARGET \
+  __attribute__((target("avx512f,avx512bw")))
 #else
-#define XE_WORKAROUND_CONSTANT_RETURN_IF(x)
+#define XE_COPY_AND_SWAP_AVX2_TARGET
+#define XE_COPY_AND_SWAP_AVX512_TARGET
 #endif
-void copy_and_swap_16_aligned(void* dest_ptr, const void* src_ptr,
-                              size_t count) {
-  assert_zero(reinterpret_cast<uintptr_t>(dest_ptr) & 0xF);
-  assert_zero(reinterpret_cast<uintptr_t>(src_ptr) & 0xF);
 
-  auto dest = reinterpret_cast<uint16_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint16_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x0E, 0x0F, 0x0C, 0x0D, 0x0A, 0x0B, 0x08, 0x09, 0x06, 0x07,
-                   0x04, 0x05, 0x02, 0x03, 0x00, 0x01);
+namespace {
+
+// All the swaps are byte shuffles within 16-byte lanes, with the size being a
+// multiple of the element size.
+XE_FORCEINLINE __m128i GetSwap16Shuffle() {
+  return _mm_set_epi8(0x0E, 0x0F, 0x0C, 0x0D, 0x0A, 0x0B, 0x08, 0x09, 0x06,
+                      0x07, 0x04, 0x05, 0x02, 0x03, 0x00, 0x01);
+}
+XE_FORCEINLINE __m128i GetSwap32Shuffle() {
+  return _mm_set_epi8(0x0C, 0x0D, 0x0E, 0x0F, 0x08, 0x09, 0x0A, 0x0B, 0x04,
+                      0x05, 0x06, 0x07, 0x00, 0x01, 0x02, 0x03);
+}
+XE_FORCEINLINE __m128i GetSwap64Shuffle() {
+  return _mm_set_epi8(0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00,
+                      0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07);
+}
+XE_FORCEINLINE __m128i GetSwap16In32Shuffle() {
+  return _mm_set_epi8(0x0D, 0x0C, 0x0F, 0x0E, 0x09, 0x08, 0x0B, 0x0A, 0x05,
+                      0x04, 0x07, 0x06, 0x01, 0x00, 0x03, 0x02);
+}
+
+// Less than 16 bytes, through a temporary not to touch the memory after the
+// end. Works in place.
+XE_FORCEINLINE void CopyAndSwapTail(uint8_t* dest, const uint8_t* src,
+                                    size_t size, __m128i shuffle) {
+  __m128i block = _mm_setzero_si128();
+  std::memcpy(&block, src, size);
+  block = _mm_shuffle_epi8(block, shuffle);
+  std::memcpy(dest, &block, size);
+}
 
+using CopyAndSwapFunction = void (*)(uint8_t* dest, const uint8_t* src,
+                                     size_t size, __m128i shuffle);
+
+void CopyAndSwapSSSE3(uint8_t* dest, const uint8_t* src, size_t size,
+                      __m128i shuffle) {
+  size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    __m128i input0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i input1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+    __m128i input2 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32));
+    __m128i input3 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_shuffle_epi8(input0, shuffle));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 16),
+                     _mm_shuffle_epi8(input1, shuffle));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 32),
+                     _mm_shuffle_epi8(input2, shuffle));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 48),
+                     _mm_shuffle_epi8(input3, shuffle));
+  }
+  for (; i + 16 <= size; i += 16) {
+    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_shuffle_epi8(input, shuffle));
+  }
+  if (i < size) {
+    CopyAndSwapTail(dest + i, src + i, size - i, shuffle);
+  }
+}
+
+XE_COPY_AND_SWAP_AVX2_TARGET
+void CopyAndSwapAVX2(uint8_t* dest, const uint8_t* src, size_t size,
+                     __m128i shuffle) {
+  // vpshufb has a throughput of 0.5, so 2 vectors per iteration.
+  __m256i shuffle_256 = _mm256_broadcastsi128_si256(shuffle);
   size_t i = 0;
-  for (i = 0; i + 8 <= count; i += 8) {
-    __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
+  for (; i + 64 <= size; i += 64) {
+    __m256i input0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i input1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+                        _mm256_shuffle_epi8(input0, shuffle_256));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i + 32),
+                        _mm256_shuffle_epi8(input1, shuffle_256));
+  }
+  if (i + 32 <= size) {
+    __m256i input =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+                        _mm256_shuffle_epi8(input, shuffle_256));
+    i += 32;
+  }
+  if (i + 16 <= size) {
+    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_shuffle_epi8(input, shuffle));
+    i += 16;
+  }
+  if (i < size) {
+    CopyAndSwapTail(dest + i, src + i, size - i, shuffle);
+  }
+}
+
+XE_COPY_AND_SWAP_AVX512_TARGET
+void CopyAndSwapAVX512(uint8_t* dest, const uint8_t* src, size_t size,
+                       __m128i shuffle) {
+  __m512i shuffle_512 = _mm512_broadcast_i32x4(shuffle);
+  size_t i = 0;
+  for (; i + 128 <= size; i += 128) {
+    __m512i input0 = _mm512_loadu_si512(src + i);
+    __m512i input1 = _mm512_loadu_si512(src + i + 64);
+    _mm512_storeu_si512(dest + i, _mm512_shuffle_epi8(input0, shuffle_512));
+    _mm512_storeu_si512(dest + i + 64,
+                        _mm512_shuffle_epi8(input1, shuffle_512));
   }
-  XE_WORKAROUND_CONSTANT_RETURN_IF(count % 8 == 0);
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = byte_swap(src[i]);
+  if (i + 64 <= size) {
+    __m512i input = _mm512_loadu_si512(src + i);
+    _mm512_storeu_si512(dest + i, _mm512_shuffle_epi8(input, shuffle_512));
+    i += 64;
+  }
+  if (i < size) {
+    // Masked accesses don't fault on the bytes outside the mask.
+    __mmask64 mask = (UINT64_C(1) << (size - i)) - 1;
+    __m512i input = _mm512_maskz_loadu_epi8(mask, src + i);
+    _mm512_mask_storeu_epi8(dest + i, mask,
+                            _mm512_shuffle_epi8(input, shuffle_512));
+  }
+}
+
+XE_COLD
+void FirstCopyAndSwap(uint8_t* dest, const uint8_t* src, size_t size,
+                      __m128i shuffle);
+
+CopyAndSwapFunction copy_and_swap_dispatch = FirstCopyAndSwap;
+
+XE_COLD
+void FirstCopyAndSwap(uint8_t* dest, const uint8_t* src, size_t size,
+                      __m128i shuffle) {
+  uint64_t feature_flags = amd64::GetFeatureFlags();
+  if ((feature_flags & (amd64::kX64EmitAVX512F | amd64::kX64EmitAVX512BW)) ==
+      (amd64::kX64EmitAVX512F | amd64::kX64EmitAVX512BW)) {
+    copy_and_swap_dispatch = CopyAndSwapAVX512;
+  } else if (feature_flags & amd64::kX64EmitAVX2) {
+    copy_and_swap_dispatch = CopyAndSwapAVX2;
+  } else {
+    copy_and_swap_dispatch = CopyAndSwapSSSE3;
   }
+  copy_and_swap_dispatch(dest, src, size, shuffle);
+}
+
+XE_FORCEINLINE void CopyAndSwap(void* dest, const void* src, size_t size,
+                                __m128i shuffle) {
+  copy_and_swap_dispatch(reinterpret_cast<uint8_t*>(dest),
+                         reinterpret_cast<const uint8_t*>(src), size, shuffle);
+}
+
+// Streaming stores are 16-byte aligned, so the destination is brought to the
+// alignment with a partial block first, which needs it to be aligned to the
+// element size. Always SSE - the stores are limited by the memory bandwidth.
+void CopyAndSwapNontemporal(void* dest_ptr, const void* src_ptr,
+                            size_t element_size, size_t count,
+                            __m128i shuffle) {
+  auto dest = reinterpret_cast<uint8_t*>(dest_ptr);
+  auto src = reinterpret_cast<const uint8_t*>(src_ptr);
+  size_t size = element_size * count;
+  if (reinterpret_cast<uintptr_t>(dest) & (element_size - 1)) {
+    CopyAndSwap(dest, src, size, shuffle);
+    return;
+  }
+  size_t i = std::min(size_t(-reinterpret_cast<intptr_t>(dest) & 0xF), size);
+  if (i) {
+    CopyAndSwapTail(dest, src, i, shuffle);
+  }
+  for (; i + 64 <= size; i += 64) {
+    __m128i input0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i input1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+    __m128i input2 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32));
+    __m128i input3 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_shuffle_epi8(input0, shuffle));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dest + i + 16),
+                     _mm_shuffle_epi8(input1, shuffle));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dest + i + 32),
+                     _mm_shuffle_epi8(input2, shuffle));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dest + i + 48),
+                     _mm_shuffle_epi8(input3, shuffle));
+  }
+  for (; i + 16 <= size; i += 16) {
+    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_shuffle_epi8(input, shuffle));
+  }
+  if (i < size) {
+    CopyAndSwapTail(dest + i, src + i, size - i, shuffle);
+  }
+  // Make the streamed data visible to the other threads before returning.
+  _mm_sfence();
+}
+
+}  // namespace
+
+void copy_and_swap_16_aligned(void* dest_ptr, const void* src_ptr,
+                              size_t count) {
+  assert_zero(reinterpret_cast<uintptr_t>(dest_ptr) & 0xF);
+  assert_zero(reinterpret_cast<uintptr_t>(src_ptr) & 0xF);
+  CopyAndSwap(dest_ptr, src_ptr, count * sizeof(uint16_t), GetSwap16Shuffle());
 }
 
 void copy_and_swap_16_unaligned(void* dest_ptr, const void* src_ptr,
                                 size_t count) {
-  auto dest = reinterpret_cast<uint16_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint16_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x0E, 0x0F, 0x0C, 0x0D, 0x0A, 0x0B, 0x08, 0x09, 0x06, 0x07,
-                   0x04, 0x05, 0x02, 0x03, 0x00, 0x01);
-
-  size_t i;
-  for (i = 0; i + 8 <= count; i += 8) {
-    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
-  XE_WORKAROUND_CONSTANT_RETURN_IF(count % 8 == 0);
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = byte_swap(src[i]);
-  }
+  CopyAndSwap(dest_ptr, src_ptr, count * sizeof(uint16_t), GetSwap16Shuffle());
 }
 
 void copy_and_swap_32_aligned(void* dest_ptr, const void* src_ptr,
                               size_t count) {
   assert_zero(reinterpret_cast<uintptr_t>(dest_ptr) & 0xF);
   assert_zero(reinterpret_cast<uintptr_t>(src_ptr) & 0xF);
-
-  auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint32_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x0C, 0x0D, 0x0E, 0x0F, 0x08, 0x09, 0x0A, 0x0B, 0x04, 0x05,
-                   0x06, 0x07, 0x00, 0x01, 0x02, 0x03);
-
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
-    __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
-  XE_WORKAROUND_CONSTANT_RETURN_IF(count % 4 == 0);
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = byte_swap(src[i]);
-  }
+  CopyAndSwap(dest_ptr, src_ptr, count * sizeof(uint32_t), GetSwap32Shuffle());
 }
 
 void copy_and_swap_32_unaligned(void* dest_ptr, const void* src_ptr,
                                 size_t count) {
-  auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint32_t*>(src_ptr);
-  size_t i;
-  // chrispy: this optimization mightt backfire if our unaligned load spans two
-  // cachelines... which it probably will
-  if (amd64::GetFeatureFlags() & amd64::kX64EmitAVX2) {
-    __m256i shufmask = _mm256_set_epi8(
-        0x0C, 0x0D, 0x0E, 0x0F, 0x08, 0x09, 0x0A, 0x0B, 0x04, 0x05, 0x06, 0x07,
-        0x00, 0x01, 0x02, 0x03, 0x0C, 0x0D, 0x0E, 0x0F, 0x08, 0x09, 0x0A, 0x0B,
-        0x04, 0x05, 0x06, 0x07, 0x00, 0x01, 0x02, 0x03);
-    // with vpshufb being a 0.5 through instruction, it makes the most sense to
-    // double up on our iters
-    for (i = 0; i + 16 <= count; i += 16) {
-      __m256i input1 =
-          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[i]));
-      __m256i input2 =
-          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[i + 8]));
-
-      __m256i output1 = _mm256_shuffle_epi8(input1, shufmask);
-      __m256i output2 = _mm256_shuffle_epi8(input2, shufmask);
-// chrispy: todo, benchmark this w/ and w/out these prefetches here on multiple
-// machines finding a good distance for prefetchw in particular is probably
-// important for when we're writing across 2 cachelines
-#if 0
-      if (i + 48 <= count) {
-        swcache::PrefetchNTA(&src[i + 32]);
-        if (amd64::GetFeatureFlags() & amd64::kX64EmitPrefetchW) {
-          swcache::PrefetchW(&dest[i + 32]);
-        }
-      }
-#endif
-      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dest[i]), output1);
-      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dest[i + 8]), output2);
-    }
-    if (i + 8 <= count) {
-      __m256i input =
-          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[i]));
-      __m256i output = _mm256_shuffle_epi8(input, shufmask);
-      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dest[i]), output);
-      i += 8;
-    }
-    if (i + 4 <= count) {
-      __m128i input =
-          _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
-      __m128i output =
-          _mm_shuffle_epi8(input, _mm256_castsi256_si128(shufmask));
-      _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-      i += 4;
-    }
-  } else {
-    __m128i shufmask =
-        _mm_set_epi8(0x0C, 0x0D, 0x0E, 0x0F, 0x08, 0x09, 0x0A, 0x0B, 0x04, 0x05,
-                     0x06, 0x07, 0x00, 0x01, 0x02, 0x03);
-
-    for (i = 0; i + 4 <= count; i += 4) {
-      __m128i input =
-          _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
-      __m128i output = _mm_shuffle_epi8(input, shufmask);
-      _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-    }
-  }
-  XE_WORKAROUND_CONSTANT_RETURN_IF(count % 4 == 0);
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = byte_swap(src[i]);
-  }
+  CopyAndSwap(dest_ptr, src_ptr, count * sizeof(uint32_t), GetSwap32Shuffle());
 }
 
 void copy_and_swap_64_aligned(void* dest_ptr, const void* src_ptr,
                               size_t count) {
   assert_zero(reinterpret_cast<uintptr_t>(dest_ptr) & 0xF);
   assert_zero(reinterpret_cast<uintptr_t>(src_ptr) & 0xF);
-
-  auto dest = reinterpret_cast<uint64_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint64_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0x01,
-                   0x02, 0x03, 0x04, 0x05, 0x06, 0x07);
-
-  size_t i;
-  for (i = 0; i + 2 <= count; i += 2) {
-    __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
-  XE_WORKAROUND_CONSTANT_RETURN_IF(count % 2 == 0);
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = byte_swap(src[i]);
-  }
+  CopyAndSwap(dest_ptr, src_ptr, count * sizeof(uint64_t), GetSwap64Shuffle());
 }
 
 void copy_and_swap_64_unaligned(void* dest_ptr, const void* src_ptr,
                                 size_t count) {
-  auto dest = reinterpret_cast<uint64_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint64_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0x01,
-                   0x02, 0x03, 0x04, 0x05, 0x06, 0x07);
-
-  size_t i;
-  for (i = 0; i + 2 <= count; i += 2) {
-    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
-  XE_WORKAROUND_CONSTANT_RETURN_IF(count % 2 == 0);
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = byte_swap(src[i]);
-  }
+  CopyAndSwap(dest_ptr, src_ptr, count * sizeof(uint64_t), GetSwap64Shuffle());
 }
 
 void copy_and_swap_16_in_32_aligned(void* dest_ptr, const void* src_ptr,
                                     size_t count) {
-  auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint32_t*>(src_ptr);
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
-    __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output =
-        _mm_or_si128(_mm_slli_epi32(input, 16), _mm_srli_epi32(input, 16));
-    _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
-  XE_WORKAROUND_CONSTANT_RETURN_IF(count % 4 == 0);
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = (src[i] >> 16) | (src[i] << 16);
-  }
+  CopyAndSwap(dest_ptr, src_ptr, count * sizeof(uint32_t),
+              GetSwap16In32Shuffle());
 }
 
 void copy_and_swap_16_in_32_unaligned(void* dest_ptr, const void* src_ptr,
                                       size_t count) {
-  auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint32_t*>(src_ptr);
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
-    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output =
-        _mm_or_si128(_mm_slli_epi32(input, 16), _mm_srli_epi32(input, 16));
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
-  XE_WORKAROUND_CONSTANT_RETURN_IF(count % 4 == 0);
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = (src[i] >> 16) | (src[i] << 16);
-  }
+  CopyAndSwap(dest_ptr, src_ptr, count * sizeof(uint32_t),
+              GetSwap16In32Shuffle());
+}
+
+void copy_and_swap_16_nontemporal(void* dest, const void* src, size_t count) {
+  CopyAndSwapNontemporal(dest, src, sizeof(uint16_t), count,
+                         GetSwap16Shuffle());
+}
+
+void copy_and_swap_32_nontemporal(void* dest, const void* src, size_t count) {
+  CopyAndSwapNontemporal(dest, src, sizeof(uint32_t), count,
+                         GetSwap32Shuffle());
+}
+
+void copy_and_swap_64_nontemporal(void* dest, const void* src, size_t count) {
+  CopyAndSwapNontemporal(dest, src, sizeof(uint64_t), count,
+                         GetSwap64Shuffle());
+}
+
+void copy_and_swap_16_in_32_nontemporal(void* dest, const void* src,
+                                        size_t count) {
+  CopyAndSwapNontemporal(dest, src, sizeof(uint32_t), count,
+                         GetSwap16In32Shuffle());
 }
 
 #elif XE_ARCH_ARM64
@@ -568,15 +626,30 @@ void copy_and_swap_16_in_32_aligned(void* dst, const void* src, size_t count) {
 
 void copy_and_swap_16_in_32_unaligned(void* dst_ptr, const void* src_ptr,
                                       size_t count) {
-  auto dst = reinterpret_cast<uint16_t*>(dst_ptr);
-  auto src = reinterpret_cast<const uint16_t*>(src_ptr);
+  auto dst = reinterpret_cast<uint8_t*>(dst_ptr);
+  auto src = reinterpret_cast<const uint8_t*>(src_ptr);
+
+  const uint8x16_t tbl_idx =
+      vcombine_u8(vcreate_u8(UINT64_C(0x0504070601000302)),
+                  vcreate_u8(UINT64_C(0x0D0C0F0E09080B0A)));
+
+  while (count >= 4) {
+    uint8x16_t data = vld1q_u8(src);
+    data = vqtbl1q_u8(data, tbl_idx);
+    vst1q_u8(dst, data);
+
+    count -= 4;
+    dst += 16;
+    src += 16;
+  }
+
   while (count > 0) {
-    uint16_t word0 = *src++;
-    uint16_t word1 = *src++;
-    *dst++ = word1;
-    *dst++ = word0;
+    uint32_t value = load<uint32_t>(src);
+    store<uint32_t>(dst, (value >> 16) | (value << 16));
 
     count--;
+    dst += 4;
+    src += 4;
   }
 }
 
@@ -17,6 +17,7 @@
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <utility>
 
 #include "xenia/base/byte_order.h"
 
@@ -156,6 +157,14 @@ void* MapFileView(FileMappingHandle handle, void* base_address, size_t length,
                   PageAccess access, size_t file_offset);
 bool UnmapFileView(FileMappingHandle handle, void* base_address, size_t length);
 
+// Requests the mapped file view to be backed by huge pages where possible,
+// while keeping page-granular protection. Returns false if not supported.
+bool AdviseHugePages(void* base_address, size_t length);
+
+// Makes the pages in the range preferably allocated on the host NUMA node,
+// moving the ones already allocated elsewhere. Returns false if not supported.
+bool BindToNumaNode(void* base_address, size_t length, uint32_t node);
+
 inline size_t hash_combine(size_t seed) { return seed; }
 
 template <typename T, typename... Ts>
@@ -179,6 +188,10 @@ inline void* low_address(void* address) {
 
 void copy_128_aligned(void* dest, const void* src, size_t count);
 
+// Byte swapping copies of count elements, also used for the GPU 8-in-16
+// (16), 8-in-32 (32) and 16-in-32 endianness, using the widest vectors the
+// host supports. They work in place, and never access the memory past the
+// end. The aligned variants require 16-byte alignment of both pointers.
 void copy_and_swap_16_aligned(void* dest, const void* src, size_t count);
 void copy_and_swap_16_unaligned(void* dest, const void* src, size_t count);
 void copy_and_swap_32_aligned(void* dest, const void* src, size_t count);
@@ -188,6 +201,16 @@ void copy_and_swap_64_unaligned(void* dest, const void* src, size_t count);
 void copy_and_swap_16_in_32_aligned(void* dest, const void* src, size_t count);
 void copy_and_swap_16_in_32_unaligned(void* dest, const void* src,
                                       size_t count);
+#if XE_ARCH_AMD64 == 1
+// With non-temporal stores, for large copies to memory that won't be read by
+// the CPU soon, such as GPU upload buffers. Any alignment. Only on x86-64 for
+// now, use the unaligned variants elsewhere.
+void copy_and_swap_16_nontemporal(void* dest, const void* src, size_t count);
+void copy_and_swap_32_nontemporal(void* dest, const void* src, size_t count);
+void copy_and_swap_64_nontemporal(void* dest, const void* src, size_t count);
+void copy_and_swap_16_in_32_nontemporal(void* dest, const void* src,
+                                        size_t count);
+#endif  // XE_ARCH_AMD64
 
 template <typename T>
 void copy_and_swap(T* dest, const T* src, size_t count) {
@@ -532,6 +555,11 @@ class FixedVMemVector {
     resize(0);  // todo:maybe zero out
   }
   void reserve(size_t size) { xenia_assert(size < sz); }
+
+  void swap(FixedVMemVector& other) {
+    std::swap(data_, other.data_);
+    std::swap(nbytes_, other.nbytes_);
+  }
 };
 // software prefetches/cache operations
 namespace swcache {
@@ -12,15 +12,22 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <climits>
 #include <cstddef>
 #include <fstream>
 #include <mutex>
 #include <sstream>
+#include <vector>
 
 #include "xenia/base/math.h"
 #include "xenia/base/platform.h"
 #include "xenia/base/string.h"
 
+#if XE_PLATFORM_LINUX
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
 #if XE_PLATFORM_ANDROID
 #include <dlfcn.h>
 #include <linux/ashmem.h>
@@ -325,5 +332,27 @@ bool UnmapFileView(FileMappingHandle handle, void* base_address,
   return munmap(base_address, length) == 0;
 }
 
+bool AdviseHugePages(void* base_address, size_t length) {
+#if defined(MADV_HUGEPAGE)
+  return madvise(base_address, length, MADV_HUGEPAGE) == 0;
+#else
+  return false;
+#endif
+}
+
+bool BindToNumaNode(void* base_address, size_t length, uint32_t node) {
+#if XE_PLATFORM_LINUX && defined(SYS_mbind)
+  // Called directly, libnuma only wraps it.
+  const size_t kMaskBits = sizeof(unsigned long) * CHAR_BIT;
+  std::vector<unsigned long> node_mask(node / kMaskBits + 1);
+  node_mask[node / kMaskBits] = 1ul << (node % kMaskBits);
+  return syscall(SYS_mbind, base_address, length, MPOL_PREFERRED,
+                 node_mask.data(), node_mask.size() * kMaskBits + 1,
+                 MPOL_MF_MOVE) == 0;
+#else
+  return false;
+#endif
+}
+
 }  // namespace memory
 }  // namespace xe
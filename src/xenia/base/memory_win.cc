@@ -283,5 +283,18 @@ bool UnmapFileView(FileMappingHandle handle, void* base_address,
   return UnmapViewOfFile(base_address) ? true : false;
 }
 
+bool AdviseHugePages(void* base_address, size_t length) {
+  // Large pages (SEC_LARGE_PAGES) must be committed at creation and can't be
+  // protected at page granularity, which the physical memory watches need.
+  return false;
+}
+
+bool BindToNumaNode(void* base_address, size_t length, uint32_t node) {
+  // The node can only be chosen when mapping a view (MapViewOfFileExNuma),
+  // otherwise the pages are placed on the node of the thread touching them
+  // first.
+  return false;
+}
+
 }  // namespace memory
 }  // namespace xe
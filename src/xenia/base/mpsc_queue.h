@@ -0,0 +1,79 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_MPSC_QUEUE_H_
+#define XENIA_BASE_MPSC_QUEUE_H_
+
+#include <atomic>
+
+namespace xe {
+
+struct MpscQueueNode {
+  std::atomic<MpscQueueNode*> mpsc_queue_next{nullptr};
+};
+
+// Intrusive multi-producer single-consumer FIFO queue (Dmitry Vyukov's node
+// based design). Pushing is wait-free and can be done from any thread, popping
+// only from one thread at a time. The nodes are owned by the caller and must
+// stay alive while they are in the queue.
+class MpscQueue {
+ public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) {}
+  MpscQueue(const MpscQueue& queue) = delete;
+  MpscQueue& operator=(const MpscQueue& queue) = delete;
+
+  void Push(MpscQueueNode* node) {
+    node->mpsc_queue_next.store(nullptr, std::memory_order_relaxed);
+    MpscQueueNode* previous = head_.exchange(node, std::memory_order_acq_rel);
+    // Until this store, the consumer sees the queue as ending at previous.
+    previous->mpsc_queue_next.store(node, std::memory_order_release);
+  }
+
+  // Returns nullptr if the queue is empty, or if the next node is still being
+  // pushed. In the latter case, the node is visible once the Push that is in
+  // progress returns.
+  MpscQueueNode* Pop() {
+    MpscQueueNode* tail = tail_;
+    MpscQueueNode* next = tail->mpsc_queue_next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (!next) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->mpsc_queue_next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    // The tail is the last node, it can only be popped with something after
+    // it.
+    Push(&stub_);
+    next = tail->mpsc_queue_next.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+ private:
+  std::atomic<MpscQueueNode*> head_;
+  // Only accessed by the consumer.
+  MpscQueueNode* tail_;
+  MpscQueueNode stub_;
+};
+
+}  // namespace xe
+
+#endif  // XENIA_BASE_MPSC_QUEUE_H_
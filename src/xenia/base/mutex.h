@@ -10,6 +10,8 @@
 #ifndef XENIA_BASE_MUTEX_H_
 #define XENIA_BASE_MUTEX_H_
 #include <mutex>
+#include <source_location>
+#include "lock_profiler.h"
 #include "memory.h"
 #include "platform.h"
 #define XE_ENABLE_FAST_WIN32_MUTEX 1
@@ -36,7 +38,7 @@ class alignas(4096) xe_global_mutex {
   void unlock();
   bool try_lock();
 };
-using global_mutex_type = xe_global_mutex;
+using unprofiled_global_mutex_type = xe_global_mutex;
 
 class alignas(64) xe_fast_mutex {
   XE_MAYBE_UNUSED
@@ -52,7 +54,7 @@ class alignas(64) xe_fast_mutex {
 };
 // a mutex that is extremely unlikely to ever be locked
 // use for race conditions that have extremely remote odds of happening
-class xe_unlikely_mutex {
+class xe_unlikely_spin_mutex {
   std::atomic<uint32_t> mut;
   bool _tryget() {
     uint32_t lock_expected = 0;
@@ -60,8 +62,8 @@ class xe_unlikely_mutex {
   }
 
  public:
-  xe_unlikely_mutex() : mut(0) {}
-  ~xe_unlikely_mutex() { mut = 0; }
+  xe_unlikely_spin_mutex() : mut(0) {}
+  ~xe_unlikely_spin_mutex() { mut = 0; }
 
   void lock() {
     if (XE_LIKELY(_tryget())) {
@@ -79,11 +81,37 @@ class xe_unlikely_mutex {
   void unlock() { mut.exchange(0); }
   bool try_lock() { return _tryget(); }
 };
+using unprofiled_unlikely_mutex_type = xe_unlikely_spin_mutex;
 using xe_mutex = xe_fast_mutex;
+// xe_fast_mutex is recursive too.
+using xe_recursive_mutex = xe_fast_mutex;
 #else
-using global_mutex_type = std::recursive_mutex;
+using unprofiled_global_mutex_type = std::recursive_mutex;
+using unprofiled_unlikely_mutex_type = std::mutex;
 using xe_mutex = std::mutex;
-using xe_unlikely_mutex = std::mutex;
+using xe_recursive_mutex = std::recursive_mutex;
+#endif
+#if XE_OPTION_LOCK_PROFILING
+using global_mutex_type =
+    lock_profiler::ProfiledMutex<unprofiled_global_mutex_type,
+                                 lock_profiler::LockKind::kGlobal>;
+using xe_unlikely_mutex =
+    lock_profiler::ProfiledMutex<unprofiled_unlikely_mutex_type,
+                                 lock_profiler::LockKind::kUnlikely>;
+// Attributes the acquisitions through the critical region helpers to the
+// callers of the helpers.
+#define XE_LOCK_CALL_SITE_PARAMETER \
+  const std::source_location& call_site = std::source_location::current()
+#define XE_LOCK_SET_CALL_SITE()                              \
+  lock_profiler::SetNextCallSite(call_site.file_name(),      \
+                                 uint32_t(call_site.line()))
+#else
+using global_mutex_type = unprofiled_global_mutex_type;
+using xe_unlikely_mutex = unprofiled_unlikely_mutex_type;
+#define XE_LOCK_CALL_SITE_PARAMETER
+#define XE_LOCK_SET_CALL_SITE() \
+  do {                          \
+  } while (false)
 #endif
 struct null_mutex {
  public:
@@ -140,12 +168,14 @@ class global_critical_region {
   // Use this when keeping an instance is not possible. Otherwise, prefer
   // to keep an instance of global_critical_region near the members requiring
   // it to keep things readable.
-  static global_unique_lock_type AcquireDirect() {
+  static global_unique_lock_type AcquireDirect(XE_LOCK_CALL_SITE_PARAMETER) {
+    XE_LOCK_SET_CALL_SITE();
     return global_unique_lock_type(mutex());
   }
 
   // Acquires a lock on the global critical section.
-  static inline global_unique_lock_type Acquire() {
+  static inline global_unique_lock_type Acquire(XE_LOCK_CALL_SITE_PARAMETER) {
+    XE_LOCK_SET_CALL_SITE();
     return global_unique_lock_type(mutex());
   }
 
@@ -162,11 +192,51 @@ class global_critical_region {
 
   // Tries to acquire a lock on the glboal critical section.
   // Check owns_lock() to see if the lock was successfully acquired.
-  static inline global_unique_lock_type TryAcquire() {
+  static inline global_unique_lock_type TryAcquire(
+      XE_LOCK_CALL_SITE_PARAMETER) {
+    XE_LOCK_SET_CALL_SITE();
     return global_unique_lock_type(mutex(), std::try_to_lock);
   }
 };
 
+using recursive_unique_lock_type = std::unique_lock<xe_recursive_mutex>;
+// A recursive critical region guarding the data of a single subsystem (the
+// object table, the VFS) instead of the whole system, so threads working with
+// different subsystems don't wait for each other on the global critical
+// region.
+//
+// Lock ordering:
+// - The global critical region may be held when acquiring a subsystem region,
+//   but must never be acquired while holding one.
+// - Subsystem regions don't nest, except for the VFS, whose region may be
+//   held when acquiring the region of a device.
+// - Nothing that may acquire the global critical region may be called with a
+//   subsystem region held, including releasing XObjects, which may destroy
+//   them.
+class subsystem_critical_region {
+ public:
+  subsystem_critical_region() = default;
+  subsystem_critical_region(const subsystem_critical_region& region) = delete;
+  subsystem_critical_region& operator=(
+      const subsystem_critical_region& region) = delete;
+
+  xe_recursive_mutex& mutex() { return mutex_; }
+
+  recursive_unique_lock_type Acquire() {
+    return recursive_unique_lock_type(mutex_);
+  }
+  recursive_unique_lock_type AcquireDeferred() {
+    return recursive_unique_lock_type(mutex_, std::defer_lock);
+  }
+  // Check owns_lock() to see if the lock was successfully acquired.
+  recursive_unique_lock_type TryAcquire() {
+    return recursive_unique_lock_type(mutex_, std::try_to_lock);
+  }
+
+ private:
+  xe_recursive_mutex mutex_;
+};
+
 }  // namespace xe
 
 #endif  // XENIA_BASE_MUTEX_H_
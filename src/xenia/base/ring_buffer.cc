@@ -128,4 +128,101 @@ size_t RingBuffer::Write(const uint8_t* buffer, size_t _count) {
   return count;
 }
 
+SpscRingBuffer::SpscRingBuffer(uint8_t* buffer, size_t capacity)
+    : buffer_(buffer), capacity_(static_cast<ring_size_t>(capacity)) {}
+
+ring_size_t SpscRingBuffer::write_count() {
+  // Only the producer writes the write position.
+  uint64_t write_position = write_position_.load(std::memory_order_relaxed);
+  producer_read_position_ = read_position_.load(std::memory_order_acquire);
+  return capacity_ - ring_size_t(write_position - producer_read_position_);
+}
+
+SpscRingBuffer::WriteRange SpscRingBuffer::BeginWrite(size_t _count) {
+  ring_size_t count = static_cast<ring_size_t>(_count);
+  uint64_t write_position = write_position_.load(std::memory_order_relaxed);
+  if (capacity_ - ring_size_t(write_position - producer_read_position_) <
+      count) {
+    producer_read_position_ = read_position_.load(std::memory_order_acquire);
+  }
+  count = std::min(
+      count,
+      capacity_ - ring_size_t(write_position - producer_read_position_));
+  if (!count) {
+    return {};
+  }
+  ring_size_t offset = ring_size_t(write_position % capacity_);
+  if (offset + count <= capacity_) {
+    return {buffer_ + offset, nullptr, count, 0};
+  }
+  ring_size_t left_half = capacity_ - offset;
+  return {buffer_ + offset, buffer_, left_half, count - left_half};
+}
+
+void SpscRingBuffer::EndWrite(size_t count) {
+  uint64_t write_position = write_position_.load(std::memory_order_relaxed);
+  assert_true(write_position + count - producer_read_position_ <= capacity_);
+  write_position_.store(write_position + count, std::memory_order_release);
+}
+
+size_t SpscRingBuffer::Write(const uint8_t* buffer, size_t count) {
+  WriteRange range = BeginWrite(count);
+  if (range.first_length) {
+    std::memcpy(range.first, buffer, range.first_length);
+  }
+  if (range.second) {
+    std::memcpy(range.second, buffer + range.first_length,
+                range.second_length);
+  }
+  size_t written = size_t(range.first_length) + range.second_length;
+  EndWrite(written);
+  return written;
+}
+
+ring_size_t SpscRingBuffer::read_count() {
+  // Only the consumer writes the read position.
+  uint64_t read_position = read_position_.load(std::memory_order_relaxed);
+  consumer_write_position_ = write_position_.load(std::memory_order_acquire);
+  return ring_size_t(consumer_write_position_ - read_position);
+}
+
+RingBuffer::ReadRange SpscRingBuffer::BeginRead(size_t _count) {
+  ring_size_t count = static_cast<ring_size_t>(_count);
+  uint64_t read_position = read_position_.load(std::memory_order_relaxed);
+  if (ring_size_t(consumer_write_position_ - read_position) < count) {
+    consumer_write_position_ = write_position_.load(std::memory_order_acquire);
+  }
+  count =
+      std::min(count, ring_size_t(consumer_write_position_ - read_position));
+  if (!count) {
+    return {};
+  }
+  ring_size_t offset = ring_size_t(read_position % capacity_);
+  if (offset + count <= capacity_) {
+    return {buffer_ + offset, nullptr, count, 0};
+  }
+  ring_size_t left_half = capacity_ - offset;
+  return {buffer_ + offset, buffer_, left_half, count - left_half};
+}
+
+void SpscRingBuffer::EndRead(size_t count) {
+  uint64_t read_position = read_position_.load(std::memory_order_relaxed);
+  assert_true(read_position + count <= consumer_write_position_);
+  read_position_.store(read_position + count, std::memory_order_release);
+}
+
+size_t SpscRingBuffer::Read(uint8_t* buffer, size_t count) {
+  RingBuffer::ReadRange range = BeginRead(count);
+  if (range.first_length) {
+    std::memcpy(buffer, range.first, range.first_length);
+  }
+  if (range.second) {
+    std::memcpy(buffer + range.first_length, range.second,
+                range.second_length);
+  }
+  size_t read = size_t(range.first_length) + range.second_length;
+  EndRead(read);
+  return read;
+}
+
 }  // namespace xe
@@ -10,6 +10,7 @@
 #ifndef XENIA_BASE_RING_BUFFER_H_
 #define XENIA_BASE_RING_BUFFER_H_
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <type_traits>
@@ -190,6 +191,64 @@ inline uint32_t RingBuffer::ReadAndSwap<uint32_t>() {
   uint32_t ring_value = *(uint32_t*)&this->buffer_[read_offset];
   return xe::byte_swap(ring_value);
 }
+
+// Ring buffer shared by exactly one producer thread and one consumer thread
+// without locking. The positions are published with release and observed with
+// acquire ordering, so the data written before EndWrite is visible to the
+// consumer after BeginRead, and the space released by EndRead can be
+// overwritten only after the consumer is done with it. Each side keeps its last
+// view of the other's position on its own cache line, only reloading it when
+// it appears to be out of space or data.
+//
+// The Begin functions return views directly into the buffer, as two ranges if
+// they wrap around, to access the data in place without copying it out
+// first. If the capacity is a multiple of the size of fixed-size elements,
+// the ranges of whole elements never wrap.
+class SpscRingBuffer {
+ public:
+  SpscRingBuffer(uint8_t* buffer, size_t capacity);
+
+  uint8_t* buffer() const { return buffer_; }
+  ring_size_t capacity() const { return capacity_; }
+
+  struct WriteRange {
+    uint8_t* XE_RESTRICT first;
+    uint8_t* XE_RESTRICT second;
+    ring_size_t first_length;
+    ring_size_t second_length;
+  };
+
+  // Producer thread only.
+  // The free space, may be larger by the time this returns.
+  ring_size_t write_count();
+  // Up to count bytes of the free space, less if not enough is free.
+  WriteRange BeginWrite(size_t count);
+  // Publishes count bytes of what BeginWrite has returned.
+  void EndWrite(size_t count);
+  // Copies as much of the data as fits, returning how much has been written.
+  size_t Write(const uint8_t* buffer, size_t count);
+
+  // Consumer thread only.
+  // The data available, may be larger by the time this returns.
+  ring_size_t read_count();
+  // Up to count bytes of the data available, less if not enough is written.
+  RingBuffer::ReadRange BeginRead(size_t count);
+  // Releases count bytes of what BeginRead has returned to the producer.
+  void EndRead(size_t count);
+  // Copies as much of the data as available, returning how much has been read.
+  size_t Read(uint8_t* buffer, size_t count);
+
+ private:
+  uint8_t* const buffer_;
+  const ring_size_t capacity_;
+
+  // Total byte counts written and read, never wrapping around in practice,
+  // which distinguishes a full buffer from an empty one.
+  alignas(XE_HOST_CACHE_LINE_SIZE) std::atomic<uint64_t> write_position_{0};
+  uint64_t producer_read_position_ = 0;
+  alignas(XE_HOST_CACHE_LINE_SIZE) std::atomic<uint64_t> read_position_{0};
+  uint64_t consumer_write_position_ = 0;
+};
 }  // namespace xe
 
 #endif  // XENIA_BASE_RING_BUFFER_H_
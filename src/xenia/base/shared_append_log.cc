@@ -0,0 +1,168 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/shared_append_log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "xenia/base/filesystem.h"
+#include "xenia/base/math.h"
+#include "xenia/base/threading.h"
+#include "xenia/base/xxhash.h"
+
+namespace xe {
+
+namespace {
+
+constexpr uint32_t kMagicInitializing = 1;
+constexpr uint32_t kMagic = 0x4C415358;  // 'XSAL'
+constexpr uint32_t kVersion = 1;
+
+// The file is zero-filled when created, so all fields are initially zero.
+struct LogHeader {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint64_t tag;
+  uint64_t capacity;
+  // Offset from the beginning of the file where the next record will be
+  // placed.
+  std::atomic<uint64_t> tail;
+};
+static_assert(sizeof(LogHeader) <= SharedAppendLog::kFirstRecordOffset);
+
+// The lower 32 bits are the size of the data, set when the record is reserved,
+// kRecordComplete is set once the data and the checksum have been written.
+constexpr uint64_t kRecordReserved = uint64_t(1) << 32;
+constexpr uint64_t kRecordComplete = uint64_t(1) << 33;
+
+struct RecordHeader {
+  std::atomic<uint64_t> state;
+  uint64_t checksum;
+  // Followed by the data, padded to kRecordAlignment.
+};
+constexpr uint64_t kRecordAlignment = 8;
+
+// Mapped by multiple processes, so the atomics must not rely on any locks in
+// the process memory.
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+}  // namespace
+
+std::unique_ptr<SharedAppendLog> SharedAppendLog::Open(
+    const std::filesystem::path& path, uint64_t tag, uint64_t capacity) {
+  if (capacity <= kFirstRecordOffset || capacity % kRecordAlignment) {
+    return nullptr;
+  }
+
+  // Create the file if it doesn't exist, but without truncating it if another
+  // process has just created it.
+  FILE* file = xe::filesystem::OpenFile(path, "ab");
+  if (!file) {
+    return nullptr;
+  }
+  fclose(file);
+  // Mapping with the full capacity extends the file, leaving the new space
+  // zeroed.
+  std::unique_ptr<MappedMemory> mapping = MappedMemory::Open(
+      path, MappedMemory::Mode::kReadWriteShared, 0, size_t(capacity));
+  if (!mapping || mapping->size() < capacity) {
+    return nullptr;
+  }
+
+  auto& header = *reinterpret_cast<LogHeader*>(mapping->data());
+  uint32_t magic = 0;
+  if (header.magic.compare_exchange_strong(magic, kMagicInitializing,
+                                           std::memory_order_acquire)) {
+    header.version = kVersion;
+    header.tag = tag;
+    header.capacity = capacity;
+    header.tail.store(kFirstRecordOffset, std::memory_order_relaxed);
+    header.magic.store(kMagic, std::memory_order_release);
+  } else {
+    // Another process is initializing the header - give up if it has crashed
+    // while doing that.
+    auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while ((magic = header.magic.load(std::memory_order_acquire)) ==
+               kMagicInitializing &&
+           std::chrono::steady_clock::now() < timeout) {
+      xe::threading::Sleep(std::chrono::milliseconds(1));
+    }
+  }
+  if (header.magic.load(std::memory_order_acquire) != kMagic ||
+      header.version != kVersion || header.tag != tag ||
+      header.capacity != capacity) {
+    return nullptr;
+  }
+
+  return std::unique_ptr<SharedAppendLog>(
+      new SharedAppendLog(std::move(mapping), capacity));
+}
+
+bool SharedAppendLog::Append(const void* data, uint32_t size) {
+  uint8_t* base = mapping_->data();
+  auto& header = *reinterpret_cast<LogHeader*>(base);
+  uint64_t record_size =
+      xe::round_up(uint64_t(sizeof(RecordHeader)) + size, kRecordAlignment);
+  // Not reserving the space that doesn't fit, so smaller records can still be
+  // appended after a large one has failed to.
+  uint64_t offset = header.tail.load(std::memory_order_relaxed);
+  do {
+    if (offset > capacity_ || capacity_ - offset < record_size) {
+      return false;
+    }
+  } while (!header.tail.compare_exchange_weak(offset, offset + record_size,
+                                              std::memory_order_relaxed));
+  auto& record_header = *reinterpret_cast<RecordHeader*>(base + offset);
+  // Let the readers skip the record while it's being written.
+  record_header.state.store(kRecordReserved | size, std::memory_order_relaxed);
+  uint8_t* record_data = base + offset + sizeof(RecordHeader);
+  std::memcpy(record_data, data, size);
+  record_header.checksum = XXH3_64bits(record_data, size);
+  record_header.state.store(kRecordReserved | kRecordComplete | size,
+                            std::memory_order_release);
+  return true;
+}
+
+uint64_t SharedAppendLog::Read(
+    uint64_t offset,
+    const std::function<void(const Record& record)>& visitor) const {
+  const uint8_t* base = mapping_->data();
+  const auto& header = *reinterpret_cast<const LogHeader*>(base);
+  uint64_t tail =
+      std::min(header.tail.load(std::memory_order_acquire), capacity_);
+  while (offset < tail && tail - offset >= sizeof(RecordHeader)) {
+    const auto& record_header =
+        *reinterpret_cast<const RecordHeader*>(base + offset);
+    uint64_t state = record_header.state.load(std::memory_order_acquire);
+    if (!(state & kRecordReserved)) {
+      // Reserved, but the writer hasn't stored the size yet.
+      break;
+    }
+    uint32_t size = uint32_t(state);
+    uint64_t record_size =
+        xe::round_up(uint64_t(sizeof(RecordHeader)) + size, kRecordAlignment);
+    if (tail - offset < record_size) {
+      break;
+    }
+    const uint8_t* record_data = base + offset + sizeof(RecordHeader);
+    if ((state & kRecordComplete) &&
+        record_header.checksum == XXH3_64bits(record_data, size)) {
+      visitor(Record{record_data, size});
+    }
+    offset += record_size;
+  }
+  return offset;
+}
+
+}  // namespace xe
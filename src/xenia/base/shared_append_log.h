@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_SHARED_APPEND_LOG_H_
+#define XENIA_BASE_SHARED_APPEND_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+
+#include "xenia/base/mapped_memory.h"
+
+namespace xe {
+
+// Append-only log of records in a file of a fixed capacity, mapped by multiple
+// processes at once, such as multiple emulator instances running the same
+// title, so data one of them produces is usable by the others and by the
+// future launches without each keeping a private copy of the file.
+//
+// Appending is lock-free: space is reserved by atomically advancing the tail
+// of the log, and a record becomes visible to the readers only after its data
+// has been written. Records are never removed - to start over, the file must
+// be deleted while no process has it open.
+class SharedAppendLog {
+ public:
+  struct Record {
+    const uint8_t* data;
+    uint32_t size;
+  };
+
+  // Creates the file if it doesn't exist. Returns nullptr if the file can't
+  // be mapped, or if it has been created with a different tag (a version of
+  // the data format chosen by the user) or capacity.
+  static std::unique_ptr<SharedAppendLog> Open(
+      const std::filesystem::path& path, uint64_t tag, uint64_t capacity);
+
+  uint64_t capacity() const { return capacity_; }
+  // Offset of the first record, for reading the log from the beginning.
+  static constexpr uint64_t kFirstRecordOffset = 64;
+
+  // Callable from any thread of any process. Returns false if the log is full.
+  bool Append(const void* data, uint32_t size);
+
+  // Calls the visitor for the complete records starting at the offset, until
+  // reaching the end of the log, and returns the offset to continue reading
+  // from later to receive the records appended in the meantime. Records still
+  // being written are skipped, as are ones with data not matching the
+  // checksum. The data of the records points into the mapping and stays valid
+  // while the log is open.
+  uint64_t Read(uint64_t offset,
+                const std::function<void(const Record& record)>& visitor) const;
+
+ private:
+  SharedAppendLog(std::unique_ptr<MappedMemory> mapping, uint64_t capacity)
+      : mapping_(std::move(mapping)), capacity_(capacity) {}
+
+  std::unique_ptr<MappedMemory> mapping_;
+  uint64_t capacity_;
+};
+
+}  // namespace xe
+
+#endif  // XENIA_BASE_SHARED_APPEND_LOG_H_
@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/startup_timeline.h"
+
+#include <cstdio>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+
+StartupTimeline::StartupTimeline()
+    : origin_ticks_(Clock::QueryHostTickCount()) {}
+
+double StartupTimeline::GetElapsedMs() const {
+  return double(Clock::QueryHostTickCount() - origin_ticks_) * 1000.0 /
+         double(Clock::QueryHostTickFrequency());
+}
+
+size_t StartupTimeline::BeginStage(std::string name) {
+  double start_ms = GetElapsedMs();
+  std::lock_guard<std::mutex> lock(mutex_);
+  stages_.push_back({std::move(name), xe::threading::current_thread_system_id(),
+                     start_ms, -1.0});
+  return stages_.size() - 1;
+}
+
+void StartupTimeline::EndStage(size_t index) {
+  double end_ms = GetElapsedMs();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index < stages_.size()) {
+    stages_[index].end_ms = end_ms;
+  }
+}
+
+bool StartupTimeline::OnFrameBoundary() {
+  if (first_frame_reached_.load(std::memory_order_relaxed) ||
+      first_frame_reached_.exchange(true, std::memory_order_relaxed)) {
+    return false;
+  }
+  double first_frame_ms = GetElapsedMs();
+  std::lock_guard<std::mutex> lock(mutex_);
+  first_frame_ms_ = first_frame_ms;
+  return true;
+}
+
+double StartupTimeline::first_frame_ms() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return first_frame_ms_;
+}
+
+std::vector<StartupTimeline::Stage> StartupTimeline::GetStages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stages_;
+}
+
+std::string StartupTimeline::FormatReport() const {
+  std::vector<Stage> stages;
+  double first_frame_ms;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages = stages_;
+    first_frame_ms = first_frame_ms_;
+  }
+  std::string report = fmt::format("{:<32} {:>10} {:>10} {:>10} {:>8}\n",
+                                   "Stage", "Start ms", "End ms", "Took ms",
+                                   "Thread");
+  for (const Stage& stage : stages) {
+    if (stage.end_ms < 0.0) {
+      report += fmt::format("{:<32} {:10.1f} {:>10} {:>10} {:8}\n", stage.name,
+                            stage.start_ms, "-", "-", stage.thread_id);
+    } else {
+      report += fmt::format("{:<32} {:10.1f} {:10.1f} {:10.1f} {:8}\n",
+                            stage.name, stage.start_ms, stage.end_ms,
+                            stage.end_ms - stage.start_ms, stage.thread_id);
+    }
+  }
+  if (first_frame_ms >= 0.0) {
+    report += fmt::format("{:<32} {:10.1f}\n", "First frame", first_frame_ms);
+  }
+  return report;
+}
+
+bool StartupTimeline::ExportCsv(const std::filesystem::path& path) const {
+  std::vector<Stage> stages;
+  double first_frame_ms;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages = stages_;
+    first_frame_ms = first_frame_ms_;
+  }
+  FILE* file = xe::filesystem::OpenFile(path, "wb");
+  if (!file) {
+    return false;
+  }
+  std::string line = "stage,thread,start_ms,end_ms\n";
+  fwrite(line.data(), 1, line.size(), file);
+  for (const Stage& stage : stages) {
+    line = fmt::format("{},{},{:.3f},{:.3f}\n", stage.name, stage.thread_id,
+                       stage.start_ms, stage.end_ms);
+    fwrite(line.data(), 1, line.size(), file);
+  }
+  if (first_frame_ms >= 0.0) {
+    line = fmt::format("first_frame,,{:.3f},{:.3f}\n", first_frame_ms,
+                       first_frame_ms);
+    fwrite(line.data(), 1, line.size(), file);
+  }
+  fclose(file);
+  return true;
+}
+
+}  // namespace xe
@@ -0,0 +1,88 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_STARTUP_TIMELINE_H_
+#define XENIA_BASE_STARTUP_TIMELINE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xe {
+
+// Start and end times of the stages of the emulator startup, relative to the
+// creation of the timeline, up to the first frame of the title, for finding
+// what the time to the first frame is spent on. Stages may run on different
+// threads and overlap.
+class StartupTimeline {
+ public:
+  struct Stage {
+    std::string name;
+    uint32_t thread_id;
+    double start_ms;
+    // Negative while the stage is running.
+    double end_ms;
+  };
+
+  class ScopedStage {
+   public:
+    ScopedStage(StartupTimeline* timeline, std::string name)
+        : timeline_(timeline),
+          index_(timeline ? timeline->BeginStage(std::move(name)) : 0) {}
+    ScopedStage(const ScopedStage& scoped_stage) = delete;
+    ScopedStage& operator=(const ScopedStage& scoped_stage) = delete;
+    ~ScopedStage() { End(); }
+
+    void End() {
+      if (timeline_) {
+        timeline_->EndStage(index_);
+        timeline_ = nullptr;
+      }
+    }
+
+   private:
+    StartupTimeline* timeline_;
+    size_t index_;
+  };
+
+  StartupTimeline();
+
+  // Returns the index of the stage to end it with.
+  size_t BeginStage(std::string name);
+  void EndStage(size_t index);
+
+  // Called at every guest frame boundary, from any thread, only the first one
+  // completes the timeline. Returns whether this was the first frame.
+  bool OnFrameBoundary();
+  // Negative before the first frame.
+  double first_frame_ms() const;
+
+  std::vector<Stage> GetStages() const;
+  // Stages in the order they began, with the times as a table for the log.
+  std::string FormatReport() const;
+  bool ExportCsv(const std::filesystem::path& path) const;
+
+ private:
+  double GetElapsedMs() const;
+
+  uint64_t origin_ticks_;
+  std::atomic<bool> first_frame_reached_{false};
+
+  mutable std::mutex mutex_;
+  std::vector<Stage> stages_;
+  double first_frame_ms_ = -1.0;
+};
+
+}  // namespace xe
+
+#endif  // XENIA_BASE_STARTUP_TIMELINE_H_
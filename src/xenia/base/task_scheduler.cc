@@ -0,0 +1,378 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/task_scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/counters.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/profiling.h"
+
+DEFINE_int32(task_scheduler_threads, -1,
+             "Number of worker threads shared by the background work of the "
+             "emulator, such as precompilation, shader translation and CPU "
+             "texture loading. -1 to use one less than the number of logical "
+             "processors, 0 to run the tasks on the threads submitting them.",
+             "General");
+
+namespace xe {
+namespace threading {
+
+namespace {
+
+thread_local const TaskScheduler* current_scheduler = nullptr;
+thread_local uint32_t current_worker_index = TaskScheduler::kAnyWorker;
+
+struct SchedulerCounters {
+  std::array<counters::Counter*, size_t(TaskPriority::kCount)> executed;
+  counters::Counter* stolen;
+};
+
+SchedulerCounters& GetSchedulerCounters() {
+  static SchedulerCounters scheduler_counters = []() {
+    SchedulerCounters result;
+    result.executed[size_t(TaskPriority::kLatencyCritical)] =
+        &counters::GetCounter("tasks/latency_critical/executed");
+    result.executed[size_t(TaskPriority::kNormal)] =
+        &counters::GetCounter("tasks/normal/executed");
+    result.executed[size_t(TaskPriority::kBackground)] =
+        &counters::GetCounter("tasks/background/executed");
+    result.stolen = &counters::GetCounter("tasks/stolen");
+    return result;
+  }();
+  return scheduler_counters;
+}
+
+}  // namespace
+
+TaskScheduler& TaskScheduler::Get() {
+  // Never destroyed, not to depend on the order of destruction of the statics
+  // the tasks may use - the workers exit with the process.
+  static TaskScheduler* scheduler = []() {
+    uint32_t worker_count;
+    if (cvars::task_scheduler_threads < 0) {
+      worker_count = std::max(logical_processor_count(), uint32_t(2)) - 1;
+    } else {
+      worker_count = uint32_t(cvars::task_scheduler_threads);
+    }
+    return new TaskScheduler(worker_count);
+  }();
+  return *scheduler;
+}
+
+TaskScheduler::TaskScheduler(uint32_t worker_count)
+    : max_background_tasks_(std::max((worker_count + 1) / 2, uint32_t(1))) {
+  workers_.reserve(worker_count);
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    Worker& worker = *workers_[i];
+    worker.name = fmt::format("Task Worker {}", i);
+    worker.thread = Thread::Create({}, [this, i]() { WorkerThread(i); });
+    if (!worker.thread) {
+      XELOGE("TaskScheduler: Failed to create worker thread {}", i);
+      // The queue of the worker is still taken from by the others.
+      continue;
+    }
+    worker.thread->set_name(worker.name);
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    shutdown_ = true;
+  }
+  sleep_cond_.notify_all();
+  for (const std::unique_ptr<Worker>& worker : workers_) {
+    if (worker->thread) {
+      Wait(worker->thread.get(), false);
+    }
+  }
+}
+
+uint32_t TaskScheduler::GetCurrentWorkerIndex() const {
+  return current_scheduler == this ? current_worker_index : kAnyWorker;
+}
+
+void TaskScheduler::Submit(Task task, TaskPriority priority,
+                           uint32_t affinity_worker) {
+  Enqueue({std::move(task), nullptr}, priority, affinity_worker);
+}
+
+void TaskScheduler::ParallelFor(
+    uint32_t count, const std::function<void(uint32_t index)>& function,
+    TaskPriority priority, uint32_t max_concurrency) {
+  uint32_t thread_count =
+      std::min({count, worker_count() + 1, std::max(max_concurrency, 1u)});
+  if (thread_count <= 1) {
+    for (uint32_t i = 0; i < count; ++i) {
+      function(i);
+    }
+    return;
+  }
+  std::atomic<uint32_t> next_index{0};
+  auto run = [&]() {
+    uint32_t index;
+    while ((index = next_index.fetch_add(1, std::memory_order_relaxed)) <
+           count) {
+      function(index);
+    }
+  };
+  TaskGroup group(*this);
+  for (uint32_t i = 1; i < thread_count; ++i) {
+    group.Submit(run, priority);
+  }
+  // Take part in the work instead of only waiting - the helpers that haven't
+  // started by the time all indices are taken return immediately.
+  run();
+  group.Wait();
+}
+
+void TaskScheduler::Enqueue(QueuedTask&& task, TaskPriority priority,
+                            uint32_t affinity_worker) {
+  if (workers_.empty()) {
+    RunTask(task, priority, false);
+    return;
+  }
+  uint32_t worker_index;
+  if (affinity_worker != kAnyWorker) {
+    worker_index = affinity_worker % worker_count();
+  } else {
+    worker_index = GetCurrentWorkerIndex();
+    if (worker_index == kAnyWorker) {
+      worker_index = next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                     worker_count();
+    }
+  }
+  {
+    Worker& worker = *workers_[worker_index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.queues[size_t(priority)].push_back(std::move(task));
+  }
+  queued_counts_[size_t(priority)].fetch_add(1, std::memory_order_release);
+  NotifyTaskAvailable();
+}
+
+bool TaskScheduler::TakeTask(uint32_t worker_index, const TaskGroup* group,
+                             QueuedTask& task_out, TaskPriority& priority_out,
+                             bool& background_slot_out) {
+  uint32_t count = worker_count();
+  for (uint32_t i = 0; i < uint32_t(TaskPriority::kCount); ++i) {
+    if (!queued_counts_[i].load(std::memory_order_acquire)) {
+      continue;
+    }
+    auto priority = TaskPriority(i);
+    // Waiting for a group is not limited, the waiting thread would be idle
+    // otherwise.
+    bool background_slot = priority == TaskPriority::kBackground && !group;
+    if (background_slot &&
+        running_background_tasks_.fetch_add(1, std::memory_order_relaxed) >=
+            max_background_tasks_) {
+      running_background_tasks_.fetch_sub(1, std::memory_order_relaxed);
+      continue;
+    }
+    bool found = worker_index != kAnyWorker &&
+                 PopTask(*workers_[worker_index], priority, true, group,
+                         task_out);
+    if (!found) {
+      uint32_t first_victim = worker_index != kAnyWorker ? worker_index + 1
+                              : next_worker_.load(std::memory_order_relaxed);
+      for (uint32_t j = 0; j < count; ++j) {
+        uint32_t victim_index = (first_victim + j) % count;
+        if (victim_index == worker_index) {
+          continue;
+        }
+        if (PopTask(*workers_[victim_index], priority, false, group,
+                    task_out)) {
+          found = true;
+          if (worker_index != kAnyWorker) {
+            GetSchedulerCounters().stolen->Increment();
+          }
+          break;
+        }
+      }
+    }
+    if (found) {
+      priority_out = priority;
+      background_slot_out = background_slot;
+      return true;
+    }
+    if (background_slot) {
+      running_background_tasks_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+  return false;
+}
+
+bool TaskScheduler::PopTask(Worker& worker, TaskPriority priority,
+                            bool newest, const TaskGroup* group,
+                            QueuedTask& task_out) {
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  std::deque<QueuedTask>& queue = worker.queues[size_t(priority)];
+  if (queue.empty()) {
+    return false;
+  }
+  if (group) {
+    auto it = std::find_if(
+        queue.begin(), queue.end(),
+        [group](const QueuedTask& task) { return task.group == group; });
+    if (it == queue.end()) {
+      return false;
+    }
+    task_out = std::move(*it);
+    queue.erase(it);
+  } else if (newest) {
+    task_out = std::move(queue.back());
+    queue.pop_back();
+  } else {
+    task_out = std::move(queue.front());
+    queue.pop_front();
+  }
+  queued_counts_[size_t(priority)].fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool TaskScheduler::HasRunnableTasks() const {
+  if (queued_counts_[size_t(TaskPriority::kLatencyCritical)].load(
+          std::memory_order_acquire) ||
+      queued_counts_[size_t(TaskPriority::kNormal)].load(
+          std::memory_order_acquire)) {
+    return true;
+  }
+  return queued_counts_[size_t(TaskPriority::kBackground)].load(
+             std::memory_order_acquire) &&
+         running_background_tasks_.load(std::memory_order_relaxed) <
+             max_background_tasks_;
+}
+
+void TaskScheduler::NotifyTaskAvailable() {
+  bool group_waiters;
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    group_waiters = group_waiter_count_ != 0;
+  }
+  // The threads waiting for groups share the condition variable, and may take
+  // the notification meant for a worker.
+  if (group_waiters) {
+    sleep_cond_.notify_all();
+  } else {
+    sleep_cond_.notify_one();
+  }
+}
+
+void TaskScheduler::RunTask(QueuedTask& task, TaskPriority priority,
+                            bool background_slot) {
+  switch (priority) {
+    case TaskPriority::kLatencyCritical: {
+      SCOPE_profile_cpu_i("task_scheduler", "LatencyCriticalTask");
+      task.function();
+    } break;
+    case TaskPriority::kNormal: {
+      SCOPE_profile_cpu_i("task_scheduler", "NormalTask");
+      task.function();
+    } break;
+    default: {
+      SCOPE_profile_cpu_i("task_scheduler", "BackgroundTask");
+      task.function();
+    } break;
+  }
+  // Release what the task has captured before letting the group waiter
+  // proceed.
+  task.function = nullptr;
+  GetSchedulerCounters().executed[size_t(priority)]->Increment();
+  if (background_slot) {
+    running_background_tasks_.fetch_sub(1, std::memory_order_relaxed);
+    if (queued_counts_[size_t(TaskPriority::kBackground)].load(
+            std::memory_order_acquire)) {
+      NotifyTaskAvailable();
+    }
+  }
+  if (task.group) {
+    // The group may be destroyed as soon as it's done.
+    if (task.group->pending_count_.fetch_sub(1, std::memory_order_acq_rel) ==
+        1) {
+      OnGroupDone();
+    }
+  }
+}
+
+void TaskScheduler::OnGroupDone() {
+  bool group_waiters;
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    group_waiters = group_waiter_count_ != 0;
+  }
+  if (group_waiters) {
+    sleep_cond_.notify_all();
+  }
+}
+
+void TaskScheduler::WorkerThread(uint32_t worker_index) {
+  current_scheduler = this;
+  current_worker_index = worker_index;
+  Profiler::ThreadEnter(workers_[worker_index]->name.c_str());
+  while (true) {
+    QueuedTask task;
+    TaskPriority priority;
+    bool background_slot;
+    if (TakeTask(worker_index, nullptr, task, priority, background_slot)) {
+      RunTask(task, priority, background_slot);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleep_cond_.wait(lock,
+                     [this]() { return shutdown_ || HasRunnableTasks(); });
+    if (shutdown_) {
+      break;
+    }
+  }
+  Profiler::ThreadExit();
+}
+
+void TaskGroup::Submit(TaskScheduler::Task task, TaskPriority priority,
+                       uint32_t affinity_worker) {
+  pending_count_.fetch_add(1, std::memory_order_relaxed);
+  scheduler_.Enqueue({std::move(task), this}, priority, affinity_worker);
+  submitted_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TaskGroup::Wait() {
+  uint32_t worker_index = scheduler_.GetCurrentWorkerIndex();
+  while (!is_done()) {
+    TaskScheduler::QueuedTask task;
+    TaskPriority priority;
+    bool background_slot;
+    if (scheduler_.TakeTask(worker_index, this, task, priority,
+                            background_slot)) {
+      scheduler_.RunTask(task, priority, background_slot);
+      continue;
+    }
+    // The remaining tasks are running on other threads, wait for them, or for
+    // them to submit more tasks to the group.
+    uint32_t submitted_count =
+        submitted_count_.load(std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(scheduler_.sleep_mutex_);
+    ++scheduler_.group_waiter_count_;
+    scheduler_.sleep_cond_.wait(lock, [this, submitted_count]() {
+      return is_done() || submitted_count_.load(std::memory_order_relaxed) !=
+                              submitted_count;
+    });
+    --scheduler_.group_waiter_count_;
+  }
+}
+
+}  // namespace threading
+}  // namespace xe
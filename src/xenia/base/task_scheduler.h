@@ -0,0 +1,171 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_TASK_SCHEDULER_H_
+#define XENIA_BASE_TASK_SCHEDULER_H_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace threading {
+
+enum class TaskPriority : uint32_t {
+  // Work a thread is blocked on right now, such as the texture loads of the
+  // current draw.
+  kLatencyCritical,
+  kNormal,
+  // Work done ahead of time that nothing is waiting for yet, such as
+  // precompilation. Runs on up to half of the workers at once, so the rest
+  // stay available for the more urgent tasks.
+  kBackground,
+
+  kCount,
+};
+
+class TaskGroup;
+
+// Shared pool of worker threads for the parallel work of all the subsystems,
+// so they don't oversubscribe the host processors with a pool each.
+//
+// Every worker has a queue of its own per priority. Tasks submitted from a
+// worker go to its queue, others are distributed between the workers, unless
+// an affinity hint names the worker. Workers run the tasks of their own queue
+// from the most recently submitted, and when it's empty, steal the oldest
+// tasks from the queues of the other workers. Higher priority tasks are always
+// taken first, but running tasks are never preempted.
+//
+// Tasks must not block on work that is not itself submitted as a task of a
+// group being waited for, as that may take all the workers.
+class TaskScheduler {
+ public:
+  using Task = std::function<void()>;
+
+  static constexpr uint32_t kAnyWorker = UINT32_MAX;
+
+  // Created on the first use with task_scheduler_threads workers.
+  static TaskScheduler& Get();
+
+  explicit TaskScheduler(uint32_t worker_count);
+  TaskScheduler(const TaskScheduler& scheduler) = delete;
+  TaskScheduler& operator=(const TaskScheduler& scheduler) = delete;
+  // Stops after the tasks being run, dropping the ones still queued. The users
+  // must wait for their task groups before that.
+  ~TaskScheduler();
+
+  uint32_t worker_count() const { return uint32_t(workers_.size()); }
+  // The index of the worker of this scheduler running on the calling thread,
+  // kAnyWorker if it's not one of its workers.
+  uint32_t GetCurrentWorkerIndex() const;
+
+  // Runs the task on one of the workers. The affinity worker index, if not
+  // kAnyWorker, is a hint to keep related tasks on the same thread, and is
+  // taken modulo the worker count.
+  void Submit(Task task, TaskPriority priority = TaskPriority::kNormal,
+              uint32_t affinity_worker = kAnyWorker);
+
+  // Calls the function for every index from 0 to count - 1 on up to
+  // max_concurrency threads, including the calling one, and returns when all
+  // of them are done.
+  void ParallelFor(uint32_t count,
+                   const std::function<void(uint32_t index)>& function,
+                   TaskPriority priority = TaskPriority::kNormal,
+                   uint32_t max_concurrency = UINT32_MAX);
+
+ private:
+  friend class TaskGroup;
+
+  struct QueuedTask {
+    Task function;
+    TaskGroup* group;
+  };
+  struct Worker {
+    std::string name;
+    std::mutex mutex;
+    std::array<std::deque<QueuedTask>, size_t(TaskPriority::kCount)> queues;
+    std::unique_ptr<Thread> thread;
+  };
+
+  void Enqueue(QueuedTask&& task, TaskPriority priority,
+               uint32_t affinity_worker);
+  // Takes a task from the worker's own queue, if called on a worker, or
+  // steals it from the others. If the group is not null, only takes the tasks
+  // of it. For background tasks taken by the workers, reserves one of the
+  // background slots, to be released by RunTask.
+  bool TakeTask(uint32_t worker_index, const TaskGroup* group,
+                QueuedTask& task_out, TaskPriority& priority_out,
+                bool& background_slot_out);
+  bool PopTask(Worker& worker, TaskPriority priority, bool newest,
+               const TaskGroup* group, QueuedTask& task_out);
+  // With the sleep mutex locked.
+  bool HasRunnableTasks() const;
+  void NotifyTaskAvailable();
+  void RunTask(QueuedTask& task, TaskPriority priority, bool background_slot);
+  void OnGroupDone();
+  void WorkerThread(uint32_t worker_index);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  uint32_t max_background_tasks_;
+
+  std::array<std::atomic<uint32_t>, size_t(TaskPriority::kCount)>
+      queued_counts_ = {};
+  std::atomic<uint32_t> running_background_tasks_{0};
+  std::atomic<uint32_t> next_worker_{0};
+
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cond_;
+  // Protected with sleep_mutex_.
+  uint32_t group_waiter_count_ = 0;
+  bool shutdown_ = false;
+};
+
+// Tasks that can be waited for together. Waiting runs the queued tasks of the
+// group on the calling thread, so groups may be waited for in tasks too.
+class TaskGroup {
+ public:
+  explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::Get())
+      : scheduler_(scheduler) {}
+  TaskGroup(const TaskGroup& group) = delete;
+  TaskGroup& operator=(const TaskGroup& group) = delete;
+  ~TaskGroup() { Wait(); }
+
+  TaskScheduler& scheduler() const { return scheduler_; }
+
+  void Submit(TaskScheduler::Task task,
+              TaskPriority priority = TaskPriority::kNormal,
+              uint32_t affinity_worker = TaskScheduler::kAnyWorker);
+  bool is_done() const {
+    return !pending_count_.load(std::memory_order_acquire);
+  }
+  // Returns when all the tasks submitted so far are done.
+  void Wait();
+
+ private:
+  friend class TaskScheduler;
+
+  TaskScheduler& scheduler_;
+  std::atomic<uint32_t> pending_count_{0};
+  // For waking up the waiters when the tasks submit more tasks to the group.
+  std::atomic<uint32_t> submitted_count_{0};
+};
+
+}  // namespace threading
+}  // namespace xe
+
+#endif  // XENIA_BASE_TASK_SCHEDULER_H_
@@ -0,0 +1,55 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/benchmark.h"
+
+#include <string>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+TEST_CASE("Benchmark frame time percentiles", "[benchmark]") {
+  std::vector<double> values;
+  REQUIRE(Benchmark::GetPercentile(values, 50.0) == 0.0);
+  for (int i = 1; i <= 100; ++i) {
+    values.push_back(double(i));
+  }
+  REQUIRE(Benchmark::GetPercentile(values, 0.0) == 1.0);
+  REQUIRE(Benchmark::GetPercentile(values, 50.0) == 50.0);
+  REQUIRE(Benchmark::GetPercentile(values, 99.0) == 99.0);
+  REQUIRE(Benchmark::GetPercentile(values, 100.0) == 100.0);
+}
+
+TEST_CASE("Benchmark counts frames after the first boundary",
+          "[benchmark]") {
+  xe::counters::Counter& hits_counter =
+      xe::counters::GetCounter("test/benchmark/hits");
+  xe::counters::Counter& misses_counter =
+      xe::counters::GetCounter("test/benchmark/misses");
+  hits_counter.Increment(100);
+
+  Benchmark benchmark(2);
+  REQUIRE(!benchmark.OnFrameBoundary());
+  hits_counter.Increment(3);
+  misses_counter.Increment(1);
+  REQUIRE(!benchmark.OnFrameBoundary());
+  REQUIRE(benchmark.OnFrameBoundary());
+  REQUIRE(benchmark.is_complete());
+  REQUIRE(!benchmark.OnFrameBoundary());
+
+  std::string json = benchmark.FormatReportJson();
+  REQUIRE(json.find("\"frames\": 2") != std::string::npos);
+  REQUIRE(json.find("\"test/benchmark\": 0.750000") != std::string::npos);
+  // Only the increments during the measured frames.
+  REQUIRE(json.find("\"test/benchmark/hits\": 3") != std::string::npos);
+}
+
+}  // namespace xe::base::test
@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/bit_stream.h"
+
+#include <array>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+std::array<uint8_t, 64> MakeTestBuffer() {
+  std::array<uint8_t, 64> buffer;
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    buffer[i] = uint8_t(i * 37 + 11);
+  }
+  return buffer;
+}
+
+TEST_CASE("BitReader reads like BitStream", "[bit_stream]") {
+  auto buffer = MakeTestBuffer();
+  size_t size_bits = buffer.size() * 8;
+  for (size_t num_bits = 1; num_bits <= 57; ++num_bits) {
+    BitStream stream(buffer.data(), size_bits);
+    BitReader reader(buffer.data(), size_bits);
+    while (stream.BitsRemaining() >= num_bits) {
+      REQUIRE(reader.Peek(num_bits) == stream.Peek(num_bits));
+      REQUIRE(reader.Read(num_bits) == stream.Read(num_bits));
+      REQUIRE(reader.offset_bits() == stream.offset_bits());
+    }
+  }
+  // Seeking backwards out of the window.
+  BitStream stream(buffer.data(), size_bits);
+  BitReader reader(buffer.data(), size_bits);
+  const size_t offsets[] = {300, 5, 480, 479, 64, 0, size_bits - 15};
+  for (size_t offset : offsets) {
+    stream.SetOffset(offset);
+    reader.SetOffset(offset);
+    REQUIRE(reader.Peek(15) == stream.Peek(15));
+  }
+}
+
+TEST_CASE("BitReader reads multiple fields", "[bit_stream]") {
+  auto buffer = MakeTestBuffer();
+  BitStream stream(buffer.data(), buffer.size() * 8);
+  BitReader reader(buffer.data(), buffer.size() * 8);
+  reader.SetOffset(3);
+  stream.SetOffset(3);
+  const uint8_t widths[] = {6, 15, 3, 8, 57, 40, 1};
+  uint64_t values[std::size(widths)];
+  reader.ReadBits(widths, values, std::size(widths));
+  for (size_t i = 0; i < std::size(widths); ++i) {
+    REQUIRE(values[i] == stream.Read(widths[i]));
+  }
+  REQUIRE(reader.offset_bits() == stream.offset_bits());
+}
+
+}  // namespace xe::base::test
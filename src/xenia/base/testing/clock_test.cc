@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/clock.h"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+TEST_CASE("Guest ticks are continuous across time scalar changes",
+          "[clock]") {
+  cvars::clock_no_scaling = false;
+  Clock::set_guest_time_scalar(1.0);
+  uint64_t last_tick_count = Clock::QueryGuestTickCount();
+  bool monotonic = true;
+  for (double scalar : {2.0, 0.5, 1.0}) {
+    Clock::set_guest_time_scalar(scalar);
+    uint64_t tick_count = Clock::QueryGuestTickCount();
+    monotonic &= tick_count >= last_tick_count;
+    last_tick_count = tick_count;
+  }
+  REQUIRE(monotonic);
+
+  // The tick rate follows the scalar.
+  using namespace std::chrono_literals;
+  Clock::set_guest_time_scalar(2.0);
+  uint64_t host_start = Clock::QueryHostTickCount();
+  uint64_t guest_start = Clock::QueryGuestTickCount();
+  std::this_thread::sleep_for(50ms);
+  uint64_t guest_end = Clock::QueryGuestTickCount();
+  uint64_t host_end = Clock::QueryHostTickCount();
+  Clock::set_guest_time_scalar(1.0);
+  double host_seconds = double(host_end - host_start) /
+                        double(Clock::QueryHostTickFrequency());
+  double guest_seconds =
+      double(guest_end - guest_start) / double(Clock::guest_tick_frequency());
+  REQUIRE(guest_seconds / host_seconds == Approx(2.0).epsilon(0.05));
+}
+
+TEST_CASE("Locked guest ticks only move when advanced", "[clock]") {
+  cvars::clock_no_scaling = false;
+  using namespace std::chrono_literals;
+  Clock::set_guest_tick_count_locked(true);
+  uint64_t locked_tick_count = Clock::QueryGuestTickCount();
+  std::this_thread::sleep_for(20ms);
+  REQUIRE(Clock::QueryGuestTickCount() == locked_tick_count);
+  Clock::AdvanceLockedGuestTickCount(1000);
+  REQUIRE(Clock::QueryGuestTickCount() == locked_tick_count + 1000);
+  Clock::set_guest_tick_count_locked(false);
+  std::this_thread::sleep_for(20ms);
+  REQUIRE(Clock::QueryGuestTickCount() > locked_tick_count + 1000);
+}
+
+}  // namespace xe::base::test
@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/counters.h"
+
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+TEST_CASE("Counter increments from multiple threads", "[counters]") {
+  xe::counters::Counter& counter =
+      xe::counters::GetCounter("test/counters/multithreaded");
+  uint64_t initial_value = counter.Read();
+  constexpr uint32_t kThreadCount = 8;
+  constexpr uint32_t kIncrementCount = 10000;
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < kThreadCount; ++i) {
+    threads.emplace_back([&counter]() {
+      for (uint32_t j = 0; j < kIncrementCount; ++j) {
+        counter.Increment();
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  REQUIRE(counter.Read() - initial_value == kThreadCount * kIncrementCount);
+}
+
+TEST_CASE("Metrics are shared by name", "[counters]") {
+  xe::counters::Counter& counter_a = xe::counters::GetCounter("test/shared");
+  xe::counters::Counter& counter_b = xe::counters::GetCounter("test/shared");
+  REQUIRE(&counter_a == &counter_b);
+  // Counters and gauges are separate namespaces.
+  xe::counters::Gauge& gauge = xe::counters::GetGauge("test/shared");
+  gauge.Set(5);
+  gauge.Add(-2);
+  REQUIRE(gauge.Read() == 3);
+}
+
+TEST_CASE("Snapshot JSON format", "[counters]") {
+  std::vector<xe::counters::Sample> samples = {
+      {"a/count", false, 7},
+      {"b/level", true, -1},
+  };
+  REQUIRE(xe::counters::FormatSnapshotJson(samples, 42) ==
+          "{\"time_ms\":42,\"counters\":{\"a/count\":7},"
+          "\"gauges\":{\"b/level\":-1}}");
+}
+
+}  // namespace xe::base::test
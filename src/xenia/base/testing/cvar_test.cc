@@ -0,0 +1,52 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/cvar.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+DEFINE_uint32(cvar_test_value, 1, "Test variable.", "Testing");
+DEFINE_uint32(cvar_test_other_value, 1, "Test variable.", "Testing");
+
+namespace xe::base::test {
+
+TEST_CASE("CVar changes notify the subscribers", "[cvar]") {
+  uint32_t notification_count = 0;
+  uint32_t notified_value = 0;
+  cvar::ChangeSubscription subscription = cvar::SubscribeToChanges(
+      {&cvars::cvar_test_value}, [&notification_count, &notified_value]() {
+        ++notification_count;
+        notified_value = cvars::cvar_test_value;
+      });
+  REQUIRE(subscription);
+
+  uint64_t version = cvar::GetChangeVersion();
+  OVERRIDE_uint32(cvar_test_value, 2);
+  REQUIRE(notification_count == 1);
+  REQUIRE(notified_value == 2);
+  REQUIRE(cvar::GetChangeVersion() != version);
+
+  // Not changed.
+  version = cvar::GetChangeVersion();
+  OVERRIDE_uint32(cvar_test_value, 2);
+  REQUIRE(notification_count == 1);
+  REQUIRE(cvar::GetChangeVersion() == version);
+
+  // Not subscribed to.
+  OVERRIDE_uint32(cvar_test_other_value, 2);
+  REQUIRE(notification_count == 1);
+  REQUIRE(cvar::GetChangeVersion() != version);
+
+  subscription.Reset();
+  REQUIRE_FALSE(subscription);
+  OVERRIDE_uint32(cvar_test_value, 3);
+  REQUIRE(notification_count == 1);
+}
+
+}  // namespace xe::base::test
@@ -0,0 +1,127 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/epoch.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+TEST_CASE("Retired functions wait for readers", "[epoch]") {
+  EpochDomain domain;
+  bool destroyed = false;
+  domain.Retire([&destroyed]() { destroyed = true; });
+  REQUIRE(destroyed);
+
+  destroyed = false;
+  {
+    EpochDomain::Reader reader(domain);
+    REQUIRE(reader.is_pinned());
+    {
+      // Nested readers don't unpin the outer one.
+      EpochDomain::Reader nested_reader(domain);
+    }
+    domain.Retire([&destroyed]() { destroyed = true; });
+    REQUIRE_FALSE(destroyed);
+    REQUIRE(domain.retired_count() == 1);
+  }
+  REQUIRE(destroyed);
+  REQUIRE(domain.retired_count() == 0);
+}
+
+TEST_CASE("Retiring without reclaiming defers the function", "[epoch]") {
+  EpochDomain domain;
+  bool destroyed = false;
+  domain.Retire([&destroyed]() { destroyed = true; }, false);
+  REQUIRE_FALSE(destroyed);
+  REQUIRE(domain.retired_count() == 1);
+  domain.Reclaim();
+  REQUIRE(destroyed);
+  REQUIRE(domain.retired_count() == 0);
+}
+
+TEST_CASE("Readers entering after retirement don't block it", "[epoch]") {
+  EpochDomain domain;
+  std::atomic<bool> destroyed{false};
+  std::atomic<bool> later_reader_pinned{false};
+  std::atomic<bool> release_later_reader{false};
+  std::thread later_reader_thread;
+  {
+    EpochDomain::Reader reader(domain);
+    domain.Retire([&destroyed]() { destroyed = true; });
+    later_reader_thread = std::thread([&]() {
+      EpochDomain::Reader later_reader(domain);
+      later_reader_pinned = true;
+      while (!release_later_reader) {
+        std::this_thread::yield();
+      }
+    });
+    while (!later_reader_pinned) {
+      std::this_thread::yield();
+    }
+    REQUIRE_FALSE(destroyed);
+  }
+  // Only the reader that was there before the retirement is waited for.
+  REQUIRE(destroyed);
+  release_later_reader = true;
+  later_reader_thread.join();
+}
+
+TEST_CASE("Objects aren't destroyed while readers access them", "[epoch]") {
+  struct Object {
+    std::atomic<bool> alive{true};
+  };
+  EpochDomain domain;
+  // Kept allocated to the end to check the flag instead of crashing.
+  std::vector<std::unique_ptr<Object>> objects;
+  constexpr uint32_t kObjectCount = 2000;
+  for (uint32_t i = 0; i < kObjectCount; ++i) {
+    objects.push_back(std::make_unique<Object>());
+  }
+  std::atomic<Object*> current{objects[0].get()};
+  std::atomic<bool> stop{false};
+  std::atomic<uint32_t> failures{0};
+
+  std::vector<std::thread> reader_threads;
+  for (uint32_t i = 0; i < 4; ++i) {
+    reader_threads.emplace_back([&]() {
+      while (!stop.load(std::memory_order_relaxed)) {
+        EpochDomain::Reader reader(domain);
+        Object* object = current.load(std::memory_order_acquire);
+        for (uint32_t j = 0; j < 16; ++j) {
+          if (!object->alive.load(std::memory_order_relaxed)) {
+            failures.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      }
+    });
+  }
+  for (uint32_t i = 1; i < kObjectCount; ++i) {
+    Object* old_object = current.exchange(objects[i].get());
+    domain.Retire([old_object]() {
+      old_object->alive.store(false, std::memory_order_relaxed);
+    });
+  }
+  stop = true;
+  for (std::thread& thread : reader_threads) {
+    thread.join();
+  }
+  domain.Reclaim();
+  REQUIRE(failures == 0);
+  REQUIRE(domain.retired_count() == 0);
+  REQUIRE_FALSE(objects[0]->alive);
+  REQUIRE(objects[kObjectCount - 1]->alive);
+}
+
+}  // namespace xe::base::test
@@ -0,0 +1,53 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/frame_timeline.h"
+
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+TEST_CASE("Frame timeline component deltas", "[frame_timeline]") {
+  xe::counters::Counter& outer_counter =
+      xe::counters::GetCounter("test/frame_timeline/outer_us");
+  xe::counters::Counter& inner_counter =
+      xe::counters::GetCounter("test/frame_timeline/inner_us");
+  FrameTimeline timeline({
+      {"Outer", "test/frame_timeline/outer_us", "test/frame_timeline/inner_us"},
+      {"Inner", "test/frame_timeline/inner_us", ""},
+  });
+  REQUIRE(timeline.component_count() == 2);
+  REQUIRE(timeline.component_label(1) == "Inner");
+
+  std::vector<float> durations_ms;
+  std::vector<float> component_times_ms;
+  // The first boundary only starts the first frame.
+  outer_counter.Increment(1000);
+  timeline.OnFrameBoundary();
+  timeline.GetHistory(durations_ms, component_times_ms);
+  REQUIRE(durations_ms.empty());
+
+  outer_counter.Increment(3000);
+  inner_counter.Increment(1000);
+  timeline.OnFrameBoundary();
+  // More nested time than outer time is clamped.
+  inner_counter.Increment(500);
+  timeline.OnFrameBoundary();
+  timeline.GetHistory(durations_ms, component_times_ms);
+  REQUIRE(durations_ms.size() == 2);
+  REQUIRE(component_times_ms.size() == 4);
+  REQUIRE(component_times_ms[0] == Approx(2.0f));
+  REQUIRE(component_times_ms[1] == Approx(1.0f));
+  REQUIRE(component_times_ms[2] == Approx(0.0f));
+  REQUIRE(component_times_ms[3] == Approx(0.5f));
+}
+
+}  // namespace xe::base::test
@@ -0,0 +1,55 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/lock_profiler.h"
+
+#include <mutex>
+#include <string>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+using xe::lock_profiler::Histogram;
+using xe::lock_profiler::LockKind;
+
+TEST_CASE("Lock histogram buckets durations by powers of two",
+          "[lock_profiler]") {
+  Histogram histogram;
+  REQUIRE(histogram.GetPercentileNs(50.0) == 0);
+  histogram.Add(0);
+  histogram.Add(3);
+  histogram.Add(1000);
+  REQUIRE(histogram.count() == 3);
+  REQUIRE(histogram.total_ns() == 1003);
+  REQUIRE(histogram.bucket(0) == 1);
+  REQUIRE(histogram.bucket(2) == 1);
+  REQUIRE(histogram.bucket(10) == 1);
+  REQUIRE(histogram.GetPercentileNs(50.0) == 4);
+  REQUIRE(histogram.GetPercentileNs(100.0) == 1024);
+  // Beyond the last bucket.
+  histogram.Add(UINT64_MAX / 2);
+  REQUIRE(histogram.bucket(Histogram::kBucketCount - 1) == 1);
+}
+
+TEST_CASE("Profiled mutex acquisitions appear in the report",
+          "[lock_profiler]") {
+  xe::lock_profiler::ProfiledMutex<std::recursive_mutex, LockKind::kUnlikely>
+      mutex;
+  xe::lock_profiler::SetNextCallSite("lock_profiler_test_site.cc", 42);
+  {
+    std::lock_guard<decltype(mutex)> lock(mutex);
+    // The call site only applies to the next acquisition.
+    std::lock_guard<decltype(mutex)> recursive_lock(mutex);
+  }
+  std::string report = xe::lock_profiler::FormatReport();
+  REQUIRE(report.find("lock_profiler_test_site.cc:42") != std::string::npos);
+}
+
+}  // namespace xe::base::test
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/logging.h"
+
+#include <string>
+#include <string_view>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+using xe::logging::internal::DeferredLineWriter;
+using xe::logging::internal::FormatDeferredLine;
+using xe::logging::internal::IsDeferrableArg;
+
+template <typename... Args>
+std::string FormatDeferred(std::string_view format, const Args&... args) {
+  char buffer[1024];
+  DeferredLineWriter writer(buffer, sizeof(buffer));
+  REQUIRE(writer.WriteFormat(format));
+  REQUIRE((writer.WriteArg(args) && ...));
+  std::string text;
+  REQUIRE(FormatDeferredLine(buffer, writer.size(), text));
+  return text;
+}
+
+TEST_CASE("Deferred log lines format like immediate ones", "[logging]") {
+  std::string str = "string";
+  std::string_view view = "view";
+  const char* c_str = "c string";
+  int8_t i8 = -8;
+  uint16_t u16 = 0xBEEF;
+  int32_t i32 = -123456;
+  uint64_t u64 = 0x123456789ABCDEF0;
+  REQUIRE(FormatDeferred("{} {} {} {}", str, view, c_str, "literal") ==
+          fmt::format("{} {} {} {}", str, view, c_str, "literal"));
+  REQUIRE(FormatDeferred("{} {:04X} {:08X} {:X}", i8, u16, i32, u64) ==
+          fmt::format("{} {:04X} {:08X} {:X}", i8, u16, i32, u64));
+  REQUIRE(FormatDeferred("{} {} {:.3f} {} {}", 0.1f, 0.1, 2.5, true, 'c') ==
+          fmt::format("{} {} {:.3f} {} {}", 0.1f, 0.1, 2.5, true, 'c'));
+  const void* pointer = &str;
+  REQUIRE(FormatDeferred("{}", pointer) == fmt::format("{}", pointer));
+}
+
+TEST_CASE("Deferred log lines reject what can't be deferred", "[logging]") {
+  REQUIRE_FALSE(IsDeferrableArg<std::u16string>());
+  REQUIRE_FALSE(IsDeferrableArg<char16_t>());
+  REQUIRE(IsDeferrableArg<char[5]>());
+
+  char small_buffer[8];
+  DeferredLineWriter writer(small_buffer, sizeof(small_buffer));
+  REQUIRE_FALSE(writer.WriteFormat("longer than the buffer"));
+
+  // Truncated data.
+  char buffer[64];
+  DeferredLineWriter truncated_writer(buffer, sizeof(buffer));
+  REQUIRE(truncated_writer.WriteFormat("{}"));
+  REQUIRE(truncated_writer.WriteArg(uint32_t(1)));
+  std::string text;
+  REQUIRE_FALSE(FormatDeferredLine(buffer, truncated_writer.size() - 1, text));
+  // Not enough arguments.
+  REQUIRE_FALSE(FormatDeferredLine(buffer, 4 + 2, text));
+}
+
+}  // namespace xe::base::test
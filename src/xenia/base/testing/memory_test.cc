@@ -15,6 +15,7 @@
 #include "xenia/base/clock.h"
 
 #include <array>
+#include <vector>
 
 namespace xe {
 namespace base {
@@ -506,6 +507,41 @@ TEST_CASE("copy_and_swap_16_in_32_unaligned", "[copy_and_swap]") {
   }
 }
 
+#if XE_ARCH_AMD64 == 1
+TEST_CASE("copy_and_swap_nontemporal", "[copy_and_swap]") {
+  // Long enough for the vector loops, with the heads and the tails at
+  // different alignments, compared with the regular copies.
+  std::vector<uint8_t> src(1024 + 64);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = static_cast<uint8_t>(i * 7 + 1);
+  }
+  using CopyAndSwapFunction = void (*)(void*, const void*, size_t);
+  const struct {
+    size_t element_size;
+    CopyAndSwapFunction regular;
+    CopyAndSwapFunction nontemporal;
+  } variants[] = {
+      {2, copy_and_swap_16_unaligned, copy_and_swap_16_nontemporal},
+      {4, copy_and_swap_32_unaligned, copy_and_swap_32_nontemporal},
+      {8, copy_and_swap_64_unaligned, copy_and_swap_64_nontemporal},
+      {4, copy_and_swap_16_in_32_unaligned,
+       copy_and_swap_16_in_32_nontemporal},
+  };
+  for (const auto& variant : variants) {
+    for (size_t offset = 0; offset < 32; offset += variant.element_size) {
+      for (size_t count : {size_t(0), size_t(1), size_t(3), size_t(37),
+                           1024 / variant.element_size}) {
+        std::vector<uint8_t> expected(src.size(), 0xCC);
+        std::vector<uint8_t> actual(src.size(), 0xCC);
+        variant.regular(expected.data() + offset, src.data() + 3, count);
+        variant.nontemporal(actual.data() + offset, src.data() + 3, count);
+        REQUIRE(actual == expected);
+      }
+    }
+  }
+}
+#endif  // XE_ARCH_AMD64
+
 TEST_CASE("create_and_close_file_mapping", "Virtual Memory Mapping") {
   auto path = fmt::format("xenia_test_{}", Clock::QueryHostTickCount());
   auto memory = xe::memory::CreateFileMappingHandle(
@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/mpsc_queue.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+struct Item : MpscQueueNode {
+  uint32_t producer;
+  uint32_t sequence;
+};
+
+TEST_CASE("Items are popped in the order they're pushed", "[mpsc_queue]") {
+  MpscQueue queue;
+  REQUIRE(queue.Pop() == nullptr);
+  Item items[3];
+  for (uint32_t i = 0; i < 3; ++i) {
+    items[i].sequence = i;
+    queue.Push(&items[i]);
+  }
+  for (uint32_t i = 0; i < 3; ++i) {
+    REQUIRE(static_cast<Item*>(queue.Pop())->sequence == i);
+  }
+  REQUIRE(queue.Pop() == nullptr);
+
+  // Nodes may be pushed again once popped.
+  queue.Push(&items[1]);
+  REQUIRE(queue.Pop() == &items[1]);
+  REQUIRE(queue.Pop() == nullptr);
+}
+
+TEST_CASE("Items from multiple producers are all popped", "[mpsc_queue]") {
+  constexpr uint32_t kProducerCount = 4;
+  constexpr uint32_t kItemCount = 10000;
+  MpscQueue queue;
+  // Not copyable due to the atomic.
+  std::vector<std::unique_ptr<Item[]>> items;
+  for (uint32_t i = 0; i < kProducerCount; ++i) {
+    items.push_back(std::make_unique<Item[]>(kItemCount));
+  }
+  std::vector<std::thread> producer_threads;
+  for (uint32_t i = 0; i < kProducerCount; ++i) {
+    producer_threads.emplace_back([&, i]() {
+      for (uint32_t j = 0; j < kItemCount; ++j) {
+        items[i][j].producer = i;
+        items[i][j].sequence = j;
+        queue.Push(&items[i][j]);
+      }
+    });
+  }
+  std::vector<uint32_t> next_sequences(kProducerCount);
+  uint32_t popped_count = 0;
+  bool in_order = true;
+  while (popped_count < kProducerCount * kItemCount) {
+    auto item = static_cast<Item*>(queue.Pop());
+    if (!item) {
+      std::this_thread::yield();
+      continue;
+    }
+    // Each producer's items stay in order.
+    in_order &= item->sequence == next_sequences[item->producer]++;
+    ++popped_count;
+  }
+  for (std::thread& thread : producer_threads) {
+    thread.join();
+  }
+  REQUIRE(in_order);
+  REQUIRE(queue.Pop() == nullptr);
+}
+
+}  // namespace xe::base::test
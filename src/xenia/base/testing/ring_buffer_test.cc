@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/ring_buffer.h"
+
+#include <cstdint>
+#include <thread>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+TEST_CASE("SPSC ring buffer views wrap around", "[ring_buffer]") {
+  uint8_t data[8];
+  SpscRingBuffer ring(data, sizeof(data));
+  REQUIRE(ring.write_count() == 8);
+  REQUIRE(ring.read_count() == 0);
+  REQUIRE(ring.BeginRead(1).first_length == 0);
+
+  const uint8_t input[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  REQUIRE(ring.Write(input, 6) == 6);
+  uint8_t output[8] = {};
+  REQUIRE(ring.Read(output, 4) == 4);
+  REQUIRE(output[0] == 1);
+  REQUIRE(output[3] == 4);
+
+  // 2 bytes before the end of the buffer, 4 after wrapping around.
+  SpscRingBuffer::WriteRange write_range = ring.BeginWrite(6);
+  REQUIRE(write_range.first == data + 6);
+  REQUIRE(write_range.first_length == 2);
+  REQUIRE(write_range.second == data);
+  REQUIRE(write_range.second_length == 4);
+  ring.EndWrite(0);
+
+  // Only as much as free.
+  REQUIRE(ring.Write(input, 10) == 6);
+  REQUIRE(ring.write_count() == 0);
+  REQUIRE(ring.BeginWrite(1).first_length == 0);
+
+  RingBuffer::ReadRange read_range = ring.BeginRead(8);
+  REQUIRE(read_range.first == data + 4);
+  REQUIRE(read_range.first_length == 4);
+  REQUIRE(read_range.second == data);
+  REQUIRE(read_range.second_length == 4);
+  REQUIRE(read_range.first[0] == 5);
+  REQUIRE(read_range.second[3] == 6);
+  ring.EndRead(8);
+  REQUIRE(ring.read_count() == 0);
+  REQUIRE(ring.write_count() == 8);
+}
+
+TEST_CASE("SPSC ring buffer transfers between threads", "[ring_buffer]") {
+  constexpr uint32_t kValueCount = 100000;
+  // Not a multiple of the value size to exercise split values.
+  uint8_t data[61];
+  SpscRingBuffer ring(data, sizeof(data));
+  std::thread producer_thread([&]() {
+    for (uint32_t i = 0; i < kValueCount; ++i) {
+      auto bytes = reinterpret_cast<const uint8_t*>(&i);
+      size_t written = 0;
+      while (written < sizeof(i)) {
+        written += ring.Write(bytes + written, sizeof(i) - written);
+      }
+    }
+  });
+  bool in_order = true;
+  for (uint32_t i = 0; i < kValueCount; ++i) {
+    uint32_t value;
+    auto bytes = reinterpret_cast<uint8_t*>(&value);
+    size_t read = 0;
+    while (read < sizeof(value)) {
+      read += ring.Read(bytes + read, sizeof(value) - read);
+    }
+    in_order &= value == i;
+  }
+  producer_thread.join();
+  REQUIRE(in_order);
+  REQUIRE(ring.read_count() == 0);
+}
+
+}  // namespace xe::base::test
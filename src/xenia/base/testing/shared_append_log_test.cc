@@ -0,0 +1,117 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/shared_append_log.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+namespace {
+
+std::filesystem::path GetTestLogPath(const char* name) {
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / name;
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+  return path;
+}
+
+}  // namespace
+
+TEST_CASE("Shared append log records are visible to other mappings",
+          "[shared_append_log]") {
+  std::filesystem::path path = GetTestLogPath("xenia_shared_append_log_a.bin");
+  {
+    auto writer = SharedAppendLog::Open(path, 1, 4096);
+    REQUIRE(writer);
+    auto reader = SharedAppendLog::Open(path, 1, 4096);
+    REQUIRE(reader);
+    // Created with a different tag or capacity.
+    REQUIRE(!SharedAppendLog::Open(path, 2, 4096));
+    REQUIRE(!SharedAppendLog::Open(path, 1, 8192));
+
+    const char kFirst[] = "first";
+    const char kSecond[] = "second record";
+    REQUIRE(writer->Append(kFirst, sizeof(kFirst)));
+    std::vector<std::string> records;
+    auto visitor = [&records](const SharedAppendLog::Record& record) {
+      records.emplace_back(reinterpret_cast<const char*>(record.data));
+    };
+    uint64_t offset =
+        reader->Read(SharedAppendLog::kFirstRecordOffset, visitor);
+    REQUIRE(records == std::vector<std::string>{"first"});
+    REQUIRE(writer->Append(kSecond, sizeof(kSecond)));
+    reader->Read(offset, visitor);
+    REQUIRE(records == std::vector<std::string>{"first", "second record"});
+
+    // Until full.
+    std::vector<uint8_t> large(4096);
+    REQUIRE(!writer->Append(large.data(), uint32_t(large.size())));
+    REQUIRE(writer->Append(kFirst, sizeof(kFirst)));
+  }
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Shared append log appends from multiple threads",
+          "[shared_append_log]") {
+  std::filesystem::path path = GetTestLogPath("xenia_shared_append_log_b.bin");
+  {
+    constexpr uint32_t kThreadCount = 4;
+    constexpr uint32_t kAppendCount = 1000;
+    std::atomic<uint32_t> failure_count = 0;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < kThreadCount; ++i) {
+      threads.emplace_back([&path, &failure_count, i]() {
+        // A mapping per thread, like separate processes would have.
+        auto log = SharedAppendLog::Open(path, 1, 1024 * 1024);
+        if (!log) {
+          ++failure_count;
+          return;
+        }
+        for (uint32_t j = 0; j < kAppendCount; ++j) {
+          uint32_t value = i * kAppendCount + j;
+          if (!log->Append(&value, sizeof(value))) {
+            ++failure_count;
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    REQUIRE(failure_count == 0);
+
+    auto log = SharedAppendLog::Open(path, 1, 1024 * 1024);
+    REQUIRE(log);
+    std::vector<bool> seen(kThreadCount * kAppendCount);
+    uint32_t record_count = 0;
+    log->Read(SharedAppendLog::kFirstRecordOffset,
+              [&](const SharedAppendLog::Record& record) {
+                REQUIRE(record.size == sizeof(uint32_t));
+                uint32_t value;
+                std::memcpy(&value, record.data, sizeof(value));
+                REQUIRE(value < seen.size());
+                REQUIRE(!seen[value]);
+                seen[value] = true;
+                ++record_count;
+              });
+    REQUIRE(record_count == kThreadCount * kAppendCount);
+  }
+  std::filesystem::remove(path);
+}
+
+}  // namespace xe::base::test
@@ -0,0 +1,53 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/startup_timeline.h"
+
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+TEST_CASE("Startup timeline stages", "[startup_timeline]") {
+  StartupTimeline timeline;
+  REQUIRE(timeline.first_frame_ms() < 0.0);
+  {
+    StartupTimeline::ScopedStage outer(&timeline, "Outer");
+    StartupTimeline::ScopedStage inner(&timeline, "Inner");
+    inner.End();
+    // Ending again does nothing.
+    inner.End();
+  }
+  size_t pending = timeline.BeginStage("Pending");
+  std::vector<StartupTimeline::Stage> stages = timeline.GetStages();
+  REQUIRE(stages.size() == 3);
+  REQUIRE(stages[0].name == "Outer");
+  REQUIRE(stages[1].name == "Inner");
+  REQUIRE(stages[0].end_ms >= stages[1].end_ms);
+  REQUIRE(stages[1].end_ms >= stages[1].start_ms);
+  REQUIRE(stages[2].end_ms < 0.0);
+  timeline.EndStage(pending);
+  REQUIRE(timeline.GetStages()[2].end_ms >= 0.0);
+
+  // Only the first frame boundary completes the timeline.
+  REQUIRE(timeline.OnFrameBoundary());
+  double first_frame_ms = timeline.first_frame_ms();
+  REQUIRE(first_frame_ms >= stages[0].end_ms);
+  REQUIRE(!timeline.OnFrameBoundary());
+  REQUIRE(timeline.first_frame_ms() == first_frame_ms);
+}
+
+TEST_CASE("Startup timeline without a timeline", "[startup_timeline]") {
+  // Stages are optional where the timeline may be absent.
+  StartupTimeline::ScopedStage stage(nullptr, "Stage");
+  stage.End();
+}
+
+}  // namespace xe::base::test
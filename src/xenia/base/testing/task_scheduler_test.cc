@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/task_scheduler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+using xe::threading::TaskGroup;
+using xe::threading::TaskPriority;
+using xe::threading::TaskScheduler;
+
+TEST_CASE("Task groups wait for all of their tasks", "[task_scheduler]") {
+  TaskScheduler scheduler(4);
+  std::atomic<uint32_t> sum{0};
+  TaskGroup group(scheduler);
+  for (uint32_t i = 1; i <= 1000; ++i) {
+    group.Submit([&sum, i]() { sum.fetch_add(i, std::memory_order_relaxed); },
+                 TaskPriority(i % uint32_t(TaskPriority::kCount)), i);
+  }
+  group.Wait();
+  REQUIRE(group.is_done());
+  REQUIRE(sum.load() == 1000 * 1001 / 2);
+}
+
+TEST_CASE("Tasks may wait for nested groups", "[task_scheduler]") {
+  // More nested waits than workers, progress is made by the waiting threads
+  // running the tasks of the groups themselves.
+  TaskScheduler scheduler(2);
+  std::atomic<uint32_t> count{0};
+  TaskGroup group(scheduler);
+  for (uint32_t i = 0; i < 8; ++i) {
+    group.Submit([&scheduler, &count]() {
+      TaskGroup nested_group(scheduler);
+      for (uint32_t j = 0; j < 8; ++j) {
+        nested_group.Submit(
+            [&count]() { count.fetch_add(1, std::memory_order_relaxed); },
+            TaskPriority::kLatencyCritical);
+      }
+      nested_group.Wait();
+    });
+  }
+  group.Wait();
+  REQUIRE(count.load() == 64);
+}
+
+TEST_CASE("Parallel for calls the function for every index",
+          "[task_scheduler]") {
+  for (uint32_t worker_count : {0u, 1u, 3u}) {
+    TaskScheduler scheduler(worker_count);
+    std::vector<std::atomic<uint32_t>> calls(257);
+    scheduler.ParallelFor(uint32_t(calls.size()), [&calls](uint32_t index) {
+      calls[index].fetch_add(1, std::memory_order_relaxed);
+    });
+    bool all_called_once = true;
+    for (const std::atomic<uint32_t>& call_count : calls) {
+      all_called_once &= call_count.load() == 1;
+    }
+    REQUIRE(all_called_once);
+  }
+}
+
+}  // namespace xe::base::test
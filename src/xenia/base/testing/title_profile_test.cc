@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/title_profile.h"
+
+#include <map>
+#include <string>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe::base::test {
+
+TEST_CASE("Title profile selects the fastest measured configuration",
+          "[title_profile]") {
+  TitleProfile profile;
+  std::map<std::string, std::string> scaled = {
+      {"draw_resolution_scale_x", "2"}, {"render_target_path_d3d12", "'rov'"}};
+  std::map<std::string, std::string> native = {
+      {"draw_resolution_scale_x", "1"}, {"render_target_path_d3d12", "'rov'"}};
+  profile.Record(scaled, 1000, 20.0);
+  profile.Record(native, 100, 10.0);
+  REQUIRE(profile.configurations().size() == 2);
+  // Not measured for long enough yet.
+  REQUIRE(profile.GetBest(1000)->options == scaled);
+  // Merged with the earlier measurement.
+  profile.Record(native, 900, 15.0);
+  REQUIRE(profile.configurations().size() == 2);
+  const TitleProfile::Configuration* best = profile.GetBest(1000);
+  REQUIRE(best->options == native);
+  REQUIRE(best->frames == 1000);
+  REQUIRE(best->frame_time_ms == Approx(14.5));
+  REQUIRE(!profile.GetBest(2000));
+}
+
+TEST_CASE("Title profile round trip", "[title_profile]") {
+  TitleProfile profile;
+  profile.Record({{"d3d12_tiled_shared_memory", "false"},
+                  {"readback_resolve", "'fast'"}},
+                 36000, 16.683);
+  profile.Record({}, 10, 30.0);
+  TitleProfile parsed;
+  REQUIRE(parsed.Parse(profile.Format()));
+  REQUIRE(parsed.configurations().size() == 2);
+  REQUIRE(parsed.configurations()[0].options ==
+          profile.configurations()[0].options);
+  REQUIRE(parsed.configurations()[0].frames == 36000);
+  REQUIRE(parsed.configurations()[0].frame_time_ms == Approx(16.683));
+  REQUIRE(parsed.configurations()[1].options.empty());
+
+  REQUIRE(parsed.Parse(""));
+  REQUIRE(parsed.configurations().empty());
+  REQUIRE(!parsed.Parse("[[configuration]]\nframe_time_ms = 1.0\n"));
+  REQUIRE(!parsed.Parse("configuration = ["));
+}
+
+}  // namespace xe::base::test
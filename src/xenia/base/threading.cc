@@ -9,9 +9,13 @@
 
 #include "xenia/base/threading.h"
 
+#include <atomic>
+
 namespace xe {
 namespace threading {
 
+static std::atomic<uint64_t> default_thread_affinity_mask_{0};
+
 uint32_t logical_processor_count() {
   static uint32_t value = 0;
   if (!value) {
@@ -29,5 +33,13 @@ uint32_t current_thread_id() {
 
 void set_current_thread_id(uint32_t id) { current_thread_id_ = id; }
 
+void SetDefaultThreadAffinityMask(uint64_t mask) {
+  default_thread_affinity_mask_.store(mask, std::memory_order_relaxed);
+}
+
+uint64_t GetDefaultThreadAffinityMask() {
+  return default_thread_affinity_mask_.load(std::memory_order_relaxed);
+}
+
 }  // namespace threading
 }  // namespace xe
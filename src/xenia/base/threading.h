@@ -94,6 +94,21 @@ uint32_t logical_processor_count();
 // Must be called at startup before attempting to set thread affinity.
 void EnableAffinityConfiguration();
 
+// Returns the logical processors of the host grouped by the physical core they
+// belong to (SMT siblings share a core), sorted by the first processor of each
+// core. Empty if the topology can't be queried.
+std::vector<std::vector<uint32_t>> GetPhysicalCoreLogicalProcessors();
+
+// Returns the NUMA node of the host logical processor, UINT32_MAX if it can't
+// be queried.
+uint32_t GetProcessorNumaNode(uint32_t processor);
+
+// Sets the affinity mask applied to the threads created with Thread::Create
+// from now on, 0 not to restrict them. The threads may change it later with
+// set_affinity_mask.
+void SetDefaultThreadAffinityMask(uint64_t mask);
+uint64_t GetDefaultThreadAffinityMask();
+
 // Gets a stable thread-specific ID, but may not be. Use for informative
 // purposes only.
 uint32_t current_thread_system_id();
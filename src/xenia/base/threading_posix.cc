@@ -14,6 +14,7 @@
 #include "xenia/base/platform.h"
 #include "xenia/base/threading_timer_queue.h"
 
+#include <linux/futex.h>
 #include <pthread.h>
 #include <sched.h>
 #include <signal.h>
@@ -22,10 +23,17 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdio>
 #include <ctime>
+#include <filesystem>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "logging.h"
 
@@ -133,6 +141,59 @@ void install_signal_handler(SignalType type) {
 // TODO(dougvj)
 void EnableAffinityConfiguration() {}
 
+std::vector<std::vector<uint32_t>> GetPhysicalCoreLogicalProcessors() {
+  // Grouped by the package and the core IDs from sysfs (not available on all
+  // platforms, such as macOS).
+  std::vector<std::pair<std::pair<int, int>, uint32_t>> processors;
+  for (uint32_t i = 0; i < logical_processor_count(); ++i) {
+    int ids[2];
+    const char* const kIdNames[] = {"physical_package_id", "core_id"};
+    for (size_t j = 0; j < 2; ++j) {
+      std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(i) +
+                         "/topology/" + kIdNames[j];
+      FILE* file = fopen(path.c_str(), "r");
+      if (!file) {
+        return {};
+      }
+      bool read = fscanf(file, "%d", &ids[j]) == 1;
+      fclose(file);
+      if (!read) {
+        return {};
+      }
+    }
+    processors.push_back({{ids[0], ids[1]}, i});
+  }
+  std::vector<std::vector<uint32_t>> cores;
+  std::vector<std::pair<int, int>> core_ids;
+  for (const auto& processor : processors) {
+    auto it = std::find(core_ids.begin(), core_ids.end(), processor.first);
+    if (it == core_ids.end()) {
+      core_ids.push_back(processor.first);
+      cores.emplace_back().push_back(processor.second);
+    } else {
+      cores[size_t(it - core_ids.begin())].push_back(processor.second);
+    }
+  }
+  return cores;
+}
+
+uint32_t GetProcessorNumaNode(uint32_t processor) {
+  // The node is a nodeN link in the directory of the processor in sysfs.
+  std::error_code error;
+  std::filesystem::directory_iterator it(
+      "/sys/devices/system/cpu/cpu" + std::to_string(processor), error);
+  for (; !error && it != std::filesystem::directory_iterator();
+       it.increment(error)) {
+    std::string name = it->path().filename().string();
+    uint32_t node;
+    if (name.compare(0, 4, "node") == 0 &&
+        sscanf(name.c_str() + 4, "%u", &node) == 1) {
+      return node;
+    }
+  }
+  return UINT32_MAX;
+}
+
 // uint64_t ticks() { return mach_absolute_time(); }
 
 uint32_t current_thread_system_id() {
@@ -189,26 +250,25 @@ bool SetTlsValue(TlsHandle handle, uintptr_t value) {
   return pthread_setspecific(handle, reinterpret_cast<void*>(value)) == 0;
 }
 
+// A thread blocked in a wait, registered in the objects it's waiting for, so
+// signaling an object only wakes the threads waiting for it.
+struct PosixWaiter {
+  // Incremented on every wake, with the futex wait done on it.
+  std::atomic<uint32_t> wake_sequence{0};
+};
+
+thread_local PosixWaiter current_waiter_;
+
 class PosixConditionBase {
  public:
   virtual ~PosixConditionBase() = default;
   virtual bool Signal() = 0;
 
   WaitResult Wait(std::chrono::milliseconds timeout) {
-    bool executed;
     auto predicate = [this] { return this->signaled(); };
     auto lock = std::unique_lock(mutex_);
-    if (predicate()) {
-      executed = true;
-    } else {
-      if (timeout == std::chrono::milliseconds::max()) {
-        cond_.wait(lock, predicate);
-        executed = true;  // Did not time out;
-      } else {
-        executed = cond_.wait_for(lock, timeout, predicate);
-      }
-    }
-    if (executed) {
+    PosixConditionBase* condition = this;
+    if (WaitLocked(lock, &condition, 1, predicate, timeout)) {
       post_execution();
       return WaitResult::kSuccess;
     }
@@ -238,16 +298,7 @@ class PosixConditionBase {
     // if the thread is suspended between locking and waiting
     std::unique_lock lock(mutex_);
 
-    bool wait_success = true;
-    // If the timeout is infinite, wait without timeout.
-    // The predicate will be checked before beginning the wait
-    if (timeout == std::chrono::milliseconds::max()) {
-      cond_.wait(lock, predicate);
-    } else {
-      // Wait with timeout.
-      wait_success = cond_.wait_for(lock, timeout, predicate);
-    }
-    if (wait_success) {
+    if (WaitLocked(lock, handles.data(), handles.size(), predicate, timeout)) {
       auto first_signaled = std::numeric_limits<size_t>::max();
       for (auto i = 0u; i < handles.size(); ++i) {
         if (handles[i]->signaled()) {
@@ -265,17 +316,93 @@ class PosixConditionBase {
   }
 
   [[nodiscard]] virtual void* native_handle() const {
-    return cond_.native_handle();
+    return const_cast<PosixConditionBase*>(this);
   }
 
  protected:
   [[nodiscard]] inline virtual bool signaled() const = 0;
   inline virtual void post_execution() = 0;
-  static std::condition_variable cond_;
+
+  // Wakes the threads waiting for this object, must be called with mutex_
+  // locked after changing the state.
+  void NotifyWaiters() {
+    for (PosixWaiter* waiter : waiters_) {
+      waiter->wake_sequence.fetch_add(1, std::memory_order_relaxed);
+      syscall(SYS_futex, &waiter->wake_sequence, FUTEX_WAKE_PRIVATE, 1,
+              nullptr, nullptr, 0);
+    }
+  }
+
+  // The state of all objects is protected by one mutex so waits for multiple
+  // objects can check and acquire them atomically, but every waiting thread
+  // sleeps on its own futex.
   static std::mutex mutex_;
+
+ private:
+  // Returns whether the predicate is true, or false if timed out.
+  template <typename Predicate>
+  static bool WaitLocked(std::unique_lock<std::mutex>& lock,
+                         PosixConditionBase* const* conditions,
+                         size_t condition_count, const Predicate& predicate,
+                         std::chrono::milliseconds timeout) {
+    if (predicate()) {
+      return true;
+    }
+    if (timeout == std::chrono::milliseconds::zero()) {
+      return false;
+    }
+    PosixWaiter& waiter = current_waiter_;
+    for (size_t i = 0; i < condition_count; ++i) {
+      conditions[i]->waiters_.push_back(&waiter);
+    }
+    bool infinite = timeout == std::chrono::milliseconds::max();
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if (!infinite) {
+      deadline = std::chrono::steady_clock::now() + timeout;
+    }
+    bool result;
+    while (true) {
+      if (predicate()) {
+        result = true;
+        break;
+      }
+      timespec remaining_timespec;
+      if (!infinite) {
+        auto remaining = deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero()) {
+          result = false;
+          break;
+        }
+        auto remaining_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(remaining)
+                .count();
+        remaining_timespec.tv_sec = time_t(remaining_ns / 1000000000);
+        remaining_timespec.tv_nsec = long(remaining_ns % 1000000000);
+      }
+      // Any wake after the sequence is read, under the lock, makes the futex
+      // wait return immediately.
+      uint32_t wake_sequence =
+          waiter.wake_sequence.load(std::memory_order_relaxed);
+      lock.unlock();
+      syscall(SYS_futex, &waiter.wake_sequence, FUTEX_WAIT_PRIVATE,
+              wake_sequence, infinite ? nullptr : &remaining_timespec, nullptr,
+              0);
+      lock.lock();
+    }
+    for (size_t i = 0; i < condition_count; ++i) {
+      std::vector<PosixWaiter*>& waiters = conditions[i]->waiters_;
+      auto it = std::find(waiters.begin(), waiters.end(), &waiter);
+      assert_true(it != waiters.end());
+      *it = waiters.back();
+      waiters.pop_back();
+    }
+    return result;
+  }
+
+  // Protected by mutex_.
+  std::vector<PosixWaiter*> waiters_;
 };
 
-std::condition_variable PosixConditionBase::cond_;
 std::mutex PosixConditionBase::mutex_;
 
 // There really is no native POSIX handle for a single wait/signal construct
@@ -295,7 +422,7 @@ class PosixCondition<Event> : public PosixConditionBase {
   bool Signal() override {
     auto lock = std::unique_lock(mutex_);
     signal_ = true;
-    cond_.notify_all();
+    NotifyWaiters();
     return true;
   }
 
@@ -328,7 +455,7 @@ class PosixCondition<Semaphore> final : public PosixConditionBase {
       auto lock = std::unique_lock(mutex_);
       if (out_previous_count) *out_previous_count = count_;
       count_ += release_count;
-      cond_.notify_all();
+      NotifyWaiters();
       return true;
     }
     return false;
@@ -336,10 +463,7 @@ class PosixCondition<Semaphore> final : public PosixConditionBase {
 
  private:
   [[nodiscard]] bool signaled() const override { return count_ > 0; }
-  void post_execution() override {
-    count_--;
-    cond_.notify_all();
-  }
+  void post_execution() override { count_--; }
   uint32_t count_;
   const uint32_t maximum_count_;
 };
@@ -362,7 +486,7 @@ class PosixCondition<Mutant> final : public PosixConditionBase {
       --count_;
       // Free to be acquired by another thread
       if (count_ == 0) {
-        cond_.notify_all();
+        NotifyWaiters();
       }
       return true;
     }
@@ -396,7 +520,7 @@ class PosixCondition<Timer> final : public PosixConditionBase {
   bool Signal() override {
     std::lock_guard lock(mutex_);
     signal_ = true;
-    cond_.notify_all();
+    NotifyWaiters();
     return true;
   }
 
@@ -634,7 +758,7 @@ class PosixCondition<Thread> final : public PosixConditionBase {
     cpu_set_t cpu_set;
     CPU_ZERO(&cpu_set);
     for (auto i = 0u; i < 64; i++) {
-      if (mask & (1 << i)) {
+      if (mask & (uint64_t(1) << i)) {
         CPU_SET(i, &cpu_set);
       }
     }
@@ -755,7 +879,7 @@ class PosixCondition<Thread> final : public PosixConditionBase {
 
       exit_code_ = exit_code;
       signaled_ = true;
-      cond_.notify_all();
+      NotifyWaiters();
     }
     if (is_current_thread) {
       pthread_exit(reinterpret_cast<void*>(exit_code));
@@ -1131,7 +1255,7 @@ void* PosixCondition<Thread>::ThreadStartRoutine(void* parameter) {
   std::unique_lock lock(mutex_);
   thread->handle_.exit_code_ = 0;
   thread->handle_.signaled_ = true;
-  cond_.notify_all();
+  thread->handle_.NotifyWaiters();
 
   current_thread_ = nullptr;
   return nullptr;
@@ -1147,6 +1271,10 @@ std::unique_ptr<Thread> Thread::Create(CreationParameters params,
   auto thread = std::make_unique<PosixThread>();
   if (!thread->Initialize(params, std::move(start_routine))) return nullptr;
   assert_not_null(thread);
+  uint64_t affinity_mask = GetDefaultThreadAffinityMask();
+  if (affinity_mask) {
+    thread->set_affinity_mask(affinity_mask);
+  }
   return thread;
 }
 
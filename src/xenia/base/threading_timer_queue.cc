@@ -8,14 +8,14 @@
  */
 
 #include <algorithm>
-#include <forward_list>
+#include <array>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-#include "third_party/disruptorplus/include/disruptorplus/blocking_wait_strategy.hpp"
-#include "third_party/disruptorplus/include/disruptorplus/multi_threaded_claim_strategy.hpp"
-#include "third_party/disruptorplus/include/disruptorplus/ring_buffer.hpp"
-#include "third_party/disruptorplus/include/disruptorplus/sequence_barrier.hpp"
 #include "third_party/disruptorplus/include/disruptorplus/spin_wait.hpp"
-#include "third_party/disruptorplus/include/disruptorplus/spin_wait_strategy.hpp"
 #include "xenia/base/assert.h"
 #include "xenia/base/threading.h"
 #include "xenia/base/threading_timer_queue.h"
@@ -26,122 +26,71 @@ namespace xe {
 namespace threading {
 
 using WaitItem = TimerQueueWaitItem;
-/*
-        chrispy: changed this to a blocking wait from a spin-wait, the spin was
-   monopolizing a ton of cpu time (depending on the game 2-4% of total cpu time)
-   on my 3990x no complaints since that change
-*/
-
-/*
-        edit: actually had to change it back, when i was testing it only worked
-   because i fixed disruptorplus' code to compile (it gives wrong args to
-   condition_variable::wait_until) but now builds
-
-*/
-
-/*
-    edit2: (30.12.2024) After uplifting version of MSVC compiler Xenia cannot be
-   correctly initialized if you're using proton.
-*/
-using WaitStrat = dp::spin_wait_strategy;
 
+// A hierarchical timer wheel (like the one in the Linux kernel) with
+// kTimerQueueResolution ticks, serviced by a thread that sleeps until the next
+// tick with anything to do, so timer insertion and expiration are O(1) and the
+// thread doesn't need to spin. The due times are rounded up to the tick, which
+// also coalesces the timers due within the same tick into a single wake-up.
 class TimerQueue {
  public:
   using clock = WaitItem::clock;
   static_assert(clock::is_steady);
 
  public:
-  TimerQueue()
-      : buffer_(kWaitCount),
-        wait_strategy_(),
-        claim_strategy_(kWaitCount, wait_strategy_),
-        consumed_(wait_strategy_),
-        shutdown_(false) {
-    claim_strategy_.add_claim_barrier(consumed_);
+  TimerQueue() : start_(clock::now()), shutdown_(false) {
     dispatch_thread_ = std::thread(&TimerQueue::TimerThreadMain, this);
   }
 
   ~TimerQueue() {
-    shutdown_.store(true, std::memory_order_release);
-
-    // Kick dispatch thread to check shutdown flag
-    auto wait_item = std::make_shared<WaitItem>(nullptr, nullptr, this,
-                                                clock::time_point::min(),
-                                                clock::duration::zero());
-    wait_item->Disarm();
-    QueueTimer(std::move(wait_item));
-
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_ = true;
+    }
+    wake_cond_.notify_one();
     dispatch_thread_.join();
   }
 
   void TimerThreadMain() {
-    dp::sequence_t next_sequence = 0;
-    const auto comp = [](const std::shared_ptr<WaitItem>& left,
-                         const std::shared_ptr<WaitItem>& right) {
-      return left->due_ < right->due_;
-    };
-
     xe::threading::set_name("xe::threading::TimerQueue");
 
-    while (!shutdown_.load(std::memory_order_relaxed)) {
-      {
-        // Consume new wait items and add them to sorted wait queue
-        dp::sequence_t available = claim_strategy_.wait_until_published(
-            next_sequence, next_sequence - 1,
-            wait_queue_.empty() ? clock::time_point::max()
-                                : wait_queue_.front()->due_);
-
-        // Check for timeout
-        if (available != next_sequence - 1) {
-          std::forward_list<std::shared_ptr<WaitItem>> wait_items;
-          do {
-            wait_items.push_front(std::move(buffer_[next_sequence]));
-          } while (next_sequence++ != available);
-
-          consumed_.publish(available);
-
-          wait_items.sort(comp);
-          wait_queue_.merge(wait_items, comp);
+    std::vector<std::shared_ptr<WaitItem>> expired_items;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!shutdown_) {
+      uint64_t now_tick = GetElapsedTicks(clock::now());
+      while (current_tick_ < now_tick) {
+        uint64_t next_tick = GetNextEventTick();
+        if (next_tick > now_tick) {
+          current_tick_ = now_tick;
+          break;
         }
+        current_tick_ = next_tick;
+        Cascade();
+        std::vector<std::shared_ptr<WaitItem>>& slot =
+            slots_[0][current_tick_ & kSlotMask];
+        std::move(slot.begin(), slot.end(), std::back_inserter(expired_));
+        slot.clear();
       }
 
-      {
-        // Check wait queue, invoke callbacks and reschedule
-        std::forward_list<std::shared_ptr<WaitItem>> wait_items;
-        while (!wait_queue_.empty() &&
-               wait_queue_.front()->due_ <= clock::now()) {
-          auto wait_item = std::move(wait_queue_.front());
-          wait_queue_.pop_front();
-
-          // Ensure that it isn't disarmed
-          auto state = WaitItem::State::kIdle;
-          if (wait_item->state_.compare_exchange_strong(
-                  state, WaitItem::State::kInCallback,
-                  std::memory_order_acq_rel)) {
-            // Possibility to dispatch to a thread pool here
-            assert_not_null(wait_item->callback_);
-            wait_item->callback_(wait_item->userdata_);
-
-            if (wait_item->interval_ != clock::duration::zero() &&
-                wait_item->state_.load(std::memory_order_acquire) !=
-                    WaitItem::State::kInCallbackSelfDisarmed) {
-              // Item is recurring and didn't self-disarm during callback:
-              wait_item->due_ += wait_item->interval_;
-              wait_item->state_.store(WaitItem::State::kIdle,
-                                      std::memory_order_release);
-              wait_items.push_front(std::move(wait_item));
-            } else {
-              wait_item->state_.store(WaitItem::State::kDisarmed,
-                                      std::memory_order_release);
-            }
-          } else {
-            // Specifically, kInCallback is illegal here
-            assert_true(WaitItem::State::kDisarmed == state);
-          }
+      if (!expired_.empty()) {
+        expired_items.swap(expired_);
+        // The callbacks may queue more timers.
+        lock.unlock();
+        for (std::shared_ptr<WaitItem>& wait_item : expired_items) {
+          Dispatch(std::move(wait_item));
         }
-        wait_items.sort(comp);
-        wait_queue_.merge(wait_items, comp);
+        expired_items.clear();
+        lock.lock();
+        continue;
+      }
+
+      next_wake_tick_ = GetNextEventTick();
+      if (next_wake_tick_ == UINT64_MAX) {
+        wake_cond_.wait(lock);
+      } else {
+        wake_cond_.wait_until(lock, GetTickTime(next_wake_tick_));
       }
+      next_wake_tick_ = 0;
     }
   }
 
@@ -152,9 +101,16 @@ class TimerQueue {
     wait_item->due_ =
         std::max(clock::now() - wait_item->interval_, wait_item->due_);
 
-    auto sequence = claim_strategy_.claim_one();
-    buffer_[sequence] = std::move(wait_item);
-    claim_strategy_.publish(sequence);
+    bool wake;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      uint64_t due_tick = Insert(std::move(wait_item));
+      // The thread is either not sleeping, or sleeping past the new timer.
+      wake = next_wake_tick_ && due_tick < next_wake_tick_;
+    }
+    if (wake) {
+      wake_cond_.notify_one();
+    }
 
     return wait_item_weak;
   }
@@ -162,18 +118,150 @@ class TimerQueue {
   const std::thread& dispatch_thread() const { return dispatch_thread_; }
 
  private:
-  // This ring buffer will be used to introduce timers queued by the public API
-  static constexpr size_t kWaitCount = 512;
-  dp::ring_buffer<std::shared_ptr<WaitItem>> buffer_;
-
-  WaitStrat wait_strategy_;
-  dp::multi_threaded_claim_strategy<WaitStrat> claim_strategy_;
-  dp::sequence_barrier<WaitStrat> consumed_;
-
-  // This is a _sorted_ (ascending due_) list of active timers managed by a
-  // dedicated thread
-  std::forward_list<std::shared_ptr<WaitItem>> wait_queue_;
-  std::atomic_bool shutdown_;
+  static constexpr uint32_t kLevelBits = 6;
+  static constexpr uint32_t kSlotCount = 1 << kLevelBits;
+  static constexpr uint64_t kSlotMask = kSlotCount - 1;
+  static constexpr uint32_t kLevelCount = 4;
+
+  static uint64_t GetResolution() {
+    return uint64_t(
+        std::chrono::duration_cast<clock::duration>(kTimerQueueResolution)
+            .count());
+  }
+
+  // The tick at which a timer due at the time is fired, rounded up so timers
+  // never fire early.
+  uint64_t GetTick(clock::time_point time) const {
+    if (time <= start_) {
+      return 0;
+    }
+    uint64_t elapsed = uint64_t((time - start_).count());
+    return (elapsed + GetResolution() - 1) / GetResolution();
+  }
+
+  // The last tick that has been fully reached at the time.
+  uint64_t GetElapsedTicks(clock::time_point time) const {
+    if (time <= start_) {
+      return 0;
+    }
+    return uint64_t((time - start_).count()) / GetResolution();
+  }
+
+  clock::time_point GetTickTime(uint64_t tick) const {
+    return start_ +
+           std::chrono::duration_cast<clock::duration>(kTimerQueueResolution) *
+               tick;
+  }
+
+  // Returns the tick the item has been scheduled for.
+  uint64_t Insert(std::shared_ptr<WaitItem> wait_item) {
+    uint64_t due_tick = GetTick(wait_item->due_);
+    if (due_tick <= current_tick_) {
+      expired_.push_back(std::move(wait_item));
+      return current_tick_;
+    }
+    uint64_t delta = due_tick - current_tick_;
+    for (uint32_t level = 0; level < kLevelCount; ++level) {
+      if (delta < (uint64_t(1) << (kLevelBits * (level + 1)))) {
+        slots_[level][(due_tick >> (kLevelBits * level)) & kSlotMask]
+            .push_back(std::move(wait_item));
+        return due_tick;
+      }
+    }
+    overflow_.push_back(std::move(wait_item));
+    return due_tick;
+  }
+
+  // Moves the timers of the higher levels whose slot begins at the current
+  // tick to the lower levels.
+  void Cascade() {
+    for (uint32_t level = 1; level < kLevelCount; ++level) {
+      uint32_t shift = kLevelBits * level;
+      if (current_tick_ & ((uint64_t(1) << shift) - 1)) {
+        return;
+      }
+      std::vector<std::shared_ptr<WaitItem>> slot;
+      slot.swap(slots_[level][(current_tick_ >> shift) & kSlotMask]);
+      for (std::shared_ptr<WaitItem>& wait_item : slot) {
+        Insert(std::move(wait_item));
+      }
+    }
+    // Beyond the last level, recheck on every full rotation.
+    if (!(current_tick_ &
+          ((uint64_t(1) << (kLevelBits * kLevelCount)) - 1))) {
+      std::vector<std::shared_ptr<WaitItem>> overflow;
+      overflow.swap(overflow_);
+      for (std::shared_ptr<WaitItem>& wait_item : overflow) {
+        Insert(std::move(wait_item));
+      }
+    }
+  }
+
+  // Returns the first tick after the current one at which a slot needs to be
+  // fired or cascaded, or UINT64_MAX if there are no timers in the wheel.
+  uint64_t GetNextEventTick() const {
+    uint64_t next_tick = UINT64_MAX;
+    for (uint32_t level = 0; level < kLevelCount; ++level) {
+      uint32_t shift = kLevelBits * level;
+      uint64_t level_tick = current_tick_ >> shift;
+      for (uint64_t i = 1; i <= kSlotCount; ++i) {
+        if (!slots_[level][(level_tick + i) & kSlotMask].empty()) {
+          next_tick = std::min(next_tick, (level_tick + i) << shift);
+          break;
+        }
+      }
+    }
+    if (!overflow_.empty()) {
+      uint32_t shift = kLevelBits * kLevelCount;
+      next_tick =
+          std::min(next_tick, ((current_tick_ >> shift) + 1) << shift);
+    }
+    return next_tick;
+  }
+
+  void Dispatch(std::shared_ptr<WaitItem> wait_item) {
+    // Ensure that it isn't disarmed
+    auto state = WaitItem::State::kIdle;
+    if (wait_item->state_.compare_exchange_strong(
+            state, WaitItem::State::kInCallback, std::memory_order_acq_rel)) {
+      // Possibility to dispatch to a thread pool here
+      assert_not_null(wait_item->callback_);
+      wait_item->callback_(wait_item->userdata_);
+
+      if (wait_item->interval_ != clock::duration::zero() &&
+          wait_item->state_.load(std::memory_order_acquire) !=
+              WaitItem::State::kInCallbackSelfDisarmed) {
+        // Item is recurring and didn't self-disarm during callback:
+        wait_item->due_ += wait_item->interval_;
+        wait_item->state_.store(WaitItem::State::kIdle,
+                                std::memory_order_release);
+        std::lock_guard<std::mutex> lock(mutex_);
+        Insert(std::move(wait_item));
+      } else {
+        wait_item->state_.store(WaitItem::State::kDisarmed,
+                                std::memory_order_release);
+      }
+    } else {
+      // Specifically, kInCallback is illegal here
+      assert_true(WaitItem::State::kDisarmed == state);
+    }
+  }
+
+  const clock::time_point start_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_cond_;
+  bool shutdown_;
+  // The tick the thread will wake up at if it's sleeping, 0 otherwise.
+  uint64_t next_wake_tick_ = 0;
+  // The last tick that has been processed.
+  uint64_t current_tick_ = 0;
+  std::array<std::array<std::vector<std::shared_ptr<WaitItem>>, kSlotCount>,
+             kLevelCount>
+      slots_;
+  std::vector<std::shared_ptr<WaitItem>> overflow_;
+  std::vector<std::shared_ptr<WaitItem>> expired_;
+
   std::thread dispatch_thread_;
 };
 
@@ -20,6 +20,10 @@
 
 namespace xe::threading {
 
+// Timers fire at the first multiple of this after their due time, all those in
+// the same interval in one wake-up of the timer thread.
+constexpr std::chrono::microseconds kTimerQueueResolution{100};
+
 class TimerQueue;
 
 struct TimerQueueWaitItem {
@@ -74,6 +74,55 @@ void EnableAffinityConfiguration() {
   SetProcessAffinityMask(process_handle, system_affinity_mask);
 }
 
+std::vector<std::vector<uint32_t>> GetPhysicalCoreLogicalProcessors() {
+  DWORD length = 0;
+  GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+  if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+    return {};
+  }
+  std::vector<uint8_t> buffer(length);
+  if (!GetLogicalProcessorInformationEx(
+          RelationProcessorCore,
+          reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(
+              buffer.data()),
+          &length)) {
+    return {};
+  }
+  std::vector<std::vector<uint32_t>> cores;
+  for (DWORD offset = 0; offset < length;) {
+    auto info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(
+        buffer.data() + offset);
+    offset += info->Size;
+    // Affinity masks only cover the first processor group.
+    if (info->Processor.GroupMask[0].Group) {
+      continue;
+    }
+    std::vector<uint32_t> processors;
+    KAFFINITY mask = info->Processor.GroupMask[0].Mask;
+    for (uint32_t i = 0; i < sizeof(KAFFINITY) * 8; ++i) {
+      if (mask & (KAFFINITY(1) << i)) {
+        processors.push_back(i);
+      }
+    }
+    if (!processors.empty()) {
+      cores.push_back(std::move(processors));
+    }
+  }
+  std::sort(cores.begin(), cores.end());
+  return cores;
+}
+
+uint32_t GetProcessorNumaNode(uint32_t processor) {
+  PROCESSOR_NUMBER processor_number = {};
+  processor_number.Number = BYTE(processor);
+  USHORT node;
+  if (!GetNumaProcessorNodeEx(&processor_number, &node) ||
+      node == MAXUSHORT) {
+    return UINT32_MAX;
+  }
+  return node;
+}
+
 uint32_t current_thread_system_id() {
   return static_cast<uint32_t>(GetCurrentThreadId());
 }
@@ -613,6 +662,10 @@ std::unique_ptr<Thread> Thread::Create(CreationParameters params,
       CreateThread(NULL, params.stack_size, ThreadStartRoutine, start_data,
                    params.create_suspended ? CREATE_SUSPENDED : 0, NULL);
   if (handle) {
+    uint64_t affinity_mask = GetDefaultThreadAffinityMask();
+    if (affinity_mask) {
+      SetThreadAffinityMask(handle, DWORD_PTR(affinity_mask));
+    }
     return std::make_unique<Win32Thread>(handle);
   } else {
     LOG_LASTERROR();
@@ -0,0 +1,170 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/title_profile.h"
+
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "third_party/tomlplusplus/include/toml++/toml.hpp"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+
+namespace xe {
+
+namespace {
+
+bool FormatTomlLiteral(const toml::node& node, std::string& literal_out) {
+  if (auto value = node.value_exact<std::string>()) {
+    literal_out = cvar::toml_internal::EscapeString(*value);
+  } else if (auto value = node.value_exact<bool>()) {
+    literal_out = *value ? "true" : "false";
+  } else if (auto value = node.value_exact<int64_t>()) {
+    literal_out = fmt::format("{}", *value);
+  } else if (auto value = node.value_exact<double>()) {
+    literal_out = fmt::format("{}", *value);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool TitleProfile::Parse(std::string_view text) {
+  configurations_.clear();
+  toml::table table;
+  try {
+    table = toml::parse(text);
+  } catch (toml::parse_error&) {
+    return false;
+  }
+  const toml::node* configurations_node = table.get("configuration");
+  if (!configurations_node) {
+    return true;
+  }
+  const toml::array* configurations_array = configurations_node->as_array();
+  if (!configurations_array) {
+    return false;
+  }
+  for (const toml::node& configuration_node : *configurations_array) {
+    const toml::table* configuration_table = configuration_node.as_table();
+    if (!configuration_table) {
+      configurations_.clear();
+      return false;
+    }
+    std::optional<int64_t> frames =
+        (*configuration_table)["frames"].value<int64_t>();
+    std::optional<double> frame_time_ms =
+        (*configuration_table)["frame_time_ms"].value<double>();
+    if (!frames || *frames < 0 || !frame_time_ms || *frame_time_ms < 0.0) {
+      configurations_.clear();
+      return false;
+    }
+    Configuration& configuration = configurations_.emplace_back();
+    configuration.frames = uint64_t(*frames);
+    configuration.frame_time_ms = *frame_time_ms;
+    if (const toml::table* options_table =
+            (*configuration_table)["options"].as_table()) {
+      for (const auto& [name, value] : *options_table) {
+        std::string literal;
+        if (!FormatTomlLiteral(value, literal)) {
+          configurations_.clear();
+          return false;
+        }
+        configuration.options.emplace(std::string(name.str()),
+                                      std::move(literal));
+      }
+    }
+  }
+  return true;
+}
+
+std::string TitleProfile::Format() const {
+  std::string text;
+  for (const Configuration& configuration : configurations_) {
+    if (!text.empty()) {
+      text += '\n';
+    }
+    text += fmt::format(
+        "[[configuration]]\nframes = {}\nframe_time_ms = {:.3f}\n"
+        "[configuration.options]\n",
+        configuration.frames, configuration.frame_time_ms);
+    for (const auto& [name, literal] : configuration.options) {
+      text += fmt::format("{} = {}\n", name, literal);
+    }
+  }
+  return text;
+}
+
+bool TitleProfile::Load(const std::filesystem::path& path) {
+  configurations_.clear();
+  if (!std::filesystem::exists(path)) {
+    return true;
+  }
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  return Parse(text.str());
+}
+
+bool TitleProfile::Save(const std::filesystem::path& path) const {
+  xe::filesystem::CreateParentFolder(path);
+  FILE* file = xe::filesystem::OpenFile(path, "wb");
+  if (!file) {
+    return false;
+  }
+  std::string text = Format();
+  bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+  fclose(file);
+  return written;
+}
+
+void TitleProfile::Record(const std::map<std::string, std::string>& options,
+                          uint64_t frames, double frame_time_ms) {
+  if (!frames) {
+    return;
+  }
+  for (Configuration& configuration : configurations_) {
+    if (configuration.options != options) {
+      continue;
+    }
+    uint64_t total_frames = configuration.frames + frames;
+    configuration.frame_time_ms =
+        (configuration.frame_time_ms * double(configuration.frames) +
+         frame_time_ms * double(frames)) /
+        double(total_frames);
+    configuration.frames = total_frames;
+    return;
+  }
+  Configuration& configuration = configurations_.emplace_back();
+  configuration.options = options;
+  configuration.frames = frames;
+  configuration.frame_time_ms = frame_time_ms;
+}
+
+const TitleProfile::Configuration* TitleProfile::GetBest(
+    uint64_t min_frames) const {
+  const Configuration* best = nullptr;
+  for (const Configuration& configuration : configurations_) {
+    if (configuration.frames >= min_frames &&
+        (!best || configuration.frame_time_ms < best->frame_time_ms)) {
+      best = &configuration;
+    }
+  }
+  return best;
+}
+
+}  // namespace xe
@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_TITLE_PROFILE_H_
+#define XENIA_BASE_TITLE_PROFILE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xe {
+
+// Measured performance of the configurations of the performance-related
+// options a title has been played with, for selecting the best known one
+// automatically on the next launches. A profile is a TOML file per title, so
+// profiles measured on one machine can be distributed to others:
+//   [[configuration]]
+//   frames = 36000
+//   frame_time_ms = 16.683
+//   [configuration.options]
+//   draw_resolution_scale_x = 2
+//   render_target_path_d3d12 = "rov"
+class TitleProfile {
+ public:
+  struct Configuration {
+    // Option names and values as TOML literals.
+    std::map<std::string, std::string> options;
+    // Number of frames measured with the configuration in all runs.
+    uint64_t frames = 0;
+    // Mean over all the measured frames.
+    double frame_time_ms = 0.0;
+  };
+
+  const std::vector<Configuration>& configurations() const {
+    return configurations_;
+  }
+
+  // Replaces the configurations. False if the text is not a valid profile, in
+  // which case the profile is left empty.
+  bool Parse(std::string_view text);
+  std::string Format() const;
+  // A missing file is loaded as an empty profile.
+  bool Load(const std::filesystem::path& path);
+  bool Save(const std::filesystem::path& path) const;
+
+  // Adds the measurement to the configuration with the same options, or
+  // creates one.
+  void Record(const std::map<std::string, std::string>& options,
+              uint64_t frames, double frame_time_ms);
+
+  // The configuration with the lowest mean frame time among those measured
+  // over at least min_frames frames, or nullptr if there are none.
+  const Configuration* GetBest(uint64_t min_frames) const;
+
+ private:
+  std::vector<Configuration> configurations_;
+};
+
+}  // namespace xe
+
+#endif  // XENIA_BASE_TITLE_PROFILE_H_
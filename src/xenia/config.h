@@ -17,6 +17,7 @@ toml::parse_result ParseFile(const std::filesystem::path& filename);
 
 namespace config {
 void SetupConfig(const std::filesystem::path& config_folder);
+std::filesystem::path GetGameConfigPath(const std::string_view title_id);
 void LoadGameConfig(const std::string_view title_id);
 void SaveConfig();
 }  // namespace config
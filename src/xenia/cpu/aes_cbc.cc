@@ -0,0 +1,205 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/aes_cbc.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "xenia/base/byte_order.h"
+#include "xenia/base/platform.h"
+
+#if XE_ARCH_AMD64
+#include <immintrin.h>
+#define XBYAK_NO_OP_NAMES
+#include "third_party/xbyak/xbyak/xbyak_util.h"
+#elif XE_ARCH_ARM64 && defined(__ARM_FEATURE_AES)
+#include <arm_neon.h>
+#endif
+
+#include "third_party/crypto/rijndael-alg-fst.c"
+#include "third_party/crypto/rijndael-alg-fst.h"
+
+namespace xe {
+namespace cpu {
+
+namespace {
+
+// Blocks decrypted at once, enough to cover the latency of the AES
+// instructions on current hosts.
+constexpr size_t kParallelBlocks = 8;
+
+#if XE_ARCH_AMD64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define XE_AES_NI_TARGET __attribute__((target("aes")))
+#else
+#define XE_AES_NI_TARGET
+#endif
+
+XE_AES_NI_TARGET void DecryptBlocksAesNi(const uint8_t (*round_keys)[16],
+                                         int rounds, const uint8_t* input,
+                                         size_t block_count, uint8_t* output,
+                                         uint8_t* ivec) {
+  __m128i keys[MAXNR + 1];
+  for (int i = 0; i <= rounds; ++i) {
+    keys[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(round_keys[i]));
+  }
+  __m128i previous = _mm_load_si128(reinterpret_cast<const __m128i*>(ivec));
+  size_t i = 0;
+  for (; i + kParallelBlocks <= block_count; i += kParallelBlocks) {
+    __m128i ciphertext[kParallelBlocks];
+    __m128i blocks[kParallelBlocks];
+    for (size_t j = 0; j < kParallelBlocks; ++j) {
+      ciphertext[j] = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(input + (i + j) * 16));
+      blocks[j] = _mm_xor_si128(ciphertext[j], keys[0]);
+    }
+    for (int round = 1; round < rounds; ++round) {
+      for (size_t j = 0; j < kParallelBlocks; ++j) {
+        blocks[j] = _mm_aesdec_si128(blocks[j], keys[round]);
+      }
+    }
+    for (size_t j = 0; j < kParallelBlocks; ++j) {
+      blocks[j] = _mm_aesdeclast_si128(blocks[j], keys[rounds]);
+      blocks[j] = _mm_xor_si128(blocks[j], previous);
+      previous = ciphertext[j];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + (i + j) * 16),
+                       blocks[j]);
+    }
+  }
+  for (; i < block_count; ++i) {
+    __m128i ciphertext =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * 16));
+    __m128i block = _mm_xor_si128(ciphertext, keys[0]);
+    for (int round = 1; round < rounds; ++round) {
+      block = _mm_aesdec_si128(block, keys[round]);
+    }
+    block = _mm_aesdeclast_si128(block, keys[rounds]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 16),
+                     _mm_xor_si128(block, previous));
+    previous = ciphertext;
+  }
+  _mm_store_si128(reinterpret_cast<__m128i*>(ivec), previous);
+}
+
+#elif XE_ARCH_ARM64 && defined(__ARM_FEATURE_AES)
+
+// AESD adds the round key before the inverse substitution, unlike AESDEC, so
+// the keys are shifted by one round, and the last one is a separate XOR.
+void DecryptBlocksArmCrypto(const uint8_t (*round_keys)[16], int rounds,
+                            const uint8_t* input, size_t block_count,
+                            uint8_t* output, uint8_t* ivec) {
+  uint8x16_t keys[MAXNR + 1];
+  for (int i = 0; i <= rounds; ++i) {
+    keys[i] = vld1q_u8(round_keys[i]);
+  }
+  uint8x16_t previous = vld1q_u8(ivec);
+  size_t i = 0;
+  for (; i + kParallelBlocks <= block_count; i += kParallelBlocks) {
+    uint8x16_t ciphertext[kParallelBlocks];
+    uint8x16_t blocks[kParallelBlocks];
+    for (size_t j = 0; j < kParallelBlocks; ++j) {
+      ciphertext[j] = vld1q_u8(input + (i + j) * 16);
+      blocks[j] = ciphertext[j];
+    }
+    for (int round = 0; round < rounds - 1; ++round) {
+      for (size_t j = 0; j < kParallelBlocks; ++j) {
+        blocks[j] = vaesimcq_u8(vaesdq_u8(blocks[j], keys[round]));
+      }
+    }
+    for (size_t j = 0; j < kParallelBlocks; ++j) {
+      blocks[j] = veorq_u8(vaesdq_u8(blocks[j], keys[rounds - 1]),
+                           keys[rounds]);
+      vst1q_u8(output + (i + j) * 16, veorq_u8(blocks[j], previous));
+      previous = ciphertext[j];
+    }
+  }
+  for (; i < block_count; ++i) {
+    uint8x16_t ciphertext = vld1q_u8(input + i * 16);
+    uint8x16_t block = ciphertext;
+    for (int round = 0; round < rounds - 1; ++round) {
+      block = vaesimcq_u8(vaesdq_u8(block, keys[round]));
+    }
+    block = veorq_u8(vaesdq_u8(block, keys[rounds - 1]), keys[rounds]);
+    vst1q_u8(output + i * 16, veorq_u8(block, previous));
+    previous = ciphertext;
+  }
+  vst1q_u8(ivec, previous);
+}
+
+#endif  // XE_ARCH
+
+}  // namespace
+
+AesCbcDecryptor::AesCbcDecryptor(const uint8_t* key) {
+  rounds_ = rijndaelKeySetupDec(round_key_words_, key, 128);
+  // The words are loaded from the bytes as big-endian.
+  for (int i = 0; i < 4 * (rounds_ + 1); ++i) {
+    uint32_t word = xe::byte_swap(round_key_words_[i]);
+    std::memcpy(&round_keys_[i / 4][(i % 4) * 4], &word, sizeof(word));
+  }
+#if XE_ARCH_AMD64
+  accelerated_ = Xbyak::util::Cpu().has(Xbyak::util::Cpu::tAESNI);
+#elif XE_ARCH_ARM64 && defined(__ARM_FEATURE_AES)
+  // Only when building for hosts that all have the instructions.
+  accelerated_ = true;
+#endif
+}
+
+void AesCbcDecryptor::Decrypt(const uint8_t* input, size_t size,
+                              uint8_t* output) {
+  size_t block_count = size / kBlockSize;
+  if (accelerated_) {
+#if XE_ARCH_AMD64
+    DecryptBlocksAesNi(round_keys_, rounds_, input, block_count, output,
+                       ivec_);
+#elif XE_ARCH_ARM64 && defined(__ARM_FEATURE_AES)
+    DecryptBlocksArmCrypto(round_keys_, rounds_, input, block_count, output,
+                           ivec_);
+#endif
+  } else {
+    DecryptBlocksPortable(input, block_count, output);
+  }
+  size_t remainder = size % kBlockSize;
+  if (remainder) {
+    // The images only consist of whole blocks, but the tail is decrypted as
+    // before, without going past the ends of the buffers.
+    uint8_t block[kBlockSize] = {};
+    std::memcpy(block, input + block_count * kBlockSize, remainder);
+    DecryptBlocksPortable(block, 1, block);
+    std::memcpy(output + block_count * kBlockSize, block, remainder);
+  }
+}
+
+void AesCbcDecryptor::DecryptBlocksPortable(const uint8_t* input,
+                                            size_t block_count,
+                                            uint8_t* output) {
+  for (size_t n = 0; n < block_count; ++n) {
+    uint8_t ciphertext[kBlockSize];
+    std::memcpy(ciphertext, input + n * kBlockSize, kBlockSize);
+    uint8_t* plaintext = output + n * kBlockSize;
+    rijndaelDecrypt(round_key_words_, rounds_, ciphertext, plaintext);
+    for (size_t i = 0; i < kBlockSize; ++i) {
+      plaintext[i] ^= ivec_[i];
+    }
+    std::memcpy(ivec_, ciphertext, kBlockSize);
+  }
+}
+
+void aes_decrypt_buffer(const uint8_t* session_key, const uint8_t* input_buffer,
+                        const size_t input_size, uint8_t* output_buffer,
+                        const size_t output_size) {
+  AesCbcDecryptor decryptor(session_key);
+  decryptor.Decrypt(input_buffer, std::min(input_size, output_size),
+                    output_buffer);
+}
+
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,59 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_AES_CBC_H_
+#define XENIA_CPU_AES_CBC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace xe {
+namespace cpu {
+
+// AES-128 CBC decryption of XEX images and patches, using the AES
+// instructions of the host where available. Unlike encryption, CBC decryption
+// of multiple blocks is independent, so several blocks are decrypted at once
+// to hide the latency of the instructions. The chaining state is kept between
+// the calls, for images decrypted in pieces.
+class AesCbcDecryptor {
+ public:
+  static constexpr size_t kBlockSize = 16;
+
+  // The initialization vector is zero.
+  explicit AesCbcDecryptor(const uint8_t* key);
+
+  // The contents of a trailing partial block are undefined. The input and the
+  // output may be the same buffer.
+  void Decrypt(const uint8_t* input, size_t size, uint8_t* output);
+
+  // Whether the host AES instructions are used.
+  bool is_accelerated() const { return accelerated_; }
+
+ private:
+  void DecryptBlocksPortable(const uint8_t* input, size_t block_count,
+                             uint8_t* output);
+
+  // Decryption schedule of the equivalent inverse cipher, in the layout of the
+  // portable implementation, and as bytes for the host instructions.
+  uint32_t round_key_words_[4 * 15];
+  alignas(16) uint8_t round_keys_[15][kBlockSize];
+  int rounds_;
+  alignas(16) uint8_t ivec_[kBlockSize] = {};
+  bool accelerated_ = false;
+};
+
+// Decrypts a whole buffer with a zero initialization vector.
+void aes_decrypt_buffer(const uint8_t* session_key, const uint8_t* input_buffer,
+                        const size_t input_size, uint8_t* output_buffer,
+                        const size_t output_size);
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_AES_CBC_H_
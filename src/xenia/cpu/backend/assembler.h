@@ -41,6 +41,10 @@ class Assembler {
                         uint32_t debug_info_flags,
                         std::unique_ptr<FunctionDebugInfo> debug_info) = 0;
 
+  // Host floating-point mode switches and checks left in the code of the last
+  // assembled function.
+  virtual uint32_t last_fp_mode_switch_count() const { return 0; }
+
  protected:
   Backend* backend_;
 };
@@ -10,6 +10,7 @@
 #ifndef XENIA_CPU_BACKEND_BACKEND_H_
 #define XENIA_CPU_BACKEND_BACKEND_H_
 
+#include <filesystem>
 #include <memory>
 
 #include "xenia/cpu/backend/machine_info.h"
@@ -63,6 +64,25 @@ class Backend {
   virtual std::unique_ptr<GuestFunction> CreateGuestFunction(
       Module* module, uint32_t address) = 0;
 
+  // Loads the machine code of the functions of the module translated in
+  // previous launches from the storage directory, and starts storing newly
+  // translated functions there.
+  virtual void InitializeCodeStorage(
+      Module* module, const std::filesystem::path& storage_root) {}
+  // Sets up a function being defined from the stored machine code instead of
+  // translating it, returns whether it was found in the storage.
+  virtual bool RestoreFunction(GuestFunction* function) { return false; }
+  // Makes calls to the guest function no longer reach its current code, for
+  // instance, when its module is unloaded.
+  virtual void RemoveFunction(uint32_t guest_address) {}
+  // Drops the stored code of the functions with code in [guest_low,
+  // guest_high), which has been modified in memory.
+  virtual void DiscardStoredFunctions(uint32_t guest_low, uint32_t guest_high) {
+  }
+  // Number of reserved stores (stwcx.) that failed because another thread
+  // stored to the reservation granule since the reserved load, for profiling.
+  virtual uint64_t GetReservationContentionCount() const { return 0; }
+
   // Calculates the next host instruction based on the current thread state and
   // current PC. This will look for branches and other control flow
   // instructions.
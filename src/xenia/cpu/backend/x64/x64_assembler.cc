@@ -18,6 +18,7 @@
 #include "xenia/base/string.h"
 #include "xenia/cpu/backend/x64/x64_backend.h"
 #include "xenia/cpu/backend/x64/x64_code_cache.h"
+#include "xenia/cpu/backend/x64/x64_code_storage.h"
 #include "xenia/cpu/backend/x64/x64_emitter.h"
 #include "xenia/cpu/backend/x64/x64_function.h"
 #include "xenia/cpu/cpu_flags.h"
@@ -67,6 +68,10 @@ void X64Assembler::Reset() {
   Assembler::Reset();
 }
 
+uint32_t X64Assembler::last_fp_mode_switch_count() const {
+  return emitter_->mxcsr_mode_switch_count();
+}
+
 bool X64Assembler::Assemble(GuestFunction* function, HIRBuilder* builder,
                             uint32_t debug_info_flags,
                             std::unique_ptr<FunctionDebugInfo> debug_info) {
@@ -102,6 +107,9 @@ bool X64Assembler::Assemble(GuestFunction* function, HIRBuilder* builder,
       ->AddIndirection(function->address(),
                        static_cast<uint32_t>(host_address));
 
+  x64_backend_->code_storage()->StoreFunction(function, *emitter_,
+                                              debug_info_flags);
+
   return true;
 }
 
@@ -39,6 +39,8 @@ class X64Assembler : public Assembler {
                 uint32_t debug_info_flags,
                 std::unique_ptr<FunctionDebugInfo> debug_info) override;
 
+  uint32_t last_fp_mode_switch_count() const override;
+
  private:
   void DumpMachineCode(void* machine_code, size_t code_size,
                        const std::vector<SourceMapEntry>& source_map,
@@ -18,6 +18,7 @@
 #include "xenia/base/logging.h"
 #include "xenia/cpu/backend/x64/x64_assembler.h"
 #include "xenia/cpu/backend/x64/x64_code_cache.h"
+#include "xenia/cpu/backend/x64/x64_code_storage.h"
 #include "xenia/cpu/backend/x64/x64_emitter.h"
 #include "xenia/cpu/backend/x64/x64_function.h"
 #include "xenia/cpu/backend/x64/x64_sequences.h"
@@ -41,6 +42,13 @@ DEFINE_bool(enable_host_guest_stack_synchronization, true,
             "and checks for reentry at return sites. Has slight performance "
             "impact, but fixes crashes in games that use setjmp/longjmp.",
             "x64");
+DEFINE_bool(lazy_host_guest_stack_synchronization, false,
+            "With enable_host_guest_stack_synchronization, only records "
+            "stackpoints in functions whose body was found to be reentered by "
+            "longjmp-like unwinding, remembered in the infocache, instead of "
+            "in all of them. The first reentry of each such function leaks "
+            "host stack frames as if synchronization was disabled.",
+            "x64");
 #if XE_X64_PROFILER_AVAILABLE == 1
 DECLARE_bool(instrument_call_times);
 #endif
@@ -140,6 +148,8 @@ X64Backend::~X64Backend() {
     cs_close(&capstone_handle_);
   }
 
+  code_storage_.reset();
+
   X64Emitter::FreeConstData(emitter_data_);
   ExceptionHandler::Uninstall(&ExceptionCallbackThunk, this);
   if (guest_trampoline_memory_) {
@@ -290,6 +300,8 @@ bool X64Backend::Initialize(Processor* processor) {
   vrsqrtefp_vector_helper =
       thunk_emitter.EmitVectorVRsqrteHelper(vrsqrtefp_scalar_helper);
   frsqrtefp_helper = thunk_emitter.EmitFrsqrteHelper();
+
+  code_storage_ = std::make_unique<X64CodeStorage>(this);
   // Set the code cache to use the ResolveFunction thunk for default
   // indirections.
   assert_zero(uint64_t(resolve_function_thunk_) & 0xFFFFFFFF00000000ull);
@@ -337,6 +349,28 @@ std::unique_ptr<GuestFunction> X64Backend::CreateGuestFunction(
   return std::make_unique<X64Function>(module, address);
 }
 
+void X64Backend::InitializeCodeStorage(
+    Module* module, const std::filesystem::path& storage_root) {
+  code_storage_->Initialize(module, storage_root);
+}
+
+bool X64Backend::RestoreFunction(GuestFunction* function) {
+  return code_storage_->RestoreFunction(function);
+}
+
+uint64_t X64Backend::GetReservationContentionCount() const {
+  return reserve_helper_.contention_count.load(std::memory_order_relaxed);
+}
+
+void X64Backend::RemoveFunction(uint32_t guest_address) {
+  code_cache_->RemoveIndirection(guest_address);
+}
+
+void X64Backend::DiscardStoredFunctions(uint32_t guest_low,
+                                        uint32_t guest_high) {
+  code_storage_->DiscardFunctions(guest_low, guest_high);
+}
+
 uint64_t ReadCapstoneReg(HostThreadContext* context, x86_reg reg) {
   switch (reg) {
     case X86_REG_RAX:
@@ -576,12 +610,7 @@ void X64Backend::RecordMMIOExceptionForGuestInstruction(void* host_address) {
       XexModule* xex_guest_module = dynamic_cast<XexModule*>(guest_module);
 
       if (xex_guest_module) {
-        cpu::InfoCacheFlags* icf =
-            xex_guest_module->GetInstructionAddressFlags(guestaddr);
-
-        if (icf) {
-          icf->accessed_mmio = true;
-        }
+        xex_guest_module->RecordMMIOAccess(guestaddr);
       }
     }
   }
@@ -962,8 +991,12 @@ void* X64HelperEmitter::EmitGuestAndHostSynchronizeStackHelper() {
   jmp(looper, T_NEAR);
   L(loopout);
   Xbyak::Label skip_adjust{};
-  cmp(r12d, 1);  // should never happen?
-  jle(skip_adjust, T_NEAR);
+  // Lazily recorded stackpoints may be only of the frame reentered, and the
+  // stack is only misaligned on reentry.
+  if (!cvars::lazy_host_guest_stack_synchronization) {
+    cmp(r12d, 1);  // should never happen?
+    jle(skip_adjust, T_NEAR);
+  }
   Xbyak::Label we_good{};
 
   // now we need to make sure that the return address matches
@@ -1488,35 +1521,22 @@ void* X64HelperEmitter::EmitTryAcquireReservationHelper() {
   _code_offsets code_offsets = {};
   code_offsets.prolog = getSize();
 
-  Xbyak::Label already_has_a_reservation;
-  Xbyak::Label acquire_new_reservation;
-
-  btr(GetBackendFlagsPtr(), kX64BackendHasReserveBit);
+  // ecx = guest addr, rax must be preserved
   mov(r8, GetBackendCtxPtr(offsetof(X64BackendContext, reserve_helper_)));
-  jc(already_has_a_reservation);
-
-  shr(ecx, RESERVE_BLOCK_SHIFT);
-  xor_(r9d, r9d);
   mov(edx, ecx);
-  shr(edx, 6);  // divide by 64
-  lea(rdx, ptr[r8 + rdx * 8]);
-  and_(ecx, 64 - 1);
-
-  lock();
-  bts(qword[rdx], rcx);
-  // set flag on local backend context for thread to indicate our previous
-  // attempt to get the reservation succeeded
-  setnc(r9b);  // success = bitmap did not have a set bit at the idx
-  shl(r9b, kX64BackendHasReserveBit);
-
+  shr(edx, RESERVE_GRANULE_SHIFT);
+  and_(edx, RESERVE_NUM_ENTRIES - 1);
+  shl(edx, 6);  // sizeof(ReserveHelper::Entry)
+  add(rdx, r8);
+  // A new reservation replaces the previous one, there's nothing to release.
+  // The version is loaded before the value, which x86 doesn't reorder.
+  mov(ecx, dword[rdx]);
   mov(GetBackendCtxPtr(offsetof(X64BackendContext, cached_reserve_offset)),
       rdx);
-  mov(GetBackendCtxPtr(offsetof(X64BackendContext, cached_reserve_bit)), ecx);
-
-  or_(GetBackendCtxPtr(offsetof(X64BackendContext, flags)), r9d);
+  mov(GetBackendCtxPtr(offsetof(X64BackendContext, cached_reserve_version)),
+      ecx);
+  bts(GetBackendFlagsPtr(), kX64BackendHasReserveBit);
   ret();
-  L(already_has_a_reservation);
-  DebugBreak();
 
   code_offsets.prolog_stack_alloc = getSize();
   code_offsets.body = getSize();
@@ -1527,74 +1547,63 @@ void* X64HelperEmitter::EmitTryAcquireReservationHelper() {
 // ecx=guest addr
 // r9 = host addr
 // r8 = value
-// if ZF is set and CF is set, we succeeded
+// if ZF is set, we succeeded
 void* X64HelperEmitter::EmitReservedStoreHelper(bool bit64) {
   _code_offsets code_offsets = {};
   code_offsets.prolog = getSize();
-  Xbyak::Label done;
-  Xbyak::Label reservation_isnt_for_our_addr;
-  Xbyak::Label somehow_double_cleared;
-  // carry must be set + zero flag must be set
+  Xbyak::Label contended;
+  Xbyak::Label failed;
 
   btr(GetBackendFlagsPtr(), kX64BackendHasReserveBit);
-
-  jnc(done);
+  jnc(failed);
 
   mov(rax, GetBackendCtxPtr(offsetof(X64BackendContext, reserve_helper_)));
-
-  shr(ecx, RESERVE_BLOCK_SHIFT);
   mov(edx, ecx);
-  shr(edx, 6);  // divide by 64
-  lea(rdx, ptr[rax + rdx * 8]);
-  // begin acquiring exclusive access to cacheline containing our bit
+  shr(edx, RESERVE_GRANULE_SHIFT);
+  and_(edx, RESERVE_NUM_ENTRIES - 1);
+  shl(edx, 6);  // sizeof(ReserveHelper::Entry)
+  add(rdx, rax);
+  // begin acquiring exclusive access to the cacheline of the version
   prefetchw(ptr[rdx]);
 
+  // Storing to another granule than the reserved one is allowed to fail.
   cmp(GetBackendCtxPtr(offsetof(X64BackendContext, cached_reserve_offset)),
       rdx);
-  jnz(reservation_isnt_for_our_addr);
+  jnz(failed);
+
+  // Odd if another thread was in the middle of a reserved store at lwarx.
+  mov(eax,
+      GetBackendCtxPtr(offsetof(X64BackendContext, cached_reserve_version)));
+  test(al, 1);
+  jnz(contended);
+  lea(ecx, ptr[rax + 1]);
+  lock();
+  cmpxchg(dword[rdx], ecx);
+  jnz(contended);
 
+  // was our memory modified by a normal store or kernel code?
   mov(rax,
       GetBackendCtxPtr(offsetof(X64BackendContext, cached_reserve_value_)));
-
-  // we need modulo bitsize, it turns out bittests' modulus behavior for the
-  // bitoffset only applies for register operands, for memory ones we bug out
-  // todo: actually, the above note may not be true, double check it
-  and_(ecx, 64 - 1);
-  cmp(GetBackendCtxPtr(offsetof(X64BackendContext, cached_reserve_bit)), ecx);
-  jnz(reservation_isnt_for_our_addr);
-
-  // was our memory modified by kernel code or something?
   lock();
   if (bit64) {
     cmpxchg(ptr[r9], r8);
-
   } else {
     cmpxchg(ptr[r9], r8d);
   }
-  // the ZF flag is unaffected by BTR! we exploit this for the retval
+  // Unlock with the next even version, lea and mov keep ZF of the cmpxchg as
+  // the result.
+  lea(ecx, ptr[rcx + 1]);
+  mov(dword[rdx], ecx);
+  ret();
 
-  // cancel our lock on the 65k block
+  L(contended);
+  mov(rax, GetBackendCtxPtr(offsetof(X64BackendContext, reserve_helper_)));
   lock();
-  btr(qword[rdx], rcx);
-
-  jnc(somehow_double_cleared);
-
-  L(done);
-  // i don't care that theres a dependency on the prev value of rax atm
-  // sadly theres no CF&ZF condition code
-  setz(al);
-  setc(ah);
-  cmp(ax, 0x0101);
+  inc(qword[rax + offsetof(ReserveHelper, contention_count)]);
+  L(failed);
+  or_(eax, 1);  // clear ZF
   ret();
 
-  // could be the same label, but otherwise we don't know where we came from
-  // when one gets triggered
-  L(reservation_isnt_for_our_addr);
-  DebugBreak();
-
-  L(somehow_double_cleared);  // somehow, something else cleared our reserve??
-  DebugBreak();
-
   code_offsets.prolog_stack_alloc = getSize();
   code_offsets.body = getSize();
   code_offsets.epilog = getSize();
@@ -1753,7 +1762,9 @@ void X64Backend::SetGuestRoundingMode(void* ctx, unsigned int mode) {
 }
 
 bool X64Backend::PopulatePseudoStacktrace(GuestPseudoStackTrace* st) {
-  if (!cvars::enable_host_guest_stack_synchronization) {
+  // Lazily recorded stackpoints are of only a few of the frames.
+  if (!cvars::enable_host_guest_stack_synchronization ||
+      cvars::lazy_host_guest_stack_synchronization) {
     return false;
   }
 
@@ -10,6 +10,8 @@
 #ifndef XENIA_CPU_BACKEND_X64_X64_BACKEND_H_
 #define XENIA_CPU_BACKEND_X64_X64_BACKEND_H_
 
+#include <atomic>
+#include <cstring>
 #include <memory>
 
 #include "xenia/base/bit_map.h"
@@ -27,6 +29,7 @@
 DECLARE_int64(x64_extension_mask);
 DECLARE_int64(max_stackpoints);
 DECLARE_bool(enable_host_guest_stack_synchronization);
+DECLARE_bool(lazy_host_guest_stack_synchronization);
 namespace xe {
 class Exception;
 }  // namespace xe
@@ -38,6 +41,7 @@ namespace x64 {
 using GuestProfilerData = std::map<uint32_t, uint64_t>;
 
 class X64CodeCache;
+class X64CodeStorage;
 
 typedef void* (*HostToGuestThunk)(void* target, void* arg0, void* arg1);
 typedef void* (*GuestToHostThunk)(void* target, void* arg0, void* arg1);
@@ -57,15 +61,29 @@ static constexpr uint32_t GUEST_TRAMPOLINE_MIN_LEN = 8;
 static constexpr uint32_t MAX_GUEST_TRAMPOLINES =
     (GUEST_TRAMPOLINE_END - GUEST_TRAMPOLINE_BASE) / GUEST_TRAMPOLINE_MIN_LEN;
 
-#define RESERVE_BLOCK_SHIFT 16
-
-#define RESERVE_NUM_ENTRIES \
-  ((1024ULL * 1024ULL * 1024ULL * 4ULL) >> RESERVE_BLOCK_SHIFT)
+// The reservation granule of the Xenon is a 128-byte cache line.
+#define RESERVE_GRANULE_SHIFT 7
+// Granules are hashed into the version table, aliasing only causes spurious
+// stwcx. failures.
+#define RESERVE_NUM_ENTRIES 16384
 // https://codalogic.com/blog/2022/12/06/Exploring-PowerPCs-read-modify-write-operations
+// lwarx records the version of the granule, stwcx. locks the granule by
+// making the version odd with a lock cmpxchg if it's still the recorded one,
+// compares and exchanges the value, and unlocks it with the next even version.
+// Threads only contend when they use the same granule.
 struct ReserveHelper {
-  uint64_t blocks[RESERVE_NUM_ENTRIES / 64];
+  // One host cache line per entry so that atomics in neighboring guest lines
+  // don't share one.
+  struct alignas(64) Entry {
+    uint32_t version;
+  };
+  static_assert(sizeof(Entry) == 64);
+  Entry entries[RESERVE_NUM_ENTRIES];
+  // Failed stwcx. due to another reserved store to the granule since lwarx,
+  // incremented with lock inc by the generated code.
+  alignas(64) std::atomic<uint64_t> contention_count{0};
 
-  ReserveHelper() { memset(blocks, 0, sizeof(blocks)); }
+  ReserveHelper() { memset(entries, 0, sizeof(entries)); }
 };
 
 struct X64BackendStackpoint {
@@ -100,8 +118,9 @@ struct X64BackendContext {
   uint64_t* guest_tick_count;
   // records mapping of host_stack to guest_stack
   X64BackendStackpoint* stackpoints;
+  // host address of the reservation table entry and its version at lwarx
   uint64_t cached_reserve_offset;
-  uint32_t cached_reserve_bit;
+  uint32_t cached_reserve_version;
   unsigned int current_stackpoint_depth;
   unsigned int mxcsr_fpu;  // currently, the way we implement rounding mode
                            // affects both vmx and the fpu
@@ -126,6 +145,7 @@ class X64Backend : public Backend {
   ~X64Backend() override;
 
   X64CodeCache* code_cache() const { return code_cache_.get(); }
+  X64CodeStorage* code_storage() const { return code_storage_.get(); }
   uintptr_t emitter_data() const { return emitter_data_; }
 
   // Call a generated function, saving all stack parameters.
@@ -159,6 +179,12 @@ class X64Backend : public Backend {
   std::unique_ptr<GuestFunction> CreateGuestFunction(Module* module,
                                                      uint32_t address) override;
 
+  void InitializeCodeStorage(
+      Module* module, const std::filesystem::path& storage_root) override;
+  bool RestoreFunction(GuestFunction* function) override;
+  void RemoveFunction(uint32_t guest_address) override;
+  void DiscardStoredFunctions(uint32_t guest_low, uint32_t guest_high) override;
+
   uint64_t CalculateNextHostInstruction(ThreadDebugInfo* thread_info,
                                         uint64_t current_pc) override;
 
@@ -190,6 +216,8 @@ class X64Backend : public Backend {
 #if XE_X64_PROFILER_AVAILABLE == 1
   uint64_t* GetProfilerRecordForFunction(uint32_t guest_address);
 #endif
+  uint64_t GetReservationContentionCount() const override;
+
  private:
   static bool ExceptionCallbackThunk(Exception* ex, void* data);
   bool ExceptionCallback(Exception* ex);
@@ -197,6 +225,7 @@ class X64Backend : public Backend {
   uintptr_t capstone_handle_ = 0;
 
   std::unique_ptr<X64CodeCache> code_cache_;
+  std::unique_ptr<X64CodeStorage> code_storage_;
   uintptr_t emitter_data_ = 0;
 
   HostToGuestThunk host_to_guest_thunk_;
@@ -9,6 +9,7 @@
 
 #include "xenia/cpu/backend/x64/x64_code_cache.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
@@ -136,9 +137,77 @@ void X64CodeCache::AddIndirection(uint32_t guest_address,
     return;
   }
 
+  SetIndirection(guest_address, host_address);
+}
+
+void X64CodeCache::RemoveIndirection(uint32_t guest_address) {
+  if (!indirection_table_base_) {
+    return;
+  }
+
+  SetIndirection(guest_address, indirection_default_value_);
+}
+
+void X64CodeCache::AddPatchableCallSite(uint32_t target_guest_address,
+                                        void* call_execute_address) {
+  if (!indirection_table_base_) {
+    return;
+  }
+
+  PatchableCallSite call_site;
+  call_site.displacement_execute_address =
+      reinterpret_cast<uint8_t*>(call_execute_address) + 1;
+  assert_zero(reinterpret_cast<uintptr_t>(
+                  call_site.displacement_execute_address) &
+              3);
+  std::memcpy(&call_site.unpatched_displacement,
+              call_site.displacement_execute_address, sizeof(int32_t));
+
+  auto global_lock = global_critical_region_.Acquire();
+  patchable_call_sites_[target_guest_address].push_back(call_site);
+  // The target may have been placed before the call site was registered.
+  uint32_t host_address = *reinterpret_cast<const uint32_t*>(
+      indirection_table_base_ +
+      (target_guest_address - kIndirectionTableBase));
+  if (host_address != indirection_default_value_) {
+    PatchCallSite(call_site, host_address);
+  }
+}
+
+void X64CodeCache::SetIndirection(uint32_t guest_address,
+                                  uint32_t host_address) {
+  auto global_lock = global_critical_region_.Acquire();
+
   uint32_t* indirection_slot = reinterpret_cast<uint32_t*>(
       indirection_table_base_ + (guest_address - kIndirectionTableBase));
   *indirection_slot = host_address;
+
+  auto call_sites_it = patchable_call_sites_.find(guest_address);
+  if (call_sites_it != patchable_call_sites_.end()) {
+    for (const PatchableCallSite& call_site : call_sites_it->second) {
+      PatchCallSite(call_site, host_address);
+    }
+  }
+}
+
+void X64CodeCache::PatchCallSite(const PatchableCallSite& call_site,
+                                 uint32_t host_address) {
+  int32_t displacement = call_site.unpatched_displacement;
+  if (host_address != indirection_default_value_) {
+    int64_t direct_displacement =
+        int64_t(host_address) -
+        int64_t(reinterpret_cast<uintptr_t>(
+            call_site.displacement_execute_address + sizeof(int32_t)));
+    if (direct_displacement >= INT32_MIN && direct_displacement <= INT32_MAX) {
+      displacement = int32_t(direct_displacement);
+    }
+  }
+  // An aligned 4-byte store, so other threads executing the instruction see
+  // either the old or the new target.
+  auto displacement_write_address = reinterpret_cast<volatile int32_t*>(
+      generated_code_write_base_ + (call_site.displacement_execute_address -
+                                    generated_code_execute_base_));
+  *displacement_write_address = displacement;
 }
 
 void X64CodeCache::CommitExecutableRange(uint32_t guest_low,
@@ -175,6 +244,30 @@ void X64CodeCache::PlaceGuestCode(uint32_t guest_address, void* machine_code,
                                   GuestFunction* function_info,
                                   void*& code_execute_address_out,
                                   void*& code_write_address_out) {
+  PlaceGuestCodeInternal(SIZE_MAX, guest_address, machine_code, func_info,
+                         function_info, code_execute_address_out,
+                         code_write_address_out);
+}
+
+bool X64CodeCache::PlaceGuestCodeAt(size_t code_offset, uint32_t guest_address,
+                                    void* machine_code,
+                                    const EmitFunctionInfo& func_info,
+                                    GuestFunction* function_info,
+                                    void*& code_execute_address_out,
+                                    void*& code_write_address_out) {
+  return PlaceGuestCodeInternal(code_offset, guest_address, machine_code,
+                                func_info, function_info,
+                                code_execute_address_out,
+                                code_write_address_out);
+}
+
+bool X64CodeCache::PlaceGuestCodeInternal(size_t code_offset,
+                                          uint32_t guest_address,
+                                          void* machine_code,
+                                          const EmitFunctionInfo& func_info,
+                                          GuestFunction* function_info,
+                                          void*& code_execute_address_out,
+                                          void*& code_write_address_out) {
   // Hold a lock while we bump the pointers up. This is important as the
   // unwind table requires entries AND code to be sorted in order.
   size_t low_mark;
@@ -184,6 +277,16 @@ void X64CodeCache::PlaceGuestCode(uint32_t guest_address, void* machine_code,
   {
     auto global_lock = global_critical_region_.Acquire();
 
+    if (code_offset != SIZE_MAX) {
+      // Placing at a fixed offset - only possible if nothing has been placed
+      // there yet, as the code map and the unwind table must stay sorted.
+      if (code_offset < generated_code_offset_ ||
+          code_offset + func_info.code_size.total > kGeneratedCodeSize) {
+        return false;
+      }
+      generated_code_offset_ = code_offset;
+    }
+
     low_mark = generated_code_offset_;
 
     // Reserve code.
@@ -283,14 +386,14 @@ void X64CodeCache::PlaceGuestCode(uint32_t guest_address, void* machine_code,
   // Note that we do support code that doesn't have an indirection fixup, so
   // ignore those when we see them.
   if (guest_address && indirection_table_base_) {
-    uint32_t* indirection_slot = reinterpret_cast<uint32_t*>(
-        indirection_table_base_ + (guest_address - kIndirectionTableBase));
-    *indirection_slot =
-        uint32_t(reinterpret_cast<uint64_t>(code_execute_address));
+    SetIndirection(guest_address,
+                   uint32_t(reinterpret_cast<uint64_t>(code_execute_address)));
   }
+
+  return true;
 }
 
-uint32_t X64CodeCache::PlaceData(const void* data, size_t length) {
+uint8_t* X64CodeCache::ReserveData(size_t length) {
   // Hold a lock while we bump the pointers up.
   size_t high_mark;
   uint8_t* data_address = nullptr;
@@ -329,12 +432,39 @@ uint32_t X64CodeCache::PlaceData(const void* data, size_t length) {
   } while (generated_code_commit_mark_.compare_exchange_weak(old_commit_mark,
                                                              new_commit_mark));
 
-  // Copy code.
-  std::memcpy(data_address, data, length);
+  return data_address;
+}
 
+uint32_t X64CodeCache::PlaceData(const void* data, size_t length) {
+  uint8_t* data_address = ReserveData(length);
+  std::memcpy(data_address, data, length);
   return uint32_t(uintptr_t(data_address));
 }
 
+const void* X64CodeCache::PlaceConstant(const vec128_t& value) {
+  std::lock_guard<std::mutex> lock(constant_pool_mutex_);
+  auto it = constant_pool_.find(value);
+  if (it != constant_pool_.end()) {
+    return generated_code_execute_base_ + it->second;
+  }
+  if (constant_pool_chunk_offset_ + sizeof(vec128_t) >
+      constant_pool_chunk_end_) {
+    uint8_t* chunk_write_address = ReserveData(kConstantPoolChunkSize);
+    size_t chunk_offset = xe::align(
+        size_t(chunk_write_address - generated_code_write_base_),
+        kConstantPoolChunkAlignment);
+    constant_pool_chunk_offset_ = chunk_offset;
+    constant_pool_chunk_end_ =
+        size_t(chunk_write_address - generated_code_write_base_) +
+        kConstantPoolChunkSize;
+  }
+  uint32_t offset = uint32_t(constant_pool_chunk_offset_);
+  constant_pool_chunk_offset_ += sizeof(vec128_t);
+  std::memcpy(generated_code_write_base_ + offset, &value, sizeof(vec128_t));
+  constant_pool_.emplace(value, offset);
+  return generated_code_execute_base_ + offset;
+}
+
 GuestFunction* X64CodeCache::LookupFunction(uint64_t host_pc) {
   uint32_t key = uint32_t(host_pc - kGeneratedCodeExecuteBase);
   void* fn_entry = std::bsearch(
@@ -362,6 +492,38 @@ GuestFunction* X64CodeCache::LookupFunction(uint64_t host_pc) {
   }
 }
 
+size_t X64CodeCache::generated_code_offset() {
+  auto global_lock = global_critical_region_.Acquire();
+  return generated_code_offset_;
+}
+
+void X64CodeCache::AdvanceGeneratedCodeOffset(size_t code_offset) {
+  auto global_lock = global_critical_region_.Acquire();
+  generated_code_offset_ =
+      std::max(generated_code_offset_, xe::round_up(code_offset, 16));
+}
+
+bool X64CodeCache::GetPlacedCodeRange(const void* code_execute_address,
+                                      uint32_t& start_offset_out,
+                                      uint32_t& end_offset_out) {
+  uint32_t start_offset = uint32_t(
+      reinterpret_cast<const uint8_t*>(code_execute_address) -
+      generated_code_execute_base_);
+  auto global_lock = global_critical_region_.Acquire();
+  auto it = std::lower_bound(
+      generated_code_map_.cbegin(), generated_code_map_.cend(), start_offset,
+      [](const std::pair<uint64_t, GuestFunction*>& element, uint32_t key) {
+        return uint32_t(element.first >> 32) < key;
+      });
+  if (it == generated_code_map_.cend() ||
+      uint32_t(it->first >> 32) != start_offset) {
+    return false;
+  }
+  start_offset_out = start_offset;
+  end_offset_out = uint32_t(it->first);
+  return true;
+}
+
 }  // namespace x64
 }  // namespace backend
 }  // namespace cpu
@@ -14,12 +14,15 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "xenia/base/memory.h"
 #include "xenia/base/mutex.h"
+#include "xenia/base/vec128.h"
 #include "xenia/cpu/backend/code_cache.h"
 
 namespace xe {
@@ -60,6 +63,15 @@ class X64CodeCache : public CodeCache {
   bool has_indirection_table() { return indirection_table_base_ != nullptr; }
   void set_indirection_default(uint32_t default_value);
   void AddIndirection(uint32_t guest_address, uint32_t host_address);
+  // Resets the indirection to the default value, unpatching the direct calls
+  // to the previous code of the function.
+  void RemoveIndirection(uint32_t guest_address);
+
+  // Registers a call or a jump (with a 4-byte-aligned rel32 displacement) to a
+  // stub calling the guest function via the indirection table, to be patched
+  // into a direct one to the code of the function whenever it's placed.
+  void AddPatchableCallSite(uint32_t target_guest_address,
+                            void* call_execute_address);
 
   void CommitExecutableRange(uint32_t guest_low, uint32_t guest_high);
 
@@ -72,10 +84,35 @@ class X64CodeCache : public CodeCache {
                       GuestFunction* function_info,
                       void*& code_execute_address_out,
                       void*& code_write_address_out);
+  // Places the code at exactly the specified offset from the execute base, for
+  // code restored from the persistent storage, that contains relative
+  // references to other code in the cache. Fails if something has already been
+  // placed at or beyond the offset.
+  bool PlaceGuestCodeAt(size_t code_offset, uint32_t guest_address,
+                        void* machine_code, const EmitFunctionInfo& func_info,
+                        GuestFunction* function_info,
+                        void*& code_execute_address_out,
+                        void*& code_write_address_out);
   uint32_t PlaceData(const void* data, size_t length);
+  // Returns the execute address of the constant in the pool shared by all the
+  // generated code, with each value placed only once and packed into cache
+  // lines, placing it if it's not there yet. Within the rel32 range of all the
+  // generated code.
+  const void* PlaceConstant(const vec128_t& value);
 
   GuestFunction* LookupFunction(uint64_t host_pc) override;
 
+  // Offset from the execute base where the next code will be placed.
+  size_t generated_code_offset();
+  // Leaves the space before the offset unused, so code restored from the
+  // persistent storage later doesn't overlap newly generated code.
+  void AdvanceGeneratedCodeOffset(size_t code_offset);
+  // Returns the offsets of the code (including the unwind information) placed
+  // at the specified execute address.
+  bool GetPlacedCodeRange(const void* code_execute_address,
+                          uint32_t& start_offset_out,
+                          uint32_t& end_offset_out);
+
  protected:
   // All executable code falls within 0x80000000 to 0x9FFFFFFF, so we can
   // only map enough for lookups within that range.
@@ -113,6 +150,26 @@ class X64CodeCache : public CodeCache {
                          void* code_execute_address,
                          UnwindReservation unwind_reservation) {}
 
+  struct PatchableCallSite {
+    // Execute address of the rel32 displacement of the call or the jump.
+    uint8_t* displacement_execute_address;
+    // Displacement to the stub calling the target via the indirection table.
+    int32_t unpatched_displacement;
+  };
+
+  // Reserves space in the generated code region, returning its write address.
+  uint8_t* ReserveData(size_t length);
+
+  void SetIndirection(uint32_t guest_address, uint32_t host_address);
+  void PatchCallSite(const PatchableCallSite& call_site, uint32_t host_address);
+
+  bool PlaceGuestCodeInternal(size_t code_offset, uint32_t guest_address,
+                              void* machine_code,
+                              const EmitFunctionInfo& func_info,
+                              GuestFunction* function_info,
+                              void*& code_execute_address_out,
+                              void*& code_write_address_out);
+
   std::filesystem::path file_name_;
   xe::memory::FileMappingHandle mapping_ =
       xe::memory::kFileMappingHandleInvalid;
@@ -128,6 +185,10 @@ class X64CodeCache : public CodeCache {
   // the generated code table that correspond to the PPC functions in guest
   // space.
   uint8_t* indirection_table_base_ = nullptr;
+  // Call sites to patch when the code of the guest function is placed, by the
+  // guest address of the target.
+  std::unordered_map<uint32_t, std::vector<PatchableCallSite>>
+      patchable_call_sites_;
   // Fixed at kGeneratedCodeExecuteBase and holding all generated code, growing
   // as needed.
   uint8_t* generated_code_execute_base_ = nullptr;
@@ -143,6 +204,22 @@ class X64CodeCache : public CodeCache {
   // This can be used to bsearch on host PC to find the guest function.
   // The key is [start address | end address].
   std::vector<std::pair<uint64_t, GuestFunction*>> generated_code_map_;
+
+  struct ConstantHash {
+    size_t operator()(const vec128_t& value) const {
+      return std::hash<uint64_t>()(value.low ^ (value.high * 31));
+    }
+  };
+  // Space for the constants is reserved in chunks, each starting on a cache
+  // line.
+  static constexpr size_t kConstantPoolChunkSize = 4096;
+  static constexpr size_t kConstantPoolChunkAlignment = 64;
+  std::mutex constant_pool_mutex_;
+  // Offsets of the constants from the execute base.
+  std::unordered_map<vec128_t, uint32_t, ConstantHash> constant_pool_;
+  // Offset of the free space in the current chunk, or 0 if there's none.
+  size_t constant_pool_chunk_offset_ = 0;
+  size_t constant_pool_chunk_end_ = 0;
 };
 
 }  // namespace x64
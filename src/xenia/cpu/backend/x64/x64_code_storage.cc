@@ -0,0 +1,578 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/backend/x64/x64_code_storage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "build/version.h"
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/platform_amd64.h"
+#include "xenia/base/xxhash.h"
+#include "xenia/cpu/backend/x64/x64_backend.h"
+#include "xenia/cpu/backend/x64/x64_emitter.h"
+#include "xenia/cpu/backend/x64/x64_function.h"
+#include "xenia/cpu/backend/x64/x64_tracers.h"
+#include "xenia/cpu/module.h"
+#include "xenia/cpu/processor.h"
+
+DEFINE_bool(store_translated_code, false,
+            "Store the machine code of translated guest functions in the cache "
+            "directory, and reuse it on the next launch of the same "
+            "executable, skipping the translation of them.",
+            "x64");
+DEFINE_bool(share_translated_code, false,
+            "With store_translated_code, keep the stored code in a file shared "
+            "by all emulator instances running at the same time, so functions "
+            "translated by any of them are reused on the next launch of each. "
+            "The file is never cleared automatically, delete it to start over.",
+            "x64");
+
+DECLARE_bool(instrument_call_times);
+
+namespace xe {
+namespace cpu {
+namespace backend {
+namespace x64 {
+
+void X64CodeStorage::Initialize(Module* module,
+                                const std::filesystem::path& storage_root) {
+  if (!cvars::store_translated_code) {
+    return;
+  }
+
+  X64CodeCache* code_cache = backend_->code_cache();
+  std::vector<uint32_t> restore_order;
+  size_t code_end_offset;
+  {
+    std::lock_guard<std::mutex> lock(storage_mutex_);
+    // Only storing the code of the first module - the code placed at fixed
+    // offsets must begin right after the backend thunks.
+    if (module_) {
+      return;
+    }
+    module_ = module;
+
+    host_fingerprint_ = CalculateHostFingerprint();
+    code_base_offset_ = uint32_t(code_cache->generated_code_offset());
+    code_end_offset = code_base_offset_;
+
+    // Later entries for the same function are for code translated in newer
+    // launches - prefer them, but keep the space of all stored functions
+    // reserved as any of them may be restored later.
+    auto add_stored_function = [&](StoredFunction& stored_function) {
+      const StoredFunctionHeader& function_header = stored_function.header;
+      if (function_header.code_offset < code_base_offset_ ||
+          function_header.code_end_offset <= function_header.code_offset ||
+          function_header.code_end_offset > code_cache->total_size()) {
+        return;
+      }
+      code_end_offset =
+          std::max(code_end_offset, size_t(function_header.code_end_offset));
+      restorable_functions_[function_header.guest_address] =
+          std::move(stored_function);
+    };
+
+    std::error_code ec;
+    std::filesystem::create_directories(storage_root, ec);
+    std::filesystem::path file_path;
+    if (cvars::share_translated_code) {
+      // The log can't be cleared while other instances may be using it, so the
+      // code of different builds and configurations goes to separate files.
+      file_path = storage_root / fmt::format("x64_code_{:016X}_{:08X}.shared",
+                                             host_fingerprint_,
+                                             code_base_offset_);
+      shared_log_ =
+          SharedAppendLog::Open(file_path, kVersion, kSharedLogCapacity);
+      if (!shared_log_) {
+        XELOGE("Failed to open the shared translated code storage file {}",
+               xe::path_to_utf8(file_path));
+        return;
+      }
+      // Each record is a function, including the ones stored by the instances
+      // still running.
+      shared_log_->Read(SharedAppendLog::kFirstRecordOffset,
+                        [&](const SharedAppendLog::Record& record) {
+                          const uint8_t* data = record.data;
+                          StoredFunction stored_function;
+                          if (ReadFunction(data, record.data + record.size,
+                                           stored_function)) {
+                            add_stored_function(stored_function);
+                          }
+                        });
+    } else {
+      file_path = storage_root / "x64_code.bin";
+      file_ = xe::filesystem::OpenFile(file_path, "a+b");
+      if (!file_) {
+        XELOGE(
+            "Failed to open the translated code storage file {} for writing",
+            xe::path_to_utf8(file_path));
+        return;
+      }
+
+      StoredHeader header;
+      xe::filesystem::Seek(file_, 0, SEEK_SET);
+      if (fread(&header, sizeof(header), 1, file_) != 1 ||
+          header.magic != kMagic || header.version != kVersion ||
+          header.host_fingerprint != host_fingerprint_ ||
+          header.code_base_offset != code_base_offset_) {
+        WriteHeader();
+        return;
+      }
+
+      // Read the stored functions, dropping the incomplete data at the end
+      // that may be left after a crash.
+      std::vector<uint8_t> stored_data;
+      uint8_t buffer[65536];
+      size_t buffer_bytes_read;
+      while ((buffer_bytes_read = fread(buffer, 1, sizeof(buffer), file_))) {
+        stored_data.insert(stored_data.end(), buffer,
+                           buffer + buffer_bytes_read);
+      }
+      const uint8_t* data = stored_data.data();
+      const uint8_t* data_end = data + stored_data.size();
+      uint64_t valid_bytes = sizeof(header);
+      StoredFunction stored_function;
+      while (ReadFunction(data, data_end, stored_function)) {
+        valid_bytes = sizeof(header) + uint64_t(data - stored_data.data());
+        add_stored_function(stored_function);
+      }
+      xe::filesystem::TruncateStdioFile(file_, valid_bytes);
+    }
+
+    // Start over if the storage is occupying too much of the code cache after
+    // many launches translating different functions.
+    if (code_end_offset - code_base_offset_ > code_cache->total_size() / 2) {
+      restorable_functions_.clear();
+      code_end_offset = code_base_offset_;
+      if (shared_log_) {
+        XELOGW(
+            "Shared translated code storage {} is too large, not using it - "
+            "delete it while no instance is running to start over",
+            xe::path_to_utf8(file_path));
+        shared_log_.reset();
+      } else {
+        XELOGI("Translated code storage is too large, clearing");
+        WriteHeader();
+      }
+      return;
+    }
+
+    // Drop functions that overlap others, stored by instances sharing the
+    // storage that have placed different code at the same offsets, or in case
+    // the file has been corrupted.
+    std::vector<const StoredFunctionHeader*> by_offset;
+    by_offset.reserve(restorable_functions_.size());
+    for (const auto& restorable_function : restorable_functions_) {
+      by_offset.push_back(&restorable_function.second.header);
+    }
+    std::sort(by_offset.begin(), by_offset.end(),
+              [](const StoredFunctionHeader* a, const StoredFunctionHeader* b) {
+                return a->code_offset < b->code_offset;
+              });
+    std::vector<uint32_t> overlapping;
+    uint32_t previous_end_offset = 0;
+    for (const StoredFunctionHeader* function_header : by_offset) {
+      if (function_header->code_offset < previous_end_offset) {
+        overlapping.push_back(function_header->guest_address);
+        continue;
+      }
+      previous_end_offset = function_header->code_end_offset;
+      restore_order.push_back(function_header->guest_address);
+    }
+    for (uint32_t guest_address : overlapping) {
+      restorable_functions_.erase(guest_address);
+    }
+
+    // Functions calling other functions directly can only be restored along
+    // with the callees, as the calls refer to the offsets of the callees - the
+    // code of the callee that was called, as a function may be stored
+    // multiple times at different offsets.
+    bool removed_any;
+    do {
+      removed_any = false;
+      for (auto it = restorable_functions_.begin();
+           it != restorable_functions_.end();) {
+        bool callees_restorable = true;
+        for (const StoredDirectCall& direct_call : it->second.direct_calls) {
+          auto callee_it =
+              restorable_functions_.find(direct_call.target_address);
+          if (callee_it == restorable_functions_.end() ||
+              callee_it->second.header.code_offset !=
+                  direct_call.target_code_offset) {
+            callees_restorable = false;
+            break;
+          }
+        }
+        if (callees_restorable) {
+          ++it;
+        } else {
+          it = restorable_functions_.erase(it);
+          removed_any = true;
+        }
+      }
+    } while (removed_any);
+    restore_order.erase(
+        std::remove_if(restore_order.begin(), restore_order.end(),
+                       [this](uint32_t guest_address) {
+                         return restorable_functions_.find(guest_address) ==
+                                restorable_functions_.end();
+                       }),
+        restore_order.end());
+  }
+
+  // Define the functions through the processor so they're registered like
+  // translated ones, with RestoreFunction placing the code. The order of the
+  // offsets must be preserved, as the code cache is append-only.
+  Processor* processor = backend_->processor();
+  uint32_t restored_count = 0;
+  for (uint32_t guest_address : restore_order) {
+    Function* function = processor->ResolveFunction(guest_address);
+    if (function && function->is_guest() &&
+        static_cast<GuestFunction*>(function)->machine_code()) {
+      ++restored_count;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(storage_mutex_);
+    restorable_functions_.clear();
+  }
+  code_cache->AdvanceGeneratedCodeOffset(code_end_offset);
+  XELOGI("Restored {} translated functions from the code storage",
+         restored_count);
+}
+
+void X64CodeStorage::Shutdown() {
+  std::lock_guard<std::mutex> lock(storage_mutex_);
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+  shared_log_.reset();
+  module_ = nullptr;
+  restorable_functions_.clear();
+}
+
+void X64CodeStorage::DiscardFunctions(uint32_t guest_low,
+                                      uint32_t guest_high) {
+  std::lock_guard<std::mutex> lock(storage_mutex_);
+  for (auto it = restorable_functions_.begin();
+       it != restorable_functions_.end();) {
+    const StoredFunctionHeader& header = it->second.header;
+    if (header.guest_address < guest_high &&
+        header.guest_end_address >= guest_low) {
+      it = restorable_functions_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool X64CodeStorage::RestoreFunction(GuestFunction* function) {
+  std::lock_guard<std::mutex> lock(storage_mutex_);
+  if (function->module() != module_) {
+    return false;
+  }
+  auto it = restorable_functions_.find(function->address());
+  if (it == restorable_functions_.end()) {
+    return false;
+  }
+  StoredFunction stored_function = std::move(it->second);
+  restorable_functions_.erase(it);
+  const StoredFunctionHeader& header = stored_function.header;
+
+  // Rebase the references to the host executable.
+  uintptr_t image_anchor = GetHostImageAnchor();
+  for (const StoredHostRelocation& relocation :
+       stored_function.host_relocations) {
+    uint64_t host_address = uint64_t(image_anchor + relocation.image_offset);
+    std::memcpy(stored_function.code.data() + relocation.code_offset,
+                &host_address, sizeof(host_address));
+  }
+
+  EmitFunctionInfo func_info = {};
+  func_info.code_size.prolog = header.code_size_prolog;
+  func_info.code_size.body = header.code_size_body;
+  func_info.code_size.epilog = header.code_size_epilog;
+  func_info.code_size.tail = header.code_size_tail;
+  func_info.code_size.total = header.code_size_total;
+  func_info.prolog_stack_alloc_offset = header.prolog_stack_alloc_offset;
+  func_info.stack_size = header.stack_size;
+
+  void* code_execute_address;
+  void* code_write_address;
+  if (!backend_->code_cache()->PlaceGuestCodeAt(
+          header.code_offset, function->address(), stored_function.code.data(),
+          func_info, function, code_execute_address, code_write_address)) {
+    XELOGE("Failed to place the stored code of function {:08X}",
+           function->address());
+    return false;
+  }
+
+  function->set_end_address(header.guest_end_address);
+  function->source_map() = std::move(stored_function.source_map);
+  static_cast<X64Function*>(function)->Setup(
+      reinterpret_cast<uint8_t*>(code_execute_address),
+      header.code_size_total);
+
+  for (const StoredCallSite& call_site : stored_function.patchable_call_sites) {
+    backend_->code_cache()->AddPatchableCallSite(
+        call_site.target_address,
+        reinterpret_cast<uint8_t*>(code_execute_address) +
+            call_site.code_offset);
+  }
+  return true;
+}
+
+void X64CodeStorage::StoreFunction(GuestFunction* function,
+                                   const X64Emitter& emitter,
+                                   uint32_t debug_info_flags) {
+  // Debug and tracing code references per-launch data. Functions translated
+  // for debugging because of breakpoints are slower, not to be reused later.
+  if (!emitter.is_code_storable() || debug_info_flags || GetTracingMode() ||
+      cvars::instrument_call_times || function->is_debuggable()) {
+    return;
+  }
+
+  // Looked up before locking, as functions are restored while the processor
+  // holds its locks.
+  const std::vector<uint32_t>& direct_call_targets =
+      emitter.direct_call_targets();
+  std::vector<StoredDirectCall> stored_direct_calls;
+  stored_direct_calls.reserve(direct_call_targets.size());
+  for (uint32_t target_address : direct_call_targets) {
+    Function* callee = backend_->processor()->QueryFunction(target_address);
+    StoredDirectCall& stored_direct_call = stored_direct_calls.emplace_back();
+    stored_direct_call.target_address = target_address;
+    uint32_t callee_code_end_offset;
+    if (!callee || !callee->is_guest() ||
+        !backend_->code_cache()->GetPlacedCodeRange(
+            static_cast<GuestFunction*>(callee)->machine_code(),
+            stored_direct_call.target_code_offset, callee_code_end_offset)) {
+      return;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(storage_mutex_);
+  if ((!file_ && !shared_log_) || function->module() != module_) {
+    return;
+  }
+
+  uint32_t code_offset, code_end_offset;
+  if (!backend_->code_cache()->GetPlacedCodeRange(
+          function->machine_code(), code_offset, code_end_offset) ||
+      code_offset < code_base_offset_) {
+    return;
+  }
+
+  const EmitFunctionInfo& func_info = emitter.emitted_function_info();
+  const std::vector<SourceMapEntry>& source_map = function->source_map();
+  const std::vector<X64Emitter::HostAddressRelocation>& host_relocations =
+      emitter.host_address_relocations();
+  const std::vector<X64Emitter::PatchableCallSite>& patchable_call_sites =
+      emitter.patchable_call_sites();
+
+  StoredFunctionHeader header;
+  header.guest_address = function->address();
+  header.guest_end_address = function->end_address();
+  header.code_offset = code_offset;
+  header.code_end_offset = code_end_offset;
+  header.code_size_prolog = uint32_t(func_info.code_size.prolog);
+  header.code_size_body = uint32_t(func_info.code_size.body);
+  header.code_size_epilog = uint32_t(func_info.code_size.epilog);
+  header.code_size_tail = uint32_t(func_info.code_size.tail);
+  header.code_size_total = uint32_t(func_info.code_size.total);
+  header.prolog_stack_alloc_offset =
+      uint32_t(func_info.prolog_stack_alloc_offset);
+  header.stack_size = uint32_t(func_info.stack_size);
+  header.source_map_entry_count = uint32_t(source_map.size());
+  header.host_relocation_count = uint32_t(host_relocations.size());
+  header.direct_call_count = uint32_t(stored_direct_calls.size());
+  header.patchable_call_site_count =
+      uint32_t(patchable_call_sites.size());
+
+  std::vector<StoredHostRelocation> stored_relocations;
+  stored_relocations.reserve(host_relocations.size());
+  uintptr_t image_anchor = GetHostImageAnchor();
+  for (const X64Emitter::HostAddressRelocation& relocation : host_relocations) {
+    StoredHostRelocation& stored_relocation = stored_relocations.emplace_back();
+    stored_relocation.code_offset = relocation.code_offset;
+    stored_relocation.image_offset = int64_t(
+        reinterpret_cast<uintptr_t>(relocation.host_address) - image_anchor);
+  }
+
+  // The calls may have already been patched to the current code of the
+  // targets, which will be placed elsewhere in the next launch.
+  std::vector<uint8_t> code(function->machine_code(),
+                            function->machine_code() + header.code_size_total);
+  std::vector<StoredCallSite> stored_call_sites;
+  stored_call_sites.reserve(patchable_call_sites.size());
+  for (const X64Emitter::PatchableCallSite& call_site : patchable_call_sites) {
+    std::memcpy(code.data() + call_site.code_offset + 1,
+                &call_site.unpatched_displacement, sizeof(int32_t));
+    StoredCallSite& stored_call_site = stored_call_sites.emplace_back();
+    stored_call_site.code_offset = call_site.code_offset;
+    stored_call_site.target_address = call_site.target_address;
+  }
+
+  // Written at once, so a shared log record is complete or absent.
+  std::vector<uint8_t> record;
+  auto append_to_record = [&record](const void* data, size_t size) {
+    const uint8_t* data_bytes = reinterpret_cast<const uint8_t*>(data);
+    record.insert(record.end(), data_bytes, data_bytes + size);
+  };
+  append_to_record(&header, sizeof(header));
+  append_to_record(code.data(), code.size());
+  append_to_record(source_map.data(),
+                   sizeof(SourceMapEntry) * source_map.size());
+  append_to_record(stored_relocations.data(),
+                   sizeof(StoredHostRelocation) * stored_relocations.size());
+  append_to_record(stored_direct_calls.data(),
+                   sizeof(StoredDirectCall) * stored_direct_calls.size());
+  append_to_record(stored_call_sites.data(),
+                   sizeof(StoredCallSite) * stored_call_sites.size());
+  if (shared_log_) {
+    // Nothing more is stored once the log is full.
+    shared_log_->Append(record.data(), uint32_t(record.size()));
+  } else {
+    fwrite(record.data(), 1, record.size(), file_);
+  }
+}
+
+uint64_t X64CodeStorage::CalculateHostFingerprint() const {
+  std::string fingerprint_data = XE_BUILD_COMMIT;
+  uintptr_t image_anchor = GetHostImageAnchor();
+  std::pair<uint64_t, uint64_t> guest_tick_ratio = Clock::guest_tick_ratio();
+  uint64_t host_values[] = {
+      amd64::GetFeatureFlags(),
+      uint64_t(reinterpret_cast<uintptr_t>(
+          backend_->processor()->memory()->virtual_membase())),
+      uint64_t(backend_->emitter_data()),
+      uint64_t(reinterpret_cast<uintptr_t>(backend_->host_to_guest_thunk())),
+      uint64_t(reinterpret_cast<uintptr_t>(backend_->guest_to_host_thunk())),
+      uint64_t(reinterpret_cast<uintptr_t>(backend_->resolve_function_thunk())),
+      // Layout of the executable image, to catch local rebuilds changing the
+      // offsets of host functions and tables.
+      uint64_t(reinterpret_cast<uintptr_t>(&mxcsr_table) - image_anchor),
+      uint64_t(reinterpret_cast<uintptr_t>(&GetHostImageAnchor) -
+               image_anchor),
+      // Guest clock reading, chosen or baked into the code of LOAD_CLOCK
+      // depending on the host time stamp counter.
+      uint64_t(Clock::guest_timebase().host_ticks_raw),
+      guest_tick_ratio.first,
+      guest_tick_ratio.second,
+  };
+  fingerprint_data.append(reinterpret_cast<const char*>(host_values),
+                          sizeof(host_values));
+  // Configuration variables that may affect the generated code.
+  if (cvar::ConfigVars) {
+    for (const auto& config_var : *cvar::ConfigVars) {
+      const std::string& category = config_var.second->category();
+      if ((category != "CPU" && category != "x64") ||
+          config_var.first == "store_translated_code" ||
+          config_var.first == "share_translated_code") {
+        continue;
+      }
+      fingerprint_data += config_var.first;
+      fingerprint_data += '=';
+      fingerprint_data += config_var.second->config_value();
+      fingerprint_data += '\n';
+    }
+  }
+  return XXH3_64bits(fingerprint_data.data(), fingerprint_data.size());
+}
+
+uintptr_t X64CodeStorage::GetHostImageAnchor() {
+  static const uint8_t image_anchor = 0;
+  return reinterpret_cast<uintptr_t>(&image_anchor);
+}
+
+bool X64CodeStorage::ReadFunction(const uint8_t*& data,
+                                  const uint8_t* data_end,
+                                  StoredFunction& function_out) {
+  const uint8_t* read_position = data;
+  auto read = [&read_position, data_end](void* out, size_t size) {
+    if (size_t(data_end - read_position) < size) {
+      return false;
+    }
+    if (size) {
+      std::memcpy(out, read_position, size);
+      read_position += size;
+    }
+    return true;
+  };
+  StoredFunctionHeader& header = function_out.header;
+  if (!read(&header, sizeof(header))) {
+    return false;
+  }
+  // Sanity limits for corrupted data.
+  if (!header.code_size_total || header.code_size_total > 0x1000000 ||
+      header.source_map_entry_count > 0x1000000 ||
+      header.host_relocation_count > header.code_size_total ||
+      header.direct_call_count > header.code_size_total ||
+      header.patchable_call_site_count > header.code_size_total) {
+    return false;
+  }
+  function_out.code.resize(header.code_size_total);
+  function_out.source_map.resize(header.source_map_entry_count);
+  function_out.host_relocations.resize(header.host_relocation_count);
+  function_out.direct_calls.resize(header.direct_call_count);
+  function_out.patchable_call_sites.resize(header.patchable_call_site_count);
+  if (!read(function_out.code.data(), function_out.code.size()) ||
+      !read(function_out.source_map.data(),
+            sizeof(SourceMapEntry) * function_out.source_map.size()) ||
+      !read(function_out.host_relocations.data(),
+            sizeof(StoredHostRelocation) *
+                function_out.host_relocations.size()) ||
+      !read(function_out.direct_calls.data(),
+            sizeof(StoredDirectCall) * function_out.direct_calls.size()) ||
+      !read(function_out.patchable_call_sites.data(),
+            sizeof(StoredCallSite) *
+                function_out.patchable_call_sites.size())) {
+    return false;
+  }
+  for (const StoredHostRelocation& relocation :
+       function_out.host_relocations) {
+    if (uint64_t(relocation.code_offset) + sizeof(uint64_t) >
+        header.code_size_total) {
+      return false;
+    }
+  }
+  for (const StoredCallSite& call_site : function_out.patchable_call_sites) {
+    if ((call_site.code_offset & 3) != 3 ||
+        uint64_t(call_site.code_offset) + 5 > header.code_size_total) {
+      return false;
+    }
+  }
+  data = read_position;
+  return true;
+}
+
+void X64CodeStorage::WriteHeader() {
+  xe::filesystem::TruncateStdioFile(file_, 0);
+  StoredHeader header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.host_fingerprint = host_fingerprint_;
+  header.code_base_offset = code_base_offset_;
+  header.reserved = 0;
+  fwrite(&header, sizeof(header), 1, file_);
+}
+
+}  // namespace x64
+}  // namespace backend
+}  // namespace cpu
+}  // namespace xe
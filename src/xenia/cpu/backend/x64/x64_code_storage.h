@@ -0,0 +1,175 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_BACKEND_X64_X64_CODE_STORAGE_H_
+#define XENIA_CPU_BACKEND_X64_X64_CODE_STORAGE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "xenia/base/platform.h"
+#include "xenia/base/shared_append_log.h"
+#include "xenia/cpu/backend/x64/x64_code_cache.h"
+#include "xenia/cpu/function.h"
+
+namespace xe {
+namespace cpu {
+class Module;
+namespace backend {
+namespace x64 {
+
+class X64Backend;
+class X64Emitter;
+
+// Persistent storage of the machine code of translated guest functions of a
+// module, so on the next launch of the same executable the code can be placed
+// into the code cache directly, without running the translation pipeline.
+//
+// Code in the cache refers to the backend thunks, to the constant data and to
+// other guest functions via absolute or relative addresses, so the stored code
+// is restored exactly at the offsets where it was originally placed. Host
+// executable addresses (native call targets, static tables) are rebased
+// relative to the executable image, and functions referencing anything else
+// not persistent between launches are not stored.
+//
+// With share_translated_code, the functions are stored in a SharedAppendLog
+// instead of a private file, so emulator instances running the same title at
+// the same time store into it together. Each instance restores what all of
+// them have stored when it's launched, but still places the code into its own
+// code cache - the code of functions translated by other instances after the
+// launch can't be placed at the original offsets anymore, as the code cache
+// is append-only and its own translations occupy that space.
+class X64CodeStorage {
+ public:
+  explicit X64CodeStorage(X64Backend* backend) : backend_(backend) {}
+  ~X64CodeStorage() { Shutdown(); }
+
+  // Opens the storage file for the module, restoring the functions stored in
+  // it, and starts appending newly translated functions to it.
+  void Initialize(Module* module, const std::filesystem::path& storage_root);
+  void Shutdown();
+
+  // Sets up the function from the stored code if it's available.
+  bool RestoreFunction(GuestFunction* function);
+  // Makes the stored functions with code in [guest_low, guest_high) no longer
+  // restorable in this run.
+  void DiscardFunctions(uint32_t guest_low, uint32_t guest_high);
+  // Appends the function that has just been emitted by the emitter.
+  void StoreFunction(GuestFunction* function, const X64Emitter& emitter,
+                     uint32_t debug_info_flags);
+
+ private:
+  static constexpr uint32_t kMagic = 0x53434558;  // 'XECS'
+  // Increment when the format or code generation details not covered by the
+  // host fingerprint change.
+  static constexpr uint32_t kVersion = 0x20261016;
+  // Enough for the functions occupying half of the code cache, with their
+  // metadata.
+  static constexpr uint64_t kSharedLogCapacity = 256 * 1024 * 1024;
+
+  XEPACKEDSTRUCT(StoredHeader, {
+    uint32_t magic;
+    uint32_t version;
+    // Hash of the state of the host the code depends on - the executable
+    // build, CPU features, the fixed addresses of the thunks and the data
+    // referenced by the code, and the configuration affecting translation.
+    uint64_t host_fingerprint;
+    // Offset in the code cache of the first guest function, must match to
+    // reuse the code as the code before it (thunks and helpers) is referenced
+    // via relative addresses.
+    uint32_t code_base_offset;
+    uint32_t reserved;
+  });
+
+  XEPACKEDSTRUCT(StoredFunctionHeader, {
+    uint32_t guest_address;
+    uint32_t guest_end_address;
+    // Offsets from the execute base of the code cache.
+    uint32_t code_offset;
+    // Including the unwind information.
+    uint32_t code_end_offset;
+    uint32_t code_size_prolog;
+    uint32_t code_size_body;
+    uint32_t code_size_epilog;
+    uint32_t code_size_tail;
+    uint32_t code_size_total;
+    uint32_t prolog_stack_alloc_offset;
+    uint32_t stack_size;
+    uint32_t source_map_entry_count;
+    uint32_t host_relocation_count;
+    uint32_t direct_call_count;
+    uint32_t patchable_call_site_count;
+    // Followed by:
+    // - uint8_t code[code_size_total]
+    // - SourceMapEntry source_map[source_map_entry_count]
+    // - StoredHostRelocation host_relocations[host_relocation_count]
+    // - StoredDirectCall direct_calls[direct_call_count]
+    // - StoredCallSite patchable_call_sites[patchable_call_site_count]
+  });
+
+  XEPACKEDSTRUCT(StoredHostRelocation, {
+    uint32_t code_offset;
+    // Relative to the host image anchor.
+    int64_t image_offset;
+  });
+
+  XEPACKEDSTRUCT(StoredDirectCall, {
+    uint32_t target_address;
+    // Offset of the code of the callee that's called.
+    uint32_t target_code_offset;
+  });
+
+  // Stored unpatched, calling the target via the stub in the function.
+  XEPACKEDSTRUCT(StoredCallSite, {
+    uint32_t code_offset;
+    uint32_t target_address;
+  });
+
+  struct StoredFunction {
+    StoredFunctionHeader header;
+    std::vector<uint8_t> code;
+    std::vector<SourceMapEntry> source_map;
+    std::vector<StoredHostRelocation> host_relocations;
+    std::vector<StoredDirectCall> direct_calls;
+    std::vector<StoredCallSite> patchable_call_sites;
+  };
+
+  uint64_t CalculateHostFingerprint() const;
+  static uintptr_t GetHostImageAnchor();
+
+  // Advances the data pointer past the function if it's read successfully.
+  static bool ReadFunction(const uint8_t*& data, const uint8_t* data_end,
+                           StoredFunction& function_out);
+  void WriteHeader();
+
+  X64Backend* backend_;
+
+  // Protects everything below.
+  std::mutex storage_mutex_;
+  Module* module_ = nullptr;
+  // One of them is open when storing.
+  FILE* file_ = nullptr;
+  std::unique_ptr<SharedAppendLog> shared_log_;
+  uint64_t host_fingerprint_ = 0;
+  uint32_t code_base_offset_ = 0;
+  // Functions in the storage that can be restored, removed once restored.
+  std::unordered_map<uint32_t, StoredFunction> restorable_functions_;
+};
+
+}  // namespace x64
+}  // namespace backend
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_BACKEND_X64_X64_CODE_STORAGE_H_
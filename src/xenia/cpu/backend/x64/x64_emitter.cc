@@ -11,6 +11,7 @@
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <climits>
 #include <cstring>
 
@@ -35,6 +36,7 @@
 #include "xenia/cpu/hir/instr.h"
 #include "xenia/cpu/hir/opcodes.h"
 #include "xenia/cpu/hir/value.h"
+#include "xenia/cpu/memory_access_trace.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/cpu/symbol.h"
 #include "xenia/cpu/thread_state.h"
@@ -53,16 +55,32 @@ DEFINE_bool(enable_incorrect_roundingmode_behavior, false,
             "code. The workaround may cause reduced CPU performance but is a "
             "more accurate emulation",
             "x64");
+DEFINE_bool(mxcsr_mode_summaries, true,
+            "Remember the MXCSR mode guest functions return in, so callers "
+            "don't need to check and reload it after calling them.",
+            "x64");
 DEFINE_uint32(align_all_basic_blocks, 0,
               "Aligns the start of all basic blocks to N bytes. Only specify a "
               "power of 2, 16 is the recommended value. Results in larger "
               "icache usage, but potentially faster loops",
               "x64");
+DEFINE_bool(shared_constant_pool, true,
+            "Load the vector and float constants not in the fixed constant "
+            "table from a deduplicated pool in the code cache instead of "
+            "building them on the stack.",
+            "x64");
+DEFINE_bool(patch_guest_call_sites, true,
+            "Patch calls to guest functions that haven't been translated yet "
+            "into direct calls once their code is available, instead of always "
+            "calling them via the indirection table.",
+            "x64");
 #if XE_X64_PROFILER_AVAILABLE == 1
 DEFINE_bool(instrument_call_times, false,
             "Compute time taken for functions, for profiling guest code",
             "x64");
 #endif
+DECLARE_bool(store_translated_code);
+
 namespace xe {
 namespace cpu {
 namespace backend {
@@ -115,22 +133,71 @@ bool X64Emitter::Emit(GuestFunction* function, HIRBuilder* builder,
   SCOPE_profile_cpu_f("cpu");
   guest_module_ = dynamic_cast<XexModule*>(function->module());
   current_guest_function_ = function->address();
+  current_guest_address_ = function->address();
+  edge_profile_ = processor()->edge_profile();
+  memory_access_trace_ = processor()->memory_access_trace();
+  if (memory_access_trace_ &&
+      !memory_access_trace_->ShouldInstrumentFunction(function->address())) {
+    memory_access_trace_ = nullptr;
+  }
   // Reset.
   debug_info_ = debug_info;
   debug_info_flags_ = debug_info_flags;
   trace_data_ = &function->trace_data();
   source_map_arena_.Reset();
+  code_storable_ = true;
+  host_address_relocations_.clear();
+  direct_call_targets_.clear();
+  patchable_call_sites_.clear();
+  constant_pool_references_.clear();
+  // First compilation with the baseline pipeline of tiered compilation.
+  emit_optimization_counter_ =
+      function->is_baseline_tier() && !function->machine_code();
+  auto x64_function = static_cast<X64Function*>(function);
+  required_exit_mxcsr_mode_ = x64_function->exit_mxcsr_mode();
+  exit_mxcsr_mode_ = MXCSRMode::Unknown;
+  has_exit_mxcsr_mode_ = false;
+  mxcsr_mode_switch_count_ = 0;
+  emit_stackpoints_ = RecordsStackpoints(function);
+  if (emit_stackpoints_ && cvars::lazy_host_guest_stack_synchronization) {
+    // Whether the function needs stackpoints is only known once translated,
+    // so stored code is always without them.
+    MarkCodeNotStorable();
+  }
 
   // Fill the generator with code.
   EmitFunctionInfo func_info = {};
   if (!Emit(builder, func_info)) {
     return false;
   }
+  emitted_function_info_ = func_info;
 
   // Copy the final code to the cache and relocate it.
   *out_code_size = getSize();
   *out_code_address = Emplace(func_info, function);
 
+  // Callers compiled from now on may rely on the mode the returns leave, with
+  // the code already in place.
+  if (cvars::mxcsr_mode_summaries) {
+    x64_function->set_exit_mxcsr_mode(
+        has_exit_mxcsr_mode_ ? exit_mxcsr_mode_ : MXCSRMode::Unknown);
+  }
+  x64_function->set_stackpoint_frame_size(
+      emit_stackpoints_ ? uint32_t(stack_size_) : 0);
+
+  // Let the calls be patched once the targets are compiled, remembering the
+  // original displacements to the stubs for the persistent storage.
+  auto code = reinterpret_cast<const uint8_t*>(*out_code_address);
+  for (PatchableCallSite& call_site : patchable_call_sites_) {
+    std::memcpy(&call_site.unpatched_displacement,
+                code + call_site.code_offset + 1, sizeof(int32_t));
+  }
+  for (const PatchableCallSite& call_site : patchable_call_sites_) {
+    code_cache_->AddPatchableCallSite(
+        call_site.target_address,
+        const_cast<uint8_t*>(code + call_site.code_offset));
+  }
+
   // Stash source map.
   source_map_arena_.CloneContents(out_source_map);
 
@@ -159,6 +226,15 @@ void* X64Emitter::Emplace(const EmitFunctionInfo& func_info,
   }
   top_ = reinterpret_cast<uint8_t*>(new_write_address);
   ready();
+  for (const ConstantPoolReference& reference : constant_pool_references_) {
+    int32_t displacement = int32_t(
+        reinterpret_cast<intptr_t>(reference.constant_address) -
+        (reinterpret_cast<intptr_t>(new_execute_address) +
+         intptr_t(reference.code_offset)));
+    std::memcpy(top_ + reference.code_offset - sizeof(int32_t), &displacement,
+                sizeof(int32_t));
+  }
+  constant_pool_references_.clear();
   top_ = old_address;
   reset();
   tail_code_.clear();
@@ -286,6 +362,12 @@ bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
     bts(qword[low_address(&trace_header->function_thread_use)], rax);
   }
 
+  if (emit_optimization_counter_) {
+    EmitOptimizationCounter();
+  }
+  EmitEdgeCounter(EdgeProfile::EdgeKind::kEntry, current_guest_function_,
+                  current_guest_function_, rdx);
+
   // Load membase.
   /*
   * chrispy: removed this, as long as we load it in HostToGuestThunk we can
@@ -317,6 +399,9 @@ bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
           EnsureSynchronizedGuestAndHostStack();
         }
       }
+      if (memory_access_trace_) {
+        EmitMemoryAccessTrace(instr);
+      }
       const Instr* new_tail = instr;
       if (!SelectSequence(this, instr, &new_tail)) {
         // No sequence found!
@@ -332,6 +417,9 @@ bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
     block = block->next;
   }
 
+  // Falling through to the epilog.
+  PrepareMxcsrModeForReturn();
+
   // Function epilog.
   L(epilog_label);
   epilog_label_ = nullptr;
@@ -371,6 +459,142 @@ bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
 
   return true;
 }
+uint64_t RequestFunctionOptimization(void* raw_context, uint64_t address) {
+  auto thread_state =
+      reinterpret_cast<ppc::PPCContext_s*>(raw_context)->thread_state;
+  thread_state->processor()->RequestFunctionOptimization(
+      static_cast<uint32_t>(address));
+  return 0;
+}
+
+void X64Emitter::EmitOptimizationCounter() {
+  // Count down the calls in a counter in the code cache data (with a 32-bit
+  // address), requesting recompilation when reaching zero. Not atomic, but
+  // decrementing in memory guarantees that at least one thread sees zero.
+  uint32_t initial_count =
+      std::max(cvars::tiered_compilation_threshold, uint32_t(1));
+  uint32_t counter_address =
+      code_cache_->PlaceData(&initial_count, sizeof(initial_count));
+  MarkCodeNotStorable();
+
+  Xbyak::Label& come_back = NewCachedLabel();
+  uint32_t guest_address = current_guest_function_;
+  Xbyak::Label& request_optimization = AddToTail(
+      [&come_back, guest_address](X64Emitter& e, Xbyak::Label& our_tail_label) {
+        e.L(our_tail_label);
+        e.CallNative(RequestFunctionOptimization, guest_address);
+        e.jmp(come_back, X64Emitter::T_NEAR);
+      });
+  mov(edx, counter_address);
+  dec(dword[rdx]);
+  jz(request_optimization, T_NEAR);
+  L(come_back);
+}
+
+void X64Emitter::EmitEdgeCounter(EdgeProfile::EdgeKind kind,
+                                 uint32_t site_address,
+                                 uint32_t target_address,
+                                 const Xbyak::Reg64& scratch) {
+  if (!edge_profile_) {
+    return;
+  }
+  uint64_t* counter =
+      edge_profile_->GetCounter(kind, site_address, target_address);
+  if (!counter) {
+    return;
+  }
+  // Not atomic, like the optimization counter, a few counts lost on races
+  // being fine for a profile.
+  mov(scratch, reinterpret_cast<uint64_t>(counter));
+  inc(qword[scratch]);
+  MarkCodeNotStorable();
+}
+
+static uint64_t RecordTracedMemoryAccess(void* raw_context, uint64_t address,
+                                         uint64_t access,
+                                         uint64_t function_address) {
+  auto context = reinterpret_cast<ppc::PPCContext_s*>(raw_context);
+  context->processor->memory_access_trace()->RecordAccess(
+      context->thread_id, static_cast<uint32_t>(address),
+      static_cast<uint32_t>(access), static_cast<uint32_t>(function_address),
+      static_cast<uint32_t>(access >> 32) & 0xFF, (access >> 63) != 0);
+  return 0;
+}
+
+void X64Emitter::EmitMemoryAccessTrace(const hir::Instr* i) {
+  const hir::Value* address = i->src1.value;
+  int32_t offset = 0;
+  const hir::Value* data;
+  bool is_store;
+  switch (i->GetOpcodeNum()) {
+    case hir::OPCODE_LOAD:
+      data = i->dest;
+      is_store = false;
+      break;
+    case hir::OPCODE_LOAD_OFFSET:
+      offset = static_cast<int32_t>(i->src2.value->constant.i64);
+      data = i->dest;
+      is_store = false;
+      break;
+    case hir::OPCODE_STORE:
+      data = i->src2.value;
+      is_store = true;
+      break;
+    case hir::OPCODE_STORE_OFFSET:
+      offset = static_cast<int32_t>(i->src2.value->constant.i64);
+      data = i->src3.value;
+      is_store = true;
+      break;
+    default:
+      return;
+  }
+  uint32_t size = uint32_t(hir::GetTypeSize(data->type));
+  uint32_t constant_address = 0;
+  if (address->IsConstant()) {
+    // The only accesses that can be proven not to touch the range.
+    constant_address = static_cast<uint32_t>(address->constant.i64) + offset;
+    if (!memory_access_trace_->Overlaps(constant_address, size)) {
+      return;
+    }
+  }
+  MarkCodeNotStorable();
+
+  // The guest address of the access is in eax when entering the tail.
+  uint64_t access = (uint64_t(is_store) << 63) | (uint64_t(size) << 32) |
+                    current_guest_address_;
+  uint32_t function_address = current_guest_function_;
+  Xbyak::Label& come_back = NewCachedLabel();
+  Xbyak::Label& record = AddToTail(
+      [&come_back, access, function_address](X64Emitter& e,
+                                             Xbyak::Label& our_tail_label) {
+        e.L(our_tail_label);
+        e.mov(e.GetNativeParam(0).cvt32(), e.eax);
+        e.mov(e.GetNativeParam(1), access);
+        e.mov(e.GetNativeParam(2).cvt32(), function_address);
+        e.CallNativeSafe(reinterpret_cast<void*>(RecordTracedMemoryAccess));
+        e.jmp(come_back, X64Emitter::T_NEAR);
+      });
+  if (address->IsConstant()) {
+    mov(eax, constant_address);
+    jmp(record, T_NEAR);
+  } else {
+    Xbyak::Reg32 address_reg;
+    SetupReg(address, address_reg);
+    lea(eax, ptr[address_reg + offset]);
+    // Unsigned distance from the lowest address of an access overlapping the
+    // range, also rejecting the addresses below it.
+    uint32_t lowest_address = memory_access_trace_->address() - (size - 1);
+    uint32_t span = memory_access_trace_->length() + (size - 1);
+    if (span < memory_access_trace_->length()) {
+      span = UINT32_MAX;
+    }
+    lea(edx, ptr[eax + static_cast<int32_t>(0u - lowest_address)]);
+    cmp(edx, span);
+    jb(record, T_NEAR);
+  }
+  L(come_back);
+}
+
 // dont use rax, we do this in tail call handling
 void X64Emitter::EmitProfilerEpilogue() {
 #if XE_X64_PROFILER_AVAILABLE == 1
@@ -381,6 +605,7 @@ void X64Emitter::EmitProfilerEpilogue() {
     mov(ecx, 0x7ffe0014);
     mov(rdx, qword[rcx]);
     mov(r10, (uintptr_t)profiler_entry);
+    MarkCodeNotStorable();
     sub(rdx, qword[rsp + StackLayout::GUEST_PROFILER_START]);
 
     // atomic add our time to the profiler entry
@@ -399,6 +624,7 @@ void X64Emitter::MarkSourceOffset(const Instr* i) {
   entry->guest_address = static_cast<uint32_t>(i->src1.offset);
   entry->hir_offset = uint32_t(i->block->ordinal << 16) | i->ordinal;
   entry->code_offset = static_cast<uint32_t>(getSize());
+  current_guest_address_ = entry->guest_address;
 
   if (cvars::emit_source_annotations) {
     nop(2);
@@ -482,6 +708,47 @@ void X64Emitter::UnimplementedInstr(const hir::Instr* i) {
   assert_always();
 }
 
+// With stackpoints recorded lazily, the body of a function can only be
+// reentered if its current code records them, and if the innermost stackpoint
+// not below the guest stack pointer is of a frame of that code, which the
+// last call made from the frame tells. Returns 0 if it can't be reentered.
+static uint64_t ResolveLazyStackpointReentry(
+    Processor* processor, XexModule* xexmod, X64Function* function,
+    X64BackendContext* backend_context, uint32_t guest_stack_pointer,
+    uintptr_t host_address) {
+  uint32_t frame_size = function->stackpoint_frame_size();
+  if (!frame_size) {
+    // Translate the function again with stackpoints for the later reentries,
+    // this one leaking the host frames as without synchronization.
+    InfoCacheFlags* function_flags =
+        xexmod->GetInstructionAddressFlags(function->address());
+    if (function_flags) {
+      function_flags->needs_stackpoint = 1;
+      processor->backend()->DiscardStoredFunctions(function->address(),
+                                                   function->address() + 4);
+      processor->RedefineFunction(function);
+    }
+    return 0;
+  }
+  X64BackendStackpoint* stackpoints = backend_context->stackpoints;
+  for (uint32_t index = backend_context->current_stackpoint_depth; index--;) {
+    const X64BackendStackpoint& stackpoint = stackpoints[index];
+    if (guest_stack_pointer > stackpoint.guest_stack_) {
+      continue;
+    }
+    uintptr_t frame = uintptr_t(stackpoint.host_stack_) - frame_size;
+    uintptr_t last_return_address =
+        *reinterpret_cast<const uint64_t*>(frame - sizeof(uint64_t));
+    uintptr_t code = reinterpret_cast<uintptr_t>(function->machine_code());
+    if (last_return_address > code &&
+        last_return_address <= code + function->machine_code_length()) {
+      return host_address;
+    }
+    break;
+  }
+  return 0;
+}
+
 // This is used by the X64ThunkEmitter's ResolveFunctionThunk.
 uint64_t ResolveFunction(void* raw_context, uint64_t target_address) {
   auto guest_context = reinterpret_cast<ppc::PPCContext_s*>(raw_context);
@@ -565,6 +832,16 @@ uint64_t ResolveFunction(void* raw_context, uint64_t target_address) {
                 X64BackendContext* backend_context =
                     backend->BackendContextForGuestContext(guest_context);
 
+                if (cvars::lazy_host_guest_stack_synchronization) {
+                  uint64_t reentry_address = ResolveLazyStackpointReentry(
+                      processor, xexmod, candidate, backend_context,
+                      static_cast<uint32_t>(guest_context->r[1]),
+                      host_address);
+                  if (reentry_address) {
+                    return reentry_address;
+                  }
+                }
+
                 uint32_t current_stackpoint_index =
                     backend_context->current_stackpoint_depth;
 
@@ -666,7 +943,8 @@ uint64_t ResolveFunction(void* raw_context, uint64_t target_address) {
 
                  */
 
-                if (num_frames_bigger > 1) {
+                if (!cvars::lazy_host_guest_stack_synchronization &&
+                    num_frames_bigger > 1) {
                   /*
                    * can't do anything about this right now :(
                    * epic mickey is quite slow due to having to call resolve on
@@ -699,10 +977,63 @@ uint64_t ResolveFunction(void* raw_context, uint64_t target_address) {
 void X64Emitter::Call(const hir::Instr* instr, GuestFunction* function) {
   assert_not_null(function);
   ForgetMxcsrMode();
+  if (instr->flags & hir::CALL_TAIL) {
+    // The callee returns to the caller of this function.
+    MergeExitMxcsrMode(GetCalleeExitMxcsrMode(function));
+  }
+  EmitEdgeCounter(EdgeProfile::EdgeKind::kDirectCall, current_guest_address_,
+                  function->address(), rdx);
   auto fn = static_cast<X64Function*>(function);
   // Resolve address to the function to call and store in rax.
 
-  if (fn->machine_code()) {
+  if (code_cache_->has_indirection_table() && cvars::patch_guest_call_sites) {
+    // Call or jump to a stub in the tail calling via the indirection table,
+    // patched by X64CodeCache into a direct call to the current code of the
+    // target whenever it's placed, including new code of baseline functions.
+    uint32_t guest_address = function->address();
+    bool is_tail_call = (instr->flags & hir::CALL_TAIL) != 0;
+    if (!is_tail_call) {
+      // Return address is from the previous SET_RETURN_ADDRESS.
+      mov(rcx, qword[rsp + StackLayout::GUEST_CALL_RET_ADDR]);
+    } else {
+      // Since we skip the prolog we need to mark the return here.
+      EmitTraceUserCallReturn();
+      EmitProfilerEpilogue();
+      // Pass the callers return address over.
+      mov(rcx, qword[rsp + StackLayout::GUEST_RET_ADDR]);
+
+      add(rsp, static_cast<uint32_t>(stack_size()));
+      PopStackpoint();
+    }
+    // Align the displacement so it can be patched with a single store.
+    size_t displacement_padding = (3 - getSize() % 4) % 4;
+    if (displacement_padding) {
+      nop(displacement_padding);
+    }
+    Xbyak::Label& stub = AddToTail(
+        [guest_address](X64Emitter& e, Xbyak::Label& our_tail_label) {
+          e.L(our_tail_label);
+          e.mov(e.ebx, guest_address);
+          e.mov(e.eax, e.dword[e.ebx]);
+          e.jmp(e.rax);
+        });
+    PatchableCallSite& call_site = patchable_call_sites_.emplace_back();
+    call_site.target_address = guest_address;
+    call_site.code_offset = uint32_t(getSize());
+    call_site.unpatched_displacement = 0;
+    if (!is_tail_call) {
+      call(stub);
+      synchronize_stack_on_next_instruction_ = true;
+    } else {
+      jmp(stub, T_NEAR);
+    }
+    return;
+  }
+
+  // Functions compiled with the baseline tier get new code once they're hot,
+  // only calling them through the indirection table.
+  if (fn->machine_code() && !fn->is_baseline_tier()) {
+    direct_call_targets_.push_back(function->address());
     if (!(instr->flags & hir::CALL_TAIL)) {
       mov(rcx, qword[rsp + StackLayout::GUEST_CALL_RET_ADDR]);
 
@@ -756,12 +1087,18 @@ void X64Emitter::Call(const hir::Instr* instr, GuestFunction* function) {
 
 void X64Emitter::CallIndirect(const hir::Instr* instr,
                               const Xbyak::Reg64& reg) {
-  ForgetMxcsrMode();
   // Check if return.
   if (instr->flags & hir::CALL_POSSIBLE_RETURN) {
+    PrepareMxcsrModeForReturn();
     cmp(reg.cvt32(), dword[rsp + StackLayout::GUEST_RET_ADDR]);
     je(epilog_label(), CodeGenerator::T_NEAR);
   }
+  ForgetMxcsrMode();
+  if (instr->flags & hir::CALL_TAIL) {
+    MergeExitMxcsrMode(MXCSRMode::Unknown);
+  }
+  EmitEdgeCounter(EdgeProfile::EdgeKind::kIndirectCall, current_guest_address_,
+                  0, reg.getIdx() == rdx.getIdx() ? rax : rdx);
 
   // Load the pointer to the indirection table maintained in X64CodeCache.
   // The target dword will either contain the address of the generated code
@@ -775,7 +1112,7 @@ void X64Emitter::CallIndirect(const hir::Instr* instr,
     // Old-style resolve.
     // Not too important because indirection table is almost always available.
     mov(edx, reg.cvt32());
-    mov(rax, reinterpret_cast<uint64_t>(ResolveFunction));
+    MovHostAddress(rax, reinterpret_cast<const void*>(ResolveFunction));
     mov(rcx, GetContextReg());
     call(rax);
   }
@@ -825,6 +1162,7 @@ void X64Emitter::CallExtern(const hir::Instr* instr, const Function* function) {
       mov(rcx, reinterpret_cast<uint64_t>(builtin_function->handler()));
       mov(rdx, reinterpret_cast<uint64_t>(builtin_function->arg0()));
       mov(r8, reinterpret_cast<uint64_t>(builtin_function->arg1()));
+      MarkCodeNotStorable();
       call(backend()->guest_to_host_thunk());
       // rax = host return
     }
@@ -836,15 +1174,20 @@ void X64Emitter::CallExtern(const hir::Instr* instr, const Function* function) {
       // rdx = arg0
       // r8  = arg1
       // r9  = arg2
-      mov(rcx, reinterpret_cast<uint64_t>(extern_function->extern_handler()));
+      MovHostAddress(
+          rcx, reinterpret_cast<const void*>(extern_function->extern_handler()));
       mov(rdx,
           qword[GetContextReg() + offsetof(ppc::PPCContext, kernel_state)]);
       call(backend()->guest_to_host_thunk());
       // rax = host return
+      // The handler may differ in the next run, such as for a host routine
+      // enabled by a patch.
+      MarkCodeNotStorable();
     }
   }
   if (undefined) {
     CallNative(UndefinedCallExtern, reinterpret_cast<uint64_t>(function));
+    MarkCodeNotStorable();
   }
 }
 
@@ -869,11 +1212,25 @@ void X64Emitter::CallNativeSafe(void* fn) {
   // rdx = arg0
   // r8  = arg1
   // r9  = arg2
-  mov(rcx, reinterpret_cast<uint64_t>(fn));
+  MovHostAddress(rcx, fn);
   call(backend()->guest_to_host_thunk());
   // rax = host return
 }
 
+void X64Emitter::MovHostAddress(const Xbyak::Reg64& dest,
+                                const void* host_address) {
+  size_t instr_start = getSize();
+  mov(dest, reinterpret_cast<uint64_t>(host_address));
+  if (getSize() - instr_start == 2 + sizeof(uint64_t)) {
+    // REX.W B8+r imm64.
+    host_address_relocations_.push_back(
+        {uint32_t(getSize() - sizeof(uint64_t)), host_address});
+  } else {
+    // Encoded as a shorter immediate, can't be rebased.
+    MarkCodeNotStorable();
+  }
+}
+
 void X64Emitter::SetReturnAddress(uint64_t value) {
   mov(rax, value);
   mov(qword[rsp + StackLayout::GUEST_CALL_RET_ADDR], rax);
@@ -1298,6 +1655,21 @@ Xbyak::Address X64Emitter::GetXmmConstPtr(XmmConst id) {
                (1ULL << 31));  // must not have signbit set
   return ptr[emitter_data_ptr];
 }
+const void* X64Emitter::GetPooledConstant(const vec128_t& v) {
+  // The code stored for the next launches can't refer to the pool of this
+  // one.
+  if (!cvars::shared_constant_pool || cvars::store_translated_code) {
+    return nullptr;
+  }
+  return code_cache_->PlaceConstant(v);
+}
+
+void X64Emitter::AddConstantPoolReference(const void* constant_address) {
+  ConstantPoolReference& reference = constant_pool_references_.emplace_back();
+  reference.code_offset = uint32_t(getSize());
+  reference.constant_address = constant_address;
+}
+
 // Implies possible StashXmm(0, ...)!
 void X64Emitter::LoadConstantXmm(Xbyak::Xmm dest, const vec128_t& v) {
   // https://www.agner.org/optimize/optimizing_assembly.pdf
@@ -1315,6 +1687,12 @@ void X64Emitter::LoadConstantXmm(Xbyak::Xmm dest, const vec128_t& v) {
         return;
       }
     }
+    const void* pooled = GetPooledConstant(v);
+    if (pooled) {
+      vmovdqa(dest, ptr[rip]);
+      AddConstantPoolReference(pooled);
+      return;
+    }
     if (IsFeatureEnabled(kX64EmitAVX2)) {
       bool all_equal_bytes = true;
 
@@ -1445,6 +1823,12 @@ void X64Emitter::LoadConstantXmm(Xbyak::Xmm dest, float v) {
         return;
       }
     }
+    const void* pooled = GetPooledConstant(vec128i(x.i, 0, 0, 0));
+    if (pooled) {
+      vmovss(dest, dword[rip]);
+      AddConstantPoolReference(pooled);
+      return;
+    }
     // TODO(benvanik): see what other common values are.
     // TODO(benvanik): build constant table - 99% are reused.
     mov(eax, x.i);
@@ -1472,6 +1856,12 @@ void X64Emitter::LoadConstantXmm(Xbyak::Xmm dest, double v) {
         return;
       }
     }
+    const void* pooled = GetPooledConstant(vec128q(x.i, 0));
+    if (pooled) {
+      vmovsd(dest, qword[rip]);
+      AddConstantPoolReference(pooled);
+      return;
+    }
     // TODO(benvanik): see what other common values are.
     // TODO(benvanik): build constant table - 99% are reused.
     mov(rax, x.i);
@@ -1680,6 +2070,9 @@ bool X64Emitter::ChangeMxcsrMode(MXCSRMode new_mode, bool already_set) {
     return false;
   }
   assert_true(new_mode != MXCSRMode::Unknown);
+  if (!already_set) {
+    ++mxcsr_mode_switch_count_;
+  }
 
   if (mxcsr_mode_ == MXCSRMode::Unknown) {
     // check the mode dynamically
@@ -1720,6 +2113,36 @@ bool X64Emitter::ChangeMxcsrMode(MXCSRMode new_mode, bool already_set) {
   }
   return false;
 }
+void X64Emitter::PrepareMxcsrModeForReturn() {
+  if (required_exit_mxcsr_mode_ != MXCSRMode::Unknown) {
+    ChangeMxcsrMode(required_exit_mxcsr_mode_);
+  }
+  MergeExitMxcsrMode(mxcsr_mode_);
+}
+void X64Emitter::MergeExitMxcsrMode(MXCSRMode mode) {
+  if (!has_exit_mxcsr_mode_) {
+    exit_mxcsr_mode_ = mode;
+    has_exit_mxcsr_mode_ = true;
+  } else if (exit_mxcsr_mode_ != mode) {
+    exit_mxcsr_mode_ = MXCSRMode::Unknown;
+  }
+}
+MXCSRMode X64Emitter::GetCalleeExitMxcsrMode(GuestFunction* function) {
+  if (!cvars::mxcsr_mode_summaries ||
+      cvars::enable_incorrect_roundingmode_behavior) {
+    return MXCSRMode::Unknown;
+  }
+  MXCSRMode mode = static_cast<X64Function*>(function)->exit_mxcsr_mode();
+  if (mode != MXCSRMode::Unknown &&
+      function->address() != current_guest_function_) {
+    // Retranslated along with the callee if its guest code changes. The
+    // callee may be compiled differently in the next launch.
+    processor()->RecordInlinedFunction(function->address(),
+                                       current_guest_function_);
+    MarkCodeNotStorable();
+  }
+  return mode;
+}
 void X64Emitter::LoadFpuMxcsrDirect() {
   vldmxcsr(GetBackendCtxPtr(offsetof(X64BackendContext, mxcsr_fpu)));
 }
@@ -1743,8 +2166,25 @@ void X64Emitter::HandleStackpointOverflowError(ppc::PPCContext* context) {
       "Xenia developers.");
 }
 
-void X64Emitter::PushStackpoint() {
+bool X64Emitter::RecordsStackpoints(GuestFunction* function) const {
   if (!cvars::enable_host_guest_stack_synchronization) {
+    return false;
+  }
+  if (!cvars::lazy_host_guest_stack_synchronization) {
+    return true;
+  }
+  // Only functions whose body was reentered by unwinding, ResolveFunction
+  // translating them again with stackpoints on the first reentry.
+  if (!guest_module_) {
+    return false;
+  }
+  InfoCacheFlags* flags =
+      guest_module_->GetInstructionAddressFlags(function->address());
+  return flags && flags->needs_stackpoint;
+}
+
+void X64Emitter::PushStackpoint() {
+  if (!emit_stackpoints_) {
     return;
   }
   // push the current host and guest stack pointers
@@ -1788,7 +2228,7 @@ void X64Emitter::PushStackpoint() {
   jge(overflowed_stackpoints, T_NEAR);
 }
 void X64Emitter::PopStackpoint() {
-  if (!cvars::enable_host_guest_stack_synchronization) {
+  if (!emit_stackpoints_) {
     return;
   }
   // todo: maybe verify that rsp and r1 == the stackpoint?
@@ -1799,7 +2239,8 @@ void X64Emitter::PopStackpoint() {
 }
 
 void X64Emitter::EnsureSynchronizedGuestAndHostStack() {
-  if (!cvars::enable_host_guest_stack_synchronization) {
+  // Only the body of code with stackpoints is reentered.
+  if (!emit_stackpoints_) {
     return;
   }
   // chrispy: keeping this old slower test here in case in the future changes
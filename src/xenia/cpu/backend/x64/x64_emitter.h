@@ -13,6 +13,9 @@
 #include <vector>
 
 #include "xenia/base/arena.h"
+#include "xenia/cpu/backend/x64/x64_code_cache.h"
+#include "xenia/cpu/backend/x64/x64_function.h"
+#include "xenia/cpu/edge_profile.h"
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/function_trace_data.h"
 #include "xenia/cpu/hir/hir_builder.h"
@@ -26,6 +29,7 @@
 #include "x64_amdfx_extensions.h"
 namespace xe {
 namespace cpu {
+class MemoryAccessTrace;
 class Processor;
 }  // namespace cpu
 }  // namespace xe
@@ -65,7 +69,6 @@ enum class SimdDomain : uint32_t {
                // CONFLICTING means its used in multiple domains)
 };
 
-enum class MXCSRMode : uint32_t { Unknown, Fpu, Vmx };
 XE_MAYBE_UNUSED
 static SimdDomain PickDomain2(SimdDomain dom1, SimdDomain dom2) {
   if (dom1 == dom2) {
@@ -221,6 +224,39 @@ class X64Emitter : public Xbyak::CodeGenerator {
             void** out_code_address, size_t* out_code_size,
             std::vector<SourceMapEntry>* out_source_map);
 
+  // 64-bit immediate in the emitted code containing an address within the host
+  // executable image, which needs to be rebased when the code is restored from
+  // the persistent storage in a different launch.
+  struct HostAddressRelocation {
+    uint32_t code_offset;
+    const void* host_address;
+  };
+
+  // Information about the last emitted function for the persistent storage.
+  bool is_code_storable() const { return code_storable_; }
+  const EmitFunctionInfo& emitted_function_info() const {
+    return emitted_function_info_;
+  }
+  const std::vector<HostAddressRelocation>& host_address_relocations() const {
+    return host_address_relocations_;
+  }
+  // Guest functions called directly via their machine code address.
+  const std::vector<uint32_t>& direct_call_targets() const {
+    return direct_call_targets_;
+  }
+  // Calls or jumps with a rel32 displacement to a stub calling the guest
+  // function via the indirection table, patched into direct ones later.
+  struct PatchableCallSite {
+    uint32_t target_address;
+    // Offset of the instruction in the code.
+    uint32_t code_offset;
+    // Displacement to the stub.
+    int32_t unpatched_displacement;
+  };
+  const std::vector<PatchableCallSite>& patchable_call_sites() const {
+    return patchable_call_sites_;
+  }
+
  public:
   // Reserved:  rsp, rsi, rdi
   // Scratch:   rax/rcx/rdx
@@ -270,6 +306,11 @@ class X64Emitter : public Xbyak::CodeGenerator {
   void CallNativeSafe(void* fn);
   void SetReturnAddress(uint64_t value);
 
+  // Loads the address of a static function or table of the host executable.
+  void MovHostAddress(const Xbyak::Reg64& dest, const void* host_address);
+  // The code references host data that doesn't persist between launches.
+  void MarkCodeNotStorable() { code_storable_ = false; }
+
   Xbyak::Reg64 GetNativeParam(uint32_t param);
 
   Xbyak::Reg64 GetContextReg() const;
@@ -289,6 +330,12 @@ class X64Emitter : public Xbyak::CodeGenerator {
   void LoadConstantXmm(Xbyak::Xmm dest, float v);
   void LoadConstantXmm(Xbyak::Xmm dest, double v);
   void LoadConstantXmm(Xbyak::Xmm dest, const vec128_t& v);
+  // Returns the address of the constant in the shared constant pool of the
+  // code cache, or nullptr if it can't be used for the current code. The
+  // instruction loading it must take a ptr[rip] operand as the last field, and
+  // be followed by AddConstantPoolReference.
+  const void* GetPooledConstant(const vec128_t& v);
+  void AddConstantPoolReference(const void* constant_address);
   Xbyak::Address StashXmm(int index, const Xbyak::Xmm& r);
   Xbyak::Address StashConstantXmm(int index, float v);
   Xbyak::Address StashConstantXmm(int index, double v);
@@ -305,6 +352,9 @@ class X64Emitter : public Xbyak::CodeGenerator {
   Xbyak::Label& AddToTail(TailEmitCallback callback, uint32_t alignment = 0);
   Xbyak::Label& NewCachedLabel();
 
+  // Whether the code records stackpoints, in all functions unless they're
+  // recorded lazily.
+  bool RecordsStackpoints(GuestFunction* function) const;
   void PushStackpoint();
   void PopStackpoint();
 
@@ -328,6 +378,20 @@ class X64Emitter : public Xbyak::CodeGenerator {
   void LoadFpuMxcsrDirect();  // unsafe, does not change mxcsr_mode_
   void LoadVmxMxcsrDirect();  // unsafe, does not change mxcsr_mode_
 
+  // Before leaving the function through a return. Switches to the exit mode
+  // callers were compiled against if the function has been compiled before,
+  // and merges the current mode into the exit mode of this compilation.
+  void PrepareMxcsrModeForReturn();
+  // Leaving the function through a tail call to a function with the given exit
+  // mode, or to an unknown target.
+  void MergeExitMxcsrMode(MXCSRMode mode);
+  // The exit mode of a called function if it can be relied on, making this
+  // function depend on the current code of the callee.
+  MXCSRMode GetCalleeExitMxcsrMode(GuestFunction* function);
+  void SetMxcsrMode(MXCSRMode mode) { mxcsr_mode_ = mode; }
+  // MXCSR switches and dynamic mode checks in the last emitted function.
+  uint32_t mxcsr_mode_switch_count() const { return mxcsr_mode_switch_count_; }
+
   XexModule* GuestModule() { return guest_module_; }
 
   void EmitProfilerEpilogue();
@@ -392,6 +456,13 @@ class X64Emitter : public Xbyak::CodeGenerator {
   bool Emit(hir::HIRBuilder* builder, EmitFunctionInfo& func_info);
   void EmitGetCurrentThreadId();
   void EmitTraceUserCallReturn();
+  void EmitOptimizationCounter();
+  // Increments the counter of the edge in the edge profile, if any.
+  void EmitEdgeCounter(EdgeProfile::EdgeKind kind, uint32_t site_address,
+                       uint32_t target_address, const Xbyak::Reg64& scratch);
+  // Records the guest memory access of the instruction if it's a load or a
+  // store to the traced range.
+  void EmitMemoryAccessTrace(const hir::Instr* i);
   static void HandleStackpointOverflowError(ppc::PPCContext* context);
 
  protected:
@@ -405,6 +476,12 @@ class X64Emitter : public Xbyak::CodeGenerator {
   Xbyak::util::Cpu cpu_;
   uint64_t feature_flags_ = 0;
   uint32_t current_guest_function_ = 0;
+  // Of the last source offset marked.
+  uint32_t current_guest_address_ = 0;
+  // Null unless the accesses of the function are traced.
+  MemoryAccessTrace* memory_access_trace_ = nullptr;
+  // Null unless the function entries and call sites are counted.
+  EdgeProfile* edge_profile_ = nullptr;
   Xbyak::Label* epilog_label_ = nullptr;
 
   hir::Instr* current_instr_ = nullptr;
@@ -414,6 +491,22 @@ class X64Emitter : public Xbyak::CodeGenerator {
   FunctionTraceData* trace_data_ = nullptr;
   Arena source_map_arena_;
 
+  bool emit_optimization_counter_ = false;
+  bool code_storable_ = false;
+  bool emit_stackpoints_ = false;
+  EmitFunctionInfo emitted_function_info_ = {};
+  std::vector<HostAddressRelocation> host_address_relocations_;
+  std::vector<uint32_t> direct_call_targets_;
+  std::vector<PatchableCallSite> patchable_call_sites_;
+  // RIP-relative references to the constant pool, patched once the code is
+  // placed.
+  struct ConstantPoolReference {
+    // Offset of the end of the instruction, with the disp32 right before it.
+    uint32_t code_offset;
+    const void* constant_address;
+  };
+  std::vector<ConstantPoolReference> constant_pool_references_;
+
   size_t stack_size_ = 0;
 
   static const uint32_t gpr_reg_map_[GPR_COUNT];
@@ -429,6 +522,11 @@ class X64Emitter : public Xbyak::CodeGenerator {
       label_cache_;  // for creating labels that need to be referenced much
                      // later by tail emitters
   MXCSRMode mxcsr_mode_ = MXCSRMode::Unknown;
+  // Exit mode published by the previous compilation of the function.
+  MXCSRMode required_exit_mxcsr_mode_ = MXCSRMode::Unknown;
+  MXCSRMode exit_mxcsr_mode_ = MXCSRMode::Unknown;
+  bool has_exit_mxcsr_mode_ = false;
+  uint32_t mxcsr_mode_switch_count_ = 0;
 };
 
 }  // namespace x64
@@ -10,6 +10,8 @@
 #ifndef XENIA_CPU_BACKEND_X64_X64_FUNCTION_H_
 #define XENIA_CPU_BACKEND_X64_X64_FUNCTION_H_
 
+#include <atomic>
+
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/thread_state.h"
 
@@ -18,6 +20,8 @@ namespace cpu {
 namespace backend {
 namespace x64 {
 
+enum class MXCSRMode : uint32_t { Unknown, Fpu, Vmx };
+
 class X64Function : public GuestFunction {
  public:
   X64Function(Module* module, uint32_t address);
@@ -28,12 +32,33 @@ class X64Function : public GuestFunction {
 
   void Setup(uint8_t* machine_code, size_t machine_code_length);
 
+  // The MXCSR mode all returns of the code leave the host in, Unknown if not
+  // compiled yet or if the returns don't agree. Once known, recompilations of
+  // the function return in the same mode, so callers can rely on it.
+  MXCSRMode exit_mxcsr_mode() const {
+    return exit_mxcsr_mode_.load(std::memory_order_acquire);
+  }
+  void set_exit_mxcsr_mode(MXCSRMode mode) {
+    exit_mxcsr_mode_.store(mode, std::memory_order_release);
+  }
+
+  // Size of the host stack frame of the code if it records stackpoints, 0 if
+  // it doesn't, for reentering its body with the host stack synchronized.
+  uint32_t stackpoint_frame_size() const {
+    return stackpoint_frame_size_.load(std::memory_order_acquire);
+  }
+  void set_stackpoint_frame_size(uint32_t size) {
+    stackpoint_frame_size_.store(size, std::memory_order_release);
+  }
+
  protected:
   bool CallImpl(ThreadState* thread_state, uint32_t return_address) override;
 
  private:
   uint8_t* machine_code_ = nullptr;
   size_t machine_code_length_ = 0;
+  std::atomic<MXCSRMode> exit_mxcsr_mode_{MXCSRMode::Unknown};
+  std::atomic<uint32_t> stackpoint_frame_size_{0};
 };
 
 }  // namespace x64
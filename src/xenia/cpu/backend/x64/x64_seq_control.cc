@@ -20,51 +20,88 @@ namespace backend {
 namespace x64 {
 
 volatile int anchor_control = 0;
-template <typename T>
+// The compare giving the opposite result for the same operands.
+static Opcode InvertCompare(Opcode num) {
+  switch (num) {
+    case OPCODE_COMPARE_EQ:
+      return OPCODE_COMPARE_NE;
+    case OPCODE_COMPARE_NE:
+      return OPCODE_COMPARE_EQ;
+    case OPCODE_COMPARE_SLT:
+      return OPCODE_COMPARE_SGE;
+    case OPCODE_COMPARE_SLE:
+      return OPCODE_COMPARE_SGT;
+    case OPCODE_COMPARE_SGT:
+      return OPCODE_COMPARE_SLE;
+    case OPCODE_COMPARE_SGE:
+      return OPCODE_COMPARE_SLT;
+    case OPCODE_COMPARE_ULT:
+      return OPCODE_COMPARE_UGE;
+    case OPCODE_COMPARE_ULE:
+      return OPCODE_COMPARE_UGT;
+    case OPCODE_COMPARE_UGT:
+      return OPCODE_COMPARE_ULE;
+    case OPCODE_COMPARE_UGE:
+      return OPCODE_COMPARE_ULT;
+    default:
+      return num;
+  }
+}
+
+// Branches on the flags of the compare right before the branch if it computed
+// the condition, or tests the condition otherwise. BRANCH_FALSE jumps on the
+// inverse condition.
+template <bool inverted, typename T>
 static void EmitFusedBranch(X64Emitter& e, const T& i) {
-  bool valid = i.instr->prev && i.instr->prev->dest == i.src1.value;
-  auto opcode = valid ? i.instr->prev->opcode->num : -1;
-  if (valid) {
-    std::string name = i.src2.value->GetIdString();
-    switch (opcode) {
-      case OPCODE_COMPARE_EQ:
-        e.je(std::move(name), e.T_NEAR);
-        break;
-      case OPCODE_COMPARE_NE:
-        e.jne(std::move(name), e.T_NEAR);
-        break;
-      case OPCODE_COMPARE_SLT:
-        e.jl(std::move(name), e.T_NEAR);
-        break;
-      case OPCODE_COMPARE_SLE:
-        e.jle(std::move(name), e.T_NEAR);
-        break;
-      case OPCODE_COMPARE_SGT:
-        e.jg(std::move(name), e.T_NEAR);
-        break;
-      case OPCODE_COMPARE_SGE:
-        e.jge(std::move(name), e.T_NEAR);
-        break;
-      case OPCODE_COMPARE_ULT:
-        e.jb(std::move(name), e.T_NEAR);
-        break;
-      case OPCODE_COMPARE_ULE:
-        e.jbe(std::move(name), e.T_NEAR);
-        break;
-      case OPCODE_COMPARE_UGT:
-        e.ja(std::move(name), e.T_NEAR);
-        break;
-      case OPCODE_COMPARE_UGE:
-        e.jae(std::move(name), e.T_NEAR);
-        break;
-      default:
-        e.test(i.src1, i.src1);
-        e.jnz(std::move(name), e.T_NEAR);
-        break;
-    }
-  } else {
+  std::string name = i.src2.value->GetIdString();
+  const hir::Instr* prev = i.instr->prev;
+  if (!prev || prev->dest != i.src1.value || !IsBranchFusibleCompare(prev)) {
     e.test(i.src1, i.src1);
-    e.jnz(i.src2.value->GetIdString(), e.T_NEAR);
+    if (inverted) {
+      e.jz(std::move(name), e.T_NEAR);
+    } else {
+      e.jnz(std::move(name), e.T_NEAR);
+    }
+    return;
+  }
+  Opcode condition = prev->opcode->num;
+  if (inverted) {
+    condition = InvertCompare(condition);
+  }
+  switch (condition) {
+    case OPCODE_COMPARE_EQ:
+      e.je(std::move(name), e.T_NEAR);
+      break;
+    case OPCODE_COMPARE_NE:
+      e.jne(std::move(name), e.T_NEAR);
+      break;
+    case OPCODE_COMPARE_SLT:
+      e.jl(std::move(name), e.T_NEAR);
+      break;
+    case OPCODE_COMPARE_SLE:
+      e.jle(std::move(name), e.T_NEAR);
+      break;
+    case OPCODE_COMPARE_SGT:
+      e.jg(std::move(name), e.T_NEAR);
+      break;
+    case OPCODE_COMPARE_SGE:
+      e.jge(std::move(name), e.T_NEAR);
+      break;
+    case OPCODE_COMPARE_ULT:
+      e.jb(std::move(name), e.T_NEAR);
+      break;
+    case OPCODE_COMPARE_ULE:
+      e.jbe(std::move(name), e.T_NEAR);
+      break;
+    case OPCODE_COMPARE_UGT:
+      e.ja(std::move(name), e.T_NEAR);
+      break;
+    case OPCODE_COMPARE_UGE:
+      e.jae(std::move(name), e.T_NEAR);
+      break;
+    default:
+      assert_unhandled_case(condition);
+      break;
   }
 }
 // ============================================================================
@@ -234,7 +271,11 @@ EMITTER_OPCODE_TABLE(OPCODE_TRAP_TRUE, TRAP_TRUE_I8, TRAP_TRUE_I16,
 struct CALL : Sequence<CALL, I<OPCODE_CALL, VoidOp, SymbolOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     assert_true(i.src1.value->is_guest());
-    e.Call(i.instr, static_cast<GuestFunction*>(i.src1.value));
+    auto function = static_cast<GuestFunction*>(i.src1.value);
+    e.Call(i.instr, function);
+    if (!(i.instr->flags & CALL_TAIL)) {
+      e.SetMxcsrMode(e.GetCalleeExitMxcsrMode(function));
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_CALL, CALL);
@@ -419,6 +460,7 @@ struct RETURN : Sequence<RETURN, I<OPCODE_RETURN, VoidOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     // If this is the last instruction in the last block, just let us
     // fall through.
+    e.PrepareMxcsrModeForReturn();
     if (i.instr->next || i.instr->block->next) {
       e.jmp(e.epilog_label(), CodeGenerator::T_NEAR);
     }
@@ -432,6 +474,7 @@ EMITTER_OPCODE_TABLE(OPCODE_RETURN, RETURN);
 struct RETURN_TRUE_I8
     : Sequence<RETURN_TRUE_I8, I<OPCODE_RETURN_TRUE, VoidOp, I8Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    e.PrepareMxcsrModeForReturn();
     e.test(i.src1, i.src1);
     e.jnz(e.epilog_label(), CodeGenerator::T_NEAR);
   }
@@ -439,6 +482,7 @@ struct RETURN_TRUE_I8
 struct RETURN_TRUE_I16
     : Sequence<RETURN_TRUE_I16, I<OPCODE_RETURN_TRUE, VoidOp, I16Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    e.PrepareMxcsrModeForReturn();
     e.test(i.src1, i.src1);
     e.jnz(e.epilog_label(), CodeGenerator::T_NEAR);
   }
@@ -446,6 +490,7 @@ struct RETURN_TRUE_I16
 struct RETURN_TRUE_I32
     : Sequence<RETURN_TRUE_I32, I<OPCODE_RETURN_TRUE, VoidOp, I32Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    e.PrepareMxcsrModeForReturn();
     e.test(i.src1, i.src1);
     e.jnz(e.epilog_label(), CodeGenerator::T_NEAR);
   }
@@ -453,6 +498,7 @@ struct RETURN_TRUE_I32
 struct RETURN_TRUE_I64
     : Sequence<RETURN_TRUE_I64, I<OPCODE_RETURN_TRUE, VoidOp, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    e.PrepareMxcsrModeForReturn();
     e.test(i.src1, i.src1);
     e.jnz(e.epilog_label(), CodeGenerator::T_NEAR);
   }
@@ -501,25 +547,25 @@ EMITTER_OPCODE_TABLE(OPCODE_BRANCH, BRANCH);
 struct BRANCH_TRUE_I8
     : Sequence<BRANCH_TRUE_I8, I<OPCODE_BRANCH_TRUE, VoidOp, I8Op, LabelOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    EmitFusedBranch(e, i);
+    EmitFusedBranch<false>(e, i);
   }
 };
 struct BRANCH_TRUE_I16
     : Sequence<BRANCH_TRUE_I16, I<OPCODE_BRANCH_TRUE, VoidOp, I16Op, LabelOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    EmitFusedBranch(e, i);
+    EmitFusedBranch<false>(e, i);
   }
 };
 struct BRANCH_TRUE_I32
     : Sequence<BRANCH_TRUE_I32, I<OPCODE_BRANCH_TRUE, VoidOp, I32Op, LabelOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    EmitFusedBranch(e, i);
+    EmitFusedBranch<false>(e, i);
   }
 };
 struct BRANCH_TRUE_I64
     : Sequence<BRANCH_TRUE_I64, I<OPCODE_BRANCH_TRUE, VoidOp, I64Op, LabelOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    EmitFusedBranch(e, i);
+    EmitFusedBranch<false>(e, i);
   }
 };
 struct BRANCH_TRUE_F32
@@ -556,32 +602,28 @@ EMITTER_OPCODE_TABLE(OPCODE_BRANCH_TRUE, BRANCH_TRUE_I8, BRANCH_TRUE_I16,
 struct BRANCH_FALSE_I8
     : Sequence<BRANCH_FALSE_I8, I<OPCODE_BRANCH_FALSE, VoidOp, I8Op, LabelOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.test(i.src1, i.src1);
-    e.jz(i.src2.value->GetIdString(), e.T_NEAR);
+    EmitFusedBranch<true>(e, i);
   }
 };
 struct BRANCH_FALSE_I16
     : Sequence<BRANCH_FALSE_I16,
                I<OPCODE_BRANCH_FALSE, VoidOp, I16Op, LabelOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.test(i.src1, i.src1);
-    e.jz(i.src2.value->GetIdString(), e.T_NEAR);
+    EmitFusedBranch<true>(e, i);
   }
 };
 struct BRANCH_FALSE_I32
     : Sequence<BRANCH_FALSE_I32,
                I<OPCODE_BRANCH_FALSE, VoidOp, I32Op, LabelOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.test(i.src1, i.src1);
-    e.jz(i.src2.value->GetIdString(), e.T_NEAR);
+    EmitFusedBranch<true>(e, i);
   }
 };
 struct BRANCH_FALSE_I64
     : Sequence<BRANCH_FALSE_I64,
                I<OPCODE_BRANCH_FALSE, VoidOp, I64Op, LabelOp>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.test(i.src1, i.src1);
-    e.jz(i.src2.value->GetIdString(), e.T_NEAR);
+    EmitFusedBranch<true>(e, i);
   }
 };
 struct BRANCH_FALSE_F32
@@ -533,10 +533,10 @@ struct RESERVED_STORE_INT32
     : Sequence<RESERVED_STORE_INT32,
                I<OPCODE_RESERVED_STORE, I8Op, I64Op, I32Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    // edx=guest addr
+    // ecx=guest addr
     // r9 = host addr
     // r8 = value
-    // if ZF is set and CF is set, we succeeded
+    // if ZF is set, we succeeded
     e.mov(e.ecx, i.src1.reg().cvt32());
     e.lea(e.r9, e.ptr[ComputeMemoryAddress(e, i.src1)]);
     e.mov(e.r8d, i.src2);
@@ -2171,7 +2171,7 @@ struct EXTRACT_I32
       e.mov(e.al, i.src2);
       e.and_(e.al, 0x03);
       e.shl(e.al, 4);
-      e.mov(e.rdx, reinterpret_cast<uint64_t>(extract_table_32));
+      e.MovHostAddress(e.rdx, extract_table_32);
       e.vmovaps(e.xmm0, e.ptr[e.rdx + e.rax]);
       e.vpshufb(e.xmm0, src1, e.xmm0);
       e.vpextrd(i.dest, e.xmm0, 0);
@@ -2856,11 +2856,33 @@ struct PACK : Sequence<PACK, I<OPCODE_PACK, V128Op, V128Op, V128Op>> {
     }
     return _mm_load_si128(reinterpret_cast<__m128i*>(c));
   }
+  // Places src1 and src2 in the low and high halves of ymm0, for packing both
+  // with a single AVX-512 down-converting move.
+  static void LoadPackSourcesYmm0(X64Emitter& e, const EmitArgType& i) {
+    Xmm src1 = i.src1.is_constant ? e.xmm0 : i.src1;
+    if (i.src1.is_constant) {
+      e.LoadConstantXmm(src1, i.src1.constant());
+    }
+    Xmm src2 = i.src2.is_constant ? e.xmm1 : i.src2;
+    if (i.src2.is_constant) {
+      e.LoadConstantXmm(src2, i.src2.constant());
+    }
+    e.vinserti128(e.ymm0, Xbyak::Ymm(src1.getIdx()), src2, 1);
+  }
   static void Emit8_IN_16(X64Emitter& e, const EmitArgType& i, uint32_t flags) {
     // TODO(benvanik): handle src2 (or src1) being constant zero
     if (IsPackInUnsigned(flags)) {
       if (IsPackOutUnsigned(flags)) {
-        if (IsPackOutSaturate(flags)) {
+        if (e.IsFeatureEnabled(kX64EmitAVX512Ortho | kX64EmitAVX512BW)) {
+          // vpmovuswb saturates, vpmovwb truncates.
+          LoadPackSourcesYmm0(e, i);
+          if (IsPackOutSaturate(flags)) {
+            e.vpmovuswb(i.dest, e.ymm0);
+          } else {
+            e.vpmovwb(i.dest, e.ymm0);
+          }
+          e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMByteOrderMask));
+        } else if (IsPackOutSaturate(flags)) {
           // unsigned -> unsigned + saturate
           if (i.src2.is_constant) {
             e.lea(e.GetNativeParam(1),
@@ -2930,7 +2952,14 @@ struct PACK : Sequence<PACK, I<OPCODE_PACK, V128Op, V128Op, V128Op>> {
     // TODO(benvanik): handle src2 (or src1) being constant zero
     if (IsPackInUnsigned(flags)) {
       if (IsPackOutUnsigned(flags)) {
-        if (IsPackOutSaturate(flags)) {
+        if (IsPackOutSaturate(flags) &&
+            e.IsFeatureEnabled(kX64EmitAVX512Ortho)) {
+          // unsigned -> unsigned + saturate
+          LoadPackSourcesYmm0(e, i);
+          e.vpmovusdw(i.dest, e.ymm0);
+          e.vpshuflw(i.dest, i.dest, 0b10110001);
+          e.vpshufhw(i.dest, i.dest, 0b10110001);
+        } else if (IsPackOutSaturate(flags)) {
           // unsigned -> unsigned + saturate
           // Construct a saturation max value
           e.mov(e.eax, 0xFFFFu);
@@ -42,9 +42,9 @@
 #include "xenia/cpu/processor.h"
 
 DEFINE_bool(use_fast_dot_product, false,
-            "Experimental optimization, much shorter sequence on dot products, "
-            "treating inf as overflow instead of using mcxsr"
-            "four insn dotprod",
+            "Experimental optimization, slightly shorter sequence on dot "
+            "products, treating any infinite result as overflow, including "
+            "the ones of infinite inputs.",
             "CPU");
 
 DEFINE_bool(no_round_to_single, false,
@@ -86,6 +86,7 @@ struct COMMENT : Sequence<COMMENT, I<OPCODE_COMMENT, VoidOp, OffsetOp>> {
       // TODO(benvanik): don't just leak this memory.
       auto str_copy = strdup(str);
       e.mov(e.rdx, reinterpret_cast<uint64_t>(str_copy));
+      e.MarkCodeNotStorable();
       e.CallNative(reinterpret_cast<void*>(TraceString));
     }
   }
@@ -524,6 +525,36 @@ struct LOAD_CLOCK : Sequence<LOAD_CLOCK, I<OPCODE_LOAD_CLOCK, I64Op>> {
         e.mov(e.rcx, ratio.second);
         e.div(e.rcx);
         e.mov(i.dest, e.rax);
+      } else if (!cvars::clock_no_scaling &&
+                 Clock::guest_timebase().host_ticks_raw) {
+        // The lock-free translation of the TSC to guest ticks that
+        // Clock::QueryGuestTickCount would do, reading the timebase while its
+        // sequence is even and unchanged.
+        const GuestTimebase& timebase = Clock::guest_timebase();
+        e.MovHostAddress(e.rcx, &timebase);
+        Xbyak::Label retry;
+        e.L(retry);
+        e.mov(e.r8d, e.dword[e.rcx + offsetof(GuestTimebase, sequence)]);
+        e.test(e.r8d, 1);
+        e.jnz(retry);
+        e.rdtsc();
+        e.shl(e.rdx, 32);
+        e.or_(e.rax, e.rdx);
+        e.sub(e.rax,
+              e.qword[e.rcx + offsetof(GuestTimebase, host_tick_base)]);
+        // Never go backwards if the TSC of this core is behind the base.
+        e.sbb(e.rdx, e.rdx);
+        e.not_(e.rdx);
+        e.and_(e.rax, e.rdx);
+        // 32.32 fixed point multiplication.
+        e.mul(e.qword[e.rcx +
+                      offsetof(GuestTimebase, guest_ticks_per_host_tick)]);
+        e.shrd(e.rax, e.rdx, 32);
+        e.add(e.rax,
+              e.qword[e.rcx + offsetof(GuestTimebase, guest_tick_base)]);
+        e.cmp(e.r8d, e.dword[e.rcx + offsetof(GuestTimebase, sequence)]);
+        e.jne(retry);
+        e.mov(i.dest, e.rax);
       } else {
         e.CallNative(LoadClock);
         e.mov(i.dest, e.rax);
@@ -885,6 +916,29 @@ static bool HasPrecedingCmpOfSameValues(const hir::Instr* i) {
   return prev->src1.value->IsEqual(i->src1.value) &&
          prev->src2.value->IsEqual(i->src2.value);
 }
+bool IsBranchFusibleCompare(const hir::Instr* compare) {
+  if (IsTracingData()) {
+    return false;
+  }
+  Opcode num = compare->opcode->num;
+  if (num < OPCODE_COMPARE_EQ || num > OPCODE_COMPARE_UGE) {
+    return false;
+  }
+  // With a constant first operand, the operands are swapped in the cmp, and
+  // the float compares set the flags like unsigned ones.
+  const hir::Value* src1 = compare->src1.value;
+  return !src1->IsConstant() && IsScalarIntegralType(src1->type);
+}
+// The result isn't needed if it's only used by the branch jumping on the flags.
+static bool IsOnlyUsedByFusedBranch(const hir::Instr* compare) {
+  const hir::Instr* next = compare->next;
+  if (!next || (next->opcode != &OPCODE_BRANCH_TRUE_info &&
+                next->opcode != &OPCODE_BRANCH_FALSE_info)) {
+    return false;
+  }
+  return next->src1.value == compare->dest && compare->dest->HasSingleUse() &&
+         IsBranchFusibleCompare(compare);
+}
 static bool MayCombineSetxWithFollowingCtxStore(const hir::Instr* setx_insn,
                                                 unsigned& out_offset) {
   if (IsTracingData()) {
@@ -936,6 +990,9 @@ template <typename dest>
 static void CompareEqDoSete(X64Emitter& e, const Instr* instr,
                             const dest& dst) {
   unsigned ctxoffset = 0;
+  if (IsOnlyUsedByFusedBranch(instr)) {
+    return;
+  }
   if (MayCombineSetxWithFollowingCtxStore(instr, ctxoffset)) {
     e.sete(e.byte[e.GetContextReg() + ctxoffset]);
   } else {
@@ -1057,6 +1114,9 @@ template <typename dest>
 static void CompareNeDoSetne(X64Emitter& e, const Instr* instr,
                              const dest& dst) {
   unsigned ctxoffset = 0;
+  if (IsOnlyUsedByFusedBranch(instr)) {
+    return;
+  }
   if (MayCombineSetxWithFollowingCtxStore(instr, ctxoffset)) {
     e.setne(e.byte[e.GetContextReg() + ctxoffset]);
   } else {
@@ -1160,6 +1220,9 @@ EMITTER_OPCODE_TABLE(OPCODE_COMPARE_NE, COMPARE_NE_I8, COMPARE_NE_I16,
 
 #define EMITTER_ASSOCIATE_CMP_INT_DO_SET(emit_instr, inverse_instr) \
   unsigned ctxoffset = 0;                                           \
+  if (IsOnlyUsedByFusedBranch(i.instr)) {                           \
+    return;                                                         \
+  }                                                                 \
   if (MayCombineSetxWithFollowingCtxStore(i.instr, ctxoffset)) {    \
     auto addr = e.byte[e.GetContextReg() + ctxoffset];              \
     if (!inverse) {                                                 \
@@ -2267,30 +2330,47 @@ EMITTER_OPCODE_TABLE(OPCODE_LOG2, LOG2_F32, LOG2_F64, LOG2_V128);
 // ============================================================================
 // OPCODE_DOT_PRODUCT_3
 // ============================================================================
+// Rounds the dot product summed as a double in xmm2 to single precision and
+// broadcasts it to dest, as QNaN if the rounding overflows like on the console.
+// The products and sums of floats can't overflow as doubles, so the rounding
+// overflowed exactly when the float is infinite but the double is finite,
+// checked directly rather than by clearing and testing the overflow flag of the
+// MXCSR, which stalls on every access. Matches the MXCSR-based check bit for
+// bit, the arithmetic being the same.
+static void EmitDotProductResult(X64Emitter& e, const Xmm& dest) {
+  e.vcvtsd2ss(e.xmm1, e.xmm2);
+  if (cvars::use_fast_dot_product) {
+    e.vandps(e.xmm0, e.xmm1, e.GetXmmConstPtr(XMMAbsMaskPS));
+    e.vcmpgeps(e.xmm2, e.xmm0, e.GetXmmConstPtr(XMMFloatInf));
+    e.vblendvps(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMQNaN), e.xmm2);
+  } else if (e.IsFeatureEnabled(kX64EmitAVX512Ortho | kX64EmitAVX512DQ)) {
+    // 0x18 is +-inf, 0x81 quiet and signaling NaN.
+    e.vfpclassss(e.k1, e.xmm1, 0x18);
+    e.vfpclasssd(e.k2, e.xmm2, 0x99);
+    e.kandnw(e.k1, e.k2, e.k1);
+    e.vmovss(e.xmm1 | e.k1, e.GetXmmConstPtr(XMMQNaN));
+  } else {
+    e.vandps(e.xmm0, e.xmm1, e.GetXmmConstPtr(XMMAbsMaskPS));
+    e.vcmpeqss(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMFloatInf));
+    // x - x is 0 for finite x, NaN otherwise.
+    e.vsubsd(e.xmm3, e.xmm2, e.xmm2);
+    e.vcmpordsd(e.xmm3, e.xmm3, e.xmm3);
+    e.vandps(e.xmm0, e.xmm0, e.xmm3);
+    e.vblendvps(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMQNaN), e.xmm0);
+  }
+  e.vshufps(dest, e.xmm1, e.xmm1, 0);
+}
+
 struct DOT_PRODUCT_3_V128
     : Sequence<DOT_PRODUCT_3_V128,
                I<OPCODE_DOT_PRODUCT_3, V128Op, V128Op, V128Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     e.ChangeMxcsrMode(MXCSRMode::Vmx);
-    // todo: add fast_dot_product path that just checks for infinity instead of
-    // using mxcsr
-    auto mxcsr_storage = e.dword[e.rsp + StackLayout::GUEST_SCRATCH];
-
-    // this is going to hurt a bit...
     /*
     this implementation is accurate, it matches the results of xb360 vmsum3
-    except that vmsum3 is often off by 1 bit, but its extremely slow. it is a
-    long, unbroken chain of dependencies, and the three uses of mxcsr all cost
-    about 15-20 cycles at the very least on amd zen processors. on older amd the
-    figures agner has are pretty horrible. it looks like its just as bad on
-    modern intel cpus also up until just recently. perhaps a better way of
-    detecting overflow would be to just compare with inf. todo: test whether cmp
-    with inf can replace
+    except that vmsum3 is often off by 1 bit. the products and the sums are
+    done as doubles, so only the final rounding to single precision rounds
     */
-    if (!cvars::use_fast_dot_product) {
-      e.vstmxcsr(mxcsr_storage);
-      e.mov(e.eax, 8);
-    }
     e.vmovaps(e.xmm2, e.GetXmmConstPtr(XMMThreeFloatMask));
     bool is_lensqr = i.instr->src1.value == i.instr->src2.value;
 
@@ -2308,9 +2388,6 @@ struct DOT_PRODUCT_3_V128
     } else {
       src2v = i.src2.reg();
     }
-    if (!cvars::use_fast_dot_product) {
-      e.not_(e.eax);
-    }
     // todo: maybe the top element should be cleared by the InstrEmit_ function
     // so that in the future this could be optimized away if the top is known to
     // be zero. Right now im not sure that happens often though and its
@@ -2320,11 +2397,6 @@ struct DOT_PRODUCT_3_V128
 
       e.vandps(e.xmm2, src2v, e.xmm2);
 
-      if (!cvars::use_fast_dot_product) {
-        e.and_(mxcsr_storage, e.eax);
-        e.vldmxcsr(mxcsr_storage);  // overflow flag is cleared, now we're good
-                                    // to go
-      }
       e.vcvtps2pd(e.ymm0, e.xmm3);
       e.vcvtps2pd(e.ymm1, e.xmm2);
 
@@ -2335,47 +2407,14 @@ struct DOT_PRODUCT_3_V128
       e.vmulpd(e.ymm3, e.ymm0, e.ymm1);
     } else {
       e.vandps(e.xmm3, src1v, e.xmm2);
-      if (!cvars::use_fast_dot_product) {
-        e.and_(mxcsr_storage, e.eax);
-        e.vldmxcsr(mxcsr_storage);  // overflow flag is cleared, now we're good
-                                    // to go
-      }
       e.vcvtps2pd(e.ymm0, e.xmm3);
       e.vmulpd(e.ymm3, e.ymm0, e.ymm0);
     }
     e.vextractf128(e.xmm2, e.ymm3, 1);
     e.vunpckhpd(e.xmm0, e.xmm3, e.xmm3);  // get element [1] in xmm3
     e.vaddsd(e.xmm3, e.xmm3, e.xmm2);
-    if (!cvars::use_fast_dot_product) {
-      e.not_(e.eax);
-    }
     e.vaddsd(e.xmm2, e.xmm3, e.xmm0);
-    e.vcvtsd2ss(e.xmm1, e.xmm2);
-
-    if (!cvars::use_fast_dot_product) {
-      e.vstmxcsr(mxcsr_storage);
-
-      e.test(mxcsr_storage, e.eax);
-
-      Xbyak::Label& done = e.NewCachedLabel();
-      Xbyak::Label& ret_qnan =
-          e.AddToTail([i, &done](X64Emitter& e, Xbyak::Label& me) {
-            e.L(me);
-            e.vmovaps(i.dest, e.GetXmmConstPtr(XMMQNaN));
-            e.jmp(done, X64Emitter::T_NEAR);
-          });
-
-      e.jnz(ret_qnan, X64Emitter::T_NEAR);  // reorder these jmps later, just
-                                            // want to get this fix in
-      e.vshufps(i.dest, e.xmm1, e.xmm1, 0);
-      e.L(done);
-    } else {
-      e.vandps(e.xmm0, e.xmm1, e.GetXmmConstPtr(XMMAbsMaskPS));
-
-      e.vcmpgeps(e.xmm2, e.xmm0, e.GetXmmConstPtr(XMMFloatInf));
-      e.vblendvps(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMQNaN), e.xmm2);
-      e.vshufps(i.dest, e.xmm1, e.xmm1, 0);
-    }
+    EmitDotProductResult(e, i.dest);
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_DOT_PRODUCT_3, DOT_PRODUCT_3_V128);
@@ -2388,9 +2427,6 @@ struct DOT_PRODUCT_4_V128
                I<OPCODE_DOT_PRODUCT_4, V128Op, V128Op, V128Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     e.ChangeMxcsrMode(MXCSRMode::Vmx);
-    // todo: add fast_dot_product path that just checks for infinity instead of
-    // using mxcsr
-    auto mxcsr_storage = e.dword[e.rsp + StackLayout::GUEST_SCRATCH];
 
     bool is_lensqr = i.instr->src1.value == i.instr->src2.value;
 
@@ -2408,15 +2444,6 @@ struct DOT_PRODUCT_4_V128
     } else {
       src2v = i.src2.reg();
     }
-    if (!cvars::use_fast_dot_product) {
-      e.vstmxcsr(mxcsr_storage);
-
-      e.mov(e.eax, 8);
-      e.not_(e.eax);
-
-      e.and_(mxcsr_storage, e.eax);
-      e.vldmxcsr(mxcsr_storage);
-    }
     if (is_lensqr) {
       e.vcvtps2pd(e.ymm0, src1v);
 
@@ -2431,36 +2458,8 @@ struct DOT_PRODUCT_4_V128
     e.vaddpd(e.xmm3, e.xmm3, e.xmm2);
 
     e.vunpckhpd(e.xmm0, e.xmm3, e.xmm3);
-    if (!cvars::use_fast_dot_product) {
-      e.not_(e.eax);
-    }
     e.vaddsd(e.xmm2, e.xmm3, e.xmm0);
-    e.vcvtsd2ss(e.xmm1, e.xmm2);
-
-    if (!cvars::use_fast_dot_product) {
-      e.vstmxcsr(mxcsr_storage);
-
-      e.test(mxcsr_storage, e.eax);
-
-      Xbyak::Label& done = e.NewCachedLabel();
-      Xbyak::Label& ret_qnan =
-          e.AddToTail([i, &done](X64Emitter& e, Xbyak::Label& me) {
-            e.L(me);
-            e.vmovaps(i.dest, e.GetXmmConstPtr(XMMQNaN));
-            e.jmp(done, X64Emitter::T_NEAR);
-          });
-
-      e.jnz(ret_qnan, X64Emitter::T_NEAR);  // reorder these jmps later, just
-                                            // want to get this fix in
-      e.vshufps(i.dest, e.xmm1, e.xmm1, 0);
-      e.L(done);
-    } else {
-      e.vandps(e.xmm0, e.xmm1, e.GetXmmConstPtr(XMMAbsMaskPS));
-
-      e.vcmpgeps(e.xmm2, e.xmm0, e.GetXmmConstPtr(XMMFloatInf));
-      e.vblendvps(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMQNaN), e.xmm2);
-      e.vshufps(i.dest, e.xmm1, e.xmm1, 0);
-    }
+    EmitDotProductResult(e, i.dest);
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_DOT_PRODUCT_4, DOT_PRODUCT_4_V128);
@@ -3225,7 +3224,7 @@ struct SET_ROUNDING_MODE_I32
 
       e.mov(e.ecx, i.src1);
       e.cmovc(e.edx, e.eax);
-      e.mov(e.rax, uintptr_t(mxcsr_table));
+      e.MovHostAddress(e.rax, mxcsr_table);
       e.mov(flags_ptr, e.edx);
       e.mov(e.edx, e.ptr[e.rax + e.rcx * 4]);
       // this was not here
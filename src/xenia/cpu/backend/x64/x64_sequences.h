@@ -47,6 +47,10 @@ static bool Register() {
 bool SelectSequence(X64Emitter* e, const hir::Instr* i,
                     const hir::Instr** new_tail);
 
+// Whether a conditional branch right after the compare, on its result, can
+// jump on the host flags set by the compare instead of testing the result.
+bool IsBranchFusibleCompare(const hir::Instr* compare);
+
 }  // namespace x64
 }  // namespace backend
 }  // namespace cpu
@@ -27,6 +27,9 @@ Breakpoint::~Breakpoint() { assert_false(installed_); }
 
 void Breakpoint::Install() {
   assert_false(installed_);
+  if (address_type_ == AddressType::kGuest) {
+    processor_->MakeCodeDebuggable(guest_address());
+  }
   processor_->backend()->InstallBreakpoint(this);
   installed_ = true;
 }
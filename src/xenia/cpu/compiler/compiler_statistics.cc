@@ -0,0 +1,118 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/compiler_statistics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/hir/block.h"
+#include "xenia/cpu/hir/hir_builder.h"
+#include "xenia/cpu/hir/instr.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+
+uint32_t CompilerStatistics::CountInstructions(
+    const hir::HIRBuilder* builder) {
+  uint32_t count = 0;
+  for (auto block = builder->first_block(); block; block = block->next) {
+    for (auto instr = block->instr_head; instr; instr = instr->next) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void CompilerStatistics::RecordPass(const char* name, uint64_t ticks) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PassRecord& pass = passes_[name];
+  ++pass.run_count;
+  pass.total_ticks += ticks;
+  pass.max_ticks = std::max(pass.max_ticks, ticks);
+}
+
+void CompilerStatistics::RecordFunction(const FunctionRecord& record) {
+  COUNT_profile_add("cpu/jit/translated_functions", 1);
+  COUNT_profile_add("cpu/jit/hir_instructions",
+                    record.optimized_hir_instruction_count);
+  COUNT_profile_add("cpu/jit/code_bytes", record.code_size);
+  COUNT_profile_add("cpu/jit/fp_mode_switches", record.fp_mode_switch_count);
+  std::lock_guard<std::mutex> lock(mutex_);
+  functions_.push_back(record);
+}
+
+bool CompilerStatistics::Dump(const std::filesystem::path& path,
+                              size_t function_count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FILE* file = xe::filesystem::OpenFile(path, "w");
+  if (!file) {
+    XELOGE("Failed to open {} for writing the compiler statistics",
+           xe::path_to_utf8(path));
+    return false;
+  }
+
+  double us_per_tick = 1000000.0 / double(Clock::QueryHostTickFrequency());
+
+  fprintf(file, "pass,runs,total_us,average_us,max_us\n");
+  for (const auto& pass : passes_) {
+    const PassRecord& record = pass.second;
+    fprintf(file, "%s,%llu,%.1f,%.2f,%.1f\n", pass.first.c_str(),
+            static_cast<unsigned long long>(record.run_count),
+            record.total_ticks * us_per_tick,
+            record.total_ticks * us_per_tick / double(record.run_count),
+            record.max_ticks * us_per_tick);
+  }
+
+  std::vector<const FunctionRecord*> functions;
+  functions.reserve(functions_.size());
+  for (const FunctionRecord& record : functions_) {
+    functions.push_back(&record);
+  }
+  if (!function_count || function_count > functions.size()) {
+    function_count = functions.size();
+  }
+  std::partial_sort(
+      functions.begin(), functions.begin() + function_count, functions.end(),
+      [](const FunctionRecord* a, const FunctionRecord* b) {
+        return a->total_ticks() > b->total_ticks();
+      });
+
+  fprintf(file,
+          "\nfunction,tier,hir_instructions,optimized_hir_instructions,"
+          "code_bytes,fp_mode_switches,build_us,compile_us,assemble_us,"
+          "total_us\n");
+  for (size_t i = 0; i < function_count; ++i) {
+    const FunctionRecord& record = *functions[i];
+    fprintf(file, "%08X,%s,%u,%u,%u,%u,%.1f,%.1f,%.1f,%.1f\n",
+            record.guest_address,
+            record.baseline_tier ? "baseline" : "optimized",
+            record.hir_instruction_count,
+            record.optimized_hir_instruction_count, record.code_size,
+            record.fp_mode_switch_count,
+            record.build_ticks * us_per_tick,
+            record.compile_ticks * us_per_tick,
+            record.assemble_ticks * us_per_tick,
+            record.total_ticks() * us_per_tick);
+  }
+
+  fclose(file);
+  XELOGI("Wrote the compiler statistics of {} functions to {}",
+         functions_.size(), xe::path_to_utf8(path));
+  return true;
+}
+
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
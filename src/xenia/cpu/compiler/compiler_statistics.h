@@ -0,0 +1,77 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_COMPILER_STATISTICS_H_
+#define XENIA_CPU_COMPILER_COMPILER_STATISTICS_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xe {
+namespace cpu {
+namespace hir {
+class HIRBuilder;
+}  // namespace hir
+namespace compiler {
+
+// Cost of translating guest functions, per function and per compiler pass, for
+// finding what's worth optimizing in the translation pipeline. Times are in
+// host ticks. Safe to use from multiple translator threads.
+class CompilerStatistics {
+ public:
+  struct FunctionRecord {
+    uint32_t guest_address;
+    bool baseline_tier;
+    uint32_t hir_instruction_count;
+    uint32_t optimized_hir_instruction_count;
+    uint32_t code_size;
+    // Host floating-point mode switches and checks left in the code.
+    uint32_t fp_mode_switch_count;
+    // Scanning and building the HIR.
+    uint64_t build_ticks;
+    // Running the compiler passes.
+    uint64_t compile_ticks;
+    // Emitting and placing the machine code.
+    uint64_t assemble_ticks;
+
+    uint64_t total_ticks() const {
+      return build_ticks + compile_ticks + assemble_ticks;
+    }
+  };
+
+  static uint32_t CountInstructions(const hir::HIRBuilder* builder);
+
+  void RecordPass(const char* name, uint64_t ticks);
+  void RecordFunction(const FunctionRecord& record);
+
+  // Writes the per-pass totals and the most expensive functions (all of them
+  // if function_count is 0) as CSV tables.
+  bool Dump(const std::filesystem::path& path, size_t function_count);
+
+ private:
+  struct PassRecord {
+    uint64_t run_count = 0;
+    uint64_t total_ticks = 0;
+    uint64_t max_ticks = 0;
+  };
+
+  std::mutex mutex_;
+  std::map<std::string, PassRecord> passes_;
+  std::vector<FunctionRecord> functions_;
+};
+
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_COMPILER_STATISTICS_H_
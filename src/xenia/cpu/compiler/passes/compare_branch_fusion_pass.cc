@@ -0,0 +1,137 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/compare_branch_fusion_pass.h"
+
+#include "xenia/base/cvar.h"
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/processor.h"
+
+DECLARE_bool(full_optimization_even_with_debug);
+
+DEFINE_bool(compare_branch_fusion, true,
+            "Move the compares conditional branches depend on next to the "
+            "branches, so the host flags can be branched on directly.",
+            "CPU");
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Value;
+
+namespace {
+bool IsCompareOpcode(Opcode num) {
+  return num >= OPCODE_COMPARE_EQ && num <= OPCODE_COMPARE_UGE;
+}
+
+// The compare giving the same result with the operands swapped.
+const OpcodeInfo& GetSwappedCompare(Opcode num) {
+  switch (num) {
+    case OPCODE_COMPARE_SLT:
+      return OPCODE_COMPARE_SGT_info;
+    case OPCODE_COMPARE_SLE:
+      return OPCODE_COMPARE_SGE_info;
+    case OPCODE_COMPARE_SGT:
+      return OPCODE_COMPARE_SLT_info;
+    case OPCODE_COMPARE_SGE:
+      return OPCODE_COMPARE_SLE_info;
+    case OPCODE_COMPARE_ULT:
+      return OPCODE_COMPARE_UGT_info;
+    case OPCODE_COMPARE_ULE:
+      return OPCODE_COMPARE_UGE_info;
+    case OPCODE_COMPARE_UGT:
+      return OPCODE_COMPARE_ULT_info;
+    case OPCODE_COMPARE_UGE:
+      return OPCODE_COMPARE_ULE_info;
+    case OPCODE_COMPARE_NE:
+      return OPCODE_COMPARE_NE_info;
+    default:
+      return OPCODE_COMPARE_EQ_info;
+  }
+}
+}  // namespace
+
+CompareBranchFusionPass::CompareBranchFusionPass() : CompilerPass() {}
+
+CompareBranchFusionPass::~CompareBranchFusionPass() {}
+
+bool CompareBranchFusionPass::Run(HIRBuilder* builder) {
+  if (!cvars::compare_branch_fusion ||
+      ((builder->attributes() & hir::FUNCTION_ATTRIB_DEBUGGABLE) &&
+       !cvars::full_optimization_even_with_debug)) {
+    return true;
+  }
+
+  for (auto block = builder->first_block(); block; block = block->next) {
+    for (auto i = block->instr_tail;
+         i && (i->opcode->flags & OPCODE_FLAG_BRANCH); i = i->prev) {
+      if (i->opcode == &OPCODE_BRANCH_TRUE_info ||
+          i->opcode == &OPCODE_BRANCH_FALSE_info) {
+        FuseBranch(builder, i);
+      }
+    }
+  }
+
+  return true;
+}
+
+bool CompareBranchFusionPass::FuseBranch(HIRBuilder* builder, Instr* branch) {
+  Value* condition = branch->src1.value;
+  if (condition->IsConstant()) {
+    return false;
+  }
+  Instr* compare = condition->def;
+  if (!compare || compare->block != branch->block ||
+      !IsCompareOpcode(compare->opcode->num)) {
+    return false;
+  }
+  Value* src1 = compare->src1.value;
+  Value* src2 = compare->src2.value;
+  // Float compares don't set the host flags the way the integer conditional
+  // jumps expect.
+  if (!IsScalarIntegralType(src1->type) ||
+      (src1->IsConstant() && src2->IsConstant())) {
+    return false;
+  }
+  bool swap = src1->IsConstant();
+  if (branch->prev == compare && !swap) {
+    // Already right before the branch.
+    return false;
+  }
+
+  if (!condition->HasSingleUse() || swap) {
+    // Keep the original for the other users, the condition register field
+    // stores mostly.
+    Value* fused = builder->AllocValue(condition->type);
+    Instr* fused_compare = builder->AppendInstr(
+        swap ? GetSwappedCompare(compare->opcode->num) : *compare->opcode,
+        compare->flags, fused);
+    fused_compare->set_src1(swap ? src2 : src1);
+    fused_compare->set_src2(swap ? src1 : src2);
+    fused_compare->MoveBefore(branch);
+    // Left to the dead code elimination if only the branch used it.
+    branch->set_src1(fused);
+  } else {
+    compare->MoveBefore(branch);
+  }
+  return true;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
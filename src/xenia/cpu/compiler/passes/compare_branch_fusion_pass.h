@@ -0,0 +1,44 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_COMPARE_BRANCH_FUSION_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_COMPARE_BRANCH_FUSION_PASS_H_
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Places the integer compares conditional branches depend on immediately
+// before the branches, with the variable operand first, so the backend can
+// branch on the flags of the compare directly instead of testing the
+// materialized condition register bit. Compares also used elsewhere, such as
+// by the stores of the condition register fields, are duplicated, the stores
+// themselves being left to the dead store elimination if overwritten before
+// being read.
+class CompareBranchFusionPass : public CompilerPass {
+ public:
+  CompareBranchFusionPass();
+  ~CompareBranchFusionPass() override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "CompareBranchFusion"; }
+
+ private:
+  bool FuseBranch(hir::HIRBuilder* builder, hir::Instr* branch);
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_COMPARE_BRANCH_FUSION_PASS_H_
@@ -277,6 +277,7 @@ bool ConstantPropagationPass::Run(HIRBuilder* builder, bool& result) {
                   !(protect & kMemoryProtectWrite) &&
                   (protect & kMemoryProtectRead)) {
                 // Memory is readonly - can just return the value.
+                builder->RecordConstantLoad(address);
                 auto host_addr = memory->TranslateVirtual(address);
                 switch (v->type) {
                   case INT8_TYPE:
@@ -13,11 +13,10 @@
 #include "xenia/base/cvar.h"
 #include "xenia/base/profiling.h"
 #include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/compiler/scratch_bit_vector.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/cpu/processor.h"
 
-DECLARE_bool(debug);
-
 DEFINE_bool(store_all_context_values, false,
             "Don't strip dead context stores to aid in debugging.", "CPU");
 
@@ -26,6 +25,11 @@ DEFINE_bool(full_optimization_even_with_debug, false,
             "not intended for actual debugging of the code",
             "CPU");
 
+DEFINE_bool(global_context_store_elimination, true,
+            "Remove the context stores overwritten before being read across "
+            "the blocks of the function rather than within a block.",
+            "CPU");
+
 namespace xe {
 namespace cpu {
 namespace compiler {
@@ -83,11 +87,16 @@ bool ContextPromotionPass::Run(HIRBuilder* builder) {
   // This will break debugging as we can't recover this information when
   // trying to extract stack traces/register values, so we don't do that.
   if (cvars::full_optimization_even_with_debug ||
-      (!cvars::debug && !cvars::store_all_context_values)) {
-    block = builder->first_block();
-    while (block) {
-      RemoveDeadStoresBlock(block);
-      block = block->next;
+      (!(builder->attributes() & hir::FUNCTION_ATTRIB_DEBUGGABLE) &&
+       !cvars::store_all_context_values)) {
+    if (cvars::global_context_store_elimination) {
+      RemoveDeadStores(builder);
+    } else {
+      block = builder->first_block();
+      while (block) {
+        RemoveDeadStoresBlock(block);
+        block = block->next;
+      }
     }
   }
 
@@ -153,6 +162,119 @@ void ContextPromotionPass::RemoveDeadStoresBlock(Block* block) {
   }
 }
 
+void ContextPromotionPass::RemoveDeadStores(HIRBuilder* builder) {
+  // Backward liveness of the context bytes over the control flow graph. Only
+  // the loads within the function read the context, other than volatile
+  // instructions such as calls, returns and traps, and context barriers, which
+  // need all of it to be up to date.
+  Arena* scratch = scratch_arena();
+  const size_t context_size = sizeof(ppc::PPCContext);
+  uint32_t block_count = 0;
+  auto block = builder->first_block();
+  while (block) {
+    block->ordinal = block_count++;
+    block = block->next;
+  }
+  if (!block_count) {
+    return;
+  }
+  if (block_count > UINT16_MAX + 1) {
+    // Ordinals have wrapped around.
+    block = builder->first_block();
+    while (block) {
+      RemoveDeadStoresBlock(block);
+      block = block->next;
+    }
+    return;
+  }
+  auto live_in = reinterpret_cast<ScratchBitVector**>(scratch->Alloc(
+      sizeof(ScratchBitVector*) * block_count, alignof(ScratchBitVector*)));
+  for (uint32_t i = 0; i < block_count; ++i) {
+    live_in[i] = ScratchBitVector::Create(scratch, context_size);
+  }
+  ScratchBitVector live(scratch, context_size);
+
+  // Computes what's live at the end of the block, not including the targets
+  // of the branches, which are handled at the branch instructions.
+  auto init_live_out = [&live, live_in](Block* block) {
+    Instr* tail = block->instr_tail;
+    if (tail && (tail->opcode == &OPCODE_BRANCH_info ||
+                 tail->opcode == &OPCODE_RETURN_info)) {
+      live.reset();
+    } else if (block->next) {
+      live.assign(*live_in[block->next->ordinal]);
+    } else {
+      // Leaving the function.
+      live.set_all();
+    }
+  };
+
+  // Iterate until the liveness stops changing, walking in reverse as data
+  // flows backwards.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    block = builder->last_block();
+    while (block) {
+      init_live_out(block);
+      PropagateContextLiveness(block, live_in, live, false);
+      if (!live_in[block->ordinal]->equals(live)) {
+        live_in[block->ordinal]->assign(live);
+        changed = true;
+      }
+      block = block->prev;
+    }
+  }
+
+  block = builder->first_block();
+  while (block) {
+    init_live_out(block);
+    PropagateContextLiveness(block, live_in, live, true);
+    block = block->next;
+  }
+}
+
+void ContextPromotionPass::PropagateContextLiveness(Block* block,
+                                                    ScratchBitVector** live_in,
+                                                    ScratchBitVector& live,
+                                                    bool remove_dead) {
+  const size_t context_size = sizeof(ppc::PPCContext);
+  Instr* i = block->instr_tail;
+  while (i) {
+    Instr* prev = i->prev;
+    if (i->opcode == &OPCODE_BRANCH_info) {
+      live |= *live_in[i->src1.label->block->ordinal];
+    } else if (i->opcode == &OPCODE_BRANCH_TRUE_info ||
+               i->opcode == &OPCODE_BRANCH_FALSE_info) {
+      live |= *live_in[i->src2.label->block->ordinal];
+    } else if ((i->opcode->flags & OPCODE_FLAG_VOLATILE) ||
+               i->opcode == &OPCODE_CONTEXT_BARRIER_info) {
+      live.set_all();
+    } else if (i->opcode == &OPCODE_LOAD_CONTEXT_info) {
+      size_t offset = i->src1.offset;
+      size_t end = offset + GetTypeSize(i->dest->type);
+      if (end <= context_size) {
+        live.set_range(offset, end);
+      } else {
+        live.set_all();
+      }
+    } else if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+      size_t offset = i->src1.offset;
+      size_t end = offset + GetTypeSize(i->src2.value->type);
+      if (end <= context_size) {
+        if (!live.any_in_range(offset, end)) {
+          if (remove_dead) {
+            i->UnlinkAndNOP();
+          }
+        } else {
+          live.reset_range(offset, end);
+        }
+      }
+    }
+    i = prev;
+  }
+}
+
 }  // namespace passes
 }  // namespace compiler
 }  // namespace cpu
@@ -29,6 +29,7 @@
 namespace xe {
 namespace cpu {
 namespace compiler {
+class ScratchBitVector;
 namespace passes {
 
 class ContextPromotionPass : public CompilerPass {
@@ -39,10 +40,18 @@ class ContextPromotionPass : public CompilerPass {
   bool Initialize(Compiler* compiler) override;
 
   bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "ContextPromotion"; }
 
  private:
   void PromoteBlock(hir::Block* block);
   void RemoveDeadStoresBlock(hir::Block* block);
+  // Removes stores overwritten before being read on all paths through the
+  // control flow graph of the function.
+  void RemoveDeadStores(hir::HIRBuilder* builder);
+  // Walks the block backwards from the context bytes live at its end, updating
+  // them to those live at its beginning, optionally removing dead stores.
+  void PropagateContextLiveness(hir::Block* block, ScratchBitVector** live_in,
+                                ScratchBitVector& live, bool remove_dead);
 
  private:
   std::vector<hir::Value*> context_values_;
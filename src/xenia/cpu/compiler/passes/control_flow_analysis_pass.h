@@ -23,6 +23,7 @@ class ControlFlowAnalysisPass : public CompilerPass {
   ~ControlFlowAnalysisPass() override;
 
   bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "ControlFlowAnalysis"; }
 
  private:
 };
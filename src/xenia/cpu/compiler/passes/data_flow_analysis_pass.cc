@@ -14,19 +14,9 @@
 #include "xenia/base/profiling.h"
 #include "xenia/cpu/backend/backend.h"
 #include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/compiler/scratch_bit_vector.h"
 #include "xenia/cpu/processor.h"
 
-#if XE_COMPILER_MSVC
-#pragma warning(push)
-#pragma warning(disable : 4244)
-#pragma warning(disable : 4267)
-#include <llvm/ADT/BitVector.h>
-#pragma warning(pop)
-#else
-#include <llvm/ADT/BitVector.h>
-#include <cmath>
-#endif  // XE_COMPILER_MSVC
-
 namespace xe {
 namespace cpu {
 namespace compiler {
@@ -75,15 +65,19 @@ void DataFlowAnalysisPass::AnalyzeFlow(HIRBuilder* builder,
   auto value_map = reinterpret_cast<Value**>(
       arena->Alloc(sizeof(Value*) * max_value_estimate, alignof(Value)));
 
-  // Allocate incoming bitvectors for use by blocks. We don't need outgoing
-  // because they are only used during the block iteration.
+  // Allocate incoming bitvectors for use by blocks in the scratch arena of the
+  // pass. We don't need outgoing because they are only used during the block
+  // iteration, so one is reused for all blocks.
   // Mapped by block ordinal.
-  // TODO(benvanik): cache this list, grow as needed, etc.
-  auto incoming_bitvectors = (llvm::BitVector**)arena->Alloc(
-      sizeof(llvm::BitVector*) * block_count, alignof(llvm::BitVector));
+  Arena* scratch = scratch_arena();
+  auto incoming_bitvectors = reinterpret_cast<ScratchBitVector**>(
+      scratch->Alloc(sizeof(ScratchBitVector*) * block_count,
+                     alignof(ScratchBitVector*)));
   for (auto n = 0u; n < block_count; n++) {
-    incoming_bitvectors[n] = new llvm::BitVector(max_value_estimate);
+    incoming_bitvectors[n] =
+        ScratchBitVector::Create(scratch, max_value_estimate);
   }
+  ScratchBitVector outgoing_values(scratch, max_value_estimate);
 
   // Walk blocks in reverse and calculate incoming/outgoing values.
   auto block = builder->last_block();
@@ -117,7 +111,7 @@ void DataFlowAnalysisPass::AnalyzeFlow(HIRBuilder* builder,
 
     // Add all successor incoming values to our outgoing, as we need to
     // pass them through.
-    llvm::BitVector outgoing_values(max_value_estimate);
+    outgoing_values.reset();
     auto outgoing_edge = block->outgoing_edge_head;
     while (outgoing_edge) {
       if (outgoing_edge->dest->ordinal > block->ordinal) {
@@ -202,9 +196,10 @@ void DataFlowAnalysisPass::AnalyzeFlow(HIRBuilder* builder,
     block = block->prev;
   }
 
-  // Cleanup bitvectors.
-  for (auto n = 0u; n < block_count; n++) {
-    delete incoming_bitvectors[n];
+  block = builder->first_block();
+  while (block) {
+    block->incoming_values = nullptr;
+    block = block->next;
   }
 }
 
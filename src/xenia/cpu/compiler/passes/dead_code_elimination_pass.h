@@ -23,6 +23,7 @@ class DeadCodeEliminationPass : public CompilerPass {
   ~DeadCodeEliminationPass() override;
 
   bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "DeadCodeElimination"; }
 
  private:
   void MakeNopRecursive(hir::Instr* i);
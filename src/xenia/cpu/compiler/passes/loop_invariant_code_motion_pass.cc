@@ -0,0 +1,355 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/loop_invariant_code_motion_pass.h"
+
+#include <cstring>
+
+#include "xenia/base/cvar.h"
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/processor.h"
+
+DECLARE_bool(full_optimization_even_with_debug);
+
+DEFINE_bool(loop_invariant_code_motion, true,
+            "Move the computations not changing between the iterations of "
+            "loops out of the loops.",
+            "CPU");
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Value;
+
+namespace {
+// Beyond this, the locals are unlikely to be worth it.
+constexpr uint32_t kMaxHoistedValues = 8;
+
+struct LoopBlockInfo {
+  // The last distinct block found branching to the block, other than itself.
+  Block* predecessor;
+  uint32_t predecessor_count;
+  bool branches_to_self;
+};
+
+Label* GetBranchLabel(const Instr* i) {
+  if (i->opcode == &OPCODE_BRANCH_info) {
+    return i->src1.label;
+  }
+  if (i->opcode == &OPCODE_BRANCH_TRUE_info ||
+      i->opcode == &OPCODE_BRANCH_FALSE_info) {
+    return i->src2.label;
+  }
+  return nullptr;
+}
+}  // namespace
+
+LoopInvariantCodeMotionPass::LoopInvariantCodeMotionPass() : CompilerPass() {}
+
+LoopInvariantCodeMotionPass::~LoopInvariantCodeMotionPass() {}
+
+bool LoopInvariantCodeMotionPass::Run(HIRBuilder* builder) {
+  if (!cvars::loop_invariant_code_motion ||
+      ((builder->attributes() & hir::FUNCTION_ATTRIB_DEBUGGABLE) &&
+       !cvars::full_optimization_even_with_debug)) {
+    return true;
+  }
+
+  uint32_t block_count = 0;
+  for (auto block = builder->first_block(); block; block = block->next) {
+    block->ordinal = block_count++;
+  }
+  if (!block_count || block_count > UINT16_MAX + 1) {
+    return true;
+  }
+
+  // Find the predecessors of the blocks from the branches at their tails, as
+  // the edges may be stale after the earlier passes.
+  Arena* scratch = scratch_arena();
+  auto infos = reinterpret_cast<LoopBlockInfo*>(scratch->Alloc(
+      sizeof(LoopBlockInfo) * block_count, alignof(LoopBlockInfo)));
+  std::memset(infos, 0, sizeof(LoopBlockInfo) * block_count);
+  for (auto block = builder->first_block(); block; block = block->next) {
+    for (auto i = block->instr_tail;
+         i && (i->opcode->flags & OPCODE_FLAG_BRANCH); i = i->prev) {
+      Label* label = GetBranchLabel(i);
+      if (!label) {
+        continue;
+      }
+      LoopBlockInfo& info = infos[label->block->ordinal];
+      if (label->block == block) {
+        info.branches_to_self = true;
+      } else if (info.predecessor != block) {
+        info.predecessor = block;
+        ++info.predecessor_count;
+      }
+    }
+  }
+
+  for (auto block = builder->first_block(); block; block = block->next) {
+    const LoopBlockInfo& info = infos[block->ordinal];
+    // Only loops with a single way in, not being loops themselves, as the
+    // code would be moved into the loop otherwise.
+    if (!info.branches_to_self || info.predecessor_count != 1 ||
+        infos[info.predecessor->ordinal].branches_to_self) {
+      continue;
+    }
+    HoistLoop(builder, block, info.predecessor);
+  }
+
+  return true;
+}
+
+bool LoopInvariantCodeMotionPass::HoistLoop(HIRBuilder* builder, Block* loop,
+                                            Block* preheader) {
+  // The hoisted instructions go before the branches at the end of the
+  // preheader. They may be executed when the loop isn't entered, so only
+  // instructions that can't fault are hoisted.
+  Instr* insert_point = preheader->instr_tail;
+  while (insert_point->prev &&
+         (insert_point->prev->opcode->flags & OPCODE_FLAG_BRANCH)) {
+    insert_point = insert_point->prev;
+  }
+  for (auto i = insert_point; i; i = i->next) {
+    if (!GetBranchLabel(i)) {
+      // A call could change the context after the hoisted loads.
+      return false;
+    }
+  }
+
+  context_stores_.clear();
+  for (auto i = loop->instr_head; i; i = i->next) {
+    switch (i->opcode->num) {
+      case OPCODE_STORE_CONTEXT:
+        context_stores_.emplace_back(i->src1.offset,
+                                     GetTypeSize(i->src2.value->type));
+        break;
+      // Anything that may change the context or the state the floating-point
+      // operations depend on invisibly.
+      case OPCODE_CALL:
+      case OPCODE_CALL_TRUE:
+      case OPCODE_CALL_INDIRECT:
+      case OPCODE_CALL_INDIRECT_TRUE:
+      case OPCODE_CALL_EXTERN:
+      case OPCODE_DEBUG_BREAK:
+      case OPCODE_DEBUG_BREAK_TRUE:
+      case OPCODE_TRAP:
+      case OPCODE_TRAP_TRUE:
+      case OPCODE_CONTEXT_BARRIER:
+      case OPCODE_LOAD_MMIO:
+      case OPCODE_STORE_MMIO:
+      case OPCODE_SET_ROUNDING_MODE:
+      case OPCODE_SET_NJM:
+      case OPCODE_DID_SATURATE:
+      case OPCODE_RESERVED_LOAD:
+      case OPCODE_RESERVED_STORE:
+        return false;
+      default:
+        break;
+    }
+  }
+
+  // Mark the invariant instructions, in order, so the sources are marked
+  // before their uses. The instruction ordinals are free until register
+  // allocation.
+  uint32_t hoisted_count = 0;
+  for (auto i = loop->instr_head; i; i = i->next) {
+    i->ordinal = IsInvariant(i) ? 1 : 0;
+    hoisted_count += i->ordinal;
+  }
+  // The values used by what stays in the loop need locals.
+  uint32_t value_count = 0;
+  for (auto i = loop->instr_head; i; i = i->next) {
+    if (!i->ordinal) {
+      continue;
+    }
+    for (auto use = i->dest->use_head; use; use = use->next) {
+      if (!use->instr->ordinal) {
+        ++value_count;
+        break;
+      }
+    }
+  }
+  // Each value costs a load from the local per iteration.
+  if (!value_count || value_count > kMaxHoistedValues ||
+      hoisted_count <= value_count) {
+    return false;
+  }
+
+  Instr* first_hoisted = nullptr;
+  auto i = loop->instr_head;
+  while (i) {
+    auto next = i->next;
+    if (i->ordinal) {
+      i->MoveBefore(insert_point);
+      if (!first_hoisted) {
+        first_hoisted = i;
+      }
+    }
+    i = next;
+  }
+
+  for (i = first_hoisted; i != insert_point; i = i->next) {
+    // Skip the stores to the locals added at the end.
+    if (!i->dest) {
+      continue;
+    }
+    uses_.clear();
+    for (auto use = i->dest->use_head; use; use = use->next) {
+      if (use->instr->block == loop) {
+        uses_.push_back(use->instr);
+      }
+    }
+    if (uses_.empty()) {
+      continue;
+    }
+    Value* value = i->dest;
+    Value* slot = builder->AllocLocal(value->type);
+    builder->StoreLocal(slot, value);
+    builder->last_instr()->MoveBefore(insert_point);
+    Value* local_value = builder->LoadLocal(slot);
+    local_value->def->MoveBefore(loop->instr_head);
+    for (Instr* use_instr : uses_) {
+      for (uint32_t n = 0; n < 3; ++n) {
+        if (use_instr->srcs_use[n] && use_instr->srcs[n].value == value) {
+          use_instr->set_srcN(local_value, n);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool LoopInvariantCodeMotionPass::IsInvariant(Instr* i) const {
+  if (i->opcode->flags & (OPCODE_FLAG_VOLATILE | OPCODE_FLAG_MEMORY)) {
+    return false;
+  }
+  switch (i->opcode->num) {
+    case OPCODE_LOAD_CONTEXT: {
+      size_t begin = i->src1.offset;
+      size_t end = begin + GetTypeSize(i->dest->type);
+      for (const auto& store : context_stores_) {
+        if (store.first < end && begin < store.first + store.second) {
+          return false;
+        }
+      }
+      return true;
+    }
+    // Operations only depending on the sources, and not faulting.
+    case OPCODE_ASSIGN:
+    case OPCODE_CAST:
+    case OPCODE_ZERO_EXTEND:
+    case OPCODE_SIGN_EXTEND:
+    case OPCODE_TRUNCATE:
+    case OPCODE_CONVERT:
+    case OPCODE_ROUND:
+    case OPCODE_VECTOR_CONVERT_I2F:
+    case OPCODE_VECTOR_CONVERT_F2I:
+    case OPCODE_LOAD_VECTOR_SHL:
+    case OPCODE_LOAD_VECTOR_SHR:
+    case OPCODE_MAX:
+    case OPCODE_VECTOR_MAX:
+    case OPCODE_MIN:
+    case OPCODE_VECTOR_MIN:
+    case OPCODE_SELECT:
+    case OPCODE_IS_NAN:
+    case OPCODE_COMPARE_EQ:
+    case OPCODE_COMPARE_NE:
+    case OPCODE_COMPARE_SLT:
+    case OPCODE_COMPARE_SLE:
+    case OPCODE_COMPARE_SGT:
+    case OPCODE_COMPARE_SGE:
+    case OPCODE_COMPARE_ULT:
+    case OPCODE_COMPARE_ULE:
+    case OPCODE_COMPARE_UGT:
+    case OPCODE_COMPARE_UGE:
+    case OPCODE_VECTOR_COMPARE_EQ:
+    case OPCODE_VECTOR_COMPARE_SGT:
+    case OPCODE_VECTOR_COMPARE_SGE:
+    case OPCODE_VECTOR_COMPARE_UGT:
+    case OPCODE_VECTOR_COMPARE_UGE:
+    case OPCODE_ADD:
+    case OPCODE_ADD_CARRY:
+    case OPCODE_VECTOR_ADD:
+    case OPCODE_SUB:
+    case OPCODE_VECTOR_SUB:
+    case OPCODE_MUL:
+    case OPCODE_MUL_HI:
+    case OPCODE_MUL_ADD:
+    case OPCODE_MUL_SUB:
+    case OPCODE_NEG:
+    case OPCODE_ABS:
+    case OPCODE_SQRT:
+    case OPCODE_RSQRT:
+    case OPCODE_RECIP:
+    case OPCODE_POW2:
+    case OPCODE_LOG2:
+    case OPCODE_DOT_PRODUCT_3:
+    case OPCODE_DOT_PRODUCT_4:
+    case OPCODE_AND:
+    case OPCODE_AND_NOT:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_NOT:
+    case OPCODE_SHL:
+    case OPCODE_VECTOR_SHL:
+    case OPCODE_SHR:
+    case OPCODE_VECTOR_SHR:
+    case OPCODE_SHA:
+    case OPCODE_VECTOR_SHA:
+    case OPCODE_ROTATE_LEFT:
+    case OPCODE_VECTOR_ROTATE_LEFT:
+    case OPCODE_VECTOR_AVERAGE:
+    case OPCODE_BYTE_SWAP:
+    case OPCODE_CNTLZ:
+    case OPCODE_INSERT:
+    case OPCODE_EXTRACT:
+    case OPCODE_SPLAT:
+    case OPCODE_PERMUTE:
+    case OPCODE_SWIZZLE:
+    case OPCODE_PACK:
+    case OPCODE_UNPACK:
+    case OPCODE_VECTOR_DENORMFLUSH:
+    case OPCODE_TO_SINGLE:
+      break;
+    default:
+      return false;
+  }
+  // Values can't come from another block, so the sources are either constants
+  // or defined by instructions hoisted before.
+  uint32_t signature = i->opcode->signature;
+  const OpcodeSignatureType src_types[] = {
+      GET_OPCODE_SIG_TYPE_SRC1(signature), GET_OPCODE_SIG_TYPE_SRC2(signature),
+      GET_OPCODE_SIG_TYPE_SRC3(signature)};
+  for (uint32_t n = 0; n < 3; ++n) {
+    if (src_types[n] != OPCODE_SIG_TYPE_V) {
+      continue;
+    }
+    Value* src = i->srcs[n].value;
+    if (!src->IsConstant() &&
+        (!src->def || src->def->block != i->block || !src->def->ordinal)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
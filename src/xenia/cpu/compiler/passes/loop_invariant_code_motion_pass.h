@@ -0,0 +1,51 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
+
+#include <utility>
+#include <vector>
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Hoists the computations not depending on anything changed in a loop out of
+// loops consisting of a single block, with the block branching back to itself,
+// into the only block entering it. As values can't live across blocks, the
+// hoisted results are passed to the loop through locals, so only loops saving
+// more instructions per iteration than the locals cost are changed.
+class LoopInvariantCodeMotionPass : public CompilerPass {
+ public:
+  LoopInvariantCodeMotionPass();
+  ~LoopInvariantCodeMotionPass() override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "LoopInvariantCodeMotion"; }
+
+ private:
+  bool HoistLoop(hir::HIRBuilder* builder, hir::Block* loop,
+                 hir::Block* preheader);
+  bool IsInvariant(hir::Instr* i) const;
+
+  // Context byte ranges (offset, size) stored to in the loop being processed.
+  std::vector<std::pair<size_t, size_t>> context_stores_;
+  std::vector<hir::Instr*> uses_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
@@ -23,6 +23,7 @@ class MemorySequenceCombinationPass : public CompilerPass {
   ~MemorySequenceCombinationPass() override;
 
   bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "MemorySequenceCombination"; }
 
  private:
   void CombineMemorySequences(hir::HIRBuilder* builder);
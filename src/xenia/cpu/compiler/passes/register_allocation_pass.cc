@@ -13,10 +13,17 @@
 #include <cstring>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
 
+DEFINE_bool(spill_by_context_reload, true,
+            "Spill the values loaded from the context, if it isn't changed "
+            "before they're used again, by loading them again instead of "
+            "storing them to the stack.",
+            "CPU");
+
 namespace xe {
 namespace cpu {
 namespace compiler {
@@ -148,7 +155,7 @@ bool RegisterAllocationPass::Run(HIRBuilder* builder) {
         if (!allocated) {
           // Failed to allocate register -- need to spill and try again.
           // We spill only those registers we aren't using.
-          if (!SpillOneRegister(builder, block, instr->dest->type)) {
+          if (!SpillOneRegister(builder, block, instr, instr->dest->type)) {
             // Unable to spill anything - this shouldn't happen.
             XELOGE("Unable to spill any registers");
             assert_always();
@@ -332,7 +339,53 @@ bool RegisterAllocationPass::TryAllocateRegister(Value* value) {
   return false;
 }
 
+bool RegisterAllocationPass::CanReloadFromContext(const Value* value,
+                                                  const Instr* at) {
+  if (!cvars::spill_by_context_reload) {
+    return false;
+  }
+  const Instr* def = value->def;
+  if (def->opcode != &OPCODE_LOAD_CONTEXT_info) {
+    return false;
+  }
+  size_t offset = def->src1.offset;
+  size_t size = GetTypeSize(value->type);
+  for (auto i = def->next; i != at; i = i->next) {
+    if (!i) {
+      return false;
+    }
+    if ((i->opcode->flags & OPCODE_FLAG_VOLATILE) ||
+        i->opcode == &OPCODE_STORE_MMIO_info) {
+      return false;
+    }
+    if (GET_OPCODE_SIG_TYPE_DEST(i->opcode->signature) != OPCODE_SIG_TYPE_X ||
+        i->IsFake()) {
+      continue;
+    }
+    switch (i->opcode->num) {
+      case OPCODE_STORE_CONTEXT: {
+        size_t store_offset = i->src1.offset;
+        if (store_offset < offset + size &&
+            offset < store_offset + GetTypeSize(i->src2.value->type)) {
+          return false;
+        }
+      } break;
+      case OPCODE_STORE_LOCAL:
+      case OPCODE_STORE:
+      case OPCODE_STORE_OFFSET:
+        // Guest memory and the stack don't overlap the context.
+        break;
+      default:
+        // Anything else with side effects may change the context behind the
+        // HIR's back.
+        return false;
+    }
+  }
+  return true;
+}
+
 bool RegisterAllocationPass::SpillOneRegister(HIRBuilder* builder, Block* block,
+                                              const Instr* instr,
                                               TypeName required_type) {
   // Get the set that we will be picking from.
   RegisterSetUsage* usage_set;
@@ -345,11 +398,27 @@ bool RegisterAllocationPass::SpillOneRegister(HIRBuilder* builder, Block* block,
   }
 
   DumpUsage("SpillOneRegister (pre)");
-  // Pick the one with the furthest next use.
+  // Pick the one with the furthest next use, preferring the values that can
+  // be loaded from the context again, as spilling them costs no store. The
+  // sources of the instruction requesting the spill are still needed by it.
   assert_true(!usage_set->upcoming_uses.empty());
-  auto furthest_usage =
-      std::max_element(usage_set->upcoming_uses.begin(),
-                       usage_set->upcoming_uses.end(), &RegisterUsage::Compare);
+  auto furthest_usage = usage_set->upcoming_uses.end();
+  for (auto it = usage_set->upcoming_uses.begin();
+       it != usage_set->upcoming_uses.end(); ++it) {
+    if (!it->use || (it->use->prev && it->use->prev->instr == instr) ||
+        (furthest_usage != usage_set->upcoming_uses.end() &&
+         !RegisterUsage::Compare(*furthest_usage, *it)) ||
+        !CanReloadFromContext(it->value, it->use->instr)) {
+      continue;
+    }
+    furthest_usage = it;
+  }
+  bool reload_from_context = furthest_usage != usage_set->upcoming_uses.end();
+  if (!reload_from_context) {
+    furthest_usage = std::max_element(usage_set->upcoming_uses.begin(),
+                                      usage_set->upcoming_uses.end(),
+                                      &RegisterUsage::Compare);
+  }
   assert_true(furthest_usage->value->def->block == block);
   assert_true(furthest_usage->use->instr->block == block);
   auto spill_value = furthest_usage->value;
@@ -365,7 +434,9 @@ bool RegisterAllocationPass::SpillOneRegister(HIRBuilder* builder, Block* block,
   auto new_head_use = next_use;
 
   // Allocate local.
-  if (spill_value->HasLocalSlot()) {
+  if (reload_from_context) {
+    // Nothing to store, the context still has the value.
+  } else if (spill_value->HasLocalSlot()) {
     // Value is already assigned a slot. Since we allocate in order and this is
     // all SSA we know the stored value will be exactly what we want. Yay,
     // we can prevent the redundant store!
@@ -417,7 +488,13 @@ bool RegisterAllocationPass::SpillOneRegister(HIRBuilder* builder, Block* block,
   // use is after the instruction requesting the spill we know we haven't
   // done allocation for that code yet and can let that be handled
   // automatically when we get to it.
-  auto new_value = builder->LoadLocal(spill_value->GetLocalSlot());
+  Value* new_value;
+  if (reload_from_context) {
+    new_value = builder->LoadContext(spill_value->def->src1.offset,
+                                     spill_value->type);
+  } else {
+    new_value = builder->LoadLocal(spill_value->GetLocalSlot());
+  }
   auto spill_load = builder->last_instr();
   spill_load->MoveBefore(next_use->instr);
   // Note: implicit first use added.
@@ -427,9 +504,11 @@ bool RegisterAllocationPass::SpillOneRegister(HIRBuilder* builder, Block* block,
   spill_value->def->block->AssertNoCycles();
 #endif  // ASSERT_NO_CYCLES
 
-  // Set the local slot of the new value to our existing one. This way we will
-  // reuse that same memory if needed.
-  new_value->SetLocalSlot(spill_value->GetLocalSlot());
+  if (!reload_from_context) {
+    // Set the local slot of the new value to our existing one. This way we
+    // will reuse that same memory if needed.
+    new_value->SetLocalSlot(spill_value->GetLocalSlot());
+  }
 
   // Rename all future uses of the SSA value to the new value as loaded
   // from the local.
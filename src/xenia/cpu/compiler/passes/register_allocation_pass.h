@@ -29,6 +29,7 @@ class RegisterAllocationPass : public CompilerPass {
   ~RegisterAllocationPass() override;
 
   bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "RegisterAllocation"; }
 
  private:
   // TODO(benvanik): rewrite all this set shit -- too much indirection, the
@@ -62,8 +63,12 @@ class RegisterAllocationPass : public CompilerPass {
   bool TryAllocateRegister(hir::Value* value,
                            const hir::RegAssignment& preferred_reg);
   bool TryAllocateRegister(hir::Value* value);
+  // Whether the value, loaded from the context, can be loaded again at the
+  // instruction instead of being spilled to the stack.
+  static bool CanReloadFromContext(const hir::Value* value,
+                                   const hir::Instr* at);
   bool SpillOneRegister(hir::HIRBuilder* builder, hir::Block* block,
-                        hir::TypeName required_type);
+                        const hir::Instr* instr, hir::TypeName required_type);
 
   RegisterSetUsage* RegisterSetForValue(const hir::Value* value);
 
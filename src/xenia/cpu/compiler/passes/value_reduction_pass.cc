@@ -13,19 +13,9 @@
 #include "xenia/base/profiling.h"
 #include "xenia/cpu/backend/backend.h"
 #include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/compiler/scratch_bit_vector.h"
 #include "xenia/cpu/processor.h"
 
-#if XE_COMPILER_MSVC
-#pragma warning(push)
-#pragma warning(disable : 4244)
-#pragma warning(disable : 4267)
-#include <llvm/ADT/BitVector.h>
-#pragma warning(pop)
-#else
-#include <llvm/ADT/BitVector.h>
-#include <cmath>
-#endif  // XE_COMPILER_MSVC
-
 namespace xe {
 namespace cpu {
 namespace compiler {
@@ -62,7 +52,7 @@ void ValueReductionPass::ComputeLastUse(Value* value) {
 bool ValueReductionPass::Run(HIRBuilder* builder) {
   // Walk each block and reuse variable ordinals as much as possible.
 
-  llvm::BitVector ordinals(builder->max_value_ordinal());
+  ScratchBitVector ordinals(scratch_arena(), builder->max_value_ordinal());
 
   auto block = builder->first_block();
   while (block) {
@@ -125,12 +115,10 @@ bool ValueReductionPass::Run(HIRBuilder* builder) {
         // source value ordinal.
         auto v = instr->dest;
         // Find a lower ordinal.
-        for (auto n = 0u; n < ordinals.size(); n++) {
-          if (!ordinals.test(n)) {
-            ordinals.set(n);
-            v->ordinal = n;
-            break;
-          }
+        int n = ordinals.find_first_unset();
+        if (n != -1) {
+          ordinals.set(n);
+          v->ordinal = n;
         }
       }
 
@@ -23,6 +23,7 @@ class ValueReductionPass : public CompilerPass {
   ~ValueReductionPass() override;
 
   bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "ValueReduction"; }
 
  private:
   void ComputeLastUse(hir::Value* value);
@@ -0,0 +1,152 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_SCRATCH_BIT_VECTOR_H_
+#define XENIA_CPU_COMPILER_SCRATCH_BIT_VECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include "xenia/base/arena.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/math.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+
+// Fixed-size bit vector with the storage in an arena, for the sets of values
+// and blocks of compiler passes, which would otherwise be heap-allocated for
+// every function. Freed when the arena is reset.
+class ScratchBitVector {
+ public:
+  ScratchBitVector(Arena* arena, size_t size)
+      : size_(size),
+        word_count_((size + 63) / 64),
+        words_(reinterpret_cast<uint64_t*>(arena->Alloc(
+            sizeof(uint64_t) * (word_count_ ? word_count_ : 1),
+            alignof(uint64_t)))) {
+    reset();
+  }
+  // The storage would be shared.
+  ScratchBitVector(const ScratchBitVector& other) = delete;
+  ScratchBitVector& operator=(const ScratchBitVector& other) = delete;
+
+  // Constructs the bit vector itself in the arena too.
+  static ScratchBitVector* Create(Arena* arena, size_t size) {
+    return new (arena->Alloc<ScratchBitVector>())
+        ScratchBitVector(arena, size);
+  }
+
+  size_t size() const { return size_; }
+
+  bool test(size_t index) const {
+    assert_true(index < size_);
+    return (words_[index >> 6] & (uint64_t(1) << (index & 63))) != 0;
+  }
+  void set(size_t index) {
+    assert_true(index < size_);
+    words_[index >> 6] |= uint64_t(1) << (index & 63);
+  }
+  void reset(size_t index) {
+    assert_true(index < size_);
+    words_[index >> 6] &= ~(uint64_t(1) << (index & 63));
+  }
+  void reset() { std::memset(words_, 0, sizeof(uint64_t) * word_count_); }
+  void set_all() {
+    if (!word_count_) {
+      return;
+    }
+    std::memset(words_, 0xFF, sizeof(uint64_t) * word_count_);
+    // Keep the bits past the end clear for the searches.
+    if (size_ & 63) {
+      words_[word_count_ - 1] = (uint64_t(1) << (size_ & 63)) - 1;
+    }
+  }
+
+  void set_range(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      set(i);
+    }
+  }
+  void reset_range(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      reset(i);
+    }
+  }
+  bool any_in_range(size_t begin, size_t end) const {
+    for (size_t i = begin; i < end; ++i) {
+      if (test(i)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void assign(const ScratchBitVector& other) {
+    assert_true(size_ == other.size_);
+    std::memcpy(words_, other.words_, sizeof(uint64_t) * word_count_);
+  }
+  bool equals(const ScratchBitVector& other) const {
+    assert_true(size_ == other.size_);
+    return !std::memcmp(words_, other.words_, sizeof(uint64_t) * word_count_);
+  }
+
+  ScratchBitVector& operator|=(const ScratchBitVector& other) {
+    assert_true(size_ == other.size_);
+    for (size_t i = 0; i < word_count_; ++i) {
+      words_[i] |= other.words_[i];
+    }
+    return *this;
+  }
+
+  // The index of the first set bit at or after the index, or -1 if none.
+  int find_first() const { return find_set_from(0); }
+  int find_next(int prev) const { return find_set_from(size_t(prev) + 1); }
+  // The index of the first unset bit, or -1 if all are set.
+  int find_first_unset() const {
+    for (size_t i = 0; i < word_count_; ++i) {
+      if (~words_[i]) {
+        size_t index = (i << 6) + xe::tzcnt(~words_[i]);
+        return index < size_ ? int(index) : -1;
+      }
+    }
+    return -1;
+  }
+
+ private:
+  int find_set_from(size_t index) const {
+    if (index >= size_) {
+      return -1;
+    }
+    size_t word_index = index >> 6;
+    uint64_t word = words_[word_index] & (~uint64_t(0) << (index & 63));
+    while (true) {
+      if (word) {
+        return int((word_index << 6) + xe::tzcnt(word));
+      }
+      if (++word_index >= word_count_) {
+        return -1;
+      }
+      word = words_[word_index];
+    }
+  }
+
+  size_t size_;
+  size_t word_count_;
+  uint64_t* words_;
+};
+
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_SCRATCH_BIT_VECTOR_H_
@@ -33,6 +33,27 @@ DEFINE_bool(trace_function_data, false,
 DEFINE_bool(validate_hir, false,
             "Perform validation checks on the HIR during compilation.", "CPU");
 
+DEFINE_bool(tiered_compilation, false,
+            "Compile guest functions with a fast pipeline with fewer "
+            "optimizations first, and recompile those called often with all "
+            "optimizations in the background.",
+            "CPU");
+DEFINE_uint32(tiered_compilation_threshold, 1000,
+              "Number of calls after which a function compiled with the fast "
+              "pipeline is recompiled with all optimizations.",
+              "CPU");
+DEFINE_bool(profile_guided_function_layout, false,
+            "Use the functions found to be hot in previous runs with tiered "
+            "compilation to compile them first, placing them next to each "
+            "other in the code cache, and with all optimizations right away.",
+            "CPU");
+
+DEFINE_bool(decode_jump_tables, true,
+            "Recognize switch jump tables at bctr sites, so function discovery "
+            "continues past them and the cases are dispatched with direct "
+            "branches instead of an indirect call.",
+            "CPU");
+
 // https://github.com/bitsh1ft3r/Xenon/blob/091e8cd4dc4a7c697b4979eb200be7c9dee3590b/Xenon/Core/XCPU/PPU/PowerPC.h#L370
 DEFINE_uint64(
     pvr, 0x710700,
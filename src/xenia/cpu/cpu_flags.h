@@ -24,6 +24,12 @@ DECLARE_bool(trace_function_data);
 
 DECLARE_bool(validate_hir);
 
+DECLARE_bool(tiered_compilation);
+DECLARE_uint32(tiered_compilation_threshold);
+DECLARE_bool(profile_guided_function_layout);
+
+DECLARE_bool(decode_jump_tables);
+
 DECLARE_uint64(pvr);
 
 // Breakpoints:
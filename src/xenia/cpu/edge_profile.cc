@@ -0,0 +1,198 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/edge_profile.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/utf8.h"
+
+DEFINE_path(edge_profile_path, "",
+            "File to load the function entry and call site counts of the "
+            "previous runs from, and to write them to with the counts of this "
+            "run added on exit. Empty to not count them.",
+            "CPU");
+DEFINE_uint32(edge_profile_max_counters, 1048576,
+              "Number of edges that can be counted in a run, the array of the "
+              "counters taking 8 bytes per edge.",
+              "CPU");
+
+namespace xe {
+namespace cpu {
+
+namespace {
+struct EdgeProfileFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t edge_count;
+};
+static_assert(sizeof(EdgeProfileFileHeader) == 12);
+
+struct EdgeProfileFileEdge {
+  uint32_t kind;
+  uint32_t site_address;
+  uint32_t target_address;
+  uint32_t reserved;
+  uint64_t count;
+};
+static_assert(sizeof(EdgeProfileFileEdge) == 24);
+}  // namespace
+
+std::unique_ptr<EdgeProfile> EdgeProfile::Create() {
+  if (cvars::edge_profile_path.empty() || !cvars::edge_profile_max_counters) {
+    return nullptr;
+  }
+  auto profile = std::unique_ptr<EdgeProfile>(
+      new EdgeProfile(cvars::edge_profile_max_counters));
+  if (std::filesystem::exists(cvars::edge_profile_path)) {
+    profile->Load(cvars::edge_profile_path);
+  }
+  return profile;
+}
+
+EdgeProfile::EdgeProfile(size_t counter_capacity)
+    : counters_(new uint64_t[counter_capacity]()),
+      counter_capacity_(counter_capacity) {}
+
+uint64_t* EdgeProfile::GetCounter(EdgeKind kind, uint32_t site_address,
+                                  uint32_t target_address) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& indices = counter_indices_[size_t(kind)];
+  uint64_t key = EdgeKey(site_address, target_address);
+  auto it = indices.find(key);
+  if (it != indices.end()) {
+    return &counters_[it->second];
+  }
+  if (counter_count_ >= counter_capacity_) {
+    if (counter_count_ == counter_capacity_) {
+      XELOGW(
+          "Edge profile counters exhausted, raise edge_profile_max_counters "
+          "to count more edges");
+      // Only warning once.
+      ++counter_count_;
+    }
+    return nullptr;
+  }
+  size_t index = counter_count_++;
+  indices.emplace(key, index);
+  return &counters_[index];
+}
+
+uint64_t EdgeProfile::GetProfiledCount(EdgeKind kind, uint32_t site_address,
+                                       uint32_t target_address) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto& counts = profiled_counts_[size_t(kind)];
+  auto it = counts.find(EdgeKey(site_address, target_address));
+  return it != counts.end() ? it->second : 0;
+}
+
+std::vector<EdgeProfile::Edge> EdgeProfile::GetEdges() const {
+  std::vector<Edge> edges;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t kind = 0; kind < size_t(EdgeKind::kCount); ++kind) {
+      std::unordered_map<uint64_t, uint64_t> counts = profiled_counts_[kind];
+      for (const auto& [key, index] : counter_indices_[kind]) {
+        counts[key] += counters_[index];
+      }
+      for (const auto& [key, count] : counts) {
+        if (count) {
+          edges.push_back({EdgeKind(kind), uint32_t(key >> 32), uint32_t(key),
+                           count});
+        }
+      }
+    }
+  }
+  std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+    if (a.kind != b.kind) {
+      return a.kind < b.kind;
+    }
+    if (a.site_address != b.site_address) {
+      return a.site_address < b.site_address;
+    }
+    return a.target_address < b.target_address;
+  });
+  return edges;
+}
+
+bool EdgeProfile::Load(const std::filesystem::path& path) {
+  FILE* file = xe::filesystem::OpenFile(path, "rb");
+  if (!file) {
+    XELOGE("Failed to open the edge profile {}", xe::path_to_utf8(path));
+    return false;
+  }
+  EdgeProfileFileHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      header.magic != kFileMagic || header.version != kFileVersion) {
+    XELOGW("Ignoring the edge profile {} of an unknown format",
+           xe::path_to_utf8(path));
+    fclose(file);
+    return false;
+  }
+  std::vector<EdgeProfileFileEdge> file_edges(header.edge_count);
+  bool read = fread(file_edges.data(), sizeof(EdgeProfileFileEdge),
+                    file_edges.size(), file) == file_edges.size();
+  fclose(file);
+  if (!read) {
+    XELOGW("Ignoring the truncated edge profile {}", xe::path_to_utf8(path));
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const EdgeProfileFileEdge& file_edge : file_edges) {
+    if (file_edge.kind >= uint32_t(EdgeKind::kCount)) {
+      continue;
+    }
+    profiled_counts_[file_edge.kind]
+                    [EdgeKey(file_edge.site_address, file_edge.target_address)] +=
+        file_edge.count;
+  }
+  XELOGI("Loaded {} edges from the edge profile {}", file_edges.size(),
+         xe::path_to_utf8(path));
+  return true;
+}
+
+bool EdgeProfile::Save(const std::filesystem::path& path) const {
+  std::vector<Edge> edges = GetEdges();
+  FILE* file = xe::filesystem::OpenFile(path, "wb");
+  if (!file) {
+    XELOGE("Failed to open {} for writing the edge profile",
+           xe::path_to_utf8(path));
+    return false;
+  }
+  EdgeProfileFileHeader header;
+  header.magic = kFileMagic;
+  header.version = kFileVersion;
+  header.edge_count = uint32_t(edges.size());
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (size_t i = 0; written && i < edges.size(); ++i) {
+    const Edge& edge = edges[i];
+    EdgeProfileFileEdge file_edge;
+    file_edge.kind = uint32_t(edge.kind);
+    file_edge.site_address = edge.site_address;
+    file_edge.target_address = edge.target_address;
+    file_edge.reserved = 0;
+    file_edge.count = edge.count;
+    written = fwrite(&file_edge, sizeof(file_edge), 1, file) == 1;
+  }
+  fclose(file);
+  if (!written) {
+    XELOGE("Failed to write the edge profile {}", xe::path_to_utf8(path));
+    return false;
+  }
+  XELOGI("Wrote {} edges to the edge profile {}", edges.size(),
+         xe::path_to_utf8(path));
+  return true;
+}
+
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,106 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_EDGE_PROFILE_H_
+#define XENIA_CPU_EDGE_PROFILE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace xe {
+namespace cpu {
+
+// Counts how many times guest functions are entered and each of their call
+// sites is executed, through plain increments of counters in one dense array
+// that the backend emits, as opposed to the function trace data, which
+// records much more per call at a much higher cost. The counts are kept
+// across runs in a file at edge_profile_path, loaded on launch and written
+// with the counts of the run added on exit, for profile-guided decisions.
+//
+// The file is little-endian: a header of the "XEEP" magic, the format version
+// and the edge count as uint32, then the edges sorted by kind, site and target
+// address, each as uint32 kind, site address, target address and a reserved
+// zero, and the uint64 count.
+class EdgeProfile {
+ public:
+  enum class EdgeKind : uint32_t {
+    // From nowhere in particular to the function, the site and target being
+    // its address.
+    kEntry,
+    // From the call instruction at the site to the function at the target.
+    kDirectCall,
+    // From the call instruction at the site, the target being 0 as it isn't
+    // known when emitting the counter.
+    kIndirectCall,
+
+    kCount,
+  };
+
+  struct Edge {
+    EdgeKind kind;
+    uint32_t site_address;
+    uint32_t target_address;
+    uint64_t count;
+  };
+
+  // "XEEP" in little-endian.
+  static constexpr uint32_t kFileMagic = 0x50454558;
+  static constexpr uint32_t kFileVersion = 1;
+
+  // Null unless edge_profile_path is set.
+  static std::unique_ptr<EdgeProfile> Create();
+
+  // The counter for the code to increment, the same for all code of the edge,
+  // or null if the array is full.
+  uint64_t* GetCounter(EdgeKind kind, uint32_t site_address,
+                       uint32_t target_address);
+
+  // Counts of the edge in the previous runs, loaded from the file.
+  uint64_t GetProfiledCount(EdgeKind kind, uint32_t site_address,
+                            uint32_t target_address) const;
+  uint64_t GetProfiledEntryCount(uint32_t function_address) const {
+    return GetProfiledCount(EdgeKind::kEntry, function_address,
+                            function_address);
+  }
+
+  // The counts of the previous runs and this one added, sorted like in the
+  // file.
+  std::vector<Edge> GetEdges() const;
+  bool Save(const std::filesystem::path& path) const;
+
+ private:
+  EdgeProfile(size_t counter_capacity);
+
+  static uint64_t EdgeKey(uint32_t site_address, uint32_t target_address) {
+    return (uint64_t(site_address) << 32) | target_address;
+  }
+
+  bool Load(const std::filesystem::path& path);
+
+  // Incremented without synchronization by the guest code, losing a few
+  // counts on races rather than slowing every call down.
+  std::unique_ptr<uint64_t[]> counters_;
+  size_t counter_capacity_;
+
+  mutable std::mutex mutex_;
+  size_t counter_count_ = 0;
+  std::unordered_map<uint64_t, size_t>
+      counter_indices_[size_t(EdgeKind::kCount)];
+  std::unordered_map<uint64_t, uint64_t>
+      profiled_counts_[size_t(EdgeKind::kCount)];
+};
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_EDGE_PROFILE_H_
@@ -9,29 +9,67 @@
 
 #include "xenia/cpu/entry_table.h"
 
+#include <algorithm>
+
 #include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
 
 namespace xe {
 namespace cpu {
 
-EntryTable::EntryTable() = default;
+EntryTable::EntryTable()
+    : pages_(std::make_unique<std::atomic<Page*>[]>(kPageCount)) {}
 
 EntryTable::~EntryTable() {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   for (auto it : map_.Values()) {
     Entry* entry = it;
     delete entry;
   }
+  for (uint32_t i = 0; i < kPageCount; ++i) {
+    delete pages_[i].load(std::memory_order_relaxed);
+  }
 }
 
-Entry* EntryTable::Get(uint32_t address) {
-  auto global_lock = global_critical_region_.Acquire();
-  uint32_t idx = map_.IndexForKey(address);
-  if (idx == map_.size() || *map_.KeyAt(idx) != address) {
+Entry* EntryTable::LookupPublished(uint32_t address) const {
+  const Page* page =
+      pages_[address >> kPageShift].load(std::memory_order_acquire);
+  if (!page) {
     return nullptr;
   }
-  Entry* entry = *map_.ValueAt(idx);
+  return (*page)[(address & ((uint32_t(1) << kPageShift) - 1)) >> 2].load(
+      std::memory_order_acquire);
+}
+
+void EntryTable::Publish(uint32_t address, Entry* entry) {
+  std::atomic<Page*>& page_ref = pages_[address >> kPageShift];
+  Page* page = page_ref.load(std::memory_order_relaxed);
+  if (!page) {
+    if (!entry) {
+      return;
+    }
+    page = new Page();
+    for (std::atomic<Entry*>& page_entry : *page) {
+      page_entry.store(nullptr, std::memory_order_relaxed);
+    }
+    page_ref.store(page, std::memory_order_release);
+  }
+  (*page)[(address & ((uint32_t(1) << kPageShift) - 1)) >> 2].store(
+      entry, std::memory_order_release);
+}
+
+Entry* EntryTable::Get(uint32_t address) {
+  Entry* entry;
+  if (!(address & 3)) {
+    entry = LookupPublished(address);
+  } else {
+    auto lock = critical_region_.Acquire();
+    uint32_t idx = map_.IndexForKey(address);
+    if (idx == map_.size() || *map_.KeyAt(idx) != address) {
+      return nullptr;
+    }
+    entry = *map_.ValueAt(idx);
+  }
   if (entry) {
     // TODO(benvanik): wait if needed?
     if (entry->status != Entry::STATUS_READY) {
@@ -42,58 +80,63 @@ Entry* EntryTable::Get(uint32_t address) {
 }
 
 Entry::Status EntryTable::GetOrCreate(uint32_t address, Entry** out_entry) {
-  // TODO(benvanik): replace with a map with wait-free for find.
-  // https://github.com/facebook/folly/blob/master/folly/AtomicHashMap.h
-
-  auto global_lock = global_critical_region_.Acquire();
+  // Existing entries are looked up without locking.
+  Entry* entry = !(address & 3) ? LookupPublished(address) : nullptr;
+  Entry::Status status;
+  if (!entry) {
+    auto lock = critical_region_.Acquire();
 
-  uint32_t idx = map_.IndexForKey(address);
+    uint32_t idx = map_.IndexForKey(address);
 
-  Entry* entry = idx != map_.size() && *map_.KeyAt(idx) == address
-                     ? *map_.ValueAt(idx)
-                     : nullptr;
-  Entry::Status status;
-  if (entry) {
-    // If we aren't ready yet spin and wait.
-    if (entry->status == Entry::STATUS_COMPILING) {
-      // chrispy: i think this is dead code, if we are compiling we're holding
-      // the global lock, arent we? so we wouldnt be executing here
-      // Still compiling, so spin.
-      do {
-        global_lock.unlock();
-        // TODO(benvanik): sleep for less time?
-        xe::threading::Sleep(std::chrono::microseconds(10));
-        global_lock.lock();
-      } while (entry->status == Entry::STATUS_COMPILING);
+    entry = idx != map_.size() && *map_.KeyAt(idx) == address
+                ? *map_.ValueAt(idx)
+                : nullptr;
+    if (!entry) {
+      // Create and return for initialization.
+      entry = new Entry();
+      entry->address = address;
+      entry->end_address = 0;
+      entry->status = Entry::STATUS_COMPILING;
+      entry->function = 0;
+      map_.InsertAt(address, entry, idx);
+      if (!(address & 3)) {
+        Publish(address, entry);
+      }
+      lock.unlock();
+      *out_entry = entry;
+      return Entry::STATUS_NEW;
     }
-    status = entry->status;
-  } else {
-    // Create and return for initialization.
-    entry = new Entry();
-    entry->address = address;
-    entry->end_address = 0;
-    entry->status = Entry::STATUS_COMPILING;
-    entry->function = 0;
-    map_.InsertAt(address, entry, idx);
-    // map_[address] = entry;
-    status = Entry::STATUS_NEW;
-  }
-  global_lock.unlock();
+  }
+
+  // If we aren't ready yet wait for the thread compiling the function.
+  status = entry->status.load(std::memory_order_acquire);
+  while (status == Entry::STATUS_COMPILING) {
+    entry->status.wait(Entry::STATUS_COMPILING, std::memory_order_acquire);
+    status = entry->status.load(std::memory_order_acquire);
+  }
   *out_entry = entry;
   return status;
 }
 
+void EntryTable::SetStatus(Entry* entry, Entry::Status status) {
+  entry->status.store(status, std::memory_order_release);
+  entry->status.notify_all();
+}
+
 void EntryTable::Delete(uint32_t address) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   // doesnt this leak memory by not deleting the entry?
   uint32_t idx = map_.IndexForKey(address);
   if (idx != map_.size() && *map_.KeyAt(idx) == address) {
     map_.EraseAt(idx);
+    if (!(address & 3)) {
+      Publish(address, nullptr);
+    }
   }
 }
 
 std::vector<Function*> EntryTable::FindWithAddress(uint32_t address) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   std::vector<Function*> fns;
   for (auto& it : map_.Values()) {
     Entry* entry = it;
@@ -105,5 +148,75 @@ std::vector<Function*> EntryTable::FindWithAddress(uint32_t address) {
   }
   return fns;
 }
+
+std::vector<Function*> EntryTable::FindInRange(uint32_t low_address,
+                                               uint32_t high_address) {
+  auto lock = critical_region_.Acquire();
+  std::vector<Function*> fns;
+  for (auto& it : map_.Values()) {
+    Entry* entry = it;
+    if (entry->address < high_address && entry->end_address >= low_address) {
+      if (entry->status == Entry::STATUS_READY) {
+        fns.push_back(entry->function);
+      }
+    }
+  }
+  return fns;
+}
+
+void EntryTable::AddInlinedCall(uint32_t callee_address,
+                                uint32_t caller_address) {
+  auto lock = critical_region_.Acquire();
+  std::vector<uint32_t>& callers = inlined_callers_[callee_address];
+  // Retranslating the caller records the same call again.
+  if (std::find(callers.cbegin(), callers.cend(), caller_address) ==
+      callers.cend()) {
+    callers.push_back(caller_address);
+  }
+}
+
+std::vector<uint32_t> EntryTable::TakeInlinedCallers(uint32_t callee_address) {
+  auto lock = critical_region_.Acquire();
+  std::vector<uint32_t> callers;
+  auto it = inlined_callers_.find(callee_address);
+  if (it != inlined_callers_.end()) {
+    callers = std::move(it->second);
+    inlined_callers_.erase(it);
+  }
+  return callers;
+}
+
+void EntryTable::AddConstantLoad(uint32_t data_address,
+                                 uint32_t function_address) {
+  auto lock = critical_region_.Acquire();
+  std::vector<uint32_t>& loaders =
+      constant_loaders_[data_address >> kConstantLoadPageShift];
+  if (std::find(loaders.cbegin(), loaders.cend(), function_address) ==
+      loaders.cend()) {
+    loaders.push_back(function_address);
+  }
+}
+
+std::vector<uint32_t> EntryTable::TakeConstantLoaders(uint32_t low_address,
+                                                      uint32_t high_address) {
+  std::vector<uint32_t> loaders;
+  if (low_address >= high_address) {
+    return loaders;
+  }
+  auto lock = critical_region_.Acquire();
+  if (constant_loaders_.empty()) {
+    return loaders;
+  }
+  uint32_t page_last = (high_address - 1) >> kConstantLoadPageShift;
+  for (uint32_t page = low_address >> kConstantLoadPageShift;
+       page <= page_last; ++page) {
+    auto it = constant_loaders_.find(page);
+    if (it != constant_loaders_.end()) {
+      loaders.insert(loaders.end(), it->second.cbegin(), it->second.cend());
+      constant_loaders_.erase(it);
+    }
+  }
+  return loaders;
+}
 }  // namespace cpu
 }  // namespace xe
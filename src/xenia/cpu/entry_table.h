@@ -10,6 +10,10 @@
 #ifndef XENIA_CPU_ENTRY_TABLE_H_
 #define XENIA_CPU_ENTRY_TABLE_H_
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -30,7 +34,10 @@ typedef struct Entry_t {
 
   uint32_t address;
   uint32_t end_address;
-  Status status;
+  // Written with release ordering once the function is set up, and notified,
+  // so threads needing a function being compiled on another thread wait only
+  // for that entry.
+  std::atomic<Status> status;
   Function* function;
 } Entry;
 
@@ -43,13 +50,53 @@ class EntryTable {
   Entry::Status GetOrCreate(uint32_t address, Entry** out_entry);
   void Delete(uint32_t address);
 
+  // Publishes the result of compiling an entry returned as STATUS_NEW by
+  // GetOrCreate, waking up the threads waiting for it.
+  static void SetStatus(Entry* entry, Entry::Status status);
+
   std::vector<Function*> FindWithAddress(uint32_t address);
+  // Ready functions with code in [low_address, high_address).
+  std::vector<Function*> FindInRange(uint32_t low_address,
+                                     uint32_t high_address);
+
+  // Records that the code of the function at callee_address was inlined into
+  // the one at caller_address, which must be invalidated along with it.
+  void AddInlinedCall(uint32_t callee_address, uint32_t caller_address);
+  // Returns and forgets the callers the function was inlined into.
+  std::vector<uint32_t> TakeInlinedCallers(uint32_t callee_address);
+
+  // Records that loads from the read-only memory at data_address have been
+  // replaced with constants in the function at function_address.
+  void AddConstantLoad(uint32_t data_address, uint32_t function_address);
+  // Returns and forgets the functions with constants loaded from
+  // [low_address, high_address).
+  std::vector<uint32_t> TakeConstantLoaders(uint32_t low_address,
+                                            uint32_t high_address);
 
  private:
-  xe::global_critical_region global_critical_region_;
-  // TODO(benvanik): replace with a better data structure.
+  // Lock-free lookup for readers: a two-level table indexed by the 4-byte
+  // aligned guest address, with pages allocated and entries published under
+  // the lock. Unaligned addresses only go through map_.
+  static constexpr uint32_t kPageShift = 16;
+  static constexpr uint32_t kPageCount = uint32_t(1) << (32 - kPageShift);
+  static constexpr uint32_t kPageEntryCount = uint32_t(1)
+                                              << (kPageShift - 2);
+  using Page = std::array<std::atomic<Entry*>, kPageEntryCount>;
+
+  Entry* LookupPublished(uint32_t address) const;
+  // Must be called with the lock held.
+  void Publish(uint32_t address, Entry* entry);
+
+  // Nothing is called out to with it held, so it's a leaf lock.
+  xe::subsystem_critical_region critical_region_;
+  // Ordered map of all entries, for the creation path and range queries.
   xe::split_map<uint32_t, Entry*> map_;
-  // std::unordered_map<uint32_t, Entry*> map_;
+  std::unique_ptr<std::atomic<Page*>[]> pages_;
+  // Callee address to the addresses of the functions it's inlined into.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> inlined_callers_;
+  // 4 KB page of the data to the addresses of the functions it's loaded into.
+  static constexpr uint32_t kConstantLoadPageShift = 12;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> constant_loaders_;
 };
 
 }  // namespace cpu
@@ -54,19 +54,22 @@ void ExportResolver::RegisterTable(
       [](Export* a, Export* b) { return std::strcmp(a->name, b->name) < 0; });
 }
 
-Export* ExportResolver::GetExportByOrdinal(const std::string_view module_name,
-                                           uint16_t ordinal) {
+const ExportResolver::Table* ExportResolver::GetTable(
+    const std::string_view module_name) const {
   for (const auto& table : tables_) {
     if (xe::utf8::starts_with_case(module_name, table.module_name())) {
-      if (ordinal >= table.exports_by_ordinal().size()) {
-        return nullptr;
-      }
-      return table.exports_by_ordinal().at(ordinal);
+      return &table;
     }
   }
   return nullptr;
 }
 
+Export* ExportResolver::GetExportByOrdinal(const std::string_view module_name,
+                                           uint16_t ordinal) {
+  const Table* table = GetTable(module_name);
+  return table ? table->GetExportByOrdinal(ordinal) : nullptr;
+}
+
 void ExportResolver::SetVariableMapping(const std::string_view module_name,
                                         uint16_t ordinal, uint32_t value) {
   auto export_entry = GetExportByOrdinal(module_name, ordinal);
@@ -69,6 +69,38 @@ struct ExportTag {
 typedef void (*xe_kernel_export_shim_fn)(void*, void*);
 
 typedef void (*ExportTrampoline)(ppc::PPCContext* ppc_context);
+
+// A native sequence that the JIT may emit in place of a call to the export, for
+// exports that only access the guest state reachable from r13 (the KPCR) and
+// their arguments. The trampoline remains the implementation used elsewhere.
+struct ExportInlineSequence {
+  enum class Type : uint8_t {
+    kNone = 0,
+    // KPCR byte at offsets[0] = r3.
+    kStorePcrByte,
+    // r3 = KPCR byte at offsets[0], then KPCR byte at offsets[0] = immediate.
+    kExchangePcrByteImmediate,
+    // r3 = KPCR byte at offsets[0], then KPCR byte at offsets[0] = old r3.
+    kExchangePcrByte,
+    // 32-bit word at r3 = 0, then, if (uint32_t)r4 < immediate, KPCR byte at
+    // offsets[0] = r4 (thus with an immediate of 0, only the word is released).
+    kReleaseSpinLock,
+    // r3 = KPCR dword at offsets[0] != 0 ? KPCR byte at offsets[1] :
+    // byte at offsets[3] of the object pointed to by KPCR dword at offsets[2].
+    kSelectPcrByteOrThreadByte,
+    // r3 = (uint32_t)r3 < KPCR dword at offsets[1] ? dword r3 of the array
+    // pointed to by KPCR dword at offsets[0] : 0.
+    kLoadPcrArrayDword,
+    // If (uint32_t)r3 < KPCR dword at offsets[1], dword r3 of the array
+    // pointed to by KPCR dword at offsets[0] = r4 and r3 = 1, otherwise r3 = 0.
+    kStorePcrArrayDword,
+  };
+
+  Type type = Type::kNone;
+  uint8_t immediate = 0;
+  uint16_t offsets[4] = {};
+};
+
 #pragma pack(push, 1)
 class Export {
  public:
@@ -104,6 +136,7 @@ class Export {
   ExportTag::type tags;
   uint16_t ordinal;
   // Type type;
+  ExportInlineSequence inline_sequence;
 
   constexpr bool is_implemented() const {
     return (tags & ExportTag::kImplemented) == ExportTag::kImplemented;
@@ -128,6 +161,12 @@ class ExportResolver {
     const std::vector<Export*>& exports_by_name() const {
       return exports_by_name_;
     }
+    // The exports are a dense table indexed by the ordinal.
+    Export* GetExportByOrdinal(uint16_t ordinal) const {
+      return ordinal < exports_by_ordinal_->size()
+                 ? (*exports_by_ordinal_)[ordinal]
+                 : nullptr;
+    }
 
    private:
     std::string module_name_;
@@ -145,6 +184,9 @@ class ExportResolver {
     return all_exports_by_name_;
   }
 
+  // For resolving multiple imports from the same library, the table is looked
+  // up by the name once.
+  const Table* GetTable(const std::string_view module_name) const;
   Export* GetExportByOrdinal(const std::string_view module_name,
                              uint16_t ordinal);
 
@@ -10,6 +10,7 @@
 #ifndef XENIA_CPU_FUNCTION_H_
 #define XENIA_CPU_FUNCTION_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -130,6 +131,25 @@ class GuestFunction : public Function {
   virtual uint8_t* machine_code() const = 0;
   virtual size_t machine_code_length() const = 0;
 
+  // Whether the function is compiled, or is being compiled for the first
+  // time, with the baseline pipeline of tiered compilation, so its machine
+  // code will be replaced once it's called frequently.
+  bool is_baseline_tier() const {
+    return baseline_tier_.load(std::memory_order_acquire);
+  }
+  void set_baseline_tier(bool value) {
+    baseline_tier_.store(value, std::memory_order_release);
+  }
+
+  // Whether the function is translated for debugging even without --debug,
+  // because a breakpoint has been placed in it.
+  bool is_debuggable() const {
+    return debuggable_.load(std::memory_order_acquire);
+  }
+  void set_debuggable(bool value) {
+    debuggable_.store(value, std::memory_order_release);
+  }
+
   FunctionDebugInfo* debug_info() const { return debug_info_.get(); }
   void set_debug_info(std::unique_ptr<FunctionDebugInfo> debug_info) {
     debug_info_ = std::move(debug_info);
@@ -160,6 +180,8 @@ class GuestFunction : public Function {
   std::vector<SourceMapEntry> source_map_;
   ExternHandler extern_handler_ = nullptr;
   Export* export_data_ = nullptr;
+  std::atomic<bool> baseline_tier_{false};
+  std::atomic<bool> debuggable_{false};
 };
 
 }  // namespace cpu
@@ -12,12 +12,11 @@
 
 #include "xenia/base/arena.h"
 
-namespace llvm {
-class BitVector;
-}  // namespace llvm
-
 namespace xe {
 namespace cpu {
+namespace compiler {
+class ScratchBitVector;
+}  // namespace compiler
 namespace hir {
 
 class Block;
@@ -53,7 +52,8 @@ class Block {
 
   Edge* incoming_edge_head;
   Edge* outgoing_edge_head;
-  llvm::BitVector* incoming_values;
+  // Only valid during DataFlowAnalysisPass.
+  compiler::ScratchBitVector* incoming_values;
 
   Label* label_head;
   Label* label_tail;
@@ -74,6 +74,7 @@ void HIRBuilder::Reset() {
   next_label_id_ = 0;
   next_value_ordinal_ = 0;
   locals_.clear();
+  constant_load_addresses_.clear();
   block_head_ = block_tail_ = NULL;
   current_block_ = NULL;
 #if SCRIBBLE_ARENA_ON_RESET
@@ -30,6 +30,9 @@ namespace hir {
 
 enum FunctionAttributes {
   FUNCTION_ATTRIB_INLINE = (1 << 1),
+  // Translated for debugging, keeping the guest state in the context exact at
+  // the instruction boundaries, for breakpoints and stepping.
+  FUNCTION_ATTRIB_DEBUGGABLE = (1 << 2),
 };
 
 class HIRBuilder {
@@ -59,6 +62,16 @@ class HIRBuilder {
 
   std::vector<Value*>& locals() { return locals_; }
 
+  // Guest addresses of the read-only memory the passes have replaced loads
+  // from with constants, for invalidating the code if the memory becomes
+  // writable.
+  const std::vector<uint32_t>& constant_load_addresses() const {
+    return constant_load_addresses_;
+  }
+  void RecordConstantLoad(uint32_t address) {
+    constant_load_addresses_.push_back(address);
+  }
+
   uint32_t max_value_ordinal() const { return next_value_ordinal_; }
 
   Block* first_block() const { return block_head_; }
@@ -324,6 +337,8 @@ class HIRBuilder {
 
   std::vector<Value*> locals_;
 
+  std::vector<uint32_t> constant_load_addresses_;
+
   Block* block_head_;
   Block* block_tail_;
   Block* current_block_;
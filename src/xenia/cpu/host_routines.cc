@@ -0,0 +1,130 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/host_routines.h"
+
+#include <cstring>
+
+#include "xenia/base/logging.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+#include "xenia/cpu/processor.h"
+#include "xenia/memory.h"
+
+namespace xe {
+namespace cpu {
+
+namespace {
+
+// Whether every page of the range is in a heap and has the protection. MMIO
+// ranges aren't in any heap, and the host can't emulate accesses to them.
+bool IsGuestRangeAccessible(Memory* memory, uint32_t address, uint32_t length,
+                            uint32_t protect) {
+  uint64_t end = uint64_t(address) + length;
+  if (end > uint64_t(UINT32_MAX) + 1) {
+    return false;
+  }
+  uint64_t page = address;
+  while (page < end) {
+    BaseHeap* heap = memory->LookupHeap(uint32_t(page));
+    uint32_t page_protect;
+    if (!heap || !heap->QueryProtect(uint32_t(page), &page_protect) ||
+        (page_protect & protect) != protect) {
+      return false;
+    }
+    page = (page & ~uint64_t(heap->page_size() - 1)) + heap->page_size();
+  }
+  return true;
+}
+
+void HostMemcpy(ppc::PPCContext* ppc_context, kernel::KernelState*) {
+  Memory* memory = ppc_context->processor->memory();
+  uint32_t dest = uint32_t(ppc_context->r[3]);
+  uint32_t src = uint32_t(ppc_context->r[4]);
+  uint32_t length = uint32_t(ppc_context->r[5]);
+  if (!length) {
+    return;
+  }
+  if (!IsGuestRangeAccessible(memory, src, length, kMemoryProtectRead) ||
+      !IsGuestRangeAccessible(memory, dest, length,
+                              kMemoryProtectRead | kMemoryProtectWrite)) {
+    XELOGE("Host memcpy from {:08X} to {:08X} ({} bytes) is out of bounds",
+           src, dest, length);
+    return;
+  }
+  memory->PrepareHostWrite(dest, length);
+  // The guest copies may overlap in practice.
+  std::memmove(memory->TranslateVirtual(dest), memory->TranslateVirtual(src),
+               length);
+  // r3 is left as the destination.
+}
+
+void HostMemset(ppc::PPCContext* ppc_context, kernel::KernelState*) {
+  Memory* memory = ppc_context->processor->memory();
+  uint32_t dest = uint32_t(ppc_context->r[3]);
+  uint8_t value = uint8_t(ppc_context->r[4]);
+  uint32_t length = uint32_t(ppc_context->r[5]);
+  if (!length) {
+    return;
+  }
+  if (!IsGuestRangeAccessible(memory, dest, length,
+                              kMemoryProtectRead | kMemoryProtectWrite)) {
+    XELOGE("Host memset of {:08X} ({} bytes) is out of bounds", dest, length);
+    return;
+  }
+  memory->PrepareHostWrite(dest, length);
+  std::memset(memory->TranslateVirtual(dest), value, length);
+}
+
+void HostStrlen(ppc::PPCContext* ppc_context, kernel::KernelState*) {
+  Memory* memory = ppc_context->processor->memory();
+  uint32_t str = uint32_t(ppc_context->r[3]);
+  uint32_t address = str;
+  while (true) {
+    BaseHeap* heap = memory->LookupHeap(address);
+    uint32_t page_protect;
+    if (!heap || !heap->QueryProtect(address, &page_protect) ||
+        !(page_protect & kMemoryProtectRead)) {
+      XELOGE("Host strlen of {:08X} is out of bounds", str);
+      break;
+    }
+    uint64_t page_end =
+        uint64_t(address & ~(heap->page_size() - 1)) + heap->page_size();
+    auto host_address = memory->TranslateVirtual<const uint8_t*>(address);
+    auto terminator = reinterpret_cast<const uint8_t*>(
+        std::memchr(host_address, 0, size_t(page_end - address)));
+    if (terminator) {
+      address += uint32_t(terminator - host_address);
+      break;
+    }
+    if (page_end > UINT32_MAX) {
+      XELOGE("Host strlen of {:08X} is out of bounds", str);
+      break;
+    }
+    address = uint32_t(page_end);
+  }
+  ppc_context->r[3] = address - str;
+}
+
+}  // namespace
+
+GuestFunction::ExternHandler LookupHostRoutine(std::string_view name) {
+  if (name == "memcpy" || name == "memmove" || name == "XMemCpy") {
+    return HostMemcpy;
+  }
+  if (name == "memset" || name == "XMemSet") {
+    return HostMemset;
+  }
+  if (name == "strlen") {
+    return HostStrlen;
+  }
+  return nullptr;
+}
+
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,30 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_HOST_ROUTINES_H_
+#define XENIA_CPU_HOST_ROUTINES_H_
+
+#include <string_view>
+
+#include "xenia/cpu/function.h"
+
+namespace xe {
+namespace cpu {
+
+// Host implementations of guest C runtime routines (memcpy, memset, strlen and
+// their XMem variants), which replace the translated PPC loops of the routines
+// in a module. The guest calling convention is kept: arguments in r3-r5, the
+// result in r3.
+// Returns nullptr if there is no host implementation with the name.
+GuestFunction::ExternHandler LookupHostRoutine(std::string_view name);
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_HOST_ROUTINES_H_
@@ -0,0 +1,179 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/memory_access_trace.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/utf8.h"
+
+DEFINE_uint32(memory_access_trace_address, 0,
+              "Guest virtual address of the range to record all the loads and "
+              "stores of, per instruction, for finding the guest code "
+              "repeatedly writing to memory watched for the GPU.",
+              "CPU");
+DEFINE_uint32(memory_access_trace_length, 0,
+              "Length of the range starting at memory_access_trace_address to "
+              "record the accesses to, 0 to disable.",
+              "CPU");
+DEFINE_string(memory_access_trace_functions, "",
+              "Comma-separated hexadecimal guest addresses of the only "
+              "functions to check the accesses of while tracing, such as the "
+              "ones found by a trace of all functions, to reduce the "
+              "overhead. Empty to check all functions.",
+              "CPU");
+DEFINE_path(memory_access_trace_output_path, "",
+            "File to write the traced memory accesses to on exit, as CSV.",
+            "CPU");
+
+namespace xe {
+namespace cpu {
+
+std::unique_ptr<MemoryAccessTrace> MemoryAccessTrace::Create() {
+  if (!cvars::memory_access_trace_length) {
+    return nullptr;
+  }
+  auto trace = std::unique_ptr<MemoryAccessTrace>(
+      new MemoryAccessTrace(cvars::memory_access_trace_address,
+                            cvars::memory_access_trace_length));
+  for (std::string_view function :
+       xe::utf8::split(cvars::memory_access_trace_functions, ", ", true)) {
+    if (xe::utf8::starts_with(function, "0x")) {
+      function.remove_prefix(2);
+    }
+    uint32_t function_address = 0;
+    auto [end, error] =
+        std::from_chars(function.data(), function.data() + function.size(),
+                        function_address, 16);
+    if (error != std::errc() || end != function.data() + function.size()) {
+      XELOGE("Invalid function address {} in memory_access_trace_functions",
+             function);
+      continue;
+    }
+    trace->functions_.insert(function_address);
+  }
+  XELOGI("Tracing the guest memory accesses to {:08X}-{:08X} in {}",
+         trace->address_, trace->address_ + trace->length_ - 1,
+         trace->functions_.empty()
+             ? std::string("all functions")
+             : fmt::format("{} functions", trace->functions_.size()));
+  return trace;
+}
+
+MemoryAccessTrace::MemoryAccessTrace(uint32_t address, uint32_t length)
+    : address_(address), length_(length) {}
+
+void MemoryAccessTrace::RecordAccess(uint32_t thread_id, uint32_t address,
+                                     uint32_t guest_address,
+                                     uint32_t function_address, uint32_t size,
+                                     bool is_store) {
+  std::lock_guard<std::mutex> lock(sites_mutex_);
+  ++access_count_;
+  auto [it, inserted] = sites_.try_emplace(guest_address);
+  SiteState& state = it->second;
+  AccessSite& site = state.site;
+  if (inserted) {
+    site.guest_address = guest_address;
+    site.function_address = function_address;
+    site.access_size = size;
+    state.last_thread_id = thread_id;
+    state.stride_candidate = 0;
+    state.stride_votes = 0;
+  } else {
+    int32_t stride = int32_t(address - state.last_address);
+    if (stride == state.stride_candidate) {
+      ++state.stride_votes;
+      ++site.stride_count;
+    } else if (!state.stride_votes) {
+      state.stride_candidate = stride;
+      state.stride_votes = 1;
+      site.stride_count = 1;
+    } else {
+      --state.stride_votes;
+    }
+    site.stride = state.stride_candidate;
+    if (state.last_thread_id != thread_id) {
+      state.last_thread_id = thread_id;
+      ++site.thread_switch_count;
+    }
+  }
+  state.last_address = address;
+  if (is_store) {
+    ++site.store_count;
+  } else {
+    ++site.load_count;
+  }
+  site.lowest_address = std::min(site.lowest_address, address);
+  site.highest_address = std::max(site.highest_address, address);
+}
+
+uint64_t MemoryAccessTrace::access_count() const {
+  std::lock_guard<std::mutex> lock(sites_mutex_);
+  return access_count_;
+}
+
+std::vector<MemoryAccessTrace::AccessSite> MemoryAccessTrace::GetAccessSites()
+    const {
+  std::vector<AccessSite> sites;
+  {
+    std::lock_guard<std::mutex> lock(sites_mutex_);
+    sites.reserve(sites_.size());
+    for (const auto& [guest_address, state] : sites_) {
+      sites.push_back(state.site);
+    }
+  }
+  std::sort(sites.begin(), sites.end(),
+            [](const AccessSite& a, const AccessSite& b) {
+              return a.load_count + a.store_count >
+                     b.load_count + b.store_count;
+            });
+  return sites;
+}
+
+void MemoryAccessTrace::Reset() {
+  std::lock_guard<std::mutex> lock(sites_mutex_);
+  access_count_ = 0;
+  sites_.clear();
+}
+
+bool MemoryAccessTrace::ExportCsv(const std::filesystem::path& path) const {
+  std::vector<AccessSite> sites = GetAccessSites();
+  FILE* file = xe::filesystem::OpenFile(path, "w");
+  if (!file) {
+    XELOGE("Failed to open {} for writing the traced memory accesses",
+           xe::path_to_utf8(path));
+    return false;
+  }
+  fprintf(file,
+          "guest_address,function_address,access_size,load_count,store_count,"
+          "lowest_address,highest_address,stride,stride_count,"
+          "thread_switch_count\n");
+  for (const AccessSite& site : sites) {
+    fprintf(file, "%08X,%08X,%u,%llu,%llu,%08X,%08X,%d,%llu,%llu\n",
+            site.guest_address, site.function_address, site.access_size,
+            static_cast<unsigned long long>(site.load_count),
+            static_cast<unsigned long long>(site.store_count),
+            site.lowest_address, site.highest_address, site.stride,
+            static_cast<unsigned long long>(site.stride_count),
+            static_cast<unsigned long long>(site.thread_switch_count));
+  }
+  fclose(file);
+  XELOGI("Wrote {} traced memory access sites to {}", sites.size(),
+         xe::path_to_utf8(path));
+  return true;
+}
+
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,99 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_MEMORY_ACCESS_TRACE_H_
+#define XENIA_CPU_MEMORY_ACCESS_TRACE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace xe {
+namespace cpu {
+
+// Records every guest load and store touching the guest virtual range chosen
+// with memory_access_trace_address and memory_access_trace_length, through
+// checks the backend emits before the memory accesses that may touch it.
+// Unlike the page protection watches, which only catch the first write to
+// each page, this shows which instructions keep writing to memory shared with
+// the GPU, how far apart their accesses are, and whether multiple guest
+// threads write the same data.
+class MemoryAccessTrace {
+ public:
+  struct AccessSite {
+    // Guest address of the accessing instruction.
+    uint32_t guest_address = 0;
+    uint32_t function_address = 0;
+    uint32_t access_size = 0;
+    uint64_t load_count = 0;
+    uint64_t store_count = 0;
+    uint32_t lowest_address = UINT32_MAX;
+    uint32_t highest_address = 0;
+    // Most common distance between the consecutive accesses of the
+    // instruction, and how many of them have been at it since it became the
+    // most common.
+    int32_t stride = 0;
+    uint64_t stride_count = 0;
+    // Consecutive accesses of the instruction from different guest threads.
+    uint64_t thread_switch_count = 0;
+  };
+
+  // Null if no range is traced.
+  static std::unique_ptr<MemoryAccessTrace> Create();
+
+  uint32_t address() const { return address_; }
+  uint32_t length() const { return length_; }
+  bool Overlaps(uint32_t address, uint32_t size) const {
+    return address - address_ < length_ || address_ - address < size;
+  }
+  // Whether the checks should be emitted in the function, all functions
+  // unless narrowed down with memory_access_trace_functions.
+  bool ShouldInstrumentFunction(uint32_t function_address) const {
+    return functions_.empty() || functions_.count(function_address) != 0;
+  }
+
+  void RecordAccess(uint32_t thread_id, uint32_t address,
+                    uint32_t guest_address, uint32_t function_address,
+                    uint32_t size, bool is_store);
+
+  uint64_t access_count() const;
+  // Sorted by the access count, highest first.
+  std::vector<AccessSite> GetAccessSites() const;
+  void Reset();
+  bool ExportCsv(const std::filesystem::path& path) const;
+
+ private:
+  struct SiteState {
+    AccessSite site;
+    uint32_t last_address;
+    uint32_t last_thread_id;
+    // Boyer-Moore majority vote over the distances between accesses.
+    int32_t stride_candidate;
+    uint64_t stride_votes;
+  };
+
+  MemoryAccessTrace(uint32_t address, uint32_t length);
+
+  uint32_t address_;
+  uint32_t length_;
+  std::unordered_set<uint32_t> functions_;
+
+  mutable std::mutex sites_mutex_;
+  uint64_t access_count_ = 0;
+  std::unordered_map<uint32_t, SiteState> sites_;
+};
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_MEMORY_ACCESS_TRACE_H_
@@ -38,6 +38,22 @@ int InstrEmit_branch(PPCHIRBuilder& f, const char* src, uint64_t cia,
                      bool expect_true = true, bool nia_is_lr = false) {
   uint32_t call_flags = 0;
 
+  // Small leaf functions and kernel exports with a native sequence are
+  // emitted in place of the call.
+  if (lk && !cond && nia->IsConstant() &&
+      (f.TryEmitInlinedExportCall(uint32_t(nia->AsUint64()),
+                                  uint32_t(cia + 4)) ||
+       f.TryEmitInlinedCall(uint32_t(nia->AsUint64()), uint32_t(cia + 4)))) {
+    return 0;
+  }
+
+  // Prolog and epilog register save and restore helpers are expanded in place.
+  if (!cond && nia->IsConstant() &&
+      f.TryEmitSaveRestoreCall(uint32_t(nia->AsUint64()), uint32_t(cia + 4),
+                               lk)) {
+    return 0;
+  }
+
   // TODO(benvanik): this may be wrong and overwrite LRs when not desired!
   // The docs say always, though...
   // Note that we do the update before we branch/call as we need it to
@@ -274,6 +290,12 @@ int InstrEmit_bcctrx(PPCHIRBuilder& f, const InstrData& i) {
     }
   }
 
+  // Cases of a switch jump table are reached with direct branches, with the
+  // indirect branch remaining for anything else.
+  if (!cond_ok && !i.XL.LK) {
+    f.TryEmitJumpTableDispatch(i.address);
+  }
+
   bool expect_true = !not_cond_ok;
   return InstrEmit_branch(f, "bcctrx", i.address, f.LoadCTR(), i.XL.LK, cond_ok,
                           expect_true);
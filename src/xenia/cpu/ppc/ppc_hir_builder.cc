@@ -10,7 +10,9 @@
 #include "xenia/cpu/ppc/ppc_hir_builder.h"
 
 #include <stddef.h>
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 #include "third_party/fmt/include/fmt/format.h"
 
@@ -21,11 +23,13 @@
 #include "xenia/base/profiling.h"
 #include "xenia/base/string.h"
 #include "xenia/cpu/cpu_flags.h"
+#include "xenia/cpu/export_resolver.h"
 #include "xenia/cpu/hir/label.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/cpu/ppc/ppc_decode_data.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/ppc/ppc_opcode_info.h"
+#include "xenia/cpu/ppc/ppc_scanner.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/cpu/xex_module.h"
 DEFINE_bool(
@@ -33,6 +37,26 @@ DEFINE_bool(
     "Break to the host debugger (or crash if no debugger attached) if an "
     "unimplemented PowerPC instruction is encountered.",
     "CPU");
+DEFINE_bool(inline_leaf_functions, true,
+            "Translate calls to small leaf functions by emitting their code in "
+            "the caller instead of calling them.",
+            "CPU");
+DEFINE_uint32(inline_leaf_function_max_instructions, 8,
+              "The largest leaf function to inline, in instructions not "
+              "counting the return.",
+              "CPU");
+DEFINE_bool(inline_save_restore_helpers, true,
+            "Translate calls to the __savegprlr/__restgprlr, __savefpr/"
+            "__restfpr and __savevmx/__restvmx prolog and epilog helpers to "
+            "loads and stores at the call site.",
+            "CPU");
+DEFINE_bool(inline_kernel_exports, true,
+            "Translate calls to the kernel exports that only access the "
+            "processor control region, such as the IRQL functions, to native "
+            "code at the call site instead of calling the host implementation.",
+            "CPU");
+
+DECLARE_bool(writable_code_segments);
 
 namespace xe {
 namespace cpu {
@@ -78,6 +102,7 @@ void PPCHIRBuilder::Reset() {
   instr_count_ = 0;
   instr_offset_list_ = NULL;
   label_list_ = NULL;
+  jump_table_data_end_ = 0;
   with_debug_info_ = false;
   HIRBuilder::Reset();
 }
@@ -102,6 +127,17 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
                   function_->name().c_str());
   }
 
+  if (function_->behavior() == Function::Behavior::kExtern) {
+    // The guest code is only a thunk (sc 2, blr) or a routine replaced by a
+    // host implementation, either way all there is to do is the call.
+    SourceOffset(start_address_);
+    if (!EmitExportInlineSequence(function_->export_data())) {
+      CallExtern(function_);
+    }
+    Return();
+    return Finalize();
+  }
+
   // Allocate offset list.
   // This is used to quickly map labels to instructions.
   // The list is built as the instructions are traversed, with the values
@@ -116,6 +152,7 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
 
   // Always mark entry with label.
   label_list_[0] = NewLabel();
+  jump_table_data_end_ = 0;
 
   uint32_t start_address = function_->address();
   uint32_t end_address = function_->end_address();
@@ -157,6 +194,11 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
     // Stash instruction offset. It's either the SOURCE_OFFSET or the COMMENT.
     instr_offset_list_[offset] = first_instr;
 
+    if (address < jump_table_data_end_) {
+      // Table data after a bctr, never executed.
+      continue;
+    }
+
     if (opcode == PPCOpcode::kInvalid) {
       XELOGE("Invalid instruction {:08X} {:08X}", address, code);
       Comment("INVALID!");
@@ -255,6 +297,405 @@ void PPCHIRBuilder::AnnotateLabel(uint32_t address, Label* label) {
   memcpy(label->name, name_buffer, sizeof(name_buffer));
 }
 
+bool PPCHIRBuilder::IsInlinableInstruction(uint32_t code) {
+  auto opcode = LookupOpcode(code);
+  if (opcode == PPCOpcode::kInvalid) {
+    return false;
+  }
+  auto& opcode_info = GetOpcodeInfo(opcode);
+  // Branches, traps and syscalls need the code to be a function of its own,
+  // and so does anything synchronizing the context.
+  if (!opcode_info.emit || opcode_info.group == PPCOpcodeGroup::kB ||
+      opcode_info.type == PPCOpcodeType::kSync) {
+    return false;
+  }
+  // mtlr/mtctr would change where the blr goes.
+  if (opcode == PPCOpcode::mtspr) {
+    return false;
+  }
+  // stwu/stdu r1 allocate a stack frame.
+  uint32_t primary_opcode = code >> 26;
+  uint32_t ra = (code >> 16) & 0x1F;
+  if (ra == 1 &&
+      (primary_opcode == 37 || (primary_opcode == 62 && (code & 3) == 1))) {
+    return false;
+  }
+  return true;
+}
+
+bool PPCHIRBuilder::TryEmitInlinedCall(uint32_t target_address,
+                                       uint32_t return_address) {
+  // Breakpoints and self-modifying code need every function to be translated
+  // on its own.
+  if (!cvars::inline_leaf_functions ||
+      (attributes() & hir::FUNCTION_ATTRIB_DEBUGGABLE) ||
+      cvars::writable_code_segments) {
+    return false;
+  }
+  // Branches within the function are jumps, not calls.
+  if (target_address >= function_->address() &&
+      target_address <= function_->end_address()) {
+    return false;
+  }
+  Module* module = function_->module();
+  if (!module || !module->ContainsAddress(target_address)) {
+    return false;
+  }
+  Function* target = LookupFunction(target_address);
+  if (!target || target->behavior() != Function::Behavior::kDefault) {
+    return false;
+  }
+  // Breakpoints in the callee are placed in its own code.
+  if (target->is_guest() &&
+      static_cast<GuestFunction*>(target)->is_debuggable()) {
+    return false;
+  }
+
+  Memory* memory = frontend_->memory();
+  uint32_t return_instr_address = 0;
+  for (uint32_t address = target_address, count = 0;
+       count <= cvars::inline_leaf_function_max_instructions;
+       address += 4, ++count) {
+    uint32_t code =
+        xe::load_and_swap<uint32_t>(memory->TranslateVirtual(address));
+    if (code == 0x4E800020) {
+      // blr
+      return_instr_address = address;
+      break;
+    }
+    if (!IsInlinableInstruction(code)) {
+      return false;
+    }
+  }
+  if (!return_instr_address) {
+    return false;
+  }
+  // If the scanner has already been through the function, it must agree it
+  // ends at the blr.
+  auto guest_target = static_cast<GuestFunction*>(target);
+  if (guest_target->has_end_address() &&
+      guest_target->end_address() != return_instr_address) {
+    return false;
+  }
+
+  // The callee and the code after the call may read LR.
+  StoreLR(LoadConstantUint64(return_address));
+  if (with_debug_info_) {
+    CommentFormat("inlined fn {:08X}-{:08X}", target_address,
+                  return_instr_address);
+  }
+  for (uint32_t address = target_address; address < return_instr_address;
+       address += 4) {
+    trace_info_.dest_count = 0;
+    uint32_t code =
+        xe::load_and_swap<uint32_t>(memory->TranslateVirtual(address));
+    auto opcode = LookupOpcode(code);
+    auto& opcode_info = GetOpcodeInfo(opcode);
+    if (with_debug_info_) {
+      comment_buffer_.Reset();
+      comment_buffer_.AppendFormat("{:08X} {:08X} ", address, code);
+      DisasmPPC(address, code, &comment_buffer_);
+      Comment(comment_buffer_);
+    }
+    SourceOffset(address);
+    ++opcode_translation_counts[static_cast<int>(opcode)];
+    MaybeBreakOnInstruction(address);
+
+    InstrData i;
+    i.address = address;
+    i.code = code;
+    i.opcode = opcode;
+    i.opcode_info = &opcode_info;
+    if (opcode_info.emit(*this, i)) {
+      auto& disasm_info = GetOpcodeDisasmInfo(opcode);
+      XELOGE("Unimplemented instr {:08X} {:08X} {} in an inlined function",
+             address, code, disasm_info.name);
+      Comment("UNIMPLEMENTED!");
+      if (cvars::break_on_unimplemented_instructions) {
+        DebugBreak();
+      }
+    }
+  }
+
+  // The caller has to be retranslated if the callee's code goes away.
+  frontend_->processor()->RecordInlinedFunction(target_address,
+                                                function_->address());
+  return true;
+}
+
+bool PPCHIRBuilder::TryEmitSaveRestoreCall(uint32_t target_address,
+                                           uint32_t return_address, bool lk) {
+  if (!cvars::inline_save_restore_helpers) {
+    return false;
+  }
+  Function* target = LookupFunction(target_address);
+  if (!target || !target->IsSaverest()) {
+    return false;
+  }
+  // __restgprlr_* returns to the restored LR and is reached with b, the rest
+  // return to the caller and are reached with bl.
+  bool is_gpr = target->SaverestType() == SaveRestoreType::GPR;
+  bool returns_to_caller = !(is_gpr && target->IsRestore());
+  if (lk != returns_to_caller) {
+    return false;
+  }
+  uint32_t first = target->SaverestIndex();
+  if (with_debug_info_) {
+    CommentFormat("inlined {} {:08X}", target->name(), target_address);
+  }
+
+  switch (target->SaverestType()) {
+    case SaveRestoreType::GPR: {
+      // r14 at r1 - 0x98, LR (in r12) at r1 - 8.
+      if (first < 14 || first > 31) {
+        return false;
+      }
+      Value* sp = LoadGPR(1);
+      for (uint32_t n = first; n <= 31; ++n) {
+        Value* offset = LoadConstantInt64(-0x98 + int64_t(n - 14) * 8);
+        if (target->IsRestore()) {
+          StoreGPR(n, ByteSwap(LoadOffset(sp, offset, INT64_TYPE)));
+        } else {
+          StoreOffset(sp, offset, ByteSwap(LoadGPR(n)));
+        }
+      }
+      Value* lr_offset = LoadConstantInt64(-8);
+      if (target->IsRestore()) {
+        Value* lr = ZeroExtend(
+            ByteSwap(LoadOffset(sp, lr_offset, INT32_TYPE)), INT64_TYPE);
+        StoreGPR(12, lr);
+        StoreLR(lr);
+        // blr.
+        CallIndirect(LoadLR(), CALL_TAIL | CALL_POSSIBLE_RETURN);
+        return true;
+      }
+      StoreOffset(sp, lr_offset,
+                  ByteSwap(Truncate(LoadGPR(12), INT32_TYPE)));
+    } break;
+    case SaveRestoreType::FPR: {
+      // f14 at r12 - 0x90.
+      if (first < 14 || first > 31) {
+        return false;
+      }
+      Value* base = LoadGPR(12);
+      for (uint32_t n = first; n <= 31; ++n) {
+        int64_t offset = -0x90 + int64_t(n - 14) * 8;
+        Value* ea = Add(base, LoadConstantUint64(uint64_t(offset)));
+        if (target->IsRestore()) {
+          StoreFPR(n, Cast(ByteSwap(Load(ea, INT64_TYPE)), FLOAT64_TYPE));
+        } else {
+          Store(ea, ByteSwap(Cast(LoadFPR(n), INT64_TYPE)));
+        }
+      }
+    } break;
+    case SaveRestoreType::VMX: {
+      // v14...v31 and v64...v127 each end right below r12, with the offset
+      // (left in r11) stepping through li r11, offset.
+      uint32_t last;
+      if (first >= 14 && first <= 31) {
+        last = 31;
+      } else if (first >= 64 && first <= 127) {
+        last = 127;
+      } else {
+        return false;
+      }
+      Value* base = LoadGPR(12);
+      for (uint32_t n = first; n <= last; ++n) {
+        int64_t offset = -int64_t(last + 1 - n) * 16;
+        Value* ea = And(Add(base, LoadConstantUint64(uint64_t(offset))),
+                        LoadConstantUint64(~0xFull));
+        if (target->IsRestore()) {
+          StoreVR(n, ByteSwap(Load(ea, VEC128_TYPE)));
+        } else {
+          Store(ea, ByteSwap(LoadVR(n)));
+        }
+      }
+      StoreGPR(11, LoadConstantInt64(-16));
+    } break;
+    default:
+      return false;
+  }
+
+  // The code after the call may read LR.
+  StoreLR(LoadConstantUint64(return_address));
+  return true;
+}
+
+bool PPCHIRBuilder::TryEmitJumpTableDispatch(uint32_t bctr_address) {
+  if (!cvars::decode_jump_tables) {
+    return false;
+  }
+  JumpTableInfo jump_table;
+  if (!PPCScanner::DecodeJumpTable(frontend_->memory(), function_->address(),
+                                   bctr_address, &jump_table)) {
+    return false;
+  }
+  if (jump_table.is_inline()) {
+    jump_table_data_end_ = jump_table.table_end_address();
+  }
+
+  // Only the cases inside this function can be reached with a branch, the rest
+  // go through the indirect branch emitted after the search.
+  std::vector<uint32_t> targets;
+  targets.reserve(jump_table.targets.size());
+  for (uint32_t target : jump_table.targets) {
+    if (target >= bctr_address && target < jump_table_data_end_) {
+      continue;
+    }
+    if (target >= start_address_ &&
+        (target - start_address_) / 4 < instr_count_) {
+      targets.push_back(target);
+    }
+  }
+  std::sort(targets.begin(), targets.end());
+  targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+  if (targets.empty()) {
+    return false;
+  }
+
+  if (with_debug_info_) {
+    CommentFormat("jump table {:08X}, {} cases", jump_table.table_address,
+                  targets.size());
+  }
+  // Comparing CTR rather than the index register - the index is often
+  // overwritten by the table load, and this stays correct even if the bounds
+  // check has been misdetected.
+  EmitJumpTableSearch(Truncate(LoadCTR(), INT32_TYPE), targets.data(),
+                      targets.size());
+  return true;
+}
+
+void PPCHIRBuilder::EmitJumpTableSearch(Value* target, const uint32_t* targets,
+                                        size_t target_count) {
+  // Binary search over the sorted targets, falling through if not found.
+  if (target_count <= 4) {
+    for (size_t i = 0; i < target_count; ++i) {
+      BranchTrue(CompareEQ(target, LoadConstantUint32(targets[i])),
+                 LookupLabel(targets[i]));
+    }
+    return;
+  }
+  size_t half = target_count / 2;
+  Label* upper_half = NewLabel();
+  Label* not_found = NewLabel();
+  BranchTrue(CompareUGE(target, LoadConstantUint32(targets[half])),
+             upper_half);
+  EmitJumpTableSearch(target, targets, half);
+  Branch(not_found);
+  MarkLabel(upper_half);
+  EmitJumpTableSearch(target, targets + half, target_count - half);
+  MarkLabel(not_found);
+}
+
+bool PPCHIRBuilder::TryEmitInlinedExportCall(uint32_t target_address,
+                                             uint32_t return_address) {
+  if (!cvars::inline_kernel_exports ||
+      (attributes() & hir::FUNCTION_ATTRIB_DEBUGGABLE)) {
+    return false;
+  }
+  Function* target = LookupFunction(target_address);
+  if (!target || target->behavior() != Function::Behavior::kExtern) {
+    return false;
+  }
+  const Export* export_data =
+      static_cast<GuestFunction*>(target)->export_data();
+  if (!export_data || export_data->inline_sequence.type ==
+                          ExportInlineSequence::Type::kNone) {
+    return false;
+  }
+  // The code after the call may read LR.
+  StoreLR(LoadConstantUint64(return_address));
+  if (with_debug_info_) {
+    CommentFormat("inlined export {}", export_data->name);
+  }
+  return EmitExportInlineSequence(export_data);
+}
+
+bool PPCHIRBuilder::EmitExportInlineSequence(const Export* export_data) {
+  if (!cvars::inline_kernel_exports || !export_data) {
+    return false;
+  }
+  const ExportInlineSequence& sequence = export_data->inline_sequence;
+  auto pcr_address = [this, &sequence](size_t offset_index) {
+    return Add(LoadGPR(13),
+               LoadConstantUint64(sequence.offsets[offset_index]));
+  };
+  switch (sequence.type) {
+    case ExportInlineSequence::Type::kStorePcrByte:
+      Store(pcr_address(0), Truncate(LoadGPR(3), INT8_TYPE));
+      return true;
+    case ExportInlineSequence::Type::kExchangePcrByteImmediate: {
+      Value* address = pcr_address(0);
+      Value* old_value = Load(address, INT8_TYPE);
+      Store(address, LoadConstantUint8(sequence.immediate));
+      StoreGPR(3, ZeroExtend(old_value, INT64_TYPE));
+      return true;
+    }
+    case ExportInlineSequence::Type::kExchangePcrByte: {
+      Value* address = pcr_address(0);
+      Value* old_value = Load(address, INT8_TYPE);
+      Store(address, Truncate(LoadGPR(3), INT8_TYPE));
+      StoreGPR(3, ZeroExtend(old_value, INT64_TYPE));
+      return true;
+    }
+    case ExportInlineSequence::Type::kReleaseSpinLock: {
+      Store(LoadGPR(3), LoadZeroInt32());
+      if (sequence.immediate) {
+        auto end = NewLabel();
+        Value* new_value = Truncate(LoadGPR(4), INT32_TYPE);
+        BranchFalse(CompareULT(new_value,
+                               LoadConstantUint32(sequence.immediate)),
+                    end);
+        Store(pcr_address(0), Truncate(new_value, INT8_TYPE));
+        MarkLabel(end);
+      }
+      return true;
+    }
+    case ExportInlineSequence::Type::kSelectPcrByteOrThreadByte: {
+      auto in_dpc = NewLabel();
+      auto end = NewLabel();
+      BranchTrue(Load(pcr_address(0), INT32_TYPE), in_dpc);
+      Value* thread =
+          ZeroExtend(ByteSwap(Load(pcr_address(2), INT32_TYPE)), INT64_TYPE);
+      Value* thread_value = Load(
+          Add(thread, LoadConstantUint64(sequence.offsets[3])), INT8_TYPE);
+      StoreGPR(3, ZeroExtend(thread_value, INT64_TYPE));
+      Branch(end);
+      MarkLabel(in_dpc);
+      StoreGPR(3, ZeroExtend(Load(pcr_address(1), INT8_TYPE), INT64_TYPE));
+      MarkLabel(end);
+      return true;
+    }
+    case ExportInlineSequence::Type::kLoadPcrArrayDword:
+    case ExportInlineSequence::Type::kStorePcrArrayDword: {
+      auto out_of_range = NewLabel();
+      auto end = NewLabel();
+      BranchFalse(
+          CompareULT(Truncate(LoadGPR(3), INT32_TYPE),
+                     ByteSwap(Load(pcr_address(1), INT32_TYPE))),
+          out_of_range);
+      // Values don't live across blocks, so the index is loaded again.
+      Value* element_address = Add(
+          ZeroExtend(ByteSwap(Load(pcr_address(0), INT32_TYPE)), INT64_TYPE),
+          Shl(ZeroExtend(Truncate(LoadGPR(3), INT32_TYPE), INT64_TYPE), 2));
+      if (sequence.type == ExportInlineSequence::Type::kLoadPcrArrayDword) {
+        StoreGPR(3, ZeroExtend(ByteSwap(Load(element_address, INT32_TYPE)),
+                               INT64_TYPE));
+      } else {
+        Store(element_address, ByteSwap(Truncate(LoadGPR(4), INT32_TYPE)));
+        StoreGPR(3, LoadConstantUint64(1));
+      }
+      Branch(end);
+      MarkLabel(out_of_range);
+      StoreGPR(3, LoadZeroInt64());
+      MarkLabel(end);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
 Function* PPCHIRBuilder::LookupFunction(uint32_t address) {
   return frontend_->processor()->LookupFunction(address);
 }
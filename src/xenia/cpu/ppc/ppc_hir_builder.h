@@ -43,6 +43,24 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   GuestFunction* function() const { return function_; }
   Function* LookupFunction(uint32_t address);
   Label* LookupLabel(uint32_t address);
+  // Emits the body of a small leaf function (straight-line code ending in
+  // blr, no stack frame) in place of a bl to it. Emits nothing and returns
+  // false if the target isn't eligible.
+  bool TryEmitInlinedCall(uint32_t target_address, uint32_t return_address);
+  // Emits the inline sequence of a kernel export in place of a bl to its import
+  // thunk. Emits nothing and returns false if the export doesn't have one.
+  bool TryEmitInlinedExportCall(uint32_t target_address,
+                                uint32_t return_address);
+  // Emits the stores or loads of a __savegprlr_*, __restgprlr_*, __savefpr_*,
+  // __restfpr_*, __savevmx_* or __restvmx_* helper in place of the branch to
+  // it, along with the return for __restgprlr_*. Emits nothing and returns
+  // false if the target isn't one of them.
+  bool TryEmitSaveRestoreCall(uint32_t target_address, uint32_t return_address,
+                              bool lk);
+  // Emits direct branches to the cases of the switch jump table dispatched by
+  // the bctr at bctr_address, falling through if CTR doesn't hold any of them.
+  // Emits nothing and returns false if no jump table is recognized.
+  bool TryEmitJumpTableDispatch(uint32_t bctr_address);
 
   Value* LoadLR();
   void StoreLR(Value* value);
@@ -86,6 +104,10 @@ class PPCHIRBuilder : public hir::HIRBuilder {
 
  private:
   void MaybeBreakOnInstruction(uint32_t address);
+  static bool IsInlinableInstruction(uint32_t code);
+  bool EmitExportInlineSequence(const Export* export_data);
+  void EmitJumpTableSearch(Value* target, const uint32_t* targets,
+                           size_t target_count);
   void AnnotateLabel(uint32_t address, Label* label);
 
   PPCFrontend* frontend_;
@@ -100,6 +122,8 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   uint64_t instr_count_;
   Instr** instr_offset_list_;
   Label** label_list_;
+  // End of the jump table data following the last bctr, not emitted as code.
+  uint32_t jump_table_data_end_;
 
   // Reset each instruction.
   struct {
@@ -15,6 +15,7 @@
 #include "xenia/base/logging.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
+#include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/ppc/ppc_decode_data.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/ppc/ppc_opcode_info.h"
@@ -32,6 +33,13 @@ namespace xe {
 namespace cpu {
 namespace ppc {
 
+namespace {
+// How far before the bctr the jump table setup is looked for.
+constexpr uint32_t kJumpTableSearchInstructionCount = 32;
+// Larger bounds are more likely a misdetection than a real switch.
+constexpr uint32_t kJumpTableMaxTargetCount = 1024;
+}  // namespace
+
 PPCScanner::PPCScanner(PPCFrontend* frontend) : frontend_(frontend) {}
 
 PPCScanner::~PPCScanner() {}
@@ -122,9 +130,23 @@ bool PPCScanner::Scan(GuestFunction* function, FunctionDebugInfo* debug_info) {
       ends_block = true;
     } else if (code == 0x4E800420) {
       // bctr -- unconditional branch to CTR.
-      // This is generally a jump to a function pointer (non-return).
-      // This is almost always a jump table.
-      // TODO(benvanik): decode jump tables.
+      // This is generally a jump to a function pointer (non-return), or a
+      // switch jump table, in which case the cases are a part of this
+      // function.
+      JumpTableInfo jump_table;
+      if (cvars::decode_jump_tables &&
+          DecodeJumpTable(memory, start_address, address, &jump_table)) {
+        LOGPPC("jump table {:08X} at {:08X} ({} targets)", address,
+               jump_table.table_address, jump_table.targets.size());
+        address_reference_count += uint32_t(jump_table.targets.size());
+        for (uint32_t target : jump_table.targets) {
+          furthest_target = std::max(furthest_target, target);
+        }
+        if (jump_table.is_inline()) {
+          // Continue after the table data rather than decoding it.
+          address = jump_table.table_end_address() - 4;
+        }
+      }
       if (furthest_target > address) {
         // Remaining targets within function, not end.
         LOGPPC("ignoring bctr {:08X} (branch to {:08X})", address,
@@ -320,8 +342,19 @@ std::vector<BlockInfo> PPCScanner::FindBlocks(GuestFunction* function) {
       ends_block = true;
     } else if (code == 0x4E800420) {
       // bctr -- unconditional branch to CTR.
-      // This is almost always a jump table.
-      // TODO(benvanik): decode jump tables.
+      JumpTableInfo jump_table;
+      if (cvars::decode_jump_tables &&
+          DecodeJumpTable(memory, start_address, address, &jump_table) &&
+          jump_table.is_inline()) {
+        // The table data is not a block.
+        block_map[block_start] = {
+            block_start,
+            address,
+        };
+        in_block = false;
+        address = jump_table.table_end_address() - 4;
+        continue;
+      }
       ends_block = true;
     } else if (opcode == PPCOpcode::bx) {
       // b/ba/bl/bla
@@ -364,6 +397,146 @@ std::vector<BlockInfo> PPCScanner::FindBlocks(GuestFunction* function) {
   return blocks;
 }
 
+bool PPCScanner::DecodeJumpTable(Memory* memory, uint32_t start_address,
+                                 uint32_t bctr_address,
+                                 JumpTableInfo* table_out) {
+  if (bctr_address <= start_address) {
+    return false;
+  }
+  uint32_t search_start_address =
+      bctr_address - std::min(bctr_address - start_address,
+                              kJumpTableSearchInstructionCount * 4);
+
+  // Walking backwards from the bctr. Registers are unknown until the
+  // instruction consuming them has been found.
+  const uint32_t kUnknown = UINT32_MAX;
+  uint32_t target_reg = kUnknown;
+  uint32_t base_reg = kUnknown;
+  uint32_t offset_reg = kUnknown;
+  uint32_t index_reg = kUnknown;
+  bool has_table_low = false, has_table_high = false;
+  int32_t table_low = 0;
+  uint32_t table_high = 0;
+  uint32_t bounds_crf = kUnknown;
+  // Whether the default branch is taken for index > bound (bgt) rather than
+  // index >= bound (bge).
+  bool bounds_inclusive = false;
+  uint32_t target_count = 0;
+  for (uint32_t address = bctr_address - 4; address >= search_start_address;
+       address -= 4) {
+    PPCDecodeData d;
+    d.address = address;
+    d.code = xe::load_and_swap<uint32_t>(memory->TranslateVirtual(address));
+    auto opcode = LookupOpcode(d.code);
+    bool is_branch = opcode == PPCOpcode::bx || opcode == PPCOpcode::bcx ||
+                     opcode == PPCOpcode::bclrx || opcode == PPCOpcode::bcctrx;
+
+    if (target_reg == kUnknown) {
+      // mtctr rT
+      if (opcode == PPCOpcode::mtspr &&
+          (((d.XFX.SPR() & 0x1F) << 5) | ((d.XFX.SPR() >> 5) & 0x1F)) == 9) {
+        target_reg = d.XFX.RT();
+      } else if (is_branch) {
+        return false;
+      }
+    } else if (base_reg == kUnknown) {
+      // lwzx rT, rB, rO
+      if (opcode == PPCOpcode::lwzx && d.X.RT() == target_reg) {
+        if (!d.X.RA()) {
+          return false;
+        }
+        base_reg = d.X.RA();
+        offset_reg = d.X.RB();
+      } else if (is_branch) {
+        return false;
+      }
+    } else if (opcode == PPCOpcode::rlwinmx && d.M.RA() == offset_reg &&
+               index_reg == kUnknown) {
+      // slwi rO, rI, 2
+      if (d.M.SH() != 2 || d.M.MB() != 0 || d.M.ME() != 29) {
+        return false;
+      }
+      index_reg = d.M.RS();
+    } else if (opcode == PPCOpcode::addi && d.D.RT() == base_reg &&
+               !has_table_low) {
+      // addi rB, rB, table@l
+      if (d.D.RA() != base_reg) {
+        return false;
+      }
+      table_low = d.D.SIMM();
+      has_table_low = true;
+    } else if (opcode == PPCOpcode::addis && d.D.RT() == base_reg &&
+               has_table_low && !has_table_high) {
+      // lis rB, table@h
+      if (d.D.RA()) {
+        return false;
+      }
+      table_high = uint32_t(d.D.SIMM()) << 16;
+      has_table_high = true;
+    } else if (opcode == PPCOpcode::bcx && bounds_crf == kUnknown) {
+      // bgt crN, default / bge crN, default, ignoring the prediction hint.
+      if (d.B.LK()) {
+        return false;
+      }
+      uint32_t bo = d.B.BO() & 0x1E;
+      uint32_t bi = d.B.BI();
+      if (bo == 0b01100 && (bi & 3) == 1) {
+        bounds_inclusive = true;
+      } else if (bo == 0b00100 && (bi & 3) == 0) {
+        bounds_inclusive = false;
+      } else {
+        return false;
+      }
+      bounds_crf = bi >> 2;
+    } else if ((opcode == PPCOpcode::cmpli || opcode == PPCOpcode::cmpi) &&
+               bounds_crf != kUnknown && d.D.CRFD() == bounds_crf) {
+      // cmplwi crN, rI, bound / cmpwi crN, rI, bound
+      if (index_reg == kUnknown || d.D.RA() != index_reg) {
+        return false;
+      }
+      int64_t bound = opcode == PPCOpcode::cmpli ? int64_t(d.D.UIMM())
+                                                 : int64_t(d.D.SIMM());
+      if (bounds_inclusive) {
+        ++bound;
+      }
+      if (bound <= 0 || bound > kJumpTableMaxTargetCount) {
+        return false;
+      }
+      target_count = uint32_t(bound);
+      break;
+    } else if (is_branch) {
+      return false;
+    }
+  }
+  if (!target_count || !has_table_high) {
+    return false;
+  }
+
+  uint32_t table_address = table_high + uint32_t(table_low);
+  if (table_address & 3) {
+    return false;
+  }
+  BaseHeap* table_heap = memory->LookupHeap(table_address);
+  if (!table_heap ||
+      table_heap->QueryRangeAccess(table_address,
+                                   table_address + target_count * 4 - 1) ==
+          xe::memory::PageAccess::kNoAccess) {
+    return false;
+  }
+  table_out->bctr_address = bctr_address;
+  table_out->table_address = table_address;
+  table_out->targets.resize(target_count);
+  for (uint32_t i = 0; i < target_count; ++i) {
+    uint32_t target = xe::load_and_swap<uint32_t>(
+        memory->TranslateVirtual(table_address + i * 4));
+    if (!target || (target & 3) || target < start_address) {
+      return false;
+    }
+    table_out->targets[i] = target;
+  }
+  return true;
+}
+
 }  // namespace ppc
 }  // namespace cpu
 }  // namespace xe
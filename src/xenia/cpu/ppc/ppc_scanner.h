@@ -14,6 +14,7 @@
 
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/function_debug_info.h"
+#include "xenia/memory.h"
 
 namespace xe {
 namespace cpu {
@@ -26,6 +27,28 @@ struct BlockInfo {
   uint32_t end_address;
 };
 
+// A switch jump table dispatched through bctr:
+//   cmplwi crN, rI, count - 1
+//   bgt    crN, default
+//   lis    rB, table@h
+//   addi   rB, rB, table@l
+//   slwi   rO, rI, 2
+//   lwzx   rT, rB, rO
+//   mtctr  rT
+//   bctr
+struct JumpTableInfo {
+  uint32_t bctr_address;
+  uint32_t table_address;
+  // Targets in table order, may contain duplicates.
+  std::vector<uint32_t> targets;
+
+  // Whether the table data directly follows the bctr, inside the function.
+  bool is_inline() const { return table_address == bctr_address + 4; }
+  uint32_t table_end_address() const {
+    return table_address + uint32_t(targets.size()) * 4;
+  }
+};
+
 class PPCScanner {
  public:
   explicit PPCScanner(PPCFrontend* frontend);
@@ -35,6 +58,12 @@ class PPCScanner {
 
   std::vector<BlockInfo> FindBlocks(GuestFunction* function);
 
+  // Matches the jump table idiom in the instructions before the bctr at
+  // bctr_address, not looking before start_address. The bounds check must be
+  // present, as it's the only source of the table size.
+  static bool DecodeJumpTable(Memory* memory, uint32_t start_address,
+                              uint32_t bctr_address, JumpTableInfo* table_out);
+
  private:
   bool IsRestGprLr(uint32_t address);
 
@@ -11,12 +11,14 @@
 
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/reset_scope.h"
 #include "xenia/base/string.h"
 #include "xenia/cpu/compiler/compiler_passes.h"
+#include "xenia/cpu/compiler/compiler_statistics.h"
 #include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/ppc/ppc_hir_builder.h"
@@ -79,6 +81,11 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   if (validate) sap->AddPass(std::make_unique<passes::ValidationPass>());
   compiler_->AddPass(std::move(sap));
 
+  // Needs the context loads promoted and the constants folded, to find what
+  // doesn't change in loops.
+  compiler_->AddPass(std::make_unique<passes::LoopInvariantCodeMotionPass>());
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+
   if (backend->machine_info()->supports_extended_load_store) {
     // Backend supports the advanced LOAD/STORE instructions.
     // These will save us a lot of HIR opcodes.
@@ -89,6 +96,9 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   }
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  // After the last simplification, which combines and rewrites the compares.
+  compiler_->AddPass(std::make_unique<passes::CompareBranchFusionPass>());
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   // compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
   // if (validate)
   // compiler_->AddPass(std::make_unique<passes::ValidationPass>());
@@ -109,6 +119,32 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
 
   // Must come last. The HIR is not really HIR after this.
   compiler_->AddPass(std::make_unique<passes::FinalizationPass>());
+
+  if (cvars::tiered_compilation) {
+    // Only the passes needed for reasonable code - single simplification and
+    // constant propagation runs instead of the group looping until no changes
+    // are made, without context promotion and memory sequence combination.
+    baseline_compiler_.reset(new Compiler(frontend->processor()));
+    baseline_compiler_->AddPass(
+        std::make_unique<passes::ControlFlowAnalysisPass>());
+    baseline_compiler_->AddPass(
+        std::make_unique<passes::ControlFlowSimplificationPass>());
+    baseline_compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
+    baseline_compiler_->AddPass(
+        std::make_unique<passes::ConstantPropagationPass>());
+    baseline_compiler_->AddPass(
+        std::make_unique<passes::DeadCodeEliminationPass>());
+    if (validate) {
+      baseline_compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+    }
+    baseline_compiler_->AddPass(
+        std::make_unique<passes::RegisterAllocationPass>(
+            backend->machine_info()));
+    if (validate) {
+      baseline_compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+    }
+    baseline_compiler_->AddPass(std::make_unique<passes::FinalizationPass>());
+  }
 }
 
 PPCTranslator::~PPCTranslator() = default;
@@ -173,9 +209,15 @@ bool PPCTranslator::Translate(GuestFunction* function,
   // Reset() all caching when we leave.
   xe::make_reset_scope(builder_);
   xe::make_reset_scope(compiler_);
+  xe::make_reset_scope(baseline_compiler_);
   xe::make_reset_scope(assembler_);
   xe::make_reset_scope(&string_buffer_);
 
+  compiler::CompilerStatistics* statistics =
+      frontend_->processor()->compiler_statistics();
+  compiler::CompilerStatistics::FunctionRecord statistics_record = {};
+  uint64_t statistics_ticks = statistics ? Clock::QueryHostTickCount() : 0;
+
   // NOTE: we only want to do this when required, as it's expensive to build.
   if (cvars::disassemble_functions) {
     debug_info_flags |= DebugInfoFlags::kDebugInfoAllDisasm;
@@ -231,6 +273,12 @@ bool PPCTranslator::Translate(GuestFunction* function,
   }
 
   // Emit function.
+  // With --debug all functions are translated for debugging, otherwise only
+  // the ones with breakpoints, so the rest of the code runs fully optimized.
+  if (cvars::debug || function->is_debuggable()) {
+    builder_->set_attributes(builder_->attributes() |
+                             hir::FUNCTION_ATTRIB_DEBUGGABLE);
+  }
   uint32_t emit_flags = 0;
   if (debug_info) {
     emit_flags |= PPCHIRBuilder::EMIT_DEBUG_COMMENTS;
@@ -239,6 +287,14 @@ bool PPCTranslator::Translate(GuestFunction* function,
     return false;
   }
 
+  if (statistics) {
+    uint64_t build_end_ticks = Clock::QueryHostTickCount();
+    statistics_record.build_ticks = build_end_ticks - statistics_ticks;
+    statistics_ticks = build_end_ticks;
+    statistics_record.hir_instruction_count =
+        compiler::CompilerStatistics::CountInstructions(builder_.get());
+  }
+
   // Stash raw HIR.
   if (debug_info_flags & DebugInfoFlags::kDebugInfoDisasmRawHir) {
     builder_->Dump(&string_buffer_);
@@ -247,9 +303,48 @@ bool PPCTranslator::Translate(GuestFunction* function,
   }
 
   // Compile/optimize/etc.
-  if (!compiler_->Compile(builder_.get())) {
+  // With tiered compilation, functions being compiled for the first time go
+  // through the fast pipeline, and are recompiled with all optimizations once
+  // called often enough. Functions known to be hot from the previous runs are
+  // compiled with all optimizations right away.
+  bool baseline_tier = baseline_compiler_ && !function->machine_code();
+  if (baseline_tier && cvars::profile_guided_function_layout) {
+    auto xexmod = dynamic_cast<XexModule*>(function->module());
+    if (xexmod) {
+      auto addr_flags = xexmod->GetInstructionAddressFlags(function->address());
+      if (addr_flags && addr_flags->is_hot) {
+        baseline_tier = false;
+      }
+    }
+  }
+  // Or from the entry counts of the edge profile of the previous runs.
+  if (baseline_tier) {
+    EdgeProfile* edge_profile = frontend_->processor()->edge_profile();
+    if (edge_profile &&
+        edge_profile->GetProfiledEntryCount(function->address()) >=
+            cvars::tiered_compilation_threshold) {
+      baseline_tier = false;
+    }
+  }
+  if (baseline_tier) {
+    function->set_baseline_tier(true);
+  }
+  if (!(baseline_tier ? baseline_compiler_ : compiler_)
+           ->Compile(builder_.get())) {
     return false;
   }
+  if (!builder_->constant_load_addresses().empty()) {
+    frontend_->processor()->RecordConstantLoads(
+        function->address(), builder_->constant_load_addresses());
+  }
+
+  if (statistics) {
+    uint64_t compile_end_ticks = Clock::QueryHostTickCount();
+    statistics_record.compile_ticks = compile_end_ticks - statistics_ticks;
+    statistics_ticks = compile_end_ticks;
+    statistics_record.optimized_hir_instruction_count =
+        compiler::CompilerStatistics::CountInstructions(builder_.get());
+  }
 
   // Stash optimized HIR.
   if (debug_info_flags & DebugInfoFlags::kDebugInfoDisasmHir) {
@@ -265,6 +360,21 @@ bool PPCTranslator::Translate(GuestFunction* function,
                             std::move(debug_info))) {
     return false;
   }
+  if (!baseline_tier) {
+    // Let callers call the optimized code directly.
+    function->set_baseline_tier(false);
+  }
+
+  if (statistics) {
+    statistics_record.assemble_ticks =
+        Clock::QueryHostTickCount() - statistics_ticks;
+    statistics_record.guest_address = function->address();
+    statistics_record.baseline_tier = baseline_tier;
+    statistics_record.code_size = uint32_t(function->machine_code_length());
+    statistics_record.fp_mode_switch_count =
+        assembler_->last_fp_mode_switch_count();
+    statistics->RecordFunction(statistics_record);
+  }
 
   return true;
 }
@@ -41,6 +41,8 @@ class PPCTranslator {
   std::unique_ptr<PPCScanner> scanner_;
   std::unique_ptr<PPCHIRBuilder> builder_;
   std::unique_ptr<compiler::Compiler> compiler_;
+  // Fast pipeline for the first compilation with tiered compilation.
+  std::unique_ptr<compiler::Compiler> baseline_compiler_;
   std::unique_ptr<backend::Assembler> assembler_;
 
   StringBuffer string_buffer_;
@@ -9,10 +9,13 @@
 
 #include "xenia/cpu/processor.h"
 
+#include <algorithm>
+
 #include "xenia/base/assert.h"
 #include "xenia/base/atomic.h"
 #include "xenia/base/byte_order.h"
 #include "xenia/base/byte_stream.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/debugging.h"
 #include "xenia/base/exception_handler.h"
@@ -23,6 +26,7 @@
 #include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
 #include "xenia/cpu/breakpoint.h"
+#include "xenia/cpu/compiler/compiler_statistics.h"
 #include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/export_resolver.h"
 #include "xenia/cpu/module.h"
@@ -44,10 +48,33 @@
 
 DEFINE_bool(debug, DEFAULT_DEBUG_FLAG,
             "Allow debugging and retain debug information.", "General");
+DEFINE_bool(debug_on_demand, false,
+            "Allow debugging without --debug, translating only the functions "
+            "breakpoints are placed in for debugging, with the rest of the "
+            "code staying fully optimized. Guest registers shown for the "
+            "frames of other functions may be out of date.",
+            "General");
 DEFINE_path(trace_function_data_path, "", "File to write trace data to.",
             "CPU");
 DEFINE_bool(break_on_start, false, "Break into the debugger on startup.",
             "CPU");
+DEFINE_path(compiler_statistics_path, "",
+            "File to write the translation time and code size of guest "
+            "functions and compiler passes to as CSV on exit.",
+            "CPU");
+DEFINE_uint32(compiler_statistics_function_count, 100,
+              "Number of the most expensive to translate functions to write "
+              "to compiler_statistics_path, 0 to write all.",
+              "CPU");
+DEFINE_bool(invalidate_written_code, true,
+            "Watch the guest pages with translated code the guest can write "
+            "to, translating the functions there again after writes.",
+            "CPU");
+
+DECLARE_bool(sampling_profiler);
+DECLARE_path(sampling_profiler_output_path);
+DECLARE_path(memory_access_trace_output_path);
+DECLARE_path(edge_profile_path);
 
 namespace xe {
 namespace kernel {
@@ -59,6 +86,11 @@ namespace cpu {
 using xe::cpu::ppc::PPCOpcode;
 using xe::kernel::XThread;
 
+static xe::counters::Counter& functions_compiled_counter =
+    xe::counters::GetCounter("cpu/functions_compiled");
+static xe::counters::Counter& functions_restored_counter =
+    xe::counters::GetCounter("cpu/functions_restored");
+
 using namespace xe::literals;
 
 class BuiltinModule : public Module {
@@ -86,6 +118,24 @@ Processor::Processor(xe::Memory* memory, ExportResolver* export_resolver)
     : memory_(memory), export_resolver_(export_resolver) {}
 
 Processor::~Processor() {
+  ShutdownFunctionOptimization();
+
+  if (physical_code_write_callback_handle_) {
+    memory_->UnregisterPhysicalMemoryInvalidationCallback(
+        physical_code_write_callback_handle_);
+    physical_code_write_callback_handle_ = nullptr;
+  }
+  memory_->SetCodeWriteCallback(nullptr, nullptr);
+
+  if (sampling_profiler_) {
+    sampling_profiler_->Stop();
+    if (!cvars::sampling_profiler_output_path.empty()) {
+      sampling_profiler_->ExportCollapsedStacks(
+          cvars::sampling_profiler_output_path);
+    }
+    sampling_profiler_.reset();
+  }
+
   {
     auto global_lock = global_critical_region_.Acquire();
     modules_.clear();
@@ -94,6 +144,24 @@ Processor::~Processor() {
   frontend_.reset();
   backend_.reset();
 
+  if (compiler_statistics_) {
+    compiler_statistics_->Dump(cvars::compiler_statistics_path,
+                               cvars::compiler_statistics_function_count);
+    compiler_statistics_.reset();
+  }
+
+  if (memory_access_trace_) {
+    if (!cvars::memory_access_trace_output_path.empty()) {
+      memory_access_trace_->ExportCsv(cvars::memory_access_trace_output_path);
+    }
+    memory_access_trace_.reset();
+  }
+
+  if (edge_profile_) {
+    edge_profile_->Save(cvars::edge_profile_path);
+    edge_profile_.reset();
+  }
+
   if (functions_trace_file_) {
     functions_trace_file_->Flush();
     functions_trace_file_.reset();
@@ -139,12 +207,35 @@ bool Processor::Setup(std::unique_ptr<backend::Backend> backend) {
   if (code_cache) {
     stack_walker_ = StackWalker::Create(code_cache);
   }
-  if (!stack_walker_) {
+  if (stack_walker_) {
+    sampling_profiler_ = std::make_unique<SamplingProfiler>(this);
+    if (cvars::sampling_profiler) {
+      sampling_profiler_->Start();
+    }
+  } else {
     // TODO(benvanik): disable features.
     if (cvars::debug) {
       XELOGW("Disabling --debug due to lack of stack walker");
       cvars::debug = false;
     }
+    if (cvars::debug_on_demand) {
+      XELOGW("Disabling --debug_on_demand due to lack of stack walker");
+      cvars::debug_on_demand = false;
+    }
+  }
+
+  if (!cvars::compiler_statistics_path.empty()) {
+    compiler_statistics_ = std::make_unique<compiler::CompilerStatistics>();
+  }
+  // Before any code is generated, for the checks to be emitted in it.
+  memory_access_trace_ = MemoryAccessTrace::Create();
+  edge_profile_ = EdgeProfile::Create();
+
+  if (cvars::invalidate_written_code) {
+    memory_->SetCodeWriteCallback(CodeWriteCallbackThunk, this);
+    physical_code_write_callback_handle_ =
+        memory_->RegisterPhysicalMemoryInvalidationCallback(
+            PhysicalCodeWriteCallbackThunk, this);
   }
 
   // Open the trace data path, if requested.
@@ -247,6 +338,156 @@ std::vector<Function*> Processor::FindFunctionsWithAddress(uint32_t address) {
 
 void Processor::RemoveFunctionByAddress(uint32_t address) {
   entry_table_.Delete(address);
+  backend_->RemoveFunction(address);
+  // The functions with the code inlined are stale too.
+  for (uint32_t caller_address : entry_table_.TakeInlinedCallers(address)) {
+    RemoveFunctionByAddress(caller_address);
+  }
+}
+
+void Processor::RecordInlinedFunction(uint32_t callee_address,
+                                      uint32_t caller_address) {
+  entry_table_.AddInlinedCall(callee_address, caller_address);
+}
+
+void Processor::RecordConstantLoads(
+    uint32_t function_address, const std::vector<uint32_t>& data_addresses) {
+  if (!cvars::invalidate_written_code) {
+    return;
+  }
+  for (uint32_t data_address : data_addresses) {
+    entry_table_.AddConstantLoad(data_address, function_address);
+    memory_->WatchReadOnlyPages(data_address, 1);
+  }
+}
+
+bool Processor::SetupHostRoutine(uint32_t address,
+                                 GuestFunction::ExternHandler handler) {
+  Function* function = LookupFunction(address);
+  if (!function || !function->is_guest() ||
+      function->behavior() != Function::Behavior::kDefault) {
+    return false;
+  }
+  auto guest_function = static_cast<GuestFunction*>(function);
+  guest_function->SetupExtern(handler);
+  if (function->status() != Symbol::Status::kDefined) {
+    return true;
+  }
+  return RedefineFunction(guest_function);
+}
+
+void Processor::InvalidateGuestCode(uint32_t address, uint32_t length) {
+  if (!length) {
+    return;
+  }
+  uint32_t end_address = address + length;
+  // Not restored from the storage either, the stored code is of the code
+  // before the modification.
+  backend_->DiscardStoredFunctions(address, end_address);
+  for (Function* function : entry_table_.FindInRange(address, end_address)) {
+    if (function->is_guest() &&
+        function->status() == Symbol::Status::kDefined) {
+      RedefineFunction(static_cast<GuestFunction*>(function));
+    }
+  }
+}
+
+void Processor::InvalidateWrittenGuestCode(uint32_t address,
+                                           uint32_t length) {
+  if (!length) {
+    return;
+  }
+  uint32_t end_address = address + length;
+  backend_->DiscardStoredFunctions(address, end_address);
+  for (Function* function : entry_table_.FindInRange(address, end_address)) {
+    if (function->is_guest()) {
+      InvalidateWrittenFunction(function->address());
+    }
+  }
+  // Data in the range may also have been folded into the code of functions
+  // elsewhere.
+  for (uint32_t function_address :
+       entry_table_.TakeConstantLoaders(address, end_address)) {
+    InvalidateWrittenFunction(function_address);
+  }
+}
+
+void Processor::InvalidateWrittenFunction(uint32_t address) {
+  Function* function = QueryFunction(address);
+  // Translating again right away would likely see the code partially written,
+  // so the function is only declared again, to be defined on the next call
+  // resolving it through the indirection table.
+  if (function && function->is_guest() &&
+      function->status() == Symbol::Status::kDefined) {
+    function->set_status(Symbol::Status::kDeclared);
+  }
+  entry_table_.Delete(address);
+  backend_->RemoveFunction(address);
+  for (uint32_t caller_address : entry_table_.TakeInlinedCallers(address)) {
+    InvalidateWrittenFunction(caller_address);
+  }
+}
+
+void Processor::WatchCodeWrites(GuestFunction* function) {
+  if (!cvars::invalidate_written_code) {
+    return;
+  }
+  uint32_t address = function->address();
+  uint32_t length = function->end_address() + 4 - address;
+  const BaseHeap* heap = memory_->LookupHeap(address);
+  if (!heap) {
+    return;
+  }
+  if (heap->heap_type() == HeapType::kGuestPhysical) {
+    memory_->EnablePhysicalMemoryAccessCallbacks(
+        memory_->GetPhysicalAddress(address), length, true, false);
+  } else {
+    memory_->WatchCodeWrites(address, length);
+  }
+}
+
+void Processor::CodeWriteCallbackThunk(void* context_ptr,
+                                       uint32_t virtual_address,
+                                       uint32_t length) {
+  reinterpret_cast<Processor*>(context_ptr)
+      ->InvalidateWrittenGuestCode(virtual_address, length);
+}
+
+std::pair<uint32_t, uint32_t> Processor::PhysicalCodeWriteCallbackThunk(
+    void* context_ptr, uint32_t physical_address_start, uint32_t length,
+    bool exact_range) {
+  auto processor = reinterpret_cast<Processor*>(context_ptr);
+  // The code may be executed via any of the mirrors of the physical memory,
+  // the one at 0xE0000000 being offset by 4 KB.
+  for (uint32_t mirror_base : {0xA0000000u, 0xC0000000u}) {
+    processor->InvalidateWrittenGuestCode(mirror_base + physical_address_start,
+                                          length);
+  }
+  if (physical_address_start + length > 0x1000) {
+    uint32_t start = std::max(physical_address_start, uint32_t(0x1000));
+    processor->InvalidateWrittenGuestCode(
+        0xE0000000 + (start - 0x1000),
+        physical_address_start + length - start);
+  }
+  return std::make_pair(uint32_t(0), UINT32_MAX);
+}
+
+bool Processor::RedefineFunction(GuestFunction* function) {
+  // New calls go through the indirection table to the new code.
+  if (!frontend_->DefineFunction(function, debug_info_flags_)) {
+    return false;
+  }
+  WatchCodeWrites(function);
+  // Breakpoints in the old code don't apply to the new code.
+  OnFunctionDefined(function);
+  for (uint32_t caller_address :
+       entry_table_.TakeInlinedCallers(function->address())) {
+    Function* caller = QueryFunction(caller_address);
+    if (caller && caller->is_guest()) {
+      RedefineFunction(static_cast<GuestFunction*>(caller));
+    }
+  }
+  return true;
 }
 
 Function* Processor::ResolveFunction(uint32_t address) {
@@ -259,12 +500,12 @@ Function* Processor::ResolveFunction(uint32_t address) {
     auto function = LookupFunction(address);
 
     if (!function) {
-      entry->status = Entry::STATUS_FAILED;
+      EntryTable::SetStatus(entry, Entry::STATUS_FAILED);
       return nullptr;
     }
 
     if (!DemandFunction(function)) {
-      entry->status = Entry::STATUS_FAILED;
+      EntryTable::SetStatus(entry, Entry::STATUS_FAILED);
       return nullptr;
     }
     // only add it to the list of resolved functions if resolving succeeded
@@ -280,7 +521,8 @@ Function* Processor::ResolveFunction(uint32_t address) {
 
     entry->function = function;
     entry->end_address = function->end_address();
-    status = entry->status = Entry::STATUS_READY;
+    status = Entry::STATUS_READY;
+    EntryTable::SetStatus(entry, status);
   }
   if (status == Entry::STATUS_READY) {
     // Ready to use.
@@ -332,6 +574,76 @@ Function* Processor::LookupFunction(Module* module, uint32_t address) {
   return function;
 }
 
+void Processor::RequestFunctionOptimization(uint32_t address) {
+  std::lock_guard<std::mutex> lock(optimization_mutex_);
+  if (optimization_shutdown_) {
+    return;
+  }
+  if (!optimization_thread_) {
+    optimization_thread_ = xe::threading::Thread::Create(
+        {}, [this]() { FunctionOptimizationThread(); });
+    assert_not_null(optimization_thread_);
+    optimization_thread_->set_name("Guest Function Optimization");
+  }
+  optimization_queue_.push_back(address);
+  optimization_cond_.notify_one();
+}
+
+void Processor::FunctionOptimizationThread() {
+  while (true) {
+    uint32_t address;
+    {
+      std::unique_lock<std::mutex> lock(optimization_mutex_);
+      optimization_cond_.wait(lock, [this]() {
+        return optimization_shutdown_ || !optimization_queue_.empty();
+      });
+      if (optimization_shutdown_) {
+        break;
+      }
+      address = optimization_queue_.front();
+      optimization_queue_.pop_front();
+    }
+    Function* function = QueryFunction(address);
+    if (!function || !function->is_guest()) {
+      continue;
+    }
+    auto guest_function = static_cast<GuestFunction*>(function);
+    // Multiple threads may reach the threshold at the same time.
+    if (!guest_function->is_baseline_tier()) {
+      continue;
+    }
+    // Remember for profile-guided layout in the next runs.
+    auto xexmod = dynamic_cast<XexModule*>(guest_function->module());
+    if (xexmod) {
+      auto addr_flags = xexmod->GetInstructionAddressFlags(address);
+      if (addr_flags) {
+        addr_flags->is_hot = 1;
+      }
+    }
+    // Threads still executing the baseline code keep running it, new calls go
+    // through the indirection table to the optimized code.
+    if (frontend_->DefineFunction(guest_function, debug_info_flags_)) {
+      OnFunctionDefined(guest_function);
+    } else {
+      XELOGE("Failed to recompile function {:08X} with all optimizations",
+             address);
+    }
+  }
+}
+
+void Processor::ShutdownFunctionOptimization() {
+  {
+    std::lock_guard<std::mutex> lock(optimization_mutex_);
+    optimization_shutdown_ = true;
+    optimization_queue_.clear();
+  }
+  optimization_cond_.notify_all();
+  if (optimization_thread_) {
+    xe::threading::Wait(optimization_thread_.get(), false);
+    optimization_thread_.reset();
+  }
+}
+
 bool Processor::DemandFunction(Function* function) {
   // Lock function for generation. If it's already being generated
   // by another thread this will block and return DECLARED.
@@ -340,11 +652,22 @@ bool Processor::DemandFunction(Function* function) {
   if (symbol_status == Symbol::Status::kNew) {
     // Symbol is undefined, so define now.
     assert_true(function->is_guest());
-    if (!frontend_->DefineFunction(static_cast<GuestFunction*>(function),
-                                   debug_info_flags_)) {
-      function->set_status(Symbol::Status::kFailed);
-      return false;
+    auto guest_function = static_cast<GuestFunction*>(function);
+    // The stored code of externs may be of another handler, such as the guest
+    // code of a routine replaced by a host one in this run.
+    // Nor is the stored code translated for debugging.
+    bool is_extern = function->behavior() == Function::Behavior::kExtern;
+    if (!is_extern && !guest_function->is_debuggable() &&
+        backend_->RestoreFunction(guest_function)) {
+      functions_restored_counter.Increment();
+    } else {
+      if (!frontend_->DefineFunction(guest_function, debug_info_flags_)) {
+        function->set_status(Symbol::Status::kFailed);
+        return false;
+      }
+      functions_compiled_counter.Increment();
     }
+    WatchCodeWrites(guest_function);
 
     // Before we give the symbol back to the rest, let the debugger know.
     OnFunctionDefined(function);
@@ -465,6 +788,39 @@ uint8_t* Processor::AllocateFunctionTraceData(size_t size) {
   return functions_trace_file_->Allocate(size);
 }
 
+void Processor::MakeCodeDebuggable(uint32_t address) {
+  if (cvars::debug) {
+    // Everything is translated for debugging already.
+    return;
+  }
+  auto global_lock = global_critical_region_.Acquire();
+  std::vector<Function*> functions = FindFunctionsWithAddress(address);
+  // Not defined yet, but will be when the breakpoint is installed - in the
+  // same way as Breakpoint::ForEachHostAddress resolves it.
+  if (Function* function = LookupFunction(address)) {
+    functions.push_back(function);
+  }
+  for (Function* function : functions) {
+    if (!function->is_guest()) {
+      continue;
+    }
+    auto guest_function = static_cast<GuestFunction*>(function);
+    if (guest_function->is_debuggable()) {
+      continue;
+    }
+    // Kept debuggable for the rest of the run, so toggling the breakpoints
+    // doesn't translate the function again each time. Threads already
+    // executing the old code keep running it until they call the function
+    // again.
+    guest_function->set_debuggable(true);
+    if (function->status() == Symbol::Status::kDefined) {
+      XELOGI("Translating function {:08X} again for debugging",
+             guest_function->address());
+      RedefineFunction(guest_function);
+    }
+  }
+}
+
 void Processor::OnFunctionDefined(Function* function) {
   auto global_lock = global_critical_region_.Acquire();
   for (auto breakpoint : breakpoints_) {
@@ -810,6 +1166,41 @@ bool Processor::ResumeAllThreads() {
   return true;
 }
 
+void Processor::CaptureGuestThreadStacks(
+    const std::function<void(const StackFrame* frames, size_t frame_count)>&
+        callback) {
+  if (!stack_walker_) {
+    return;
+  }
+  uint64_t frame_host_pcs[64];
+  xe::cpu::StackFrame cpu_frames[64];
+  auto global_lock = global_critical_region_.Acquire();
+  for (auto& it : thread_debug_infos_) {
+    auto thread_info = it.second.get();
+    auto thread = thread_info->thread;
+    // Threads suspended by the debugger are not running guest code.
+    if (!thread || !thread->can_debugger_suspend() || thread_info->suspended ||
+        thread_info->state == ThreadDebugInfo::State::kZombie ||
+        thread_info->state == ThreadDebugInfo::State::kExited ||
+        (Thread::IsInThread() &&
+         thread_info->thread_id == Thread::GetCurrentThreadId())) {
+      continue;
+    }
+    if (!thread->thread()->Suspend(nullptr)) {
+      continue;
+    }
+    size_t count = stack_walker_->CaptureStackTrace(
+        thread->thread()->native_handle(), frame_host_pcs, 0,
+        xe::countof(frame_host_pcs), nullptr, nullptr);
+    thread->thread()->Resume();
+    if (!count) {
+      continue;
+    }
+    stack_walker_->ResolveStack(frame_host_pcs, cpu_frames, count);
+    callback(cpu_frames, count);
+  }
+}
+
 void Processor::UpdateThreadExecutionStates(
     uint32_t override_thread_id, HostThreadContext* override_context) {
   auto global_lock = global_critical_region_.Acquire();
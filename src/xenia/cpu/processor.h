@@ -10,26 +10,36 @@
 #ifndef XENIA_CPU_PROCESSOR_H_
 #define XENIA_CPU_PROCESSOR_H_
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "xenia/base/cvar.h"
 #include "xenia/base/mapped_memory.h"
 #include "xenia/base/mutex.h"
+#include "xenia/base/threading.h"
 #include "xenia/cpu/backend/backend.h"
+#include "xenia/cpu/compiler/compiler_statistics.h"
 #include "xenia/cpu/debug_listener.h"
 #include "xenia/cpu/entry_table.h"
 #include "xenia/cpu/export_resolver.h"
 #include "xenia/cpu/function.h"
+#include "xenia/cpu/edge_profile.h"
+#include "xenia/cpu/memory_access_trace.h"
 #include "xenia/cpu/module.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
+#include "xenia/cpu/sampling_profiler.h"
 #include "xenia/cpu/thread_debug_info.h"
 #include "xenia/cpu/thread_state.h"
 #include "xenia/memory.h"
 
 DECLARE_bool(debug);
+DECLARE_bool(debug_on_demand);
 
 namespace xe {
 namespace cpu {
@@ -38,6 +48,7 @@ constexpr fourcc_t kProcessorSaveSignature = make_fourcc("PROC");
 
 class Breakpoint;
 class StackWalker;
+struct StackFrame;
 class XexModule;
 
 enum class Irql : uint32_t {
@@ -70,6 +81,20 @@ class Processor {
   StackWalker* stack_walker() const { return stack_walker_.get(); }
   ppc::PPCFrontend* frontend() const { return frontend_.get(); }
   backend::Backend* backend() const { return backend_.get(); }
+  // Null unless collecting compiler statistics.
+  compiler::CompilerStatistics* compiler_statistics() const {
+    return compiler_statistics_.get();
+  }
+  // Null if the stacks of the threads can't be walked.
+  SamplingProfiler* sampling_profiler() const {
+    return sampling_profiler_.get();
+  }
+  // Null unless tracing the accesses to a guest memory range.
+  MemoryAccessTrace* memory_access_trace() const {
+    return memory_access_trace_.get();
+  }
+  // Null unless the function entries and call sites are counted.
+  EdgeProfile* edge_profile() const { return edge_profile_.get(); }
   ExportResolver* export_resolver() const { return export_resolver_; }
 
   bool Setup(std::unique_ptr<backend::Backend> backend);
@@ -112,12 +137,33 @@ class Processor {
 
   Function* QueryFunction(uint32_t address);
   std::vector<Function*> FindFunctionsWithAddress(uint32_t address);
+  // Also removes the functions the one at the address was inlined into.
   void RemoveFunctionByAddress(uint32_t address);
+  void RecordInlinedFunction(uint32_t callee_address, uint32_t caller_address);
+  // Makes the function at function_address translated again if the read-only
+  // memory it has loaded constants from becomes writable.
+  void RecordConstantLoads(uint32_t function_address,
+                           const std::vector<uint32_t>& data_addresses);
+
+  // Replaces the translated code of the guest function with a call to the host
+  // handler, retranslating it if it has already been defined.
+  bool SetupHostRoutine(uint32_t address, GuestFunction::ExternHandler handler);
+  // Retranslates the defined functions with code in the range after the guest
+  // code there has been modified, along with the functions it was inlined
+  // into, leaving the code of all other functions as is.
+  void InvalidateGuestCode(uint32_t address, uint32_t length);
+  // Makes the functions with code in the range translated again on the next
+  // call, along with the functions it was inlined into, unlinking the direct
+  // calls to them. For writes to the code, which may not be complete yet.
+  void InvalidateWrittenGuestCode(uint32_t address, uint32_t length);
 
   Function* LookupFunction(uint32_t address);
   Module* LookupModule(uint32_t address);
   Function* LookupFunction(Module* module, uint32_t address);
   Function* ResolveFunction(uint32_t address);
+  // Queues a function compiled with the baseline pipeline of tiered
+  // compilation for recompilation with all optimizations in the background.
+  void RequestFunctionOptimization(uint32_t address);
 
   bool Execute(ThreadState* thread_state, uint32_t address);
   bool ExecuteRaw(ThreadState* thread_state, uint32_t address);
@@ -149,6 +195,12 @@ class Processor {
   // Returns all currently registered breakpoints.
   std::vector<Breakpoint*> breakpoints() const;
 
+  // Translates the functions containing the guest address, unless already
+  // done, so the guest state is exact at the instruction boundaries for
+  // breakpoints and stepping, without affecting the code of other functions.
+  // Called before placing a breakpoint at the address.
+  void MakeCodeDebuggable(uint32_t address);
+
   // Shows the debug listener, focusing it if it already exists.
   void ShowDebugger();
 
@@ -211,6 +263,15 @@ class Processor {
 
   uint8_t* AllocateFunctionTraceData(size_t size);
 
+  // Translates the defined function again, and the ones it was inlined into.
+  bool RedefineFunction(GuestFunction* function);
+
+  // Briefly suspends each running guest thread to capture its stack, passing
+  // the resolved frames, innermost first, to the callback after resuming it.
+  void CaptureGuestThreadStacks(
+      const std::function<void(const StackFrame* frames, size_t frame_count)>&
+          callback);
+
  private:
   // Synchronously demands a debug listener.
   void DemandDebugListener();
@@ -248,8 +309,19 @@ class Processor {
                                          uint32_t current_pc);
 
   bool DemandFunction(Function* function);
+  // Watches the writes to the guest code of the translated function.
+  void WatchCodeWrites(GuestFunction* function);
+  void InvalidateWrittenFunction(uint32_t address);
+  static void CodeWriteCallbackThunk(void* context_ptr,
+                                     uint32_t virtual_address, uint32_t length);
+  static std::pair<uint32_t, uint32_t> PhysicalCodeWriteCallbackThunk(
+      void* context_ptr, uint32_t physical_address_start, uint32_t length,
+      bool exact_range);
+  void FunctionOptimizationThread();
+  void ShutdownFunctionOptimization();
 
   Memory* memory_ = nullptr;
+  void* physical_code_write_callback_handle_ = nullptr;
   std::unique_ptr<StackWalker> stack_walker_;
 
   std::function<DebugListener*(Processor*)> debug_listener_handler_;
@@ -260,9 +332,20 @@ class Processor {
   // If specified, the file trace data gets written to when running.
   std::filesystem::path functions_trace_path_;
   std::unique_ptr<ChunkedMappedMemoryWriter> functions_trace_file_;
+  std::unique_ptr<compiler::CompilerStatistics> compiler_statistics_;
+  std::unique_ptr<SamplingProfiler> sampling_profiler_;
+  std::unique_ptr<MemoryAccessTrace> memory_access_trace_;
+  std::unique_ptr<EdgeProfile> edge_profile_;
 
   std::unique_ptr<ppc::PPCFrontend> frontend_;
   std::unique_ptr<backend::Backend> backend_;
+
+  // Tiered compilation recompiling hot functions.
+  std::mutex optimization_mutex_;
+  std::condition_variable optimization_cond_;
+  std::deque<uint32_t> optimization_queue_;
+  bool optimization_shutdown_ = false;
+  std::unique_ptr<xe::threading::Thread> optimization_thread_;
   ExportResolver* export_resolver_ = nullptr;
 
   EntryTable entry_table_;
@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/sampling_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/backend/backend.h"
+#include "xenia/cpu/function.h"
+#include "xenia/cpu/processor.h"
+#include "xenia/cpu/stack_walker.h"
+
+DEFINE_bool(sampling_profiler, false,
+            "Sample the stacks of the guest threads from the start, for "
+            "finding the hot guest functions. Can also be started from the "
+            "debugger.",
+            "CPU");
+DEFINE_uint32(sampling_profiler_interval_ms, 1,
+              "Milliseconds between the samples of the sampling profiler.",
+              "CPU");
+DEFINE_path(sampling_profiler_output_path, "",
+            "File to write the guest stacks sampled by the sampling profiler "
+            "to on exit, in the collapsed format of flamegraph.pl.",
+            "CPU");
+
+namespace xe {
+namespace cpu {
+
+SamplingProfiler::SamplingProfiler(Processor* processor)
+    : processor_(processor) {}
+
+SamplingProfiler::~SamplingProfiler() { Stop(); }
+
+void SamplingProfiler::Start() {
+  if (thread_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    thread_shutdown_ = false;
+  }
+  thread_ =
+      xe::threading::Thread::Create({}, [this]() { SamplingThread(); });
+  assert_not_null(thread_);
+  thread_->set_name("Guest Sampling Profiler");
+}
+
+void SamplingProfiler::Stop() {
+  if (!thread_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    thread_shutdown_ = true;
+  }
+  thread_cond_.notify_all();
+  xe::threading::Wait(thread_.get(), false);
+  thread_.reset();
+}
+
+void SamplingProfiler::Reset() {
+  std::lock_guard<std::mutex> lock(samples_mutex_);
+  sample_count_ = 0;
+  functions_.clear();
+  instructions_.clear();
+  stacks_.clear();
+}
+
+void SamplingProfiler::SamplingThread() {
+  auto interval = std::chrono::milliseconds(
+      std::max(cvars::sampling_profiler_interval_ms, uint32_t(1)));
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(thread_mutex_);
+      if (thread_cond_.wait_for(lock, interval,
+                                [this]() { return thread_shutdown_; })) {
+        break;
+      }
+    }
+    processor_->CaptureGuestThreadStacks(
+        [this](const StackFrame* frames, size_t frame_count) {
+          AddSample(frames, frame_count);
+        });
+    COUNT_profile_set("cpu/reservation_contention",
+                      processor_->backend()->GetReservationContentionCount());
+  }
+}
+
+void SamplingProfiler::AddSample(const StackFrame* frames,
+                                 size_t frame_count) {
+  std::lock_guard<std::mutex> lock(samples_mutex_);
+  stack_scratch_.clear();
+  for (size_t i = 0; i < frame_count; ++i) {
+    const StackFrame& frame = frames[i];
+    if (frame.type != StackFrame::Type::kGuest ||
+        !frame.guest_symbol.function) {
+      continue;
+    }
+    uint32_t function_address = frame.guest_symbol.function->address();
+    if (stack_scratch_.empty()) {
+      // Innermost guest frame.
+      FunctionSamples& function = functions_[function_address];
+      function.guest_address = function_address;
+      ++function.self_count;
+      if (frame.guest_pc) {
+        ++instructions_[function_address][frame.guest_pc];
+      }
+    }
+    // Count recursive functions once per stack.
+    if (std::find(stack_scratch_.cbegin(), stack_scratch_.cend(),
+                  function_address) == stack_scratch_.cend()) {
+      FunctionSamples& function = functions_[function_address];
+      function.guest_address = function_address;
+      ++function.total_count;
+    }
+    stack_scratch_.push_back(function_address);
+  }
+  if (stack_scratch_.empty()) {
+    // Not running guest code, such as waiting in the kernel.
+    return;
+  }
+  ++sample_count_;
+  ++stacks_[stack_scratch_];
+}
+
+uint64_t SamplingProfiler::sample_count() const {
+  std::lock_guard<std::mutex> lock(samples_mutex_);
+  return sample_count_;
+}
+
+std::vector<SamplingProfiler::FunctionSamples>
+SamplingProfiler::GetFunctionSamples() const {
+  std::vector<FunctionSamples> functions;
+  {
+    std::lock_guard<std::mutex> lock(samples_mutex_);
+    functions.reserve(functions_.size());
+    for (const auto& it : functions_) {
+      functions.push_back(it.second);
+    }
+  }
+  std::sort(functions.begin(), functions.end(),
+            [](const FunctionSamples& a, const FunctionSamples& b) {
+              if (a.self_count != b.self_count) {
+                return a.self_count > b.self_count;
+              }
+              return a.total_count > b.total_count;
+            });
+  return functions;
+}
+
+std::vector<std::pair<uint32_t, uint64_t>>
+SamplingProfiler::GetInstructionSamples(uint32_t function_address) const {
+  std::vector<std::pair<uint32_t, uint64_t>> instructions;
+  {
+    std::lock_guard<std::mutex> lock(samples_mutex_);
+    auto it = instructions_.find(function_address);
+    if (it != instructions_.end()) {
+      instructions.assign(it->second.cbegin(), it->second.cend());
+    }
+  }
+  std::sort(instructions.begin(), instructions.end());
+  return instructions;
+}
+
+std::string SamplingProfiler::GetFunctionName(uint32_t function_address) const {
+  Function* function = processor_->QueryFunction(function_address);
+  if (function && !function->name().empty()) {
+    return function->name();
+  }
+  return fmt::format("sub_{:08X}", function_address);
+}
+
+bool SamplingProfiler::ExportCollapsedStacks(
+    const std::filesystem::path& path) const {
+  FILE* file = xe::filesystem::OpenFile(path, "w");
+  if (!file) {
+    XELOGE("Failed to open {} for writing the sampled guest stacks",
+           xe::path_to_utf8(path));
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(samples_mutex_);
+  std::unordered_map<uint32_t, std::string> names;
+  std::string line;
+  for (const auto& stack : stacks_) {
+    line.clear();
+    for (auto it = stack.first.crbegin(); it != stack.first.crend(); ++it) {
+      auto name_it = names.find(*it);
+      if (name_it == names.end()) {
+        name_it = names.emplace(*it, GetFunctionName(*it)).first;
+      }
+      if (!line.empty()) {
+        line.push_back(';');
+      }
+      line.append(name_it->second);
+    }
+    fprintf(file, "%s %llu\n", line.c_str(),
+            static_cast<unsigned long long>(stack.second));
+  }
+  fclose(file);
+  XELOGI("Wrote {} sampled guest stacks to {}", sample_count_,
+         xe::path_to_utf8(path));
+  return true;
+}
+
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_SAMPLING_PROFILER_H_
+#define XENIA_CPU_SAMPLING_PROFILER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace cpu {
+
+class Processor;
+struct StackFrame;
+
+// Periodically interrupts the guest threads to capture their stacks, for
+// finding where guest time goes without instrumenting the generated code.
+// The host frames are mapped back to guest functions and instructions through
+// the code cache and the source maps of the functions.
+class SamplingProfiler {
+ public:
+  struct FunctionSamples {
+    uint32_t guest_address = 0;
+    // Samples with the function at the top of the guest stack.
+    uint64_t self_count = 0;
+    // Samples with the function anywhere in the guest stack.
+    uint64_t total_count = 0;
+  };
+
+  explicit SamplingProfiler(Processor* processor);
+  ~SamplingProfiler();
+
+  bool is_running() const { return thread_ != nullptr; }
+  void Start();
+  void Stop();
+  // Drops all the samples taken so far.
+  void Reset();
+
+  uint64_t sample_count() const;
+  // Sorted by the self sample count, highest first.
+  std::vector<FunctionSamples> GetFunctionSamples() const;
+  // Self sample counts of the instructions of the function, by guest address.
+  std::vector<std::pair<uint32_t, uint64_t>> GetInstructionSamples(
+      uint32_t function_address) const;
+  std::string GetFunctionName(uint32_t function_address) const;
+
+  // Writes the guest stacks in the collapsed format taken by flamegraph.pl and
+  // compatible tools: one line per distinct stack, outermost function first.
+  bool ExportCollapsedStacks(const std::filesystem::path& path) const;
+
+ private:
+  void SamplingThread();
+  void AddSample(const StackFrame* frames, size_t frame_count);
+
+  Processor* processor_;
+
+  std::mutex thread_mutex_;
+  std::condition_variable thread_cond_;
+  bool thread_shutdown_ = false;
+  std::unique_ptr<xe::threading::Thread> thread_;
+
+  mutable std::mutex samples_mutex_;
+  uint64_t sample_count_ = 0;
+  std::unordered_map<uint32_t, FunctionSamples> functions_;
+  // Function address to instruction address to count.
+  std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint64_t>>
+      instructions_;
+  // Guest function addresses of each stack, innermost first.
+  std::map<std::vector<uint32_t>, uint64_t> stacks_;
+  std::vector<uint32_t> stack_scratch_;
+};
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_SAMPLING_PROFILER_H_
@@ -0,0 +1,93 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/aes_cbc.h"
+
+#include <cstring>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace cpu {
+namespace test {
+
+// NIST SP 800-38A F.2.2, CBC-AES128.Decrypt.
+constexpr uint8_t kKey[16] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                              0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+constexpr uint8_t kIv[16] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                             0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+constexpr uint8_t kCiphertext[64] = {
+    0x76, 0x49, 0xAB, 0xAC, 0x81, 0x19, 0xB2, 0x46, 0xCE, 0xE9, 0x8E,
+    0x9B, 0x12, 0xE9, 0x19, 0x7D, 0x50, 0x86, 0xCB, 0x9B, 0x50, 0x72,
+    0x19, 0xEE, 0x95, 0xDB, 0x11, 0x3A, 0x91, 0x76, 0x78, 0xB2, 0x73,
+    0xBE, 0xD6, 0xB8, 0xE3, 0xC1, 0x74, 0x3B, 0x71, 0x16, 0xE6, 0x9E,
+    0x22, 0x22, 0x95, 0x16, 0x3F, 0xF1, 0xCA, 0xA1, 0x68, 0x1F, 0xAC,
+    0x09, 0x12, 0x0E, 0xCA, 0x30, 0x75, 0x86, 0xE1, 0xA7};
+constexpr uint8_t kPlaintext[64] = {
+    0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E,
+    0x11, 0x73, 0x93, 0x17, 0x2A, 0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03,
+    0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51, 0x30,
+    0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19,
+    0x1A, 0x0A, 0x52, 0xEF, 0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B,
+    0x17, 0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10};
+
+// The vector repeated, longer than the blocks decrypted at once, and the
+// plaintext it decrypts to with the zero initialization vector.
+void MakeRepeatedVector(size_t repeat_count, std::vector<uint8_t>& ciphertext,
+                        std::vector<uint8_t>& plaintext) {
+  ciphertext.clear();
+  plaintext.clear();
+  for (size_t i = 0; i < repeat_count; ++i) {
+    ciphertext.insert(ciphertext.end(), kCiphertext, kCiphertext + 64);
+    plaintext.insert(plaintext.end(), kPlaintext, kPlaintext + 64);
+    // The first block is chained to the initialization vector, or to the last
+    // block of the previous repetition.
+    for (size_t j = 0; j < 16; ++j) {
+      plaintext[i * 64 + j] ^= kIv[j] ^ (i ? kCiphertext[48 + j] : 0);
+    }
+  }
+}
+
+TEST_CASE("AES_CBC_DECRYPT", "[aes_cbc]") {
+  std::vector<uint8_t> ciphertext, plaintext;
+  MakeRepeatedVector(5, ciphertext, plaintext);
+  std::vector<uint8_t> output(ciphertext.size());
+  AesCbcDecryptor decryptor(kKey);
+  decryptor.Decrypt(ciphertext.data(), ciphertext.size(), output.data());
+  REQUIRE(output == plaintext);
+}
+
+TEST_CASE("AES_CBC_DECRYPT_IN_PLACE", "[aes_cbc]") {
+  std::vector<uint8_t> buffer, plaintext;
+  MakeRepeatedVector(5, buffer, plaintext);
+  aes_decrypt_buffer(kKey, buffer.data(), buffer.size(), buffer.data(),
+                     buffer.size());
+  REQUIRE(buffer == plaintext);
+}
+
+TEST_CASE("AES_CBC_DECRYPT_CHUNKED", "[aes_cbc]") {
+  std::vector<uint8_t> ciphertext, plaintext;
+  MakeRepeatedVector(5, ciphertext, plaintext);
+  std::vector<uint8_t> output(ciphertext.size());
+  AesCbcDecryptor decryptor(kKey);
+  // The chaining continues across the calls.
+  size_t offset = 0;
+  for (size_t block_count : {1, 3, 9, 2, 5}) {
+    decryptor.Decrypt(ciphertext.data() + offset, block_count * 16,
+                      output.data() + offset);
+    offset += block_count * 16;
+  }
+  REQUIRE(offset == ciphertext.size());
+  REQUIRE(output == plaintext);
+}
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace xe
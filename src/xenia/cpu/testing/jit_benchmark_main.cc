@@ -0,0 +1,491 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/platform.h"
+#include "xenia/cpu/hir/hir_builder.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+#include "xenia/cpu/processor.h"
+#include "xenia/cpu/test_module.h"
+#include "xenia/cpu/thread_state.h"
+#include "xenia/memory.h"
+
+#if XE_ARCH_AMD64
+#include "xenia/base/platform_amd64.h"
+#include "xenia/cpu/backend/x64/x64_backend.h"
+#endif  // XE_ARCH
+
+DEFINE_transient_string(benchmark_filter, "",
+                        "Only run the benchmarks with names containing this.",
+                        "General");
+DEFINE_string(benchmark_tier, "",
+              "Only run the instruction set tier with this name (avx, avx2, "
+              "bmi2, movbe, gfni, avx512 or all).",
+              "Other");
+DEFINE_uint32(benchmark_iterations, 100000,
+              "Number of calls of the generated function per measurement.",
+              "Other");
+DEFINE_path(benchmark_output_path, "",
+            "CSV file to write the results to, for comparing against a "
+            "baseline.",
+            "Other");
+
+namespace xe {
+namespace cpu {
+namespace benchmark {
+
+using namespace xe::cpu::hir;
+using xe::cpu::ppc::PPCContext;
+
+#if XE_ARCH_AMD64
+
+using namespace xe::amd64;
+
+constexpr uint32_t kFunctionAddress = 0x80000000;
+constexpr uint32_t kBufferAddress = 0x10000000;
+constexpr uint32_t kBufferSize = 0x10000;
+
+// Each benchmark is emitted as a dependent chain of the same sequence, with
+// two chain lengths. The difference between the two removes the cost of the
+// call and of the context loads and stores around the chain.
+constexpr uint32_t kShortChainLength = 8;
+constexpr uint32_t kLongChainLength = 72;
+
+struct Benchmark {
+  const char* name;
+  // Type of the value carried through the chain.
+  TypeName type;
+  // Type of the second operand, loaded once before the chain.
+  TypeName operand_type;
+  // Emits one link of the chain. address is a guest pointer to a scratch
+  // buffer for the memory sequences.
+  std::function<Value*(HIRBuilder& b, Value* value, Value* operand,
+                       Value* address)>
+      emit;
+};
+
+size_t GetContextOffset(TypeName type, uint32_t index) {
+  switch (type) {
+    case FLOAT32_TYPE:
+    case FLOAT64_TYPE:
+      return offsetof(PPCContext, f) + (1 + index) * 8;
+    case VEC128_TYPE:
+      return offsetof(PPCContext, v) + (1 + index) * 16;
+    default:
+      return offsetof(PPCContext, r) + (3 + index) * 8;
+  }
+}
+
+const std::vector<Benchmark>& GetBenchmarks() {
+  static const std::vector<Benchmark> benchmarks = {
+      // Integer opcodes.
+      {"add_i64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Add(v, y); }},
+      {"sub_i64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Sub(v, y); }},
+      {"mul_i64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Mul(v, y); }},
+      {"mul_hi_u64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.MulHi(v, y, ARITHMETIC_UNSIGNED);
+       }},
+      {"div_u64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.Div(v, y, ARITHMETIC_UNSIGNED);
+       }},
+      {"div_i32", INT32_TYPE, INT32_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Div(v, y); }},
+      {"and_i64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.And(v, y); }},
+      {"xor_i64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Xor(v, y); }},
+      {"not_i64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) { return b.Not(v); }},
+      {"neg_i64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) { return b.Neg(v); }},
+      {"shl_i64", INT64_TYPE, INT8_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Shl(v, y); }},
+      {"shr_i64", INT64_TYPE, INT8_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Shr(v, y); }},
+      {"sha_i64", INT64_TYPE, INT8_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Sha(v, y); }},
+      {"rotate_left_i32", INT32_TYPE, INT8_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.RotateLeft(v, y);
+       }},
+      {"byte_swap_i32", INT32_TYPE, INT32_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) { return b.ByteSwap(v); }},
+      {"count_leading_zeros_i64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) {
+         return b.ZeroExtend(b.CountLeadingZeros(v), INT64_TYPE);
+       }},
+      {"select_i64", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.Select(b.CompareULT(v, y), y, b.Sub(v, y));
+       }},
+
+      // Common PPC idioms.
+      {"ppc_rlwinm", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) {
+         Value* rotated =
+             b.RotateLeft(b.Truncate(v, INT32_TYPE), b.LoadConstantInt8(5));
+         return b.ZeroExtend(
+             b.And(rotated, b.LoadConstantUint32(0x0FFFFFF0)), INT64_TYPE);
+       }},
+      {"ppc_extsw", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.SignExtend(b.Truncate(b.Add(v, y), INT32_TYPE), INT64_TYPE);
+       }},
+      {"ppc_lwz", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value* address) {
+         return b.Add(v, b.ZeroExtend(b.ByteSwap(b.Load(address, INT32_TYPE)),
+                                      INT64_TYPE));
+       }},
+      {"ppc_ld", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value* address) {
+         return b.Add(v, b.ByteSwap(b.Load(address, INT64_TYPE)));
+       }},
+      {"ppc_stw", INT64_TYPE, INT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value* address) {
+         b.Store(address, b.ByteSwap(b.Truncate(v, INT32_TYPE)));
+         return b.Add(v, y);
+       }},
+      {"ppc_lvx", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value* address) {
+         return b.VectorAdd(v, b.ByteSwap(b.Load(address, VEC128_TYPE)),
+                            INT32_TYPE);
+       }},
+      {"ppc_stvx", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value* address) {
+         b.Store(address, b.ByteSwap(v));
+         return b.VectorAdd(v, y, INT32_TYPE);
+       }},
+      {"ppc_frsp", FLOAT64_TYPE, FLOAT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.ToSingle(b.Add(v, y));
+       }},
+      {"ppc_fctidz_fcfid", FLOAT64_TYPE, FLOAT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) {
+         return b.Convert(b.Convert(v, INT64_TYPE), FLOAT64_TYPE);
+       }},
+
+      // Scalar floating point opcodes.
+      {"add_f64", FLOAT64_TYPE, FLOAT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Add(v, y); }},
+      {"mul_f64", FLOAT64_TYPE, FLOAT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Mul(v, y); }},
+      {"div_f64", FLOAT64_TYPE, FLOAT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) { return b.Div(v, y); }},
+      {"mul_add_f64", FLOAT64_TYPE, FLOAT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.MulAdd(v, y, y);
+       }},
+      {"sqrt_f64", FLOAT64_TYPE, FLOAT64_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) { return b.Sqrt(v); }},
+
+      // Vector opcodes.
+      {"vector_add_f32", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.VectorAdd(v, y, FLOAT32_TYPE);
+       }},
+      {"vector_add_i32_sat", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.VectorAdd(v, y, INT32_TYPE, ARITHMETIC_SATURATE);
+       }},
+      {"vector_mul_add_f32", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.MulAdd(v, y, y);
+       }},
+      {"vector_max_f32", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.VectorMax(v, y, FLOAT32_TYPE);
+       }},
+      {"dot_product_4", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.DotProduct4(v, y);
+       }},
+      {"rsqrt_v128", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) { return b.RSqrt(v); }},
+      {"vector_shl_i8", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.VectorShl(v, y, INT8_TYPE);
+       }},
+      {"vector_shl_i8_constant", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) {
+         return b.VectorShl(v, b.LoadConstantVec128(vec128b(3)), INT8_TYPE);
+       }},
+      {"vector_sha_i8_constant", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) {
+         return b.VectorSha(v, b.LoadConstantVec128(vec128b(3)), INT8_TYPE);
+       }},
+      {"vector_sha_i16", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.VectorSha(v, y, INT16_TYPE);
+       }},
+      {"vector_rotate_left_i32", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.VectorRotateLeft(v, y, INT32_TYPE);
+       }},
+      {"vector_compare_eq_i32", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.Xor(b.VectorCompareEQ(v, y, INT32_TYPE), y);
+       }},
+      {"vector_convert_i2f_f2i", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) {
+         return b.VectorConvertF2I(b.VectorConvertI2F(v));
+       }},
+      {"permute_i8", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value* y, Value*) {
+         return b.Permute(y, v, y, INT8_TYPE);
+       }},
+      {"swizzle_i32", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) {
+         return b.Swizzle(v, INT32_TYPE, SWIZZLE_XYZW_TO_YZWX);
+       }},
+      {"pack_d3dcolor", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) {
+         return b.Pack(v, PACK_TYPE_D3DCOLOR);
+       }},
+      {"unpack_float16_4", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) {
+         return b.Unpack(v, PACK_TYPE_FLOAT16_4);
+       }},
+      {"byte_swap_v128", VEC128_TYPE, VEC128_TYPE,
+       [](HIRBuilder& b, Value* v, Value*, Value*) { return b.ByteSwap(v); }},
+  };
+  return benchmarks;
+}
+
+struct Tier {
+  const char* name;
+  int64_t extension_mask;
+};
+
+// Each tier adds to the previous one, so a regression shows up in the tier
+// that enables the sequence.
+const Tier kTiers[] = {
+    {"avx", 0},
+    {"avx2", kX64EmitAVX2 | kX64EmitFMA | kX64EmitLZCNT | kX64EmitBMI1},
+    {"bmi2", kX64EmitAVX2 | kX64EmitFMA | kX64EmitLZCNT | kX64EmitBMI1 |
+                 kX64EmitBMI2},
+    {"movbe", kX64EmitAVX2 | kX64EmitFMA | kX64EmitLZCNT | kX64EmitBMI1 |
+                  kX64EmitBMI2 | kX64EmitMovbe},
+    {"gfni", kX64EmitAVX2 | kX64EmitFMA | kX64EmitLZCNT | kX64EmitBMI1 |
+                 kX64EmitBMI2 | kX64EmitMovbe | kX64EmitGFNI},
+    {"avx512", kX64EmitAVX2 | kX64EmitFMA | kX64EmitLZCNT | kX64EmitBMI1 |
+                   kX64EmitBMI2 | kX64EmitMovbe | kX64EmitGFNI |
+                   kX64EmitAVX512F | kX64EmitAVX512VL | kX64EmitAVX512BW |
+                   kX64EmitAVX512DQ | kX64EmitAVX512VBMI},
+    {"all", -1LL},
+};
+
+struct Result {
+  double ns_per_op;
+  double bytes_per_op;
+  size_t code_size;
+};
+
+class BenchmarkRunner {
+ public:
+  bool Setup() {
+    memory_ = std::make_unique<Memory>();
+    if (!memory_->Initialize()) {
+      XELOGE("Failed to initialize the guest memory");
+      return false;
+    }
+    memory_->LookupHeap(kBufferAddress)
+        ->AllocFixed(kBufferAddress, kBufferSize, 0,
+                     kMemoryAllocationReserve | kMemoryAllocationCommit,
+                     kMemoryProtectRead | kMemoryProtectWrite);
+
+    processor_ = std::make_unique<Processor>(memory_.get(), nullptr);
+    if (!processor_->Setup(std::make_unique<backend::x64::X64Backend>())) {
+      XELOGE("Failed to set up the processor");
+      return false;
+    }
+    thread_state_ = std::make_unique<ThreadState>(processor_.get(), 0x100);
+    return true;
+  }
+
+  bool Run(const Benchmark& benchmark, Result& result) {
+    auto short_function = Define(benchmark, kShortChainLength);
+    auto long_function = Define(benchmark, kLongChainLength);
+    if (!short_function || !long_function) {
+      return false;
+    }
+    double short_ns = Measure(short_function);
+    double long_ns = Measure(long_function);
+    uint32_t chain_difference = kLongChainLength - kShortChainLength;
+    result.ns_per_op = std::max(long_ns - short_ns, 0.0) / chain_difference;
+    result.code_size = long_function->machine_code_length();
+    result.bytes_per_op =
+        (double(long_function->machine_code_length()) -
+         double(short_function->machine_code_length())) /
+        chain_difference;
+    return true;
+  }
+
+ private:
+  GuestFunction* Define(const Benchmark& benchmark, uint32_t chain_length) {
+    uint32_t address = next_address_;
+    next_address_ += 4;
+    auto module = std::make_unique<TestModule>(
+        processor_.get(), benchmark.name,
+        [address](uint32_t query) { return query == address; },
+        [&benchmark, chain_length](HIRBuilder& b) {
+          Value* value = b.LoadContext(GetContextOffset(benchmark.type, 0),
+                                       benchmark.type);
+          Value* operand =
+              b.LoadContext(GetContextOffset(benchmark.operand_type, 1),
+                            benchmark.operand_type);
+          Value* buffer_address =
+              b.LoadContext(offsetof(PPCContext, r) + 5 * 8, INT64_TYPE);
+          for (uint32_t i = 0; i < chain_length; ++i) {
+            value = benchmark.emit(b, value, operand, buffer_address);
+          }
+          b.StoreContext(GetContextOffset(benchmark.type, 0), value);
+          b.Return();
+          return true;
+        });
+    processor_->AddModule(std::move(module));
+    processor_->backend()->CommitExecutableRange(address, address + 4);
+    auto function =
+        static_cast<GuestFunction*>(processor_->ResolveFunction(address));
+    if (!function) {
+      XELOGE("Failed to generate {} with a chain of {}", benchmark.name,
+             chain_length);
+    }
+    return function;
+  }
+
+  void ResetContext() {
+    PPCContext* ctx = thread_state_->context();
+    ctx->r[3] = 0x0123456789ABCDEFull;
+    ctx->r[4] = 1;
+    ctx->r[5] = kBufferAddress;
+    ctx->f[1] = 1.5;
+    ctx->f[2] = 1.0000001;
+    ctx->v[1] = vec128f(1.5f);
+    ctx->v[2] = vec128f(1.0000001f);
+    ctx->lr = 0xBCBCBCBC;
+  }
+
+  // Returns the nanoseconds per call.
+  double Measure(GuestFunction* function) {
+    ResetContext();
+    // Warm up the caches and the branch predictors.
+    for (uint32_t i = 0; i < 1000; ++i) {
+      function->Call(thread_state_.get(), 0xBCBCBCBC);
+    }
+    ResetContext();
+    uint32_t iterations = std::max(cvars::benchmark_iterations, uint32_t(1));
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+      function->Call(thread_state_.get(), 0xBCBCBCBC);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           iterations;
+  }
+
+  std::unique_ptr<Memory> memory_;
+  std::unique_ptr<Processor> processor_;
+  std::unique_ptr<ThreadState> thread_state_;
+  uint32_t next_address_ = kFunctionAddress;
+};
+
+int main(const std::vector<std::string>& args) {
+  FILE* output = nullptr;
+  if (!cvars::benchmark_output_path.empty()) {
+    output = xe::filesystem::OpenFile(cvars::benchmark_output_path, "w");
+    if (!output) {
+      XELOGE("Failed to open {} for writing the results",
+             xe::path_to_utf8(cvars::benchmark_output_path));
+      return 1;
+    }
+    fprintf(output, "tier,benchmark,ns_per_op,bytes_per_op,code_size\n");
+  }
+
+  bool failed = false;
+  for (const Tier& tier : kTiers) {
+    if (!cvars::benchmark_tier.empty() && cvars::benchmark_tier != tier.name) {
+      continue;
+    }
+    // The emitter takes the features from the global flags, detected again
+    // for each tier.
+    cvars::x64_extension_mask = tier.extension_mask;
+    amd64::InitFeatureFlags();
+    uint64_t feature_flags = amd64::GetFeatureFlags();
+    if (tier.extension_mask != -1LL &&
+        (feature_flags & uint64_t(tier.extension_mask)) !=
+            uint64_t(tier.extension_mask)) {
+      XELOGI("Skipping the {} tier, not supported by the host", tier.name);
+      continue;
+    }
+    XELOGI("Tier {} (features {:X}):", tier.name, feature_flags);
+
+    BenchmarkRunner runner;
+    if (!runner.Setup()) {
+      failed = true;
+      break;
+    }
+    for (const Benchmark& benchmark : GetBenchmarks()) {
+      if (!cvars::benchmark_filter.empty() &&
+          std::string_view(benchmark.name).find(cvars::benchmark_filter) ==
+              std::string_view::npos) {
+        continue;
+      }
+      Result result;
+      if (!runner.Run(benchmark, result)) {
+        failed = true;
+        continue;
+      }
+      XELOGI("  {:<28} {:8.3f} ns/op {:7.2f} bytes/op ({} bytes)",
+             benchmark.name, result.ns_per_op, result.bytes_per_op,
+             result.code_size);
+      if (output) {
+        fprintf(output, "%s,%s,%.4f,%.2f,%zu\n", tier.name, benchmark.name,
+                result.ns_per_op, result.bytes_per_op, result.code_size);
+      }
+    }
+  }
+
+  if (output) {
+    fclose(output);
+  }
+  return failed ? 1 : 0;
+}
+
+#else
+
+int main(const std::vector<std::string>& args) {
+  XELOGE("The JIT benchmarks need the x64 backend");
+  return 1;
+}
+
+#endif  // XE_ARCH_AMD64
+
+}  // namespace benchmark
+}  // namespace cpu
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-cpu-jit-benchmarks", xe::cpu::benchmark::main,
+                      "[benchmark filter]", "benchmark_filter");
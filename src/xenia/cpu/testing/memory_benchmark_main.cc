@@ -0,0 +1,380 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/literals.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/mutex.h"
+#include "xenia/memory.h"
+
+DEFINE_transient_string(benchmark_filter, "",
+                        "Only run the benchmarks with names containing this.",
+                        "General");
+DEFINE_uint32(benchmark_iterations, 100000,
+              "Number of operations per benchmark, fewer for the ones working "
+              "on large allocations.",
+              "Other");
+DEFINE_path(benchmark_output_path, "",
+            "CSV file to write the results to, for comparing against a "
+            "baseline.",
+            "Other");
+
+namespace xe {
+namespace memory_benchmark {
+
+using namespace xe::literals;
+
+constexpr uint32_t kReadWrite = kMemoryProtectRead | kMemoryProtectWrite;
+constexpr uint32_t kReserveCommit =
+    kMemoryAllocationReserve | kMemoryAllocationCommit;
+constexpr uint32_t kSmallPage = uint32_t(4_KiB);
+constexpr uint32_t kLargePage = uint32_t(64_KiB);
+// Of the ranges the protection and the watch benchmarks work on.
+constexpr uint32_t kRangeSize = uint32_t(16_MiB);
+constexpr uint32_t kRangeSmallPages = kRangeSize / kSmallPage;
+
+// Returns the number of operations done, each benchmark runs on a new guest
+// memory with the same random sequence for the results to be comparable.
+using BenchmarkFunction =
+    std::function<uint64_t(Memory& memory, std::mt19937& random,
+                           uint32_t iterations)>;
+
+struct Benchmark {
+  const char* name;
+  // Of benchmark_iterations, for the operations much slower than the others.
+  uint32_t iteration_divisor;
+  BenchmarkFunction run;
+};
+
+// Allocation sizes resembling those of title heaps: mostly small blocks, some
+// buffers, and rare large resources.
+uint32_t RandomTitleAllocationSize(std::mt19937& random) {
+  uint32_t kind = random() % 100;
+  if (kind < 70) {
+    return kSmallPage * (1 + random() % 4);
+  }
+  if (kind < 95) {
+    return kLargePage * (1 + random() % 4);
+  }
+  return uint32_t(1_MiB) * (1 + random() % 4);
+}
+
+// Keeps up to max_live allocations from the heap, releasing a random one half
+// of the time, which fragments the heap like a long-running title does.
+uint64_t RunRandomChurn(BaseHeap& heap, std::mt19937& random,
+                        uint32_t iterations, size_t max_live,
+                        const std::function<uint32_t()>& size_function) {
+  std::vector<uint32_t> live;
+  live.reserve(max_live);
+  uint64_t operations = 0;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    if (!live.empty() && (live.size() >= max_live || random() % 2)) {
+      size_t index = random() % live.size();
+      heap.Release(live[index]);
+      live[index] = live.back();
+      live.pop_back();
+    } else {
+      uint32_t address;
+      if (heap.Alloc(size_function(), 0, kReserveCommit, kReadWrite,
+                     random() % 8 == 0, &address)) {
+        live.push_back(address);
+      }
+    }
+    ++operations;
+  }
+  for (uint32_t address : live) {
+    heap.Release(address);
+  }
+  return operations;
+}
+
+using CopyAndSwapFunction = void (*)(void* dest, const void* src,
+                                     size_t count);
+
+// Swaps a host buffer of the size, one operation per copy. The offset is for
+// the unaligned case, most guest data isn't aligned to the vector size.
+uint64_t RunCopyAndSwap(uint32_t iterations, size_t size_bytes,
+                        size_t element_size, size_t offset,
+                        CopyAndSwapFunction copy_and_swap) {
+  std::vector<uint8_t> source(size_bytes + offset, 0x5A);
+  std::vector<uint8_t> destination(size_bytes + offset);
+  for (uint32_t i = 0; i < iterations; ++i) {
+    copy_and_swap(destination.data() + offset, source.data() + offset,
+                  size_bytes / element_size);
+  }
+  return uint64_t(iterations);
+}
+
+std::pair<uint32_t, uint32_t> BenchmarkInvalidationCallback(
+    void* context, uint32_t physical_address_start, uint32_t length,
+    bool exact_range) {
+  ++*static_cast<uint64_t*>(context);
+  return std::make_pair(uint32_t(0), UINT32_MAX);
+}
+
+const std::vector<Benchmark>& GetBenchmarks() {
+  static const std::vector<Benchmark> benchmarks = {
+      {"virtual_4k_title_churn", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         return RunRandomChurn(
+             *memory.LookupHeap(0x00000000), random, iterations, 512,
+             [&random]() { return RandomTitleAllocationSize(random); });
+       }},
+      {"virtual_64k_large_churn", 10,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         return RunRandomChurn(
+             *memory.LookupHeap(0x40000000), random, iterations, 32,
+             [&random]() { return uint32_t(1_MiB) * (1 + random() % 32); });
+       }},
+      {"virtual_4k_lifo", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         // Frame allocators freeing in the reverse order.
+         BaseHeap& heap = *memory.LookupHeap(0x00000000);
+         std::vector<uint32_t> live;
+         uint64_t operations = 0;
+         while (operations < iterations) {
+           for (uint32_t i = 0; i < 64; ++i) {
+             uint32_t address;
+             if (heap.Alloc(kSmallPage * (1 + random() % 16), 0,
+                            kReserveCommit, kReadWrite, false, &address)) {
+               live.push_back(address);
+             }
+           }
+           for (auto it = live.crbegin(); it != live.crend(); ++it) {
+             heap.Release(*it);
+           }
+           operations += 64 + live.size();
+           live.clear();
+         }
+         return operations;
+       }},
+      {"physical_64k_churn", 10,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         // Also allocates from the parent physical heap.
+         return RunRandomChurn(
+             *memory.LookupHeapByType(true, kLargePage), random, iterations,
+             128, [&random]() { return kLargePage * (1 + random() % 32); });
+       }},
+      {"protect_churn", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         BaseHeap& heap = *memory.LookupHeap(0x00000000);
+         uint32_t base;
+         if (!heap.Alloc(kRangeSize, 0, kReserveCommit, kReadWrite, false,
+                         &base)) {
+           return uint64_t(0);
+         }
+         for (uint32_t i = 0; i < iterations; ++i) {
+           uint32_t page_count = 1 + random() % 16;
+           uint32_t page = random() % (kRangeSmallPages - page_count);
+           heap.Protect(base + page * kSmallPage, page_count * kSmallPage,
+                        (i & 1) ? kReadWrite : kMemoryProtectRead);
+         }
+         heap.Release(base);
+         return uint64_t(iterations);
+       }},
+      {"decommit_recommit", 2,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         BaseHeap& heap = *memory.LookupHeap(0x00000000);
+         uint32_t base;
+         if (!heap.Alloc(kRangeSize, 0, kReserveCommit, kReadWrite, false,
+                         &base)) {
+           return uint64_t(0);
+         }
+         for (uint32_t i = 0; i < iterations; ++i) {
+           uint32_t page_count = 1 + random() % 16;
+           uint32_t address =
+               base + random() % (kRangeSmallPages - page_count) * kSmallPage;
+           heap.Decommit(address, page_count * kSmallPage);
+           heap.AllocFixed(address, page_count * kSmallPage, 0,
+                           kMemoryAllocationCommit, kReadWrite);
+         }
+         heap.Release(base);
+         return uint64_t(iterations) * 2;
+       }},
+      {"access_callback_trigger", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         // Watching a range for the GPU, then the host writing to it.
+         BaseHeap& heap = *memory.LookupHeapByType(true, kSmallPage);
+         uint32_t base;
+         if (!heap.Alloc(kRangeSize, 0, kReserveCommit, kReadWrite, false,
+                         &base)) {
+           return uint64_t(0);
+         }
+         uint64_t invalidation_count = 0;
+         void* callback = memory.RegisterPhysicalMemoryInvalidationCallback(
+             BenchmarkInvalidationCallback, &invalidation_count);
+         for (uint32_t i = 0; i < iterations; ++i) {
+           uint32_t page_count = 1 + random() % 16;
+           uint32_t address =
+               base + random() % (kRangeSmallPages - page_count) * kSmallPage;
+           memory.EnablePhysicalMemoryAccessCallbacks(
+               memory.GetPhysicalAddress(address), page_count * kSmallPage,
+               true, false);
+           memory.TriggerPhysicalMemoryCallbacks(
+               xe::global_critical_region::AcquireDirect(), address,
+               page_count * kSmallPage, true, false);
+         }
+         memory.UnregisterPhysicalMemoryInvalidationCallback(callback);
+         heap.Release(base);
+         if (invalidation_count != iterations) {
+           XELOGW("Expected {} invalidations, got {}", iterations,
+                  invalidation_count);
+         }
+         return uint64_t(iterations) * 2;
+       }},
+      {"prepare_host_write_unwatched", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         BaseHeap& heap = *memory.LookupHeapByType(true, kSmallPage);
+         uint32_t base;
+         if (!heap.Alloc(kRangeSize, 0, kReserveCommit, kReadWrite, false,
+                         &base)) {
+           return uint64_t(0);
+         }
+         for (uint32_t i = 0; i < iterations; ++i) {
+           memory.PrepareHostWrite(
+               base + random() % (kRangeSize / kLargePage) * kLargePage,
+               kLargePage);
+         }
+         heap.Release(base);
+         return uint64_t(iterations);
+       }},
+      {"translate_virtual", 10,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         std::vector<uint32_t> addresses(4096);
+         for (uint32_t& address : addresses) {
+           address = uint32_t(random()) & ~uint32_t(3);
+         }
+         uintptr_t sum = 0;
+         uint64_t operations = 0;
+         for (uint32_t i = 0; i < iterations; ++i) {
+           for (uint32_t address : addresses) {
+             sum += reinterpret_cast<uintptr_t>(
+                 memory.TranslateVirtual(address));
+           }
+           operations += addresses.size();
+         }
+         // Keeps the loop from being optimized out.
+         static volatile uintptr_t sink;
+         sink = sum;
+         return operations;
+       }},
+      {"copy_and_swap_16_4k", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         return RunCopyAndSwap(iterations, kSmallPage, sizeof(uint16_t), 0,
+                               xe::copy_and_swap_16_unaligned);
+       }},
+      {"copy_and_swap_32_4k", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         return RunCopyAndSwap(iterations, kSmallPage, sizeof(uint32_t), 0,
+                               xe::copy_and_swap_32_unaligned);
+       }},
+      {"copy_and_swap_32_4k_unaligned", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         return RunCopyAndSwap(iterations, kSmallPage, sizeof(uint32_t), 4,
+                               xe::copy_and_swap_32_unaligned);
+       }},
+      {"copy_and_swap_64_4k", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         return RunCopyAndSwap(iterations, kSmallPage, sizeof(uint64_t), 0,
+                               xe::copy_and_swap_64_unaligned);
+       }},
+      {"copy_and_swap_16_in_32_4k", 1,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         return RunCopyAndSwap(iterations, kSmallPage, sizeof(uint32_t), 0,
+                               xe::copy_and_swap_16_in_32_unaligned);
+       }},
+      {"copy_and_swap_32_16m", 1000,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         return RunCopyAndSwap(iterations, kRangeSize, sizeof(uint32_t), 0,
+                               xe::copy_and_swap_32_unaligned);
+       }},
+#if XE_ARCH_AMD64 == 1
+      {"copy_and_swap_32_16m_nontemporal", 1000,
+       [](Memory& memory, std::mt19937& random, uint32_t iterations) {
+         return RunCopyAndSwap(iterations, kRangeSize, sizeof(uint32_t), 0,
+                               xe::copy_and_swap_32_nontemporal);
+       }},
+#endif  // XE_ARCH_AMD64
+  };
+  return benchmarks;
+}
+
+int main(const std::vector<std::string>& args) {
+  FILE* output = nullptr;
+  if (!cvars::benchmark_output_path.empty()) {
+    output = xe::filesystem::OpenFile(cvars::benchmark_output_path, "w");
+    if (!output) {
+      XELOGE("Failed to open {} for writing the results",
+             xe::path_to_utf8(cvars::benchmark_output_path));
+      return 1;
+    }
+    fprintf(output, "benchmark,operations,ns_per_op\n");
+  }
+
+  bool failed = false;
+  for (const Benchmark& benchmark : GetBenchmarks()) {
+    if (!cvars::benchmark_filter.empty() &&
+        std::string_view(benchmark.name).find(cvars::benchmark_filter) ==
+            std::string_view::npos) {
+      continue;
+    }
+    auto memory = std::make_unique<Memory>();
+    if (!memory->Initialize()) {
+      XELOGE("Failed to initialize the guest memory");
+      failed = true;
+      break;
+    }
+    std::mt19937 random(0x58454E41);
+    uint32_t iterations =
+        std::max(cvars::benchmark_iterations / benchmark.iteration_divisor,
+                 uint32_t(1));
+    auto start = std::chrono::steady_clock::now();
+    uint64_t operations = benchmark.run(*memory, random, iterations);
+    auto end = std::chrono::steady_clock::now();
+    if (!operations) {
+      XELOGE("Benchmark {} failed", benchmark.name);
+      failed = true;
+      continue;
+    }
+    double ns_per_op =
+        std::chrono::duration<double, std::nano>(end - start).count() /
+        double(operations);
+    XELOGI("  {:<30} {:10.2f} ns/op ({} operations)", benchmark.name,
+           ns_per_op, operations);
+    if (output) {
+      fprintf(output, "%s,%llu,%.4f\n", benchmark.name,
+              static_cast<unsigned long long>(operations), ns_per_op);
+    }
+  }
+
+  if (output) {
+    fclose(output);
+  }
+  return failed ? 1 : 0;
+}
+
+}  // namespace memory_benchmark
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-memory-benchmarks", xe::memory_benchmark::main,
+                      "[benchmark filter]", "benchmark_filter");
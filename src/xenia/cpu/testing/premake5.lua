@@ -25,3 +25,51 @@ test_suite("xenia-cpu-tests", project_root, ".", {
     }
   },
 })
+
+group("tests")
+project("xenia-cpu-jit-benchmarks")
+  uuid("720c675f-6225-40f7-b8ac-96a73d5638af")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "capstone",
+    "fmt",
+    "imgui",
+    "xenia-base",
+    "xenia-core",
+    "xenia-cpu",
+    "xenia-gpu",
+    "xenia-kernel",
+    "xenia-ui", -- needed by xenia-base
+    "xenia-patcher",
+  })
+  files({
+    "jit_benchmark_main.cc",
+    "../../base/console_app_main_"..platform_suffix..".cc",
+  })
+  filter("architecture:x86_64")
+    links({
+      "xenia-cpu-backend-x64",
+    })
+
+group("tests")
+project("xenia-memory-benchmarks")
+  uuid("3b0d7c2e-5f4a-4c8e-9a61-2d7e8f1b6c43")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "capstone",
+    "fmt",
+    "imgui",
+    "xenia-base",
+    "xenia-core",
+    "xenia-cpu",
+    "xenia-gpu",
+    "xenia-kernel",
+    "xenia-ui", -- needed by xenia-base
+    "xenia-patcher",
+  })
+  files({
+    "memory_benchmark_main.cc",
+    "../../base/console_app_main_"..platform_suffix..".cc",
+  })
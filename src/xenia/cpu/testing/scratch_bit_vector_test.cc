@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/scratch_bit_vector.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace test {
+
+TEST_CASE("SCRATCH_BIT_VECTOR_FIND", "[scratch_bit_vector]") {
+  Arena arena;
+  ScratchBitVector bits(&arena, 200);
+  REQUIRE(bits.find_first() == -1);
+  REQUIRE(bits.find_first_unset() == 0);
+
+  bits.set(3);
+  bits.set(64);
+  bits.set(199);
+  REQUIRE(bits.test(64));
+  REQUIRE(!bits.test(65));
+  REQUIRE(bits.find_first() == 3);
+  REQUIRE(bits.find_next(3) == 64);
+  REQUIRE(bits.find_next(64) == 199);
+  REQUIRE(bits.find_next(199) == -1);
+
+  bits.reset(3);
+  REQUIRE(bits.find_first() == 64);
+  bits.reset();
+  REQUIRE(bits.find_first() == -1);
+}
+
+TEST_CASE("SCRATCH_BIT_VECTOR_UNSET", "[scratch_bit_vector]") {
+  Arena arena;
+  ScratchBitVector bits(&arena, 70);
+  for (size_t i = 0; i < 70; ++i) {
+    bits.set(i);
+  }
+  REQUIRE(bits.find_first_unset() == -1);
+  bits.reset(66);
+  REQUIRE(bits.find_first_unset() == 66);
+}
+
+TEST_CASE("SCRATCH_BIT_VECTOR_RANGE", "[scratch_bit_vector]") {
+  Arena arena;
+  ScratchBitVector bits(&arena, 100);
+  bits.set_all();
+  REQUIRE(bits.find_first_unset() == -1);
+  REQUIRE(bits.find_next(99) == -1);
+  bits.reset_range(60, 70);
+  REQUIRE(!bits.any_in_range(60, 70));
+  REQUIRE(bits.any_in_range(59, 61));
+  REQUIRE(bits.find_first_unset() == 60);
+  REQUIRE(bits.find_next(59) == 70);
+
+  ScratchBitVector copy(&arena, 100);
+  REQUIRE(!copy.equals(bits));
+  copy.assign(bits);
+  REQUIRE(copy.equals(bits));
+}
+
+TEST_CASE("SCRATCH_BIT_VECTOR_OR", "[scratch_bit_vector]") {
+  Arena arena;
+  ScratchBitVector* a = ScratchBitVector::Create(&arena, 130);
+  ScratchBitVector* b = ScratchBitVector::Create(&arena, 130);
+  a->set(1);
+  b->set(129);
+  *a |= *b;
+  REQUIRE(a->test(1));
+  REQUIRE(a->test(129));
+  REQUIRE(!b->test(1));
+}
+
+}  // namespace test
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
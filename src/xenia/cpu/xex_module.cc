@@ -10,17 +10,23 @@
 #include "xenia/cpu/xex_module.h"
 
 #include <algorithm>
+#include <cstdio>
+#include <system_error>
 
 #include "third_party/fmt/include/fmt/format.h"
 
 #include "xenia/base/byte_order.h"
 #include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
+#include "xenia/base/xxhash.h"
 
+#include "xenia/cpu/aes_cbc.h"
 #include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/export_resolver.h"
+#include "xenia/cpu/host_routines.h"
 #include "xenia/cpu/lzx.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/emulator.h"
@@ -28,8 +34,6 @@
 #include "xenia/kernel/xmodule.h"
 
 #include "third_party/crypto/TinySHA1.hpp"
-#include "third_party/crypto/rijndael-alg-fst.c"
-#include "third_party/crypto/rijndael-alg-fst.h"
 #include "third_party/pe/pe_image.h"
 #include "xenia/cpu/ppc/ppc_decode_data.h"
 #include "xenia/cpu/ppc/ppc_instr.h"
@@ -48,6 +52,25 @@ DEFINE_bool(
     "finding/stress testing with the JIT",
     "CPU");
 
+DEFINE_int32(
+    precompilation_threads, -1,
+    "Number of background tasks compiling the functions found by early "
+    "precompilation while the game is running, sharing the task scheduler "
+    "workers with the rest of the emulator. -1 for one per worker, 0 to "
+    "compile them on the loading thread before starting the game.",
+    "CPU");
+
+DEFINE_bool(precompile_known_functions, true,
+            "Compile the functions of a module called in previous runs, as "
+            "recorded in the info cache, in the background when the module is "
+            "loaded, instead of on the first call.",
+            "CPU");
+
+DEFINE_bool(cache_module_images, true,
+            "Store the decompressed images of LZX-compressed modules in the "
+            "cache to load them without decompressing the next time.",
+            "CPU");
+
 DECLARE_bool(allow_plugins);
 
 static const uint8_t xe_xex2_retail_key[16] = {
@@ -57,26 +80,6 @@ static const uint8_t xe_xex2_devkit_key[16] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
-void aes_decrypt_buffer(const uint8_t* session_key, const uint8_t* input_buffer,
-                        const size_t input_size, uint8_t* output_buffer,
-                        const size_t output_size) {
-  uint32_t rk[4 * (MAXNR + 1)];
-  uint8_t ivec[16] = {0};
-  int32_t Nr = rijndaelKeySetupDec(rk, session_key, 128);
-  const uint8_t* ct = input_buffer;
-  uint8_t* pt = output_buffer;
-  for (size_t n = 0; n < input_size; n += 16, ct += 16, pt += 16) {
-    // Decrypt 16 uint8_ts from input -> output.
-    rijndaelDecrypt(rk, Nr, ct, pt);
-    for (size_t i = 0; i < 16; i++) {
-      // XOR with previous.
-      pt[i] ^= ivec[i];
-      // Set previous.
-      ivec[i] = ct[i];
-    }
-  }
-}
-
 namespace xe {
 namespace cpu {
 
@@ -85,7 +88,7 @@ using xe::kernel::KernelState;
 XexModule::XexModule(Processor* processor, KernelState* kernel_state)
     : Module(processor), processor_(processor), kernel_state_(kernel_state) {}
 
-XexModule::~XexModule() {}
+XexModule::~XexModule() { ShutdownPrecompilation(); }
 
 bool XexModule::GetOptHeader(const xex2_header* header, xex2_header_keys key,
                              void** out_ptr) {
@@ -648,9 +651,8 @@ int XexModule::ReadImageBasicCompressed(const void* xex_addr,
   std::memset(buffer, 0, total_size);  // Quickly zero the contents.
   uint8_t* d = buffer;
 
-  uint32_t rk[4 * (MAXNR + 1)];
-  uint8_t ivec[16] = {0};
-  int32_t Nr = rijndaelKeySetupDec(rk, session_key_, 128);
+  // The chaining continues across the blocks.
+  AesCbcDecryptor decryptor(session_key_);
 
   for (size_t n = 0; n < block_count; n++) {
     const uint32_t data_size = comp_info.blocks[n].data_size;
@@ -664,20 +666,9 @@ int XexModule::ReadImageBasicCompressed(const void* xex_addr,
         }
         memcpy(d, p, data_size);
         break;
-      case XEX_ENCRYPTION_NORMAL: {
-        const uint8_t* ct = p;
-        uint8_t* pt = d;
-        for (size_t m = 0; m < data_size; m += 16, ct += 16, pt += 16) {
-          // Decrypt 16 uint8_ts from input -> output.
-          rijndaelDecrypt(rk, Nr, ct, pt);
-          for (size_t i = 0; i < 16; i++) {
-            // XOR with previous.
-            pt[i] ^= ivec[i];
-            // Set previous.
-            ivec[i] = ct[i];
-          }
-        }
-      } break;
+      case XEX_ENCRYPTION_NORMAL:
+        decryptor.Decrypt(p, data_size, d);
+        break;
       default:
         assert_always();
         return 1;
@@ -690,7 +681,109 @@ int XexModule::ReadImageBasicCompressed(const void* xex_addr,
   return 0;
 }
 
+namespace {
+
+constexpr uint32_t kCachedImageMagic = 0x43494D58;  // XMIC
+// Increment to invalidate all the cached images.
+constexpr uint32_t kCachedImageVersion = 1;
+
+struct CachedImageHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t image_size;
+  uint32_t reserved;
+  uint64_t image_hash;
+};
+
+}  // namespace
+
+std::filesystem::path XexModule::GetCachedImagePath(const void* xex_addr,
+                                                    size_t xex_length) const {
+  if (!cvars::cache_module_images) {
+    return std::filesystem::path();
+  }
+  const std::filesystem::path& cache_root =
+      kernel_state_->emulator()->cache_root();
+  if (cache_root.empty()) {
+    return std::filesystem::path();
+  }
+  // The same file is decrypted with either key, only one gives the image.
+  XXH128_hash_t file_hash =
+      XXH3_128bits_withSeed(xex_addr, xex_length, is_dev_kit_ ? 1 : 0);
+  return cache_root / "modules" /
+         fmt::format("{:016X}{:016X}.image", file_hash.high64,
+                     file_hash.low64);
+}
+
+bool XexModule::LoadCachedImage(const std::filesystem::path& path,
+                                uint32_t image_size) {
+  auto mapping = MappedMemory::Open(path, MappedMemory::Mode::kRead);
+  if (!mapping || mapping->size() != sizeof(CachedImageHeader) + image_size) {
+    return false;
+  }
+  CachedImageHeader header;
+  std::memcpy(&header, mapping->data(), sizeof(header));
+  if (header.magic != kCachedImageMagic ||
+      header.version != kCachedImageVersion ||
+      header.image_size != image_size) {
+    return false;
+  }
+  BaseHeap* heap = memory()->LookupHeap(base_address_);
+  if (!heap->AllocFixed(
+          base_address_, image_size, 4096,
+          xe::kMemoryAllocationReserve | xe::kMemoryAllocationCommit,
+          xe::kMemoryProtectRead | xe::kMemoryProtectWrite)) {
+    return false;
+  }
+  uint8_t* buffer = memory()->TranslateVirtual(base_address_);
+  std::memcpy(buffer, mapping->data() + sizeof(header), image_size);
+  // Checked after the copy so the file is read once.
+  if (XXH3_64bits(buffer, image_size) != header.image_hash) {
+    XELOGW("Discarding the damaged cached module image {}", path);
+    heap->Release(base_address_);
+    return false;
+  }
+  return true;
+}
+
+void XexModule::StoreCachedImage(const std::filesystem::path& path,
+                                 uint32_t image_size) const {
+  const uint8_t* buffer = memory()->TranslateVirtual(base_address_);
+  CachedImageHeader header = {};
+  header.magic = kCachedImageMagic;
+  header.version = kCachedImageVersion;
+  header.image_size = image_size;
+  header.image_hash = XXH3_64bits(buffer, image_size);
+
+  // Written to a temporary file first to never leave a partial image.
+  std::filesystem::path temp_path = path;
+  temp_path += ".tmp";
+  xe::filesystem::CreateParentFolder(temp_path);
+  FILE* file = xe::filesystem::OpenFile(temp_path, "wb");
+  if (!file) {
+    return;
+  }
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(buffer, 1, image_size, file) == image_size;
+  fclose(file);
+  std::error_code error;
+  if (written) {
+    std::filesystem::rename(temp_path, path, error);
+  }
+  if (!written || error) {
+    std::filesystem::remove(temp_path, error);
+    XELOGW("Failed to write the cached module image {}", path);
+  }
+}
+
 int XexModule::ReadImageCompressed(const void* xex_addr, size_t xex_length) {
+  std::filesystem::path cached_image_path =
+      GetCachedImagePath(xex_addr, xex_length);
+  if (!cached_image_path.empty() &&
+      LoadCachedImage(cached_image_path, image_size())) {
+    return 0;
+  }
+
   const uint32_t exe_length =
       static_cast<uint32_t>(xex_length - xex_header()->header_size);
   const uint8_t* exe_buffer =
@@ -796,6 +889,9 @@ int XexModule::ReadImageCompressed(const void* xex_addr, size_t xex_length) {
       result_code = lzx_decompress(
           compress_buffer, d - compress_buffer, buffer, uncompressed_size,
           compression_info->normal.window_size, nullptr, 0);
+      if (!result_code && !cached_image_path.empty()) {
+        StoreCachedImage(cached_image_path, uncompressed_size);
+      }
     } else {
       XELOGE("Unable to allocate XEX memory at {:08X}-{:08X}.", base_address_,
              uncompressed_size);
@@ -1126,26 +1222,15 @@ bool XexModule::LoadContinue() {
 }
 
 void XexModule::Precompile() {
-  sha1::SHA1 final_image_sha_;
-
-  final_image_sha_.reset();
-
-  unsigned high_code = this->high_address_ - this->low_address_;
-
-  final_image_sha_.processBytes(memory()->TranslateVirtual(this->low_address_),
-                                high_code);
-  final_image_sha_.finalize(image_sha_bytes_);
+  // Identifies the image for the caches. Not for verification, so a fast
+  // non-cryptographic hash is enough, about as fast as reading the memory.
+  XXH128_hash_t image_hash =
+      XXH3_128bits(memory()->TranslateVirtual(low_address_),
+                   high_address_ - low_address_);
+  image_hash_str_ =
+      fmt::format("{:016X}{:016X}", image_hash.high64, image_hash.low64);
 
-  char fmtbuf[20];
-
-  for (unsigned i = 0; i < 20; ++i) {
-#ifdef XE_PLATFORM_WIN32
-    sprintf_s(fmtbuf, "%X", image_sha_bytes_[i]);
-#else
-    snprintf(fmtbuf, sizeof(fmtbuf), "%X", image_sha_bytes_[i]);
-#endif
-    image_sha_str_ += &fmtbuf[0];
-  }
+  info_cache_.Init(this);
 
   // Find __savegprlr_* and __restgprlr_* and the others.
   // We can flag these for special handling (inlining/etc).
@@ -1153,7 +1238,10 @@ void XexModule::Precompile() {
     return;
   }
 
-  info_cache_.Init(this);
+  std::filesystem::path code_storage_path =
+      kernel_state_->emulator()->cache_root() / "modules" / image_hash_str_;
+  processor_->backend()->InitializeCodeStorage(this, code_storage_path);
+
   PrecompileDiscoveredFunctions();
 }
 bool XexModule::Unload() {
@@ -1162,6 +1250,8 @@ bool XexModule::Unload() {
   }
   loaded_ = false;
 
+  ShutdownPrecompilation();
+
   // If this isn't a patch, just deallocate the memory occupied by the exe
   if (!is_patch()) {
     assert_not_zero(base_address_);
@@ -1176,10 +1266,10 @@ bool XexModule::Unload() {
 
 bool XexModule::SetupLibraryImports(const std::string_view name,
                                     const xex2_import_library* library) {
-  ExportResolver* kernel_resolver = nullptr;
-  if (kernel_state_->IsKernelModule(name)) {
-    kernel_resolver = processor_->export_resolver();
-  }
+  bool is_kernel_module = kernel_state_->IsKernelModule(name);
+  const ExportResolver::Table* kernel_table =
+      is_kernel_module ? processor_->export_resolver()->GetTable(name)
+                       : nullptr;
 
   auto user_module = kernel_state_->GetModule(name);
 
@@ -1207,8 +1297,10 @@ bool XexModule::SetupLibraryImports(const std::string_view name,
     Export* kernel_export = nullptr;
     uint32_t user_export_addr = 0;
 
-    if (kernel_resolver) {
-      kernel_export = kernel_resolver->GetExportByOrdinal(name, ordinal);
+    if (is_kernel_module) {
+      if (kernel_table) {
+        kernel_export = kernel_table->GetExportByOrdinal(ordinal);
+      }
     } else if (user_module) {
       user_export_addr = user_module->GetProcAddressByOrdinal(ordinal);
     }
@@ -1372,9 +1464,10 @@ void XexInfoCache::Init(XexModule* xexmod) {
 
   infocache_path.append(L"modules");
 
-  infocache_path.append(xexmod->image_sha_str_);
+  infocache_path.append(xexmod->image_hash_str_);
 
   std::filesystem::create_directories(infocache_path);
+  mmio_access_sites_path_ = infocache_path / "mmio_access_sites.bin";
   infocache_path.append("executable_addr_flags.bin");
 
   unsigned num_codebytes = xexmod->high_address_ - xexmod->low_address_;
@@ -1413,8 +1506,80 @@ void XexInfoCache::Init(XexModule* xexmod) {
       this->executable_addr_flags_->Close();
       std::filesystem::remove(infocache_path);
       try_open();
+      if (!GetHeader()) {
+        return;
+      }
+      GetHeader()->version = CURRENT_INFOCACHE_VERSION;
+    }
+  }
+  LoadMMIOAccessSites(xexmod);
+}
+void XexInfoCache::LoadMMIOAccessSites(XexModule* xexmod) {
+  FILE* file = xe::filesystem::OpenFile(mmio_access_sites_path_, "rb");
+  if (!file) {
+    return;
+  }
+  uint32_t guest_addr;
+  uint32_t site_count = 0;
+  while (fread(&guest_addr, sizeof(guest_addr), 1, file) == 1) {
+    if (guest_addr < xexmod->low_address_ ||
+        guest_addr >= xexmod->high_address_) {
+      continue;
+    }
+    InfoCacheFlags* flags = LookupFlags(guest_addr - xexmod->low_address_);
+    if (flags) {
+      flags->accessed_mmio = true;
+      ++site_count;
     }
   }
+  fclose(file);
+  XELOGI("Loaded {} MMIO access sites from the infocache", site_count);
+}
+void XexInfoCache::RecordMMIOAccessSite(XexModule* xexmod,
+                                        uint32_t guest_addr) {
+  InfoCacheFlags* flags = LookupFlags(guest_addr - xexmod->low_address_);
+  if (!flags) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mmio_access_sites_mutex_);
+  if (flags->accessed_mmio) {
+    return;
+  }
+  flags->accessed_mmio = true;
+  // Appended right away, exits during boot are rarely clean.
+  FILE* file = xe::filesystem::OpenFile(mmio_access_sites_path_, "ab");
+  if (!file) {
+    return;
+  }
+  fwrite(&guest_addr, sizeof(guest_addr), 1, file);
+  fclose(file);
+}
+void XexModule::RecordMMIOAccess(uint32_t guest_addr) {
+  if (guest_addr < low_address_ || guest_addr >= high_address_) {
+    return;
+  }
+  info_cache_.RecordMMIOAccessSite(this, guest_addr);
+}
+bool XexModule::SetupHostRoutine(uint32_t address,
+                                 std::string_view routine_name) {
+  auto handler = LookupHostRoutine(routine_name);
+  if (!handler) {
+    XELOGE("Unknown host routine {} for {:08X}", routine_name, address);
+    return false;
+  }
+  if (!ContainsAddress(address) ||
+      !processor_->SetupHostRoutine(address, handler)) {
+    XELOGE("Failed to replace the function at {:08X} with host {}", address,
+           routine_name);
+    return false;
+  }
+  Function* function = processor_->QueryFunction(address);
+  if (function && function->name().empty()) {
+    function->set_name(routine_name);
+  }
+  XELOGI("Replaced the function at {:08X} with host {}", address,
+         routine_name);
+  return true;
 }
 InfoCacheFlags* XexModule::GetInstructionAddressFlags(uint32_t guest_addr) {
   if (guest_addr < low_address_ || guest_addr > high_address_) {
@@ -1426,44 +1591,145 @@ InfoCacheFlags* XexModule::GetInstructionAddressFlags(uint32_t guest_addr) {
   return info_cache_.LookupFlags(guest_addr);
 }
 void XexModule::PrecompileDiscoveredFunctions() {
-  if (!cvars::enable_early_precompilation) {
+  // Functions are placed in the code cache in the order they're compiled, so
+  // compile the hot ones first to pack them together.
+  std::vector<uint32_t> hot;
+  if (cvars::profile_guided_function_layout) {
+    hot = GetHotFunctions();
+  }
+  std::vector<uint32_t> others;
+  if (cvars::enable_early_precompilation) {
+    others = PreanalyzeCode();
+  } else if (cvars::precompile_known_functions) {
+    // Modules loaded while the game is running, such as the ones for the
+    // different game modes, would otherwise be compiled on the first calls in
+    // the middle of the gameplay.
+    others = GetKnownFunctions();
+  }
+  if (others.empty()) {
+    if (!hot.empty()) {
+      PrecompileFunctions(std::move(hot));
+    }
     return;
   }
-  auto others = PreanalyzeCode();
 
-  for (auto&& other : others) {
-    if (other < low_address_ || other >= high_address_) {
-      continue;
+  others.erase(std::remove_if(others.begin(), others.end(),
+                              [this](uint32_t other) {
+                                return other < low_address_ ||
+                                       other >= high_address_;
+                              }),
+               others.end());
+  if (!hot.empty()) {
+    // Sorted by address.
+    others.erase(std::remove_if(others.begin(), others.end(),
+                                [&hot](uint32_t other) {
+                                  return std::binary_search(hot.cbegin(),
+                                                            hot.cend(), other);
+                                }),
+                 others.end());
+    others.insert(others.begin(), hot.cbegin(), hot.cend());
+  }
+  PrecompileFunctions(std::move(others));
+}
+std::vector<uint32_t> XexModule::GetHotFunctions() {
+  std::vector<uint32_t> hot;
+  uint32_t end = (high_address_ - low_address_) / 4;
+  auto flags = info_cache_.LookupFlags(0);
+  if (!flags) {
+    return hot;
+  }
+  for (uint32_t i = 0; i < end; i++) {
+    if (flags[i].is_hot) {
+      hot.push_back(low_address_ + (i * 4));
     }
-    auto sym = processor_->LookupFunction(other);
-
-    if (!sym || sym->status() != Symbol::Status::kDefined) {
-      processor_->ResolveFunction(other);
+  }
+  return hot;
+}
+std::vector<uint32_t> XexModule::GetKnownFunctions() {
+  std::vector<uint32_t> known;
+  uint32_t end = (high_address_ - low_address_) / 4;
+  auto flags = info_cache_.LookupFlags(0);
+  if (!flags) {
+    return known;
+  }
+  for (uint32_t i = 0; i < end; i++) {
+    if (flags[i].was_resolved) {
+      known.push_back(low_address_ + (i * 4));
     }
   }
+  return known;
 }
 void XexModule::PrecompileKnownFunctions() {
   if (!cvars::enable_early_precompilation) {
     return;
   }
-  uint32_t start = 0;
-  uint32_t end = (high_address_ - low_address_) / 4;
-  auto flags = info_cache_.LookupFlags(0);
-  if (!flags) {
+  std::vector<uint32_t> known = GetKnownFunctions();
+  if (known.empty()) {
     return;
   }
-  // maybe should pre-acquire global crit?
-  for (uint32_t i = 0; i < end; i++) {
-    if (flags[i].was_resolved) {
-      uint32_t addr = low_address_ + (i * 4);
-      auto sym = processor_->LookupFunction(addr);
+  PrecompileFunctions(std::move(known));
+}
+void XexModule::PrecompileFunctions(std::vector<uint32_t> addresses) {
+  ShutdownPrecompilation();
+
+  xe::threading::TaskScheduler& task_scheduler =
+      xe::threading::TaskScheduler::Get();
+  uint32_t task_count;
+  if (cvars::precompilation_threads < 0) {
+    task_count = task_scheduler.worker_count();
+  } else {
+    task_count = uint32_t(cvars::precompilation_threads);
+  }
+  task_count = uint32_t(std::min(size_t(task_count), addresses.size()));
 
+  if (!task_count) {
+    for (uint32_t address : addresses) {
+      auto sym = processor_->LookupFunction(address);
       if (!sym || sym->status() != Symbol::Status::kDefined) {
-        processor_->ResolveFunction(addr);
+        processor_->ResolveFunction(address);
       }
     }
+    return;
+  }
+
+  // Functions are independent - the entry table makes sure each is compiled
+  // once, and guest threads needing a function still being compiled wait only
+  // for that function.
+  precompile_addresses_ = std::move(addresses);
+  precompile_next_index_.store(0, std::memory_order_relaxed);
+  precompile_cancel_.store(false, std::memory_order_relaxed);
+  if (!precompile_task_group_) {
+    precompile_task_group_ =
+        std::make_unique<xe::threading::TaskGroup>(task_scheduler);
+  }
+  // Background tasks leave part of the workers to the more urgent work, and
+  // the guest threads still get the functions they call first.
+  for (uint32_t i = 0; i < task_count; ++i) {
+    precompile_task_group_->Submit([this]() { PrecompileTask(); },
+                                   xe::threading::TaskPriority::kBackground);
+  }
+}
+void XexModule::PrecompileTask() {
+  while (!precompile_cancel_.load(std::memory_order_relaxed)) {
+    size_t index =
+        precompile_next_index_.fetch_add(1, std::memory_order_relaxed);
+    if (index >= precompile_addresses_.size()) {
+      break;
+    }
+    uint32_t address = precompile_addresses_[index];
+    auto sym = processor_->LookupFunction(address);
+    if (!sym || sym->status() != Symbol::Status::kDefined) {
+      processor_->ResolveFunction(address);
+    }
   }
 }
+void XexModule::ShutdownPrecompilation() {
+  precompile_cancel_.store(true, std::memory_order_relaxed);
+  if (precompile_task_group_) {
+    precompile_task_group_->Wait();
+  }
+  precompile_addresses_.clear();
+}
 
 static uint32_t GetBLCalledFunction(XexModule* xexmod, uint32_t current_base,
                                     ppc::PPCOpcodeBits wrd) {
@@ -1480,6 +1746,20 @@ static bool IsOpcodeBL(unsigned w) {
 }
 
 std::vector<uint32_t> XexModule::PreanalyzeCode() {
+  XexInfoCache::InfoCacheFlagsHeader* info_cache_header =
+      info_cache_.GetHeader();
+  uint32_t flag_count = (high_address_ - low_address_) / 4;
+  std::vector<uint32_t> result;
+  if (info_cache_header && info_cache_header->function_starts_scanned) {
+    InfoCacheFlags* flags = info_cache_header->LookupFlags(0);
+    for (uint32_t i = 0; i < flag_count; ++i) {
+      if (flags[i].is_scanned_function_start) {
+        result.push_back(low_address_ + i * 4);
+      }
+    }
+    return result;
+  }
+
   uint32_t low_8_aligned = xe::align<uint32_t>(low_address_, 8);
 
   uint32_t highest_exec_addr = 0;
@@ -1490,140 +1770,149 @@ std::vector<uint32_t> XexModule::PreanalyzeCode() {
           std::max<uint32_t>(highest_exec_addr, sec.address + sec.size);
     }
   }
-  uint32_t high_8_aligned = highest_exec_addr & ~(8U - 1);
-  uint32_t n_possible_8byte_addresses = (high_8_aligned - low_8_aligned) / 8;
-  uint32_t* funcstart_candidate_stack =
-      new uint32_t[n_possible_8byte_addresses];
-  uint32_t* funcstart_candstack2 = new uint32_t[n_possible_8byte_addresses];
-
-  uint32_t stack_pos = 0;
-  {
-    // all functions seem to start on 8 byte boundaries, except for obvious ones
-    // like the save/rest funcs
-    uint32_t* range_start =
-        (uint32_t*)memory()->TranslateVirtual(low_8_aligned);
-    uint32_t* range_end = (uint32_t*)memory()->TranslateVirtual(
-        high_8_aligned);  // align down to multiple of 8
-
-    const uint8_t mfspr_r12_lr[4] = {0x7D, 0x88, 0x02, 0xA6};
-
-    // a blr instruction, with 4 zero bytes afterwards to pad the next address
-    // to 8 byte alignment
-    // if we see this prior to our address, we can assume we are a function
-    // start
-    const uint8_t blr[4] = {0x4E, 0x80, 0x0, 0x20};
-
-    uint32_t blr32 = *reinterpret_cast<const uint32_t*>(&blr[0]);
-
-    uint32_t mfspr_r12_lr32 =
-        *reinterpret_cast<const uint32_t*>(&mfspr_r12_lr[0]);
-
-    auto add_new_func = [funcstart_candidate_stack, &stack_pos](uint32_t addr) {
-      funcstart_candidate_stack[stack_pos++] = addr;
-    };
-    /*
-                First pass: detect save of the link register at an eight byte
-       aligned address
-        */
-    for (uint32_t* first_pass = range_start; first_pass < range_end;
-         first_pass += 2) {
-      if (*first_pass == mfspr_r12_lr32) {
-        // Push our newly discovered function start into our list
-        // All addresses in the list are sorted until the second pass
-        add_new_func(
-            static_cast<uint32_t>(reinterpret_cast<uintptr_t>(first_pass) -
-                                  reinterpret_cast<uintptr_t>(range_start)) +
-            low_8_aligned);
-      } else if (first_pass[-1] == 0 && *first_pass != 0) {
-        // originally i checked for blr followed by 0, but some functions are
-        // actually aligned to greater boundaries. something that appears to be
-        // longjmp (it occurs in most games, so standard library, and loads ctx,
-        // so longjmp) is aligned to 16 bytes in most games
-        uint32_t* check_iter = &first_pass[-2];
-
-        while (!*check_iter) {
-          --check_iter;
-        }
+  uint32_t high_8_aligned =
+      std::max(highest_exec_addr & ~(8U - 1), low_8_aligned);
+
+  // Every instruction is checked on its own (only looking back at the
+  // preceding ones), so the code is split into equal ranges scanned in
+  // parallel.
+  constexpr uint32_t kMinRangeSize = 1024 * 1024;
+  uint32_t code_size = high_8_aligned - low_8_aligned;
+  xe::threading::TaskScheduler& task_scheduler =
+      xe::threading::TaskScheduler::Get();
+  uint32_t range_count = std::clamp(code_size / kMinRangeSize, uint32_t(1),
+                                    task_scheduler.worker_count() + 1);
+  uint32_t range_size = xe::align<uint32_t>(code_size / range_count, 8);
+  std::vector<std::vector<uint32_t>> range_starts(range_count);
+  auto range_bounds = [&](uint32_t range_index, uint32_t& start,
+                          uint32_t& end) {
+    start = std::min(low_8_aligned + range_index * range_size, high_8_aligned);
+    end = range_index + 1 == range_count
+              ? high_8_aligned
+              : std::min(start + range_size, high_8_aligned);
+  };
+  task_scheduler.ParallelFor(range_count, [&](uint32_t range_index) {
+    uint32_t start, end;
+    range_bounds(range_index, start, end);
+    ScanFunctionStarts(start, end, range_starts[range_index]);
+  });
 
-        XE_LIKELY_IF(*check_iter == blr32) {
-          add_new_func(
-              static_cast<uint32_t>(reinterpret_cast<uintptr_t>(first_pass) -
-                                    reinterpret_cast<uintptr_t>(range_start)) +
-              low_8_aligned);
-        }
-      }
-    }
-    uint32_t current_guestaddr = low_8_aligned;
-    // Second pass: detect branch with link instructions and decode the target
-    // address. We can safely assume that if bl is to address, that address is
-    // the start of the function
-    for (uint32_t* second_pass = range_start; second_pass < range_end;
-         second_pass++, current_guestaddr += 4) {
-      uint32_t current_call = xe::byte_swap(*second_pass);
-
-      if (IsOpcodeBL(current_call)) {
-        uint32_t called_function = GetBLCalledFunction(
-            this, current_guestaddr, ppc::PPCOpcodeBits{current_call});
-        // must be 8 byte aligned and in range
-        if ((called_function & (8 - 1)) == 0 &&
-            called_function >= low_address_ &&
-            called_function < high_address_) {
-          add_new_func(called_function);
-        }
-      }
-    }
+  size_t candidate_count = 0;
+  for (const std::vector<uint32_t>& starts : range_starts) {
+    candidate_count += starts.size();
+  }
+  result.reserve(candidate_count);
+  for (const std::vector<uint32_t>& starts : range_starts) {
+    result.insert(result.end(), starts.cbegin(), starts.cend());
+  }
 
-    auto pdata = this->GetPESection(".pdata");
+  auto pdata = this->GetPESection(".pdata");
 
-    if (pdata) {
-      uint32_t* pdata_base =
-          (uint32_t*)this->memory()->TranslateVirtual(pdata->address);
+  if (pdata) {
+    uint32_t* pdata_base =
+        (uint32_t*)this->memory()->TranslateVirtual(pdata->address);
 
-      uint32_t n_pdata_entries = pdata->raw_size / 8;
+    uint32_t n_pdata_entries = pdata->raw_size / 8;
 
-      for (uint32_t i = 0; i < n_pdata_entries; ++i) {
-        uint32_t funcaddr = xe::load_and_swap<uint32_t>(&pdata_base[i * 2]);
-        if (funcaddr >= low_address_ && funcaddr <= highest_exec_addr) {
-          add_new_func(funcaddr);
-        } else {
-          // we hit 0 for func addr, that means we're done
-          break;
-        }
+    for (uint32_t i = 0; i < n_pdata_entries; ++i) {
+      uint32_t funcaddr = xe::load_and_swap<uint32_t>(&pdata_base[i * 2]);
+      if (funcaddr >= low_address_ && funcaddr <= highest_exec_addr) {
+        result.push_back(funcaddr);
+      } else {
+        // we hit 0 for func addr, that means we're done
+        break;
       }
     }
   }
 
   // Sort the list of function starts and then ensure that all addresses are
   // unique
-  uint32_t n_known_funcaddrs = 0;
-  {
-    // make addresses unique
-
-    std::sort(funcstart_candidate_stack, funcstart_candidate_stack + stack_pos);
-
-    uint32_t read_pos = 0;
-    uint32_t write_pos = 0;
-    uint32_t previous_addr = ~0u;
-    while (read_pos < stack_pos) {
-      uint32_t current_addr = funcstart_candidate_stack[read_pos++];
-
-      if (current_addr != previous_addr) {
-        previous_addr = current_addr;
-        funcstart_candstack2[write_pos++] = current_addr;
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+
+  if (info_cache_header) {
+    InfoCacheFlags* flags = info_cache_header->LookupFlags(0);
+    for (uint32_t address : result) {
+      if (address >= low_address_ && address < high_address_) {
+        flags[(address - low_address_) / 4].is_scanned_function_start = true;
       }
     }
-    n_known_funcaddrs = write_pos;
+    info_cache_header->function_starts_scanned = true;
   }
-
-  delete[] funcstart_candidate_stack;
-
-  std::vector<uint32_t> result;
-  result.resize(n_known_funcaddrs);
-  memcpy(&result[0], funcstart_candstack2,
-         sizeof(uint32_t) * n_known_funcaddrs);
-  delete[] funcstart_candstack2;
   return result;
 }
+void XexModule::ScanFunctionStarts(uint32_t start, uint32_t end,
+                                   std::vector<uint32_t>& starts) {
+  // all functions seem to start on 8 byte boundaries, except for obvious ones
+  // like the save/rest funcs
+  uint32_t* range_start = (uint32_t*)memory()->TranslateVirtual(start);
+  uint32_t* range_end = (uint32_t*)memory()->TranslateVirtual(end);
+
+  const uint8_t mfspr_r12_lr[4] = {0x7D, 0x88, 0x02, 0xA6};
+
+  // a blr instruction, with 4 zero bytes afterwards to pad the next address
+  // to 8 byte alignment
+  // if we see this prior to our address, we can assume we are a function
+  // start
+  const uint8_t blr[4] = {0x4E, 0x80, 0x0, 0x20};
+
+  uint32_t blr32 = *reinterpret_cast<const uint32_t*>(&blr[0]);
+
+  uint32_t mfspr_r12_lr32 =
+      *reinterpret_cast<const uint32_t*>(&mfspr_r12_lr[0]);
+
+  auto add_new_func = [&starts](uint32_t addr) { starts.push_back(addr); };
+  /*
+              First pass: detect save of the link register at an eight byte
+     aligned address
+      */
+  for (uint32_t* first_pass = range_start; first_pass < range_end;
+       first_pass += 2) {
+    if (*first_pass == mfspr_r12_lr32) {
+      // Push our newly discovered function start into our list
+      add_new_func(
+          static_cast<uint32_t>(reinterpret_cast<uintptr_t>(first_pass) -
+                                reinterpret_cast<uintptr_t>(range_start)) +
+          start);
+    } else if (first_pass[-1] == 0 && *first_pass != 0) {
+      // originally i checked for blr followed by 0, but some functions are
+      // actually aligned to greater boundaries. something that appears to be
+      // longjmp (it occurs in most games, so standard library, and loads ctx,
+      // so longjmp) is aligned to 16 bytes in most games
+      uint32_t* check_iter = &first_pass[-2];
+
+      while (!*check_iter) {
+        --check_iter;
+      }
+
+      XE_LIKELY_IF(*check_iter == blr32) {
+        add_new_func(
+            static_cast<uint32_t>(reinterpret_cast<uintptr_t>(first_pass) -
+                                  reinterpret_cast<uintptr_t>(range_start)) +
+            start);
+      }
+    }
+  }
+  uint32_t current_guestaddr = start;
+  // Second pass: detect branch with link instructions and decode the target
+  // address. We can safely assume that if bl is to address, that address is
+  // the start of the function
+  for (uint32_t* second_pass = range_start; second_pass < range_end;
+       second_pass++, current_guestaddr += 4) {
+    uint32_t current_call = xe::byte_swap(*second_pass);
+
+    if (IsOpcodeBL(current_call)) {
+      uint32_t called_function = GetBLCalledFunction(
+          this, current_guestaddr, ppc::PPCOpcodeBits{current_call});
+      // must be 8 byte aligned and in range
+      if ((called_function & (8 - 1)) == 0 &&
+          called_function >= low_address_ &&
+          called_function < high_address_) {
+        add_new_func(called_function);
+      }
+    }
+  }
+}
 bool XexModule::FindSaveRest() {
   // Special stack save/restore functions.
   // http://research.microsoft.com/en-us/um/redmond/projects/invisible/src/crt/md/ppc/xxx.s.htm
@@ -1794,40 +2083,56 @@ bool XexModule::FindSaveRest() {
   uint32_t fpr_start = 0;
   uint32_t vmx_start = 0;
 
-  auto page_size = base_address_ <= 0x90000000 ? 64 * 1024 : 4 * 1024;
-  auto sec_header = xex_security_info();
   std::vector<uint32_t> resolve_on_exit{};
   resolve_on_exit.reserve(256);
-  for (uint32_t i = 0, page = 0; i < sec_header->page_descriptor_count; i++) {
-    // Byteswap the bitfield manually.
-    xex2_page_descriptor desc;
-    desc.value = xe::byte_swap(sec_header->page_descriptors[i].value);
-
-    const auto start_address = base_address_ + (page * page_size);
-    const auto end_address = start_address + (desc.page_count * page_size);
-
-    if (desc.info == XEX_SECTION_CODE) {
-      if (!gplr_start) {
-        gplr_start = memory_->SearchAligned(start_address, end_address,
-                                            gprlr_code_values,
-                                            xe::countof(gprlr_code_values));
-      }
-      if (!fpr_start) {
-        fpr_start =
-            memory_->SearchAligned(start_address, end_address, fpr_code_values,
-                                   xe::countof(fpr_code_values));
-      }
-      if (!vmx_start) {
-        vmx_start =
-            memory_->SearchAligned(start_address, end_address, vmx_code_values,
-                                   xe::countof(vmx_code_values));
-      }
-      if (gplr_start && fpr_start && vmx_start) {
-        break;
+  // The locations only depend on the contents of the image.
+  XexInfoCache::InfoCacheFlagsHeader* info_cache_header =
+      info_cache_.GetHeader();
+  if (info_cache_header && info_cache_header->save_rest_searched) {
+    gplr_start = info_cache_header->savegprlr_address;
+    fpr_start = info_cache_header->savefpr_address;
+    vmx_start = info_cache_header->savevmx_address;
+  } else {
+    auto page_size = base_address_ <= 0x90000000 ? 64 * 1024 : 4 * 1024;
+    auto sec_header = xex_security_info();
+    for (uint32_t i = 0, page = 0; i < sec_header->page_descriptor_count;
+         i++) {
+      // Byteswap the bitfield manually.
+      xex2_page_descriptor desc;
+      desc.value = xe::byte_swap(sec_header->page_descriptors[i].value);
+
+      const auto start_address = base_address_ + (page * page_size);
+      const auto end_address = start_address + (desc.page_count * page_size);
+
+      if (desc.info == XEX_SECTION_CODE) {
+        if (!gplr_start) {
+          gplr_start = memory_->SearchAligned(start_address, end_address,
+                                              gprlr_code_values,
+                                              xe::countof(gprlr_code_values));
+        }
+        if (!fpr_start) {
+          fpr_start = memory_->SearchAligned(start_address, end_address,
+                                             fpr_code_values,
+                                             xe::countof(fpr_code_values));
+        }
+        if (!vmx_start) {
+          vmx_start = memory_->SearchAligned(start_address, end_address,
+                                             vmx_code_values,
+                                             xe::countof(vmx_code_values));
+        }
+        if (gplr_start && fpr_start && vmx_start) {
+          break;
+        }
       }
-    }
 
-    page += desc.page_count;
+      page += desc.page_count;
+    }
+    if (info_cache_header) {
+      info_cache_header->savegprlr_address = gplr_start;
+      info_cache_header->savefpr_address = fpr_start;
+      info_cache_header->savevmx_address = vmx_start;
+      info_cache_header->save_rest_searched = true;
+    }
   }
 
   // Add function stubs.
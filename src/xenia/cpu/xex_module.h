@@ -10,9 +10,15 @@
 #ifndef XENIA_CPU_XEX_MODULE_H_
 #define XENIA_CPU_XEX_MODULE_H_
 
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "xenia/base/mapped_memory.h"
+#include "xenia/base/task_scheduler.h"
 #include "xenia/cpu/module.h"
 #include "xenia/kernel/util/xex2_info.h"
 
@@ -37,7 +43,13 @@ struct InfoCacheFlags {
   uint32_t is_syscall_func : 1;
   uint32_t is_return_site : 1;  // address can be reached from another function
                                 // by returning
-  uint32_t reserved : 28;
+  uint32_t is_hot : 1;  // function start called often enough to be recompiled
+                        // with all optimizations by tiered compilation
+  uint32_t is_scanned_function_start : 1;  // found by scanning the code, valid
+                                           // if function_starts_scanned
+  uint32_t needs_stackpoint : 1;  // function start whose body was reentered
+                                  // by longjmp-like unwinding
+  uint32_t reserved : 25;
 };
 static_assert(sizeof(InfoCacheFlags) == 4,
               "InfoCacheFlags size should be equal to sizeof ppc instruction.");
@@ -48,8 +60,15 @@ struct XexInfoCache {
 
   struct InfoCacheFlagsHeader {
     uint32_t version;
+    // Results of scanning the image, which only depend on its contents, so it
+    // doesn't need to be scanned again. Zero in older files.
+    uint32_t function_starts_scanned;
+    uint32_t save_rest_searched;
+    uint32_t savegprlr_address;
+    uint32_t savefpr_address;
+    uint32_t savevmx_address;
 
-    unsigned char reserved[252];
+    unsigned char reserved[232];
 
     InfoCacheFlags* LookupFlags(unsigned offset) {
       return &reinterpret_cast<InfoCacheFlags*>(&this[1])[offset];
@@ -59,8 +78,16 @@ struct XexInfoCache {
         for every 4-byte aligned address, records a 4 byte set of flags.
   */
   std::unique_ptr<MappedMemory> executable_addr_flags_;
+  /*
+        guest addresses of the instructions that accessed mmio, also kept
+        apart from the flags so they survive infocache version changes.
+  */
+  std::filesystem::path mmio_access_sites_path_;
+  std::mutex mmio_access_sites_mutex_;
 
   void Init(class XexModule*);
+  void LoadMMIOAccessSites(class XexModule*);
+  void RecordMMIOAccessSite(class XexModule*, uint32_t guest_addr);
   InfoCacheFlagsHeader* GetHeader() {
     if (!executable_addr_flags_) {
       return nullptr;
@@ -231,6 +258,11 @@ class XexModule : public xe::cpu::Module {
   }
 
   InfoCacheFlags* GetInstructionAddressFlags(uint32_t guest_addr);
+  // Marks the instruction as accessing MMIO, in this and future runs.
+  void RecordMMIOAccess(uint32_t guest_addr);
+  // Replaces the guest routine at the address with the host implementation of
+  // the routine with the name (see host_routines.h).
+  bool SetupHostRoutine(uint32_t address, std::string_view routine_name);
 
   virtual void Precompile() override;
 
@@ -240,7 +272,21 @@ class XexModule : public xe::cpu::Module {
  private:
   void PrecompileKnownFunctions();
   void PrecompileDiscoveredFunctions();
+  // Functions marked as hot in the info cache in previous runs.
+  std::vector<uint32_t> GetHotFunctions();
+  // Functions called in previous runs, as recorded in the info cache.
+  std::vector<uint32_t> GetKnownFunctions();
+  // Compiles the functions in background tasks (one translator per worker
+  // thread), or on the calling thread if background precompilation is
+  // disabled.
+  void PrecompileFunctions(std::vector<uint32_t> addresses);
+  void PrecompileTask();
+  void ShutdownPrecompilation();
   std::vector<uint32_t> PreanalyzeCode();
+  // Appends the candidate function starts found in [start, end), both 8-byte
+  // aligned, unsorted.
+  void ScanFunctionStarts(uint32_t start, uint32_t end,
+                          std::vector<uint32_t>& starts);
   friend struct XexInfoCache;
   void ReadSecurityInfo();
 
@@ -248,6 +294,14 @@ class XexModule : public xe::cpu::Module {
   int ReadImageUncompressed(const void* xex_addr, size_t xex_length);
   int ReadImageBasicCompressed(const void* xex_addr, size_t xex_length);
   int ReadImageCompressed(const void* xex_addr, size_t xex_length);
+  // Decompressed images of the LZX-compressed files stored in the cache, keyed
+  // by the hash of the file and the key used to decrypt it.
+  std::filesystem::path GetCachedImagePath(const void* xex_addr,
+                                           size_t xex_length) const;
+  bool LoadCachedImage(const std::filesystem::path& path,
+                       uint32_t image_size);
+  void StoreCachedImage(const std::filesystem::path& path,
+                        uint32_t image_size) const;
 
   int ReadPEHeaders();
 
@@ -282,9 +336,13 @@ class XexModule : public xe::cpu::Module {
   XexFormat xex_format_ = kFormatUnknown;
   SecurityInfoContext security_info_ = {};
 
-  uint8_t image_sha_bytes_[20];
-  std::string image_sha_str_;
+  std::string image_hash_str_;
   XexInfoCache info_cache_;
+
+  std::unique_ptr<xe::threading::TaskGroup> precompile_task_group_;
+  std::vector<uint32_t> precompile_addresses_;
+  std::atomic<size_t> precompile_next_index_{0};
+  std::atomic<bool> precompile_cancel_{false};
 };
 
 }  // namespace cpu
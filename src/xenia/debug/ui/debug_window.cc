@@ -37,6 +37,7 @@
 #include "xenia/ui/windowed_app_context.h"
 
 DEFINE_bool(imgui_debug, false, "Show ImGui debugging tools.", "UI");
+DECLARE_path(sampling_profiler_output_path);
 
 namespace xe {
 namespace debug {
@@ -217,6 +218,9 @@ void DebugWindow::DrawFrame(ImGuiIO& io) {
   ImGui::SameLine();
   ImGui::RadioButton("Memory", &state_.right_pane_tab,
                      ImState::kRightPaneMemory);
+  ImGui::SameLine();
+  ImGui::RadioButton("Profiler", &state_.right_pane_tab,
+                     ImState::kRightPaneProfiler);
   ImGui::EndGroup();
   ImGui::Separator();
   switch (state_.right_pane_tab) {
@@ -230,6 +234,11 @@ void DebugWindow::DrawFrame(ImGuiIO& io) {
       DrawMemoryPane();
       ImGui::EndChild();
       break;
+    case ImState::kRightPaneProfiler:
+      ImGui::BeginChild("##profiler_pane");
+      DrawProfilerPane();
+      ImGui::EndChild();
+      break;
   }
   ImGui::EndChild();
   ImGui::InvisibleButton("##hsplitter0", ImVec2(-1, kSplitterWidth));
@@ -1130,6 +1139,114 @@ void DebugWindow::DrawMemoryPane() {
   // https://github.com/ocornut/imgui/wiki/memory_editor_example
 }
 
+void DebugWindow::DrawProfilerPane() {
+  auto profiler = processor_->sampling_profiler();
+  if (!profiler) {
+    ImGui::Text("Sampling is not supported on this platform.");
+    return;
+  }
+  ImGui::BeginGroup();
+  if (profiler->is_running()) {
+    if (ImGui::Button("Stop", ImVec2(80, 0))) {
+      profiler->Stop();
+    }
+  } else {
+    if (ImGui::Button("Start", ImVec2(80, 0))) {
+      profiler->Start();
+    }
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Reset", ImVec2(80, 0))) {
+    profiler->Reset();
+    state_.profiler_function_address = 0;
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Export", ImVec2(80, 0))) {
+    std::filesystem::path path = cvars::sampling_profiler_output_path;
+    if (path.empty()) {
+      path = "guest_profile.folded";
+    }
+    profiler->ExportCollapsedStacks(path);
+  }
+  ImGui::SameLine();
+  uint64_t sample_count = profiler->sample_count();
+  ImGui::Text("%" PRIu64 " samples, %" PRIu64 " contended stwcx.",
+              sample_count,
+              processor_->backend()->GetReservationContentionCount());
+  ImGui::EndGroup();
+  if (!sample_count) {
+    return;
+  }
+  double percent_scale = 100.0 / double(sample_count);
+
+  float listing_height = state_.profiler_function_address
+                             ? ImGui::GetContentRegionAvail().y * 0.6f
+                             : 0.0f;
+  ImGui::BeginChild("##profiler_functions", ImVec2(0, listing_height));
+  if (ImGui::BeginTable("##profiler_functions_table", 3,
+                        ImGuiTableFlags_BordersInnerH |
+                            ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Self");
+    ImGui::TableSetupColumn("Total");
+    ImGui::TableSetupColumn("Function", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableHeadersRow();
+    for (const auto& function_samples : profiler->GetFunctionSamples()) {
+      if (!function_samples.self_count) {
+        // Sorted by the self count, the rest are only callers.
+        break;
+      }
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%5.1f%%", function_samples.self_count * percent_scale);
+      ImGui::TableNextColumn();
+      ImGui::Text("%5.1f%%", function_samples.total_count * percent_scale);
+      ImGui::TableNextColumn();
+      char function_label[256];
+      std::snprintf(
+          function_label, xe::countof(function_label), "%08X %s##%08X",
+          function_samples.guest_address,
+          profiler->GetFunctionName(function_samples.guest_address).c_str(),
+          function_samples.guest_address);
+      if (ImGui::Selectable(function_label,
+                            state_.profiler_function_address ==
+                                function_samples.guest_address,
+                            ImGuiSelectableFlags_SpanAllColumns)) {
+        state_.profiler_function_address = function_samples.guest_address;
+        auto function =
+            processor_->QueryFunction(function_samples.guest_address);
+        if (function) {
+          NavigateToFunction(function);
+        }
+      }
+    }
+    ImGui::EndTable();
+  }
+  ImGui::EndChild();
+
+  if (!state_.profiler_function_address) {
+    return;
+  }
+  ImGui::Separator();
+  ImGui::BeginChild("##profiler_instructions");
+  if (ImGui::BeginTable("##profiler_instructions_table", 2,
+                        ImGuiTableFlags_BordersInnerH |
+                            ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Self");
+    ImGui::TableSetupColumn("Address", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableHeadersRow();
+    for (const auto& instruction_samples :
+         profiler->GetInstructionSamples(state_.profiler_function_address)) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%5.1f%%", instruction_samples.second * percent_scale);
+      ImGui::TableNextColumn();
+      ImGui::Text("%08X", instruction_samples.first);
+    }
+    ImGui::EndTable();
+  }
+  ImGui::EndChild();
+}
+
 void DebugWindow::DrawBreakpointsPane() {
   auto& state = state_.breakpoints;
 
@@ -86,6 +86,7 @@ class DebugWindow : public cpu::DebugListener {
   bool DrawRegisterTextBoxes(int id, float* value);
   void DrawThreadsPane();
   void DrawMemoryPane();
+  void DrawProfilerPane();
   void DrawBreakpointsPane();
   void DrawLogPane();
 
@@ -139,6 +140,7 @@ class DebugWindow : public cpu::DebugListener {
   struct ImState {
     static const int kRightPaneThreads = 0;
     static const int kRightPaneMemory = 1;
+    static const int kRightPaneProfiler = 2;
     int right_pane_tab = kRightPaneThreads;
 
     cpu::ThreadDebugInfo* thread_info = nullptr;
@@ -163,6 +165,9 @@ class DebugWindow : public cpu::DebugListener {
     } breakpoints;
 
     xe::kernel::XThread* isolated_log_thread = nullptr;
+
+    // Guest function with the instruction samples shown in the profiler.
+    uint32_t profiler_function_address = 0;
   } state_;
 };
 
@@ -11,7 +11,9 @@
 
 #include <algorithm>
 #include <cinttypes>
+#include <cstring>
 
+#include "build/version.h"
 #include "config.h"
 #include "third_party/fmt/include/fmt/format.h"
 #include "third_party/tabulate/single_include/tabulate/tabulate.hpp"
@@ -22,21 +24,28 @@
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/clock.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/debugging.h"
 #include "xenia/base/exception_handler.h"
+#include "xenia/base/filesystem.h"
 #include "xenia/base/literals.h"
+#include "xenia/base/lock_profiler.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/mapped_memory.h"
+#include "xenia/base/memory.h"
 #include "xenia/base/platform.h"
 #include "xenia/base/string.h"
 #include "xenia/base/system.h"
+#include "xenia/base/title_profile.h"
+#include "xenia/base/xxhash.h"
 #include "xenia/cpu/backend/code_cache.h"
 #include "xenia/cpu/backend/null_backend.h"
 #include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/thread_state.h"
 #include "xenia/gpu/command_processor.h"
 #include "xenia/gpu/graphics_system.h"
+#include "xenia/gpu/gpu_flags.h"
 #include "xenia/hid/input_driver.h"
 #include "xenia/hid/input_system.h"
 #include "xenia/kernel/XLiveAPI.h"
@@ -47,6 +56,7 @@
 #include "xenia/kernel/xam/xam_module.h"
 #include "xenia/kernel/xbdm/xbdm_module.h"
 #include "xenia/kernel/xboxkrnl/xboxkrnl_module.h"
+#include "xenia/kernel/xthread.h"
 #include "xenia/memory.h"
 #include "xenia/ui/file_picker.h"
 #include "xenia/ui/imgui_dialog.h"
@@ -59,7 +69,9 @@
 #include "xenia/vfs/devices/disc_zarchive_device.h"
 #include "xenia/vfs/devices/host_path_device.h"
 #include "xenia/vfs/devices/null_device.h"
+#include "xenia/vfs/devices/overlay_device.h"
 #include "xenia/vfs/devices/xcontent_container_device.h"
+#include "xenia/vfs/metadata_snapshot.h"
 #include "xenia/vfs/virtual_file_system.h"
 
 #if XE_ARCH_AMD64
@@ -83,6 +95,64 @@ DEFINE_bool(allow_game_relative_writes, false,
             "generating test data to compare with original hardware. ",
             "General");
 
+DEFINE_string(
+    mount_overlay_paths, "",
+    "Host directories or packages, separated by |, whose files are layered "
+    "over the files of the title when it's mounted, the first one on top, for "
+    "instance to replace assets.",
+    "General");
+
+DEFINE_path(startup_timeline_path, "",
+            "File to write the durations of the startup stages up to the "
+            "first guest frame to, as CSV.",
+            "General");
+
+DEFINE_bool(boot_snapshot, false,
+            "Take a snapshot of the title at the guest frame set by "
+            "boot_snapshot_frame, and restore it on the next launches with the "
+            "same title update, configuration files and emulator build instead "
+            "of booting the title again. Not all titles can be restored.",
+            "General");
+
+DEFINE_uint32(boot_snapshot_frame, 600,
+              "Guest frame after the launch to take the boot snapshot at, for "
+              "instance once the title menu is shown. May be set in the game "
+              "configuration of the title.",
+              "General");
+
+DEFINE_uint32(benchmark_frames, 0,
+              "Benchmark mode: measures this many guest frames after the "
+              "first one, writes the report to benchmark_report_path and "
+              "exits. Locks the guest time to the vblanks (see "
+              "vblank_locked_guest_time_timeout_ms) for repeatable runs. Meant "
+              "to be used with headless, and with hid set to replay for "
+              "scripted input. 0 to disable.",
+              "General");
+DEFINE_path(benchmark_report_path, "",
+            "File to write the JSON report of the benchmark mode to: the frame "
+            "time percentiles, the cache hit rates and the performance counter "
+            "changes, such as the JIT compilations. Empty to only log it.",
+            "General");
+DEFINE_bool(benchmark_offscreen, false,
+            "In the benchmark mode, render with the GPU backend as usual, but "
+            "don't present the frames to the window.",
+            "General");
+
+DEFINE_bool(title_profiles, false,
+            "Measure the mean frame time of titles with the current values of "
+            "the performance options, such as draw_resolution_scale_x/y, the "
+            "render target path and readback_resolve, in the title profiles "
+            "in the cache, and on launch apply the fastest configuration "
+            "known for the title. The options set in the game configuration "
+            "of the title are not changed. Profiles can be copied between "
+            "machines.",
+            "General");
+DEFINE_uint32(title_profile_min_frames, 3600,
+              "Number of guest frames a configuration of the performance "
+              "options must have been measured over in total to be selected "
+              "with title_profiles.",
+              "General");
+
 DECLARE_int32(user_language);
 
 DECLARE_bool(allow_plugins);
@@ -96,6 +166,22 @@ DEFINE_int32(priority_class, 0,
 namespace xe {
 using namespace xe::literals;
 
+// Options with the biggest effect on the performance that are worth
+// selecting automatically per title.
+static const char* const kTitleProfileOptions[] = {
+    "d3d12_tiled_shared_memory",
+    "draw_resolution_scale_x",
+    "draw_resolution_scale_y",
+    "readback_memexport",
+    "readback_resolve",
+    "render_target_path_d3d12",
+    "render_target_path_vulkan",
+    "use_fast_dot_product",
+    "use_new_decoder",
+};
+// Not measuring the boot of the title, usually with long loading pauses.
+constexpr uint64_t kTitleProfileSkippedFrames = 600;
+
 Emulator::GameConfigLoadCallback::GameConfigLoadCallback(Emulator& emulator)
     : emulator_(emulator) {
   emulator_.AddGameConfigLoadCallback(this);
@@ -133,6 +219,11 @@ Emulator::Emulator(const std::filesystem::path& command_line,
       paused_(false),
       restoring_(false),
       restore_fence_() {
+  startup_timeline_ = std::make_unique<StartupTimeline>();
+  if (!cache_root_.empty()) {
+    vfs::SetMetadataSnapshotRoot(cache_root_ / "vfs_metadata");
+  }
+
   if (cvars::priority_class != 0) {
     if (SetProcessPriorityClass(cvars::priority_class)) {
       XELOGI("Higher priority class request: Successful. New priority: {}",
@@ -165,6 +256,8 @@ Emulator::Emulator(const std::filesystem::path& command_line,
 }
 
 Emulator::~Emulator() {
+  RecordTitleProfile();
+
   // Note that we delete things in the reverse order they were initialized.
 
   // Give the systems time to shutdown before we delete them.
@@ -188,6 +281,9 @@ Emulator::~Emulator() {
   export_resolver_.reset();
 
   ExceptionHandler::Uninstall(Emulator::ExceptionCallbackThunk, this);
+
+  xe::lock_profiler::DumpToConfiguredFile();
+  xe::counters::ShutdownExport();
 }
 
 X_STATUS Emulator::Setup(
@@ -215,6 +311,29 @@ X_STATUS Emulator::Setup(
   // Before we can set thread affinity we must enable the process to use all
   // logical processors.
   xe::threading::EnableAffinityConfiguration();
+  // Before creating any threads, so they don't interfere with the guest.
+  xe::kernel::XThread::InitializeHostProcessorMapping();
+
+  xe::counters::InitializeExport();
+  if (cvars::benchmark_frames) {
+    benchmark_ = std::make_unique<Benchmark>(cvars::benchmark_frames);
+    if (!cvars::vblank_locked_guest_time_timeout_ms) {
+      OVERRIDE_uint32(vblank_locked_guest_time_timeout_ms, 100);
+    }
+  }
+  frame_timeline_ = std::make_unique<FrameTimeline>(
+      std::vector<FrameTimeline::ComponentDefinition>{
+          {"Guest CPU", "kernel/guest_run_us", ""},
+          {"Kernel waits", "kernel/wait_us", ""},
+          {"XMA decoding", "apu/xma/work_us", ""},
+          {"GPU command processor", "gpu/command_processor/busy_us",
+           "gpu/host_gpu_wait_us"},
+          {"Host GPU wait", "gpu/host_gpu_wait_us", ""},
+          {"Present", "ui/present_us", ""},
+      });
+
+  StartupTimeline::ScopedStage setup_stage(startup_timeline_.get(),
+                                          "Emulator setup");
 
   // Create memory system first, as it is required for other systems.
   memory_ = std::make_unique<Memory>();
@@ -243,12 +362,36 @@ X_STATUS Emulator::Setup(
   }
 
   // Initialize the CPU.
+  StartupTimeline::ScopedStage cpu_stage(startup_timeline_.get(), "CPU setup");
   processor_ = std::make_unique<xe::cpu::Processor>(memory_.get(),
                                                     export_resolver_.get());
   if (!processor_->Setup(std::move(backend))) {
     return X_STATUS_UNSUCCESSFUL;
   }
 
+  cpu_stage.End();
+
+  // Allocated on the node of the thread touching the pages first otherwise,
+  // which is often not the node of the guest hardware threads.
+  uint32_t numa_node = xe::kernel::XThread::GetGuestHardwareThreadNumaNode();
+  if (numa_node != UINT32_MAX) {
+    bool numa_bound = memory_->BindToNumaNode(numa_node);
+    xe::cpu::backend::CodeCache* code_cache =
+        processor_->backend()->code_cache();
+    if (code_cache) {
+      numa_bound &= xe::memory::BindToNumaNode(
+          reinterpret_cast<void*>(code_cache->execute_base_address()),
+          code_cache->total_size(), numa_node);
+    }
+    if (numa_bound) {
+      XELOGI("Guest memory and generated code placed on host NUMA node {}",
+             numa_node);
+    } else {
+      XELOGW("Failed to place the guest memory on host NUMA node {}",
+             numa_node);
+    }
+  }
+
   // Initialize the APU.
   if (audio_system_factory) {
     audio_system_ = audio_system_factory(processor_.get());
@@ -258,7 +401,10 @@ X_STATUS Emulator::Setup(
   }
 
   // Initialize the GPU.
+  StartupTimeline::ScopedStage graphics_provider_stage(startup_timeline_.get(),
+                                                      "Graphics provider");
   graphics_system_ = graphics_system_factory();
+  graphics_provider_stage.End();
   if (!graphics_system_) {
     return X_STATUS_NOT_IMPLEMENTED;
   }
@@ -289,6 +435,8 @@ X_STATUS Emulator::Setup(
   patcher_ = std::make_unique<xe::patcher::Patcher>(storage_root_);
 
   // Shared kernel state.
+  StartupTimeline::ScopedStage kernel_stage(startup_timeline_.get(),
+                                           "Kernel setup");
   kernel_state_ = std::make_unique<xe::kernel::KernelState>(this);
 #define LOAD_KERNEL_MODULE(t) \
   static_cast<void>(kernel_state_->LoadKernelModule<kernel::t>())
@@ -300,7 +448,11 @@ X_STATUS Emulator::Setup(
   plugin_loader_ = std::make_unique<xe::patcher::PluginLoader>(
       kernel_state_.get(), storage_root() / "plugins");
 
+  kernel_stage.End();
+
   // Setup the core components.
+  StartupTimeline::ScopedStage graphics_stage(startup_timeline_.get(),
+                                             "Graphics setup");
   result = graphics_system_->Setup(
       processor_.get(), kernel_state_.get(),
       display_window_ ? &display_window_->app_context() : nullptr,
@@ -308,8 +460,11 @@ X_STATUS Emulator::Setup(
   if (result) {
     return result;
   }
+  graphics_stage.End();
 
   if (audio_system_) {
+    StartupTimeline::ScopedStage audio_stage(startup_timeline_.get(),
+                                            "Audio setup");
     result = audio_system_->Setup(kernel_state_.get());
     if (result) {
       return result;
@@ -330,6 +485,7 @@ X_STATUS Emulator::TerminateTitle() {
     return X_STATUS_UNSUCCESSFUL;
   }
 
+  RecordTitleProfile();
   kernel_state_->TerminateTitle();
   title_id_ = std::nullopt;
   title_name_ = "";
@@ -413,7 +569,26 @@ void Emulator::SetPersistentEmulatorFlags(uint64_t new_flags) {
 
 X_STATUS Emulator::MountPath(const std::filesystem::path& path,
                              const std::string_view mount_path) {
+  StartupTimeline::ScopedStage mount_stage(startup_timeline_.get(), "Mount");
   auto device = CreateVfsDevice(path, mount_path);
+  if (device && !cvars::mount_overlay_paths.empty()) {
+    std::vector<std::unique_ptr<vfs::Device>> layers;
+    for (const std::string_view overlay_path :
+         xe::utf8::split(cvars::mount_overlay_paths, "|", true)) {
+      auto overlay_host_path = xe::to_path(overlay_path);
+      if (std::filesystem::is_directory(overlay_host_path)) {
+        layers.push_back(std::make_unique<vfs::HostPathDevice>(
+            mount_path, overlay_host_path, true));
+      } else if (auto layer = CreateVfsDevice(overlay_host_path, mount_path)) {
+        layers.push_back(std::move(layer));
+      } else {
+        XELOGW("Unable to layer {} over the title files", overlay_path);
+      }
+    }
+    layers.push_back(std::move(device));
+    device =
+        std::make_unique<vfs::OverlayDevice>(mount_path, std::move(layers));
+  }
   if (!device || !device->Initialize()) {
     XELOGE(
         "Unable to mount the selected file, it is an unsupported format or "
@@ -512,6 +687,8 @@ Emulator::FileSignatureType Emulator::GetFileSignature(
 
 X_STATUS Emulator::LaunchPath(const std::filesystem::path& path) {
   X_STATUS mount_result = X_STATUS_SUCCESS;
+  StartupTimeline::ScopedStage launch_stage(startup_timeline_.get(),
+                                           "Launch");
 
   switch (GetFileSignature(path)) {
     case FileSignatureType::XEX1:
@@ -833,6 +1010,8 @@ X_STATUS Emulator::InstallContentPackage(
 
   X_STATUS error_code = vfs::VirtualFileSystem::ExtractContentFiles(
       device.get(), installation_path);
+  // Closed packages may still be mounted with the previous content.
+  kernel_state_->content_manager()->EvictClosedPackages(installation_path);
   if (error_code != X_ERROR_SUCCESS) {
     return error_code;
   }
@@ -1028,7 +1207,13 @@ void Emulator::Resume() {
   }
 }
 
-bool Emulator::SaveToFile(const std::filesystem::path& path) {
+bool Emulator::SaveToFile(const std::filesystem::path& path,
+                          bool incremental) {
+  if (incremental && last_snapshot_path_.empty()) {
+    XELOGW("No previous snapshot to save an incremental one based on");
+    incremental = false;
+  }
+
   Pause();
 
   filesystem::CreateEmptyFile(path);
@@ -1044,6 +1229,19 @@ bool Emulator::SaveToFile(const std::filesystem::path& path) {
   if (title_id_.has_value()) {
     stream.Write(title_id_.value());
   }
+  // The previous snapshot is referenced relatively to the directory of this
+  // one so they can be moved together.
+  std::string parent_path;
+  if (incremental) {
+    parent_path = xe::path_to_utf8(
+        std::filesystem::absolute(last_snapshot_path_)
+            .lexically_relative(std::filesystem::absolute(path).parent_path()));
+  }
+  stream.Write(std::string_view(parent_path));
+  // Location of the memory state, for restoring the memory from the previous
+  // snapshots without the rest of their state, filled later.
+  size_t memory_offset_offset = stream.offset();
+  stream.Write(uint64_t(0));
 
   // It's important we don't hold the global lock here! XThreads need to step
   // forward (possibly through guarded regions) without worry!
@@ -1051,19 +1249,56 @@ bool Emulator::SaveToFile(const std::filesystem::path& path) {
   graphics_system_->Save(&stream);
   audio_system_->Save(&stream);
   kernel_state_->Save(&stream);
-  memory_->Save(&stream);
+  uint64_t memory_offset = stream.offset();
+  std::memcpy(stream.data() + memory_offset_offset, &memory_offset,
+              sizeof(memory_offset));
+  bool memory_saved = memory_->Save(&stream, incremental);
   map->Close(stream.offset());
 
   Resume();
+  if (!memory_saved) {
+    XELOGE("Could not save memory!");
+    last_snapshot_path_.clear();
+    return false;
+  }
+  last_snapshot_path_ = path;
   return true;
 }
 
 bool Emulator::RestoreFromFile(const std::filesystem::path& path) {
-  // Restore the emulator state from a file
-  auto map = MappedMemory::Open(path, MappedMemory::Mode::kReadWrite);
-  if (!map) {
-    return false;
+  // Restore the emulator state from a file, and the memory from the chain of
+  // snapshots it's based on, from the newest to the oldest.
+  std::vector<std::unique_ptr<MappedMemory>> maps;
+  std::vector<uint64_t> memory_offsets;
+  std::filesystem::path snapshot_path = path;
+  while (true) {
+    auto snapshot_map =
+        MappedMemory::Open(snapshot_path, MappedMemory::Mode::kRead);
+    if (!snapshot_map) {
+      XELOGE("Could not open the snapshot {}",
+             xe::path_to_utf8(snapshot_path));
+      return false;
+    }
+    ByteStream snapshot_stream(snapshot_map->data(), snapshot_map->size());
+    if (snapshot_stream.Read<uint32_t>() != kEmulatorSaveSignature) {
+      return false;
+    }
+    if (snapshot_stream.Read<bool>()) {
+      snapshot_stream.Read<uint32_t>();
+    }
+    auto parent_path = snapshot_stream.Read<std::string>();
+    memory_offsets.push_back(snapshot_stream.Read<uint64_t>());
+    maps.push_back(std::move(snapshot_map));
+    if (parent_path.empty()) {
+      break;
+    }
+    if (maps.size() >= 4096) {
+      XELOGE("Snapshot chain of {} is too long", xe::path_to_utf8(path));
+      return false;
+    }
+    snapshot_path = snapshot_path.parent_path() / xe::to_path(parent_path);
   }
+  MappedMemory* map = maps.front().get();
 
   restoring_ = true;
 
@@ -1090,6 +1325,8 @@ bool Emulator::RestoreFromFile(const std::filesystem::path& path) {
     assert_always();
     return false;
   }
+  stream.Read<std::string>();
+  stream.Read<uint64_t>();
 
   if (!processor_->Restore(&stream)) {
     XELOGE("Could not restore processor!");
@@ -1107,10 +1344,16 @@ bool Emulator::RestoreFromFile(const std::filesystem::path& path) {
     XELOGE("Could not restore kernel state!");
     return false;
   }
-  if (!memory_->Restore(&stream)) {
-    XELOGE("Could not restore memory!");
-    return false;
+  for (size_t i = maps.size(); i-- > 0;) {
+    ByteStream memory_stream(maps[i]->data(), maps[i]->size(),
+                             size_t(memory_offsets[i]));
+    if (!memory_->Restore(&memory_stream)) {
+      XELOGE("Could not restore memory!");
+      last_snapshot_path_.clear();
+      return false;
+    }
   }
+  last_snapshot_path_ = path;
 
   // Update the main thread.
   auto threads =
@@ -1295,6 +1538,216 @@ void Emulator::RemoveGameConfigLoadCallback(GameConfigLoadCallback* callback) {
   game_config_load_callbacks_.erase(it);
 }
 
+void Emulator::ReportStartupTimeline() {
+  XELOGI("First frame {:.1f} ms after the emulator was created:\n{}",
+         startup_timeline_->first_frame_ms(),
+         startup_timeline_->FormatReport());
+  if (!cvars::startup_timeline_path.empty() &&
+      !startup_timeline_->ExportCsv(cvars::startup_timeline_path)) {
+    XELOGE("Failed to write the startup timeline to {}",
+           cvars::startup_timeline_path);
+  }
+}
+
+void Emulator::UpdateBootSnapshot() {
+  uint32_t frames_left =
+      boot_snapshot_frames_left_.load(std::memory_order_relaxed);
+  do {
+    if (!frames_left) {
+      return;
+    }
+  } while (!boot_snapshot_frames_left_.compare_exchange_weak(
+      frames_left, frames_left - 1, std::memory_order_relaxed));
+  if (frames_left != 1 || !display_window_) {
+    return;
+  }
+  // Saved outside the guest threads, like from the UI, so all of them are
+  // suspended at a point where they can be resumed after restoring.
+  display_window_->app_context().CallInUIThread([this]() {
+    std::filesystem::create_directories(boot_snapshot_path_.parent_path());
+    if (SaveToFile(boot_snapshot_path_)) {
+      XELOGI("Saved the boot snapshot to {}",
+             xe::path_to_utf8(boot_snapshot_path_));
+    } else {
+      XELOGE("Failed to save the boot snapshot to {}",
+             xe::path_to_utf8(boot_snapshot_path_));
+      std::error_code error_code;
+      std::filesystem::remove(boot_snapshot_path_, error_code);
+    }
+  });
+}
+
+void Emulator::UpdateBenchmark() {
+  if (!benchmark_ || !benchmark_->OnFrameBoundary()) {
+    return;
+  }
+  std::string report = benchmark_->FormatReportJson();
+  XELOGI("Benchmark of {} frames complete:\n{}", benchmark_->frame_count(),
+         report);
+  if (!cvars::benchmark_report_path.empty() &&
+      !benchmark_->WriteReport(cvars::benchmark_report_path)) {
+    XELOGE("Failed to write the benchmark report to {}",
+           cvars::benchmark_report_path);
+  }
+  on_benchmark_complete();
+}
+
+void Emulator::UpdateTitleProfile() {
+  uint64_t ticks = Clock::QueryHostTickCount();
+  std::lock_guard<std::mutex> lock(title_profile_mutex_);
+  if (title_profile_path_.empty()) {
+    return;
+  }
+  if (++title_profile_frame_boundaries_ == kTitleProfileSkippedFrames) {
+    title_profile_start_ticks_ = ticks;
+  }
+  title_profile_last_ticks_ = ticks;
+}
+
+void Emulator::ApplyTitleProfile(uint32_t title_id) {
+  std::lock_guard<std::mutex> lock(title_profile_mutex_);
+  title_profile_path_.clear();
+  title_profile_options_.clear();
+  title_profile_frame_boundaries_ = 0;
+  if (!cvar::ConfigVars) {
+    return;
+  }
+  // Not keeping the values from the profile of the previous title.
+  for (const char* option : kTitleProfileOptions) {
+    auto it = cvar::ConfigVars->find(option);
+    if (it != cvar::ConfigVars->end()) {
+      it->second->ResetGameConfigValue();
+    }
+  }
+  if (!cvars::title_profiles || cache_root_.empty()) {
+    return;
+  }
+  title_profile_path_ =
+      cache_root_ / "title_profiles" / fmt::format("{:08X}.toml", title_id);
+
+  TitleProfile profile;
+  if (!profile.Load(title_profile_path_)) {
+    XELOGE("Failed to load the title profile {}",
+           xe::path_to_utf8(title_profile_path_));
+  }
+  const TitleProfile::Configuration* best =
+      profile.GetBest(cvars::title_profile_min_frames);
+  if (best) {
+    std::filesystem::path game_config_path =
+        config::GetGameConfigPath(fmt::format("{:08X}", title_id));
+    toml::table game_config;
+    if (std::filesystem::exists(game_config_path)) {
+      try {
+        game_config = ParseFile(game_config_path);
+      } catch (toml::parse_error&) {
+      }
+    }
+    for (const auto& [name, literal] : best->options) {
+      if (std::find_if(std::begin(kTitleProfileOptions),
+                       std::end(kTitleProfileOptions),
+                       [&name = name](const char* option) {
+                         return name == option;
+                       }) == std::end(kTitleProfileOptions)) {
+        continue;
+      }
+      auto it = cvar::ConfigVars->find(name);
+      if (it == cvar::ConfigVars->end()) {
+        continue;
+      }
+      cvar::IConfigVar* config_var = it->second;
+      if (game_config.at_path(config_var->category() + "." + name)) {
+        // Chosen by the user for the title.
+        continue;
+      }
+      toml::table value_table;
+      try {
+        value_table = toml::parse("value = " + literal);
+      } catch (toml::parse_error&) {
+        continue;
+      }
+      config_var->LoadGameConfigValue(value_table.get("value"));
+    }
+    XELOGI("Applied the title profile configuration measured at {:.3f} ms "
+           "per frame over {} frames",
+           best->frame_time_ms, best->frames);
+  }
+
+  for (const char* option : kTitleProfileOptions) {
+    auto it = cvar::ConfigVars->find(option);
+    if (it != cvar::ConfigVars->end()) {
+      title_profile_options_.emplace(option,
+                                     it->second->current_config_value());
+    }
+  }
+}
+
+void Emulator::RecordTitleProfile() {
+  std::lock_guard<std::mutex> lock(title_profile_mutex_);
+  if (title_profile_path_.empty()) {
+    return;
+  }
+  std::filesystem::path path = std::move(title_profile_path_);
+  title_profile_path_.clear();
+  if (title_profile_frame_boundaries_ <= kTitleProfileSkippedFrames) {
+    return;
+  }
+  // The measurement is not attributable to one configuration if the options
+  // have been changed while running.
+  for (const auto& [name, value] : title_profile_options_) {
+    if (cvar::ConfigVars->at(name)->current_config_value() != value) {
+      return;
+    }
+  }
+  uint64_t frames = title_profile_frame_boundaries_ - kTitleProfileSkippedFrames;
+  double frame_time_ms =
+      double(title_profile_last_ticks_ - title_profile_start_ticks_) * 1000.0 /
+      double(Clock::QueryHostTickFrequency()) / double(frames);
+  TitleProfile profile;
+  // Not overwriting a profile that can't be parsed.
+  if (!profile.Load(path)) {
+    XELOGE("Failed to load the title profile {}", xe::path_to_utf8(path));
+    return;
+  }
+  profile.Record(title_profile_options_, frames, frame_time_ms);
+  if (!profile.Save(path)) {
+    XELOGE("Failed to save the title profile {}", xe::path_to_utf8(path));
+  }
+}
+
+std::filesystem::path Emulator::GetBootSnapshotPath(
+    const kernel::UserModule* module) const {
+  std::string fingerprint_data = XE_BUILD_COMMIT;
+  fingerprint_data += '\n';
+  if (cvar::ConfigVars) {
+    for (const auto& config_var : *cvar::ConfigVars) {
+      if (config_var.second->is_transient() ||
+          config_var.first == "boot_snapshot" ||
+          config_var.first == "boot_snapshot_frame") {
+        continue;
+      }
+      fingerprint_data += config_var.first;
+      fingerprint_data += '=';
+      fingerprint_data += config_var.second->config_value();
+      fingerprint_data += '\n';
+    }
+  }
+  // Only the global configuration values are in the variables, the game
+  // configuration overriding them is taken as a whole.
+  std::filesystem::path game_config_path =
+      config::GetGameConfigPath(fmt::format("{:08X}", module->title_id()));
+  auto game_config = MappedMemory::Open(game_config_path,
+                                        MappedMemory::Mode::kRead);
+  if (game_config) {
+    fingerprint_data.append(reinterpret_cast<const char*>(game_config->data()),
+                            game_config->size());
+  }
+  return cache_root_ / "snapshots" /
+         fmt::format("{:08X}_{:016X}_{:016X}.xsav", module->title_id(),
+                     module->hash().value_or(0),
+                     XXH3_64bits(fingerprint_data.data(),
+                                 fingerprint_data.size()));
+}
+
 std::string Emulator::FindLaunchModule() {
   std::string path("game:\\");
 
@@ -1382,6 +1835,8 @@ X_STATUS Emulator::CompleteLaunch(const std::filesystem::path& path,
   auto xam = kernel_state()->GetKernelModule<kernel::xam::XamModule>("xam.xex");
 
   XELOGI("Loading module {}", module_path);
+  StartupTimeline::ScopedStage load_stage(startup_timeline_.get(),
+                                         "Module load");
   auto module = kernel_state_->LoadUserModule(module_path);
   if (!module) {
     XELOGE("Failed to load user module {}", path);
@@ -1393,18 +1848,72 @@ X_STATUS Emulator::CompleteLaunch(const std::filesystem::path& path,
     XELOGE("Failed to load user module {}", path);
     return X_STATUS_NOT_SUPPORTED;
   }
+  load_stage.End();
+
+  if (module->title_id()) {
+    // Load the per-game configuration file and make sure updates are handled
+    // by the callbacks. Before the title update and the shader storage, which
+    // the per-game configuration may change the behavior of.
+    config::LoadGameConfig(fmt::format("{:08X}", module->title_id()));
+    ApplyTitleProfile(module->title_id());
+    assert_true(game_config_load_callback_loop_next_index_ == SIZE_MAX);
+    game_config_load_callback_loop_next_index_ = 0;
+    while (game_config_load_callback_loop_next_index_ <
+           game_config_load_callbacks_.size()) {
+      game_config_load_callbacks_[game_config_load_callback_loop_next_index_++]
+          ->PostGameConfigLoad();
+    }
+    game_config_load_callback_loop_next_index_ = SIZE_MAX;
+  }
 
+  // Only needs the title ID, so the shader storage is loaded on the GPU
+  // command processor thread while the module is prepared. It's still waited
+  // for before launching, so the user doesn't miss the initial seconds - for
+  // instance, sound from an intro video may start playing before the video can
+  // be seen otherwise.
+  on_shader_storage_initialization(true);
+  size_t shader_storage_stage = startup_timeline_->BeginStage("Shader storage");
+  graphics_system_->BeginShaderStorageInitialization(cache_root_,
+                                                     module->title_id());
+  auto wait_for_shader_storage = [this, shader_storage_stage]() {
+    graphics_system_->WaitForShaderStorageInitialization();
+    startup_timeline_->EndStage(shader_storage_stage);
+    on_shader_storage_initialization(false);
+  };
+
+  StartupTimeline::ScopedStage title_update_stage(startup_timeline_.get(),
+                                                 "Title update");
   X_RESULT result = kernel_state_->ApplyTitleUpdate(module);
   if (XFAILED(result)) {
     XELOGE("Failed to apply title update! Cannot run module {}", path);
+    wait_for_shader_storage();
     return result;
   }
+  title_update_stage.End();
 
+  StartupTimeline::ScopedStage finish_load_stage(startup_timeline_.get(),
+                                                "Module preparation");
   result = kernel_state_->FinishLoadingUserModule(module);
   if (XFAILED(result)) {
     XELOGE("Failed to initialize user module {}", path);
+    wait_for_shader_storage();
     return result;
   }
+  finish_load_stage.End();
+
+  std::filesystem::path boot_snapshot_path;
+  bool restore_boot_snapshot = false;
+  boot_snapshot_path_.clear();
+  boot_snapshot_frames_left_.store(0, std::memory_order_relaxed);
+  if (cvars::boot_snapshot && !cache_root_.empty()) {
+    boot_snapshot_path = GetBootSnapshotPath(module.get());
+    restore_boot_snapshot = std::filesystem::exists(boot_snapshot_path);
+    if (!restore_boot_snapshot && cvars::boot_snapshot_frame) {
+      boot_snapshot_path_ = boot_snapshot_path;
+      boot_snapshot_frames_left_.store(cvars::boot_snapshot_frame,
+                                       std::memory_order_relaxed);
+    }
+  }
   // Grab the current title ID.
   xex2_opt_execution_info* info = nullptr;
   uint32_t workspace_address = 0;
@@ -1429,20 +1938,8 @@ X_STATUS Emulator::CompleteLaunch(const std::filesystem::path& path,
 
   // Try and load the resource database (xex only).
   if (module->title_id()) {
-    auto title_id = fmt::format("{:08X}", module->title_id());
-
-    // Load the per-game configuration file and make sure updates are handled
-    // by the callbacks.
-    config::LoadGameConfig(title_id);
-    assert_true(game_config_load_callback_loop_next_index_ == SIZE_MAX);
-    game_config_load_callback_loop_next_index_ = 0;
-    while (game_config_load_callback_loop_next_index_ <
-           game_config_load_callbacks_.size()) {
-      game_config_load_callbacks_[game_config_load_callback_loop_next_index_++]
-          ->PostGameConfigLoad();
-    }
-    game_config_load_callback_loop_next_index_ = SIZE_MAX;
-
+    StartupTimeline::ScopedStage title_info_stage(startup_timeline_.get(),
+                                                 "Title information");
     const kernel::util::XdbfGameData db = kernel_state_->module_xdbf(module);
 
     game_info_database_ = std::make_unique<kernel::util::GameInfoDatabase>(&db);
@@ -1520,14 +2017,7 @@ X_STATUS Emulator::CompleteLaunch(const std::filesystem::path& path,
     }
   }
 
-  // Initializing the shader storage in a blocking way so the user doesn't
-  // miss the initial seconds - for instance, sound from an intro video may
-  // start playing before the video can be seen if doing this in parallel with
-  // the main thread.
-  on_shader_storage_initialization(true);
-  graphics_system_->InitializeShaderStorage(cache_root_, title_id_.value(),
-                                            true);
-  on_shader_storage_initialization(false);
+  wait_for_shader_storage();
 
   auto main_thread = kernel_state_->LaunchModule(module);
   if (!main_thread) {
@@ -1536,6 +2026,18 @@ X_STATUS Emulator::CompleteLaunch(const std::filesystem::path& path,
   main_thread_ = main_thread;
   on_launch(title_id_.value(), title_name_);
 
+  if (restore_boot_snapshot) {
+    // The title is booted first, so its state can be replaced.
+    XELOGI("Restoring the boot snapshot {}",
+           xe::path_to_utf8(boot_snapshot_path));
+    if (!RestoreFromFile(boot_snapshot_path)) {
+      // Taken again on the next launch.
+      XELOGE("Failed to restore the boot snapshot, removing it");
+      std::error_code error_code;
+      std::filesystem::remove(boot_snapshot_path, error_code);
+    }
+  }
+
   // Plugins must be loaded after calling LaunchModule() and
   // FinishLoadingUserModule() which will apply TUs and patching to the main
   // xex.
@@ -10,16 +10,22 @@
 #ifndef XENIA_EMULATOR_H_
 #define XENIA_EMULATOR_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
 
 #include "xenia/apu/audio_media_player.h"
+#include "xenia/base/benchmark.h"
 #include "xenia/base/delegate.h"
 #include "xenia/base/exception_handler.h"
+#include "xenia/base/frame_timeline.h"
+#include "xenia/base/startup_timeline.h"
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/util/game_info_database.h"
 #include "xenia/kernel/util/xlast.h"
@@ -139,6 +145,29 @@ class Emulator {
   // Virtualized processor that can execute PPC code.
   cpu::Processor* processor() const { return processor_.get(); }
 
+  // Breakdown of the host time spent on each guest frame.
+  FrameTimeline* frame_timeline() const { return frame_timeline_.get(); }
+
+  // Stages of the startup up to the first guest frame.
+  StartupTimeline* startup_timeline() const {
+    return startup_timeline_.get();
+  }
+  // Logs the startup timeline, and writes it to startup_timeline_path, once
+  // the first guest frame is reached.
+  void ReportStartupTimeline();
+  // Called at every guest frame boundary, takes the boot snapshot of the title
+  // at the frame set by boot_snapshot_frame.
+  void UpdateBootSnapshot();
+
+  // Measurement of benchmark_frames guest frames, null if not benchmarking.
+  Benchmark* benchmark() const { return benchmark_.get(); }
+  // Called at every guest frame boundary, writes the benchmark report and
+  // invokes on_benchmark_complete once all the frames have been measured.
+  void UpdateBenchmark();
+  // Called at every guest frame boundary, measures the frame time of the title
+  // for its profile with title_profiles.
+  void UpdateTitleProfile();
+
   // Audio hardware emulation for decoding and playback.
   apu::AudioSystem* audio_system() const { return audio_system_.get(); }
 
@@ -267,7 +296,10 @@ class Emulator {
   void Pause();
   void Resume();
   bool is_paused() const { return paused_; }
-  bool SaveToFile(const std::filesystem::path& path);
+  // An incremental snapshot only contains the guest memory pages changed since
+  // the previous snapshot saved or restored, and refers to that snapshot's
+  // file, which must be kept to restore it.
+  bool SaveToFile(const std::filesystem::path& path, bool incremental = false);
   bool RestoreFromFile(const std::filesystem::path& path);
 
   // The game can request another title to be loaded.
@@ -279,6 +311,7 @@ class Emulator {
   xe::Delegate<uint32_t, const std::string_view> on_launch;
   xe::Delegate<bool> on_shader_storage_initialization;
   xe::Delegate<> on_patch_apply;
+  xe::Delegate<> on_benchmark_complete;
   xe::Delegate<> on_terminate;
   xe::Delegate<> on_exit;
 
@@ -293,6 +326,18 @@ class Emulator {
   void RemoveGameConfigLoadCallback(GameConfigLoadCallback* callback);
 
   std::string FindLaunchModule();
+  // Specific to the title, the title update, the configuration and the build
+  // of the emulator, as the snapshot can be restored only in the same
+  // conditions it was taken in.
+  std::filesystem::path GetBootSnapshotPath(
+      const kernel::UserModule* module) const;
+
+  // With title_profiles, applies the fastest known configuration of the
+  // performance options not set by the game configuration of the title, and
+  // starts measuring the frame time with the resulting values.
+  void ApplyTitleProfile(uint32_t title_id);
+  // Adds the measurement of the current run to the profile of the title.
+  void RecordTitleProfile();
 
   X_STATUS CompleteLaunch(const std::filesystem::path& path,
                           const std::string_view module_path);
@@ -323,6 +368,19 @@ class Emulator {
 
   std::unique_ptr<kernel::KernelState> kernel_state_;
 
+  std::unique_ptr<FrameTimeline> frame_timeline_;
+  std::unique_ptr<StartupTimeline> startup_timeline_;
+  std::unique_ptr<Benchmark> benchmark_;
+
+  // Measurement of the running title for its profile, empty path if not
+  // profiling.
+  std::mutex title_profile_mutex_;
+  std::filesystem::path title_profile_path_;
+  std::map<std::string, std::string> title_profile_options_;
+  uint64_t title_profile_frame_boundaries_ = 0;
+  uint64_t title_profile_start_ticks_ = 0;
+  uint64_t title_profile_last_ticks_ = 0;
+
   // Accessible only from the thread that invokes those callbacks (the UI thread
   // if the UI is available).
   std::vector<GameConfigLoadCallback*> game_config_load_callbacks_;
@@ -340,6 +398,11 @@ class Emulator {
   bool paused_;
   bool restoring_;
   threading::Fence restore_fence_;  // Fired on restore finish.
+  // Last snapshot saved or restored, which incremental ones are based on.
+  std::filesystem::path last_snapshot_path_;
+  // Where the boot snapshot is saved, empty if it's not being taken.
+  std::filesystem::path boot_snapshot_path_;
+  std::atomic<uint32_t> boot_snapshot_frames_left_{0};
 };
 
 }  // namespace xe
@@ -9,10 +9,12 @@
 
 #include "xenia/gpu/command_processor.h"
 
+#include <algorithm>
 #include <cinttypes>
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/byte_stream.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/profiling.h"
@@ -65,9 +67,21 @@ DEFINE_bool(
     "mid-frame synchronization, so it has a huge performance impact.",
     "GPU");
 
+DEFINE_bool(
+    readback_async, false,
+    "[D3D12 Only] With readback_resolve, don't wait for the GPU on every "
+    "resolve and memory export. The data is written to guest memory once the "
+    "GPU is done with it, at the latest before the next fence or interrupt "
+    "the guest may wait for. Much faster, but games reading the data on the "
+    "CPU without waiting for the GPU may see it late.",
+    "GPU");
+
 namespace xe {
 namespace gpu {
 
+static xe::counters::Counter& busy_time_counter =
+    xe::counters::GetCounter("gpu/command_processor/busy_us");
+
 // This should be written completely differently with support for different
 // types.
 void SaveGPUSetting(GPUSetting setting, uint64_t value) {
@@ -223,6 +237,7 @@ void CommandProcessor::RestoreRegisters(uint32_t first_register,
   } else {
     std::memcpy(register_file_->values + first_register, register_values,
                 sizeof(uint32_t) * register_count);
+    register_file_->MarkRangeDirty(first_register, register_count);
   }
 }
 
@@ -288,6 +303,7 @@ void CommandProcessor::WorkerThreadMain() {
           const int wait_time_ms = 2;
           xe::threading::Wait(write_ptr_index_event_.get(), true,
                               std::chrono::milliseconds(wait_time_ms));
+          UpdateWhileWaiting();
         } else {
           xe::threading::MaybeYield();
         }
@@ -304,7 +320,10 @@ void CommandProcessor::WorkerThreadMain() {
     assert_true(read_ptr_index_ != write_ptr_index);
 
     // Execute. Note that we handle wraparound transparently.
-    read_ptr_index_ = ExecutePrimaryBuffer(read_ptr_index_, write_ptr_index);
+    {
+      xe::counters::ScopedTimer busy_timer(busy_time_counter);
+      read_ptr_index_ = ExecutePrimaryBuffer(read_ptr_index_, write_ptr_index);
+    }
 
     // TODO(benvanik): use reader->Read_update_freq_ and only issue after moving
     //     that many indices.
@@ -632,6 +651,7 @@ void CommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
 
   if (XE_LIKELY(index < RegisterFile::kRegisterCount)) {
     register_file_->values[index] = value;
+    register_file_->MarkDirty(index);
 
     // quick pre-test
     // todo: figure out just how unlikely this is. if very (it ought to be,
@@ -661,19 +681,53 @@ void CommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
 void CommandProcessor::WriteRegistersFromMem(uint32_t start_index,
                                              uint32_t* base,
                                              uint32_t num_registers) {
-  for (uint32_t i = 0; i < num_registers; ++i) {
-    uint32_t data = xe::load_and_swap<uint32_t>(base + i);
-    this->WriteRegister(start_index + i, data);
+  if (start_index >= RegisterFile::kRegisterCount ||
+      RegisterFile::kRegisterCount - start_index < num_registers) {
+    // Let WriteRegister report the out of bounds writes.
+    for (uint32_t i = 0; i < num_registers; ++i) {
+      uint32_t data = xe::load_and_swap<uint32_t>(base + i);
+      this->WriteRegister(start_index + i, data);
+    }
+    return;
+  }
+  uint32_t end_index = start_index + num_registers;
+  // Only the registers between the scratch registers and the gamma ramp may
+  // need special handling - bulk copy the rest, marking the blocks as dirty
+  // for the constant upload.
+  if (start_index < XE_GPU_REG_SCRATCH_REG0) {
+    uint32_t count =
+        std::min(end_index, uint32_t(XE_GPU_REG_SCRATCH_REG0)) - start_index;
+    register_file_->WriteRangeFromGuest(start_index, base, count);
+    start_index += count;
+    base += count;
+  }
+  for (; start_index < end_index &&
+         start_index <= XE_GPU_REG_DC_LUT_30_COLOR;
+       ++start_index, ++base) {
+    this->WriteRegister(start_index, xe::load_and_swap<uint32_t>(base));
+  }
+  if (start_index < end_index) {
+    register_file_->WriteRangeFromGuest(start_index, base,
+                                        end_index - start_index);
   }
 }
 
 void CommandProcessor::WriteRegisterRangeFromRing(xe::RingBuffer* ring,
                                                   uint32_t base,
                                                   uint32_t num_registers) {
-  for (uint32_t i = 0; i < num_registers; ++i) {
-    uint32_t data = ring->ReadAndSwap<uint32_t>();
-    WriteRegister(base + i, data);
+  RingBuffer::ReadRange range =
+      ring->BeginRead(num_registers * sizeof(uint32_t));
+  uint32_t first_count = uint32_t(range.first_length / sizeof(uint32_t));
+  WriteRegistersFromMem(
+      base, reinterpret_cast<uint32_t*>(const_cast<uint8_t*>(range.first)),
+      first_count);
+  if (range.second) {
+    WriteRegistersFromMem(
+        base + first_count,
+        reinterpret_cast<uint32_t*>(const_cast<uint8_t*>(range.second)),
+        num_registers - first_count);
   }
+  ring->EndRead(range);
 }
 
 void CommandProcessor::WriteALURangeFromRing(xe::RingBuffer* ring,
@@ -783,6 +837,23 @@ void CommandProcessor::MakeCoherent() {
   regs_volatile[XE_GPU_REG_COHER_STATUS_HOST] = 0;
 }
 
+const char* CommandProcessor::GetGpuTimingKindName(GpuTiming::Kind kind) {
+  switch (kind) {
+    case GpuTiming::Kind::kDraw:
+      return "draw";
+    case GpuTiming::Kind::kResolve:
+      return "resolve";
+    case GpuTiming::Kind::kEdramTransfer:
+      return "edram_transfer";
+    case GpuTiming::Kind::kTextureLoad:
+      return "texture_load";
+    case GpuTiming::Kind::kPresenterEffect:
+      return "presenter_effect";
+    default:
+      return "unknown";
+  }
+}
+
 void CommandProcessor::PrepareForWait() { trace_writer_.Flush(); }
 
 void CommandProcessor::ReturnFromWait() {}
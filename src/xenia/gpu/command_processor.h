@@ -120,6 +120,39 @@ class CommandProcessor {
   virtual void InitializeShaderStorage(const std::filesystem::path& cache_root,
                                        uint32_t title_id, bool blocking);
 
+  // Cumulative host cache usage, for benchmarking and diagnostics.
+  struct CacheStatistics {
+    uint64_t texture_hits = 0;
+    uint64_t texture_misses = 0;
+  };
+  virtual CacheStatistics GetCacheStatistics() const { return {}; }
+
+  // Host GPU time of a guest operation, measured with gpu_timestamps.
+  struct GpuTiming {
+    enum class Kind : uint32_t {
+      kDraw,
+      kResolve,
+      kEdramTransfer,
+      kTextureLoad,
+      kPresenterEffect,
+
+      kCount,
+    };
+    Kind kind;
+    // Guest physical address of the PM4 packet the operation was done for.
+    uint32_t packet_address;
+    // Ucode hashes of the shaders of a draw, 0 for other operations.
+    uint64_t vertex_shader_hash;
+    uint64_t pixel_shader_hash;
+    uint64_t frame;
+    double gpu_us;
+  };
+  static const char* GetGpuTimingKindName(GpuTiming::Kind kind);
+  // Awaits the GPU work submitted so far, and appends the timings completed
+  // since the previous call to the vector. The timings are only collected
+  // after the first call. Must be called on the command processor thread.
+  virtual void TakeGpuTimings(std::vector<GpuTiming>& timings_out) {}
+
   virtual void RequestFrameTrace(const std::filesystem::path& root_path);
   virtual void BeginTracing(const std::filesystem::path& root_path);
   virtual void EndTracing();
@@ -134,6 +167,10 @@ class CommandProcessor {
       const reg::DC_LUT_PWL_DATA* new_gamma_ramp_pwl_rgb,
       uint32_t new_gamma_ramp_rw_component);
   virtual void RestoreEdramSnapshot(const void* snapshot) = 0;
+  // Downloads xenos::kEdramSizeBytes of the current EDRAM contents in the
+  // format of RestoreEdramSnapshot, for trace playback checkpoints. Returns
+  // false if not supported. Must be called on the command processor thread.
+  virtual bool SaveEdramSnapshot(void* snapshot_out) { return false; }
 
   void InitializeRingBuffer(uint32_t ptr, uint32_t size_log2);
   void EnableReadPointerWriteBack(uint32_t ptr, uint32_t block_size_log2);
@@ -227,8 +264,36 @@ class CommandProcessor {
   virtual void MakeCoherent();
   virtual void PrepareForWait();
   virtual void ReturnFromWait();
+  uint32_t GetCurrentPacketPhysicalAddress() const {
+    return uint32_t(current_packet_ptr_ -
+                    reinterpret_cast<uintptr_t>(memory_->TranslatePhysical(0)));
+  }
+  // Called periodically while waiting for new commands, to complete the
+  // asynchronous work the guest may be polling for.
+  virtual void UpdateWhileWaiting() {}
 
   virtual void OnPrimaryBufferEnd() {}
+  // Called before writing a value the guest may wait for, such as a fence, or
+  // raising an interrupt, to make the results of the earlier commands visible
+  // to the guest CPU.
+  virtual void PrepareForGuestFence() {}
+  // Writes a value the guest may wait for, already in the guest byte order,
+  // once the results of the earlier commands are visible to the guest CPU.
+  // Implementations tracking the completion of the host submissions may defer
+  // the write instead of awaiting the earlier commands.
+  virtual void WriteGuestFence(uint32_t* destination, uint32_t value) {
+    PrepareForGuestFence();
+    xe::store(destination, value);
+  }
+
+  // Host occlusion queries with query_occlusion_host. The sample counts of the
+  // query ended by EndOcclusionQuery must be written to the guest
+  // xe_gpu_depth_sample_counts at the address later. If either returns false,
+  // the fake sample counts are used.
+  virtual bool BeginOcclusionQuery() { return false; }
+  virtual bool EndOcclusionQuery(uint32_t sample_counts_address) {
+    return false;
+  }
 
 #include "pm4_command_processor_declare.h"
 
@@ -284,6 +349,8 @@ class CommandProcessor {
 
   uint32_t read_ptr_index_ = 0;
   uint32_t read_ptr_update_freq_ = 0;
+  // Host address of the type 3 packet being executed.
+  uintptr_t current_packet_ptr_ = 0;
   uint32_t read_ptr_writeback_ptr_ = 0;
 
   std::unique_ptr<xe::threading::Event> write_ptr_index_event_;
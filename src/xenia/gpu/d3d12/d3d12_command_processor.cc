@@ -13,6 +13,7 @@
 #include <sstream>
 #include <utility>
 #include "xenia/base/assert.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/byte_order.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
@@ -38,7 +39,26 @@ DEFINE_bool(d3d12_submit_on_primary_buffer_end, true,
             "possible to submit immediately to try to reduce frame latency.",
             "D3D12");
 
+DEFINE_bool(d3d12_pipelined_submission, false,
+            "Replay the recorded command lists and submit them to the GPU on a "
+            "separate thread, so the processing of the next guest commands can "
+            "continue meanwhile. May improve performance in CPU-bound games.",
+            "D3D12");
+
+DEFINE_bool(d3d12_merge_draws, false,
+            "Execute consecutive draws with no state changes between them as "
+            "one ExecuteIndirect to reduce the driver overhead in games "
+            "issuing many similar draws, such as with particles or UI.",
+            "D3D12");
+
+DEFINE_bool(d3d12_enhanced_barriers, false,
+            "Use enhanced barriers where available, with the synchronization "
+            "scopes narrower than those of the legacy resource states, to let "
+            "the GPU overlap more work submitted before and after barriers.",
+            "D3D12");
+
 DECLARE_bool(clear_memory_page_state);
+DECLARE_bool(readback_async);
 
 namespace xe {
 namespace gpu {
@@ -54,6 +74,13 @@ namespace shaders {
 #include "xenia/gpu/shaders/bytecode/d3d12_5_1/fxaa_extreme_cs.h"
 }  // namespace shaders
 
+static xe::counters::Counter& host_gpu_wait_time_counter =
+    xe::counters::GetCounter("gpu/host_gpu_wait_us");
+static xe::counters::Counter& deferred_guest_fences_counter =
+    xe::counters::GetCounter("gpu/deferred_guest_fences");
+static xe::counters::Counter& split_submissions_counter =
+    xe::counters::GetCounter("gpu/split_submissions");
+
 D3D12CommandProcessor::D3D12CommandProcessor(
     D3D12GraphicsSystem* graphics_system, kernel::KernelState* kernel_state)
     : CommandProcessor(graphics_system, kernel_state),
@@ -71,6 +98,27 @@ void D3D12CommandProcessor::InitializeShaderStorage(
   pipeline_cache_->InitializeShaderStorage(cache_root, title_id, blocking);
 }
 
+CommandProcessor::CacheStatistics
+D3D12CommandProcessor::GetCacheStatistics() const {
+  CacheStatistics statistics;
+  if (texture_cache_) {
+    statistics.texture_hits = texture_cache_->texture_hit_count();
+    statistics.texture_misses = texture_cache_->texture_miss_count();
+  }
+  return statistics;
+}
+
+void D3D12CommandProcessor::TakeGpuTimings(
+    std::vector<GpuTiming>& timings_out) {
+  gpu_timings_taken_ = true;
+  if (!gpu_timestamp_ranges_pending_.empty()) {
+    CheckSubmissionFence(gpu_timestamp_ranges_pending_.back().submission);
+  }
+  timings_out.insert(timings_out.end(), gpu_timings_completed_.cbegin(),
+                     gpu_timings_completed_.cend());
+  gpu_timings_completed_.clear();
+}
+
 void D3D12CommandProcessor::RequestFrameTrace(
     const std::filesystem::path& root_path) {
   // Capture with PIX if attached.
@@ -95,6 +143,15 @@ void D3D12CommandProcessor::RestoreEdramSnapshot(const void* snapshot) {
   render_target_cache_->RestoreEdramSnapshot(snapshot);
 }
 
+bool D3D12CommandProcessor::SaveEdramSnapshot(void* snapshot_out) {
+  if (!BeginSubmission(false) ||
+      !render_target_cache_->InitializeTraceSubmitDownloads()) {
+    return false;
+  }
+  AwaitAllQueueOperationsCompletion();
+  return render_target_cache_->CompleteEdramSnapshotDownload(snapshot_out);
+}
+
 bool D3D12CommandProcessor::PushTransitionBarrier(
     ID3D12Resource* resource, D3D12_RESOURCE_STATES old_state,
     D3D12_RESOURCE_STATES new_state, UINT subresource) {
@@ -131,12 +188,350 @@ void D3D12CommandProcessor::PushUAVBarrier(ID3D12Resource* resource) {
 }
 
 void D3D12CommandProcessor::SubmitBarriers() {
-  UINT barrier_count = UINT(barriers_.size());
-  if (barrier_count != 0) {
-    deferred_command_list_.D3DResourceBarrier(barrier_count, barriers_.data());
+  if (barriers_.empty()) {
+    return;
+  }
+  MergeBarriers();
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  if (command_list_7_ && ConvertBarriersToEnhanced()) {
+    deferred_command_list_.D3DBarrier(
+        UINT32(texture_barriers_.size()), texture_barriers_.data(),
+        UINT32(buffer_barriers_.size()), buffer_barriers_.data(),
+        UINT32(global_barriers_.size()), global_barriers_.data());
     barriers_.clear();
+    return;
+  }
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
+  deferred_command_list_.D3DResourceBarrier(UINT(barriers_.size()),
+                                            barriers_.data());
+  barriers_.clear();
+}
+
+void D3D12CommandProcessor::MergeBarriers() {
+  if (barriers_.size() < 2) {
+    return;
+  }
+  const D3D12_RESOURCE_STATES write_states =
+      D3D12_RESOURCE_STATE_RENDER_TARGET |
+      D3D12_RESOURCE_STATE_UNORDERED_ACCESS | D3D12_RESOURCE_STATE_DEPTH_WRITE |
+      D3D12_RESOURCE_STATE_STREAM_OUT | D3D12_RESOURCE_STATE_COPY_DEST |
+      D3D12_RESOURCE_STATE_RESOLVE_DEST;
+  merged_barriers_.clear();
+  for (const D3D12_RESOURCE_BARRIER& barrier : barriers_) {
+    if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV) {
+      // No work is done between the barriers in a batch, so one UAV barrier of
+      // a resource is enough, and a null one covers all resources.
+      bool uav_barrier_redundant = false;
+      for (const D3D12_RESOURCE_BARRIER& merged_barrier : merged_barriers_) {
+        if (merged_barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV &&
+            (!merged_barrier.UAV.pResource ||
+             merged_barrier.UAV.pResource == barrier.UAV.pResource)) {
+          uav_barrier_redundant = true;
+          break;
+        }
+      }
+      if (!uav_barrier_redundant) {
+        merged_barriers_.push_back(barrier);
+      }
+      continue;
+    }
+    if (barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION ||
+        barrier.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE) {
+      merged_barriers_.push_back(barrier);
+      continue;
+    }
+    ID3D12Resource* resource = barrier.Transition.pResource;
+    // Find the latest barrier involving the resource - only it can be merged
+    // with the new one without changing the order of the transitions.
+    auto previous_it = merged_barriers_.end();
+    for (auto it = merged_barriers_.end(); it != merged_barriers_.begin();) {
+      --it;
+      const D3D12_RESOURCE_BARRIER& previous = *it;
+      bool previous_involves_resource;
+      switch (previous.Type) {
+        case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+          previous_involves_resource =
+              previous.Transition.pResource == resource;
+          break;
+        case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+          previous_involves_resource =
+              previous.Aliasing.pResourceBefore == resource ||
+              previous.Aliasing.pResourceAfter == resource;
+          break;
+        case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+          previous_involves_resource = previous.UAV.pResource == resource;
+          break;
+        default:
+          previous_involves_resource = true;
+      }
+      if (previous_involves_resource) {
+        previous_it = it;
+        break;
+      }
+    }
+    if (previous_it != merged_barriers_.end()) {
+      D3D12_RESOURCE_BARRIER& previous = *previous_it;
+      if (previous.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV) {
+        // A transition from the unordered access state waits for the
+        // unordered access writes too.
+        if (barrier.Transition.StateBefore &
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS) {
+          merged_barriers_.erase(previous_it);
+        }
+      } else if (previous.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION &&
+                 previous.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE &&
+                 previous.Transition.Subresource ==
+                     barrier.Transition.Subresource &&
+                 previous.Transition.StateAfter ==
+                     barrier.Transition.StateBefore) {
+        D3D12_RESOURCE_STATES state_before = previous.Transition.StateBefore;
+        D3D12_RESOURCE_STATES state_after = barrier.Transition.StateAfter;
+        if (state_before != state_after) {
+          // A -> B -> C to A -> C.
+          previous.Transition.StateAfter = state_after;
+          continue;
+        }
+        if (state_before == D3D12_RESOURCE_STATE_UNORDERED_ACCESS) {
+          // The writes before and after the round trip still need to be
+          // ordered.
+          previous.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+          previous.UAV.pResource = resource;
+          continue;
+        }
+        if (state_before != D3D12_RESOURCE_STATE_COMMON &&
+            !(state_before & write_states)) {
+          // A read-only state to the same read-only state - nothing to wait
+          // for.
+          merged_barriers_.erase(previous_it);
+          continue;
+        }
+      }
+    }
+    merged_barriers_.push_back(barrier);
+  }
+  barriers_.swap(merged_barriers_);
+}
+
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+bool D3D12CommandProcessor::GetEnhancedBarrierScope(
+    D3D12_RESOURCE_STATES state, D3D12_BARRIER_SYNC& sync_out,
+    D3D12_BARRIER_ACCESS& access_out, D3D12_BARRIER_LAYOUT& layout_out) {
+  if (state == D3D12_RESOURCE_STATE_COMMON) {
+    // May be implicitly promoted to any state.
+    sync_out = D3D12_BARRIER_SYNC_ALL;
+    access_out = D3D12_BARRIER_ACCESS_COMMON;
+    layout_out = D3D12_BARRIER_LAYOUT_COMMON;
+    return true;
+  }
+  struct StateScope {
+    D3D12_RESOURCE_STATES state;
+    D3D12_BARRIER_SYNC sync;
+    D3D12_BARRIER_ACCESS access;
+  };
+  static const StateScope kStateScopes[] = {
+      {D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+       D3D12_BARRIER_SYNC_ALL_SHADING,
+       D3D12_BARRIER_ACCESS_VERTEX_BUFFER |
+           D3D12_BARRIER_ACCESS_CONSTANT_BUFFER},
+      {D3D12_RESOURCE_STATE_INDEX_BUFFER, D3D12_BARRIER_SYNC_INDEX_INPUT,
+       D3D12_BARRIER_ACCESS_INDEX_BUFFER},
+      {D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_BARRIER_SYNC_RENDER_TARGET,
+       D3D12_BARRIER_ACCESS_RENDER_TARGET},
+      {D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+       D3D12_BARRIER_SYNC_ALL_SHADING |
+           D3D12_BARRIER_SYNC_CLEAR_UNORDERED_ACCESS_VIEW,
+       D3D12_BARRIER_ACCESS_UNORDERED_ACCESS},
+      {D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_BARRIER_SYNC_DEPTH_STENCIL,
+       D3D12_BARRIER_ACCESS_DEPTH_STENCIL_WRITE},
+      {D3D12_RESOURCE_STATE_DEPTH_READ, D3D12_BARRIER_SYNC_DEPTH_STENCIL,
+       D3D12_BARRIER_ACCESS_DEPTH_STENCIL_READ},
+      {D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+       D3D12_BARRIER_SYNC_NON_PIXEL_SHADING,
+       D3D12_BARRIER_ACCESS_SHADER_RESOURCE},
+      {D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+       D3D12_BARRIER_SYNC_PIXEL_SHADING, D3D12_BARRIER_ACCESS_SHADER_RESOURCE},
+      {D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+       D3D12_BARRIER_SYNC_EXECUTE_INDIRECT,
+       D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT},
+      {D3D12_RESOURCE_STATE_COPY_DEST, D3D12_BARRIER_SYNC_COPY,
+       D3D12_BARRIER_ACCESS_COPY_DEST},
+      {D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_BARRIER_SYNC_COPY,
+       D3D12_BARRIER_ACCESS_COPY_SOURCE},
+      {D3D12_RESOURCE_STATE_RESOLVE_DEST, D3D12_BARRIER_SYNC_RESOLVE,
+       D3D12_BARRIER_ACCESS_RESOLVE_DEST},
+      {D3D12_RESOURCE_STATE_RESOLVE_SOURCE, D3D12_BARRIER_SYNC_RESOLVE,
+       D3D12_BARRIER_ACCESS_RESOLVE_SOURCE},
+  };
+  D3D12_RESOURCE_STATES states_remaining = state;
+  D3D12_BARRIER_SYNC sync = D3D12_BARRIER_SYNC_NONE;
+  D3D12_BARRIER_ACCESS access = D3D12_BARRIER_ACCESS_COMMON;
+  for (const StateScope& state_scope : kStateScopes) {
+    if (state & state_scope.state) {
+      sync |= state_scope.sync;
+      access |= state_scope.access;
+      states_remaining &= ~state_scope.state;
+    }
+  }
+  if (states_remaining) {
+    // Stream output, video, ray tracing or shading rate.
+    return false;
+  }
+  const D3D12_RESOURCE_STATES shader_resource_states =
+      D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE |
+      D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+  D3D12_BARRIER_LAYOUT layout;
+  switch (state) {
+    case D3D12_RESOURCE_STATE_RENDER_TARGET:
+      layout = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
+      break;
+    case D3D12_RESOURCE_STATE_UNORDERED_ACCESS:
+      layout = D3D12_BARRIER_LAYOUT_UNORDERED_ACCESS;
+      break;
+    case D3D12_RESOURCE_STATE_DEPTH_WRITE:
+      layout = D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE;
+      break;
+    case D3D12_RESOURCE_STATE_COPY_DEST:
+      layout = D3D12_BARRIER_LAYOUT_COPY_DEST;
+      break;
+    case D3D12_RESOURCE_STATE_COPY_SOURCE:
+      layout = D3D12_BARRIER_LAYOUT_COPY_SOURCE;
+      break;
+    case D3D12_RESOURCE_STATE_RESOLVE_DEST:
+      layout = D3D12_BARRIER_LAYOUT_RESOLVE_DEST;
+      break;
+    case D3D12_RESOURCE_STATE_RESOLVE_SOURCE:
+      layout = D3D12_BARRIER_LAYOUT_RESOLVE_SOURCE;
+      break;
+    default:
+      if (state & (D3D12_RESOURCE_STATE_RENDER_TARGET |
+                   D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+                   D3D12_RESOURCE_STATE_DEPTH_WRITE |
+                   D3D12_RESOURCE_STATE_COPY_DEST |
+                   D3D12_RESOURCE_STATE_RESOLVE_DEST)) {
+        // A write state combined with other states.
+        return false;
+      }
+      if (state & D3D12_RESOURCE_STATE_DEPTH_READ) {
+        if (state & ~(D3D12_RESOURCE_STATE_DEPTH_READ |
+                      shader_resource_states)) {
+          return false;
+        }
+        layout = D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_READ;
+      } else if (!(state & ~shader_resource_states)) {
+        layout = D3D12_BARRIER_LAYOUT_SHADER_RESOURCE;
+      } else {
+        layout = D3D12_BARRIER_LAYOUT_GENERIC_READ;
+      }
+  }
+  sync_out = sync;
+  access_out = access;
+  layout_out = layout;
+  return true;
+}
+
+bool D3D12CommandProcessor::ConvertBarriersToEnhanced() {
+  texture_barriers_.clear();
+  buffer_barriers_.clear();
+  global_barriers_.clear();
+  for (const D3D12_RESOURCE_BARRIER& barrier : barriers_) {
+    switch (barrier.Type) {
+      case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION: {
+        if (barrier.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE) {
+          return false;
+        }
+        D3D12_BARRIER_SYNC sync_before, sync_after;
+        D3D12_BARRIER_ACCESS access_before, access_after;
+        D3D12_BARRIER_LAYOUT layout_before, layout_after;
+        if (!GetEnhancedBarrierScope(barrier.Transition.StateBefore,
+                                     sync_before, access_before,
+                                     layout_before) ||
+            !GetEnhancedBarrierScope(barrier.Transition.StateAfter, sync_after,
+                                     access_after, layout_after)) {
+          return false;
+        }
+        ID3D12Resource* resource = barrier.Transition.pResource;
+        if (resource->GetDesc().Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+          D3D12_BUFFER_BARRIER& buffer_barrier =
+              buffer_barriers_.emplace_back();
+          buffer_barrier.SyncBefore = sync_before;
+          buffer_barrier.SyncAfter = sync_after;
+          buffer_barrier.AccessBefore = access_before;
+          buffer_barrier.AccessAfter = access_after;
+          buffer_barrier.pResource = resource;
+          buffer_barrier.Offset = 0;
+          buffer_barrier.Size = UINT64_MAX;
+        } else {
+          D3D12_TEXTURE_BARRIER& texture_barrier =
+              texture_barriers_.emplace_back();
+          texture_barrier.SyncBefore = sync_before;
+          texture_barrier.SyncAfter = sync_after;
+          texture_barrier.AccessBefore = access_before;
+          texture_barrier.AccessAfter = access_after;
+          texture_barrier.LayoutBefore = layout_before;
+          texture_barrier.LayoutAfter = layout_after;
+          texture_barrier.pResource = resource;
+          // With zero mip levels, the first is the subresource index, with
+          // UINT32_MAX (D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) meaning all.
+          texture_barrier.Subresources.IndexOrFirstMipLevel =
+              barrier.Transition.Subresource;
+          texture_barrier.Subresources.NumMipLevels = 0;
+          texture_barrier.Subresources.FirstArraySlice = 0;
+          texture_barrier.Subresources.NumArraySlices = 0;
+          texture_barrier.Subresources.FirstPlane = 0;
+          texture_barrier.Subresources.NumPlanes = 0;
+          texture_barrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+        }
+      } break;
+      case D3D12_RESOURCE_BARRIER_TYPE_UAV: {
+        ID3D12Resource* resource = barrier.UAV.pResource;
+        const D3D12_BARRIER_SYNC uav_sync =
+            D3D12_BARRIER_SYNC_ALL_SHADING |
+            D3D12_BARRIER_SYNC_CLEAR_UNORDERED_ACCESS_VIEW;
+        if (resource &&
+            resource->GetDesc().Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+          D3D12_BUFFER_BARRIER& buffer_barrier =
+              buffer_barriers_.emplace_back();
+          buffer_barrier.SyncBefore = uav_sync;
+          buffer_barrier.SyncAfter = uav_sync;
+          buffer_barrier.AccessBefore = D3D12_BARRIER_ACCESS_UNORDERED_ACCESS;
+          buffer_barrier.AccessAfter = D3D12_BARRIER_ACCESS_UNORDERED_ACCESS;
+          buffer_barrier.pResource = resource;
+          buffer_barrier.Offset = 0;
+          buffer_barrier.Size = UINT64_MAX;
+        } else {
+          // Texture barriers need the layout, which is not known here.
+          D3D12_GLOBAL_BARRIER& global_barrier =
+              global_barriers_.emplace_back();
+          global_barrier.SyncBefore = uav_sync;
+          global_barrier.SyncAfter = uav_sync;
+          global_barrier.AccessBefore = D3D12_BARRIER_ACCESS_UNORDERED_ACCESS;
+          global_barrier.AccessAfter = D3D12_BARRIER_ACCESS_UNORDERED_ACCESS;
+        }
+      } break;
+      case D3D12_RESOURCE_BARRIER_TYPE_ALIASING: {
+        // Only buffers are aliased currently (the scaled resolve buffers),
+        // which have no layout to discard.
+        ID3D12Resource* resource_before = barrier.Aliasing.pResourceBefore;
+        ID3D12Resource* resource_after = barrier.Aliasing.pResourceAfter;
+        if ((resource_before && resource_before->GetDesc().Dimension !=
+                                    D3D12_RESOURCE_DIMENSION_BUFFER) ||
+            (resource_after && resource_after->GetDesc().Dimension !=
+                                   D3D12_RESOURCE_DIMENSION_BUFFER)) {
+          return false;
+        }
+        D3D12_GLOBAL_BARRIER& global_barrier = global_barriers_.emplace_back();
+        global_barrier.SyncBefore = D3D12_BARRIER_SYNC_ALL;
+        global_barrier.SyncAfter = D3D12_BARRIER_SYNC_ALL;
+        global_barrier.AccessBefore = D3D12_BARRIER_ACCESS_COMMON;
+        global_barrier.AccessAfter = D3D12_BARRIER_ACCESS_COMMON;
+      } break;
+      default:
+        return false;
+    }
   }
+  return true;
 }
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
 
 ID3D12RootSignature* D3D12CommandProcessor::GetRootSignature(
     const DxbcShader* vertex_shader, const DxbcShader* pixel_shader,
@@ -852,6 +1247,17 @@ bool D3D12CommandProcessor::SetupContext() {
   command_list_->Close();
   // Optional - added in Creators Update (SDK 10.0.15063.0).
   command_list_->QueryInterface(IID_PPV_ARGS(&command_list_1_));
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  // Optional - requires the Agility SDK or Windows 11 and a recent driver.
+  if (cvars::d3d12_enhanced_barriers &&
+      provider.AreEnhancedBarriersSupported()) {
+    command_list_->QueryInterface(IID_PPV_ARGS(&command_list_7_));
+  }
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
+
+  if (cvars::d3d12_pipelined_submission) {
+    StartSubmissionThread();
+  }
 
   bindless_resources_used_ =
       cvars::d3d12_bindless &&
@@ -896,7 +1302,8 @@ bool D3D12CommandProcessor::SetupContext() {
   constant_buffer_pool_ = std::make_unique<ui::d3d12::D3D12UploadBufferPool>(
       provider,
       std::max(ui::d3d12::D3D12UploadBufferPool::kDefaultPageSize,
-               sizeof(float) * 4 * D3D12_REQ_CONSTANT_BUFFER_ELEMENT_COUNT));
+               sizeof(float) * 4 * D3D12_REQ_CONSTANT_BUFFER_ELEMENT_COUNT),
+      "d3d12/constants");
   if (bindless_resources_used_) {
     D3D12_DESCRIPTOR_HEAP_DESC view_bindless_heap_desc;
     view_bindless_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
@@ -1604,6 +2011,90 @@ bool D3D12CommandProcessor::SetupContext() {
                           uint32_t(SystemBindlessView::kGammaRampPWLSRV)));
   }
 
+  // With rasterizer-ordered views, depth and stencil are tested in the pixel
+  // shader, and the host queries would count the samples failing the tests.
+  if (cvars::query_occlusion_host &&
+      render_target_cache_->GetPath() !=
+          RenderTargetCache::Path::kPixelShaderInterlock) {
+    D3D12_QUERY_HEAP_DESC occlusion_query_heap_desc;
+    occlusion_query_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_OCCLUSION;
+    occlusion_query_heap_desc.Count = kOcclusionQueryCount;
+    occlusion_query_heap_desc.NodeMask = 0;
+    D3D12_RESOURCE_DESC occlusion_query_readback_buffer_desc;
+    ui::d3d12::util::FillBufferResourceDesc(
+        occlusion_query_readback_buffer_desc,
+        sizeof(uint64_t) * kOcclusionQueryCount, D3D12_RESOURCE_FLAG_NONE);
+    if (FAILED(device->CreateQueryHeap(
+            &occlusion_query_heap_desc,
+            IID_PPV_ARGS(&occlusion_query_heap_))) ||
+        FAILED(device->CreateCommittedResource(
+            &ui::d3d12::util::kHeapPropertiesReadback,
+            provider.GetHeapFlagCreateNotZeroed(),
+            &occlusion_query_readback_buffer_desc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+            IID_PPV_ARGS(&occlusion_query_readback_buffer_)))) {
+      XELOGE(
+          "Failed to create the host occlusion query heap or its readback "
+          "buffer, using fake sample counts");
+      ui::d3d12::util::ReleaseAndNull(occlusion_query_heap_);
+    }
+  }
+  if (cvars::d3d12_merge_draws) {
+    D3D12_INDIRECT_ARGUMENT_DESC draw_indexed_argument_desc;
+    draw_indexed_argument_desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+    D3D12_COMMAND_SIGNATURE_DESC draw_indexed_command_signature_desc;
+    draw_indexed_command_signature_desc.ByteStride =
+        sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+    draw_indexed_command_signature_desc.NumArgumentDescs = 1;
+    draw_indexed_command_signature_desc.pArgumentDescs =
+        &draw_indexed_argument_desc;
+    draw_indexed_command_signature_desc.NodeMask = 0;
+    if (FAILED(device->CreateCommandSignature(
+            &draw_indexed_command_signature_desc, nullptr,
+            IID_PPV_ARGS(&draw_indexed_command_signature_)))) {
+      XELOGE(
+          "Failed to create the indexed draw command signature, not merging "
+          "draws");
+    }
+  }
+  deferred_command_list_.SetMergeDraws(draw_indexed_command_signature_ !=
+                                       nullptr);
+
+  if (cvars::gpu_timestamps) {
+    D3D12_QUERY_HEAP_DESC gpu_timestamp_heap_desc;
+    gpu_timestamp_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    gpu_timestamp_heap_desc.Count = kGpuTimestampCount;
+    gpu_timestamp_heap_desc.NodeMask = 0;
+    D3D12_RESOURCE_DESC gpu_timestamp_readback_buffer_desc;
+    ui::d3d12::util::FillBufferResourceDesc(
+        gpu_timestamp_readback_buffer_desc,
+        sizeof(uint64_t) * kGpuTimestampCount, D3D12_RESOURCE_FLAG_NONE);
+    if (FAILED(provider.GetDirectQueue()->GetTimestampFrequency(
+            &gpu_timestamp_frequency_)) ||
+        !gpu_timestamp_frequency_ ||
+        FAILED(device->CreateQueryHeap(&gpu_timestamp_heap_desc,
+                                       IID_PPV_ARGS(&gpu_timestamp_heap_))) ||
+        FAILED(device->CreateCommittedResource(
+            &ui::d3d12::util::kHeapPropertiesReadback,
+            provider.GetHeapFlagCreateNotZeroed(),
+            &gpu_timestamp_readback_buffer_desc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+            IID_PPV_ARGS(&gpu_timestamp_readback_buffer_)))) {
+      XELOGE("Failed to set up the GPU timestamp queries");
+      ui::d3d12::util::ReleaseAndNull(gpu_timestamp_heap_);
+    }
+  }
+  gpu_timestamp_next_ = 0;
+  gpu_timestamps_used_ = 0;
+  gpu_timestamp_submission_count_ = 0;
+  gpu_timings_frame_ = 0;
+  gpu_timings_frame_us_.fill(0.0);
+
+  occlusion_query_next_part_ = 0;
+  occlusion_query_parts_used_ = 0;
+  occlusion_query_is_active_ = false;
+  occlusion_query_part_open_ = false;
+
   pix_capture_requested_.store(false, std::memory_order_relaxed);
   pix_capturing_ = false;
 
@@ -1616,9 +2107,36 @@ bool D3D12CommandProcessor::SetupContext() {
 void D3D12CommandProcessor::ShutdownContext() {
   AwaitAllQueueOperationsCompletion();
 
+  ShutdownSubmissionThread();
+
   ui::d3d12::util::ReleaseAndNull(readback_buffer_);
   readback_buffer_size_ = 0;
 
+  // All completed by AwaitAllQueueOperationsCompletion unless the device has
+  // been removed.
+  for (AsyncReadback& async_readback : async_readbacks_pending_) {
+    async_readback.buffer.buffer->Release();
+  }
+  async_readbacks_pending_.clear();
+  deferred_guest_fences_.clear();
+  for (AsyncReadbackBuffer& async_readback_buffer :
+       async_readback_buffers_free_) {
+    async_readback_buffer.buffer->Release();
+  }
+  async_readback_buffers_free_.clear();
+
+  occlusion_queries_pending_.clear();
+  ui::d3d12::util::ReleaseAndNull(occlusion_query_readback_buffer_);
+  ui::d3d12::util::ReleaseAndNull(occlusion_query_heap_);
+
+  deferred_command_list_.SetMergeDraws(false);
+  ui::d3d12::util::ReleaseAndNull(draw_indexed_command_signature_);
+
+  gpu_timestamp_ranges_pending_.clear();
+  gpu_timings_completed_.clear();
+  ui::d3d12::util::ReleaseAndNull(gpu_timestamp_readback_buffer_);
+  ui::d3d12::util::ReleaseAndNull(gpu_timestamp_heap_);
+
   ui::d3d12::util::ReleaseAndNull(scratch_buffer_);
   scratch_buffer_size_ = 0;
 
@@ -1686,6 +2204,9 @@ void D3D12CommandProcessor::ShutdownContext() {
   shared_memory_.reset();
 
   deferred_command_list_.Reset();
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  ui::d3d12::util::ReleaseAndNull(command_list_7_);
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
   ui::d3d12::util::ReleaseAndNull(command_list_1_);
   ui::d3d12::util::ReleaseAndNull(command_list_);
   ClearCommandAllocatorCache();
@@ -1748,6 +2269,7 @@ void D3D12CommandProcessor::WriteRegisterForceinline(uint32_t index,
   __m128i is_below_upper = _mm_cmplt_epi16(to_rangecheck, upper_bounds);
   __m128i is_within_range = _mm_and_si128(is_above_lower, is_below_upper);
   register_file_->values[index] = value;
+  register_file_->MarkDirty(index);
 
   uint32_t movmask = static_cast<uint32_t>(_mm_movemask_epi8(is_within_range));
 
@@ -2049,6 +2571,7 @@ D3D12CommandProcessor::WriteRegisterRangeFromMem_WithKnownBound(
     uint32_t start_index, uint32_t* base, uint32_t num_registers) {
   uint32_t end = start_index + num_registers;
   LogRegisterSets(start_index, base, num_registers);
+  register_file_->MarkRangeDirty(start_index, num_registers);
   uint32_t current_index = start_index;
 
   auto get_end_before_qty = [&end, current_index](uint32_t regnum) {
@@ -2195,6 +2718,9 @@ void D3D12CommandProcessor::IssueSwap(uint32_t frontbuffer_ptr,
         const ui::d3d12::D3D12Provider& provider = GetD3D12Provider();
         ID3D12Device* device = provider.GetDevice();
 
+        GpuTimestampRangeBegin presenter_effect_timestamps =
+            BeginGpuTimestampRange();
+
         SwapPostEffect swap_post_effect = GetActualSwapPostEffect();
         bool use_fxaa = swap_post_effect == SwapPostEffect::kFxaa ||
                         swap_post_effect == SwapPostEffect::kFxaaExtreme;
@@ -2500,13 +3026,39 @@ void D3D12CommandProcessor::IssueSwap(uint32_t frontbuffer_ptr,
         // presenter so it can submit its own commands for displaying it to the
         // queue.
         SubmitBarriers();
+        EndGpuTimestampRange(presenter_effect_timestamps,
+                             GpuTiming::Kind::kPresenterEffect);
         EndSubmission(true);
+        AwaitSubmissionThreadIdle();
         return true;
       });
 
   // End the frame even if did not present for any reason (the image refresher
   // was not called), to prevent leaking per-frame resources.
   EndSubmission(true);
+
+  AwaitOcclusionQueries(false);
+}
+
+void D3D12CommandProcessor::PrepareForWait() {
+  CommandProcessor::PrepareForWait();
+  // The guest may be polling for the occlusion query results without
+  // submitting anything else - let the GPU execute the queries.
+  // Same for the fences written after readbacks.
+  if (submission_open_ &&
+      ((!occlusion_queries_pending_.empty() &&
+        occlusion_queries_pending_.back().submission == submission_current_) ||
+       (!deferred_guest_fences_.empty() &&
+        deferred_guest_fences_.back().submission == submission_current_)) &&
+      CanEndSubmissionImmediately()) {
+    EndSubmission(false);
+  }
+}
+
+void D3D12CommandProcessor::UpdateWhileWaiting() {
+  if (!occlusion_queries_pending_.empty() || !deferred_guest_fences_.empty()) {
+    CheckSubmissionFence(0);
+  }
 }
 
 void D3D12CommandProcessor::OnPrimaryBufferEnd() {
@@ -2516,6 +3068,68 @@ void D3D12CommandProcessor::OnPrimaryBufferEnd() {
   }
 }
 
+void D3D12CommandProcessor::PrepareForGuestFence() {
+  if (!async_readbacks_pending_.empty()) {
+    CheckSubmissionFence(async_readbacks_pending_.back().submission);
+  }
+}
+
+void D3D12CommandProcessor::WriteGuestFence(uint32_t* destination,
+                                            uint32_t value) {
+  // Deferred fences are only pending along with readbacks of the same or later
+  // submissions.
+  assert_true(deferred_guest_fences_.empty() ||
+              !async_readbacks_pending_.empty());
+  if (async_readbacks_pending_.empty()) {
+    xe::store(destination, value);
+    return;
+  }
+  // Instead of awaiting the readbacks, let the guest see the value when they
+  // are completed. Later fences are deferred too, even if they're written to
+  // the same location, to keep the order of the writes.
+  DeferredGuestFence& deferred_guest_fence =
+      deferred_guest_fences_.emplace_back();
+  deferred_guest_fence.submission = async_readbacks_pending_.back().submission;
+  deferred_guest_fence.destination = destination;
+  deferred_guest_fence.value = value;
+  deferred_guest_fences_counter.Increment();
+}
+
+bool D3D12CommandProcessor::BeginOcclusionQuery() {
+  if (!occlusion_query_heap_ || !BeginSubmission(true)) {
+    return false;
+  }
+  if (occlusion_query_is_active_) {
+    // Begun again without ending - drop the previous query. Its host queries
+    // may be reused right away as the new results will be resolved later in
+    // the queue anyway.
+    EndOcclusionQueryPart();
+    occlusion_query_parts_used_ -= occlusion_query_active_.part_count;
+  }
+  occlusion_query_active_.sample_counts_address = 0;
+  occlusion_query_active_.first_part = occlusion_query_next_part_;
+  occlusion_query_active_.part_count = 0;
+  occlusion_query_is_active_ = true;
+  return BeginOcclusionQueryPart();
+}
+
+bool D3D12CommandProcessor::EndOcclusionQuery(uint32_t sample_counts_address) {
+  if (!occlusion_query_is_active_ || !BeginSubmission(true)) {
+    return false;
+  }
+  // Opening a new submission begins a new part, but it may also fail to.
+  if (!occlusion_query_is_active_) {
+    return false;
+  }
+  EndOcclusionQueryPart();
+  occlusion_query_active_.sample_counts_address = sample_counts_address;
+  occlusion_query_active_.submission = submission_current_;
+  occlusion_query_active_.frame = frame_current_;
+  occlusion_queries_pending_.push_back(occlusion_query_active_);
+  occlusion_query_is_active_ = false;
+  return true;
+}
+
 Shader* D3D12CommandProcessor::LoadShader(xenos::ShaderType shader_type,
                                           uint32_t guest_address,
                                           const uint32_t* host_address,
@@ -2628,9 +3242,13 @@ bool D3D12CommandProcessor::IssueDraw(xenos::PrimitiveType primitive_type,
       pixel_shader ? draw_util::GetNormalizedColorMask(
                          regs, pixel_shader->writes_color_targets())
                    : 0;
-  if (!render_target_cache_->Update(is_rasterization_done,
-                                    normalized_depth_control,
-                                    normalized_color_mask, *vertex_shader)) {
+  GpuTimestampRangeBegin edram_transfer_timestamps = BeginGpuTimestampRange();
+  bool render_targets_updated = render_target_cache_->Update(
+      is_rasterization_done, normalized_depth_control, normalized_color_mask,
+      *vertex_shader);
+  EndGpuTimestampRange(edram_transfer_timestamps,
+                       GpuTiming::Kind::kEdramTransfer);
+  if (!render_targets_updated) {
     return false;
   }
 
@@ -2676,7 +3294,9 @@ bool D3D12CommandProcessor::IssueDraw(xenos::PrimitiveType primitive_type,
       (pixel_shader != nullptr
            ? pixel_shader->GetUsedTextureMaskAfterTranslation()
            : 0);
+  GpuTimestampRangeBegin texture_load_timestamps = BeginGpuTimestampRange();
   texture_cache_->RequestTextures(used_texture_mask);
+  EndGpuTimestampRange(texture_load_timestamps, GpuTiming::Kind::kTextureLoad);
 
   // Bind the pipeline after configuring it and doing everything that may bind
   // other pipelines.
@@ -2896,6 +3516,7 @@ bool D3D12CommandProcessor::IssueDraw(xenos::PrimitiveType primitive_type,
   // Must not call anything that may change the primitive topology from now on!
 
   // Draw.
+  GpuTimestampRangeBegin draw_timestamps = BeginGpuTimestampRange();
   if (primitive_processing_result.index_buffer_type ==
       PrimitiveProcessor::ProcessedIndexBufferType::kNone) {
     if (!memexport_used) {
@@ -2959,6 +3580,28 @@ bool D3D12CommandProcessor::IssueDraw(xenos::PrimitiveType primitive_type,
             primitive_processor_->GetBuiltinIndexBufferGpuAddress(
                 primitive_processing_result.host_index_buffer_handle);
         break;
+      case PrimitiveProcessor::ProcessedIndexBufferType::kGpuConverted: {
+        scratch_index_buffer = RequestScratchGPUBuffer(
+            index_buffer_view.SizeInBytes,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        if (scratch_index_buffer == nullptr) {
+          return false;
+        }
+        shared_memory_->UseForReading();
+        primitive_processor_->ConvertIndicesOnGpu(
+            primitive_processing_result, shared_memory_->GetGPUAddress(),
+            scratch_index_buffer->GetGPUVirtualAddress());
+        PushTransitionBarrier(scratch_index_buffer,
+                              D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                              D3D12_RESOURCE_STATE_INDEX_BUFFER);
+        index_buffer_view.BufferLocation =
+            scratch_index_buffer->GetGPUVirtualAddress();
+        // The conversion dispatch has replaced the pipeline state.
+        deferred_command_list_.SetPipelineStateHandle(
+            reinterpret_cast<void*>(pipeline_handle));
+        current_guest_pipeline_ = pipeline_handle;
+        current_external_pipeline_ = nullptr;
+      } break;
       default:
         assert_unhandled_case(primitive_processing_result.index_buffer_type);
         return false;
@@ -2977,6 +3620,9 @@ bool D3D12CommandProcessor::IssueDraw(xenos::PrimitiveType primitive_type,
                               D3D12_RESOURCE_STATE_INDEX_BUFFER);
     }
   }
+  EndGpuTimestampRange(draw_timestamps, GpuTiming::Kind::kDraw,
+                       vertex_shader->ucode_data_hash(),
+                       pixel_shader ? pixel_shader->ucode_data_hash() : 0);
 
   if (memexport_used) {
     // Make sure this memexporting draw is ordered with other work using shared
@@ -2990,7 +3636,16 @@ bool D3D12CommandProcessor::IssueDraw(xenos::PrimitiveType primitive_type,
           memexport_range.base_address_dwords << 2, memexport_range.size_bytes,
           false);
     }
-    if (GetGPUSetting(GPUSetting::ReadbackResolve)) {
+    if (GetGPUSetting(GPUSetting::ReadbackResolve) && cvars::readback_async) {
+      std::vector<std::pair<uint32_t, uint32_t>> readback_ranges;
+      readback_ranges.reserve(memexport_ranges_.size());
+      for (const draw_util::MemExportRange& memexport_range :
+           memexport_ranges_) {
+        readback_ranges.emplace_back(memexport_range.base_address_dwords << 2,
+                                     memexport_range.size_bytes);
+      }
+      IssueAsyncReadback(std::move(readback_ranges));
+    } else if (GetGPUSetting(GPUSetting::ReadbackResolve)) {
       // Read the exported data on the CPU.
       uint32_t memexport_total_size = 0;
       for (const draw_util::MemExportRange& memexport_range :
@@ -3038,6 +3693,18 @@ bool D3D12CommandProcessor::IssueDraw(xenos::PrimitiveType primitive_type,
     }
   }
 
+  ++submission_draw_count_;
+  if (cvars::submit_split_draw_count &&
+      submission_draw_count_ >= cvars::submit_split_draw_count &&
+      submission_fence_->GetCompletedValue() + 1 >= submission_current_ &&
+      CanEndSubmissionImmediately()) {
+    // The GPU has nothing else to do - let it execute the draws recorded so
+    // far while the rest of the frame is being processed.
+    if (EndSubmission(false)) {
+      split_submissions_counter.Increment();
+    }
+  }
+
   return true;
 }
 
@@ -3070,22 +3737,28 @@ bool D3D12CommandProcessor::IssueCopy() {
   if (!BeginSubmission(true)) {
     return false;
   }
+  GpuTimestampRangeBegin resolve_timestamps = BeginGpuTimestampRange();
+  bool resolved;
   if (!GetGPUSetting(GPUSetting::ReadbackResolve)) {
     uint32_t written_address, written_length;
-    return render_target_cache_->Resolve(*memory_, *shared_memory_,
-                                         *texture_cache_, written_address,
-                                         written_length);
+    resolved = render_target_cache_->Resolve(*memory_, *shared_memory_,
+                                             *texture_cache_, written_address,
+                                             written_length);
   } else {
-    return IssueCopy_ReadbackResolvePath();
+    resolved = IssueCopy_ReadbackResolvePath();
   }
-  return true;
+  EndGpuTimestampRange(resolve_timestamps, GpuTiming::Kind::kResolve);
+  return resolved;
 }
 XE_NOINLINE
 bool D3D12CommandProcessor::IssueCopy_ReadbackResolvePath() {
   uint32_t written_address, written_length;
   if (render_target_cache_->Resolve(*memory_, *shared_memory_, *texture_cache_,
                                     written_address, written_length)) {
-    if (!texture_cache_->IsDrawResolutionScaled() && written_length) {
+    if (!texture_cache_->IsDrawResolutionScaled() && written_length &&
+        cvars::readback_async) {
+      IssueAsyncReadback({std::make_pair(written_address, written_length)});
+    } else if (!texture_cache_->IsDrawResolutionScaled() && written_length) {
       // Read the resolved data on the CPU.
       ID3D12Resource* readback_buffer = RequestReadbackBuffer(written_length);
       if (readback_buffer != nullptr) {
@@ -3150,6 +3823,7 @@ void D3D12CommandProcessor::CheckSubmissionFence(uint64_t await_submission) {
   uint64_t submission_completed_before = submission_completed_;
   submission_completed_ = submission_fence_->GetCompletedValue();
   if (submission_completed_ < await_submission) {
+    xe::counters::ScopedTimer wait_timer(host_gpu_wait_time_counter);
     if (SUCCEEDED(submission_fence_->SetEventOnCompletion(await_submission,
                                                           nullptr))) {
       submission_completed_ = submission_fence_->GetCompletedValue();
@@ -3204,6 +3878,12 @@ void D3D12CommandProcessor::CheckSubmissionFence(uint64_t await_submission) {
     resources_for_deletion_.pop_front();
   }
 
+  CompleteAsyncReadbacks();
+
+  CompleteOcclusionQueries();
+
+  CompleteGpuTimestamps();
+
   shared_memory_->CompletedSubmissionUpdated();
 
   render_target_cache_->CompletedSubmissionUpdated();
@@ -3265,6 +3945,7 @@ bool D3D12CommandProcessor::BeginSubmission(bool is_guest_command) {
 
   if (!submission_open_) {
     submission_open_ = true;
+    submission_draw_count_ = 0;
 
     // Start a new deferred command list - will submit it to the real one in the
     // end of the submission (when async pipeline creation requests are
@@ -3291,9 +3972,15 @@ bool D3D12CommandProcessor::BeginSubmission(bool is_guest_command) {
 
     render_target_cache_->BeginSubmission();
 
+    shared_memory_->BeginSubmission();
+
     primitive_processor_->BeginSubmission();
 
     texture_cache_->BeginSubmission(submission_current_);
+
+    if (occlusion_query_is_active_) {
+      BeginOcclusionQueryPart();
+    }
   }
 
   if (is_opening_frame) {
@@ -3345,6 +4032,8 @@ bool D3D12CommandProcessor::BeginSubmission(bool is_guest_command) {
     primitive_processor_->BeginFrame();
 
     texture_cache_->BeginFrame();
+
+    render_target_cache_->BeginFrame();
   }
 
   return true;
@@ -3384,12 +4073,19 @@ bool D3D12CommandProcessor::EndSubmission(bool is_swap) {
 
     pipeline_cache_->EndSubmission();
 
+    EndOcclusionQueryPart();
+
+    ResolveGpuTimestamps();
+
     // Submit barriers now because resources with the queued barriers may be
     // destroyed between frames.
     SubmitBarriers();
 
     ID3D12CommandQueue* direct_queue = provider.GetDirectQueue();
 
+    deferred_command_list_.UploadMultiDrawArguments(*constant_buffer_pool_,
+                                                    submission_current_);
+
     // Submit the deferred command list.
     // Only one deferred command list must be executed in the same
     // ExecuteCommandLists - the boundaries of ExecuteCommandLists are a full
@@ -3397,12 +4093,18 @@ bool D3D12CommandProcessor::EndSubmission(bool is_swap) {
     // happens between Xenia submissions.
     ID3D12CommandAllocator* command_allocator =
         command_allocator_writable_first_->command_allocator;
-    command_allocator->Reset();
-    command_list_->Reset(command_allocator, nullptr);
-    deferred_command_list_.Execute(command_list_, command_list_1_);
-    command_list_->Close();
-    ID3D12CommandList* execute_command_lists[] = {command_list_};
-    direct_queue->ExecuteCommandLists(1, execute_command_lists);
+    if (submission_thread_) {
+      // The allocator is not reclaimed until the submission is completed, so
+      // it's safe for the submission thread to use it.
+      QueueSubmissionReplay(command_allocator);
+    } else {
+      command_allocator->Reset();
+      command_list_->Reset(command_allocator, nullptr);
+      deferred_command_list_.Execute(command_list_, command_list_1_);
+      command_list_->Close();
+      ID3D12CommandList* execute_command_lists[] = {command_list_};
+      direct_queue->ExecuteCommandLists(1, execute_command_lists);
+    }
     command_allocator_writable_first_->last_usage_submission =
         submission_current_;
     if (command_allocator_submitted_last_) {
@@ -3418,7 +4120,12 @@ bool D3D12CommandProcessor::EndSubmission(bool is_swap) {
       command_allocator_writable_last_ = nullptr;
     }
 
-    direct_queue->Signal(submission_fence_, submission_current_++);
+    // The submission thread signals the fence after executing the command
+    // list.
+    if (!submission_thread_) {
+      direct_queue->Signal(submission_fence_, submission_current_);
+    }
+    ++submission_current_;
 
     submission_open_ = false;
 
@@ -3433,6 +4140,7 @@ bool D3D12CommandProcessor::EndSubmission(bool is_swap) {
     }
     // Close the capture after submitting.
     if (pix_capturing_) {
+      AwaitSubmissionThreadIdle();
       IDXGraphicsAnalysis* graphics_analysis = provider.GetGraphicsAnalysis();
       if (graphics_analysis != nullptr) {
         graphics_analysis->EndCapture();
@@ -3503,6 +4211,108 @@ void D3D12CommandProcessor::ClearCommandAllocatorCache() {
   command_allocator_writable_last_ = nullptr;
 }
 
+void D3D12CommandProcessor::StartSubmissionThread() {
+  assert_null(submission_thread_);
+  submission_thread_shutdown_ = false;
+  submission_thread_pending_count_ = 0;
+  for (size_t i = 0; i < kSubmissionThreadCommandListCount; ++i) {
+    submission_thread_free_command_lists_.push_back(
+        std::make_unique<DeferredCommandList>(*this));
+  }
+  submission_thread_ =
+      xe::threading::Thread::Create({}, [this]() { SubmissionThread(); });
+  assert_not_null(submission_thread_);
+  submission_thread_->set_name("D3D12 Submission");
+}
+
+void D3D12CommandProcessor::ShutdownSubmissionThread() {
+  if (!submission_thread_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(submission_thread_mutex_);
+    submission_thread_shutdown_ = true;
+  }
+  submission_thread_cond_.notify_all();
+  xe::threading::Wait(submission_thread_.get(), false);
+  submission_thread_.reset();
+  submission_thread_queue_.clear();
+  submission_thread_free_command_lists_.clear();
+}
+
+void D3D12CommandProcessor::SubmissionThread() {
+  ID3D12CommandQueue* direct_queue = GetD3D12Provider().GetDirectQueue();
+  std::unique_lock<std::mutex> lock(submission_thread_mutex_);
+  while (true) {
+    submission_thread_cond_.wait(lock, [this]() {
+      return submission_thread_shutdown_ || !submission_thread_queue_.empty();
+    });
+    // Finish the remaining submissions before exiting.
+    if (submission_thread_queue_.empty()) {
+      break;
+    }
+    PendingSubmission submission =
+        std::move(submission_thread_queue_.front());
+    submission_thread_queue_.pop_front();
+    lock.unlock();
+
+    {
+      SCOPE_profile_cpu_i("gpu",
+                          "xe::gpu::d3d12::D3D12CommandProcessor::Submit");
+      submission.command_allocator->Reset();
+      command_list_->Reset(submission.command_allocator, nullptr);
+      submission.deferred_command_list->Execute(command_list_,
+                                                command_list_1_);
+      command_list_->Close();
+      ID3D12CommandList* execute_command_lists[] = {command_list_};
+      direct_queue->ExecuteCommandLists(1, execute_command_lists);
+      direct_queue->Signal(submission_fence_, submission.submission_index);
+      submission.deferred_command_list->Reset();
+    }
+
+    lock.lock();
+    submission_thread_free_command_lists_.push_back(
+        std::move(submission.deferred_command_list));
+    --submission_thread_pending_count_;
+    submission_thread_cond_.notify_all();
+  }
+}
+
+void D3D12CommandProcessor::QueueSubmissionReplay(
+    ID3D12CommandAllocator* command_allocator) {
+  std::unique_ptr<DeferredCommandList> replay_command_list;
+  {
+    std::unique_lock<std::mutex> lock(submission_thread_mutex_);
+    // Don't get more than a few submissions ahead of the GPU submission.
+    submission_thread_cond_.wait(lock, [this]() {
+      return !submission_thread_free_command_lists_.empty();
+    });
+    replay_command_list =
+        std::move(submission_thread_free_command_lists_.back());
+    submission_thread_free_command_lists_.pop_back();
+  }
+  // Take the recorded commands, and continue recording into the empty stream.
+  replay_command_list->Swap(deferred_command_list_);
+  {
+    std::lock_guard<std::mutex> lock(submission_thread_mutex_);
+    PendingSubmission& submission = submission_thread_queue_.emplace_back();
+    submission.deferred_command_list = std::move(replay_command_list);
+    submission.command_allocator = command_allocator;
+    submission.submission_index = submission_current_;
+    ++submission_thread_pending_count_;
+  }
+  submission_thread_cond_.notify_all();
+}
+
+void D3D12CommandProcessor::AwaitSubmissionThreadIdle() {
+  if (!submission_thread_) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(submission_thread_mutex_);
+  submission_thread_cond_.wait(
+      lock, [this]() { return !submission_thread_pending_count_; });
+}
+
 void D3D12CommandProcessor::UpdateFixedFunctionState(
     const draw_util::ViewportInfo& viewport_info,
     const draw_util::Scissor& scissor, bool primitive_polygonal,
@@ -5102,6 +5912,378 @@ ID3D12Resource* D3D12CommandProcessor::RequestReadbackBuffer(uint32_t size) {
   return readback_buffer_;
 }
 
+void D3D12CommandProcessor::IssueAsyncReadback(
+    std::vector<std::pair<uint32_t, uint32_t>>&& ranges) {
+  uint32_t total_size = 0;
+  for (const std::pair<uint32_t, uint32_t>& range : ranges) {
+    total_size += range.second;
+  }
+  if (!total_size) {
+    return;
+  }
+
+  if (async_readbacks_pending_.size() >= kAsyncReadbackRingSize) {
+    CheckSubmissionFence(async_readbacks_pending_.front().submission);
+    // The submission may have been ended for awaiting.
+    if (!BeginSubmission(true)) {
+      return;
+    }
+  }
+
+  // Take the smallest free buffer that is large enough.
+  AsyncReadback async_readback;
+  auto free_buffer_it = async_readback_buffers_free_.end();
+  for (auto it = async_readback_buffers_free_.begin();
+       it != async_readback_buffers_free_.end(); ++it) {
+    if (it->size >= total_size &&
+        (free_buffer_it == async_readback_buffers_free_.end() ||
+         it->size < free_buffer_it->size)) {
+      free_buffer_it = it;
+    }
+  }
+  if (free_buffer_it != async_readback_buffers_free_.end()) {
+    async_readback.buffer = *free_buffer_it;
+    async_readback_buffers_free_.erase(free_buffer_it);
+  } else {
+    uint32_t buffer_size =
+        xe::align(total_size, kAsyncReadbackBufferSizeIncrement);
+    const ui::d3d12::D3D12Provider& provider = GetD3D12Provider();
+    D3D12_RESOURCE_DESC buffer_desc;
+    ui::d3d12::util::FillBufferResourceDesc(buffer_desc, buffer_size,
+                                            D3D12_RESOURCE_FLAG_NONE);
+    ID3D12Resource* buffer;
+    if (FAILED(provider.GetDevice()->CreateCommittedResource(
+            &ui::d3d12::util::kHeapPropertiesReadback,
+            provider.GetHeapFlagCreateNotZeroed(), &buffer_desc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&buffer)))) {
+      XELOGE("Failed to create a {} KB asynchronous readback buffer",
+             buffer_size >> 10);
+      return;
+    }
+    async_readback.buffer.buffer = buffer;
+    async_readback.buffer.size = buffer_size;
+  }
+
+  shared_memory_->UseAsCopySource();
+  SubmitBarriers();
+  ID3D12Resource* shared_memory_buffer = shared_memory_->GetBuffer();
+  uint32_t buffer_offset = 0;
+  for (const std::pair<uint32_t, uint32_t>& range : ranges) {
+    deferred_command_list_.D3DCopyBufferRegion(async_readback.buffer.buffer,
+                                               buffer_offset,
+                                               shared_memory_buffer,
+                                               range.first, range.second);
+    buffer_offset += range.second;
+  }
+  async_readback.submission = submission_current_;
+  async_readback.ranges = std::move(ranges);
+  async_readbacks_pending_.push_back(std::move(async_readback));
+}
+
+void D3D12CommandProcessor::CompleteAsyncReadbacks() {
+  while (!async_readbacks_pending_.empty()) {
+    AsyncReadback& async_readback = async_readbacks_pending_.front();
+    if (async_readback.submission > submission_completed_) {
+      break;
+    }
+    uint32_t total_size = 0;
+    for (const std::pair<uint32_t, uint32_t>& range : async_readback.ranges) {
+      total_size += range.second;
+    }
+    D3D12_RANGE readback_range;
+    readback_range.Begin = 0;
+    readback_range.End = total_size;
+    void* readback_mapping;
+    if (SUCCEEDED(async_readback.buffer.buffer->Map(0, &readback_range,
+                                                    &readback_mapping))) {
+      uint8_t* readback_bytes = reinterpret_cast<uint8_t*>(readback_mapping);
+      uint32_t buffer_offset = 0;
+      for (const std::pair<uint32_t, uint32_t>& range :
+           async_readback.ranges) {
+        uint8_t* destination = memory_->TranslatePhysical(range.first);
+        // Resolves are whole cache lines, memory exports may be not.
+        if (!((range.first | range.second | buffer_offset) & 63)) {
+          memory::vastcpy(destination, readback_bytes + buffer_offset,
+                          range.second);
+        } else {
+          std::memcpy(destination, readback_bytes + buffer_offset,
+                      range.second);
+        }
+        buffer_offset += range.second;
+      }
+      D3D12_RANGE readback_write_range = {};
+      async_readback.buffer.buffer->Unmap(0, &readback_write_range);
+    }
+    async_readback_buffers_free_.push_back(async_readback.buffer);
+    async_readbacks_pending_.pop_front();
+  }
+  while (!deferred_guest_fences_.empty()) {
+    const DeferredGuestFence& deferred_guest_fence =
+        deferred_guest_fences_.front();
+    if (deferred_guest_fence.submission > submission_completed_) {
+      break;
+    }
+    xe::store(deferred_guest_fence.destination, deferred_guest_fence.value);
+    deferred_guest_fences_.pop_front();
+  }
+}
+
+bool D3D12CommandProcessor::BeginOcclusionQueryPart() {
+  assert_true(occlusion_query_is_active_);
+  assert_false(occlusion_query_part_open_);
+  if (occlusion_query_parts_used_ >= kOcclusionQueryCount) {
+    XELOGW(
+        "Too many host occlusion queries in flight, using fake sample counts "
+        "for a query");
+    occlusion_query_parts_used_ -= occlusion_query_active_.part_count;
+    occlusion_query_is_active_ = false;
+    return false;
+  }
+  deferred_command_list_.D3DBeginQuery(occlusion_query_heap_,
+                                       D3D12_QUERY_TYPE_OCCLUSION,
+                                       occlusion_query_next_part_);
+  occlusion_query_next_part_ =
+      (occlusion_query_next_part_ + 1) % kOcclusionQueryCount;
+  ++occlusion_query_parts_used_;
+  ++occlusion_query_active_.part_count;
+  occlusion_query_part_open_ = true;
+  return true;
+}
+
+void D3D12CommandProcessor::EndOcclusionQueryPart() {
+  if (!occlusion_query_part_open_) {
+    return;
+  }
+  uint32_t part_index = (occlusion_query_active_.first_part +
+                         occlusion_query_active_.part_count - 1) %
+                        kOcclusionQueryCount;
+  deferred_command_list_.D3DEndQuery(
+      occlusion_query_heap_, D3D12_QUERY_TYPE_OCCLUSION, part_index);
+  deferred_command_list_.D3DResolveQueryData(
+      occlusion_query_heap_, D3D12_QUERY_TYPE_OCCLUSION, part_index, 1,
+      occlusion_query_readback_buffer_, sizeof(uint64_t) * part_index);
+  occlusion_query_part_open_ = false;
+}
+
+void D3D12CommandProcessor::CompleteOcclusionQueries() {
+  if (occlusion_queries_pending_.empty() ||
+      occlusion_queries_pending_.front().submission > submission_completed_) {
+    return;
+  }
+  D3D12_RANGE readback_range;
+  readback_range.Begin = 0;
+  readback_range.End = sizeof(uint64_t) * kOcclusionQueryCount;
+  void* readback_mapping;
+  if (FAILED(occlusion_query_readback_buffer_->Map(0, &readback_range,
+                                                   &readback_mapping))) {
+    readback_mapping = nullptr;
+  }
+  const uint64_t* readback_sample_counts =
+      reinterpret_cast<const uint64_t*>(readback_mapping);
+  // The host samples are at the draw resolution.
+  uint32_t draw_resolution_scale_area =
+      texture_cache_->draw_resolution_scale_x() *
+      texture_cache_->draw_resolution_scale_y();
+  while (!occlusion_queries_pending_.empty()) {
+    const OcclusionQuery& query = occlusion_queries_pending_.front();
+    if (query.submission > submission_completed_) {
+      break;
+    }
+    uint64_t sample_count = 0;
+    if (readback_sample_counts) {
+      for (uint32_t i = 0; i < query.part_count; ++i) {
+        sample_count += readback_sample_counts[(query.first_part + i) %
+                                               kOcclusionQueryCount];
+      }
+    }
+    sample_count /= draw_resolution_scale_area;
+    auto* sample_counts =
+        memory_->TranslatePhysical<xe_gpu_depth_sample_counts*>(
+            query.sample_counts_address);
+    std::memset(sample_counts, 0, sizeof(xe_gpu_depth_sample_counts));
+    sample_counts->ZPass_A = sample_counts->Total_A =
+        uint32_t(std::min(sample_count, uint64_t(UINT32_MAX)));
+    occlusion_query_parts_used_ -= query.part_count;
+    occlusion_queries_pending_.pop_front();
+  }
+  if (readback_mapping) {
+    D3D12_RANGE readback_write_range = {};
+    occlusion_query_readback_buffer_->Unmap(0, &readback_write_range);
+  }
+}
+
+void D3D12CommandProcessor::BeginGpuTimestampRangeImpl(
+    GpuTimestampRangeBegin& begin) {
+  if (!submission_open_) {
+    return;
+  }
+  begin.recording_point = deferred_command_list_.GetRecordingPoint();
+  begin.submission = submission_current_;
+  begin.index = WriteGpuTimestamp();
+  begin.stream_size_after =
+      deferred_command_list_.GetRecordingPoint().stream_size;
+}
+
+void D3D12CommandProcessor::EndGpuTimestampRange(
+    const GpuTimestampRangeBegin& begin, GpuTiming::Kind kind,
+    uint64_t vertex_shader_hash, uint64_t pixel_shader_hash) {
+  if (begin.index == UINT32_MAX) {
+    return;
+  }
+  bool is_same_submission =
+      submission_open_ && begin.submission == submission_current_;
+  if (is_same_submission &&
+      deferred_command_list_.GetRecordingPoint().stream_size ==
+          begin.stream_size_after) {
+    // Nothing to measure has been recorded, drop the timestamp at the
+    // beginning, which is the last one written.
+    deferred_command_list_.RevertToRecordingPoint(begin.recording_point);
+    gpu_timestamp_next_ = begin.index;
+    --gpu_timestamps_used_;
+    --gpu_timestamp_submission_count_;
+    return;
+  }
+  GpuTimestampRange range;
+  range.timing.kind = kind;
+  range.timing.packet_address = GetCurrentPacketPhysicalAddress();
+  range.timing.vertex_shader_hash = vertex_shader_hash;
+  range.timing.pixel_shader_hash = pixel_shader_hash;
+  range.timing.frame = frame_current_;
+  range.timing.gpu_us = 0.0;
+  range.begin_index = begin.index;
+  range.end_index = UINT32_MAX;
+  range.submission = begin.submission;
+  if (submission_open_) {
+    range.end_index = WriteGpuTimestamp();
+    if (range.end_index != UINT32_MAX) {
+      range.submission = submission_current_;
+    }
+  }
+  gpu_timestamp_ranges_pending_.push_back(range);
+}
+
+uint32_t D3D12CommandProcessor::WriteGpuTimestamp() {
+  assert_true(submission_open_);
+  if (gpu_timestamps_used_ >= kGpuTimestampCount) {
+    return UINT32_MAX;
+  }
+  uint32_t index = gpu_timestamp_next_;
+  deferred_command_list_.D3DEndQuery(gpu_timestamp_heap_,
+                                     D3D12_QUERY_TYPE_TIMESTAMP, index);
+  gpu_timestamp_next_ = (gpu_timestamp_next_ + 1) % kGpuTimestampCount;
+  ++gpu_timestamps_used_;
+  ++gpu_timestamp_submission_count_;
+  return index;
+}
+
+void D3D12CommandProcessor::ResolveGpuTimestamps() {
+  uint32_t count = gpu_timestamp_submission_count_;
+  if (!count) {
+    return;
+  }
+  gpu_timestamp_submission_count_ = 0;
+  uint32_t first =
+      (gpu_timestamp_next_ + kGpuTimestampCount - count) % kGpuTimestampCount;
+  // May wrap around the ring.
+  uint32_t first_count = std::min(count, kGpuTimestampCount - first);
+  deferred_command_list_.D3DResolveQueryData(
+      gpu_timestamp_heap_, D3D12_QUERY_TYPE_TIMESTAMP, first, first_count,
+      gpu_timestamp_readback_buffer_, sizeof(uint64_t) * first);
+  if (count > first_count) {
+    deferred_command_list_.D3DResolveQueryData(
+        gpu_timestamp_heap_, D3D12_QUERY_TYPE_TIMESTAMP, 0,
+        count - first_count, gpu_timestamp_readback_buffer_, 0);
+  }
+}
+
+void D3D12CommandProcessor::CompleteGpuTimestamps() {
+  if (gpu_timestamp_ranges_pending_.empty() ||
+      gpu_timestamp_ranges_pending_.front().submission >
+          submission_completed_) {
+    return;
+  }
+  D3D12_RANGE readback_range;
+  readback_range.Begin = 0;
+  readback_range.End = sizeof(uint64_t) * kGpuTimestampCount;
+  void* readback_mapping;
+  if (FAILED(gpu_timestamp_readback_buffer_->Map(0, &readback_range,
+                                                 &readback_mapping))) {
+    readback_mapping = nullptr;
+  }
+  const uint64_t* readback_timestamps =
+      reinterpret_cast<const uint64_t*>(readback_mapping);
+  double us_per_tick = 1000000.0 / double(gpu_timestamp_frequency_);
+  while (!gpu_timestamp_ranges_pending_.empty()) {
+    const GpuTimestampRange& range = gpu_timestamp_ranges_pending_.front();
+    if (range.submission > submission_completed_) {
+      break;
+    }
+    if (range.end_index != UINT32_MAX) {
+      if (readback_timestamps) {
+        GpuTiming timing = range.timing;
+        uint64_t begin_timestamp = readback_timestamps[range.begin_index];
+        uint64_t end_timestamp = readback_timestamps[range.end_index];
+        if (end_timestamp > begin_timestamp) {
+          timing.gpu_us = double(end_timestamp - begin_timestamp) * us_per_tick;
+        }
+        AddCompletedGpuTiming(timing);
+      }
+      --gpu_timestamps_used_;
+    }
+    --gpu_timestamps_used_;
+    gpu_timestamp_ranges_pending_.pop_front();
+  }
+  if (readback_mapping) {
+    D3D12_RANGE readback_write_range = {};
+    gpu_timestamp_readback_buffer_->Unmap(0, &readback_write_range);
+  }
+}
+
+void D3D12CommandProcessor::AddCompletedGpuTiming(const GpuTiming& timing) {
+  if (timing.frame != gpu_timings_frame_) {
+    // The previous frame is complete.
+    COUNT_profile_set("gpu/timestamps/draw_us",
+                      int64_t(gpu_timings_frame_us_[size_t(
+                          GpuTiming::Kind::kDraw)]));
+    COUNT_profile_set("gpu/timestamps/resolve_us",
+                      int64_t(gpu_timings_frame_us_[size_t(
+                          GpuTiming::Kind::kResolve)]));
+    COUNT_profile_set("gpu/timestamps/edram_transfer_us",
+                      int64_t(gpu_timings_frame_us_[size_t(
+                          GpuTiming::Kind::kEdramTransfer)]));
+    COUNT_profile_set("gpu/timestamps/texture_load_us",
+                      int64_t(gpu_timings_frame_us_[size_t(
+                          GpuTiming::Kind::kTextureLoad)]));
+    COUNT_profile_set("gpu/timestamps/presenter_effect_us",
+                      int64_t(gpu_timings_frame_us_[size_t(
+                          GpuTiming::Kind::kPresenterEffect)]));
+    gpu_timings_frame_ = timing.frame;
+    gpu_timings_frame_us_.fill(0.0);
+  }
+  gpu_timings_frame_us_[size_t(timing.kind)] += timing.gpu_us;
+  if (gpu_timings_taken_ &&
+      gpu_timings_completed_.size() < kGpuTimingsCompletedMax) {
+    gpu_timings_completed_.push_back(timing);
+  }
+}
+
+void D3D12CommandProcessor::AwaitOcclusionQueries(bool all) {
+  uint64_t latency_frames =
+      uint64_t(std::max(cvars::query_occlusion_latency_frames, int32_t(0)));
+  while (!occlusion_queries_pending_.empty()) {
+    const OcclusionQuery& query = occlusion_queries_pending_.front();
+    if (!all && query.frame + latency_frames >= frame_current_) {
+      break;
+    }
+    size_t pending_count_before = occlusion_queries_pending_.size();
+    CheckSubmissionFence(query.submission);
+    if (occlusion_queries_pending_.size() >= pending_count_before) {
+      // Failed to await, such as when the device has been removed.
+      break;
+    }
+  }
+}
+
 void D3D12CommandProcessor::WriteGammaRampSRV(
     bool is_pwl, D3D12_CPU_DESCRIPTOR_HANDLE handle) const {
   ID3D12Device* device = GetD3D12Provider().GetDevice();
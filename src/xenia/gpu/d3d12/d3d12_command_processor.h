@@ -11,9 +11,12 @@
 #define XENIA_GPU_D3D12_D3D12_COMMAND_PROCESSOR_H_
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -21,6 +24,7 @@
 #include <vector>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/threading.h"
 #include "xenia/gpu/command_processor.h"
 #include "xenia/gpu/d3d12/d3d12_graphics_system.h"
 #include "xenia/gpu/d3d12/d3d12_primitive_processor.h"
@@ -70,11 +74,15 @@ class D3D12CommandProcessor final : public CommandProcessor {
   void InitializeShaderStorage(const std::filesystem::path& cache_root,
                                uint32_t title_id, bool blocking) override;
 
+  CacheStatistics GetCacheStatistics() const override;
+  void TakeGpuTimings(std::vector<GpuTiming>& timings_out) override;
+
   void RequestFrameTrace(const std::filesystem::path& root_path) override;
 
   void TracePlaybackWroteMemory(uint32_t base_ptr, uint32_t length) override;
 
   void RestoreEdramSnapshot(const void* snapshot) override;
+  bool SaveEdramSnapshot(void* snapshot_out) override;
 
   ui::d3d12::D3D12Provider& GetD3D12Provider() const {
     return *static_cast<ui::d3d12::D3D12Provider*>(
@@ -213,6 +221,17 @@ class D3D12CommandProcessor final : public CommandProcessor {
     return pipeline_cache_->GetD3D12PipelineByHandle(handle);
   }
 
+  // For executing merged draws with d3d12_merge_draws.
+  ID3D12CommandSignature* GetDrawIndexedCommandSignature() const {
+    return draw_indexed_command_signature_;
+  }
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  // Not null only if enhanced barriers are used.
+  ID3D12GraphicsCommandList7* GetCommandList7() const {
+    return command_list_7_;
+  }
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
+
   // Sets the current cached values to external ones. This is for cache
   // invalidation primarily. A submission must be open.
   void SetExternalPipeline(ID3D12PipelineState* pipeline);
@@ -311,7 +330,15 @@ class D3D12CommandProcessor final : public CommandProcessor {
   void IssueSwap(uint32_t frontbuffer_ptr, uint32_t frontbuffer_width,
                  uint32_t frontbuffer_height) override;
 
+  void PrepareForWait() override;
+  void UpdateWhileWaiting() override;
+
   void OnPrimaryBufferEnd() override;
+  void PrepareForGuestFence() override;
+  void WriteGuestFence(uint32_t* destination, uint32_t value) override;
+
+  bool BeginOcclusionQuery() override;
+  bool EndOcclusionQuery(uint32_t sample_counts_address) override;
 
   Shader* LoadShader(xenos::ShaderType shader_type, uint32_t guest_address,
                      const uint32_t* host_address,
@@ -408,6 +435,22 @@ class D3D12CommandProcessor final : public CommandProcessor {
       const DxbcShader* vertex_shader, const DxbcShader* pixel_shader,
       RootBindfulExtraParameterIndices& indices_out);
 
+  // Combines the transitions of the same subresources in the pending barrier
+  // batch, and drops the UAV barriers made redundant by other barriers.
+  void MergeBarriers();
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  // Gets the synchronization scope, the access and the texture layout
+  // equivalent to a legacy resource state. Returns false if the state has no
+  // known equivalent.
+  static bool GetEnhancedBarrierScope(D3D12_RESOURCE_STATES state,
+                                      D3D12_BARRIER_SYNC& sync_out,
+                                      D3D12_BARRIER_ACCESS& access_out,
+                                      D3D12_BARRIER_LAYOUT& layout_out);
+  // Converts the pending barrier batch to the enhanced barriers, returns false
+  // if any of them can't be converted, and the legacy barriers must be used.
+  bool ConvertBarriersToEnhanced();
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
+
   // BeginSubmission and EndSubmission may be called at any time. If there's an
   // open non-frame submission, BeginSubmission(true) will promote it to a
   // frame. EndSubmission(true) will close the frame no matter whether the
@@ -441,6 +484,18 @@ class D3D12CommandProcessor final : public CommandProcessor {
   // Need to await submission completion before calling.
   void ClearCommandAllocatorCache();
 
+  // Pipelined submission - replaying the deferred command lists into the real
+  // command list and executing them on a separate thread, so recording of the
+  // next submission can continue on the command processor thread.
+  void StartSubmissionThread();
+  void ShutdownSubmissionThread();
+  void SubmissionThread();
+  // Hands the recorded deferred command list over to the submission thread.
+  void QueueSubmissionReplay(ID3D12CommandAllocator* command_allocator);
+  // Waits until all the ended submissions have been executed on the queue, for
+  // queue operations that need to be ordered after them.
+  void AwaitSubmissionThreadIdle();
+
   // Request descriptors and automatically rebind the descriptor heap on the
   // draw command list. Refer to D3D12DescriptorHeapPool::Request for partial /
   // full update explanation. Doesn't work when bindless descriptors are used.
@@ -496,6 +551,55 @@ class D3D12CommandProcessor final : public CommandProcessor {
   // synchronizing immediately after use. Always in COPY_DEST state.
   ID3D12Resource* RequestReadbackBuffer(uint32_t size);
 
+  // Copies the guest physical memory ranges (address, length) from the shared
+  // memory to a buffer of the readback ring, to be written to guest memory by
+  // CompleteAsyncReadbacks after the submission is completed.
+  void IssueAsyncReadback(std::vector<std::pair<uint32_t, uint32_t>>&& ranges);
+  // Writes the readbacks and the deferred guest fences of the completed
+  // submissions to guest memory.
+  void CompleteAsyncReadbacks();
+
+  // Begins measuring a part of the active occlusion query in the current
+  // submission. If there are no free host queries, drops the active query.
+  bool BeginOcclusionQueryPart();
+  void EndOcclusionQueryPart();
+  // Writes the sample counts of the queries ended in the completed submissions
+  // to guest memory.
+  void CompleteOcclusionQueries();
+  // Awaits the queries ended more than query_occlusion_latency_frames frames
+  // ago, or all of them.
+  void AwaitOcclusionQueries(bool all);
+
+  struct GpuTimestampRangeBegin {
+    DeferredCommandList::RecordingPoint recording_point;
+    // The size of the recorded commands after the timestamp query.
+    size_t stream_size_after;
+    uint64_t submission;
+    // UINT32_MAX if not measuring.
+    uint32_t index;
+  };
+  // With gpu_timestamps, measures the GPU time of the commands recorded between
+  // the beginning and the end of the range. Ranges must not be nested.
+  GpuTimestampRangeBegin BeginGpuTimestampRange() {
+    GpuTimestampRangeBegin begin;
+    begin.index = UINT32_MAX;
+    if (gpu_timestamp_heap_) {
+      BeginGpuTimestampRangeImpl(begin);
+    }
+    return begin;
+  }
+  void BeginGpuTimestampRangeImpl(GpuTimestampRangeBegin& begin);
+  void EndGpuTimestampRange(const GpuTimestampRangeBegin& begin,
+                            GpuTiming::Kind kind,
+                            uint64_t vertex_shader_hash = 0,
+                            uint64_t pixel_shader_hash = 0);
+  // Returns UINT32_MAX if there are no free timestamp queries.
+  uint32_t WriteGpuTimestamp();
+  // Resolves the timestamps written in the open submission.
+  void ResolveGpuTimestamps();
+  void CompleteGpuTimestamps();
+  void AddCompletedGpuTiming(const GpuTiming& timing);
+
   void WriteGammaRampSRV(bool is_pwl, D3D12_CPU_DESCRIPTOR_HANDLE handle) const;
 
   bool device_removed_ = false;
@@ -505,6 +609,9 @@ class D3D12CommandProcessor final : public CommandProcessor {
   HANDLE fence_completion_event_ = nullptr;
 
   bool submission_open_ = false;
+  // Guest draws recorded in the current submission, for splitting it with
+  // submit_split_draw_count.
+  uint32_t submission_draw_count_ = 0;
   // Values of submission_fence_.
   uint64_t submission_current_ = 1;
   uint64_t submission_completed_ = 0;
@@ -537,7 +644,29 @@ class D3D12CommandProcessor final : public CommandProcessor {
   CommandAllocator* command_allocator_submitted_last_ = nullptr;
   ID3D12GraphicsCommandList* command_list_ = nullptr;
   ID3D12GraphicsCommandList1* command_list_1_ = nullptr;
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  ID3D12GraphicsCommandList7* command_list_7_ = nullptr;
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
   DeferredCommandList deferred_command_list_;
+  ID3D12CommandSignature* draw_indexed_command_signature_ = nullptr;
+
+  // Lists replayed or awaiting replay on the submission thread, or free for
+  // swapping with deferred_command_list_ when ending a submission.
+  static constexpr size_t kSubmissionThreadCommandListCount = 2;
+  struct PendingSubmission {
+    std::unique_ptr<DeferredCommandList> deferred_command_list;
+    ID3D12CommandAllocator* command_allocator;
+    uint64_t submission_index;
+  };
+  std::unique_ptr<xe::threading::Thread> submission_thread_;
+  std::mutex submission_thread_mutex_;
+  std::condition_variable submission_thread_cond_;
+  bool submission_thread_shutdown_ = false;
+  std::deque<PendingSubmission> submission_thread_queue_;
+  // Submissions queued or being replayed.
+  size_t submission_thread_pending_count_ = 0;
+  std::vector<std::unique_ptr<DeferredCommandList>>
+      submission_thread_free_command_lists_;
 
   // Should bindless textures and samplers be used - many times faster
   // UpdateBindings than bindful (that becomes a significant bottleneck with
@@ -682,6 +811,13 @@ class D3D12CommandProcessor final : public CommandProcessor {
 
   // Unsubmitted barrier batch.
   std::vector<D3D12_RESOURCE_BARRIER> barriers_;
+  // Temporary storage for merging and converting the batch.
+  std::vector<D3D12_RESOURCE_BARRIER> merged_barriers_;
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  std::vector<D3D12_TEXTURE_BARRIER> texture_barriers_;
+  std::vector<D3D12_BUFFER_BARRIER> buffer_barriers_;
+  std::vector<D3D12_GLOBAL_BARRIER> global_barriers_;
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
 
   // <Submission where requested, resource>, sorted by the submission number.
   std::deque<std::pair<uint64_t, ID3D12Resource*>> resources_for_deletion_;
@@ -696,6 +832,89 @@ class D3D12CommandProcessor final : public CommandProcessor {
   ID3D12Resource* readback_buffer_ = nullptr;
   uint32_t readback_buffer_size_ = 0;
 
+  // Readbacks with readback_async. When the ring is full, the oldest one is
+  // awaited.
+  static constexpr size_t kAsyncReadbackRingSize = 16;
+  static constexpr uint32_t kAsyncReadbackBufferSizeIncrement = 1024 * 1024;
+  struct AsyncReadbackBuffer {
+    ID3D12Resource* buffer;
+    uint32_t size;
+  };
+  struct AsyncReadback {
+    AsyncReadbackBuffer buffer;
+    uint64_t submission;
+    // Guest physical address and length, packed in the buffer in this order.
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+  };
+  // Sorted by the submission number.
+  std::deque<AsyncReadback> async_readbacks_pending_;
+  std::vector<AsyncReadbackBuffer> async_readback_buffers_free_;
+  // Guest fence values written while readbacks were pending, stored in the
+  // guest memory by CompleteAsyncReadbacks after the readbacks of the earlier
+  // submissions, so the guest waiting for them sees the readback data, but the
+  // command processor doesn't have to await the submissions to write them.
+  struct DeferredGuestFence {
+    uint64_t submission;
+    uint32_t* destination;
+    uint32_t value;
+  };
+  // Sorted by the submission number.
+  std::deque<DeferredGuestFence> deferred_guest_fences_;
+
+  // Host occlusion queries with query_occlusion_host. Direct3D 12 queries must
+  // begin and end in the same command list, so a guest query is measured in
+  // parts, one per submission, with consecutive indices in the ring of the
+  // host queries, and the results of the parts are summed.
+  static constexpr uint32_t kOcclusionQueryCount = 4096;
+  struct OcclusionQuery {
+    uint32_t sample_counts_address;
+    uint32_t first_part;
+    uint32_t part_count;
+    // The submission of the last part.
+    uint64_t submission;
+    uint64_t frame;
+  };
+  ID3D12QueryHeap* occlusion_query_heap_ = nullptr;
+  // UINT64 sample counts, at the indices of the host queries.
+  ID3D12Resource* occlusion_query_readback_buffer_ = nullptr;
+  uint32_t occlusion_query_next_part_ = 0;
+  uint32_t occlusion_query_parts_used_ = 0;
+  // Sorted by the submission number.
+  std::deque<OcclusionQuery> occlusion_queries_pending_;
+  // The query between the guest begin and end events.
+  OcclusionQuery occlusion_query_active_;
+  bool occlusion_query_is_active_ = false;
+  // Whether the last part of the active query is begun in the open submission.
+  bool occlusion_query_part_open_ = false;
+
+  // Timestamp queries with gpu_timestamps, in a ring.
+  static constexpr uint32_t kGpuTimestampCount = 8192;
+  // The most timings kept for TakeGpuTimings, the newer ones are dropped.
+  static constexpr size_t kGpuTimingsCompletedMax = 65536;
+  struct GpuTimestampRange {
+    GpuTiming timing;
+    uint32_t begin_index;
+    // UINT32_MAX if failed to write the timestamp at the end.
+    uint32_t end_index;
+    // The submission of the last timestamp.
+    uint64_t submission;
+  };
+  ID3D12QueryHeap* gpu_timestamp_heap_ = nullptr;
+  // UINT64 timestamps, at the indices of the queries.
+  ID3D12Resource* gpu_timestamp_readback_buffer_ = nullptr;
+  uint64_t gpu_timestamp_frequency_ = 0;
+  uint32_t gpu_timestamp_next_ = 0;
+  uint32_t gpu_timestamps_used_ = 0;
+  uint32_t gpu_timestamp_submission_count_ = 0;
+  // Sorted by the submission number.
+  std::deque<GpuTimestampRange> gpu_timestamp_ranges_pending_;
+  bool gpu_timings_taken_ = false;
+  std::vector<GpuTiming> gpu_timings_completed_;
+  // Totals of the frame of the last completed timing, for the profiler.
+  uint64_t gpu_timings_frame_ = 0;
+  std::array<double, size_t(GpuTiming::Kind::kCount)> gpu_timings_frame_us_ =
+      {};
+
   // The current fixed-function drawing state.
   D3D12_VIEWPORT ff_viewport_;
   D3D12_RECT ff_scissor_;
@@ -11,16 +11,24 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "third_party/dxbc/DXBCChecksum.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/math.h"
 #include "xenia/gpu/d3d12/d3d12_command_processor.h"
 #include "xenia/gpu/d3d12/deferred_command_list.h"
+#include "xenia/gpu/dxbc.h"
 #include "xenia/ui/d3d12/d3d12_provider.h"
 #include "xenia/ui/d3d12/d3d12_util.h"
 
+DECLARE_bool(convert_indices_on_gpu);
+
 namespace xe {
 namespace gpu {
 namespace d3d12 {
@@ -28,28 +36,41 @@ namespace d3d12 {
 D3D12PrimitiveProcessor::~D3D12PrimitiveProcessor() { Shutdown(true); }
 
 bool D3D12PrimitiveProcessor::Initialize() {
-  if (!InitializeCommon(true, false, false, true, true, true)) {
+  // Not fatal if failed - converting the indices on the CPU in this case.
+  bool gpu_index_conversion_supported =
+      cvars::convert_indices_on_gpu && InitializeGpuIndexConversion();
+  if (!InitializeCommon(true, false, false, true, true, true,
+                        gpu_index_conversion_supported)) {
     Shutdown();
     return false;
   }
   frame_index_buffer_pool_ = std::make_unique<ui::d3d12::D3D12UploadBufferPool>(
       command_processor_.GetD3D12Provider(),
       std::max(size_t(kMinRequiredConvertedIndexBufferSize),
-               ui::GraphicsUploadBufferPool::kDefaultPageSize));
+               ui::GraphicsUploadBufferPool::kDefaultPageSize),
+      "d3d12/indices");
   return true;
 }
 
 void D3D12PrimitiveProcessor::Shutdown(bool from_destructor) {
+  DestroyPersistentIndexBufferChunks();
   frame_index_buffers_.clear();
   frame_index_buffer_pool_.reset();
   builtin_index_buffer_upload_.Reset();
   builtin_index_buffer_gpu_address_ = 0;
   builtin_index_buffer_.Reset();
+  gpu_index_conversion_pipeline_.Reset();
+  gpu_index_conversion_root_signature_.Reset();
   if (!from_destructor) {
     ShutdownCommon();
   }
 }
 
+void D3D12PrimitiveProcessor::ClearCache() {
+  ClearCacheCommon();
+  frame_index_buffer_pool_->ClearCache();
+}
+
 void D3D12PrimitiveProcessor::CompletedSubmissionUpdated() {
   if (builtin_index_buffer_upload_ &&
       command_processor_.GetCompletedSubmission() >=
@@ -79,10 +100,52 @@ void D3D12PrimitiveProcessor::BeginFrame() {
 }
 
 void D3D12PrimitiveProcessor::EndFrame() {
-  ClearPerFrameCache();
+  ClearPerFrameCache(command_processor_.GetCurrentFrame(),
+                     command_processor_.GetCompletedFrame());
   frame_index_buffers_.clear();
 }
 
+void D3D12PrimitiveProcessor::ConvertIndicesOnGpu(
+    const ProcessingResult& processing_result,
+    D3D12_GPU_VIRTUAL_ADDRESS shared_memory_address,
+    D3D12_GPU_VIRTUAL_ADDRESS dest_address) {
+  assert_true(processing_result.index_buffer_type ==
+              ProcessedIndexBufferType::kGpuConverted);
+  assert_not_null(gpu_index_conversion_pipeline_);
+  GpuIndexConversionConstants constants;
+  constants.guest_index_base = processing_result.guest_index_base;
+  constants.host_index_count = processing_result.host_draw_vertex_count;
+  constants.guest_index_count = processing_result.guest_index_count;
+  constants.flags = uint32_t(processing_result.gpu_index_conversion);
+  if (processing_result.guest_index_format == xenos::IndexFormat::kInt32) {
+    constants.flags |= kGpuIndexConversionFlag32Bit;
+  }
+  constants.reset_index_guest_endian =
+      processing_result.gpu_reset_index_guest_endian;
+  constants.index_mask_guest_endian =
+      processing_result.gpu_index_mask_guest_endian;
+  constants.padding[0] = 0;
+  constants.padding[1] = 0;
+  DeferredCommandList& command_list =
+      command_processor_.GetDeferredCommandList();
+  command_list.D3DSetComputeRootSignature(
+      gpu_index_conversion_root_signature_.Get());
+  command_list.D3DSetComputeRoot32BitConstants(
+      kGpuIndexConversionRootParameterConstants,
+      sizeof(constants) / sizeof(uint32_t), &constants, 0);
+  command_list.D3DSetComputeRootShaderResourceView(
+      kGpuIndexConversionRootParameterSource, shared_memory_address);
+  command_list.D3DSetComputeRootUnorderedAccessView(
+      kGpuIndexConversionRootParameterDest, dest_address);
+  command_processor_.SetExternalPipeline(gpu_index_conversion_pipeline_.Get());
+  command_processor_.SubmitBarriers();
+  command_list.D3DDispatch(
+      (processing_result.host_draw_vertex_count +
+       (kGpuIndexConversionGroupSize - 1)) /
+          kGpuIndexConversionGroupSize,
+      1, 1);
+}
+
 bool D3D12PrimitiveProcessor::InitializeBuiltinIndexBuffer(
     size_t size_bytes, std::function<void(void*)> fill_callback) {
   assert_not_zero(size_bytes);
@@ -167,6 +230,515 @@ void* D3D12PrimitiveProcessor::RequestHostConvertedIndexBufferForCurrentFrame(
   return mapping;
 }
 
+void* D3D12PrimitiveProcessor::CreatePersistentIndexBufferChunk(
+    uint32_t chunk_index) {
+  assert_true(chunk_index == persistent_index_buffers_.size());
+  const ui::d3d12::D3D12Provider& provider =
+      command_processor_.GetD3D12Provider();
+  D3D12_RESOURCE_DESC resource_desc;
+  ui::d3d12::util::FillBufferResourceDesc(
+      resource_desc, kPersistentIndexBufferChunkSize, D3D12_RESOURCE_FLAG_NONE);
+  Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+  if (!provider.CreateUploadResource(
+          provider.GetHeapFlagCreateNotZeroed(), &resource_desc,
+          D3D12_RESOURCE_STATE_GENERIC_READ, IID_PPV_ARGS(&resource))) {
+    XELOGE(
+        "D3D12 primitive processor: Failed to create a {} MB buffer for "
+        "converted indices persistent across frames",
+        kPersistentIndexBufferChunkSize >> 20);
+    return nullptr;
+  }
+  D3D12_RANGE read_range = {};
+  void* mapping;
+  if (FAILED(resource->Map(0, &read_range, &mapping))) {
+    XELOGE(
+        "D3D12 primitive processor: Failed to map a {} MB buffer for "
+        "converted indices persistent across frames",
+        kPersistentIndexBufferChunkSize >> 20);
+    return nullptr;
+  }
+  persistent_index_buffers_.push_back(std::move(resource));
+  return mapping;
+}
+
+void D3D12PrimitiveProcessor::DestroyPersistentIndexBufferChunks() {
+  // Upload heap resources may be released while mapped.
+  persistent_index_buffers_.clear();
+}
+
+bool D3D12PrimitiveProcessor::InitializeGpuIndexConversion() {
+  const ui::d3d12::D3D12Provider& provider =
+      command_processor_.GetD3D12Provider();
+
+  // Root signature - constants, the shared memory and the destination as root
+  // descriptors of raw buffers, so no descriptor heap is needed.
+  D3D12_ROOT_PARAMETER root_parameters[kGpuIndexConversionRootParameterCount];
+  {
+    D3D12_ROOT_PARAMETER& root_constants =
+        root_parameters[kGpuIndexConversionRootParameterConstants];
+    root_constants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    root_constants.Constants.ShaderRegister = 0;
+    root_constants.Constants.RegisterSpace = 0;
+    root_constants.Constants.Num32BitValues =
+        sizeof(GpuIndexConversionConstants) / sizeof(uint32_t);
+    root_constants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    D3D12_ROOT_PARAMETER& root_source =
+        root_parameters[kGpuIndexConversionRootParameterSource];
+    root_source.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    root_source.Descriptor.ShaderRegister = 0;
+    root_source.Descriptor.RegisterSpace = 0;
+    root_source.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    D3D12_ROOT_PARAMETER& root_dest =
+        root_parameters[kGpuIndexConversionRootParameterDest];
+    root_dest.ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+    root_dest.Descriptor.ShaderRegister = 0;
+    root_dest.Descriptor.RegisterSpace = 0;
+    root_dest.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+  }
+  D3D12_ROOT_SIGNATURE_DESC root_signature_desc;
+  root_signature_desc.NumParameters = UINT(xe::countof(root_parameters));
+  root_signature_desc.pParameters = root_parameters;
+  root_signature_desc.NumStaticSamplers = 0;
+  root_signature_desc.pStaticSamplers = nullptr;
+  root_signature_desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+  gpu_index_conversion_root_signature_.Attach(
+      ui::d3d12::util::CreateRootSignature(provider, root_signature_desc));
+  if (!gpu_index_conversion_root_signature_) {
+    XELOGE(
+        "D3D12 primitive processor: Failed to create the GPU index conversion "
+        "root signature");
+    return false;
+  }
+
+  // The shader, equivalent to:
+  //   cbuffer xe_index_conversion_constants : register(b0) {
+  //     uint4 xe_index_conversion_source;
+  //     uint4 xe_index_conversion_reset;
+  //   };
+  //   ByteAddressBuffer xe_shared_memory : register(t0);
+  //   RWByteAddressBuffer xe_index_conversion_dest : register(u0);
+  //   [numthreads(64, 1, 1)]
+  //   void main(uint3 xe_thread_id : SV_DispatchThreadID) {
+  //     uint host_index = xe_thread_id.x;
+  //     if (host_index >= xe_index_conversion_source.y) return;
+  //     uint guest_index;
+  //     switch (xe_index_conversion_source.w & 3) {
+  //       case kTriangleFanToList: {
+  //         uint triangle = host_index / 3, vertex = host_index % 3;
+  //         guest_index = vertex == 2 ? 0 : triangle + 1 + vertex;
+  //       } break;
+  //       case kLineLoopToStrip:
+  //         guest_index = host_index < xe_index_conversion_source.z
+  //                       ? host_index : 0;
+  //         break;
+  //       case kQuadListToTriangleList: {
+  //         uint quad = host_index / 6, vertex = host_index % 6;
+  //         guest_index =
+  //             quad * 4 + (vertex < 3 ? vertex
+  //                                    : (vertex == 3 ? 0 : vertex - 2));
+  //       } break;
+  //       default:
+  //         guest_index = host_index;
+  //         break;
+  //     }
+  //     uint index;
+  //     if (xe_index_conversion_source.w & 4) {
+  //       index = xe_shared_memory.Load(xe_index_conversion_source.x +
+  //                                     guest_index * 4);
+  //     } else {
+  //       uint address = xe_index_conversion_source.x + guest_index * 2;
+  //       index =
+  //           (xe_shared_memory.Load(address & ~3) >> ((address & 2) * 8)) &
+  //           0xFFFF;
+  //     }
+  //     if ((xe_index_conversion_source.w & 3) == kResetIndexReplace) {
+  //       index &= xe_index_conversion_reset.y;
+  //       if (index == xe_index_conversion_reset.x) index = 0xFFFFFFFF;
+  //     }
+  //     xe_index_conversion_dest.Store(host_index * 4, index);
+  //   }
+  std::vector<uint32_t> shader;
+
+  // RDEF, ISGN, OSGN, SHEX, STAT.
+  constexpr uint32_t kBlobCount = 5;
+  shader.resize(sizeof(dxbc::ContainerHeader) / sizeof(uint32_t) + kBlobCount);
+  uint32_t blob_offset_position_dwords =
+      sizeof(dxbc::ContainerHeader) / sizeof(uint32_t);
+  uint32_t blob_position_dwords = uint32_t(shader.size());
+  constexpr uint32_t kBlobHeaderSizeDwords =
+      sizeof(dxbc::BlobHeader) / sizeof(uint32_t);
+  uint32_t name_ptr;
+
+  // Resource definition.
+  shader[blob_offset_position_dwords] =
+      uint32_t(blob_position_dwords * sizeof(uint32_t));
+  uint32_t rdef_position_dwords = blob_position_dwords + kBlobHeaderSizeDwords;
+  shader.resize(rdef_position_dwords +
+                sizeof(dxbc::RdefHeader) / sizeof(uint32_t));
+  dxbc::AppendAlignedString(shader, "Xenia");
+  // Constant type - uint4.
+  name_ptr =
+      uint32_t((shader.size() - rdef_position_dwords) * sizeof(uint32_t));
+  uint32_t rdef_uint4_name_ptr = name_ptr;
+  name_ptr += dxbc::AppendAlignedString(shader, "uint4");
+  uint32_t rdef_type_uint4_position_dwords = uint32_t(shader.size());
+  uint32_t rdef_type_uint4_ptr =
+      uint32_t((rdef_type_uint4_position_dwords - rdef_position_dwords) *
+               sizeof(uint32_t));
+  shader.resize(rdef_type_uint4_position_dwords +
+                sizeof(dxbc::RdefType) / sizeof(uint32_t));
+  {
+    auto& rdef_type_uint4 = *reinterpret_cast<dxbc::RdefType*>(
+        shader.data() + rdef_type_uint4_position_dwords);
+    rdef_type_uint4.variable_class = dxbc::RdefVariableClass::kVector;
+    rdef_type_uint4.variable_type = dxbc::RdefVariableType::kUInt;
+    rdef_type_uint4.row_count = 1;
+    rdef_type_uint4.column_count = 4;
+    rdef_type_uint4.name_ptr = rdef_uint4_name_ptr;
+  }
+  // Constants.
+  const char* const kConstantNames[] = {
+      "xe_index_conversion_source",
+      "xe_index_conversion_reset",
+  };
+  constexpr uint32_t kConstantCount = uint32_t(xe::countof(kConstantNames));
+  uint32_t rdef_constant_name_ptrs[kConstantCount];
+  for (uint32_t i = 0; i < kConstantCount; ++i) {
+    rdef_constant_name_ptrs[i] = name_ptr;
+    name_ptr += dxbc::AppendAlignedString(shader, kConstantNames[i]);
+  }
+  uint32_t rdef_cbuffer_name_ptr = name_ptr;
+  name_ptr +=
+      dxbc::AppendAlignedString(shader, "xe_index_conversion_constants");
+  uint32_t rdef_constants_position_dwords = uint32_t(shader.size());
+  uint32_t rdef_constants_ptr =
+      uint32_t((rdef_constants_position_dwords - rdef_position_dwords) *
+               sizeof(uint32_t));
+  shader.resize(rdef_constants_position_dwords +
+                sizeof(dxbc::RdefVariable) / sizeof(uint32_t) * kConstantCount);
+  {
+    auto rdef_constants = reinterpret_cast<dxbc::RdefVariable*>(
+        shader.data() + rdef_constants_position_dwords);
+    for (uint32_t i = 0; i < kConstantCount; ++i) {
+      dxbc::RdefVariable& rdef_constant = rdef_constants[i];
+      rdef_constant.name_ptr = rdef_constant_name_ptrs[i];
+      rdef_constant.start_offset_bytes = sizeof(uint32_t) * 4 * i;
+      rdef_constant.size_bytes = sizeof(uint32_t) * 4;
+      rdef_constant.flags = dxbc::kRdefVariableFlagUsed;
+      rdef_constant.type_ptr = rdef_type_uint4_ptr;
+      rdef_constant.start_texture = UINT32_MAX;
+      rdef_constant.start_sampler = UINT32_MAX;
+    }
+  }
+  // Constant buffer.
+  uint32_t rdef_cbuffer_position_dwords = uint32_t(shader.size());
+  shader.resize(rdef_cbuffer_position_dwords +
+                sizeof(dxbc::RdefCbuffer) / sizeof(uint32_t));
+  {
+    auto& rdef_cbuffer = *reinterpret_cast<dxbc::RdefCbuffer*>(
+        shader.data() + rdef_cbuffer_position_dwords);
+    rdef_cbuffer.name_ptr = rdef_cbuffer_name_ptr;
+    rdef_cbuffer.variable_count = kConstantCount;
+    rdef_cbuffer.variables_ptr = rdef_constants_ptr;
+    rdef_cbuffer.size_vector_aligned_bytes =
+        sizeof(GpuIndexConversionConstants);
+  }
+  // Bindings - SRVs, UAVs, CBVs.
+  uint32_t rdef_shared_memory_name_ptr = name_ptr;
+  name_ptr += dxbc::AppendAlignedString(shader, "xe_shared_memory");
+  uint32_t rdef_dest_name_ptr = name_ptr;
+  name_ptr += dxbc::AppendAlignedString(shader, "xe_index_conversion_dest");
+  constexpr uint32_t kBindingCount = 3;
+  uint32_t rdef_binding_position_dwords = uint32_t(shader.size());
+  shader.resize(rdef_binding_position_dwords +
+                sizeof(dxbc::RdefInputBind) / sizeof(uint32_t) * kBindingCount);
+  {
+    auto rdef_bindings = reinterpret_cast<dxbc::RdefInputBind*>(
+        shader.data() + rdef_binding_position_dwords);
+    dxbc::RdefInputBind& rdef_binding_shared_memory = rdef_bindings[0];
+    rdef_binding_shared_memory.name_ptr = rdef_shared_memory_name_ptr;
+    rdef_binding_shared_memory.type = dxbc::RdefInputType::kByteAddress;
+    rdef_binding_shared_memory.return_type = dxbc::ResourceReturnType::kMixed;
+    rdef_binding_shared_memory.dimension = dxbc::RdefDimension::kSRVBuffer;
+    rdef_binding_shared_memory.bind_count = 1;
+    dxbc::RdefInputBind& rdef_binding_dest = rdef_bindings[1];
+    rdef_binding_dest.name_ptr = rdef_dest_name_ptr;
+    rdef_binding_dest.type = dxbc::RdefInputType::kUAVRWByteAddress;
+    rdef_binding_dest.return_type = dxbc::ResourceReturnType::kMixed;
+    rdef_binding_dest.dimension = dxbc::RdefDimension::kUAVBuffer;
+    rdef_binding_dest.bind_count = 1;
+    dxbc::RdefInputBind& rdef_binding_constants = rdef_bindings[2];
+    rdef_binding_constants.name_ptr = rdef_cbuffer_name_ptr;
+    rdef_binding_constants.type = dxbc::RdefInputType::kCbuffer;
+    rdef_binding_constants.bind_count = 1;
+    rdef_binding_constants.flags = dxbc::kRdefInputFlagUserPacked;
+  }
+  // Header.
+  {
+    auto& rdef_header = *reinterpret_cast<dxbc::RdefHeader*>(
+        shader.data() + rdef_position_dwords);
+    rdef_header.cbuffer_count = 1;
+    rdef_header.cbuffers_ptr =
+        uint32_t((rdef_cbuffer_position_dwords - rdef_position_dwords) *
+                 sizeof(uint32_t));
+    rdef_header.input_bind_count = kBindingCount;
+    rdef_header.input_binds_ptr =
+        uint32_t((rdef_binding_position_dwords - rdef_position_dwords) *
+                 sizeof(uint32_t));
+    rdef_header.shader_model = dxbc::RdefShaderModel::kComputeShader5_1;
+    rdef_header.compile_flags =
+        dxbc::kCompileFlagNoPreshader | dxbc::kCompileFlagPreferFlowControl |
+        dxbc::kCompileFlagIeeeStrictness | dxbc::kCompileFlagAllResourcesBound;
+    // Generator name is right after the header.
+    rdef_header.generator_name_ptr = sizeof(dxbc::RdefHeader);
+    rdef_header.fourcc = dxbc::RdefHeader::FourCC::k5_1;
+    rdef_header.InitializeSizes();
+  }
+  {
+    auto& blob_header = *reinterpret_cast<dxbc::BlobHeader*>(
+        shader.data() + blob_position_dwords);
+    blob_header.fourcc = dxbc::BlobHeader::FourCC::kResourceDefinition;
+    blob_position_dwords = uint32_t(shader.size());
+    blob_header.size_bytes =
+        (blob_position_dwords - kBlobHeaderSizeDwords) * sizeof(uint32_t) -
+        shader[blob_offset_position_dwords++];
+  }
+
+  // Input and output signatures (empty).
+  for (uint32_t i = 0; i < 2; ++i) {
+    shader[blob_offset_position_dwords] =
+        uint32_t(blob_position_dwords * sizeof(uint32_t));
+    uint32_t signature_position_dwords =
+        blob_position_dwords + kBlobHeaderSizeDwords;
+    shader.resize(signature_position_dwords +
+                  sizeof(dxbc::Signature) / sizeof(uint32_t));
+    {
+      auto& signature = *reinterpret_cast<dxbc::Signature*>(
+          shader.data() + signature_position_dwords);
+      // Empty - just set parameter pointer to the end.
+      signature.parameter_info_ptr = sizeof(dxbc::Signature);
+    }
+    {
+      auto& blob_header = *reinterpret_cast<dxbc::BlobHeader*>(
+          shader.data() + blob_position_dwords);
+      blob_header.fourcc = i ? dxbc::BlobHeader::FourCC::kOutputSignature
+                             : dxbc::BlobHeader::FourCC::kInputSignature;
+      blob_position_dwords = uint32_t(shader.size());
+      blob_header.size_bytes =
+          (blob_position_dwords - kBlobHeaderSizeDwords) * sizeof(uint32_t) -
+          shader[blob_offset_position_dwords++];
+    }
+  }
+
+  // Shader program.
+  shader[blob_offset_position_dwords] =
+      uint32_t(blob_position_dwords * sizeof(uint32_t));
+  uint32_t shex_position_dwords = blob_position_dwords + kBlobHeaderSizeDwords;
+  shader.resize(shex_position_dwords);
+  shader.push_back(dxbc::VersionToken(dxbc::ProgramType::kComputeShader, 5, 1));
+  // Reserve space for the length token.
+  shader.push_back(0);
+  dxbc::Statistics stat;
+  std::memset(&stat, 0, sizeof(dxbc::Statistics));
+  dxbc::Assembler a(shader, stat);
+  a.OpDclGlobalFlags(dxbc::kGlobalFlagAllResourcesBound);
+  a.OpDclConstantBuffer(dxbc::Src::CB(dxbc::Src::Dcl, 0, 0, 0),
+                        kConstantCount);
+  a.OpDclResourceRaw(dxbc::Src::T(dxbc::Src::Dcl, 0, 0, 0));
+  a.OpDclUnorderedAccessViewRaw(0, dxbc::Src::U(dxbc::Src::Dcl, 0, 0, 0));
+  a.OpDclInput(dxbc::Dest::VThreadID(0b0001));
+  stat.temp_register_count = 2;
+  a.OpDclTemps(stat.temp_register_count);
+  a.OpDclThreadGroup(kGpuIndexConversionGroupSize, 1, 1);
+
+  dxbc::Src host_index_src = dxbc::Src::VThreadID(dxbc::Src::kXXXX);
+  dxbc::Src guest_index_base_src = dxbc::Src::CB(0, 0, 0, dxbc::Src::kXXXX);
+  dxbc::Src host_index_count_src = dxbc::Src::CB(0, 0, 0, dxbc::Src::kYYYY);
+  dxbc::Src guest_index_count_src = dxbc::Src::CB(0, 0, 0, dxbc::Src::kZZZZ);
+  dxbc::Src flags_src = dxbc::Src::CB(0, 0, 0, dxbc::Src::kWWWW);
+  dxbc::Src reset_index_src = dxbc::Src::CB(0, 0, 1, dxbc::Src::kXXXX);
+  dxbc::Src index_mask_src = dxbc::Src::CB(0, 0, 1, dxbc::Src::kYYYY);
+
+  // Drop the threads beyond the host index count.
+  a.OpUGE(dxbc::Dest::R(0, 0b0001), host_index_src, host_index_count_src);
+  a.OpRetC(true, dxbc::Src::R(0, dxbc::Src::kXXXX));
+
+  // Get the guest index to r0.x.
+  a.OpAnd(dxbc::Dest::R(0, 0b0001), flags_src, dxbc::Src::LU(0b11));
+  a.OpSwitch(dxbc::Src::R(0, dxbc::Src::kXXXX));
+  a.OpCase(dxbc::Src::LU(uint32_t(GpuIndexConversion::kTriangleFanToList)));
+  {
+    // r0.y = triangle index
+    // r0.z = vertex index in the triangle
+    a.OpUDiv(dxbc::Dest::R(0, 0b0010), dxbc::Dest::R(0, 0b0100),
+             host_index_src, dxbc::Src::LU(3));
+    // Like TriangleFanToList - (1 + triangle, 2 + triangle, 0).
+    a.OpIAdd(dxbc::Dest::R(0, 0b1000), dxbc::Src::R(0, dxbc::Src::kYYYY),
+             dxbc::Src::R(0, dxbc::Src::kZZZZ));
+    a.OpIAdd(dxbc::Dest::R(0, 0b1000), dxbc::Src::R(0, dxbc::Src::kWWWW),
+             dxbc::Src::LU(1));
+    a.OpIEq(dxbc::Dest::R(0, 0b0100), dxbc::Src::R(0, dxbc::Src::kZZZZ),
+            dxbc::Src::LU(2));
+    a.OpMovC(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kZZZZ),
+             dxbc::Src::LU(0), dxbc::Src::R(0, dxbc::Src::kWWWW));
+  }
+  a.OpBreak();
+  a.OpCase(dxbc::Src::LU(uint32_t(GpuIndexConversion::kLineLoopToStrip)));
+  {
+    // Like LineLoopToStrip - closing with the first index.
+    a.OpULT(dxbc::Dest::R(0, 0b0010), host_index_src, guest_index_count_src);
+    a.OpMovC(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kYYYY),
+             host_index_src, dxbc::Src::LU(0));
+  }
+  a.OpBreak();
+  a.OpCase(
+      dxbc::Src::LU(uint32_t(GpuIndexConversion::kQuadListToTriangleList)));
+  {
+    // r0.y = quad index
+    // r0.z = vertex index in the two triangles
+    a.OpUDiv(dxbc::Dest::R(0, 0b0010), dxbc::Dest::R(0, 0b0100),
+             host_index_src, dxbc::Src::LU(6));
+    // Like QuadListToTriangleList - (0, 1, 2), (0, 2, 3).
+    // r0.w = vertex index in the quad
+    a.OpIAdd(dxbc::Dest::R(0, 0b1000), dxbc::Src::R(0, dxbc::Src::kZZZZ),
+             dxbc::Src::LI(-2));
+    a.OpIEq(dxbc::Dest::R(1, 0b0001), dxbc::Src::R(0, dxbc::Src::kZZZZ),
+            dxbc::Src::LU(3));
+    a.OpMovC(dxbc::Dest::R(0, 0b1000), dxbc::Src::R(1, dxbc::Src::kXXXX),
+             dxbc::Src::LU(0), dxbc::Src::R(0, dxbc::Src::kWWWW));
+    a.OpULT(dxbc::Dest::R(1, 0b0001), dxbc::Src::R(0, dxbc::Src::kZZZZ),
+            dxbc::Src::LU(3));
+    a.OpMovC(dxbc::Dest::R(0, 0b1000), dxbc::Src::R(1, dxbc::Src::kXXXX),
+             dxbc::Src::R(0, dxbc::Src::kZZZZ),
+             dxbc::Src::R(0, dxbc::Src::kWWWW));
+    a.OpUMAd(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kYYYY),
+             dxbc::Src::LU(4), dxbc::Src::R(0, dxbc::Src::kWWWW));
+  }
+  a.OpBreak();
+  a.OpDefault();
+  {
+    // Reset index replacement - same layout.
+    a.OpMov(dxbc::Dest::R(0, 0b0001), host_index_src);
+  }
+  a.OpBreak();
+  a.OpEndSwitch();
+
+  // Load the guest index to r0.x.
+  a.OpAnd(dxbc::Dest::R(0, 0b0010), flags_src,
+          dxbc::Src::LU(kGpuIndexConversionFlag32Bit));
+  a.OpIf(true, dxbc::Src::R(0, dxbc::Src::kYYYY));
+  {
+    a.OpIShL(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kXXXX),
+             dxbc::Src::LU(2));
+    a.OpIAdd(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kXXXX),
+             guest_index_base_src);
+    a.OpLdRaw(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kXXXX),
+              dxbc::Src::T(0, 0, dxbc::Src::kXXXX));
+  }
+  a.OpElse();
+  {
+    // r0.x = byte address of the 16-bit index
+    a.OpIShL(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kXXXX),
+             dxbc::Src::LU(1));
+    a.OpIAdd(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kXXXX),
+             guest_index_base_src);
+    // r0.y = dword containing the index
+    a.OpAnd(dxbc::Dest::R(0, 0b0010), dxbc::Src::R(0, dxbc::Src::kXXXX),
+            dxbc::Src::LU(~uint32_t(3)));
+    a.OpLdRaw(dxbc::Dest::R(0, 0b0010), dxbc::Src::R(0, dxbc::Src::kYYYY),
+              dxbc::Src::T(0, 0, dxbc::Src::kXXXX));
+    // r0.x = bit offset of the index in the dword
+    a.OpAnd(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kXXXX),
+            dxbc::Src::LU(2));
+    a.OpIShL(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kXXXX),
+             dxbc::Src::LU(3));
+    a.OpUBFE(dxbc::Dest::R(0, 0b0001), dxbc::Src::LU(16),
+             dxbc::Src::R(0, dxbc::Src::kXXXX),
+             dxbc::Src::R(0, dxbc::Src::kYYYY));
+  }
+  a.OpEndIf();
+
+  // Replace the reset index.
+  a.OpAnd(dxbc::Dest::R(0, 0b0010), flags_src, dxbc::Src::LU(0b11));
+  a.OpIEq(dxbc::Dest::R(0, 0b0010), dxbc::Src::R(0, dxbc::Src::kYYYY),
+          dxbc::Src::LU(uint32_t(GpuIndexConversion::kResetIndexReplace)));
+  a.OpIf(true, dxbc::Src::R(0, dxbc::Src::kYYYY));
+  {
+    a.OpAnd(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kXXXX),
+            index_mask_src);
+    a.OpIEq(dxbc::Dest::R(0, 0b0010), dxbc::Src::R(0, dxbc::Src::kXXXX),
+            reset_index_src);
+    a.OpMovC(dxbc::Dest::R(0, 0b0001), dxbc::Src::R(0, dxbc::Src::kYYYY),
+             dxbc::Src::LU(UINT32_MAX), dxbc::Src::R(0, dxbc::Src::kXXXX));
+  }
+  a.OpEndIf();
+
+  // Store the host index.
+  a.OpIShL(dxbc::Dest::R(0, 0b0010), host_index_src, dxbc::Src::LU(2));
+  a.OpStoreRaw(dxbc::Dest::U(0, 0, 0b0001), dxbc::Src::R(0, dxbc::Src::kYYYY),
+               dxbc::Src::R(0, dxbc::Src::kXXXX));
+
+  a.OpRet();
+
+  // Write the shader program length in dwords.
+  shader[shex_position_dwords + 1] =
+      uint32_t(shader.size()) - shex_position_dwords;
+  {
+    auto& blob_header = *reinterpret_cast<dxbc::BlobHeader*>(
+        shader.data() + blob_position_dwords);
+    blob_header.fourcc = dxbc::BlobHeader::FourCC::kShaderEx;
+    blob_position_dwords = uint32_t(shader.size());
+    blob_header.size_bytes =
+        (blob_position_dwords - kBlobHeaderSizeDwords) * sizeof(uint32_t) -
+        shader[blob_offset_position_dwords++];
+  }
+
+  // Statistics.
+  shader[blob_offset_position_dwords] =
+      uint32_t(blob_position_dwords * sizeof(uint32_t));
+  uint32_t stat_position_dwords = blob_position_dwords + kBlobHeaderSizeDwords;
+  shader.resize(stat_position_dwords +
+                sizeof(dxbc::Statistics) / sizeof(uint32_t));
+  std::memcpy(shader.data() + stat_position_dwords, &stat,
+              sizeof(dxbc::Statistics));
+  {
+    auto& blob_header = *reinterpret_cast<dxbc::BlobHeader*>(
+        shader.data() + blob_position_dwords);
+    blob_header.fourcc = dxbc::BlobHeader::FourCC::kStatistics;
+    blob_position_dwords = uint32_t(shader.size());
+    blob_header.size_bytes =
+        (blob_position_dwords - kBlobHeaderSizeDwords) * sizeof(uint32_t) -
+        shader[blob_offset_position_dwords++];
+  }
+
+  // Container header.
+  uint32_t shader_size_bytes = uint32_t(shader.size() * sizeof(uint32_t));
+  {
+    auto& container_header =
+        *reinterpret_cast<dxbc::ContainerHeader*>(shader.data());
+    container_header.InitializeIdentification();
+    container_header.size_bytes = shader_size_bytes;
+    container_header.blob_count = kBlobCount;
+    CalculateDXBCChecksum(
+        reinterpret_cast<unsigned char*>(shader.data()),
+        static_cast<unsigned int>(shader_size_bytes),
+        reinterpret_cast<unsigned int*>(&container_header.hash));
+  }
+
+  gpu_index_conversion_pipeline_.Attach(ui::d3d12::util::CreateComputePipeline(
+      provider.GetDevice(), shader.data(), shader_size_bytes,
+      gpu_index_conversion_root_signature_.Get()));
+  if (!gpu_index_conversion_pipeline_) {
+    XELOGE(
+        "D3D12 primitive processor: Failed to create the GPU index conversion "
+        "pipeline");
+    gpu_index_conversion_root_signature_.Reset();
+    return false;
+  }
+  gpu_index_conversion_pipeline_->SetName(L"GPU Index Conversion");
+  return true;
+}
+
 }  // namespace d3d12
 }  // namespace gpu
 }  // namespace xe
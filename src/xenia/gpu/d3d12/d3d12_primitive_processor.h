@@ -13,6 +13,7 @@
 #include <cstdint>
 #include <deque>
 #include <memory>
+#include <vector>
 
 #include "xenia/base/assert.h"
 #include "xenia/gpu/primitive_processor.h"
@@ -37,7 +38,7 @@ class D3D12PrimitiveProcessor final : public PrimitiveProcessor {
 
   bool Initialize();
   void Shutdown(bool from_destructor = false);
-  void ClearCache() { frame_index_buffer_pool_->ClearCache(); }
+  void ClearCache();
 
   void CompletedSubmissionUpdated();
   void BeginSubmission();
@@ -52,9 +53,24 @@ class D3D12PrimitiveProcessor final : public PrimitiveProcessor {
   }
   D3D12_GPU_VIRTUAL_ADDRESS GetConvertedIndexBufferGpuAddress(
       size_t handle) const {
+    if (IsPersistentIndexBufferHandle(handle)) {
+      return D3D12_GPU_VIRTUAL_ADDRESS(
+          persistent_index_buffers_[GetPersistentIndexBufferChunk(handle)]
+              ->GetGPUVirtualAddress() +
+          GetPersistentIndexBufferOffset(handle));
+    }
     return frame_index_buffers_[handle];
   }
 
+  // Records the conversion of the indices for ProcessedIndexBufferType
+  // kGpuConverted from the shared memory buffer, which must be in a state
+  // readable by non-pixel shaders, to a buffer in the unordered access state
+  // with space for 32-bit host_draw_vertex_count indices. Binds a compute
+  // pipeline, so the graphics pipeline must be rebound after this.
+  void ConvertIndicesOnGpu(const ProcessingResult& processing_result,
+                           D3D12_GPU_VIRTUAL_ADDRESS shared_memory_address,
+                           D3D12_GPU_VIRTUAL_ADDRESS dest_address);
+
  protected:
   bool InitializeBuiltinIndexBuffer(
       size_t size_bytes, std::function<void(void*)> fill_callback) override;
@@ -64,7 +80,36 @@ class D3D12PrimitiveProcessor final : public PrimitiveProcessor {
       uint32_t coalignment_original_address,
       size_t& backend_handle_out) override;
 
+  void* CreatePersistentIndexBufferChunk(uint32_t chunk_index) override;
+  void DestroyPersistentIndexBufferChunks() override;
+
  private:
+  enum GpuIndexConversionRootParameter : UINT {
+    kGpuIndexConversionRootParameterConstants,
+    kGpuIndexConversionRootParameterSource,
+    kGpuIndexConversionRootParameterDest,
+
+    kGpuIndexConversionRootParameterCount,
+  };
+
+  // Laid out as two uint4 vectors.
+  struct GpuIndexConversionConstants {
+    uint32_t guest_index_base;
+    uint32_t host_index_count;
+    uint32_t guest_index_count;
+    // GpuIndexConversion in bits 0:1, 32-bit guest indices in bit 2.
+    uint32_t flags;
+    uint32_t reset_index_guest_endian;
+    uint32_t index_mask_guest_endian;
+    uint32_t padding[2];
+  };
+  static constexpr uint32_t kGpuIndexConversionFlag32Bit = uint32_t(1) << 2;
+  static constexpr uint32_t kGpuIndexConversionGroupSize = 64;
+
+  // Builds the compute shader and creates the pipeline for
+  // ConvertIndicesOnGpu.
+  bool InitializeGpuIndexConversion();
+
   D3D12CommandProcessor& command_processor_;
 
   Microsoft::WRL::ComPtr<ID3D12Resource> builtin_index_buffer_;
@@ -80,6 +125,14 @@ class D3D12PrimitiveProcessor final : public PrimitiveProcessor {
   std::unique_ptr<ui::d3d12::D3D12UploadBufferPool> frame_index_buffer_pool_;
   // Indexed by the backend handles.
   std::deque<D3D12_GPU_VIRTUAL_ADDRESS> frame_index_buffers_;
+
+  // Persistently mapped upload heap buffers for the converted indices kept in
+  // the cache across frames, indexed by the chunk index.
+  std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> persistent_index_buffers_;
+
+  Microsoft::WRL::ComPtr<ID3D12RootSignature>
+      gpu_index_conversion_root_signature_;
+  Microsoft::WRL::ComPtr<ID3D12PipelineState> gpu_index_conversion_pipeline_;
 };
 
 }  // namespace d3d12
@@ -1209,6 +1209,18 @@ void D3D12RenderTargetCache::BeginSubmission() {
   }
 }
 
+void D3D12RenderTargetCache::BeginFrame() {
+  RenderTargetCache::BeginFrame();
+
+  DestroyUnusedRenderTargets(command_processor_.GetCompletedSubmission(),
+                             destroyed_render_target_keys_);
+  if (!destroyed_render_target_keys_.empty()) {
+    // A new render target may be created at the address of a destroyed one
+    // bound to the command list.
+    InvalidateCommandListRenderTargets();
+  }
+}
+
 bool D3D12RenderTargetCache::Update(
     bool is_rasterization_done, reg::RB_DEPTHCONTROL normalized_depth_control,
     uint32_t normalized_color_mask, const Shader& vertex_shader) {
@@ -1447,7 +1459,11 @@ bool D3D12RenderTargetCache::Resolve(const Memory& memory,
             texture_cache.TransitionCurrentScaledResolveRange(
                 D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
           } else {
-            shared_memory.UseForWriting();
+            // Small consecutive resolves to different locations (like shadow
+            // cascades) don't need to wait for each other.
+            shared_memory.UseForWritingRange(
+                resolve_info.copy_dest_extent_start,
+                resolve_info.copy_dest_extent_length);
           }
           TransitionEdramBuffer(D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
@@ -1476,7 +1492,9 @@ bool D3D12RenderTargetCache::Resolve(const Memory& memory,
           if (draw_resolution_scaled) {
             texture_cache.MarkCurrentScaledResolveRangeUAVWritesCommitNeeded();
           } else {
-            shared_memory.MarkUAVWritesCommitNeeded();
+            shared_memory.MarkUAVWritesCommitNeeded(
+                resolve_info.copy_dest_extent_start,
+                resolve_info.copy_dest_extent_length);
           }
 
           // Invalidate textures and mark the range as scaled if needed.
@@ -1660,6 +1678,28 @@ void D3D12RenderTargetCache::InitializeTraceCompleteDownloads() {
   edram_snapshot_download_buffer_ = nullptr;
 }
 
+bool D3D12RenderTargetCache::CompleteEdramSnapshotDownload(
+    void* snapshot_out) {
+  if (!edram_snapshot_download_buffer_) {
+    return false;
+  }
+  void* download_mapping;
+  bool downloaded = SUCCEEDED(
+      edram_snapshot_download_buffer_->Map(0, nullptr, &download_mapping));
+  if (downloaded) {
+    std::memcpy(snapshot_out, download_mapping, xenos::kEdramSizeBytes);
+    D3D12_RANGE download_write_range = {};
+    edram_snapshot_download_buffer_->Unmap(0, &download_write_range);
+  } else {
+    XELOGE(
+        "D3D12RenderTargetCache: Failed to map the EDRAM snapshot download "
+        "buffer");
+  }
+  edram_snapshot_download_buffer_->Release();
+  edram_snapshot_download_buffer_ = nullptr;
+  return downloaded;
+}
+
 void D3D12RenderTargetCache::RestoreEdramSnapshot(const void* snapshot) {
   if (IsDrawResolutionScaled()) {
     // No 1:1 mapping.
@@ -1912,6 +1952,10 @@ DXGI_FORMAT D3D12RenderTargetCache::GetDepthSRVStencilDXGIFormat(
   }
 }
 
+uint64_t D3D12RenderTargetCache::GetCurrentSubmission() const {
+  return command_processor_.GetCurrentSubmission();
+}
+
 RenderTargetCache::RenderTarget* D3D12RenderTargetCache::CreateRenderTarget(
     RenderTargetKey key) {
   ID3D12Device* device = command_processor_.GetD3D12Provider().GetDevice();
@@ -61,6 +61,8 @@ class D3D12RenderTargetCache final : public RenderTargetCache {
   void CompletedSubmissionUpdated();
   void BeginSubmission();
 
+  void BeginFrame() override;
+
   Path GetPath() const override { return path_; }
 
   bool Update(bool is_rasterization_done,
@@ -91,6 +93,9 @@ class D3D12RenderTargetCache final : public RenderTargetCache {
   // Returns true if any downloads were submitted to the command processor.
   bool InitializeTraceSubmitDownloads();
   void InitializeTraceCompleteDownloads();
+  // Like InitializeTraceCompleteDownloads, but copying the EDRAM snapshot to
+  // xenos::kEdramSizeBytes at the pointer instead of writing it to the trace.
+  bool CompleteEdramSnapshotDownload(void* snapshot_out);
   void RestoreEdramSnapshot(const void* snapshot);
 
   // For host render targets.
@@ -137,6 +142,7 @@ class D3D12RenderTargetCache final : public RenderTargetCache {
   }
 
   RenderTarget* CreateRenderTarget(RenderTargetKey key) override;
+  uint64_t GetCurrentSubmission() const override;
 
   bool IsHostDepthEncodingDifferent(
       xenos::DepthRenderTargetFormat format) const override;
@@ -756,6 +762,9 @@ class D3D12RenderTargetCache final : public RenderTargetCache {
   uint32_t are_current_command_list_render_targets_srgb_ = 0;
   bool are_current_command_list_render_targets_valid_ = false;
 
+  // Temporary storage for DestroyUnusedRenderTargets results.
+  std::vector<RenderTargetKey> destroyed_render_target_keys_;
+
   // Temporary storage for descriptors used in PerformTransfersAndResolveClears
   // and DumpRenderTargets.
   std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> current_temporary_descriptors_cpu_;
@@ -63,7 +63,7 @@ bool D3D12SharedMemory::Initialize() {
     }
     static_assert(D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES == (1 << 16));
     InitializeSparseHostGpuMemory(
-        std::max(kHostGpuMemoryOptimalSparseAllocationLog2, uint32_t(16)));
+        std::max(kHostGpuMemoryOptimalSparseAllocationLog2, uint32_t(16)), 16);
   } else {
     XELOGGPU(
         "Direct3D 12 tiled resources are not used for shared memory "
@@ -155,7 +155,8 @@ bool D3D12SharedMemory::Initialize() {
 
   upload_buffer_pool_ = std::make_unique<ui::d3d12::D3D12UploadBufferPool>(
       provider, xe::align(ui::d3d12::D3D12UploadBufferPool::kDefaultPageSize,
-                          size_t(1) << page_size_log2()));
+                          size_t(1) << page_size_log2()),
+      "d3d12/shared_memory");
 
   return true;
 }
@@ -193,6 +194,7 @@ void D3D12SharedMemory::CompletedSubmissionUpdated() {
 }
 
 void D3D12SharedMemory::BeginSubmission() {
+  SharedMemory::BeginSubmission();
   // ExecuteCommandLists is a full UAV barrier.
   buffer_uav_writes_commit_needed_ = false;
 }
@@ -449,7 +451,9 @@ bool D3D12SharedMemory::UploadRanges(
             memory().TranslatePhysical(upload_range_start << page_size_log2()),
             upload_buffer_size);
       }
-      command_list.D3DCopyBufferRegion(
+      // Uploads for consecutive requests without anything in between are
+      // often contiguous in both buffers.
+      command_list.D3DCopyBufferRegionCoalesced(
           buffer_, upload_range_start << page_size_log2(), upload_buffer,
           UINT64(upload_buffer_offset), UINT64(upload_buffer_size));
       uint32_t upload_buffer_pages =
@@ -43,7 +43,7 @@ class D3D12SharedMemory : public SharedMemory {
   }
 
   void CompletedSubmissionUpdated();
-  void BeginSubmission();
+  void BeginSubmission() override;
 
   // RequestRange may transition the buffer to copy destination - call it before
   // UseForReading or UseForWriting.
@@ -60,6 +60,19 @@ class D3D12SharedMemory : public SharedMemory {
   void UseForWriting() {
     CommitUAVWritesAndTransitionBuffer(D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
   }
+  // Makes the buffer usable for writing the range by something that doesn't
+  // read the shared memory (like resolving). Consecutive writes to disjoint
+  // ranges are independent, so a UAV barrier is only done if the range
+  // overlaps the writes that haven't been committed yet.
+  void UseForWritingRange(uint32_t start, uint32_t length) {
+    if (buffer_state_ == D3D12_RESOURCE_STATE_UNORDERED_ACCESS &&
+        buffer_uav_writes_commit_needed_ &&
+        (start >= buffer_uav_writes_end_ ||
+         start + length <= buffer_uav_writes_start_)) {
+      return;
+    }
+    UseForWriting();
+  }
   // Makes the buffer usable as a source for copy commands.
   void UseAsCopySource() {
     CommitUAVWritesAndTransitionBuffer(D3D12_RESOURCE_STATE_COPY_SOURCE);
@@ -67,9 +80,18 @@ class D3D12SharedMemory : public SharedMemory {
   // Must be called when doing draws/dispatches modifying data within the shared
   // memory buffer as a UAV, to make sure that when UseForWriting is called the
   // next time, a UAV barrier will be done, and subsequent overlapping UAV
-  // writes and reads are ordered.
-  void MarkUAVWritesCommitNeeded() {
-    if (buffer_state_ == D3D12_RESOURCE_STATE_UNORDERED_ACCESS) {
+  // writes and reads are ordered. The range is used by UseForWritingRange.
+  void MarkUAVWritesCommitNeeded(uint32_t start = 0,
+                                 uint32_t length = kBufferSize) {
+    if (buffer_state_ != D3D12_RESOURCE_STATE_UNORDERED_ACCESS) {
+      return;
+    }
+    if (buffer_uav_writes_commit_needed_) {
+      buffer_uav_writes_start_ = std::min(buffer_uav_writes_start_, start);
+      buffer_uav_writes_end_ = std::max(buffer_uav_writes_end_, start + length);
+    } else {
+      buffer_uav_writes_start_ = start;
+      buffer_uav_writes_end_ = start + length;
       buffer_uav_writes_commit_needed_ = true;
     }
   }
@@ -104,6 +126,9 @@ class D3D12SharedMemory : public SharedMemory {
   std::vector<ID3D12Heap*> buffer_tiled_heaps_;
   D3D12_RESOURCE_STATES buffer_state_ = D3D12_RESOURCE_STATE_COPY_DEST;
   bool buffer_uav_writes_commit_needed_ = false;
+  // Extent of the writes not committed yet if buffer_uav_writes_commit_needed_.
+  uint32_t buffer_uav_writes_start_ = 0;
+  uint32_t buffer_uav_writes_end_ = 0;
   void CommitUAVWritesAndTransitionBuffer(D3D12_RESOURCE_STATES new_state);
 
   // Non-shader-visible buffer descriptor heap for faster binding (via copying
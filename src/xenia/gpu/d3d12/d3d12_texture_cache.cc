@@ -17,17 +17,35 @@
 #include <utility>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
+#include "xenia/base/task_scheduler.h"
 #include "xenia/gpu/d3d12/d3d12_command_processor.h"
 #include "xenia/gpu/d3d12/d3d12_shared_memory.h"
+#include "xenia/gpu/texture_conversion.h"
 #include "xenia/gpu/texture_info.h"
 #include "xenia/gpu/texture_util.h"
 #include "xenia/gpu/xenos.h"
+#include "xenia/memory.h"
 #include "xenia/ui/d3d12/d3d12_upload_buffer_pool.h"
 #include "xenia/ui/d3d12/d3d12_util.h"
 
+DEFINE_uint32(
+    d3d12_texture_cpu_load_min_size, 0,
+    "Size in bytes from which textures that only need to be untiled and "
+    "byte-swapped, without format conversion, are loaded on CPU threads "
+    "directly into upload buffers instead of with compute shaders. Reduces the "
+    "GPU work when streaming large textures. 0 to always load textures on the "
+    "GPU.",
+    "D3D12");
+DEFINE_uint32(d3d12_texture_cpu_load_threads, 0,
+              "Maximum number of task scheduler workers loading a texture on "
+              "the CPU (see d3d12_texture_cpu_load_min_size), in addition to "
+              "the GPU thread. 0 to use half of the logical processors.",
+              "D3D12");
+
 namespace xe {
 namespace gpu {
 namespace d3d12 {
@@ -418,6 +436,19 @@ bool D3D12TextureCache::Initialize() {
       provider.OffsetViewDescriptor(null_srv_descriptor_heap_start_,
                                     uint32_t(NullSRVDescriptorIndex::kCube)));
 
+  if (cvars::d3d12_texture_cpu_load_min_size) {
+    cpu_load_upload_buffer_pool_ =
+        std::make_unique<ui::d3d12::D3D12UploadBufferPool>(
+            provider, kCpuLoadUploadBufferPageSize, "d3d12/texture_loads");
+    uint32_t cpu_load_worker_count = cvars::d3d12_texture_cpu_load_threads;
+    if (!cpu_load_worker_count) {
+      cpu_load_worker_count =
+          std::max(xe::threading::logical_processor_count() / 2, uint32_t(2)) -
+          1;
+    }
+    cpu_load_max_concurrency_ = cpu_load_worker_count + 1;
+  }
+
   return true;
 }
 
@@ -430,6 +461,15 @@ void D3D12TextureCache::ClearCache() {
   srv_descriptor_cache_.clear();
 }
 
+void D3D12TextureCache::CompletedSubmissionUpdated(
+    uint64_t completed_submission_index) {
+  TextureCache::CompletedSubmissionUpdated(completed_submission_index);
+
+  if (cpu_load_upload_buffer_pool_) {
+    cpu_load_upload_buffer_pool_->Reclaim(completed_submission_index);
+  }
+}
+
 void D3D12TextureCache::BeginSubmission(uint64_t new_submission_index) {
   TextureCache::BeginSubmission(new_submission_index);
 
@@ -1346,6 +1386,12 @@ std::unique_ptr<TextureCache::Texture> D3D12TextureCache::CreateTexture(
       new D3D12Texture(*this, key, resource.Get(), resource_state));
 }
 
+bool D3D12TextureCache::GetHostMemoryBudget(uint64_t& budget_out,
+                                            uint64_t& usage_out) const {
+  return command_processor_.GetD3D12Provider().QueryLocalVideoMemoryBudget(
+      budget_out, usage_out);
+}
+
 bool D3D12TextureCache::LoadTextureDataFromResidentMemoryImpl(Texture& texture,
                                                               bool load_base,
                                                               bool load_mips) {
@@ -1490,6 +1536,183 @@ bool D3D12TextureCache::LoadTextureDataFromResidentMemoryImpl(Texture& texture,
         level_host_slice_size;
     copy_buffer_size += level_host_slice_size * array_size;
   }
+
+  // Submits copying from the buffer with the data in the host layout to the
+  // host texture.
+  auto copy_to_texture = [&](ID3D12Resource* source, UINT64 source_offset) {
+    // Update LRU caching because the texture will be used by the command list.
+    d3d12_texture.MarkAsUsed();
+
+    ID3D12Resource* texture_resource = d3d12_texture.resource();
+    command_processor_.PushTransitionBarrier(
+        texture_resource,
+        d3d12_texture.SetResourceState(D3D12_RESOURCE_STATE_COPY_DEST),
+        D3D12_RESOURCE_STATE_COPY_DEST);
+    command_processor_.SubmitBarriers();
+    uint32_t texture_level_count = texture_key.mip_max_level + 1;
+    D3D12_TEXTURE_COPY_LOCATION location_source, location_dest;
+    location_source.pResource = source;
+    location_source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+    location_dest.pResource = texture_resource;
+    location_dest.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+    for (uint32_t level = level_first; level <= level_last; ++level) {
+      uint32_t guest_level = std::min(level, level_packed);
+      location_source.PlacedFootprint =
+          level ? host_slice_layouts_mips[guest_level] : host_slice_layout_base;
+      location_source.PlacedFootprint.Offset += source_offset;
+      location_dest.SubresourceIndex = level;
+      UINT64 host_slice_size =
+          level ? host_slice_sizes_mips[guest_level] : host_slice_size_base;
+      D3D12_BOX source_box;
+      const D3D12_BOX* source_box_ptr;
+      if (level >= level_packed) {
+        uint32_t level_offset_blocks_x, level_offset_blocks_y, level_offset_z;
+        texture_util::GetPackedMipOffset(width, height, depth, guest_format,
+                                         level, level_offset_blocks_x,
+                                         level_offset_blocks_y, level_offset_z);
+        source_box.left =
+            level_offset_blocks_x * block_width * texture_resolution_scale_x;
+        source_box.top =
+            level_offset_blocks_y * block_height * texture_resolution_scale_y;
+        source_box.front = level_offset_z;
+        source_box.right =
+            source_box.left +
+            xe::align(std::max((width * texture_resolution_scale_x) >> level,
+                               uint32_t(1)),
+                      host_block_width);
+        source_box.bottom =
+            source_box.top +
+            xe::align(std::max((height * texture_resolution_scale_y) >> level,
+                               uint32_t(1)),
+                      host_block_height);
+        source_box.back =
+            source_box.front + std::max(depth >> level, uint32_t(1));
+        source_box_ptr = &source_box;
+      } else {
+        source_box_ptr = nullptr;
+      }
+      for (uint32_t slice = 0; slice < array_size; ++slice) {
+        command_list.D3DCopyTextureRegion(&location_dest, 0, 0, 0,
+                                          &location_source, source_box_ptr);
+        location_dest.SubresourceIndex += texture_level_count;
+        location_source.PlacedFootprint.Offset += host_slice_size;
+      }
+    }
+  };
+
+  // Large textures that only need to be untiled and byte-swapped can be loaded
+  // on the CPU threads directly into an upload buffer, without the compute
+  // dispatches (which are slow for them on some GPUs) and the scratch buffer.
+  // Guest memory must be up to date though - if anything in the range has been
+  // written by the GPU, like a resolve, it's only in the shared memory buffer.
+  if (cpu_load_upload_buffer_pool_ && !texture_resolution_scaled &&
+      (load_shader == kLoadShaderIndex8bpb ||
+       load_shader == kLoadShaderIndex16bpb ||
+       load_shader == kLoadShaderIndex32bpb ||
+       load_shader == kLoadShaderIndex64bpb ||
+       load_shader == kLoadShaderIndex128bpb) &&
+      (host_block_compressed || (block_width == 1 && block_height == 1)) &&
+      copy_buffer_size >= cvars::d3d12_texture_cpu_load_min_size &&
+      copy_buffer_size <= kCpuLoadUploadBufferPageSize &&
+      (level_first != 0 ||
+       !shared_memory().IsRangeGpuWritten(texture_key.base_page << 12,
+                                          d3d12_texture.GetGuestBaseSize())) &&
+      (level_last == 0 ||
+       !shared_memory().IsRangeGpuWritten(texture_key.mip_page << 12,
+                                          d3d12_texture.GetGuestMipsSize()))) {
+    ID3D12Resource* upload_buffer;
+    size_t upload_buffer_offset;
+    uint8_t* upload_buffer_mapping = cpu_load_upload_buffer_pool_->Request(
+        command_processor_.GetCurrentSubmission(), size_t(copy_buffer_size),
+        D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &upload_buffer,
+        &upload_buffer_offset, nullptr);
+    if (upload_buffer_mapping) {
+      struct CpuLoadSlice {
+        uint8_t* host;
+        const uint8_t* guest;
+        texture_conversion::CopyRowsInfo info;
+        uint32_t job_first;
+      };
+      std::vector<CpuLoadSlice> cpu_load_slices;
+      cpu_load_slices.reserve(
+          (loop_level_last - loop_level_first + 1) * array_size);
+      uint32_t job_count = 0;
+      Memory& memory = shared_memory().memory();
+      texture_conversion::CopyRowsInfo copy_rows_info;
+      copy_rows_info.is_tiled = texture_key.tiled;
+      copy_rows_info.is_3d = is_3d;
+      copy_rows_info.endian = texture_key.endianness;
+      copy_rows_info.bytes_per_block_log2 = xe::log2_floor(bytes_per_block);
+      for (uint32_t loop_level = loop_level_first;
+           loop_level <= loop_level_last; ++loop_level) {
+        bool is_base = loop_level == 0;
+        uint32_t level = (level_packed == 0) ? 0 : loop_level;
+        uint32_t guest_address =
+            (is_base ? texture_key.base_page : texture_key.mip_page) << 12;
+        if (!is_base) {
+          guest_address += guest_layout.mip_offsets_bytes[level];
+        }
+        const texture_util::TextureGuestLayout::Level& level_guest_layout =
+            is_base ? guest_layout.base : guest_layout.mips[level];
+        copy_rows_info.guest_pitch = level_guest_layout.row_pitch_bytes;
+        if (texture_key.tiled) {
+          copy_rows_info.guest_pitch /= bytes_per_block;
+        }
+        copy_rows_info.guest_z_stride_block_rows =
+            level_guest_layout.z_slice_stride_block_rows;
+        if (level == level_packed) {
+          copy_rows_info.width_blocks = level_guest_layout.x_extent_blocks;
+          copy_rows_info.height_blocks = level_guest_layout.y_extent_blocks;
+          copy_rows_info.depth = level_guest_layout.z_extent;
+        } else {
+          copy_rows_info.width_blocks =
+              (std::max(width >> level, uint32_t(1)) + (block_width - 1)) /
+              block_width;
+          copy_rows_info.height_blocks =
+              (std::max(height >> level, uint32_t(1)) + (block_height - 1)) /
+              block_height;
+          copy_rows_info.depth = std::max(depth >> level, uint32_t(1));
+        }
+        const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& level_host_slice_layout =
+            is_base ? host_slice_layout_base : host_slice_layouts_mips[level];
+        copy_rows_info.host_pitch = level_host_slice_layout.Footprint.RowPitch;
+        UINT64 host_slice_size =
+            is_base ? host_slice_size_base : host_slice_sizes_mips[level];
+        uint32_t level_job_count =
+            (copy_rows_info.height_blocks * copy_rows_info.depth +
+             (kCpuLoadRowsPerJob - 1)) /
+            kCpuLoadRowsPerJob;
+        for (uint32_t slice = 0; slice < array_size; ++slice) {
+          CpuLoadSlice& cpu_load_slice = cpu_load_slices.emplace_back();
+          cpu_load_slice.host = upload_buffer_mapping +
+                                level_host_slice_layout.Offset +
+                                host_slice_size * slice;
+          cpu_load_slice.guest = memory.TranslatePhysical<const uint8_t*>(
+              guest_address +
+              level_guest_layout.array_slice_stride_bytes * slice);
+          cpu_load_slice.info = copy_rows_info;
+          cpu_load_slice.job_first = job_count;
+          job_count += level_job_count;
+        }
+      }
+      RunCpuLoadJobs(job_count, [&cpu_load_slices](uint32_t job_index) {
+        auto slice_it = std::upper_bound(
+            cpu_load_slices.cbegin(), cpu_load_slices.cend(), job_index,
+            [](uint32_t index, const CpuLoadSlice& slice) {
+              return index < slice.job_first;
+            });
+        const CpuLoadSlice& slice = *(--slice_it);
+        uint32_t row_count = slice.info.height_blocks * slice.info.depth;
+        uint32_t row_first = (job_index - slice.job_first) * kCpuLoadRowsPerJob;
+        texture_conversion::CopySwapTextureRows(
+            slice.host, slice.guest, slice.info, row_first,
+            std::min(kCpuLoadRowsPerJob, row_count - row_first));
+      });
+      copy_to_texture(upload_buffer, upload_buffer_offset);
+      return true;
+    }
+  }
+
   D3D12_RESOURCE_STATES copy_buffer_state =
       D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
   ID3D12Resource* copy_buffer = command_processor_.RequestScratchGPUBuffer(
@@ -1696,73 +1919,49 @@ bool D3D12TextureCache::LoadTextureDataFromResidentMemoryImpl(Texture& texture,
     }
   }
 
-  // Update LRU caching because the texture will be used by the command list.
-  d3d12_texture.MarkAsUsed();
-
-  // Submit copying from the copy buffer to the host texture.
-  ID3D12Resource* texture_resource = d3d12_texture.resource();
-  command_processor_.PushTransitionBarrier(
-      texture_resource,
-      d3d12_texture.SetResourceState(D3D12_RESOURCE_STATE_COPY_DEST),
-      D3D12_RESOURCE_STATE_COPY_DEST);
   command_processor_.PushTransitionBarrier(copy_buffer, copy_buffer_state,
                                            D3D12_RESOURCE_STATE_COPY_SOURCE);
   copy_buffer_state = D3D12_RESOURCE_STATE_COPY_SOURCE;
-  command_processor_.SubmitBarriers();
-  uint32_t texture_level_count = texture_key.mip_max_level + 1;
-  D3D12_TEXTURE_COPY_LOCATION location_source, location_dest;
-  location_source.pResource = copy_buffer;
-  location_source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-  location_dest.pResource = texture_resource;
-  location_dest.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-  for (uint32_t level = level_first; level <= level_last; ++level) {
-    uint32_t guest_level = std::min(level, level_packed);
-    location_source.PlacedFootprint =
-        level ? host_slice_layouts_mips[guest_level] : host_slice_layout_base;
-    location_dest.SubresourceIndex = level;
-    UINT64 host_slice_size =
-        level ? host_slice_sizes_mips[guest_level] : host_slice_size_base;
-    D3D12_BOX source_box;
-    const D3D12_BOX* source_box_ptr;
-    if (level >= level_packed) {
-      uint32_t level_offset_blocks_x, level_offset_blocks_y, level_offset_z;
-      texture_util::GetPackedMipOffset(width, height, depth, guest_format,
-                                       level, level_offset_blocks_x,
-                                       level_offset_blocks_y, level_offset_z);
-      source_box.left =
-          level_offset_blocks_x * block_width * texture_resolution_scale_x;
-      source_box.top =
-          level_offset_blocks_y * block_height * texture_resolution_scale_y;
-      source_box.front = level_offset_z;
-      source_box.right =
-          source_box.left +
-          xe::align(std::max((width * texture_resolution_scale_x) >> level,
-                             uint32_t(1)),
-                    host_block_width);
-      source_box.bottom =
-          source_box.top +
-          xe::align(std::max((height * texture_resolution_scale_y) >> level,
-                             uint32_t(1)),
-                    host_block_height);
-      source_box.back =
-          source_box.front + std::max(depth >> level, uint32_t(1));
-      source_box_ptr = &source_box;
-    } else {
-      source_box_ptr = nullptr;
-    }
-    for (uint32_t slice = 0; slice < array_size; ++slice) {
-      command_list.D3DCopyTextureRegion(&location_dest, 0, 0, 0,
-                                        &location_source, source_box_ptr);
-      location_dest.SubresourceIndex += texture_level_count;
-      location_source.PlacedFootprint.Offset += host_slice_size;
-    }
-  }
+  copy_to_texture(copy_buffer, 0);
 
   command_processor_.ReleaseScratchGPUBuffer(copy_buffer, copy_buffer_state);
 
   return true;
 }
 
+void D3D12TextureCache::RunCpuLoadJobs(
+    uint32_t job_count, const std::function<void(uint32_t)>& job) {
+  SCOPE_profile_cpu_f("gpu");
+  // The draw is waiting for the texture.
+  xe::threading::TaskScheduler::Get().ParallelFor(
+      job_count, job, xe::threading::TaskPriority::kLatencyCritical,
+      cpu_load_max_concurrency_);
+}
+
+bool D3D12TextureCache::CopyTextureHostData(Texture& dest, Texture& source) {
+  D3D12Texture& d3d12_dest = static_cast<D3D12Texture&>(dest);
+  D3D12Texture& d3d12_source = static_cast<D3D12Texture&>(source);
+  // Both will be used by the command list.
+  d3d12_dest.MarkAsUsed();
+  d3d12_source.MarkAsUsed();
+  ID3D12Resource* dest_resource = d3d12_dest.resource();
+  ID3D12Resource* source_resource = d3d12_source.resource();
+  command_processor_.PushTransitionBarrier(
+      dest_resource,
+      d3d12_dest.SetResourceState(D3D12_RESOURCE_STATE_COPY_DEST),
+      D3D12_RESOURCE_STATE_COPY_DEST);
+  command_processor_.PushTransitionBarrier(
+      source_resource,
+      d3d12_source.SetResourceState(D3D12_RESOURCE_STATE_COPY_SOURCE),
+      D3D12_RESOURCE_STATE_COPY_SOURCE);
+  command_processor_.SubmitBarriers();
+  // The keys differ only in the addresses, so the resources are created with
+  // the same description.
+  command_processor_.GetDeferredCommandList().D3DCopyResource(dest_resource,
+                                                               source_resource);
+  return true;
+}
+
 void D3D12TextureCache::UpdateTextureBindingsImpl(
     uint32_t fetch_constant_mask) {
   uint32_t bindings_remaining = fetch_constant_mask;
@@ -26,6 +26,7 @@
 #include "xenia/gpu/xenos.h"
 #include "xenia/ui/d3d12/d3d12_api.h"
 #include "xenia/ui/d3d12/d3d12_provider.h"
+#include "xenia/ui/d3d12/d3d12_upload_buffer_pool.h"
 
 namespace xe {
 namespace gpu {
@@ -89,6 +90,7 @@ class D3D12TextureCache final : public TextureCache {
 
   void ClearCache() override;
 
+  void CompletedSubmissionUpdated(uint64_t completed_submission_index) override;
   void BeginSubmission(uint64_t new_submission_index) override;
   void BeginFrame() override;
   void EndFrame();
@@ -541,6 +543,10 @@ class D3D12TextureCache final : public TextureCache {
   // This binds pipelines, allocates descriptors, and copies!
   bool LoadTextureDataFromResidentMemoryImpl(Texture& texture, bool load_base,
                                              bool load_mips) override;
+  bool GetHostMemoryBudget(uint64_t& budget_out,
+                           uint64_t& usage_out) const override;
+  bool IsTextureHostDataCopySupported() const override { return true; }
+  bool CopyTextureHostData(Texture& dest, Texture& source) override;
 
   void UpdateTextureBindingsImpl(uint32_t fetch_constant_mask) override;
 
@@ -548,6 +554,11 @@ class D3D12TextureCache final : public TextureCache {
   static constexpr uint32_t kLoadGuestXThreadsPerGroupLog2 = 2;
   static constexpr uint32_t kLoadGuestYBlocksPerGroupLog2 = 5;
 
+  // Textures loaded on the CPU are written directly to upload buffer pages, so
+  // this limits the size of a texture that can be loaded this way.
+  static constexpr size_t kCpuLoadUploadBufferPageSize = size_t(32) << 20;
+  static constexpr uint32_t kCpuLoadRowsPerJob = 32;
+
   class D3D12Texture final : public Texture {
    public:
     union SRVDescriptorKey {
@@ -791,6 +802,12 @@ class D3D12TextureCache final : public TextureCache {
 
   xenos::ClampMode NormalizeClampMode(xenos::ClampMode clamp_mode) const;
 
+  // Calls the job for every index from 0 to job_count - 1 on the task
+  // scheduler workers and the calling thread, and returns when all of them are
+  // done.
+  void RunCpuLoadJobs(uint32_t job_count,
+                      const std::function<void(uint32_t)>& job);
+
   D3D12CommandProcessor& command_processor_;
   bool bindless_resources_used_;
 
@@ -801,6 +818,13 @@ class D3D12TextureCache final : public TextureCache {
   std::array<Microsoft::WRL::ComPtr<ID3D12PipelineState>, kLoadShaderCount>
       load_pipelines_scaled_;
 
+  // Loading of large textures not needing format conversion on the CPU
+  // (d3d12_texture_cpu_load_min_size) rather than with the load shaders.
+  std::unique_ptr<ui::d3d12::D3D12UploadBufferPool>
+      cpu_load_upload_buffer_pool_;
+  // Including the GPU thread.
+  uint32_t cpu_load_max_concurrency_ = 1;
+
   std::vector<SRVDescriptorCachePage> srv_descriptor_cache_;
   uint32_t srv_descriptor_cache_allocated_;
   // Indices of cached descriptors used by deleted textures, for reuse.
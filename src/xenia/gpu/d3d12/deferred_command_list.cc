@@ -24,7 +24,36 @@ DeferredCommandList::DeferredCommandList(
   command_stream_.reserve(initial_size / sizeof(uintmax_t));
 }
 
-void DeferredCommandList::Reset() { command_stream_.clear(); }
+void DeferredCommandList::Reset() {
+  command_stream_.clear();
+  last_command_offset_ = SIZE_MAX;
+  multi_draw_offsets_.clear();
+}
+
+void DeferredCommandList::UploadMultiDrawArguments(
+    ui::d3d12::D3D12UploadBufferPool& pool, uint64_t submission_index) {
+  for (size_t multi_draw_offset : multi_draw_offsets_) {
+    auto& args = *reinterpret_cast<D3DMultiDrawIndexedInstancedHeader*>(
+        command_stream_.data() + multi_draw_offset +
+        kCommandHeaderSizeElements * sizeof(uintmax_t));
+    if (args.draw_count < kMultiDrawIndirectMinDrawCount) {
+      continue;
+    }
+    size_t arguments_size =
+        sizeof(D3D12_DRAW_INDEXED_ARGUMENTS) * args.draw_count;
+    ID3D12Resource* argument_buffer;
+    size_t argument_buffer_offset;
+    uint8_t* mapping =
+        pool.Request(submission_index, arguments_size, sizeof(uint32_t),
+                     &argument_buffer, &argument_buffer_offset, nullptr);
+    if (!mapping) {
+      continue;
+    }
+    std::memcpy(mapping, &args + 1, arguments_size);
+    args.argument_buffer = argument_buffer;
+    args.argument_buffer_offset = argument_buffer_offset;
+  }
+}
 
 void DeferredCommandList::Execute(ID3D12GraphicsCommandList* command_list,
                                   ID3D12GraphicsCommandList1* command_list_1) {
@@ -40,6 +69,10 @@ void DeferredCommandList::Execute(ID3D12GraphicsCommandList* command_list,
     stream += kCommandHeaderSizeElements;
     stream_remaining -= kCommandHeaderSizeElements;
     switch (header.command) {
+      case Command::kD3DBeginQuery: {
+        auto& args = *reinterpret_cast<const D3DQueryArguments*>(stream);
+        command_list->BeginQuery(args.query_heap, args.type, args.index);
+      } break;
       case Command::kD3DClearDepthStencilView: {
         auto& args =
             *reinterpret_cast<const ClearDepthStencilViewHeader*>(stream);
@@ -107,6 +140,30 @@ void DeferredCommandList::Execute(ID3D12GraphicsCommandList* command_list,
               args.start_instance_location);
         }
       } break;
+      case Command::kD3DMultiDrawIndexedInstanced: {
+        if (current_pipeline_state != nullptr) {
+          auto& args =
+              *reinterpret_cast<const D3DMultiDrawIndexedInstancedHeader*>(
+                  stream);
+          if (args.argument_buffer) {
+            command_list->ExecuteIndirect(
+                command_processor_.GetDrawIndexedCommandSignature(),
+                args.draw_count, args.argument_buffer,
+                args.argument_buffer_offset, nullptr, 0);
+          } else {
+            auto draws =
+                reinterpret_cast<const D3D12_DRAW_INDEXED_ARGUMENTS*>(&args +
+                                                                      1);
+            for (UINT i = 0; i < args.draw_count; ++i) {
+              const D3D12_DRAW_INDEXED_ARGUMENTS& draw = draws[i];
+              command_list->DrawIndexedInstanced(
+                  draw.IndexCountPerInstance, draw.InstanceCount,
+                  draw.StartIndexLocation, draw.BaseVertexLocation,
+                  draw.StartInstanceLocation);
+            }
+          }
+        }
+      } break;
       case Command::kD3DDrawInstanced: {
         if (current_pipeline_state != nullptr) {
           auto& args =
@@ -116,6 +173,10 @@ void DeferredCommandList::Execute(ID3D12GraphicsCommandList* command_list,
               args.start_vertex_location, args.start_instance_location);
         }
       } break;
+      case Command::kD3DEndQuery: {
+        auto& args = *reinterpret_cast<const D3DQueryArguments*>(stream);
+        command_list->EndQuery(args.query_heap, args.type, args.index);
+      } break;
       case Command::kD3DIASetIndexBuffer: {
         auto view = reinterpret_cast<const D3D12_INDEX_BUFFER_VIEW*>(stream);
         command_list->IASetIndexBuffer(
@@ -150,6 +211,13 @@ void DeferredCommandList::Execute(ID3D12GraphicsCommandList* command_list,
       case Command::kD3DOMSetStencilRef: {
         command_list->OMSetStencilRef(*reinterpret_cast<const UINT*>(stream));
       } break;
+      case Command::kD3DResolveQueryData: {
+        auto& args =
+            *reinterpret_cast<const D3DResolveQueryDataArguments*>(stream);
+        command_list->ResolveQueryData(
+            args.query_heap, args.type, args.start_index, args.num_queries,
+            args.destination_buffer, args.aligned_destination_buffer_offset);
+      } break;
       case Command::kD3DResourceBarrier: {
         static_assert(alignof(D3D12_RESOURCE_BARRIER) <= alignof(uintmax_t));
         command_list->ResourceBarrier(
@@ -158,6 +226,45 @@ void DeferredCommandList::Execute(ID3D12GraphicsCommandList* command_list,
                 reinterpret_cast<const uint8_t*>(stream) +
                 xe::align(sizeof(UINT), alignof(D3D12_RESOURCE_BARRIER))));
       } break;
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+      case Command::kD3DBarrier: {
+        auto& header = *reinterpret_cast<const D3DBarrierHeader*>(stream);
+        D3DBarrierOffsets offsets = GetD3DBarrierOffsets(
+            header.num_texture_barriers, header.num_buffer_barriers,
+            header.num_global_barriers);
+        const uint8_t* args = reinterpret_cast<const uint8_t*>(stream);
+        D3D12_BARRIER_GROUP groups[3];
+        UINT32 group_count = 0;
+        if (header.num_texture_barriers) {
+          D3D12_BARRIER_GROUP& group = groups[group_count++];
+          group.Type = D3D12_BARRIER_TYPE_TEXTURE;
+          group.NumBarriers = header.num_texture_barriers;
+          group.pTextureBarriers =
+              reinterpret_cast<const D3D12_TEXTURE_BARRIER*>(
+                  args + offsets.texture_barriers);
+        }
+        if (header.num_buffer_barriers) {
+          D3D12_BARRIER_GROUP& group = groups[group_count++];
+          group.Type = D3D12_BARRIER_TYPE_BUFFER;
+          group.NumBarriers = header.num_buffer_barriers;
+          group.pBufferBarriers =
+              reinterpret_cast<const D3D12_BUFFER_BARRIER*>(
+                  args + offsets.buffer_barriers);
+        }
+        if (header.num_global_barriers) {
+          D3D12_BARRIER_GROUP& group = groups[group_count++];
+          group.Type = D3D12_BARRIER_TYPE_GLOBAL;
+          group.NumBarriers = header.num_global_barriers;
+          group.pGlobalBarriers =
+              reinterpret_cast<const D3D12_GLOBAL_BARRIER*>(
+                  args + offsets.global_barriers);
+        }
+        ID3D12GraphicsCommandList7* command_list_7 =
+            command_processor_.GetCommandList7();
+        assert_not_null(command_list_7);
+        command_list_7->Barrier(group_count, groups);
+      } break;
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
       case Command::kRSSetScissorRect: {
         command_list->RSSetScissorRects(
             1, reinterpret_cast<const D3D12_RECT*>(stream));
@@ -194,6 +301,18 @@ void DeferredCommandList::Execute(ID3D12GraphicsCommandList* command_list,
         command_list->SetGraphicsRootConstantBufferView(
             args.root_parameter_index, args.buffer_location);
       } break;
+      case Command::kD3DSetComputeRootShaderResourceView: {
+        auto& args =
+            *reinterpret_cast<const SetRootBufferViewArguments*>(stream);
+        command_list->SetComputeRootShaderResourceView(
+            args.root_parameter_index, args.buffer_location);
+      } break;
+      case Command::kD3DSetComputeRootUnorderedAccessView: {
+        auto& args =
+            *reinterpret_cast<const SetRootBufferViewArguments*>(stream);
+        command_list->SetComputeRootUnorderedAccessView(
+            args.root_parameter_index, args.buffer_location);
+      } break;
       case Command::kD3DSetComputeRootDescriptorTable: {
         auto& args =
             *reinterpret_cast<const SetRootDescriptorTableArguments*>(stream);
@@ -279,9 +398,74 @@ void* DeferredCommandList::WriteCommand(Command command,
   header.command = command;
   header.arguments_size_elements =
       uint32_t(arguments_size_elements) / sizeof(uintmax_t);
+  last_command_offset_ = offset;
   return command_stream_.data() + (offset + kCommandHeaderSizeBytes);
 }
 
+bool DeferredCommandList::MergeDrawIndexedInstanced(
+    UINT index_count_per_instance, UINT instance_count,
+    UINT start_index_location, INT base_vertex_location,
+    UINT start_instance_location) {
+  if (last_command_offset_ == SIZE_MAX) {
+    return false;
+  }
+  constexpr size_t kCommandHeaderSizeBytes =
+      kCommandHeaderSizeElements * sizeof(uintmax_t);
+  size_t arguments_offset = last_command_offset_ + kCommandHeaderSizeBytes;
+  CommandHeader& header = *reinterpret_cast<CommandHeader*>(
+      command_stream_.data() + last_command_offset_);
+  D3D12_DRAW_INDEXED_ARGUMENTS* draws;
+  if (header.command == Command::kD3DDrawIndexedInstanced) {
+    // Replace the draw with a multi-draw.
+    D3DDrawIndexedInstancedArguments first_draw =
+        *reinterpret_cast<const D3DDrawIndexedInstancedArguments*>(
+            command_stream_.data() + arguments_offset);
+    size_t multi_draw_offset = last_command_offset_;
+    command_stream_.resize(multi_draw_offset);
+    auto& args = *reinterpret_cast<D3DMultiDrawIndexedInstancedHeader*>(
+        WriteCommand(Command::kD3DMultiDrawIndexedInstanced,
+                     sizeof(D3DMultiDrawIndexedInstancedHeader) +
+                         2 * sizeof(D3D12_DRAW_INDEXED_ARGUMENTS)));
+    args.argument_buffer = nullptr;
+    args.argument_buffer_offset = 0;
+    args.draw_count = 2;
+    draws = reinterpret_cast<D3D12_DRAW_INDEXED_ARGUMENTS*>(&args + 1);
+    draws[0].IndexCountPerInstance = first_draw.index_count_per_instance;
+    draws[0].InstanceCount = first_draw.instance_count;
+    draws[0].StartIndexLocation = first_draw.start_index_location;
+    draws[0].BaseVertexLocation = first_draw.base_vertex_location;
+    draws[0].StartInstanceLocation = first_draw.start_instance_location;
+    multi_draw_offsets_.push_back(multi_draw_offset);
+    draws += 1;
+  } else if (header.command == Command::kD3DMultiDrawIndexedInstanced) {
+    auto& args = *reinterpret_cast<D3DMultiDrawIndexedInstancedHeader*>(
+        command_stream_.data() + arguments_offset);
+    if (args.draw_count >= kMultiDrawMaxDrawCount) {
+      return false;
+    }
+    // The multi-draw is the last command, so it can be extended in place.
+    size_t arguments_size_elements =
+        round_up(sizeof(D3DMultiDrawIndexedInstancedHeader) +
+                     (args.draw_count + 1) *
+                         sizeof(D3D12_DRAW_INDEXED_ARGUMENTS),
+                 sizeof(uintmax_t), false);
+    command_stream_.resize(arguments_offset + arguments_size_elements);
+    header.arguments_size_elements =
+        uint32_t(arguments_size_elements) / sizeof(uintmax_t);
+    draws = reinterpret_cast<D3D12_DRAW_INDEXED_ARGUMENTS*>(&args + 1) +
+            args.draw_count;
+    ++args.draw_count;
+  } else {
+    return false;
+  }
+  draws->IndexCountPerInstance = index_count_per_instance;
+  draws->InstanceCount = instance_count;
+  draws->StartIndexLocation = start_index_location;
+  draws->BaseVertexLocation = base_vertex_location;
+  draws->StartInstanceLocation = start_instance_location;
+  return true;
+}
+
 }  // namespace d3d12
 }  // namespace gpu
 }  // namespace xe
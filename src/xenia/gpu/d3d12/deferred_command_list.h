@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <utility>
 #include <vector>
 
 #include "xenia/base/assert.h"
@@ -20,6 +21,7 @@
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
 #include "xenia/ui/d3d12/d3d12_api.h"
+#include "xenia/ui/d3d12/d3d12_upload_buffer_pool.h"
 namespace xe {
 namespace gpu {
 namespace d3d12 {
@@ -39,6 +41,41 @@ class DeferredCommandList {
                       size_t initial_size_bytes = MAX_SIZEOF_COMMANDLIST);
 
   void Reset();
+  // Exchanges the recorded commands with another list, so they can be
+  // executed while the other list is being recorded.
+  void Swap(DeferredCommandList& other) {
+    command_stream_.swap(other.command_stream_);
+    std::swap(last_command_offset_, other.last_command_offset_);
+    multi_draw_offsets_.swap(other.multi_draw_offsets_);
+  }
+  // Whether to record consecutive indexed draws, with nothing recorded between
+  // them, as one multi-draw to execute with ExecuteIndirect. Requires the
+  // command processor to have a draw-indexed command signature, and
+  // UploadMultiDrawArguments to be called before executing.
+  void SetMergeDraws(bool merge_draws) { merge_draws_ = merge_draws; }
+  // Writes the arguments of the multi-draws long enough to be executed
+  // indirectly to the upload buffer pool. The others are executed as separate
+  // draws.
+  void UploadMultiDrawArguments(ui::d3d12::D3D12UploadBufferPool& pool,
+                                uint64_t submission_index);
+
+  // For dropping the commands recorded after some point, such as a timestamp
+  // query if nothing to measure has been recorded after it.
+  struct RecordingPoint {
+    size_t stream_size;
+    size_t last_command_offset;
+    size_t multi_draw_count;
+  };
+  RecordingPoint GetRecordingPoint() const {
+    return {command_stream_.size(), last_command_offset_,
+            multi_draw_offsets_.size()};
+  }
+  void RevertToRecordingPoint(const RecordingPoint& point) {
+    assert_true(point.stream_size <= command_stream_.size());
+    command_stream_.resize(point.stream_size);
+    last_command_offset_ = point.last_command_offset;
+    multi_draw_offsets_.resize(point.multi_draw_count);
+  }
   void Execute(ID3D12GraphicsCommandList* command_list,
                ID3D12GraphicsCommandList1* command_list_1);
 
@@ -57,6 +94,15 @@ class DeferredCommandList {
     return num_rects ? reinterpret_cast<D3D12_RECT*>(args + 1) : nullptr;
   }
 
+  void D3DBeginQuery(ID3D12QueryHeap* query_heap, D3D12_QUERY_TYPE type,
+                     UINT index) {
+    auto& args = *reinterpret_cast<D3DQueryArguments*>(
+        WriteCommand(Command::kD3DBeginQuery, sizeof(D3DQueryArguments)));
+    args.query_heap = query_heap;
+    args.type = type;
+    args.index = index;
+  }
+
   void D3DClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depth_stencil_view,
                                 D3D12_CLEAR_FLAGS clear_flags, FLOAT depth,
                                 UINT8 stencil, UINT num_rects,
@@ -113,6 +159,32 @@ class DeferredCommandList {
     args.num_bytes = num_bytes;
   }
 
+  // If the last recorded command is a copy between the same buffers that this
+  // copy directly continues in both of them, extends it instead of recording a
+  // new command. Nothing must depend on the previous command ending earlier.
+  void D3DCopyBufferRegionCoalesced(ID3D12Resource* dst_buffer,
+                                    UINT64 dst_offset,
+                                    ID3D12Resource* src_buffer,
+                                    UINT64 src_offset, UINT64 num_bytes) {
+    if (last_command_offset_ != SIZE_MAX) {
+      const CommandHeader& header = *reinterpret_cast<const CommandHeader*>(
+          command_stream_.data() + last_command_offset_);
+      if (header.command == Command::kD3DCopyBufferRegion) {
+        auto& args = *reinterpret_cast<D3DCopyBufferRegionArguments*>(
+            command_stream_.data() + last_command_offset_ +
+            kCommandHeaderSizeElements * sizeof(uintmax_t));
+        if (args.dst_buffer == dst_buffer && args.src_buffer == src_buffer &&
+            args.dst_offset + args.num_bytes == dst_offset &&
+            args.src_offset + args.num_bytes == src_offset) {
+          args.num_bytes += num_bytes;
+          return;
+        }
+      }
+    }
+    D3DCopyBufferRegion(dst_buffer, dst_offset, src_buffer, src_offset,
+                        num_bytes);
+  }
+
   void D3DCopyResource(ID3D12Resource* dst_resource,
                        ID3D12Resource* src_resource) {
     auto& args = *reinterpret_cast<D3DCopyResourceArguments*>(WriteCommand(
@@ -163,6 +235,12 @@ class DeferredCommandList {
                                UINT instance_count, UINT start_index_location,
                                INT base_vertex_location,
                                UINT start_instance_location) {
+    if (merge_draws_ &&
+        MergeDrawIndexedInstanced(index_count_per_instance, instance_count,
+                                  start_index_location, base_vertex_location,
+                                  start_instance_location)) {
+      return;
+    }
     auto& args = *reinterpret_cast<D3DDrawIndexedInstancedArguments*>(
         WriteCommand(Command::kD3DDrawIndexedInstanced,
                      sizeof(D3DDrawIndexedInstancedArguments)));
@@ -184,6 +262,15 @@ class DeferredCommandList {
     args.start_instance_location = start_instance_location;
   }
 
+  void D3DEndQuery(ID3D12QueryHeap* query_heap, D3D12_QUERY_TYPE type,
+                   UINT index) {
+    auto& args = *reinterpret_cast<D3DQueryArguments*>(
+        WriteCommand(Command::kD3DEndQuery, sizeof(D3DQueryArguments)));
+    args.query_heap = query_heap;
+    args.type = type;
+    args.index = index;
+  }
+
   void D3DIASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) {
     auto& args = *reinterpret_cast<D3D12_INDEX_BUFFER_VIEW*>(WriteCommand(
         Command::kD3DIASetIndexBuffer, sizeof(D3D12_INDEX_BUFFER_VIEW)));
@@ -263,6 +350,21 @@ class DeferredCommandList {
     arg = stencil_ref;
   }
 
+  void D3DResolveQueryData(ID3D12QueryHeap* query_heap, D3D12_QUERY_TYPE type,
+                           UINT start_index, UINT num_queries,
+                           ID3D12Resource* destination_buffer,
+                           UINT64 aligned_destination_buffer_offset) {
+    auto& args = *reinterpret_cast<D3DResolveQueryDataArguments*>(
+        WriteCommand(Command::kD3DResolveQueryData,
+                     sizeof(D3DResolveQueryDataArguments)));
+    args.query_heap = query_heap;
+    args.type = type;
+    args.start_index = start_index;
+    args.num_queries = num_queries;
+    args.destination_buffer = destination_buffer;
+    args.aligned_destination_buffer_offset = aligned_destination_buffer_offset;
+  }
+
   void D3DResourceBarrier(UINT num_barriers,
                           const D3D12_RESOURCE_BARRIER* barriers) {
     if (num_barriers == 0) {
@@ -279,6 +381,40 @@ class DeferredCommandList {
                 num_barriers * sizeof(D3D12_RESOURCE_BARRIER));
   }
 
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  // Executed as ID3D12GraphicsCommandList7::Barrier with the texture, buffer
+  // and global barrier groups in this order, must be used only if the command
+  // processor has ID3D12GraphicsCommandList7.
+  void D3DBarrier(UINT32 num_texture_barriers,
+                  const D3D12_TEXTURE_BARRIER* texture_barriers,
+                  UINT32 num_buffer_barriers,
+                  const D3D12_BUFFER_BARRIER* buffer_barriers,
+                  UINT32 num_global_barriers,
+                  const D3D12_GLOBAL_BARRIER* global_barriers) {
+    if (!num_texture_barriers && !num_buffer_barriers &&
+        !num_global_barriers) {
+      return;
+    }
+    static_assert(alignof(D3D12_TEXTURE_BARRIER) <= alignof(uintmax_t));
+    static_assert(alignof(D3D12_BUFFER_BARRIER) <= alignof(uintmax_t));
+    static_assert(alignof(D3D12_GLOBAL_BARRIER) <= alignof(uintmax_t));
+    D3DBarrierOffsets offsets = GetD3DBarrierOffsets(
+        num_texture_barriers, num_buffer_barriers, num_global_barriers);
+    uint8_t* args = reinterpret_cast<uint8_t*>(
+        WriteCommand(Command::kD3DBarrier, offsets.size));
+    D3DBarrierHeader& header = *reinterpret_cast<D3DBarrierHeader*>(args);
+    header.num_texture_barriers = num_texture_barriers;
+    header.num_buffer_barriers = num_buffer_barriers;
+    header.num_global_barriers = num_global_barriers;
+    std::memcpy(args + offsets.texture_barriers, texture_barriers,
+                num_texture_barriers * sizeof(D3D12_TEXTURE_BARRIER));
+    std::memcpy(args + offsets.buffer_barriers, buffer_barriers,
+                num_buffer_barriers * sizeof(D3D12_BUFFER_BARRIER));
+    std::memcpy(args + offsets.global_barriers, global_barriers,
+                num_global_barriers * sizeof(D3D12_GLOBAL_BARRIER));
+  }
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
+
   void RSSetScissorRect(const D3D12_RECT& rect) {
     auto& arg = *reinterpret_cast<D3D12_RECT*>(
         WriteCommand(Command::kRSSetScissorRect, sizeof(D3D12_RECT)));
@@ -343,6 +479,24 @@ class DeferredCommandList {
     args.buffer_location = buffer_location;
   }
 
+  void D3DSetComputeRootShaderResourceView(
+      UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS buffer_location) {
+    auto& args = *reinterpret_cast<SetRootBufferViewArguments*>(
+        WriteCommand(Command::kD3DSetComputeRootShaderResourceView,
+                     sizeof(SetRootBufferViewArguments)));
+    args.root_parameter_index = root_parameter_index;
+    args.buffer_location = buffer_location;
+  }
+
+  void D3DSetComputeRootUnorderedAccessView(
+      UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS buffer_location) {
+    auto& args = *reinterpret_cast<SetRootBufferViewArguments*>(
+        WriteCommand(Command::kD3DSetComputeRootUnorderedAccessView,
+                     sizeof(SetRootBufferViewArguments)));
+    args.root_parameter_index = root_parameter_index;
+    args.buffer_location = buffer_location;
+  }
+
   void D3DSetComputeRootDescriptorTable(
       UINT root_parameter_index, D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor) {
     auto& args = *reinterpret_cast<SetRootDescriptorTableArguments*>(
@@ -407,6 +561,7 @@ class DeferredCommandList {
 
  private:
   enum class Command {
+    kD3DBeginQuery,
     kD3DClearDepthStencilView,
     kD3DClearRenderTargetView,
     kD3DClearUnorderedAccessViewUint,
@@ -417,19 +572,27 @@ class DeferredCommandList {
     kD3DDispatch,
     kD3DDrawIndexedInstanced,
     kD3DDrawInstanced,
+    kD3DEndQuery,
+    kD3DMultiDrawIndexedInstanced,
     kD3DIASetIndexBuffer,
     kD3DIASetPrimitiveTopology,
     kD3DIASetVertexBuffers,
     kD3DOMSetBlendFactor,
     kD3DOMSetRenderTargets,
     kD3DOMSetStencilRef,
+    kD3DResolveQueryData,
     kD3DResourceBarrier,
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+    kD3DBarrier,
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
     kRSSetScissorRect,
     kRSSetViewport,
     kD3DSetComputeRoot32BitConstants,
     kD3DSetGraphicsRoot32BitConstants,
     kD3DSetComputeRootConstantBufferView,
     kD3DSetGraphicsRootConstantBufferView,
+    kD3DSetComputeRootShaderResourceView,
+    kD3DSetComputeRootUnorderedAccessView,
     kD3DSetComputeRootDescriptorTable,
     kD3DSetGraphicsRootDescriptorTable,
     kD3DSetComputeRootSignature,
@@ -514,6 +677,17 @@ class DeferredCommandList {
     UINT start_instance_location;
   };
 
+  // Followed by D3D12_DRAW_INDEXED_ARGUMENTS[draw_count].
+  struct D3DMultiDrawIndexedInstancedHeader {
+    // Null if not uploaded, to execute as separate draws.
+    ID3D12Resource* argument_buffer;
+    UINT64 argument_buffer_offset;
+    UINT draw_count;
+  };
+  // Shorter multi-draws are cheaper to execute directly than to upload.
+  static constexpr UINT kMultiDrawIndirectMinDrawCount = 4;
+  static constexpr UINT kMultiDrawMaxDrawCount = 1024;
+
   struct D3DDrawInstancedArguments {
     UINT vertex_count_per_instance;
     UINT instance_count;
@@ -521,6 +695,53 @@ class DeferredCommandList {
     UINT start_instance_location;
   };
 
+  struct D3DQueryArguments {
+    ID3D12QueryHeap* query_heap;
+    D3D12_QUERY_TYPE type;
+    UINT index;
+  };
+
+  struct D3DResolveQueryDataArguments {
+    ID3D12QueryHeap* query_heap;
+    D3D12_QUERY_TYPE type;
+    UINT start_index;
+    UINT num_queries;
+    ID3D12Resource* destination_buffer;
+    UINT64 aligned_destination_buffer_offset;
+  };
+
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  struct D3DBarrierHeader {
+    UINT32 num_texture_barriers;
+    UINT32 num_buffer_barriers;
+    UINT32 num_global_barriers;
+  };
+  struct D3DBarrierOffsets {
+    size_t texture_barriers;
+    size_t buffer_barriers;
+    size_t global_barriers;
+    size_t size;
+  };
+  static D3DBarrierOffsets GetD3DBarrierOffsets(UINT32 num_texture_barriers,
+                                                UINT32 num_buffer_barriers,
+                                                UINT32 num_global_barriers) {
+    D3DBarrierOffsets offsets;
+    offsets.texture_barriers =
+        xe::align(sizeof(D3DBarrierHeader), alignof(D3D12_TEXTURE_BARRIER));
+    offsets.buffer_barriers =
+        xe::align(offsets.texture_barriers +
+                      num_texture_barriers * sizeof(D3D12_TEXTURE_BARRIER),
+                  alignof(D3D12_BUFFER_BARRIER));
+    offsets.global_barriers =
+        xe::align(offsets.buffer_barriers +
+                      num_buffer_barriers * sizeof(D3D12_BUFFER_BARRIER),
+                  alignof(D3D12_GLOBAL_BARRIER));
+    offsets.size = offsets.global_barriers +
+                   num_global_barriers * sizeof(D3D12_GLOBAL_BARRIER);
+    return offsets;
+  }
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
+
   struct D3DIASetVertexBuffersHeader {
     UINT start_slot;
     UINT num_views;
@@ -546,6 +767,13 @@ class DeferredCommandList {
     D3D12_GPU_VIRTUAL_ADDRESS buffer_location;
   };
 
+  // For root shader resource and unordered access views of raw and structured
+  // buffers.
+  struct SetRootBufferViewArguments {
+    UINT root_parameter_index;
+    D3D12_GPU_VIRTUAL_ADDRESS buffer_location;
+  };
+
   struct SetRootDescriptorTableArguments {
     UINT root_parameter_index;
     D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor;
@@ -564,11 +792,24 @@ class DeferredCommandList {
 
   void* WriteCommand(Command command, size_t arguments_size_bytes);
 
+  // Appends the draw to the multi-draw or the draw recorded last, if any.
+  bool MergeDrawIndexedInstanced(UINT index_count_per_instance,
+                                 UINT instance_count, UINT start_index_location,
+                                 INT base_vertex_location,
+                                 UINT start_instance_location);
+
   const D3D12CommandProcessor& command_processor_;
 
   // uintmax_t to ensure uint64_t and pointer alignment of all structures.
   // std::vector<uintmax_t> command_stream_;
   FixedVMemVector<MAX_SIZEOF_COMMANDLIST> command_stream_;
+  // Byte offset of the header of the most recently written command, or
+  // SIZE_MAX if the list is empty.
+  size_t last_command_offset_ = SIZE_MAX;
+
+  bool merge_draws_ = false;
+  // Byte offsets of the headers of the multi-draw commands.
+  std::vector<size_t> multi_draw_offsets_;
 };
 
 }  // namespace d3d12
@@ -145,6 +145,21 @@ bool PipelineCache::Initialize() {
     }
   }
 
+  if (cvars::parallel_draw_shader_translation &&
+      !cvars::d3d12_dxbc_disasm_dxilconv) {
+    pixel_shader_translator_ = std::make_unique<DxbcShaderTranslator>(
+        provider.GetAdapterVendorID(), bindless_resources_used_,
+        render_target_cache_.GetPath() ==
+            RenderTargetCache::Path::kPixelShaderInterlock,
+        render_target_cache_.gamma_render_target_as_srgb(),
+        render_target_cache_.msaa_2x_supported(),
+        render_target_cache_.draw_resolution_scale_x(),
+        render_target_cache_.draw_resolution_scale_y(),
+        provider.GetGraphicsAnalysis() != nullptr);
+    pixel_shader_translation_worker_ =
+        std::make_unique<ShaderTranslationWorker>();
+  }
+
   uint32_t logical_processor_count = xe::threading::logical_processor_count();
   if (!logical_processor_count) {
     // Pick some reasonable amount if couldn't determine the number of cores.
@@ -222,6 +237,8 @@ void PipelineCache::Shutdown() {
   shader_storage_index_ = 0;
 
   // Shut down shader translation.
+  pixel_shader_translation_worker_.reset();
+  pixel_shader_translator_.reset();
   ui::d3d12::util::ReleaseAndNull(dxc_compiler_);
   ui::d3d12::util::ReleaseAndNull(dxc_utils_);
   ui::d3d12::util::ReleaseAndNull(dxbc_converter_);
@@ -233,11 +250,6 @@ void PipelineCache::InitializeShaderStorage(
 
   auto shader_storage_root = cache_root / "shaders";
   // For files that can be moved between different hosts.
-  // Host PSO blobs - if ever added - should be stored in shaders/local/ (they
-  // currently aren't used because because they may be not very practical -
-  // would need to invalidate them every commit likely, and additional I/O
-  // cost - though D3D's internal validation would possibly be enough to ensure
-  // they are up to date).
   auto shader_storage_shareable_root = shader_storage_root / "shareable";
   if (!std::filesystem::exists(shader_storage_shareable_root)) {
     if (!std::filesystem::create_directories(shader_storage_shareable_root)) {
@@ -252,6 +264,21 @@ void PipelineCache::InitializeShaderStorage(
   bool edram_rov_used = render_target_cache_.GetPath() ==
                         RenderTargetCache::Path::kPixelShaderInterlock;
 
+  // For the compiled pipelines, which are specific to the device and the
+  // driver version (validated by Direct3D itself).
+  auto shader_storage_local_root = shader_storage_root / "local";
+  if (!std::filesystem::exists(shader_storage_local_root) &&
+      !std::filesystem::create_directories(shader_storage_local_root)) {
+    XELOGW(
+        "Failed to create the local shader storage directory, the Direct3D 12 "
+        "pipeline library will not be stored: {}",
+        shader_storage_local_root);
+  } else {
+    LoadPipelineLibrary(shader_storage_local_root /
+                        fmt::format("{:08X}.{}.d3d12.xpsl", title_id,
+                                    edram_rov_used ? "rov" : "rtv"));
+  }
+
   // Initialize the pipeline storage stream - read pipeline descriptions and
   // collect used shader modifications to translate.
   std::vector<PipelineStoredDescription> pipeline_stored_descriptions;
@@ -379,6 +406,7 @@ void PipelineCache::InitializeShaderStorage(
     ShaderStoredHeader shader_header;
     std::vector<uint32_t> ucode_dwords;
     ucode_dwords.reserve(0xFFFF);
+    std::vector<uint8_t> ucode_analysis;
     size_t shaders_translated = 0;
 
     // Threads overlapping file reading.
@@ -492,7 +520,18 @@ void PipelineCache::InitializeShaderStorage(
         // Validation failed.
         break;
       }
-      shader_storage_valid_bytes += sizeof(shader_header) + ucode_byte_count;
+      ucode_analysis.resize(shader_header.ucode_analysis_byte_count);
+      if (shader_header.ucode_analysis_byte_count &&
+          !fread(ucode_analysis.data(), ucode_analysis.size(), 1,
+                 shader_storage_file_)) {
+        break;
+      }
+      if (shader_header.ucode_analysis_hash !=
+          XXH3_64bits(ucode_analysis.data(), ucode_analysis.size())) {
+        break;
+      }
+      shader_storage_valid_bytes += sizeof(shader_header) + ucode_byte_count +
+                                    ucode_analysis.size();
       D3D12Shader* shader =
           LoadShader(shader_header.type, ucode_dwords.data(),
                      shader_header.ucode_dword_count, ucode_data_hash);
@@ -503,6 +542,13 @@ void PipelineCache::InitializeShaderStorage(
       }
       // Loaded from the current storage - don't write again.
       shader->set_ucode_storage_index(shader_storage_index_);
+      // Skip the analysis on the translation threads if its results have been
+      // stored, unless the disassembly, which is not stored, is needed for
+      // dumping.
+      if (!ucode_analysis.empty() && cvars::dump_shaders.empty()) {
+        shader->DeserializeUcodeAnalysis(ucode_analysis.data(),
+                                         ucode_analysis.size());
+      }
       // Create new threads if the currently existing threads can't keep up
       // with file reading, but not more than the number of logical processors
       // minus one.
@@ -790,10 +836,126 @@ void PipelineCache::ShutdownShaderStorage() {
     shader_storage_file_flush_needed_ = false;
   }
 
+  StorePipelineLibrary();
+  {
+    std::lock_guard<std::mutex> lock(pipeline_library_mutex_);
+    ui::d3d12::util::ReleaseAndNull(pipeline_library_);
+    pipeline_library_data_.clear();
+    pipeline_library_data_.shrink_to_fit();
+    pipeline_library_file_path_.clear();
+    pipeline_library_store_needed_ = false;
+  }
+
   shader_storage_cache_root_.clear();
   shader_storage_title_id_ = 0;
 }
 
+void PipelineCache::LoadPipelineLibrary(const std::filesystem::path& path) {
+  std::lock_guard<std::mutex> lock(pipeline_library_mutex_);
+  ui::d3d12::util::ReleaseAndNull(pipeline_library_);
+  pipeline_library_data_.clear();
+  pipeline_library_file_path_.clear();
+  pipeline_library_store_needed_ = false;
+
+  ID3D12Device1* device_1;
+  if (FAILED(command_processor_.GetD3D12Provider().GetDevice()->QueryInterface(
+          IID_PPV_ARGS(&device_1)))) {
+    XELOGW(
+        "ID3D12Device1 is not available, the Direct3D 12 pipeline library will "
+        "not be used");
+    return;
+  }
+
+  FILE* file = xe::filesystem::OpenFile(path, "rb");
+  if (file) {
+    if (xe::filesystem::Seek(file, 0, SEEK_END)) {
+      int64_t file_size = xe::filesystem::Tell(file);
+      if (file_size > 0 && xe::filesystem::Seek(file, 0, SEEK_SET)) {
+        pipeline_library_data_.resize(size_t(file_size));
+        if (!fread(pipeline_library_data_.data(),
+                   pipeline_library_data_.size(), 1, file)) {
+          pipeline_library_data_.clear();
+        }
+      }
+    }
+    fclose(file);
+  }
+
+  // The library from a different adapter or driver version is rejected by
+  // Direct3D, start a new one in this case.
+  if (FAILED(device_1->CreatePipelineLibrary(
+          pipeline_library_data_.data(), pipeline_library_data_.size(),
+          IID_PPV_ARGS(&pipeline_library_)))) {
+    pipeline_library_ = nullptr;
+    if (!pipeline_library_data_.empty()) {
+      XELOGGPU(
+          "Discarding the Direct3D 12 pipeline library {} created for a "
+          "different device or driver",
+          path);
+      pipeline_library_data_.clear();
+      if (FAILED(device_1->CreatePipelineLibrary(
+              nullptr, 0, IID_PPV_ARGS(&pipeline_library_)))) {
+        pipeline_library_ = nullptr;
+      }
+    }
+  }
+  device_1->Release();
+  if (!pipeline_library_) {
+    XELOGW(
+        "Failed to create the Direct3D 12 pipeline library, the pipelines will "
+        "be compiled when loading the shader storage");
+    pipeline_library_data_.clear();
+    return;
+  }
+  pipeline_library_file_path_ = path;
+  if (!pipeline_library_data_.empty()) {
+    XELOGGPU("Loaded {} bytes of the Direct3D 12 pipeline library from {}",
+             pipeline_library_data_.size(), path);
+  }
+}
+
+void PipelineCache::StorePipelineLibrary() {
+  std::lock_guard<std::mutex> lock(pipeline_library_mutex_);
+  if (!pipeline_library_ || !pipeline_library_store_needed_ ||
+      pipeline_library_file_path_.empty()) {
+    return;
+  }
+  size_t data_size = pipeline_library_->GetSerializedSize();
+  if (!data_size) {
+    return;
+  }
+  std::vector<uint8_t> data(data_size);
+  if (FAILED(pipeline_library_->Serialize(data.data(), data_size))) {
+    XELOGW("Failed to serialize the Direct3D 12 pipeline library");
+    return;
+  }
+  // Write to a temporary file first not to leave a partially written library
+  // if terminated while writing.
+  std::filesystem::path temp_path = pipeline_library_file_path_;
+  temp_path += ".tmp";
+  FILE* file = xe::filesystem::OpenFile(temp_path, "wb");
+  if (!file) {
+    XELOGW(
+        "Failed to open the Direct3D 12 pipeline library file for writing: {}",
+        temp_path);
+    return;
+  }
+  bool written = fwrite(data.data(), data_size, 1, file) == 1;
+  fclose(file);
+  std::error_code error_code;
+  if (written) {
+    std::filesystem::rename(temp_path, pipeline_library_file_path_,
+                            error_code);
+  }
+  if (!written || error_code) {
+    XELOGW("Failed to write the Direct3D 12 pipeline library file: {}",
+           pipeline_library_file_path_);
+    std::filesystem::remove(temp_path, error_code);
+    return;
+  }
+  pipeline_library_store_needed_ = false;
+}
+
 void PipelineCache::EndSubmission() {
   if (shader_storage_file_flush_needed_ ||
       pipeline_storage_file_flush_needed_) {
@@ -897,6 +1059,14 @@ PipelineCache::GetCurrentVertexShaderModification(
                regs.Get<reg::VGT_DRAW_INITIATOR>().prim_type ==
                    xenos::PrimitiveType::kPointList);
 
+  xenos::Endian vertex_fetch_endian;
+  if (cvars::static_vertex_fetch_endian &&
+      draw_util::GetStaticVertexFetchEndian(regs, shader,
+                                            vertex_fetch_endian)) {
+    modification.vertex.vertex_fetch_endian_static = 1;
+    modification.vertex.vertex_fetch_endian = vertex_fetch_endian;
+  }
+
   return modification;
 }
 
@@ -983,6 +1153,20 @@ bool PipelineCache::ConfigurePipeline(
               register_file_.Get<reg::SQ_PROGRAM_CNTL>().vs_export_mode !=
                   xenos::VertexShaderExportMode::kPosition2VectorsEdgeKill);
   assert_false(register_file_.Get<reg::SQ_PROGRAM_CNTL>().gen_index_vtx);
+  // If both shaders are new, translate the pixel shader on the worker thread
+  // while the vertex shader is translated on this one.
+  bool pixel_shader_translating_in_parallel = false;
+  if (pixel_shader_translation_worker_ && pixel_shader != nullptr &&
+      !pixel_shader->is_translated() && !vertex_shader->is_translated()) {
+    if (!pixel_shader->shader().is_ucode_analyzed()) {
+      pixel_shader->shader().AnalyzeUcode(ucode_disasm_buffer_);
+    }
+    pixel_shader_translation_worker_->Start([this, pixel_shader]() {
+      return TranslateAnalyzedShader(*pixel_shader_translator_, *pixel_shader,
+                                     nullptr, nullptr, nullptr);
+    });
+    pixel_shader_translating_in_parallel = true;
+  }
   if (!vertex_shader->is_translated()) {
     if (!vertex_shader->shader().is_ucode_analyzed()) {
       vertex_shader->shader().AnalyzeUcode(ucode_disasm_buffer_);
@@ -990,6 +1174,9 @@ bool PipelineCache::ConfigurePipeline(
     if (!TranslateAnalyzedShader(*shader_translator_, *vertex_shader,
                                  dxbc_converter_, dxc_utils_, dxc_compiler_)) {
       XELOGE("Failed to translate the vertex shader!");
+      if (pixel_shader_translating_in_parallel) {
+        pixel_shader_translation_worker_->Await();
+      }
       return false;
     }
     if (shader_storage_file_ && vertex_shader->shader().ucode_storage_index() !=
@@ -1004,20 +1191,31 @@ bool PipelineCache::ConfigurePipeline(
       storage_write_request_cond_.notify_all();
     }
   }
+  bool pixel_shader_translated_in_parallel =
+      pixel_shader_translating_in_parallel &&
+      pixel_shader_translation_worker_->Await();
   if (!vertex_shader->is_valid()) {
     // Translation attempted previously, but not valid.
     return false;
   }
   if (pixel_shader != nullptr) {
-    if (!pixel_shader->is_translated()) {
-      if (!pixel_shader->shader().is_ucode_analyzed()) {
-        pixel_shader->shader().AnalyzeUcode(ucode_disasm_buffer_);
-      }
-      if (!TranslateAnalyzedShader(*shader_translator_, *pixel_shader,
-                                   dxbc_converter_, dxc_utils_,
-                                   dxc_compiler_)) {
-        XELOGE("Failed to translate the pixel shader!");
-        return false;
+    if (pixel_shader_translating_in_parallel ||
+        !pixel_shader->is_translated()) {
+      if (pixel_shader_translating_in_parallel) {
+        if (!pixel_shader_translated_in_parallel) {
+          XELOGE("Failed to translate the pixel shader!");
+          return false;
+        }
+      } else {
+        if (!pixel_shader->shader().is_ucode_analyzed()) {
+          pixel_shader->shader().AnalyzeUcode(ucode_disasm_buffer_);
+        }
+        if (!TranslateAnalyzedShader(*shader_translator_, *pixel_shader,
+                                     dxbc_converter_, dxc_utils_,
+                                     dxc_compiler_)) {
+          XELOGE("Failed to translate the pixel shader!");
+          return false;
+        }
       }
       if (shader_storage_file_ &&
           pixel_shader->shader().ucode_storage_index() !=
@@ -3200,20 +3398,44 @@ ID3D12PipelineState* PipelineCache::CreateD3D12Pipeline(
     state_desc.DepthStencilState.StencilEnable = FALSE;
   }
 
-  // Create the D3D12 pipeline state object.
+  // Load the D3D12 pipeline state object compiled in the previous runs, or
+  // create it.
+  std::wstring library_name = fmt::format(
+      L"{:016X}", XXH3_64bits(&description, sizeof(description)));
+  ID3D12PipelineState* state = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(pipeline_library_mutex_);
+    if (pipeline_library_ &&
+        FAILED(pipeline_library_->LoadGraphicsPipeline(
+            library_name.c_str(), &state_desc, IID_PPV_ARGS(&state)))) {
+      // Not stored yet, or stored with a different state description (with a
+      // hash collision or different translated shaders).
+      state = nullptr;
+    }
+  }
   ID3D12Device* device = command_processor_.GetD3D12Provider().GetDevice();
-  ID3D12PipelineState* state;
-  if (FAILED(device->CreateGraphicsPipelineState(&state_desc,
-                                                 IID_PPV_ARGS(&state)))) {
-    if (runtime_description.pixel_shader != nullptr) {
-      XELOGE("Failed to create graphics pipeline with VS {:016X}, PS {:016X}",
-             runtime_description.vertex_shader->shader().ucode_data_hash(),
-             runtime_description.pixel_shader->shader().ucode_data_hash());
-    } else {
-      XELOGE("Failed to create graphics pipeline with VS {:016X}",
-             runtime_description.vertex_shader->shader().ucode_data_hash());
+  if (!state) {
+    if (FAILED(device->CreateGraphicsPipelineState(&state_desc,
+                                                   IID_PPV_ARGS(&state)))) {
+      if (runtime_description.pixel_shader != nullptr) {
+        XELOGE(
+            "Failed to create graphics pipeline with VS {:016X}, PS {:016X}",
+            runtime_description.vertex_shader->shader().ucode_data_hash(),
+            runtime_description.pixel_shader->shader().ucode_data_hash());
+      } else {
+        XELOGE("Failed to create graphics pipeline with VS {:016X}",
+               runtime_description.vertex_shader->shader().ucode_data_hash());
+      }
+      return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(pipeline_library_mutex_);
+    // Replacing a pipeline with the same name isn't possible, so an outdated
+    // pipeline stays in the library until the storage is deleted.
+    if (pipeline_library_ &&
+        SUCCEEDED(pipeline_library_->StorePipeline(library_name.c_str(),
+                                                   state))) {
+      pipeline_library_store_needed_ = true;
     }
-    return nullptr;
   }
   std::wstring name;
   if (runtime_description.pixel_shader != nullptr) {
@@ -3237,6 +3459,7 @@ void PipelineCache::StorageWriteThread() {
 
   std::vector<uint32_t> ucode_guest_endian;
   ucode_guest_endian.reserve(0xFFFF);
+  std::vector<uint8_t> ucode_analysis;
 
   bool flush_shaders = false;
   bool flush_pipelines = false;
@@ -3288,6 +3511,10 @@ void PipelineCache::StorageWriteThread() {
       shader_header.ucode_data_hash = shader->ucode_data_hash();
       shader_header.ucode_dword_count = shader->ucode_dword_count();
       shader_header.type = shader->type();
+      shader->SerializeUcodeAnalysis(ucode_analysis);
+      shader_header.ucode_analysis_byte_count = uint32_t(ucode_analysis.size());
+      shader_header.ucode_analysis_hash =
+          XXH3_64bits(ucode_analysis.data(), ucode_analysis.size());
       assert_not_null(shader_storage_file_);
       fwrite(&shader_header, sizeof(shader_header), 1, shader_storage_file_);
       if (shader_header.ucode_dword_count) {
@@ -3300,6 +3527,10 @@ void PipelineCache::StorageWriteThread() {
                shader_header.ucode_dword_count * sizeof(uint32_t), 1,
                shader_storage_file_);
       }
+      if (!ucode_analysis.empty()) {
+        fwrite(ucode_analysis.data(), ucode_analysis.size(), 1,
+               shader_storage_file_);
+      }
     }
 
     if (write_pipeline) {
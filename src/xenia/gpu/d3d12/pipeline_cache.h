@@ -34,6 +34,7 @@
 #include "xenia/gpu/primitive_processor.h"
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/registers.h"
+#include "xenia/gpu/shader_translation_worker.h"
 #include "xenia/gpu/xenos.h"
 #include "xenia/ui/d3d12/d3d12_api.h"
 
@@ -111,7 +112,12 @@ class PipelineCache {
     uint32_t ucode_dword_count : 31;
     xenos::ShaderType type : 1;
 
-    static constexpr uint32_t kVersion = 0x20201219;
+    // Results of Shader::AnalyzeUcode following the microcode, in the host
+    // format.
+    uint32_t ucode_analysis_byte_count;
+    uint64_t ucode_analysis_hash;
+
+    static constexpr uint32_t kVersion = 0x20261014;
   });
 
   // Update PipelineDescription::kVersion if any of the Pipeline* enums are
@@ -322,6 +328,12 @@ class PipelineCache {
   IDxcUtils* dxc_utils_ = nullptr;
   IDxcCompiler* dxc_compiler_ = nullptr;
 
+  // Translator and thread for translating the pixel shader of a draw in
+  // parallel with the vertex shader, if parallel_draw_shader_translation is
+  // enabled (and DXIL disassembly, which needs thread-local objects, is not).
+  std::unique_ptr<DxbcShaderTranslator> pixel_shader_translator_;
+  std::unique_ptr<ShaderTranslationWorker> pixel_shader_translation_worker_;
+
   // Ucode hash -> shader.
   std::unordered_map<uint64_t, D3D12Shader*, xe::hash::IdentityHasher<uint64_t>>
       shaders_;
@@ -387,6 +399,22 @@ class PipelineCache {
   FILE* pipeline_storage_file_ = nullptr;
   bool pipeline_storage_file_flush_needed_ = false;
 
+  // Driver-compiled pipelines, persistently stored per device in the local
+  // (non-shareable) part of the shader storage, named by the hashes of their
+  // descriptions, to load the pipelines from instead of compiling them when
+  // preloading the storage. Direct3D validates the whole pipeline state
+  // description on loading, so outdated pipelines are simply recompiled. Used
+  // by the creation threads, so protected by pipeline_library_mutex_.
+  void LoadPipelineLibrary(const std::filesystem::path& path);
+  void StorePipelineLibrary();
+  std::mutex pipeline_library_mutex_;
+  ID3D12PipelineLibrary* pipeline_library_ = nullptr;
+  // Referenced by pipeline_library_, must be kept while it exists.
+  std::vector<uint8_t> pipeline_library_data_;
+  std::filesystem::path pipeline_library_file_path_;
+  // Whether any pipelines have been added since the library has been loaded.
+  bool pipeline_library_store_needed_ = false;
+
   // Thread for asynchronous writing to the storage streams.
   void StorageWriteThread();
   std::mutex storage_write_request_lock_;
@@ -12,11 +12,14 @@
 #include <algorithm>
 #include <cfloat>
 #include <cstdint>
+#include <cstring>
+#include <utility>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
+#include "xenia/base/xxhash.h"
 #include "xenia/gpu/registers.h"
 #include "xenia/gpu/ucode.h"
 #include "xenia/gpu/xenos.h"
@@ -48,6 +51,13 @@ DEFINE_bool(
     "some games draw rectangles (for their UI, for instance) without clipping, "
     "but with a proper scissor rectangle.",
     "GPU");
+DEFINE_bool(
+    execute_unclipped_draw_vs_on_cpu_straight_line, true,
+    "For execute_unclipped_draw_vs_on_cpu, translate the vertex shader once "
+    "per set of bool constants into a straight line of only the instructions "
+    "contributing to the position, instead of interpreting the whole shader "
+    "with its control flow for every vertex.",
+    "GPU");
 
 namespace xe {
 namespace gpu {
@@ -73,6 +83,41 @@ void DrawExtentEstimator::PositionYExportSink::Export(
   }
 }
 
+size_t DrawExtentEstimator::PositionStraightLineKey::Hasher::operator()(
+    const PositionStraightLineKey& key) const {
+  return size_t(XXH3_64bits(&key, sizeof(key)));
+}
+
+const DrawExtentEstimator::PositionStraightLine*
+DrawExtentEstimator::GetPositionStraightLine(const Shader& vertex_shader) {
+  if (!cvars::execute_unclipped_draw_vs_on_cpu_straight_line) {
+    return nullptr;
+  }
+  PositionStraightLineKey key;
+  std::memset(&key, 0, sizeof(key));
+  key.ucode_data_hash = vertex_shader.ucode_data_hash();
+  std::memcpy(key.bool_constants,
+              &register_file_[XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031],
+              sizeof(key.bool_constants));
+  auto it = position_straight_lines_.find(key);
+  if (it == position_straight_lines_.end()) {
+    // Games switching between many bool constant combinations shouldn't make
+    // the cache grow indefinitely.
+    if (position_straight_lines_.size() >= 4096) {
+      position_straight_lines_.clear();
+    }
+    PositionStraightLine straight_line;
+    straight_line.is_valid = ShaderInterpreter::BuildPositionStraightLine(
+        vertex_shader.ucode_dwords(), register_file_,
+        straight_line.instructions);
+    if (!straight_line.is_valid) {
+      straight_line.instructions.clear();
+    }
+    it = position_straight_lines_.emplace(key, std::move(straight_line)).first;
+  }
+  return it->second.is_valid ? &it->second : nullptr;
+}
+
 uint32_t DrawExtentEstimator::EstimateVertexMaxY(const Shader& vertex_shader) {
   SCOPE_profile_cpu_f("gpu");
 
@@ -169,6 +214,8 @@ uint32_t DrawExtentEstimator::EstimateVertexMaxY(const Shader& vertex_shader) {
   float max_y = -FLT_MAX;
 
   shader_interpreter_.SetShader(vertex_shader);
+  const PositionStraightLine* straight_line =
+      GetPositionStraightLine(vertex_shader);
 
   PositionYExportSink position_y_export_sink;
   shader_interpreter_.SetExportSink(&position_y_export_sink);
@@ -201,7 +248,13 @@ uint32_t DrawExtentEstimator::EstimateVertexMaxY(const Shader& vertex_shader) {
     position_y_export_sink.Reset();
 
     shader_interpreter_.temp_registers()[0] = float(vertex_index);
-    shader_interpreter_.Execute();
+    if (straight_line) {
+      shader_interpreter_.ExecuteStraightLine(
+          straight_line->instructions.data(),
+          straight_line->instructions.size());
+    } else {
+      shader_interpreter_.Execute();
+    }
 
     if (position_y_export_sink.vertex_kill().has_value() &&
         (position_y_export_sink.vertex_kill().value() & ~(UINT32_C(1) << 31))) {
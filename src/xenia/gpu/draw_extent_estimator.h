@@ -11,7 +11,10 @@
 #define XENIA_GPU_DRAW_EXTENT_ESTIMATOR_H_
 
 #include <cstdint>
+#include <cstring>
 #include <optional>
+#include <unordered_map>
+#include <vector>
 
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/shader.h"
@@ -63,11 +66,38 @@ class DrawExtentEstimator {
     std::optional<uint32_t> vertex_kill_;
   };
 
+  // The resolved control flow for the bool constants used when building the
+  // straight line.
+  struct PositionStraightLineKey {
+    uint64_t ucode_data_hash;
+    uint32_t bool_constants[8];
+
+    struct Hasher {
+      size_t operator()(const PositionStraightLineKey& key) const;
+    };
+    bool operator==(const PositionStraightLineKey& other_key) const {
+      return !std::memcmp(this, &other_key, sizeof(*this));
+    }
+  };
+  struct PositionStraightLine {
+    // False if the shader can't be executed as a straight line, for falling
+    // back to the interpreter without trying again.
+    bool is_valid;
+    std::vector<ShaderInterpreter::StraightLineInstruction> instructions;
+  };
+  // Returns nullptr if the interpreter needs to be used.
+  const PositionStraightLine* GetPositionStraightLine(
+      const Shader& vertex_shader);
+
   const RegisterFile& register_file_;
   const Memory& memory_;
   TraceWriter* trace_writer_;
 
   ShaderInterpreter shader_interpreter_;
+
+  std::unordered_map<PositionStraightLineKey, PositionStraightLine,
+                     PositionStraightLineKey::Hasher>
+      position_straight_lines_;
 };
 
 }  // namespace gpu
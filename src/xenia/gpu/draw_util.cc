@@ -764,6 +764,24 @@ uint32_t GetNormalizedColorMask(const RegisterFile& regs,
   return normalized_color_mask;
 }
 
+bool GetStaticVertexFetchEndian(const RegisterFile& regs, const Shader& shader,
+                                xenos::Endian& endian_out) {
+  const std::vector<Shader::VertexBinding>& vertex_bindings =
+      shader.vertex_bindings();
+  if (vertex_bindings.empty()) {
+    return false;
+  }
+  xenos::Endian endian =
+      regs.GetVertexFetch(vertex_bindings.front().fetch_constant).endian;
+  for (const Shader::VertexBinding& vertex_binding : vertex_bindings) {
+    if (regs.GetVertexFetch(vertex_binding.fetch_constant).endian != endian) {
+      return false;
+    }
+  }
+  endian_out = endian;
+  return true;
+}
+
 void AddMemExportRanges(const RegisterFile& regs, const Shader& shader,
                         std::vector<MemExportRange>& ranges_out) {
   if (!shader.memexport_eM_written()) {
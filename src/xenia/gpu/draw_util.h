@@ -488,6 +488,12 @@ struct MemExportRange {
 void AddMemExportRanges(const RegisterFile& regs, const Shader& shader,
                         std::vector<MemExportRange>& ranges_out);
 
+// Returns whether all the vertex fetch constants used by the shader have the
+// same endianness, which can then be used by the translated shader directly
+// instead of the one from the fetch constant.
+bool GetStaticVertexFetchEndian(const RegisterFile& regs, const Shader& shader,
+                                xenos::Endian& endian_out);
+
 // To avoid passing values that the shader won't understand (even though
 // Direct3D 9 shouldn't pass them anyway).
 XE_NOINLINE
@@ -114,7 +114,7 @@ class DxbcShaderTranslator : public ShaderTranslator {
     // If anything in this is structure is changed in a way not compatible with
     // the previous layout, invalidate the pipeline storages by increasing this
     // version number (0xYYYYMMDD)!
-    static constexpr uint32_t kVersion = 0x20220720;
+    static constexpr uint32_t kVersion = 0x20261014;
 
     enum class DepthStencilMode : uint32_t {
       kNoModifiers,
@@ -161,6 +161,10 @@ class DxbcShaderTranslator : public ShaderTranslator {
       // Pipeline stage and input configuration.
       Shader::HostVertexShaderType host_vertex_shader_type
           : Shader::kHostVertexShaderTypeBitCount;
+      // Whether all vertex fetches use vertex_fetch_endian rather than the
+      // endianness from the fetch constant (static_vertex_fetch_endian).
+      uint32_t vertex_fetch_endian_static : 1;
+      xenos::Endian vertex_fetch_endian : 2;
     } vertex;
     struct PixelShaderModification {
       // uint32_t 0.
@@ -26,6 +26,16 @@ DEFINE_uint64(framerate_limit, 0,
               "GPU");
 UPDATE_from_uint64(framerate_limit, 2024, 8, 31, 20, 60);
 
+DEFINE_uint32(
+    vblank_locked_guest_time_timeout_ms, 0,
+    "Makes the guest time deterministic for benchmarking and reproducing: the "
+    "guest clock only advances by exactly one refresh interval (of "
+    "framerate_limit, or 60 Hz) on every vblank, and a vblank is issued as "
+    "soon as the guest ends a frame, or after this many milliseconds of host "
+    "time if the guest doesn't end one, for instance while loading. 0 to "
+    "follow the host time.",
+    "GPU");
+
 DEFINE_bool(
     gpu_allow_invalid_fetch_constants, true,
     "Allow texture and vertex fetch constants with invalid type - generally "
@@ -55,6 +65,22 @@ DEFINE_bool(
     "when MSAA is used with fullscreen passes.",
     "GPU");
 
+DEFINE_bool(
+    parallel_draw_shader_translation, true,
+    "When a draw uses both a new vertex shader and a new pixel shader, "
+    "translate the pixel shader on a separate thread while the vertex shader "
+    "is being translated.",
+    "GPU");
+
+DEFINE_bool(
+    static_vertex_fetch_endian, true,
+    "Translate vertex shaders with the byte order of the vertex data known at "
+    "translation time when all their vertex buffers use the same one, to "
+    "replace the swapping selected for every fetch at runtime with just the "
+    "needed operations. Creates a pipeline variant per byte order, usually "
+    "only one is used by a game.",
+    "GPU");
+
 DEFINE_int32(query_occlusion_fake_sample_count, 100,
              "If set to -1 no sample counts are written, games may hang. Else, "
              "the sample count of every tile will be incremented on every "
@@ -62,3 +88,33 @@ DEFINE_int32(query_occlusion_fake_sample_count, 100,
              "everything is reported as occluded.",
              "GPU");
 UPDATE_from_int32(query_occlusion_fake_sample_count, 2024, 9, 23, 9, 1000);
+
+DEFINE_bool(query_occlusion_host, false,
+            "[D3D12 Only] Measure the sample counts of occlusion queries on "
+            "the host GPU instead of reporting "
+            "query_occlusion_fake_sample_count, so the visibility culling of "
+            "games works. The results are written asynchronously, like on the "
+            "console.",
+            "GPU");
+DEFINE_int32(query_occlusion_latency_frames, 1,
+             "With query_occlusion_host, the maximum number of frames after "
+             "the one ending an occlusion query to wait for its result to be "
+             "written if the host GPU hasn't completed it by itself yet. 0 to "
+             "have the results by the end of the frame.",
+             "GPU");
+
+DEFINE_bool(gpu_timestamps, false,
+            "[D3D12 Only] Measure the host GPU time of guest draws, resolves, "
+            "EDRAM transfers, texture loads and presenter effects with "
+            "timestamp queries. The totals per frame are shown in the "
+            "profiler, and the time of every operation is written by the "
+            "trace dump benchmark.",
+            "GPU");
+
+DEFINE_uint32(submit_split_draw_count, 256,
+              "Submit the host commands recorded so far in the middle of a "
+              "frame after this many draws if the host GPU has completed all "
+              "the earlier submissions, so it doesn't stay idle while the "
+              "rest of a CPU-heavy frame is being processed. 0 to submit only "
+              "when the guest primary buffers end and on swaps.",
+              "GPU");
@@ -20,14 +20,28 @@ DECLARE_bool(vsync);
 
 DECLARE_uint64(framerate_limit);
 
+DECLARE_uint32(vblank_locked_guest_time_timeout_ms);
+
 DECLARE_bool(gpu_allow_invalid_fetch_constants);
 
 DECLARE_bool(non_seamless_cube_map);
 
 DECLARE_bool(half_pixel_offset);
 
+DECLARE_bool(parallel_draw_shader_translation);
+
+DECLARE_bool(static_vertex_fetch_endian);
+
 DECLARE_int32(query_occlusion_fake_sample_count);
 
+DECLARE_bool(query_occlusion_host);
+
+DECLARE_int32(query_occlusion_latency_frames);
+
+DECLARE_bool(gpu_timestamps);
+
+DECLARE_uint32(submit_split_draw_count);
+
 DECLARE_bool(disassemble_pm4);
 
 #endif  // XENIA_GPU_GPU_FLAGS_H_
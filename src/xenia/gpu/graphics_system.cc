@@ -154,6 +154,8 @@ X_STATUS GraphicsSystem::Setup(cpu::Processor* processor,
       reinterpret_cast<cpu::MMIOReadCallback>(ReadRegisterThunk),
       reinterpret_cast<cpu::MMIOWriteCallback>(WriteRegisterThunk));
 
+  frame_boundary_event_ = threading::Event::CreateAutoResetEvent(false);
+
   // Frame limiter thread.
   frame_limiter_worker_running_ = true;
   frame_limiter_worker_thread_ =
@@ -168,6 +170,28 @@ X_STATUS GraphicsSystem::Setup(cpu::Processor* processor,
             if (normalized_framerate_limit == 0 && cvars::vsync)
               normalized_framerate_limit = 60;
 
+            if (cvars::vblank_locked_guest_time_timeout_ms) {
+              // Guest time only advancing with the vblanks, and the vblanks
+              // following the guest frames rather than the host time.
+              const uint64_t vblank_guest_ticks =
+                  Clock::guest_tick_frequency() /
+                  (normalized_framerate_limit ? normalized_framerate_limit
+                                              : 60);
+              const auto vblank_timeout = std::chrono::milliseconds(
+                  cvars::vblank_locked_guest_time_timeout_ms);
+              Clock::set_guest_tick_count_locked(true);
+              while (frame_limiter_worker_running_) {
+                register_file()->values[XE_GPU_REG_D1MODE_V_COUNTER] +=
+                    GetInternalDisplayResolution().second;
+                Clock::AdvanceLockedGuestTickCount(vblank_guest_ticks);
+                MarkVblank();
+                threading::Wait(frame_boundary_event_.get(), false,
+                                vblank_timeout);
+              }
+              Clock::set_guest_tick_count_locked(false);
+              return 0;
+            }
+
             const double vsync_duration_d =
                 cvars::vsync
                     ? std::max<double>(5.0,
@@ -356,6 +380,12 @@ void GraphicsSystem::DispatchInterruptCallback(uint32_t source, uint32_t cpu) {
                                         interrupt_callback_data_, source, cpu);
 }
 
+void GraphicsSystem::OnGuestFrameBoundary() {
+  if (frame_boundary_event_) {
+    frame_boundary_event_->Set();
+  }
+}
+
 void GraphicsSystem::MarkVblank() {
   SCOPE_profile_cpu_f("gpu");
 
@@ -398,6 +428,31 @@ void GraphicsSystem::InitializeShaderStorage(
   }
 }
 
+void GraphicsSystem::BeginShaderStorageInitialization(
+    const std::filesystem::path& cache_root, uint32_t title_id) {
+  assert_null(shader_storage_initialization_fence_);
+  if (!cvars::store_shaders) {
+    return;
+  }
+  if (command_processor_->is_paused()) {
+    command_processor_->InitializeShaderStorage(cache_root, title_id, true);
+    return;
+  }
+  shader_storage_initialization_fence_ =
+      std::make_unique<xe::threading::Fence>();
+  command_processor_->CallInThread([this, cache_root, title_id]() {
+    command_processor_->InitializeShaderStorage(cache_root, title_id, true);
+    shader_storage_initialization_fence_->Signal();
+  });
+}
+
+void GraphicsSystem::WaitForShaderStorageInitialization() {
+  if (shader_storage_initialization_fence_) {
+    shader_storage_initialization_fence_->Wait();
+    shader_storage_initialization_fence_.reset();
+  }
+}
+
 void GraphicsSystem::RequestFrameTrace() {
   command_processor_->RequestFrameTrace(cvars::trace_gpu_prefix);
 }
@@ -18,6 +18,7 @@
 #include <string>
 #include <thread>
 
+#include "xenia/base/threading.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/gpu/register_file.h"
 #include "xenia/kernel/xthread.h"
@@ -79,8 +80,18 @@ class GraphicsSystem {
 
   virtual void ClearCaches();
 
+  // Called at the end of each guest frame, from any thread. With
+  // vblank_locked_guest_time_timeout_ms, issues the next vblank.
+  void OnGuestFrameBoundary();
+
   void InitializeShaderStorage(const std::filesystem::path& cache_root,
                                uint32_t title_id, bool blocking);
+  // Loads the shader storage like the blocking InitializeShaderStorage, but on
+  // the command processor thread while the caller continues preparing the
+  // title, until WaitForShaderStorageInitialization.
+  void BeginShaderStorageInitialization(
+      const std::filesystem::path& cache_root, uint32_t title_id);
+  void WaitForShaderStorageInitialization();
 
   void RequestFrameTrace();
   void BeginTracing();
@@ -127,6 +138,7 @@ class GraphicsSystem {
   uint32_t interrupt_callback_data_ = 0;
 
   std::atomic<bool> frame_limiter_worker_running_;
+  std::unique_ptr<xe::threading::Event> frame_boundary_event_;
   kernel::object_ref<kernel::XHostThread> frame_limiter_worker_thread_;
 
   RegisterFile* register_file_;
@@ -140,6 +152,8 @@ class GraphicsSystem {
  private:
   std::unique_ptr<ui::Presenter> presenter_;
 
+  std::unique_ptr<xe::threading::Fence> shader_storage_initialization_fence_;
+
   std::atomic_flag host_gpu_loss_reported_;
 };
 
@@ -394,6 +394,7 @@ bool COMMAND_PROCESSOR::ExecutePacketType3(uint32_t packet) XE_RESTRICT {
   uint32_t opcode = (packet >> 8) & 0x7F;
   uint32_t count = ((packet >> 16) & 0x3FFF) + 1;
   auto data_start_offset = reader_.read_offset();
+  current_packet_ptr_ = reader_.read_ptr() - sizeof(uint32_t);
 
   if (COMMAND_PROCESSOR::GetCurrentRingReadCount() >=
       count * sizeof(uint32_t)) {
@@ -633,6 +634,7 @@ bool COMMAND_PROCESSOR::ExecutePacketType3_INTERRUPT(
 
   // generate interrupt from the command stream
   uint32_t cpu_mask = reader_.ReadAndSwap<uint32_t>();
+  COMMAND_PROCESSOR::PrepareForGuestFence();
   for (int n = 0; n < 6; n++) {
     if (cpu_mask & (1 << n)) {
       graphics_system_->DispatchInterruptCallback(1, n);
@@ -742,6 +744,8 @@ bool COMMAND_PROCESSOR::ExecutePacketType3_WAIT_REG_MEM(
           xe::threading::Sleep(std::chrono::milliseconds(wait / 0x100));
           ReturnFromWait();
         }
+        // The value may be a fence written when a submission completes.
+        UpdateWhileWaiting();
 
         if (!worker_running_) {
           // Short-circuited exit.
@@ -812,7 +816,9 @@ bool COMMAND_PROCESSOR::ExecutePacketType3_MEM_WRITE(
     auto endianness = static_cast<xenos::Endian>(write_addr & 0x3);
     auto addr = write_addr & ~0x3;
     write_data = GpuSwap(write_data, endianness);
-    xe::store(memory_->TranslatePhysical(addr), write_data);
+    COMMAND_PROCESSOR::WriteGuestFence(
+        reinterpret_cast<uint32_t*>(memory_->TranslatePhysical(addr)),
+        write_data);
     trace_writer_.WriteMemoryWrite(CpuToGpu(addr), 4);
     write_addr += 4;
   }
@@ -912,7 +918,8 @@ bool COMMAND_PROCESSOR::ExecutePacketType3_EVENT_WRITE_SHD(
           memory_->TranslateVirtual(0x7F000000 + writeback_offset);
     }
   }
-  xe::store(write_destination, data_value);
+  COMMAND_PROCESSOR::WriteGuestFence(
+      reinterpret_cast<uint32_t*>(write_destination), data_value);
   trace_writer_.WriteMemoryWrite(CpuToGpu(address), 4);
   return true;
 }
@@ -964,19 +971,35 @@ bool COMMAND_PROCESSOR::ExecutePacketType3_EVENT_WRITE_ZPD(
 
   // Occlusion queries:
   // This command is send on query begin and end.
+  uint32_t sample_counts_address =
+      register_file_->values[XE_GPU_REG_RB_SAMPLE_COUNT_ADDR];
+  auto* pSampleCounts =
+      memory_->TranslatePhysical<xe_gpu_depth_sample_counts*>(
+          sample_counts_address);
+  // 0xFFFFFEED is written to this two locations by D3D only on D3DISSUE_END
+  // and used to detect a finished query.
+  bool is_end_via_z_pass = pSampleCounts->ZPass_A == kQueryFinished &&
+                           pSampleCounts->ZPass_B == kQueryFinished;
+  // Older versions of D3D also checks for ZFail (4D5307D5).
+  bool is_end_via_z_fail = pSampleCounts->ZFail_A == kQueryFinished &&
+                           pSampleCounts->ZFail_B == kQueryFinished;
+  if (cvars::query_occlusion_host) {
+    // D3D subtracts the counts at the beginning from the ones at the end, so
+    // the beginning is reported as 0, and the host backend writes the samples
+    // passed in between at the end when it has them.
+    if (is_end_via_z_pass || is_end_via_z_fail) {
+      if (COMMAND_PROCESSOR::EndOcclusionQuery(sample_counts_address)) {
+        return true;
+      }
+    } else if (COMMAND_PROCESSOR::BeginOcclusionQuery()) {
+      std::memset(pSampleCounts, 0, sizeof(xe_gpu_depth_sample_counts));
+      return true;
+    }
+  }
+
   // As a workaround report some fixed amount of passed samples.
   auto fake_sample_count = cvars::query_occlusion_fake_sample_count;
   if (fake_sample_count >= 0) {
-    auto* pSampleCounts =
-        memory_->TranslatePhysical<xe_gpu_depth_sample_counts*>(
-            register_file_->values[XE_GPU_REG_RB_SAMPLE_COUNT_ADDR]);
-    // 0xFFFFFEED is written to this two locations by D3D only on D3DISSUE_END
-    // and used to detect a finished query.
-    bool is_end_via_z_pass = pSampleCounts->ZPass_A == kQueryFinished &&
-                             pSampleCounts->ZPass_B == kQueryFinished;
-    // Older versions of D3D also checks for ZFail (4D5307D5).
-    bool is_end_via_z_fail = pSampleCounts->ZFail_A == kQueryFinished &&
-                             pSampleCounts->ZFail_B == kQueryFinished;
     std::memset(pSampleCounts, 0, sizeof(xe_gpu_depth_sample_counts));
     if (is_end_via_z_pass || is_end_via_z_fail) {
       pSampleCounts->ZPass_A = fake_sample_count;
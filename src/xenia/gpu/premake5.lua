@@ -14,6 +14,7 @@ project("xenia-gpu")
     "xenia-base",
     "xenia-ui",
     "xxhash",
+    "zstd",
   })
   includedirs({
     project_root.."/third_party/Vulkan-Headers/include",
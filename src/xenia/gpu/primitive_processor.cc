@@ -68,6 +68,21 @@ DEFINE_int32(
     "while a very low value may result in excessive locking and lookups.\n"
     "Negative values disable caching.",
     "GPU");
+DEFINE_uint32(
+    primitive_processor_persistent_cache_mb, 64,
+    "Maximum size of host memory, in megabytes, for keeping converted guest "
+    "indices stored in the cache across frames, so static index buffers that "
+    "need processing are processed only once until the guest writes to them.\n"
+    "0 to only reuse converted indices within a frame.",
+    "GPU");
+DEFINE_bool(
+    convert_indices_on_gpu, false,
+    "Convert guest index buffers with triangle fans, line loops and quad lists "
+    "without primitive reset, and replace non-host primitive reset indices, "
+    "using compute shaders reading directly from the shared memory, instead "
+    "of reading the guest indices on the CPU, if supported by the "
+    "implementation (currently Direct3D 12 only).",
+    "GPU");
 
 namespace xe {
 namespace gpu {
@@ -109,7 +124,8 @@ bool PrimitiveProcessor::InitializeCommon(
     bool full_32bit_vertex_indices_supported, bool triangle_fans_supported,
     bool line_loops_supported, bool quad_lists_supported,
     bool point_sprites_supported_without_vs_expansion,
-    bool rectangle_lists_supported_without_vs_expansion) {
+    bool rectangle_lists_supported_without_vs_expansion,
+    bool gpu_index_conversion_supported) {
   full_32bit_vertex_indices_used_ = full_32bit_vertex_indices_supported;
   convert_triangle_fans_to_lists_ =
       !triangle_fans_supported || cvars::force_convert_triangle_fans_to_lists;
@@ -124,6 +140,9 @@ bool PrimitiveProcessor::InitializeCommon(
   expand_point_sprites_in_vs_ = !point_sprites_supported_without_vs_expansion;
   expand_rectangle_lists_in_vs_ =
       !rectangle_lists_supported_without_vs_expansion;
+  convert_indices_on_gpu_ = cvars::convert_indices_on_gpu &&
+                            gpu_index_conversion_supported &&
+                            full_32bit_vertex_indices_used_;
 
   // Initialize the index buffer for conversion of auto-indexed primitive types.
   size_t builtin_index_buffer_size = 0;
@@ -252,30 +271,75 @@ void PrimitiveProcessor::ShutdownCommon() {
                   sizeof(cache_buckets_non_empty_l1_));
       std::memset(cache_buckets_non_empty_l2_, 0,
                   sizeof(cache_buckets_non_empty_l2_));
+      persistent_index_buffers_released_.clear();
     }
     memory_.UnregisterPhysicalMemoryInvalidationCallback(
         memory_invalidation_callback_handle_);
     memory_invalidation_callback_handle_ = nullptr;
     cache_entry_pool_.clear();
   }
+  // The backend destroys the chunks themselves in its shutdown.
+  persistent_index_buffer_chunks_.clear();
+  persistent_index_buffer_chunk_current_ = UINT32_MAX;
+  persistent_index_buffer_chunks_unsupported_ = false;
 }
 
-void PrimitiveProcessor::ClearPerFrameCache() {
+void PrimitiveProcessor::ClearPerFrameCache(uint64_t frame_current,
+                                            uint64_t frame_completed) {
   if (!memory_invalidation_callback_handle_) {
     // Only do clearing if cache has ever been used.
     return;
   }
-  auto global_lock = global_critical_region_.Acquire();
-  for (const std::pair<CacheKey, size_t>& cache_map_entry : cache_map_) {
-    cache_entry_pool_[cache_map_entry.second].free_next =
-        cache_bucket_free_first_entry_;
-    cache_bucket_free_first_entry_ = cache_map_entry.second;
+  {
+    auto global_lock = global_critical_region_.Acquire();
+    if (persistent_index_buffer_chunks_.empty()) {
+      RemoveAllCacheEntries(global_lock);
+    } else {
+      // Only drop the entries referencing the buffers for the current frame.
+      cache_entries_removing_.clear();
+      for (const std::pair<CacheKey, size_t>& cache_map_entry : cache_map_) {
+        const CachedResult& result =
+            cache_entry_pool_[cache_map_entry.second].result;
+        if (result.index_buffer_type ==
+                ProcessedIndexBufferType::kHostConverted &&
+            !IsPersistentIndexBufferHandle(result.host_index_buffer_handle)) {
+          cache_entries_removing_.push_back(cache_map_entry.second);
+        }
+      }
+      for (size_t entry_index : cache_entries_removing_) {
+        RemoveCacheEntry(entry_index, global_lock);
+      }
+    }
+    persistent_index_buffers_releasing_.swap(
+        persistent_index_buffers_released_);
+  }
+  for (size_t handle : persistent_index_buffers_releasing_) {
+    PersistentIndexBufferChunk& chunk =
+        persistent_index_buffer_chunks_[GetPersistentIndexBufferChunk(handle)];
+    assert_not_zero(chunk.allocation_count);
+    --chunk.allocation_count;
+    chunk.last_release_frame = frame_current;
+  }
+  persistent_index_buffers_releasing_.clear();
+  for (PersistentIndexBufferChunk& chunk : persistent_index_buffer_chunks_) {
+    if (!chunk.allocation_count &&
+        chunk.last_release_frame <= frame_completed) {
+      chunk.used_bytes = 0;
+    }
   }
-  cache_map_.clear();
-  std::memset(cache_buckets_non_empty_l1_, 0,
-              sizeof(cache_buckets_non_empty_l1_));
-  std::memset(cache_buckets_non_empty_l2_, 0,
-              sizeof(cache_buckets_non_empty_l2_));
+}
+
+void PrimitiveProcessor::ClearCacheCommon() {
+  if (memory_invalidation_callback_handle_) {
+    auto global_lock = global_critical_region_.Acquire();
+    RemoveAllCacheEntries(global_lock);
+    persistent_index_buffers_released_.clear();
+  }
+  if (!persistent_index_buffer_chunks_.empty()) {
+    DestroyPersistentIndexBufferChunks();
+    persistent_index_buffer_chunks_.clear();
+  }
+  persistent_index_buffer_chunk_current_ = UINT32_MAX;
 }
 
 bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
@@ -436,6 +500,10 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
   }
   uint32_t line_loop_closing_index = 0;
   uint32_t guest_index_base = 0, guest_index_buffer_needed_bytes = 0;
+  GpuIndexConversion gpu_index_conversion =
+      GpuIndexConversion::kResetIndexReplace;
+  uint32_t gpu_reset_index_guest_endian = 0;
+  uint32_t gpu_index_mask_guest_endian = UINT32_MAX;
   CachedResult cacheable;
   cacheable.host_draw_vertex_count = guest_draw_vertex_count;
   cacheable.host_primitive_reset_enabled = false;
@@ -673,7 +741,54 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
         guest_index_format == xenos::IndexFormat::kInt16
             ? UINT16_MAX
             : GpuSwap(xenos::kVertexIndexMask, guest_index_endian);
-    if (host_primitive_type != guest_primitive_type) {
+    // Conversions with the output layout not depending on the index values
+    // can be done on the GPU directly from the shared memory.
+    bool convert_on_gpu = false;
+    if (convert_indices_on_gpu_) {
+      if (host_primitive_type != guest_primitive_type) {
+        convert_on_gpu =
+            guest_primitive_type == xenos::PrimitiveType::kQuadList ||
+            !guest_primitive_reset_enabled;
+      } else if (guest_primitive_reset_enabled) {
+        convert_on_gpu = guest_index_format == xenos::IndexFormat::kInt32 ||
+                         guest_primitive_reset_index_guest_endian != UINT16_MAX;
+      }
+    }
+    if (convert_on_gpu) {
+      cacheable.index_buffer_type = ProcessedIndexBufferType::kGpuConverted;
+      cacheable.host_index_format = xenos::IndexFormat::kInt32;
+      gpu_reset_index_guest_endian = 0;
+      gpu_index_mask_guest_endian = UINT32_MAX;
+      if (host_primitive_type != guest_primitive_type) {
+        cacheable.host_primitive_reset_enabled = false;
+        switch (guest_primitive_type) {
+          case xenos::PrimitiveType::kTriangleFan:
+            gpu_index_conversion = GpuIndexConversion::kTriangleFanToList;
+            cacheable.host_draw_vertex_count =
+                GetTriangleFanListIndexCount(guest_draw_vertex_count);
+            break;
+          case xenos::PrimitiveType::kLineLoop:
+            gpu_index_conversion = GpuIndexConversion::kLineLoopToStrip;
+            cacheable.host_draw_vertex_count =
+                GetLineLoopStripIndexCount(guest_draw_vertex_count);
+            break;
+          case xenos::PrimitiveType::kQuadList:
+            gpu_index_conversion = GpuIndexConversion::kQuadListToTriangleList;
+            cacheable.host_draw_vertex_count =
+                GetQuadListTriangleListIndexCount(guest_draw_vertex_count);
+            break;
+          default:
+            assert_unhandled_case(guest_primitive_type);
+            return false;
+        }
+      } else {
+        gpu_index_conversion = GpuIndexConversion::kResetIndexReplace;
+        cacheable.host_draw_vertex_count = guest_draw_vertex_count;
+        cacheable.host_primitive_reset_enabled = true;
+        gpu_reset_index_guest_endian = guest_primitive_reset_index_guest_endian;
+        gpu_index_mask_guest_endian = guest_index_mask_guest_endian;
+      }
+    } else if (host_primitive_type != guest_primitive_type) {
       // Already converting to a different index type - primitive reset is
       // performed during conversion here. Also doing the endian swap here for
       // hosts not supporting 32-bit indices because indirection is only used
@@ -735,9 +850,10 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
                 0, guest_draw_vertex_count, cacheable.host_draw_vertex_count);
           }
           auto host_indices = reinterpret_cast<uint16_t*>(
-              RequestHostConvertedIndexBufferForCurrentFrame(
-                  xenos::IndexFormat::kInt16, cacheable.host_draw_vertex_count,
-                  false, guest_index_base, cacheable.host_index_buffer_handle));
+              RequestCachedHostConvertedIndexBuffer(
+                  cache_transaction, xenos::IndexFormat::kInt16,
+                  cacheable.host_draw_vertex_count, false, guest_index_base,
+                  cacheable.host_index_buffer_handle));
           if (!host_indices) {
             return false;
           }
@@ -769,9 +885,10 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
                 0, guest_draw_vertex_count, cacheable.host_draw_vertex_count);
           }
           auto host_indices = reinterpret_cast<uint32_t*>(
-              RequestHostConvertedIndexBufferForCurrentFrame(
-                  xenos::IndexFormat::kInt32, cacheable.host_draw_vertex_count,
-                  false, guest_index_base, cacheable.host_index_buffer_handle));
+              RequestCachedHostConvertedIndexBuffer(
+                  cache_transaction, xenos::IndexFormat::kInt32,
+                  cacheable.host_draw_vertex_count, false, guest_index_base,
+                  cacheable.host_index_buffer_handle));
           if (!host_indices) {
             return false;
           }
@@ -867,11 +984,10 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
                 cacheable.host_index_format = is_ffff_used_as_vertex_index
                                                   ? xenos::IndexFormat::kInt32
                                                   : xenos::IndexFormat::kInt16;
-                void* host_indices_ptr =
-                    RequestHostConvertedIndexBufferForCurrentFrame(
-                        cacheable.host_index_format, guest_draw_vertex_count,
-                        true, guest_index_base,
-                        cacheable.host_index_buffer_handle);
+                void* host_indices_ptr = RequestCachedHostConvertedIndexBuffer(
+                    cache_transaction, cacheable.host_index_format,
+                    guest_draw_vertex_count, true, guest_index_base,
+                    cacheable.host_index_buffer_handle);
                 if (!host_indices_ptr) {
                   return false;
                 }
@@ -920,9 +1036,10 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
               cacheable.index_buffer_type =
                   ProcessedIndexBufferType::kHostConverted;
               auto host_indices = reinterpret_cast<uint32_t*>(
-                  RequestHostConvertedIndexBufferForCurrentFrame(
-                      xenos::IndexFormat::kInt32, guest_draw_vertex_count, true,
-                      guest_index_base, cacheable.host_index_buffer_handle));
+                  RequestCachedHostConvertedIndexBuffer(
+                      cache_transaction, xenos::IndexFormat::kInt32,
+                      guest_draw_vertex_count, true, guest_index_base,
+                      cacheable.host_index_buffer_handle));
               if (!host_indices) {
                 return false;
               }
@@ -966,7 +1083,8 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
   // there on the GPU.
   if (cacheable.index_buffer_type == ProcessedIndexBufferType::kGuestDMA ||
       cacheable.index_buffer_type ==
-          ProcessedIndexBufferType::kHostBuiltinForDMA) {
+          ProcessedIndexBufferType::kHostBuiltinForDMA ||
+      cacheable.index_buffer_type == ProcessedIndexBufferType::kGpuConverted) {
     // Request the index buffer memory.
     // TODO(Triang3l): Shared memory request cache.
     if (!shared_memory_.RequestRange(guest_index_base,
@@ -992,6 +1110,11 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
   result_out.host_primitive_reset_enabled =
       cacheable.host_primitive_reset_enabled;
   result_out.host_index_buffer_handle = cacheable.host_index_buffer_handle;
+  result_out.gpu_index_conversion = gpu_index_conversion;
+  result_out.guest_index_format = vgt_draw_initiator.index_size;
+  result_out.guest_index_count = guest_draw_vertex_count;
+  result_out.gpu_reset_index_guest_endian = gpu_reset_index_guest_endian;
+  result_out.gpu_index_mask_guest_endian = gpu_index_mask_guest_endian;
   return true;
 }
 
@@ -1465,6 +1588,13 @@ PrimitiveProcessor::CacheTransaction::~CacheTransaction() {
   processor_.cache_currently_processing_base_ = 0;
   processor_.cache_currently_processing_size_bytes_ = 0;
 
+  if (result_type_ != ResultType::kNewSet &&
+      persistent_index_buffer_handle_ != SIZE_MAX) {
+    // Processing has failed after allocating the memory.
+    processor_.persistent_index_buffers_released_.push_back(
+        persistent_index_buffer_handle_);
+  }
+
   if (result_type_ == ResultType::kNewSet) {
     size_t new_entry_index;
     if (processor_.cache_bucket_free_first_entry_ != SIZE_MAX) {
@@ -1516,6 +1646,179 @@ PrimitiveProcessor::CacheTransaction::~CacheTransaction() {
   }
 }
 
+bool PrimitiveProcessor::IsPersistentIndexBufferCacheEnabled() const {
+  return cvars::primitive_processor_persistent_cache_mb &&
+         !persistent_index_buffer_chunks_unsupported_;
+}
+
+void* PrimitiveProcessor::RequestCachedHostConvertedIndexBuffer(
+    CacheTransaction& cache_transaction, xenos::IndexFormat format,
+    uint32_t index_count, bool coalign_for_simd,
+    uint32_t coalignment_original_address, size_t& backend_handle_out) {
+  uint32_t index_size = format == xenos::IndexFormat::kInt16
+                            ? uint32_t(sizeof(uint16_t))
+                            : uint32_t(sizeof(uint32_t));
+  uint32_t size_bytes =
+      index_size * index_count +
+      (coalign_for_simd ? uint32_t(XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE) : 0);
+  if (!cache_transaction.IsStoringNewResult() ||
+      !IsPersistentIndexBufferCacheEnabled() ||
+      size_bytes > kPersistentIndexBufferChunkSize) {
+    return RequestHostConvertedIndexBufferForCurrentFrame(
+        format, index_count, coalign_for_simd, coalignment_original_address,
+        backend_handle_out);
+  }
+
+  uint32_t offset = 0;
+  if (persistent_index_buffer_chunk_current_ != UINT32_MAX) {
+    offset = xe::align(
+        persistent_index_buffer_chunks_[persistent_index_buffer_chunk_current_]
+            .used_bytes,
+        index_size);
+    if (kPersistentIndexBufferChunkSize - offset < size_bytes) {
+      persistent_index_buffer_chunk_current_ = UINT32_MAX;
+    }
+  }
+  if (persistent_index_buffer_chunk_current_ == UINT32_MAX) {
+    offset = 0;
+    // Take a chunk with all allocations reclaimed, or create a new one.
+    for (size_t i = 0; i < persistent_index_buffer_chunks_.size(); ++i) {
+      if (!persistent_index_buffer_chunks_[i].used_bytes) {
+        persistent_index_buffer_chunk_current_ = uint32_t(i);
+        break;
+      }
+    }
+    if (persistent_index_buffer_chunk_current_ == UINT32_MAX) {
+      uint64_t chunks_max =
+          (uint64_t(cvars::primitive_processor_persistent_cache_mb) << 20) >>
+          kPersistentIndexBufferChunkSizeLog2;
+      if (persistent_index_buffer_chunks_.size() >= chunks_max) {
+        return RequestHostConvertedIndexBufferForCurrentFrame(
+            format, index_count, coalign_for_simd,
+            coalignment_original_address, backend_handle_out);
+      }
+      uint32_t new_chunk_index =
+          uint32_t(persistent_index_buffer_chunks_.size());
+      void* new_chunk_mapping =
+          CreatePersistentIndexBufferChunk(new_chunk_index);
+      if (!new_chunk_mapping) {
+        if (persistent_index_buffer_chunks_.empty()) {
+          persistent_index_buffer_chunks_unsupported_ = true;
+        }
+        return RequestHostConvertedIndexBufferForCurrentFrame(
+            format, index_count, coalign_for_simd,
+            coalignment_original_address, backend_handle_out);
+      }
+      PersistentIndexBufferChunk& new_chunk =
+          persistent_index_buffer_chunks_.emplace_back();
+      new_chunk.mapping = reinterpret_cast<uint8_t*>(new_chunk_mapping);
+      new_chunk.used_bytes = 0;
+      new_chunk.allocation_count = 0;
+      new_chunk.last_release_frame = 0;
+      persistent_index_buffer_chunk_current_ = new_chunk_index;
+    }
+  }
+
+  PersistentIndexBufferChunk& chunk =
+      persistent_index_buffer_chunks_[persistent_index_buffer_chunk_current_];
+  uint8_t* mapping = chunk.mapping + offset;
+  PersistentIndexBufferChunkWritten(persistent_index_buffer_chunk_current_,
+                                    offset, size_bytes);
+  chunk.used_bytes = offset + size_bytes;
+  ++chunk.allocation_count;
+  if (coalign_for_simd) {
+    ptrdiff_t coalignment_offset =
+        GetSimdCoalignmentOffset(mapping, coalignment_original_address);
+    mapping += coalignment_offset;
+    offset += uint32_t(coalignment_offset);
+  }
+  backend_handle_out =
+      kPersistentIndexBufferHandleFlag |
+      (size_t(persistent_index_buffer_chunk_current_)
+       << kPersistentIndexBufferChunkSizeLog2) |
+      offset;
+  cache_transaction.persistent_index_buffer_handle_ = backend_handle_out;
+  return mapping;
+}
+
+void PrimitiveProcessor::RemoveCacheEntry(
+    size_t entry_index, const global_unique_lock_type& global_lock) {
+  CacheEntry& entry = cache_entry_pool_[entry_index];
+  CacheKey entry_key = entry.key;
+  // Remove the entry from the cache map.
+  auto entry_map_it = cache_map_.find(entry_key);
+  assert_true(entry_map_it != cache_map_.end());
+  if (entry_map_it != cache_map_.end()) {
+    cache_map_.erase(entry_map_it);
+  }
+  if (entry.result.index_buffer_type ==
+          ProcessedIndexBufferType::kHostConverted &&
+      IsPersistentIndexBufferHandle(entry.result.host_index_buffer_handle)) {
+    persistent_index_buffers_released_.push_back(
+        entry.result.host_index_buffer_handle);
+  }
+  // Unlink the entry from the bucket's list.
+  uint32_t entry_bucket_index_first =
+      entry_key.base >> kCacheBucketSizeBytesLog2;
+  uint32_t entry_link_index_last =
+      ((entry_key.base + entry_key.GetSizeBytes() - 1) >>
+       kCacheBucketSizeBytesLog2) -
+      entry_bucket_index_first;
+  assert_true(entry_link_index_last <= 1,
+              "Cache entries only store list links within two buckets");
+  for (uint32_t entry_link_index = 0;
+       entry_link_index <= entry_link_index_last; ++entry_link_index) {
+    uint32_t entry_bucket_index = entry_bucket_index_first + entry_link_index;
+    size_t entry_link_prev = entry.buckets_prev[entry_link_index];
+    size_t entry_link_next = entry.buckets_next[entry_link_index];
+    if (entry_link_prev != SIZE_MAX) {
+      CacheEntry& entry_prev = cache_entry_pool_[entry_link_prev];
+      entry_prev.buckets_next[size_t(
+          (entry_prev.key.base >> kCacheBucketSizeBytesLog2) !=
+          entry_bucket_index)] = entry_link_next;
+    } else {
+      if (entry_link_next != SIZE_MAX) {
+        cache_bucket_first_entries_[entry_bucket_index] = entry_link_next;
+      } else {
+        // The only entry that was remaining in the bucket - it's empty now.
+        cache_buckets_non_empty_l1_[entry_bucket_index >> 6] &=
+            ~(uint64_t(1) << (entry_bucket_index & 63));
+        UpdateCacheBucketsNonEmptyL2(entry_bucket_index >> 6, global_lock);
+      }
+    }
+    if (entry_link_next != SIZE_MAX) {
+      CacheEntry& entry_next = cache_entry_pool_[entry_link_next];
+      entry_next.buckets_prev[size_t(
+          (entry_next.key.base >> kCacheBucketSizeBytesLog2) !=
+          entry_bucket_index)] = entry_link_prev;
+    }
+  }
+  // Make the entry free for reuse.
+  entry.free_next = cache_bucket_free_first_entry_;
+  cache_bucket_free_first_entry_ = entry_index;
+}
+
+void PrimitiveProcessor::RemoveAllCacheEntries(
+    [[maybe_unused]] const global_unique_lock_type& global_lock) {
+  for (const std::pair<CacheKey, size_t>& cache_map_entry : cache_map_) {
+    const CachedResult& result =
+        cache_entry_pool_[cache_map_entry.second].result;
+    if (result.index_buffer_type == ProcessedIndexBufferType::kHostConverted &&
+        IsPersistentIndexBufferHandle(result.host_index_buffer_handle)) {
+      persistent_index_buffers_released_.push_back(
+          result.host_index_buffer_handle);
+    }
+    cache_entry_pool_[cache_map_entry.second].free_next =
+        cache_bucket_free_first_entry_;
+    cache_bucket_free_first_entry_ = cache_map_entry.second;
+  }
+  cache_map_.clear();
+  std::memset(cache_buckets_non_empty_l1_, 0,
+              sizeof(cache_buckets_non_empty_l1_));
+  std::memset(cache_buckets_non_empty_l2_, 0,
+              sizeof(cache_buckets_non_empty_l2_));
+}
+
 std::pair<uint32_t, uint32_t> PrimitiveProcessor::MemoryInvalidationCallback(
     uint32_t physical_address_start, uint32_t length, bool exact_range) {
   if (length == 0 || physical_address_start >= SharedMemory::kBufferSize) {
@@ -1613,54 +1916,7 @@ std::pair<uint32_t, uint32_t> PrimitiveProcessor::MemoryInvalidationCallback(
             if (entry_end > physical_address_end) {
               // Invalidate the entry.
               any_invalidated = true;
-              // Remove the entry from the cache map.
-              auto entry_map_it = cache_map_.find(entry_key);
-              assert_true(entry_map_it != cache_map_.end());
-              if (entry_map_it != cache_map_.end()) {
-                cache_map_.erase(entry_map_it);
-              }
-              // Unlink the entry from the bucket's list.
-              uint32_t entry_link_index_last =
-                  ((entry_end - 1) >> kCacheBucketSizeBytesLog2) -
-                  entry_bucket_index_first;
-              assert_true(
-                  entry_link_index_last <= 1,
-                  "Cache entries only store list links within two buckets");
-              for (uint32_t entry_link_index = 0;
-                   entry_link_index <= entry_link_index_last;
-                   ++entry_link_index) {
-                uint32_t entry_bucket_index =
-                    entry_bucket_index_first + entry_link_index;
-                size_t entry_link_prev = entry.buckets_prev[entry_link_index];
-                size_t entry_link_next = entry.buckets_next[entry_link_index];
-                if (entry_link_prev != SIZE_MAX) {
-                  CacheEntry& entry_prev = cache_entry_pool_[entry_link_prev];
-                  entry_prev.buckets_next[size_t(
-                      (entry_prev.key.base >> kCacheBucketSizeBytesLog2) !=
-                      entry_bucket_index)] = entry_link_next;
-                } else {
-                  if (entry_link_next != SIZE_MAX) {
-                    cache_bucket_first_entries_[entry_bucket_index] =
-                        entry_link_next;
-                  } else {
-                    // The only entry that was remaining in the bucket - it's
-                    // empty now.
-                    cache_buckets_non_empty_l1_[entry_bucket_index >> 6] &=
-                        ~(uint64_t(1) << (entry_bucket_index & 63));
-                    UpdateCacheBucketsNonEmptyL2(entry_bucket_index >> 6,
-                                                 global_lock);
-                  }
-                }
-                if (entry_link_next != SIZE_MAX) {
-                  CacheEntry& entry_next = cache_entry_pool_[entry_link_next];
-                  entry_next.buckets_prev[size_t(
-                      (entry_next.key.base >> kCacheBucketSizeBytesLog2) !=
-                      entry_bucket_index)] = entry_link_prev;
-                }
-              }
-              // Make the entry free for reuse.
-              entry.free_next = cache_bucket_free_first_entry_;
-              cache_bucket_free_first_entry_ = entry_index;
+              RemoveCacheEntry(entry_index, global_lock);
             }
           }
           entry_index = next_entry_index;
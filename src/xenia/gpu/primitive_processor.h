@@ -20,6 +20,7 @@
 #include <mutex>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/cvar.h"
@@ -121,6 +122,23 @@ class PrimitiveProcessor {
     // Adapter index buffer on the host for indirect loading of indices via DMA
     // (from the shared memory).
     kHostBuiltinForDMA,
+    // Converted by the backend on the GPU, for the current draw command, from
+    // the guest indices in the shared memory, as specified by
+    // gpu_index_conversion. Always 32-bit on the host, with the guest endian.
+    kGpuConverted,
+  };
+
+  // Index processing done on the GPU for ProcessedIndexBufferType
+  // kGpuConverted - the guest indices are not read on the CPU at all.
+  enum class GpuIndexConversion : uint32_t {
+    // Without primitive reset.
+    kTriangleFanToList,
+    // Without primitive reset.
+    kLineLoopToStrip,
+    kQuadListToTriangleList,
+    // Replacing the masked guest reset index with 0xFFFFFFFF, and storing the
+    // masked index otherwise.
+    kResetIndexReplace,
   };
 
   struct ProcessingResult {
@@ -149,6 +167,13 @@ class PrimitiveProcessor {
     // only valid for index_buffer_type kHostConverted, kHostBuiltinForAuto and
     // kHostBuiltinForDMA.
     size_t host_index_buffer_handle;
+    // Only valid for index_buffer_type kGpuConverted.
+    GpuIndexConversion gpu_index_conversion;
+    xenos::IndexFormat guest_index_format;
+    uint32_t guest_index_count;
+    // For kResetIndexReplace.
+    uint32_t gpu_reset_index_guest_endian;
+    uint32_t gpu_index_mask_guest_endian;
     bool IsTessellated() const {
       return Shader::IsHostVertexShaderTypeDomain(host_vertex_shader_type);
     }
@@ -176,6 +201,7 @@ class PrimitiveProcessor {
   bool IsExpandingRectangleListsInVS() const {
     return expand_rectangle_lists_in_vs_;
   }
+  bool IsConvertingIndicesOnGpu() const { return convert_indices_on_gpu_; }
 
   // Submission must be open to call (may request the index buffer in the shared
   // memory).
@@ -253,11 +279,16 @@ class PrimitiveProcessor {
   //     emulation. Overrides do not apply to these as hosts are not required to
   //     support the fallback paths since they require different vertex shader
   //     structure (for the fallback HostVertexShaderTypes).
+  // - gpu_index_conversion_supported:
+  //   - Pass true if the backend can perform the GpuIndexConversions for
+  //     ProcessedIndexBufferType kGpuConverted with compute shaders. Only used
+  //     with full 32-bit vertex indices, as the indices are not pre-swapped.
   bool InitializeCommon(bool full_32bit_vertex_indices_supported,
                         bool triangle_fans_supported, bool line_loops_supported,
                         bool quad_lists_supported,
                         bool point_sprites_supported_without_vs_expansion,
-                        bool rectangle_lists_supported_without_vs_expansion);
+                        bool rectangle_lists_supported_without_vs_expansion,
+                        bool gpu_index_conversion_supported = false);
   // If any primitive type conversion is needed for auto-indexed draws, called
   // from InitializeCommon (thus only once in the primitive processor's
   // lifetime) to set up the backend's index buffer containing indices for
@@ -272,8 +303,15 @@ class PrimitiveProcessor {
 
   // Call at boundaries of lifespans of converted data (between frames,
   // preferably in the end of a frame so between the swap and the next draw,
-  // access violation handlers need to do less work).
-  void ClearPerFrameCache();
+  // access violation handlers need to do less work). Entries with indices in
+  // persistent index buffer chunks are kept until the guest memory is written,
+  // and chunks with all allocations released before frame_completed are
+  // reused.
+  void ClearPerFrameCache(uint64_t frame_current, uint64_t frame_completed);
+  // Call in the implementation-specific ClearCache when the GPU isn't using
+  // any of the converted index buffers - drops all cache entries and destroys
+  // the persistent index buffer chunks.
+  void ClearCacheCommon();
 
   static constexpr size_t GetBuiltinIndexBufferOffsetBytes(size_t handle) {
     // For simplicity, just using the handles as byte offsets.
@@ -316,6 +354,40 @@ class PrimitiveProcessor {
       xenos::IndexFormat format, uint32_t index_count, bool coalign_for_simd,
       uint32_t coalignment_original_address, size_t& backend_handle_out) = 0;
 
+  // Converted indices stored in the cache across frames are placed in chunks
+  // of host-visible memory usable as index buffers, created by the backend,
+  // and suballocated here. Their backend handles have
+  // kPersistentIndexBufferHandleFlag set, and contain the chunk index and the
+  // offset in the chunk.
+  static constexpr uint32_t kPersistentIndexBufferChunkSizeLog2 = 22;
+  static constexpr uint32_t kPersistentIndexBufferChunkSize =
+      uint32_t(1) << kPersistentIndexBufferChunkSizeLog2;
+  static constexpr size_t kPersistentIndexBufferHandleFlag =
+      size_t(1) << (sizeof(size_t) * CHAR_BIT - 1);
+  static bool IsPersistentIndexBufferHandle(size_t handle) {
+    return (handle & kPersistentIndexBufferHandleFlag) != 0;
+  }
+  static uint32_t GetPersistentIndexBufferChunk(size_t handle) {
+    return uint32_t((handle & ~kPersistentIndexBufferHandleFlag) >>
+                    kPersistentIndexBufferChunkSizeLog2);
+  }
+  static uint32_t GetPersistentIndexBufferOffset(size_t handle) {
+    return uint32_t(handle & (kPersistentIndexBufferChunkSize - 1));
+  }
+  // Creates a buffer of kPersistentIndexBufferChunkSize bytes with the index
+  // chunk_index (chunks are created in ascending order without gaps), returns
+  // its mapping, or nullptr if failed or not supported by the backend.
+  virtual void* CreatePersistentIndexBufferChunk(uint32_t chunk_index) {
+    return nullptr;
+  }
+  // Called when a range in a chunk is going to be written for use in the
+  // current submission.
+  virtual void PersistentIndexBufferChunkWritten(uint32_t chunk_index,
+                                                 uint32_t offset,
+                                                 uint32_t length) {}
+  // Called from ClearCacheCommon to destroy all the chunks.
+  virtual void DestroyPersistentIndexBufferChunks() {}
+
  private:
 #if XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
 #if XE_ARCH_AMD64
@@ -701,6 +773,7 @@ class PrimitiveProcessor {
   bool convert_quad_lists_to_triangle_lists_ = false;
   bool expand_point_sprites_in_vs_ = false;
   bool expand_rectangle_lists_in_vs_ = false;
+  bool convert_indices_on_gpu_ = false;
 
   // Byte offsets used, for simplicity, directly as handles.
   size_t builtin_ib_offset_two_triangle_strips_ = SIZE_MAX;
@@ -831,6 +904,10 @@ class PrimitiveProcessor {
     const CachedResult* GetFoundResult() const {
       return result_type_ == ResultType::kExisting ? &result_ : nullptr;
     }
+    // Whether the new result will be stored in the cache.
+    bool IsStoringNewResult() const {
+      return key_.count && result_type_ != ResultType::kExisting;
+    }
     void SetNewResult(const CachedResult& new_result) {
       // Replacement of an existing entry is not allowed.
       assert_true(result_type_ != ResultType::kExisting);
@@ -853,8 +930,42 @@ class PrimitiveProcessor {
       kExisting,
     };
     ResultType result_type_ = ResultType::kNewUnset;
+    // If an allocation has been made in a persistent index buffer chunk, but
+    // the result hasn't been set, it needs to be released.
+    size_t persistent_index_buffer_handle_ = SIZE_MAX;
+
+    friend class PrimitiveProcessor;
   };
 
+  // Requests the memory for indices that will be stored in the cache in the
+  // transaction - in a persistent index buffer chunk if possible, in the
+  // buffer for the current frame otherwise.
+  void* RequestCachedHostConvertedIndexBuffer(
+      CacheTransaction& cache_transaction, xenos::IndexFormat format,
+      uint32_t index_count, bool coalign_for_simd,
+      uint32_t coalignment_original_address, size_t& backend_handle_out);
+  bool IsPersistentIndexBufferCacheEnabled() const;
+
+  struct PersistentIndexBufferChunk {
+    uint8_t* mapping;
+    uint32_t used_bytes;
+    uint32_t allocation_count;
+    // The last frame when an allocation in the chunk was released (thus, the
+    // last frame when the GPU may have used it).
+    uint64_t last_release_frame;
+  };
+  // Accessed only by the processor.
+  std::vector<PersistentIndexBufferChunk> persistent_index_buffer_chunks_;
+  uint32_t persistent_index_buffer_chunk_current_ = UINT32_MAX;
+  bool persistent_index_buffer_chunks_unsupported_ = false;
+  // Handles of persistent index buffer allocations of removed cache entries,
+  // released by the processor in ClearPerFrameCache.
+  // Modified by both the processor and the invalidation callback.
+  std::vector<size_t> persistent_index_buffers_released_;
+  // Scratch vectors used by the processor.
+  std::vector<size_t> persistent_index_buffers_releasing_;
+  std::vector<size_t> cache_entries_removing_;
+
   std::deque<CacheEntry> cache_entry_pool_;
 
   void* memory_invalidation_callback_handle_ = nullptr;
@@ -880,6 +991,12 @@ class PrimitiveProcessor {
   // Modified by both the processor and the invalidation callback.
   uint64_t cache_buckets_non_empty_l2_[(kCacheBucketCount + (64 * 64 - 1)) /
                                        (64 * 64)] = {};
+  // Unlinks the entry from the buckets and the cache map, and frees it. Must be
+  // called in a global critical region.
+  void RemoveCacheEntry(size_t entry_index,
+                        const global_unique_lock_type& global_lock);
+  // Frees all entries. Must be called in a global critical region.
+  void RemoveAllCacheEntries(const global_unique_lock_type& global_lock);
   // Must be called in a global critical region.
   void UpdateCacheBucketsNonEmptyL2(
       uint32_t bucket_index_div_64,
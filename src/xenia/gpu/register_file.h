@@ -40,6 +40,15 @@ class RegisterFile {
   static constexpr size_t kRegisterCount = 0x5003;
   uint32_t values[kRegisterCount];
 
+  // Writes are tracked in blocks of 16 registers (4 float constants), so range
+  // writes only need to set a few bits, and the consumers of the registers,
+  // such as the constant buffer upload, can skip the blocks that haven't been
+  // written since they last cleared them.
+  static constexpr uint32_t kDirtyBlockSizeLog2 = 4;
+  static constexpr uint32_t kDirtyBlockCount =
+      (kRegisterCount + (1 << kDirtyBlockSizeLog2) - 1) >> kDirtyBlockSizeLog2;
+  uint64_t dirty_blocks[(kDirtyBlockCount + 63) >> 6];
+
   const uint32_t& operator[](uint32_t reg) const { return values[reg]; }
   uint32_t& operator[](uint32_t reg) { return values[reg]; }
 
@@ -56,6 +65,47 @@ class RegisterFile {
     return Get<T>(T::register_index);
   }
 
+  void MarkDirty(uint32_t reg) {
+    uint32_t block = reg >> kDirtyBlockSizeLog2;
+    dirty_blocks[block >> 6] |= uint64_t(1) << (block & 63);
+  }
+  void MarkRangeDirty(uint32_t first_reg, uint32_t count) {
+    if (!count) {
+      return;
+    }
+    ModifyDirtyBlocks(first_reg, count, true);
+  }
+  // Clears all the blocks overlapping the range, including partially.
+  void ClearRangeDirty(uint32_t first_reg, uint32_t count) {
+    if (!count) {
+      return;
+    }
+    ModifyDirtyBlocks(first_reg, count, false);
+  }
+  bool IsRangeDirty(uint32_t first_reg, uint32_t count) const {
+    if (!count) {
+      return false;
+    }
+    uint32_t block_first = first_reg >> kDirtyBlockSizeLog2;
+    uint32_t block_last = (first_reg + count - 1) >> kDirtyBlockSizeLog2;
+    for (uint32_t i = block_first >> 6; i <= block_last >> 6; ++i) {
+      if (dirty_blocks[i] & GetDirtyWordMask(i, block_first, block_last)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Copies big-endian values from the command buffer or memory without any
+  // handling of the special registers.
+  void WriteRangeFromGuest(uint32_t first_reg, const uint32_t* source,
+                           uint32_t count) {
+    assert_true(first_reg <= kRegisterCount &&
+                kRegisterCount - first_reg >= count);
+    xe::copy_and_swap_32_unaligned(&values[first_reg], source, count);
+    MarkRangeDirty(first_reg, count);
+  }
+
   xenos::xe_gpu_vertex_fetch_t GetVertexFetch(uint32_t index) const {
     assert_true(index < 96);
     xenos::xe_gpu_vertex_fetch_t fetch;
@@ -86,6 +136,31 @@ class RegisterFile {
         sizeof(stream));
     return stream;
   }
+
+ private:
+  static uint64_t GetDirtyWordMask(uint32_t word, uint32_t block_first,
+                                   uint32_t block_last) {
+    uint64_t mask = UINT64_MAX;
+    if (word == block_first >> 6) {
+      mask &= UINT64_MAX << (block_first & 63);
+    }
+    if (word == block_last >> 6) {
+      mask &= UINT64_MAX >> (63 - (block_last & 63));
+    }
+    return mask;
+  }
+  void ModifyDirtyBlocks(uint32_t first_reg, uint32_t count, bool dirty) {
+    uint32_t block_first = first_reg >> kDirtyBlockSizeLog2;
+    uint32_t block_last = (first_reg + count - 1) >> kDirtyBlockSizeLog2;
+    for (uint32_t i = block_first >> 6; i <= block_last >> 6; ++i) {
+      uint64_t mask = GetDirtyWordMask(i, block_first, block_last);
+      if (dirty) {
+        dirty_blocks[i] |= mask;
+      } else {
+        dirty_blocks[i] &= ~mask;
+      }
+    }
+  }
 };
 
 }  // namespace gpu
@@ -18,9 +18,12 @@
 #include <utility>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
+#include "xenia/base/profiling.h"
 #include "xenia/gpu/draw_util.h"
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/registers.h"
@@ -203,10 +206,38 @@ DEFINE_bool(
     "If this is enabled, excessive barriers may be eliminated when switching "
     "between different render targets in separate EDRAM locations.",
     "GPU");
+DEFINE_bool(
+    elide_unmodified_render_target_transfers, true,
+    "Skip copying EDRAM data back to a host render target if the data has "
+    "only been read by other render targets (depth / stencil testing without "
+    "writing) since it was transferred from it, so it still contains the "
+    "latest data.",
+    "GPU");
+DEFINE_bool(
+    log_render_target_transfers, false,
+    "Log the number, the size and the formats of the ownership transfers "
+    "between host render targets in each frame.",
+    "GPU");
+DEFINE_uint32(
+    render_target_unused_lifetime, 30,
+    "Seconds after which a host render target that doesn't hold any of the "
+    "latest EDRAM data anymore is destroyed to free the host GPU memory, "
+    "which is especially significant with draw_resolution_scale_x/y, or 0 to "
+    "keep all host render targets until the caches are cleared. A smaller "
+    "value reduces memory usage, but may cause render targets to be recreated "
+    "more often.",
+    "GPU");
 
 namespace xe {
 namespace gpu {
 
+static xe::counters::Counter& render_target_transfers_counter =
+    xe::counters::GetCounter("gpu/render_target_cache/transfers");
+static xe::counters::Counter& render_target_transfer_bytes_counter =
+    xe::counters::GetCounter("gpu/render_target_cache/transfer_bytes");
+static xe::counters::Counter& render_target_evictions_counter =
+    xe::counters::GetCounter("gpu/render_target_cache/evictions");
+
 void RenderTargetCache::GetPSIColorFormatInfo(
     xenos::ColorRenderTargetFormat format, uint32_t write_mask,
     float& clamp_rgb_low, float& clamp_alpha_low, float& clamp_rgb_high,
@@ -536,20 +567,7 @@ void RenderTargetCache::ClearCache() {
   if (!render_targets_.empty()) {
     std::unordered_set<RenderTargetKey, RenderTargetKey::Hasher>
         used_render_targets;
-    for (const auto& ownership_range_pair : ownership_ranges_) {
-      const OwnershipRange& ownership_range = ownership_range_pair.second;
-      if (!ownership_range.render_target.IsEmpty()) {
-        used_render_targets.emplace(ownership_range.render_target);
-      }
-      if (!ownership_range.host_depth_render_target_unorm24.IsEmpty()) {
-        used_render_targets.emplace(
-            ownership_range.host_depth_render_target_unorm24);
-      }
-      if (!ownership_range.host_depth_render_target_float24.IsEmpty()) {
-        used_render_targets.emplace(
-            ownership_range.host_depth_render_target_float24);
-      }
-    }
+    GetEdramOwningRenderTargets(used_render_targets);
     if (render_targets_.size() != used_render_targets.size()) {
       typename decltype(render_targets_)::iterator it_next;
       for (auto it = render_targets_.begin(); it != render_targets_.end();
@@ -569,7 +587,42 @@ void RenderTargetCache::ClearCache() {
   }
 }
 
-void RenderTargetCache::BeginFrame() { ResetAccumulatedRenderTargets(); }
+void RenderTargetCache::BeginFrame() {
+  if (GetPath() == Path::kHostRenderTargets) {
+    COUNT_profile_set("gpu/render_target_cache/transfers",
+                      frame_transfer_count_);
+    COUNT_profile_set("gpu/render_target_cache/transfer_kb",
+                      uint32_t(frame_transfer_bytes_ >> 10));
+    COUNT_profile_set("gpu/render_target_cache/elided_transfers",
+                      frame_elided_transfer_count_);
+    COUNT_profile_set("gpu/render_target_cache/elided_transfer_kb",
+                      uint32_t(frame_elided_transfer_bytes_ >> 10));
+    if (cvars::log_render_target_transfers &&
+        (frame_transfer_count_ || frame_elided_transfer_count_)) {
+      XELOGI(
+          "Render target ownership transfers in the frame: {} ({} KB), {} "
+          "elided ({} KB)",
+          frame_transfer_count_, frame_transfer_bytes_ >> 10,
+          frame_elided_transfer_count_, frame_elided_transfer_bytes_ >> 10);
+      for (const auto& format_count : frame_transfer_format_counts_) {
+        RenderTargetKey source_format, dest_format;
+        source_format.is_depth = format_count.first.first >> 4;
+        source_format.resource_format = format_count.first.first & 0xF;
+        dest_format.is_depth = format_count.first.second >> 4;
+        dest_format.resource_format = format_count.first.second & 0xF;
+        XELOGI("  {} -> {}: {}", source_format.GetFormatName(),
+               dest_format.GetFormatName(), format_count.second);
+      }
+    }
+  }
+  frame_transfer_count_ = 0;
+  frame_elided_transfer_count_ = 0;
+  frame_transfer_bytes_ = 0;
+  frame_elided_transfer_bytes_ = 0;
+  frame_transfer_format_counts_.clear();
+
+  ResetAccumulatedRenderTargets();
+}
 
 bool RenderTargetCache::Update(bool is_rasterization_done,
                                reg::RB_DEPTHCONTROL normalized_depth_control,
@@ -882,13 +935,19 @@ bool RenderTargetCache::Update(bool is_rasterization_done,
   // draw with whatever contents currently are in the render target in this
   // case).
 
+  // If depth / stencil is only tested, but not written, the previous owners
+  // of the range will still have the latest data after the draw.
+  bool depth_read_only = !interlock_barrier_only &&
+                         !normalized_depth_control.z_write_enable &&
+                         !normalized_depth_control.stencil_enable;
   for (uint32_t i = 0; i < edram_bases_sorted_count; ++i) {
     const std::pair<uint32_t, uint32_t>& rt_base_index = edram_bases_sorted[i];
     uint32_t rt_bit_index = rt_base_index.second;
     ChangeOwnership(rt_keys[rt_bit_index], 0, rt_lengths_tiles[i],
                     interlock_barrier_only
                         ? nullptr
-                        : &last_update_transfers_[rt_bit_index]);
+                        : &last_update_transfers_[rt_bit_index],
+                    nullptr, rt_bit_index == 0 && depth_read_only);
   }
 
   if (interlock_barrier_only) {
@@ -1408,6 +1467,9 @@ RenderTargetCache::PrepareFullEdram1280xRenderTargetForSnapshotRestoration(
   }
   // Change ownership, but don't transfer the contents - they will be replaced
   // anyway.
+  for (const auto& ownership_range_pair : ownership_ranges_) {
+    MarkOwnersAsUsed(ownership_range_pair.second);
+  }
   ownership_ranges_.clear();
   ownership_ranges_.emplace(
       std::piecewise_construct, std::forward_as_tuple(uint32_t(0)),
@@ -1436,6 +1498,109 @@ void RenderTargetCache::PixelShaderInterlockFullEdramBarrierPlaced() {
   ownership_ranges_.emplace(0, empty_range);
 }
 
+void RenderTargetCache::DestroyUnusedRenderTargets(
+    uint64_t completed_submission,
+    std::vector<RenderTargetKey>& destroyed_keys_out) {
+  destroyed_keys_out.clear();
+  uint64_t lifetime_ms = uint64_t(cvars::render_target_unused_lifetime) * 1000;
+  if (!lifetime_ms || render_targets_.empty()) {
+    return;
+  }
+  uint64_t current_time = xe::Clock::QueryHostUptimeMillis();
+  // Not checking the ownership of every render target each frame if none of
+  // them may be old enough anyway.
+  if (current_time < render_targets_next_eviction_check_time_) {
+    return;
+  }
+  render_targets_next_eviction_check_time_ = UINT64_MAX;
+  std::unordered_set<RenderTargetKey, RenderTargetKey::Hasher>
+      owning_render_targets;
+  GetEdramOwningRenderTargets(owning_render_targets);
+  typename decltype(render_targets_)::iterator it_next;
+  for (auto it = render_targets_.begin(); it != render_targets_.end();
+       it = it_next) {
+    it_next = std::next(it);
+    RenderTarget* render_target = it->second;
+    if (!render_target ||
+        owning_render_targets.find(it->first) != owning_render_targets.end()) {
+      // Will be marked as used when losing the ownership of the data.
+      continue;
+    }
+    uint64_t expiration_time = render_target->last_usage_time() + lifetime_ms;
+    if (render_target->last_usage_submission() > completed_submission ||
+        expiration_time > current_time ||
+        std::find(std::begin(last_update_used_render_targets_),
+                  std::end(last_update_used_render_targets_),
+                  render_target) !=
+            std::end(last_update_used_render_targets_) ||
+        std::find(std::begin(last_update_accumulated_render_targets_),
+                  std::end(last_update_accumulated_render_targets_),
+                  render_target) !=
+            std::end(last_update_accumulated_render_targets_)) {
+      // Not owning the data anymore, but may still be used by the GPU or
+      // needed again soon.
+      render_targets_next_eviction_check_time_ =
+          std::min(render_targets_next_eviction_check_time_,
+                   std::max(expiration_time, current_time + 1));
+      continue;
+    }
+    XELOGGPU("Destroying an unused {} render target with guest format {} at "
+             "EDRAM base {}",
+             it->first.is_depth ? "depth" : "color", it->first.resource_format,
+             it->first.base_tiles);
+    destroyed_keys_out.push_back(it->first);
+    delete render_target;
+    render_targets_.erase(it);
+    render_target_evictions_counter.Increment();
+  }
+}
+
+void RenderTargetCache::GetEdramOwningRenderTargets(
+    std::unordered_set<RenderTargetKey, RenderTargetKey::Hasher>&
+        render_targets_out) const {
+  for (const auto& ownership_range_pair : ownership_ranges_) {
+    const OwnershipRange& ownership_range = ownership_range_pair.second;
+    if (!ownership_range.render_target.IsEmpty()) {
+      render_targets_out.emplace(ownership_range.render_target);
+    }
+    if (!ownership_range.host_depth_render_target_unorm24.IsEmpty()) {
+      render_targets_out.emplace(
+          ownership_range.host_depth_render_target_unorm24);
+    }
+    if (!ownership_range.host_depth_render_target_float24.IsEmpty()) {
+      render_targets_out.emplace(
+          ownership_range.host_depth_render_target_float24);
+    }
+    if (!ownership_range.unmodified_render_target.IsEmpty()) {
+      render_targets_out.emplace(ownership_range.unmodified_render_target);
+    }
+  }
+}
+
+void RenderTargetCache::MarkOwnersAsUsed(const OwnershipRange& range) {
+  if (render_targets_.empty()) {
+    return;
+  }
+  uint64_t submission = GetCurrentSubmission();
+  uint64_t time = xe::Clock::QueryHostUptimeMillis();
+  render_targets_next_eviction_check_time_ = std::min(
+      render_targets_next_eviction_check_time_,
+      time + uint64_t(cvars::render_target_unused_lifetime) * 1000);
+  RenderTargetKey owners[] = {range.render_target,
+                              range.host_depth_render_target_unorm24,
+                              range.host_depth_render_target_float24,
+                              range.unmodified_render_target};
+  for (RenderTargetKey owner : owners) {
+    if (owner.IsEmpty()) {
+      continue;
+    }
+    auto it = render_targets_.find(owner);
+    if (it != render_targets_.end() && it->second) {
+      it->second->MarkAsUsed(submission, time);
+    }
+  }
+}
+
 RenderTargetCache::RenderTarget* RenderTargetCache::GetOrCreateRenderTarget(
     RenderTargetKey key) {
   assert_true(GetPath() == Path::kHostRenderTargets);
@@ -1449,6 +1614,8 @@ RenderTargetCache::RenderTarget* RenderTargetCache::GetOrCreateRenderTarget(
     uint32_t height =
         GetRenderTargetHeight(key.pitch_tiles_at_32bpp, key.msaa_samples);
     if (render_target) {
+      render_target->MarkAsUsed(GetCurrentSubmission(),
+                                xe::Clock::QueryHostUptimeMillis());
       XELOGGPU(
           "Created a {}x{} {}xMSAA {} render target with guest format {} at "
           "EDRAM base {}",
@@ -1539,7 +1706,7 @@ bool RenderTargetCache::WouldOwnershipChangeRequireTransfers(
 void RenderTargetCache::ChangeOwnership(
     RenderTargetKey dest, uint32_t start_tiles_base_relative,
     uint32_t length_tiles, std::vector<Transfer>* transfers_append_out,
-    const Transfer::Rectangle* resolve_clear_cutout) {
+    const Transfer::Rectangle* resolve_clear_cutout, bool dest_read_only) {
   // xenos::kEdramTileCount with length 0 is fine if both the start and the end
   // are clamped to xenos::kEdramTileCount.
   assert_true(start_tiles_base_relative <=
@@ -1553,6 +1720,14 @@ void RenderTargetCache::ChangeOwnership(
   bool host_depth_encoding_different =
       dest.is_depth && GetPath() == Path::kHostRenderTargets &&
       IsHostDepthEncodingDifferent(dest.GetDepthFormat());
+  auto is_claim_needed = [&](const OwnershipRange& range) {
+    if (!range.IsOwnedBy(dest, host_depth_encoding_different)) {
+      return true;
+    }
+    // Already owned, but if writing, the previous owner will not have the
+    // latest data anymore.
+    return !dest_read_only && !range.unmodified_render_target.IsEmpty();
+  };
   auto change_ownership_in_extent = [&](uint32_t extent_start,
                                         uint32_t extent_end) {
     // The map contains consecutive ranges, merged if the adjacent ones are the
@@ -1564,7 +1739,7 @@ void RenderTargetCache::ChangeOwnership(
     if (it != ownership_ranges_.begin()) {
       auto it_pre = std::prev(it);
       if (it_pre->second.end_tiles > extent_start &&
-          !it_pre->second.IsOwnedBy(dest, host_depth_encoding_different)) {
+          is_claim_needed(it_pre->second)) {
         // Different render target overlapping the range - split the head.
         ownership_ranges_.emplace(extent_start, it_pre->second);
         it_pre->second.end_tiles = extent_start;
@@ -1578,7 +1753,7 @@ void RenderTargetCache::ChangeOwnership(
         // Outside the touched extent already.
         break;
       }
-      if (it->second.IsOwnedBy(dest, host_depth_encoding_different)) {
+      if (!is_claim_needed(it->second)) {
         // Already owned by the needed render target - no need to transfer
         // anything.
         ++it;
@@ -1591,14 +1766,24 @@ void RenderTargetCache::ChangeOwnership(
         ownership_ranges_.emplace(extent_end, it->second);
         it->second.end_tiles = extent_end;
       }
+      RenderTargetKey previous_owner = it->second.render_target;
       if (transfers_append_out) {
-        RenderTargetKey transfer_source = it->second.render_target;
+        RenderTargetKey transfer_source = previous_owner;
+        uint32_t transfer_end_tiles =
+            std::min(it->second.end_tiles, extent_end);
+        if (!transfer_source.IsEmpty() && transfer_source != dest &&
+            it->second.unmodified_render_target == dest &&
+            cvars::elide_unmodified_render_target_transfers) {
+          // The range has only been read since it was transferred from the
+          // destination, which still contains the latest data.
+          CountTransfer(transfer_source, dest, transfer_end_tiles - it->first,
+                        true);
+          transfer_source = RenderTargetKey();
+        }
         // Only perform the copying when actually changing the latest owner, not
         // just the latest host depth owner - the transfer source is expected to
         // be different than the destination.
         if (!transfer_source.IsEmpty() && transfer_source != dest) {
-          uint32_t transfer_end_tiles =
-              std::min(it->second.end_tiles, extent_end);
           if (!resolve_clear_cutout ||
               Transfer::GetRangeRectangles(it->first, transfer_end_tiles,
                                            dest.base_tiles, dest_pitch_tiles,
@@ -1623,6 +1808,8 @@ void RenderTargetCache::ChangeOwnership(
               // Extend the last transfer if, for example, transferring color,
               // but host depth is different.
               transfers_append_out->back().end_tiles = transfer_end_tiles;
+              CountTransfer(transfer_source, dest,
+                            transfer_end_tiles - it->first, false);
             } else {
               auto transfer_source_rt_it =
                   render_targets_.find(transfer_source);
@@ -1643,14 +1830,23 @@ void RenderTargetCache::ChangeOwnership(
                       transfer_host_depth_source_rt_it != render_targets_.end()
                           ? transfer_host_depth_source_rt_it->second
                           : nullptr);
+                  CountTransfer(transfer_source, dest,
+                                transfer_end_tiles - it->first, false);
                 }
               }
             }
           }
         }
       }
+      // The previous owners may have been used by the GPU until now.
+      MarkOwnersAsUsed(it->second);
       // Claim the current range.
       it->second.render_target = dest;
+      if (!dest_read_only) {
+        it->second.unmodified_render_target = RenderTargetKey();
+      } else if (previous_owner != dest) {
+        it->second.unmodified_render_target = previous_owner;
+      }
       if (host_depth_encoding_different) {
         it->second.GetHostDepthRenderTarget(dest.GetDepthFormat()) = dest;
       }
@@ -1695,5 +1891,25 @@ void RenderTargetCache::ChangeOwnership(
   }
 }
 
+void RenderTargetCache::CountTransfer(RenderTargetKey source,
+                                      RenderTargetKey dest,
+                                      uint32_t length_tiles, bool elided) {
+  uint64_t bytes = uint64_t(length_tiles) * xenos::kEdramTileWidthSamples *
+                   xenos::kEdramTileHeightSamples * sizeof(uint32_t) *
+                   draw_resolution_scale_x() * draw_resolution_scale_y();
+  if (elided) {
+    ++frame_elided_transfer_count_;
+    frame_elided_transfer_bytes_ += bytes;
+    return;
+  }
+  ++frame_transfer_count_;
+  frame_transfer_bytes_ += bytes;
+  render_target_transfers_counter.Increment();
+  render_target_transfer_bytes_counter.Increment(bytes);
+  ++frame_transfer_format_counts_[std::make_pair(
+      (uint32_t(source.is_depth) << 4) | source.resource_format,
+      (uint32_t(dest.is_depth) << 4) | dest.resource_format)];
+}
+
 }  // namespace gpu
 }  // namespace xe
@@ -15,6 +15,7 @@
 #include <functional>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -347,11 +348,22 @@ class RenderTargetCache {
     RenderTarget& operator=(RenderTarget&& render_target) = delete;
     RenderTargetKey key() const { return key_; }
 
+    // For destroying the render targets that don't own any EDRAM data anymore
+    // after the GPU has stopped using them.
+    uint64_t last_usage_submission() const { return last_usage_submission_; }
+    uint64_t last_usage_time() const { return last_usage_time_; }
+    void MarkAsUsed(uint64_t submission, uint64_t time) {
+      last_usage_submission_ = submission;
+      last_usage_time_ = time;
+    }
+
    protected:
     RenderTarget(RenderTargetKey key) : key_(key) {}
 
    private:
     RenderTargetKey key_;
+    uint64_t last_usage_submission_ = 0;
+    uint64_t last_usage_time_ = 0;
   };
 
   struct Transfer {
@@ -528,6 +540,20 @@ class RenderTargetCache {
                                  xenos::MsaaSamples msaa_samples) const;
 
   virtual RenderTarget* CreateRenderTarget(RenderTargetKey key) = 0;
+  // The submission the GPU commands currently being recorded will be in, for
+  // tracking the usage of render targets.
+  virtual uint64_t GetCurrentSubmission() const = 0;
+
+  // Destroys the host render targets that don't own any EDRAM data, have not
+  // been used by the GPU after completed_submission, and have not been used
+  // for longer than render_target_unused_lifetime. Must be called when there
+  // are no pending references to the render targets in the implementation
+  // other than those from the last update - such as in the beginning of a
+  // frame. The implementation must drop its own objects referencing the
+  // render targets with the keys returned in destroyed_keys_out.
+  void DestroyUnusedRenderTargets(
+      uint64_t completed_submission,
+      std::vector<RenderTargetKey>& destroyed_keys_out);
 
   // Whether depth buffer is encoded differently on the host, thus after
   // aliasing naively, precision may be lost - host depth must only be
@@ -650,13 +676,21 @@ class RenderTargetCache {
     // empty too.
     RenderTargetKey host_depth_render_target_unorm24;
     RenderTargetKey host_depth_render_target_float24;
+    // Previous owner of the range from which the data was transferred to
+    // render_target, if render_target has only been read since then (depth /
+    // stencil testing without writing), so the previous owner still contains
+    // the latest data, and transferring it back is not needed. Empty if the
+    // range has been written by render_target.
+    RenderTargetKey unmodified_render_target;
     OwnershipRange(uint32_t end_tiles, RenderTargetKey render_target,
                    RenderTargetKey host_depth_render_target_unorm24,
-                   RenderTargetKey host_depth_render_target_float24)
+                   RenderTargetKey host_depth_render_target_float24,
+                   RenderTargetKey unmodified_render_target = RenderTargetKey())
         : end_tiles(end_tiles),
           render_target(render_target),
           host_depth_render_target_unorm24(host_depth_render_target_unorm24),
-          host_depth_render_target_float24(host_depth_render_target_float24) {}
+          host_depth_render_target_float24(host_depth_render_target_float24),
+          unmodified_render_target(unmodified_render_target) {}
     const RenderTargetKey& GetHostDepthRenderTarget(
         xenos::DepthRenderTargetFormat resource_format) const {
       assert_true(
@@ -693,7 +727,8 @@ class RenderTargetCache {
              host_depth_render_target_unorm24 ==
                  other_range.host_depth_render_target_unorm24 &&
              host_depth_render_target_float24 ==
-                 other_range.host_depth_render_target_float24;
+                 other_range.host_depth_render_target_float24 &&
+             unmodified_render_target == other_range.unmodified_render_target;
     }
   };
 
@@ -709,6 +744,13 @@ class RenderTargetCache {
 
   RenderTarget* GetOrCreateRenderTarget(RenderTargetKey key);
 
+  void GetEdramOwningRenderTargets(
+      std::unordered_set<RenderTargetKey, RenderTargetKey::Hasher>&
+          render_targets_out) const;
+  // Called when the render targets owning the range lose the ownership of it,
+  // as they may have been used by the GPU until now.
+  void MarkOwnersAsUsed(const OwnershipRange& range);
+
   // Checks if changing ownership of the range to the specified render target
   // would require transferring data - primarily for barrier placement on the
   // pixel shader interlock path (where transfers do not involve copying, but
@@ -719,16 +761,26 @@ class RenderTargetCache {
                                             uint32_t start_tiles_base_relative,
                                             uint32_t length_tiles) const;
   // Updates ownership_ranges_, adds the transfers needed for the ownership
-  // change to transfers_append_out if it's not null.
+  // change to transfers_append_out if it's not null. If dest_read_only is true,
+  // the range will only be read by the new owner (depth / stencil testing
+  // without writing), so the previous owner will still have the latest data.
   void ChangeOwnership(
       RenderTargetKey dest, uint32_t start_tiles_base_relative,
       uint32_t length_tiles, std::vector<Transfer>* transfers_append_out,
-      const Transfer::Rectangle* resolve_clear_cutout = nullptr);
+      const Transfer::Rectangle* resolve_clear_cutout = nullptr,
+      bool dest_read_only = false);
+  // Adds an ownership transfer (performed or elided) to the statistics of the
+  // current frame.
+  void CountTransfer(RenderTargetKey source, RenderTargetKey dest,
+                     uint32_t length_tiles, bool elided);
 
   // If failed to create, may contain nullptr to prevent attempting to create a
   // render target twice.
   std::unordered_map<RenderTargetKey, RenderTarget*, RenderTargetKey::Hasher>
       render_targets_;
+  // Host uptime in milliseconds before which none of the render targets can
+  // expire in DestroyUnusedRenderTargets.
+  uint64_t render_targets_next_eviction_check_time_ = UINT64_MAX;
 
   // Map of host render targets currently containing the most up-to-date version
   // of the tile. Has no gaps, unused parts are represented by empty render
@@ -742,7 +794,7 @@ class RenderTargetCache {
   // update. 0 is depth, color starting from 1, nullptr if not bound.
   // Only valid for non-pixel-shader-interlock paths.
   RenderTarget*
-      last_update_used_render_targets_[1 + xenos::kMaxColorRenderTargets];
+      last_update_used_render_targets_[1 + xenos::kMaxColorRenderTargets] = {};
   // Render targets used by the draw call with the last successful update or
   // previous updates, unless a different or a totally new one was bound (or
   // surface info was changed), to avoid unneeded render target switching (which
@@ -752,9 +804,8 @@ class RenderTargetCache {
   // whether it's safe to enable depth / stencil or writing to a specific color
   // render target in the pipeline for this draw call.
   // Only valid for non-pixel-shader-interlock paths.
-  RenderTarget*
-      last_update_accumulated_render_targets_[1 +
-                                              xenos::kMaxColorRenderTargets];
+  RenderTarget* last_update_accumulated_render_targets_
+      [1 + xenos::kMaxColorRenderTargets] = {};
   // Whether the color render targets (in bits 0...3) from the last successful
   // update have k_8_8_8_8_GAMMA format, for sRGB emulation on the host if
   // needed.
@@ -769,6 +820,17 @@ class RenderTargetCache {
   // consecutive in the array.
   std::vector<Transfer>
       last_update_transfers_[1 + xenos::kMaxColorRenderTargets];
+
+  // Ownership transfer statistics of the current frame, reported to the
+  // profiler (and optionally to the log) in the beginning of the next frame.
+  uint32_t frame_transfer_count_ = 0;
+  uint32_t frame_elided_transfer_count_ = 0;
+  uint64_t frame_transfer_bytes_ = 0;
+  uint64_t frame_elided_transfer_bytes_ = 0;
+  // Number of transfers for each pair of source and destination formats, with
+  // the format identifiers being (is_depth << 4) | resource_format.
+  std::map<std::pair<uint32_t, uint32_t>, uint32_t>
+      frame_transfer_format_counts_;
 };
 
 }  // namespace gpu
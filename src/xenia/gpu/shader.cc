@@ -11,9 +11,11 @@
 
 #include <cinttypes>
 #include <cstring>
+#include <type_traits>
 #include <utility>
 
 #include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/assert.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
@@ -147,7 +149,9 @@ std::pair<std::filesystem::path, std::filesystem::path> Shader::DumpUcode(
   }
 
   std::filesystem::path disasm_path;
-  if (is_ucode_analyzed()) {
+  // The disassembly is not available if the analysis was loaded from the shader
+  // storage.
+  if (is_ucode_analyzed() && !ucode_disassembly().empty()) {
     disasm_path = target_path / fmt::format("shader_{:016X}.ucode.{}",
                                             ucode_data_hash(), type_extension);
     FILE* disasm_file = filesystem::OpenFile(disasm_path, "w");
@@ -161,6 +165,244 @@ std::pair<std::filesystem::path, std::filesystem::path> Shader::DumpUcode(
   return std::make_pair(std::move(binary_path), std::move(disasm_path));
 }
 
+namespace {
+
+struct UcodeAnalysisStoredHeader {
+  Shader::ConstantRegisterMap constant_register_map;
+  uint32_t cf_pair_index_bound;
+  uint32_t register_static_address_bound;
+  uint32_t writes_interpolators;
+  uint32_t writes_point_size_edge_flag_kill_vertex;
+  uint32_t writes_color_targets;
+  uint32_t vertex_binding_count;
+  uint32_t texture_binding_count;
+  uint32_t label_address_count;
+  uint32_t cf_memexport_info_count;
+  uint32_t memexport_stream_constant_count;
+  uint8_t memexport_eM_written;
+  uint8_t memexport_eM_potentially_written_before_end;
+  uint8_t uses_register_dynamic_addressing : 1;
+  uint8_t kills_pixels : 1;
+  uint8_t uses_texture_fetch_instruction_results : 1;
+  uint8_t writes_depth : 1;
+};
+
+struct VertexBindingStoredHeader {
+  int32_t binding_index;
+  uint32_t fetch_constant;
+  uint32_t stride_words;
+  uint32_t attribute_count;
+};
+
+struct TextureBindingStoredHeader {
+  uint32_t binding_index;
+  uint32_t fetch_constant;
+};
+
+// Fetch instructions are stored as raw bytes.
+static_assert(std::is_trivially_copyable_v<Shader::ConstantRegisterMap>);
+static_assert(std::is_trivially_copyable_v<ParsedVertexFetchInstruction>);
+static_assert(std::is_trivially_copyable_v<ParsedTextureFetchInstruction>);
+
+template <typename T>
+void AppendStoredUcodeAnalysis(std::vector<uint8_t>& data, const T& value) {
+  size_t offset = data.size();
+  data.resize(offset + sizeof(T));
+  std::memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+bool ReadStoredUcodeAnalysis(const uint8_t*& data, const uint8_t* data_end,
+                             T& value_out) {
+  if (size_t(data_end - data) < sizeof(T)) {
+    return false;
+  }
+  std::memcpy(&value_out, data, sizeof(T));
+  data += sizeof(T);
+  return true;
+}
+
+}  // namespace
+
+void Shader::SerializeUcodeAnalysis(std::vector<uint8_t>& data_out) const {
+  data_out.clear();
+  assert_true(is_ucode_analyzed());
+
+  UcodeAnalysisStoredHeader header;
+  // Don't leak anything in the padding.
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(&header.constant_register_map, &constant_register_map_,
+              sizeof(constant_register_map_));
+  header.cf_pair_index_bound = cf_pair_index_bound_;
+  header.register_static_address_bound = register_static_address_bound_;
+  header.writes_interpolators = writes_interpolators_;
+  header.writes_point_size_edge_flag_kill_vertex =
+      writes_point_size_edge_flag_kill_vertex_;
+  header.writes_color_targets = writes_color_targets_;
+  header.vertex_binding_count = uint32_t(vertex_bindings_.size());
+  header.texture_binding_count = uint32_t(texture_bindings_.size());
+  header.label_address_count = uint32_t(label_addresses_.size());
+  header.cf_memexport_info_count = uint32_t(cf_memexport_info_.size());
+  header.memexport_stream_constant_count =
+      uint32_t(memexport_stream_constants_.size());
+  header.memexport_eM_written = memexport_eM_written_;
+  header.memexport_eM_potentially_written_before_end =
+      memexport_eM_potentially_written_before_end_;
+  header.uses_register_dynamic_addressing = uses_register_dynamic_addressing_;
+  header.kills_pixels = kills_pixels_;
+  header.uses_texture_fetch_instruction_results =
+      uses_texture_fetch_instruction_results_;
+  header.writes_depth = writes_depth_;
+  AppendStoredUcodeAnalysis(data_out, header);
+
+  for (const VertexBinding& vertex_binding : vertex_bindings_) {
+    VertexBindingStoredHeader vertex_binding_header;
+    vertex_binding_header.binding_index = vertex_binding.binding_index;
+    vertex_binding_header.fetch_constant = vertex_binding.fetch_constant;
+    vertex_binding_header.stride_words = vertex_binding.stride_words;
+    vertex_binding_header.attribute_count =
+        uint32_t(vertex_binding.attributes.size());
+    AppendStoredUcodeAnalysis(data_out, vertex_binding_header);
+    for (const VertexBinding::Attribute& attribute :
+         vertex_binding.attributes) {
+      // The name points to a string in the executable, and is only needed for
+      // the disassembly, which is not stored.
+      ParsedVertexFetchInstruction fetch_instr = attribute.fetch_instr;
+      fetch_instr.opcode_name = nullptr;
+      AppendStoredUcodeAnalysis(data_out, fetch_instr);
+    }
+  }
+
+  for (const TextureBinding& texture_binding : texture_bindings_) {
+    TextureBindingStoredHeader texture_binding_header;
+    texture_binding_header.binding_index =
+        uint32_t(texture_binding.binding_index);
+    texture_binding_header.fetch_constant = texture_binding.fetch_constant;
+    AppendStoredUcodeAnalysis(data_out, texture_binding_header);
+    ParsedTextureFetchInstruction fetch_instr = texture_binding.fetch_instr;
+    fetch_instr.opcode_name = nullptr;
+    AppendStoredUcodeAnalysis(data_out, fetch_instr);
+  }
+
+  for (uint32_t label_address : label_addresses_) {
+    AppendStoredUcodeAnalysis(data_out, label_address);
+  }
+  for (const ControlFlowMemExportInfo& memexport_info : cf_memexport_info_) {
+    AppendStoredUcodeAnalysis(data_out, memexport_info);
+  }
+  for (uint32_t stream_constant : memexport_stream_constants_) {
+    AppendStoredUcodeAnalysis(data_out, stream_constant);
+  }
+}
+
+bool Shader::DeserializeUcodeAnalysis(const void* data, size_t data_size) {
+  if (is_ucode_analyzed()) {
+    return true;
+  }
+
+  const uint8_t* data_current = reinterpret_cast<const uint8_t*>(data);
+  const uint8_t* data_end = data_current + data_size;
+
+  UcodeAnalysisStoredHeader header;
+  if (!ReadStoredUcodeAnalysis(data_current, data_end, header)) {
+    return false;
+  }
+
+  std::vector<VertexBinding> vertex_bindings;
+  for (uint32_t i = 0; i < header.vertex_binding_count; ++i) {
+    VertexBindingStoredHeader vertex_binding_header;
+    if (!ReadStoredUcodeAnalysis(data_current, data_end,
+                                 vertex_binding_header) ||
+        size_t(data_end - data_current) /
+                sizeof(ParsedVertexFetchInstruction) <
+            vertex_binding_header.attribute_count) {
+      return false;
+    }
+    VertexBinding& vertex_binding = vertex_bindings.emplace_back();
+    vertex_binding.binding_index = vertex_binding_header.binding_index;
+    vertex_binding.fetch_constant = vertex_binding_header.fetch_constant;
+    vertex_binding.stride_words = vertex_binding_header.stride_words;
+    vertex_binding.attributes.resize(vertex_binding_header.attribute_count);
+    for (VertexBinding::Attribute& attribute : vertex_binding.attributes) {
+      ReadStoredUcodeAnalysis(data_current, data_end, attribute.fetch_instr);
+    }
+  }
+
+  std::vector<TextureBinding> texture_bindings;
+  for (uint32_t i = 0; i < header.texture_binding_count; ++i) {
+    TextureBindingStoredHeader texture_binding_header;
+    if (!ReadStoredUcodeAnalysis(data_current, data_end,
+                                 texture_binding_header)) {
+      return false;
+    }
+    TextureBinding& texture_binding = texture_bindings.emplace_back();
+    texture_binding.binding_index = texture_binding_header.binding_index;
+    texture_binding.fetch_constant = texture_binding_header.fetch_constant;
+    if (!ReadStoredUcodeAnalysis(data_current, data_end,
+                                 texture_binding.fetch_instr)) {
+      return false;
+    }
+  }
+
+  std::set<uint32_t> label_addresses;
+  for (uint32_t i = 0; i < header.label_address_count; ++i) {
+    uint32_t label_address;
+    if (!ReadStoredUcodeAnalysis(data_current, data_end, label_address)) {
+      return false;
+    }
+    label_addresses.insert(label_address);
+  }
+
+  if (size_t(data_end - data_current) / sizeof(ControlFlowMemExportInfo) <
+      header.cf_memexport_info_count) {
+    return false;
+  }
+  std::vector<ControlFlowMemExportInfo> cf_memexport_info(
+      header.cf_memexport_info_count);
+  for (ControlFlowMemExportInfo& memexport_info : cf_memexport_info) {
+    ReadStoredUcodeAnalysis(data_current, data_end, memexport_info);
+  }
+
+  std::set<uint32_t> memexport_stream_constants;
+  for (uint32_t i = 0; i < header.memexport_stream_constant_count; ++i) {
+    uint32_t stream_constant;
+    if (!ReadStoredUcodeAnalysis(data_current, data_end, stream_constant)) {
+      return false;
+    }
+    memexport_stream_constants.insert(stream_constant);
+  }
+
+  if (data_current != data_end) {
+    return false;
+  }
+
+  ucode_disassembly_.clear();
+  vertex_bindings_ = std::move(vertex_bindings);
+  texture_bindings_ = std::move(texture_bindings);
+  std::memcpy(&constant_register_map_, &header.constant_register_map,
+              sizeof(constant_register_map_));
+  label_addresses_ = std::move(label_addresses);
+  cf_pair_index_bound_ = header.cf_pair_index_bound;
+  register_static_address_bound_ = header.register_static_address_bound;
+  writes_interpolators_ = header.writes_interpolators;
+  writes_point_size_edge_flag_kill_vertex_ =
+      header.writes_point_size_edge_flag_kill_vertex;
+  writes_color_targets_ = header.writes_color_targets;
+  uses_register_dynamic_addressing_ = header.uses_register_dynamic_addressing;
+  kills_pixels_ = header.kills_pixels;
+  uses_texture_fetch_instruction_results_ =
+      header.uses_texture_fetch_instruction_results;
+  writes_depth_ = header.writes_depth;
+  cf_memexport_info_ = std::move(cf_memexport_info);
+  memexport_eM_written_ = header.memexport_eM_written;
+  memexport_eM_potentially_written_before_end_ =
+      header.memexport_eM_potentially_written_before_end;
+  memexport_stream_constants_ = std::move(memexport_stream_constants);
+
+  is_ucode_analyzed_ = true;
+  return true;
+}
+
 Shader::Translation* Shader::CreateTranslationInstance(uint64_t modification) {
   // Default implementation for simple cases like ucode disassembly.
   return new Translation(*this, modification);
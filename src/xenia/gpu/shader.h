@@ -864,6 +864,17 @@ class Shader {
   // ucode_disasm_buffer is temporary storage for disassembly (provided
   // externally so it won't need to be reallocated for every shader).
   void AnalyzeUcode(StringBuffer& ucode_disasm_buffer);
+  // Writes the results of AnalyzeUcode, except for the disassembly, to be
+  // stored along with the microcode, so the analysis can be skipped when the
+  // shader is loaded from the storage next time. The data is in the host
+  // layout, and the storage version must be changed if the analysis results or
+  // their structures are modified.
+  void SerializeUcodeAnalysis(std::vector<uint8_t>& data_out) const;
+  // Restores the analysis results written by SerializeUcodeAnalysis, marking
+  // the shader as analyzed (with empty disassembly). Returns false and leaves
+  // the shader not analyzed if the data is malformed. Not thread-safe, must not
+  // be called while the shader may be analyzed on another thread.
+  bool DeserializeUcodeAnalysis(const void* data, size_t data_size);
 
   // The following parameters, until the translation, are valid if ucode
   // information has been gathered.
@@ -934,15 +945,20 @@ class Shader {
   // returns the amount of temporary registers that need to be allocated
   // explicitly - if not using register dynamic addressing, the shader
   // translator will use register_static_address_bound directly.
+  // Rounded up to kDynamicAddressableRegisterCountAlignment so the same shader
+  // used with slightly different SQ_PROGRAM_CNTL register counts shares one
+  // translation and its pipelines, at the cost of a few unused registers.
+  static constexpr uint32_t kDynamicAddressableRegisterCountAlignment = 16;
   uint32_t GetDynamicAddressableRegisterCount(
       uint32_t program_cntl_num_reg) const {
     if (!uses_register_dynamic_addressing()) {
       return 0;
     }
-    return std::max((program_cntl_num_reg & 0x80)
-                        ? uint32_t(0)
-                        : (program_cntl_num_reg + uint32_t(1)),
-                    register_static_address_bound());
+    return xe::align(std::max((program_cntl_num_reg & 0x80)
+                                  ? uint32_t(0)
+                                  : (program_cntl_num_reg + uint32_t(1)),
+                              register_static_address_bound()),
+                     kDynamicAddressableRegisterCountAlignment);
   }
 
   // True if the current shader has any `kill` instructions.
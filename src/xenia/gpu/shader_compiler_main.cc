@@ -7,8 +7,10 @@
  ******************************************************************************
  */
 
+#include <atomic>
 #include <cinttypes>
 #include <cstring>
+#include <filesystem>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -16,12 +18,14 @@
 
 #include "third_party/glslang/SPIRV/disassemble.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/console_app_main.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/platform.h"
 #include "xenia/base/string.h"
 #include "xenia/base/string_buffer.h"
+#include "xenia/base/task_scheduler.h"
 #include "xenia/gpu/dxbc_shader_translator.h"
 #include "xenia/gpu/shader_translator.h"
 #include "xenia/gpu/spirv_shader_translator.h"
@@ -33,7 +37,11 @@
 #include "xenia/ui/d3d12/d3d12_api.h"
 #endif  // XE_PLATFORM_WIN32
 
-DEFINE_path(shader_input, "", "Input shader binary file path.", "GPU");
+DEFINE_path(shader_input, "",
+            "Input shader binary file path, or a directory (such as one "
+            "written by --dump_shaders) to translate all the .vs and .ps "
+            "files in it in parallel.",
+            "GPU");
 DEFINE_string(shader_input_type, "",
               "'vs', 'ps', or unspecified to infer from the given filename.",
               "GPU");
@@ -42,7 +50,11 @@ DEFINE_bool(
     "Whether the input shader binary is little-endian (from an Arm device with "
     "the Qualcomm Adreno 200, for instance).",
     "GPU");
-DEFINE_path(shader_output, "", "Output shader file path.", "GPU");
+DEFINE_path(shader_output, "",
+            "Output shader file path, or the directory for the outputs named "
+            "after the inputs with the output type as the extension if "
+            "--shader_input is a directory.",
+            "GPU");
 DEFINE_string(shader_output_type, "ucode",
               "Translator to use: [ucode, spirv, spirvtext, dxbc, dxbctext].",
               "GPU");
@@ -63,7 +75,8 @@ DEFINE_bool(
 namespace xe {
 namespace gpu {
 
-int shader_compiler_main(const std::vector<std::string>& args) {
+bool TranslateShaderFile(const std::filesystem::path& input_path,
+                         const std::filesystem::path& output_path) {
   xenos::ShaderType shader_type;
   if (!cvars::shader_input_type.empty()) {
     if (cvars::shader_input_type == "vs") {
@@ -72,12 +85,12 @@ int shader_compiler_main(const std::vector<std::string>& args) {
       shader_type = xenos::ShaderType::kPixel;
     } else {
       XELOGE("Invalid --shader_input_type; must be 'vs' or 'ps'.");
-      return 1;
+      return false;
     }
   } else {
     bool valid_type = false;
-    if (cvars::shader_input.has_extension()) {
-      auto extension = cvars::shader_input.extension();
+    if (input_path.has_extension()) {
+      auto extension = input_path.extension();
       if (extension == ".vs") {
         shader_type = xenos::ShaderType::kVertex;
         valid_type = true;
@@ -90,21 +103,21 @@ int shader_compiler_main(const std::vector<std::string>& args) {
       XELOGE(
           "File type not recognized (use .vs, .ps or "
           "--shader_input_type=vs|ps).");
-      return 1;
+      return false;
     }
   }
 
-  auto input_file = filesystem::OpenFile(cvars::shader_input, "rb");
+  auto input_file = filesystem::OpenFile(input_path, "rb");
   if (!input_file) {
-    XELOGE("Unable to open input file: {}", cvars::shader_input);
-    return 1;
+    XELOGE("Unable to open input file: {}", input_path);
+    return false;
   }
-  size_t input_file_size = std::filesystem::file_size(cvars::shader_input);
+  size_t input_file_size = std::filesystem::file_size(input_path);
   std::vector<uint32_t> ucode_dwords(input_file_size / 4);
   fread(ucode_dwords.data(), 4, ucode_dwords.size(), input_file);
   fclose(input_file);
 
-  XELOGI("Opened {} as a {} shader, {} words ({} bytes).", cvars::shader_input,
+  XELOGI("Opened {} as a {} shader, {} words ({} bytes).", input_path,
          shader_type == xenos::ShaderType::kVertex ? "vertex" : "pixel",
          ucode_dwords.size(), ucode_dwords.size() * 4);
 
@@ -134,13 +147,17 @@ int shader_compiler_main(const std::vector<std::string>& args) {
   } else {
     // Just output microcode disassembly generated during microcode information
     // gathering.
-    if (!cvars::shader_output.empty()) {
-      auto output_file = filesystem::OpenFile(cvars::shader_output, "wb");
+    if (!output_path.empty()) {
+      auto output_file = filesystem::OpenFile(output_path, "wb");
+      if (!output_file) {
+        XELOGE("Unable to open output file: {}", output_path);
+        return false;
+      }
       fwrite(shader->ucode_disassembly().c_str(), 1,
              shader->ucode_disassembly().length(), output_file);
       fclose(output_file);
     }
-    return 0;
+    return true;
   }
 
   Shader::HostVertexShaderType host_vertex_shader_type =
@@ -178,12 +195,15 @@ int shader_compiler_main(const std::vector<std::string>& args) {
       break;
     default:
       assert_unhandled_case(shader_type);
-      return 1;
+      return false;
   }
 
   Shader::Translation* translation =
       shader->GetOrCreateTranslation(modification);
-  translator->TranslateAnalyzedShader(*translation);
+  if (!translator->TranslateAnalyzedShader(*translation)) {
+    XELOGE("Failed to translate {}", input_path);
+    return false;
+  }
 
   const void* source_data = translation->translated_binary().data();
   size_t source_data_size = translation->translated_binary().size();
@@ -242,10 +262,16 @@ int shader_compiler_main(const std::vector<std::string>& args) {
   }
 #endif  // XE_PLATFORM_WIN32
 
-  if (!cvars::shader_output.empty()) {
-    auto output_file = filesystem::OpenFile(cvars::shader_output, "wb");
-    fwrite(source_data, 1, source_data_size, output_file);
-    fclose(output_file);
+  bool output_written = true;
+  if (!output_path.empty()) {
+    auto output_file = filesystem::OpenFile(output_path, "wb");
+    if (output_file) {
+      fwrite(source_data, 1, source_data_size, output_file);
+      fclose(output_file);
+    } else {
+      XELOGE("Unable to open output file: {}", output_path);
+      output_written = false;
+    }
   }
 
 #if XE_PLATFORM_WIN32
@@ -254,7 +280,61 @@ int shader_compiler_main(const std::vector<std::string>& args) {
   }
 #endif  // XE_PLATFORM_WIN32
 
-  return 0;
+  return output_written;
+}
+
+int shader_compiler_main(const std::vector<std::string>& args) {
+  std::error_code error_code;
+  if (!std::filesystem::is_directory(cvars::shader_input, error_code)) {
+    return TranslateShaderFile(cvars::shader_input, cvars::shader_output) ? 0
+                                                                          : 1;
+  }
+
+  // Batch mode.
+  std::vector<std::filesystem::path> input_paths;
+  for (const std::filesystem::directory_entry& entry :
+       std::filesystem::directory_iterator(cvars::shader_input, error_code)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    const std::filesystem::path& path = entry.path();
+    if (!cvars::shader_input_type.empty() ||
+        (path.extension() == ".vs" || path.extension() == ".ps")) {
+      input_paths.push_back(path);
+    }
+  }
+  if (error_code) {
+    XELOGE("Unable to list the input directory: {}", cvars::shader_input);
+    return 1;
+  }
+  if (!cvars::shader_output.empty() &&
+      !std::filesystem::create_directories(cvars::shader_output, error_code) &&
+      error_code) {
+    XELOGE("Unable to create the output directory: {}", cvars::shader_output);
+    return 1;
+  }
+  XELOGI("Translating {} shaders from {}", input_paths.size(),
+         cvars::shader_input);
+  uint64_t start_time = Clock::QueryHostUptimeMillis();
+  std::atomic<uint32_t> failed_count{0};
+  threading::TaskScheduler::Get().ParallelFor(
+      uint32_t(input_paths.size()), [&](uint32_t index) {
+        const std::filesystem::path& input_path = input_paths[index];
+        std::filesystem::path output_path;
+        if (!cvars::shader_output.empty()) {
+          output_path =
+              cvars::shader_output /
+              (input_path.filename().string() + "." +
+               cvars::shader_output_type);
+        }
+        if (!TranslateShaderFile(input_path, output_path)) {
+          failed_count.fetch_add(1, std::memory_order_relaxed);
+        }
+      });
+  XELOGI("Translated {} shaders in {} ms, {} failed",
+         input_paths.size() - failed_count.load(),
+         Clock::QueryHostUptimeMillis() - start_time, failed_count.load());
+  return failed_count.load() ? 1 : 0;
 }
 
 }  // namespace gpu
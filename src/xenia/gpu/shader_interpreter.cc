@@ -9,6 +9,7 @@
 
 #include "xenia/gpu/shader_interpreter.h"
 
+#include <bitset>
 #include <cfloat>
 #include <cmath>
 #include <cstring>
@@ -250,6 +251,433 @@ void ShaderInterpreter::Execute() {
   }
 }
 
+namespace {
+
+bool DoesAluScalarOpcodeReadPreviousScalar(ucode::AluScalarOpcode opcode) {
+  switch (opcode) {
+    case ucode::AluScalarOpcode::kAddsPrev:
+    case ucode::AluScalarOpcode::kMulsPrev:
+    case ucode::AluScalarOpcode::kMulsPrev2:
+    case ucode::AluScalarOpcode::kSubsPrev:
+    case ucode::AluScalarOpcode::kRetainPrev:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+bool ShaderInterpreter::BuildPositionStraightLine(
+    const uint32_t* ucode, const RegisterFile& register_file,
+    std::vector<StraightLineInstruction>& instructions_out) {
+  instructions_out.clear();
+
+  // Against infinite jumps, and long shaders are unlikely to be clears and
+  // similar screen-space draws anyway.
+  constexpr uint32_t kMaxControlFlowSteps = 1024;
+  constexpr size_t kMaxInstructions = 1024;
+
+  const uint32_t* bool_constants =
+      &register_file[XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031];
+  auto is_bool_constant_set = [bool_constants](uint32_t bool_address) {
+    return (bool_constants[bool_address >> 5] &
+            (UINT32_C(1) << (bool_address & 31))) != 0;
+  };
+
+  // Resolve the control flow the same way as Execute does.
+  uint32_t call_stack_depth = 0;
+  uint32_t call_return_addresses[4];
+  uint32_t cf_step_count = 0;
+  bool exec_ended = false;
+  uint32_t cf_index_next = 1;
+  for (uint32_t cf_index = 0; !exec_ended; cf_index = cf_index_next) {
+    if (++cf_step_count > kMaxControlFlowSteps) {
+      return false;
+    }
+    cf_index_next = cf_index + 1;
+
+    const uint32_t* cf_pair = &ucode[3 * (cf_index >> 1)];
+    ucode::ControlFlowInstruction cf_instr;
+    if (cf_index & 1) {
+      cf_instr.dword_0 = (cf_pair[1] >> 16) | (cf_pair[2] << 16);
+      cf_instr.dword_1 = cf_pair[2] >> 16;
+    } else {
+      cf_instr.dword_0 = cf_pair[0];
+      cf_instr.dword_1 = cf_pair[1] & 0xFFFF;
+    }
+
+    ucode::ControlFlowOpcode cf_opcode = cf_instr.opcode();
+    switch (cf_opcode) {
+      case ucode::ControlFlowOpcode::kNop:
+      case ucode::ControlFlowOpcode::kAlloc:
+      case ucode::ControlFlowOpcode::kMarkVsFetchDone: {
+      } break;
+
+      case ucode::ControlFlowOpcode::kExec:
+      case ucode::ControlFlowOpcode::kExecEnd:
+      case ucode::ControlFlowOpcode::kCondExec:
+      case ucode::ControlFlowOpcode::kCondExecEnd:
+      case ucode::ControlFlowOpcode::kCondExecPred:
+      case ucode::ControlFlowOpcode::kCondExecPredEnd:
+      case ucode::ControlFlowOpcode::kCondExecPredClean:
+      case ucode::ControlFlowOpcode::kCondExecPredCleanEnd: {
+        ucode::ControlFlowExecInstruction cf_exec =
+            *reinterpret_cast<const ucode::ControlFlowExecInstruction*>(
+                &cf_instr);
+
+        bool exec_is_predicated = false;
+        bool exec_predicate_condition = false;
+        switch (cf_opcode) {
+          case ucode::ControlFlowOpcode::kCondExec:
+          case ucode::ControlFlowOpcode::kCondExecEnd:
+          case ucode::ControlFlowOpcode::kCondExecPredClean:
+          case ucode::ControlFlowOpcode::kCondExecPredCleanEnd: {
+            const ucode::ControlFlowCondExecInstruction cf_cond_exec =
+                *reinterpret_cast<const ucode::ControlFlowCondExecInstruction*>(
+                    &cf_exec);
+            if (cf_cond_exec.condition() !=
+                is_bool_constant_set(cf_cond_exec.bool_address())) {
+              continue;
+            }
+          } break;
+          case ucode::ControlFlowOpcode::kCondExecPred:
+          case ucode::ControlFlowOpcode::kCondExecPredEnd: {
+            const ucode::ControlFlowCondExecPredInstruction cf_cond_exec_pred =
+                *reinterpret_cast<
+                    const ucode::ControlFlowCondExecPredInstruction*>(&cf_exec);
+            exec_is_predicated = true;
+            exec_predicate_condition = cf_cond_exec_pred.condition();
+          } break;
+          default:
+            break;
+        }
+
+        for (uint32_t exec_index = 0; exec_index < cf_exec.count();
+             ++exec_index) {
+          StraightLineInstruction instruction;
+          instruction.instruction_index = cf_exec.address() + exec_index;
+          instruction.is_fetch =
+              ((cf_exec.sequence() >> (exec_index << 1)) & 0b01) != 0;
+          const uint32_t* exec_instruction =
+              &ucode[3 * instruction.instruction_index];
+          bool instruction_is_predicated, instruction_predicate_condition;
+          if (instruction.is_fetch) {
+            const ucode::FetchInstruction& fetch_instr =
+                *reinterpret_cast<const ucode::FetchInstruction*>(
+                    exec_instruction);
+            instruction_is_predicated = fetch_instr.is_predicated();
+            instruction_predicate_condition = fetch_instr.predicate_condition();
+          } else {
+            const ucode::AluInstruction& alu_instr =
+                *reinterpret_cast<const ucode::AluInstruction*>(
+                    exec_instruction);
+            instruction_is_predicated = alu_instr.is_predicated();
+            instruction_predicate_condition = alu_instr.predicate_condition();
+            // The predicate of the exec is checked only once, before the
+            // first instruction.
+            if (exec_is_predicated && exec_index + 1 < cf_exec.count()) {
+              uint32_t changed_state =
+                  ucode::GetAluScalarOpcodeInfo(alu_instr.scalar_opcode())
+                      .changed_state;
+              const ucode::AluVectorOpcodeInfo& vector_opcode_info =
+                  ucode::GetAluVectorOpcodeInfo(alu_instr.vector_opcode());
+              if (alu_instr.GetVectorOpResultWriteMask() ||
+                  vector_opcode_info.changed_state) {
+                changed_state |= vector_opcode_info.changed_state;
+              }
+              if (changed_state & ucode::kAluOpChangedStatePredicate) {
+                return false;
+              }
+            }
+          }
+          if (instruction_is_predicated) {
+            if (exec_is_predicated &&
+                instruction_predicate_condition != exec_predicate_condition) {
+              continue;
+            }
+            instruction.is_predicated = true;
+            instruction.predicate_condition = instruction_predicate_condition;
+          } else {
+            instruction.is_predicated = exec_is_predicated;
+            instruction.predicate_condition = exec_predicate_condition;
+          }
+          instructions_out.push_back(instruction);
+          if (instructions_out.size() > kMaxInstructions) {
+            return false;
+          }
+        }
+
+        if (ucode::DoesControlFlowOpcodeEndShader(cf_opcode)) {
+          exec_ended = true;
+        }
+      } break;
+
+      case ucode::ControlFlowOpcode::kCondCall: {
+        if (call_stack_depth >= 4) {
+          continue;
+        }
+        const ucode::ControlFlowCondCallInstruction cf_cond_call =
+            *reinterpret_cast<const ucode::ControlFlowCondCallInstruction*>(
+                &cf_instr);
+        if (!cf_cond_call.is_unconditional()) {
+          if (cf_cond_call.is_predicated()) {
+            return false;
+          }
+          if (cf_cond_call.condition() !=
+              is_bool_constant_set(cf_cond_call.bool_address())) {
+            continue;
+          }
+        }
+        call_return_addresses[call_stack_depth++] = cf_index + 1;
+        cf_index_next = cf_cond_call.address();
+      } break;
+
+      case ucode::ControlFlowOpcode::kReturn: {
+        if (!call_stack_depth) {
+          continue;
+        }
+        cf_index_next = call_return_addresses[--call_stack_depth];
+      } break;
+
+      case ucode::ControlFlowOpcode::kCondJmp: {
+        const ucode::ControlFlowCondJmpInstruction cf_cond_jmp =
+            *reinterpret_cast<const ucode::ControlFlowCondJmpInstruction*>(
+                &cf_instr);
+        if (!cf_cond_jmp.is_unconditional()) {
+          if (cf_cond_jmp.is_predicated()) {
+            return false;
+          }
+          if (cf_cond_jmp.condition() !=
+              is_bool_constant_set(cf_cond_jmp.bool_address())) {
+            continue;
+          }
+        }
+        cf_index_next = cf_cond_jmp.address();
+      } break;
+
+      default:
+        // Loops, or invalid.
+        return false;
+    }
+  }
+
+  // Going backwards, drop the instructions whose results are not read by the
+  // later kept instructions or the needed exports. A write kills the liveness
+  // only if it's not predicated and replaces the whole register.
+  std::bitset<xenos::kMaxShaderTempRegisters> live_temps;
+  bool live_previous_scalar = false;
+  bool live_predicate = false;
+  bool live_address_register = false;
+  bool live_vertex_fetch_state = false;
+  std::vector<bool> instructions_kept(instructions_out.size(), false);
+  for (size_t i = instructions_out.size(); i--;) {
+    const StraightLineInstruction& instruction = instructions_out[i];
+    const uint32_t* instruction_dwords =
+        &ucode[3 * instruction.instruction_index];
+    bool is_unconditional = !instruction.is_predicated;
+    if (instruction.is_fetch) {
+      const ucode::FetchInstruction& fetch_instr =
+          *reinterpret_cast<const ucode::FetchInstruction*>(instruction_dwords);
+      bool is_vertex_fetch =
+          fetch_instr.opcode() == ucode::FetchOpcode::kVertexFetch;
+      bool is_full_vertex_fetch =
+          is_vertex_fetch && !fetch_instr.vertex_fetch().is_mini_fetch();
+      if (fetch_instr.is_dest_relative() ||
+          (is_full_vertex_fetch && fetch_instr.is_src_relative())) {
+        return false;
+      }
+      uint32_t dest = fetch_instr.dest();
+      if (!live_temps[dest] &&
+          !(is_full_vertex_fetch && live_vertex_fetch_state)) {
+        continue;
+      }
+      if (is_unconditional) {
+        bool dest_fully_written = true;
+        for (uint32_t j = 0; j < 4; ++j) {
+          if (ucode::GetFetchDestinationComponentSwizzle(
+                  fetch_instr.dest_swizzle(), j) ==
+              ucode::FetchDestinationSwizzle::kKeep) {
+            dest_fully_written = false;
+            break;
+          }
+        }
+        if (dest_fully_written) {
+          live_temps[dest] = false;
+        }
+        if (is_full_vertex_fetch) {
+          live_vertex_fetch_state = false;
+        }
+      }
+      if (is_full_vertex_fetch) {
+        live_temps[fetch_instr.src()] = true;
+      } else if (is_vertex_fetch) {
+        live_vertex_fetch_state = true;
+      }
+    } else {
+      const ucode::AluInstruction& alu_instr =
+          *reinterpret_cast<const ucode::AluInstruction*>(instruction_dwords);
+      ucode::AluScalarOpcode scalar_opcode = alu_instr.scalar_opcode();
+      const ucode::AluScalarOpcodeInfo& scalar_opcode_info =
+          ucode::GetAluScalarOpcodeInfo(scalar_opcode);
+      const ucode::AluVectorOpcodeInfo& vector_opcode_info =
+          ucode::GetAluVectorOpcodeInfo(alu_instr.vector_opcode());
+      uint32_t vector_result_write_mask =
+          alu_instr.GetVectorOpResultWriteMask();
+      uint32_t scalar_result_write_mask =
+          alu_instr.GetScalarOpResultWriteMask();
+      bool vector_executed =
+          vector_result_write_mask || vector_opcode_info.changed_state;
+      uint32_t changed_state = scalar_opcode_info.changed_state;
+      if (vector_executed) {
+        changed_state |= vector_opcode_info.changed_state;
+      }
+      bool writes_previous_scalar =
+          scalar_opcode != ucode::AluScalarOpcode::kRetainPrev;
+
+      bool is_kept = false;
+      if (alu_instr.is_export()) {
+        uint32_t export_register = alu_instr.vector_dest();
+        is_kept =
+            export_register ==
+                uint32_t(ucode::ExportRegister::kVSPosition) ||
+            export_register ==
+                uint32_t(ucode::ExportRegister::kVSPointSizeEdgeFlagKillVertex);
+      } else {
+        if (vector_result_write_mask) {
+          if (alu_instr.is_vector_dest_relative()) {
+            return false;
+          }
+          is_kept |= live_temps[alu_instr.vector_dest()];
+        }
+        if (scalar_result_write_mask) {
+          if (alu_instr.is_scalar_dest_relative()) {
+            return false;
+          }
+          is_kept |= live_temps[alu_instr.scalar_dest()];
+        }
+      }
+      is_kept |= writes_previous_scalar && live_previous_scalar;
+      is_kept |= (changed_state & ucode::kAluOpChangedStatePredicate) &&
+                 live_predicate;
+      is_kept |= (changed_state & ucode::kAluOpChangedStateAddressRegister) &&
+                 live_address_register;
+      if (!is_kept) {
+        continue;
+      }
+
+      if (is_unconditional) {
+        if (!alu_instr.is_export()) {
+          if (vector_result_write_mask == 0b1111) {
+            live_temps[alu_instr.vector_dest()] = false;
+          }
+          if (scalar_result_write_mask == 0b1111) {
+            live_temps[alu_instr.scalar_dest()] = false;
+          }
+        }
+        if (writes_previous_scalar) {
+          live_previous_scalar = false;
+        }
+        if (changed_state & ucode::kAluOpChangedStatePredicate) {
+          live_predicate = false;
+        }
+        if (changed_state & ucode::kAluOpChangedStateAddressRegister) {
+          live_address_register = false;
+        }
+      }
+
+      // Constants relative to the loop index are a bail-out, there are no
+      // loops in the straight line.
+      auto read_constant = [&](uint32_t operand) {
+        if (!alu_instr.src_const_is_addressed(operand)) {
+          return true;
+        }
+        if (!alu_instr.is_const_address_register_relative()) {
+          return false;
+        }
+        live_address_register = true;
+        return true;
+      };
+      auto read_operand = [&](uint32_t operand) {
+        if (!alu_instr.src_is_temp(operand)) {
+          return read_constant(operand);
+        }
+        uint32_t src_reg = alu_instr.src_reg(operand);
+        if (ucode::AluInstruction::is_src_temp_relative(src_reg)) {
+          return false;
+        }
+        live_temps[ucode::AluInstruction::src_temp_reg(src_reg)] = true;
+        return true;
+      };
+      if (vector_executed) {
+        for (uint32_t j = 0; j < 3; ++j) {
+          if (vector_opcode_info.operand_components_used[j] &&
+              !read_operand(1 + j)) {
+            return false;
+          }
+        }
+      }
+      switch (scalar_opcode_info.operand_count) {
+        case 1:
+          if (!read_operand(3)) {
+            return false;
+          }
+          break;
+        case 2:
+          if (!read_constant(3)) {
+            return false;
+          }
+          live_temps[alu_instr.scalar_const_reg_op_src_temp_reg()] = true;
+          break;
+      }
+      if (DoesAluScalarOpcodeReadPreviousScalar(scalar_opcode)) {
+        live_previous_scalar = true;
+      }
+    }
+    if (instruction.is_predicated) {
+      live_predicate = true;
+    }
+    instructions_kept[i] = true;
+  }
+  size_t kept_count = 0;
+  for (size_t i = 0; i < instructions_out.size(); ++i) {
+    if (instructions_kept[i]) {
+      instructions_out[kept_count++] = instructions_out[i];
+    }
+  }
+  instructions_out.resize(kept_count);
+  return true;
+}
+
+void ShaderInterpreter::ExecuteStraightLine(
+    const StraightLineInstruction* instructions, size_t instruction_count) {
+  state_.Reset();
+
+  for (size_t i = 0; i < instruction_count; ++i) {
+    const StraightLineInstruction& instruction = instructions[i];
+    if (instruction.is_predicated &&
+        instruction.predicate_condition != state_.predicate) {
+      continue;
+    }
+    const uint32_t* instruction_dwords =
+        &ucode_[3 * instruction.instruction_index];
+    if (instruction.is_fetch) {
+      const ucode::FetchInstruction& fetch_instr =
+          *reinterpret_cast<const ucode::FetchInstruction*>(instruction_dwords);
+      if (fetch_instr.opcode() == ucode::FetchOpcode::kVertexFetch) {
+        ExecuteVertexFetchInstruction(fetch_instr.vertex_fetch());
+      } else {
+        float zero_result[4] = {};
+        StoreFetchResult(fetch_instr.dest(), fetch_instr.is_dest_relative(),
+                         fetch_instr.dest_swizzle(), zero_result);
+      }
+    } else {
+      ExecuteAluInstruction(
+          *reinterpret_cast<const ucode::AluInstruction*>(instruction_dwords));
+    }
+  }
+}
+
 const std::array<float, 4> ShaderInterpreter::GetFloatConstant(
     uint32_t address, bool is_relative, bool relative_address_is_a0) const {
   int32_t index = int32_t(address);
@@ -14,6 +14,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/shader.h"
@@ -69,6 +70,30 @@ class ShaderInterpreter {
 
   void Execute();
 
+  // An ALU or a fetch instruction of a shader with the control flow resolved.
+  struct StraightLineInstruction {
+    // In 3-dword units in the ucode.
+    uint32_t instruction_index;
+    bool is_fetch;
+    // Combined from the exec and the instruction predication.
+    bool is_predicated;
+    bool predicate_condition;
+  };
+  // Resolves the control flow of a vertex shader for the current bool
+  // constants, and leaves only the instructions contributing to the position,
+  // the point size and the vertex kill exports, so that many vertices may be
+  // executed without decoding the control flow and running the unrelated
+  // instructions for every vertex. Returns false if the shader can't be
+  // represented this way (has loops, predicated jumps or calls, relative temp
+  // register addressing, or is too long).
+  static bool BuildPositionStraightLine(
+      const uint32_t* ucode, const RegisterFile& register_file,
+      std::vector<StraightLineInstruction>& instructions_out);
+  // The ucode set with SetShader must be the one the instructions were built
+  // from. Memory export allocations are not reported to the export sink.
+  void ExecuteStraightLine(const StraightLineInstruction* instructions,
+                           size_t instruction_count);
+
  private:
   struct State {
     ucode::VertexFetchInstruction vfetch_full_last;
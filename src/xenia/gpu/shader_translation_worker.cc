@@ -0,0 +1,32 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/shader_translation_worker.h"
+
+#include <utility>
+
+#include "xenia/base/assert.h"
+
+namespace xe {
+namespace gpu {
+
+void ShaderTranslationWorker::Start(std::function<bool()> function) {
+  assert_true(task_group_.is_done());
+  task_group_.Submit(
+      [this, function = std::move(function)]() { result_ = function(); },
+      xe::threading::TaskPriority::kLatencyCritical);
+}
+
+bool ShaderTranslationWorker::Await() {
+  task_group_.Wait();
+  return result_;
+}
+
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,43 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_SHADER_TRANSLATION_WORKER_H_
+#define XENIA_GPU_SHADER_TRANSLATION_WORKER_H_
+
+#include <functional>
+
+#include "xenia/base/task_scheduler.h"
+
+namespace xe {
+namespace gpu {
+
+// Translates a shader in parallel with another one being translated on the
+// command processor thread - such as the pixel shader of a draw while the
+// vertex shader is translated, if both are new - with a separate translator
+// instance owned by the caller, as a latency-critical task of the shared task
+// scheduler.
+class ShaderTranslationWorker {
+ public:
+  // Starts executing the translation function in a task. Nothing accessed by
+  // the function may be used by the caller until Await returns.
+  void Start(std::function<bool()> function);
+  // Waits for the function passed to the last Start to complete, running it
+  // on the calling thread if no worker has taken it yet, and returns its
+  // result.
+  bool Await();
+
+ private:
+  xe::threading::TaskGroup task_group_;
+  bool result_ = false;
+};
+
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_SHADER_TRANSLATION_WORKER_H_
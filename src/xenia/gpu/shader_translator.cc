@@ -330,10 +330,14 @@ uint32_t Shader::GetInterpolatorInputMask(reg::SQ_PROGRAM_CNTL sq_program_cntl,
                                           reg::SQ_CONTEXT_MISC sq_context_misc,
                                           uint32_t& param_gen_pos_out) const {
   assert_true(type() == xenos::ShaderType::kPixel);
-  uint32_t interpolator_count = std::min(
-      xenos::kMaxInterpolators,
-      std::max(register_static_address_bound(),
-               GetDynamicAddressableRegisterCount(sq_program_cntl.ps_num_reg)));
+  // Not using GetDynamicAddressableRegisterCount, which is rounded up.
+  uint32_t interpolator_count = register_static_address_bound();
+  if (uses_register_dynamic_addressing() &&
+      !(sq_program_cntl.ps_num_reg & 0x80)) {
+    interpolator_count =
+        std::max(interpolator_count, sq_program_cntl.ps_num_reg + uint32_t(1));
+  }
+  interpolator_count = std::min(xenos::kMaxInterpolators, interpolator_count);
   uint32_t interpolator_mask = (UINT32_C(1) << interpolator_count) - 1;
   if (sq_program_cntl.param_gen &&
       sq_context_misc.param_gen_pos < interpolator_count) {
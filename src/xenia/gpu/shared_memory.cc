@@ -13,12 +13,42 @@
 
 #include "xenia/base/assert.h"
 #include "xenia/base/bit_range.h"
+#include "xenia/base/counters.h"
+#include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/profiling.h"
 
+DEFINE_uint32(
+    shared_memory_upload_merge_gap_pages, 4,
+    "Maximum number of already valid pages between two ranges of shared memory "
+    "to be uploaded for the ranges to be merged into one copy. Re-uploading "
+    "unchanged data is usually cheaper than recording an additional copy.",
+    "GPU");
+DEFINE_uint32(
+    shared_memory_unprotect_write_streak, 0,
+    "Number of consecutive submissions in which a page of shared memory must "
+    "be written by the CPU for write protection of the page to be dropped. "
+    "Such pages, usually dynamic vertex buffers, are then assumed to be "
+    "modified once per submission instead of causing an access violation "
+    "for every rewrite. Writes to them within a submission, however, may be "
+    "missed. 0 to always use write protection.",
+    "GPU");
+DEFINE_uint32(
+    shared_memory_sparse_min_allocation_kb, 64,
+    "Smallest allocation of host GPU memory for shared memory emulation with "
+    "sparse binding, in KB, rounded up to a power of two and the host "
+    "alignment requirements. Regions where half of a 4 MB block is used are "
+    "allocated fully. 4096 or more to always allocate 4 MB blocks.",
+    "GPU");
+
 namespace xe {
 namespace gpu {
 
+static xe::counters::Counter& upload_bytes_counter =
+    xe::counters::GetCounter("gpu/shared_memory/upload_bytes");
+static xe::counters::Counter& invalidations_counter =
+    xe::counters::GetCounter("gpu/shared_memory/invalidations");
+
 SharedMemory::SharedMemory(Memory& memory) : memory_(memory) {
   page_size_log2_ = xe::log2_ceil(uint32_t(xe::memory::page_size()));
 }
@@ -48,17 +78,39 @@ void SharedMemory::InitializeCommon() {
          8 * num_system_page_flags_entries);
   memset(system_page_flags_valid_and_gpu_written_, 0,
          8 * num_system_page_flags_entries);
+
+  unprotect_write_streak_ =
+      std::min(cvars::shared_memory_unprotect_write_streak, uint32_t(UINT8_MAX));
+  if (unprotect_write_streak_) {
+    cpu_written_pages_.resize(num_system_page_flags_entries);
+    cpu_write_streak_pages_.resize(num_system_page_flags_entries);
+    cpu_write_streaks_.resize(kBufferSize >> page_size_log2_);
+    unprotected_pages_.resize(num_system_page_flags_entries);
+    unprotected_pages_submissions_ = 0;
+  }
+
   memory_invalidation_callback_handle_ =
       memory_.RegisterPhysicalMemoryInvalidationCallback(
           MemoryInvalidationCallbackThunk, this);
 }
 
-void SharedMemory::InitializeSparseHostGpuMemory(uint32_t granularity_log2) {
+void SharedMemory::InitializeSparseHostGpuMemory(
+    uint32_t granularity_log2, uint32_t min_granularity_log2) {
   assert_true(granularity_log2 <= kBufferSizeLog2);
+  assert_true(min_granularity_log2 <= granularity_log2);
   assert_true(host_gpu_memory_sparse_granularity_log2_ == UINT32_MAX);
-  host_gpu_memory_sparse_granularity_log2_ = granularity_log2;
+  uint32_t small_granularity_log2 =
+      xe::log2_ceil(std::max(cvars::shared_memory_sparse_min_allocation_kb,
+                             uint32_t(1))) +
+      10;
+  small_granularity_log2 = std::min(
+      std::max(small_granularity_log2, min_granularity_log2), granularity_log2);
+  host_gpu_memory_sparse_block_granules_log2_ =
+      granularity_log2 - small_granularity_log2;
+  host_gpu_memory_sparse_granularity_log2_ = small_granularity_log2;
   host_gpu_memory_sparse_allocated_.resize(
-      size_t(1) << (std::max(kBufferSizeLog2 - granularity_log2, uint32_t(6)) -
+      size_t(1) << (std::max(kBufferSizeLog2 - small_granularity_log2,
+                             uint32_t(6)) -
                     6));
 }
 
@@ -88,6 +140,13 @@ void SharedMemory::ShutdownCommon() {
     memory_invalidation_callback_handle_ = nullptr;
   }
 
+  if (host_gpu_memory_sparse_allocations_) {
+    XELOGGPU(
+        "Shared memory: {} MB of host GPU memory was allocated in {} sparse "
+        "bindings",
+        (host_gpu_memory_sparse_used_bytes_ + ((1 << 20) - 1)) >> 20,
+        host_gpu_memory_sparse_allocations_);
+  }
   if (host_gpu_memory_sparse_used_bytes_) {
     host_gpu_memory_sparse_used_bytes_ = 0;
     COUNT_profile_set("gpu/shared_memory/host_gpu_memory_sparse_used_mb", 0);
@@ -100,12 +159,23 @@ void SharedMemory::ShutdownCommon() {
   host_gpu_memory_sparse_allocated_.clear();
   host_gpu_memory_sparse_allocated_.shrink_to_fit();
   host_gpu_memory_sparse_granularity_log2_ = UINT32_MAX;
+  host_gpu_memory_sparse_block_granules_log2_ = 0;
   memory::DeallocFixed(system_page_flags_valid_, 0,
                        memory::DeallocationType::kRelease);
   system_page_flags_valid_ = nullptr;
   system_page_flags_valid_and_gpu_resolved_ = nullptr;
   system_page_flags_valid_and_gpu_written_ = nullptr;
   num_system_page_flags_ = 0;
+
+  unprotect_write_streak_ = 0;
+  cpu_written_pages_.clear();
+  cpu_written_pages_.shrink_to_fit();
+  cpu_write_streak_pages_.clear();
+  cpu_write_streak_pages_.shrink_to_fit();
+  cpu_write_streaks_.clear();
+  cpu_write_streaks_.shrink_to_fit();
+  unprotected_pages_.clear();
+  unprotected_pages_.shrink_to_fit();
 }
 
 void SharedMemory::ClearCache() {
@@ -301,6 +371,32 @@ void SharedMemory::RangeWrittenByGpu(uint32_t start, uint32_t length,
   MakeRangeValid(start, length, true, is_resolve);
 }
 
+bool SharedMemory::IsRangeGpuWritten(uint32_t start, uint32_t length) {
+  if (length == 0 || start >= kBufferSize) {
+    return false;
+  }
+  length = std::min(length, kBufferSize - start);
+  uint32_t last = start + length - 1;
+  uint32_t page_first = start >> page_size_log2_;
+  uint32_t page_last = last >> page_size_log2_;
+  uint32_t block_first = page_first >> 6;
+  uint32_t block_last = page_last >> 6;
+  auto global_lock = global_critical_region_.Acquire();
+  for (uint32_t i = block_first; i <= block_last; ++i) {
+    uint64_t range_bits = UINT64_MAX;
+    if (i == block_first) {
+      range_bits &= ~((uint64_t(1) << (page_first & 63)) - 1);
+    }
+    if (i == block_last && (page_last & 63) != 63) {
+      range_bits &= (uint64_t(1) << ((page_last & 63) + 1)) - 1;
+    }
+    if (system_page_flags_valid_and_gpu_written_[i] & range_bits) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool SharedMemory::AllocateSparseHostGpuMemoryRange(
     uint32_t offset_allocations, uint32_t length_allocations) {
   assert_always(
@@ -323,6 +419,7 @@ void SharedMemory::MakeRangeValid(uint32_t start, uint32_t length,
   uint32_t valid_block_first = valid_page_first >> 6;
   uint32_t valid_block_last = valid_page_last >> 6;
 
+  bool any_unprotected = false;
   {
     auto global_lock = global_critical_region_.Acquire();
 
@@ -346,15 +443,122 @@ void SharedMemory::MakeRangeValid(uint32_t start, uint32_t length,
       } else {
         system_page_flags_valid_and_gpu_resolved_[i] &= ~valid_bits;
       }
+      if (!unprotected_pages_.empty()) {
+        // GPU-written data can't be reuploaded from the guest memory, so CPU
+        // writes to it must be caught exactly.
+        if (written_by_gpu) {
+          unprotected_pages_[i] &= ~valid_bits;
+        } else if (unprotected_pages_[i] & valid_bits) {
+          any_unprotected = true;
+        }
+      }
     }
   }
 
-  if (memory_invalidation_callback_handle_) {
+  if (!memory_invalidation_callback_handle_) {
+    return;
+  }
+  if (!any_unprotected) {
     memory().EnablePhysicalMemoryAccessCallbacks(
         valid_page_first << page_size_log2_,
         (valid_page_last - valid_page_first + 1) << page_size_log2_, true,
         false);
+    return;
+  }
+  // Only protect the pages not polled in BeginSubmission. Only modified on the
+  // command processor thread, so safe to access without the lock.
+  uint32_t protect_page_first = UINT32_MAX;
+  for (uint32_t i = valid_page_first; i <= valid_page_last; ++i) {
+    if (!(unprotected_pages_[i >> 6] & (uint64_t(1) << (i & 63)))) {
+      if (protect_page_first == UINT32_MAX) {
+        protect_page_first = i;
+      }
+      continue;
+    }
+    if (protect_page_first != UINT32_MAX) {
+      memory().EnablePhysicalMemoryAccessCallbacks(
+          protect_page_first << page_size_log2_,
+          (i - protect_page_first) << page_size_log2_, true, false);
+      protect_page_first = UINT32_MAX;
+    }
+  }
+  if (protect_page_first != UINT32_MAX) {
+    memory().EnablePhysicalMemoryAccessCallbacks(
+        protect_page_first << page_size_log2_,
+        (valid_page_last + 1 - protect_page_first) << page_size_log2_, true,
+        false);
+  }
+}
+
+void SharedMemory::BeginSubmission() {
+  if (unprotected_pages_.empty()) {
+    return;
+  }
+
+  SCOPE_profile_cpu_f("gpu");
+
+  // Periodically protect all the pages again in case they're not rewritten
+  // constantly anymore.
+  bool reprotect = ++unprotected_pages_submissions_ >=
+                   kUnprotectedPagesReprotectIntervalSubmissions;
+  if (reprotect) {
+    unprotected_pages_submissions_ = 0;
+  }
+
+  uint32_t unprotected_page_count = 0;
+  auto global_lock = global_critical_region_.Acquire();
+  for (uint32_t i = 0; i < num_system_page_flags_; ++i) {
+    uint64_t written = cpu_written_pages_[i];
+    cpu_written_pages_[i] = 0;
+    uint64_t unprotected = unprotected_pages_[i];
+
+    // Update the streaks of consecutive submissions with CPU writes, breaking
+    // them for pages not written during the last submission.
+    uint64_t streak_pages_remaining = written | cpu_write_streak_pages_[i];
+    uint64_t streak_pages = 0;
+    uint32_t streak_page_index;
+    while (xe::bit_scan_forward(streak_pages_remaining, &streak_page_index)) {
+      uint64_t streak_page_bit = uint64_t(1) << streak_page_index;
+      streak_pages_remaining &= ~streak_page_bit;
+      uint8_t& streak = cpu_write_streaks_[(i << 6) + streak_page_index];
+      if (!(written & streak_page_bit)) {
+        streak = 0;
+        continue;
+      }
+      if (++streak >= unprotect_write_streak_) {
+        streak = 0;
+        unprotected |= streak_page_bit;
+      } else {
+        streak_pages |= streak_page_bit;
+      }
+    }
+    cpu_write_streak_pages_[i] = streak_pages;
+    unprotected &= ~system_page_flags_valid_and_gpu_written_[i];
+
+    // Assume that the unprotected pages have been modified.
+    uint64_t invalidate = system_page_flags_valid_[i] & unprotected;
+    system_page_flags_valid_[i] &= ~invalidate;
+    system_page_flags_valid_and_gpu_resolved_[i] &= ~invalidate;
+    while (invalidate) {
+      uint32_t run_first = xe::tzcnt(invalidate);
+      uint32_t run_length = xe::tzcnt(~(invalidate >> run_first));
+      FireWatches((i << 6) + run_first, (i << 6) + run_first + run_length - 1,
+                  false);
+      if (run_first + run_length >= 64) {
+        break;
+      }
+      invalidate &= ~((uint64_t(1) << (run_first + run_length)) - 1);
+    }
+
+    // Invalidated pages will be protected when requested again.
+    if (reprotect) {
+      unprotected = 0;
+    }
+    unprotected_pages_[i] = unprotected;
+    unprotected_page_count += xe::bit_count(unprotected);
   }
+  COUNT_profile_set("gpu/shared_memory/unprotected_pages",
+                    unprotected_page_count);
 }
 
 void SharedMemory::UnlinkWatchRange(WatchRange* range) {
@@ -419,10 +623,35 @@ bool SharedMemory::RequestRange(uint32_t start, uint32_t length,
     TryFindUploadRange(block_first, block_last, page_first, page_last,
                        any_data_resolved, range_start, current_upload_range,
                        uploads);
-  }
-  if (range_start != UINT32_MAX) {
-    uploads[current_upload_range++] =
-        (std::make_pair(range_start, page_last + 1 - range_start));
+    if (range_start != UINT32_MAX) {
+      uploads[current_upload_range++] =
+          (std::make_pair(range_start, page_last + 1 - range_start));
+    }
+    // Merge ranges separated by short runs of valid pages. Pages that have
+    // been written by the GPU must not be overwritten with the stale guest
+    // memory contents, so gaps containing them are kept.
+    uint32_t merge_gap_pages = cvars::shared_memory_upload_merge_gap_pages;
+    if (merge_gap_pages && current_upload_range > 1) {
+      unsigned int merged_upload_range = 0;
+      for (unsigned int i = 1; i < current_upload_range; ++i) {
+        std::pair<uint32_t, uint32_t>& merged = uploads[merged_upload_range];
+        uint32_t gap_first = merged.first + merged.second;
+        uint32_t gap_end = uploads[i].first;
+        bool merge = gap_end - gap_first <= merge_gap_pages;
+        for (uint32_t j = gap_first; merge && j < gap_end; ++j) {
+          if (system_page_flags_valid_and_gpu_written_[j >> 6] &
+              (uint64_t(1) << (j & 63))) {
+            merge = false;
+          }
+        }
+        if (merge) {
+          merged.second = gap_end + uploads[i].second - merged.first;
+        } else {
+          uploads[++merged_upload_range] = uploads[i];
+        }
+      }
+      current_upload_range = merged_upload_range + 1;
+    }
   }
   if (any_data_resolved_out) {
     *any_data_resolved_out = any_data_resolved;
@@ -431,6 +660,12 @@ bool SharedMemory::RequestRange(uint32_t start, uint32_t length,
     return true;
   }
 
+  uint64_t upload_page_count = 0;
+  for (unsigned int i = 0; i < current_upload_range; ++i) {
+    upload_page_count += uploads[i].second;
+  }
+  upload_bytes_counter.Increment(upload_page_count << page_size_log2_);
+
   return UploadRanges(uploads, current_upload_range);
 }
 
@@ -552,6 +787,7 @@ std::pair<uint32_t, uint32_t> SharedMemory::MemoryInvalidationCallback(
   }
   length = std::min(length, kBufferSize - physical_address_start);
   uint32_t physical_address_last = physical_address_start + (length - 1);
+  invalidations_counter.Increment();
 
   uint32_t page_first = physical_address_start >> page_size_log2_;
   uint32_t page_last = physical_address_last >> page_size_log2_;
@@ -560,6 +796,20 @@ std::pair<uint32_t, uint32_t> SharedMemory::MemoryInvalidationCallback(
 
   auto global_lock = global_critical_region_.Acquire();
 
+  if (!cpu_written_pages_.empty()) {
+    // Only the pages actually written, not the widened range.
+    for (uint32_t i = block_first; i <= block_last; ++i) {
+      uint64_t written_bits = UINT64_MAX;
+      if (i == block_first) {
+        written_bits &= ~((uint64_t(1) << (page_first & 63)) - 1);
+      }
+      if (i == block_last && (page_last & 63) != 63) {
+        written_bits &= (uint64_t(1) << ((page_last & 63) + 1)) - 1;
+      }
+      cpu_written_pages_[i] |= system_page_flags_valid_[i] & written_bits;
+    }
+  }
+
   if (!exact_range) {
     // Check if a somewhat wider range (up to 256 KB with 4 KB pages) can be
     // invalidated - if no GPU-written data nearby that was not intended to be
@@ -707,48 +957,92 @@ void SharedMemory::ReleaseTraceDownloadRanges() {
 
 bool SharedMemory::EnsureHostGpuMemoryAllocated(uint32_t start,
                                                 uint32_t length) {
-  if (host_gpu_memory_sparse_granularity_log2_ != UINT32_MAX && length) {
-    if (start <= kBufferSize && (kBufferSize - start) >= length) {
-      uint32_t page_first = start >> page_size_log2_;
-      uint32_t page_last = (start + length - 1) >> page_size_log2_;
-      uint32_t allocation_first = page_first << page_size_log2_ >>
-                                  host_gpu_memory_sparse_granularity_log2_;
-      uint32_t allocation_last = page_last << page_size_log2_ >>
-                                 host_gpu_memory_sparse_granularity_log2_;
-      while (true) {
-        std::pair<size_t, size_t> allocation_range =
-            xe::bit_range::NextUnsetRange(
-                host_gpu_memory_sparse_allocated_.data(), allocation_first,
-                allocation_last - allocation_first + 1);
-        if (!allocation_range.second) {
-          break;
-        }
-        if (!AllocateSparseHostGpuMemoryRange(
-                uint32_t(allocation_range.first),
-                uint32_t(allocation_range.second))) {
-          return false;
+  if (host_gpu_memory_sparse_granularity_log2_ == UINT32_MAX || !length) {
+    return true;
+  }
+  if (start > kBufferSize || (kBufferSize - start) < length) {
+    return false;
+  }
+  uint32_t page_first = start >> page_size_log2_;
+  uint32_t page_last = (start + length - 1) >> page_size_log2_;
+  uint32_t allocation_first =
+      page_first << page_size_log2_ >> host_gpu_memory_sparse_granularity_log2_;
+  uint32_t allocation_last =
+      page_last << page_size_log2_ >> host_gpu_memory_sparse_granularity_log2_;
+  uint32_t block_granules_log2 = host_gpu_memory_sparse_block_granules_log2_;
+  if (!block_granules_log2) {
+    return AllocateUnsetSparseHostGpuMemory(allocation_first, allocation_last);
+  }
+  // Allocate the rest of densely used blocks at once, so they're not
+  // fragmented into many small allocations (and binding calls) over time.
+  bool small_allocations_allowed = host_gpu_memory_sparse_allocations_ <
+                                   kHostGpuMemorySparseMaxSmallAllocations;
+  uint32_t block_granules = uint32_t(1) << block_granules_log2;
+  uint32_t ensure_first = UINT32_MAX, ensure_last = 0;
+  for (uint32_t block = allocation_first >> block_granules_log2;
+       block <= allocation_last >> block_granules_log2; ++block) {
+    uint32_t block_allocation_first = block << block_granules_log2;
+    uint32_t block_allocation_last = block_allocation_first + block_granules - 1;
+    uint32_t range_first = std::max(allocation_first, block_allocation_first);
+    uint32_t range_last = std::min(allocation_last, block_allocation_last);
+    bool allocate_block = !small_allocations_allowed;
+    if (!allocate_block) {
+      uint32_t block_granules_allocated = 0;
+      for (uint32_t i = block_allocation_first; i <= block_allocation_last;
+           i += 64) {
+        uint64_t word = host_gpu_memory_sparse_allocated_[i >> 6];
+        if (block_granules < 64) {
+          word = (word >> (i & 63)) & ((uint64_t(1) << block_granules) - 1);
         }
-        xe::bit_range::SetRange(host_gpu_memory_sparse_allocated_.data(),
-                                allocation_range.first,
-                                allocation_range.second);
-        ++host_gpu_memory_sparse_allocations_;
-        COUNT_profile_set(
-            "gpu/shared_memory/host_gpu_memory_sparse_allocations",
-            host_gpu_memory_sparse_allocations_);
-        host_gpu_memory_sparse_used_bytes_ +=
-            uint32_t(allocation_range.second)
-            << host_gpu_memory_sparse_granularity_log2_;
-        COUNT_profile_set(
-            "gpu/shared_memory/host_gpu_memory_sparse_used_mb",
-            (host_gpu_memory_sparse_used_bytes_ + ((1 << 20) - 1)) >> 20);
-        allocation_first =
-            uint32_t(allocation_range.first + allocation_range.second);
+        block_granules_allocated += xe::bit_count(word);
       }
-    } else {
+      allocate_block = block_granules_allocated * 2 >= block_granules;
+    }
+    if (allocate_block) {
+      range_first = block_allocation_first;
+      range_last = block_allocation_last;
+    }
+    if (ensure_first != UINT32_MAX && range_first == ensure_last + 1) {
+      ensure_last = range_last;
+      continue;
+    }
+    if (ensure_first != UINT32_MAX &&
+        !AllocateUnsetSparseHostGpuMemory(ensure_first, ensure_last)) {
       return false;
     }
-  } else {
-    return true;
+    ensure_first = range_first;
+    ensure_last = range_last;
+  }
+  return ensure_first == UINT32_MAX ||
+         AllocateUnsetSparseHostGpuMemory(ensure_first, ensure_last);
+}
+
+bool SharedMemory::AllocateUnsetSparseHostGpuMemory(uint32_t allocation_first,
+                                                    uint32_t allocation_last) {
+  while (true) {
+    std::pair<size_t, size_t> allocation_range = xe::bit_range::NextUnsetRange(
+        host_gpu_memory_sparse_allocated_.data(), allocation_first,
+        allocation_last - allocation_first + 1);
+    if (!allocation_range.second) {
+      break;
+    }
+    if (!AllocateSparseHostGpuMemoryRange(uint32_t(allocation_range.first),
+                                          uint32_t(allocation_range.second))) {
+      return false;
+    }
+    xe::bit_range::SetRange(host_gpu_memory_sparse_allocated_.data(),
+                            allocation_range.first, allocation_range.second);
+    ++host_gpu_memory_sparse_allocations_;
+    COUNT_profile_set("gpu/shared_memory/host_gpu_memory_sparse_allocations",
+                      host_gpu_memory_sparse_allocations_);
+    host_gpu_memory_sparse_used_bytes_ +=
+        uint32_t(allocation_range.second)
+        << host_gpu_memory_sparse_granularity_log2_;
+    COUNT_profile_set(
+        "gpu/shared_memory/host_gpu_memory_sparse_used_mb",
+        (host_gpu_memory_sparse_used_bytes_ + ((1 << 20) - 1)) >> 20);
+    allocation_first =
+        uint32_t(allocation_range.first + allocation_range.second);
   }
   return true;
 }
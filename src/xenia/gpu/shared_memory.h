@@ -102,11 +102,27 @@ class SharedMemory {
   // regions in those pages.
   void RangeWrittenByGpu(uint32_t start, uint32_t length, bool is_resolve);
 
+  // Whether any page in the range contains data written by the GPU and not
+  // modified by the CPU since, meaning the guest memory copy of the range is
+  // stale and it must be read from the host GPU memory.
+  bool IsRangeGpuWritten(uint32_t start, uint32_t length);
+
+  Memory& memory() const { return memory_; }
+
+  // Call when a new submission is opened. If dropping write protection for
+  // pages rewritten by the CPU in many consecutive submissions is enabled,
+  // invalidates such pages, and updates the set of them.
+  virtual void BeginSubmission();
+
  protected:
   SharedMemory(Memory& memory);
   // Call in implementation-specific initialization.
   void InitializeCommon();
-  void InitializeSparseHostGpuMemory(uint32_t granularity_log2);
+  // Regions of the buffer are first allocated with min_granularity_log2 (if
+  // enabled by the configuration), and with granularity_log2 blocks once they
+  // are densely used.
+  void InitializeSparseHostGpuMemory(uint32_t granularity_log2,
+                                     uint32_t min_granularity_log2);
   // Call last in implementation-specific shutdown, also callable from the
   // destructor.
   void ShutdownCommon();
@@ -117,10 +133,10 @@ class SharedMemory {
   static constexpr uint32_t kHostGpuMemoryOptimalSparseAllocationLog2 = 22;
   static_assert(kHostGpuMemoryOptimalSparseAllocationLog2 <= kBufferSizeLog2);
 
-  Memory& memory() const { return memory_; }
-
   uint32_t page_size_log2() const { return page_size_log2_; }
 
+  // The smallest granularity of allocations, AllocateSparseHostGpuMemoryRange
+  // arguments are in its units.
   uint32_t host_gpu_memory_sparse_granularity_log2() const {
     return host_gpu_memory_sparse_granularity_log2_;
   }
@@ -174,7 +190,15 @@ class SharedMemory {
   uint32_t page_size_log2_;
 
   bool EnsureHostGpuMemoryAllocated(uint32_t start, uint32_t length);
+  bool AllocateUnsetSparseHostGpuMemory(uint32_t allocation_first,
+                                        uint32_t allocation_last);
+  // After this many allocations, only whole blocks are allocated, to stay far
+  // from the limit of the number of allocations on Windows (4096).
+  static constexpr uint32_t kHostGpuMemorySparseMaxSmallAllocations = 512;
   uint32_t host_gpu_memory_sparse_granularity_log2_ = UINT32_MAX;
+  // Log2 of the number of allocation granules in a block that is allocated
+  // fully once half of it is used.
+  uint32_t host_gpu_memory_sparse_block_granules_log2_ = 0;
   std::vector<uint64_t> host_gpu_memory_sparse_allocated_;
   uint32_t host_gpu_memory_sparse_allocations_ = 0;
   uint32_t host_gpu_memory_sparse_used_bytes_ = 0;
@@ -218,6 +242,20 @@ class SharedMemory {
            *system_page_flags_valid_and_gpu_written_ = nullptr,
            *system_page_flags_valid_and_gpu_resolved_ = nullptr;
   unsigned num_system_page_flags_ = 0;
+
+  // Pages rewritten by the CPU in this many consecutive submissions are not
+  // protected, but invalidated in every BeginSubmission instead. 0 if always
+  // protecting, in this case the vectors below are empty.
+  uint32_t unprotect_write_streak_ = 0;
+  static constexpr uint32_t kUnprotectedPagesReprotectIntervalSubmissions =
+      1024;
+  // Bits for each 64 system pages.
+  std::vector<uint64_t> cpu_written_pages_;
+  std::vector<uint64_t> cpu_write_streak_pages_;
+  std::vector<uint64_t> unprotected_pages_;
+  // Number of consecutive submissions with CPU writes for each system page.
+  std::vector<uint8_t> cpu_write_streaks_;
+  uint32_t unprotected_pages_submissions_ = 0;
   static std::pair<uint32_t, uint32_t> MemoryInvalidationCallbackThunk(
       void* context_ptr, uint32_t physical_address_start, uint32_t length,
       bool exact_range);
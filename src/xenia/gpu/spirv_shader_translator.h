@@ -34,7 +34,7 @@ class SpirvShaderTranslator : public ShaderTranslator {
     // TODO(Triang3l): Change to 0xYYYYMMDD once it's out of the rapid
     // prototyping stage (easier to do small granular updates with an
     // incremental counter).
-    static constexpr uint32_t kVersion = 6;
+    static constexpr uint32_t kVersion = 7;
 
     enum class DepthStencilMode : uint32_t {
       kNoModifiers,
@@ -60,6 +60,10 @@ class SpirvShaderTranslator : public ShaderTranslator {
       // Pipeline stage and input configuration.
       Shader::HostVertexShaderType host_vertex_shader_type
           : Shader::kHostVertexShaderTypeBitCount;
+      // Whether all vertex fetches use vertex_fetch_endian rather than the
+      // endianness from the fetch constant (static_vertex_fetch_endian).
+      uint32_t vertex_fetch_endian_static : 1;
+      xenos::Endian vertex_fetch_endian : 2;
     } vertex;
     struct PixelShaderModification {
       // uint32_t 0.
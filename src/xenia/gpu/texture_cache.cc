@@ -10,10 +10,13 @@
 #include "xenia/gpu/texture_cache.h"
 
 #include "xenia/base/clock.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/profiling.h"
+#include "xenia/base/xxhash.h"
 #include "xenia/gpu/gpu_flags.h"
+#include "xenia/memory.h"
 
 DEFINE_int32(
     draw_resolution_scale_x, 1,
@@ -59,10 +62,34 @@ DEFINE_uint32(
     "textures - so with 2x2 resolution scaling, the soft limit will be 360 + "
     "96 MB, and with 3x3, it will be 360 + 216 MB.",
     "GPU");
+DEFINE_uint32(
+    texture_cache_memory_budget_percent, 90,
+    "Percentage of the video memory budget given by the OS to the emulator "
+    "above which the least recently used textures will be destroyed as soon "
+    "as possible, regardless of texture_cache_memory_limit_soft, to avoid "
+    "stuttering caused by paging of video memory. The usage of the budget "
+    "includes all the video memory of the emulator, not only textures. 0 to "
+    "only use the texture_cache_memory_limit values.",
+    "GPU");
+DEFINE_bool(
+    texture_cache_content_hashing, false,
+    "Hash the guest data of the textures being loaded, and if another texture "
+    "with the same format and size has been loaded from identical data at a "
+    "different address, copy its host data instead of untiling and converting "
+    "the guest data again. Speeds up loading in games streaming the same "
+    "assets to different locations. Direct3D 12 only.",
+    "GPU");
 
 namespace xe {
 namespace gpu {
 
+static xe::counters::Counter& texture_hits_counter =
+    xe::counters::GetCounter("gpu/texture_cache/hits");
+static xe::counters::Counter& texture_misses_counter =
+    xe::counters::GetCounter("gpu/texture_cache/misses");
+static xe::counters::Counter& texture_fetch_rewrites_counter =
+    xe::counters::GetCounter("gpu/texture_cache/unchanged_fetch_rewrites");
+
 const TextureCache::LoadShaderInfo
     TextureCache::load_shader_info_[kLoadShaderCount] = {
         // k8bpb
@@ -193,23 +220,56 @@ void TextureCache::CompletedSubmissionUpdated(
     uint64_t completed_submission_index) {
   // If memory usage is too high, destroy unused textures.
   uint64_t current_time = xe::Clock::QueryHostUptimeMillis();
-  // texture_cache_memory_limit_render_to_texture is assumed to be included in
-  // texture_cache_memory_limit_soft and texture_cache_memory_limit_hard, at 1x,
-  // so subtracting 1 from the scale.
-  uint32_t limit_scaled_resolve_add_mb =
-      cvars::texture_cache_memory_limit_render_to_texture *
-      (draw_resolution_scale_x() * draw_resolution_scale_y() - 1);
-  uint32_t limit_soft_mb =
-      cvars::texture_cache_memory_limit_soft + limit_scaled_resolve_add_mb;
-  uint32_t limit_hard_mb =
-      cvars::texture_cache_memory_limit_hard + limit_scaled_resolve_add_mb;
-  uint32_t limit_soft_lifetime =
-      cvars::texture_cache_memory_limit_soft_lifetime * 1000;
+  uint64_t cvar_version = cvar::GetChangeVersion();
+  if (memory_limits_cvar_version_ != cvar_version) {
+    if (memory_limits_cvar_version_ != UINT64_MAX) {
+      // Apply a changed budget percentage immediately rather than after the
+      // next periodic query.
+      memory_budget_query_time_ = 0;
+      memory_budget_excess_ = 0;
+    }
+    memory_limits_cvar_version_ = cvar_version;
+    // texture_cache_memory_limit_render_to_texture is assumed to be included
+    // in texture_cache_memory_limit_soft and texture_cache_memory_limit_hard,
+    // at 1x, so subtracting 1 from the scale.
+    uint32_t limit_scaled_resolve_add_mb =
+        cvars::texture_cache_memory_limit_render_to_texture *
+        (draw_resolution_scale_x() * draw_resolution_scale_y() - 1);
+    memory_limit_soft_mb_ =
+        cvars::texture_cache_memory_limit_soft + limit_scaled_resolve_add_mb;
+    memory_limit_hard_mb_ =
+        cvars::texture_cache_memory_limit_hard + limit_scaled_resolve_add_mb;
+    memory_limit_soft_lifetime_ms_ =
+        cvars::texture_cache_memory_limit_soft_lifetime * 1000;
+  }
+  uint32_t limit_soft_mb = memory_limit_soft_mb_;
+  uint32_t limit_hard_mb = memory_limit_hard_mb_;
+  uint32_t limit_soft_lifetime = memory_limit_soft_lifetime_ms_;
+  // Querying the budget may be relatively expensive, and the usage doesn't
+  // change instantly after destroying resources anyway.
+  if (cvars::texture_cache_memory_budget_percent &&
+      current_time >= memory_budget_query_time_ + kMemoryBudgetQueryInterval) {
+    memory_budget_query_time_ = current_time;
+    memory_budget_excess_ = 0;
+    uint64_t budget, usage;
+    if (GetHostMemoryBudget(budget, usage)) {
+      uint64_t budget_limit =
+          budget *
+          std::min(cvars::texture_cache_memory_budget_percent, uint32_t(100)) /
+          100;
+      if (usage > budget_limit) {
+        memory_budget_excess_ = usage - budget_limit;
+      }
+      COUNT_profile_set("gpu/memory_budget_mb", uint32_t(budget >> 20));
+      COUNT_profile_set("gpu/memory_budget_usage_mb", uint32_t(usage >> 20));
+    }
+  }
   bool destroyed_any = false;
   while (texture_used_first_ != nullptr) {
     uint64_t total_host_memory_usage_mb =
         (textures_total_host_memory_usage_ + ((UINT32_C(1) << 20) - 1)) >> 20;
-    bool limit_hard_exceeded = total_host_memory_usage_mb > limit_hard_mb;
+    bool limit_hard_exceeded =
+        total_host_memory_usage_mb > limit_hard_mb || memory_budget_excess_;
     if (total_host_memory_usage_mb <= limit_soft_mb && !limit_hard_exceeded) {
       break;
     }
@@ -230,17 +290,26 @@ void TextureCache::CompletedSubmissionUpdated(
       // any texture has been destroyed.
       ResetTextureBindings();
     }
+    memory_budget_excess_ -=
+        std::min(memory_budget_excess_, texture->GetHostMemoryUsage());
+    ++evicted_texture_count_;
     // Remove the texture from the map and destroy it via its unique_ptr.
     auto found_texture_it = textures_.find(texture->key());
     assert_true(found_texture_it != textures_.end());
     if (found_texture_it != textures_.end()) {
       assert_true(found_texture_it->second.get() == texture);
+      RecentTexture& recent_texture =
+          recent_textures_[GetRecentTextureIndex(texture->key())];
+      if (recent_texture.texture == texture) {
+        recent_texture.texture = nullptr;
+      }
       textures_.erase(found_texture_it);
       // `texture` is invalid now.
     }
   }
   if (destroyed_any) {
     COUNT_profile_set("gpu/texture_cache/textures", textures_.size());
+    COUNT_profile_set("gpu/texture_cache/evicted", evicted_texture_count_);
   }
 }
 
@@ -251,6 +320,11 @@ void TextureCache::BeginSubmission(uint64_t new_submission_index) {
 }
 
 void TextureCache::BeginFrame() {
+  COUNT_profile_set("gpu/texture_cache/hits", texture_hit_count_);
+  COUNT_profile_set("gpu/texture_cache/render_to_texture_loads",
+                    render_to_texture_load_count_);
+  recent_resolve_count_ = 0;
+
   // In case there was a failure to create something in the previous frame, make
   // sure bindings are reset so a new attempt will surely be made if the texture
   // is requested again.
@@ -265,6 +339,13 @@ void TextureCache::MarkRangeAsResolved(uint32_t start_unscaled,
   start_unscaled &= 0x1FFFFFFF;
   length_unscaled = std::min(length_unscaled, 0x20000000 - start_unscaled);
 
+  RecentResolve& recent_resolve = recent_resolves_[recent_resolve_next_];
+  recent_resolve.start = start_unscaled;
+  recent_resolve.length = length_unscaled;
+  recent_resolve_next_ = (recent_resolve_next_ + 1) % kRecentResolveCount;
+  recent_resolve_count_ =
+      std::min(recent_resolve_count_ + 1, kRecentResolveCount);
+
   if (IsDrawResolutionScaled()) {
     uint32_t page_first = start_unscaled >> 12;
     uint32_t page_last = (start_unscaled + length_unscaled - 1) >> 12;
@@ -331,17 +412,28 @@ void TextureCache::RequestTextures(uint32_t used_texture_mask) {
     textures_remaining = xe::clear_lowest_bit(textures_remaining);
     TextureBinding& binding = texture_bindings_[index];
     xenos::xe_gpu_texture_fetch_t fetch = regs.GetTextureFetch(index);
+    static_assert(sizeof(binding.fetch_constant) == sizeof(fetch));
+    texture_bindings_in_sync_ |= index_bit;
+    if (binding.fetch_constant_valid &&
+        !std::memcmp(binding.fetch_constant, &fetch, sizeof(fetch))) {
+      // Rewritten with the same value - nothing to update.
+      texture_fetch_rewrites_counter.Increment();
+      continue;
+    }
     TextureKey old_key = binding.key;
     uint8_t old_swizzled_signs = binding.swizzled_signs;
     BindingInfoFromFetchConstant(fetch, binding.key, &binding.swizzled_signs);
-    texture_bindings_in_sync_ |= index_bit;
     if (!binding.key.is_valid) {
       if (old_key.is_valid) {
         bindings_changed |= index_bit;
       }
       binding.Reset();
+      std::memcpy(binding.fetch_constant, &fetch, sizeof(fetch));
+      binding.fetch_constant_valid = true;
       continue;
     }
+    std::memcpy(binding.fetch_constant, &fetch, sizeof(fetch));
+    binding.fetch_constant_valid = true;
     uint32_t old_host_swizzle = binding.host_swizzle;
     binding.host_swizzle =
         GuestToHostSwizzle(fetch.swizzle, GetHostFormatSwizzle(binding.key));
@@ -484,6 +576,8 @@ TextureCache::Texture::Texture(TextureCache& texture_cache,
 }
 
 TextureCache::Texture::~Texture() {
+  texture_cache_.RemoveTextureContentHash(*this);
+
   if (mips_watch_handle_) {
     texture_cache().shared_memory().UnwatchMemoryRange(mips_watch_handle_);
   }
@@ -574,6 +668,9 @@ void TextureCache::WatchCallback(const global_unique_lock_type& global_lock,
 
 void TextureCache::DestroyAllTextures(bool from_destructor) {
   ResetTextureBindings(from_destructor);
+  for (RecentTexture& recent_texture : recent_textures_) {
+    recent_texture.texture = nullptr;
+  }
   textures_.clear();
   COUNT_profile_set("gpu/texture_cache/textures", 0);
 }
@@ -618,10 +715,23 @@ TextureCache::Texture* TextureCache::FindOrCreateTexture(TextureKey key) {
   // Try to find an existing texture.
   // TODO(Triang3l): Reuse a texture with mip_page unchanged, but base_page
   // previously 0, now not 0, to save memory - common case in streaming.
+  RecentTexture& recent_texture = recent_textures_[GetRecentTextureIndex(key)];
+  if (recent_texture.texture && recent_texture.key == key) {
+    ++texture_hit_count_;
+    texture_hits_counter.Increment();
+    return recent_texture.texture;
+  }
   auto found_texture_it = textures_.find(key);
   if (found_texture_it != textures_.end()) {
-    return found_texture_it->second.get();
+    ++texture_hit_count_;
+    texture_hits_counter.Increment();
+    recent_texture.key = key;
+    recent_texture.texture = found_texture_it->second.get();
+    return recent_texture.texture;
   }
+  ++texture_miss_count_;
+  texture_misses_counter.Increment();
+  COUNT_profile_set("gpu/texture_cache/misses", texture_miss_count_);
 
   // Create the texture and add it to the map.
   Texture* texture;
@@ -635,10 +745,22 @@ TextureCache::Texture* TextureCache::FindOrCreateTexture(TextureKey key) {
     texture =
         textures_.emplace(key, std::move(new_texture)).first->second.get();
   }
+  recent_texture.key = key;
+  recent_texture.texture = texture;
   COUNT_profile_set("gpu/texture_cache/textures", textures_.size());
   texture->LogAction("Created");
   return texture;
 }
+uint32_t TextureCache::GetRecentTextureIndex(const TextureKey& key) {
+  uint64_t key_parts[2];
+  static_assert(sizeof(key_parts) == sizeof(key));
+  std::memcpy(key_parts, &key, sizeof(key));
+  // Fibonacci hashing of the folded key.
+  uint64_t key_folded = key_parts[0] ^ key_parts[1];
+  return uint32_t((key_folded * UINT64_C(0x9E3779B97F4A7C15)) >>
+                  (64 - kRecentTextureCountLog2));
+}
+
 void TextureCache::LoadTexturesData(Texture** textures, uint32_t n_textures) {
   assert_true(n_textures <= 64);
   if (n_textures < 2) {
@@ -733,7 +855,7 @@ void TextureCache::LoadTexturesData(Texture** textures, uint32_t n_textures) {
     }
 
     // Actually load the texture data.
-    if (!LoadTextureDataFromResidentMemoryImpl(
+    if (!LoadTextureDataFromResidentMemory(
             texture, (index_base_outdated & (1ULL << i)) != 0,
             (index_mips_outdated & (1ULL << i)) != 0)) {
       continue;
@@ -829,8 +951,8 @@ bool TextureCache::LoadTextureData(Texture& texture) {
   }
 
   // Actually load the texture data.
-  if (!LoadTextureDataFromResidentMemoryImpl(texture, base_outdated,
-                                             mips_outdated)) {
+  if (!LoadTextureDataFromResidentMemory(texture, base_outdated,
+                                         mips_outdated)) {
     return false;
   }
 
@@ -853,6 +975,121 @@ bool TextureCache::LoadTextureData(Texture& texture) {
   return true;
 }
 
+bool TextureCache::LoadTextureDataFromResidentMemory(Texture& texture,
+                                                     bool load_base,
+                                                     bool load_mips) {
+  // The host data will not correspond to the old hash anymore.
+  RemoveTextureContentHash(texture);
+
+  if (load_base && texture.GetGuestBaseSize()) {
+    uint32_t base_address = texture.key().base_page << 12;
+    uint32_t base_size = texture.GetGuestBaseSize();
+    for (size_t i = 0; i < recent_resolve_count_; ++i) {
+      const RecentResolve& recent_resolve = recent_resolves_[i];
+      if (base_address >= recent_resolve.start &&
+          base_address - recent_resolve.start + uint64_t(base_size) <=
+              recent_resolve.length) {
+        ++render_to_texture_load_count_;
+        break;
+      }
+    }
+  }
+
+  uint64_t content_hash;
+  if (!cvars::texture_cache_content_hashing ||
+      !IsTextureHostDataCopySupported() ||
+      !GetTextureContentHash(texture, load_base, load_mips, content_hash)) {
+    return LoadTextureDataFromResidentMemoryImpl(texture, load_base, load_mips);
+  }
+
+  // Textures in the index keep the host data they were hashed with even if
+  // their guest memory has been modified since, until they are reloaded.
+  bool copied = false;
+  auto source_range = content_hash_textures_.equal_range(content_hash);
+  for (auto it = source_range.first; it != source_range.second; ++it) {
+    Texture& source = *it->second;
+    TextureKey source_key = source.key();
+    if ((source_key.base_page != 0) != (texture.key().base_page != 0) ||
+        (source_key.mip_page != 0) != (texture.key().mip_page != 0)) {
+      continue;
+    }
+    source_key.base_page = texture.key().base_page;
+    source_key.mip_page = texture.key().mip_page;
+    if (source_key == texture.key() && CopyTextureHostData(texture, source)) {
+      copied = true;
+      ++content_hash_copy_count_;
+      COUNT_profile_set("gpu/texture_cache/content_hash_copies",
+                        content_hash_copy_count_);
+      texture.LogAction("Copied the data from an identical");
+      break;
+    }
+  }
+  if (!copied &&
+      !LoadTextureDataFromResidentMemoryImpl(texture, load_base, load_mips)) {
+    return false;
+  }
+  content_hash_textures_.emplace(content_hash, &texture);
+  texture.SetContentHashIndexed(true, content_hash);
+  return true;
+}
+
+bool TextureCache::GetTextureContentHash(const Texture& texture,
+                                         bool load_base, bool load_mips,
+                                         uint64_t& hash_out) const {
+  TextureKey key = texture.key();
+  // Resolution-scaled data is not in the guest memory.
+  if (key.scaled_resolve) {
+    return false;
+  }
+  uint32_t base_address = key.base_page << 12;
+  uint32_t base_size = texture.GetGuestBaseSize();
+  uint32_t mips_address = key.mip_page << 12;
+  uint32_t mips_size = texture.GetGuestMipsSize();
+  // Only whole textures can be shared, and the guest memory is stale where the
+  // GPU has written the data.
+  if ((base_size &&
+       (!load_base || shared_memory().IsRangeGpuWritten(base_address,
+                                                        base_size))) ||
+      (mips_size &&
+       (!load_mips ||
+        shared_memory().IsRangeGpuWritten(mips_address, mips_size)))) {
+    return false;
+  }
+  // The same data stored in the same way - the key with only whether the base
+  // and the mips are present remaining from the addresses.
+  key.base_page = uint32_t(key.base_page != 0);
+  key.mip_page = uint32_t(key.mip_page != 0);
+  const Memory& memory = shared_memory().memory();
+  XXH3_state_t hash_state;
+  XXH3_64bits_reset_withSeed(&hash_state, XXH3_64bits(&key, sizeof(key)));
+  if (base_size) {
+    XXH3_64bits_update(&hash_state,
+                       memory.TranslatePhysical<const void*>(base_address),
+                       base_size);
+  }
+  if (mips_size) {
+    XXH3_64bits_update(&hash_state,
+                       memory.TranslatePhysical<const void*>(mips_address),
+                       mips_size);
+  }
+  hash_out = XXH3_64bits_digest(&hash_state);
+  return true;
+}
+
+void TextureCache::RemoveTextureContentHash(Texture& texture) {
+  if (!texture.content_hash_indexed()) {
+    return;
+  }
+  auto range = content_hash_textures_.equal_range(texture.content_hash());
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == &texture) {
+      content_hash_textures_.erase(it);
+      break;
+    }
+  }
+  texture.SetContentHashIndexed(false);
+}
+
 void TextureCache::BindingInfoFromFetchConstant(
     const xenos::xe_gpu_texture_fetch_t& fetch, TextureKey& key_out,
     uint8_t* swizzled_signs_out) {
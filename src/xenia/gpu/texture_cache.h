@@ -85,6 +85,10 @@ class TextureCache {
 
   virtual void ClearCache();
 
+  // Cumulative counts of texture requests since the creation of the cache.
+  uint64_t texture_hit_count() const { return texture_hit_count_; }
+  uint64_t texture_miss_count() const { return texture_miss_count_; }
+
   virtual void CompletedSubmissionUpdated(uint64_t completed_submission_index);
   virtual void BeginSubmission(uint64_t new_submission_index);
   virtual void BeginFrame();
@@ -257,6 +261,15 @@ class TextureCache {
     }
     bool IsResolved() const { return base_resolved_ || mips_resolved_; }
 
+    // Hash of the guest data the current host data has been loaded from, if
+    // the texture is in the content hash index of the texture cache.
+    bool content_hash_indexed() const { return content_hash_indexed_; }
+    uint64_t content_hash() const { return content_hash_; }
+    void SetContentHashIndexed(bool indexed, uint64_t content_hash = 0) {
+      content_hash_indexed_ = indexed;
+      content_hash_ = content_hash;
+    }
+
     bool base_outdated(const global_unique_lock_type& global_lock) const {
       return base_outdated_;
     }
@@ -305,6 +318,9 @@ class TextureCache {
     bool base_resolved_;
     bool mips_resolved_;
 
+    bool content_hash_indexed_ = false;
+    uint64_t content_hash_ = 0;
+
     // These are to be accessed within the global critical region to synchronize
     // with shared memory.
     // Whether the recent base level data needs reloading from the memory.
@@ -501,6 +517,10 @@ class TextureCache {
     // Signed version of the texture if the data in the signed version is
     // different on the host.
     Texture* texture_signed;
+    // The fetch constant the binding was last derived from, for skipping the
+    // update when it's rewritten with the same value.
+    uint32_t fetch_constant[6];
+    bool fetch_constant_valid;
 
     TextureBinding() { Reset(); }
 
@@ -577,6 +597,20 @@ class TextureCache {
   virtual bool LoadTextureDataFromResidentMemoryImpl(Texture& texture,
                                                      bool load_base,
                                                      bool load_mips) = 0;
+  // Returns the video memory budget given by the OS to the process and the
+  // current usage of it by the whole process, or false if not available.
+  virtual bool GetHostMemoryBudget(uint64_t& budget_out,
+                                   uint64_t& usage_out) const {
+    return false;
+  }
+  // Whether CopyTextureHostData is implemented, so the guest data of the loaded
+  // textures is worth hashing (texture_cache_content_hashing).
+  virtual bool IsTextureHostDataCopySupported() const { return false; }
+  // Copies the whole host data between two textures with keys different only
+  // in the guest addresses, instead of loading the same guest data again.
+  virtual bool CopyTextureHostData(Texture& dest, Texture& source) {
+    return false;
+  }
 
   // Converts a texture fetch constant to a texture key, normalizing and
   // validating the values, or creating an invalid key, and also gets the
@@ -602,6 +636,16 @@ class TextureCache {
  private:
   void UpdateTexturesTotalHostMemoryUsage(uint64_t add, uint64_t subtract);
 
+  // Loads the data via LoadTextureDataFromResidentMemoryImpl, or, if another
+  // texture has host data loaded from the same guest data, copies it.
+  bool LoadTextureDataFromResidentMemory(Texture& texture, bool load_base,
+                                         bool load_mips);
+  // Returns false if the guest data of the whole texture can't be hashed, for
+  // instance, if it's not fully loaded or is not in the guest memory.
+  bool GetTextureContentHash(const Texture& texture, bool load_base,
+                             bool load_mips, uint64_t& hash_out) const;
+  void RemoveTextureContentHash(Texture& texture);
+
   // Shared memory callback for texture data invalidation.
   static void WatchCallback(const global_unique_lock_type& global_lock,
                             void* context, void* data, uint64_t argument,
@@ -645,9 +689,59 @@ class TextureCache {
 
   std::unordered_map<TextureKey, std::unique_ptr<Texture>, TextureKey::Hasher>
       textures_;
+  // Direct-mapped cache of the recent lookups in textures_, as mostly the same
+  // textures are requested draw after draw. Entries are removed along with the
+  // textures.
+  struct RecentTexture {
+    TextureKey key;
+    Texture* texture = nullptr;
+  };
+  static constexpr uint32_t kRecentTextureCountLog2 = 6;
+  static uint32_t GetRecentTextureIndex(const TextureKey& key);
+  std::array<RecentTexture, size_t(1) << kRecentTextureCountLog2>
+      recent_textures_;
 
   uint64_t textures_total_host_memory_usage_ = 0;
 
+  // The texture_cache_memory_ limits, rebuilt when the cvars change.
+  uint64_t memory_limits_cvar_version_ = UINT64_MAX;
+  uint32_t memory_limit_soft_mb_ = 0;
+  uint32_t memory_limit_hard_mb_ = 0;
+  uint32_t memory_limit_soft_lifetime_ms_ = 0;
+
+  // In milliseconds.
+  static constexpr uint64_t kMemoryBudgetQueryInterval = 100;
+  uint64_t memory_budget_query_time_ = 0;
+  // How much above texture_cache_memory_budget_percent of the budget the usage
+  // was as of the last query, minus the textures destroyed since.
+  uint64_t memory_budget_excess_ = 0;
+
+  // Statistics for the profiler.
+  uint64_t texture_hit_count_ = 0;
+  uint64_t texture_miss_count_ = 0;
+  uint64_t evicted_texture_count_ = 0;
+
+  // Textures by the hash of the guest data their host data was loaded from, for
+  // copying the host data to textures with the same contents at different
+  // addresses (texture_cache_content_hashing). The hash includes the key
+  // without the addresses, though the full key still needs to be compared.
+  std::unordered_multimap<uint64_t, Texture*> content_hash_textures_;
+  uint64_t content_hash_copy_count_ = 0;
+
+  // Destination ranges of the most recent resolves in the current frame, for
+  // detecting textures rendered to and sampled within one frame (such as in
+  // post-processing chains) - the candidates for bypassing the untiling and
+  // retiling through the shared memory.
+  struct RecentResolve {
+    uint32_t start;
+    uint32_t length;
+  };
+  static constexpr size_t kRecentResolveCount = 8;
+  std::array<RecentResolve, kRecentResolveCount> recent_resolves_;
+  size_t recent_resolve_count_ = 0;
+  size_t recent_resolve_next_ = 0;
+  uint64_t render_to_texture_load_count_ = 0;
+
   Texture* texture_used_first_ = nullptr;
   Texture* texture_used_last_ = nullptr;
 
@@ -19,6 +19,7 @@
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/xxhash.h"
+#include "xenia/gpu/texture_util.h"
 
 namespace xe {
 namespace gpu {
@@ -37,7 +38,7 @@ void CopySwapBlock(xenos::Endian endian, void* output, const void* input,
       break;
     case xenos::Endian::k16in32:  // Swap high and low 16 bits within a 32 bit
                                   // word
-      xe::copy_and_swap_16_in_32_unaligned(output, input, length);
+      xe::copy_and_swap_16_in_32_unaligned(output, input, length / 4);
       break;
     default:
     case xenos::Endian::kNone:
@@ -46,6 +47,31 @@ void CopySwapBlock(xenos::Endian endian, void* output, const void* input,
   }
 }
 
+// For whole rows written to upload buffers, which are usually write-combined
+// memory only read by the GPU.
+static void CopySwapRowNontemporal(xenos::Endian endian, void* output,
+                                   const void* input, size_t length) {
+#if XE_ARCH_AMD64 == 1
+  switch (endian) {
+    case xenos::Endian::k8in16:
+      xe::copy_and_swap_16_nontemporal(output, input, length / 2);
+      break;
+    case xenos::Endian::k8in32:
+      xe::copy_and_swap_32_nontemporal(output, input, length / 4);
+      break;
+    case xenos::Endian::k16in32:
+      xe::copy_and_swap_16_in_32_nontemporal(output, input, length / 4);
+      break;
+    default:
+    case xenos::Endian::kNone:
+      std::memcpy(output, input, length);
+      break;
+  }
+#else
+  CopySwapBlock(endian, output, input, length);
+#endif  // XE_ARCH_AMD64
+}
+
 void ConvertTexelCTX1ToR8G8(xenos::Endian endian, void* output,
                             const void* input, size_t length) {
   // https://fileadmin.cs.lth.se/cs/Personal/Michael_Doggett/talks/unc-xenos-doggett.pdf
@@ -153,6 +179,55 @@ void Untile(uint8_t* output_buffer, const uint8_t* input_buffer,
   }
 }
 
+void CopySwapTextureRows(uint8_t* host, const uint8_t* guest,
+                         const CopyRowsInfo& info, uint32_t row_first,
+                         uint32_t row_count) {
+  assert_true(row_first + row_count <= info.height_blocks * info.depth);
+  uint32_t bytes_per_block = UINT32_C(1) << info.bytes_per_block_log2;
+  if (!info.is_tiled) {
+    // Guest pitches are aligned to 256 bytes, and host pitches are aligned to
+    // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT, so swapping whole 32-bit words
+    // stays within the rows on both sides.
+    uint32_t row_length = xe::align(info.width_blocks * bytes_per_block, 16u);
+    for (uint32_t row = row_first; row < row_first + row_count; ++row) {
+      uint32_t z = row / info.height_blocks;
+      uint32_t y = row - z * info.height_blocks;
+      CopySwapRowNontemporal(
+          info.endian, host + size_t(info.host_pitch) * row,
+          guest + size_t(info.guest_pitch) *
+                      (z * info.guest_z_stride_block_rows + y),
+          row_length);
+    }
+    return;
+  }
+  // Blocks are contiguous along X in groups of 8 (for 1 byte per block) or 16
+  // bytes in tiled textures.
+  uint32_t group_size_log2 = info.bytes_per_block_log2 ? 4 : 3;
+  uint32_t group_size = UINT32_C(1) << group_size_log2;
+  uint32_t group_blocks_log2 = group_size_log2 - info.bytes_per_block_log2;
+  uint32_t group_count =
+      (info.width_blocks + ((UINT32_C(1) << group_blocks_log2) - 1)) >>
+      group_blocks_log2;
+  for (uint32_t row = row_first; row < row_first + row_count; ++row) {
+    uint32_t z = row / info.height_blocks;
+    uint32_t y = row - z * info.height_blocks;
+    uint8_t* host_row = host + size_t(info.host_pitch) * row;
+    for (uint32_t group = 0; group < group_count; ++group) {
+      int32_t x = int32_t(group << group_blocks_log2);
+      int32_t guest_offset =
+          info.is_3d ? texture_util::GetTiledOffset3D(
+                           x, int32_t(y), int32_t(z), info.guest_pitch,
+                           info.guest_z_stride_block_rows,
+                           info.bytes_per_block_log2)
+                     : texture_util::GetTiledOffset2D(
+                           x, int32_t(y), info.guest_pitch,
+                           info.bytes_per_block_log2);
+      CopySwapBlock(info.endian, host_row + (group << group_size_log2),
+                    guest + guest_offset, group_size);
+    }
+  }
+}
+
 }  //  namespace texture_conversion
 }  //  namespace gpu
 }  //  namespace xe
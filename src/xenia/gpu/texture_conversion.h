@@ -49,6 +49,30 @@ typedef struct UntileInfo {
 void Untile(uint8_t* output_buffer, const uint8_t* input_buffer,
             const UntileInfo* untile_info);
 
+// Copies a level of a texture, untiling it if needed and swapping the endian,
+// without changing the format of the blocks - like the pass-through texture
+// load shaders, for loading the texture on the CPU. Rows of blocks are indexed
+// as z * height_blocks + y, so disjoint row ranges may be copied in parallel.
+struct CopyRowsInfo {
+  bool is_tiled;
+  bool is_3d;
+  xenos::Endian endian;
+  uint32_t bytes_per_block_log2;
+  // In blocks for tiled textures, in bytes for linear textures.
+  uint32_t guest_pitch;
+  uint32_t guest_z_stride_block_rows;
+  uint32_t width_blocks;
+  uint32_t height_blocks;
+  uint32_t depth;
+  // In bytes, must be enough for width_blocks rounded up to 16 bytes, as whole
+  // 16-byte groups of blocks are written.
+  uint32_t host_pitch;
+};
+
+void CopySwapTextureRows(uint8_t* host, const uint8_t* guest,
+                         const CopyRowsInfo& info, uint32_t row_first,
+                         uint32_t row_count);
+
 }  // namespace texture_conversion
 }  // namespace gpu
 }  // namespace xe
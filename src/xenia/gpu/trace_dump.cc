@@ -9,13 +9,18 @@
 
 #include "xenia/gpu/trace_dump.h"
 
+#include <algorithm>
+
+#include "third_party/fmt/include/fmt/format.h"
 #include "third_party/stb/stb_image_write.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/string.h"
 #include "xenia/base/threading.h"
 #include "xenia/gpu/command_processor.h"
+#include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/graphics_system.h"
 #include "xenia/memory.h"
 #include "xenia/ui/file_picker.h"
@@ -30,6 +35,21 @@
 
 DEFINE_path(target_trace_file, "", "Specifies the trace file to load.", "GPU");
 DEFINE_path(trace_dump_path, "", "Output path for dumped files.", "GPU");
+DEFINE_int32(trace_dump_benchmark_iterations, 0,
+             "Number of times to replay all frames of the trace, measuring the "
+             "time taken by each, instead of dumping the last frame. The "
+             "results are written to a .benchmark.json file at the output "
+             "path. 0 to disable benchmarking.",
+             "GPU");
+DEFINE_int32(trace_dump_benchmark_warmup, 1,
+             "Number of replays of the trace before the measured benchmark "
+             "iterations, for populating the host caches.",
+             "GPU");
+DEFINE_path(trace_dump_benchmark_cache_root, "",
+            "Cache root to load the shader storage of the title the trace was "
+            "recorded from before benchmarking, to exclude pipeline creation "
+            "from the measurements.",
+            "GPU");
 
 namespace xe {
 namespace gpu {
@@ -119,6 +139,10 @@ bool TraceDump::Load(const std::filesystem::path& trace_file_path) {
 }
 
 int TraceDump::Run() {
+  if (cvars::trace_dump_benchmark_iterations > 0) {
+    return RunBenchmark();
+  }
+
   BeginHostCapture();
   player_->SeekFrame(0);
   player_->SeekCommand(
@@ -151,5 +175,207 @@ int TraceDump::Run() {
   return result;
 }
 
+void TraceDump::TakeGpuTimings(
+    std::vector<CommandProcessor::GpuTiming>& timings_out) {
+  CommandProcessor* command_processor = graphics_system_->command_processor();
+  auto taken_event = xe::threading::Event::CreateAutoResetEvent(false);
+  command_processor->CallInThread([command_processor, &timings_out,
+                                   &taken_event]() {
+    command_processor->TakeGpuTimings(timings_out);
+    taken_event->Set();
+  });
+  xe::threading::Wait(taken_event.get(), false);
+}
+
+int TraceDump::RunBenchmark() {
+  int frame_count = player_->frame_count();
+  if (!frame_count) {
+    XELOGE("Trace has no frames to benchmark");
+    return 1;
+  }
+  int iterations = cvars::trace_dump_benchmark_iterations;
+  int warmup = std::max(cvars::trace_dump_benchmark_warmup, 0);
+
+  uint32_t title_id = player_->header()->title_id;
+  if (!cvars::trace_dump_benchmark_cache_root.empty()) {
+    if (title_id) {
+      XELOGI("Loading the shader storage for title {:08X}", title_id);
+      graphics_system_->InitializeShaderStorage(
+          cvars::trace_dump_benchmark_cache_root, title_id, true);
+    } else {
+      XELOGW("Trace has no title ID, not loading the shader storage");
+    }
+  }
+
+  struct FrameStatistics {
+    uint32_t draw_count = 0;
+    uint32_t swap_count = 0;
+    double cpu_ms_total = 0.0;
+    double cpu_ms_min = 0.0;
+    double cpu_ms_max = 0.0;
+    double gpu_ms_total = 0.0;
+  };
+  std::vector<FrameStatistics> frame_statistics(frame_count);
+  for (int i = 0; i < frame_count; ++i) {
+    for (const auto& command : player_->frame(i)->commands) {
+      switch (command.type) {
+        case TraceReader::Frame::Command::Type::kDraw:
+          ++frame_statistics[i].draw_count;
+          break;
+        case TraceReader::Frame::Command::Type::kSwap:
+          ++frame_statistics[i].swap_count;
+          break;
+      }
+    }
+  }
+
+  CommandProcessor* command_processor = graphics_system_->command_processor();
+  CommandProcessor::CacheStatistics cache_statistics_start;
+  double tick_ms = 1000.0 / double(Clock::QueryHostTickFrequency());
+  uint64_t total_ticks = 0;
+  XELOGI("Benchmarking {} frames, {} warmup and {} measured iterations",
+         frame_count, warmup, iterations);
+  bool gpu_timestamps = cvars::gpu_timestamps;
+  std::vector<CommandProcessor::GpuTiming> gpu_timings;
+  // The operations of the last iteration, with the frame index in the trace.
+  std::vector<std::pair<int, CommandProcessor::GpuTiming>>
+      last_iteration_gpu_timings;
+  if (gpu_timestamps) {
+    // Start collecting.
+    TakeGpuTimings(gpu_timings);
+    gpu_timings.clear();
+  }
+  BeginHostCapture();
+  for (int iteration = -warmup; iteration < iterations; ++iteration) {
+    if (iteration == 0) {
+      cache_statistics_start = command_processor->GetCacheStatistics();
+    }
+    for (int i = 0; i < frame_count; ++i) {
+      uint64_t frame_start_ticks = Clock::QueryHostTickCount();
+      player_->PlayFrame(i);
+      player_->WaitOnPlayback();
+      uint64_t frame_ticks = Clock::QueryHostTickCount() - frame_start_ticks;
+      if (gpu_timestamps) {
+        // Awaiting the GPU after measuring the CPU time of the frame.
+        gpu_timings.clear();
+        TakeGpuTimings(gpu_timings);
+      }
+      if (iteration < 0) {
+        continue;
+      }
+      for (const CommandProcessor::GpuTiming& gpu_timing : gpu_timings) {
+        frame_statistics[i].gpu_ms_total += gpu_timing.gpu_us * 0.001;
+        if (iteration + 1 == iterations) {
+          last_iteration_gpu_timings.emplace_back(i, gpu_timing);
+        }
+      }
+      total_ticks += frame_ticks;
+      double frame_ms = double(frame_ticks) * tick_ms;
+      FrameStatistics& statistics = frame_statistics[i];
+      statistics.cpu_ms_total += frame_ms;
+      if (!iteration) {
+        statistics.cpu_ms_min = frame_ms;
+        statistics.cpu_ms_max = frame_ms;
+      } else {
+        statistics.cpu_ms_min = std::min(statistics.cpu_ms_min, frame_ms);
+        statistics.cpu_ms_max = std::max(statistics.cpu_ms_max, frame_ms);
+      }
+    }
+  }
+  EndHostCapture();
+  CommandProcessor::CacheStatistics cache_statistics_end =
+      command_processor->GetCacheStatistics();
+
+  uint64_t texture_hits =
+      cache_statistics_end.texture_hits - cache_statistics_start.texture_hits;
+  uint64_t texture_misses = cache_statistics_end.texture_misses -
+                            cache_statistics_start.texture_misses;
+  uint64_t texture_requests = texture_hits + texture_misses;
+  double total_ms = double(total_ticks) * tick_ms;
+
+  // Escape the characters special in JSON strings.
+  std::string trace_name = xe::path_to_utf8(trace_file_path_.filename());
+  std::string trace_name_escaped;
+  for (char c : trace_name) {
+    if (c == '"' || c == '\\') {
+      trace_name_escaped.push_back('\\');
+    }
+    trace_name_escaped.push_back(c);
+  }
+
+  std::string json;
+  fmt::format_to(std::back_inserter(json),
+                 "{{\n"
+                 "  \"trace\": \"{}\",\n"
+                 "  \"title_id\": \"{:08X}\",\n"
+                 "  \"iterations\": {},\n"
+                 "  \"warmup_iterations\": {},\n"
+                 "  \"total_cpu_ms\": {:.3f},\n"
+                 "  \"mean_iteration_cpu_ms\": {:.3f},\n"
+                 "  \"texture_cache\": {{\"hits\": {}, \"misses\": {}, "
+                 "\"hit_rate\": {:.4f}}},\n"
+                 "  \"frames\": [\n",
+                 trace_name_escaped, title_id, iterations, warmup, total_ms,
+                 total_ms / iterations, texture_hits, texture_misses,
+                 texture_requests ? double(texture_hits) / texture_requests
+                                  : 1.0);
+  for (int i = 0; i < frame_count; ++i) {
+    const FrameStatistics& statistics = frame_statistics[i];
+    fmt::format_to(std::back_inserter(json),
+                   "    {{\"index\": {}, \"draws\": {}, \"swaps\": {}, "
+                   "\"cpu_ms_mean\": {:.3f}, \"cpu_ms_min\": {:.3f}, "
+                   "\"cpu_ms_max\": {:.3f}",
+                   i, statistics.draw_count, statistics.swap_count,
+                   statistics.cpu_ms_total / iterations, statistics.cpu_ms_min,
+                   statistics.cpu_ms_max);
+    if (gpu_timestamps) {
+      fmt::format_to(std::back_inserter(json), ", \"gpu_ms_mean\": {:.3f}",
+                     statistics.gpu_ms_total / iterations);
+    }
+    fmt::format_to(std::back_inserter(json), "}}{}\n",
+                   i + 1 < frame_count ? "," : "");
+  }
+  json += "  ]";
+  if (gpu_timestamps) {
+    json += ",\n  \"gpu_operations\": [\n";
+    for (size_t i = 0; i < last_iteration_gpu_timings.size(); ++i) {
+      const std::pair<int, CommandProcessor::GpuTiming>& frame_gpu_timing =
+          last_iteration_gpu_timings[i];
+      const CommandProcessor::GpuTiming& gpu_timing = frame_gpu_timing.second;
+      fmt::format_to(
+          std::back_inserter(json),
+          "    {{\"frame\": {}, \"kind\": \"{}\", \"packet\": "
+          "\"{:08X}\", \"vertex_shader\": \"{:016X}\", "
+          "\"pixel_shader\": \"{:016X}\", \"gpu_us\": {:.3f}}}{}\n",
+          frame_gpu_timing.first,
+          CommandProcessor::GetGpuTimingKindName(gpu_timing.kind),
+          gpu_timing.packet_address, gpu_timing.vertex_shader_hash,
+          gpu_timing.pixel_shader_hash, gpu_timing.gpu_us,
+          i + 1 < last_iteration_gpu_timings.size() ? "," : "");
+    }
+    json += "  ]";
+  }
+  json += "\n}\n";
+
+  XELOGI("Benchmark: {:.3f} ms per iteration, texture cache hit rate {}/{}",
+         total_ms / iterations, texture_hits, texture_requests);
+
+  int result = 0;
+  auto json_path = base_output_path_;
+  json_path.replace_extension(".benchmark.json");
+  FILE* file = filesystem::OpenFile(json_path, "wb");
+  if (file) {
+    fwrite(json.data(), 1, json.size(), file);
+    fclose(file);
+  } else {
+    XELOGE("Unable to write the benchmark results to {}", json_path);
+    result = 1;
+  }
+
+  player_.reset();
+  emulator_.reset();
+  return result;
+}
+
 }  //  namespace gpu
 }  //  namespace xe
@@ -11,8 +11,10 @@
 #define XENIA_GPU_TRACE_DUMP_H_
 
 #include <string>
+#include <vector>
 
 #include "xenia/emulator.h"
+#include "xenia/gpu/command_processor.h"
 #include "xenia/gpu/shader.h"
 #include "xenia/gpu/trace_player.h"
 #include "xenia/gpu/trace_protocol.h"
@@ -47,6 +49,9 @@ class TraceDump {
   bool Setup();
   bool Load(const std::filesystem::path& trace_file_path);
   int Run();
+  int RunBenchmark();
+  // Awaits and takes the host GPU timings of the commands played back so far.
+  void TakeGpuTimings(std::vector<CommandProcessor::GpuTiming>& timings_out);
 
   std::filesystem::path trace_file_path_;
   std::filesystem::path base_output_path_;
@@ -9,14 +9,26 @@
 
 #include "xenia/gpu/trace_player.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <memory>
 
+#include "xenia/base/cvar.h"
 #include "xenia/gpu/command_processor.h"
 #include "xenia/gpu/graphics_system.h"
+#include "xenia/gpu/register_file.h"
 #include "xenia/gpu/registers.h"
 #include "xenia/gpu/xenos.h"
 #include "xenia/memory.h"
 
+DEFINE_int32(trace_checkpoint_interval, 64,
+             "Number of commands between the GPU state checkpoints recorded "
+             "while playing a frame of a trace, for seeking backwards in the "
+             "frame without playing it from the start. Each checkpoint takes "
+             "more than 10 MB of RAM for the EDRAM contents. 0 to disable.",
+             "GPU");
+
 namespace xe {
 namespace gpu {
 
@@ -53,7 +65,17 @@ void TracePlayer::SeekFrame(int target_frame) {
 
   assert_true(frame->start_ptr <= frame->end_ptr);
   PlayTrace(frame->start_ptr, frame->end_ptr - frame->start_ptr,
-            TracePlaybackMode::kBreakOnSwap, false);
+            TracePlaybackMode::kBreakOnSwap, false, 0);
+}
+
+void TracePlayer::PlayFrame(int target_frame, bool clear_caches) {
+  current_frame_index_ = target_frame;
+  auto frame = current_frame();
+  current_command_index_ = int(frame->commands.size()) - 1;
+
+  assert_true(frame->start_ptr <= frame->end_ptr);
+  PlayTrace(frame->start_ptr, frame->end_ptr - frame->start_ptr,
+            TracePlaybackMode::kBreakOnSwap, clear_caches, 0);
 }
 
 void TracePlayer::SeekCommand(int target_command) {
@@ -73,11 +95,16 @@ void TracePlayer::SeekCommand(int target_command) {
     const auto& previous_command = frame->commands[previous_command_index];
     PlayTrace(previous_command.end_ptr,
               command.end_ptr - previous_command.end_ptr,
-              TracePlaybackMode::kBreakOnSwap, false);
+              TracePlaybackMode::kBreakOnSwap, false,
+              previous_command_index + 1);
   } else {
-    // Full playback from frame start.
-    PlayTrace(frame->start_ptr, command.end_ptr - frame->start_ptr,
-              TracePlaybackMode::kBreakOnSwap, true);
+    // Playback from the nearest checkpoint or the frame start.
+    playing_trace_ = true;
+    int frame_index = current_frame_index_;
+    graphics_system_->command_processor()->CallInThread(
+        [this, frame_index, target_command]() {
+          SeekCommandOnThread(frame_index, target_command);
+        });
   }
 }
 
@@ -86,18 +113,118 @@ void TracePlayer::WaitOnPlayback() {
 }
 
 void TracePlayer::PlayTrace(const uint8_t* trace_data, size_t trace_size,
-                            TracePlaybackMode playback_mode,
-                            bool clear_caches) {
+                            TracePlaybackMode playback_mode, bool clear_caches,
+                            int first_command_index) {
   playing_trace_ = true;
+  int frame_index = current_frame_index_;
   graphics_system_->command_processor()->CallInThread([=, this]() {
-    PlayTraceOnThread(trace_data, trace_size, playback_mode, clear_caches);
+    PlayTraceOnThread(trace_data, trace_size, playback_mode, clear_caches,
+                      frame_index, first_command_index);
   });
 }
 
+void TracePlayer::SeekCommandOnThread(int frame_index, int target_command) {
+  const Frame* seek_frame = frame(frame_index);
+  const uint8_t* target_end_ptr = seek_frame->commands[target_command].end_ptr;
+  auto checkpoint_it = checkpoints_.end();
+  if (checkpoints_frame_index_ == frame_index) {
+    checkpoint_it = std::upper_bound(
+        checkpoints_.begin(), checkpoints_.end(), target_command,
+        [](int command_index, const Checkpoint& checkpoint) {
+          return command_index < checkpoint.command_index;
+        });
+    checkpoint_it = checkpoint_it != checkpoints_.begin()
+                        ? std::prev(checkpoint_it)
+                        : checkpoints_.end();
+  }
+  if (checkpoint_it == checkpoints_.end()) {
+    PlayTraceOnThread(seek_frame->start_ptr,
+                      target_end_ptr - seek_frame->start_ptr,
+                      TracePlaybackMode::kBreakOnSwap, true, frame_index, 0);
+    return;
+  }
+  graphics_system_->command_processor()->ClearCaches();
+  RestoreCheckpoint(size_t(checkpoint_it - checkpoints_.begin()));
+  int checkpoint_command_index = checkpoint_it->command_index;
+  const uint8_t* checkpoint_end_ptr =
+      seek_frame->commands[checkpoint_command_index].end_ptr;
+  PlayTraceOnThread(checkpoint_end_ptr, target_end_ptr - checkpoint_end_ptr,
+                    TracePlaybackMode::kBreakOnSwap, false, frame_index,
+                    checkpoint_command_index + 1);
+}
+
+void TracePlayer::RecordCheckpoint(int command_index) {
+  auto checkpoint_it = std::lower_bound(
+      checkpoints_.begin(), checkpoints_.end(), command_index,
+      [](const Checkpoint& checkpoint, int command_index) {
+        return checkpoint.command_index < command_index;
+      });
+  if (checkpoint_it != checkpoints_.end() &&
+      checkpoint_it->command_index == command_index) {
+    // Already recorded in a previous playback of the frame, with the memory
+    // written before it.
+    checkpoint_written_memory_.clear();
+    return;
+  }
+
+  auto memory = graphics_system_->memory();
+  auto command_processor = graphics_system_->command_processor();
+
+  Checkpoint checkpoint;
+  checkpoint.command_index = command_index;
+  checkpoint.edram_snapshot.reset(new uint8_t[xenos::kEdramSizeBytes]);
+  if (!command_processor->SaveEdramSnapshot(
+          checkpoint.edram_snapshot.get())) {
+    checkpoints_supported_ = false;
+    checkpoints_.clear();
+    checkpoint_written_memory_.clear();
+    return;
+  }
+  checkpoint.register_values.reset(
+      new uint32_t[RegisterFile::kRegisterCount]);
+  std::memcpy(checkpoint.register_values.get(),
+              graphics_system_->register_file()->values,
+              sizeof(uint32_t) * RegisterFile::kRegisterCount);
+  checkpoint.memory.reserve(checkpoint_written_memory_.size());
+  for (const auto& written_range : checkpoint_written_memory_) {
+    const uint8_t* written_data =
+        memory->TranslatePhysical(written_range.first);
+    checkpoint.memory.emplace_back(
+        written_range.first,
+        std::vector<uint8_t>(written_data,
+                             written_data + written_range.second));
+  }
+  checkpoint_written_memory_.clear();
+  checkpoints_.insert(checkpoint_it, std::move(checkpoint));
+}
+
+void TracePlayer::RestoreCheckpoint(size_t checkpoint_index) {
+  auto memory = graphics_system_->memory();
+  auto command_processor = graphics_system_->command_processor();
+
+  // The memory written by the trace before the checkpoint in the frame, with
+  // the later checkpoints overriding the earlier ones.
+  for (size_t i = 0; i <= checkpoint_index; ++i) {
+    for (const auto& written_range : checkpoints_[i].memory) {
+      std::memcpy(memory->TranslatePhysical(written_range.first),
+                  written_range.second.data(), written_range.second.size());
+      command_processor->TracePlaybackWroteMemory(
+          written_range.first, uint32_t(written_range.second.size()));
+    }
+  }
+  const Checkpoint& checkpoint = checkpoints_[checkpoint_index];
+  command_processor->RestoreRegisters(0, checkpoint.register_values.get(),
+                                      uint32_t(RegisterFile::kRegisterCount),
+                                      false);
+  command_processor->RestoreEdramSnapshot(checkpoint.edram_snapshot.get());
+  checkpoint_written_memory_.clear();
+}
+
 void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
                                     size_t trace_size,
                                     TracePlaybackMode playback_mode,
-                                    bool clear_caches) {
+                                    bool clear_caches, int frame_index,
+                                    int first_command_index) {
   auto memory = graphics_system_->memory();
   auto command_processor = graphics_system_->command_processor();
 
@@ -105,6 +232,21 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
     command_processor->ClearCaches();
   }
 
+  // Record the checkpoints at the ends of the commands in the frame.
+  const Frame* checkpoint_frame = nullptr;
+  int next_command_index = first_command_index;
+  if (first_command_index >= 0 && checkpoints_supported_ &&
+      cvars::trace_checkpoint_interval > 0) {
+    if (checkpoints_frame_index_ != frame_index) {
+      checkpoints_frame_index_ = frame_index;
+      checkpoints_.clear();
+    }
+    if (!first_command_index) {
+      checkpoint_written_memory_.clear();
+    }
+    checkpoint_frame = frame(frame_index);
+  }
+
   playback_percent_ = 0;
   auto trace_end = trace_data + trace_size;
 
@@ -112,7 +254,22 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
   auto trace_ptr = trace_data;
   bool pending_break = false;
   const PacketStartCommand* pending_packet = nullptr;
+  auto record_checkpoints = [&]() {
+    if (!checkpoint_frame) {
+      return;
+    }
+    while (checkpoints_supported_ &&
+           size_t(next_command_index) < checkpoint_frame->commands.size() &&
+           trace_ptr >=
+               checkpoint_frame->commands[next_command_index].end_ptr) {
+      if (!((next_command_index + 1) % cvars::trace_checkpoint_interval)) {
+        RecordCheckpoint(next_command_index);
+      }
+      ++next_command_index;
+    }
+  };
   while (trace_ptr < trace_data + trace_size) {
+    record_checkpoints();
     playback_percent_ = uint32_t(
         (float(trace_ptr - trace_data) / float(trace_end - trace_data)) *
         10000);
@@ -177,6 +334,10 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
         trace_ptr += cmd->encoded_length;
         command_processor->TracePlaybackWroteMemory(cmd->base_ptr,
                                                     cmd->decoded_length);
+        if (checkpoint_frame) {
+          checkpoint_written_memory_.emplace_back(cmd->base_ptr,
+                                                  cmd->decoded_length);
+        }
         break;
       }
       case TraceCommandType::kMemoryWrite: {
@@ -241,6 +402,7 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
       }
     }
   }
+  record_checkpoints();
 
   playing_trace_ = false;
 
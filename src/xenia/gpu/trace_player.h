@@ -11,7 +11,10 @@
 #define XENIA_GPU_TRACE_PLAYER_H_
 
 #include <atomic>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "xenia/base/threading.h"
 #include "xenia/gpu/trace_protocol.h"
@@ -43,14 +46,40 @@ class TracePlayer : public TraceReader {
 
   void SeekFrame(int target_frame);
   void SeekCommand(int target_command);
+  // Plays the whole frame even if it's the current one, for replaying the same
+  // frames multiple times.
+  void PlayFrame(int target_frame, bool clear_caches = false);
 
   void WaitOnPlayback();
 
  private:
+  // GPU state after a command of a frame, recorded every
+  // trace_checkpoint_interval commands while playing the frame, so seeking
+  // backwards in it only needs to play the commands after the nearest
+  // checkpoint rather than the whole frame from the start.
+  struct Checkpoint {
+    int command_index;
+    std::unique_ptr<uint32_t[]> register_values;
+    // Guest physical memory ranges written by the trace since the previous
+    // checkpoint or the start of the frame, with their contents at this
+    // checkpoint.
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> memory;
+    std::unique_ptr<uint8_t[]> edram_snapshot;
+  };
+
+  // If first_command_index is not -1, the trace data starts after the end of
+  // the previous command of the frame, and checkpoints are recorded for it.
   void PlayTrace(const uint8_t* trace_data, size_t trace_size,
-                 TracePlaybackMode playback_mode, bool clear_caches);
+                 TracePlaybackMode playback_mode, bool clear_caches,
+                 int first_command_index = -1);
   void PlayTraceOnThread(const uint8_t* trace_data, size_t trace_size,
-                         TracePlaybackMode playback_mode, bool clear_caches);
+                         TracePlaybackMode playback_mode, bool clear_caches,
+                         int frame_index, int first_command_index);
+  // Restores the nearest checkpoint before the command of the frame if it has
+  // been recorded, and plays the rest of the commands up to it.
+  void SeekCommandOnThread(int frame_index, int target_command);
+  void RecordCheckpoint(int command_index);
+  void RestoreCheckpoint(size_t checkpoint_index);
 
   GraphicsSystem* graphics_system_;
   int current_frame_index_;
@@ -58,6 +87,16 @@ class TracePlayer : public TraceReader {
   bool playing_trace_ = false;
   std::atomic<uint32_t> playback_percent_ = {0};
   std::unique_ptr<xe::threading::Event> playback_event_;
+
+  // Accessed only on the command processor thread.
+  // False if the command processor can't take EDRAM snapshots, as the
+  // render targets can't be restored then.
+  bool checkpoints_supported_ = true;
+  int checkpoints_frame_index_ = -1;
+  // Sorted by the command index.
+  std::vector<Checkpoint> checkpoints_;
+  // Guest physical memory ranges written since the last checkpoint.
+  std::vector<std::pair<uint32_t, uint32_t>> checkpoint_written_memory_;
 };
 
 }  // namespace gpu
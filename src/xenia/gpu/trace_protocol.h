@@ -23,7 +23,12 @@ static const char kTraceExtension[] = "xtr";
 // Other changes besides the file format may require bumps, such as
 // anything that changes what is recorded into the files (new GPU
 // command processor commands, etc).
-constexpr uint32_t kTraceFormatVersion = 1;
+constexpr uint32_t kTraceFormatVersion = 3;
+// Older versions that can still be read, with the differences from the current
+// version handled by the reader.
+// 1 - no frame index footer.
+// 2 - no zstd and duplicate memory encoding formats.
+constexpr uint32_t kTraceFormatVersionMinReadable = 1;
 
 // Trace file header identifying information about the trace.
 // This must be positioned at the start of the file and must only occur once.
@@ -95,6 +100,13 @@ enum class MemoryEncodingFormat {
   kNone,
   // Data is compressed with third_party/snappy.
   kSnappy,
+  // Data is compressed with third_party/zstd.
+  kZstd,
+  // Only for MemoryCommand. The data is the same as that of an earlier memory
+  // command, and the encoded data is the uint64_t offset of that command from
+  // the beginning of the trace file. The referenced command is never a
+  // duplicate itself.
+  kDuplicate,
 };
 
 // Represents the GPU reading or writing data from or to memory.
@@ -170,6 +182,21 @@ struct GammaRampCommand {
   uint32_t encoded_length;
 };
 
+// Set in TraceFrameIndexFooter::magic, 'XTRI'.
+constexpr uint32_t kTraceFrameIndexMagic = 0x49525458;
+
+// Written at the very end of the trace when it's closed, so the frames can be
+// located without parsing all the commands before them. It's preceded by the
+// index itself, frame_count uint64_t file offsets of the first command of each
+// frame, at frame_index_offset, which is also the end of the command stream.
+// Traces that were not closed properly don't have it.
+struct TraceFrameIndexFooter {
+  uint64_t frame_index_offset;
+  uint32_t frame_count;
+  // Set to kTraceFrameIndexMagic.
+  uint32_t magic;
+};
+
 }  // namespace gpu
 }  // namespace xe
 
@@ -12,6 +12,7 @@
 #include <cinttypes>
 
 #include "third_party/snappy/snappy.h"
+#include "third_party/zstd/lib/zstd.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/mapped_memory.h"
@@ -45,11 +46,16 @@ bool TraceReader::Open(const std::string_view path) {
   trace_size_ = mmap_->size();
 
   // Verify version.
+  if (trace_size_ < sizeof(TraceHeader)) {
+    XELOGE("Trace file is too small");
+    return false;
+  }
   auto header = reinterpret_cast<const TraceHeader*>(trace_data_);
-  if (header->version != kTraceFormatVersion) {
+  if (header->version < kTraceFormatVersionMinReadable ||
+      header->version > kTraceFormatVersion) {
     XELOGE("Trace format version mismatch, code has {}, file has {}",
            kTraceFormatVersion, header->version);
-    if (header->version < kTraceFormatVersion) {
+    if (header->version < kTraceFormatVersionMinReadable) {
       XELOGE("You need to regenerate your trace for the latest version");
     }
     return false;
@@ -62,21 +68,91 @@ bool TraceReader::Open(const std::string_view path) {
   XELOGI("    Commit: {}", commit_str);
   XELOGI("  Title ID: {}", header->title_id);
 
-  ParseTrace();
+  if (ReadFrameIndex()) {
+    XELOGI("Located {} frames using the frame index", frames_.size());
+  } else {
+    ParseTrace(trace_data_ + sizeof(TraceHeader), trace_data_ + trace_size_,
+               frames_);
+  }
 
   return true;
 }
 
 void TraceReader::Close() {
+  frames_.clear();
   mmap_.reset();
   trace_data_ = nullptr;
   trace_size_ = 0;
 }
 
-void TraceReader::ParseTrace() {
-  // Skip file header.
-  auto trace_ptr = trace_data_;
-  trace_ptr += sizeof(TraceHeader);
+const TraceReader::Frame* TraceReader::frame(int n) const {
+  Frame& frame = frames_[n];
+  if (!frame.is_parsed) {
+    frame.is_parsed = true;
+    std::vector<Frame> parsed_frames;
+    ParseTrace(frame.start_ptr, frame.end_ptr, parsed_frames);
+    if (parsed_frames.empty()) {
+      frame.command_tree = std::make_unique<CommandBuffer>();
+    } else {
+      if (parsed_frames.size() > 1) {
+        XELOGW("Frame {} in the trace frame index contains {} frames", n,
+               parsed_frames.size());
+      }
+      Frame& parsed_frame = parsed_frames.front();
+      frame.command_count = parsed_frame.command_count;
+      frame.commands = std::move(parsed_frame.commands);
+      frame.command_tree = std::move(parsed_frame.command_tree);
+    }
+  }
+  return &frame;
+}
+
+bool TraceReader::ReadFrameIndex() {
+  if (header()->version < 2 ||
+      trace_size_ < sizeof(TraceHeader) + sizeof(TraceFrameIndexFooter)) {
+    return false;
+  }
+  auto footer = reinterpret_cast<const TraceFrameIndexFooter*>(
+      trace_data_ + trace_size_ - sizeof(TraceFrameIndexFooter));
+  if (footer->magic != kTraceFrameIndexMagic) {
+    // Not closed properly.
+    XELOGW("Trace has no frame index, parsing the whole trace");
+    return false;
+  }
+  uint64_t frame_index_size = uint64_t(footer->frame_count) * sizeof(uint64_t);
+  if (footer->frame_index_offset < sizeof(TraceHeader) ||
+      footer->frame_index_offset + frame_index_size +
+              sizeof(TraceFrameIndexFooter) !=
+          trace_size_) {
+    XELOGE("Trace frame index is out of bounds");
+    return false;
+  }
+  auto frame_start_offsets = reinterpret_cast<const uint64_t*>(
+      trace_data_ + footer->frame_index_offset);
+  std::vector<Frame> frames(footer->frame_count);
+  for (uint32_t i = 0; i < footer->frame_count; ++i) {
+    uint64_t frame_end_offset = i + 1 < footer->frame_count
+                                    ? frame_start_offsets[i + 1]
+                                    : footer->frame_index_offset;
+    if (frame_start_offsets[i] < sizeof(TraceHeader) ||
+        frame_start_offsets[i] > frame_end_offset ||
+        frame_end_offset > footer->frame_index_offset) {
+      XELOGE("Trace frame index has an invalid range for frame {}", i);
+      return false;
+    }
+    Frame& frame = frames[i];
+    frame.start_ptr = trace_data_ + frame_start_offsets[i];
+    frame.end_ptr = trace_data_ + frame_end_offset;
+    frame.is_parsed = false;
+  }
+  frames_ = std::move(frames);
+  return true;
+}
+
+void TraceReader::ParseTrace(const uint8_t* trace_start,
+                             const uint8_t* trace_end,
+                             std::vector<Frame>& frames_out) const {
+  auto trace_ptr = trace_start;
 
   Frame current_frame;
   current_frame.start_ptr = trace_ptr;
@@ -88,7 +164,7 @@ void TraceReader::ParseTrace() {
   current_frame.command_tree =
       std::unique_ptr<CommandBuffer>(current_command_buffer);
 
-  while (trace_ptr < trace_data_ + trace_size_) {
+  while (trace_ptr < trace_end) {
     ++current_frame.command_count;
     auto type = static_cast<TraceCommandType>(xe::load<uint32_t>(trace_ptr));
     switch (type) {
@@ -178,7 +254,7 @@ void TraceReader::ParseTrace() {
         }
         if (pending_break) {
           current_frame.end_ptr = trace_ptr;
-          frames_.push_back(std::move(current_frame));
+          frames_out.push_back(std::move(current_frame));
           current_command_buffer = new CommandBuffer();
           current_frame.command_tree =
               std::unique_ptr<CommandBuffer>(current_command_buffer);
@@ -233,7 +309,7 @@ void TraceReader::ParseTrace() {
   }
   if (pending_break || current_frame.command_count) {
     current_frame.end_ptr = trace_ptr;
-    frames_.push_back(std::move(current_frame));
+    frames_out.push_back(std::move(current_frame));
   }
 }
 
@@ -248,6 +324,30 @@ bool TraceReader::DecompressMemory(MemoryEncodingFormat encoding_format,
     case MemoryEncodingFormat::kSnappy:
       return snappy::RawUncompress(reinterpret_cast<const char*>(src), src_size,
                                    reinterpret_cast<char*>(dest));
+    case MemoryEncodingFormat::kZstd: {
+      size_t decoded_size = ZSTD_decompress(dest, dest_size, src, src_size);
+      return !ZSTD_isError(decoded_size) && decoded_size == dest_size;
+    }
+    case MemoryEncodingFormat::kDuplicate: {
+      if (src_size != sizeof(uint64_t)) {
+        return false;
+      }
+      uint64_t original_offset = xe::load<uint64_t>(src);
+      if (original_offset > trace_size_ ||
+          trace_size_ - original_offset < sizeof(MemoryCommand)) {
+        return false;
+      }
+      auto original = reinterpret_cast<const MemoryCommand*>(trace_data_ +
+                                                             original_offset);
+      if (original->encoding_format == MemoryEncodingFormat::kDuplicate ||
+          original->decoded_length != dest_size ||
+          trace_size_ - original_offset - sizeof(MemoryCommand) <
+              original->encoded_length) {
+        return false;
+      }
+      return DecompressMemory(original->encoding_format, original + 1,
+                              original->encoded_length, dest, dest_size);
+    }
     default:
       assert_unhandled_case(encoding_format);
       return false;
@@ -82,6 +82,10 @@ class TraceReader {
     const uint8_t* end_ptr = nullptr;
     int command_count = 0;
 
+    // If the frames have been located via the frame index, the commands are
+    // parsed only when the frame is requested for the first time.
+    bool is_parsed = true;
+
     // Flat list of all commands in this frame.
     std::vector<Command> commands;
 
@@ -96,7 +100,7 @@ class TraceReader {
     return reinterpret_cast<const TraceHeader*>(trace_data_);
   }
 
-  const Frame* frame(int n) const { return &frames_[n]; }
+  const Frame* frame(int n) const;
   int frame_count() const { return int(frames_.size()); }
 
   bool Open(const std::string_view path);
@@ -104,14 +108,19 @@ class TraceReader {
   void Close();
 
  protected:
-  void ParseTrace();
+  // Tries to locate the frames using the index at the end of the trace, if it
+  // has one, without parsing them.
+  bool ReadFrameIndex();
+  // Appends the frames in the range of the command stream.
+  void ParseTrace(const uint8_t* trace_start, const uint8_t* trace_end,
+                  std::vector<Frame>& frames_out) const;
   bool DecompressMemory(MemoryEncodingFormat encoding_format, const void* src,
                         size_t src_size, void* dest, size_t dest_size);
 
   std::unique_ptr<MappedMemory> mmap_;
   const uint8_t* trace_data_ = nullptr;
   size_t trace_size_ = 0;
-  std::vector<Frame> frames_;
+  mutable std::vector<Frame> frames_;
 };
 
 }  // namespace gpu
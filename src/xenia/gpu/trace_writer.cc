@@ -9,27 +9,52 @@
 
 #include "xenia/gpu/trace_writer.h"
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
+#include <type_traits>
+#include <utility>
 
-#include "third_party/snappy/snappy-sinksource.h"
 #include "third_party/snappy/snappy.h"
+#include "third_party/zstd/lib/zstd.h"
 
 #include "build/version.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/cvar.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/string.h"
+#include "xenia/base/xxhash.h"
 #include "xenia/gpu/registers.h"
 #include "xenia/gpu/xenos.h"
 
+#if XE_ENABLE_TRACE_WRITER_INSTRUMENTATION == 1
+DEFINE_string(trace_gpu_compression, "zstd",
+              "Compression of the data in GPU traces.\n"
+              " none\n"
+              " snappy: Fastest.\n"
+              " zstd: Smallest traces.",
+              "GPU");
+DEFINE_int32(trace_gpu_zstd_level, 3,
+             "zstd compression level for GPU traces, from 1 to 19.", "GPU");
+DEFINE_bool(trace_gpu_deduplicate_memory_reads, true,
+            "Store identical memory reads, such as static vertex and texture "
+            "data, only once in GPU traces.",
+            "GPU");
+DEFINE_uint32(trace_gpu_writer_queue_size_mb, 256,
+              "Maximum amount of GPU trace data in megabytes waiting to be "
+              "compressed and written by the trace writer thread before the "
+              "GPU thread waits for it.",
+              "GPU");
+#endif
+
 namespace xe {
 namespace gpu {
 #if XE_ENABLE_TRACE_WRITER_INSTRUMENTATION == 1
 TraceWriter::TraceWriter(uint8_t* membase)
     : membase_(membase), file_(nullptr) {}
 
-TraceWriter::~TraceWriter() = default;
+TraceWriter::~TraceWriter() { Close(); }
 
 bool TraceWriter::Open(const std::filesystem::path& path, uint32_t title_id) {
   Close();
@@ -53,19 +78,63 @@ bool TraceWriter::Open(const std::filesystem::path& path, uint32_t title_id) {
   header.title_id = title_id;
   fwrite(&header, sizeof(header), 1, file_);
 
+  if (cvars::trace_gpu_compression == "zstd") {
+    encoding_format_ = MemoryEncodingFormat::kZstd;
+    zstd_context_ = ZSTD_createCCtx();
+    if (!zstd_context_) {
+      XELOGE("Failed to create the zstd context for GPU tracing");
+      encoding_format_ = MemoryEncodingFormat::kSnappy;
+    }
+  } else if (cvars::trace_gpu_compression == "snappy") {
+    encoding_format_ = MemoryEncodingFormat::kSnappy;
+  } else {
+    encoding_format_ = MemoryEncodingFormat::kNone;
+  }
+
   cached_memory_reads_.clear();
+  memory_read_locations_.clear();
+  frame_start_offsets_.clear();
+  frame_start_offsets_.push_back(sizeof(header));
+  frame_end_pending_ = false;
+
+  current_block_ = std::make_unique<Block>();
+  writer_shutdown_ = false;
+  writer_thread_ =
+      xe::threading::Thread::Create({}, [this]() { WriterThread(); });
+  assert_not_null(writer_thread_);
+  writer_thread_->set_name("GPU Trace Writer");
   return true;
 }
 
 void TraceWriter::Flush() {
   if (file_) {
-    fflush(file_);
+    current_block_->flush = true;
+    SubmitCurrentBlock();
   }
 }
 
 void TraceWriter::Close() {
   if (file_) {
+    SubmitCurrentBlock();
+    current_block_.reset();
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      writer_shutdown_ = true;
+    }
+    queue_request_cond_.notify_all();
+    xe::threading::Wait(writer_thread_.get(), false);
+    writer_thread_.reset();
+
     cached_memory_reads_.clear();
+    memory_read_locations_.clear();
+    if (zstd_context_) {
+      ZSTD_freeCCtx(zstd_context_);
+      zstd_context_ = nullptr;
+    }
+    encode_buffer_.clear();
+    encode_buffer_.shrink_to_fit();
+
+    WriteFrameIndex();
 
     fflush(file_);
     fclose(file_);
@@ -73,6 +142,167 @@ void TraceWriter::Close() {
   }
 }
 
+void TraceWriter::AppendRaw(const void* data, size_t size) {
+  std::vector<uint8_t>& raw = current_block_->raw;
+  raw.insert(raw.end(), reinterpret_cast<const uint8_t*>(data),
+             reinterpret_cast<const uint8_t*>(data) + size);
+  if (raw.size() >= kMaxRawBlockSize) {
+    SubmitCurrentBlock();
+  }
+}
+
+template <typename Command>
+void TraceWriter::SubmitCommand(const Command& command, const void* payload,
+                                size_t payload_size) {
+  Block& block = *current_block_;
+  block.has_command = true;
+  block.command_type = command.type;
+  std::memcpy(&block.command, &command, sizeof(command));
+  auto payload_bytes = reinterpret_cast<const uint8_t*>(payload);
+  block.payload.assign(payload_bytes, payload_bytes + payload_size);
+  SubmitCurrentBlock();
+}
+
+void TraceWriter::SubmitCurrentBlock() {
+  if (!current_block_->size() && !current_block_->has_command &&
+      !current_block_->flush) {
+    return;
+  }
+  size_t block_size = current_block_->size();
+  size_t max_queued_bytes =
+      size_t(std::max(cvars::trace_gpu_writer_queue_size_mb, uint32_t(1)))
+      << 20;
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    // Always allow at least one block, even if it's bigger than the limit.
+    queue_space_cond_.wait(lock, [&]() {
+      return queued_blocks_.empty() ||
+             queued_bytes_ + block_size <= max_queued_bytes;
+    });
+    queued_bytes_ += block_size;
+    queued_blocks_.push_back(std::move(current_block_));
+  }
+  queue_request_cond_.notify_one();
+  current_block_ = std::make_unique<Block>();
+}
+
+void TraceWriter::WriterThread() {
+  for (;;) {
+    std::unique_ptr<Block> block;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_request_cond_.wait(lock, [this]() {
+        return writer_shutdown_ || !queued_blocks_.empty();
+      });
+      if (queued_blocks_.empty()) {
+        return;
+      }
+      block = std::move(queued_blocks_.front());
+      queued_blocks_.pop_front();
+    }
+    WriteBlock(*block);
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      queued_bytes_ -= block->size();
+    }
+    queue_space_cond_.notify_all();
+  }
+}
+
+void TraceWriter::WriteBlock(Block& block) {
+  if (!block.raw.empty()) {
+    fwrite(block.raw.data(), 1, block.raw.size(), file_);
+  }
+  if (block.has_command) {
+    switch (block.command_type) {
+      case TraceCommandType::kMemoryRead:
+        WriteEncodedCommand(block.command.memory, block.payload,
+                            cvars::trace_gpu_deduplicate_memory_reads);
+        break;
+      case TraceCommandType::kMemoryWrite:
+        WriteEncodedCommand(block.command.memory, block.payload, false);
+        break;
+      case TraceCommandType::kEdramSnapshot:
+        WriteEncodedCommand(block.command.edram_snapshot, block.payload, false);
+        break;
+      case TraceCommandType::kRegisters:
+        WriteEncodedCommand(block.command.registers, block.payload, false);
+        break;
+      case TraceCommandType::kGammaRamp:
+        WriteEncodedCommand(block.command.gamma_ramp, block.payload, false);
+        break;
+      default:
+        assert_unhandled_case(block.command_type);
+        break;
+    }
+  }
+  if (block.ends_frame) {
+    frame_start_offsets_.push_back(uint64_t(xe::filesystem::Tell(file_)));
+  }
+  if (block.flush) {
+    fflush(file_);
+  }
+}
+
+template <typename Command>
+void TraceWriter::WriteEncodedCommand(Command& command,
+                                      const std::vector<uint8_t>& payload,
+                                      bool deduplicate) {
+  // Only MemoryCommand has the decoded length, for the other commands it's
+  // implied by the command.
+  if constexpr (std::is_same_v<Command, MemoryCommand>) {
+    if (deduplicate) {
+      uint64_t command_offset = uint64_t(xe::filesystem::Tell(file_));
+      uint64_t hash = XXH3_64bits(payload.data(), payload.size());
+      auto location_it = memory_read_locations_.find(hash);
+      if (location_it != memory_read_locations_.end()) {
+        if (location_it->second.length == payload.size()) {
+          command.encoding_format = MemoryEncodingFormat::kDuplicate;
+          command.encoded_length = uint32_t(sizeof(uint64_t));
+          fwrite(&command, 1, sizeof(command), file_);
+          fwrite(&location_it->second.offset, 1, sizeof(uint64_t), file_);
+          return;
+        }
+      } else {
+        memory_read_locations_.emplace(
+            hash, MemoryReadLocation{command_offset, uint32_t(payload.size())});
+      }
+    }
+  }
+
+  const void* encoded_data = payload.data();
+  size_t encoded_size = payload.size();
+  command.encoding_format = MemoryEncodingFormat::kNone;
+  switch (encoding_format_) {
+    case MemoryEncodingFormat::kSnappy: {
+      encode_buffer_.resize(snappy::MaxCompressedLength(payload.size()));
+      snappy::RawCompress(reinterpret_cast<const char*>(payload.data()),
+                          payload.size(),
+                          reinterpret_cast<char*>(encode_buffer_.data()),
+                          &encoded_size);
+      command.encoding_format = MemoryEncodingFormat::kSnappy;
+      encoded_data = encode_buffer_.data();
+    } break;
+    case MemoryEncodingFormat::kZstd: {
+      encode_buffer_.resize(ZSTD_compressBound(payload.size()));
+      size_t zstd_size = ZSTD_compressCCtx(
+          zstd_context_, encode_buffer_.data(), encode_buffer_.size(),
+          payload.data(), payload.size(),
+          std::clamp(cvars::trace_gpu_zstd_level, 1, ZSTD_maxCLevel()));
+      if (!ZSTD_isError(zstd_size)) {
+        command.encoding_format = MemoryEncodingFormat::kZstd;
+        encoded_data = encode_buffer_.data();
+        encoded_size = zstd_size;
+      }
+    } break;
+    default:
+      break;
+  }
+  command.encoded_length = uint32_t(encoded_size);
+  fwrite(&command, 1, sizeof(command), file_);
+  fwrite(encoded_data, 1, encoded_size, file_);
+}
+
 void TraceWriter::WritePrimaryBufferStart(uint32_t base_ptr, uint32_t count) {
   if (!file_) {
     return;
@@ -82,7 +312,7 @@ void TraceWriter::WritePrimaryBufferStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       0,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendRaw(cmd);
 }
 
 void TraceWriter::WritePrimaryBufferEnd() {
@@ -92,7 +322,7 @@ void TraceWriter::WritePrimaryBufferEnd() {
   PrimaryBufferEndCommand cmd = {
       TraceCommandType::kPrimaryBufferEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendRaw(cmd);
 }
 
 void TraceWriter::WriteIndirectBufferStart(uint32_t base_ptr, uint32_t count) {
@@ -104,7 +334,7 @@ void TraceWriter::WriteIndirectBufferStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       0,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendRaw(cmd);
 }
 
 void TraceWriter::WriteIndirectBufferEnd() {
@@ -114,7 +344,7 @@ void TraceWriter::WriteIndirectBufferEnd() {
   IndirectBufferEndCommand cmd = {
       TraceCommandType::kIndirectBufferEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendRaw(cmd);
 }
 
 void TraceWriter::WritePacketStart(uint32_t base_ptr, uint32_t count) {
@@ -126,8 +356,8 @@ void TraceWriter::WritePacketStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       count,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
-  fwrite(membase_ + base_ptr, 4, count, file_);
+  AppendRaw(cmd);
+  AppendRaw(membase_ + base_ptr, sizeof(uint32_t) * count);
 }
 
 void TraceWriter::WritePacketEnd() {
@@ -137,7 +367,12 @@ void TraceWriter::WritePacketEnd() {
   PacketEndCommand cmd = {
       TraceCommandType::kPacketEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendRaw(cmd);
+  if (frame_end_pending_) {
+    frame_end_pending_ = false;
+    current_block_->ends_frame = true;
+    SubmitCurrentBlock();
+  }
 }
 
 void TraceWriter::WriteMemoryRead(uint32_t base_ptr, size_t length,
@@ -182,18 +417,6 @@ void TraceWriter::WriteMemoryWrite(uint32_t base_ptr, size_t length,
                      host_ptr);
 }
 
-class SnappySink : public snappy::Sink {
- public:
-  SnappySink(FILE* file) : file_(file) {}
-
-  void Append(const char* bytes, size_t n) override {
-    fwrite(bytes, 1, n, file_);
-  }
-
- private:
-  FILE* file_ = nullptr;
-};
-
 void TraceWriter::WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
                                      size_t length, const void* host_ptr) {
   MemoryCommand cmd = {};
@@ -206,62 +429,25 @@ void TraceWriter::WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
     host_ptr = membase_ + cmd.base_ptr;
   }
 
-  bool compress = compress_output_ && length > compression_threshold_;
-  if (compress) {
-    // Write the header now so we reserve space in the buffer.
-    long header_position = std::ftell(file_);
-    cmd.encoding_format = MemoryEncodingFormat::kSnappy;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-
-    // Stream the content right to the buffer.
-    snappy::ByteArraySource snappy_source(
-        reinterpret_cast<const char*>(host_ptr), cmd.decoded_length);
-    SnappySink snappy_sink(file_);
-    cmd.encoded_length =
-        static_cast<uint32_t>(snappy::Compress(&snappy_source, &snappy_sink));
-
-    // Seek back and overwrite the header with our final size.
-    std::fseek(file_, header_position, SEEK_SET);
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    std::fseek(file_, header_position + sizeof(cmd) + cmd.encoded_length,
-               SEEK_SET);
+  if (length > compression_threshold_) {
+    // Encoded (and possibly deduplicated) on the writer thread.
+    SubmitCommand(cmd, host_ptr, length);
   } else {
-    // Uncompressed - write buffer directly to the file.
-    cmd.encoding_format = MemoryEncodingFormat::kNone;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    fwrite(host_ptr, 1, cmd.decoded_length, file_);
+    // Too small to be worth compressing - write the data directly.
+    AppendRaw(cmd);
+    AppendRaw(host_ptr, cmd.decoded_length);
   }
 }
 
 void TraceWriter::WriteEdramSnapshot(const void* snapshot) {
+  if (!file_) {
+    return;
+  }
   EdramSnapshotCommand cmd = {};
   cmd.type = TraceCommandType::kEdramSnapshot;
-
-  if (compress_output_) {
-    // Write the header now so we reserve space in the buffer.
-    long header_position = std::ftell(file_);
-    cmd.encoding_format = MemoryEncodingFormat::kSnappy;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-
-    // Stream the content right to the buffer.
-    snappy::ByteArraySource snappy_source(
-        reinterpret_cast<const char*>(snapshot), xenos::kEdramSizeBytes);
-    SnappySink snappy_sink(file_);
-    cmd.encoded_length =
-        static_cast<uint32_t>(snappy::Compress(&snappy_source, &snappy_sink));
-
-    // Seek back and overwrite the header with our final size.
-    std::fseek(file_, header_position, SEEK_SET);
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    std::fseek(file_, header_position + sizeof(cmd) + cmd.encoded_length,
-               SEEK_SET);
-  } else {
-    // Uncompressed - write buffer directly to the file.
-    cmd.encoding_format = MemoryEncodingFormat::kNone;
-    cmd.encoded_length = xenos::kEdramSizeBytes;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    fwrite(snapshot, 1, xenos::kEdramSizeBytes, file_);
-  }
+  cmd.encoding_format = MemoryEncodingFormat::kNone;
+  cmd.encoded_length = xenos::kEdramSizeBytes;
+  SubmitCommand(cmd, snapshot, xenos::kEdramSizeBytes);
 }
 
 void TraceWriter::WriteEvent(EventCommand::Type event_type) {
@@ -272,51 +458,55 @@ void TraceWriter::WriteEvent(EventCommand::Type event_type) {
       TraceCommandType::kEvent,
       event_type,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendRaw(cmd);
+  if (event_type == EventCommand::Type::kSwap) {
+    frame_end_pending_ = true;
+  }
+}
+
+void TraceWriter::WriteFrameIndex() {
+  uint64_t frame_index_offset = uint64_t(xe::filesystem::Tell(file_));
+  // The swap may be the last thing in the trace, or some commands may follow
+  // it. Same as in TraceReader, don't create an empty frame in the first case,
+  // but create one in the second (even if it hasn't been ended by a swap).
+  if (!frame_start_offsets_.empty() &&
+      frame_start_offsets_.back() >= frame_index_offset) {
+    frame_start_offsets_.pop_back();
+  }
+  fwrite(frame_start_offsets_.data(), sizeof(uint64_t),
+         frame_start_offsets_.size(), file_);
+  TraceFrameIndexFooter footer;
+  footer.frame_index_offset = frame_index_offset;
+  footer.frame_count = uint32_t(frame_start_offsets_.size());
+  footer.magic = kTraceFrameIndexMagic;
+  fwrite(&footer, sizeof(footer), 1, file_);
+  frame_start_offsets_.clear();
 }
 
 void TraceWriter::WriteRegisters(uint32_t first_register,
                                  const uint32_t* register_values,
                                  uint32_t register_count,
                                  bool execute_callbacks_on_play) {
+  if (!file_) {
+    return;
+  }
   RegistersCommand cmd = {};
   cmd.type = TraceCommandType::kRegisters;
   cmd.first_register = first_register;
   cmd.register_count = register_count;
   cmd.execute_callbacks = execute_callbacks_on_play;
-
-  uint32_t uncompressed_length = uint32_t(sizeof(uint32_t) * register_count);
-  if (compress_output_) {
-    // Write the header now so we reserve space in the buffer.
-    long header_position = std::ftell(file_);
-    cmd.encoding_format = MemoryEncodingFormat::kSnappy;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-
-    // Stream the content right to the buffer.
-    snappy::ByteArraySource snappy_source(
-        reinterpret_cast<const char*>(register_values), uncompressed_length);
-    SnappySink snappy_sink(file_);
-    cmd.encoded_length =
-        static_cast<uint32_t>(snappy::Compress(&snappy_source, &snappy_sink));
-
-    // Seek back and overwrite the header with our final size.
-    std::fseek(file_, header_position, SEEK_SET);
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    std::fseek(file_, header_position + sizeof(cmd) + cmd.encoded_length,
-               SEEK_SET);
-  } else {
-    // Uncompressed - write the values directly to the file.
-    cmd.encoding_format = MemoryEncodingFormat::kNone;
-    cmd.encoded_length = uncompressed_length;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    fwrite(register_values, 1, uncompressed_length, file_);
-  }
+  cmd.encoding_format = MemoryEncodingFormat::kNone;
+  cmd.encoded_length = uint32_t(sizeof(uint32_t) * register_count);
+  SubmitCommand(cmd, register_values, cmd.encoded_length);
 }
 
 void TraceWriter::WriteGammaRamp(
     const reg::DC_LUT_30_COLOR* gamma_ramp_256_entry_table,
     const reg::DC_LUT_PWL_DATA* gamma_ramp_pwl_rgb,
     uint32_t gamma_ramp_rw_component) {
+  if (!file_) {
+    return;
+  }
   GammaRampCommand cmd = {};
   cmd.type = TraceCommandType::kGammaRamp;
   cmd.rw_component = uint8_t(gamma_ramp_rw_component);
@@ -327,40 +517,15 @@ void TraceWriter::WriteGammaRamp(
       sizeof(reg::DC_LUT_PWL_DATA) * 3 * 128;
   constexpr uint32_t kUncompressedLength =
       k256EntryTableUncompressedLength + kPWLUncompressedLength;
-  if (compress_output_) {
-    // Write the header now so we reserve space in the buffer.
-    long header_position = std::ftell(file_);
-    cmd.encoding_format = MemoryEncodingFormat::kSnappy;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-
-    // Stream the content right to the buffer.
-    {
-      std::unique_ptr<char[]> gamma_ramps(new char[kUncompressedLength]);
-      std::memcpy(gamma_ramps.get(), gamma_ramp_256_entry_table,
-                  k256EntryTableUncompressedLength);
-      std::memcpy(gamma_ramps.get() + k256EntryTableUncompressedLength,
-                  gamma_ramp_pwl_rgb, kPWLUncompressedLength);
-      snappy::ByteArraySource snappy_source(gamma_ramps.get(),
-                                            kUncompressedLength);
-      SnappySink snappy_sink(file_);
-      cmd.encoded_length =
-          static_cast<uint32_t>(snappy::Compress(&snappy_source, &snappy_sink));
-    }
-
-    // Seek back and overwrite the header with our final size.
-    std::fseek(file_, header_position, SEEK_SET);
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    std::fseek(file_, header_position + sizeof(cmd) + cmd.encoded_length,
-               SEEK_SET);
-  } else {
-    // Uncompressed - write the values directly to the file.
-    cmd.encoding_format = MemoryEncodingFormat::kNone;
-    cmd.encoded_length = kUncompressedLength;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    fwrite(gamma_ramp_256_entry_table, 1, k256EntryTableUncompressedLength,
-           file_);
-    fwrite(gamma_ramp_pwl_rgb, 1, kPWLUncompressedLength, file_);
-  }
+  cmd.encoding_format = MemoryEncodingFormat::kNone;
+  cmd.encoded_length = kUncompressedLength;
+
+  uint8_t gamma_ramps[kUncompressedLength];
+  std::memcpy(gamma_ramps, gamma_ramp_256_entry_table,
+              k256EntryTableUncompressedLength);
+  std::memcpy(gamma_ramps + k256EntryTableUncompressedLength,
+              gamma_ramp_pwl_rgb, kPWLUncompressedLength);
+  SubmitCommand(cmd, gamma_ramps, kUncompressedLength);
 }
 #endif
 }  //  namespace gpu
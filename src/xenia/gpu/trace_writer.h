@@ -10,10 +10,17 @@
 #ifndef XENIA_GPU_TRACE_WRITER_H_
 #define XENIA_GPU_TRACE_WRITER_H_
 
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "xenia/base/threading.h"
 #include "xenia/gpu/registers.h"
 #include "xenia/gpu/trace_protocol.h"
 
@@ -27,6 +34,10 @@
 #define XE_ENABLE_TRACE_WRITER_INSTRUMENTATION 1
 #endif
 
+#if XE_ENABLE_TRACE_WRITER_INSTRUMENTATION == 1
+struct ZSTD_CCtx_s;
+#endif
+
 namespace xe {
 namespace gpu {
 
@@ -63,14 +74,90 @@ class TraceWriter {
                       uint32_t gamma_ramp_rw_component);
 
  private:
+  // Commands are gathered into blocks on the calling thread, and written to the
+  // file, with the payloads encoded, on the writer thread, so the GPU thread is
+  // not slowed down by compression, which would change the behavior of the
+  // title being captured.
+  struct Block {
+    // Written to the file as is.
+    std::vector<uint8_t> raw;
+    // If has_command, the command of command_type is written after the raw
+    // bytes, followed by the payload encoded with the output compression.
+    bool has_command = false;
+    TraceCommandType command_type;
+    union {
+      MemoryCommand memory;
+      EdramSnapshotCommand edram_snapshot;
+      RegistersCommand registers;
+      GammaRampCommand gamma_ramp;
+    } command;
+    std::vector<uint8_t> payload;
+    // A new frame starts after this block.
+    bool ends_frame = false;
+    // The file needs to be flushed after writing this block.
+    bool flush = false;
+
+    size_t size() const { return raw.size() + payload.size(); }
+  };
+
+  // Raw bytes accumulated before a block is submitted to the writer thread.
+  static constexpr size_t kMaxRawBlockSize = 1024 * 1024;
+
+  template <typename T>
+  void AppendRaw(const T& value) {
+    AppendRaw(&value, sizeof(value));
+  }
+  void AppendRaw(const void* data, size_t size);
+  // Submits the current block with the command and the payload, which is
+  // copied, and starts a new block.
+  template <typename Command>
+  void SubmitCommand(const Command& command, const void* payload,
+                     size_t payload_size);
+  void SubmitCurrentBlock();
+
   void WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
                           size_t length, const void* host_ptr = nullptr);
 
+  void WriterThread();
+  // Writer thread functions.
+  void WriteBlock(Block& block);
+  template <typename Command>
+  void WriteEncodedCommand(Command& command,
+                           const std::vector<uint8_t>& payload,
+                           bool deduplicate);
+  void WriteFrameIndex();
+
   std::set<uint64_t> cached_memory_reads_;
   uint8_t* membase_;
   FILE* file_;
 
-  bool compress_output_ = true;
+  std::unique_ptr<Block> current_block_;
+
+  std::mutex queue_mutex_;
+  std::condition_variable queue_request_cond_;
+  std::condition_variable queue_space_cond_;
+  // Protected with queue_mutex_.
+  std::deque<std::unique_ptr<Block>> queued_blocks_;
+  size_t queued_bytes_ = 0;
+  bool writer_shutdown_ = false;
+  std::unique_ptr<xe::threading::Thread> writer_thread_;
+
+  // Writer thread state.
+  MemoryEncodingFormat encoding_format_ = MemoryEncodingFormat::kNone;
+  ZSTD_CCtx_s* zstd_context_ = nullptr;
+  std::vector<uint8_t> encode_buffer_;
+  // File offsets of memory read commands by the hash of their contents.
+  struct MemoryReadLocation {
+    uint64_t offset;
+    uint32_t length;
+  };
+  std::unordered_map<uint64_t, MemoryReadLocation> memory_read_locations_;
+  // File offsets of the first command of each frame for the index.
+  std::vector<uint64_t> frame_start_offsets_;
+
+  // A frame ends after the packet containing the swap event.
+  bool frame_end_pending_ = false;
+
   size_t compression_threshold_ = 1024;  // Min. number of bytes to compress.
 
 #else
@@ -70,6 +70,31 @@ void DeferredCommandBuffer::Execute(VkCommandBuffer command_buffer) {
                                  args.contents);
       } break;
 
+      case Command::kVkBeginRendering: {
+        auto& args = *reinterpret_cast<const ArgsVkBeginRendering*>(stream);
+        auto attachments = reinterpret_cast<const VkRenderingAttachmentInfo*>(
+            reinterpret_cast<const uint8_t*>(stream) +
+            xe::align(sizeof(ArgsVkBeginRendering),
+                      alignof(VkRenderingAttachmentInfo)));
+        VkRenderingInfo rendering_info;
+        rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        rendering_info.pNext = nullptr;
+        rendering_info.flags = args.flags;
+        rendering_info.renderArea = args.render_area;
+        rendering_info.layerCount = args.layer_count;
+        rendering_info.viewMask = 0;
+        rendering_info.colorAttachmentCount = args.color_attachment_count;
+        rendering_info.pColorAttachments =
+            args.color_attachment_count ? attachments : nullptr;
+        attachments += args.color_attachment_count;
+        rendering_info.pDepthAttachment =
+            args.has_depth_attachment ? attachments : nullptr;
+        attachments += uint32_t(args.has_depth_attachment);
+        rendering_info.pStencilAttachment =
+            args.has_stencil_attachment ? attachments : nullptr;
+        dfn.vkCmdBeginRendering(command_buffer, &rendering_info);
+      } break;
+
       case Command::kVkBindDescriptorSets: {
         auto& args = *reinterpret_cast<const ArgsVkBindDescriptorSets*>(stream);
         size_t offset_bytes = xe::align(sizeof(ArgsVkBindDescriptorSets),
@@ -188,6 +213,10 @@ void DeferredCommandBuffer::Execute(VkCommandBuffer command_buffer) {
         dfn.vkCmdEndRenderPass(command_buffer);
         break;
 
+      case Command::kVkEndRendering:
+        dfn.vkCmdEndRendering(command_buffer);
+        break;
+
       case Command::kVkPipelineBarrier: {
         auto& args = *reinterpret_cast<const ArgsVkPipelineBarrier*>(stream);
         size_t barrier_offset_bytes = sizeof(ArgsVkPipelineBarrier);
@@ -59,6 +59,45 @@ class DeferredCommandBuffer {
     }
   }
 
+  // rendering_info->pNext and pNext of all attachments must be null, and the
+  // attachments must have no resolve images.
+  void CmdVkBeginRendering(const VkRenderingInfo* rendering_info) {
+    assert_null(rendering_info->pNext);
+    uint32_t color_attachment_count = rendering_info->colorAttachmentCount;
+    bool has_depth_attachment = rendering_info->pDepthAttachment != nullptr;
+    bool has_stencil_attachment = rendering_info->pStencilAttachment != nullptr;
+    size_t arguments_size =
+        xe::align(sizeof(ArgsVkBeginRendering),
+                  alignof(VkRenderingAttachmentInfo));
+    size_t attachments_offset = arguments_size;
+    arguments_size +=
+        sizeof(VkRenderingAttachmentInfo) *
+        (color_attachment_count + uint32_t(has_depth_attachment) +
+         uint32_t(has_stencil_attachment));
+    uint8_t* args_ptr = reinterpret_cast<uint8_t*>(
+        WriteCommand(Command::kVkBeginRendering, arguments_size));
+    auto& args = *reinterpret_cast<ArgsVkBeginRendering*>(args_ptr);
+    args.flags = rendering_info->flags;
+    args.render_area = rendering_info->renderArea;
+    args.layer_count = rendering_info->layerCount;
+    args.color_attachment_count = color_attachment_count;
+    args.has_depth_attachment = has_depth_attachment;
+    args.has_stencil_attachment = has_stencil_attachment;
+    auto attachments = reinterpret_cast<VkRenderingAttachmentInfo*>(
+        args_ptr + attachments_offset);
+    if (color_attachment_count) {
+      std::memcpy(attachments, rendering_info->pColorAttachments,
+                  sizeof(VkRenderingAttachmentInfo) * color_attachment_count);
+      attachments += color_attachment_count;
+    }
+    if (has_depth_attachment) {
+      *(attachments++) = *rendering_info->pDepthAttachment;
+    }
+    if (has_stencil_attachment) {
+      *(attachments++) = *rendering_info->pStencilAttachment;
+    }
+  }
+
   void CmdVkBindDescriptorSets(VkPipelineBindPoint pipeline_bind_point,
                                VkPipelineLayout layout, uint32_t first_set,
                                uint32_t descriptor_set_count,
@@ -264,6 +303,8 @@ class DeferredCommandBuffer {
 
   void CmdVkEndRenderPass() { WriteCommand(Command::kVkEndRenderPass, 0); }
 
+  void CmdVkEndRendering() { WriteCommand(Command::kVkEndRendering, 0); }
+
   // pNext of all barriers must be null.
   void CmdVkPipelineBarrier(VkPipelineStageFlags src_stage_mask,
                             VkPipelineStageFlags dst_stage_mask,
@@ -360,6 +401,7 @@ class DeferredCommandBuffer {
  private:
   enum class Command {
     kVkBeginRenderPass,
+    kVkBeginRendering,
     kVkBindDescriptorSets,
     kVkBindIndexBuffer,
     kVkBindPipeline,
@@ -372,6 +414,7 @@ class DeferredCommandBuffer {
     kVkDraw,
     kVkDrawIndexed,
     kVkEndRenderPass,
+    kVkEndRendering,
     kVkPipelineBarrier,
     kVkPushConstants,
     kVkSetBlendConstants,
@@ -400,6 +443,18 @@ class DeferredCommandBuffer {
     static_assert(alignof(VkClearValue) <= alignof(uintmax_t));
   };
 
+  struct ArgsVkBeginRendering {
+    VkRenderingFlags flags;
+    VkRect2D render_area;
+    uint32_t layer_count;
+    uint32_t color_attachment_count;
+    bool has_depth_attachment;
+    bool has_stencil_attachment;
+    // Followed by aligned VkRenderingAttachmentInfo[] - color attachments, then
+    // optional depth, then optional stencil.
+    static_assert(alignof(VkRenderingAttachmentInfo) <= alignof(uintmax_t));
+  };
+
   struct ArgsVkBindDescriptorSets {
     VkPipelineBindPoint pipeline_bind_point;
     VkPipelineLayout layout;
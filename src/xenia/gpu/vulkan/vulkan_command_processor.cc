@@ -19,6 +19,7 @@
 
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_order.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
@@ -54,6 +55,11 @@ namespace shaders {
 #include "xenia/gpu/shaders/bytecode/vulkan_spirv/fullscreen_cw_vs.h"
 }  // namespace shaders
 
+static xe::counters::Counter& host_gpu_wait_time_counter =
+    xe::counters::GetCounter("gpu/host_gpu_wait_us");
+static xe::counters::Counter& split_submissions_counter =
+    xe::counters::GetCounter("gpu/split_submissions");
+
 const VkDescriptorPoolSize
     VulkanCommandProcessor::kDescriptorPoolSizeUniformBuffer = {
         VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
@@ -100,6 +106,22 @@ void VulkanCommandProcessor::ClearCaches() {
   cache_clear_requested_ = true;
 }
 
+void VulkanCommandProcessor::InitializeShaderStorage(
+    const std::filesystem::path& cache_root, uint32_t title_id, bool blocking) {
+  CommandProcessor::InitializeShaderStorage(cache_root, title_id, blocking);
+  pipeline_cache_->InitializeShaderStorage(cache_root, title_id, blocking);
+}
+
+CommandProcessor::CacheStatistics
+VulkanCommandProcessor::GetCacheStatistics() const {
+  CacheStatistics statistics;
+  if (texture_cache_) {
+    statistics.texture_hits = texture_cache_->texture_hit_count();
+    statistics.texture_misses = texture_cache_->texture_miss_count();
+  }
+  return statistics;
+}
+
 void VulkanCommandProcessor::TracePlaybackWroteMemory(uint32_t base_ptr,
                                                       uint32_t length) {
   shared_memory_->MemoryInvalidationCallback(base_ptr, length, true);
@@ -170,7 +192,8 @@ bool VulkanCommandProcessor::SetupContext() {
       provider, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
       xe::align(std::max(ui::GraphicsUploadBufferPool::kDefaultPageSize,
                          size_t(16384)),
-                size_t(device_info.minUniformBufferOffsetAlignment)));
+                size_t(device_info.minUniformBufferOffsetAlignment)),
+      "vulkan/uniforms");
 
   // Descriptor set layouts that don't depend on the setup of other subsystems.
   VkShaderStageFlags guest_shader_stages =
@@ -1192,51 +1215,6 @@ void VulkanCommandProcessor::ShutdownContext() {
   CommandProcessor::ShutdownContext();
 }
 
-void VulkanCommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
-  CommandProcessor::WriteRegister(index, value);
-
-  if (index >= XE_GPU_REG_SHADER_CONSTANT_000_X &&
-      index <= XE_GPU_REG_SHADER_CONSTANT_511_W) {
-    if (frame_open_) {
-      uint32_t float_constant_index =
-          (index - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2;
-      if (float_constant_index >= 256) {
-        float_constant_index -= 256;
-        if (current_float_constant_map_pixel_[float_constant_index >> 6] &
-            (1ull << (float_constant_index & 63))) {
-          current_constant_buffers_up_to_date_ &= ~(
-              UINT32_C(1) << SpirvShaderTranslator::kConstantBufferFloatPixel);
-        }
-      } else {
-        if (current_float_constant_map_vertex_[float_constant_index >> 6] &
-            (1ull << (float_constant_index & 63))) {
-          current_constant_buffers_up_to_date_ &= ~(
-              UINT32_C(1) << SpirvShaderTranslator::kConstantBufferFloatVertex);
-        }
-      }
-    }
-  } else if (index >= XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 &&
-             index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31) {
-    current_constant_buffers_up_to_date_ &=
-        ~(UINT32_C(1) << SpirvShaderTranslator::kConstantBufferBoolLoop);
-  } else if (index >= XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0 &&
-             index <= XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5) {
-    current_constant_buffers_up_to_date_ &=
-        ~(UINT32_C(1) << SpirvShaderTranslator::kConstantBufferFetch);
-    if (texture_cache_) {
-      texture_cache_->TextureFetchConstantWritten(
-          (index - XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) / 6);
-    }
-  }
-}
-void VulkanCommandProcessor::WriteRegistersFromMem(uint32_t start_index,
-                                                   uint32_t* base,
-                                                   uint32_t num_registers) {
-  for (uint32_t i = 0; i < num_registers; ++i) {
-    uint32_t data = xe::load_and_swap<uint32_t>(base + i);
-    VulkanCommandProcessor::WriteRegister(start_index + i, data);
-  }
-}
 void VulkanCommandProcessor::SparseBindBuffer(
     VkBuffer buffer, uint32_t bind_count, const VkSparseMemoryBind* binds,
     VkPipelineStageFlags wait_stage_mask) {
@@ -1790,9 +1768,7 @@ void VulkanCommandProcessor::SubmitBarriersAndEnterRenderTargetCacheRenderPass(
       current_framebuffer_ == framebuffer) {
     return;
   }
-  if (current_render_pass_ != VK_NULL_HANDLE) {
-    deferred_command_buffer_.CmdVkEndRenderPass();
-  }
+  EndRenderPass();
   current_render_pass_ = render_pass;
   current_framebuffer_ = framebuffer;
   VkRenderPassBeginInfo render_pass_begin_info;
@@ -1811,8 +1787,88 @@ void VulkanCommandProcessor::SubmitBarriersAndEnterRenderTargetCacheRenderPass(
                                                 VK_SUBPASS_CONTENTS_INLINE);
 }
 
+void VulkanCommandProcessor::SubmitBarriersAndBeginRenderTargetCacheRendering(
+    const VulkanRenderTargetCache::Rendering& rendering) {
+  SubmitBarriers(false);
+  if (current_rendering_active_ && current_rendering_ == rendering) {
+    return;
+  }
+  EndRenderPass();
+  if (dynamic_rendering_barrier_needed_) {
+    // Draws in different dynamic rendering scopes are not ordered by
+    // rasterization order, unlike the render target cache render passes with
+    // their external subpass dependencies between draws.
+    constexpr VkPipelineStageFlags kDrawStageMask =
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    VkMemoryBarrier memory_barrier;
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.pNext = nullptr;
+    memory_barrier.srcAccessMask =
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    memory_barrier.dstAccessMask = memory_barrier.srcAccessMask;
+    deferred_command_buffer_.CmdVkPipelineBarrier(
+        kDrawStageMask, kDrawStageMask, VK_DEPENDENCY_BY_REGION_BIT, 1,
+        &memory_barrier, 0, nullptr, 0, nullptr);
+    dynamic_rendering_barrier_needed_ = false;
+  }
+  current_rendering_active_ = true;
+  current_rendering_ = rendering;
+  VkRenderingAttachmentInfo
+      color_attachments[xenos::kMaxColorRenderTargets] = {};
+  uint32_t color_attachment_count = 0;
+  for (uint32_t i = 0; i < xenos::kMaxColorRenderTargets; ++i) {
+    VkRenderingAttachmentInfo& color_attachment = color_attachments[i];
+    color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    color_attachment.resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment.imageView = rendering.attachments[1 + i];
+    if (color_attachment.imageView != VK_NULL_HANDLE) {
+      color_attachment_count = i + 1;
+    }
+  }
+  VkRenderingAttachmentInfo depth_stencil_attachment = {};
+  depth_stencil_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+  depth_stencil_attachment.imageView = rendering.attachments[0];
+  depth_stencil_attachment.imageLayout =
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depth_stencil_attachment.resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depth_stencil_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  depth_stencil_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  bool has_depth_stencil_attachment =
+      depth_stencil_attachment.imageView != VK_NULL_HANDLE;
+  VkRenderingInfo rendering_info;
+  rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+  rendering_info.pNext = nullptr;
+  rendering_info.flags = 0;
+  rendering_info.renderArea.offset.x = 0;
+  rendering_info.renderArea.offset.y = 0;
+  rendering_info.renderArea.extent = rendering.host_extent;
+  rendering_info.layerCount = 1;
+  rendering_info.viewMask = 0;
+  rendering_info.colorAttachmentCount = color_attachment_count;
+  rendering_info.pColorAttachments = color_attachments;
+  rendering_info.pDepthAttachment =
+      has_depth_stencil_attachment ? &depth_stencil_attachment : nullptr;
+  rendering_info.pStencilAttachment =
+      has_depth_stencil_attachment ? &depth_stencil_attachment : nullptr;
+  deferred_command_buffer_.CmdVkBeginRendering(&rendering_info);
+}
+
 void VulkanCommandProcessor::EndRenderPass() {
   assert_true(submission_open_);
+  if (current_rendering_active_) {
+    deferred_command_buffer_.CmdVkEndRendering();
+    current_rendering_active_ = false;
+    dynamic_rendering_barrier_needed_ = true;
+    return;
+  }
   if (current_render_pass_ == VK_NULL_HANDLE) {
     return;
   }
@@ -2180,6 +2236,8 @@ bool VulkanCommandProcessor::IssueDraw(xenos::PrimitiveType prim_type,
     return IssueCopy();
   }
 
+  InvalidateWrittenFetchConstants();
+
   const ui::vulkan::VulkanProvider::DeviceInfo& device_info =
       GetVulkanProvider().device_info();
 
@@ -2395,6 +2453,11 @@ bool VulkanCommandProcessor::IssueDraw(xenos::PrimitiveType prim_type,
           pipeline_layout_provider)) {
     return false;
   }
+  if (pipeline == VK_NULL_HANDLE) {
+    // The pipeline is being created asynchronously - skip the draw, but not
+    // treat it as an error.
+    return true;
+  }
 
   // Update the textures before most other work in the submission because
   // samplers depend on this (and in case of sampler overflow in a submission,
@@ -2589,9 +2652,14 @@ bool VulkanCommandProcessor::IssueDraw(xenos::PrimitiveType prim_type,
   // After all commands that may dispatch, copy or insert barriers, submit the
   // barriers (may end the render pass), and (re)enter the render pass before
   // drawing.
-  SubmitBarriersAndEnterRenderTargetCacheRenderPass(
-      render_target_cache_->last_update_render_pass(),
-      render_target_cache_->last_update_framebuffer());
+  if (render_target_cache_->IsDynamicRenderingUsed()) {
+    SubmitBarriersAndBeginRenderTargetCacheRendering(
+        render_target_cache_->last_update_rendering());
+  } else {
+    SubmitBarriersAndEnterRenderTargetCacheRenderPass(
+        render_target_cache_->last_update_render_pass(),
+        render_target_cache_->last_update_framebuffer());
+  }
 
   // Draw.
   if (primitive_processing_result.index_buffer_type ==
@@ -2635,6 +2703,19 @@ bool VulkanCommandProcessor::IssueDraw(xenos::PrimitiveType prim_type,
                                       memexport_range.size_bytes, false);
   }
 
+  ++submission_draw_count_;
+  if (cvars::submit_split_draw_count &&
+      submission_draw_count_ >= cvars::submit_split_draw_count) {
+    CheckSubmissionFenceAndDeviceLoss(0);
+    if (submissions_in_flight_fences_.empty()) {
+      // The GPU has nothing else to do - let it execute the draws recorded so
+      // far while the rest of the frame is being processed.
+      if (EndSubmission(false)) {
+        split_submissions_counter.Increment();
+      }
+    }
+  }
+
   return true;
 }
 
@@ -2704,9 +2785,13 @@ void VulkanCommandProcessor::CheckSubmissionFenceAndDeviceLoss(
     // defined by vkQueueSubmit additionally include in the first
     // synchronization scope all commands that occur earlier in submission
     // order."
-    VkResult wait_result = dfn.vkWaitForFences(
-        device, uint32_t(await_submission - submission_completed_),
-        submissions_in_flight_fences_.data(), VK_TRUE, UINT64_MAX);
+    VkResult wait_result;
+    {
+      xe::counters::ScopedTimer wait_timer(host_gpu_wait_time_counter);
+      wait_result = dfn.vkWaitForFences(
+          device, uint32_t(await_submission - submission_completed_),
+          submissions_in_flight_fences_.data(), VK_TRUE, UINT64_MAX);
+    }
     if (wait_result == VK_SUCCESS) {
       fences_awaited += await_submission - submission_completed_;
     } else {
@@ -2851,6 +2936,7 @@ bool VulkanCommandProcessor::BeginSubmission(bool is_guest_command) {
 
   if (!submission_open_) {
     submission_open_ = true;
+    submission_draw_count_ = 0;
 
     // Start a new deferred command buffer - will submit it to the real one in
     // the end of the submission (when async pipeline object creation requests
@@ -2870,12 +2956,16 @@ bool VulkanCommandProcessor::BeginSubmission(bool is_guest_command) {
     dynamic_stencil_reference_back_update_needed_ = true;
     current_render_pass_ = VK_NULL_HANDLE;
     current_framebuffer_ = nullptr;
+    current_rendering_active_ = false;
+    dynamic_rendering_barrier_needed_ = true;
     current_guest_graphics_pipeline_ = VK_NULL_HANDLE;
     current_external_graphics_pipeline_ = VK_NULL_HANDLE;
     current_external_compute_pipeline_ = VK_NULL_HANDLE;
     current_guest_graphics_pipeline_layout_ = nullptr;
     current_graphics_descriptor_sets_bound_up_to_date_ = 0;
 
+    shared_memory_->BeginSubmission();
+
     primitive_processor_->BeginSubmission();
 
     texture_cache_->BeginSubmission(GetCurrentSubmission());
@@ -2949,6 +3039,8 @@ bool VulkanCommandProcessor::BeginSubmission(bool is_guest_command) {
     primitive_processor_->BeginFrame();
 
     texture_cache_->BeginFrame();
+
+    render_target_cache_->BeginFrame();
   }
 
   return true;
@@ -3037,6 +3129,8 @@ bool VulkanCommandProcessor::EndSubmission(bool is_swap) {
 
     shared_memory_->EndSubmission();
 
+    pipeline_cache_->EndSubmission();
+
     uniform_buffer_pool_->FlushWrites();
 
     // Submit sparse binds earlier, before executing the deferred command
@@ -3204,6 +3298,8 @@ bool VulkanCommandProcessor::EndSubmission(bool is_swap) {
 
       texture_cache_->ClearCache();
 
+      // Render passes may still be used by asynchronous pipeline creation.
+      pipeline_cache_->AwaitPipelineCreationCompletion();
       render_target_cache_->ClearCache();
 
       // Not clearing the pipeline layouts and the descriptor set layouts as
@@ -3957,6 +4053,59 @@ void VulkanCommandProcessor::UpdateSystemConstantValues(
   }
 }
 
+void VulkanCommandProcessor::InvalidateWrittenFetchConstants() {
+  RegisterFile& regs = *register_file_;
+  constexpr uint32_t kBlockSize = UINT32_C(1)
+                                  << RegisterFile::kDirtyBlockSizeLog2;
+  constexpr uint32_t kFetchConstantRegisterCount =
+      XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5 -
+      XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0 + 1;
+  static_assert(!(XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0 & (kBlockSize - 1)),
+                "Fetch constants must start at a dirty block boundary");
+  if (!regs.IsRangeDirty(XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0,
+                         kFetchConstantRegisterCount)) {
+    return;
+  }
+  current_constant_buffers_up_to_date_ &=
+      ~(UINT32_C(1) << SpirvShaderTranslator::kConstantBufferFetch);
+  if (texture_cache_) {
+    for (uint32_t i = 0; i < kFetchConstantRegisterCount; i += kBlockSize) {
+      if (regs.IsRangeDirty(XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0 + i, 1)) {
+        texture_cache_->TextureFetchConstantsWritten(
+            i / 6, std::min((i + kBlockSize - 1) / 6, UINT32_C(31)));
+      }
+    }
+  }
+  regs.ClearRangeDirty(XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0,
+                       kFetchConstantRegisterCount);
+}
+
+void VulkanCommandProcessor::InvalidateWrittenFloatConstants(
+    uint32_t first_register, const uint64_t* float_constant_map,
+    uint32_t constant_buffer) {
+  RegisterFile& regs = *register_file_;
+  // 256 constants of a stage are 64 blocks - exactly one word of the bitmap.
+  constexpr uint32_t kConstantsPerBlock =
+      (UINT32_C(1) << RegisterFile::kDirtyBlockSizeLog2) / 4;
+  static_assert(kConstantsPerBlock * 64 == 256,
+                "Float constants of a stage must be one dirty bitmap word");
+  uint64_t& dirty_blocks =
+      regs.dirty_blocks[(first_register >> RegisterFile::kDirtyBlockSizeLog2) >>
+                        6];
+  uint64_t dirty_blocks_remaining = dirty_blocks;
+  dirty_blocks = 0;
+  uint32_t block;
+  while (xe::bit_scan_forward(dirty_blocks_remaining, &block)) {
+    dirty_blocks_remaining &= ~(UINT64_C(1) << block);
+    uint32_t first_constant = block * kConstantsPerBlock;
+    if ((float_constant_map[first_constant >> 6] >> (first_constant & 63)) &
+        ((UINT64_C(1) << kConstantsPerBlock) - 1)) {
+      current_constant_buffers_up_to_date_ &= ~(UINT32_C(1) << constant_buffer);
+      return;
+    }
+  }
+}
+
 bool VulkanCommandProcessor::UpdateBindings(const VulkanShader* vertex_shader,
                                             const VulkanShader* pixel_shader) {
 #if XE_UI_VULKAN_FINE_GRAINED_DRAW_SCOPES
@@ -4016,6 +4165,25 @@ bool VulkanCommandProcessor::UpdateBindings(const VulkanShader* vertex_shader,
     std::memset(current_float_constant_map_pixel_, 0,
                 sizeof(current_float_constant_map_pixel_));
   }
+  // Check the constants written since the previous draw - with the same float
+  // constant layout, only the blocks containing the used constants matter.
+  InvalidateWrittenFloatConstants(
+      XE_GPU_REG_SHADER_CONSTANT_000_X, current_float_constant_map_vertex_,
+      SpirvShaderTranslator::kConstantBufferFloatVertex);
+  InvalidateWrittenFloatConstants(
+      XE_GPU_REG_SHADER_CONSTANT_256_X, current_float_constant_map_pixel_,
+      SpirvShaderTranslator::kConstantBufferFloatPixel);
+  if (register_file_->IsRangeDirty(
+          XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031,
+          XE_GPU_REG_SHADER_CONSTANT_LOOP_31 -
+              XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 + 1)) {
+    current_constant_buffers_up_to_date_ &=
+        ~(UINT32_C(1) << SpirvShaderTranslator::kConstantBufferBoolLoop);
+    register_file_->ClearRangeDirty(
+        XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031,
+        XE_GPU_REG_SHADER_CONSTANT_LOOP_31 -
+            XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 + 1);
+  }
 
   // Write the new constant buffers.
   constexpr uint32_t kAllConstantBuffersMask =
@@ -4171,56 +4339,32 @@ bool VulkanCommandProcessor::UpdateBindings(const VulkanShader* vertex_shader,
     sampler_count_pixel = 0;
     texture_count_pixel = 0;
   }
-  // TODO(Triang3l): Reuse texture and sampler bindings if not changed.
-  current_graphics_descriptor_set_values_up_to_date_ &=
-      ~((UINT32_C(1) << SpirvShaderTranslator::kDescriptorSetTexturesVertex) |
-        (UINT32_C(1) << SpirvShaderTranslator::kDescriptorSetTexturesPixel));
-
-  // Make sure new descriptor sets are bound to the command buffer.
-
-  current_graphics_descriptor_sets_bound_up_to_date_ &=
-      current_graphics_descriptor_set_values_up_to_date_;
-
-  // Fill the texture and sampler write image infos.
+  // Fill the texture and sampler image infos.
 
-  bool write_vertex_textures =
-      (texture_count_vertex || sampler_count_vertex) &&
-      !(current_graphics_descriptor_set_values_up_to_date_ &
-        (UINT32_C(1) << SpirvShaderTranslator::kDescriptorSetTexturesVertex));
-  bool write_pixel_textures =
-      (texture_count_pixel || sampler_count_pixel) &&
-      !(current_graphics_descriptor_set_values_up_to_date_ &
-        (UINT32_C(1) << SpirvShaderTranslator::kDescriptorSetTexturesPixel));
   descriptor_write_image_info_.clear();
   descriptor_write_image_info_.reserve(
-      (write_vertex_textures ? texture_count_vertex + sampler_count_vertex
-                             : 0) +
-      (write_pixel_textures ? texture_count_pixel + sampler_count_pixel : 0));
+      texture_count_vertex + sampler_count_vertex + texture_count_pixel +
+      sampler_count_pixel);
   size_t vertex_texture_image_info_offset = descriptor_write_image_info_.size();
-  if (write_vertex_textures && texture_count_vertex) {
-    for (const VulkanShader::TextureBinding& texture_binding :
-         textures_vertex) {
-      VkDescriptorImageInfo& descriptor_image_info =
-          descriptor_write_image_info_.emplace_back();
-      descriptor_image_info.imageView =
-          texture_cache_->GetActiveBindingOrNullImageView(
-              texture_binding.fetch_constant, texture_binding.dimension,
-              bool(texture_binding.is_signed));
-      descriptor_image_info.imageLayout =
-          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    }
+  for (const VulkanShader::TextureBinding& texture_binding : textures_vertex) {
+    VkDescriptorImageInfo& descriptor_image_info =
+        descriptor_write_image_info_.emplace_back();
+    descriptor_image_info.imageView =
+        texture_cache_->GetActiveBindingOrNullImageView(
+            texture_binding.fetch_constant, texture_binding.dimension,
+            bool(texture_binding.is_signed));
+    descriptor_image_info.imageLayout =
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
   }
   size_t vertex_sampler_image_info_offset = descriptor_write_image_info_.size();
-  if (write_vertex_textures && sampler_count_vertex) {
-    for (const std::pair<VulkanTextureCache::SamplerParameters, VkSampler>&
-             sampler_pair : current_samplers_vertex_) {
-      VkDescriptorImageInfo& descriptor_image_info =
-          descriptor_write_image_info_.emplace_back();
-      descriptor_image_info.sampler = sampler_pair.second;
-    }
+  for (const std::pair<VulkanTextureCache::SamplerParameters, VkSampler>&
+           sampler_pair : current_samplers_vertex_) {
+    VkDescriptorImageInfo& descriptor_image_info =
+        descriptor_write_image_info_.emplace_back();
+    descriptor_image_info.sampler = sampler_pair.second;
   }
   size_t pixel_texture_image_info_offset = descriptor_write_image_info_.size();
-  if (write_pixel_textures && texture_count_pixel) {
+  if (textures_pixel) {
     for (const VulkanShader::TextureBinding& texture_binding :
          *textures_pixel) {
       VkDescriptorImageInfo& descriptor_image_info =
@@ -4234,7 +4378,7 @@ bool VulkanCommandProcessor::UpdateBindings(const VulkanShader* vertex_shader,
     }
   }
   size_t pixel_sampler_image_info_offset = descriptor_write_image_info_.size();
-  if (write_pixel_textures && sampler_count_pixel) {
+  if (pixel_shader) {
     for (const std::pair<VulkanTextureCache::SamplerParameters, VkSampler>&
              sampler_pair : current_samplers_pixel_) {
       VkDescriptorImageInfo& descriptor_image_info =
@@ -4243,6 +4387,70 @@ bool VulkanCommandProcessor::UpdateBindings(const VulkanShader* vertex_shader,
     }
   }
 
+  // Reuse the texture descriptor sets written for the previous draws if the
+  // bindings are the same. Only within one submission though - the texture
+  // cache may destroy the image views and the samplers not used in the
+  // current submission once the previous submissions are completed, and new
+  // objects may get the same handles.
+  uint64_t submission_current = GetCurrentSubmission();
+  auto are_texture_descriptors_up_to_date =
+      [this, submission_current](
+          const TextureDescriptorSetBindings& bindings,
+          VkDescriptorSetLayout layout, size_t image_info_offset,
+          size_t image_info_count) {
+        if (bindings.submission != submission_current ||
+            bindings.layout != layout ||
+            bindings.image_info.size() != image_info_count) {
+          return false;
+        }
+        const VkDescriptorImageInfo* image_info =
+            descriptor_write_image_info_.data() + image_info_offset;
+        for (size_t i = 0; i < image_info_count; ++i) {
+          const VkDescriptorImageInfo& image_info_current = image_info[i];
+          const VkDescriptorImageInfo& image_info_written =
+              bindings.image_info[i];
+          if (image_info_current.sampler != image_info_written.sampler ||
+              image_info_current.imageView != image_info_written.imageView ||
+              image_info_current.imageLayout !=
+                  image_info_written.imageLayout) {
+            return false;
+          }
+        }
+        return true;
+      };
+  if (!are_texture_descriptors_up_to_date(
+          current_texture_descriptor_set_bindings_vertex_,
+          current_guest_graphics_pipeline_layout_
+              ->descriptor_set_layout_textures_vertex_ref(),
+          vertex_texture_image_info_offset,
+          texture_count_vertex + sampler_count_vertex)) {
+    current_graphics_descriptor_set_values_up_to_date_ &=
+        ~(UINT32_C(1) << SpirvShaderTranslator::kDescriptorSetTexturesVertex);
+  }
+  if (!are_texture_descriptors_up_to_date(
+          current_texture_descriptor_set_bindings_pixel_,
+          current_guest_graphics_pipeline_layout_
+              ->descriptor_set_layout_textures_pixel_ref(),
+          pixel_texture_image_info_offset,
+          texture_count_pixel + sampler_count_pixel)) {
+    current_graphics_descriptor_set_values_up_to_date_ &=
+        ~(UINT32_C(1) << SpirvShaderTranslator::kDescriptorSetTexturesPixel);
+  }
+
+  // Make sure new descriptor sets are bound to the command buffer.
+
+  current_graphics_descriptor_sets_bound_up_to_date_ &=
+      current_graphics_descriptor_set_values_up_to_date_;
+
+  bool write_vertex_textures =
+      (texture_count_vertex || sampler_count_vertex) &&
+      !(current_graphics_descriptor_set_values_up_to_date_ &
+        (UINT32_C(1) << SpirvShaderTranslator::kDescriptorSetTexturesVertex));
+  bool write_pixel_textures =
+      (texture_count_pixel || sampler_count_pixel) &&
+      !(current_graphics_descriptor_set_values_up_to_date_ &
+        (UINT32_C(1) << SpirvShaderTranslator::kDescriptorSetTexturesPixel));
+
   // Write the new descriptor sets.
 
   // Consecutive bindings updated via a single VkWriteDescriptorSet must have
@@ -4320,6 +4528,16 @@ bool VulkanCommandProcessor::UpdateBindings(const VulkanShader* vertex_shader,
     current_graphics_descriptor_sets_
         [SpirvShaderTranslator::kDescriptorSetTexturesVertex] =
             write_textures[0].dstSet;
+    TextureDescriptorSetBindings& bindings =
+        current_texture_descriptor_set_bindings_vertex_;
+    bindings.submission = submission_current;
+    bindings.layout = current_guest_graphics_pipeline_layout_
+                          ->descriptor_set_layout_textures_vertex_ref();
+    bindings.image_info.assign(
+        descriptor_write_image_info_.cbegin() +
+            vertex_texture_image_info_offset,
+        descriptor_write_image_info_.cbegin() +
+            pixel_texture_image_info_offset);
   }
   // Pixel shader textures and samplers.
   if (write_pixel_textures) {
@@ -4341,6 +4559,14 @@ bool VulkanCommandProcessor::UpdateBindings(const VulkanShader* vertex_shader,
     current_graphics_descriptor_sets_
         [SpirvShaderTranslator::kDescriptorSetTexturesPixel] =
             write_textures[0].dstSet;
+    TextureDescriptorSetBindings& bindings =
+        current_texture_descriptor_set_bindings_pixel_;
+    bindings.submission = submission_current;
+    bindings.layout = current_guest_graphics_pipeline_layout_
+                          ->descriptor_set_layout_textures_pixel_ref();
+    bindings.image_info.assign(
+        descriptor_write_image_info_.cbegin() + pixel_texture_image_info_offset,
+        descriptor_write_image_info_.cend());
   }
   // Write.
   if (write_descriptor_set_count) {
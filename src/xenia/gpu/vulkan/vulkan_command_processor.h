@@ -143,6 +143,11 @@ class VulkanCommandProcessor final : public CommandProcessor {
 
   void ClearCaches() override;
 
+  void InitializeShaderStorage(const std::filesystem::path& cache_root,
+                               uint32_t title_id, bool blocking) override;
+
+  CacheStatistics GetCacheStatistics() const override;
+
   void TracePlaybackWroteMemory(uint32_t base_ptr, uint32_t length) override;
 
   void RestoreEdramSnapshot(const void* snapshot) override;
@@ -207,9 +212,14 @@ class VulkanCommandProcessor final : public CommandProcessor {
   void SubmitBarriersAndEnterRenderTargetCacheRenderPass(
       VkRenderPass render_pass,
       const VulkanRenderTargetCache::Framebuffer* framebuffer);
-  // Must be called before doing anything outside the render pass scope,
-  // including adding pipeline barriers that are not a part of the render pass
-  // scope. Submission must be open.
+  // Like SubmitBarriersAndEnterRenderTargetCacheRenderPass, but for the
+  // dynamic rendering path of the render target cache - keeps the current
+  // rendering scope if the attachments are the same.
+  void SubmitBarriersAndBeginRenderTargetCacheRendering(
+      const VulkanRenderTargetCache::Rendering& rendering);
+  // Must be called before doing anything outside the render pass (or dynamic
+  // rendering) scope, including adding pipeline barriers that are not a part
+  // of the render pass scope. Submission must be open.
   void EndRenderPass();
 
   VkDescriptorSetLayout GetSingleTransientDescriptorLayout(
@@ -267,12 +277,6 @@ class VulkanCommandProcessor final : public CommandProcessor {
  protected:
   bool SetupContext() override;
   void ShutdownContext() override;
-  XE_FORCEINLINE
-  void WriteRegister(uint32_t index, uint32_t value) override;
-  XE_FORCEINLINE
-  virtual void WriteRegistersFromMem(uint32_t start_index, uint32_t* base,
-                                     uint32_t num_registers) override;
-
   void OnGammaRamp256EntryTableValueWritten() override;
   void OnGammaRampPWLValueWritten() override;
 
@@ -388,6 +392,15 @@ class VulkanCommandProcessor final : public CommandProcessor {
     VkDescriptorSet set;
   };
 
+  // The descriptors last written to a texture descriptor set in
+  // UpdateBindings, for reusing the set if the bindings stay the same.
+  struct TextureDescriptorSetBindings {
+    uint64_t submission = 0;
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    // Textures, then samplers.
+    std::vector<VkDescriptorImageInfo> image_info;
+  };
+
   struct UsedTextureTransientDescriptorSet {
     uint64_t frame;
     TextureDescriptorSetLayoutKey layout;
@@ -450,6 +463,14 @@ class VulkanCommandProcessor final : public CommandProcessor {
       bool shader_32bit_index_dma, const draw_util::ViewportInfo& viewport_info,
       uint32_t used_texture_mask, reg::RB_DEPTHCONTROL normalized_depth_control,
       uint32_t normalized_color_mask);
+  // Invalidates the texture bindings and the fetch constant buffer for the
+  // fetch constants written since the previous draw.
+  void InvalidateWrittenFetchConstants();
+  // Invalidates the float constant buffer of a shader stage if any of the
+  // constants used by it have been written since the previous draw.
+  void InvalidateWrittenFloatConstants(uint32_t first_register,
+                                       const uint64_t* float_constant_map,
+                                       uint32_t constant_buffer);
   bool UpdateBindings(const VulkanShader* vertex_shader,
                       const VulkanShader* pixel_shader);
   // Allocates a descriptor set and fills one or two VkWriteDescriptorSet
@@ -481,6 +502,9 @@ class VulkanCommandProcessor final : public CommandProcessor {
   std::vector<VkSemaphore> semaphores_free_;
 
   bool submission_open_ = false;
+  // Guest draws recorded in the current submission, for splitting it with
+  // submit_split_draw_count.
+  uint32_t submission_draw_count_ = 0;
   uint64_t submission_completed_ = 0;
   // In case vkQueueSubmit fails after something like a successful
   // vkQueueBindSparse, to wait correctly on the next attempt.
@@ -694,11 +718,21 @@ class VulkanCommandProcessor final : public CommandProcessor {
       current_samplers_vertex_;
   std::vector<std::pair<VulkanTextureCache::SamplerParameters, VkSampler>>
       current_samplers_pixel_;
+  TextureDescriptorSetBindings current_texture_descriptor_set_bindings_vertex_;
+  TextureDescriptorSetBindings current_texture_descriptor_set_bindings_pixel_;
 
   // Cache render pass currently started in the command buffer with the
   // framebuffer.
   VkRenderPass current_render_pass_;
   const VulkanRenderTargetCache::Framebuffer* current_framebuffer_;
+  // Dynamic rendering scope currently started in the command buffer, if
+  // current_rendering_active_.
+  bool current_rendering_active_;
+  VulkanRenderTargetCache::Rendering current_rendering_;
+  // Whether a dynamic rendering scope may have been ended since the last
+  // draw-to-draw barrier, which takes the place of the external subpass
+  // dependencies of the render passes between rendering scopes.
+  bool dynamic_rendering_barrier_needed_;
 
   // Currently bound graphics pipeline, either from the pipeline cache (with
   // potentially deferred creation - current_external_graphics_pipeline_ is
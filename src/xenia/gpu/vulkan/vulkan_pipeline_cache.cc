@@ -11,14 +11,21 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #include <memory>
+#include <set>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
@@ -34,6 +41,37 @@
 #include "xenia/gpu/xenos.h"
 #include "xenia/ui/vulkan/vulkan_util.h"
 
+DEFINE_bool(
+    vulkan_async_pipeline_creation, false,
+    "Create graphics pipelines on background threads instead of stalling the "
+    "command processor. Draws whose pipelines are not created yet are skipped, "
+    "which may cause temporary graphical glitches when new pipelines are "
+    "encountered, but removes hitches.",
+    "Vulkan");
+DEFINE_int32(
+    vulkan_pipeline_creation_threads, -1,
+    "Number of threads used for asynchronous graphics pipeline creation if "
+    "vulkan_async_pipeline_creation is enabled. -1 to calculate automatically "
+    "(75% of logical CPU cores), a positive number to specify the number of "
+    "threads explicitly (up to the number of logical CPU cores).",
+    "Vulkan");
+DEFINE_bool(
+    vulkan_spirv_optimize, false,
+    "Optimize the translated shaders with the spirv-opt performance passes "
+    "from the SPIRV-Tools library of the Vulkan SDK on a background thread, "
+    "and replace the pipelines with ones using the optimized shaders when they "
+    "are ready. The unoptimized shaders are used until then.",
+    "Vulkan");
+DEFINE_bool(
+    vulkan_pipeline_libraries, true,
+    "If VK_EXT_graphics_pipeline_library with fast linking is supported, link "
+    "the graphics pipelines first encountered during gameplay from libraries "
+    "of their shaders and state subsets shared between the pipelines, which "
+    "is much faster than creating the whole pipelines, and replace them with "
+    "the monolithic pipelines created on a background thread when they are "
+    "ready.",
+    "Vulkan");
+
 namespace xe {
 namespace gpu {
 namespace vulkan {
@@ -63,6 +101,15 @@ bool VulkanPipelineCache::Initialize() {
       render_target_cache_.msaa_2x_attachments_supported(),
       render_target_cache_.msaa_2x_no_attachments_supported(),
       edram_fragment_shader_interlock);
+  if (cvars::parallel_draw_shader_translation) {
+    pixel_shader_translator_ = std::make_unique<SpirvShaderTranslator>(
+        SpirvShaderTranslator::Features(provider.device_info()),
+        render_target_cache_.msaa_2x_attachments_supported(),
+        render_target_cache_.msaa_2x_no_attachments_supported(),
+        edram_fragment_shader_interlock);
+    pixel_shader_translation_worker_ =
+        std::make_unique<ShaderTranslationWorker>();
+  }
 
   if (edram_fragment_shader_interlock) {
     std::vector<uint8_t> depth_only_fragment_shader_code =
@@ -81,6 +128,65 @@ bool VulkanPipelineCache::Initialize() {
     }
   }
 
+  // Create an empty host pipeline cache for the pipelines created before the
+  // shader storage is opened, it will be replaced with the stored one when the
+  // title is known.
+  LoadHostPipelineCache(std::filesystem::path());
+
+  creation_threads_busy_ = 0;
+  creation_threads_shutdown_from_ = SIZE_MAX;
+  if (cvars::vulkan_async_pipeline_creation) {
+    uint32_t logical_processor_count = xe::threading::logical_processor_count();
+    if (!logical_processor_count) {
+      // Pick some reasonable amount if couldn't determine the number of cores.
+      logical_processor_count = 6;
+    }
+    size_t creation_thread_count;
+    if (cvars::vulkan_pipeline_creation_threads <= 0) {
+      creation_thread_count =
+          std::max(logical_processor_count * 3 / 4, uint32_t(1));
+    } else {
+      creation_thread_count =
+          std::min(uint32_t(cvars::vulkan_pipeline_creation_threads),
+                   logical_processor_count);
+    }
+    for (size_t i = 0; i < creation_thread_count; ++i) {
+      std::unique_ptr<xe::threading::Thread> creation_thread =
+          xe::threading::Thread::Create({}, [this, i]() { CreationThread(i); });
+      assert_not_null(creation_thread);
+      creation_thread->set_name("Vulkan Pipelines");
+      creation_threads_.push_back(std::move(creation_thread));
+    }
+  }
+
+  if (cvars::vulkan_spirv_optimize) {
+    if (spirv_tools_context_.Initialize(
+            SpirvShaderTranslator::Features(provider.device_info())
+                .spirv_version) &&
+        spirv_tools_context_.IsOptimizerAvailable()) {
+      shader_optimization_enabled_ = true;
+    } else {
+      XELOGW(
+          "VulkanPipelineCache: The SPIRV-Tools optimizer is not available, "
+          "the translated shaders will not be optimized");
+      spirv_tools_context_.Shutdown();
+    }
+  }
+
+  pipeline_libraries_enabled_ =
+      cvars::vulkan_pipeline_libraries &&
+      provider.device_info().ext_VK_EXT_graphics_pipeline_library &&
+      provider.device_info().graphicsPipelineLibrary &&
+      provider.device_info().graphicsPipelineLibraryFastLinking;
+
+  if (shader_optimization_enabled_ || pipeline_libraries_enabled_) {
+    optimization_thread_shutdown_ = false;
+    optimization_thread_ = xe::threading::Thread::Create(
+        {}, [this]() { OptimizationThread(); });
+    assert_not_null(optimization_thread_);
+    optimization_thread_->set_name("Vulkan Pipeline Optimization");
+  }
+
   return true;
 }
 
@@ -90,14 +196,59 @@ void VulkanPipelineCache::Shutdown() {
   const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
   VkDevice device = provider.device();
 
+  // Shut down all threads, before destroying the pipelines since they may be
+  // creating them.
+  if (!creation_threads_.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(creation_request_lock_);
+      creation_threads_shutdown_from_ = 0;
+    }
+    creation_request_cond_.notify_all();
+    for (size_t i = 0; i < creation_threads_.size(); ++i) {
+      xe::threading::Wait(creation_threads_[i].get(), false);
+    }
+    creation_threads_.clear();
+  }
+  creation_queue_.clear();
+  draws_skipped_pipeline_pending_ = 0;
+  if (optimization_thread_) {
+    {
+      std::lock_guard<std::mutex> lock(optimization_request_lock_);
+      optimization_thread_shutdown_ = true;
+    }
+    optimization_request_cond_.notify_all();
+    xe::threading::Wait(optimization_thread_.get(), false);
+    optimization_thread_.reset();
+  }
+  optimization_shader_queue_.clear();
+  optimization_pipeline_queue_.clear();
+
+  // Shut down the persistent shader / pipeline storage, also writing the host
+  // pipeline cache.
+  ShutdownShaderStorage();
+
+  ui::vulkan::util::DestroyAndNullHandle(dfn.vkDestroyPipelineCache, device,
+                                         host_pipeline_cache_);
+
   // Destroy all pipelines.
   last_pipeline_ = nullptr;
   for (const auto& pipeline_pair : pipelines_) {
     if (pipeline_pair.second.pipeline != VK_NULL_HANDLE) {
       dfn.vkDestroyPipeline(device, pipeline_pair.second.pipeline, nullptr);
     }
+    if (pipeline_pair.second.optimized_pipeline != VK_NULL_HANDLE) {
+      dfn.vkDestroyPipeline(device, pipeline_pair.second.optimized_pipeline,
+                            nullptr);
+    }
   }
   pipelines_.clear();
+  DestroyReplacedPipelines(true);
+  for (const auto& pipeline_library_pair : pipeline_libraries_) {
+    if (pipeline_library_pair.second != VK_NULL_HANDLE) {
+      dfn.vkDestroyPipeline(device, pipeline_library_pair.second, nullptr);
+    }
+  }
+  pipeline_libraries_.clear();
 
   // Destroy all internal shaders.
   ui::vulkan::util::DestroyAndNullHandle(dfn.vkDestroyShaderModule, device,
@@ -116,17 +267,577 @@ void VulkanPipelineCache::Shutdown() {
   shaders_.clear();
   texture_binding_layout_map_.clear();
   texture_binding_layouts_.clear();
+  shader_storage_index_ = 0;
 
   // Shut down shader translation.
+  pixel_shader_translation_worker_.reset();
+  pixel_shader_translator_.reset();
   shader_translator_.reset();
+  spirv_tools_context_.Shutdown();
+}
+
+void VulkanPipelineCache::InitializeShaderStorage(
+    const std::filesystem::path& cache_root, uint32_t title_id, bool blocking) {
+  // The host pipeline cache object may be replaced.
+  AwaitPipelineCreationCompletion();
+
+  ShutdownShaderStorage();
+
+  auto shader_storage_root = cache_root / "shaders";
+  // For files that can be moved between different hosts.
+  auto shader_storage_shareable_root = shader_storage_root / "shareable";
+  if (!std::filesystem::exists(shader_storage_shareable_root)) {
+    if (!std::filesystem::create_directories(shader_storage_shareable_root)) {
+      XELOGE(
+          "Failed to create the shareable shader storage directory, persistent "
+          "shader storage will be disabled: {}",
+          shader_storage_shareable_root);
+      return;
+    }
+  }
+  // For the driver pipeline cache, which is specific to the device and the
+  // driver version (validated by the driver itself).
+  auto shader_storage_local_root = shader_storage_root / "local";
+  if (!std::filesystem::exists(shader_storage_local_root) &&
+      !std::filesystem::create_directories(shader_storage_local_root)) {
+    XELOGW(
+        "Failed to create the local shader storage directory, the Vulkan "
+        "pipeline cache will not be stored: {}",
+        shader_storage_local_root);
+  } else {
+    LoadHostPipelineCache(shader_storage_local_root /
+                          fmt::format("{:08X}.vulkan.vkpc", title_id));
+  }
+
+  bool edram_fragment_shader_interlock =
+      render_target_cache_.GetPath() ==
+      RenderTargetCache::Path::kPixelShaderInterlock;
+
+  // Initialize the pipeline storage stream - read pipeline descriptions and
+  // collect used shader modifications to translate.
+  std::vector<PipelineStoredDescription> pipeline_stored_descriptions;
+  // <Shader hash, modification bits>.
+  std::set<std::pair<uint64_t, uint64_t>> shader_translations_needed;
+  auto pipeline_storage_file_path =
+      shader_storage_shareable_root /
+      fmt::format("{:08X}.{}.vulkan.xpso", title_id,
+                  edram_fragment_shader_interlock ? "fsi" : "rtv");
+  pipeline_storage_file_ =
+      xe::filesystem::OpenFile(pipeline_storage_file_path, "a+b");
+  if (!pipeline_storage_file_) {
+    XELOGE(
+        "Failed to open the Vulkan pipeline description storage file for "
+        "writing, persistent shader storage will be disabled: {}",
+        pipeline_storage_file_path);
+    return;
+  }
+  pipeline_storage_file_flush_needed_ = false;
+  // 'XEPS'.
+  const uint32_t pipeline_storage_magic = 0x53504558;
+  // 'VKFS' or 'VKRT'.
+  const uint32_t pipeline_storage_magic_api =
+      edram_fragment_shader_interlock ? 0x53464B56 : 0x54524B56;
+  const uint32_t pipeline_storage_version_swapped =
+      xe::byte_swap(PipelineDescription::kVersion);
+  const uint32_t pipeline_storage_modification_version_swapped =
+      xe::byte_swap(SpirvShaderTranslator::Modification::kVersion);
+  struct {
+    uint32_t magic;
+    uint32_t magic_api;
+    uint32_t version_swapped;
+    uint32_t modification_version_swapped;
+  } pipeline_storage_file_header;
+  // Pipelines that may be created on this device, the rest are kept in the
+  // file so it stays shareable between devices.
+  size_t pipeline_storage_supported_count = 0;
+  if (fread(&pipeline_storage_file_header, sizeof(pipeline_storage_file_header),
+            1, pipeline_storage_file_) &&
+      pipeline_storage_file_header.magic == pipeline_storage_magic &&
+      pipeline_storage_file_header.magic_api == pipeline_storage_magic_api &&
+      pipeline_storage_file_header.version_swapped ==
+          pipeline_storage_version_swapped &&
+      pipeline_storage_file_header.modification_version_swapped ==
+          pipeline_storage_modification_version_swapped) {
+    xe::filesystem::Seek(pipeline_storage_file_, 0, SEEK_END);
+    int64_t pipeline_storage_told_end =
+        xe::filesystem::Tell(pipeline_storage_file_);
+    size_t pipeline_storage_told_count =
+        size_t(pipeline_storage_told_end >=
+                       int64_t(sizeof(pipeline_storage_file_header))
+                   ? (uint64_t(pipeline_storage_told_end) -
+                      sizeof(pipeline_storage_file_header)) /
+                         sizeof(PipelineStoredDescription)
+                   : 0);
+    if (pipeline_storage_told_count &&
+        xe::filesystem::Seek(pipeline_storage_file_,
+                             int64_t(sizeof(pipeline_storage_file_header)),
+                             SEEK_SET)) {
+      pipeline_stored_descriptions.resize(pipeline_storage_told_count);
+      pipeline_stored_descriptions.resize(
+          fread(pipeline_stored_descriptions.data(),
+                sizeof(PipelineStoredDescription), pipeline_storage_told_count,
+                pipeline_storage_file_));
+      size_t pipeline_storage_read_count = pipeline_stored_descriptions.size();
+      for (size_t i = 0; i < pipeline_storage_read_count; ++i) {
+        const PipelineStoredDescription& pipeline_stored_description =
+            pipeline_stored_descriptions[i];
+        // Validate file integrity, stop and truncate the stream if data is
+        // corrupted.
+        if (pipeline_stored_description.description.GetHash() !=
+            pipeline_stored_description.description_hash) {
+          pipeline_stored_descriptions.resize(i);
+          break;
+        }
+        // Skip pipelines requiring unsupported device features, but keep them
+        // in the file.
+        if (!ArePipelineRequirementsMet(
+                pipeline_stored_description.description)) {
+          continue;
+        }
+        ++pipeline_storage_supported_count;
+        // Mark the shader modifications as needed for translation.
+        shader_translations_needed.emplace(
+            pipeline_stored_description.description.vertex_shader_hash,
+            pipeline_stored_description.description.vertex_shader_modification);
+        if (pipeline_stored_description.description.pixel_shader_hash) {
+          shader_translations_needed.emplace(
+              pipeline_stored_description.description.pixel_shader_hash,
+              pipeline_stored_description.description
+                  .pixel_shader_modification);
+        }
+      }
+    }
+  }
+
+  size_t logical_processor_count = xe::threading::logical_processor_count();
+  if (!logical_processor_count) {
+    // Pick some reasonable amount if couldn't determine the number of cores.
+    logical_processor_count = 6;
+  }
+
+  // Initialize the Xenos shader storage stream.
+  uint64_t shader_storage_initialization_start =
+      xe::Clock::QueryHostTickCount();
+  auto shader_storage_file_path =
+      shader_storage_shareable_root / fmt::format("{:08X}.xsh", title_id);
+  shader_storage_file_ =
+      xe::filesystem::OpenFile(shader_storage_file_path, "a+b");
+  if (!shader_storage_file_) {
+    XELOGE(
+        "Failed to open the guest shader storage file for writing, persistent "
+        "shader storage will be disabled: {}",
+        shader_storage_file_path);
+    fclose(pipeline_storage_file_);
+    pipeline_storage_file_ = nullptr;
+    return;
+  }
+  ++shader_storage_index_;
+  shader_storage_file_flush_needed_ = false;
+  struct {
+    uint32_t magic;
+    uint32_t version_swapped;
+  } shader_storage_file_header;
+  // 'XESH'.
+  const uint32_t shader_storage_magic = 0x48534558;
+  if (fread(&shader_storage_file_header, sizeof(shader_storage_file_header), 1,
+            shader_storage_file_) &&
+      shader_storage_file_header.magic == shader_storage_magic &&
+      xe::byte_swap(shader_storage_file_header.version_swapped) ==
+          ShaderStoredHeader::kVersion) {
+    uint64_t shader_storage_valid_bytes = sizeof(shader_storage_file_header);
+    // Load and translate shaders written by previous Xenia executions until the
+    // end of the file or until a corrupted one is detected.
+    ShaderStoredHeader shader_header;
+    std::vector<uint32_t> ucode_dwords;
+    ucode_dwords.reserve(0xFFFF);
+    std::vector<uint8_t> ucode_analysis;
+    size_t shaders_translated = 0;
+
+    // Threads overlapping file reading.
+    std::mutex shaders_translation_thread_mutex;
+    std::condition_variable shaders_translation_thread_cond;
+    std::deque<VulkanShader*> shaders_to_translate;
+    size_t shader_translation_threads_busy = 0;
+    bool shader_translation_threads_shutdown = false;
+    std::mutex shaders_failed_to_translate_mutex;
+    std::vector<VulkanShader::VulkanTranslation*> shaders_failed_to_translate;
+    auto shader_translation_thread_function = [&]() {
+      const ui::vulkan::VulkanProvider& provider =
+          command_processor_.GetVulkanProvider();
+      StringBuffer ucode_disasm_buffer;
+      SpirvShaderTranslator translator(
+          SpirvShaderTranslator::Features(provider.device_info()),
+          render_target_cache_.msaa_2x_attachments_supported(),
+          render_target_cache_.msaa_2x_no_attachments_supported(),
+          edram_fragment_shader_interlock);
+      for (;;) {
+        VulkanShader* shader_to_translate;
+        for (;;) {
+          std::unique_lock<std::mutex> lock(shaders_translation_thread_mutex);
+          if (shaders_to_translate.empty()) {
+            if (shader_translation_threads_shutdown) {
+              return;
+            }
+            shaders_translation_thread_cond.wait(lock);
+            continue;
+          }
+          shader_to_translate = shaders_to_translate.front();
+          shaders_to_translate.pop_front();
+          ++shader_translation_threads_busy;
+          break;
+        }
+        shader_to_translate->AnalyzeUcode(ucode_disasm_buffer);
+        // Translate each needed modification on this thread after performing
+        // modification-independent analysis of the whole shader.
+        uint64_t ucode_data_hash = shader_to_translate->ucode_data_hash();
+        for (auto modification_it = shader_translations_needed.lower_bound(
+                 std::make_pair(ucode_data_hash, uint64_t(0)));
+             modification_it != shader_translations_needed.end() &&
+             modification_it->first == ucode_data_hash;
+             ++modification_it) {
+          VulkanShader::VulkanTranslation* translation =
+              static_cast<VulkanShader::VulkanTranslation*>(
+                  shader_to_translate->GetOrCreateTranslation(
+                      modification_it->second));
+          // Only try (and delete in case of failure) if it's a new translation.
+          // If it's a shader previously encountered in the game, translation of
+          // which has failed, and the shader storage is loaded later, keep it
+          // this way not to try to translate it again.
+          if (!translation->is_translated() &&
+              !TranslateAnalyzedShader(translator, *translation)) {
+            std::lock_guard<std::mutex> lock(shaders_failed_to_translate_mutex);
+            shaders_failed_to_translate.push_back(translation);
+          }
+        }
+        {
+          std::lock_guard<std::mutex> lock(shaders_translation_thread_mutex);
+          --shader_translation_threads_busy;
+        }
+      }
+    };
+    std::vector<std::unique_ptr<xe::threading::Thread>>
+        shader_translation_threads;
+
+    while (true) {
+      if (!fread(&shader_header, sizeof(shader_header), 1,
+                 shader_storage_file_)) {
+        break;
+      }
+      size_t ucode_byte_count =
+          shader_header.ucode_dword_count * sizeof(uint32_t);
+      ucode_dwords.resize(shader_header.ucode_dword_count);
+      if (shader_header.ucode_dword_count &&
+          !fread(ucode_dwords.data(), ucode_byte_count, 1,
+                 shader_storage_file_)) {
+        break;
+      }
+      uint64_t ucode_data_hash =
+          XXH3_64bits(ucode_dwords.data(), ucode_byte_count);
+      if (shader_header.ucode_data_hash != ucode_data_hash) {
+        // Validation failed.
+        break;
+      }
+      ucode_analysis.resize(shader_header.ucode_analysis_byte_count);
+      if (shader_header.ucode_analysis_byte_count &&
+          !fread(ucode_analysis.data(), ucode_analysis.size(), 1,
+                 shader_storage_file_)) {
+        break;
+      }
+      if (shader_header.ucode_analysis_hash !=
+          XXH3_64bits(ucode_analysis.data(), ucode_analysis.size())) {
+        break;
+      }
+      shader_storage_valid_bytes += sizeof(shader_header) + ucode_byte_count +
+                                    ucode_analysis.size();
+      VulkanShader* shader =
+          LoadShader(shader_header.type, ucode_dwords.data(),
+                     shader_header.ucode_dword_count, ucode_data_hash);
+      if (shader->ucode_storage_index() == shader_storage_index_) {
+        // Appeared twice in this file for some reason - skip, otherwise race
+        // condition will be caused by translating twice in parallel.
+        continue;
+      }
+      // Loaded from the current storage - don't write again.
+      shader->set_ucode_storage_index(shader_storage_index_);
+      // Skip the analysis on the translation threads if its results have been
+      // stored, unless the disassembly, which is not stored, is needed for
+      // dumping.
+      if (!ucode_analysis.empty() && cvars::dump_shaders.empty()) {
+        shader->DeserializeUcodeAnalysis(ucode_analysis.data(),
+                                         ucode_analysis.size());
+      }
+      // Create new threads if the currently existing threads can't keep up
+      // with file reading, but not more than the number of logical processors
+      // minus one.
+      size_t shader_translation_threads_needed;
+      {
+        std::lock_guard<std::mutex> lock(shaders_translation_thread_mutex);
+        shader_translation_threads_needed = std::max(
+            std::min(shader_translation_threads_busy +
+                         shaders_to_translate.size() + size_t(1),
+                     logical_processor_count - size_t(1)),
+            size_t(1));
+      }
+      while (shader_translation_threads.size() <
+             shader_translation_threads_needed) {
+        auto thread = xe::threading::Thread::Create(
+            {}, shader_translation_thread_function);
+        assert_not_null(thread);
+        thread->set_name("Shader Translation");
+        shader_translation_threads.push_back(std::move(thread));
+      }
+      // Request ucode information gathering and translation of all the needed
+      // shaders.
+      {
+        std::lock_guard<std::mutex> lock(shaders_translation_thread_mutex);
+        shaders_to_translate.push_back(shader);
+      }
+      shaders_translation_thread_cond.notify_one();
+      ++shaders_translated;
+    }
+    if (!shader_translation_threads.empty()) {
+      {
+        std::lock_guard<std::mutex> lock(shaders_translation_thread_mutex);
+        shader_translation_threads_shutdown = true;
+      }
+      shaders_translation_thread_cond.notify_all();
+      for (auto& shader_translation_thread : shader_translation_threads) {
+        xe::threading::Wait(shader_translation_thread.get(), false);
+      }
+      shader_translation_threads.clear();
+      for (VulkanShader::VulkanTranslation* translation :
+           shaders_failed_to_translate) {
+        VulkanShader* shader = static_cast<VulkanShader*>(&translation->shader());
+        shader->DestroyTranslation(translation->modification());
+        if (shader->translations().empty()) {
+          shaders_.erase(shader->ucode_data_hash());
+          delete shader;
+        }
+      }
+    }
+    XELOGGPU("Translated {} shaders from the storage in {} milliseconds",
+             shaders_translated,
+             (xe::Clock::QueryHostTickCount() -
+              shader_storage_initialization_start) *
+                 1000 / xe::Clock::QueryHostTickFrequency());
+    xe::filesystem::TruncateStdioFile(shader_storage_file_,
+                                      shader_storage_valid_bytes);
+  } else {
+    xe::filesystem::TruncateStdioFile(shader_storage_file_, 0);
+    shader_storage_file_header.magic = shader_storage_magic;
+    shader_storage_file_header.version_swapped =
+        xe::byte_swap(ShaderStoredHeader::kVersion);
+    fwrite(&shader_storage_file_header, sizeof(shader_storage_file_header), 1,
+           shader_storage_file_);
+  }
+
+  // Create the pipelines.
+  if (!pipeline_stored_descriptions.empty()) {
+    uint64_t pipeline_creation_start = xe::Clock::QueryHostTickCount();
+
+    // Look up the shaders, the layouts and the render passes on this thread,
+    // then create the pipelines themselves in parallel.
+    std::vector<PipelineCreationArguments> pipelines_to_create;
+    pipelines_to_create.reserve(pipeline_storage_supported_count);
+    for (const PipelineStoredDescription& pipeline_stored_description :
+         pipeline_stored_descriptions) {
+      const PipelineDescription& pipeline_description =
+          pipeline_stored_description.description;
+      if (!ArePipelineRequirementsMet(pipeline_description)) {
+        continue;
+      }
+      // Skip already known pipelines - those have already been created.
+      if (pipelines_.find(pipeline_description) != pipelines_.end()) {
+        continue;
+      }
+
+      auto vertex_shader_it =
+          shaders_.find(pipeline_description.vertex_shader_hash);
+      if (vertex_shader_it == shaders_.end()) {
+        continue;
+      }
+      auto vertex_shader = static_cast<VulkanShader::VulkanTranslation*>(
+          vertex_shader_it->second->GetTranslation(
+              pipeline_description.vertex_shader_modification));
+      if (!vertex_shader || !vertex_shader->is_translated() ||
+          !vertex_shader->is_valid()) {
+        continue;
+      }
+      VulkanShader::VulkanTranslation* pixel_shader = nullptr;
+      if (pipeline_description.pixel_shader_hash) {
+        auto pixel_shader_it =
+            shaders_.find(pipeline_description.pixel_shader_hash);
+        if (pixel_shader_it == shaders_.end()) {
+          continue;
+        }
+        pixel_shader = static_cast<VulkanShader::VulkanTranslation*>(
+            pixel_shader_it->second->GetTranslation(
+                pipeline_description.pixel_shader_modification));
+        if (!pixel_shader || !pixel_shader->is_translated() ||
+            !pixel_shader->is_valid()) {
+          continue;
+        }
+      }
+
+      const PipelineLayoutProvider* pipeline_layout;
+      PipelineCreationArguments creation_arguments;
+      if (!GetPipelineCreationArguments(pipeline_description, vertex_shader,
+                                        pixel_shader, pipeline_layout,
+                                        creation_arguments)) {
+        continue;
+      }
+      creation_arguments.pipeline =
+          &*pipelines_
+                .emplace(std::piecewise_construct,
+                         std::forward_as_tuple(pipeline_description),
+                         std::forward_as_tuple(pipeline_layout))
+                .first;
+      pipelines_to_create.push_back(creation_arguments);
+    }
+
+    // Create the pipelines on all the cores, including this thread, so minus
+    // 1 for the additional threads.
+    std::atomic<size_t> pipelines_to_create_next{0};
+    std::atomic<size_t> pipelines_created{0};
+    auto pipeline_creation_thread_function = [&]() {
+      for (;;) {
+        size_t pipeline_index =
+            pipelines_to_create_next.fetch_add(1, std::memory_order_relaxed);
+        if (pipeline_index >= pipelines_to_create.size()) {
+          return;
+        }
+        if (EnsurePipelineCreated(pipelines_to_create[pipeline_index])) {
+          pipelines_created.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    };
+    std::vector<std::unique_ptr<xe::threading::Thread>>
+        pipeline_creation_threads;
+    size_t pipeline_creation_thread_count =
+        std::min(pipelines_to_create.size(), logical_processor_count) -
+        std::min(pipelines_to_create.size(), size_t(1));
+    for (size_t i = 0; i < pipeline_creation_thread_count; ++i) {
+      auto thread = xe::threading::Thread::Create(
+          {}, pipeline_creation_thread_function);
+      assert_not_null(thread);
+      thread->set_name("Vulkan Pipelines");
+      pipeline_creation_threads.push_back(std::move(thread));
+    }
+    pipeline_creation_thread_function();
+    for (auto& pipeline_creation_thread : pipeline_creation_threads) {
+      xe::threading::Wait(pipeline_creation_thread.get(), false);
+    }
+    pipeline_creation_threads.clear();
+
+    XELOGGPU(
+        "Created {} graphics pipelines (not including reading the "
+        "descriptions) from the storage in {} milliseconds",
+        pipelines_created.load(std::memory_order_relaxed),
+        (xe::Clock::QueryHostTickCount() - pipeline_creation_start) * 1000 /
+            xe::Clock::QueryHostTickFrequency());
+    // If any pipeline descriptions were corrupted (or the whole file has excess
+    // bytes in the end), truncate to the last valid pipeline description.
+    xe::filesystem::TruncateStdioFile(
+        pipeline_storage_file_,
+        uint64_t(sizeof(pipeline_storage_file_header) +
+                 sizeof(PipelineStoredDescription) *
+                     pipeline_stored_descriptions.size()));
+  } else {
+    xe::filesystem::TruncateStdioFile(pipeline_storage_file_, 0);
+    pipeline_storage_file_header.magic = pipeline_storage_magic;
+    pipeline_storage_file_header.magic_api = pipeline_storage_magic_api;
+    pipeline_storage_file_header.version_swapped =
+        pipeline_storage_version_swapped;
+    pipeline_storage_file_header.modification_version_swapped =
+        pipeline_storage_modification_version_swapped;
+    fwrite(&pipeline_storage_file_header, sizeof(pipeline_storage_file_header),
+           1, pipeline_storage_file_);
+  }
+
+  shader_storage_cache_root_ = cache_root;
+  shader_storage_title_id_ = title_id;
+
+  // Start the storage writing thread.
+  storage_write_flush_shaders_ = false;
+  storage_write_flush_pipelines_ = false;
+  storage_write_thread_shutdown_ = false;
+  storage_write_thread_ =
+      xe::threading::Thread::Create({}, [this]() { StorageWriteThread(); });
+  assert_not_null(storage_write_thread_);
+  storage_write_thread_->set_name("Vulkan Storage writer");
+}
+
+void VulkanPipelineCache::ShutdownShaderStorage() {
+  if (storage_write_thread_) {
+    {
+      std::lock_guard<std::mutex> lock(storage_write_request_lock_);
+      storage_write_thread_shutdown_ = true;
+    }
+    storage_write_request_cond_.notify_all();
+    xe::threading::Wait(storage_write_thread_.get(), false);
+    storage_write_thread_.reset();
+  }
+  storage_write_shader_queue_.clear();
+  storage_write_pipeline_queue_.clear();
+
+  if (pipeline_storage_file_) {
+    fclose(pipeline_storage_file_);
+    pipeline_storage_file_ = nullptr;
+    pipeline_storage_file_flush_needed_ = false;
+  }
+
+  if (shader_storage_file_) {
+    fclose(shader_storage_file_);
+    shader_storage_file_ = nullptr;
+    shader_storage_file_flush_needed_ = false;
+  }
+
+  StoreHostPipelineCache();
+  host_pipeline_cache_file_path_.clear();
+
+  shader_storage_cache_root_.clear();
+  shader_storage_title_id_ = 0;
+}
+
+void VulkanPipelineCache::EndSubmission() {
+  if (shader_storage_file_flush_needed_ ||
+      pipeline_storage_file_flush_needed_) {
+    {
+      std::lock_guard<std::mutex> lock(storage_write_request_lock_);
+      if (shader_storage_file_flush_needed_) {
+        storage_write_flush_shaders_ = true;
+      }
+      if (pipeline_storage_file_flush_needed_) {
+        storage_write_flush_pipelines_ = true;
+      }
+    }
+    storage_write_request_cond_.notify_one();
+    shader_storage_file_flush_needed_ = false;
+    pipeline_storage_file_flush_needed_ = false;
+  }
+  COUNT_profile_set("gpu/pipeline_cache/vulkan/draws_skipped_pipeline_pending",
+                    draws_skipped_pipeline_pending_);
+  if (draws_skipped_pipeline_pending_) {
+    XELOGGPU(
+        "VulkanPipelineCache: Skipped {} draws in the submission while their "
+        "pipelines were being created",
+        draws_skipped_pipeline_pending_);
+    draws_skipped_pipeline_pending_ = 0;
+  }
 }
 
 VulkanShader* VulkanPipelineCache::LoadShader(xenos::ShaderType shader_type,
                                               const uint32_t* host_address,
                                               uint32_t dword_count) {
   // Hash the input memory and lookup the shader.
-  uint64_t data_hash =
-      XXH3_64bits(host_address, dword_count * sizeof(uint32_t));
+  return LoadShader(shader_type, host_address, dword_count,
+                    XXH3_64bits(host_address, dword_count * sizeof(uint32_t)));
+}
+
+VulkanShader* VulkanPipelineCache::LoadShader(xenos::ShaderType shader_type,
+                                              const uint32_t* host_address,
+                                              uint32_t dword_count,
+                                              uint64_t data_hash) {
   auto it = shaders_.find(data_hash);
   if (it != shaders_.end()) {
     // Shader has been previously loaded.
@@ -170,6 +881,14 @@ VulkanPipelineCache::GetCurrentVertexShaderModification(
                      xenos::PrimitiveType::kPointList);
   }
 
+  xenos::Endian vertex_fetch_endian;
+  if (cvars::static_vertex_fetch_endian &&
+      draw_util::GetStaticVertexFetchEndian(regs, shader,
+                                            vertex_fetch_endian)) {
+    modification.vertex.vertex_fetch_endian_static = 1;
+    modification.vertex.vertex_fetch_endian = vertex_fetch_endian;
+  }
+
   return modification;
 }
 
@@ -232,24 +951,49 @@ bool VulkanPipelineCache::EnsureShadersTranslated(
               register_file_.Get<reg::SQ_PROGRAM_CNTL>().vs_export_mode !=
                   xenos::VertexShaderExportMode::kPosition2VectorsEdgeKill);
   assert_false(register_file_.Get<reg::SQ_PROGRAM_CNTL>().gen_index_vtx);
+  // If both shaders are new, translate the pixel shader on the worker thread
+  // while the vertex shader is translated on this one.
+  bool pixel_shader_translating_in_parallel = false;
+  if (pixel_shader_translation_worker_ && pixel_shader != nullptr &&
+      !pixel_shader->is_translated() && !vertex_shader->is_translated()) {
+    pixel_shader->shader().AnalyzeUcode(ucode_disasm_buffer_);
+    pixel_shader_translation_worker_->Start([this, pixel_shader]() {
+      return TranslateAnalyzedShader(*pixel_shader_translator_, *pixel_shader);
+    });
+    pixel_shader_translating_in_parallel = true;
+  }
   if (!vertex_shader->is_translated()) {
     vertex_shader->shader().AnalyzeUcode(ucode_disasm_buffer_);
     if (!TranslateAnalyzedShader(*shader_translator_, *vertex_shader)) {
       XELOGE("Failed to translate the vertex shader!");
+      if (pixel_shader_translating_in_parallel) {
+        pixel_shader_translation_worker_->Await();
+      }
       return false;
     }
+    StoreShader(vertex_shader->shader());
   }
+  bool pixel_shader_translated_in_parallel =
+      pixel_shader_translating_in_parallel &&
+      pixel_shader_translation_worker_->Await();
   if (!vertex_shader->is_valid()) {
     // Translation attempted previously, but not valid.
     return false;
   }
   if (pixel_shader != nullptr) {
-    if (!pixel_shader->is_translated()) {
+    if (pixel_shader_translating_in_parallel) {
+      if (!pixel_shader_translated_in_parallel) {
+        XELOGE("Failed to translate the pixel shader!");
+        return false;
+      }
+      StoreShader(pixel_shader->shader());
+    } else if (!pixel_shader->is_translated()) {
       pixel_shader->shader().AnalyzeUcode(ucode_disasm_buffer_);
       if (!TranslateAnalyzedShader(*shader_translator_, *pixel_shader)) {
         XELOGE("Failed to translate the pixel shader!");
         return false;
       }
+      StoreShader(pixel_shader->shader());
     }
     if (!pixel_shader->is_valid()) {
       // Translation attempted previously, but not valid.
@@ -284,20 +1028,97 @@ bool VulkanPipelineCache::ConfigurePipeline(
           description)) {
     return false;
   }
+  std::pair<const PipelineDescription, Pipeline>* existing_pipeline = nullptr;
   if (last_pipeline_ && last_pipeline_->first == description) {
-    pipeline_out = last_pipeline_->second.pipeline;
-    pipeline_layout_out = last_pipeline_->second.pipeline_layout;
-    return true;
+    existing_pipeline = last_pipeline_;
+  } else {
+    auto it = pipelines_.find(description);
+    if (it != pipelines_.end()) {
+      existing_pipeline = &*it;
+      last_pipeline_ = existing_pipeline;
+    }
   }
-  auto it = pipelines_.find(description);
-  if (it != pipelines_.end()) {
-    last_pipeline_ = &*it;
-    pipeline_out = it->second.pipeline;
-    pipeline_layout_out = it->second.pipeline_layout;
+  if (existing_pipeline) {
+    if (!existing_pipeline->second.creation_completed.load(
+            std::memory_order_acquire)) {
+      // Still being created asynchronously.
+      ++draws_skipped_pipeline_pending_;
+      pipeline_out = VK_NULL_HANDLE;
+      pipeline_layout_out = existing_pipeline->second.pipeline_layout;
+      return true;
+    }
+    if (existing_pipeline->second.pipeline == VK_NULL_HANDLE) {
+      // Failed to create previously.
+      return false;
+    }
+    if (optimization_thread_) {
+      DestroyReplacedPipelines(false);
+      UpdatePipelineOptimization(*existing_pipeline, vertex_shader,
+                                 pixel_shader);
+    }
+    pipeline_out = existing_pipeline->second.pipeline;
+    pipeline_layout_out = existing_pipeline->second.pipeline_layout;
     return true;
   }
 
   // Create the pipeline if not the latest and not already existing.
+  const PipelineLayoutProvider* pipeline_layout;
+  PipelineCreationArguments creation_arguments;
+  if (!GetPipelineCreationArguments(description, vertex_shader, pixel_shader,
+                                    pipeline_layout, creation_arguments)) {
+    return false;
+  }
+  auto& pipeline = *pipelines_
+                        .emplace(std::piecewise_construct,
+                                 std::forward_as_tuple(description),
+                                 std::forward_as_tuple(pipeline_layout))
+                        .first;
+  creation_arguments.pipeline = &pipeline;
+  creation_arguments.link_libraries = true;
+  last_pipeline_ = &pipeline;
+
+  if (pipeline_storage_file_) {
+    assert_not_null(storage_write_thread_);
+    pipeline_storage_file_flush_needed_ = true;
+    {
+      std::lock_guard<std::mutex> lock(storage_write_request_lock_);
+      storage_write_pipeline_queue_.emplace_back();
+      PipelineStoredDescription& stored_description =
+          storage_write_pipeline_queue_.back();
+      stored_description.description_hash = description.GetHash();
+      stored_description.description = description;
+    }
+    storage_write_request_cond_.notify_all();
+  }
+
+  if (!creation_threads_.empty()) {
+    // Submit the pipeline for creation to any available thread, and skip the
+    // draw until it's created.
+    {
+      std::lock_guard<std::mutex> lock(creation_request_lock_);
+      creation_queue_.push_back(creation_arguments);
+    }
+    creation_request_cond_.notify_one();
+    ++draws_skipped_pipeline_pending_;
+    pipeline_out = VK_NULL_HANDLE;
+    pipeline_layout_out = pipeline_layout;
+    return true;
+  }
+
+  if (!EnsurePipelineCreated(creation_arguments)) {
+    return false;
+  }
+  pipeline_out = pipeline.second.pipeline;
+  pipeline_layout_out = pipeline_layout;
+  return true;
+}
+
+bool VulkanPipelineCache::GetPipelineCreationArguments(
+    const PipelineDescription& description,
+    const VulkanShader::VulkanTranslation* vertex_shader,
+    const VulkanShader::VulkanTranslation* pixel_shader,
+    const PipelineLayoutProvider*& pipeline_layout_out,
+    PipelineCreationArguments& creation_arguments_out) {
   const PipelineLayoutProvider* pipeline_layout =
       command_processor_.GetPipelineLayout(
           pixel_shader
@@ -332,31 +1153,155 @@ bool VulkanPipelineCache::ConfigurePipeline(
       return false;
     }
   }
-  VkRenderPass render_pass =
-      render_target_cache_.GetPath() ==
-              RenderTargetCache::Path::kPixelShaderInterlock
-          ? render_target_cache_.GetFragmentShaderInterlockRenderPass()
-          : render_target_cache_.GetHostRenderTargetsRenderPass(
-                render_pass_key);
-  if (render_pass == VK_NULL_HANDLE) {
-    return false;
-  }
-  PipelineCreationArguments creation_arguments;
-  auto& pipeline =
-      *pipelines_.emplace(description, Pipeline(pipeline_layout)).first;
-  creation_arguments.pipeline = &pipeline;
-  creation_arguments.vertex_shader = vertex_shader;
-  creation_arguments.pixel_shader = pixel_shader;
-  creation_arguments.geometry_shader = geometry_shader;
-  creation_arguments.render_pass = render_pass;
-  if (!EnsurePipelineCreated(creation_arguments)) {
-    return false;
+  // With dynamic rendering, the pipeline is created for the attachment formats
+  // instead.
+  VkRenderPass render_pass = VK_NULL_HANDLE;
+  if (!render_target_cache_.IsDynamicRenderingUsed()) {
+    render_pass =
+        render_target_cache_.GetPath() ==
+                RenderTargetCache::Path::kPixelShaderInterlock
+            ? render_target_cache_.GetFragmentShaderInterlockRenderPass()
+            : render_target_cache_.GetHostRenderTargetsRenderPass(
+                  description.render_pass_key);
+    if (render_pass == VK_NULL_HANDLE) {
+      return false;
+    }
   }
-  pipeline_out = pipeline.second.pipeline;
   pipeline_layout_out = pipeline_layout;
+  creation_arguments_out.pipeline = nullptr;
+  creation_arguments_out.vertex_shader = vertex_shader;
+  creation_arguments_out.pixel_shader = pixel_shader;
+  creation_arguments_out.geometry_shader = geometry_shader;
+  creation_arguments_out.render_pass = render_pass;
+  creation_arguments_out.use_optimized_shaders = false;
+  creation_arguments_out.link_libraries = false;
   return true;
 }
 
+void VulkanPipelineCache::StoreShader(Shader& shader) {
+  if (!shader_storage_file_ ||
+      shader.ucode_storage_index() == shader_storage_index_) {
+    return;
+  }
+  shader.set_ucode_storage_index(shader_storage_index_);
+  assert_not_null(storage_write_thread_);
+  shader_storage_file_flush_needed_ = true;
+  {
+    std::lock_guard<std::mutex> lock(storage_write_request_lock_);
+    storage_write_shader_queue_.push_back(&shader);
+  }
+  storage_write_request_cond_.notify_all();
+}
+
+void VulkanPipelineCache::LoadHostPipelineCache(
+    const std::filesystem::path& path) {
+  const ui::vulkan::VulkanProvider& provider =
+      command_processor_.GetVulkanProvider();
+  const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
+  VkDevice device = provider.device();
+
+  // Pipelines already created from the previous cache object don't depend on
+  // it anymore.
+  ui::vulkan::util::DestroyAndNullHandle(dfn.vkDestroyPipelineCache, device,
+                                         host_pipeline_cache_);
+  host_pipeline_cache_file_path_ = path;
+
+  // The header of the data is validated by the driver - if it's from a
+  // different device or driver version, an empty cache is created.
+  std::vector<uint8_t> initial_data;
+  if (!path.empty()) {
+    FILE* file = xe::filesystem::OpenFile(path, "rb");
+    if (file) {
+      if (xe::filesystem::Seek(file, 0, SEEK_END)) {
+        int64_t file_size = xe::filesystem::Tell(file);
+        if (file_size > 0 && xe::filesystem::Seek(file, 0, SEEK_SET)) {
+          initial_data.resize(size_t(file_size));
+          if (!fread(initial_data.data(), initial_data.size(), 1, file)) {
+            initial_data.clear();
+          }
+        }
+      }
+      fclose(file);
+    }
+  }
+
+  VkPipelineCacheCreateInfo pipeline_cache_create_info;
+  pipeline_cache_create_info.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  pipeline_cache_create_info.pNext = nullptr;
+  pipeline_cache_create_info.flags = 0;
+  pipeline_cache_create_info.initialDataSize = initial_data.size();
+  pipeline_cache_create_info.pInitialData = initial_data.data();
+  if (dfn.vkCreatePipelineCache(device, &pipeline_cache_create_info, nullptr,
+                                &host_pipeline_cache_) != VK_SUCCESS) {
+    host_pipeline_cache_ = VK_NULL_HANDLE;
+    if (!initial_data.empty()) {
+      // Retry without the possibly broken initial data.
+      pipeline_cache_create_info.initialDataSize = 0;
+      pipeline_cache_create_info.pInitialData = nullptr;
+      if (dfn.vkCreatePipelineCache(device, &pipeline_cache_create_info,
+                                    nullptr,
+                                    &host_pipeline_cache_) != VK_SUCCESS) {
+        host_pipeline_cache_ = VK_NULL_HANDLE;
+      }
+    }
+    if (host_pipeline_cache_ == VK_NULL_HANDLE) {
+      XELOGW(
+          "VulkanPipelineCache: Failed to create the Vulkan pipeline cache, "
+          "pipelines will be created without it");
+      return;
+    }
+  }
+  if (!initial_data.empty()) {
+    XELOGGPU("Loaded {} bytes of the Vulkan pipeline cache from {}",
+             initial_data.size(), path);
+  }
+}
+
+void VulkanPipelineCache::StoreHostPipelineCache() {
+  if (host_pipeline_cache_ == VK_NULL_HANDLE ||
+      host_pipeline_cache_file_path_.empty()) {
+    return;
+  }
+  const ui::vulkan::VulkanProvider& provider =
+      command_processor_.GetVulkanProvider();
+  const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
+  VkDevice device = provider.device();
+  size_t data_size = 0;
+  if (dfn.vkGetPipelineCacheData(device, host_pipeline_cache_, &data_size,
+                                 nullptr) != VK_SUCCESS ||
+      !data_size) {
+    return;
+  }
+  std::vector<uint8_t> data(data_size);
+  if (dfn.vkGetPipelineCacheData(device, host_pipeline_cache_, &data_size,
+                                 data.data()) != VK_SUCCESS) {
+    return;
+  }
+  // Write to a temporary file first not to leave a partially written cache if
+  // terminated while writing.
+  std::filesystem::path temp_path = host_pipeline_cache_file_path_;
+  temp_path += ".tmp";
+  FILE* file = xe::filesystem::OpenFile(temp_path, "wb");
+  if (!file) {
+    XELOGW("Failed to open the Vulkan pipeline cache file for writing: {}",
+           temp_path);
+    return;
+  }
+  bool written = fwrite(data.data(), data_size, 1, file) == 1;
+  fclose(file);
+  std::error_code error_code;
+  if (written) {
+    std::filesystem::rename(temp_path, host_pipeline_cache_file_path_,
+                            error_code);
+  }
+  if (!written || error_code) {
+    XELOGW("Failed to write the Vulkan pipeline cache file: {}",
+           host_pipeline_cache_file_path_);
+    std::filesystem::remove(temp_path, error_code);
+  }
+}
+
 bool VulkanPipelineCache::TranslateAnalyzedShader(
     SpirvShaderTranslator& translator,
     VulkanShader::VulkanTranslation& translation) {
@@ -372,6 +1317,7 @@ bool VulkanPipelineCache::TranslateAnalyzedShader(
   if (translation.GetOrCreateShaderModule() == VK_NULL_HANDLE) {
     return false;
   }
+  RequestShaderOptimization(translation);
 
   // TODO(Triang3l): Log that the shader has been successfully translated in
   // common code.
@@ -389,6 +1335,7 @@ bool VulkanPipelineCache::TranslateAnalyzedShader(
           texture_binding_count * sizeof(*texture_bindings.data());
       uint64_t texture_binding_layout_hash =
           XXH3_64bits(texture_bindings.data(), texture_binding_layout_bytes);
+      std::lock_guard<std::mutex> layouts_lock(layouts_mutex_);
       auto found_range =
           texture_binding_layout_map_.equal_range(texture_binding_layout_hash);
       for (auto it = found_range.first; it != found_range.second; ++it) {
@@ -1866,10 +2813,17 @@ VkShaderModule VulkanPipelineCache::GetGeometryShader(GeometryShaderKey key) {
 
 bool VulkanPipelineCache::EnsurePipelineCreated(
     const PipelineCreationArguments& creation_arguments) {
-  if (creation_arguments.pipeline->second.pipeline != VK_NULL_HANDLE) {
-    return true;
+  Pipeline& pipeline = creation_arguments.pipeline->second;
+  if (pipeline.creation_completed.load(std::memory_order_acquire)) {
+    return pipeline.pipeline != VK_NULL_HANDLE;
   }
+  bool created = CreatePipeline(creation_arguments);
+  pipeline.creation_completed.store(true, std::memory_order_release);
+  return created;
+}
 
+bool VulkanPipelineCache::CreatePipeline(
+    const PipelineCreationArguments& creation_arguments) {
   // This function preferably should validate the description to prevent
   // unsupported behavior that may be dangerous/crashing because pipelines can
   // be created from the disk storage.
@@ -1916,8 +2870,20 @@ bool VulkanPipelineCache::EnsurePipelineCreated(
   shader_stage_vertex.pNext = nullptr;
   shader_stage_vertex.flags = 0;
   shader_stage_vertex.stage = VK_SHADER_STAGE_VERTEX_BIT;
+  auto get_shader_module =
+      [&creation_arguments](
+          const VulkanShader::VulkanTranslation& translation) {
+        if (creation_arguments.use_optimized_shaders) {
+          VkShaderModule optimized_shader_module =
+              translation.optimized_shader_module();
+          if (optimized_shader_module != VK_NULL_HANDLE) {
+            return optimized_shader_module;
+          }
+        }
+        return translation.shader_module();
+      };
   shader_stage_vertex.module =
-      creation_arguments.vertex_shader->shader_module();
+      get_shader_module(*creation_arguments.vertex_shader);
   assert_true(shader_stage_vertex.module != VK_NULL_HANDLE);
   shader_stage_vertex.pName = "main";
   shader_stage_vertex.pSpecializationInfo = nullptr;
@@ -1951,7 +2917,7 @@ bool VulkanPipelineCache::EnsurePipelineCreated(
       return false;
     }
     shader_stage_fragment.module =
-        creation_arguments.pixel_shader->shader_module();
+        get_shader_module(*creation_arguments.pixel_shader);
     assert_true(shader_stage_fragment.module != VK_NULL_HANDLE);
   } else {
     if (edram_fragment_shader_interlock) {
@@ -2254,9 +3220,28 @@ bool VulkanPipelineCache::EnsurePipelineCreated(
         VK_DYNAMIC_STATE_STENCIL_REFERENCE;
   }
 
+  VkFormat rendering_color_formats[xenos::kMaxColorRenderTargets];
+  VkPipelineRenderingCreateInfo rendering_create_info;
+  if (creation_arguments.render_pass == VK_NULL_HANDLE) {
+    rendering_create_info.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    rendering_create_info.pNext = nullptr;
+    rendering_create_info.viewMask = 0;
+    VkFormat rendering_depth_format;
+    rendering_create_info.colorAttachmentCount =
+        render_target_cache_.GetHostRenderTargetsRenderingFormats(
+            description.render_pass_key, rendering_color_formats,
+            rendering_depth_format);
+    rendering_create_info.pColorAttachmentFormats = rendering_color_formats;
+    rendering_create_info.depthAttachmentFormat = rendering_depth_format;
+    rendering_create_info.stencilAttachmentFormat = rendering_depth_format;
+  }
+
   VkGraphicsPipelineCreateInfo pipeline_create_info;
   pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipeline_create_info.pNext = nullptr;
+  pipeline_create_info.pNext = creation_arguments.render_pass == VK_NULL_HANDLE
+                                   ? &rendering_create_info
+                                   : nullptr;
   pipeline_create_info.flags = 0;
   pipeline_create_info.stageCount = shader_stage_count;
   pipeline_create_info.pStages = shader_stages.data();
@@ -2279,7 +3264,15 @@ bool VulkanPipelineCache::EnsurePipelineCreated(
   const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
   VkDevice device = provider.device();
   VkPipeline pipeline;
-  if (dfn.vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1,
+  if (pipeline_libraries_enabled_ && creation_arguments.link_libraries &&
+      !creation_arguments.use_optimized_shaders &&
+      CreatePipelineFromLibraries(creation_arguments, pipeline_create_info,
+                                  pipeline)) {
+    creation_arguments.pipeline->second.linked_from_libraries = true;
+    creation_arguments.pipeline->second.pipeline = pipeline;
+    return true;
+  }
+  if (dfn.vkCreateGraphicsPipelines(device, host_pipeline_cache_, 1,
                                     &pipeline_create_info, nullptr,
                                     &pipeline) != VK_SUCCESS) {
     // TODO(Triang3l): Move these error messages outside.
@@ -2294,10 +3287,479 @@ bool VulkanPipelineCache::EnsurePipelineCreated(
     } */
     return false;
   }
-  creation_arguments.pipeline->second.pipeline = pipeline;
+  if (creation_arguments.use_optimized_shaders) {
+    creation_arguments.pipeline->second.optimized_pipeline = pipeline;
+  } else {
+    creation_arguments.pipeline->second.pipeline = pipeline;
+  }
   return true;
 }
 
+bool VulkanPipelineCache::CreatePipelineFromLibraries(
+    const PipelineCreationArguments& creation_arguments,
+    const VkGraphicsPipelineCreateInfo& pipeline_create_info,
+    VkPipeline& pipeline_out) {
+  const PipelineDescription& description = creation_arguments.pipeline->first;
+
+  // Only the render target formats are needed from the dynamic rendering info,
+  // the rest of the pipeline creation info chain isn't used by the libraries.
+  VkGraphicsPipelineLibraryCreateInfoEXT library_subset_create_info;
+  library_subset_create_info.sType =
+      VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+  library_subset_create_info.pNext = pipeline_create_info.pNext;
+
+  VkPipeline libraries[size_t(PipelineLibraryType::kCount)];
+  for (uint32_t i = 0; i < uint32_t(PipelineLibraryType::kCount); ++i) {
+    auto type = PipelineLibraryType(i);
+    PipelineLibraryKey key;
+    key.type = type;
+    VkGraphicsPipelineCreateInfo library_create_info;
+    library_create_info.sType =
+        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    library_create_info.pNext = &library_subset_create_info;
+    library_create_info.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+    library_create_info.stageCount = 0;
+    library_create_info.pStages = nullptr;
+    library_create_info.pVertexInputState = nullptr;
+    library_create_info.pInputAssemblyState = nullptr;
+    library_create_info.pTessellationState = nullptr;
+    library_create_info.pViewportState = nullptr;
+    library_create_info.pRasterizationState = nullptr;
+    library_create_info.pMultisampleState = nullptr;
+    library_create_info.pDepthStencilState = nullptr;
+    library_create_info.pColorBlendState = nullptr;
+    library_create_info.pDynamicState = pipeline_create_info.pDynamicState;
+    library_create_info.layout = VK_NULL_HANDLE;
+    library_create_info.renderPass = VK_NULL_HANDLE;
+    library_create_info.subpass = 0;
+    library_create_info.basePipelineHandle = VK_NULL_HANDLE;
+    library_create_info.basePipelineIndex = -1;
+    // Everything except for the vertex input depends on the render targets.
+    if (type != PipelineLibraryType::kVertexInputInterface) {
+      key.description.render_pass_key = description.render_pass_key;
+      key.render_pass = pipeline_create_info.renderPass;
+      library_create_info.renderPass = pipeline_create_info.renderPass;
+    }
+    switch (type) {
+      case PipelineLibraryType::kVertexInputInterface:
+        library_subset_create_info.flags =
+            VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+        key.description.primitive_topology = description.primitive_topology;
+        key.description.primitive_restart = description.primitive_restart;
+        library_create_info.pVertexInputState =
+            pipeline_create_info.pVertexInputState;
+        library_create_info.pInputAssemblyState =
+            pipeline_create_info.pInputAssemblyState;
+        break;
+      case PipelineLibraryType::kPreRasterizationShaders:
+        library_subset_create_info.flags =
+            VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+        key.description.geometry_shader = description.geometry_shader;
+        key.description.depth_clamp_enable = description.depth_clamp_enable;
+        key.description.polygon_mode = description.polygon_mode;
+        key.description.cull_front = description.cull_front;
+        key.description.cull_back = description.cull_back;
+        key.description.front_face_clockwise =
+            description.front_face_clockwise;
+        key.pipeline_layout = pipeline_create_info.layout;
+        // The vertex shader, and the geometry shader if used, always come
+        // first.
+        library_create_info.stageCount = 0;
+        for (uint32_t j = 0; j < pipeline_create_info.stageCount; ++j) {
+          const VkPipelineShaderStageCreateInfo& stage =
+              pipeline_create_info.pStages[j];
+          if (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
+            break;
+          }
+          key.shader_modules[j] = stage.module;
+          ++library_create_info.stageCount;
+        }
+        library_create_info.pStages = pipeline_create_info.pStages;
+        library_create_info.pViewportState =
+            pipeline_create_info.pViewportState;
+        library_create_info.pRasterizationState =
+            pipeline_create_info.pRasterizationState;
+        library_create_info.layout = pipeline_create_info.layout;
+        break;
+      case PipelineLibraryType::kFragmentShader:
+        library_subset_create_info.flags =
+            VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+        key.description.depth_write_enable = description.depth_write_enable;
+        key.description.depth_compare_op = description.depth_compare_op;
+        key.description.stencil_test_enable = description.stencil_test_enable;
+        key.description.stencil_front_fail_op =
+            description.stencil_front_fail_op;
+        key.description.stencil_front_pass_op =
+            description.stencil_front_pass_op;
+        key.description.stencil_front_depth_fail_op =
+            description.stencil_front_depth_fail_op;
+        key.description.stencil_front_compare_op =
+            description.stencil_front_compare_op;
+        key.description.stencil_back_fail_op = description.stencil_back_fail_op;
+        key.description.stencil_back_pass_op = description.stencil_back_pass_op;
+        key.description.stencil_back_depth_fail_op =
+            description.stencil_back_depth_fail_op;
+        key.description.stencil_back_compare_op =
+            description.stencil_back_compare_op;
+        key.pipeline_layout = pipeline_create_info.layout;
+        for (uint32_t j = 0; j < pipeline_create_info.stageCount; ++j) {
+          const VkPipelineShaderStageCreateInfo& stage =
+              pipeline_create_info.pStages[j];
+          if (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
+            key.shader_modules[0] = stage.module;
+            library_create_info.stageCount = 1;
+            library_create_info.pStages = &stage;
+            break;
+          }
+        }
+        library_create_info.pMultisampleState =
+            pipeline_create_info.pMultisampleState;
+        library_create_info.pDepthStencilState =
+            pipeline_create_info.pDepthStencilState;
+        library_create_info.layout = pipeline_create_info.layout;
+        break;
+      case PipelineLibraryType::kFragmentOutputInterface:
+        library_subset_create_info.flags =
+            VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+        std::memcpy(key.description.render_targets,
+                    description.render_targets,
+                    sizeof(description.render_targets));
+        library_create_info.pMultisampleState =
+            pipeline_create_info.pMultisampleState;
+        library_create_info.pColorBlendState =
+            pipeline_create_info.pColorBlendState;
+        break;
+      default:
+        assert_unhandled_case(type);
+        return false;
+    }
+    libraries[i] = GetPipelineLibrary(key, library_create_info);
+    if (libraries[i] == VK_NULL_HANDLE) {
+      return false;
+    }
+  }
+
+  // Fast linking without VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT -
+  // the optimized monolithic pipeline is created in the background instead.
+  VkPipelineLibraryCreateInfoKHR library_create_info;
+  library_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+  library_create_info.pNext = nullptr;
+  library_create_info.libraryCount = uint32_t(xe::countof(libraries));
+  library_create_info.pLibraries = libraries;
+  VkGraphicsPipelineCreateInfo link_create_info = {};
+  link_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  link_create_info.pNext = &library_create_info;
+  link_create_info.layout = pipeline_create_info.layout;
+  link_create_info.basePipelineIndex = -1;
+
+  const ui::vulkan::VulkanProvider& provider =
+      command_processor_.GetVulkanProvider();
+  const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
+  VkDevice device = provider.device();
+  return dfn.vkCreateGraphicsPipelines(device, host_pipeline_cache_, 1,
+                                       &link_create_info, nullptr,
+                                       &pipeline_out) == VK_SUCCESS;
+}
+
+VkPipeline VulkanPipelineCache::GetPipelineLibrary(
+    const PipelineLibraryKey& key,
+    const VkGraphicsPipelineCreateInfo& library_create_info) {
+  {
+    std::lock_guard<std::mutex> lock(pipeline_libraries_mutex_);
+    auto it = pipeline_libraries_.find(key);
+    if (it != pipeline_libraries_.end()) {
+      return it->second;
+    }
+  }
+
+  // Create outside the lock not to block other creation threads.
+  const ui::vulkan::VulkanProvider& provider =
+      command_processor_.GetVulkanProvider();
+  const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
+  VkDevice device = provider.device();
+  VkPipeline library;
+  if (dfn.vkCreateGraphicsPipelines(device, host_pipeline_cache_, 1,
+                                    &library_create_info, nullptr,
+                                    &library) != VK_SUCCESS) {
+    // Not caching the failure, the whole pipeline will likely fail too.
+    return VK_NULL_HANDLE;
+  }
+  std::lock_guard<std::mutex> lock(pipeline_libraries_mutex_);
+  auto emplaced = pipeline_libraries_.emplace(key, library);
+  if (!emplaced.second) {
+    // Created by another thread meanwhile.
+    dfn.vkDestroyPipeline(device, library, nullptr);
+  }
+  return emplaced.first->second;
+}
+
+void VulkanPipelineCache::RequestShaderOptimization(
+    VulkanShader::VulkanTranslation& translation) {
+  if (!shader_optimization_enabled_ || !translation.is_valid() ||
+      !translation.RequestOptimization()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(optimization_request_lock_);
+    optimization_shader_queue_.push_back(&translation);
+  }
+  optimization_request_cond_.notify_one();
+}
+
+void VulkanPipelineCache::UpdatePipelineOptimization(
+    std::pair<const PipelineDescription, Pipeline>& pipeline,
+    const VulkanShader::VulkanTranslation* vertex_shader,
+    const VulkanShader::VulkanTranslation* pixel_shader) {
+  Pipeline& pipeline_state = pipeline.second;
+  if (pipeline_state.optimization_requested) {
+    if (pipeline_state.optimized_creation_completed.load(
+            std::memory_order_acquire) &&
+        pipeline_state.optimized_pipeline != VK_NULL_HANDLE) {
+      // The old pipeline may have been used in the current submission.
+      replaced_pipelines_.emplace_back(
+          command_processor_.GetCurrentSubmission(), pipeline_state.pipeline);
+      pipeline_state.pipeline = pipeline_state.optimized_pipeline;
+      pipeline_state.optimized_pipeline = VK_NULL_HANDLE;
+    }
+    return;
+  }
+  if (shader_optimization_enabled_ &&
+      (!vertex_shader->is_optimization_completed() ||
+       (pixel_shader && !pixel_shader->is_optimization_completed()))) {
+    return;
+  }
+  pipeline_state.optimization_requested = true;
+  if (!pipeline_state.linked_from_libraries &&
+      vertex_shader->optimized_shader_module() == VK_NULL_HANDLE &&
+      (!pixel_shader ||
+       pixel_shader->optimized_shader_module() == VK_NULL_HANDLE)) {
+    // Nothing has been optimized, and the pipeline is already monolithic.
+    return;
+  }
+  const PipelineLayoutProvider* pipeline_layout;
+  PipelineCreationArguments creation_arguments;
+  if (!GetPipelineCreationArguments(pipeline.first, vertex_shader, pixel_shader,
+                                    pipeline_layout, creation_arguments)) {
+    return;
+  }
+  creation_arguments.pipeline = &pipeline;
+  creation_arguments.use_optimized_shaders = true;
+  {
+    std::lock_guard<std::mutex> lock(optimization_request_lock_);
+    optimization_pipeline_queue_.push_back(creation_arguments);
+  }
+  optimization_request_cond_.notify_one();
+}
+
+void VulkanPipelineCache::DestroyReplacedPipelines(bool all) {
+  if (replaced_pipelines_.empty()) {
+    return;
+  }
+  const ui::vulkan::VulkanProvider& provider =
+      command_processor_.GetVulkanProvider();
+  const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
+  VkDevice device = provider.device();
+  uint64_t submission_completed = command_processor_.GetCompletedSubmission();
+  while (!replaced_pipelines_.empty()) {
+    const std::pair<uint64_t, VkPipeline>& replaced_pipeline =
+        replaced_pipelines_.front();
+    if (!all && replaced_pipeline.first > submission_completed) {
+      break;
+    }
+    dfn.vkDestroyPipeline(device, replaced_pipeline.second, nullptr);
+    replaced_pipelines_.pop_front();
+  }
+}
+
+void VulkanPipelineCache::OptimizationThread() {
+  std::vector<uint32_t> optimized_binary;
+  while (true) {
+    VulkanShader::VulkanTranslation* translation = nullptr;
+    PipelineCreationArguments pipeline_creation_arguments;
+    bool create_pipeline = false;
+    {
+      std::unique_lock<std::mutex> lock(optimization_request_lock_);
+      if (optimization_thread_shutdown_) {
+        return;
+      }
+      // Replace the pipelines with the already optimized shaders first.
+      if (!optimization_pipeline_queue_.empty()) {
+        pipeline_creation_arguments = optimization_pipeline_queue_.front();
+        optimization_pipeline_queue_.pop_front();
+        create_pipeline = true;
+      } else if (!optimization_shader_queue_.empty()) {
+        translation = optimization_shader_queue_.front();
+        optimization_shader_queue_.pop_front();
+      } else {
+        optimization_request_cond_.wait(lock);
+        continue;
+      }
+    }
+
+    if (create_pipeline) {
+      CreatePipeline(pipeline_creation_arguments);
+      pipeline_creation_arguments.pipeline->second.optimized_creation_completed
+          .store(true, std::memory_order_release);
+      continue;
+    }
+
+    const std::vector<uint8_t>& translated_binary =
+        translation->translated_binary();
+    if (spirv_tools_context_.Optimize(
+            reinterpret_cast<const uint32_t*>(translated_binary.data()),
+            translated_binary.size() / sizeof(uint32_t),
+            optimized_binary) != SPV_SUCCESS) {
+      XELOGW(
+          "VulkanPipelineCache: Failed to optimize shader {:016X} modification "
+          "{:016X}",
+          translation->shader().ucode_data_hash(), translation->modification());
+      optimized_binary.clear();
+    }
+    translation->CompleteOptimization(optimized_binary);
+  }
+}
+
+void VulkanPipelineCache::StorageWriteThread() {
+  ShaderStoredHeader shader_header;
+  // Don't leak anything in unused bits.
+  std::memset(&shader_header, 0, sizeof(shader_header));
+
+  std::vector<uint32_t> ucode_guest_endian;
+  ucode_guest_endian.reserve(0xFFFF);
+  std::vector<uint8_t> ucode_analysis;
+
+  bool flush_shaders = false;
+  bool flush_pipelines = false;
+
+  while (true) {
+    if (flush_shaders) {
+      flush_shaders = false;
+      assert_not_null(shader_storage_file_);
+      fflush(shader_storage_file_);
+    }
+    if (flush_pipelines) {
+      flush_pipelines = false;
+      assert_not_null(pipeline_storage_file_);
+      fflush(pipeline_storage_file_);
+    }
+
+    const Shader* shader = nullptr;
+    PipelineStoredDescription pipeline_description;
+    bool write_pipeline = false;
+    {
+      std::unique_lock<std::mutex> lock(storage_write_request_lock_);
+      if (storage_write_thread_shutdown_) {
+        return;
+      }
+      if (!storage_write_shader_queue_.empty()) {
+        shader = storage_write_shader_queue_.front();
+        storage_write_shader_queue_.pop_front();
+      } else if (storage_write_flush_shaders_) {
+        storage_write_flush_shaders_ = false;
+        flush_shaders = true;
+      }
+      if (!storage_write_pipeline_queue_.empty()) {
+        std::memcpy(&pipeline_description,
+                    &storage_write_pipeline_queue_.front(),
+                    sizeof(pipeline_description));
+        storage_write_pipeline_queue_.pop_front();
+        write_pipeline = true;
+      } else if (storage_write_flush_pipelines_) {
+        storage_write_flush_pipelines_ = false;
+        flush_pipelines = true;
+      }
+      if (!shader && !write_pipeline) {
+        storage_write_request_cond_.wait(lock);
+        continue;
+      }
+    }
+
+    if (shader) {
+      shader_header.ucode_data_hash = shader->ucode_data_hash();
+      shader_header.ucode_dword_count = shader->ucode_dword_count();
+      shader_header.type = shader->type();
+      shader->SerializeUcodeAnalysis(ucode_analysis);
+      shader_header.ucode_analysis_byte_count = uint32_t(ucode_analysis.size());
+      shader_header.ucode_analysis_hash =
+          XXH3_64bits(ucode_analysis.data(), ucode_analysis.size());
+      assert_not_null(shader_storage_file_);
+      fwrite(&shader_header, sizeof(shader_header), 1, shader_storage_file_);
+      if (shader_header.ucode_dword_count) {
+        ucode_guest_endian.resize(shader_header.ucode_dword_count);
+        // Need to swap because the hash is calculated for the shader with guest
+        // endianness.
+        xe::copy_and_swap(ucode_guest_endian.data(), shader->ucode_dwords(),
+                          shader_header.ucode_dword_count);
+        fwrite(ucode_guest_endian.data(),
+               shader_header.ucode_dword_count * sizeof(uint32_t), 1,
+               shader_storage_file_);
+      }
+      if (!ucode_analysis.empty()) {
+        fwrite(ucode_analysis.data(), ucode_analysis.size(), 1,
+               shader_storage_file_);
+      }
+    }
+
+    if (write_pipeline) {
+      assert_not_null(pipeline_storage_file_);
+      fwrite(&pipeline_description, sizeof(pipeline_description), 1,
+             pipeline_storage_file_);
+    }
+  }
+}
+
+void VulkanPipelineCache::CreationThread(size_t thread_index) {
+  while (true) {
+    PipelineCreationArguments creation_arguments;
+
+    // Check if need to shut down and dequeue the pipeline if there is any.
+    {
+      std::unique_lock<std::mutex> lock(creation_request_lock_);
+      if (thread_index >= creation_threads_shutdown_from_ ||
+          creation_queue_.empty()) {
+        if (creation_threads_busy_ == 0) {
+          creation_completion_cond_.notify_all();
+        }
+        if (thread_index >= creation_threads_shutdown_from_) {
+          return;
+        }
+        creation_request_cond_.wait(lock);
+        continue;
+      }
+      // Take the pipeline from the queue and increment the busy thread count
+      // until the pipeline is created - other threads must be able to dequeue
+      // requests, but completion can't be reported until the pipelines are
+      // fully created (rather than just started creating).
+      creation_arguments = creation_queue_.front();
+      creation_queue_.pop_front();
+      ++creation_threads_busy_;
+    }
+
+    EnsurePipelineCreated(creation_arguments);
+
+    bool creation_completed;
+    {
+      std::lock_guard<std::mutex> lock(creation_request_lock_);
+      --creation_threads_busy_;
+      creation_completed =
+          creation_queue_.empty() && creation_threads_busy_ == 0;
+    }
+    if (creation_completed) {
+      creation_completion_cond_.notify_all();
+    }
+  }
+}
+
+void VulkanPipelineCache::AwaitPipelineCreationCompletion() {
+  if (creation_threads_.empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(creation_request_lock_);
+  while (!creation_queue_.empty() || creation_threads_busy_ != 0) {
+    creation_completion_cond_.wait(lock);
+  }
+}
+
 }  // namespace vulkan
 }  // namespace gpu
 }  // namespace xe
@@ -10,23 +10,35 @@
 #ifndef XENIA_GPU_VULKAN_VULKAN_PIPELINE_STATE_CACHE_H_
 #define XENIA_GPU_VULKAN_VULKAN_PIPELINE_STATE_CACHE_H_
 
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <deque>
+#include <filesystem>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "xenia/base/hash.h"
 #include "xenia/base/platform.h"
+#include "xenia/base/string_buffer.h"
+#include "xenia/base/threading.h"
 #include "xenia/base/xxhash.h"
 #include "xenia/gpu/primitive_processor.h"
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/registers.h"
+#include "xenia/gpu/shader_translation_worker.h"
 #include "xenia/gpu/spirv_shader_translator.h"
 #include "xenia/gpu/vulkan/vulkan_render_target_cache.h"
 #include "xenia/gpu/vulkan/vulkan_shader.h"
 #include "xenia/gpu/xenos.h"
+#include "xenia/ui/vulkan/spirv_tools_context.h"
 #include "xenia/ui/vulkan/vulkan_provider.h"
 
 namespace xe {
@@ -59,6 +71,16 @@ class VulkanPipelineCache {
   bool Initialize();
   void Shutdown();
 
+  void InitializeShaderStorage(const std::filesystem::path& cache_root,
+                               uint32_t title_id, bool blocking);
+  void ShutdownShaderStorage();
+
+  void EndSubmission();
+  // Waits until all the asynchronously created pipelines have been created, to
+  // make sure the creation threads are not using objects (such as render
+  // passes) that are about to be destroyed.
+  void AwaitPipelineCreationCompletion();
+
   VulkanShader* LoadShader(xenos::ShaderType shader_type,
                            const uint32_t* host_address, uint32_t dword_count);
   // Analyze shader microcode on the translator thread.
@@ -78,6 +100,9 @@ class VulkanPipelineCache {
 
   bool EnsureShadersTranslated(VulkanShader::VulkanTranslation* vertex_shader,
                                VulkanShader::VulkanTranslation* pixel_shader);
+  // If asynchronous pipeline creation is enabled, and the pipeline hasn't been
+  // created yet, returns true, but with pipeline_out set to VK_NULL_HANDLE -
+  // the draw must be skipped in this case.
   // TODO(Triang3l): Return a deferred creation handle.
   bool ConfigurePipeline(
       VulkanShader::VulkanTranslation* vertex_shader,
@@ -90,6 +115,26 @@ class VulkanPipelineCache {
       const PipelineLayoutProvider*& pipeline_layout_out);
 
  private:
+  XEPACKEDSTRUCT(ShaderStoredHeader, {
+    uint64_t ucode_data_hash;
+
+    uint32_t ucode_dword_count : 31;
+    xenos::ShaderType type : 1;
+
+    // Results of Shader::AnalyzeUcode following the microcode, in the host
+    // format.
+    uint32_t ucode_analysis_byte_count;
+    uint64_t ucode_analysis_hash;
+
+    // Same as in the Direct3D 12 pipeline cache - the guest shader storage
+    // contains only API-independent microcode, and is shared between the
+    // implementations.
+    static constexpr uint32_t kVersion = 0x20261014;
+  });
+
+  // Update PipelineDescription::kVersion if any of the Pipeline* enums are
+  // changed!
+
   enum class PipelineGeometryShader : uint32_t {
     kNone,
     kPointList,
@@ -179,6 +224,8 @@ class VulkanPipelineCache {
     // Filled only for the attachments present in the render pass object.
     PipelineRenderTarget render_targets[xenos::kMaxColorRenderTargets];
 
+    static constexpr uint32_t kVersion = 0x20261014;
+
     // Including all the padding, for a stable hash.
     PipelineDescription() { Reset(); }
     PipelineDescription(const PipelineDescription& description) {
@@ -200,12 +247,34 @@ class VulkanPipelineCache {
     };
   });
 
+  XEPACKEDSTRUCT(PipelineStoredDescription, {
+    uint64_t description_hash;
+    PipelineDescription description;
+  });
+
   struct Pipeline {
+    // VK_NULL_HANDLE if creation has failed or hasn't been completed yet. Must
+    // only be read after creation_completed is acquired.
     VkPipeline pipeline = VK_NULL_HANDLE;
     // The layouts are owned by the VulkanCommandProcessor, and must not be
     // destroyed by it while the pipeline cache is active.
     const PipelineLayoutProvider* pipeline_layout;
-    Pipeline(const PipelineLayoutProvider* pipeline_layout_provider)
+    // Released by the thread that has attempted to create the pipeline.
+    std::atomic<bool> creation_completed{false};
+    // With vulkan_spirv_optimize, the pipeline with the optimized shaders,
+    // created in the background, replacing `pipeline` at the next draw using
+    // it. Must only be read after optimized_creation_completed is acquired.
+    VkPipeline optimized_pipeline = VK_NULL_HANDLE;
+    std::atomic<bool> optimized_creation_completed{false};
+    // Whether the creation of the optimized pipeline has been requested (or
+    // considered not needed), accessed only by the command processor thread.
+    bool optimization_requested = false;
+    // Whether `pipeline` has been fast-linked from graphics pipeline libraries,
+    // to be replaced with a monolithic pipeline created in the background
+    // like the optimized one. Must only be read after creation_completed is
+    // acquired.
+    bool linked_from_libraries = false;
+    explicit Pipeline(const PipelineLayoutProvider* pipeline_layout_provider)
         : pipeline_layout(pipeline_layout_provider) {}
   };
 
@@ -216,7 +285,53 @@ class VulkanPipelineCache {
     const VulkanShader::VulkanTranslation* vertex_shader;
     const VulkanShader::VulkanTranslation* pixel_shader;
     VkShaderModule geometry_shader;
+    // VK_NULL_HANDLE if the render target cache uses dynamic rendering.
+    VkRenderPass render_pass;
+    // Whether to create Pipeline::optimized_pipeline from the optimized
+    // shaders rather than Pipeline::pipeline.
+    bool use_optimized_shaders;
+    // Whether Pipeline::pipeline may be fast-linked from graphics pipeline
+    // libraries if they're enabled, for pipelines first encountered during
+    // gameplay rather than loaded from the storage.
+    bool link_libraries;
+  };
+
+  enum class PipelineLibraryType : uint32_t {
+    kVertexInputInterface,
+    kPreRasterizationShaders,
+    kFragmentShader,
+    kFragmentOutputInterface,
+
+    kCount,
+  };
+
+  struct PipelineLibraryKey {
+    // Only the fields of the description affecting the state subset of the
+    // library, the rest being zero.
+    PipelineDescription description;
+    VkPipelineLayout pipeline_layout;
     VkRenderPass render_pass;
+    // Vertex and geometry, or fragment shader.
+    VkShaderModule shader_modules[2];
+    PipelineLibraryType type;
+
+    // Including all the padding, for a stable hash.
+    PipelineLibraryKey() { std::memset(this, 0, sizeof(*this)); }
+    PipelineLibraryKey(const PipelineLibraryKey& key) {
+      std::memcpy(this, &key, sizeof(*this));
+    }
+    PipelineLibraryKey& operator=(const PipelineLibraryKey& key) {
+      std::memcpy(this, &key, sizeof(*this));
+      return *this;
+    }
+    bool operator==(const PipelineLibraryKey& key) const {
+      return std::memcmp(this, &key, sizeof(*this)) == 0;
+    }
+    struct Hasher {
+      size_t operator()(const PipelineLibraryKey& key) const {
+        return size_t(XXH3_64bits(&key, sizeof(key)));
+      }
+    };
   };
 
   union GeometryShaderKey {
@@ -246,6 +361,10 @@ class VulkanPipelineCache {
     }
   };
 
+  VulkanShader* LoadShader(xenos::ShaderType shader_type,
+                           const uint32_t* host_address, uint32_t dword_count,
+                           uint64_t data_hash);
+
   // Can be called from multiple threads.
   bool TranslateAnalyzedShader(SpirvShaderTranslator& translator,
                                VulkanShader::VulkanTranslation& translation);
@@ -277,6 +396,48 @@ class VulkanPipelineCache {
   // render pass objects must be available.
   bool EnsurePipelineCreated(
       const PipelineCreationArguments& creation_arguments);
+  bool CreatePipeline(const PipelineCreationArguments& creation_arguments);
+  // Creates the pipeline by fast-linking the libraries of the state subsets of
+  // the monolithic pipeline creation info, creating the libraries not created
+  // for other pipelines yet.
+  bool CreatePipelineFromLibraries(
+      const PipelineCreationArguments& creation_arguments,
+      const VkGraphicsPipelineCreateInfo& pipeline_create_info,
+      VkPipeline& pipeline_out);
+  // Returns VK_NULL_HANDLE if failed to create. Can be called from any thread.
+  VkPipeline GetPipelineLibrary(
+      const PipelineLibraryKey& key,
+      const VkGraphicsPipelineCreateInfo& library_create_info);
+
+  // Looks up the objects needed to create the pipeline with the description on
+  // the creation threads (everything except for the pipeline itself in the
+  // creation arguments). Must be called from the command processor thread.
+  bool GetPipelineCreationArguments(
+      const PipelineDescription& description,
+      const VulkanShader::VulkanTranslation* vertex_shader,
+      const VulkanShader::VulkanTranslation* pixel_shader,
+      const PipelineLayoutProvider*& pipeline_layout_out,
+      PipelineCreationArguments& creation_arguments_out);
+
+  // Queues the shader for writing to the storage if it has been translated for
+  // the first time in the currently open storage.
+  void StoreShader(Shader& shader);
+
+  // Queues the translation for background optimization if enabled. May be
+  // called from any thread.
+  void RequestShaderOptimization(VulkanShader::VulkanTranslation& translation);
+  // Replaces the pipeline with the one with the optimized shaders if it has
+  // been created, or requests its creation if the shaders have been optimized.
+  // Must be called from the command processor thread.
+  void UpdatePipelineOptimization(
+      std::pair<const PipelineDescription, Pipeline>& pipeline,
+      const VulkanShader::VulkanTranslation* vertex_shader,
+      const VulkanShader::VulkanTranslation* pixel_shader);
+  // Destroys the replaced pipelines not used by pending submissions anymore.
+  void DestroyReplacedPipelines(bool all);
+
+  void LoadHostPipelineCache(const std::filesystem::path& path);
+  void StoreHostPipelineCache();
 
   VulkanCommandProcessor& command_processor_;
   const RegisterFile& register_file_;
@@ -287,6 +448,11 @@ class VulkanPipelineCache {
   StringBuffer ucode_disasm_buffer_;
   // Reusable shader translator on the command processor thread.
   std::unique_ptr<SpirvShaderTranslator> shader_translator_;
+  // Translator and thread for translating the fragment shader of a draw in
+  // parallel with the vertex shader, if parallel_draw_shader_translation is
+  // enabled.
+  std::unique_ptr<SpirvShaderTranslator> pixel_shader_translator_;
+  std::unique_ptr<ShaderTranslationWorker> pixel_shader_translation_worker_;
 
   struct LayoutUID {
     size_t uid;
@@ -322,8 +488,93 @@ class VulkanPipelineCache {
       pipelines_;
 
   // Previously used pipeline, to avoid lookups if the state wasn't changed.
-  const std::pair<const PipelineDescription, Pipeline>* last_pipeline_ =
-      nullptr;
+  std::pair<const PipelineDescription, Pipeline>* last_pipeline_ = nullptr;
+
+  // Graphics pipeline libraries shared between the pipelines, for fast-linking
+  // the pipelines first needed during gameplay, if vulkan_pipeline_libraries is
+  // enabled and supported by the device.
+  bool pipeline_libraries_enabled_ = false;
+  std::mutex pipeline_libraries_mutex_;
+  std::unordered_map<PipelineLibraryKey, VkPipeline,
+                     PipelineLibraryKey::Hasher>
+      pipeline_libraries_;
+
+  // Background spirv-opt optimization of the translated shaders, and creation
+  // of the pipelines with the optimized shaders, if vulkan_spirv_optimize is
+  // enabled and the optimizer is available, and of the monolithic pipelines
+  // replacing the ones linked from libraries.
+  void OptimizationThread();
+  bool shader_optimization_enabled_ = false;
+  ui::vulkan::SpirvToolsContext spirv_tools_context_;
+  std::mutex optimization_request_lock_;
+  std::condition_variable optimization_request_cond_;
+  // Protected with optimization_request_lock_, notify_one
+  // optimization_request_cond_ when pushed.
+  std::deque<VulkanShader::VulkanTranslation*> optimization_shader_queue_;
+  std::deque<PipelineCreationArguments> optimization_pipeline_queue_;
+  bool optimization_thread_shutdown_ = false;
+  std::unique_ptr<xe::threading::Thread> optimization_thread_;
+  // Pipelines replaced by the optimized ones, with the submission in which they
+  // may have been used for the last time.
+  std::deque<std::pair<uint64_t, VkPipeline>> replaced_pipelines_;
+
+  // Driver-side cache of compiled pipelines, persistently stored per device in
+  // the local (non-shareable) part of the shader storage. Internally
+  // synchronized, so can be used by multiple creation threads at once.
+  VkPipelineCache host_pipeline_cache_ = VK_NULL_HANDLE;
+  std::filesystem::path host_pipeline_cache_file_path_;
+
+  // Currently open shader storage path.
+  std::filesystem::path shader_storage_cache_root_;
+  uint32_t shader_storage_title_id_ = 0;
+
+  // Shader storage output stream, for preload in the next emulator runs.
+  FILE* shader_storage_file_ = nullptr;
+  // For only writing shaders to the currently open storage once, incremented
+  // when switching the storage.
+  uint32_t shader_storage_index_ = 0;
+  bool shader_storage_file_flush_needed_ = false;
+
+  // Pipeline storage output stream, for preload in the next emulator runs.
+  FILE* pipeline_storage_file_ = nullptr;
+  bool pipeline_storage_file_flush_needed_ = false;
+
+  // Thread for asynchronous writing to the storage streams.
+  void StorageWriteThread();
+  std::mutex storage_write_request_lock_;
+  std::condition_variable storage_write_request_cond_;
+  // Storage thread input is protected with storage_write_request_lock_, and the
+  // thread is notified about its change via storage_write_request_cond_.
+  std::deque<const Shader*> storage_write_shader_queue_;
+  std::deque<PipelineStoredDescription> storage_write_pipeline_queue_;
+  bool storage_write_flush_shaders_ = false;
+  bool storage_write_flush_pipelines_ = false;
+  bool storage_write_thread_shutdown_ = false;
+  std::unique_ptr<xe::threading::Thread> storage_write_thread_;
+
+  // Pipeline creation threads, used if asynchronous pipeline creation is
+  // enabled.
+  void CreationThread(size_t thread_index);
+  std::mutex creation_request_lock_;
+  std::condition_variable creation_request_cond_;
+  // Protected with creation_request_lock_, notify_one creation_request_cond_
+  // when pushed.
+  std::deque<PipelineCreationArguments> creation_queue_;
+  // Number of threads that are currently creating a pipeline. Protected with
+  // creation_request_lock_.
+  size_t creation_threads_busy_ = 0;
+  // Creation threads with this index or above need to be shut down as soon as
+  // possible. Protected with creation_request_lock_, notify_all
+  // creation_request_cond_ when set.
+  size_t creation_threads_shutdown_from_ = SIZE_MAX;
+  // Notified when the queue becomes empty and no thread is busy, protected with
+  // creation_request_lock_.
+  std::condition_variable creation_completion_cond_;
+  std::vector<std::unique_ptr<xe::threading::Thread>> creation_threads_;
+
+  // Number of draws skipped because their pipelines were still being created,
+  // since the last submission.
+  uint32_t draws_skipped_pipeline_pending_ = 0;
 };
 
 }  // namespace vulkan
@@ -41,7 +41,8 @@ bool VulkanPrimitiveProcessor::Initialize() {
           command_processor_.GetVulkanProvider(),
           VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
           std::max(size_t(kMinRequiredConvertedIndexBufferSize),
-                   ui::GraphicsUploadBufferPool::kDefaultPageSize));
+                   ui::GraphicsUploadBufferPool::kDefaultPageSize),
+          "vulkan/indices");
   return true;
 }
 
@@ -51,6 +52,7 @@ void VulkanPrimitiveProcessor::Shutdown(bool from_destructor) {
   const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
   VkDevice device = provider.device();
 
+  DestroyPersistentIndexBufferChunks();
   frame_index_buffers_.clear();
   frame_index_buffer_pool_.reset();
   ui::vulkan::util::DestroyAndNullHandle(dfn.vkDestroyBuffer, device,
@@ -67,6 +69,11 @@ void VulkanPrimitiveProcessor::Shutdown(bool from_destructor) {
   }
 }
 
+void VulkanPrimitiveProcessor::ClearCache() {
+  ClearCacheCommon();
+  frame_index_buffer_pool_->ClearCache();
+}
+
 void VulkanPrimitiveProcessor::CompletedSubmissionUpdated() {
   if (builtin_index_buffer_upload_ != VK_NULL_HANDLE &&
       command_processor_.GetCompletedSubmission() >=
@@ -116,10 +123,28 @@ void VulkanPrimitiveProcessor::BeginFrame() {
 
 void VulkanPrimitiveProcessor::EndSubmission() {
   frame_index_buffer_pool_->FlushWrites();
+  const ui::vulkan::VulkanProvider& provider =
+      command_processor_.GetVulkanProvider();
+  for (PersistentIndexBuffer& persistent_index_buffer :
+       persistent_index_buffers_) {
+    if (!persistent_index_buffer.written_end) {
+      continue;
+    }
+    ui::vulkan::util::FlushMappedMemoryRange(
+        provider, persistent_index_buffer.memory,
+        persistent_index_buffer.memory_type,
+        persistent_index_buffer.written_start,
+        persistent_index_buffer.memory_size,
+        persistent_index_buffer.written_end -
+            persistent_index_buffer.written_start);
+    persistent_index_buffer.written_start = 0;
+    persistent_index_buffer.written_end = 0;
+  }
 }
 
 void VulkanPrimitiveProcessor::EndFrame() {
-  ClearPerFrameCache();
+  ClearPerFrameCache(command_processor_.GetCurrentFrame(),
+                     command_processor_.GetCompletedFrame());
   frame_index_buffers_.clear();
 }
 
@@ -219,6 +244,73 @@ void* VulkanPrimitiveProcessor::RequestHostConvertedIndexBufferForCurrentFrame(
   return mapping;
 }
 
+void* VulkanPrimitiveProcessor::CreatePersistentIndexBufferChunk(
+    uint32_t chunk_index) {
+  assert_true(chunk_index == persistent_index_buffers_.size());
+  const ui::vulkan::VulkanProvider& provider =
+      command_processor_.GetVulkanProvider();
+  const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
+  VkDevice device = provider.device();
+  PersistentIndexBuffer persistent_index_buffer;
+  if (!ui::vulkan::util::CreateDedicatedAllocationBuffer(
+          provider, kPersistentIndexBufferChunkSize,
+          VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+          ui::vulkan::util::MemoryPurpose::kUpload,
+          persistent_index_buffer.buffer, persistent_index_buffer.memory,
+          &persistent_index_buffer.memory_type,
+          &persistent_index_buffer.memory_size)) {
+    XELOGE(
+        "Vulkan primitive processor: Failed to create a {} MB buffer for "
+        "converted indices persistent across frames",
+        kPersistentIndexBufferChunkSize >> 20);
+    return nullptr;
+  }
+  void* mapping;
+  if (dfn.vkMapMemory(device, persistent_index_buffer.memory, 0,
+                      VK_WHOLE_SIZE, 0, &mapping) != VK_SUCCESS) {
+    XELOGE(
+        "Vulkan primitive processor: Failed to map a {} MB buffer for "
+        "converted indices persistent across frames",
+        kPersistentIndexBufferChunkSize >> 20);
+    dfn.vkDestroyBuffer(device, persistent_index_buffer.buffer, nullptr);
+    dfn.vkFreeMemory(device, persistent_index_buffer.memory, nullptr);
+    return nullptr;
+  }
+  persistent_index_buffer.written_start = 0;
+  persistent_index_buffer.written_end = 0;
+  persistent_index_buffers_.push_back(persistent_index_buffer);
+  return mapping;
+}
+
+void VulkanPrimitiveProcessor::PersistentIndexBufferChunkWritten(
+    uint32_t chunk_index, uint32_t offset, uint32_t length) {
+  PersistentIndexBuffer& persistent_index_buffer =
+      persistent_index_buffers_[chunk_index];
+  if (persistent_index_buffer.written_end) {
+    persistent_index_buffer.written_start =
+        std::min(persistent_index_buffer.written_start, offset);
+    persistent_index_buffer.written_end =
+        std::max(persistent_index_buffer.written_end, offset + length);
+  } else {
+    persistent_index_buffer.written_start = offset;
+    persistent_index_buffer.written_end = offset + length;
+  }
+}
+
+void VulkanPrimitiveProcessor::DestroyPersistentIndexBufferChunks() {
+  const ui::vulkan::VulkanProvider& provider =
+      command_processor_.GetVulkanProvider();
+  const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
+  VkDevice device = provider.device();
+  for (const PersistentIndexBuffer& persistent_index_buffer :
+       persistent_index_buffers_) {
+    // Freeing the memory unmaps it implicitly.
+    dfn.vkDestroyBuffer(device, persistent_index_buffer.buffer, nullptr);
+    dfn.vkFreeMemory(device, persistent_index_buffer.memory, nullptr);
+  }
+  persistent_index_buffers_.clear();
+}
+
 }  // namespace vulkan
 }  // namespace gpu
 }  // namespace xe
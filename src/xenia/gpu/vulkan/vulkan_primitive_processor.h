@@ -10,8 +10,10 @@
 #ifndef XENIA_GPU_VULKAN_VULKAN_PRIMITIVE_PROCESSOR_H_
 #define XENIA_GPU_VULKAN_VULKAN_PRIMITIVE_PROCESSOR_H_
 
+#include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "xenia/base/assert.h"
 #include "xenia/gpu/primitive_processor.h"
@@ -36,7 +38,7 @@ class VulkanPrimitiveProcessor final : public PrimitiveProcessor {
 
   bool Initialize();
   void Shutdown(bool from_destructor = false);
-  void ClearCache() { frame_index_buffer_pool_->ClearCache(); }
+  void ClearCache();
 
   void CompletedSubmissionUpdated();
   void BeginSubmission();
@@ -52,6 +54,12 @@ class VulkanPrimitiveProcessor final : public PrimitiveProcessor {
   }
   std::pair<VkBuffer, VkDeviceSize> GetConvertedIndexBuffer(
       size_t handle) const {
+    if (IsPersistentIndexBufferHandle(handle)) {
+      return std::make_pair(
+          persistent_index_buffers_[GetPersistentIndexBufferChunk(handle)]
+              .buffer,
+          VkDeviceSize(GetPersistentIndexBufferOffset(handle)));
+    }
     return frame_index_buffers_[handle];
   }
 
@@ -64,7 +72,22 @@ class VulkanPrimitiveProcessor final : public PrimitiveProcessor {
       uint32_t coalignment_original_address,
       size_t& backend_handle_out) override;
 
+  void* CreatePersistentIndexBufferChunk(uint32_t chunk_index) override;
+  void PersistentIndexBufferChunkWritten(uint32_t chunk_index, uint32_t offset,
+                                         uint32_t length) override;
+  void DestroyPersistentIndexBufferChunks() override;
+
  private:
+  struct PersistentIndexBuffer {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    uint32_t memory_type;
+    VkDeviceSize memory_size;
+    // Range written since the last flush, empty if written_end is 0.
+    uint32_t written_start;
+    uint32_t written_end;
+  };
+
   VulkanCommandProcessor& command_processor_;
 
   VkDeviceSize builtin_index_buffer_size_ = 0;
@@ -82,6 +105,10 @@ class VulkanPrimitiveProcessor final : public PrimitiveProcessor {
   std::unique_ptr<ui::vulkan::VulkanUploadBufferPool> frame_index_buffer_pool_;
   // Indexed by the backend handles.
   std::deque<std::pair<VkBuffer, VkDeviceSize>> frame_index_buffers_;
+
+  // Persistently mapped buffers for the converted indices kept in the cache
+  // across frames, indexed by the chunk index.
+  std::vector<PersistentIndexBuffer> persistent_index_buffers_;
 };
 
 }  // namespace vulkan
@@ -14,6 +14,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <iterator>
 #include <memory>
 #include <tuple>
 #include <utility>
@@ -54,6 +55,12 @@ DEFINE_string(
     "  Choose what is considered the most optimal for the system (currently "
     "always FB because the FSI path is much slower now).",
     "GPU");
+DEFINE_bool(
+    vulkan_dynamic_rendering, true,
+    "Bind the host render targets for guest draws using dynamic rendering on "
+    "Vulkan 1.3 devices supporting it, instead of creating render passes and "
+    "framebuffers for every combination of render targets.",
+    "Vulkan");
 
 namespace xe {
 namespace gpu {
@@ -253,6 +260,9 @@ bool VulkanRenderTargetCache::Initialize(uint32_t shared_memory_binding_count) {
       path_ = Path::kHostRenderTargets;
     }
   }
+  dynamic_rendering_used_ = path_ == Path::kHostRenderTargets &&
+                            cvars::vulkan_dynamic_rendering &&
+                            device_info.dynamicRendering;
 
   // Format support.
   constexpr VkFormatFeatureFlags kUsedDepthFormatFeatures =
@@ -867,6 +877,7 @@ bool VulkanRenderTargetCache::Initialize(uint32_t shared_memory_binding_count) {
   std::memset(last_update_framebuffer_attachments_, 0,
               sizeof(last_update_framebuffer_attachments_));
   last_update_framebuffer_ = VK_NULL_HANDLE;
+  last_update_rendering_ = Rendering();
 
   InitializeCommon();
   return true;
@@ -993,6 +1004,7 @@ void VulkanRenderTargetCache::ClearCache() {
   // Framebuffer objects must be destroyed because they reference views of
   // attachment images, which may be removed by the common ClearCache.
   last_update_framebuffer_ = VK_NULL_HANDLE;
+  last_update_rendering_ = Rendering();
   for (const auto& framebuffer_pair : framebuffers_) {
     dfn.vkDestroyFramebuffer(device, framebuffer_pair.second.framebuffer,
                              nullptr);
@@ -1021,6 +1033,69 @@ void VulkanRenderTargetCache::EndSubmission() {
   }
 }
 
+void VulkanRenderTargetCache::BeginFrame() {
+  RenderTargetCache::BeginFrame();
+
+  DestroyUnusedRenderTargets(command_processor_.GetCompletedSubmission(),
+                             destroyed_render_target_keys_);
+  if (destroyed_render_target_keys_.empty()) {
+    return;
+  }
+  // New render targets may be created at the addresses of the destroyed ones.
+  last_update_framebuffer_ = VK_NULL_HANDLE;
+  last_update_rendering_ = Rendering();
+  // Framebuffers referencing the destroyed render targets have not been used
+  // by the GPU after the render targets either, and must not be reused for
+  // new render targets with the same keys.
+  const ui::vulkan::VulkanProvider& provider =
+      command_processor_.GetVulkanProvider();
+  const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
+  VkDevice device = provider.device();
+  auto does_framebuffer_reference = [](const FramebufferKey& framebuffer_key,
+                                       RenderTargetKey render_target_key) {
+    const RenderPassKey& render_pass_key = framebuffer_key.render_pass_key;
+    if (framebuffer_key.pitch_tiles_at_32bpp !=
+            render_target_key.pitch_tiles_at_32bpp ||
+        render_pass_key.msaa_samples != render_target_key.msaa_samples) {
+      return false;
+    }
+    if (render_target_key.is_depth) {
+      return (render_pass_key.depth_and_color_used & 0b1) &&
+             framebuffer_key.depth_base_tiles == render_target_key.base_tiles &&
+             render_pass_key.depth_format == render_target_key.GetDepthFormat();
+    }
+    const uint32_t color_base_tiles[] = {
+        framebuffer_key.color_0_base_tiles, framebuffer_key.color_1_base_tiles,
+        framebuffer_key.color_2_base_tiles, framebuffer_key.color_3_base_tiles};
+    const xenos::ColorRenderTargetFormat color_view_formats[] = {
+        render_pass_key.color_0_view_format,
+        render_pass_key.color_1_view_format,
+        render_pass_key.color_2_view_format,
+        render_pass_key.color_3_view_format};
+    for (uint32_t i = 0; i < xenos::kMaxColorRenderTargets; ++i) {
+      if ((render_pass_key.depth_and_color_used & (uint32_t(1) << (1 + i))) &&
+          color_base_tiles[i] == render_target_key.base_tiles &&
+          GetColorResourceFormat(color_view_formats[i]) ==
+              render_target_key.GetColorFormat()) {
+        return true;
+      }
+    }
+    return false;
+  };
+  typename decltype(framebuffers_)::iterator it_next;
+  for (auto it = framebuffers_.begin(); it != framebuffers_.end();
+       it = it_next) {
+    it_next = std::next(it);
+    for (RenderTargetKey destroyed_key : destroyed_render_target_keys_) {
+      if (does_framebuffer_reference(it->first, destroyed_key)) {
+        dfn.vkDestroyFramebuffer(device, it->second.framebuffer, nullptr);
+        framebuffers_.erase(it);
+        break;
+      }
+    }
+  }
+}
+
 bool VulkanRenderTargetCache::Resolve(const Memory& memory,
                                       VulkanSharedMemory& shared_memory,
                                       VulkanTextureCache& texture_cache,
@@ -1327,50 +1402,78 @@ bool VulkanRenderTargetCache::Update(
                 : depth_and_color_render_targets[4]->key().GetColorFormat();
       }
 
-      const Framebuffer* framebuffer = last_update_framebuffer_;
-      VkRenderPass render_pass = last_update_render_pass_key_ == render_pass_key
-                                     ? last_update_render_pass_
-                                     : VK_NULL_HANDLE;
-      if (render_pass == VK_NULL_HANDLE) {
-        render_pass = GetHostRenderTargetsRenderPass(render_pass_key);
-        if (render_pass == VK_NULL_HANDLE) {
-          return false;
-        }
-        // Framebuffer for a different render pass needed now.
-        framebuffer = nullptr;
-      }
-
       uint32_t pitch_tiles_at_32bpp =
           ((rb_surface_info.surface_pitch << uint32_t(
                 rb_surface_info.msaa_samples >= xenos::MsaaSamples::k4X)) +
            (xenos::kEdramTileWidthSamples - 1)) /
           xenos::kEdramTileWidthSamples;
-      if (framebuffer) {
-        if (last_update_framebuffer_pitch_tiles_at_32bpp_ !=
-                pitch_tiles_at_32bpp ||
-            std::memcmp(last_update_framebuffer_attachments_,
-                        depth_and_color_render_targets,
-                        sizeof(last_update_framebuffer_attachments_))) {
+
+      if (dynamic_rendering_used_) {
+        // No objects to create - the pipelines are compatible with any
+        // attachments of the formats in the render pass key.
+        Rendering& rendering = last_update_rendering_;
+        rendering.render_pass_key = render_pass_key;
+        rendering.host_extent =
+            GetHostRenderTargetsExtent(render_pass_key, pitch_tiles_at_32bpp);
+        for (uint32_t i = 0; i < 1 + xenos::kMaxColorRenderTargets; ++i) {
+          const auto* vulkan_rt = static_cast<const VulkanRenderTarget*>(
+              depth_and_color_render_targets[i]);
+          VkImageView attachment = VK_NULL_HANDLE;
+          if (vulkan_rt) {
+            attachment = i ? vulkan_rt->view_depth_color()
+                           : vulkan_rt->view_depth_stencil();
+          }
+          rendering.attachments[i] = attachment;
+        }
+        last_update_render_pass_key_ = render_pass_key;
+        last_update_render_pass_ = VK_NULL_HANDLE;
+        last_update_framebuffer_pitch_tiles_at_32bpp_ = pitch_tiles_at_32bpp;
+        std::memcpy(last_update_framebuffer_attachments_,
+                    depth_and_color_render_targets,
+                    sizeof(last_update_framebuffer_attachments_));
+        last_update_framebuffer_ = nullptr;
+      } else {
+        const Framebuffer* framebuffer = last_update_framebuffer_;
+        VkRenderPass render_pass =
+            last_update_render_pass_key_ == render_pass_key
+                ? last_update_render_pass_
+                : VK_NULL_HANDLE;
+        if (render_pass == VK_NULL_HANDLE) {
+          render_pass = GetHostRenderTargetsRenderPass(render_pass_key);
+          if (render_pass == VK_NULL_HANDLE) {
+            return false;
+          }
+          // Framebuffer for a different render pass needed now.
           framebuffer = nullptr;
         }
-      }
-      if (!framebuffer) {
-        framebuffer = GetHostRenderTargetsFramebuffer(
-            render_pass_key, pitch_tiles_at_32bpp,
-            depth_and_color_render_targets);
+
+        if (framebuffer) {
+          if (last_update_framebuffer_pitch_tiles_at_32bpp_ !=
+                  pitch_tiles_at_32bpp ||
+              std::memcmp(last_update_framebuffer_attachments_,
+                          depth_and_color_render_targets,
+                          sizeof(last_update_framebuffer_attachments_))) {
+            framebuffer = nullptr;
+          }
+        }
         if (!framebuffer) {
-          return false;
+          framebuffer = GetHostRenderTargetsFramebuffer(
+              render_pass_key, pitch_tiles_at_32bpp,
+              depth_and_color_render_targets);
+          if (!framebuffer) {
+            return false;
+          }
         }
-      }
 
-      // Successful update - write the new configuration.
-      last_update_render_pass_key_ = render_pass_key;
-      last_update_render_pass_ = render_pass;
-      last_update_framebuffer_pitch_tiles_at_32bpp_ = pitch_tiles_at_32bpp;
-      std::memcpy(last_update_framebuffer_attachments_,
-                  depth_and_color_render_targets,
-                  sizeof(last_update_framebuffer_attachments_));
-      last_update_framebuffer_ = framebuffer;
+        // Successful update - write the new configuration.
+        last_update_render_pass_key_ = render_pass_key;
+        last_update_render_pass_ = render_pass;
+        last_update_framebuffer_pitch_tiles_at_32bpp_ = pitch_tiles_at_32bpp;
+        std::memcpy(last_update_framebuffer_attachments_,
+                    depth_and_color_render_targets,
+                    sizeof(last_update_framebuffer_attachments_));
+        last_update_framebuffer_ = framebuffer;
+      }
 
       // Transition the used render targets.
       for (uint32_t i = 0; i < 1 + xenos::kMaxColorRenderTargets; ++i) {
@@ -1684,6 +1787,10 @@ uint32_t VulkanRenderTargetCache::GetMaxRenderTargetHeight() const {
                   device_info.maxImageDimension2D);
 }
 
+uint64_t VulkanRenderTargetCache::GetCurrentSubmission() const {
+  return command_processor_.GetCurrentSubmission();
+}
+
 RenderTargetCache::RenderTarget* VulkanRenderTargetCache::CreateRenderTarget(
     RenderTargetKey key) {
   const ui::vulkan::VulkanProvider& provider =
@@ -2040,6 +2147,60 @@ void VulkanRenderTargetCache::CommitEdramBufferShaderWrites(
   PixelShaderInterlockFullEdramBarrierPlaced();
 }
 
+uint32_t VulkanRenderTargetCache::GetHostRenderTargetsRenderingFormats(
+    RenderPassKey key,
+    VkFormat color_formats_out[xenos::kMaxColorRenderTargets],
+    VkFormat& depth_format_out) const {
+  depth_format_out = (key.depth_and_color_used & 0b1)
+                         ? GetDepthVulkanFormat(key.depth_format)
+                         : VK_FORMAT_UNDEFINED;
+  xenos::ColorRenderTargetFormat color_formats[] = {
+      key.color_0_view_format,
+      key.color_1_view_format,
+      key.color_2_view_format,
+      key.color_3_view_format,
+  };
+  uint32_t color_attachment_count =
+      32 - xe::lzcnt(uint32_t(key.depth_and_color_used >> 1));
+  for (uint32_t i = 0; i < color_attachment_count; ++i) {
+    if (!(key.depth_and_color_used & (uint32_t(1) << (1 + i)))) {
+      color_formats_out[i] = VK_FORMAT_UNDEFINED;
+      continue;
+    }
+    color_formats_out[i] =
+        key.color_rts_use_transfer_formats
+            ? GetColorOwnershipTransferVulkanFormat(color_formats[i])
+            : GetColorVulkanFormat(color_formats[i]);
+  }
+  return color_attachment_count;
+}
+
+VkExtent2D VulkanRenderTargetCache::GetHostRenderTargetsExtent(
+    RenderPassKey render_pass_key, uint32_t pitch_tiles_at_32bpp) const {
+  const ui::vulkan::VulkanProvider::DeviceInfo& device_info =
+      command_processor_.GetVulkanProvider().device_info();
+  VkExtent2D host_extent;
+  if (pitch_tiles_at_32bpp) {
+    host_extent.width = RenderTargetKey::GetWidth(pitch_tiles_at_32bpp,
+                                                  render_pass_key.msaa_samples);
+    host_extent.height = GetRenderTargetHeight(pitch_tiles_at_32bpp,
+                                               render_pass_key.msaa_samples);
+  } else {
+    assert_zero(render_pass_key.depth_and_color_used);
+    // Still needed for occlusion queries.
+    host_extent.width = xenos::kTexture2DCubeMaxWidthHeight;
+    host_extent.height = xenos::kTexture2DCubeMaxWidthHeight;
+  }
+  // Limiting to the device limit for the case of no attachments, for which
+  // there's no limit imposed by the sizes of the attachments that have been
+  // created successfully.
+  host_extent.width = std::min(host_extent.width * draw_resolution_scale_x(),
+                               device_info.maxFramebufferWidth);
+  host_extent.height = std::min(host_extent.height * draw_resolution_scale_y(),
+                                device_info.maxFramebufferHeight);
+  return host_extent;
+}
+
 const VulkanRenderTargetCache::Framebuffer*
 VulkanRenderTargetCache::GetHostRenderTargetsFramebuffer(
     RenderPassKey render_pass_key, uint32_t pitch_tiles_at_32bpp,
@@ -2075,8 +2236,6 @@ VulkanRenderTargetCache::GetHostRenderTargetsFramebuffer(
       command_processor_.GetVulkanProvider();
   const ui::vulkan::VulkanProvider::DeviceFunctions& dfn = provider.dfn();
   VkDevice device = provider.device();
-  const ui::vulkan::VulkanProvider::DeviceInfo& device_info =
-      provider.device_info();
 
   VkRenderPass render_pass = GetHostRenderTargetsRenderPass(render_pass_key);
   if (render_pass == VK_NULL_HANDLE) {
@@ -2109,25 +2268,8 @@ VulkanRenderTargetCache::GetHostRenderTargetsFramebuffer(
   framebuffer_create_info.renderPass = render_pass;
   framebuffer_create_info.attachmentCount = attachment_count;
   framebuffer_create_info.pAttachments = attachments;
-  VkExtent2D host_extent;
-  if (pitch_tiles_at_32bpp) {
-    host_extent.width = RenderTargetKey::GetWidth(pitch_tiles_at_32bpp,
-                                                  render_pass_key.msaa_samples);
-    host_extent.height = GetRenderTargetHeight(pitch_tiles_at_32bpp,
-                                               render_pass_key.msaa_samples);
-  } else {
-    assert_zero(render_pass_key.depth_and_color_used);
-    // Still needed for occlusion queries.
-    host_extent.width = xenos::kTexture2DCubeMaxWidthHeight;
-    host_extent.height = xenos::kTexture2DCubeMaxWidthHeight;
-  }
-  // Limiting to the device limit for the case of no attachments, for which
-  // there's no limit imposed by the sizes of the attachments that have been
-  // created successfully.
-  host_extent.width = std::min(host_extent.width * draw_resolution_scale_x(),
-                               device_info.maxFramebufferWidth);
-  host_extent.height = std::min(host_extent.height * draw_resolution_scale_y(),
-                                device_info.maxFramebufferHeight);
+  VkExtent2D host_extent =
+      GetHostRenderTargetsExtent(render_pass_key, pitch_tiles_at_32bpp);
   framebuffer_create_info.width = host_extent.width;
   framebuffer_create_info.height = host_extent.height;
   framebuffer_create_info.layers = 1;
@@ -16,6 +16,7 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "xenia/base/hash.h"
 #include "xenia/base/xxhash.h"
@@ -96,6 +97,22 @@ class VulkanRenderTargetCache final : public RenderTargetCache {
         : framebuffer(framebuffer), host_extent(host_extent) {}
   };
 
+  // Host render target bindings for guest draws with dynamic rendering instead
+  // of a render pass and a framebuffer.
+  struct Rendering {
+    RenderPassKey render_pass_key;
+    VkExtent2D host_extent{};
+    // Depth / stencil, then color. VK_NULL_HANDLE for unused attachments.
+    VkImageView attachments[1 + xenos::kMaxColorRenderTargets] = {};
+    bool operator==(const Rendering& other) const {
+      return render_pass_key == other.render_pass_key &&
+             host_extent.width == other.host_extent.width &&
+             host_extent.height == other.host_extent.height &&
+             !std::memcmp(attachments, other.attachments, sizeof(attachments));
+    }
+    bool operator!=(const Rendering& other) const { return !(*this == other); }
+  };
+
   VulkanRenderTargetCache(const RegisterFile& register_file,
                           const Memory& memory, TraceWriter& trace_writer,
                           uint32_t draw_resolution_scale_x,
@@ -112,6 +129,8 @@ class VulkanRenderTargetCache final : public RenderTargetCache {
   void CompletedSubmissionUpdated();
   void EndSubmission();
 
+  void BeginFrame() override;
+
   Path GetPath() const override { return path_; }
 
   VkBuffer edram_buffer() const { return edram_buffer_; }
@@ -137,6 +156,11 @@ class VulkanRenderTargetCache final : public RenderTargetCache {
   const Framebuffer* last_update_framebuffer() const {
     return last_update_framebuffer_;
   }
+  // With dynamic rendering, used instead of the render pass and the
+  // framebuffer, which are null in this case.
+  const Rendering& last_update_rendering() const {
+    return last_update_rendering_;
+  }
 
   // Using R16G16[B16A16]_SNORM, which are -1...1, not the needed -32...32.
   // Persistent data doesn't depend on this, so can be overriden by per-game
@@ -172,6 +196,17 @@ class VulkanRenderTargetCache final : public RenderTargetCache {
   // A render pass managed by the render target cache may be ended and resumed
   // at any time (to allow for things like copying and texture loading).
   VkRenderPass GetHostRenderTargetsRenderPass(RenderPassKey key);
+  // Whether guest draws to host render targets use dynamic rendering, with
+  // pipelines created for the attachment formats rather than a render pass.
+  // Render target ownership transfers still use render passes.
+  bool IsDynamicRenderingUsed() const { return dynamic_rendering_used_; }
+  // Returns the number of color attachment formats written for
+  // VkPipelineRenderingCreateInfo, with VK_FORMAT_UNDEFINED for the unused
+  // ones below the last used one.
+  uint32_t GetHostRenderTargetsRenderingFormats(
+      RenderPassKey key,
+      VkFormat color_formats_out[xenos::kMaxColorRenderTargets],
+      VkFormat& depth_format_out) const;
   VkRenderPass GetFragmentShaderInterlockRenderPass() const {
     assert_true(GetPath() == Path::kPixelShaderInterlock);
     return fsi_render_pass_;
@@ -188,6 +223,7 @@ class VulkanRenderTargetCache final : public RenderTargetCache {
   uint32_t GetMaxRenderTargetHeight() const override;
 
   RenderTarget* CreateRenderTarget(RenderTargetKey key) override;
+  uint64_t GetCurrentSubmission() const override;
 
   bool IsHostDepthEncodingDifferent(
       xenos::DepthRenderTargetFormat format) const override;
@@ -268,6 +304,7 @@ class VulkanRenderTargetCache final : public RenderTargetCache {
   TraceWriter& trace_writer_;
 
   Path path_ = Path::kHostRenderTargets;
+  bool dynamic_rendering_used_ = false;
 
   // Accessible in fragment and compute shaders.
   VkDescriptorSetLayout descriptor_set_layout_storage_buffer_ = VK_NULL_HANDLE;
@@ -306,6 +343,7 @@ class VulkanRenderTargetCache final : public RenderTargetCache {
       last_update_framebuffer_attachments_[1 + xenos::kMaxColorRenderTargets] =
           {};
   const Framebuffer* last_update_framebuffer_ = VK_NULL_HANDLE;
+  Rendering last_update_rendering_;
 
   // For host render targets.
 
@@ -835,6 +873,9 @@ class VulkanRenderTargetCache final : public RenderTargetCache {
     }
   };
 
+  // The size of the render area for the host render targets with the pitch.
+  VkExtent2D GetHostRenderTargetsExtent(RenderPassKey render_pass_key,
+                                        uint32_t pitch_tiles_at_32bpp) const;
   // Returns the framebuffer object, or VK_NULL_HANDLE if failed to create.
   const Framebuffer* GetHostRenderTargetsFramebuffer(
       RenderPassKey render_pass_key, uint32_t pitch_tiles_at_32bpp,
@@ -878,6 +919,8 @@ class VulkanRenderTargetCache final : public RenderTargetCache {
 
   std::unordered_map<FramebufferKey, Framebuffer, FramebufferKey::Hasher>
       framebuffers_;
+  // Temporary storage for DestroyUnusedRenderTargets results.
+  std::vector<RenderTargetKey> destroyed_render_target_keys_;
 
   // Set 0 - EDRAM storage buffer, set 1 - source depth sampled image (and
   // unused stencil from the transfer descriptor set), HostDepthStoreConstants
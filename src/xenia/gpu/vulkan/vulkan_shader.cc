@@ -11,20 +11,45 @@
 
 #include <cstdint>
 
+#include "xenia/base/assert.h"
 #include "xenia/base/logging.h"
 #include "xenia/ui/vulkan/vulkan_provider.h"
+#include "xenia/ui/vulkan/vulkan_util.h"
 
 namespace xe {
 namespace gpu {
 namespace vulkan {
 
 VulkanShader::VulkanTranslation::~VulkanTranslation() {
+  const ui::vulkan::VulkanProvider& provider =
+      static_cast<const VulkanShader&>(shader()).provider_;
   if (shader_module_) {
-    const ui::vulkan::VulkanProvider& provider =
-        static_cast<const VulkanShader&>(shader()).provider_;
     provider.dfn().vkDestroyShaderModule(provider.device(), shader_module_,
                                          nullptr);
   }
+  if (optimized_shader_module_) {
+    provider.dfn().vkDestroyShaderModule(provider.device(),
+                                         optimized_shader_module_, nullptr);
+  }
+}
+
+void VulkanShader::VulkanTranslation::CompleteOptimization(
+    const std::vector<uint32_t>& optimized_binary) {
+  assert_false(is_optimization_completed());
+  if (!optimized_binary.empty()) {
+    const ui::vulkan::VulkanProvider& provider =
+        static_cast<const VulkanShader&>(shader()).provider_;
+    optimized_shader_module_ = ui::vulkan::util::CreateShaderModule(
+        provider, optimized_binary.data(),
+        optimized_binary.size() * sizeof(uint32_t));
+    if (optimized_shader_module_ == VK_NULL_HANDLE) {
+      XELOGE(
+          "VulkanShader::VulkanTranslation: Failed to create the optimized "
+          "Vulkan shader module for shader {:016X} modification {:016X}",
+          shader().ucode_data_hash(), modification());
+    }
+  }
+  optimization_completed_.store(true, std::memory_order_release);
 }
 
 VkShaderModule VulkanShader::VulkanTranslation::GetOrCreateShaderModule() {
@@ -10,8 +10,11 @@
 #ifndef XENIA_GPU_VULKAN_VULKAN_SHADER_H_
 #define XENIA_GPU_VULKAN_VULKAN_SHADER_H_
 
+#include <atomic>
 #include <cstdint>
+#include <vector>
 
+#include "xenia/base/assert.h"
 #include "xenia/gpu/spirv_shader.h"
 #include "xenia/gpu/xenos.h"
 #include "xenia/ui/vulkan/vulkan_provider.h"
@@ -31,8 +34,29 @@ class VulkanShader : public SpirvShader {
     VkShaderModule GetOrCreateShaderModule();
     VkShaderModule shader_module() const { return shader_module_; }
 
+    // Background optimization of the translated SPIR-V. Returns true only for
+    // the first request, so the translation is queued for optimization once.
+    bool RequestOptimization() {
+      return !optimization_requested_.test_and_set(std::memory_order_relaxed);
+    }
+    // Creates the optimized module (or attempts to, with an empty binary if
+    // optimization has failed) and publishes it.
+    void CompleteOptimization(const std::vector<uint32_t>& optimized_binary);
+    bool is_optimization_completed() const {
+      return optimization_completed_.load(std::memory_order_acquire);
+    }
+    // VK_NULL_HANDLE if optimization has failed, must only be called if
+    // is_optimization_completed() is true.
+    VkShaderModule optimized_shader_module() const {
+      assert_true(is_optimization_completed());
+      return optimized_shader_module_;
+    }
+
    private:
     VkShaderModule shader_module_ = VK_NULL_HANDLE;
+    std::atomic_flag optimization_requested_ = ATOMIC_FLAG_INIT;
+    std::atomic<bool> optimization_completed_{false};
+    VkShaderModule optimized_shader_module_ = VK_NULL_HANDLE;
   };
 
   explicit VulkanShader(const ui::vulkan::VulkanProvider& provider,
@@ -87,11 +87,13 @@ bool VulkanSharedMemory::Initialize() {
         if (allocation_size_log2 < kBufferSizeLog2) {
           // Maximum of 1024 allocations in the worst case for all of the
           // buffer because of the overall 4096 allocation count limit on
-          // Windows drivers.
+          // Windows drivers, plus the limited number of smaller allocations
+          // made before blocks are densely used.
           InitializeSparseHostGpuMemory(
               std::max(allocation_size_log2,
                        std::max(kHostGpuMemoryOptimalSparseAllocationLog2,
-                                kBufferSizeLog2 - uint32_t(10))));
+                                kBufferSizeLog2 - uint32_t(10))),
+              allocation_size_log2);
         } else {
           // Shouldn't happen on any real platform, but no point allocating the
           // buffer sparsely.
@@ -185,7 +187,8 @@ bool VulkanSharedMemory::Initialize() {
   upload_buffer_pool_ = std::make_unique<ui::vulkan::VulkanUploadBufferPool>(
       provider, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
       xe::align(ui::vulkan::VulkanUploadBufferPool::kDefaultPageSize,
-                size_t(1) << page_size_log2()));
+                size_t(1) << page_size_log2()),
+      "vulkan/shared_memory");
 
   return true;
 }
@@ -225,6 +228,24 @@ void VulkanSharedMemory::Use(Usage usage,
   written_range.second =
       std::min(written_range.second, kBufferSize - written_range.first);
   assert_true(usage != Usage::kRead || !written_range.second);
+  if (usage == Usage::kComputeWrite && last_usage_ == usage &&
+      last_written_range_.second && written_range.second &&
+      (written_range.first >=
+           last_written_range_.first + last_written_range_.second ||
+       written_range.first + written_range.second <=
+           last_written_range_.first)) {
+    // Resolves don't read the shared memory, so consecutive resolves to
+    // disjoint ranges (like shadow cascades) are independent - keep
+    // accumulating the written extent until an overlapping write or a
+    // different usage instead of placing a barrier between each of them.
+    uint32_t written_end =
+        std::max(last_written_range_.first + last_written_range_.second,
+                 written_range.first + written_range.second);
+    last_written_range_.first =
+        std::min(last_written_range_.first, written_range.first);
+    last_written_range_.second = written_end - last_written_range_.first;
+    return;
+  }
   if (last_usage_ != usage || last_written_range_.second) {
     VkPipelineStageFlags src_stage_mask, dst_stage_mask;
     VkAccessFlags src_access_mask, dst_access_mask;
@@ -49,7 +49,8 @@ class VulkanSharedMemory : public SharedMemory {
     kTransferDestination,
   };
   // Inserts a pipeline barrier for the target usage, also ensuring consecutive
-  // read-write accesses are ordered with each other.
+  // read-write accesses are ordered with each other. Consecutive kComputeWrite
+  // usages with disjoint written ranges are not ordered with each other.
   void Use(Usage usage, std::pair<uint32_t, uint32_t> written_range = {});
 
   VkBuffer buffer() const { return buffer_; }
@@ -14,6 +14,7 @@
 #include <utility>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
@@ -475,11 +476,64 @@ VulkanTextureCache::~VulkanTextureCache() {
   // textures before destroying VMA.
   DestroyAllTextures(true);
 
+  for (VmaPool& texture_pool : texture_pools_) {
+    if (texture_pool != VK_NULL_HANDLE) {
+      vmaDestroyPool(vma_allocator_, texture_pool);
+      texture_pool = VK_NULL_HANDLE;
+    }
+  }
+
   if (vma_allocator_ != VK_NULL_HANDLE) {
     vmaDestroyAllocator(vma_allocator_);
   }
 }
 
+void VulkanTextureCache::BeginFrame() {
+  TextureCache::BeginFrame();
+
+  // Report the memory usage of the textures.
+  static xe::counters::Gauge& block_count_gauge =
+      xe::counters::GetGauge("gpu/vulkan/texture_memory/blocks");
+  static xe::counters::Gauge& block_bytes_gauge =
+      xe::counters::GetGauge("gpu/vulkan/texture_memory/block_bytes");
+  static xe::counters::Gauge& allocation_count_gauge =
+      xe::counters::GetGauge("gpu/vulkan/texture_memory/allocations");
+  static xe::counters::Gauge& allocation_bytes_gauge =
+      xe::counters::GetGauge("gpu/vulkan/texture_memory/allocation_bytes");
+  static xe::counters::Gauge& small_pool_bytes_gauge =
+      xe::counters::GetGauge("gpu/vulkan/texture_memory/small_pool_bytes");
+  static xe::counters::Gauge& medium_pool_bytes_gauge =
+      xe::counters::GetGauge("gpu/vulkan/texture_memory/medium_pool_bytes");
+  static_assert(kTexturePoolSizeClassCount == 2,
+                "One pool size gauge per texture pool size class");
+  const VkPhysicalDeviceMemoryProperties* memory_properties;
+  vmaGetMemoryProperties(vma_allocator_, &memory_properties);
+  VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+  vmaGetHeapBudgets(vma_allocator_, budgets);
+  VmaStatistics statistics = {};
+  for (uint32_t i = 0; i < memory_properties->memoryHeapCount; ++i) {
+    const VmaStatistics& heap_statistics = budgets[i].statistics;
+    statistics.blockCount += heap_statistics.blockCount;
+    statistics.blockBytes += heap_statistics.blockBytes;
+    statistics.allocationCount += heap_statistics.allocationCount;
+    statistics.allocationBytes += heap_statistics.allocationBytes;
+  }
+  block_count_gauge.Set(int64_t(statistics.blockCount));
+  block_bytes_gauge.Set(int64_t(statistics.blockBytes));
+  allocation_count_gauge.Set(int64_t(statistics.allocationCount));
+  allocation_bytes_gauge.Set(int64_t(statistics.allocationBytes));
+  xe::counters::Gauge* pool_bytes_gauges[] = {&small_pool_bytes_gauge,
+                                              &medium_pool_bytes_gauge};
+  for (size_t i = 0; i < kTexturePoolSizeClassCount; ++i) {
+    VmaStatistics pool_statistics = {};
+    if (texture_pools_[i] != VK_NULL_HANDLE) {
+      vmaGetPoolStatistics(vma_allocator_, texture_pools_[i],
+                           &pool_statistics);
+    }
+    pool_bytes_gauges[i]->Set(int64_t(pool_statistics.blockBytes));
+  }
+}
+
 void VulkanTextureCache::BeginSubmission(uint64_t new_submission_index) {
   TextureCache::BeginSubmission(new_submission_index);
 
@@ -1060,13 +1114,47 @@ std::unique_ptr<TextureCache::Texture> VulkanTextureCache::CreateTexture(
     image_format_list_create_info.pViewFormats = formats;
   }
 
-  VmaAllocationCreateInfo allocation_create_info = {};
-  allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
-
   VkImage image;
+  if (dfn.vkCreateImage(device, &image_create_info, nullptr, &image) !=
+      VK_SUCCESS) {
+    return nullptr;
+  }
+  VkMemoryRequirements image_memory_requirements;
+  dfn.vkGetImageMemoryRequirements(device, image, &image_memory_requirements);
+  VmaAllocationCreateInfo allocation_create_info = {};
+  if (texture_pool_memory_type_index_ != UINT32_MAX &&
+      (image_memory_requirements.memoryTypeBits &
+       (uint32_t(1) << texture_pool_memory_type_index_))) {
+    for (size_t i = 0; i < kTexturePoolSizeClassCount; ++i) {
+      if (image_memory_requirements.size <=
+          kTexturePoolSizeClasses[i].max_allocation_size) {
+        allocation_create_info.pool = texture_pools_[i];
+        break;
+      }
+    }
+  }
   VmaAllocation allocation;
-  if (vmaCreateImage(vma_allocator_, &image_create_info,
-                     &allocation_create_info, &image, &allocation, nullptr)) {
+  VkResult allocation_result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+  if (allocation_create_info.pool != VK_NULL_HANDLE) {
+    allocation_result = vmaAllocateMemoryForImage(
+        vma_allocator_, image, &allocation_create_info, &allocation, nullptr);
+  }
+  if (allocation_result != VK_SUCCESS) {
+    // Too large for the pools, or the pool couldn't allocate a new block - use
+    // the default VMA heuristics, preferring device-local memory.
+    allocation_create_info.pool = VK_NULL_HANDLE;
+    allocation_create_info.preferredFlags =
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    allocation_result = vmaAllocateMemoryForImage(
+        vma_allocator_, image, &allocation_create_info, &allocation, nullptr);
+  }
+  if (allocation_result != VK_SUCCESS) {
+    dfn.vkDestroyImage(device, image, nullptr);
+    return nullptr;
+  }
+  if (vmaBindImageMemory(vma_allocator_, allocation, image) != VK_SUCCESS) {
+    vmaFreeMemory(vma_allocator_, allocation);
+    dfn.vkDestroyImage(device, image, nullptr);
     return nullptr;
   }
 
@@ -1074,6 +1162,29 @@ std::unique_ptr<TextureCache::Texture> VulkanTextureCache::CreateTexture(
       new VulkanTexture(*this, key, image, allocation));
 }
 
+bool VulkanTextureCache::GetHostMemoryBudget(uint64_t& budget_out,
+                                             uint64_t& usage_out) const {
+  if (vma_allocator_ == VK_NULL_HANDLE) {
+    return false;
+  }
+  // Only actually for the whole process with VK_EXT_memory_budget, otherwise
+  // estimated by VMA for its own allocations.
+  const VkPhysicalDeviceMemoryProperties* memory_properties;
+  vmaGetMemoryProperties(vma_allocator_, &memory_properties);
+  VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+  vmaGetHeapBudgets(vma_allocator_, budgets);
+  budget_out = 0;
+  usage_out = 0;
+  for (uint32_t i = 0; i < memory_properties->memoryHeapCount; ++i) {
+    if (memory_properties->memoryHeaps[i].flags &
+        VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      budget_out += budgets[i].budget;
+      usage_out += budgets[i].usage;
+    }
+  }
+  return budget_out != 0;
+}
+
 bool VulkanTextureCache::LoadTextureDataFromResidentMemoryImpl(Texture& texture,
                                                                bool load_base,
                                                                bool load_mips) {
@@ -1720,6 +1831,48 @@ bool VulkanTextureCache::Initialize() {
     return false;
   }
 
+  // Texture pools, in the memory type the usual sampled textures would be
+  // allocated from.
+  {
+    VkImageCreateInfo pool_image_create_info = {};
+    pool_image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    pool_image_create_info.imageType = VK_IMAGE_TYPE_2D;
+    pool_image_create_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    pool_image_create_info.extent.width = 256;
+    pool_image_create_info.extent.height = 256;
+    pool_image_create_info.extent.depth = 1;
+    pool_image_create_info.mipLevels = 1;
+    pool_image_create_info.arrayLayers = 1;
+    pool_image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    pool_image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    pool_image_create_info.usage =
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    pool_image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    pool_image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VmaAllocationCreateInfo pool_allocation_create_info = {};
+    pool_allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    if (vmaFindMemoryTypeIndexForImageInfo(
+            vma_allocator_, &pool_image_create_info,
+            &pool_allocation_create_info,
+            &texture_pool_memory_type_index_) == VK_SUCCESS) {
+      for (size_t i = 0; i < kTexturePoolSizeClassCount; ++i) {
+        VmaPoolCreateInfo pool_create_info = {};
+        pool_create_info.memoryTypeIndex = texture_pool_memory_type_index_;
+        pool_create_info.blockSize = kTexturePoolSizeClasses[i].block_size;
+        if (vmaCreatePool(vma_allocator_, &pool_create_info,
+                          &texture_pools_[i]) != VK_SUCCESS) {
+          XELOGW(
+              "VulkanTextureCache: Failed to create the pool for textures up "
+              "to {} KB",
+              kTexturePoolSizeClasses[i].max_allocation_size >> 10);
+          texture_pools_[i] = VK_NULL_HANDLE;
+        }
+      }
+    } else {
+      texture_pool_memory_type_index_ = UINT32_MAX;
+    }
+  }
+
   // Image formats.
 
   // Initialize to the best formats.
@@ -16,6 +16,7 @@
 #include <utility>
 
 #include "xenia/base/hash.h"
+#include "xenia/base/math.h"
 #include "xenia/gpu/texture_cache.h"
 #include "xenia/gpu/vulkan/vulkan_shader.h"
 #include "xenia/gpu/vulkan/vulkan_shared_memory.h"
@@ -83,6 +84,7 @@ class VulkanTextureCache final : public TextureCache {
   ~VulkanTextureCache();
 
   void BeginSubmission(uint64_t new_submission_index) override;
+  void BeginFrame() override;
 
   // Must be called within a frame - creates and untiles textures needed by
   // shaders, and enqueues transitioning them into the sampled usage. This may
@@ -135,6 +137,8 @@ class VulkanTextureCache final : public TextureCache {
 
   bool LoadTextureDataFromResidentMemoryImpl(Texture& texture, bool load_base,
                                              bool load_mips) override;
+  bool GetHostMemoryBudget(uint64_t& budget_out,
+                           uint64_t& usage_out) const override;
 
   void UpdateTextureBindingsImpl(uint32_t fetch_constant_mask) override;
 
@@ -324,6 +328,25 @@ class VulkanTextureCache final : public TextureCache {
   // 4096.
   VmaAllocator vma_allocator_ = VK_NULL_HANDLE;
 
+  // Smaller textures are allocated from pools of their size classes, with
+  // blocks shared by many of them, rather than from the default VMA blocks
+  // sized for the largest resources, or from dedicated allocations, so the
+  // frequently recreated small textures don't fragment the memory of the large
+  // long-lived ones, and the device memory allocation count stays low.
+  struct TexturePoolSizeClass {
+    VkDeviceSize max_allocation_size;
+    VkDeviceSize block_size;
+  };
+  static constexpr TexturePoolSizeClass kTexturePoolSizeClasses[] = {
+      {256 * 1024, 16 * 1024 * 1024},
+      {4 * 1024 * 1024, 64 * 1024 * 1024},
+  };
+  static constexpr size_t kTexturePoolSizeClassCount =
+      xe::countof(kTexturePoolSizeClasses);
+  // Null if failed to create.
+  std::array<VmaPool, kTexturePoolSizeClassCount> texture_pools_ = {};
+  uint32_t texture_pool_memory_type_index_ = UINT32_MAX;
+
   static const HostFormatPair kBestHostFormats[64];
   static const HostFormatPair kHostFormatGBGRUnaligned;
   static const HostFormatPair kHostFormatBGRGUnaligned;
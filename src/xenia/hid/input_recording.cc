@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/hid/input_recording.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/counters.h"
+
+namespace xe {
+namespace hid {
+
+uint64_t GetInputRecordingFrame() {
+  // Incremented by VdSwap.
+  static xe::counters::Counter& frames_counter =
+      xe::counters::GetCounter("kernel/frames");
+  return frames_counter.Read();
+}
+
+std::string FormatInputRecordingEvent(const InputRecordingEvent& event) {
+  const X_INPUT_GAMEPAD& gamepad = event.gamepad;
+  return fmt::format("{} {} {:04X} {} {} {} {} {} {}", event.frame,
+                     event.user_index, uint16_t(gamepad.buttons),
+                     gamepad.left_trigger, gamepad.right_trigger,
+                     int16_t(gamepad.thumb_lx), int16_t(gamepad.thumb_ly),
+                     int16_t(gamepad.thumb_rx), int16_t(gamepad.thumb_ry));
+}
+
+bool ParseInputRecordingEvent(std::string_view line,
+                              InputRecordingEvent& event_out) {
+  size_t first = line.find_first_not_of(" \t\r");
+  if (first == std::string_view::npos || line[first] == '#') {
+    return false;
+  }
+  // Null-terminated for sscanf.
+  std::string line_string(line.substr(first));
+  uint64_t frame;
+  uint32_t user_index, buttons, left_trigger, right_trigger;
+  int32_t thumb_lx, thumb_ly, thumb_rx, thumb_ry;
+  if (std::sscanf(line_string.c_str(),
+                  "%" SCNu64 " %" SCNu32 " %" SCNx32 " %" SCNu32 " %" SCNu32
+                  " %" SCNd32 " %" SCNd32 " %" SCNd32 " %" SCNd32,
+                  &frame, &user_index, &buttons, &left_trigger, &right_trigger,
+                  &thumb_lx, &thumb_ly, &thumb_rx, &thumb_ry) != 9 ||
+      user_index >= XUserMaxUserCount || buttons > UINT16_MAX ||
+      left_trigger > UINT8_MAX || right_trigger > UINT8_MAX) {
+    return false;
+  }
+  auto clamp_thumb = [](int32_t value) {
+    return int16_t(value < INT16_MIN   ? INT16_MIN
+                   : value > INT16_MAX ? INT16_MAX
+                                       : value);
+  };
+  event_out.frame = frame;
+  event_out.user_index = user_index;
+  event_out.gamepad.buttons = uint16_t(buttons);
+  event_out.gamepad.left_trigger = uint8_t(left_trigger);
+  event_out.gamepad.right_trigger = uint8_t(right_trigger);
+  event_out.gamepad.thumb_lx = clamp_thumb(thumb_lx);
+  event_out.gamepad.thumb_ly = clamp_thumb(thumb_ly);
+  event_out.gamepad.thumb_rx = clamp_thumb(thumb_rx);
+  event_out.gamepad.thumb_ry = clamp_thumb(thumb_ry);
+  return true;
+}
+
+}  // namespace hid
+}  // namespace xe
@@ -0,0 +1,51 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_HID_INPUT_RECORDING_H_
+#define XENIA_HID_INPUT_RECORDING_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "xenia/hid/input.h"
+#include "xenia/xbox.h"
+
+namespace xe {
+namespace hid {
+
+// Gamepad states the guest reads, recorded with hid_record_path and replayed
+// by the replay input driver, keyed by the guest frame so a replay is
+// independent from the host speed when the guest time is locked to the
+// vblanks.
+//
+// A recording is a text file, a line per state change:
+//   <frame> <user index> <buttons in hex> <left trigger> <right trigger>
+//   <thumb lx> <thumb ly> <thumb rx> <thumb ry>
+// with the state applying from the frame until the next line of the user.
+// Empty lines and lines starting with # are ignored.
+struct InputRecordingEvent {
+  uint64_t frame;
+  uint32_t user_index;
+  X_INPUT_GAMEPAD gamepad;
+};
+
+// Number of guest frames ended so far, the frame the input is attributed to.
+uint64_t GetInputRecordingFrame();
+
+// Without the line break.
+std::string FormatInputRecordingEvent(const InputRecordingEvent& event);
+// False for ignored and malformed lines.
+bool ParseInputRecordingEvent(std::string_view line,
+                              InputRecordingEvent& event_out);
+
+}  // namespace hid
+}  // namespace xe
+
+#endif  // XENIA_HID_INPUT_RECORDING_H_
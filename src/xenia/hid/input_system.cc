@@ -11,9 +11,16 @@
 
 #include "xenia/hid/input_system.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "xenia/base/filesystem.h"
 #include "xenia/base/profiling.h"
+#include "xenia/base/threading.h"
 #include "xenia/hid/hid_flags.h"
 #include "xenia/hid/input_driver.h"
+#include "xenia/hid/input_recording.h"
 #include "xenia/kernel/util/shim_utils.h"
 
 namespace xe {
@@ -28,11 +35,81 @@ DEFINE_double(
     right_stick_deadzone_percentage, 0.0,
     "Defines deadzone level for right stick. Allowed range [0.0-1.0].", "HID");
 
+DEFINE_uint32(input_poll_rate, 0,
+              "Rate in Hz at which a thread samples the controllers for the "
+              "guest, which then reads the latest state without querying the "
+              "drivers on every call. 0 to query them on every call.",
+              "HID");
+
+DEFINE_path(hid_record_path, "",
+            "File to record the gamepad states read by the guest to, with the "
+            "guest frames they change at, for replaying them with the replay "
+            "input system. Empty to not record.",
+            "HID");
+
 InputSystem::InputSystem(xe::ui::Window* window) : window_(window) {}
 
-InputSystem::~InputSystem() = default;
+InputSystem::~InputSystem() {
+  if (poll_thread_.joinable()) {
+    polling_ = false;
+    poll_thread_.join();
+  }
+  if (record_file_) {
+    fclose(record_file_);
+  }
+}
 
-X_STATUS InputSystem::Setup() { return X_STATUS_SUCCESS; }
+X_STATUS InputSystem::Setup() {
+  if (!cvars::hid_record_path.empty()) {
+    record_file_ = xe::filesystem::OpenFile(cvars::hid_record_path, "wb");
+    if (record_file_) {
+      fputs(
+          "# frame user buttons left_trigger right_trigger thumb_lx thumb_ly "
+          "thumb_rx thumb_ry\n",
+          record_file_);
+    } else {
+      XELOGE("Failed to open {} for recording the input",
+             cvars::hid_record_path);
+    }
+  }
+  if (cvars::input_poll_rate) {
+    polling_ = true;
+    poll_thread_ = std::thread(&InputSystem::PollThread, this,
+                               std::min(cvars::input_poll_rate, 8000u));
+  }
+  return X_STATUS_SUCCESS;
+}
+
+void InputSystem::PollThread(uint32_t rate) {
+  xe::threading::set_name("Input Polling");
+  const auto interval = std::chrono::microseconds(1000000 / rate);
+  while (polling_) {
+    for (uint32_t user_index = 0; user_index < XUserMaxUserCount;
+         ++user_index) {
+      X_INPUT_STATE state = {};
+      X_RESULT result;
+      {
+        auto input_lock = lock();
+        result = GetState(user_index, X_INPUT_FLAG::X_INPUT_FLAG_GAMEPAD,
+                          &state);
+      }
+      uint32_t state_words[PolledState::kStateWordCount];
+      std::memcpy(state_words, &state, sizeof(state));
+
+      PolledState& polled_state = polled_states_[user_index];
+      uint32_t sequence = polled_state.sequence.load(std::memory_order_relaxed);
+      polled_state.sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      polled_state.result.store(result, std::memory_order_relaxed);
+      for (size_t i = 0; i < PolledState::kStateWordCount; ++i) {
+        polled_state.state_words[i].store(state_words[i],
+                                          std::memory_order_relaxed);
+      }
+      polled_state.sequence.store(sequence + 2, std::memory_order_release);
+    }
+    xe::threading::Sleep(interval);
+  }
+}
 
 void InputSystem::AddDriver(std::unique_ptr<InputDriver> driver) {
   drivers_.push_back(std::move(driver));
@@ -119,6 +196,9 @@ X_RESULT InputSystem::GetState(uint32_t user_index, uint32_t flags,
       if (out_state->gamepad.buttons != 0) {
         last_used_slot = user_index;
       }
+      if (record_file_) {
+        RecordGamepad(user_index, out_state->gamepad);
+      }
       return result;
     }
   }
@@ -126,6 +206,64 @@ X_RESULT InputSystem::GetState(uint32_t user_index, uint32_t flags,
   return X_ERROR_DEVICE_NOT_CONNECTED;
 }
 
+void InputSystem::RecordGamepad(uint32_t user_index,
+                                const X_INPUT_GAMEPAD& gamepad) {
+  if (user_index >= XUserMaxUserCount) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(record_mutex_);
+  if (recorded_users_.test(user_index) &&
+      !std::memcmp(&recorded_gamepads_[user_index], &gamepad,
+                   sizeof(gamepad))) {
+    return;
+  }
+  recorded_users_.set(user_index);
+  recorded_gamepads_[user_index] = gamepad;
+  InputRecordingEvent event;
+  event.frame = GetInputRecordingFrame();
+  event.user_index = user_index;
+  event.gamepad = gamepad;
+  std::string line = FormatInputRecordingEvent(event);
+  line.push_back('\n');
+  fwrite(line.data(), 1, line.size(), record_file_);
+  fflush(record_file_);
+}
+
+X_RESULT InputSystem::GetPolledState(uint32_t user_index, uint32_t flags,
+                                     X_INPUT_STATE* out_state) {
+  if (polling_ && flags == X_INPUT_FLAG::X_INPUT_FLAG_GAMEPAD &&
+      user_index < XUserMaxUserCount) {
+    const PolledState& polled_state = polled_states_[user_index];
+    uint32_t state_words[PolledState::kStateWordCount];
+    X_RESULT result = X_ERROR_DEVICE_NOT_CONNECTED;
+    uint32_t sequence;
+    do {
+      sequence = polled_state.sequence.load(std::memory_order_acquire);
+      if (!sequence) {
+        break;
+      }
+      if (sequence & 1) {
+        continue;
+      }
+      result = polled_state.result.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < PolledState::kStateWordCount; ++i) {
+        state_words[i] =
+            polled_state.state_words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || polled_state.sequence.load(
+                                   std::memory_order_relaxed) != sequence);
+    if (sequence) {
+      if (out_state) {
+        std::memcpy(out_state, state_words, sizeof(*out_state));
+      }
+      return result;
+    }
+  }
+  auto input_lock = lock();
+  return GetState(user_index, flags, out_state);
+}
+
 X_RESULT InputSystem::SetState(uint32_t user_index,
                                X_INPUT_VIBRATION* vibration) {
   SCOPE_profile_cpu_f("hid");
@@ -10,8 +10,13 @@
 #ifndef XENIA_HID_INPUT_SYSTEM_H_
 #define XENIA_HID_INPUT_SYSTEM_H_
 
+#include <array>
+#include <atomic>
 #include <bitset>
+#include <cstdio>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include "xenia/base/mutex.h"
 #include "xenia/hid/input.h"
@@ -42,6 +47,10 @@ class InputSystem {
                            X_INPUT_CAPABILITIES* out_caps);
   X_RESULT GetState(uint32_t user_index, uint32_t flags,
                     X_INPUT_STATE* out_state);
+  // For the guest, without locking, returns the latest gamepad state sampled by
+  // the polling thread if it's enabled, otherwise GetState under the lock.
+  X_RESULT GetPolledState(uint32_t user_index, uint32_t flags,
+                          X_INPUT_STATE* out_state);
   X_RESULT SetState(uint32_t user_index, X_INPUT_VIBRATION* vibration);
   X_RESULT GetKeystroke(uint32_t user_index, uint32_t flags,
                         X_INPUT_KEYSTROKE* out_keystroke);
@@ -60,12 +69,27 @@ class InputSystem {
  private:
   typedef std::pair<uint16_t, uint16_t> joystick_value;
 
+  // The state of a slot written by the polling thread, read by any thread.
+  // The sequence is odd while the state is being written, and zero before it
+  // has been sampled.
+  struct PolledState {
+    static constexpr size_t kStateWordCount = sizeof(X_INPUT_STATE) / 4;
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint32_t> result{0};
+    std::array<std::atomic<uint32_t>, kStateWordCount> state_words{};
+  };
+  static_assert(sizeof(X_INPUT_STATE) % 4 == 0);
+
+  void PollThread(uint32_t rate);
+
   const std::string controller_slot_state_change_message[2] = {
       "Controller disconnected from slot {}.",
       "New controller connected to slot {}."};
 
   void UpdateUsedSlot(InputDriver* driver, uint8_t slot, bool connected);
   void AdjustDeadzoneLevels(const uint8_t slot, X_INPUT_GAMEPAD* gamepad);
+  // Appends the state to the hid_record_path file if it has changed.
+  void RecordGamepad(uint32_t user_index, const X_INPUT_GAMEPAD& gamepad);
   X_INPUT_VIBRATION ModifyVibrationLevel(X_INPUT_VIBRATION* vibration);
 
   std::vector<InputDriver*> FilterDrivers(uint32_t flags);
@@ -80,6 +104,15 @@ class InputSystem {
   uint32_t last_used_slot = 0;
 
   xe_unlikely_mutex lock_;
+
+  std::array<PolledState, XUserMaxUserCount> polled_states_;
+  std::atomic<bool> polling_{false};
+  std::thread poll_thread_;
+
+  FILE* record_file_ = nullptr;
+  std::mutex record_mutex_;
+  std::bitset<XUserMaxUserCount> recorded_users_;
+  std::array<X_INPUT_GAMEPAD, XUserMaxUserCount> recorded_gamepads_;
 };
 
 }  // namespace hid
@@ -0,0 +1,15 @@
+project_root = "../../../.."
+include(project_root.."/tools/build")
+
+group("src")
+project("xenia-hid-replay")
+  uuid("5c2f0a3e-8d6b-4f1e-9a47-2b1c8e6d3f90")
+  kind("StaticLib")
+  language("C++")
+  links({
+    "xenia-base",
+    "xenia-hid",
+  })
+  defines({
+  })
+  local_platform_files()
@@ -0,0 +1,25 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/hid/replay/replay_hid.h"
+
+#include "xenia/hid/replay/replay_input_driver.h"
+
+namespace xe {
+namespace hid {
+namespace replay {
+
+std::unique_ptr<InputDriver> Create(xe::ui::Window* window,
+                                    size_t window_z_order) {
+  return std::make_unique<ReplayInputDriver>(window, window_z_order);
+}
+
+}  // namespace replay
+}  // namespace hid
+}  // namespace xe
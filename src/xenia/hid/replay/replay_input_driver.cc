@@ -0,0 +1,147 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/hid/replay/replay_input_driver.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/hid/hid_flags.h"
+
+DEFINE_path(hid_replay_path, "",
+            "Input recording (written with hid_record_path) for the replay "
+            "input system to play back.",
+            "HID");
+
+namespace xe {
+namespace hid {
+namespace replay {
+
+ReplayInputDriver::ReplayInputDriver(xe::ui::Window* window,
+                                     size_t window_z_order)
+    : InputDriver(window, window_z_order) {}
+
+ReplayInputDriver::~ReplayInputDriver() = default;
+
+X_STATUS ReplayInputDriver::Setup() {
+  if (cvars::hid_replay_path.empty()) {
+    return X_STATUS_UNSUCCESSFUL;
+  }
+  FILE* file = xe::filesystem::OpenFile(cvars::hid_replay_path, "rb");
+  if (!file) {
+    XELOGE("Failed to open the input recording {}", cvars::hid_replay_path);
+    return X_STATUS_UNSUCCESSFUL;
+  }
+  char line[256];
+  uint32_t line_number = 0;
+  size_t event_count = 0;
+  while (std::fgets(line, sizeof(line), file)) {
+    ++line_number;
+    InputRecordingEvent event;
+    if (!ParseInputRecordingEvent(line, event)) {
+      const char* first = line + std::strspn(line, " \t\r\n");
+      if (*first && *first != '#') {
+        XELOGW("Ignoring malformed line {} of the input recording {}",
+               line_number, cvars::hid_replay_path);
+      }
+      continue;
+    }
+    events_[event.user_index].push_back(event);
+    ++event_count;
+  }
+  std::fclose(file);
+  for (std::vector<InputRecordingEvent>& user_events : events_) {
+    // Stable so the last of the states of the same frame is used.
+    std::stable_sort(user_events.begin(), user_events.end(),
+                     [](const InputRecordingEvent& a,
+                        const InputRecordingEvent& b) {
+                       return a.frame < b.frame;
+                     });
+  }
+  XELOGI("Replaying {} gamepad states from {}", event_count,
+         cvars::hid_replay_path);
+  return X_STATUS_SUCCESS;
+}
+
+X_RESULT ReplayInputDriver::GetCapabilities(uint32_t user_index,
+                                            uint32_t flags,
+                                            X_INPUT_CAPABILITIES* out_caps) {
+  if (user_index >= XUserMaxUserCount || events_[user_index].empty()) {
+    return X_ERROR_DEVICE_NOT_CONNECTED;
+  }
+  if (out_caps) {
+    std::memset(out_caps, 0, sizeof(*out_caps));
+    out_caps->type = XINPUT_DEVTYPE_GAMEPAD;
+    out_caps->sub_type = XINPUT_DEVSUBTYPE_GAMEPAD;
+    out_caps->gamepad.buttons =
+        0xF3FF | (cvars::guide_button ? X_INPUT_GAMEPAD_GUIDE : 0x0);
+    out_caps->gamepad.left_trigger = 0xFF;
+    out_caps->gamepad.right_trigger = 0xFF;
+    out_caps->gamepad.thumb_lx = static_cast<int16_t>(0xFFFFu);
+    out_caps->gamepad.thumb_ly = static_cast<int16_t>(0xFFFFu);
+    out_caps->gamepad.thumb_rx = static_cast<int16_t>(0xFFFFu);
+    out_caps->gamepad.thumb_ry = static_cast<int16_t>(0xFFFFu);
+  }
+  return X_ERROR_SUCCESS;
+}
+
+X_RESULT ReplayInputDriver::GetState(uint32_t user_index,
+                                     X_INPUT_STATE* out_state) {
+  if (user_index >= XUserMaxUserCount || events_[user_index].empty()) {
+    return X_ERROR_DEVICE_NOT_CONNECTED;
+  }
+  if (!out_state) {
+    return X_ERROR_SUCCESS;
+  }
+  const std::vector<InputRecordingEvent>& user_events = events_[user_index];
+  uint64_t frame = GetInputRecordingFrame();
+  auto next_it = std::upper_bound(
+      user_events.begin(), user_events.end(), frame,
+      [](uint64_t frame, const InputRecordingEvent& event) {
+        return frame < event.frame;
+      });
+  // Changes whenever the state does, like the packet number of a controller.
+  out_state->packet_number = uint32_t(next_it - user_events.begin());
+  if (next_it == user_events.begin()) {
+    std::memset(&out_state->gamepad, 0, sizeof(out_state->gamepad));
+  } else {
+    out_state->gamepad = std::prev(next_it)->gamepad;
+  }
+  return X_ERROR_SUCCESS;
+}
+
+X_RESULT ReplayInputDriver::SetState(uint32_t user_index,
+                                     X_INPUT_VIBRATION* vibration) {
+  if (user_index >= XUserMaxUserCount || events_[user_index].empty()) {
+    return X_ERROR_DEVICE_NOT_CONNECTED;
+  }
+  return X_ERROR_SUCCESS;
+}
+
+X_RESULT ReplayInputDriver::GetKeystroke(uint32_t user_index, uint32_t flags,
+                                         X_INPUT_KEYSTROKE* out_keystroke) {
+  if (user_index >= XUserMaxUserCount || events_[user_index].empty()) {
+    return X_ERROR_DEVICE_NOT_CONNECTED;
+  }
+  // Only the states are recorded.
+  return X_ERROR_EMPTY;
+}
+
+InputType ReplayInputDriver::GetInputType() const {
+  return InputType::Controller;
+}
+
+}  // namespace replay
+}  // namespace hid
+}  // namespace xe
@@ -0,0 +1,51 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_HID_REPLAY_REPLAY_INPUT_DRIVER_H_
+#define XENIA_HID_REPLAY_REPLAY_INPUT_DRIVER_H_
+
+#include <array>
+#include <vector>
+
+#include "xenia/hid/input_driver.h"
+#include "xenia/hid/input_recording.h"
+
+namespace xe {
+namespace hid {
+namespace replay {
+
+// Plays back the gamepad states of an input recording (see
+// input_recording.h) from hid_replay_path, by the guest frame, for scripted
+// runs such as benchmarks. Only the users present in the recording are
+// connected.
+class ReplayInputDriver final : public InputDriver {
+ public:
+  explicit ReplayInputDriver(xe::ui::Window* window, size_t window_z_order);
+  ~ReplayInputDriver() override;
+
+  X_STATUS Setup() override;
+
+  X_RESULT GetCapabilities(uint32_t user_index, uint32_t flags,
+                           X_INPUT_CAPABILITIES* out_caps) override;
+  X_RESULT GetState(uint32_t user_index, X_INPUT_STATE* out_state) override;
+  X_RESULT SetState(uint32_t user_index, X_INPUT_VIBRATION* vibration) override;
+  X_RESULT GetKeystroke(uint32_t user_index, uint32_t flags,
+                        X_INPUT_KEYSTROKE* out_keystroke) override;
+  InputType GetInputType() const override;
+
+ private:
+  // Sorted by the frame, immutable after Setup.
+  std::array<std::vector<InputRecordingEvent>, XUserMaxUserCount> events_;
+};
+
+}  // namespace replay
+}  // namespace hid
+}  // namespace xe
+
+#endif  // XENIA_HID_REPLAY_REPLAY_INPUT_DRIVER_H_
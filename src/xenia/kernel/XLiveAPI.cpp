@@ -56,6 +56,12 @@ DEFINE_bool(xstorage_user_data_backend, false,
             "if enabled and available.",
             "Live");
 
+DEFINE_uint32(api_cache_ttl, 2000,
+              "Milliseconds responses of session searches, QoS and player "
+              "lookups are reused for, and refreshed in the background for as "
+              "long again. 0 disables the reuse.",
+              "Live");
+
 DECLARE_string(upnp_root);
 
 DECLARE_bool(upnp);
@@ -312,7 +318,16 @@ std::string XLiveAPI::GetApiAddress() {
 }
 
 // If online NAT open, otherwise strict.
-uint32_t XLiveAPI::GetNatType() { return IsConnectedToServer() ? 1 : 3; }
+uint32_t XLiveAPI::GetNatType() {
+  if (!IsConnectedToServer()) {
+    return 3;
+  }
+  // Moderate once the UPnP search has failed, the ports can't be mapped.
+  if (upnp_handler && upnp_handler->status() == UPnP::Status::kUnavailable) {
+    return 2;
+  }
+  return 1;
+}
 
 bool XLiveAPI::IsConnectedToServer() { return OnlineIP().sin_addr.s_addr != 0; }
 
@@ -398,6 +413,82 @@ void XLiveAPI::Init() {
   DeleteAllSessions();
 }
 
+void XLiveAPI::Shutdown() {
+  std::lock_guard<std::mutex> lock(curl_handle_pool_mutex_);
+  for (CURL* curl_handle : curl_handle_pool_) {
+    curl_easy_cleanup(curl_handle);
+  }
+  curl_handle_pool_.clear();
+  if (curl_share_) {
+    curl_share_cleanup(curl_share_);
+    curl_share_ = nullptr;
+  }
+}
+
+CURL* XLiveAPI::AcquireCurlHandle() {
+  CURL* curl_handle = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(curl_handle_pool_mutex_);
+    if (!curl_share_) {
+      curl_share_ = curl_share_init();
+      if (curl_share_) {
+        curl_share_setopt(curl_share_, CURLSHOPT_LOCKFUNC, LockCurlShare);
+        curl_share_setopt(curl_share_, CURLSHOPT_UNLOCKFUNC, UnlockCurlShare);
+        curl_share_setopt(curl_share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(curl_share_, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(curl_share_, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_CONNECT);
+      }
+    }
+    if (!curl_handle_pool_.empty()) {
+      curl_handle = curl_handle_pool_.back();
+      curl_handle_pool_.pop_back();
+    }
+  }
+  if (curl_handle) {
+    // Keeps the connections and the caches.
+    curl_easy_reset(curl_handle);
+  } else {
+    curl_handle = curl_easy_init();
+    if (!curl_handle) {
+      return nullptr;
+    }
+  }
+  if (curl_share_) {
+    curl_easy_setopt(curl_handle, CURLOPT_SHARE, curl_share_);
+  }
+  curl_easy_setopt(curl_handle, CURLOPT_TCP_KEEPALIVE, 1L);
+  // Multiple requests over one connection where the server supports it.
+  curl_easy_setopt(curl_handle, CURLOPT_HTTP_VERSION,
+                   long(CURL_HTTP_VERSION_2TLS));
+  return curl_handle;
+}
+
+void XLiveAPI::ReleaseCurlHandle(CURL* curl_handle) {
+  if (!curl_handle) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(curl_handle_pool_mutex_);
+    if (curl_handle_pool_.size() < kMaxPooledCurlHandles) {
+      curl_handle_pool_.push_back(curl_handle);
+      return;
+    }
+  }
+  curl_easy_cleanup(curl_handle);
+}
+
+void XLiveAPI::LockCurlShare(CURL* curl_handle, curl_lock_data data,
+                             curl_lock_access access, void* userptr) {
+  curl_share_mutexes_[data].lock();
+}
+
+void XLiveAPI::UnlockCurlShare(CURL* curl_handle, curl_lock_data data,
+                               void* userptr) {
+  curl_share_mutexes_[data].unlock();
+}
+
 void XLiveAPI::clearXnaddrCache() {
   sessionIdCache.clear();
   macAddressCache.clear();
@@ -407,7 +498,6 @@ void XLiveAPI::clearXnaddrCache() {
 std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Get(std::string endpoint,
                                                       const uint32_t timeout) {
   response_data chunk = {};
-  CURL* curl_handle = curl_easy_init();
   CURLcode result;
 
   if (GetInitState() == InitState::Failed) {
@@ -415,6 +505,7 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Get(std::string endpoint,
     return PraseResponse(chunk);
   }
 
+  CURL* curl_handle = AcquireCurlHandle();
   if (!curl_handle) {
     XELOGE("XLiveAPI::Get: Cannot initialize CURL");
     return PraseResponse(chunk);
@@ -435,6 +526,7 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Get(std::string endpoint,
   headers = curl_slist_append(headers, "charset: utf-8");
 
   if (headers == NULL) {
+    ReleaseCurlHandle(curl_handle);
     return PraseResponse(chunk);
   }
 
@@ -453,13 +545,15 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Get(std::string endpoint,
 
   if (result != CURLE_OK) {
     XELOGE("XLiveAPI::Get: CURL Error Code: {}", static_cast<uint32_t>(result));
+    ReleaseCurlHandle(curl_handle);
+    curl_slist_free_all(headers);
     return PraseResponse(chunk);
   }
 
   result =
       curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &chunk.http_code);
 
-  curl_easy_cleanup(curl_handle);
+  ReleaseCurlHandle(curl_handle);
   curl_slist_free_all(headers);
 
   if (result == CURLE_OK &&
@@ -477,7 +571,6 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Post(std::string endpoint,
                                                        const uint8_t* data,
                                                        size_t data_size) {
   response_data chunk = {};
-  CURL* curl_handle = curl_easy_init();
   CURLcode result;
 
   if (GetInitState() == InitState::Failed) {
@@ -485,6 +578,7 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Post(std::string endpoint,
     return PraseResponse(chunk);
   }
 
+  CURL* curl_handle = AcquireCurlHandle();
   if (!curl_handle) {
     XELOGE("XLiveAPI::Post: Cannot initialize CURL");
     return PraseResponse(chunk);
@@ -515,6 +609,7 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Post(std::string endpoint,
     headers = curl_slist_append(headers, "charset: utf-8");
 
     if (headers == NULL) {
+      ReleaseCurlHandle(curl_handle);
       return PraseResponse(chunk);
     }
 
@@ -530,13 +625,15 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Post(std::string endpoint,
   if (result != CURLE_OK) {
     XELOGE("XLiveAPI::Post: CURL Error Code: {}",
            static_cast<uint32_t>(result));
+    ReleaseCurlHandle(curl_handle);
+    curl_slist_free_all(headers);
     return PraseResponse(chunk);
   }
 
   result =
       curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &chunk.http_code);
 
-  curl_easy_cleanup(curl_handle);
+  ReleaseCurlHandle(curl_handle);
   curl_slist_free_all(headers);
 
   if (CURLE_OK == result && chunk.http_code == HTTP_STATUS_CODE::HTTP_CREATED) {
@@ -547,10 +644,33 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Post(std::string endpoint,
   return PraseResponse(chunk);
 }
 
+void XLiveAPI::InvalidateSessionSearches() {
+  response_cache_.Invalidate(
+      fmt::format("title/{:08X}/sessions/search", kernel_state()->title_id()));
+}
+
+std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::CachedGet(
+    std::string endpoint) {
+  response_data chunk = response_cache_.Fetch(
+      endpoint, std::chrono::milliseconds(cvars::api_cache_ttl),
+      [endpoint]() { return Get(endpoint)->RawResponse(); });
+  return PraseResponse(chunk);
+}
+
+std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::CachedPost(
+    std::string endpoint, std::string data) {
+  response_data chunk = response_cache_.Fetch(
+      fmt::format("{}\n{}", endpoint, data),
+      std::chrono::milliseconds(cvars::api_cache_ttl), [endpoint, data]() {
+        return Post(endpoint, reinterpret_cast<const uint8_t*>(data.c_str()))
+            ->RawResponse();
+      });
+  return PraseResponse(chunk);
+}
+
 // Delete data from the server
 std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Delete(std::string endpoint) {
   response_data chunk = {};
-  CURL* curl_handle = curl_easy_init();
   CURLcode result;
 
   if (GetInitState() == InitState::Failed) {
@@ -558,6 +678,7 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Delete(std::string endpoint) {
     return PraseResponse(chunk);
   }
 
+  CURL* curl_handle = AcquireCurlHandle();
   if (!curl_handle) {
     XELOGE("XLiveAPI::Delete: Cannot initialize CURL");
     return PraseResponse(chunk);
@@ -581,13 +702,15 @@ std::unique_ptr<HTTPResponseObjectJSON> XLiveAPI::Delete(std::string endpoint) {
   if (result != CURLE_OK) {
     XELOGE("XLiveAPI::Delete: CURL Error Code: {}",
            static_cast<uint32_t>(result));
+    ReleaseCurlHandle(curl_handle);
+    curl_slist_free_all(headers);
     return PraseResponse(chunk);
   }
 
   result =
       curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &chunk.http_code);
 
-  curl_easy_cleanup(curl_handle);
+  ReleaseCurlHandle(curl_handle);
   curl_slist_free_all(headers);
 
   if (result == CURLE_OK && chunk.http_code == HTTP_STATUS_CODE::HTTP_OK) {
@@ -748,7 +871,7 @@ std::unique_ptr<PlayerObjectJSON> XLiveAPI::FindPlayer(std::string ip) {
 
   // POST & receive.
   std::unique_ptr<HTTPResponseObjectJSON> response =
-      Post("players/find", (uint8_t*)buffer.GetString());
+      CachedPost("players/find", buffer.GetString());
 
   if (response->StatusCode() != HTTP_STATUS_CODE::HTTP_CREATED) {
     XELOGE("FindPlayers error message: {}", response->Message());
@@ -784,6 +907,9 @@ void XLiveAPI::QoSPost(uint64_t sessionId, uint8_t* qosData, size_t qosLength) {
   std::unique_ptr<HTTPResponseObjectJSON> response =
       Post(endpoint, qosData, qosLength);
 
+  // Our own QoS data is seen at once.
+  response_cache_.Invalidate(endpoint);
+
   if (response->StatusCode() != HTTP_STATUS_CODE::HTTP_CREATED) {
     assert_always();
     return;
@@ -797,7 +923,7 @@ response_data XLiveAPI::QoSGet(uint64_t sessionId) {
   std::string endpoint = fmt::format("title/{:08X}/sessions/{:016x}/qos",
                                      kernel_state()->title_id(), sessionId);
 
-  std::unique_ptr<HTTPResponseObjectJSON> response = Get(endpoint);
+  std::unique_ptr<HTTPResponseObjectJSON> response = CachedGet(endpoint);
 
   if (response->StatusCode() != HTTP_STATUS_CODE::HTTP_OK &&
       response->StatusCode() != HTTP_STATUS_CODE::HTTP_NO_CONTENT) {
@@ -830,6 +956,8 @@ void XLiveAPI::SessionModify(uint64_t sessionId, XSessionModify* data) {
   std::unique_ptr<HTTPResponseObjectJSON> response =
       Post(endpoint, (uint8_t*)buffer.GetString());
 
+  InvalidateSessionSearches();
+
   if (response->StatusCode() != HTTP_STATUS_CODE::HTTP_CREATED) {
     XELOGE("Modify error message: {}", response->Message());
     assert_always();
@@ -857,7 +985,7 @@ const std::vector<std::unique_ptr<SessionObjectJSON>> XLiveAPI::SessionSearch(
   doc.Accept(writer);
 
   std::unique_ptr<HTTPResponseObjectJSON> response =
-      Post(endpoint, (uint8_t*)buffer.GetString());
+      CachedPost(endpoint, buffer.GetString());
 
   std::vector<std::unique_ptr<SessionObjectJSON>> sessions;
 
@@ -1052,6 +1180,8 @@ void XLiveAPI::DeleteSession(uint64_t sessionId) {
 
   clearXnaddrCache();
   qos_payload_cache.erase(sessionId);
+  response_cache_.Invalidate(fmt::format("{}/qos", endpoint));
+  InvalidateSessionSearches();
 }
 
 void XLiveAPI::DeleteAllSessionsByMac() {
@@ -1064,6 +1194,8 @@ void XLiveAPI::DeleteAllSessionsByMac() {
 
   std::unique_ptr<HTTPResponseObjectJSON> response = Delete(endpoint);
 
+  response_cache_.Clear();
+
   if (response->StatusCode() != HTTP_STATUS_CODE::HTTP_OK) {
     XELOGE("Failed to delete all sessions");
   }
@@ -1074,6 +1206,8 @@ void XLiveAPI::DeleteAllSessions() {
 
   std::unique_ptr<HTTPResponseObjectJSON> response = Delete(endpoint);
 
+  response_cache_.Clear();
+
   if (response->StatusCode() != HTTP_STATUS_CODE::HTTP_OK) {
     XELOGE("Failed to delete all sessions");
   }
@@ -1127,6 +1261,8 @@ void XLiveAPI::XSessionCreate(uint64_t sessionId, XSessionData* data) {
   std::unique_ptr<HTTPResponseObjectJSON> response =
       Post(endpoint, (uint8_t*)session_output.c_str());
 
+  InvalidateSessionSearches();
+
   if (response->StatusCode() != HTTP_STATUS_CODE::HTTP_CREATED) {
     XELOGE("XSessionCreate error message: {}", response->Message());
     assert_always();
@@ -1323,6 +1459,8 @@ void XLiveAPI::SessionJoinRemote(uint64_t sessionId,
   std::unique_ptr<HTTPResponseObjectJSON> response =
       Post(endpoint, (uint8_t*)buffer.GetString());
 
+  InvalidateSessionSearches();
+
   if (response->StatusCode() != HTTP_STATUS_CODE::HTTP_CREATED) {
     XELOGE("SessionJoinRemote error message: {}", response->Message());
     assert_always();
@@ -1357,6 +1495,8 @@ void XLiveAPI::SessionLeaveRemote(uint64_t sessionId,
   std::unique_ptr<HTTPResponseObjectJSON> response =
       Post(endpoint, (uint8_t*)buffer.GetString());
 
+  InvalidateSessionSearches();
+
   if (response->StatusCode() != HTTP_STATUS_CODE::HTTP_CREATED) {
     XELOGE("SessionLeaveRemote error message: {}", response->Message());
     assert_always();
@@ -10,13 +10,16 @@
 #ifndef XENIA_KERNEL_XLIVEAPI_H_
 #define XENIA_KERNEL_XLIVEAPI_H_
 
+#include <mutex>
 #include <unordered_set>
+#include <vector>
 
 #include <third_party/libcurl/include/curl/curl.h>
 
 #include "xenia/base/byte_order.h"
 #include "xenia/kernel/upnp.h"
 #include "xenia/kernel/util/net_utils.h"
+#include "xenia/kernel/util/response_cache.h"
 #include "xenia/kernel/xnet.h"
 
 #include "xenia/kernel/json/arbitration_object_json.h"
@@ -76,6 +79,8 @@ class XLiveAPI {
   static int8_t GetVersionStatus();
 
   static void Init();
+  // Closes the connections kept alive for the requests.
+  static void Shutdown();
 
   static void clearXnaddrCache();
 
@@ -226,6 +231,26 @@ class XLiveAPI {
 
   static std::unique_ptr<HTTPResponseObjectJSON> Delete(std::string endpoint);
 
+  // For the queries titles repeat, the response is reused from the recent
+  // identical queries, see ResponseCache.
+  static std::unique_ptr<HTTPResponseObjectJSON> CachedGet(
+      std::string endpoint);
+  static std::unique_ptr<HTTPResponseObjectJSON> CachedPost(
+      std::string endpoint, std::string data);
+  // After a change to the sessions made by this client.
+  static void InvalidateSessionSearches();
+
+  // Handles are reused between the requests instead of creating one for each,
+  // with the connections (kept alive), DNS lookups and TLS sessions shared
+  // between them, so requests to the server mostly don't need a new
+  // connection and TLS handshake.
+  static CURL* AcquireCurlHandle();
+  static void ReleaseCurlHandle(CURL* curl_handle);
+  static void LockCurlShare(CURL* curl_handle, curl_lock_data data,
+                            curl_lock_access access, void* userptr);
+  static void UnlockCurlShare(CURL* curl_handle, curl_lock_data data,
+                              void* userptr);
+
   // https://curl.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
   static size_t callback(void* data, size_t size, size_t nmemb, void* clientp) {
     size_t realsize = size * nmemb;
@@ -242,6 +267,15 @@ class XLiveAPI {
     return realsize;
   };
 
+  // Idle handles kept beyond this are closed.
+  static constexpr size_t kMaxPooledCurlHandles = 8;
+  inline static std::mutex curl_handle_pool_mutex_;
+  inline static std::vector<CURL*> curl_handle_pool_{};
+  inline static CURLSH* curl_share_ = nullptr;
+  inline static std::mutex curl_share_mutexes_[CURL_LOCK_DATA_LAST];
+
+  inline static ResponseCache response_cache_;
+
   inline static sockaddr_in online_ip_{};
 
   inline static sockaddr_in local_ip_{};
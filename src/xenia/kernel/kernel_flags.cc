@@ -14,3 +14,11 @@ DEFINE_bool(headless, false,
             "UI");
 DEFINE_bool(log_high_frequency_kernel_calls, false,
             "Log kernel calls with the kHighFrequency tag.", "Kernel");
+DEFINE_bool(kernel_export_stats, false,
+            "Gather the call counts and the host latencies of the kernel "
+            "exports, shown in the display config dialog.",
+            "Kernel");
+DEFINE_bool(kernel_allocation_stats, false,
+            "Attribute the guest memory allocated through the kernel to the "
+            "guest call sites, shown in the display config dialog.",
+            "Kernel");
@@ -13,5 +13,7 @@
 
 DECLARE_bool(headless);
 DECLARE_bool(log_high_frequency_kernel_calls);
+DECLARE_bool(kernel_export_stats);
+DECLARE_bool(kernel_allocation_stats);
 
 #endif  // XENIA_KERNEL_KERNEL_FLAGS_H_
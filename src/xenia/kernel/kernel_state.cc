@@ -14,6 +14,7 @@
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_stream.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/string.h"
 #include "xenia/cpu/processor.h"
@@ -41,6 +42,18 @@ DEFINE_bool(apply_title_update, true, "Apply title updates.", "Kernel");
 DEFINE_uint32(kernel_build_version, 1888, "Define current kernel version",
               "Kernel");
 
+DEFINE_uint32(async_io_threads, 4,
+              "Number of host threads completing asynchronous guest file "
+              "reads and writes, so the calling guest threads don't wait for "
+              "the host disk. 0 to complete all file requests synchronously.",
+              "Kernel");
+
+DEFINE_uint32(guest_thread_memory_pool_size, 32,
+              "Number of exited guest threads to keep the stack, TLS and PCR "
+              "memory of, for reusing it for new threads instead of allocating "
+              "it again. 0 to always allocate it.",
+              "Kernel");
+
 DECLARE_string(cl);
 
 DECLARE_int32(network_mode);
@@ -48,6 +61,11 @@ DECLARE_int32(network_mode);
 namespace xe {
 namespace kernel {
 
+static xe::counters::Counter& threads_created_counter =
+    xe::counters::GetCounter("kernel/threads_created");
+static xe::counters::Gauge& threads_gauge =
+    xe::counters::GetGauge("kernel/threads");
+
 constexpr uint32_t kDeferredOverlappedDelayMillis = 100;
 
 // This is a global object initialized with the XboxkrnlModule.
@@ -62,6 +80,10 @@ KernelState::KernelState(Emulator* emulator)
       memory_(emulator->memory()),
       dispatch_thread_running_(false),
       dpc_list_(emulator->memory()),
+      dispatch_event_(xe::threading::Event::CreateAutoResetEvent(false)),
+      dispatch_task_pool_(
+          std::make_unique<DispatchTask[]>(kDispatchTaskPoolSize)),
+      dispatch_task_free_head_(0),
       kernel_trampoline_group_(emulator->processor()->backend()) {
   assert_null(shared_kernel_state_);
   shared_kernel_state_ = this;
@@ -69,6 +91,12 @@ KernelState::KernelState(Emulator* emulator)
   file_system_ = emulator->file_system();
   xam_state_ = std::make_unique<xam::XamState>(emulator, this);
 
+  for (uint32_t i = 0; i < kDispatchTaskPoolSize; ++i) {
+    dispatch_task_pool_[i].next_free.store(
+        i + 1 < kDispatchTaskPoolSize ? i + 1 : kNoFreeDispatchTask,
+        std::memory_order_relaxed);
+  }
+
   InitializeKernelGuestGlobals();
   kernel_version_ = KernelVersion(cvars::kernel_build_version);
 
@@ -89,9 +117,25 @@ KernelState::~KernelState() {
 
   if (dispatch_thread_running_) {
     dispatch_thread_running_ = false;
-    dispatch_cond_.notify_all();
+    dispatch_event_->Set();
     dispatch_thread_->Wait(0, 0, 0, nullptr);
   }
+  // Drop the completions that haven't been run.
+  while (MpscQueueNode* task = dispatch_queue_.Pop()) {
+    FreeDispatchTask(static_cast<DispatchTask*>(task));
+  }
+
+  if (!io_threads_.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(io_mutex_);
+      io_threads_running_ = false;
+    }
+    io_cond_.notify_all();
+    for (object_ref<XHostThread>& io_thread : io_threads_) {
+      io_thread->Wait(0, 0, 0, nullptr);
+    }
+    io_threads_.clear();
+  }
 
   executable_module_.reset();
   user_modules_.clear();
@@ -100,8 +144,23 @@ KernelState::~KernelState() {
   // Delete all objects.
   object_table_.Reset();
 
+  // After the threads have given back their memory.
+  for (const PooledThreadMemory& thread_memory : thread_memory_pool_) {
+    memory_->LookupHeap(XThread::kStackAddressRangeBegin)
+        ->Release(thread_memory.stack_alloc_base);
+    memory_->SystemHeapFree(thread_memory.tls_address);
+    memory_->SystemHeapFree(thread_memory.pcr_address);
+  }
+  thread_memory_pool_.clear();
+
+  // After the sockets have been closed.
+  socket_reactor_.reset();
+
   xam_state_.reset();
 
+  // Writes what the profiles have left queued.
+  write_behind_queue_.reset();
+
   assert_true(shared_kernel_state_ == this);
   shared_kernel_state_ = nullptr;
 }
@@ -423,21 +482,23 @@ void KernelState::SetExecutableModule(object_ref<UserModule> module) {
           // As we run guest callbacks the debugger must be able to suspend us.
           dispatch_thread_->set_can_debugger_suspend(true);
 
-          auto global_lock = global_critical_region_.AcquireDeferred();
           while (dispatch_thread_running_) {
-            global_lock.lock();
-            if (dispatch_queue_.empty()) {
-              dispatch_cond_.wait(global_lock);
-              if (!dispatch_thread_running_) {
-                global_lock.unlock();
-                break;
+            auto task = static_cast<DispatchTask*>(dispatch_queue_.Pop());
+            if (!task) {
+              dispatch_thread_sleeping_.store(true, std::memory_order_relaxed);
+              // Either this sees the tasks pushed before, or the producers
+              // see that the thread is going to sleep.
+              std::atomic_thread_fence(std::memory_order_seq_cst);
+              task = static_cast<DispatchTask*>(dispatch_queue_.Pop());
+              if (!task) {
+                xe::threading::Wait(dispatch_event_.get(), false);
+                continue;
               }
+              dispatch_thread_sleeping_.store(false,
+                                              std::memory_order_relaxed);
             }
-            auto fn = std::move(dispatch_queue_.front());
-            dispatch_queue_.pop_front();
-            global_lock.unlock();
-
-            fn();
+            RunDispatchTask(task);
+            FreeDispatchTask(task);
           }
           return 0;
         },
@@ -445,6 +506,60 @@ void KernelState::SetExecutableModule(object_ref<UserModule> module) {
     dispatch_thread_->set_name("Kernel Dispatch");
     dispatch_thread_->Create();
   }
+
+  // Spin up the asynchronous file I/O workers.
+  if (io_threads_.empty() && cvars::async_io_threads) {
+    io_threads_running_ = true;
+    for (uint32_t i = 0; i < cvars::async_io_threads; ++i) {
+      auto io_thread = object_ref<XHostThread>(new XHostThread(
+          this, 128 * 1024, 0,
+          [this]() {
+            while (true) {
+              std::function<void()> request;
+              {
+                std::unique_lock<std::mutex> lock(io_mutex_);
+                io_cond_.wait(lock, [this]() {
+                  return !io_queue_.empty() || !io_threads_running_;
+                });
+                if (io_queue_.empty()) {
+                  break;
+                }
+                request = std::move(io_queue_.front());
+                io_queue_.pop_front();
+              }
+              request();
+            }
+            return 0;
+          },
+          GetSystemProcess()));
+      io_thread->set_name(fmt::format("Kernel I/O {}", i));
+      io_thread->Create();
+      io_threads_.push_back(std::move(io_thread));
+    }
+  }
+}
+
+void KernelState::QueueAsyncIO(std::function<void()> request) {
+  {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    io_queue_.push_back(std::move(request));
+  }
+  io_cond_.notify_one();
+}
+
+SocketReactor* KernelState::socket_reactor() {
+  std::call_once(socket_reactor_once_, [this]() {
+    socket_reactor_ = std::make_unique<SocketReactor>();
+  });
+  return socket_reactor_.get();
+}
+
+WriteBehindQueue* KernelState::write_behind_queue() {
+  std::call_once(write_behind_queue_once_, [this]() {
+    write_behind_queue_ =
+        std::make_unique<WriteBehindQueue>(std::chrono::milliseconds(500));
+  });
+  return write_behind_queue_.get();
 }
 
 void KernelState::LoadKernelModule(object_ref<KernelModule> kernel_module) {
@@ -537,6 +652,11 @@ X_RESULT KernelState::FinishLoadingUserModule(
                                              module->hash());
   emulator_->on_patch_apply();
   if (module->xex_module()) {
+    for (const patcher::PatchHostRoutineEntry& host_routine :
+         emulator_->patcher()->host_routines()) {
+      module->xex_module()->SetupHostRoutine(host_routine.address,
+                                             host_routine.routine);
+    }
     module->xex_module()->Precompile();
   }
 
@@ -784,7 +904,13 @@ void KernelState::TerminateTitle() {
   object_table_.PurgeAllObjects();
 
   // Unregister all notify listeners.
-  notify_listeners_.clear();
+  std::shared_ptr<const std::vector<object_ref<XNotifyListener>>>
+      notify_listeners;
+  {
+    std::lock_guard<xe_mutex> lock(notify_listeners_mutex_);
+    notify_listeners = std::move(notify_listeners_);
+  }
+  notify_listeners.reset();
 
   // Clear the TLS map.
   tls_bitmap_.Reset();
@@ -805,6 +931,8 @@ void KernelState::TerminateTitle() {
 void KernelState::RegisterThread(XThread* thread) {
   auto global_lock = global_critical_region_.Acquire();
   threads_by_id_[thread->thread_id()] = thread;
+  threads_created_counter.Increment();
+  threads_gauge.Set(int64_t(threads_by_id_.size()));
 }
 
 void KernelState::UnregisterThread(XThread* thread) {
@@ -813,6 +941,33 @@ void KernelState::UnregisterThread(XThread* thread) {
   if (it != threads_by_id_.end()) {
     threads_by_id_.erase(it);
   }
+  threads_gauge.Set(int64_t(threads_by_id_.size()));
+}
+
+bool KernelState::TakePooledThreadMemory(uint32_t stack_alloc_size,
+                                         uint32_t tls_size,
+                                         PooledThreadMemory& memory_out) {
+  std::lock_guard<std::mutex> lock(thread_memory_pool_mutex_);
+  // The most recently exited thread first, its memory is the most likely to
+  // be in the host caches.
+  for (auto it = thread_memory_pool_.rbegin(); it != thread_memory_pool_.rend();
+       ++it) {
+    if (it->stack_alloc_size == stack_alloc_size && it->tls_size == tls_size) {
+      memory_out = *it;
+      thread_memory_pool_.erase(std::next(it).base());
+      return true;
+    }
+  }
+  return false;
+}
+
+bool KernelState::PoolThreadMemory(const PooledThreadMemory& memory) {
+  std::lock_guard<std::mutex> lock(thread_memory_pool_mutex_);
+  if (thread_memory_pool_.size() >= cvars::guest_thread_memory_pool_size) {
+    return false;
+  }
+  thread_memory_pool_.push_back(memory);
+  return true;
 }
 
 void KernelState::OnThreadExecute(XThread* thread) {
@@ -873,7 +1028,16 @@ object_ref<XThread> KernelState::GetThreadByID(uint32_t thread_id) {
 
 void KernelState::RegisterNotifyListener(XNotifyListener* listener) {
   auto global_lock = global_critical_region_.Acquire();
-  notify_listeners_.push_back(retain_object(listener));
+  {
+    std::lock_guard<xe_mutex> lock(notify_listeners_mutex_);
+    auto notify_listeners =
+        notify_listeners_
+            ? std::make_shared<std::vector<object_ref<XNotifyListener>>>(
+                  *notify_listeners_)
+            : std::make_shared<std::vector<object_ref<XNotifyListener>>>();
+    notify_listeners->push_back(retain_object(listener));
+    notify_listeners_ = std::move(notify_listeners);
+  }
 
   // Games seem to expect a few notifications on startup, only for the first
   // listener.
@@ -906,20 +1070,38 @@ void KernelState::RegisterNotifyListener(XNotifyListener* listener) {
 }
 
 void KernelState::UnregisterNotifyListener(XNotifyListener* listener) {
-  auto global_lock = global_critical_region_.Acquire();
-  for (auto it = notify_listeners_.begin(); it != notify_listeners_.end();
+  std::lock_guard<xe_mutex> lock(notify_listeners_mutex_);
+  if (!notify_listeners_) {
+    return;
+  }
+  for (auto it = notify_listeners_->begin(); it != notify_listeners_->end();
        ++it) {
     if ((*it).get() == listener) {
-      notify_listeners_.erase(it);
+      auto notify_listeners =
+          std::make_shared<std::vector<object_ref<XNotifyListener>>>(
+              *notify_listeners_);
+      notify_listeners->erase(notify_listeners->begin() +
+                              (it - notify_listeners_->begin()));
+      notify_listeners_ = std::move(notify_listeners);
       break;
     }
   }
 }
 
 void KernelState::BroadcastNotification(XNotificationID id, uint32_t data) {
-  auto global_lock = global_critical_region_.Acquire();
-  for (const auto& notify_listener : notify_listeners_) {
-    notify_listener->EnqueueNotification(id, data);
+  std::shared_ptr<const std::vector<object_ref<XNotifyListener>>>
+      notify_listeners;
+  {
+    std::lock_guard<xe_mutex> lock(notify_listeners_mutex_);
+    notify_listeners = notify_listeners_;
+  }
+  if (!notify_listeners) {
+    return;
+  }
+  for (const auto& notify_listener : *notify_listeners) {
+    if (notify_listener->IsNotificationAccepted(id)) {
+      notify_listener->EnqueueNotification(id, data);
+    }
   }
 }
 
@@ -1012,6 +1194,36 @@ void KernelState::CompleteOverlappedDeferredEx(
     std::function<X_RESULT(uint32_t&, uint32_t&)> completion_callback,
     uint32_t overlapped_ptr, std::function<void()> pre_callback,
     std::function<void()> post_callback) {
+  SetOverlappedPending(overlapped_ptr);
+  DispatchTask* task = AllocateDispatchTask();
+  task->completion_callback = std::move(completion_callback);
+  task->pre_callback = std::move(pre_callback);
+  task->post_callback = std::move(post_callback);
+  task->overlapped_ptr = overlapped_ptr;
+  QueueDispatchTask(task);
+}
+
+void KernelState::CompleteOverlappedAsync(
+    std::function<X_RESULT()> completion_callback, uint32_t overlapped_ptr,
+    std::function<void()> post_callback) {
+  if (!is_async_io_enabled()) {
+    CompleteOverlappedDeferred(std::move(completion_callback), overlapped_ptr,
+                               nullptr, std::move(post_callback));
+    return;
+  }
+  SetOverlappedPending(overlapped_ptr);
+  QueueAsyncIO([this, completion_callback = std::move(completion_callback),
+                overlapped_ptr, post_callback = std::move(post_callback)]() {
+    X_RESULT result = completion_callback();
+    CompleteOverlappedEx(overlapped_ptr, result, static_cast<uint32_t>(result),
+                         0);
+    if (post_callback) {
+      post_callback();
+    }
+  });
+}
+
+void KernelState::SetOverlappedPending(uint32_t overlapped_ptr) {
   auto ptr = memory()->TranslateVirtual(overlapped_ptr);
   XOverlappedSetResult(ptr, X_ERROR_IO_PENDING);
   XOverlappedSetContext(ptr, XThread::GetCurrentThreadHandle());
@@ -1024,22 +1236,67 @@ void KernelState::CompleteOverlappedDeferredEx(
       ev.get<XEvent>()->Reset();
     }
   }
-  auto global_lock = global_critical_region_.Acquire();
-  dispatch_queue_.push_back([this, completion_callback, overlapped_ptr,
-                             pre_callback, post_callback]() {
-    if (pre_callback) {
-      pre_callback();
-    }
-    xe::threading::Sleep(
-        std::chrono::milliseconds(kDeferredOverlappedDelayMillis));
-    uint32_t extended_error, length;
-    auto result = completion_callback(extended_error, length);
-    CompleteOverlappedEx(overlapped_ptr, result, extended_error, length);
-    if (post_callback) {
-      post_callback();
+}
+
+KernelState::DispatchTask* KernelState::AllocateDispatchTask() {
+  uint64_t free_head = dispatch_task_free_head_.load(std::memory_order_acquire);
+  while (uint32_t(free_head) != kNoFreeDispatchTask) {
+    DispatchTask& task = dispatch_task_pool_[uint32_t(free_head)];
+    // May be stale if the task has been taken by another thread, but then the
+    // counter in the head has changed too.
+    uint64_t new_free_head =
+        (((free_head >> 32) + 1) << 32) |
+        task.next_free.load(std::memory_order_relaxed);
+    if (dispatch_task_free_head_.compare_exchange_weak(
+            free_head, new_free_head, std::memory_order_acquire,
+            std::memory_order_acquire)) {
+      return &task;
     }
-  });
-  dispatch_cond_.notify_all();
+  }
+  return new DispatchTask;
+}
+
+void KernelState::FreeDispatchTask(DispatchTask* task) {
+  // Release the captures now rather than when the task is reused.
+  task->completion_callback = nullptr;
+  task->pre_callback = nullptr;
+  task->post_callback = nullptr;
+  if (task < dispatch_task_pool_.get() ||
+      task >= dispatch_task_pool_.get() + kDispatchTaskPoolSize) {
+    delete task;
+    return;
+  }
+  uint32_t index = uint32_t(task - dispatch_task_pool_.get());
+  uint64_t free_head = dispatch_task_free_head_.load(std::memory_order_relaxed);
+  do {
+    task->next_free.store(uint32_t(free_head), std::memory_order_relaxed);
+  } while (!dispatch_task_free_head_.compare_exchange_weak(
+      free_head, (((free_head >> 32) + 1) << 32) | index,
+      std::memory_order_release, std::memory_order_relaxed));
+}
+
+void KernelState::QueueDispatchTask(DispatchTask* task) {
+  dispatch_queue_.Push(task);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  // Only the first producer after the thread has gone to sleep wakes it up.
+  if (dispatch_thread_sleeping_.load(std::memory_order_relaxed) &&
+      dispatch_thread_sleeping_.exchange(false, std::memory_order_relaxed)) {
+    dispatch_event_->Set();
+  }
+}
+
+void KernelState::RunDispatchTask(DispatchTask* task) {
+  if (task->pre_callback) {
+    task->pre_callback();
+  }
+  xe::threading::Sleep(
+      std::chrono::milliseconds(kDeferredOverlappedDelayMillis));
+  uint32_t extended_error, length;
+  X_RESULT result = task->completion_callback(extended_error, length);
+  CompleteOverlappedEx(task->overlapped_ptr, result, extended_error, length);
+  if (task->post_callback) {
+    task->post_callback();
+  }
 }
 
 bool KernelState::Save(ByteStream* stream) {
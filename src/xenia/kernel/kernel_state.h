@@ -16,10 +16,12 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "xenia/base/bit_map.h"
 #include "xenia/base/cvar.h"
+#include "xenia/base/mpsc_queue.h"
 #include "xenia/base/mutex.h"
 #include "xenia/cpu/backend/backend.h"
 #include "xenia/cpu/export_resolver.h"
@@ -32,6 +34,8 @@
 #include "xenia/kernel/xam/content_manager.h"
 #include "xenia/kernel/xam/user_profile.h"
 #include "xenia/kernel/xam/xam_state.h"
+#include "xenia/kernel/socket_reactor.h"
+#include "xenia/kernel/util/write_behind_queue.h"
 #include "xenia/kernel/xevent.h"
 #include "xenia/memory.h"
 #include "xenia/vfs/virtual_file_system.h"
@@ -264,6 +268,20 @@ class KernelState {
 
   void RegisterThread(XThread* thread);
   void UnregisterThread(XThread* thread);
+
+  // Guest memory of an exited thread, kept for the next thread created with
+  // the same stack and TLS sizes.
+  struct PooledThreadMemory {
+    uint32_t stack_alloc_base;
+    uint32_t stack_alloc_size;
+    uint32_t tls_address;
+    uint32_t tls_size;
+    uint32_t pcr_address;
+  };
+  bool TakePooledThreadMemory(uint32_t stack_alloc_size, uint32_t tls_size,
+                              PooledThreadMemory& memory_out);
+  // Returns false if the pool is full, the memory must be freed then.
+  bool PoolThreadMemory(const PooledThreadMemory& memory);
   void OnThreadExecute(XThread* thread);
   void OnThreadExit(XThread* thread);
   object_ref<XThread> GetThreadByID(uint32_t thread_id);
@@ -301,6 +319,26 @@ class KernelState {
       uint32_t overlapped_ptr, std::function<void()> pre_callback = nullptr,
       std::function<void()> post_callback = nullptr);
 
+  // Like CompleteOverlappedDeferred, but running the callback on an I/O thread
+  // if they're enabled, for requests that may take long, such as ones waiting
+  // for the network, so they don't delay the other deferred completions.
+  void CompleteOverlappedAsync(std::function<X_RESULT()> completion_callback,
+                               uint32_t overlapped_ptr,
+                               std::function<void()> post_callback = nullptr);
+
+  // Whether asynchronous file requests should be completed on the I/O threads
+  // instead of the calling guest thread.
+  bool is_async_io_enabled() const { return !io_threads_.empty(); }
+  // Runs the file request on an I/O thread, which has a guest context for
+  // completing it (queueing APCs, for instance). Requests may run in parallel
+  // and complete in any order.
+  void QueueAsyncIO(std::function<void()> request);
+
+  // Created when first needed, for the overlapped socket receives.
+  SocketReactor* socket_reactor();
+  // Created when first needed, for the profile data saved by the titles.
+  WriteBehindQueue* write_behind_queue();
+
   bool Save(ByteStream* stream);
   bool Restore(ByteStream* stream);
 
@@ -324,6 +362,27 @@ class KernelState {
                              uint32_t cpu);
 
  private:
+  // Deferred overlapped completion run by the dispatch thread.
+  struct DispatchTask : MpscQueueNode {
+    std::function<X_RESULT(uint32_t&, uint32_t&)> completion_callback;
+    std::function<void()> pre_callback;
+    std::function<void()> post_callback;
+    uint32_t overlapped_ptr = 0;
+    // Index of the next task in the free list of the pool.
+    std::atomic<uint32_t> next_free{0};
+  };
+  static constexpr uint32_t kDispatchTaskPoolSize = 256;
+  static constexpr uint32_t kNoFreeDispatchTask = UINT32_MAX;
+
+  // Marks the request as pending for the guest, before it's completed later.
+  void SetOverlappedPending(uint32_t overlapped_ptr);
+
+  // Lock-free, allocates only when the pool is exhausted.
+  DispatchTask* AllocateDispatchTask();
+  void FreeDispatchTask(DispatchTask* task);
+  void QueueDispatchTask(DispatchTask* task);
+  void RunDispatchTask(DispatchTask* task);
+
   void LoadKernelModule(object_ref<KernelModule> kernel_module);
   void InitializeProcess(X_KPROCESS* process, uint32_t type, char unk_18,
                          char unk_19, char unk_1A);
@@ -355,7 +414,15 @@ class KernelState {
   // Must be guarded by the global critical region.
   util::ObjectTable object_table_;
   std::unordered_map<uint32_t, XThread*> threads_by_id_;
-  std::vector<object_ref<XNotifyListener>> notify_listeners_;
+
+  std::mutex thread_memory_pool_mutex_;
+  std::vector<PooledThreadMemory> thread_memory_pool_;
+  // Replaced as a whole when listeners are registered or unregistered, so
+  // broadcasting only takes a reference to the current list under
+  // notify_listeners_mutex_ rather than holding the global lock.
+  xe_mutex notify_listeners_mutex_;
+  std::shared_ptr<const std::vector<object_ref<XNotifyListener>>>
+      notify_listeners_;
   bool has_notified_startup_ = false;
 
   object_ref<UserModule> executable_module_;
@@ -368,8 +435,30 @@ class KernelState {
   object_ref<XHostThread> dispatch_thread_;
   // Must be guarded by the global critical region.
   util::NativeList dpc_list_;
-  std::condition_variable_any dispatch_cond_;
-  std::list<std::function<void()>> dispatch_queue_;
+  // Tasks are pushed without any lock, and the dispatch thread is only woken up
+  // by the first push after it has gone to sleep, with everything queued by
+  // then being run in a single batch.
+  MpscQueue dispatch_queue_;
+  std::atomic<bool> dispatch_thread_sleeping_{false};
+  std::unique_ptr<xe::threading::Event> dispatch_event_;
+  std::unique_ptr<DispatchTask[]> dispatch_task_pool_;
+  // The index of the first free pooled task in the low 32 bits, and the number
+  // of times the head has been changed in the high 32 bits against ABA.
+  std::atomic<uint64_t> dispatch_task_free_head_;
+
+  // Host I/O must not be done within the global critical region, so the I/O
+  // threads have their own lock.
+  std::vector<object_ref<XHostThread>> io_threads_;
+  bool io_threads_running_ = false;
+  std::mutex io_mutex_;
+  std::condition_variable io_cond_;
+  std::list<std::function<void()>> io_queue_;
+
+  std::once_flag socket_reactor_once_;
+  std::unique_ptr<SocketReactor> socket_reactor_;
+
+  std::once_flag write_behind_queue_once_;
+  std::unique_ptr<WriteBehindQueue> write_behind_queue_;
 
   BitMap tls_bitmap_;
   uint32_t ke_timestamp_bundle_ptr_ = 0;
@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/socket_reactor.h"
+
+#include <vector>
+
+#include "xenia/base/logging.h"
+#include "xenia/base/platform.h"
+#include "xenia/base/threading.h"
+
+#ifdef XE_PLATFORM_WIN32
+// clang-format off
+#include "xenia/base/platform_win.h"
+#include <WS2tcpip.h>
+#include <WinSock2.h>
+// clang-format on
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace xe {
+namespace kernel {
+
+namespace {
+
+#ifdef XE_PLATFORM_WIN32
+using NativeSocket = SOCKET;
+#else
+using NativeSocket = int;
+#endif
+
+void CloseNativeSocket(NativeSocket native_socket) {
+#ifdef XE_PLATFORM_WIN32
+  closesocket(native_socket);
+#else
+  close(native_socket);
+#endif
+}
+
+}  // namespace
+
+SocketReactor::SocketReactor() {
+  NativeSocket wake_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#ifdef XE_PLATFORM_WIN32
+  if (wake_socket == INVALID_SOCKET) {
+#else
+  if (wake_socket < 0) {
+#endif
+    XELOGE("SocketReactor: Failed to create the wake up socket");
+    return;
+  }
+
+  // Bound to a loopback port and connected to it, for sending to itself.
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  socklen_t address_length = sizeof(address);
+  bool nonblocking;
+#ifdef XE_PLATFORM_WIN32
+  u_long nonblocking_mode = 1;
+  nonblocking = ioctlsocket(wake_socket, FIONBIO, &nonblocking_mode) == 0;
+#else
+  int file_flags = fcntl(wake_socket, F_GETFL, 0);
+  nonblocking = file_flags >= 0 &&
+                fcntl(wake_socket, F_SETFL, file_flags | O_NONBLOCK) == 0;
+#endif
+  if (!nonblocking ||
+      bind(wake_socket, reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      getsockname(wake_socket, reinterpret_cast<sockaddr*>(&address),
+                  &address_length) != 0 ||
+      connect(wake_socket, reinterpret_cast<sockaddr*>(&address),
+              sizeof(address)) != 0) {
+    XELOGE("SocketReactor: Failed to set up the wake up socket");
+    CloseNativeSocket(wake_socket);
+    return;
+  }
+
+  wake_socket_ = uint64_t(wake_socket);
+  thread_ = std::thread(&SocketReactor::ThreadMain, this);
+}
+
+SocketReactor::~SocketReactor() {
+  if (!is_valid()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  Wake();
+  thread_.join();
+  CloseNativeSocket(NativeSocket(wake_socket_));
+}
+
+void SocketReactor::WatchReadable(uint64_t native_handle,
+                                  ReadyCallback callback) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    watched_[native_handle] = std::move(callback);
+  }
+  Wake();
+}
+
+void SocketReactor::Cancel(uint64_t native_handle) {
+  ReadyCallback callback;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // The running callback may watch the socket again.
+    callback_done_cond_.wait(
+        lock, [&]() { return running_handle_ != native_handle; });
+    auto it = watched_.find(native_handle);
+    if (it != watched_.end()) {
+      callback = std::move(it->second);
+      watched_.erase(it);
+    }
+  }
+  if (callback) {
+    // For the socket to be dropped from the sockets being waited on before
+    // it's closed.
+    Wake();
+    callback();
+  }
+}
+
+void SocketReactor::Wake() {
+  const char wake_byte = 0;
+  send(NativeSocket(wake_socket_), &wake_byte, 1, 0);
+}
+
+void SocketReactor::ThreadMain() {
+  xe::threading::set_name("Socket Reactor");
+
+  std::vector<pollfd> fds;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    fds.clear();
+    fds.push_back({NativeSocket(wake_socket_), POLLIN, 0});
+    for (const auto& watched_socket : watched_) {
+      fds.push_back({NativeSocket(watched_socket.first), POLLIN, 0});
+    }
+    lock.unlock();
+
+#ifdef XE_PLATFORM_WIN32
+    int ret = WSAPoll(fds.data(), ULONG(fds.size()), -1);
+#else
+    int ret = poll(fds.data(), nfds_t(fds.size()), -1);
+#endif
+    if (fds[0].revents & POLLIN) {
+      char wake_bytes[64];
+      while (recv(NativeSocket(wake_socket_), wake_bytes, sizeof(wake_bytes),
+                  0) > 0) {
+      }
+    }
+
+    lock.lock();
+    if (ret <= 0) {
+      // Interrupted, or a socket was closed while being waited on, which has
+      // been cancelled and won't be waited on again.
+      continue;
+    }
+    for (size_t i = 1; i < fds.size(); ++i) {
+      if (!fds[i].revents) {
+        continue;
+      }
+      uint64_t native_handle = uint64_t(fds[i].fd);
+      auto it = watched_.find(native_handle);
+      if (it == watched_.end()) {
+        continue;
+      }
+      ReadyCallback callback = std::move(it->second);
+      watched_.erase(it);
+      running_handle_ = native_handle;
+      lock.unlock();
+      callback();
+      lock.lock();
+      running_handle_ = kInvalidSocket;
+      callback_done_cond_.notify_all();
+    }
+  }
+}
+
+}  // namespace kernel
+}  // namespace xe
@@ -0,0 +1,63 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_SOCKET_REACTOR_H_
+#define XENIA_KERNEL_SOCKET_REACTOR_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace xe {
+namespace kernel {
+
+// Waits on one thread for the host sockets with pending overlapped receives to
+// become readable, instead of a thread polling each of them.
+class SocketReactor {
+ public:
+  using ReadyCallback = std::function<void()>;
+
+  SocketReactor();
+  ~SocketReactor();
+
+  bool is_valid() const { return wake_socket_ != kInvalidSocket; }
+
+  // Calls the callback once, on the reactor thread, when the socket becomes
+  // readable (or has an error). A socket can only be watched once at a time.
+  void WatchReadable(uint64_t native_handle, ReadyCallback callback);
+  // Stops watching the socket, calling its callback on this thread if that
+  // hasn't been done yet, so it can complete the request as aborted. When this
+  // returns, the callback has finished running.
+  void Cancel(uint64_t native_handle);
+
+ private:
+  static constexpr uint64_t kInvalidSocket = ~uint64_t(0);
+
+  void ThreadMain();
+  void Wake();
+
+  // Datagrams sent to itself wake the reactor thread up when the watched
+  // sockets change.
+  uint64_t wake_socket_ = kInvalidSocket;
+
+  std::mutex mutex_;
+  std::condition_variable callback_done_cond_;
+  std::map<uint64_t, ReadyCallback> watched_;
+  uint64_t running_handle_ = kInvalidSocket;
+  bool running_ = true;
+  std::thread thread_;
+};
+
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_SOCKET_REACTOR_H_
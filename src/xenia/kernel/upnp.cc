@@ -11,6 +11,7 @@
 #include "util/net_utils.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/threading.h"
 
 #include <third_party/miniupnp/miniupnpc/include/miniwget.h>
 #include <third_party/miniupnp/miniupnpc/include/upnpcommands.h>
@@ -31,6 +32,10 @@ namespace kernel {
 UPnP::UPnP() {}
 
 UPnP::~UPnP() {
+  if (discovery_thread_.joinable()) {
+    discovery_thread_.join();
+  }
+
   std::lock_guard lock(mutex_);
 
   for (const auto& [protocol, prot_bindings] : port_bindings_) {
@@ -78,8 +83,6 @@ bool UPnP::LoadSavedUPnPDevice() {
   }
 
   XELOGI("UPnP: Saved UPnP({}) enabled", device_url);
-  RefreshPortsTimer();
-  active_ = true;
   return true;
 }
 
@@ -101,65 +104,102 @@ const UPNPDev* UPnP::GetDeviceByName(const UPNPDev* device_list,
   return device;
 }
 
-const UPNPDev* UPnP::DiscoverUPnPDevice() {
+bool UPnP::DiscoverUPnPDevice(std::string& desc_url, std::string& type) {
   XELOGI("UPnP: Starting UPnP search");
 
   int error = 0;
   UPNPDev* device_list = upnpDiscover(2000, nullptr, nullptr, 0, 0, 2, &error);
   if (error) {
     XELOGE("UPnP: SearchUPnPDevice Error Code: {}", error);
-    return nullptr;
+    return false;
   }
 
   if (!device_list) {
     XELOGE("UPnP: No UPnP devices were found");
-    return nullptr;
+    return false;
   }
 
+  // Copied out before the list is freed.
   const UPNPDev* device = GetDeviceByName(device_list, "InternetGatewayDevice");
+  if (device) {
+    desc_url = device->descURL;
+    type = device->st;
+  }
   freeUPNPDevlist(device_list);
-  return device;
+  return device != nullptr;
 }
 
 void UPnP::Initialize() {
-  std::lock_guard lock(mutex_);
-
-  if (LoadSavedUPnPDevice()) {
+  if (status_ != Status::kDisabled) {
     return;
   }
+  status_ = Status::kSearching;
+  discovery_thread_ = std::thread([this]() {
+    xe::threading::set_name("UPnP Discovery");
+    Discover();
+  });
+}
 
-  SearchUPnP();
-
-  RefreshPortsTimer();
-  active_ = true;
-};
-
-void UPnP::SearchUPnP() {
-  if (active_) {
+void UPnP::Discover() {
+  bool found;
+  {
     std::lock_guard lock(mutex_);
+    // The device saved by the previous search is tried first, without waiting
+    // for the responses to a search.
+    found = LoadSavedUPnPDevice() || SearchUPnP();
+    if (found) {
+      RefreshPortsTimer();
+      active_ = true;
+    }
   }
 
-  const UPNPDev* device = DiscoverUPnPDevice();
-  if (!device) {
-    XELOGE("No UPNP device was found");
+  std::vector<PendingPort> pending_ports;
+  {
+    std::lock_guard pending_lock(pending_ports_mutex_);
+    status_ = found ? Status::kActive : Status::kUnavailable;
+    pending_ports.swap(pending_ports_);
+  }
+  if (!found) {
+    XELOGI("UPnP: No device is available, ports won't be mapped");
     return;
   }
+  for (const PendingPort& pending_port : pending_ports) {
+    AddPort(pending_port.addr, pending_port.internal_port,
+            pending_port.protocol);
+  }
+}
 
-  if (!GetAndParseUPnPXmlData(device->descURL)) {
-    XELOGE("Failed to retrieve UPNP xml for {}", device->descURL);
-    return;
+bool UPnP::SearchUPnP() {
+  std::string desc_url, type;
+  if (!DiscoverUPnPDevice(desc_url, type)) {
+    XELOGE("No UPNP device was found");
+    return false;
   }
 
-  XELOGI("Found UPnP device type : {} at {}", device->st, device->descURL);
+  if (!GetAndParseUPnPXmlData(desc_url)) {
+    XELOGE("Failed to retrieve UPNP xml for {}", desc_url);
+    return false;
+  }
+
+  XELOGI("Found UPnP device type : {} at {}", type, desc_url);
 
-  cvars::upnp_root = device->descURL;
+  cvars::upnp_root = desc_url;
   OVERRIDE_string(upnp_root, cvars::upnp_root);
+  return true;
 };
 
 uint32_t UPnP::AddPort(std::string_view addr, uint16_t internal_port,
                        std::string_view protocol) {
   if (!active_) {
-    return UPNPCOMMAND_UNKNOWN_ERROR;
+    std::lock_guard pending_lock(pending_ports_mutex_);
+    if (status_ == Status::kSearching) {
+      pending_ports_.push_back(
+          {std::string(addr), internal_port, std::string(protocol)});
+      return UPNPCOMMAND_SUCCESS;
+    }
+    if (status_ != Status::kActive) {
+      return UPNPCOMMAND_UNKNOWN_ERROR;
+    }
   }
 
   std::lock_guard lock(mutex_);
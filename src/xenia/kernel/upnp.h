@@ -7,8 +7,13 @@
  ******************************************************************************
  */
 
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <third_party/miniupnp/miniupnpc/include/miniupnpc.h>
 #include <xenia/base/threading_timer_queue.h>
@@ -18,14 +23,20 @@ namespace kernel {
 
 class UPnP {
  public:
+  enum class Status { kDisabled, kSearching, kActive, kUnavailable };
+
   UPnP();
   ~UPnP();
 
+  // Looks for the device in the background, as the search may take seconds
+  // on networks without one. The ports added meanwhile are mapped once it's
+  // found.
   void Initialize();
 
-  void SearchUPnP();
+  bool SearchUPnP();
 
   bool is_active() const { return active_; }
+  Status status() const { return status_; }
 
   // internal port is in BE notation.
   uint32_t AddPort(std::string_view addr, uint16_t internal_port,
@@ -65,12 +76,20 @@ class UPnP {
 
   typedef std::map<uint16_t, uint16_t> port_binding;
 
+  struct PendingPort {
+    std::string addr;
+    uint16_t internal_port;
+    std::string protocol;
+  };
+
+  void Discover();
+
   void RemovePortExternal(uint16_t external_port, std::string_view protocol,
                           bool verbose = true);
   void RefreshPortsTimer();
 
   bool LoadSavedUPnPDevice();
-  const UPNPDev* DiscoverUPnPDevice();
+  bool DiscoverUPnPDevice(std::string& desc_url, std::string& type);
   const UPNPDev* GetDeviceByName(const UPNPDev* device_list,
                                  std::string device_name);
   bool GetAndParseUPnPXmlData(std::string url);
@@ -80,6 +99,13 @@ class UPnP {
   std::atomic<bool> leases_supported_ = true;
   std::atomic<bool> refreshed_unauthorized_ = false;
 
+  std::thread discovery_thread_;
+  // Guards the change of the status from searching, and the ports added while
+  // searching.
+  std::mutex pending_ports_mutex_;
+  std::atomic<Status> status_ = Status::kDisabled;
+  std::vector<PendingPort> pending_ports_;
+
   IGDdatas* igd_data_ = new IGDdatas();
   UPNPUrls* igd_urls_ = new UPNPUrls();
 
@@ -0,0 +1,177 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/allocation_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+#include "xenia/base/filesystem.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+namespace {
+
+struct SiteTotals {
+  uint32_t live_count = 0;
+  uint64_t live_bytes = 0;
+  uint64_t allocation_count = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t free_count = 0;
+};
+
+struct LiveAllocation {
+  uint64_t site_key;
+  uint32_t size;
+};
+
+struct AllocationStatsRegistry {
+  std::mutex mutex;
+  // Keyed by the call site in the low 32 bits and the kind in the high ones.
+  std::unordered_map<uint64_t, SiteTotals> sites;
+  std::unordered_map<uint32_t, LiveAllocation> live_allocations;
+  // For returning from frees without locking while nothing is tracked.
+  std::atomic<size_t> live_allocation_count{0};
+};
+
+AllocationStatsRegistry& GetAllocationStatsRegistry() {
+  // Never destroyed since guest threads may still free during shutdown.
+  static AllocationStatsRegistry* registry = new AllocationStatsRegistry;
+  return *registry;
+}
+
+uint64_t GetSiteKey(AllocationKind kind, uint32_t call_site) {
+  return (uint64_t(kind) << 32) | call_site;
+}
+
+}  // namespace
+
+const char* GetAllocationKindName(AllocationKind kind) {
+  switch (kind) {
+    case AllocationKind::kVirtual:
+      return "Virtual";
+    case AllocationKind::kPhysical:
+      return "Physical";
+    case AllocationKind::kPool:
+      return "Pool";
+  }
+  return "Unknown";
+}
+
+void RecordAllocation(AllocationKind kind, uint32_t address, uint32_t size,
+                      uint32_t call_site) {
+  AllocationStatsRegistry& registry = GetAllocationStatsRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  uint64_t site_key = GetSiteKey(kind, call_site);
+  auto [it, inserted] =
+      registry.live_allocations.try_emplace(address, LiveAllocation{site_key});
+  if (!inserted) {
+    // Committing a part of a region that is already tracked.
+    return;
+  }
+  it->second.size = size;
+  registry.live_allocation_count.store(registry.live_allocations.size(),
+                                       std::memory_order_relaxed);
+  SiteTotals& site = registry.sites[site_key];
+  ++site.live_count;
+  site.live_bytes += size;
+  ++site.allocation_count;
+  site.allocated_bytes += size;
+}
+
+void RecordFree(uint32_t address) {
+  AllocationStatsRegistry& registry = GetAllocationStatsRegistry();
+  if (!registry.live_allocation_count.load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.live_allocations.find(address);
+  if (it == registry.live_allocations.end()) {
+    return;
+  }
+  SiteTotals& site = registry.sites[it->second.site_key];
+  --site.live_count;
+  site.live_bytes -= it->second.size;
+  ++site.free_count;
+  registry.live_allocations.erase(it);
+  registry.live_allocation_count.store(registry.live_allocations.size(),
+                                       std::memory_order_relaxed);
+}
+
+void SnapshotAllocationStats(std::vector<AllocationSiteStats>& stats_out) {
+  stats_out.clear();
+  AllocationStatsRegistry& registry = GetAllocationStatsRegistry();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    stats_out.reserve(registry.sites.size());
+    for (const auto& [site_key, totals] : registry.sites) {
+      AllocationSiteStats& stats = stats_out.emplace_back();
+      stats.call_site = uint32_t(site_key);
+      stats.kind = AllocationKind(site_key >> 32);
+      stats.live_count = totals.live_count;
+      stats.live_bytes = totals.live_bytes;
+      stats.allocation_count = totals.allocation_count;
+      stats.allocated_bytes = totals.allocated_bytes;
+      stats.free_count = totals.free_count;
+    }
+  }
+  std::sort(stats_out.begin(), stats_out.end(),
+            [](const AllocationSiteStats& a, const AllocationSiteStats& b) {
+              if (a.live_bytes != b.live_bytes) {
+                return a.live_bytes > b.live_bytes;
+              }
+              return a.allocated_bytes > b.allocated_bytes;
+            });
+}
+
+void ResetAllocationStats() {
+  AllocationStatsRegistry& registry = GetAllocationStatsRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto it = registry.sites.begin(); it != registry.sites.end();) {
+    if (!it->second.live_count) {
+      it = registry.sites.erase(it);
+      continue;
+    }
+    it->second.allocation_count = 0;
+    it->second.allocated_bytes = 0;
+    it->second.free_count = 0;
+    ++it;
+  }
+}
+
+bool ExportAllocationStatsCsv(const std::filesystem::path& path) {
+  std::vector<AllocationSiteStats> stats;
+  SnapshotAllocationStats(stats);
+  FILE* file = xe::filesystem::OpenFile(path, "w");
+  if (!file) {
+    return false;
+  }
+  fprintf(file,
+          "call_site,kind,live_count,live_bytes,allocation_count,"
+          "allocated_bytes,free_count\n");
+  for (const AllocationSiteStats& site : stats) {
+    fprintf(file, "%08X,%s,%u,%llu,%llu,%llu,%llu\n", site.call_site,
+            GetAllocationKindName(site.kind), site.live_count,
+            static_cast<unsigned long long>(site.live_bytes),
+            static_cast<unsigned long long>(site.allocation_count),
+            static_cast<unsigned long long>(site.allocated_bytes),
+            static_cast<unsigned long long>(site.free_count));
+  }
+  fclose(file);
+  return true;
+}
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_ALLOCATION_STATS_H_
+#define XENIA_KERNEL_UTIL_ALLOCATION_STATS_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "xenia/kernel/kernel_flags.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// Live and total guest memory allocated through the kernel, attributed to the
+// guest return address of the allocating call, gathered while
+// kernel_allocation_stats is enabled. Allocations made while it was disabled
+// are not known, and their frees are ignored.
+
+enum class AllocationKind : uint32_t {
+  // NtAllocateVirtualMemory.
+  kVirtual,
+  // MmAllocatePhysicalMemory(Ex).
+  kPhysical,
+  // ExAllocatePool*.
+  kPool,
+};
+
+const char* GetAllocationKindName(AllocationKind kind);
+
+struct AllocationSiteStats {
+  uint32_t call_site;
+  AllocationKind kind;
+  uint32_t live_count;
+  uint64_t live_bytes;
+  // Since the last reset.
+  uint64_t allocation_count;
+  uint64_t allocated_bytes;
+  uint64_t free_count;
+};
+
+void RecordAllocation(AllocationKind kind, uint32_t address, uint32_t size,
+                      uint32_t call_site);
+// Called regardless of kernel_allocation_stats, for the allocations recorded
+// before it was disabled.
+void RecordFree(uint32_t address);
+
+inline void RecordAllocationIfEnabled(AllocationKind kind, uint32_t address,
+                                      uint32_t size, uint32_t call_site) {
+  if (cvars::kernel_allocation_stats && address) {
+    RecordAllocation(kind, address, size, call_site);
+  }
+}
+
+// Returns the sites with live allocations or allocations since the last reset,
+// sorted by the live bytes, from the highest.
+void SnapshotAllocationStats(std::vector<AllocationSiteStats>& stats_out);
+// Resets the totals, keeping the allocations that are still live.
+void ResetAllocationStats();
+bool ExportAllocationStatsCsv(const std::filesystem::path& path);
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_ALLOCATION_STATS_H_
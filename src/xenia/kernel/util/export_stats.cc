@@ -0,0 +1,183 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/export_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "xenia/base/math.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+namespace {
+
+// Only written by the thread owning the buckets, so relaxed loads and stores
+// are enough, without read-modify-write operations.
+struct ThreadExportBucket {
+  std::atomic<uint64_t> call_count{0};
+  std::atomic<uint64_t> total_ticks{0};
+  std::atomic<uint64_t> histogram[kExportStatsHistogramBucketCount] = {};
+};
+
+struct ExportTotals {
+  uint64_t call_count = 0;
+  uint64_t total_ticks = 0;
+  uint64_t histogram[kExportStatsHistogramBucketCount] = {};
+
+  void Add(const ThreadExportBucket& bucket) {
+    call_count += bucket.call_count.load(std::memory_order_relaxed);
+    total_ticks += bucket.total_ticks.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < kExportStatsHistogramBucketCount; ++i) {
+      histogram[i] += bucket.histogram[i].load(std::memory_order_relaxed);
+    }
+  }
+};
+
+struct ThreadExportBuckets;
+
+struct ExportStatsRegistry {
+  std::mutex mutex;
+  std::vector<std::pair<const char*, const cpu::Export*>> exports;
+  std::vector<ThreadExportBuckets*> threads;
+  // Calls of the threads that have exited.
+  std::vector<ExportTotals> exited_thread_totals;
+  // Subtracted from the totals, set by ResetExportStats.
+  std::vector<ExportTotals> reset_totals;
+};
+
+ExportStatsRegistry& GetExportStatsRegistry() {
+  // Never destroyed since threads may exit during static destruction.
+  static ExportStatsRegistry* registry = new ExportStatsRegistry;
+  return *registry;
+}
+
+struct ThreadExportBuckets {
+  // Exports are all registered during static initialization, before any call.
+  uint32_t count;
+  std::unique_ptr<ThreadExportBucket[]> buckets;
+
+  ThreadExportBuckets() {
+    ExportStatsRegistry& registry = GetExportStatsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    count = uint32_t(registry.exports.size());
+    buckets = std::make_unique<ThreadExportBucket[]>(count);
+    registry.threads.push_back(this);
+  }
+  ~ThreadExportBuckets() {
+    ExportStatsRegistry& registry = GetExportStatsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (uint32_t i = 0; i < count; ++i) {
+      registry.exited_thread_totals[i].Add(buckets[i]);
+    }
+    registry.threads.erase(
+        std::find(registry.threads.begin(), registry.threads.end(), this));
+  }
+};
+
+// Created on the first call made with the statistics enabled.
+ThreadExportBuckets& GetThreadExportBuckets() {
+  thread_local ThreadExportBuckets buckets;
+  return buckets;
+}
+
+void GetExportTotals(ExportStatsRegistry& registry,
+                     std::vector<ExportTotals>& totals_out) {
+  totals_out = registry.exited_thread_totals;
+  for (const ThreadExportBuckets* thread : registry.threads) {
+    for (uint32_t i = 0; i < thread->count; ++i) {
+      totals_out[i].Add(thread->buckets[i]);
+    }
+  }
+}
+
+}  // namespace
+
+uint32_t RegisterExportStats(const char* module_name,
+                             const cpu::Export* export_entry) {
+  ExportStatsRegistry& registry = GetExportStatsRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.exports.emplace_back(module_name, export_entry);
+  registry.exited_thread_totals.emplace_back();
+  registry.reset_totals.emplace_back();
+  return uint32_t(registry.exports.size() - 1);
+}
+
+void RecordExportCall(uint32_t index, uint64_t start_ticks) {
+  uint64_t ticks = Clock::QueryHostTickCount() - start_ticks;
+  ThreadExportBuckets& thread = GetThreadExportBuckets();
+  if (index >= thread.count) {
+    return;
+  }
+  ThreadExportBucket& bucket = thread.buckets[index];
+  static const uint64_t tick_frequency = Clock::QueryHostTickFrequency();
+  uint64_t us = ticks * 1000000 / tick_frequency;
+  uint32_t histogram_index =
+      std::min(uint32_t(64 - xe::lzcnt(us)),
+               kExportStatsHistogramBucketCount - 1);
+  bucket.call_count.store(
+      bucket.call_count.load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  bucket.total_ticks.store(
+      bucket.total_ticks.load(std::memory_order_relaxed) + ticks,
+      std::memory_order_relaxed);
+  bucket.histogram[histogram_index].store(
+      bucket.histogram[histogram_index].load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+}
+
+void SnapshotExportStats(std::vector<ExportStats>& stats_out) {
+  stats_out.clear();
+  ExportStatsRegistry& registry = GetExportStatsRegistry();
+  std::vector<ExportTotals> totals;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    GetExportTotals(registry, totals);
+    for (size_t i = 0; i < totals.size(); ++i) {
+      const ExportTotals& reset_totals = registry.reset_totals[i];
+      ExportTotals& export_totals = totals[i];
+      if (export_totals.call_count == reset_totals.call_count) {
+        continue;
+      }
+      ExportStats& stats = stats_out.emplace_back();
+      stats.module_name = registry.exports[i].first;
+      stats.export_entry = registry.exports[i].second;
+      stats.call_count = export_totals.call_count - reset_totals.call_count;
+      // The total is converted at the end to avoid accumulating rounding.
+      stats.total_us = export_totals.total_ticks - reset_totals.total_ticks;
+      for (uint32_t j = 0; j < kExportStatsHistogramBucketCount; ++j) {
+        stats.histogram[j] =
+            export_totals.histogram[j] - reset_totals.histogram[j];
+      }
+    }
+  }
+  uint64_t tick_frequency = Clock::QueryHostTickFrequency();
+  for (ExportStats& stats : stats_out) {
+    stats.total_us = uint64_t(double(stats.total_us) * 1000000.0 /
+                              double(tick_frequency));
+  }
+  std::sort(stats_out.begin(), stats_out.end(),
+            [](const ExportStats& a, const ExportStats& b) {
+              return a.total_us > b.total_us;
+            });
+}
+
+void ResetExportStats() {
+  ExportStatsRegistry& registry = GetExportStatsRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  GetExportTotals(registry, registry.reset_totals);
+}
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
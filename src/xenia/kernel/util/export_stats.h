@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_EXPORT_STATS_H_
+#define XENIA_KERNEL_UTIL_EXPORT_STATS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "xenia/base/clock.h"
+#include "xenia/cpu/export_resolver.h"
+#include "xenia/kernel/kernel_flags.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// Call counts and host latency histograms of the HLE exports, gathered while
+// kernel_export_stats is enabled. Each thread records its calls into its own
+// buckets without synchronization, which are summed when taking a snapshot.
+
+// Bucket 0 is for calls under 1 microsecond, bucket i for calls of
+// [2^(i-1), 2^i) microseconds, and the last one for everything longer.
+constexpr uint32_t kExportStatsHistogramBucketCount = 16;
+
+struct ExportStats {
+  const char* module_name;
+  const cpu::Export* export_entry;
+  uint64_t call_count;
+  uint64_t total_us;
+  uint64_t histogram[kExportStatsHistogramBucketCount];
+};
+
+// Returns the index to record the calls of the export with. Called when the
+// export is registered, before any calls.
+uint32_t RegisterExportStats(const char* module_name,
+                             const cpu::Export* export_entry);
+
+void RecordExportCall(uint32_t index, uint64_t start_ticks);
+
+// Returns the exports that have been called since the last reset, sorted by
+// the total time spent in them, from the highest.
+void SnapshotExportStats(std::vector<ExportStats>& stats_out);
+void ResetExportStats();
+
+class ScopedExportCallStats {
+ public:
+  explicit ScopedExportCallStats(uint32_t index)
+      : index_(index),
+        start_ticks_(cvars::kernel_export_stats ? Clock::QueryHostTickCount()
+                                                : 0) {}
+  ScopedExportCallStats(const ScopedExportCallStats& stats) = delete;
+  ScopedExportCallStats& operator=(const ScopedExportCallStats& stats) = delete;
+  ~ScopedExportCallStats() {
+    if (start_ticks_) {
+      RecordExportCall(index_, start_ticks_);
+    }
+  }
+
+ private:
+  uint32_t index_;
+  uint64_t start_ticks_;
+};
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_EXPORT_STATS_H_
@@ -10,7 +10,7 @@
 #include "xenia/kernel/util/object_table.h"
 
 #include <algorithm>
-#include <cstring>
+#include <new>
 
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/logging.h"
@@ -26,19 +26,24 @@ ObjectTable::ObjectTable() {}
 ObjectTable::~ObjectTable() { Reset(); }
 
 void ObjectTable::Reset() {
-  auto global_lock = global_critical_region_.Acquire();
+  std::vector<XObject*> removed_objects;
+  auto lock = critical_region_.Acquire();
 
-  // Release all objects.
+  // Unpublish the tables, then release all objects.
+  const TableView* view = table_view_.exchange(nullptr);
+  const TableView* host_view = host_table_view_.exchange(nullptr);
   for (uint32_t n = 0; n < table_capacity_; n++) {
     ObjectTableEntry& entry = table_[n];
-    if (entry.object) {
-      entry.object->Release();
+    XObject* object = entry.object.load(std::memory_order_relaxed);
+    if (object) {
+      removed_objects.push_back(object);
     }
   }
   for (uint32_t n = 0; n < host_table_capacity_; n++) {
     ObjectTableEntry& entry = host_table_[n];
-    if (entry.object) {
-      entry.object->Release();
+    XObject* object = entry.object.load(std::memory_order_relaxed);
+    if (object) {
+      removed_objects.push_back(object);
     }
   }
 
@@ -46,10 +51,16 @@ void ObjectTable::Reset() {
   host_table_capacity_ = 0;
   last_free_entry_ = 0;
   last_free_host_entry_ = 0;
-  free(table_);
+  RetireTable(table_, view);
   table_ = nullptr;
-  free(host_table_);
+  RetireTable(host_table_, host_view);
   host_table_ = nullptr;
+
+  lock.unlock();
+  for (XObject* object : removed_objects) {
+    RetireObjectReference(object);
+  }
+  reclamation_domain_.Reclaim();
 }
 
 X_STATUS ObjectTable::FindFreeSlot(uint32_t* out_slot, bool host) {
@@ -59,7 +70,7 @@ X_STATUS ObjectTable::FindFreeSlot(uint32_t* out_slot, bool host) {
   uint32_t scan_count = 0;
   while (scan_count < capacity) {
     ObjectTableEntry& entry = host ? host_table_[slot] : table_[slot];
-    if (!entry.object) {
+    if (!entry.object.load(std::memory_order_relaxed)) {
       *out_slot = slot;
       return X_STATUS_SUCCESS;
     }
@@ -87,18 +98,17 @@ X_STATUS ObjectTable::FindFreeSlot(uint32_t* out_slot, bool host) {
 
 bool ObjectTable::Resize(uint32_t new_capacity, bool host) {
   uint32_t capacity = host ? host_table_capacity_ : table_capacity_;
-  uint32_t new_size = new_capacity * sizeof(ObjectTableEntry);
-  uint32_t old_size = capacity * sizeof(ObjectTableEntry);
-  auto new_table = reinterpret_cast<ObjectTableEntry*>(
-      realloc(host ? host_table_ : table_, new_size));
+  ObjectTableEntry* old_table = host ? host_table_ : table_;
+  // Not reallocated in place since lookups may be reading the old table.
+  auto new_table = new (std::nothrow) ObjectTableEntry[new_capacity];
   if (!new_table) {
     return false;
   }
-
-  // Zero out new entries.
-  if (new_size > old_size) {
-    std::memset(reinterpret_cast<uint8_t*>(new_table) + old_size, 0,
-                new_size - old_size);
+  for (uint32_t i = 0; i < std::min(capacity, new_capacity); ++i) {
+    new_table[i].handle_ref_count = old_table[i].handle_ref_count;
+    new_table[i].object.store(
+        old_table[i].object.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
   }
 
   if (host) {
@@ -111,15 +121,53 @@ bool ObjectTable::Resize(uint32_t new_capacity, bool host) {
     table_ = new_table;
   }
 
+  const TableView* old_view = (host ? host_table_view_ : table_view_)
+                                  .load(std::memory_order_relaxed);
+  PublishTable(host);
+  RetireTable(old_table, old_view);
   return true;
 }
 
+void ObjectTable::PublishTable(bool host) {
+  auto view = new TableView;
+  view->entries = host ? host_table_ : table_;
+  view->capacity = host ? host_table_capacity_ : table_capacity_;
+  (host ? host_table_view_ : table_view_)
+      .store(view, std::memory_order_release);
+}
+
+void ObjectTable::RetireTable(ObjectTableEntry* table,
+                              const TableView* view) {
+  if (!table && !view) {
+    return;
+  }
+  // Retired with the table lock held, while reclaiming may release objects
+  // retired earlier, so the callers reclaim after releasing the lock.
+  reclamation_domain_.Retire(
+      [table, view]() {
+        delete view;
+        delete[] table;
+      },
+      false);
+}
+
+void ObjectTable::RetireObjectReference(XObject* object) {
+  // Likely released immediately, but if not, the object may be destroyed on
+  // the thread of the last lookup that could have seen it, with the global
+  // lock held like when it's released directly. Must not be called with the
+  // table lock held, as the global lock may not be acquired after it.
+  reclamation_domain_.Retire([object]() {
+    auto global_lock = global_critical_region::AcquireDirect();
+    object->Release();
+  });
+}
+
 X_STATUS ObjectTable::AddHandle(XObject* object, X_HANDLE* out_handle) {
   X_STATUS result = X_STATUS_SUCCESS;
 
   uint32_t handle = 0;
   {
-    auto global_lock = global_critical_region_.Acquire();
+    auto lock = critical_region_.Acquire();
 
     // Find a free slot.
     uint32_t slot = 0;
@@ -129,7 +177,6 @@ X_STATUS ObjectTable::AddHandle(XObject* object, X_HANDLE* out_handle) {
     // Stash.
     if (XSUCCEEDED(result)) {
       ObjectTableEntry& entry = host_object ? host_table_[slot] : table_[slot];
-      entry.object = object;
       entry.handle_ref_count = 1;
       handle = slot << 2;
       if (!host_object) {
@@ -143,11 +190,15 @@ X_STATUS ObjectTable::AddHandle(XObject* object, X_HANDLE* out_handle) {
 
       // Retain so long as the object is in the table.
       object->Retain();
+      entry.object.store(object, std::memory_order_release);
 
       XELOGI("Added handle:{:08X} for {}", handle, typeid(*object).name());
     }
   }
 
+  // The old table may have been retired if the table has been resized.
+  reclamation_domain_.Reclaim();
+
   if (XSUCCEEDED(result)) {
     if (out_handle) {
       *out_handle = handle;
@@ -173,7 +224,7 @@ X_STATUS ObjectTable::DuplicateHandle(X_HANDLE handle, X_HANDLE* out_handle) {
 }
 
 X_STATUS ObjectTable::RetainHandle(X_HANDLE handle) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
 
   ObjectTableEntry* entry = LookupTableInLock(handle);
   if (!entry) {
@@ -185,42 +236,58 @@ X_STATUS ObjectTable::RetainHandle(X_HANDLE handle) {
 }
 
 X_STATUS ObjectTable::ReleaseHandle(X_HANDLE handle) {
-  auto global_lock = global_critical_region_.Acquire();
-
   return ReleaseHandleInLock(handle);
 }
 X_STATUS ObjectTable::ReleaseHandleInLock(X_HANDLE handle) {
-  ObjectTableEntry* entry = LookupTableInLock(handle);
-  if (!entry) {
-    return X_STATUS_INVALID_HANDLE;
-  }
+  XObject* removed_object = nullptr;
+  X_STATUS result = X_STATUS_SUCCESS;
+  {
+    auto lock = critical_region_.Acquire();
+    ObjectTableEntry* entry = LookupTableInLock(handle);
+    if (!entry) {
+      return X_STATUS_INVALID_HANDLE;
+    }
 
-  if (--entry->handle_ref_count == 0) {
-    // No more references. Remove it from the table.
-    return RemoveHandle(handle);
+    if (--entry->handle_ref_count == 0) {
+      // No more references. Remove it from the table.
+      result = RemoveHandleInLock(handle, removed_object);
+    }
+  }
+  if (removed_object) {
+    RetireObjectReference(removed_object);
   }
 
   // FIXME: Return a status code telling the caller it wasn't released
   // (but not a failure code)
-  return X_STATUS_SUCCESS;
+  return result;
 }
 X_STATUS ObjectTable::RemoveHandle(X_HANDLE handle) {
-  X_STATUS result = X_STATUS_SUCCESS;
-
+  XObject* removed_object = nullptr;
+  X_STATUS result;
+  {
+    auto lock = critical_region_.Acquire();
+    result = RemoveHandleInLock(handle, removed_object);
+  }
+  if (removed_object) {
+    RetireObjectReference(removed_object);
+  }
+  return result;
+}
+X_STATUS ObjectTable::RemoveHandleInLock(X_HANDLE handle,
+                                         XObject*& removed_object) {
   handle = TranslateHandle(handle);
   if (!handle) {
     return X_STATUS_INVALID_HANDLE;
   }
-  auto global_lock = global_critical_region_.Acquire();
 
   ObjectTableEntry* entry = LookupTableInLock(handle);
   if (!entry) {
     return X_STATUS_INVALID_HANDLE;
   }
 
-  if (entry->object) {
-    auto object = entry->object;
-    entry->object = nullptr;
+  auto object = entry->object.load(std::memory_order_relaxed);
+  if (object) {
+    entry->object.store(nullptr, std::memory_order_relaxed);
     assert_zero(entry->handle_ref_count);
     entry->handle_ref_count = 0;
 
@@ -237,31 +304,32 @@ X_STATUS ObjectTable::RemoveHandle(X_HANDLE handle) {
     if (!object->name().empty()) {
       RemoveNameMapping(object->name());
     }
-    // Release now that the object has been removed from the table.
-    object->Release();
+    // Released by the caller once the lock is released.
+    removed_object = object;
   }
 
   return X_STATUS_SUCCESS;
 }
 
 std::vector<object_ref<XObject>> ObjectTable::GetAllObjects() {
-  auto lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   std::vector<object_ref<XObject>> results;
 
   for (uint32_t slot = 0; slot < host_table_capacity_; slot++) {
-    auto& entry = host_table_[slot];
-    if (entry.object && std::find(results.begin(), results.end(),
-                                  entry.object) == results.end()) {
-      entry.object->Retain();
-      results.push_back(object_ref<XObject>(entry.object));
+    XObject* object =
+        host_table_[slot].object.load(std::memory_order_relaxed);
+    if (object && std::find(results.begin(), results.end(), object) ==
+                      results.end()) {
+      object->Retain();
+      results.push_back(object_ref<XObject>(object));
     }
   }
   for (uint32_t slot = 0; slot < table_capacity_; slot++) {
-    auto& entry = table_[slot];
-    if (entry.object && std::find(results.begin(), results.end(),
-                                  entry.object) == results.end()) {
-      entry.object->Retain();
-      results.push_back(object_ref<XObject>(entry.object));
+    XObject* object = table_[slot].object.load(std::memory_order_relaxed);
+    if (object && std::find(results.begin(), results.end(), object) ==
+                      results.end()) {
+      object->Retain();
+      results.push_back(object_ref<XObject>(object));
     }
   }
 
@@ -269,20 +337,26 @@ std::vector<object_ref<XObject>> ObjectTable::GetAllObjects() {
 }
 
 void ObjectTable::PurgeAllObjects() {
-  auto lock = global_critical_region_.Acquire();
-  for (uint32_t slot = 0; slot < table_capacity_; slot++) {
-    auto& entry = table_[slot];
-    if (entry.object) {
-      entry.handle_ref_count = 0;
-      entry.object->Release();
-
-      entry.object = nullptr;
+  std::vector<XObject*> removed_objects;
+  {
+    auto lock = critical_region_.Acquire();
+    for (uint32_t slot = 0; slot < table_capacity_; slot++) {
+      auto& entry = table_[slot];
+      XObject* object = entry.object.load(std::memory_order_relaxed);
+      if (object) {
+        entry.handle_ref_count = 0;
+        entry.object.store(nullptr, std::memory_order_relaxed);
+        removed_objects.push_back(object);
+      }
     }
   }
+  for (XObject* object : removed_objects) {
+    RetireObjectReference(object);
+  }
 }
 
 ObjectTable::ObjectTableEntry* ObjectTable::LookupTable(X_HANDLE handle) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   return LookupTableInLock(handle);
 }
 
@@ -320,27 +394,25 @@ XObject* ObjectTable::LookupObject(X_HANDLE handle, bool already_locked) {
     return nullptr;
   }
 
-  XObject* object = nullptr;
-  if (!already_locked) {
-    global_critical_region_.mutex().lock();
+  // The table and the object are kept alive by the reclamation domain while
+  // pinned, or by the lock if too many threads are doing lookups at once.
+  // The table lock is separate from the global lock held by the callers
+  // passing already_locked, and is recursive, so it's taken for them too.
+  EpochDomain::Reader reader(reclamation_domain_);
+  auto lock = critical_region_.AcquireDeferred();
+  if (!reader.is_pinned()) {
+    lock.lock();
   }
 
   const bool is_host_object = XObject::is_handle_host_object(handle);
   uint32_t slot = GetHandleSlot(handle, is_host_object);
 
   // Verify slot.
-  if (is_host_object) {
-    if (slot < host_table_capacity_) {
-      ObjectTableEntry& entry = host_table_[slot];
-      if (entry.object) {
-        object = entry.object;
-      }
-    }
-  } else if (slot < table_capacity_) {
-    ObjectTableEntry& entry = table_[slot];
-    if (entry.object) {
-      object = entry.object;
-    }
+  XObject* object = nullptr;
+  const TableView* view = (is_host_object ? host_table_view_ : table_view_)
+                              .load(std::memory_order_acquire);
+  if (view && slot < view->capacity) {
+    object = view->entries[slot].object.load(std::memory_order_acquire);
   }
 
   // Retain the object pointer.
@@ -348,31 +420,28 @@ XObject* ObjectTable::LookupObject(X_HANDLE handle, bool already_locked) {
     object->Retain();
   }
 
-  if (!already_locked) {
-    global_critical_region_.mutex().unlock();
-  }
-
   return object;
 }
 
 void ObjectTable::GetObjectsByType(XObject::Type type,
                                    std::vector<object_ref<XObject>>* results) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   for (uint32_t slot = 0; slot < host_table_capacity_; ++slot) {
-    auto& entry = host_table_[slot];
-    if (entry.object) {
-      if (entry.object->type() == type) {
-        entry.object->Retain();
-        results->push_back(object_ref<XObject>(entry.object));
+    XObject* object =
+        host_table_[slot].object.load(std::memory_order_relaxed);
+    if (object) {
+      if (object->type() == type) {
+        object->Retain();
+        results->push_back(object_ref<XObject>(object));
       }
     }
   }
   for (uint32_t slot = 0; slot < table_capacity_; ++slot) {
-    auto& entry = table_[slot];
-    if (entry.object) {
-      if (entry.object->type() == type) {
-        entry.object->Retain();
-        results->push_back(object_ref<XObject>(entry.object));
+    XObject* object = table_[slot].object.load(std::memory_order_relaxed);
+    if (object) {
+      if (object->type() == type) {
+        object->Retain();
+        results->push_back(object_ref<XObject>(object));
       }
     }
   }
@@ -392,7 +461,7 @@ X_HANDLE ObjectTable::TranslateHandle(X_HANDLE handle) {
 
 X_STATUS ObjectTable::AddNameMapping(const std::string_view name,
                                      X_HANDLE handle) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   if (name_table_.count(string_key_case(name))) {
     return X_STATUS_OBJECT_NAME_COLLISION;
   }
@@ -402,7 +471,7 @@ X_STATUS ObjectTable::AddNameMapping(const std::string_view name,
 
 void ObjectTable::RemoveNameMapping(const std::string_view name) {
   // Names are case-insensitive.
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   auto it = name_table_.find(string_key_case(name));
   if (it != name_table_.end()) {
     name_table_.erase(it);
@@ -412,16 +481,21 @@ void ObjectTable::RemoveNameMapping(const std::string_view name) {
 X_STATUS ObjectTable::GetObjectByName(const std::string_view name,
                                       X_HANDLE* out_handle) {
   // Names are case-insensitive.
-  auto global_lock = global_critical_region_.Acquire();
-  auto it = name_table_.find(string_key_case(name));
-  if (it == name_table_.end()) {
-    *out_handle = X_INVALID_HANDLE_VALUE;
-    return X_STATUS_OBJECT_NAME_NOT_FOUND;
+  X_HANDLE handle;
+  {
+    auto lock = critical_region_.Acquire();
+    auto it = name_table_.find(string_key_case(name));
+    if (it == name_table_.end()) {
+      *out_handle = X_INVALID_HANDLE_VALUE;
+      return X_STATUS_OBJECT_NAME_NOT_FOUND;
+    }
+    handle = it->second;
   }
-  *out_handle = it->second;
+  *out_handle = handle;
 
   // We need to ref the handle. I think.
-  auto obj = LookupObject(it->second, true);
+  // Released without the table lock held, as it may destroy the object.
+  auto obj = LookupObject(handle, true);
   if (obj) {
     obj->RetainHandle();
     obj->Release();
@@ -461,6 +535,7 @@ bool ObjectTable::Restore(ByteStream* stream) {
     entry.handle_ref_count = stream->Read<int32_t>();
   }
 
+  reclamation_domain_.Reclaim();
   return true;
 }
 
@@ -472,8 +547,8 @@ X_STATUS ObjectTable::RestoreHandle(X_HANDLE handle, XObject* object) {
 
   if (capacity >= slot) {
     auto& entry = is_host_object ? host_table_[slot] : table_[slot];
-    entry.object = object;
     object->Retain();
+    entry.object.store(object, std::memory_order_release);
   }
 
   return X_STATUS_SUCCESS;
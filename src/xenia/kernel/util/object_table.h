@@ -10,10 +10,12 @@
 #ifndef XENIA_KERNEL_UTIL_OBJECT_TABLE_H_
 #define XENIA_KERNEL_UTIL_OBJECT_TABLE_H_
 
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "xenia/base/epoch.h"
 #include "xenia/base/mutex.h"
 #include "xenia/base/string_key.h"
 #include "xenia/kernel/xobject.h"
@@ -83,9 +85,21 @@ class ObjectTable {
  private:
   struct ObjectTableEntry {
     int handle_ref_count = 0;
-    XObject* object = nullptr;
+    // Written with the lock held, read without it by LookupObject.
+    std::atomic<XObject*> object{nullptr};
+  };
+  // A table and its capacity published together for LookupObject, which
+  // doesn't take the lock. Replaced tables and views, and the table's
+  // references to the objects removed from it, are released through the
+  // reclamation domain once no lookup may be accessing them anymore.
+  struct TableView {
+    ObjectTableEntry* entries;
+    uint32_t capacity;
   };
   ObjectTableEntry* LookupTableInLock(X_HANDLE handle);
+  // The object must be released by the caller through RetireObjectReference
+  // after releasing the lock.
+  X_STATUS RemoveHandleInLock(X_HANDLE handle, XObject*& removed_object);
   ObjectTableEntry* LookupTable(X_HANDLE handle);
   XObject* LookupObject(X_HANDLE handle, bool already_locked);
   void GetObjectsByType(XObject::Type type,
@@ -98,8 +112,13 @@ class ObjectTable {
   }
   X_STATUS FindFreeSlot(uint32_t* out_slot, bool host);
   bool Resize(uint32_t new_capacity, bool host);
+  void PublishTable(bool host);
+  void RetireTable(ObjectTableEntry* table, const TableView* view);
+  void RetireObjectReference(XObject* object);
 
-  xe::global_critical_region global_critical_region_;
+  // Not the global critical region, so handle operations don't wait for
+  // unrelated kernel work. Objects aren't released with it held.
+  xe::subsystem_critical_region critical_region_;
   uint32_t table_capacity_ = 0;
   uint32_t host_table_capacity_ = 0;
   ObjectTableEntry* table_ = nullptr;
@@ -107,6 +126,9 @@ class ObjectTable {
   uint32_t last_free_entry_ = 0;
   uint32_t last_free_host_entry_ = 0;
   std::unordered_map<string_key_case, X_HANDLE> name_table_;
+  std::atomic<const TableView*> table_view_{nullptr};
+  std::atomic<const TableView*> host_table_view_{nullptr};
+  EpochDomain reclamation_domain_;
 };
 
 // Generic lookup
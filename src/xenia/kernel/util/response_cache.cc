@@ -0,0 +1,148 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/response_cache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace xe {
+namespace kernel {
+
+response_data ResponseCache::Fetch(const std::string& key,
+                                   std::chrono::milliseconds ttl,
+                                   FetchFunction fetch) {
+  if (ttl.count() <= 0) {
+    return fetch();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto entry_it = entries_.find(key);
+  if (entry_it != entries_.end()) {
+    Entry& entry = entry_it->second;
+    auto age = std::chrono::steady_clock::now() - entry.fetch_time;
+    if (age < ttl) {
+      return CopyResponse(entry.response);
+    }
+    if (age < ttl * 2) {
+      if (!entry.refreshing) {
+        entry.refreshing = true;
+        std::thread(&ResponseCache::Refresh, this, key, std::move(fetch))
+            .detach();
+      }
+      return CopyResponse(entry.response);
+    }
+    entries_.erase(entry_it);
+  }
+
+  auto pending_it = pending_.find(key);
+  if (pending_it != pending_.end()) {
+    std::shared_future<Response> pending_response = pending_it->second;
+    lock.unlock();
+    return CopyResponse(pending_response.get());
+  }
+
+  std::promise<Response> promise;
+  pending_.emplace(key, promise.get_future().share());
+  uint64_t generation = generation_;
+  lock.unlock();
+
+  response_data chunk = fetch();
+  Response response = CopyResponse(chunk);
+
+  lock.lock();
+  if (IsCacheable(response) && generation == generation_) {
+    Entry& entry = entries_[key];
+    entry.response = response;
+    entry.fetch_time = std::chrono::steady_clock::now();
+    entry.refreshing = false;
+  }
+  pending_.erase(key);
+  lock.unlock();
+
+  promise.set_value(std::move(response));
+  return chunk;
+}
+
+void ResponseCache::Invalidate(std::string_view key_prefix) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.lower_bound(std::string(key_prefix));
+  while (it != entries_.end() &&
+         std::string_view(it->first).substr(0, key_prefix.size()) ==
+             key_prefix) {
+    it = entries_.erase(it);
+  }
+  ++generation_;
+}
+
+void ResponseCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  ++generation_;
+}
+
+ResponseCache::Response ResponseCache::CopyResponse(
+    const response_data& chunk) {
+  Response response;
+  if (chunk.response) {
+    response.body.assign(chunk.response, chunk.size);
+    response.has_body = true;
+  }
+  response.http_code = chunk.http_code;
+  return response;
+}
+
+response_data ResponseCache::CopyResponse(const Response& response) {
+  response_data chunk = {};
+  if (response.has_body) {
+    chunk.response = static_cast<char*>(std::malloc(response.body.size() + 1));
+    if (chunk.response) {
+      std::memcpy(chunk.response, response.body.data(), response.body.size());
+      chunk.response[response.body.size()] = 0;
+      chunk.size = response.body.size();
+    }
+  }
+  chunk.http_code = response.http_code;
+  return chunk;
+}
+
+bool ResponseCache::IsCacheable(const Response& response) {
+  return response.http_code == HTTP_STATUS_CODE::HTTP_OK ||
+         response.http_code == HTTP_STATUS_CODE::HTTP_CREATED ||
+         response.http_code == HTTP_STATUS_CODE::HTTP_NO_CONTENT;
+}
+
+void ResponseCache::Refresh(std::string key, FetchFunction fetch) {
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation = generation_;
+  }
+
+  response_data chunk = fetch();
+  Response response = CopyResponse(chunk);
+  std::free(chunk.response);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto entry_it = entries_.find(key);
+  if (entry_it == entries_.end()) {
+    return;
+  }
+  Entry& entry = entry_it->second;
+  if (IsCacheable(response) && generation == generation_) {
+    entry.response = std::move(response);
+    entry.fetch_time = std::chrono::steady_clock::now();
+  }
+  // If the refresh failed, the stale response is dropped when it expires.
+  entry.refreshing = false;
+}
+
+}  // namespace kernel
+}  // namespace xe
@@ -0,0 +1,78 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_RESPONSE_CACHE_H_
+#define XENIA_KERNEL_UTIL_RESPONSE_CACHE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "xenia/kernel/util/net_utils.h"
+
+namespace xe {
+namespace kernel {
+
+// Successful responses of the server for the queries titles repeat, such as
+// session searches and QoS lookups. A response is reused for the time to live
+// after it was fetched, and for as long again while it's refreshed in the
+// background, after which the query waits for the server again. Identical
+// queries made while one is waiting for the server wait for its response
+// instead of sending their own.
+class ResponseCache {
+ public:
+  using FetchFunction = std::function<response_data()>;
+
+  // The fetch function may be called on another thread, after this returns,
+  // so it must not refer to the state of the caller. The response is owned by
+  // the caller. Not cached if the time to live is zero.
+  response_data Fetch(const std::string& key, std::chrono::milliseconds ttl,
+                      FetchFunction fetch);
+
+  // Drops the responses of the keys starting with the prefix, and the
+  // responses of the fetches in progress, after a change made by this client.
+  void Invalidate(std::string_view key_prefix);
+  void Clear();
+
+ private:
+  struct Response {
+    std::string body;
+    bool has_body = false;
+    uint64_t http_code = 0;
+  };
+  struct Entry {
+    Response response;
+    std::chrono::steady_clock::time_point fetch_time;
+    bool refreshing = false;
+  };
+
+  static Response CopyResponse(const response_data& chunk);
+  static response_data CopyResponse(const Response& response);
+  static bool IsCacheable(const Response& response);
+
+  void Refresh(std::string key, FetchFunction fetch);
+
+  std::mutex mutex_;
+  // Ordered for invalidating by prefix.
+  std::map<std::string, Entry> entries_;
+  std::map<std::string, std::shared_future<Response>> pending_;
+  // Incremented by the invalidation, for not storing the responses of the
+  // fetches that were in progress.
+  uint64_t generation_ = 0;
+};
+
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_RESPONSE_CACHE_H_
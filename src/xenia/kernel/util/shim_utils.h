@@ -23,6 +23,7 @@
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/kernel/kernel_flags.h"
 #include "xenia/kernel/kernel_state.h"
+#include "xenia/kernel/util/export_stats.h"
 
 namespace xe {
 namespace kernel {
@@ -500,6 +501,18 @@ enum class KernelModuleId {
   xbdm,
 };
 
+constexpr const char* GetKernelModuleName(KernelModuleId module) {
+  switch (module) {
+    case KernelModuleId::xboxkrnl:
+      return "xboxkrnl";
+    case KernelModuleId::xam:
+      return "xam";
+    case KernelModuleId::xbdm:
+      return "xbdm";
+  }
+  return "";
+}
+
 template <size_t I = 0, typename... Ps>
 typename std::enable_if<I == sizeof...(Ps)>::type AppendKernelCallParams(
     StringBuffer& string_buffer, xe::cpu::Export* export_entry,
@@ -562,8 +575,11 @@ struct ExportRegistrerHelper {
 
     static const auto export_entry =
         new cpu::Export(ORDINAL, xe::cpu::Export::Type::kFunction, name, TAGS);
+    static const uint32_t stats_index =
+        util::RegisterExportStats(GetKernelModuleName(MODULE), export_entry);
     struct X {
       static void Trampoline(PPCContext* ppc_context) {
+        util::ScopedExportCallStats call_stats(stats_index);
         Param::Init init = {
             ppc_context,
             0,
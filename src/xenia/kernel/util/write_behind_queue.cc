@@ -0,0 +1,139 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/write_behind_queue.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace kernel {
+
+WriteBehindQueue::WriteBehindQueue(std::chrono::milliseconds delay)
+    : delay_(delay) {
+  thread_ = std::thread(&WriteBehindQueue::ThreadMain, this);
+}
+
+WriteBehindQueue::~WriteBehindQueue() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  cond_.notify_all();
+  thread_.join();
+}
+
+void WriteBehindQueue::Write(const std::filesystem::path& path,
+                             std::vector<uint8_t> data) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(path);
+    if (it != pending_.end()) {
+      // Keeping the time of the first write, so files written over and over
+      // still reach the disk after the delay.
+      it->second.data = std::move(data);
+      return;
+    }
+    pending_.emplace(path,
+                     PendingWrite{std::move(data),
+                                  std::chrono::steady_clock::now()});
+  }
+  cond_.notify_all();
+}
+
+bool WriteBehindQueue::GetPending(const std::filesystem::path& path,
+                                  std::vector<uint8_t>& data_out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = pending_.find(path);
+  if (it == pending_.end()) {
+    it = writing_.find(path);
+    if (it == writing_.end()) {
+      return false;
+    }
+  }
+  data_out = it->second.data;
+  return true;
+}
+
+void WriteBehindQueue::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (pending_.empty() && writing_.empty()) {
+    return;
+  }
+  flush_requested_ = true;
+  cond_.notify_all();
+  cond_.wait(lock, [this]() { return pending_.empty() && writing_.empty(); });
+}
+
+void WriteBehindQueue::WriteFile(const std::filesystem::path& path,
+                                 const std::vector<uint8_t>& data) {
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  FILE* file = xe::filesystem::OpenFile(path, "wb");
+  if (!file) {
+    XELOGE("WriteBehindQueue: Failed to open {} for writing",
+           xe::path_to_utf8(path));
+    return;
+  }
+  if (!data.empty() &&
+      fwrite(data.data(), 1, data.size(), file) != data.size()) {
+    XELOGE("WriteBehindQueue: Failed to write {}", xe::path_to_utf8(path));
+  }
+  fclose(file);
+}
+
+void WriteBehindQueue::ThreadMain() {
+  xe::threading::set_name("Write Behind Queue");
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (pending_.empty()) {
+      flush_requested_ = false;
+      if (!running_) {
+        break;
+      }
+      cond_.wait(lock);
+      continue;
+    }
+
+    // Everything is written when flushing or shutting down, otherwise only
+    // the files queued for longer than the delay.
+    bool write_all = flush_requested_ || !running_;
+    auto now = std::chrono::steady_clock::now();
+    auto next_due = std::chrono::steady_clock::time_point::max();
+    for (auto it = pending_.begin(); it != pending_.end();) {
+      auto due = it->second.queue_time + delay_;
+      if (write_all || due <= now) {
+        writing_.insert(pending_.extract(it++));
+      } else {
+        next_due = std::min(next_due, due);
+        ++it;
+      }
+    }
+    if (writing_.empty()) {
+      cond_.wait_until(lock, next_due);
+      continue;
+    }
+
+    lock.unlock();
+    for (const auto& write : writing_) {
+      WriteFile(write.first, write.second.data);
+    }
+    lock.lock();
+    writing_.clear();
+    cond_.notify_all();
+  }
+}
+
+}  // namespace kernel
+}  // namespace xe
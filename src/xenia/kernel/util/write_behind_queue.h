@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_WRITE_BEHIND_QUEUE_H_
+#define XENIA_KERNEL_UTIL_WRITE_BEHIND_QUEUE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xe {
+namespace kernel {
+
+// Host files written by a background thread some time after they're queued,
+// so the guest threads saving them (profile settings written by titles, for
+// instance) don't wait for the disk. Writes of the same file queued before it's
+// written replace each other, only the last one is written. The queued
+// contents must be read through GetPending, as the file on the disk may be
+// outdated until it's written.
+class WriteBehindQueue {
+ public:
+  explicit WriteBehindQueue(std::chrono::milliseconds delay);
+  WriteBehindQueue(const WriteBehindQueue& queue) = delete;
+  WriteBehindQueue& operator=(const WriteBehindQueue& queue) = delete;
+  // Writes all the files still queued.
+  ~WriteBehindQueue();
+
+  // The directories of the path are created when the file is written.
+  void Write(const std::filesystem::path& path, std::vector<uint8_t> data);
+  // Returns whether the file has been queued and not written yet, with the
+  // contents that will be written.
+  bool GetPending(const std::filesystem::path& path,
+                  std::vector<uint8_t>& data_out) const;
+  // Writes the queued files now, returning after they're written.
+  void Flush();
+
+ private:
+  struct PendingWrite {
+    std::vector<uint8_t> data;
+    std::chrono::steady_clock::time_point queue_time;
+  };
+
+  static void WriteFile(const std::filesystem::path& path,
+                        const std::vector<uint8_t>& data);
+  void ThreadMain();
+
+  std::chrono::milliseconds delay_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::map<std::filesystem::path, PendingWrite> pending_;
+  // Taken from pending_ by the thread while it's writing them.
+  std::map<std::filesystem::path, PendingWrite> writing_;
+  bool flush_requested_ = false;
+  bool running_ = true;
+  std::thread thread_;
+};
+
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_WRITE_BEHIND_QUEUE_H_
@@ -74,8 +74,18 @@ X_HRESULT AppManager::DispatchMessageAsync(uint32_t app_id, uint32_t message,
   };
 
   if (overlapped_ptr) {
-    it->second->kernel_state_->CompleteOverlappedDeferred(run, overlapped_ptr,
-                                                          nullptr, post);
+    App* app = it->second;
+    if (app->uses_network()) {
+      app->kernel_state_->CompleteOverlappedAsync(
+          [app, run]() -> X_RESULT {
+            std::lock_guard<std::mutex> lock(app->async_message_mutex_);
+            return run();
+          },
+          overlapped_ptr, post);
+    } else {
+      app->kernel_state_->CompleteOverlappedDeferred(run, overlapped_ptr,
+                                                     nullptr, post);
+    }
     return X_ERROR_IO_PENDING;
   };
 
@@ -12,6 +12,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -34,6 +35,9 @@ class App {
 
   virtual X_HRESULT DispatchMessageSync(uint32_t message, uint32_t buffer_ptr,
                                         uint32_t buffer_length) = 0;
+  // Whether messages may wait for requests to the online service, in which
+  // case the asynchronous ones are completed on the I/O threads.
+  virtual bool uses_network() const { return false; }
 
   virtual ~App() = default;
   KernelState* kernel_state_;
@@ -43,6 +47,12 @@ class App {
 
   Memory* memory_;
   uint32_t app_id_;
+
+ private:
+  friend class AppManager;
+  // Asynchronous messages of an app using the network are still handled one at
+  // a time, as on the dispatch thread.
+  std::mutex async_message_mutex_;
 };
 
 class AppManager {
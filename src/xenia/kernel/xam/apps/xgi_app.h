@@ -24,6 +24,7 @@ class XgiApp : public App {
 
   X_HRESULT DispatchMessageSync(uint32_t message, uint32_t buffer_ptr,
                                 uint32_t buffer_length) override;
+  bool uses_network() const override { return true; }
 };
 
 }  // namespace apps
@@ -9,6 +9,7 @@
 
 #include "xenia/kernel/xam/content_manager.h"
 
+#include <algorithm>
 #include <array>
 #include <string>
 #include <unordered_set>
@@ -20,8 +21,21 @@
 #include "xenia/kernel/xam/user_profile.h"
 #include "xenia/kernel/xfile.h"
 #include "xenia/kernel/xobject.h"
+#include "xenia/vfs/devices/content_archive_device.h"
 #include "xenia/vfs/devices/host_path_device.h"
 
+DEFINE_uint32(content_package_cache_size, 8,
+              "Number of recently closed content packages kept mounted, so "
+              "opening them again doesn't scan their directories. 0 disables "
+              "the cache.",
+              "Content");
+
+DEFINE_bool(content_archives, false,
+            "Store new content packages, such as saves, as single compressed "
+            "archives instead of directories. The existing directories are "
+            "still used.",
+            "Content");
+
 DECLARE_int32(license_mask);
 
 namespace xe {
@@ -31,19 +45,64 @@ namespace xam {
 static const char* kThumbnailFileName = "__thumbnail.png";
 static const char* kGameContentHeaderDirName = "Headers";
 
+static const char* kContentArchiveExtension = ".xcar";
+
 static int content_device_id_ = 0;
 
+// A package is stored either as a directory at the package path, or as an
+// archive next to it.
+static std::filesystem::path GetPackageArchivePath(
+    const std::filesystem::path& package_path) {
+  auto archive_path = package_path;
+  archive_path += kContentArchiveExtension;
+  return archive_path;
+}
+
+static bool IsArchivedPackage(const std::filesystem::path& package_path) {
+  if (std::filesystem::is_directory(package_path)) {
+    return false;
+  }
+  return cvars::content_archives ||
+         std::filesystem::exists(GetPackageArchivePath(package_path));
+}
+
+static bool PackageExists(const std::filesystem::path& package_path) {
+  return std::filesystem::exists(package_path) ||
+         std::filesystem::exists(GetPackageArchivePath(package_path));
+}
+
+static std::filesystem::path GetPackageThumbnailPath(
+    const std::filesystem::path& package_path) {
+  if (!IsArchivedPackage(package_path)) {
+    return package_path / kThumbnailFileName;
+  }
+  // Kept out of the archive as it's read without opening the package.
+  auto thumb_path = GetPackageArchivePath(package_path);
+  thumb_path += ".png";
+  return thumb_path;
+}
+
 ContentPackage::ContentPackage(KernelState* kernel_state,
                                const std::string_view root_name,
                                const XCONTENT_AGGREGATE_DATA& data,
                                const std::filesystem::path& package_path)
-    : kernel_state_(kernel_state), root_name_(root_name) {
+    : kernel_state_(kernel_state),
+      root_name_(root_name),
+      package_path_(package_path) {
   device_path_ = fmt::format("\\Device\\Content\\{0}\\", ++content_device_id_);
   content_data_ = data;
 
   auto fs = kernel_state_->file_system();
-  auto device =
-      std::make_unique<vfs::HostPathDevice>(device_path_, package_path, false);
+  std::unique_ptr<vfs::Device> device;
+  if (IsArchivedPackage(package_path)) {
+    auto archive_device = std::make_unique<vfs::ContentArchiveDevice>(
+        device_path_, GetPackageArchivePath(package_path));
+    archive_device_ = archive_device.get();
+    device = std::move(archive_device);
+  } else {
+    device = std::make_unique<vfs::HostPathDevice>(device_path_, package_path,
+                                                   false);
+  }
   device->Initialize();
   fs->RegisterDevice(std::move(device));
   fs->RegisterSymbolicLink(root_name_ + ":", device_path_);
@@ -51,10 +110,28 @@ ContentPackage::ContentPackage(KernelState* kernel_state,
 
 ContentPackage::~ContentPackage() {
   auto fs = kernel_state_->file_system();
-  fs->UnregisterSymbolicLink(root_name_ + ":");
+  if (!root_name_.empty()) {
+    fs->UnregisterSymbolicLink(root_name_ + ":");
+  }
   fs->UnregisterDevice(device_path_);
 }
 
+void ContentPackage::Close() {
+  if (archive_device_) {
+    archive_device_->Flush();
+  }
+  kernel_state_->file_system()->UnregisterSymbolicLink(root_name_ + ":");
+  root_name_.clear();
+}
+
+void ContentPackage::Reopen(const std::string_view root_name,
+                            const XCONTENT_AGGREGATE_DATA& data) {
+  root_name_ = root_name;
+  content_data_ = data;
+  kernel_state_->file_system()->RegisterSymbolicLink(root_name_ + ":",
+                                                     device_path_);
+}
+
 void ContentPackage::LoadPackageLicenseMask(
     const std::filesystem::path header_path) {
   license_ = cvars::license_mask;
@@ -130,7 +207,7 @@ std::filesystem::path ContentManager::ResolvePackagePath(
     for (const auto& title_id : title_ids) {
       auto package_path = get_package_path(title_id);
 
-      if (!std::filesystem::exists(package_path)) {
+      if (!PackageExists(package_path)) {
         continue;
       }
       return package_path;
@@ -202,6 +279,17 @@ std::unordered_set<uint32_t> ContentManager::FindPublisherTitleIds(
 std::vector<XCONTENT_AGGREGATE_DATA> ContentManager::ListContent(
     const uint32_t device_id, const uint64_t xuid, const uint32_t title_id,
     const XContentType content_type) const {
+  std::vector<XCONTENT_AGGREGATE_DATA> result =
+      ListContentPackages(device_id, xuid, title_id, content_type);
+  for (XCONTENT_AGGREGATE_DATA& content_data : result) {
+    ReadListedContentHeader(content_data);
+  }
+  return result;
+}
+
+std::vector<XCONTENT_AGGREGATE_DATA> ContentManager::ListContentPackages(
+    const uint32_t device_id, const uint64_t xuid, const uint32_t title_id,
+    const XContentType content_type) const {
   std::vector<XCONTENT_AGGREGATE_DATA> result;
 
   std::unordered_set<uint32_t> title_ids = {title_id};
@@ -217,49 +305,85 @@ std::vector<XCONTENT_AGGREGATE_DATA> ContentManager::ListContent(
     auto file_infos = xe::filesystem::ListFiles(package_root);
 
     for (const auto& file_info : file_infos) {
+      std::filesystem::path package_name = file_info.name;
       if (file_info.type != xe::filesystem::FileInfo::Type::kDirectory) {
-        // Directories only.
-        continue;
+        // Directories and archives only.
+        if (package_name.extension() != kContentArchiveExtension) {
+          continue;
+        }
+        package_name.replace_extension();
       }
 
       XCONTENT_AGGREGATE_DATA content_data;
-      if (XSUCCEEDED(ReadContentHeaderFile(xe::path_to_utf8(file_info.name),
-                                           xuid, title_id, content_type,
-                                           content_data))) {
-        result.emplace_back(std::move(content_data));
-      } else {
-        content_data.device_id = device_id;
-        content_data.content_type = content_type;
-        content_data.set_display_name(xe::path_to_utf16(file_info.name));
-        content_data.set_file_name(xe::path_to_utf8(file_info.name));
-        content_data.title_id = title_id;
-        content_data.xuid = xuid;
-        result.emplace_back(std::move(content_data));
-      }
+      content_data.device_id = device_id;
+      content_data.content_type = content_type;
+      content_data.set_display_name(xe::path_to_utf16(package_name));
+      content_data.set_file_name(xe::path_to_utf8(package_name));
+      content_data.title_id = title_id;
+      content_data.xuid = xuid;
+      result.emplace_back(std::move(content_data));
     }
   }
   return result;
 }
 
+void ContentManager::ReadListedContentHeader(
+    XCONTENT_AGGREGATE_DATA& data) const {
+  XCONTENT_AGGREGATE_DATA header_data;
+  if (XSUCCEEDED(ReadContentHeaderFile(data.file_name(), data.xuid,
+                                       data.title_id, data.content_type,
+                                       header_data))) {
+    data = header_data;
+  }
+}
+
 std::unique_ptr<ContentPackage> ContentManager::ResolvePackage(
     const std::string_view root_name, const uint64_t xuid,
     const XCONTENT_AGGREGATE_DATA& data, const uint32_t disc_number) {
   auto package_path = ResolvePackagePath(xuid, data, disc_number);
-  if (!std::filesystem::exists(package_path)) {
+  if (!PackageExists(package_path)) {
     return nullptr;
   }
 
   auto global_lock = global_critical_region_.Acquire();
 
-  auto package = std::make_unique<ContentPackage>(kernel_state_, root_name,
-                                                  data, package_path);
+  return OpenPackage(root_name, data, package_path);
+}
+
+std::unique_ptr<ContentPackage> ContentManager::OpenPackage(
+    const std::string_view root_name, const XCONTENT_AGGREGATE_DATA& data,
+    const std::filesystem::path& package_path) {
+  auto it = std::find_if(closed_packages_.begin(), closed_packages_.end(),
+                         [&package_path](const auto& package) {
+                           return package->package_path() == package_path;
+                         });
+  if (it == closed_packages_.end()) {
+    return std::make_unique<ContentPackage>(kernel_state_, root_name, data,
+                                            package_path);
+  }
+  auto package = std::move(*it);
+  closed_packages_.erase(it);
+  package->Reopen(root_name, data);
   return package;
 }
 
+void ContentManager::EvictClosedPackages(const std::filesystem::path& path) {
+  auto global_lock = global_critical_region_.Acquire();
+
+  closed_packages_.remove_if([&path](const auto& package) {
+    // Compared by components, so packages of other multi-disc titles sharing
+    // the prefix of the name are kept.
+    const auto& package_path = package->package_path();
+    return std::mismatch(path.begin(), path.end(), package_path.begin(),
+                         package_path.end())
+               .first == path.end();
+  });
+}
+
 bool ContentManager::ContentExists(const uint64_t xuid,
                                    const XCONTENT_AGGREGATE_DATA& data) {
   auto path = ResolvePackagePath(xuid, data);
-  return std::filesystem::exists(path);
+  return PackageExists(path);
 }
 
 X_RESULT ContentManager::WriteContentHeaderFile(const uint64_t xuid,
@@ -337,12 +461,16 @@ X_RESULT ContentManager::CreateContent(const std::string_view root_name,
   }
 
   auto package_path = ResolvePackagePath(xuid, data);
-  if (std::filesystem::exists(package_path)) {
+  if (PackageExists(package_path)) {
     // Exists, must not!
     return X_ERROR_ALREADY_EXISTS;
   }
+  // Deleted on the host since it was closed.
+  EvictClosedPackages(package_path);
 
-  if (!std::filesystem::create_directories(package_path)) {
+  // Archives are created by their devices.
+  if (!cvars::content_archives &&
+      !std::filesystem::create_directories(package_path)) {
     return X_ERROR_ACCESS_DENIED;
   }
 
@@ -367,7 +495,7 @@ X_RESULT ContentManager::OpenContent(const std::string_view root_name,
   }
 
   auto package_path = ResolvePackagePath(xuid, data, disc_number);
-  if (!std::filesystem::exists(package_path)) {
+  if (!PackageExists(package_path)) {
     // Does not exist, must be created.
     return X_ERROR_FILE_NOT_FOUND;
   }
@@ -395,9 +523,16 @@ X_RESULT ContentManager::CloseContent(const std::string_view root_name) {
   }
   CloseOpenedFilesFromContent(root_name);
 
-  auto package = it->second;
+  auto package = std::unique_ptr<ContentPackage>(it->second);
   open_packages_.erase(it);
-  delete package;
+  if (!cvars::content_package_cache_size) {
+    return X_ERROR_SUCCESS;
+  }
+  package->Close();
+  closed_packages_.push_front(std::move(package));
+  if (closed_packages_.size() > cvars::content_package_cache_size) {
+    closed_packages_.pop_back();
+  }
 
   return X_ERROR_SUCCESS;
 }
@@ -408,7 +543,7 @@ X_RESULT ContentManager::GetContentThumbnail(
   auto global_lock = global_critical_region_.Acquire();
 
   auto package_path = ResolvePackagePath(xuid, data);
-  auto thumb_path = package_path / kThumbnailFileName;
+  auto thumb_path = GetPackageThumbnailPath(package_path);
   if (std::filesystem::exists(thumb_path)) {
     auto file = xe::filesystem::OpenFile(thumb_path, "rb");
     size_t file_len = std::filesystem::file_size(thumb_path);
@@ -426,9 +561,11 @@ X_RESULT ContentManager::SetContentThumbnail(
     std::vector<uint8_t> buffer) {
   auto global_lock = global_critical_region_.Acquire();
   auto package_path = ResolvePackagePath(xuid, data);
-  std::filesystem::create_directories(package_path);
-  if (std::filesystem::exists(package_path)) {
-    auto thumb_path = package_path / kThumbnailFileName;
+  auto thumb_path = GetPackageThumbnailPath(package_path);
+  std::filesystem::create_directories(thumb_path.parent_path());
+  if (std::filesystem::exists(thumb_path.parent_path())) {
+    // Written directly to the host directory.
+    EvictClosedPackages(package_path);
     auto file = xe::filesystem::OpenFile(thumb_path, "wb");
     fwrite(buffer.data(), 1, buffer.size(), file);
     fclose(file);
@@ -448,7 +585,17 @@ X_RESULT ContentManager::DeleteContent(const uint64_t xuid,
   }
 
   auto package_path = ResolvePackagePath(xuid, data);
-  if (std::filesystem::remove_all(package_path) > 0) {
+  EvictClosedPackages(package_path);
+  auto archive_path = GetPackageArchivePath(package_path);
+  std::error_code error;
+  bool removed = std::filesystem::remove_all(package_path, error) > 0 && !error;
+  if (std::filesystem::remove(archive_path, error)) {
+    auto thumb_path = archive_path;
+    thumb_path += ".png";
+    std::filesystem::remove(thumb_path, error);
+    removed = true;
+  }
+  if (removed) {
     return X_ERROR_SUCCESS;
   } else {
     return X_ERROR_FILE_NOT_FOUND;
@@ -10,6 +10,7 @@
 #ifndef XENIA_KERNEL_XAM_CONTENT_MANAGER_H_
 #define XENIA_KERNEL_XAM_CONTENT_MANAGER_H_
 
+#include <list>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -26,6 +27,9 @@ namespace xe {
 namespace kernel {
 class KernelState;
 }  // namespace kernel
+namespace vfs {
+class ContentArchiveDevice;
+}  // namespace vfs
 }  // namespace xe
 
 namespace xe {
@@ -125,8 +129,17 @@ class ContentPackage {
                  const std::filesystem::path& package_path);
   ~ContentPackage();
 
+  // Unlinks the root of a closed package, keeping its device registered so it
+  // can be opened again without scanning the package directory.
+  void Close();
+  // Links the root of a closed package again, under the new root name.
+  void Reopen(const std::string_view root_name,
+              const XCONTENT_AGGREGATE_DATA& data);
+
   void LoadPackageLicenseMask(const std::filesystem::path header_path);
 
+  const std::filesystem::path& package_path() const { return package_path_; }
+
   const XCONTENT_AGGREGATE_DATA& GetPackageContentData() const {
     return content_data_;
   }
@@ -137,6 +150,9 @@ class ContentPackage {
   KernelState* kernel_state_;
   std::string root_name_;
   std::string device_path_;
+  std::filesystem::path package_path_;
+  // Owned by the file system, if the package is stored as an archive.
+  vfs::ContentArchiveDevice* archive_device_ = nullptr;
   XCONTENT_AGGREGATE_DATA content_data_;
   uint32_t license_;
 };
@@ -150,6 +166,15 @@ class ContentManager {
   std::vector<XCONTENT_AGGREGATE_DATA> ListContent(
       const uint32_t device_id, const uint64_t xuid, const uint32_t title_id,
       const XContentType content_type) const;
+  // Like ListContent, but only from the names of the packages, without reading
+  // their headers, which is slow with many packages. The full data of each
+  // package can then be obtained with ReadListedContentHeader when needed.
+  std::vector<XCONTENT_AGGREGATE_DATA> ListContentPackages(
+      const uint32_t device_id, const uint64_t xuid, const uint32_t title_id,
+      const XContentType content_type) const;
+  // Replaces the data of a package from ListContentPackages with the data from
+  // its header if it has one.
+  void ReadListedContentHeader(XCONTENT_AGGREGATE_DATA& data) const;
 
   std::unique_ptr<ContentPackage> ResolvePackage(
       const std::string_view root_name, const uint64_t xuid,
@@ -180,6 +205,9 @@ class ContentManager {
   std::filesystem::path ResolveGameUserContentPath(const uint64_t xuid);
   bool IsContentOpen(const XCONTENT_AGGREGATE_DATA& data) const;
   void CloseOpenedFilesFromContent(const std::string_view root_name);
+  // Drops the closed packages in or under the path, which must be done when
+  // their directories are modified on the host outside of their devices.
+  void EvictClosedPackages(const std::filesystem::path& path);
 
  private:
   std::filesystem::path ResolvePackageRoot(
@@ -192,6 +220,10 @@ class ContentManager {
       const std::string_view file_name, uint64_t xuid, uint32_t title_id,
       const XContentType content_type) const;
 
+  std::unique_ptr<ContentPackage> OpenPackage(
+      const std::string_view root_name, const XCONTENT_AGGREGATE_DATA& data,
+      const std::filesystem::path& package_path);
+
   std::unordered_set<uint32_t> FindPublisherTitleIds(
       const uint64_t xuid,
       uint32_t base_title_id = kCurrentlyRunningTitleId) const;
@@ -202,6 +234,9 @@ class ContentManager {
   // TODO(benvanik): remove use of global lock, it's bad here!
   xe::global_critical_region global_critical_region_;
   std::unordered_map<string_key, ContentPackage*> open_packages_;
+  // Recently closed packages, from the most recently closed one, bounded by
+  // content_package_cache_size.
+  std::list<std::unique_ptr<ContentPackage>> closed_packages_;
 };
 
 }  // namespace xam
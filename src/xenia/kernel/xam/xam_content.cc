@@ -121,19 +121,21 @@ dword_result_t XamContentCreateEnumerator_entry(
     xuid = user->xuid();
   }
 
-  auto e = make_object<XStaticEnumerator<XCONTENT_DATA>>(kernel_state(),
-                                                         items_per_enumerate);
+  auto e = make_object<XDeferredEnumerator<XCONTENT_DATA>>(kernel_state(),
+                                                           items_per_enumerate);
   auto result = e->Initialize(XUserIndexAny, 0xFE, 0x20005, 0x20007, 0);
   if (XFAILED(result)) {
     return result;
   }
 
+  // Only listing the packages here, their headers are read as the title
+  // enumerates them.
   std::vector<XCONTENT_AGGREGATE_DATA> enumerated_content = {};
 
   if (!device_info || device_info->device_id == DummyDeviceId::HDD) {
     if (xuid) {
       auto user_enumerated_data =
-          kernel_state()->content_manager()->ListContent(
+          kernel_state()->content_manager()->ListContentPackages(
               static_cast<uint32_t>(DummyDeviceId::HDD), xuid,
               kernel_state()->title_id(), XContentType(uint32_t(content_type)));
 
@@ -144,7 +146,7 @@ dword_result_t XamContentCreateEnumerator_entry(
 
     if (!(content_flags & 0x00001000)) {
       auto common_enumerated_data =
-          kernel_state()->content_manager()->ListContent(
+          kernel_state()->content_manager()->ListContentPackages(
               static_cast<uint32_t>(DummyDeviceId::HDD), 0,
               kernel_state()->title_id(), XContentType(uint32_t(content_type)));
 
@@ -163,12 +165,20 @@ dword_result_t XamContentCreateEnumerator_entry(
     // TODO(gibbed): disc drive content
   }
 
-  for (const auto& content_data : enumerated_content) {
-    auto item = e->AppendItem();
-    *item = content_data;
-    XELOGI("{}: Adding: {} (Filename: {}) to enumerator result", __func__,
-           xe::to_utf8(content_data.display_name()), content_data.file_name());
-  }
+  size_t item_count = enumerated_content.size();
+  e->SetItems(item_count,
+              [enumerated_content = std::move(enumerated_content)](
+                  size_t index, XCONTENT_DATA* item) mutable {
+                XCONTENT_AGGREGATE_DATA& content_data =
+                    enumerated_content[index];
+                kernel_state()->content_manager()->ReadListedContentHeader(
+                    content_data);
+                *item = content_data;
+                XELOGI("XamContentCreateEnumerator: Enumerating: {} "
+                       "(Filename: {})",
+                       xe::to_utf8(content_data.display_name()),
+                       content_data.file_name());
+              });
 
   XELOGD("XamContentCreateEnumerator: added {} items to enumerator",
          e->item_count());
@@ -13,6 +13,7 @@
 #include <xenia/kernel/xboxkrnl/xboxkrnl_modules.h>
 #include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/threading.h"
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/util/shim_utils.h"
 #include "xenia/kernel/xam/xam_module.h"
@@ -474,24 +475,9 @@ dword_result_t NetDll_WSASendTo_entry(
     return -1;
   }
 
-  // Our sockets implementation doesn't support multiple buffers, so we need
-  // to combine the buffers the game has given us!
-  std::vector<uint8_t> combined_buffer_mem;
-  uint32_t combined_buffer_size = 0;
-  uint32_t combined_buffer_offset = 0;
-  for (uint32_t i = 0; i < num_buffers; i++) {
-    combined_buffer_size += buffers[i].len;
-    combined_buffer_mem.resize(combined_buffer_size);
-    uint8_t* combined_buffer = combined_buffer_mem.data();
-
-    std::memcpy(combined_buffer + combined_buffer_offset,
-                kernel_memory()->TranslateVirtual(buffers[i].buf_ptr),
-                buffers[i].len);
-    combined_buffer_offset += buffers[i].len;
-  }
-
-  const int result = socket->SendTo(
-      combined_buffer_mem.data(), combined_buffer_size, flags, to_ptr, to_len);
+  // The buffers are sent as one datagram, straight from guest memory.
+  const int result =
+      socket->WSASendTo(buffers, num_buffers, flags, to_ptr, to_len);
 
   if (result == -1) {
     XThread::SetLastError(socket->GetLastWSAError());
@@ -1721,6 +1707,12 @@ int_result_t NetDll_select_entry(dword_t caller, dword_t nfds,
     host_exceptfds.Store(exceptfds);
   }
 
+  if (!ret && timeout_in && !timeout.tv_sec && !timeout.tv_usec) {
+    // Titles poll sockets with zero timeouts in a loop, give up the rest of
+    // the time slice without anything to receive.
+    xe::threading::MaybeYield();
+  }
+
   // TODO(gibbed): modify ret to be what's actually copied to the guest
   // fd_sets?
   return ret;
@@ -785,21 +785,32 @@ dword_result_t XamUserCreateAchievementEnumerator_entry(
       kernel_state()->achievement_manager()->GetTitleAchievements(
           requester_xuid, title_id_);
 
+  // Converted from the profile data only when the title enumerates them.
   if (user_title_achievements) {
-    for (const auto& entry : *user_title_achievements) {
-      auto item = XAchievementEnumerator::AchievementDetails{
-          entry.achievement_id,
-          xe::load_and_swap<std::u16string>(entry.achievement_name.c_str()),
-          xe::load_and_swap<std::u16string>(entry.unlocked_description.c_str()),
-          xe::load_and_swap<std::u16string>(entry.locked_description.c_str()),
-          entry.image_id,
-          entry.gamerscore,
-          entry.unlock_time.high_part,
-          entry.unlock_time.low_part,
-          entry.flags};
-
-      e->AppendItem(item);
-    }
+    e->SetDeferredItems(
+        user_title_achievements->size(),
+        [requester_xuid, title_id_](size_t index) {
+          const auto user_title_achievements =
+              kernel_state()->achievement_manager()->GetTitleAchievements(
+                  requester_xuid, title_id_);
+          if (!user_title_achievements ||
+              index >= user_title_achievements->size()) {
+            return XAchievementEnumerator::AchievementDetails{};
+          }
+          const auto& entry = (*user_title_achievements)[index];
+          return XAchievementEnumerator::AchievementDetails{
+              entry.achievement_id,
+              xe::load_and_swap<std::u16string>(entry.achievement_name.c_str()),
+              xe::load_and_swap<std::u16string>(
+                  entry.unlocked_description.c_str()),
+              xe::load_and_swap<std::u16string>(
+                  entry.locked_description.c_str()),
+              entry.image_id,
+              entry.gamerscore,
+              entry.unlock_time.high_part,
+              entry.unlock_time.low_part,
+              entry.flags};
+        });
   }
 
   *handle_ptr = e->handle();
@@ -125,6 +125,33 @@ dword_result_t NtOpenFile_entry(
 }
 DECLARE_XBOXKRNL_EXPORT1(NtOpenFile, kFileSystem, kImplemented);
 
+// Completes a request done on an I/O thread (with notify_completion = false)
+// the same way as a synchronous one, but with the APC queued to the thread that
+// has issued the request.
+void CompleteAsyncFileRequest(XFile* file, XEvent* ev, XThread* thread,
+                              uint32_t apc_routine, uint32_t apc_context,
+                              uint32_t io_status_block_ptr, X_STATUS status,
+                              uint32_t information) {
+  if (io_status_block_ptr) {
+    auto io_status_block =
+        kernel_memory()->TranslateVirtual<X_IO_STATUS_BLOCK*>(
+            io_status_block_ptr);
+    io_status_block->status = status;
+    io_status_block->information = information;
+  }
+
+  file->NotifyCompletion(apc_context, information, status);
+
+  // Low bit probably means do not queue to IO ports.
+  if ((apc_routine & ~1u) && apc_context && thread && thread->is_running()) {
+    thread->EnqueueApc(apc_routine & ~1u, apc_context, io_status_block_ptr, 0);
+  }
+
+  if (ev) {
+    ev->Set(0, false);
+  }
+}
+
 dword_result_t NtReadFile_entry(dword_t file_handle, dword_t event_handle,
                                 lpvoid_t apc_routine_ptr, lpvoid_t apc_context,
                                 pointer_t<X_IO_STATUS_BLOCK> io_status_block,
@@ -144,7 +171,7 @@ dword_result_t NtReadFile_entry(dword_t file_handle, dword_t event_handle,
   }
 
   if (XSUCCEEDED(result)) {
-    if (true || file->is_synchronous()) {
+    if (file->is_synchronous() || !kernel_state()->is_async_io_enabled()) {
       // Synchronous.
       uint32_t bytes_read = 0;
       result = file->Read(
@@ -175,22 +202,33 @@ dword_result_t NtReadFile_entry(dword_t file_handle, dword_t event_handle,
       // we have written the info out.
       signal_event = true;
     } else {
-      // TODO(benvanik): async.
-
-      // X_STATUS_PENDING if not returning immediately.
-      // XFile is waitable and signalled after each async req completes.
-      // reset the input event (->Reset())
-      /*xeNtReadFileState* call_state = new xeNtReadFileState();
-      XAsyncRequest* request = new XAsyncRequest(
-      state, file,
-      (XAsyncRequest::CompletionCallback)xeNtReadFileCompleted,
-      call_state);*/
-      // result = file->Read(buffer.guest_address(), buffer_length, byte_offset,
-      //                     request);
+      // Asynchronous, completed on an I/O thread so the guest can overlap the
+      // host disk access with its own work.
+      if (ev) {
+        ev->Reset();
+      }
       if (io_status_block) {
         io_status_block->status = X_STATUS_PENDING;
         io_status_block->information = 0;
       }
+      uint64_t byte_offset = byte_offset_ptr
+                                 ? static_cast<uint64_t>(*byte_offset_ptr)
+                                 : file->position();
+      kernel_state()->QueueAsyncIO(
+          [file, ev, thread = retain_object(XThread::GetCurrentThread()),
+           buffer_ptr = buffer.guest_address(),
+           buffer_length = uint32_t(buffer_length), byte_offset,
+           apc_routine = uint32_t(apc_routine_ptr.guest_address()),
+           apc_context_ptr = apc_context.guest_address(),
+           io_status_block_ptr = io_status_block.guest_address()]() {
+            uint32_t bytes_read = 0;
+            X_STATUS status = file->Read(buffer_ptr, buffer_length,
+                                         byte_offset, &bytes_read,
+                                         apc_context_ptr, false);
+            CompleteAsyncFileRequest(file.get(), ev.get(), thread.get(),
+                                     apc_routine, apc_context_ptr,
+                                     io_status_block_ptr, status, bytes_read);
+          });
 
       result = X_STATUS_PENDING;
     }
@@ -317,8 +355,7 @@ dword_result_t NtWriteFile_entry(dword_t file_handle, dword_t event_handle,
 
   // Execute write.
   if (XSUCCEEDED(result)) {
-    // TODO(benvanik): async path.
-    if (true || file->is_synchronous()) {
+    if (file->is_synchronous() || !kernel_state()->is_async_io_enabled()) {
       // Synchronous request.
       uint32_t bytes_written = 0;
       result = file->Write(
@@ -350,13 +387,36 @@ dword_result_t NtWriteFile_entry(dword_t file_handle, dword_t event_handle,
       // we have written the info out.
       signal_event = true;
     } else {
-      // X_STATUS_PENDING if not returning immediately.
-      result = X_STATUS_PENDING;
-
+      // Asynchronous, completed on an I/O thread.
+      if (ev) {
+        ev->Reset();
+      }
       if (io_status_block) {
         io_status_block->status = X_STATUS_PENDING;
         io_status_block->information = 0;
       }
+      uint64_t byte_offset = byte_offset_ptr
+                                 ? static_cast<uint64_t>(*byte_offset_ptr)
+                                 : file->position();
+      kernel_state()->QueueAsyncIO(
+          [file, ev, thread = retain_object(XThread::GetCurrentThread()),
+           buffer_ptr = buffer.guest_address(),
+           buffer_length = uint32_t(buffer_length), byte_offset,
+           apc_routine = uint32_t(apc_routine),
+           apc_context_ptr = apc_context.guest_address(),
+           io_status_block_ptr = io_status_block.guest_address()]() {
+            uint32_t bytes_written = 0;
+            X_STATUS status = file->Write(buffer_ptr, buffer_length,
+                                          byte_offset, &bytes_written,
+                                          apc_context_ptr, false);
+            CompleteAsyncFileRequest(file.get(), ev.get(), thread.get(),
+                                     apc_routine, apc_context_ptr,
+                                     io_status_block_ptr, status,
+                                     bytes_written);
+          });
+
+      // X_STATUS_PENDING if not returning immediately.
+      result = X_STATUS_PENDING;
     }
   }
 
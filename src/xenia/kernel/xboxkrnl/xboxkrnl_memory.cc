@@ -13,6 +13,7 @@
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/kernel/kernel_state.h"
+#include "xenia/kernel/util/allocation_stats.h"
 #include "xenia/kernel/util/shim_utils.h"
 #include "xenia/kernel/xboxkrnl/xboxkrnl_memory.h"
 #include "xenia/kernel/xboxkrnl/xboxkrnl_private.h"
@@ -68,7 +69,8 @@ dword_result_t NtAllocateVirtualMemory_entry(lpdword_t base_addr_ptr,
                                              lpdword_t region_size_ptr,
                                              dword_t alloc_type,
                                              dword_t protect_bits,
-                                             dword_t debug_memory) {
+                                             dword_t debug_memory,
+                                             const ppc_context_t& context) {
   // NTSTATUS
   // _Inout_  PVOID *BaseAddress,
   // _Inout_  PSIZE_T RegionSize,
@@ -154,6 +156,7 @@ dword_result_t NtAllocateVirtualMemory_entry(lpdword_t base_addr_ptr,
   uint32_t address = 0;
   BaseHeap* heap;
   HeapAllocationInfo prev_alloc_info = {};
+  bool was_reserved = false;
   bool was_commited = false;
 
   if (adjusted_base != 0) {
@@ -162,8 +165,10 @@ dword_result_t NtAllocateVirtualMemory_entry(lpdword_t base_addr_ptr,
       // Specified the wrong page size for the wrong heap.
       return X_STATUS_ACCESS_DENIED;
     }
-    was_commited = heap->QueryRegionInfo(adjusted_base, &prev_alloc_info) &&
-                   (prev_alloc_info.state & kMemoryAllocationCommit) != 0;
+    if (heap->QueryRegionInfo(adjusted_base, &prev_alloc_info)) {
+      was_reserved = prev_alloc_info.state != 0;
+      was_commited = (prev_alloc_info.state & kMemoryAllocationCommit) != 0;
+    }
 
     if (heap->AllocFixed(adjusted_base, adjusted_size, page_size,
                          allocation_type, protect)) {
@@ -197,6 +202,10 @@ dword_result_t NtAllocateVirtualMemory_entry(lpdword_t base_addr_ptr,
   }
 
   XELOGD("NtAllocateVirtualMemory = {:08X}", address);
+  if (!was_reserved) {
+    util::RecordAllocationIfEnabled(util::AllocationKind::kVirtual, address,
+                                    adjusted_size, uint32_t(context->lr));
+  }
 
   // Stash back.
   // Maybe set X_STATUS_ALREADY_COMMITTED if MEM_COMMIT?
@@ -290,6 +299,9 @@ dword_result_t NtFreeVirtualMemory_entry(lpdword_t base_addr_ptr,
     result = heap->Decommit(base_addr_value, region_size_value);
   } else {
     result = heap->Release(base_addr_value, &region_size_value);
+    if (result) {
+      util::RecordFree(base_addr_value);
+    }
   }
   if (!result) {
     return X_STATUS_UNSUCCESSFUL;
@@ -463,18 +475,27 @@ uint32_t xeMmAllocatePhysicalMemoryEx(uint32_t flags, uint32_t region_size,
 
 dword_result_t MmAllocatePhysicalMemoryEx_entry(
     dword_t flags, dword_t region_size, dword_t protect_bits,
-    dword_t min_addr_range, dword_t max_addr_range, dword_t alignment) {
-  return xeMmAllocatePhysicalMemoryEx(flags, region_size, protect_bits,
-                                      min_addr_range, max_addr_range,
-                                      alignment);
+    dword_t min_addr_range, dword_t max_addr_range, dword_t alignment,
+    const ppc_context_t& context) {
+  uint32_t address =
+      xeMmAllocatePhysicalMemoryEx(flags, region_size, protect_bits,
+                                   min_addr_range, max_addr_range, alignment);
+  util::RecordAllocationIfEnabled(util::AllocationKind::kPhysical, address,
+                                  region_size, uint32_t(context->lr));
+  return address;
 }
 DECLARE_XBOXKRNL_EXPORT1(MmAllocatePhysicalMemoryEx, kMemory, kImplemented);
 
 dword_result_t MmAllocatePhysicalMemory_entry(dword_t flags,
                                               dword_t region_size,
-                                              dword_t protect_bits) {
-  return xeMmAllocatePhysicalMemoryEx(flags, region_size, protect_bits, 0,
-                                      0xFFFFFFFFu, 0);
+                                              dword_t protect_bits,
+                                              const ppc_context_t& context) {
+  uint32_t address = xeMmAllocatePhysicalMemoryEx(flags, region_size,
+                                                  protect_bits, 0, 0xFFFFFFFFu,
+                                                  0);
+  util::RecordAllocationIfEnabled(util::AllocationKind::kPhysical, address,
+                                  region_size, uint32_t(context->lr));
+  return address;
 }
 DECLARE_XBOXKRNL_EXPORT1(MmAllocatePhysicalMemory, kMemory, kImplemented);
 
@@ -484,7 +505,9 @@ void MmFreePhysicalMemory_entry(dword_t type, dword_t base_address) {
   assert_true((base_address & 0x1F) == 0);
 
   auto heap = kernel_state()->memory()->LookupHeap(base_address);
-  heap->Release(base_address);
+  if (heap->Release(base_address)) {
+    util::RecordFree(base_address);
+  }
 }
 DECLARE_XBOXKRNL_EXPORT1(MmFreePhysicalMemory, kMemory, kImplemented);
 
@@ -672,6 +695,7 @@ struct X_POOL_ALLOC_HEADER {
 
 uint32_t xeAllocatePoolTypeWithTag(PPCContext* context, uint32_t size,
                                    uint32_t tag, uint32_t zero) {
+  uint32_t address;
   if (size <= 0xFD8) {
     uint32_t adjusted_size = size + sizeof(X_POOL_ALLOC_HEADER);
 
@@ -682,10 +706,13 @@ uint32_t xeAllocatePoolTypeWithTag(PPCContext* context, uint32_t size,
     result_ptr->unk_2 = 170;
     result_ptr->tag = tag;
 
-    return addr + sizeof(X_POOL_ALLOC_HEADER);
+    address = addr + sizeof(X_POOL_ALLOC_HEADER);
   } else {
-    return kernel_state()->memory()->SystemHeapAlloc(size, 4096);
+    address = kernel_state()->memory()->SystemHeapAlloc(size, 4096);
   }
+  util::RecordAllocationIfEnabled(util::AllocationKind::kPool, address, size,
+                                  uint32_t(context->lr));
+  return address;
 }
 
 dword_result_t ExAllocatePoolTypeWithTag_entry(dword_t size, dword_t tag,
@@ -709,6 +736,7 @@ dword_result_t ExAllocatePool_entry(dword_t size,
 DECLARE_XBOXKRNL_EXPORT1(ExAllocatePool, kMemory, kImplemented);
 
 void xeFreePool(PPCContext* context, uint32_t base_address) {
+  util::RecordFree(base_address);
   auto memory = context->kernel_state->memory();
   // if 4kb aligned, there is no pool header!
   if ((base_address & (4096 - 1)) == 0) {
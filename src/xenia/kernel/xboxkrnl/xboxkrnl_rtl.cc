@@ -10,7 +10,12 @@
 #include "xenia/kernel/xboxkrnl/xboxkrnl_rtl.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 #ifdef XE_PLATFORM_WIN32
 // clang-format off
@@ -23,7 +28,10 @@
 
 #include "xenia/base/atomic.h"
 #include "xenia/base/chrono.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/lock_profiler.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/platform.h"
 #include "xenia/base/string.h"
 #include "xenia/base/threading.h"
 #include "xenia/kernel/kernel_state.h"
@@ -32,7 +40,18 @@
 #include "xenia/kernel/xboxkrnl/xboxkrnl_private.h"
 #include "xenia/kernel/xboxkrnl/xboxkrnl_threading.h"
 #include "xenia/kernel/xevent.h"
+#include "xenia/kernel/xobject.h"
 #include "xenia/kernel/xthread.h"
+
+DEFINE_bool(critical_section_keyed_waits, false,
+            "Park guest threads waiting for contended critical sections in a "
+            "host table keyed by the address of the critical section instead "
+            "of waiting for its dispatcher header as a kernel event.\n"
+            "The wakes pending in the table are not saved in savestates, so "
+            "threads waiting for critical sections may stay blocked after "
+            "restoring one.",
+            "Kernel");
+
 namespace xe {
 namespace kernel {
 namespace xboxkrnl {
@@ -601,7 +620,86 @@ static void CriticalSectionPrefetchW(const void* vp) {
 #endif
 }
 
-void RtlEnterCriticalSection_entry(pointer_t<X_RTL_CRITICAL_SECTION> cs) {
+// Adaptive spin count estimates, like in glibc's adaptive mutexes, moving
+// towards the number of spins it took to acquire each critical section, and
+// halved when spinning fails (when the owner holds the lock for long). Indexed
+// by a hash of the address, collisions only skew the estimates.
+static std::array<std::atomic<uint16_t>, 1024> critical_section_spin_estimates;
+
+static std::atomic<uint16_t>& GetCriticalSectionSpinEstimate(
+    uint32_t cs_ptr) {
+  size_t index = (cs_ptr >> 2) % critical_section_spin_estimates.size();
+  return critical_section_spin_estimates[index];
+}
+
+// Host-side parking of the threads waiting for contended critical sections,
+// keyed by the guest address, so contention doesn't need the kernel object
+// wrapping the dispatcher header. Unlike the state of the event in the header,
+// the pending wakes live only on the host and are not saved in savestates.
+class CriticalSectionWaitTable {
+ public:
+  void Wait(uint32_t cs_ptr) {
+    Bucket& bucket = GetBucket(cs_ptr);
+    std::unique_lock<std::mutex> lock(bucket.mutex);
+    // Like the auto-reset event in the header, a wake before the wait is
+    // kept, this is when the section is released between the lock count
+    // increment and the wait.
+    bucket.cond.wait(lock, [&bucket, cs_ptr]() {
+      return bucket.pending_wakes.find(cs_ptr) != bucket.pending_wakes.end();
+    });
+    auto it = bucket.pending_wakes.find(cs_ptr);
+    if (!--it->second) {
+      bucket.pending_wakes.erase(it);
+    }
+  }
+
+  void Wake(uint32_t cs_ptr) {
+    Bucket& bucket = GetBucket(cs_ptr);
+    {
+      std::lock_guard<std::mutex> lock(bucket.mutex);
+      ++bucket.pending_wakes[cs_ptr];
+    }
+    // The bucket may be shared by multiple critical sections.
+    bucket.cond.notify_all();
+  }
+
+ private:
+  struct Bucket {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::unordered_map<uint32_t, uint32_t> pending_wakes;
+  };
+
+  Bucket& GetBucket(uint32_t cs_ptr) {
+    return buckets_[(cs_ptr >> 2) % buckets_.size()];
+  }
+
+  std::array<Bucket, 64> buckets_;
+};
+
+static CriticalSectionWaitTable critical_section_wait_table;
+
+// No-ops unless profiling locks. A zero wait start means the acquisition
+// wasn't contended.
+static uint64_t GetCriticalSectionWaitStart() {
+#if XE_OPTION_LOCK_PROFILING
+  return lock_profiler::GetWaitStartTicks();
+#else
+  return 0;
+#endif  // XE_OPTION_LOCK_PROFILING
+}
+static void OnCriticalSectionAcquired(const X_RTL_CRITICAL_SECTION* cs,
+                                      const ppc_context_t& ctx,
+                                      uint64_t wait_start_ticks) {
+#if XE_OPTION_LOCK_PROFILING
+  lock_profiler::OnGuestLockAcquired(
+      cs, lock_profiler::LockKind::kGuestCriticalSection, uint32_t(ctx->lr),
+      wait_start_ticks != 0, wait_start_ticks);
+#endif  // XE_OPTION_LOCK_PROFILING
+}
+
+void RtlEnterCriticalSection_entry(pointer_t<X_RTL_CRITICAL_SECTION> cs,
+                                   const ppc_context_t& ctx) {
   if (!cs.guest_address()) {
     XELOGE("Null critical section in RtlEnterCriticalSection!");
     return;
@@ -614,34 +712,64 @@ void RtlEnterCriticalSection_entry(pointer_t<X_RTL_CRITICAL_SECTION> cs) {
     // We already own the lock.
     xe::atomic_inc(&cs->lock_count);
     cs->recursion_count++;
+    OnCriticalSectionAcquired(cs, ctx, 0);
     return;
   }
 
-  // Spin loop
-  while (spin_count--) {
-    if (xe::atomic_cas(-1, 0, &cs->lock_count)) {
+  // Spin loop, with exponential backoff, only attempting to take the lock
+  // when it looks free to avoid bouncing the cache line between the cores.
+  std::atomic<uint16_t>& spin_estimate =
+      GetCriticalSectionSpinEstimate(cs.guest_address());
+  uint32_t estimate = spin_estimate.load(std::memory_order_relaxed);
+  uint32_t spin_limit = std::min(spin_count, estimate * 2 + 16);
+  uint32_t backoff = 1;
+  uint64_t wait_start_ticks = 0;
+  for (uint32_t spins = 0; spins < spin_limit;) {
+    if (*reinterpret_cast<volatile int32_t*>(&cs->lock_count) == -1 &&
+        xe::atomic_cas(-1, 0, &cs->lock_count)) {
       // Acquired.
+      int32_t estimate_delta = (int32_t(spins) - int32_t(estimate)) / 8;
+      spin_estimate.store(uint16_t(int32_t(estimate) + estimate_delta),
+                          std::memory_order_relaxed);
       cs->owning_thread = cur_thread;
       cs->recursion_count = 1;
+      OnCriticalSectionAcquired(cs, ctx, wait_start_ticks);
       return;
     }
+    if (!wait_start_ticks) {
+      wait_start_ticks = GetCriticalSectionWaitStart();
+    }
+    for (uint32_t i = 0; i < backoff; ++i) {
+#if XE_ARCH_AMD64 == 1
+      _mm_pause();
+#endif
+    }
+    spins += backoff;
+    backoff = std::min(backoff * 2, uint32_t(64));
   }
+  spin_estimate.store(uint16_t(estimate / 2), std::memory_order_relaxed);
 
   if (xe::atomic_inc(&cs->lock_count) != 0) {
-    // Create a full waiter.
-    xeKeWaitForSingleObject(reinterpret_cast<void*>(cs.host_address()), 8, 0, 0,
-                            nullptr);
+    if (cvars::critical_section_keyed_waits) {
+      ScopedGuestWait guest_wait;
+      critical_section_wait_table.Wait(cs.guest_address());
+    } else {
+      // Create a full waiter.
+      xeKeWaitForSingleObject(reinterpret_cast<void*>(cs.host_address()), 8, 0,
+                              0, nullptr);
+    }
   }
 
   assert_true(cs->owning_thread == 0);
   cs->owning_thread = cur_thread;
   cs->recursion_count = 1;
+  OnCriticalSectionAcquired(cs, ctx, wait_start_ticks);
 }
 DECLARE_XBOXKRNL_EXPORT2(RtlEnterCriticalSection, kNone, kImplemented,
                          kHighFrequency);
 
 dword_result_t RtlTryEnterCriticalSection_entry(
-    pointer_t<X_RTL_CRITICAL_SECTION> cs) {
+    pointer_t<X_RTL_CRITICAL_SECTION> cs, const ppc_context_t& ctx) {
   if (!cs.guest_address()) {
     XELOGE("Null critical section in RtlTryEnterCriticalSection!");
     return 1;  // pretend we got the critical section.
@@ -653,11 +781,13 @@ dword_result_t RtlTryEnterCriticalSection_entry(
     // Able to steal the lock right away.
     cs->owning_thread = thread;
     cs->recursion_count = 1;
+    OnCriticalSectionAcquired(cs, ctx, 0);
     return 1;
   } else if (cs->owning_thread == thread) {
     // Already own the lock.
     xe::atomic_inc(&cs->lock_count);
     ++cs->recursion_count;
+    OnCriticalSectionAcquired(cs, ctx, 0);
     return 1;
   }
 
@@ -673,6 +803,9 @@ void RtlLeaveCriticalSection_entry(pointer_t<X_RTL_CRITICAL_SECTION> cs) {
     return;
   }
   assert_true(cs->owning_thread == XThread::GetCurrentThread()->guest_object());
+#if XE_OPTION_LOCK_PROFILING
+  lock_profiler::OnLockReleasing(cs);
+#endif  // XE_OPTION_LOCK_PROFILING
 
   // Drop recursion count - if it isn't zero we still have the lock.
   assert_true(cs->recursion_count > 0);
@@ -687,7 +820,11 @@ void RtlLeaveCriticalSection_entry(pointer_t<X_RTL_CRITICAL_SECTION> cs) {
   cs->owning_thread = 0;
   if (xe::atomic_dec(&cs->lock_count) != -1) {
     // There were waiters - wake one of them.
-    xeKeSetEvent(reinterpret_cast<X_KEVENT*>(cs.host_address()), 1, 0);
+    if (cvars::critical_section_keyed_waits) {
+      critical_section_wait_table.Wake(cs.guest_address());
+    } else {
+      xeKeSetEvent(reinterpret_cast<X_KEVENT*>(cs.host_address()), 1, 0);
+    }
   }
 }
 DECLARE_XBOXKRNL_EXPORT2(RtlLeaveCriticalSection, kNone, kImplemented,
@@ -12,6 +12,7 @@
 #include <vector>
 #include "xenia/base/atomic.h"
 #include "xenia/base/clock.h"
+#include "xenia/base/lock_profiler.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/mutex.h"
 #include "xenia/cpu/processor.h"
@@ -402,6 +403,20 @@ dword_result_t KeQueryPerformanceFrequency_entry() {
 DECLARE_XBOXKRNL_EXPORT2(KeQueryPerformanceFrequency, kThreading, kImplemented,
                          kHighFrequency);
 
+// Before an alertable wait, the user APCs queued while the thread wasn't
+// waiting are delivered instead of waiting, as the host wakeup for them may
+// have already been consumed.
+static X_STATUS DeliverQueuedUserApcs() {
+  PPCContext* ctx = cpu::ThreadState::Get()->context();
+  auto kpcr = ctx->TranslateVirtualGPR<X_KPCR*>(ctx->r[13]);
+  auto current_thread = ctx->TranslateVirtual(kpcr->prcb_data.current_thread);
+  // Without the lock - APCs being queued concurrently also wake the thread.
+  if (current_thread->apc_lists[1].empty(ctx)) {
+    return X_STATUS_SUCCESS;
+  }
+  return xeProcessUserApcs(ctx);
+}
+
 uint32_t KeDelayExecutionThread(uint32_t processor_mode, uint32_t alertable,
                                 uint64_t* interval_ptr,
                                 cpu::ppc::PPCContext* ctx) {
@@ -924,6 +939,9 @@ uint32_t xeKeWaitForSingleObject(void* object_ptr, uint32_t wait_reason,
     return X_STATUS_ABANDONED_WAIT_0;
   }
 
+  if (alertable && DeliverQueuedUserApcs() == X_STATUS_USER_APC) {
+    return X_STATUS_USER_APC;
+  }
   X_STATUS result =
       object->Wait(wait_reason, processor_mode, alertable, timeout_ptr);
   if (alertable) {
@@ -953,6 +971,9 @@ uint32_t NtWaitForSingleObjectEx(uint32_t object_handle, uint32_t wait_mode,
   auto object =
       kernel_state()->object_table()->LookupObject<XObject>(object_handle);
   if (object) {
+    if (alertable && DeliverQueuedUserApcs() == X_STATUS_USER_APC) {
+      return X_STATUS_USER_APC;
+    }
     uint64_t timeout = timeout_ptr ? static_cast<uint64_t>(*timeout_ptr) : 0u;
     result =
         object->Wait(3, wait_mode, alertable, timeout_ptr ? &timeout : nullptr);
@@ -1000,6 +1021,9 @@ dword_result_t KeWaitForMultipleObjects_entry(
       objects[n] = std::move(object_ref);
     }
   }
+  if (alertable && DeliverQueuedUserApcs() == X_STATUS_USER_APC) {
+    return X_STATUS_USER_APC;
+  }
   uint64_t timeout = timeout_ptr ? static_cast<uint64_t>(*timeout_ptr) : 0u;
   X_STATUS result = XObject::WaitMultiple(
       uint32_t(count), reinterpret_cast<XObject**>(&objects[0]), wait_type,
@@ -1045,6 +1069,9 @@ uint32_t xeNtWaitForMultipleObjectsEx(uint32_t count, xe::be<uint32_t>* handles,
     }
   }
 
+  if (alertable && DeliverQueuedUserApcs() == X_STATUS_USER_APC) {
+    return X_STATUS_USER_APC;
+  }
   auto result =
       XObject::WaitMultiple(count, reinterpret_cast<XObject**>(&objects[0]),
                             wait_type, 6, wait_mode, alertable, timeout_ptr);
@@ -1111,13 +1138,29 @@ uint32_t xeKeKfAcquireSpinLock(PPCContext* ctx, X_KSPINLOCK* lock,
 
   PrefetchForCAS(lock);
   assert_true(lock->prcb_of_owner != static_cast<uint32_t>(ctx->r[13]));
+#if XE_OPTION_LOCK_PROFILING
+  bool contended = false;
+  uint64_t wait_start_ticks = 0;
+#endif  // XE_OPTION_LOCK_PROFILING
   // Lock.
   while (!xe::atomic_cas(0, xe::byte_swap(static_cast<uint32_t>(ctx->r[13])),
                          &lock->prcb_of_owner.value)) {
+#if XE_OPTION_LOCK_PROFILING
+    if (!contended) {
+      contended = true;
+      wait_start_ticks = lock_profiler::GetWaitStartTicks();
+    }
+#endif  // XE_OPTION_LOCK_PROFILING
     // Spin!
     // TODO(benvanik): error on deadlock?
     xe::threading::MaybeYield();
   }
+#if XE_OPTION_LOCK_PROFILING
+  lock_profiler::OnGuestLockAcquired(lock,
+                                     lock_profiler::LockKind::kGuestSpinLock,
+                                     uint32_t(ctx->lr), contended,
+                                     wait_start_ticks);
+#endif  // XE_OPTION_LOCK_PROFILING
 
   return old_irql;
 }
@@ -1132,6 +1175,9 @@ DECLARE_XBOXKRNL_EXPORT3(KfAcquireSpinLock, kThreading, kImplemented, kBlocking,
 void xeKeKfReleaseSpinLock(PPCContext* ctx, X_KSPINLOCK* lock,
                            uint32_t old_irql, bool change_irql) {
   assert_true(lock->prcb_of_owner == static_cast<uint32_t>(ctx->r[13]));
+#if XE_OPTION_LOCK_PROFILING
+  lock_profiler::OnLockReleasing(lock);
+#endif  // XE_OPTION_LOCK_PROFILING
   // Unlock.
   lock->prcb_of_owner.value = 0;
 
@@ -1172,6 +1218,11 @@ dword_result_t KeTryToAcquireSpinLockAtRaisedIrql_entry(
           lock_ptr.guest_address())) {
     return 0;
   }
+#if XE_OPTION_LOCK_PROFILING
+  lock_profiler::OnGuestLockAcquired(lock,
+                                     lock_profiler::LockKind::kGuestSpinLock,
+                                     uint32_t(ppc_ctx->lr), false, 0);
+#endif  // XE_OPTION_LOCK_PROFILING
   return 1;
 }
 DECLARE_XBOXKRNL_EXPORT4(KeTryToAcquireSpinLockAtRaisedIrql, kThreading,
@@ -1275,9 +1326,6 @@ uint32_t xeNtQueueApcThread(uint32_t thread_handle, uint32_t apc_routine,
     memory->SystemHeapFree(apc_ptr);
     return X_STATUS_UNSUCCESSFUL;
   }
-  // no-op, just meant to awaken a sleeping alertable thread to process real
-  // apcs
-  thread->thread()->QueueUserCallback([]() {});
   return X_STATUS_SUCCESS;
 }
 dword_result_t NtQueueApcThread_entry(dword_t thread_handle,
@@ -1356,6 +1404,11 @@ X_STATUS xeProcessUserApcs(PPCContext* ctx) {
   ctx->r[1] = old_stack_pointer;
 
   xeKeKfReleaseSpinLock(ctx, &current_thread->apc_lock, unlocked_irql);
+  if (alert_status == X_STATUS_USER_APC) {
+    if (XThread* thread = XThread::GetCurrentThread()) {
+      thread->OnUserApcsDelivered();
+    }
+  }
   return alert_status;
 }
 
@@ -1478,14 +1531,18 @@ uint32_t xeKeInsertQueueApc(XAPC* apc, uint32_t arg1, uint32_t arg2,
     }
 
     apc->enqueued = 1;
-
-    /*
-        todo: this is incomplete, a ton of other logic happens here, i believe
-       for waking the target thread if its alertable
-    */
     result = 1;
   }
+  bool is_user_apc = result && apc->apc_mode == 1;
   xeKeKfReleaseSpinLock(context, &target_thread->apc_lock, old_irql);
+  // Kernel mode APCs are only delivered on rundown currently.
+  if (is_user_apc) {
+    auto thread = XObject::GetNativeObject<XThread>(context->kernel_state,
+                                                    target_thread);
+    if (thread) {
+      thread->OnUserApcQueued();
+    }
+  }
   return result;
 }
 
@@ -1782,8 +1839,52 @@ pointer_result_t InterlockedFlushSList_entry(
 }
 DECLARE_XBOXKRNL_EXPORT1(InterlockedFlushSList, kThreading, kImplemented);
 
+void RegisterThreadingExports(xe::cpu::ExportResolver* export_resolver,
+                              KernelState* kernel_state) {
+  // The IRQL and process type functions are called often around spinlocks and
+  // only access the KPCR, so they can be translated at the call site, skipping
+  // the guest-to-host transition. The logging in the implementations above is
+  // not done in the translated code.
+  using xe::cpu::ExportInlineSequence;
+  constexpr uint16_t kIrqlOffset = offsetof(X_KPCR, current_irql);
+
+  EXPORT_xboxkrnl_KeRaiseIrqlToDpcLevel->inline_sequence = {
+      ExportInlineSequence::Type::kExchangePcrByteImmediate, 2, {kIrqlOffset}};
+  EXPORT_xboxkrnl_KfRaiseIrql->inline_sequence = {
+      ExportInlineSequence::Type::kExchangePcrByte, 0, {kIrqlOffset}};
+  EXPORT_xboxkrnl_KfLowerIrql->inline_sequence = {
+      ExportInlineSequence::Type::kStorePcrByte, 0, {kIrqlOffset}};
+  // Releasing doesn't need the reservation semantics of acquiring, which stays
+  // in the host implementation.
+  EXPORT_xboxkrnl_KfReleaseSpinLock->inline_sequence = {
+      ExportInlineSequence::Type::kReleaseSpinLock, 2, {kIrqlOffset}};
+  EXPORT_xboxkrnl_KeReleaseSpinLockFromRaisedIrql->inline_sequence = {
+      ExportInlineSequence::Type::kReleaseSpinLock, 0, {kIrqlOffset}};
+
+  constexpr uint16_t kPrcbOffset = offsetof(X_KPCR, prcb_data);
+  EXPORT_xboxkrnl_KeGetCurrentProcessType->inline_sequence = {
+      ExportInlineSequence::Type::kSelectPcrByteOrThreadByte,
+      0,
+      {kPrcbOffset + offsetof(X_KPRCB, dpc_active),
+       offsetof(X_KPCR, processtype_value_in_dpc),
+       kPrcbOffset + offsetof(X_KPRCB, current_thread),
+       offsetof(X_KTHREAD, process_type)}};
+
+  // The dynamic TLS slots of each thread are pointed to by its KPCR, so getting
+  // and setting them is a load or a store, which matters as some middleware
+  // gets a slot on every profiling scope.
+  constexpr uint16_t kTlsSlotsOffset = offsetof(X_KPCR, tls_slots_ptr);
+  constexpr uint16_t kTlsSlotCountOffset = offsetof(X_KPCR, tls_slot_count);
+  EXPORT_xboxkrnl_KeTlsGetValue->inline_sequence = {
+      ExportInlineSequence::Type::kLoadPcrArrayDword,
+      0,
+      {kTlsSlotsOffset, kTlsSlotCountOffset}};
+  EXPORT_xboxkrnl_KeTlsSetValue->inline_sequence = {
+      ExportInlineSequence::Type::kStorePcrArrayDword,
+      0,
+      {kTlsSlotsOffset, kTlsSlotCountOffset}};
+}
+
 }  // namespace xboxkrnl
 }  // namespace kernel
 }  // namespace xe
-
-DECLARE_XBOXKRNL_EMPTY_REGISTER_EXPORTS(Threading);
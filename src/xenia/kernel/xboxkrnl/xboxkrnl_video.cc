@@ -9,6 +9,7 @@
 
 #include "xenia/kernel/xboxkrnl/xboxkrnl_video.h"
 
+#include "xenia/base/counters.h"
 #include "xenia/base/logging.h"
 #include "xenia/emulator.h"
 #include "xenia/gpu/graphics_system.h"
@@ -514,6 +515,23 @@ void VdSwap_entry(
   for (uint32_t i = offset; i < 64; i++) {
     dwords[i] = xenos::MakePacketType2();
   }
+
+  static xe::counters::Counter& frames_counter =
+      xe::counters::GetCounter("kernel/frames");
+  frames_counter.Increment();
+  Emulator* emulator = kernel_state()->emulator();
+  emulator->graphics_system()->OnGuestFrameBoundary();
+  FrameTimeline* frame_timeline = emulator->frame_timeline();
+  if (frame_timeline) {
+    frame_timeline->OnFrameBoundary();
+  }
+  emulator->UpdateBenchmark();
+  emulator->UpdateTitleProfile();
+  StartupTimeline* startup_timeline = emulator->startup_timeline();
+  if (startup_timeline && startup_timeline->OnFrameBoundary()) {
+    emulator->ReportStartupTimeline();
+  }
+  emulator->UpdateBootSnapshot();
 }
 DECLARE_XBOXKRNL_EXPORT3(VdSwap, kVideo, kImplemented, kHighFrequency,
                          kImportant);
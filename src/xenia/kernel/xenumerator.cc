@@ -78,10 +78,34 @@ uint32_t XStaticUntypedEnumerator::WriteItems(uint32_t buffer_ptr,
   return X_ERROR_SUCCESS;
 }
 
+uint32_t XDeferredUntypedEnumerator::WriteItems(uint32_t buffer_ptr,
+                                                uint8_t* buffer_data,
+                                                uint32_t* written_count) {
+  size_t count = std::min(item_count_ - current_item_, items_per_enumerate());
+  if (!count) {
+    return X_ERROR_NO_MORE_FILES;
+  }
+
+  std::memset(buffer_data, 0, count * item_size());
+  for (size_t i = 0; i < count; ++i) {
+    item_writer_(current_item_ + i, buffer_data + i * item_size());
+  }
+
+  current_item_ += count;
+
+  if (written_count) {
+    *written_count = static_cast<uint32_t>(count);
+  }
+
+  return X_ERROR_SUCCESS;
+}
+
 uint32_t XAchievementEnumerator::WriteItems(uint32_t buffer_ptr,
                                             uint8_t* buffer_data,
                                             uint32_t* written_count) {
-  size_t count = std::min(items_.size() - current_item_, items_per_enumerate());
+  size_t item_count =
+      deferred_item_getter_ ? deferred_item_count_ : items_.size();
+  size_t count = std::min(item_count - current_item_, items_per_enumerate());
   if (!count) {
     return X_ERROR_NO_MORE_FILES;
   }
@@ -96,7 +120,12 @@ uint32_t XAchievementEnumerator::WriteItems(uint32_t buffer_ptr,
                    &buffer_data[string_offset],
                    count * xam::X_ACHIEVEMENT_DETAILS::kStringBufferSize};
   for (size_t i = 0, o = current_item_; i < count; ++i, ++current_item_) {
-    const auto& item = items_[current_item_];
+    AchievementDetails deferred_item;
+    if (deferred_item_getter_) {
+      deferred_item = deferred_item_getter_(current_item_);
+    }
+    const auto& item =
+        deferred_item_getter_ ? deferred_item : items_[current_item_];
     details[i].id = item.id;
     details[i].label_ptr =
         !!(flags_ & 1) ? AppendString(string_buffer, item.label) : 0;
@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <functional>
 #include <vector>
 
 #include "xenia/kernel/xam/achievement_manager.h"
@@ -115,6 +116,52 @@ class XStaticEnumerator : public XStaticUntypedEnumerator {
   }
 };
 
+// Like XStaticUntypedEnumerator, but with the items written only when the
+// guest enumerates them, items_per_enumerate at a time, for listings that are
+// slow to build entirely when the enumerator is created.
+class XDeferredUntypedEnumerator : public XEnumerator {
+ public:
+  // Writes the item with the index to the zeroed item_size() bytes.
+  using ItemWriter = std::function<void(size_t index, uint8_t* item)>;
+
+  XDeferredUntypedEnumerator(KernelState* kernel_state,
+                             size_t items_per_enumerate, size_t item_size)
+      : XEnumerator(kernel_state, items_per_enumerate, item_size) {}
+
+  size_t item_count() const { return item_count_; }
+
+  void SetItems(size_t item_count, ItemWriter item_writer) {
+    item_count_ = item_count;
+    current_item_ = 0;
+    item_writer_ = std::move(item_writer);
+  }
+
+  uint32_t WriteItems(uint32_t buffer_ptr, uint8_t* buffer_data,
+                      uint32_t* written_count) override;
+
+ private:
+  size_t item_count_ = 0;
+  size_t current_item_ = 0;
+  ItemWriter item_writer_;
+};
+
+template <typename T>
+class XDeferredEnumerator : public XDeferredUntypedEnumerator {
+ public:
+  XDeferredEnumerator(KernelState* kernel_state, size_t items_per_enumerate)
+      : XDeferredUntypedEnumerator(kernel_state, items_per_enumerate,
+                                   sizeof(T)) {}
+
+  void SetItems(size_t item_count,
+                std::function<void(size_t index, T* item)> item_writer) {
+    XDeferredUntypedEnumerator::SetItems(
+        item_count, [item_writer = std::move(item_writer)](size_t index,
+                                                           uint8_t* item) {
+          item_writer(index, reinterpret_cast<T*>(item));
+        });
+  }
+};
+
 class XAchievementEnumerator : public XEnumerator {
  public:
   struct AchievementDetails {
@@ -144,6 +191,14 @@ class XAchievementEnumerator : public XEnumerator {
     items_.push_back(std::move(item));
   }
 
+  // Instead of appending the items, gets them only when the guest enumerates
+  // them.
+  void SetDeferredItems(size_t item_count,
+                        std::function<AchievementDetails(size_t index)> getter) {
+    deferred_item_count_ = item_count;
+    deferred_item_getter_ = std::move(getter);
+  }
+
   uint32_t WriteItems(uint32_t buffer_ptr, uint8_t* buffer_data,
                       uint32_t* written_count) override;
 
@@ -173,6 +228,8 @@ class XAchievementEnumerator : public XEnumerator {
  private:
   uint32_t flags_;
   std::vector<AchievementDetails> items_;
+  size_t deferred_item_count_ = 0;
+  std::function<AchievementDetails(size_t index)> deferred_item_getter_;
   size_t current_item_ = 0;
 };
 
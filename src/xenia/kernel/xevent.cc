@@ -25,12 +25,8 @@ void XEvent::Initialize(bool manual_reset, bool initial_state) {
 
   this->CreateNative<X_KEVENT>();
 
-  if (manual_reset) {
-    event_ = xe::threading::Event::CreateManualResetEvent(initial_state);
-  } else {
-    event_ = xe::threading::Event::CreateAutoResetEvent(initial_state);
-  }
-  assert_not_null(event_);
+  manual_reset_ = manual_reset;
+  lazy_signaled_ = initial_state;
 }
 
 void XEvent::InitializeNative(void* native_ptr, X_DISPATCH_HEADER* header) {
@@ -48,55 +44,105 @@ void XEvent::InitializeNative(void* native_ptr, X_DISPATCH_HEADER* header) {
       return;
   }
 
-  bool initial_state = header->signal_state ? true : false;
+  lazy_signaled_ = header->signal_state ? true : false;
+}
+
+xe::threading::Event* XEvent::GetOrCreateEvent() {
+  std::unique_lock<std::mutex> lock;
+  xe::threading::Event* event = GetEventOrLock(lock);
+  if (event) {
+    return event;
+  }
   if (manual_reset_) {
-    event_ = xe::threading::Event::CreateManualResetEvent(initial_state);
+    event_ = xe::threading::Event::CreateManualResetEvent(lazy_signaled_);
   } else {
-    event_ = xe::threading::Event::CreateAutoResetEvent(initial_state);
+    event_ = xe::threading::Event::CreateAutoResetEvent(lazy_signaled_);
   }
   assert_not_null(event_);
+  event_created_.store(true, std::memory_order_release);
+  return event_.get();
+}
+
+xe::threading::Event* XEvent::GetEventOrLock(
+    std::unique_lock<std::mutex>& lock) {
+  if (event_created_.load(std::memory_order_acquire)) {
+    return event_.get();
+  }
+  lock = std::unique_lock<std::mutex>(lazy_state_mutex_);
+  if (event_created_.load(std::memory_order_relaxed)) {
+    lock.unlock();
+    return event_.get();
+  }
+  return nullptr;
 }
 
 int32_t XEvent::Set(uint32_t priority_increment, bool wait) {
-  event_->Set();
+  std::unique_lock<std::mutex> lock;
+  if (xe::threading::Event* event = GetEventOrLock(lock)) {
+    event->Set();
+  } else {
+    lazy_signaled_ = true;
+  }
   return 1;
 }
 
 int32_t XEvent::Pulse(uint32_t priority_increment, bool wait) {
-  event_->Pulse();
+  std::unique_lock<std::mutex> lock;
+  if (xe::threading::Event* event = GetEventOrLock(lock)) {
+    event->Pulse();
+  } else {
+    // Nothing can be waiting for the event without the host event.
+    lazy_signaled_ = false;
+  }
   return 1;
 }
 
 int32_t XEvent::Reset() {
-  event_->Reset();
+  std::unique_lock<std::mutex> lock;
+  if (xe::threading::Event* event = GetEventOrLock(lock)) {
+    event->Reset();
+  } else {
+    lazy_signaled_ = false;
+  }
   return 1;
 }
 void XEvent::Query(uint32_t* out_type, uint32_t* out_state) {
-  auto [type, state] = event_->Query();
-
-  *out_type = type;
-  *out_state = state;
+  std::unique_lock<std::mutex> lock;
+  if (xe::threading::Event* event = GetEventOrLock(lock)) {
+    auto [type, state] = event->Query();
+    *out_type = type;
+    *out_state = state;
+  } else {
+    // NotificationEvent or SynchronizationEvent.
+    *out_type = manual_reset_ ? 0 : 1;
+    *out_state = lazy_signaled_ ? 1 : 0;
+  }
 }
-void XEvent::Clear() { event_->Reset(); }
+void XEvent::Clear() { Reset(); }
 
 bool XEvent::Save(ByteStream* stream) {
   XELOGD("XEvent {:08X} ({})", handle(), manual_reset_ ? "manual" : "auto");
   SaveObject(stream);
 
   bool signaled = true;
-  auto result =
-      xe::threading::Wait(event_.get(), false, std::chrono::milliseconds(0));
-  if (result == xe::threading::WaitResult::kSuccess) {
-    signaled = true;
-  } else if (result == xe::threading::WaitResult::kTimeout) {
-    signaled = false;
-  } else {
-    assert_always();
-  }
+  std::unique_lock<std::mutex> lock;
+  if (xe::threading::Event* event = GetEventOrLock(lock)) {
+    auto result =
+        xe::threading::Wait(event, false, std::chrono::milliseconds(0));
+    if (result == xe::threading::WaitResult::kSuccess) {
+      signaled = true;
+    } else if (result == xe::threading::WaitResult::kTimeout) {
+      signaled = false;
+    } else {
+      assert_always();
+    }
 
-  if (signaled) {
-    // Reset the event in-case it's an auto-reset.
-    event_->Set();
+    if (signaled) {
+      // Reset the event in-case it's an auto-reset.
+      event->Set();
+    }
+  } else {
+    signaled = lazy_signaled_;
   }
 
   stream->Write<bool>(signaled);
@@ -113,17 +159,7 @@ object_ref<XEvent> XEvent::Restore(KernelState* kernel_state,
   evt->RestoreObject(stream);
   bool signaled = stream->Read<bool>();
   evt->manual_reset_ = stream->Read<bool>();
-
-  if (evt->manual_reset_) {
-    evt->event_ = xe::threading::Event::CreateManualResetEvent(false);
-  } else {
-    evt->event_ = xe::threading::Event::CreateAutoResetEvent(false);
-  }
-  assert_not_null(evt->event_);
-
-  if (signaled) {
-    evt->event_->Set();
-  }
+  evt->lazy_signaled_ = signaled;
 
   return object_ref<XEvent>(evt);
 }
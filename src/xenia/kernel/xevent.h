@@ -10,6 +10,9 @@
 #ifndef XENIA_KERNEL_XEVENT_H_
 #define XENIA_KERNEL_XEVENT_H_
 
+#include <atomic>
+#include <mutex>
+
 #include "xenia/base/threading.h"
 #include "xenia/kernel/xobject.h"
 #include "xenia/xbox.h"
@@ -43,17 +46,30 @@ class XEvent : public XObject {
   static object_ref<XEvent> Restore(KernelState* kernel_state,
                                     ByteStream* stream);
 
-  uint64_t native_handle() const {
+  uint64_t native_handle() {
     const uint64_t native_handle =
-        reinterpret_cast<uint64_t>(event_->native_handle());
+        reinterpret_cast<uint64_t>(GetOrCreateEvent()->native_handle());
     return native_handle;
   }
 
  protected:
-  xe::threading::WaitHandle* GetWaitHandle() override { return event_.get(); }
+  xe::threading::WaitHandle* GetWaitHandle() override {
+    return GetOrCreateEvent();
+  }
 
  private:
+  // Many events are only set and reset, never waited on, so the host event is
+  // created only when needed for waiting, with the state tracked in the object
+  // until then.
+  xe::threading::Event* GetOrCreateEvent();
+  // Returns nullptr if the host event hasn't been created yet, with the lock
+  // held, so the state can't be changed concurrently with the creation.
+  xe::threading::Event* GetEventOrLock(std::unique_lock<std::mutex>& lock);
+
   bool manual_reset_ = false;
+  std::mutex lazy_state_mutex_;
+  bool lazy_signaled_ = false;
+  std::atomic<bool> event_created_ = false;
   std::unique_ptr<xe::threading::Event> event_;
 };
 
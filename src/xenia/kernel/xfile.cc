@@ -142,7 +142,8 @@ X_STATUS XFile::Read(uint32_t buffer_guest_address, uint32_t buffer_length,
                 memory::PageAccess::kReadWrite) {
           result = X_STATUS_ACCESS_VIOLATION;
         } else {
-          result = file_->ReadSync(
+          result = kernel_state()->file_system()->read_cache().Read(
+              file_,
               buffer_physical_heap
                   ? memory()->TranslatePhysical(
                         buffer_physical_heap->GetPhysicalAddress(
@@ -167,14 +168,7 @@ X_STATUS XFile::Read(uint32_t buffer_guest_address, uint32_t buffer_length,
   }
 
   if (notify_completion) {
-    XIOCompletion::IONotification notify;
-    notify.apc_context = apc_context;
-    notify.num_bytes = uint32_t(bytes_read);
-    notify.status = result;
-
-    NotifyIOCompletionPorts(notify);
-
-    async_event_->Set();
+    NotifyCompletion(apc_context, uint32_t(bytes_read), result);
   }
 
   return result;
@@ -238,7 +232,7 @@ X_STATUS XFile::ReadScatter(uint32_t segments_guest_address, uint32_t length,
 
 X_STATUS XFile::Write(uint32_t buffer_guest_address, uint32_t buffer_length,
                       uint64_t byte_offset, uint32_t* out_bytes_written,
-                      uint32_t apc_context) {
+                      uint32_t apc_context, bool notify_completion) {
   if (byte_offset == uint64_t(-1)) {
     // Write from current position.
     byte_offset = position_;
@@ -252,19 +246,26 @@ X_STATUS XFile::Write(uint32_t buffer_guest_address, uint32_t buffer_length,
     position_ += bytes_written;
   }
 
+  if (out_bytes_written) {
+    *out_bytes_written = uint32_t(bytes_written);
+  }
+
+  if (notify_completion) {
+    NotifyCompletion(apc_context, uint32_t(bytes_written), result);
+  }
+  return result;
+}
+
+void XFile::NotifyCompletion(uint32_t apc_context, uint32_t num_bytes,
+                             X_STATUS status) {
   XIOCompletion::IONotification notify;
   notify.apc_context = apc_context;
-  notify.num_bytes = uint32_t(bytes_written);
-  notify.status = result;
+  notify.num_bytes = num_bytes;
+  notify.status = status;
 
   NotifyIOCompletionPorts(notify);
 
-  if (out_bytes_written) {
-    *out_bytes_written = uint32_t(bytes_written);
-  }
-
   async_event_->Set();
-  return result;
 }
 
 X_STATUS XFile::SetLength(size_t length) { return file_->SetLength(length); }
@@ -163,7 +163,13 @@ class XFile : public XObject {
 
   X_STATUS Write(uint32_t buffer_guess_address, uint32_t buffer_length,
                  uint64_t byte_offset, uint32_t* out_bytes_written,
-                 uint32_t apc_context);
+                 uint32_t apc_context, bool notify_completion = true);
+
+  // Posts the result of a request to the completion ports and signals the
+  // file, for requests done with notify_completion = false once their status
+  // has been written.
+  void NotifyCompletion(uint32_t apc_context, uint32_t num_bytes,
+                        X_STATUS status);
 
   X_STATUS SetLength(size_t length);
   X_STATUS Rename(const std::filesystem::path file_path);
@@ -20,7 +20,10 @@ namespace kernel {
 XNotifyListener::XNotifyListener(KernelState* kernel_state)
     : XObject(kernel_state, kObjectType) {}
 
-XNotifyListener::~XNotifyListener() {}
+XNotifyListener::~XNotifyListener() {
+  std::lock_guard<xe_mutex> lock(dequeue_mutex_);
+  TakeQueuedNotifications();
+}
 
 void XNotifyListener::Initialize(uint64_t mask, uint32_t max_version) {
   assert_false(wait_handle_);
@@ -34,66 +37,87 @@ void XNotifyListener::Initialize(uint64_t mask, uint32_t max_version) {
 }
 
 void XNotifyListener::EnqueueNotification(XNotificationID id, uint32_t data) {
-  auto key = XNotificationKey(id);
-  // Ignore if the notification doesn't match our mask.
-  if ((mask_ & uint64_t(1ULL << key.mask_index)) == 0) {
+  if (!IsNotificationAccepted(id)) {
     return;
   }
-  // Ignore if the notification is too new.
-  if (key.version > max_version_) {
-    return;
+  auto notification = new QueuedNotification;
+  notification->id = id;
+  notification->data = data;
+  queued_notifications_.Push(notification);
+  // Only signal on the transition from empty, most broadcasts happen while
+  // the previous notifications are still waiting to be taken.
+  if (!notification_count_.fetch_add(1, std::memory_order_acq_rel)) {
+    wait_handle_->Set();
+  }
+}
+
+void XNotifyListener::TakeQueuedNotifications() {
+  while (MpscQueueNode* node = queued_notifications_.Pop()) {
+    auto notification = static_cast<QueuedNotification*>(node);
+    pending_notifications_.emplace_back(notification->id, notification->data);
+    delete notification;
+  }
+}
+
+void XNotifyListener::OnNotificationDequeued() {
+  if (notification_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    wait_handle_->Reset();
+    // A notification may have been enqueued, and the handle set, between the
+    // decrement and the reset.
+    if (notification_count_.load(std::memory_order_acquire)) {
+      wait_handle_->Set();
+    }
   }
-  auto global_lock = global_critical_region_.Acquire();
-  notifications_.push_back(std::pair<XNotificationID, uint32_t>(id, data));
-  wait_handle_->Set();
 }
 
 bool XNotifyListener::DequeueNotification(XNotificationID* out_id,
                                           uint32_t* out_data) {
-  auto global_lock = global_critical_region_.Acquire();
-  bool dequeued = false;
-  if (notifications_.size()) {
-    dequeued = true;
-    auto it = notifications_.begin();
-    *out_id = it->first;
-    *out_data = it->second;
-    notifications_.erase(it);
-    if (!notifications_.size()) {
-      wait_handle_->Reset();
-    }
+  if (!notification_count_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  std::lock_guard<xe_mutex> lock(dequeue_mutex_);
+  TakeQueuedNotifications();
+  if (pending_notifications_.empty()) {
+    // Still being enqueued.
+    return false;
   }
-  return dequeued;
+  *out_id = pending_notifications_.front().first;
+  *out_data = pending_notifications_.front().second;
+  pending_notifications_.pop_front();
+  OnNotificationDequeued();
+  return true;
 }
 
 bool XNotifyListener::DequeueNotification(XNotificationID id,
                                           uint32_t* out_data) {
-  auto global_lock = global_critical_region_.Acquire();
-  if (!notifications_.size()) {
+  if (!notification_count_.load(std::memory_order_acquire)) {
     return false;
   }
-  bool dequeued = false;
-  for (auto it = notifications_.begin(); it != notifications_.end(); ++it) {
+  std::lock_guard<xe_mutex> lock(dequeue_mutex_);
+  TakeQueuedNotifications();
+  for (auto it = pending_notifications_.begin();
+       it != pending_notifications_.end(); ++it) {
     if (it->first != id) {
       continue;
     }
-    dequeued = true;
     *out_data = it->second;
-    notifications_.erase(it);
-    if (!notifications_.size()) {
-      wait_handle_->Reset();
-    }
-    break;
+    pending_notifications_.erase(it);
+    OnNotificationDequeued();
+    return true;
   }
-  return dequeued;
+  return false;
 }
 
 bool XNotifyListener::Save(ByteStream* stream) {
   SaveObject(stream);
 
+  std::lock_guard<xe_mutex> lock(dequeue_mutex_);
+  TakeQueuedNotifications();
+
   stream->Write(mask_);
   stream->Write(max_version_);
-  stream->Write(notifications_.size());
-  for (auto pair : notifications_) {
+  stream->Write(pending_notifications_.size());
+  for (auto pair : pending_notifications_) {
     stream->Write<uint32_t>(pair.first);
     stream->Write<uint32_t>(pair.second);
   }
@@ -117,7 +141,7 @@ object_ref<XNotifyListener> XNotifyListener::Restore(KernelState* kernel_state,
     std::pair<XNotificationID, uint32_t> pair;
     pair.first = stream->Read<uint32_t>();
     pair.second = stream->Read<uint32_t>();
-    notify->notifications_.push_back(pair);
+    notify->EnqueueNotification(pair.first, pair.second);
   }
 
   return object_ref<XNotifyListener>(notify);
@@ -10,10 +10,14 @@
 #ifndef XENIA_KERNEL_XNOTIFYLISTENER_H_
 #define XENIA_KERNEL_XNOTIFYLISTENER_H_
 
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <unordered_map>
+#include <utility>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/mpsc_queue.h"
 #include "xenia/base/mutex.h"
 #include "xenia/base/threading.h"
 #include "xenia/kernel/xobject.h"
@@ -52,6 +56,14 @@ class XNotifyListener : public XObject {
 
   void Initialize(uint64_t mask, uint32_t max_version);
 
+  bool IsNotificationAccepted(XNotificationID id) const {
+    auto key = XNotificationKey(id);
+    // Ignore if the notification doesn't match our mask, or is too new.
+    return (mask_ & (uint64_t(1) << key.mask_index)) &&
+           key.version <= max_version_;
+  }
+
+  // Lock-free, can be called from any thread.
   void EnqueueNotification(XNotificationID id, uint32_t data);
   bool DequeueNotification(XNotificationID* out_id, uint32_t* out_data);
   bool DequeueNotification(XNotificationID id, uint32_t* out_data);
@@ -66,9 +78,30 @@ class XNotifyListener : public XObject {
   }
 
  private:
+  struct QueuedNotification : MpscQueueNode {
+    XNotificationID id;
+    uint32_t data;
+  };
+
+  // Moves the notifications enqueued since the last call to
+  // pending_notifications_. Must be called with dequeue_mutex_ locked.
+  void TakeQueuedNotifications();
+  // Must be called with dequeue_mutex_ locked after removing a notification
+  // from pending_notifications_.
+  void OnNotificationDequeued();
+
+  // Set when the count becomes non-zero, reset when it becomes zero.
   std::unique_ptr<xe::threading::Event> wait_handle_;
-  xe::global_critical_region global_critical_region_;
-  std::vector<std::pair<XNotificationID, uint32_t>> notifications_;
+  // Notifications enqueued and not dequeued yet, both in queued_notifications_
+  // and in pending_notifications_.
+  std::atomic<uint32_t> notification_count_{0};
+  // Pushed to by the broadcasting threads without locking.
+  MpscQueue queued_notifications_;
+  // Notifications may be dequeued by multiple guest threads, and also not in
+  // the FIFO order by their ID, so taking them from the queue and removing them
+  // is done under the lock of this listener only.
+  xe_mutex dequeue_mutex_;
+  std::deque<std::pair<XNotificationID, uint32_t>> pending_notifications_;
   uint64_t mask_ = 0;
   uint32_t max_version_ = 0;
 };
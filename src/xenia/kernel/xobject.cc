@@ -13,6 +13,7 @@
 
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/clock.h"
+#include "xenia/base/counters.h"
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/util/shim_utils.h"
 #include "xenia/kernel/xboxkrnl/xboxkrnl_private.h"
@@ -30,6 +31,26 @@
 namespace xe {
 namespace kernel {
 
+static xe::counters::Counter& guest_run_counter =
+    xe::counters::GetCounter("kernel/guest_run_us");
+static xe::counters::Counter& wait_counter =
+    xe::counters::GetCounter("kernel/wait_us");
+// The end of the last wait on the thread, 0 before the first one.
+static thread_local uint64_t last_wait_end_ticks = 0;
+
+ScopedGuestWait::ScopedGuestWait()
+    : start_ticks_(Clock::QueryHostTickCount()) {
+  if (last_wait_end_ticks) {
+    xe::counters::ScopedTimer::AddElapsedMicroseconds(guest_run_counter,
+                                                      last_wait_end_ticks);
+  }
+}
+
+ScopedGuestWait::~ScopedGuestWait() {
+  xe::counters::ScopedTimer::AddElapsedMicroseconds(wait_counter, start_ticks_);
+  last_wait_end_ticks = Clock::QueryHostTickCount();
+}
+
 XObject::XObject(Type type)
     : kernel_state_(nullptr), pointer_ref_count_(1), type_(type) {
   handles_.reserve(10);
@@ -204,8 +225,12 @@ X_STATUS XObject::Wait(uint32_t wait_reason, uint32_t processor_mode,
                         TimeoutTicksToMs(*opt_timeout)))
                   : std::chrono::milliseconds::max();
 
-  auto result =
-      xe::threading::Wait(wait_handle, alertable ? true : false, timeout_ms);
+  xe::threading::WaitResult result;
+  {
+    ScopedGuestWait guest_wait;
+    result =
+        xe::threading::Wait(wait_handle, alertable ? true : false, timeout_ms);
+  }
   switch (result) {
     case xe::threading::WaitResult::kSuccess:
       WaitCallback();
@@ -231,9 +256,13 @@ X_STATUS XObject::SignalAndWait(XObject* signal_object, XObject* wait_object,
                         TimeoutTicksToMs(*opt_timeout)))
                   : std::chrono::milliseconds::max();
 
-  auto result = xe::threading::SignalAndWait(
-      signal_object->GetWaitHandle(), wait_object->GetWaitHandle(),
-      alertable ? true : false, timeout_ms);
+  xe::threading::WaitResult result;
+  {
+    ScopedGuestWait guest_wait;
+    result = xe::threading::SignalAndWait(
+        signal_object->GetWaitHandle(), wait_object->GetWaitHandle(),
+        alertable ? true : false, timeout_ms);
+  }
   switch (result) {
     case xe::threading::WaitResult::kSuccess:
       wait_object->WaitCallback();
@@ -267,6 +296,7 @@ X_STATUS XObject::WaitMultiple(uint32_t count, XObject** objects,
                         TimeoutTicksToMs(*opt_timeout)))
                   : std::chrono::milliseconds::max();
 
+  ScopedGuestWait guest_wait;
   if (wait_type) {
     auto result = xe::threading::WaitAny(wait_handles, count,
                                          alertable ? true : false, timeout_ms);
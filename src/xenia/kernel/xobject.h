@@ -99,6 +99,19 @@ struct X_OBJECT_CREATE_INFORMATION {
   // Security QoS here (SECURITY_QUALITY_OF_SERVICE) too!
 };
 
+// For the frame timeline, accounts the time the current guest thread spends in
+// a kernel wait, and the time since its previous wait as guest execution.
+class ScopedGuestWait {
+ public:
+  ScopedGuestWait();
+  ScopedGuestWait(const ScopedGuestWait& wait) = delete;
+  ScopedGuestWait& operator=(const ScopedGuestWait& wait) = delete;
+  ~ScopedGuestWait();
+
+ private:
+  uint64_t start_ticks_;
+};
+
 class XObject {
  public:
   // 45410806 needs proper handle value for certain calculations
@@ -25,24 +25,67 @@ bool XSemaphore::Initialize(int32_t initial_count, int32_t maximum_count) {
 
   CreateNative(sizeof(X_KSEMAPHORE));
 
+  // Same limits as for creating the host semaphore.
+  if (initial_count < 0 || initial_count > maximum_count ||
+      maximum_count <= 0) {
+    return false;
+  }
   maximum_count_ = maximum_count;
-  semaphore_ = xe::threading::Semaphore::Create(initial_count, maximum_count);
-  return !!semaphore_;
+  lazy_count_ = initial_count;
+  return true;
 }
 
 bool XSemaphore::InitializeNative(void* native_ptr, X_DISPATCH_HEADER* header) {
   assert_false(semaphore_);
 
   auto semaphore = reinterpret_cast<X_KSEMAPHORE*>(native_ptr);
-  maximum_count_ = semaphore->limit;
-  semaphore_ = xe::threading::Semaphore::Create(semaphore->header.signal_state,
-                                                semaphore->limit);
-  return !!semaphore_;
+  int32_t initial_count = semaphore->header.signal_state;
+  int32_t maximum_count = semaphore->limit;
+  if (initial_count < 0 || initial_count > maximum_count ||
+      maximum_count <= 0) {
+    return false;
+  }
+  maximum_count_ = maximum_count;
+  lazy_count_ = initial_count;
+  return true;
+}
+
+xe::threading::Semaphore* XSemaphore::GetOrCreateSemaphore() {
+  std::unique_lock<std::mutex> lock;
+  xe::threading::Semaphore* semaphore = GetSemaphoreOrLock(lock);
+  if (semaphore) {
+    return semaphore;
+  }
+  semaphore_ =
+      xe::threading::Semaphore::Create(lazy_count_, int32_t(maximum_count_));
+  assert_not_null(semaphore_);
+  semaphore_created_.store(true, std::memory_order_release);
+  return semaphore_.get();
+}
+
+xe::threading::Semaphore* XSemaphore::GetSemaphoreOrLock(
+    std::unique_lock<std::mutex>& lock) {
+  if (semaphore_created_.load(std::memory_order_acquire)) {
+    return semaphore_.get();
+  }
+  lock = std::unique_lock<std::mutex>(lazy_state_mutex_);
+  if (semaphore_created_.load(std::memory_order_relaxed)) {
+    lock.unlock();
+    return semaphore_.get();
+  }
+  return nullptr;
 }
 
 int32_t XSemaphore::ReleaseSemaphore(int32_t release_count) {
   int32_t previous_count = 0;
-  semaphore_->Release(release_count, &previous_count);
+  std::unique_lock<std::mutex> lock;
+  if (xe::threading::Semaphore* semaphore = GetSemaphoreOrLock(lock)) {
+    semaphore->Release(release_count, &previous_count);
+  } else if (release_count >= 1 &&
+             uint32_t(release_count) <= maximum_count_ - lazy_count_) {
+    previous_count = lazy_count_;
+    lazy_count_ += release_count;
+  }
   return previous_count;
 }
 
@@ -53,17 +96,24 @@ bool XSemaphore::Save(ByteStream* stream) {
 
   // Get the free number of slots from the semaphore.
   uint32_t free_count = 0;
-  while (
-      threading::Wait(semaphore_.get(), false, std::chrono::milliseconds(0)) ==
-      threading::WaitResult::kSuccess) {
-    free_count++;
+  std::unique_lock<std::mutex> lock;
+  xe::threading::Semaphore* semaphore = GetSemaphoreOrLock(lock);
+  if (semaphore) {
+    while (threading::Wait(semaphore, false, std::chrono::milliseconds(0)) ==
+           threading::WaitResult::kSuccess) {
+      free_count++;
+    }
+  } else {
+    free_count = uint32_t(lazy_count_);
   }
 
   XELOGD("XSemaphore {:08X} (count {}/{})", handle(), free_count,
          maximum_count_);
 
   // Restore the semaphore back to its previous count.
-  semaphore_->Release(free_count, nullptr);
+  if (semaphore && free_count) {
+    semaphore->Release(free_count, nullptr);
+  }
 
   stream->Write(maximum_count_);
   stream->Write(free_count);
@@ -85,9 +135,7 @@ object_ref<XSemaphore> XSemaphore::Restore(KernelState* kernel_state,
   XELOGD("XSemaphore {:08X} (count {}/{})", sem->handle(), free_count,
          sem->maximum_count_);
 
-  sem->semaphore_ =
-      threading::Semaphore::Create(free_count, sem->maximum_count_);
-  assert_not_null(sem->semaphore_);
+  sem->lazy_count_ = int32_t(free_count);
 
   return object_ref<XSemaphore>(sem);
 }
@@ -10,6 +10,9 @@
 #ifndef XENIA_KERNEL_XSEMAPHORE_H_
 #define XENIA_KERNEL_XSEMAPHORE_H_
 
+#include <atomic>
+#include <mutex>
+
 #include "xenia/base/threading.h"
 #include "xenia/kernel/xobject.h"
 #include "xenia/kernel/xthread.h"
@@ -36,10 +39,21 @@ class XSemaphore : public XObject {
 
  protected:
   xe::threading::WaitHandle* GetWaitHandle() override {
-    return semaphore_.get();
+    return GetOrCreateSemaphore();
   }
 
  private:
+  // Like XEvent, creates the host semaphore only when needed for waiting,
+  // tracking the count in the object until then.
+  xe::threading::Semaphore* GetOrCreateSemaphore();
+  // Returns nullptr with the lock held if the host semaphore hasn't been
+  // created yet.
+  xe::threading::Semaphore* GetSemaphoreOrLock(
+      std::unique_lock<std::mutex>& lock);
+
+  std::mutex lazy_state_mutex_;
+  int32_t lazy_count_ = 0;
+  std::atomic<bool> semaphore_created_ = false;
   std::unique_ptr<xe::threading::Semaphore> semaphore_;
   uint32_t maximum_count_ = 0;
 };
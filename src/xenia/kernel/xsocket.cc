@@ -10,6 +10,7 @@
 #include "src/xenia/kernel/xsocket.h"
 
 #include <cstring>
+#include <vector>
 
 #include "xenia/base/platform.h"
 #include "xenia/kernel/kernel_state.h"
@@ -52,11 +53,18 @@ X_STATUS XSocket::Initialize(AddressFamily af, Type type, Protocol proto) {
 
 X_STATUS XSocket::Close() {
   std::unique_lock lock(receive_mutex_);
-  if (active_overlapped_ && !(active_overlapped_->offset_high & 1)) {
+  bool receive_pending =
+      active_overlapped_ && !(active_overlapped_->offset_high & 1);
+  if (receive_pending) {
     active_overlapped_->offset_high |= 2;
   }
   lock.unlock();
 
+  if (receive_pending) {
+    // Completes the receive as aborted.
+    kernel_state_->socket_reactor()->Cancel(native_handle_);
+  }
+
   std::unique_lock socket_lock(receive_socket_mutex_);
 #if XE_PLATFORM_WIN32
   int ret = closesocket(native_handle_);
@@ -277,21 +285,25 @@ int XSocket::PollWSARecvFrom(bool wait, WSARecvFromData receive_async_data) {
   DWORD flags = receive_async_data.flags;
   auto buffers = new WSABUF[receive_async_data.num_buffers];
 
-  int ret;
-  do {
 #ifdef XE_PLATFORM_WIN32
-    ret = WSAPoll(fds, 1, wait ? 1000 : 0);
+  int ret = WSAPoll(fds, 1, 0);
 #else
-    ret = poll(fds, 1, wait ? 1000 : 0);
+  int ret = poll(fds, 1, 0);
 #endif
 
-    if (receive_async_data.overlapped->offset_high & 2) {
-      receive_async_data.overlapped->internal_high =
-          (uint32_t)X_WSAError::X_WSA_OPERATION_ABORTED;
-      ret = -1;
-      goto threadexit;
-    }
-  } while (ret == 0 && wait);
+  if (receive_async_data.overlapped->offset_high & 2) {
+    receive_async_data.overlapped->internal_high =
+        (uint32_t)X_WSAError::X_WSA_OPERATION_ABORTED;
+    ret = -1;
+    goto threadexit;
+  }
+
+  if (ret == 0 && wait) {
+    // Another receive has taken what the socket was readable for.
+    delete[] buffers;
+    WatchPendingWSARecvFrom(receive_async_data);
+    return -1;
+  }
 
   if (ret < 0) {
     receive_async_data.overlapped->internal_high = WSAGetLastError();
@@ -427,9 +439,11 @@ int XSocket::WSARecvFrom(XWSABUF* buffers, uint32_t num_buffers,
     SetLastWSAError((X_WSAError)wsa_error);
 
     if (overlapped_ptr && wsa_error == (uint32_t)X_WSAError::X_WSAEWOULDBLOCK) {
+      SocketReactor* socket_reactor = kernel_state_->socket_reactor();
       receive_mutex_.lock();
 
-      if (!active_overlapped_ || active_overlapped_->offset_high & 1) {
+      if (socket_reactor->is_valid() &&
+          (!active_overlapped_ || active_overlapped_->offset_high & 1)) {
         // These may have been on the stack - copy them.
         receive_async_data.buffers = new XWSABUF[num_buffers];
         std::memcpy(receive_async_data.buffers, buffers,
@@ -441,16 +455,8 @@ int XSocket::WSARecvFrom(XWSABUF* buffers, uint32_t num_buffers,
         }
         active_overlapped_ = overlapped_ptr;
 
-        if (!polling_task_.valid()) {
-          polling_task_ =
-              std::async(std::launch::async, &XSocket::PollWSARecvFrom, this,
-                         true, receive_async_data);
-        } else {
-          auto status = polling_task_.wait_for(0ms);
-          if (status == std::future_status::ready) {
-            auto result = polling_task_.get();
-          }
-        }
+        // Completed on the reactor thread when the socket becomes readable.
+        WatchPendingWSARecvFrom(receive_async_data);
         SetLastWSAError(X_WSAError::X_WSA_IO_PENDING);
       }
 
@@ -466,6 +472,13 @@ int XSocket::WSARecvFrom(XWSABUF* buffers, uint32_t num_buffers,
   return ret;
 }
 
+void XSocket::WatchPendingWSARecvFrom(WSARecvFromData receive_async_data) {
+  kernel_state_->socket_reactor()->WatchReadable(
+      native_handle_, [this, receive_async_data]() {
+        PollWSARecvFrom(true, receive_async_data);
+      });
+}
+
 bool XSocket::WSAGetOverlappedResult(XWSAOVERLAPPED* overlapped_ptr,
                                      xe::be<uint32_t>* bytes_transferred,
                                      bool wait, xe::be<uint32_t>* flags_ptr) {
@@ -505,15 +518,73 @@ int XSocket::Send(const uint8_t* buf, uint32_t buf_len, uint32_t flags) {
 
 int XSocket::SendTo(uint8_t* buf, uint32_t buf_len, uint32_t flags,
                     XSOCKADDR_IN* to, uint32_t to_len) {
-  to->address_port =
-      XLiveAPI::upnp_handler->GetMappedBindPort(to->address_port);
-
-  sockaddr addr = to->to_host();
+  // The port is mapped in a copy, not in the address of the guest.
+  sockaddr addr = {};
+  if (to) {
+    XSOCKADDR_IN mapped_to = *to;
+    mapped_to.address_port =
+        XLiveAPI::upnp_handler->GetMappedBindPort(to->address_port);
+    addr = mapped_to.to_host();
+  }
 
   return sendto(native_handle_, reinterpret_cast<char*>(buf), buf_len, flags,
                 to ? &addr : nullptr, to_len);
 }
 
+int XSocket::WSASendTo(const XWSABUF* buffers, uint32_t num_buffers,
+                       uint32_t flags, const XSOCKADDR_IN* to,
+                       uint32_t to_len) {
+  sockaddr addr = {};
+  if (to) {
+    XSOCKADDR_IN mapped_to = *to;
+    mapped_to.address_port =
+        XLiveAPI::upnp_handler->GetMappedBindPort(to->address_port);
+    addr = mapped_to.to_host();
+  }
+
+  // Titles send up to a few buffers, a header and the payload usually.
+  constexpr uint32_t kMaxLocalBuffers = 8;
+  Memory* memory = kernel_state_->memory();
+#ifdef XE_PLATFORM_WIN32
+  WSABUF local_buffers[kMaxLocalBuffers];
+  std::vector<WSABUF> heap_buffers;
+  WSABUF* host_buffers = local_buffers;
+  if (num_buffers > kMaxLocalBuffers) {
+    heap_buffers.resize(num_buffers);
+    host_buffers = heap_buffers.data();
+  }
+  for (uint32_t i = 0; i < num_buffers; ++i) {
+    host_buffers[i].len = buffers[i].len;
+    host_buffers[i].buf = memory->TranslateVirtual<CHAR*>(buffers[i].buf_ptr);
+  }
+
+  DWORD bytes_sent = 0;
+  int ret = ::WSASendTo(native_handle_, host_buffers, num_buffers, &bytes_sent,
+                        flags, to ? &addr : nullptr, to_len, nullptr, nullptr);
+  return ret == 0 ? int(bytes_sent) : -1;
+#else
+  iovec local_buffers[kMaxLocalBuffers];
+  std::vector<iovec> heap_buffers;
+  iovec* host_buffers = local_buffers;
+  if (num_buffers > kMaxLocalBuffers) {
+    heap_buffers.resize(num_buffers);
+    host_buffers = heap_buffers.data();
+  }
+  for (uint32_t i = 0; i < num_buffers; ++i) {
+    host_buffers[i].iov_len = buffers[i].len;
+    host_buffers[i].iov_base = memory->TranslateVirtual(buffers[i].buf_ptr);
+  }
+
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_name = to ? &addr : nullptr;
+  msg.msg_namelen = to ? to_len : 0;
+  msg.msg_iov = host_buffers;
+  msg.msg_iovlen = num_buffers;
+  return int(sendmsg(native_handle_, &msg, flags));
+#endif
+}
+
 int XSocket::WSAEventSelect(uint64_t socket_handle, uint64_t event_handle,
                             uint32_t flags) {
   return ::WSAEventSelect(socket_handle, reinterpret_cast<HANDLE>(event_handle),
@@ -145,6 +145,10 @@ class XSocket : public XObject {
                XSOCKADDR_IN* from, uint32_t* from_len);
   int SendTo(uint8_t* buf, uint32_t buf_len, uint32_t flags, XSOCKADDR_IN* to,
              uint32_t to_len);
+  // Sends the guest buffers as one datagram, gathered by the host from guest
+  // memory.
+  int WSASendTo(const XWSABUF* buffers, uint32_t num_buffers, uint32_t flags,
+                const XSOCKADDR_IN* to, uint32_t to_len);
 
   int WSAEventSelect(uint64_t socket_handle, uint64_t event_handle,
                      uint32_t flags);
@@ -195,14 +199,15 @@ class XSocket : public XObject {
   std::mutex incoming_packet_mutex_;
   std::queue<uint8_t*> incoming_packets_;
 
-  std::future<int> polling_task_;
-
   std::mutex receive_mutex_;
   std::condition_variable receive_cv_;
   std::mutex receive_socket_mutex_;
   XWSAOVERLAPPED* active_overlapped_ = nullptr;
 
+  // Completes the receive if the socket is readable. With wait, completes the
+  // pending overlapped receive, called by the socket reactor.
   int PollWSARecvFrom(bool wait, struct WSARecvFromData data);
+  void WatchPendingWSARecvFrom(struct WSARecvFromData data);
 
   void SetLastWSAError(X_WSAError) const;
 };
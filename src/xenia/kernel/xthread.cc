@@ -9,16 +9,23 @@
 
 #include "xenia/kernel/xthread.h"
 
+#include <algorithm>
+#include <charconv>
 #include <cstring>
+#include <map>
+#include <string_view>
+#include <vector>
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/clock.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/literals.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
+#include "xenia/base/utf8.h"
 #include "xenia/cpu/breakpoint.h"
 #include "xenia/cpu/ppc/ppc_decode_data.h"
 #include "xenia/cpu/processor.h"
@@ -32,6 +39,26 @@ DEFINE_bool(ignore_thread_priorities, true,
             "Ignores game-specified thread priorities.", "Kernel");
 DEFINE_bool(ignore_thread_affinities, true,
             "Ignores game-specified thread affinities.", "Kernel");
+DEFINE_bool(pin_guest_hardware_threads, false,
+            "Runs the guest threads of each of the 6 guest hardware threads on "
+            "a dedicated host logical processor (the SMT siblings of a host "
+            "core for the 2 hardware threads of a guest core where possible), "
+            "honoring the affinities and the priorities set by the game, and "
+            "keeps the other emulator threads off those processors. Requires "
+            "at least 4 host cores.",
+            "Kernel");
+DEFINE_string(guest_hardware_thread_host_processors, "",
+              "Comma-separated indices of the host logical processors to run "
+              "the 6 guest hardware threads on with "
+              "pin_guest_hardware_threads, or empty to choose them based on "
+              "the host processor topology.",
+              "Kernel");
+DEFINE_bool(numa_local_guest_memory, true,
+            "On hosts with multiple NUMA nodes, keeps the guest hardware "
+            "threads pinned with pin_guest_hardware_threads on a single node "
+            "when choosing the processors based on the topology, and places "
+            "the guest memory and the generated code on that node.",
+            "Kernel");
 
 #if 0
 DEFINE_int64(stack_size_multiplier_hack, 1,
@@ -52,6 +79,18 @@ using namespace xe::literals;
 
 uint32_t next_xthread_id_ = 0;
 
+// Size of the KPCR block allocated for each thread.
+constexpr uint32_t kPcrAllocationSize = 0x2D8;
+
+static xe::counters::Counter& thread_create_us_counter =
+    xe::counters::GetCounter("kernel/thread_create_us");
+static xe::counters::Counter& thread_memory_reused_counter =
+    xe::counters::GetCounter("kernel/thread_memory_reused");
+static xe::counters::Counter& apc_deliveries_counter =
+    xe::counters::GetCounter("kernel/apc_deliveries");
+static xe::counters::Counter& apc_delivery_latency_us_counter =
+    xe::counters::GetCounter("kernel/apc_delivery_latency_us");
+
 XThread::XThread(KernelState* kernel_state)
     : XObject(kernel_state, kObjectType), guest_thread_(true) {}
 
@@ -90,12 +129,15 @@ XThread::~XThread() {
 
   thread_.reset();
 
+  // The thread may have been terminated during a delay.
+  if (auto delay_wait_item = delay_wait_item_.lock()) {
+    delay_wait_item->Disarm();
+  }
+
   if (thread_state_) {
     delete thread_state_;
   }
-  kernel_state()->memory()->SystemHeapFree(tls_static_address_);
-  kernel_state()->memory()->SystemHeapFree(pcr_address_);
-  FreeStack();
+  ReleaseMemory();
 
   if (thread_) {
     // TODO(benvanik): platform kill
@@ -155,6 +197,166 @@ void XThread::set_name(const std::string_view name) {
   }
 }
 
+// Host logical processor of each guest hardware thread, if pinning.
+static bool guest_cpus_pinned_ = false;
+static uint32_t guest_cpu_host_processors_[6];
+static uint32_t guest_cpu_numa_node_ = UINT32_MAX;
+
+static bool ChooseGuestCpuHostProcessors(uint32_t* host_processors_out) {
+  uint32_t processor_count =
+      std::min(xe::threading::logical_processor_count(), 64u);
+  if (!cvars::guest_hardware_thread_host_processors.empty()) {
+    std::vector<std::string_view> indices = xe::utf8::split(
+        cvars::guest_hardware_thread_host_processors, ", ");
+    if (indices.size() != 6) {
+      XELOGE("guest_hardware_thread_host_processors must contain 6 indices");
+      return false;
+    }
+    for (size_t i = 0; i < 6; ++i) {
+      uint32_t index = UINT32_MAX;
+      std::from_chars(indices[i].data(), indices[i].data() + indices[i].size(),
+                      index);
+      if (index >= processor_count) {
+        XELOGE("Invalid host logical processor {} for guest hardware thread {}",
+               indices[i], i);
+        return false;
+      }
+      host_processors_out[i] = index;
+    }
+    return true;
+  }
+
+  std::vector<std::vector<uint32_t>> cores;
+  for (std::vector<uint32_t>& core :
+       xe::threading::GetPhysicalCoreLogicalProcessors()) {
+    // Only the processors that can be in an affinity mask.
+    core.erase(std::remove_if(core.begin(), core.end(),
+                              [processor_count](uint32_t processor) {
+                                return processor >= processor_count;
+                              }),
+               core.end());
+    if (!core.empty()) {
+      cores.push_back(std::move(core));
+    }
+  }
+  if (cores.empty()) {
+    for (uint32_t i = 0; i < processor_count; ++i) {
+      cores.push_back({i});
+    }
+  }
+  if (cvars::numa_local_guest_memory) {
+    // Only the cores of the node with the most of them if there are enough, so
+    // none of the guest hardware threads accesses memory on a remote node.
+    std::map<uint32_t, size_t> node_core_counts;
+    for (const std::vector<uint32_t>& core : cores) {
+      ++node_core_counts[xe::threading::GetProcessorNumaNode(core[0])];
+    }
+    auto largest_node = std::max_element(
+        node_core_counts.cbegin(), node_core_counts.cend(),
+        [](const auto& a, const auto& b) { return a.second < b.second; });
+    if (node_core_counts.size() >= 2 && largest_node->first != UINT32_MAX &&
+        largest_node->second >= 4) {
+      uint32_t node = largest_node->first;
+      cores.erase(std::remove_if(cores.begin(), cores.end(),
+                                 [node](const std::vector<uint32_t>& core) {
+                                   return xe::threading::GetProcessorNumaNode(
+                                              core[0]) != node;
+                                 }),
+                  cores.end());
+    }
+  }
+  // The first core usually takes most of the interrupts and the work of the
+  // other processes, so it's left to the host threads.
+  if (cores.size() < 4) {
+    XELOGW("Too few host processor cores to pin the guest hardware threads");
+    return false;
+  }
+  std::vector<const std::vector<uint32_t>*> smt_cores;
+  for (size_t i = 1; i < cores.size(); ++i) {
+    if (cores[i].size() >= 2) {
+      smt_cores.push_back(&cores[i]);
+    }
+  }
+  if (smt_cores.size() >= 3) {
+    // A guest core on a host core, with the hardware threads on its siblings.
+    for (uint32_t i = 0; i < 3; ++i) {
+      host_processors_out[i * 2] = (*smt_cores[i])[0];
+      host_processors_out[i * 2 + 1] = (*smt_cores[i])[1];
+    }
+  } else if (cores.size() >= 7) {
+    // A host core per guest hardware thread.
+    for (uint32_t i = 0; i < 6; ++i) {
+      host_processors_out[i] = cores[1 + i][0];
+    }
+  } else {
+    // A host core per guest core.
+    for (uint32_t i = 0; i < 6; ++i) {
+      host_processors_out[i] = cores[1 + i / 2][0];
+    }
+  }
+  return true;
+}
+
+void XThread::InitializeHostProcessorMapping() {
+  if (!cvars::pin_guest_hardware_threads || guest_cpus_pinned_) {
+    return;
+  }
+  if (!ChooseGuestCpuHostProcessors(guest_cpu_host_processors_)) {
+    return;
+  }
+  guest_cpus_pinned_ = true;
+  uint32_t processor_count =
+      std::min(xe::threading::logical_processor_count(), 64u);
+  uint64_t host_mask = (processor_count >= 64)
+                           ? ~uint64_t(0)
+                           : (uint64_t(1) << processor_count) - 1;
+  for (uint32_t i = 0; i < 6; ++i) {
+    host_mask &= ~(uint64_t(1) << guest_cpu_host_processors_[i]);
+  }
+  if (host_mask) {
+    xe::threading::SetDefaultThreadAffinityMask(host_mask);
+    // Also inherited by the threads not created with threading::Thread on
+    // some platforms.
+    xe::threading::Thread::GetCurrentThread()->set_affinity_mask(host_mask);
+  }
+  XELOGI(
+      "Guest hardware threads pinned to host logical processors "
+      "{}, {}, {}, {}, {}, {}",
+      guest_cpu_host_processors_[0], guest_cpu_host_processors_[1],
+      guest_cpu_host_processors_[2], guest_cpu_host_processors_[3],
+      guest_cpu_host_processors_[4], guest_cpu_host_processors_[5]);
+
+  if (cvars::numa_local_guest_memory) {
+    bool multiple_nodes = false;
+    uint32_t first_node = xe::threading::GetProcessorNumaNode(0);
+    for (uint32_t i = 1; i < processor_count && !multiple_nodes; ++i) {
+      multiple_nodes = xe::threading::GetProcessorNumaNode(i) != first_node;
+    }
+    uint32_t node =
+        xe::threading::GetProcessorNumaNode(guest_cpu_host_processors_[0]);
+    for (uint32_t i = 1; i < 6; ++i) {
+      if (xe::threading::GetProcessorNumaNode(guest_cpu_host_processors_[i]) !=
+          node) {
+        node = UINT32_MAX;
+        break;
+      }
+    }
+    if (multiple_nodes) {
+      if (node != UINT32_MAX) {
+        guest_cpu_numa_node_ = node;
+      } else {
+        XELOGW(
+            "The guest hardware threads are on different host NUMA nodes, "
+            "not placing the guest memory on one");
+      }
+    }
+  }
+}
+
+uint32_t XThread::GetGuestHardwareThreadNumaNode() {
+  return guest_cpu_numa_node_;
+}
+
 static uint8_t next_cpu = 0;
 static uint8_t GetFakeCpuNumber(uint8_t proc_mask) {
   // NOTE: proc_mask is logical processors, not physical processors or cores.
@@ -287,19 +489,66 @@ void XThread::FreeStack() {
   }
 }
 
+bool XThread::TakePooledMemory(uint32_t stack_size) {
+  // The same size as allocated by AllocateStack.
+  auto heap = memory()->LookupHeap(kStackAddressRangeBegin);
+  auto padding = heap->page_size() * 2;
+  stack_size = xe::round_up(stack_size, heap->page_size());
+
+  KernelState::PooledThreadMemory pooled_memory;
+  if (!kernel_state()->TakePooledThreadMemory(
+          stack_size + padding, tls_total_size_, pooled_memory)) {
+    return false;
+  }
+  thread_memory_reused_counter.Increment();
+
+  // The guard pages are still protected.
+  stack_alloc_base_ = pooled_memory.stack_alloc_base;
+  stack_alloc_size_ = pooled_memory.stack_alloc_size;
+  stack_limit_ = stack_alloc_base_ + (padding / 2);
+  stack_base_ = stack_limit_ + stack_size;
+  tls_static_address_ = pooled_memory.tls_address;
+  pcr_address_ = pooled_memory.pcr_address;
+
+  // Like the newly allocated memory. TLS is cleared by Create.
+  memory()->Zero(stack_limit_, stack_size);
+  memory()->Zero(pcr_address_, kPcrAllocationSize);
+  return true;
+}
+
+void XThread::ReleaseMemory() {
+  if (stack_alloc_base_ && tls_static_address_ && pcr_address_) {
+    KernelState::PooledThreadMemory pooled_memory;
+    pooled_memory.stack_alloc_base = stack_alloc_base_;
+    pooled_memory.stack_alloc_size = stack_alloc_size_;
+    pooled_memory.tls_address = tls_static_address_;
+    pooled_memory.tls_size = tls_total_size_;
+    pooled_memory.pcr_address = pcr_address_;
+    if (kernel_state()->PoolThreadMemory(pooled_memory)) {
+      tls_static_address_ = 0;
+      pcr_address_ = 0;
+      stack_alloc_base_ = 0;
+      stack_alloc_size_ = 0;
+      stack_base_ = 0;
+      stack_limit_ = 0;
+      return;
+    }
+  }
+  memory()->SystemHeapFree(tls_static_address_);
+  memory()->SystemHeapFree(pcr_address_);
+  FreeStack();
+}
+
 X_STATUS XThread::Create() {
+  xe::counters::ScopedTimer create_timer(thread_create_us_counter);
+
   // Thread kernel object.
   if (!CreateNative<X_KTHREAD>()) {
     XELOGW("Unable to allocate thread object");
     return X_STATUS_NO_MEMORY;
   }
 
-  // Allocate a stack.
-  if (!AllocateStack(creation_params_.stack_size)) {
-    return X_STATUS_NO_MEMORY;
-  }
-
-  // Allocate TLS block.
+  // TLS block size.
   // Games will specify a certain number of 4b slots that each thread will get.
   xex2_opt_tls_info* tls_header = nullptr;
   auto module = kernel_state()->GetExecutableModule();
@@ -320,12 +569,42 @@ X_STATUS XThread::Create() {
   // will directly access those through 0(r13).
   uint32_t tls_slot_size = tls_slots * 4;
   tls_total_size_ = tls_slot_size + tls_extended_size;
-  tls_static_address_ = memory()->SystemHeapAlloc(tls_total_size_);
-  tls_dynamic_address_ = tls_static_address_ + tls_extended_size;
-  if (!tls_static_address_) {
-    XELOGW("Unable to allocate thread local storage block");
-    return X_STATUS_NO_MEMORY;
+
+  if (!TakePooledMemory(creation_params_.stack_size)) {
+    // Allocate a stack.
+    if (!AllocateStack(creation_params_.stack_size)) {
+      return X_STATUS_NO_MEMORY;
+    }
+
+    // Allocate TLS block.
+    tls_static_address_ = memory()->SystemHeapAlloc(tls_total_size_);
+    if (!tls_static_address_) {
+      XELOGW("Unable to allocate thread local storage block");
+      return X_STATUS_NO_MEMORY;
+    }
+
+    // Allocate thread state block from heap.
+    // https://web.archive.org/web/20170704035330/https://www.microsoft.com/msj/archive/S2CE.aspx
+    // This is set as r13 for user code and some special inlined Win32 calls
+    // (like GetLastError/etc) will poke it directly.
+    // We try to use it as our primary store of data just to keep things all
+    // consistent.
+    // 0x000: pointer to tls data
+    // 0x100: pointer to TEB(?)
+    // 0x10C: Current CPU(?)
+    // 0x150: if >0 then error states don't get set (DPC active bool?)
+    // TEB:
+    // 0x14C: thread id
+    // 0x160: last error
+    // So, at offset 0x100 we have a 4b pointer to offset 200, then have the
+    // structure.
+    pcr_address_ = memory()->SystemHeapAlloc(kPcrAllocationSize);
+    if (!pcr_address_) {
+      XELOGW("Unable to allocate thread state block");
+      return X_STATUS_NO_MEMORY;
+    }
   }
+  tls_dynamic_address_ = tls_static_address_ + tls_extended_size;
 
   // Zero all of TLS.
   memory()->Fill(tls_static_address_, tls_total_size_, 0);
@@ -336,27 +615,6 @@ X_STATUS XThread::Create() {
                    tls_header->raw_data_size);
   }
 
-  // Allocate thread state block from heap.
-  // https://web.archive.org/web/20170704035330/https://www.microsoft.com/msj/archive/S2CE.aspx
-  // This is set as r13 for user code and some special inlined Win32 calls
-  // (like GetLastError/etc) will poke it directly.
-  // We try to use it as our primary store of data just to keep things all
-  // consistent.
-  // 0x000: pointer to tls data
-  // 0x100: pointer to TEB(?)
-  // 0x10C: Current CPU(?)
-  // 0x150: if >0 then error states don't get set (DPC active bool?)
-  // TEB:
-  // 0x14C: thread id
-  // 0x160: last error
-  // So, at offset 0x100 we have a 4b pointer to offset 200, then have the
-  // structure.
-  pcr_address_ = memory()->SystemHeapAlloc(0x2D8);
-  if (!pcr_address_) {
-    XELOGW("Unable to allocate thread state block");
-    return X_STATUS_NO_MEMORY;
-  }
-
   // Allocate processor thread state.
   // This is thread safe.
   thread_state_ = new cpu::ThreadState(kernel_state()->processor(), thread_id_,
@@ -376,6 +634,8 @@ X_STATUS XThread::Create() {
   X_KPCR* pcr = memory()->TranslateVirtual<X_KPCR*>(pcr_address_);
 
   pcr->tls_ptr = tls_static_address_;
+  pcr->tls_slots_ptr = tls_dynamic_address_;
+  pcr->tls_slot_count = tls_slot_count();
   pcr->pcr_ptr = pcr_address_;
   pcr->prcb_data.current_thread = guest_object();
   pcr->prcb = pcr_address_ + offsetof(X_KPCR, prcb_data);
@@ -617,6 +877,29 @@ void XThread::EnqueueApc(uint32_t normal_routine, uint32_t normal_context,
   xenia_assert(success == X_STATUS_SUCCESS);
 }
 
+void XThread::OnUserApcQueued() {
+  uint64_t queued_ticks = 0;
+  user_apc_queued_ticks_.compare_exchange_strong(
+      queued_ticks, Clock::QueryHostTickCount(), std::memory_order_relaxed);
+  // The host user callback interrupts an alertable host wait of the thread,
+  // which then delivers the guest APCs. The thread checks its queue before
+  // every alertable wait, so it's not needed when it's queuing for itself, or
+  // before it has started.
+  if (thread_ && this != GetCurrentThread()) {
+    thread_->QueueUserCallback([]() {});
+  }
+}
+
+void XThread::OnUserApcsDelivered() {
+  uint64_t queued_ticks =
+      user_apc_queued_ticks_.exchange(0, std::memory_order_relaxed);
+  if (queued_ticks) {
+    apc_deliveries_counter.Increment();
+    xe::counters::ScopedTimer::AddElapsedMicroseconds(
+        apc_delivery_latency_us_counter, queued_ticks);
+  }
+}
+
 void XThread::SetCurrentThread() { current_xthread_tls_ = this; }
 
 void XThread::DeliverAPCs() {
@@ -648,7 +931,7 @@ void XThread::SetPriority(int32_t increment) {
   } else {
     target_priority = xe::threading::ThreadPriority::kNormal;
   }
-  if (!cvars::ignore_thread_priorities) {
+  if (!cvars::ignore_thread_priorities || guest_cpus_pinned_) {
     thread_->set_priority(target_priority);
   }
 }
@@ -676,7 +959,13 @@ void XThread::SetActiveCpu(uint8_t cpu_index) {
     thread_object.current_cpu = cpu_index;
   }
 
-  if (xe::threading::logical_processor_count() >= 6) {
+  if (guest_cpus_pinned_) {
+    // Host threads stay on the processors not used by the guest.
+    if (is_guest_thread()) {
+      thread_->set_affinity_mask(uint64_t(1)
+                                 << guest_cpu_host_processors_[cpu_index]);
+    }
+  } else if (xe::threading::logical_processor_count() >= 6) {
     if (!cvars::ignore_thread_affinities) {
       thread_->set_affinity_mask(uint64_t(1) << cpu_index);
     }
@@ -688,7 +977,8 @@ void XThread::SetActiveCpu(uint8_t cpu_index) {
 }
 
 bool XThread::GetTLSValue(uint32_t slot, uint32_t* value_out) {
-  if (slot * 4 > tls_total_size_) {
+  // The same bounds as the inlined KeTlsGetValue and KeTlsSetValue.
+  if (slot >= tls_slot_count()) {
     return false;
   }
 
@@ -698,7 +988,7 @@ bool XThread::GetTLSValue(uint32_t slot, uint32_t* value_out) {
 }
 
 bool XThread::SetTLSValue(uint32_t slot, uint32_t value) {
-  if (slot * 4 >= tls_total_size_) {
+  if (slot >= tls_slot_count()) {
     return false;
   }
 
@@ -751,34 +1041,49 @@ X_STATUS XThread::Suspend(uint32_t* out_suspend_count) {
 
 X_STATUS XThread::Delay(uint32_t processor_mode, uint32_t alertable,
                         uint64_t interval) {
-  int64_t timeout_ticks = interval;
-  uint32_t timeout_ms;
+  int64_t timeout_ticks =
+      Clock::ScaleGuestDurationFileTime(static_cast<int64_t>(interval));
   if (timeout_ticks > 0) {
     // Absolute time, based on January 1, 1601.
-    // TODO(benvanik): convert time to relative time.
-    assert_always();
-    timeout_ms = 0;
-  } else if (timeout_ticks < 0) {
-    // Relative time.
-    timeout_ms = uint32_t(-timeout_ticks / 10000);  // Ticks -> MS
-  } else {
-    timeout_ms = 0;
-  }
-  timeout_ms = Clock::ScaleGuestDurationMillis(timeout_ms);
-  if (alertable) {
-    auto result =
-        xe::threading::AlertableSleep(std::chrono::milliseconds(timeout_ms));
-    switch (result) {
-      default:
-      case xe::threading::SleepResult::kSuccess:
-        return X_STATUS_SUCCESS;
-      case xe::threading::SleepResult::kAlerted:
+    timeout_ticks = std::min(
+        int64_t(Clock::QueryGuestSystemTime()) - timeout_ticks, int64_t(0));
+  }
+  ScopedGuestWait guest_wait;
+  if (!timeout_ticks) {
+    // Only yields the rest of the time slice.
+    if (alertable) {
+      if (xe::threading::AlertableSleep(std::chrono::milliseconds(0)) ==
+          xe::threading::SleepResult::kAlerted) {
         return X_STATUS_USER_APC;
+      }
+    } else {
+      xe::threading::Sleep(std::chrono::milliseconds(0));
     }
-  } else {
-    xe::threading::Sleep(std::chrono::milliseconds(timeout_ms));
     return X_STATUS_SUCCESS;
   }
+
+  // Through the timer queue rather than a host sleep, which may be rounded to
+  // the millisecond or the scheduler period.
+  if (!delay_event_) {
+    delay_event_ = xe::threading::Event::CreateAutoResetEvent(false);
+  }
+  auto due = xe::threading::TimerQueueWaitItem::clock::now() +
+             std::chrono::duration_cast<
+                 xe::threading::TimerQueueWaitItem::clock::duration>(
+                 std::chrono::nanoseconds(-timeout_ticks * 100));
+  xe::threading::Event* delay_event = delay_event_.get();
+  delay_wait_item_ = xe::threading::QueueTimerOnce(
+      [delay_event](void*) { delay_event->Set(); }, nullptr, due);
+  if (xe::threading::Wait(delay_event, bool(alertable)) ==
+      xe::threading::WaitResult::kUserCallback) {
+    if (auto delay_wait_item = delay_wait_item_.lock()) {
+      // Waits for the callback to finish if it's being called.
+      delay_wait_item->Disarm();
+    }
+    delay_event->Reset();
+    return X_STATUS_USER_APC;
+  }
+  return X_STATUS_SUCCESS;
 }
 
 struct ThreadSavedState {
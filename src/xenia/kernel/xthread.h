@@ -171,7 +171,11 @@ struct X_KPCR {
   X_KPRCB prcb_data;                        // 0x100
   // pointer to KPCRB?
   TypedGuestPointer<X_KPRCB> prcb;  // 0x2A8
-  uint8_t unk_2AC[0x2C];            // 0x2AC
+  // Not known to be used by the kernel, set by the emulator so the dynamic TLS
+  // slots can be accessed without calling the kernel.
+  xe::be<uint32_t> tls_slots_ptr;   // 0x2AC
+  xe::be<uint32_t> tls_slot_count;  // 0x2B0
+  uint8_t unk_2B4[0x24];            // 0x2B4
 };
 
 struct X_KTHREAD {
@@ -296,8 +300,22 @@ class XThread : public XObject, public cpu::Thread {
   static uint32_t GetLastError();
   static void SetLastError(uint32_t error_code);
 
+  // Chooses the host logical processors for the guest hardware threads if
+  // pin_guest_hardware_threads is enabled, and keeps the host threads created
+  // from now on off them. Must be called at startup, before the emulator
+  // creates its threads.
+  static void InitializeHostProcessorMapping();
+  // The host NUMA node of all the processors chosen for the guest hardware
+  // threads if the host has multiple nodes and numa_local_guest_memory is
+  // enabled, UINT32_MAX otherwise.
+  static uint32_t GetGuestHardwareThreadNumaNode();
+
   const CreationParams* creation_params() const { return &creation_params_; }
   uint32_t tls_ptr() const { return tls_static_address_; }
+  uint32_t tls_slot_count() const {
+    return (tls_total_size_ - (tls_dynamic_address_ - tls_static_address_)) /
+           4;
+  }
   uint32_t pcr_ptr() const { return pcr_address_; }
   // True if the thread is created by the guest app.
   bool is_guest_thread() const { return guest_thread_; }
@@ -322,6 +340,13 @@ class XThread : public XObject, public cpu::Thread {
 
   void EnqueueApc(uint32_t normal_routine, uint32_t normal_context,
                   uint32_t arg1, uint32_t arg2);
+  // Called after a user APC has been inserted into the queue of the thread,
+  // from any thread. Wakes the thread if it's in an alertable wait, for the
+  // APC to be delivered right away rather than when the wait ends.
+  void OnUserApcQueued();
+  // Called by the thread itself after delivering its user APCs, for measuring
+  // the delivery latency.
+  void OnUserApcsDelivered();
 
   int32_t priority() const { return priority_; }
   int32_t QueryPriority();
@@ -362,6 +387,11 @@ class XThread : public XObject, public cpu::Thread {
  protected:
   bool AllocateStack(uint32_t size);
   void FreeStack();
+  // Takes the stack, TLS and PCR memory of an exited thread if one with the
+  // same sizes is pooled, and clears it.
+  bool TakePooledMemory(uint32_t stack_size);
+  // Gives the stack, TLS and PCR memory to the pool or frees it.
+  void ReleaseMemory();
   void InitializeGuestObject();
 
   void DeliverAPCs();
@@ -387,6 +417,15 @@ class XThread : public XObject, public cpu::Thread {
   bool running_ = false;
 
   int32_t priority_ = 0;
+
+  // Signaled by the timer queue at the end of a Delay, created on the first
+  // one. Only used by the thread itself.
+  std::unique_ptr<xe::threading::Event> delay_event_;
+  std::weak_ptr<xe::threading::TimerQueueWaitItem> delay_wait_item_;
+
+  // Host time when the oldest of the user APCs not delivered yet was queued,
+  // or 0 if there are none.
+  std::atomic<uint64_t> user_apc_queued_ticks_{0};
 };
 
 class XHostThread : public XThread {
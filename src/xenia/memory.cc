@@ -10,17 +10,23 @@
 #include "xenia/memory.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <functional>
 #include <utility>
+#include <vector>
 
 #include "third_party/fmt/include/fmt/format.h"
+#include "third_party/zstd/lib/zstd.h"
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/clock.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
+#include "xenia/base/task_scheduler.h"
 #include "xenia/base/threading.h"
+#include "xenia/base/xxhash.h"
 
 #include "xenia/cpu/mmio_handler.h"
 
@@ -33,6 +39,13 @@ DEFINE_bool(protect_on_release, false,
             "Protect released memory to prevent accesses.", "Memory");
 DEFINE_bool(scribble_heap, false,
             "Scribble 0xCD into all allocated heap memory.", "Memory");
+DEFINE_bool(
+    memory_huge_pages, false,
+    "Back the guest memory with transparent huge pages where the host "
+    "supports them, to reduce TLB misses in memory-heavy titles. On Linux, "
+    "requires /sys/kernel/mm/transparent_hugepage/shmem_enabled to be "
+    "\"advise\" or \"always\".",
+    "Memory");
 
 namespace xe {
 uint32_t get_page_count(uint32_t value, uint32_t page_size) {
@@ -84,6 +97,18 @@ void CrashDump() {
   --in_crash_dump;
 }
 
+// Amount of memory hashed and compressed as a unit when saving snapshots.
+constexpr uint32_t kSnapshotChunkSize = 1024 * 1024;
+// Snapshots are taken often, favor speed over size.
+constexpr int kSnapshotZstdLevel = 1;
+
+// Runs the snapshot tasks on the task scheduler workers and the calling
+// thread.
+void RunSnapshotTasks(uint32_t task_count,
+                      const std::function<void(uint32_t task_index)>& task) {
+  xe::threading::TaskScheduler::Get().ParallelFor(task_count, task);
+}
+
 xe::memory::PageAccess ToPageAccess(uint32_t protect) {
   if ((protect & kMemoryProtectRead) && !(protect & kMemoryProtectWrite)) {
     return xe::memory::PageAccess::kReadOnly;
@@ -190,6 +215,10 @@ bool Memory::Initialize() {
                               &heaps_.physical);
   heaps_.vE0000000.Initialize(this, virtual_membase_, HeapType::kGuestPhysical,
                               0xE0000000, 0x1FD00000, 4096, &heaps_.physical);
+  for (uint32_t i = 0; i < xe::countof(host_address_offsets_); ++i) {
+    const BaseHeap* heap = LookupHeap(std::min(i << 28, 0xE0000000u));
+    host_address_offsets_[i] = heap ? heap->host_address_offset() : 0;
+  }
 
   // Protect the first and last 64kb of memory.
   heaps_.v00000000.AllocFixed(
@@ -330,9 +359,35 @@ int Memory::MapViews(uint8_t* mapping_base) {
       return 1;
     }
   }
+  if (cvars::memory_huge_pages) {
+    // Protection can still be changed for individual pages, the host splits
+    // the huge pages in the watched ranges.
+    bool huge_pages_advised = true;
+    for (size_t n = 0; n < xe::countof(map_info); n++) {
+      huge_pages_advised &= xe::memory::AdviseHugePages(
+          views_.all_views[n], map_info[n].virtual_address_end -
+                                   map_info[n].virtual_address_start + 1);
+    }
+    if (!huge_pages_advised) {
+      XELOGW("Huge pages are not supported for the guest memory on this host");
+    }
+  }
   return 0;
 }
 
+bool Memory::BindToNumaNode(uint32_t node) {
+  // Through all the views, as some parts of the backing file are only mapped
+  // in the physical memory ones.
+  bool bound = true;
+  for (size_t n = 0; n < xe::countof(map_info); n++) {
+    bound &= xe::memory::BindToNumaNode(
+        views_.all_views[n],
+        map_info[n].virtual_address_end - map_info[n].virtual_address_start + 1,
+        node);
+  }
+  return bound;
+}
+
 void Memory::UnmapViews() {
   for (size_t n = 0; n < xe::countof(views_.all_views); n++) {
     if (views_.all_views[n]) {
@@ -483,15 +538,30 @@ uint32_t Memory::GetPhysicalAddress(uint32_t address) const {
   return static_cast<const PhysicalHeap*>(heap)->GetPhysicalAddress(address);
 }
 
+void Memory::PrepareHostWrite(uint32_t address, uint32_t size) {
+  if (!size) {
+    return;
+  }
+  BaseHeap* heap = LookupHeap(address);
+  if (heap && heap->heap_type() == HeapType::kGuestPhysical &&
+      static_cast<PhysicalHeap*>(heap)->IsWatched(address, size)) {
+    TriggerPhysicalMemoryCallbacks(xe::global_critical_region::AcquireDirect(),
+                                   address, size, true, false);
+  }
+}
+
 void Memory::Zero(uint32_t address, uint32_t size) {
+  PrepareHostWrite(address, size);
   std::memset(TranslateVirtual(address), 0, size);
 }
 
 void Memory::Fill(uint32_t address, uint32_t size, uint8_t value) {
+  PrepareHostWrite(address, size);
   std::memset(TranslateVirtual(address), value, size);
 }
 
 void Memory::Copy(uint32_t dest, uint32_t src, uint32_t size) {
+  PrepareHostWrite(dest, size);
   uint8_t* pdest = TranslateVirtual(dest);
   const uint8_t* psrc = TranslateVirtual(src);
   std::memcpy(pdest, psrc, size);
@@ -500,23 +570,43 @@ void Memory::Copy(uint32_t dest, uint32_t src, uint32_t size) {
 uint32_t Memory::SearchAligned(uint32_t start, uint32_t end,
                                const uint32_t* values, size_t value_count) {
   assert_true(start <= end);
+  assert_not_zero(value_count);
   auto p = TranslateVirtual<const uint32_t*>(start);
-  auto pe = TranslateVirtual<const uint32_t*>(end);
-  while (p != pe) {
-    if (*p == values[0]) {
-      const uint32_t* pc = p + 1;
-      size_t matched = 1;
-      for (size_t n = 1; n < value_count; n++, pc++) {
-        if (*pc != values[n]) {
-          break;
+  size_t count = (end - start) / sizeof(uint32_t);
+  if (count < value_count) {
+    return 0;
+  }
+  // Last position where the whole run still fits in the range.
+  size_t last = count - value_count;
+  auto matches_at = [&](size_t i) {
+    return std::memcmp(p + i + 1, values + 1,
+                       (value_count - 1) * sizeof(uint32_t)) == 0;
+  };
+  size_t i = 0;
+#if XE_ARCH_AMD64
+  if (amd64::GetFeatureFlags() & amd64::kX64EmitAVX2) {
+    // Compare 8 dwords at once with the first value, and only check the rest
+    // of the run where it matches.
+    __m256i first = _mm256_set1_epi32(int(values[0]));
+    for (; i + 8 <= last + 1; i += 8) {
+      __m256i data =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+      uint32_t mask = uint32_t(_mm256_movemask_ps(
+          _mm256_castsi256_ps(_mm256_cmpeq_epi32(data, first))));
+      while (mask) {
+        size_t match = i + xe::tzcnt(mask);
+        if (matches_at(match)) {
+          return HostToGuestVirtual(p + match);
         }
-        matched++;
-      }
-      if (matched == value_count) {
-        return HostToGuestVirtual(p);
+        mask &= mask - 1;
       }
     }
-    p++;
+  }
+#endif  // XE_ARCH_AMD64
+  for (; i <= last; ++i) {
+    if (p[i] == values[0] && matches_at(i)) {
+      return HostToGuestVirtual(p + i);
+    }
   }
   return 0;
 }
@@ -552,6 +642,9 @@ bool Memory::AccessViolationCallback(
     return false;
   }
   uint32_t virtual_address = HostToGuestVirtual(host_address);
+  if (is_write && TriggerCodeWriteWatch(virtual_address)) {
+    return true;
+  }
   BaseHeap* heap = LookupHeap(virtual_address);
   if (heap->heap_type() != HeapType::kGuestPhysical) {
     return false;
@@ -567,6 +660,110 @@ bool Memory::AccessViolationCallback(
                                          virtual_address, 1, is_write, false);
 }
 
+void Memory::SetCodeWriteCallback(CodeWriteCallback callback,
+                                  void* callback_context) {
+  auto global_lock = global_critical_region_.Acquire();
+  code_write_callback_ = callback;
+  code_write_callback_context_ = callback_context;
+}
+
+void Memory::WatchCodeWrites(uint32_t virtual_address, uint32_t length) {
+  if (!length) {
+    return;
+  }
+  const uint32_t page_size = system_page_size_;
+  uint32_t page_first = virtual_address / page_size;
+  uint32_t page_last = uint32_t((uint64_t(virtual_address) + length - 1) /
+                                page_size);
+  auto global_lock = global_critical_region_.Acquire();
+  if (code_write_watches_.empty()) {
+    code_write_watches_.resize(
+        ((uint64_t(1) << 32) / page_size + 63) / 64);
+  }
+  for (uint32_t page = page_first; page <= page_last; ++page) {
+    uint64_t& watch_block = code_write_watches_[page >> 6];
+    uint64_t watch_bit = uint64_t(1) << (page & 63);
+    if (watch_block & watch_bit) {
+      continue;
+    }
+    uint32_t page_address = page * page_size;
+    BaseHeap* heap = LookupHeap(page_address);
+    uint32_t protect;
+    // Nothing to watch if the guest can't write there anyway.
+    if (!heap || heap->heap_type() == HeapType::kGuestPhysical ||
+        !heap->QueryProtect(page_address, &protect) ||
+        !(protect & kMemoryProtectWrite)) {
+      continue;
+    }
+    if (xe::memory::Protect(TranslateVirtual(page_address), page_size,
+                            xe::memory::PageAccess::kReadOnly, nullptr)) {
+      watch_block |= watch_bit;
+    }
+  }
+}
+
+void Memory::WatchReadOnlyPages(uint32_t virtual_address, uint32_t length) {
+  if (!length) {
+    return;
+  }
+  const uint32_t page_size = system_page_size_;
+  uint32_t page_first = virtual_address / page_size;
+  uint32_t page_last = uint32_t((uint64_t(virtual_address) + length - 1) /
+                                page_size);
+  auto global_lock = global_critical_region_.Acquire();
+  if (read_only_watches_.empty()) {
+    read_only_watches_.resize(((uint64_t(1) << 32) / page_size + 63) / 64);
+  }
+  for (uint32_t page = page_first; page <= page_last; ++page) {
+    read_only_watches_[page >> 6] |= uint64_t(1) << (page & 63);
+  }
+}
+
+void Memory::OnPagesMadeWritable(uint32_t virtual_address, uint32_t length) {
+  if (read_only_watches_.empty() || !length) {
+    return;
+  }
+  const uint32_t page_size = system_page_size_;
+  uint32_t page_first = virtual_address / page_size;
+  uint32_t page_last = uint32_t((uint64_t(virtual_address) + length - 1) /
+                                page_size);
+  for (uint32_t page = page_first; page <= page_last; ++page) {
+    uint64_t& watch_block = read_only_watches_[page >> 6];
+    uint64_t watch_bit = uint64_t(1) << (page & 63);
+    if (!(watch_block & watch_bit)) {
+      continue;
+    }
+    watch_block &= ~watch_bit;
+    if (code_write_callback_) {
+      code_write_callback_(code_write_callback_context_, page * page_size,
+                           page_size);
+    }
+  }
+}
+
+bool Memory::TriggerCodeWriteWatch(uint32_t virtual_address) {
+  if (code_write_watches_.empty()) {
+    return false;
+  }
+  const uint32_t page_size = system_page_size_;
+  uint32_t page = virtual_address / page_size;
+  uint64_t& watch_block = code_write_watches_[page >> 6];
+  uint64_t watch_bit = uint64_t(1) << (page & 63);
+  if (!(watch_block & watch_bit)) {
+    return false;
+  }
+  watch_block &= ~watch_bit;
+  uint32_t page_address = page * page_size;
+  // The write is retried after this, so the old code must be gone by then.
+  if (code_write_callback_) {
+    code_write_callback_(code_write_callback_context_, page_address,
+                         page_size);
+  }
+  xe::memory::Protect(TranslateVirtual(page_address), page_size,
+                      xe::memory::PageAccess::kReadWrite, nullptr);
+  return true;
+}
+
 bool Memory::AccessViolationCallbackThunk(
     global_unique_lock_type global_lock_locked_once, void* context,
     void* host_address, bool is_write) {
@@ -683,26 +880,21 @@ void Memory::DumpMap() {
   XELOGE("");
 }
 
-bool Memory::Save(ByteStream* stream) {
+bool Memory::Save(ByteStream* stream, bool incremental) {
   XELOGD("Serializing memory...");
-  heaps_.v00000000.Save(stream);
-  heaps_.v40000000.Save(stream);
-  heaps_.v80000000.Save(stream);
-  heaps_.v90000000.Save(stream);
-  heaps_.physical.Save(stream);
-
-  return true;
+  return heaps_.v00000000.Save(stream, incremental) &&
+         heaps_.v40000000.Save(stream, incremental) &&
+         heaps_.v80000000.Save(stream, incremental) &&
+         heaps_.v90000000.Save(stream, incremental) &&
+         heaps_.physical.Save(stream, incremental);
 }
 
 bool Memory::Restore(ByteStream* stream) {
   XELOGD("Restoring memory...");
-  heaps_.v00000000.Restore(stream);
-  heaps_.v40000000.Restore(stream);
-  heaps_.v80000000.Restore(stream);
-  heaps_.v90000000.Restore(stream);
-  heaps_.physical.Restore(stream);
-
-  return true;
+  return heaps_.v00000000.Restore(stream) &&
+         heaps_.v40000000.Restore(stream) &&
+         heaps_.v80000000.Restore(stream) &&
+         heaps_.v90000000.Restore(stream) && heaps_.physical.Restore(stream);
 }
 
 uint32_t FromPageAccess(xe::memory::PageAccess protect) {
@@ -745,6 +937,87 @@ void BaseHeap::Initialize(Memory* memory, uint8_t* membase, HeapType heap_type,
   host_address_offset_ = host_address_offset;
   page_table_.resize(heap_size / page_size);
   unreserved_page_count_ = uint32_t(page_table_.size());
+  RebuildPageUsage();
+}
+
+void BaseHeap::SetPagesUsed(uint32_t first_page, uint32_t page_count,
+                            bool used) {
+  uint32_t end_page = first_page + page_count;
+  while (first_page < end_page) {
+    uint32_t first_bit = first_page & 63;
+    uint32_t bit_count = std::min(64 - first_bit, end_page - first_page);
+    uint64_t mask = (bit_count == 64 ? ~uint64_t(0)
+                                     : (uint64_t(1) << bit_count) - 1)
+                    << first_bit;
+    if (used) {
+      page_usage_[first_page >> 6] |= mask;
+    } else {
+      page_usage_[first_page >> 6] &= ~mask;
+    }
+    first_page += bit_count;
+  }
+}
+
+void BaseHeap::RebuildPageUsage() {
+  uint32_t page_count = uint32_t(page_table_.size());
+  page_usage_.assign((size_t(page_count) + 63) >> 6, 0);
+  for (uint32_t i = 0; i < page_count; ++i) {
+    if (page_table_[i].state) {
+      page_usage_[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+  }
+  if (page_count & 63) {
+    page_usage_.back() |= ~uint64_t(0) << (page_count & 63);
+  }
+}
+
+uint32_t BaseHeap::FindUsedPage(uint32_t first_page, uint32_t end_page) const {
+  if (first_page >= end_page) {
+    return end_page;
+  }
+  size_t word_index = first_page >> 6;
+  uint64_t word = page_usage_[word_index] & (~uint64_t(0) << (first_page & 63));
+  while (!word) {
+    if (((word_index + 1) << 6) >= end_page) {
+      return end_page;
+    }
+    word = page_usage_[++word_index];
+  }
+  return std::min(uint32_t(word_index << 6) + xe::tzcnt(word), end_page);
+}
+
+uint32_t BaseHeap::FindFreePage(uint32_t first_page, uint32_t end_page) const {
+  if (first_page >= end_page) {
+    return end_page;
+  }
+  size_t word_index = first_page >> 6;
+  uint64_t word =
+      ~page_usage_[word_index] & (~uint64_t(0) << (first_page & 63));
+  while (!word) {
+    if (((word_index + 1) << 6) >= end_page) {
+      return end_page;
+    }
+    word = ~page_usage_[++word_index];
+  }
+  return std::min(uint32_t(word_index << 6) + xe::tzcnt(word), end_page);
+}
+
+uint32_t BaseHeap::FindLastFreePage(uint32_t first_page,
+                                    uint32_t last_page) const {
+  if (first_page > last_page) {
+    return UINT32_MAX;
+  }
+  size_t word_index = last_page >> 6;
+  uint64_t word =
+      ~page_usage_[word_index] & (~uint64_t(0) >> (63 - (last_page & 63)));
+  while (!word) {
+    if ((word_index << 6) <= first_page) {
+      return UINT32_MAX;
+    }
+    word = ~page_usage_[--word_index];
+  }
+  uint32_t page = uint32_t(word_index << 6) + 63 - xe::lzcnt(word);
+  return page >= first_page ? page : UINT32_MAX;
 }
 
 void BaseHeap::Dispose() {
@@ -811,28 +1084,110 @@ void BaseHeap::DumpMap() {
   }
 }
 
-bool BaseHeap::Save(ByteStream* stream) {
+bool BaseHeap::Save(ByteStream* stream, bool incremental) {
   XELOGD("Heap {:08X}-{:08X}", heap_base_, heap_base_ + (heap_size_ - 1));
 
-  for (size_t i = 0; i < page_table_.size(); i++) {
-    auto& page = page_table_[i];
-    stream->Write(page.qword);
-    if (!page.state) {
-      // Unallocated.
-      continue;
+  uint32_t page_count = uint32_t(page_table_.size());
+  snapshot_page_hashes_.resize(page_count, 0);
+  stream->Write(page_count);
+  stream->Write(page_table_.data(), sizeof(PageEntry) * page_count);
+
+  // Hash and compress the pages in chunks in parallel, then write the runs of
+  // changed committed pages in order.
+  struct Run {
+    uint32_t first_page;
+    uint32_t page_count;
+    std::vector<uint8_t> compressed;
+  };
+  uint32_t chunk_page_count = std::max(kSnapshotChunkSize >> page_size_shift_,
+                                       uint32_t(1));
+  uint32_t chunk_count = xe::round_up(page_count, chunk_page_count) /
+                         chunk_page_count;
+  std::vector<std::vector<Run>> chunk_runs(chunk_count);
+  std::atomic<bool> compression_failed{false};
+  RunSnapshotTasks(chunk_count, [&](uint32_t chunk_index) {
+    uint32_t chunk_first = chunk_index * chunk_page_count;
+    uint32_t chunk_end = std::min(chunk_first + chunk_page_count, page_count);
+    // Make pages the guest can't read readable for hashing and compression.
+    std::vector<uint32_t> unreadable_pages;
+    for (uint32_t i = chunk_first; i < chunk_end; ++i) {
+      const PageEntry& page = page_table_[i];
+      if ((page.state & kMemoryAllocationCommit) &&
+          !(page.current_protect & kMemoryProtectRead)) {
+        memory::Protect(TranslateRelative(size_t(i) << page_size_shift_),
+                        page_size_, memory::PageAccess::kReadOnly, nullptr);
+        unreadable_pages.push_back(i);
+      }
     }
+    uint32_t run_first = UINT32_MAX;
+    for (uint32_t i = chunk_first; i <= chunk_end; ++i) {
+      bool dirty = false;
+      if (i < chunk_end) {
+        uint64_t& hash = snapshot_page_hashes_[i];
+        if (page_table_[i].state & kMemoryAllocationCommit) {
+          uint64_t previous_hash = hash;
+          hash = XXH3_64bits(TranslateRelative(size_t(i) << page_size_shift_),
+                             page_size_);
+          // A hash of 0 is used for pages not present in the previous
+          // snapshot.
+          dirty = !incremental || !previous_hash || hash != previous_hash;
+        } else {
+          hash = 0;
+        }
+      }
+      if (dirty) {
+        if (run_first == UINT32_MAX) {
+          run_first = i;
+        }
+        continue;
+      }
+      if (run_first == UINT32_MAX) {
+        continue;
+      }
+      Run& run = chunk_runs[chunk_index].emplace_back();
+      run.first_page = run_first;
+      run.page_count = i - run_first;
+      size_t run_size = size_t(run.page_count) << page_size_shift_;
+      run.compressed.resize(ZSTD_compressBound(run_size));
+      size_t compressed_size = ZSTD_compress(
+          run.compressed.data(), run.compressed.size(),
+          TranslateRelative(size_t(run_first) << page_size_shift_), run_size,
+          kSnapshotZstdLevel);
+      if (ZSTD_isError(compressed_size)) {
+        compression_failed = true;
+        compressed_size = 0;
+      }
+      run.compressed.resize(compressed_size);
+      run_first = UINT32_MAX;
+    }
+    for (uint32_t i : unreadable_pages) {
+      memory::Protect(TranslateRelative(size_t(i) << page_size_shift_),
+                      page_size_, ToPageAccess(page_table_[i].current_protect),
+                      nullptr);
+    }
+  });
+  if (compression_failed) {
+    XELOGE("Failed to compress the memory of heap {:08X}", heap_base_);
+    // Make the next snapshot write everything.
+    std::fill(snapshot_page_hashes_.begin(), snapshot_page_hashes_.end(), 0);
+    return false;
+  }
 
-    // TODO(DrChat): write compressed with snappy.
-    if (page.state & kMemoryAllocationCommit) {
-      void* addr = TranslateRelative(i * page_size_);
-
-      memory::PageAccess old_access;
-      memory::Protect(addr, page_size_, memory::PageAccess::kReadWrite,
-                      &old_access);
-
-      stream->Write(addr, page_size_);
-
-      memory::Protect(addr, page_size_, old_access, nullptr);
+  uint32_t run_count = 0;
+  for (const std::vector<Run>& runs : chunk_runs) {
+    run_count += uint32_t(runs.size());
+  }
+  stream->Write(run_count);
+  for (const std::vector<Run>& runs : chunk_runs) {
+    for (const Run& run : runs) {
+      stream->Write(run.first_page);
+      stream->Write(run.page_count);
+      stream->Write(uint32_t(run.compressed.size()));
+      // The hashes of the pages let Restore skip the runs that the memory
+      // already contains.
+      stream->Write(snapshot_page_hashes_.data() + run.first_page,
+                    sizeof(uint64_t) * run.page_count);
+      stream->Write(run.compressed.data(), run.compressed.size());
     }
   }
 
@@ -842,50 +1197,139 @@ bool BaseHeap::Save(ByteStream* stream) {
 bool BaseHeap::Restore(ByteStream* stream) {
   XELOGD("Heap {:08X}-{:08X}", heap_base_, heap_base_ + (heap_size_ - 1));
 
-  for (size_t i = 0; i < page_table_.size(); i++) {
-    auto& page = page_table_[i];
-    page.qword = stream->Read<uint64_t>();
-    if (!page.state) {
-      // Unallocated.
+  uint32_t page_count = uint32_t(page_table_.size());
+  if (stream->Read<uint32_t>() != page_count) {
+    XELOGE("Page count mismatch in the snapshot of heap {:08X}", heap_base_);
+    return false;
+  }
+  stream->Read(page_table_.data(), sizeof(PageEntry) * page_count);
+  RebuildPageUsage();
+  snapshot_page_hashes_.resize(page_count, 0);
+
+  // Commit the memory if it isn't already, and make it writable, in ranges of
+  // consecutive committed pages. We do not need to reserve any memory, as the
+  // mapping has already taken care of that.
+  for (uint32_t i = 0; i < page_count;) {
+    if (!(page_table_[i].state & kMemoryAllocationCommit)) {
+      snapshot_page_hashes_[i] = 0;
+      ++i;
       continue;
     }
-
-    memory::PageAccess page_access = memory::PageAccess::kNoAccess;
-    if ((page.current_protect & kMemoryProtectRead) &&
-        (page.current_protect & kMemoryProtectWrite)) {
-      page_access = memory::PageAccess::kReadWrite;
-    } else if (page.current_protect & kMemoryProtectRead) {
-      page_access = memory::PageAccess::kReadOnly;
+    uint32_t range_end = i + 1;
+    while (range_end < page_count &&
+           (page_table_[range_end].state & kMemoryAllocationCommit)) {
+      ++range_end;
     }
-
-    // Commit the memory if it isn't already. We do not need to reserve any
-    // memory, as the mapping has already taken care of that.
-    if (page.state & kMemoryAllocationCommit) {
-      xe::memory::AllocFixed(TranslateRelative(i * page_size_), page_size_,
-                             memory::AllocationType::kCommit,
-                             memory::PageAccess::kReadWrite);
+    void* addr = TranslateRelative(size_t(i) << page_size_shift_);
+    size_t range_size = size_t(range_end - i) << page_size_shift_;
+    xe::memory::AllocFixed(addr, range_size, memory::AllocationType::kCommit,
+                           memory::PageAccess::kReadWrite);
+    xe::memory::Protect(addr, range_size, memory::PageAccess::kReadWrite,
+                        nullptr);
+    i = range_end;
+  }
+
+  // Decompress the runs in parallel. In an incremental snapshot, the pages not
+  // included keep the contents restored from the previous snapshots.
+  struct Run {
+    uint32_t first_page;
+    uint32_t page_count;
+    const uint8_t* page_hashes;
+    const uint8_t* compressed;
+    uint32_t compressed_size;
+  };
+  uint32_t run_count = stream->Read<uint32_t>();
+  std::vector<Run> runs;
+  runs.reserve(run_count);
+  bool runs_valid = true;
+  for (uint32_t i = 0; i < run_count; ++i) {
+    Run& run = runs.emplace_back();
+    run.first_page = stream->Read<uint32_t>();
+    run.page_count = stream->Read<uint32_t>();
+    run.compressed_size = stream->Read<uint32_t>();
+    if (run.first_page > page_count ||
+        run.page_count > page_count - run.first_page ||
+        sizeof(uint64_t) * run.page_count + run.compressed_size >
+            stream->data_length() - stream->offset()) {
+      runs_valid = false;
+      break;
     }
+    run.page_hashes = stream->data() + stream->offset();
+    stream->Advance(sizeof(uint64_t) * run.page_count);
+    run.compressed = stream->data() + stream->offset();
+    stream->Advance(run.compressed_size);
+  }
+  std::atomic<bool> decompression_failed{false};
+  if (runs_valid) {
+    RunSnapshotTasks(uint32_t(runs.size()), [&](uint32_t run_index) {
+      const Run& run = runs[run_index];
+      size_t run_size = size_t(run.page_count) << page_size_shift_;
+      for (uint32_t i = 0; i < run.page_count; ++i) {
+        if (!(page_table_[run.first_page + i].state &
+              kMemoryAllocationCommit)) {
+          decompression_failed = true;
+          return;
+        }
+      }
+      uint8_t* run_address =
+          TranslateRelative(size_t(run.first_page) << page_size_shift_);
+      // When going back to a snapshot, most of the memory is usually still
+      // the same, and hashing it is much faster than decompressing it.
+      bool run_unchanged = true;
+      for (uint32_t i = 0; i < run.page_count; ++i) {
+        uint64_t page_hash =
+            xe::load<uint64_t>(run.page_hashes + sizeof(uint64_t) * i);
+        snapshot_page_hashes_[run.first_page + i] = page_hash;
+        if (run_unchanged &&
+            XXH3_64bits(run_address + (size_t(i) << page_size_shift_),
+                        page_size_) != page_hash) {
+          run_unchanged = false;
+        }
+      }
+      if (run_unchanged) {
+        return;
+      }
+      if (ZSTD_decompress(run_address, run_size, run.compressed,
+                          run.compressed_size) != run_size) {
+        decompression_failed = true;
+        return;
+      }
+    });
+  }
 
-    // Now read into memory. We'll set R/W protection first, then set the
-    // protection back to its previous state.
-    // TODO(DrChat): read compressed with snappy.
-    if (page.state & kMemoryAllocationCommit) {
-      void* addr = TranslateRelative(i * page_size_);
-      xe::memory::Protect(addr, page_size_, memory::PageAccess::kReadWrite,
-                          nullptr);
-
-      stream->Read(addr, page_size_);
-
-      xe::memory::Protect(addr, page_size_, page_access, nullptr);
+  // Set the protection back to its saved state.
+  for (uint32_t i = 0; i < page_count;) {
+    if (!(page_table_[i].state & kMemoryAllocationCommit)) {
+      ++i;
+      continue;
+    }
+    memory::PageAccess page_access =
+        ToPageAccess(page_table_[i].current_protect);
+    uint32_t range_end = i + 1;
+    while (range_end < page_count &&
+           (page_table_[range_end].state & kMemoryAllocationCommit) &&
+           ToPageAccess(page_table_[range_end].current_protect) ==
+               page_access) {
+      ++range_end;
     }
+    xe::memory::Protect(TranslateRelative(size_t(i) << page_size_shift_),
+                        size_t(range_end - i) << page_size_shift_, page_access,
+                        nullptr);
+    i = range_end;
   }
 
+  if (!runs_valid || decompression_failed) {
+    XELOGE("Invalid memory snapshot of heap {:08X}", heap_base_);
+    std::fill(snapshot_page_hashes_.begin(), snapshot_page_hashes_.end(), 0);
+    return false;
+  }
   return true;
 }
 
 void BaseHeap::Reset() {
   // TODO(DrChat): protect pages.
   std::memset(page_table_.data(), 0, sizeof(PageEntry) * page_table_.size());
+  RebuildPageUsage();
   // TODO(Triang3l): Remove access callbacks from pages if this is a physical
   // memory heap.
 }
@@ -994,6 +1438,7 @@ bool BaseHeap::AllocFixed(uint32_t base_address, uint32_t size,
     }
     page_entry.state = kMemoryAllocationReserve | allocation_type;
   }
+  SetPagesUsed(start_page_number, page_count, true);
 
   return true;
 }
@@ -1032,9 +1477,10 @@ bool BaseHeap::AllocRange(uint32_t low_address, uint32_t high_address,
   auto global_lock = global_critical_region_.Acquire();
 
   // Find a free page range.
-  // The base page must match the requested alignment, so we first scan for
-  // a free aligned page and only then check for continuous free pages.
-  // TODO(benvanik): optimized searching (free list buckets, bitmap, etc).
+  // The base page must match the requested alignment, so we first look for
+  // a free aligned page and only then check for continuous free pages. The
+  // pages are looked up in the usage bitmap, 64 at a time, and the candidates
+  // are the same as in a scan of the pages one by one, so is the result.
   uint32_t start_page_number = UINT_MAX;
   uint32_t end_page_number = UINT_MAX;
   // chrispy:todo, page_scan_stride is probably always a power of two...
@@ -1042,75 +1488,65 @@ bool BaseHeap::AllocRange(uint32_t low_address, uint32_t high_address,
   high_page_number =
       high_page_number - QuickMod(high_page_number, page_scan_stride);
   if (top_down) {
-    for (int64_t base_page_number =
-             high_page_number - xe::round_up(page_count, page_scan_stride);
-         base_page_number >= low_page_number;
-         base_page_number -= page_scan_stride) {
-      if (page_table_[base_page_number].state != 0) {
-        // Base page not free, skip to next usable page.
-        continue;
+    int64_t base_page_number =
+        int64_t(high_page_number) - xe::round_up(page_count, page_scan_stride);
+    while (base_page_number >= int64_t(low_page_number)) {
+      // None of the aligned pages between the last free page and the current
+      // one can be the base.
+      uint32_t free_page_number =
+          FindLastFreePage(low_page_number, uint32_t(base_page_number));
+      if (free_page_number == UINT32_MAX) {
+        break;
       }
-      // Check requested range to ensure free.
-      start_page_number = uint32_t(base_page_number);
-      end_page_number = uint32_t(base_page_number) + page_count - 1;
-      assert_true(end_page_number < page_table_.size());
-      bool any_taken = false;
-      for (uint32_t page_number = uint32_t(base_page_number);
-           !any_taken && page_number <= end_page_number; ++page_number) {
-        bool is_free = page_table_[page_number].state == 0;
-        if (!is_free) {
-          // At least one page in the range is used, skip to next.
-          // We know we'll be starting at least before this page.
-          any_taken = true;
-          if (page_count > page_number) {
-            // Not enough space left to fit entire page range. Breaks outer
-            // loop.
-            base_page_number = -1;
-          } else {
-            base_page_number = page_number - page_count;
-            base_page_number -= QuickMod(base_page_number, page_scan_stride);
-            base_page_number += page_scan_stride;  // cancel out loop logic
-          }
-          break;
-        }
+      base_page_number =
+          free_page_number - QuickMod(free_page_number, page_scan_stride);
+      if (base_page_number < int64_t(low_page_number)) {
+        break;
       }
-      if (!any_taken) {
+      // Check requested range to ensure free.
+      uint32_t range_end_page_number = uint32_t(base_page_number) + page_count;
+      assert_true(range_end_page_number <= page_table_.size());
+      uint32_t used_page_number =
+          FindUsedPage(uint32_t(base_page_number), range_end_page_number);
+      if (used_page_number == range_end_page_number) {
         // Found our place.
+        start_page_number = uint32_t(base_page_number);
+        end_page_number = range_end_page_number - 1;
+        break;
+      }
+      // We know we'll be starting at least before the used page.
+      if (page_count > used_page_number) {
+        // Not enough space left to fit entire page range.
         break;
       }
-      // Retry.
-      start_page_number = end_page_number = UINT_MAX;
+      base_page_number = used_page_number - page_count;
+      base_page_number -= QuickMod(base_page_number, page_scan_stride);
     }
-  } else {
-    for (uint32_t base_page_number = low_page_number;
-         base_page_number <= high_page_number - page_count;
-         base_page_number += page_scan_stride) {
-      if (page_table_[base_page_number].state != 0) {
-        // Base page not free, skip to next usable page.
-        continue;
+  } else if (high_page_number >= page_count) {
+    uint32_t last_base_page_number = high_page_number - page_count;
+    uint32_t base_page_number = low_page_number;
+    while (base_page_number <= last_base_page_number) {
+      // None of the aligned pages before the first free page can be the base.
+      base_page_number =
+          FindFreePage(base_page_number, last_base_page_number + 1);
+      base_page_number =
+          xe::round_up(base_page_number, page_scan_stride, false);
+      if (base_page_number > last_base_page_number) {
+        break;
       }
       // Check requested range to ensure free.
-      start_page_number = base_page_number;
-      end_page_number = base_page_number + page_count - 1;
-      bool any_taken = false;
-      for (uint32_t page_number = base_page_number;
-           !any_taken && page_number <= end_page_number; ++page_number) {
-        bool is_free = page_table_[page_number].state == 0;
-        if (!is_free) {
-          // At least one page in the range is used, skip to next.
-          // We know we'll be starting at least after this page.
-          any_taken = true;
-          base_page_number = xe::round_up(page_number + 1, page_scan_stride);
-          base_page_number -= page_scan_stride;  // cancel out loop logic
-          break;
-        }
-      }
-      if (!any_taken) {
+      uint32_t range_end_page_number = base_page_number + page_count;
+      uint32_t used_page_number =
+          FindUsedPage(base_page_number, range_end_page_number);
+      if (used_page_number == range_end_page_number) {
         // Found our place.
+        start_page_number = base_page_number;
+        end_page_number = range_end_page_number - 1;
         break;
       }
-      // Retry.
-      start_page_number = end_page_number = UINT_MAX;
+      // We know we'll be starting at least after the used page.
+      base_page_number =
+          xe::round_up(used_page_number + 1, page_scan_stride, false);
     }
   }
   if (start_page_number == UINT_MAX || end_page_number == UINT_MAX) {
@@ -1151,6 +1587,7 @@ bool BaseHeap::AllocRange(uint32_t low_address, uint32_t high_address,
     page_entry.state = kMemoryAllocationReserve | allocation_type;
     unreserved_page_count_--;
   }
+  SetPagesUsed(start_page_number, page_count, true);
 
   *out_address = heap_base_ + (start_page_number << page_size_shift_);
   return true;
@@ -1260,6 +1697,7 @@ bool BaseHeap::Release(uint32_t base_address, uint32_t* out_region_size) {
     page_entry.qword = 0;
     unreserved_page_count_++;
   }
+  SetPagesUsed(base_page_number, base_page_entry.region_page_count, false);
 
   return true;
 }
@@ -1345,11 +1783,21 @@ bool BaseHeap::Protect(uint32_t address, uint32_t size, uint32_t protect,
   }
 
   // Perform table change.
+  bool made_writable = false;
   for (uint32_t page_number = start_page_number; page_number <= end_page_number;
        ++page_number) {
     auto& page_entry = page_table_[page_number];
+    if ((protect & kMemoryProtectWrite) &&
+        !(page_entry.current_protect & kMemoryProtectWrite)) {
+      made_writable = true;
+    }
     page_entry.current_protect = protect;
   }
+  if (made_writable) {
+    memory_->OnPagesMadeWritable(
+        heap_base_ + (start_page_number << page_size_shift_),
+        page_count << page_size_shift_);
+  }
 
   return true;
 }
@@ -1506,7 +1954,8 @@ void PhysicalHeap::Initialize(Memory* memory, uint8_t* membase,
   system_page_count_ =
       (size_t(heap_size_) + host_address_offset + (system_page_size_ - 1)) /
       system_page_size_;
-  system_page_flags_.resize((system_page_count_ + 63) / 64);
+  system_page_flags_ =
+      std::make_unique<SystemPageFlagsBlock[]>((system_page_count_ + 63) / 64);
 }
 
 bool PhysicalHeap::Alloc(uint32_t size, uint32_t alignment,
@@ -1735,6 +2184,13 @@ void PhysicalHeap::EnableAccessCallbacks(uint32_t physical_address,
       enable_data_providers ? xe::memory::PageAccess::kNoAccess
                             : xe::memory::PageAccess::kReadOnly;
 
+  // Requests for ranges already fully watched are common, and don't need the
+  // global lock.
+  if (enable_invalidation_notifications && !enable_data_providers &&
+      AllSystemPagesWatched(system_page_first, system_page_last)) {
+    return;
+  }
+
   auto global_lock = global_critical_region_.Acquire();
   if (enable_invalidation_notifications) {
     EnableAccessCallbacksInner<true>(system_page_first, system_page_last,
@@ -1752,7 +2208,7 @@ XE_NOINLINE void PhysicalHeap::EnableAccessCallbacksInner(
   uint8_t* protect_base = membase_ + heap_base_;
   uint32_t protect_system_page_first = UINT32_MAX;
 
-  SystemPageFlagsBlock* XE_RESTRICT sys_page_flags = system_page_flags_.data();
+  SystemPageFlagsBlock* XE_RESTRICT sys_page_flags = system_page_flags_.get();
   PageEntry* XE_RESTRICT page_table_ptr = page_table_.data();
 
   // chrispy: a lot of time is spent in this loop, and i think some of the work
@@ -1809,7 +2265,9 @@ XE_NOINLINE void PhysicalHeap::EnableAccessCallbacksInner(
       // TODO(Triang3l): Enable data providers.
       if constexpr (enable_invalidation_notifications) {
         if (current_page_access != xe::memory::PageAccess::kReadOnly &&
-            (page_flags_block.notify_on_invalidation & page_flags_bit) == 0) {
+            (page_flags_block.notify_on_invalidation.load(
+                 std::memory_order_relaxed) &
+             page_flags_bit) == 0) {
           // TODO(Triang3l): Check if data providers are already enabled.
           // If data providers are already enabled for the page, it has even
           // stricter protection.
@@ -1850,50 +2308,18 @@ bool PhysicalHeap::TriggerCallbacks(
     return false;
   }
 
-  if (virtual_address < heap_base_) {
-    if (heap_base_ - virtual_address >= length) {
-      return false;
-    }
-    length -= heap_base_ - virtual_address;
-    virtual_address = heap_base_;
-  }
-  uint32_t heap_relative_address = virtual_address - heap_base_;
-  if (heap_relative_address >= heap_size_) {
+  uint32_t system_page_first, system_page_last;
+  if (!GetSystemPageRange(virtual_address, length, system_page_first,
+                          system_page_last)) {
     return false;
   }
-  length = std::min(length, heap_size_ - heap_relative_address);
-  if (length == 0) {
-    return false;
-  }
-
-  uint32_t system_page_first =
-      (heap_relative_address + host_address_offset()) >> system_page_shift_;
-  uint32_t system_page_last =
-      (heap_relative_address + length - 1 + host_address_offset()) >>
-      system_page_shift_;
-  system_page_last = std::min(system_page_last, system_page_count_ - 1);
-  assert_true(system_page_first <= system_page_last);
-  uint32_t block_index_first = system_page_first >> 6;
-  uint32_t block_index_last = system_page_last >> 6;
 
   // Check if watching any page, whether need to call the callback at all.
-  bool any_watched = false;
-  for (uint32_t i = block_index_first; i <= block_index_last; ++i) {
-    uint64_t block = system_page_flags_[i].notify_on_invalidation;
-    if (i == block_index_first) {
-      block &= ~((uint64_t(1) << (system_page_first & 63)) - 1);
-    }
-    if (i == block_index_last && (system_page_last & 63) != 63) {
-      block &= (uint64_t(1) << ((system_page_last & 63) + 1)) - 1;
-    }
-    if (block) {
-      any_watched = true;
-      break;
-    }
-  }
-  if (!any_watched) {
+  if (!AnySystemPageWatched(system_page_first, system_page_last)) {
     return false;
   }
+  uint32_t block_index_first = system_page_first >> 6;
+  uint32_t block_index_last = system_page_last >> 6;
 
   // Trigger callbacks.
   if (!unprotect) {
@@ -1963,8 +2389,10 @@ bool PhysicalHeap::TriggerCallbacks(
     uint32_t unprotect_system_page_first = UINT32_MAX;
     for (uint32_t i = system_page_first; i <= system_page_last; ++i) {
       // Check if need to allow writing to this page.
-      bool unprotect_page = (system_page_flags_[i >> 6].notify_on_invalidation &
-                             (uint64_t(1) << (i & 63))) != 0;
+      bool unprotect_page =
+          (system_page_flags_[i >> 6].notify_on_invalidation.load(
+               std::memory_order_relaxed) &
+           (uint64_t(1) << (i & 63))) != 0;
       if (unprotect_page) {
         uint32_t guest_page_number =
             xe::sat_sub(i << system_page_shift_, host_address_offset()) >>
@@ -2013,6 +2441,82 @@ bool PhysicalHeap::TriggerCallbacks(
   return true;
 }
 
+bool PhysicalHeap::IsWatched(uint32_t virtual_address, uint32_t length) const {
+  uint32_t system_page_first, system_page_last;
+  return GetSystemPageRange(virtual_address, length, system_page_first,
+                            system_page_last) &&
+         AnySystemPageWatched(system_page_first, system_page_last);
+}
+
+bool PhysicalHeap::GetSystemPageRange(uint32_t virtual_address,
+                                      uint32_t length,
+                                      uint32_t& system_page_first,
+                                      uint32_t& system_page_last) const {
+  if (virtual_address < heap_base_) {
+    if (heap_base_ - virtual_address >= length) {
+      return false;
+    }
+    length -= heap_base_ - virtual_address;
+    virtual_address = heap_base_;
+  }
+  uint32_t heap_relative_address = virtual_address - heap_base_;
+  if (heap_relative_address >= heap_size_) {
+    return false;
+  }
+  length = std::min(length, heap_size_ - heap_relative_address);
+  if (length == 0) {
+    return false;
+  }
+  system_page_first =
+      (heap_relative_address + host_address_offset()) >> system_page_shift_;
+  system_page_last =
+      (heap_relative_address + length - 1 + host_address_offset()) >>
+      system_page_shift_;
+  system_page_last = std::min(system_page_last, system_page_count_ - 1);
+  assert_true(system_page_first <= system_page_last);
+  return true;
+}
+
+bool PhysicalHeap::AnySystemPageWatched(uint32_t system_page_first,
+                                        uint32_t system_page_last) const {
+  uint32_t block_index_first = system_page_first >> 6;
+  uint32_t block_index_last = system_page_last >> 6;
+  for (uint32_t i = block_index_first; i <= block_index_last; ++i) {
+    uint64_t block = system_page_flags_[i].notify_on_invalidation.load(
+        std::memory_order_acquire);
+    if (i == block_index_first) {
+      block &= ~((uint64_t(1) << (system_page_first & 63)) - 1);
+    }
+    if (i == block_index_last && (system_page_last & 63) != 63) {
+      block &= (uint64_t(1) << ((system_page_last & 63) + 1)) - 1;
+    }
+    if (block) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PhysicalHeap::AllSystemPagesWatched(uint32_t system_page_first,
+                                         uint32_t system_page_last) const {
+  uint32_t block_index_first = system_page_first >> 6;
+  uint32_t block_index_last = system_page_last >> 6;
+  for (uint32_t i = block_index_first; i <= block_index_last; ++i) {
+    uint64_t block = ~system_page_flags_[i].notify_on_invalidation.load(
+        std::memory_order_acquire);
+    if (i == block_index_first) {
+      block &= ~((uint64_t(1) << (system_page_first & 63)) - 1);
+    }
+    if (i == block_index_last && (system_page_last & 63) != 63) {
+      block &= (uint64_t(1) << ((system_page_last & 63) + 1)) - 1;
+    }
+    if (block) {
+      return false;
+    }
+  }
+  return true;
+}
+
 uint32_t PhysicalHeap::GetPhysicalAddress(uint32_t address) const {
   assert_true(address >= heap_base_);
   address -= heap_base_;
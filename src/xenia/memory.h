@@ -10,6 +10,7 @@
 #ifndef XENIA_MEMORY_H_
 #define XENIA_MEMORY_H_
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -198,7 +199,10 @@ class BaseHeap {
   xe::memory::PageAccess QueryRangeAccess(uint32_t low_address,
                                           uint32_t high_address);
 
-  bool Save(ByteStream* stream);
+  // Writes the page table and the compressed contents of the committed pages.
+  // If incremental, only the pages changed since the previous Save or Restore
+  // are written, so the snapshot must be restored on top of that one.
+  bool Save(ByteStream* stream, bool incremental = false);
   bool Restore(ByteStream* stream);
 
   void Reset();
@@ -210,6 +214,17 @@ class BaseHeap {
                   uint32_t heap_base, uint32_t heap_size, uint32_t page_size,
                   uint32_t host_address_offset = 0);
 
+  // Keep page_usage_ in sync with the states in the page table.
+  void SetPagesUsed(uint32_t first_page, uint32_t page_count, bool used);
+  void RebuildPageUsage();
+  // The first page in [first_page, end_page) that is reserved or free, or
+  // end_page if there's none.
+  uint32_t FindUsedPage(uint32_t first_page, uint32_t end_page) const;
+  uint32_t FindFreePage(uint32_t first_page, uint32_t end_page) const;
+  // The last free page in [first_page, last_page], or UINT32_MAX if there's
+  // none.
+  uint32_t FindLastFreePage(uint32_t first_page, uint32_t last_page) const;
+
   Memory* memory_;
   uint8_t* membase_;
   HeapType heap_type_;
@@ -221,6 +236,12 @@ class BaseHeap {
   uint32_t unreserved_page_count_;
   xe::global_critical_region global_critical_region_;
   std::vector<PageEntry> page_table_;
+  // A bit per page, set if the page is reserved, so free page ranges are found
+  // 64 pages at a time. The bits past the end of the page table are set.
+  std::vector<uint64_t> page_usage_;
+  // Hashes of the page contents in the last saved or restored snapshot, or 0
+  // for pages that were not committed.
+  std::vector<uint64_t> snapshot_page_hashes_;
 };
 
 // Normal heap allowing allocations from guest virtual address ranges.
@@ -276,6 +297,12 @@ class PhysicalHeap : public BaseHeap {
       const uint32_t system_page_first, const uint32_t system_page_last,
       xe::memory::PageAccess protect_access) XE_RESTRICT;
 
+  // Checks, without locking, whether any page in the virtual address range has
+  // write watches, so TriggerCallbacks doesn't need to be called with the
+  // global lock acquired otherwise. Watches enabled concurrently will still be
+  // triggered by the access violation.
+  bool IsWatched(uint32_t virtual_address, uint32_t length) const;
+
   // Returns true if any page in the range was watched.
   bool TriggerCallbacks(global_unique_lock_type global_lock_locked_once,
                         uint32_t virtual_address, uint32_t length,
@@ -304,14 +331,27 @@ class PhysicalHeap : public BaseHeap {
   uint32_t system_page_shift_;
   uint32_t padding1_;
 
+  // Converts a virtual address range to the system pages it covers, clamped to
+  // the heap. Returns false if the range is outside the heap.
+  bool GetSystemPageRange(uint32_t virtual_address, uint32_t length,
+                          uint32_t& system_page_first,
+                          uint32_t& system_page_last) const;
+  // Whether any or all of the system pages have invalidation notifications.
+  bool AnySystemPageWatched(uint32_t system_page_first,
+                            uint32_t system_page_last) const;
+  bool AllSystemPagesWatched(uint32_t system_page_first,
+                             uint32_t system_page_last) const;
+
   struct SystemPageFlagsBlock {
     // Whether writing to each page should result trigger invalidation
     // callbacks.
-    uint64_t notify_on_invalidation;
+    std::atomic<uint64_t> notify_on_invalidation;
   };
-  // Protected by global_critical_region. Flags for each 64 system pages,
-  // interleaved as blocks, so bit scan can be used to quickly extract ranges.
-  std::vector<SystemPageFlagsBlock> system_page_flags_;
+  // Modified with global_critical_region held, but may be read without it to
+  // skip locking when no page needs to be watched or unwatched. Flags for each
+  // 64 system pages, interleaved as blocks, so bit scan can be used to quickly
+  // extract ranges.
+  std::unique_ptr<SystemPageFlagsBlock[]> system_page_flags_;
 };
 
 // Models the entire guest memory system on the console.
@@ -353,21 +393,8 @@ class Memory {
   // Note that the contents at the specified host address are big-endian.
   template <typename T = uint8_t*>
   inline T TranslateVirtual(uint32_t guest_address) const {
-#if XE_PLATFORM_WIN32 == 1
-    uint8_t* host_address = virtual_membase_ + guest_address;
-    if (guest_address >= 0xE0000000) {
-      host_address += 0x1000;
-    }
-    return reinterpret_cast<T>(host_address);
-#else
-    uint8_t* host_address = virtual_membase_ + guest_address;
-    const auto heap = LookupHeap(guest_address);
-    if (heap) {
-      host_address += heap->host_address_offset();
-    }
-    return reinterpret_cast<T>(host_address);
-
-#endif
+    return reinterpret_cast<T>(virtual_membase_ + guest_address +
+                               host_address_offsets_[guest_address >> 28]);
   }
   template <typename T>
   inline T* TranslateVirtual(TypedGuestPointer<T> guest_address) {
@@ -402,6 +429,11 @@ class Memory {
   // UINT32_MAX if it can't be obtained.
   uint32_t GetPhysicalAddress(uint32_t address) const;
 
+  // Triggers the physical memory watches of a guest range that's about to be
+  // written by the host at once, rather than taking an access violation for
+  // every watched page during the write.
+  void PrepareHostWrite(uint32_t address, uint32_t size);
+
   // Zeros out a range of memory at the given guest address.
   void Zero(uint32_t address, uint32_t size);
 
@@ -412,7 +444,8 @@ class Memory {
   void Copy(uint32_t dest, uint32_t src, uint32_t size);
 
   // Searches the given range of guest memory for a run of dword values in
-  // big-endian order.
+  // big-endian order, returning the address of the first one fully within the
+  // range or 0 if there's none.
   uint32_t SearchAligned(uint32_t start, uint32_t end, const uint32_t* values,
                          size_t value_count);
 
@@ -503,6 +536,21 @@ class Memory {
       uint32_t length, bool is_write, bool unwatch_exact_range,
       bool unprotect = true);
 
+  // Write-protects the host pages of a range of guest virtual memory outside
+  // the physical memory heaps, such as translated guest code, if the guest
+  // can write to them. The first write to each such page calls the code write
+  // callback for it (with the global critical region locked) and makes the
+  // page writable again until it's watched again. The physical memory heaps
+  // have the access callbacks for this.
+  typedef void (*CodeWriteCallback)(void* context_ptr, uint32_t virtual_address,
+                                    uint32_t length);
+  void SetCodeWriteCallback(CodeWriteCallback callback, void* callback_context);
+  void WatchCodeWrites(uint32_t virtual_address, uint32_t length);
+  // Calls the code write callback for the pages in a range of guest virtual
+  // memory that is read-only for the guest, such as the data that has been
+  // folded into the translated code, if the guest makes them writable.
+  void WatchReadOnlyPages(uint32_t virtual_address, uint32_t length);
+
   // Allocates virtual memory from the 'system' heap.
   // System memory is kept separate from game memory but is still accessible
   // using normal guest virtual addresses. Kernel structures and other internal
@@ -536,7 +584,13 @@ class Memory {
   // Dumps a map of all allocated memory to the log.
   void DumpMap();
 
-  bool Save(ByteStream* stream);
+  // Places the guest memory on the host NUMA node, including the pages already
+  // allocated. Returns false if not supported.
+  bool BindToNumaNode(uint32_t node);
+
+  // Saves a snapshot of the memory, containing only the pages changed since
+  // the previous snapshot if incremental.
+  bool Save(ByteStream* stream, bool incremental = false);
   bool Restore(ByteStream* stream);
 
   void SetMMIOExceptionRecordingCallback(cpu::MmioAccessRecordCallback callback,
@@ -554,11 +608,21 @@ class Memory {
   static bool AccessViolationCallbackThunk(
       global_unique_lock_type global_lock_locked_once, void* context,
       void* host_address, bool is_write);
+  // Unwatches the page, calling the code write callback, if it's watched.
+  bool TriggerCodeWriteWatch(uint32_t virtual_address);
+  // Called by the heaps with the global critical region locked when the guest
+  // is given write access to the pages.
+  void OnPagesMadeWritable(uint32_t virtual_address, uint32_t length);
 
   std::filesystem::path file_name_;
   uint32_t system_page_size_ = 0;
   uint32_t system_allocation_granularity_ = 0;
   uint8_t* virtual_membase_ = nullptr;
+  // host_address_offset() of the heaps for each 256 MB of the guest virtual
+  // address space, for translating addresses without looking the heap up. The
+  // physical mirror at 0xE0000000 is the only heap with a non-zero offset,
+  // and it spans the whole last two entries.
+  uint32_t host_address_offsets_[16] = {};
   uint8_t* physical_membase_ = nullptr;
 
   xe::memory::FileMappingHandle mapping_ =
@@ -599,6 +663,14 @@ class Memory {
   xe::global_critical_region global_critical_region_;
   std::vector<std::pair<PhysicalMemoryInvalidationCallback, void*>*>
       physical_memory_invalidation_callbacks_;
+
+  CodeWriteCallback code_write_callback_ = nullptr;
+  void* code_write_callback_context_ = nullptr;
+  // Bits of the write-protected host pages in the guest virtual address
+  // space, allocated on the first watch.
+  std::vector<uint64_t> code_write_watches_;
+  // Bits of the host pages watched by WatchReadOnlyPages.
+  std::vector<uint64_t> read_only_watches_;
 };
 
 }  // namespace xe
@@ -18,6 +18,10 @@
 
 DEFINE_bool(apply_patches, true, "Enables custom patching functionality",
             "General");
+DEFINE_bool(lazy_patch_loading, true,
+            "Only parse the patch files of the titles being run, indexing the "
+            "others by the title ID their file names start with.",
+            "General");
 
 namespace xe {
 namespace patcher {
@@ -48,13 +52,53 @@ void PatchDB::LoadPatches() {
       continue;
     }
 
+    if (cvars::lazy_patch_loading) {
+      const uint32_t title_id = static_cast<uint32_t>(strtoul(
+          path_to_utf8(patch_file.name).substr(0, 8).c_str(), NULL, 16));
+      indexed_patch_files_[title_id].push_back(patch_file.path /
+                                               patch_file.name);
+      continue;
+    }
+
     const PatchFileEntry loaded_title_patches =
         ReadPatchFile(patch_file.path / patch_file.name);
     if (loaded_title_patches.title_id != -1) {
       loaded_patches_.push_back(loaded_title_patches);
     }
   }
-  XELOGI("PatchDB: Loaded patches for {} titles", loaded_patches_.size());
+  if (cvars::lazy_patch_loading) {
+    XELOGI("PatchDB: Indexed patches for {} titles",
+           indexed_patch_files_.size());
+  } else {
+    XELOGI("PatchDB: Loaded patches for {} titles", loaded_patches_.size());
+  }
+}
+
+void PatchDB::LoadIndexedPatches(const uint32_t title_id) {
+  auto it = indexed_patch_files_.find(title_id);
+  if (it == indexed_patch_files_.end()) {
+    return;
+  }
+  for (const std::filesystem::path& file_path : it->second) {
+    const PatchFileEntry loaded_title_patches = ReadPatchFile(file_path);
+    if (loaded_title_patches.title_id == -1) {
+      continue;
+    }
+    if (loaded_title_patches.title_id != title_id) {
+      XELOGW("PatchDB: Patch file {} is for title {:08X}, not the one in its "
+             "name",
+             file_path.filename(), loaded_title_patches.title_id);
+    }
+    loaded_patches_.push_back(loaded_title_patches);
+  }
+  indexed_patch_files_.erase(it);
+}
+
+std::vector<PatchFileEntry>& PatchDB::GetAllPatches() {
+  while (!indexed_patch_files_.empty()) {
+    LoadIndexedPatches(indexed_patch_files_.cbegin()->first);
+  }
+  return loaded_patches_;
 }
 
 PatchFileEntry PatchDB::ReadPatchFile(
@@ -208,8 +252,35 @@ bool PatchDB::ReadPatchData(std::vector<PatchDataEntry>& patch_data,
   return true;
 }
 
+void PatchDB::ReadHostRoutines(
+    std::vector<PatchHostRoutineEntry>& host_routines,
+    const toml::table* patch_fields) const {
+  auto host_routine_fields = patch_fields->get_as<toml::array>("host_routine");
+  if (!host_routine_fields) {
+    return;
+  }
+
+  for (const auto& host_routine_table : *host_routine_fields) {
+    if (!host_routine_table.is_table()) {
+      continue;
+    }
+
+    auto table = host_routine_table.as_table();
+    auto address = table->get_as<int64_t>("address");
+    auto routine = table->get_as<std::string>("routine");
+    if (!address || !routine) {
+      XELOGW("PatchDB: Host routine without an address or a name! Skipping");
+      continue;
+    }
+    host_routines.push_back(
+        {static_cast<uint32_t>(address->get()), routine->get()});
+  }
+}
+
 std::vector<PatchFileEntry> PatchDB::GetTitlePatches(
     const uint32_t title_id, const std::optional<uint64_t> hash) {
+  LoadIndexedPatches(title_id);
+
   std::vector<PatchFileEntry> title_patches;
 
   std::copy_if(
@@ -287,6 +358,8 @@ void PatchDB::ReadPatchHeader(PatchInfoEntry& patch_info,
       break;
     }
   }
+
+  ReadHostRoutines(patch_info.host_routines, patch_fields);
 }
 
 }  // namespace patcher
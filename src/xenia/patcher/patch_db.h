@@ -54,12 +54,19 @@ struct PatchDataEntry {
       : address(memory_address), data(patch_data) {};
 };
 
+// Guest routine to replace with a host implementation, such as memcpy.
+struct PatchHostRoutineEntry {
+  uint32_t address;
+  std::string routine;
+};
+
 struct PatchInfoEntry {
   uint32_t id;
   std::string patch_name;
   std::string patch_desc;
   std::string patch_author;
   std::vector<PatchDataEntry> patch_data;
+  std::vector<PatchHostRoutineEntry> host_routines;
   bool is_enabled;
 };
 
@@ -100,9 +107,12 @@ class PatchDB {
 
   std::vector<PatchFileEntry> GetTitlePatches(
       const uint32_t title_id, const std::optional<uint64_t> hash);
-  std::vector<PatchFileEntry>& GetAllPatches() { return loaded_patches_; }
+  std::vector<PatchFileEntry>& GetAllPatches();
 
  private:
+  // Parses the files indexed for the title by the lazy loading.
+  void LoadIndexedPatches(const uint32_t title_id);
+
   void ReadHashes(PatchFileEntry& patch_entry,
                   const toml::node* patch_toml_fields) const;
   void ReadPatchHeader(PatchInfoEntry& patch_info,
@@ -110,6 +120,8 @@ class PatchDB {
   bool ReadPatchData(std::vector<PatchDataEntry>& patch_data,
                      const std::pair<std::string, PatchData> data_type,
                      const toml::table* patch_fields) const;
+  void ReadHostRoutines(std::vector<PatchHostRoutineEntry>& host_routines,
+                        const toml::table* patch_fields) const;
 
   inline static const std::regex patch_filename_regex_ =
       std::regex("^[A-Fa-f0-9]{8}.*\\.patch\\.toml$");
@@ -126,6 +138,8 @@ class PatchDB {
       {"be8", PatchData(sizeof(uint8_t), PatchDataType::kBE8)}};
 
   std::vector<PatchFileEntry> loaded_patches_;
+  // Files not parsed yet, by the title ID their names start with.
+  std::map<uint32_t, std::vector<std::filesystem::path>> indexed_patch_files_;
   std::filesystem::path patches_root_;
 };
 }  // namespace patcher
@@ -6,9 +6,12 @@
  * Released under the BSD license - see LICENSE in the root for more details. *
  ******************************************************************************
  */
+#include <algorithm>
 #include <cstring>
 
 #include "xenia/base/logging.h"
+#include "xenia/base/math.h"
+#include "xenia/cpu/processor.h"
 #include "xenia/patcher/patcher.h"
 
 namespace xe {
@@ -22,7 +25,11 @@ Patcher::Patcher(const std::filesystem::path patches_root) {
 void Patcher::ApplyPatchesForTitle(Memory* memory, const uint32_t title_id,
                                    const std::optional<uint64_t> hash) {
   const auto title_patches = patch_db_->GetTitlePatches(title_id, hash);
+  host_routines_.clear();
 
+  // Written together before the code is translated, so nothing compiled from
+  // the unpatched code needs to be invalidated.
+  std::vector<const PatchDataEntry*> patch_data;
   for (const PatchFileEntry& patchFile : title_patches) {
     for (const PatchInfoEntry& patchEntry : patchFile.patch_info) {
       if (!patchEntry.is_enabled) {
@@ -30,34 +37,98 @@ void Patcher::ApplyPatchesForTitle(Memory* memory, const uint32_t title_id,
       }
       XELOGE("Patcher: Applying patch for: {}({:08X}) - {}",
              patchFile.title_name, patchFile.title_id, patchEntry.patch_name);
-      ApplyPatch(memory, &patchEntry);
+      for (const PatchDataEntry& patch_data_entry : patchEntry.patch_data) {
+        patch_data.push_back(&patch_data_entry);
+      }
+      AddHostRoutines(&patchEntry);
     }
   }
+  WritePatchData(memory, std::move(patch_data));
 }
 
 void Patcher::ApplyPatch(Memory* memory, const PatchInfoEntry* patch) {
+  std::vector<const PatchDataEntry*> patch_data;
   for (const PatchDataEntry& patch_data_entry : patch->patch_data) {
-    uint32_t old_address_protect = 0;
-    uint8_t* address = memory->TranslateVirtual(patch_data_entry.address);
-    xe::BaseHeap* heap = memory->LookupHeap(patch_data_entry.address);
+    patch_data.push_back(&patch_data_entry);
+  }
+  WritePatchData(memory, std::move(patch_data));
+  AddHostRoutines(patch);
+}
+
+void Patcher::ApplyPatchToRunningTitle(Memory* memory,
+                                       cpu::Processor* processor,
+                                       const PatchInfoEntry* patch) {
+  ApplyPatch(memory, patch);
+  for (const PatchDataEntry& patch_data_entry : patch->patch_data) {
+    processor->InvalidateGuestCode(
+        patch_data_entry.address,
+        static_cast<uint32_t>(patch_data_entry.data.alloc_size));
+  }
+}
+
+void Patcher::WritePatchData(Memory* memory,
+                             std::vector<const PatchDataEntry*> patch_data) {
+  std::sort(patch_data.begin(), patch_data.end(),
+            [](const PatchDataEntry* a, const PatchDataEntry* b) {
+              return a->address < b->address;
+            });
+  // The protection is changed once for each run of pages with the same
+  // protection covered by the patches.
+  size_t run_begin = 0;
+  while (run_begin < patch_data.size()) {
+    const PatchDataEntry* first_entry = patch_data[run_begin];
+    xe::BaseHeap* heap = memory->LookupHeap(first_entry->address);
     if (!heap) {
+      ++run_begin;
       continue;
     }
+    uint32_t page_size = heap->page_size();
+    uint32_t run_address = first_entry->address & ~(page_size - 1);
+    uint32_t run_end = xe::align(
+        first_entry->address + uint32_t(first_entry->data.alloc_size),
+        page_size);
+    uint32_t old_address_protect = 0;
+    heap->QueryProtect(first_entry->address, &old_address_protect);
+    size_t run_entry_end = run_begin + 1;
+    for (; run_entry_end < patch_data.size(); ++run_entry_end) {
+      const PatchDataEntry* entry = patch_data[run_entry_end];
+      if (memory->LookupHeap(entry->address) != heap) {
+        break;
+      }
+      if ((entry->address & ~(page_size - 1)) >= run_end) {
+        uint32_t entry_protect = 0;
+        heap->QueryProtect(entry->address, &entry_protect);
+        if (entry_protect != old_address_protect) {
+          break;
+        }
+      }
+      run_end = std::max(
+          run_end,
+          xe::align(entry->address + uint32_t(entry->data.alloc_size),
+                    page_size));
+    }
 
-    heap->QueryProtect(patch_data_entry.address, &old_address_protect);
-
-    heap->Protect(patch_data_entry.address,
-                  (uint32_t)patch_data_entry.data.alloc_size,
+    heap->Protect(run_address, run_end - run_address,
                   kMemoryProtectRead | kMemoryProtectWrite);
 
-    std::memcpy(address, patch_data_entry.data.patch_data.data(),
-                patch_data_entry.data.alloc_size);
+    for (size_t i = run_begin; i < run_entry_end; ++i) {
+      const PatchDataEntry* entry = patch_data[i];
+      std::memcpy(memory->TranslateVirtual(entry->address),
+                  entry->data.patch_data.data(), entry->data.alloc_size);
+      is_any_patch_applied_ = true;
+    }
 
     // Restore previous protection
-    heap->Protect(patch_data_entry.address,
-                  (uint32_t)patch_data_entry.data.alloc_size,
-                  old_address_protect);
+    heap->Protect(run_address, run_end - run_address, old_address_protect);
+
+    run_begin = run_entry_end;
+  }
+}
 
+void Patcher::AddHostRoutines(const PatchInfoEntry* patch) {
+  if (!patch->host_routines.empty()) {
+    host_routines_.insert(host_routines_.cend(), patch->host_routines.cbegin(),
+                          patch->host_routines.cend());
     is_any_patch_applied_ = true;
   }
 }
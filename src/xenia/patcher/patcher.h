@@ -14,6 +14,9 @@
 #include "xenia/patcher/patch_db.h"
 
 namespace xe {
+namespace cpu {
+class Processor;
+}  // namespace cpu
 namespace patcher {
 
 class Patcher {
@@ -23,12 +26,29 @@ class Patcher {
   void ApplyPatch(Memory* memory, const PatchInfoEntry* patch);
   void ApplyPatchesForTitle(Memory* memory, const uint32_t title_id,
                             const std::optional<uint64_t> hash);
+  // Applies the patch while the title is running, retranslating only the
+  // functions with the patched code if they have already been translated.
+  void ApplyPatchToRunningTitle(Memory* memory, cpu::Processor* processor,
+                                const PatchInfoEntry* patch);
 
   bool IsAnyPatchApplied() { return is_any_patch_applied_; }
 
+  // Host routines of the patches applied by the last ApplyPatchesForTitle, to
+  // be set up by the CPU once the patches are in memory.
+  const std::vector<PatchHostRoutineEntry>& host_routines() const {
+    return host_routines_;
+  }
+
  private:
+  // Writes the data of the patches, changing the protection of the memory
+  // once for all the patches in the same pages.
+  void WritePatchData(Memory* memory,
+                      std::vector<const PatchDataEntry*> patch_data);
+  void AddHostRoutines(const PatchInfoEntry* patch);
+
   PatchDB* patch_db_;
   bool is_any_patch_applied_;
+  std::vector<PatchHostRoutineEntry> host_routines_;
 };
 
 }  // namespace patcher
@@ -7,7 +7,8 @@ project("xenia-patcher")
   kind("StaticLib")
   language("C++")
   links({
-    "xenia-base"
+    "xenia-base",
+    "xenia-cpu",
   })
   defines({
   })
@@ -27,4 +27,12 @@
 
 #define XELOGD3D XELOGI
 
+// Enhanced barriers (ID3D12GraphicsCommandList7::Barrier) are declared starting
+// from the Windows SDK 10.0.22621.0.
+#ifdef __ID3D12GraphicsCommandList7_INTERFACE_DEFINED__
+#define XE_UI_D3D12_ENHANCED_BARRIERS 1
+#else
+#define XE_UI_D3D12_ENHANCED_BARRIERS 0
+#endif  // __ID3D12GraphicsCommandList7_INTERFACE_DEFINED__
+
 #endif  // XENIA_UI_D3D12_D3D12_API_H_
@@ -229,18 +229,22 @@ D3D12Presenter::ConnectOrReconnectPaintingToSurfaceFromUIThread(
     paint_context_.AwaitSwapChainUsageCompletion();
     // Using the current swap_chain_allows_tearing_ value that's consistent with
     // the creation of the swap chain because ResizeBuffers can't toggle the
-    // tearing flag.
+    // tearing flag, and the same for the frame latency waitable object flag.
     for (Microsoft::WRL::ComPtr<ID3D12Resource>& swap_chain_buffer_ref :
          paint_context_.swap_chain_buffers) {
       swap_chain_buffer_ref.Reset();
     }
+    UINT swap_chain_flags = 0;
+    if (paint_context_.swap_chain_allows_tearing) {
+      swap_chain_flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+    }
+    if (paint_context_.swap_chain_frame_latency_waitable_object) {
+      swap_chain_flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    }
     bool swap_chain_resized =
         SUCCEEDED(paint_context_.swap_chain->ResizeBuffers(
             0, UINT(new_swap_chain_width), UINT(new_swap_chain_height),
-            DXGI_FORMAT_UNKNOWN,
-            paint_context_.swap_chain_allows_tearing
-                ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING
-                : 0));
+            DXGI_FORMAT_UNKNOWN, swap_chain_flags));
     if (swap_chain_resized) {
       for (uint32_t i = 0; i < PaintContext::kSwapChainBufferCount; ++i) {
         if (FAILED(paint_context_.swap_chain->GetBuffer(
@@ -291,6 +295,12 @@ D3D12Presenter::ConnectOrReconnectPaintingToSurfaceFromUIThread(
       // rate.
       swap_chain_desc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
     }
+    if (cvars::present_low_latency) {
+      // Wait for the swap chain before painting instead of blocking in Present
+      // with up to the default three frames queued.
+      swap_chain_desc.Flags |=
+          DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    }
     IDXGIFactory2* dxgi_factory = provider_.GetDXGIFactory();
     ID3D12CommandQueue* direct_queue = provider_.GetDirectQueue();
     Microsoft::WRL::ComPtr<IDXGISwapChain1> swap_chain_1;
@@ -333,6 +343,20 @@ D3D12Presenter::ConnectOrReconnectPaintingToSurfaceFromUIThread(
     paint_context_.swap_chain_height = new_swap_chain_height;
     paint_context_.swap_chain_allows_tearing =
         (swap_chain_desc.Flags & DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING) != 0;
+    if (swap_chain_desc.Flags &
+        DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT) {
+      if (SUCCEEDED(paint_context_.swap_chain->SetMaximumFrameLatency(1))) {
+        paint_context_.swap_chain_frame_latency_waitable_object =
+            paint_context_.swap_chain->GetFrameLatencyWaitableObject();
+      }
+      if (!paint_context_.swap_chain_frame_latency_waitable_object) {
+        XELOGE(
+            "D3D12Presenter: Failed to set up the frame latency waitable "
+            "object of a swap chain");
+        paint_context_.DestroySwapChain();
+        return SurfacePaintConnectResult::kFailure;
+      }
+    }
     for (uint32_t i = 0; i < PaintContext::kSwapChainBufferCount; ++i) {
       if (FAILED(paint_context_.swap_chain->GetBuffer(
               i, IID_PPV_ARGS(&paint_context_.swap_chain_buffers[i])))) {
@@ -443,6 +467,10 @@ void D3D12Presenter::PaintContext::DestroySwapChain() {
     swap_chain_buffer_ref.Reset();
   }
   swap_chain.Reset();
+  if (swap_chain_frame_latency_waitable_object) {
+    CloseHandle(swap_chain_frame_latency_waitable_object);
+    swap_chain_frame_latency_waitable_object = nullptr;
+  }
   swap_chain_allows_tearing = false;
   swap_chain_height = 0;
   swap_chain_width = 0;
@@ -450,6 +478,13 @@ void D3D12Presenter::PaintContext::DestroySwapChain() {
 
 Presenter::PaintResult D3D12Presenter::PaintAndPresentImpl(
     bool execute_ui_drawers) {
+  if (paint_context_.swap_chain_frame_latency_waitable_object) {
+    // Don't create more latency by painting an image that will have to wait
+    // for a queued one to be displayed. With a timeout in case something has
+    // gone wrong with the swap chain so painting isn't blocked forever.
+    WaitForSingleObjectEx(
+        paint_context_.swap_chain_frame_latency_waitable_object, 1000, TRUE);
+  }
   // Begin the command list with the command allocator not currently potentially
   // used on the GPU.
   UINT64 current_paint_submission =
@@ -469,6 +504,39 @@ Presenter::PaintResult D3D12Presenter::PaintAndPresentImpl(
   ID3D12GraphicsCommandList* command_list = paint_context_.command_list.Get();
   command_list->Reset(command_allocator, nullptr);
 
+  // The timestamps of the previous submission with this command allocator are
+  // available now that it has been completed.
+  UINT timestamp_first =
+      UINT(current_paint_submission % command_allocator_count) *
+      PaintContext::kTimestampsPerSubmission;
+  PaintContext::TimedEffects& timed_effects =
+      paint_context_
+          .timed_effects[current_paint_submission % command_allocator_count];
+  if (timed_effects.effect_count) {
+    D3D12_RANGE timestamp_read_range;
+    timestamp_read_range.Begin = sizeof(UINT64) * timestamp_first;
+    timestamp_read_range.End =
+        sizeof(UINT64) * (timestamp_first + timed_effects.effect_count + 1);
+    void* timestamp_mapping;
+    if (SUCCEEDED(paint_context_.timestamp_readback_buffer->Map(
+            0, &timestamp_read_range, &timestamp_mapping))) {
+      const UINT64* timestamps =
+          reinterpret_cast<const UINT64*>(timestamp_mapping) + timestamp_first;
+      for (size_t i = 0; i < timed_effects.effect_count; ++i) {
+        if (timestamps[i + 1] >= timestamps[i]) {
+          AddGuestOutputPaintEffectGpuTime(
+              timed_effects.effects[i],
+              (timestamps[i + 1] - timestamps[i]) * 1000000 /
+                  paint_context_.timestamp_frequency);
+        }
+      }
+      D3D12_RANGE timestamp_written_range = {};
+      paint_context_.timestamp_readback_buffer->Unmap(
+          0, &timestamp_written_range);
+    }
+    timed_effects.effect_count = 0;
+  }
+
   ID3D12Device* device = provider_.GetDevice();
 
   // Obtain the RTV heap and the back buffer.
@@ -719,6 +787,13 @@ Presenter::PaintResult D3D12Presenter::PaintAndPresentImpl(
       // involved are consistent.
       D3D12_GPU_DESCRIPTOR_HANDLE view_heap_gpu_start =
           view_heap->GetGPUDescriptorHandleForHeapStart();
+      ID3D12QueryHeap* timestamp_query_heap =
+          cvars::present_gpu_timing ? paint_context_.timestamp_query_heap.Get()
+                                    : nullptr;
+      if (timestamp_query_heap) {
+        command_list->EndQuery(timestamp_query_heap,
+                               D3D12_QUERY_TYPE_TIMESTAMP, timestamp_first);
+      }
       for (size_t i = 0; i < guest_output_flow.effect_count; ++i) {
         bool is_final_effect = i + 1 >= guest_output_flow.effect_count;
 
@@ -887,6 +962,11 @@ Presenter::PaintResult D3D12Presenter::PaintAndPresentImpl(
         command_list->IASetPrimitiveTopology(
             D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
         command_list->DrawInstanced(4, 1, 0, 0);
+        if (timestamp_query_heap) {
+          command_list->EndQuery(timestamp_query_heap,
+                                 D3D12_QUERY_TYPE_TIMESTAMP,
+                                 timestamp_first + UINT(i + 1));
+        }
 
         if (is_final_effect) {
           // Clear the letterbox around the guest output if the guest output
@@ -980,6 +1060,18 @@ Presenter::PaintResult D3D12Presenter::PaintAndPresentImpl(
           }
         }
       }
+      if (timestamp_query_heap) {
+        command_list->ResolveQueryData(
+            timestamp_query_heap, D3D12_QUERY_TYPE_TIMESTAMP, timestamp_first,
+            UINT(guest_output_flow.effect_count + 1),
+            paint_context_.timestamp_readback_buffer.Get(),
+            sizeof(UINT64) * timestamp_first);
+        timed_effects.effect_count = guest_output_flow.effect_count;
+        std::copy(guest_output_flow.effects.cbegin(),
+                  guest_output_flow.effects.cbegin() +
+                      guest_output_flow.effect_count,
+                  timed_effects.effects.begin());
+      }
     }
   }
 
@@ -1449,6 +1541,37 @@ bool D3D12Presenter::InitializeSurfaceIndependent() {
     return false;
   }
 
+  // Guest output effect pass timestamps, optional.
+  if (SUCCEEDED(direct_queue->GetTimestampFrequency(
+          &paint_context_.timestamp_frequency)) &&
+      paint_context_.timestamp_frequency) {
+    D3D12_QUERY_HEAP_DESC timestamp_query_heap_desc;
+    timestamp_query_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    timestamp_query_heap_desc.Count =
+        PaintContext::kTimestampsPerSubmission *
+        UINT(paint_context_.command_allocators.size());
+    timestamp_query_heap_desc.NodeMask = 0;
+    D3D12_RESOURCE_DESC timestamp_readback_buffer_desc;
+    util::FillBufferResourceDesc(
+        timestamp_readback_buffer_desc,
+        sizeof(UINT64) * timestamp_query_heap_desc.Count,
+        D3D12_RESOURCE_FLAG_NONE);
+    if (FAILED(device->CreateQueryHeap(
+            &timestamp_query_heap_desc,
+            IID_PPV_ARGS(&paint_context_.timestamp_query_heap))) ||
+        FAILED(device->CreateCommittedResource(
+            &util::kHeapPropertiesReadback, D3D12_HEAP_FLAG_NONE,
+            &timestamp_readback_buffer_desc, D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&paint_context_.timestamp_readback_buffer)))) {
+      XELOGW(
+          "D3D12Presenter: Failed to create the guest output effect timestamp "
+          "query heap or readback buffer, GPU timing won't be available");
+      paint_context_.timestamp_query_heap.Reset();
+      paint_context_.timestamp_readback_buffer.Reset();
+    }
+  }
+
   if (!guest_output_resource_refresher_submission_tracker_.Initialize(
           device, direct_queue)) {
     return false;
@@ -263,11 +263,29 @@ class D3D12Presenter final : public Presenter {
         guest_output_intermediate_textures;
     UINT64 guest_output_intermediate_texture_last_usage = 0;
 
+    // Timestamps before and after each guest output effect pass for
+    // present_gpu_timing, with a range for every command allocator, read back
+    // when the command allocator is reused. Null if timestamp queries couldn't
+    // be set up.
+    static constexpr UINT kTimestampsPerSubmission =
+        UINT(kMaxGuestOutputPaintEffects + 1);
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> timestamp_query_heap;
+    Microsoft::WRL::ComPtr<ID3D12Resource> timestamp_readback_buffer;
+    UINT64 timestamp_frequency = 0;
+    struct TimedEffects {
+      size_t effect_count = 0;
+      std::array<GuestOutputPaintEffect, kMaxGuestOutputPaintEffects> effects;
+    };
+    std::array<TimedEffects, kSwapChainBufferCount> timed_effects;
+
     // Connection-specific.
 
     uint32_t swap_chain_width = 0;
     uint32_t swap_chain_height = 0;
     bool swap_chain_allows_tearing = false;
+    // Non-null if the swap chain was created with the frame latency waitable
+    // object flag for present_low_latency.
+    HANDLE swap_chain_frame_latency_waitable_object = nullptr;
     Microsoft::WRL::ComPtr<IDXGISwapChain3> swap_chain;
     std::array<Microsoft::WRL::ComPtr<ID3D12Resource>, kSwapChainBufferCount>
         swap_chain_buffers;
@@ -77,6 +77,9 @@ D3D12Provider::~D3D12Provider() {
   if (device_ != nullptr) {
     device_->Release();
   }
+  if (dxgi_adapter3_ != nullptr) {
+    dxgi_adapter3_->Release();
+  }
   if (dxgi_factory_ != nullptr) {
     dxgi_factory_->Release();
   }
@@ -315,6 +318,10 @@ bool D3D12Provider::Initialize() {
     dxgi_factory->Release();
     return false;
   }
+  // Optional, for the video memory budget (Windows 10+).
+  if (FAILED(adapter->QueryInterface(IID_PPV_ARGS(&dxgi_adapter3_)))) {
+    dxgi_adapter3_ = nullptr;
+  }
   adapter->Release();
 
   // Configure the Direct3D 12 debug info queue.
@@ -449,6 +456,14 @@ bool D3D12Provider::Initialize() {
     unaligned_block_textures_supported_ =
         bool(options8.UnalignedBlockTexturesSupported);
   }
+  enhanced_barriers_supported_ = false;
+#if XE_UI_D3D12_ENHANCED_BARRIERS
+  D3D12_FEATURE_DATA_D3D12_OPTIONS12 options12;
+  if (SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS12,
+                                            &options12, sizeof(options12)))) {
+    enhanced_barriers_supported_ = bool(options12.EnhancedBarriersSupported);
+  }
+#endif  // XE_UI_D3D12_ENHANCED_BARRIERS
   virtual_address_bits_per_resource_ = 0;
   D3D12_FEATURE_DATA_GPU_VIRTUAL_ADDRESS_SUPPORT virtual_address_support;
   if (SUCCEEDED(device->CheckFeatureSupport(
@@ -459,6 +474,7 @@ bool D3D12Provider::Initialize() {
   }
   XELOGD3D(
       "Direct3D 12 device and OS features:\n"
+      "* Enhanced barriers: {}\n"
       "* Max GPU virtual address bits per resource: {}\n"
       "* Non-zeroed heap creation: {}\n"
       "* Pixel-shader-specified stencil reference: {}\n"
@@ -467,6 +483,7 @@ bool D3D12Provider::Initialize() {
       "* Resource binding: tier {}\n"
       "* Tiled resources: tier {}\n"
       "* Unaligned block-compressed textures: {}",
+      enhanced_barriers_supported_ ? "yes" : "no",
       virtual_address_bits_per_resource_,
       (heap_flag_create_not_zeroed_ & D3D12_HEAP_FLAG_CREATE_NOT_ZEROED) ? "yes"
                                                                          : "no",
@@ -100,6 +100,21 @@ class D3D12Provider : public GraphicsProvider {
 
   // Adapter info.
   GpuVendorID GetAdapterVendorID() const { return adapter_vendor_id_; }
+  // The budget of the local (dedicated on discrete GPUs) video memory given by
+  // the OS to the process, and the current usage of it. Returns false if not
+  // available.
+  bool QueryLocalVideoMemoryBudget(uint64_t& budget_out,
+                                   uint64_t& usage_out) const {
+    DXGI_QUERY_VIDEO_MEMORY_INFO memory_info;
+    if (!dxgi_adapter3_ ||
+        FAILED(dxgi_adapter3_->QueryVideoMemoryInfo(
+            0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memory_info))) {
+      return false;
+    }
+    budget_out = memory_info.Budget;
+    usage_out = memory_info.CurrentUsage;
+    return true;
+  }
 
   // Device features.
   D3D12_HEAP_FLAGS GetHeapFlagCreateNotZeroed() const {
@@ -124,6 +139,9 @@ class D3D12Provider : public GraphicsProvider {
   bool AreUnalignedBlockTexturesSupported() const {
     return unaligned_block_textures_supported_;
   }
+  bool AreEnhancedBarriersSupported() const {
+    return enhanced_barriers_supported_;
+  }
   uint32_t GetVirtualAddressBitsPerResource() const {
     return virtual_address_bits_per_resource_;
   }
@@ -190,6 +208,7 @@ class D3D12Provider : public GraphicsProvider {
   DxcCreateInstanceProc pfn_dxcompiler_dxc_create_instance_ = nullptr;
 
   IDXGIFactory2* dxgi_factory_ = nullptr;
+  IDXGIAdapter3* dxgi_adapter3_ = nullptr;
   ID3D12Device* device_ = nullptr;
   ID3D12CommandQueue* direct_queue_ = nullptr;
   IDXGraphicsAnalysis* graphics_analysis_ = nullptr;
@@ -206,6 +225,7 @@ class D3D12Provider : public GraphicsProvider {
   bool ps_specified_stencil_reference_supported_;
   bool rasterizer_ordered_views_supported_;
   bool unaligned_block_textures_supported_;
+  bool enhanced_barriers_supported_;
 
   lightweight_nvapi::nvapi_state_t* nvapi_;
   lightweight_nvapi::cb_NvAPI_D3D12_CreateCommittedResource
@@ -21,9 +21,12 @@ namespace d3d12 {
 // it's smaller (the size of the heap backing the buffer will be aligned to
 // D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT anyway).
 D3D12UploadBufferPool::D3D12UploadBufferPool(const D3D12Provider& provider,
-                                             size_t page_size)
-    : GraphicsUploadBufferPool(xe::align(
-          page_size, size_t(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))),
+                                             size_t page_size,
+                                             const char* metrics_name)
+    : GraphicsUploadBufferPool(
+          xe::align(page_size,
+                    size_t(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)),
+          metrics_name),
       provider_(provider) {}
 
 uint8_t* D3D12UploadBufferPool::Request(
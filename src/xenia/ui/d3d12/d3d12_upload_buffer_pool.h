@@ -20,7 +20,8 @@ namespace d3d12 {
 class D3D12UploadBufferPool : public GraphicsUploadBufferPool {
  public:
   D3D12UploadBufferPool(const D3D12Provider& provider,
-                        size_t page_size = kDefaultPageSize);
+                        size_t page_size = kDefaultPageSize,
+                        const char* metrics_name = nullptr);
 
   uint8_t* Request(uint64_t submission_index, size_t size, size_t alignment,
                    ID3D12Resource** buffer_out, size_t* offset_out,
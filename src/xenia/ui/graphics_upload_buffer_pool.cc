@@ -10,6 +10,7 @@
 #include "xenia/ui/graphics_upload_buffer_pool.h"
 
 #include <algorithm>
+#include <string>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/math.h"
@@ -17,6 +18,31 @@
 namespace xe {
 namespace ui {
 
+namespace {
+std::string GetMetricName(const char* pool_name, const char* metric_name) {
+  return std::string("gpu/upload_buffer_pool/") + pool_name + "/" +
+         metric_name;
+}
+}  // namespace
+
+GraphicsUploadBufferPool::Metrics::Metrics(const char* name)
+    : pages(xe::counters::GetGauge(GetMetricName(name, "pages"))),
+      pages_high_water(
+          xe::counters::GetGauge(GetMetricName(name, "pages_high_water"))),
+      requests(xe::counters::GetCounter(GetMetricName(name, "requests"))),
+      requested_bytes(
+          xe::counters::GetCounter(GetMetricName(name, "requested_bytes"))),
+      wasted_bytes(
+          xe::counters::GetCounter(GetMetricName(name, "wasted_bytes"))) {}
+
+GraphicsUploadBufferPool::GraphicsUploadBufferPool(size_t page_size,
+                                                   const char* metrics_name)
+    : page_size_(page_size) {
+  if (metrics_name) {
+    metrics_ = std::make_unique<Metrics>(metrics_name);
+  }
+}
+
 GraphicsUploadBufferPool::~GraphicsUploadBufferPool() { ClearCache(); }
 
 void GraphicsUploadBufferPool::Reclaim(uint64_t completed_submission_index) {
@@ -61,6 +87,8 @@ void GraphicsUploadBufferPool::ClearCache() {
   // Called from the destructor - must not call virtual functions here.
   current_page_flushed_ = 0;
   current_page_used_ = 0;
+  dedicated_page_unflushed_ = nullptr;
+  dedicated_page_unflushed_size_ = 0;
   while (submitted_first_) {
     Page* next_ = submitted_first_->next_;
     delete submitted_first_;
@@ -73,11 +101,21 @@ void GraphicsUploadBufferPool::ClearCache() {
     writable_first_ = next_;
   }
   writable_last_ = nullptr;
+  if (metrics_) {
+    metrics_->pages.Add(-int64_t(page_count_));
+  }
+  page_count_ = 0;
 }
 
 GraphicsUploadBufferPool::Page::~Page() {}
 
 void GraphicsUploadBufferPool::FlushWrites() {
+  if (dedicated_page_unflushed_) {
+    FlushPageWrites(dedicated_page_unflushed_, 0,
+                    dedicated_page_unflushed_size_);
+    dedicated_page_unflushed_ = nullptr;
+    dedicated_page_unflushed_size_ = 0;
+  }
   if (current_page_flushed_ >= current_page_used_) {
     return;
   }
@@ -101,20 +139,52 @@ GraphicsUploadBufferPool::Page* GraphicsUploadBufferPool::Request(
               submission_index >= writable_first_->last_submission_index_);
   assert_true(!submitted_last_ ||
               submission_index >= submitted_last_->last_submission_index_);
+  if (metrics_) {
+    metrics_->requests.Increment();
+    metrics_->requested_bytes.Increment(size);
+  }
   size_t current_page_used_aligned = xe::align(current_page_used_, alignment);
   if (current_page_used_aligned + size > page_size_ || !writable_first_) {
     // Start a new page if can't fit all the bytes or don't have an open page.
     if (writable_first_) {
+      size_t current_page_free =
+          page_size_ - std::min(current_page_used_aligned, page_size_);
+      if (current_page_free > page_size_ - size) {
+        // Less space would be wasted by placing the request in a page of its
+        // own than by closing the current one (and page_size_ is not changed
+        // anymore after the first page has been created).
+        Page* page = writable_first_->next_;
+        if (page) {
+          writable_first_->next_ = page->next_;
+          if (writable_last_ == page) {
+            writable_last_ = writable_first_;
+          }
+        } else {
+          page = CreatePageImplementation();
+          if (!page) {
+            return nullptr;
+          }
+          OnPageCreated();
+        }
+        page->last_submission_index_ = submission_index;
+        SubmitPage(page);
+        if (dedicated_page_unflushed_) {
+          FlushPageWrites(dedicated_page_unflushed_, 0,
+                          dedicated_page_unflushed_size_);
+        }
+        dedicated_page_unflushed_ = page;
+        dedicated_page_unflushed_size_ = size;
+        offset_out = 0;
+        return page;
+      }
       // Close the page that was current.
       FlushWrites();
-      if (submitted_last_) {
-        submitted_last_->next_ = writable_first_;
-      } else {
-        submitted_first_ = writable_first_;
+      if (metrics_) {
+        metrics_->wasted_bytes.Increment(current_page_free);
       }
-      submitted_last_ = writable_first_;
+      Page* closed_page = writable_first_;
       writable_first_ = writable_first_->next_;
-      submitted_last_->next_ = nullptr;
+      SubmitPage(closed_page);
       if (!writable_first_) {
         writable_last_ = nullptr;
       }
@@ -126,6 +196,7 @@ GraphicsUploadBufferPool::Page* GraphicsUploadBufferPool::Request(
         // Failed to create.
         return nullptr;
       }
+      OnPageCreated();
       writable_first_->last_submission_index_ = submission_index;
       writable_first_->next_ = nullptr;
       writable_last_ = writable_first_;
@@ -165,5 +236,27 @@ GraphicsUploadBufferPool::Page* GraphicsUploadBufferPool::RequestPartial(
 void GraphicsUploadBufferPool::FlushPageWrites(Page* page, size_t offset,
                                                size_t size) {}
 
+void GraphicsUploadBufferPool::SubmitPage(Page* page) {
+  if (submitted_last_) {
+    submitted_last_->next_ = page;
+  } else {
+    submitted_first_ = page;
+  }
+  submitted_last_ = page;
+  page->next_ = nullptr;
+}
+
+void GraphicsUploadBufferPool::OnPageCreated() {
+  ++page_count_;
+  if (!metrics_) {
+    return;
+  }
+  metrics_->pages.Add(1);
+  int64_t pages = metrics_->pages.Read();
+  if (pages > metrics_->pages_high_water.Read()) {
+    metrics_->pages_high_water.Set(pages);
+  }
+}
+
 }  // namespace ui
 }  // namespace xe
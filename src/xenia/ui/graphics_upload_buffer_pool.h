@@ -12,7 +12,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
+#include "xenia/base/counters.h"
 #include "xenia/base/literals.h"
 
 namespace xe {
@@ -40,6 +42,21 @@ class GraphicsUploadBufferPool {
   void FlushWrites();
 
  protected:
+  // Usage metrics of a pool, reported under
+  // gpu/upload_buffer_pool/<metrics name>/ - pools of the same kind may share
+  // them.
+  struct Metrics {
+    explicit Metrics(const char* name);
+    // Pages currently allocated by all the pools with the name, and the
+    // highest number of them allocated at once.
+    xe::counters::Gauge& pages;
+    xe::counters::Gauge& pages_high_water;
+    xe::counters::Counter& requests;
+    xe::counters::Counter& requested_bytes;
+    // Free space left at the end of pages closed because a request didn't fit.
+    xe::counters::Counter& wasted_bytes;
+  };
+
   // Extended by the implementation.
   struct Page {
     virtual ~Page();
@@ -47,7 +64,9 @@ class GraphicsUploadBufferPool {
     Page* next_;
   };
 
-  GraphicsUploadBufferPool(size_t page_size) : page_size_(page_size) {}
+  // Without the metrics name, usage is not reported.
+  GraphicsUploadBufferPool(size_t page_size,
+                           const char* metrics_name = nullptr);
 
   // Request to write data in a single piece, creating a new page if the current
   // one doesn't have enough free space.
@@ -77,6 +96,22 @@ class GraphicsUploadBufferPool {
 
   size_t current_page_used_ = 0;
   size_t current_page_flushed_ = 0;
+
+  // A page taken for a single request that is larger than the free space in
+  // the current page, while the current page has more free space left than
+  // the new one would have, so the current page stays open for smaller
+  // requests. Submitted immediately, but its writes are flushed along with the
+  // ones of the current page.
+  Page* dedicated_page_unflushed_ = nullptr;
+  size_t dedicated_page_unflushed_size_ = 0;
+
+ private:
+  // Appends the page to the list of the submitted pages.
+  void SubmitPage(Page* page);
+  void OnPageCreated();
+
+  std::unique_ptr<Metrics> metrics_;
+  size_t page_count_ = 0;
 };
 
 }  // namespace ui
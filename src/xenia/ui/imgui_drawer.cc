@@ -567,18 +567,43 @@ void ImGuiDrawer::RenderDrawLists(ImDrawData* data,
                                   UIDrawContext& ui_draw_context) {
   ImGuiIO& io = ImGui::GetIO();
 
-  immediate_drawer_->Begin(ui_draw_context, io.DisplaySize.x, io.DisplaySize.y);
+  if (data->TotalVtxCount <= 0 || data->TotalIdxCount <= 0) {
+    // Only windows that haven't appeared yet, for instance.
+    return;
+  }
 
+  // Uploaded as one batch rather than one per window, with the indices, which
+  // are relative to the vertices of their window, offset by the base vertex.
+  static_assert(sizeof(ImDrawVert) == sizeof(ImmediateVertex));
+  static_assert(sizeof(ImDrawIdx) == sizeof(uint16_t));
+  batch_vertices_.clear();
+  batch_indices_.clear();
+  batch_vertices_.reserve(data->TotalVtxCount);
+  batch_indices_.reserve(data->TotalIdxCount);
   for (int i = 0; i < data->CmdListsCount; ++i) {
     const auto cmd_list = data->CmdLists[i];
+    const auto* vertices =
+        reinterpret_cast<const ImmediateVertex*>(cmd_list->VtxBuffer.Data);
+    batch_vertices_.insert(batch_vertices_.end(), vertices,
+                           vertices + cmd_list->VtxBuffer.size());
+    const ImDrawIdx* indices = cmd_list->IdxBuffer.Data;
+    batch_indices_.insert(batch_indices_.end(), indices,
+                          indices + cmd_list->IdxBuffer.size());
+  }
+
+  immediate_drawer_->Begin(ui_draw_context, io.DisplaySize.x, io.DisplaySize.y);
 
-    ImmediateDrawBatch batch;
-    batch.vertices =
-        reinterpret_cast<ImmediateVertex*>(cmd_list->VtxBuffer.Data);
-    batch.vertex_count = cmd_list->VtxBuffer.size();
-    batch.indices = cmd_list->IdxBuffer.Data;
-    batch.index_count = cmd_list->IdxBuffer.size();
-    immediate_drawer_->BeginDrawBatch(batch);
+  ImmediateDrawBatch batch;
+  batch.vertices = batch_vertices_.data();
+  batch.vertex_count = int(batch_vertices_.size());
+  batch.indices = batch_indices_.data();
+  batch.index_count = int(batch_indices_.size());
+  immediate_drawer_->BeginDrawBatch(batch);
+
+  int list_base_vertex = 0;
+  int list_index_offset = 0;
+  for (int i = 0; i < data->CmdListsCount; ++i) {
+    const auto cmd_list = data->CmdLists[i];
 
     for (int j = 0; j < cmd_list->CmdBuffer.size(); ++j) {
       const auto& cmd = cmd_list->CmdBuffer[j];
@@ -586,7 +611,8 @@ void ImGuiDrawer::RenderDrawLists(ImDrawData* data,
       ImmediateDraw draw;
       draw.primitive_type = ImmediatePrimitiveType::kTriangles;
       draw.count = cmd.ElemCount;
-      draw.index_offset = cmd.IdxOffset;
+      draw.index_offset = list_index_offset + int(cmd.IdxOffset);
+      draw.base_vertex = list_base_vertex;
       draw.texture = reinterpret_cast<ImmediateTexture*>(cmd.TextureId);
       draw.scissor = true;
       draw.scissor_left = cmd.ClipRect.x;
@@ -596,9 +622,12 @@ void ImGuiDrawer::RenderDrawLists(ImDrawData* data,
       immediate_drawer_->Draw(draw);
     }
 
-    immediate_drawer_->EndDrawBatch();
+    list_base_vertex += cmd_list->VtxBuffer.size();
+    list_index_offset += cmd_list->IdxBuffer.size();
   }
 
+  immediate_drawer_->EndDrawBatch();
+
   immediate_drawer_->End();
 }
 
@@ -144,6 +144,11 @@ class ImGuiDrawer : public WindowInputListener, public UIDrawer {
 
   std::vector<std::unique_ptr<ImmediateTexture>> notification_icon_textures_;
 
+  // The draw lists of all the windows of a frame, gathered for uploading them
+  // as a single batch, with the capacity kept between the frames.
+  std::vector<ImmediateVertex> batch_vertices_;
+  std::vector<uint16_t> batch_indices_;
+
   // If there's an active pointer, the ImGui mouse is controlled by this touch.
   // If it's TouchEvent::kPointerIDNone, the ImGui mouse is controlled by the
   // mouse.
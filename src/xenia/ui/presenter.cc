@@ -10,9 +10,13 @@
 #include "xenia/ui/presenter.h"
 
 #include <algorithm>
+#include <cmath>
 #include <utility>
 
+#include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/counters.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/platform.h"
@@ -40,6 +44,14 @@ DEFINE_bool(
     "host window system.",
     "Display");
 
+DEFINE_bool(
+    present_low_latency, false,
+    "On graphics backends where this is supported, allow only one frame to be "
+    "queued for presentation, and wait for the host swap chain before painting "
+    "to minimize the latency between the guest output refresh and the display "
+    "at the cost of some throughput.",
+    "Display");
+
 DEFINE_bool(
     present_render_pass_clear, true,
     "On graphics backends where this is supported, use the clear render pass "
@@ -47,6 +59,13 @@ DEFINE_bool(
     "the letterbox area.",
     "Display");
 
+DEFINE_bool(
+    present_gpu_timing, false,
+    "On graphics backends where this is supported, measure the GPU time of "
+    "each guest output effect pass (such as FSR or CAS) for the "
+    "ui/guest_output_gpu_us metrics.",
+    "Display");
+
 DEFINE_bool(
     present_letterbox, true,
     "Maintain aspect ratio when stretching by displaying bars around the image "
@@ -74,6 +93,62 @@ DEFINE_int32(
 namespace xe {
 namespace ui {
 
+static xe::counters::Counter& present_time_counter =
+    xe::counters::GetCounter("ui/present_us");
+
+const char* Presenter::GetGuestOutputPaintEffectName(
+    GuestOutputPaintEffect effect) {
+  switch (effect) {
+    case GuestOutputPaintEffect::kBilinear:
+      return "bilinear";
+    case GuestOutputPaintEffect::kBilinearDither:
+      return "bilinear_dither";
+    case GuestOutputPaintEffect::kCasSharpen:
+      return "cas_sharpen";
+    case GuestOutputPaintEffect::kCasSharpenDither:
+      return "cas_sharpen_dither";
+    case GuestOutputPaintEffect::kCasResample:
+      return "cas_resample";
+    case GuestOutputPaintEffect::kCasResampleDither:
+      return "cas_resample_dither";
+    case GuestOutputPaintEffect::kFsrEasu:
+      return "fsr_easu";
+    case GuestOutputPaintEffect::kFsrRcas:
+      return "fsr_rcas";
+    case GuestOutputPaintEffect::kFsrRcasDither:
+      return "fsr_rcas_dither";
+    default:
+      return "unknown";
+  }
+}
+
+void Presenter::AddGuestOutputPaintEffectGpuTime(GuestOutputPaintEffect effect,
+                                                 uint64_t microseconds) {
+  struct EffectCounters {
+    std::array<xe::counters::Counter*, size_t(GuestOutputPaintEffect::kCount)>
+        gpu_time;
+    std::array<xe::counters::Counter*, size_t(GuestOutputPaintEffect::kCount)>
+        passes;
+  };
+  static const EffectCounters effect_counters = []() {
+    EffectCounters counters;
+    for (size_t i = 0; i < size_t(GuestOutputPaintEffect::kCount); ++i) {
+      const char* name =
+          GetGuestOutputPaintEffectName(GuestOutputPaintEffect(i));
+      counters.gpu_time[i] = &xe::counters::GetCounter(
+          fmt::format("ui/guest_output_gpu_us/{}", name));
+      counters.passes[i] = &xe::counters::GetCounter(
+          fmt::format("ui/guest_output_passes/{}", name));
+    }
+    return counters;
+  }();
+  if (size_t(effect) >= size_t(GuestOutputPaintEffect::kCount)) {
+    return;
+  }
+  effect_counters.gpu_time[size_t(effect)]->Increment(microseconds);
+  effect_counters.passes[size_t(effect)]->Increment();
+}
+
 void Presenter::FatalErrorHostGpuLossCallback(
     [[maybe_unused]] bool is_responsible,
     [[maybe_unused]] bool statically_from_ui_thread) {
@@ -363,6 +438,7 @@ bool Presenter::RefreshGuestOutput(
   writable_properties.display_aspect_ratio_x = display_aspect_ratio_x;
   writable_properties.display_aspect_ratio_y = display_aspect_ratio_y;
   writable_properties.is_8bpc = false;
+  writable_properties.refresh_host_tick = 0;
   bool is_active = writable_properties.IsActive();
   if (is_active) {
     if (!RefreshGuestOutputImpl(guest_output_mailbox_writable_,
@@ -373,6 +449,18 @@ bool Presenter::RefreshGuestOutput(
       // output either though because the failure may be something transient.
       return false;
     }
+    uint64_t refresh_host_tick = Clock::QueryHostTickCount();
+    writable_properties.refresh_host_tick = refresh_host_tick;
+    if (guest_output_active_last_refresh_ &&
+        frame_pacing_last_refresh_host_tick_) {
+      float frame_time_ms =
+          float(double(refresh_host_tick -
+                       frame_pacing_last_refresh_host_tick_) *
+                1000.0 / double(Clock::QueryHostTickFrequency()));
+      std::lock_guard<std::mutex> frame_pacing_lock(frame_pacing_mutex_);
+      frame_pacing_frame_times_.Add(frame_time_ms);
+    }
+    frame_pacing_last_refresh_host_tick_ = refresh_host_tick;
     guest_output_active_last_refresh_ = true;
   } else {
     // Request presenting a blank image if there was a true image previously,
@@ -491,10 +579,28 @@ void Presenter::SetGuestOutputPaintConfigFromUIThread(
     request_repaint = true;
   }
   if (modified) {
-    {
-      std::unique_lock<std::mutex> config_lock(
-          guest_output_paint_config_mutex_);
-      guest_output_paint_config_ = new_config;
+    guest_output_paint_config_ = new_config;
+    // Publish the new configuration as the ready one, replacing the previous
+    // ready one if it hasn't been acquired yet, the same way as guest output
+    // images are published by refreshing.
+    guest_output_paint_config_mailbox_[guest_output_paint_config_writable_] =
+        new_config;
+    uint32_t last_acquired_and_ready =
+        guest_output_paint_config_acquired_and_ready_.load(
+            std::memory_order_relaxed);
+    while (!guest_output_paint_config_acquired_and_ready_.compare_exchange_weak(
+        last_acquired_and_ready,
+        (last_acquired_and_ready & 3) |
+            (guest_output_paint_config_writable_ << 2),
+        std::memory_order_acq_rel, std::memory_order_relaxed)) {
+    }
+    uint32_t last_acquired = last_acquired_and_ready & 3;
+    if (last_acquired == guest_output_paint_config_writable_) {
+      guest_output_paint_config_writable_ =
+          (guest_output_paint_config_writable_ + 1) % 3;
+    } else {
+      guest_output_paint_config_writable_ =
+          (3 - last_acquired - guest_output_paint_config_writable_) % 3;
     }
     // Coarsely check the availability of painting and of the window (for
     // calling RequestPaint) via paint_mode_ because the actual painting
@@ -600,19 +706,37 @@ std::unique_lock<std::mutex> Presenter::ConsumeGuestOutput(
     uint32_t& mailbox_index_or_max_if_inactive_out,
     GuestOutputProperties* properties_out,
     GuestOutputPaintConfig* paint_config_out) {
-  if (paint_config_out) {
-    // Get the up-to-date guest output paint configuration settings set by the
-    // UI thread.
-    std::unique_lock<std::mutex> config_lock(guest_output_paint_config_mutex_);
-    *paint_config_out = guest_output_paint_config_;
-  }
-
   // Lock the mutex to make sure the image that will be acquired now is owned
   // exclusively by the calling thread for the time while this mutex is still
   // locked (it needs to be held by the consumer while working with anything
   // that depends on the image now being acquired or its index in the mailbox).
   std::unique_lock<std::mutex> consumer_lock(
       guest_output_mailbox_consumer_mutex_);
+
+  if (paint_config_out) {
+    // Get the up-to-date guest output paint configuration settings set by the
+    // UI thread, without waiting for it, acquiring them the same way as the
+    // image.
+    uint32_t old_config_acquired_and_ready =
+        guest_output_paint_config_acquired_and_ready_.load(
+            std::memory_order_relaxed);
+    uint32_t desired_config_acquired_and_ready =
+        (old_config_acquired_and_ready & ~uint32_t(3)) |
+        (old_config_acquired_and_ready >> 2);
+    while (old_config_acquired_and_ready !=
+               desired_config_acquired_and_ready &&
+           !guest_output_paint_config_acquired_and_ready_.compare_exchange_weak(
+               old_config_acquired_and_ready,
+               desired_config_acquired_and_ready, std::memory_order_acq_rel,
+               std::memory_order_relaxed)) {
+      desired_config_acquired_and_ready =
+          (old_config_acquired_and_ready & ~uint32_t(3)) |
+          (old_config_acquired_and_ready >> 2);
+    }
+    uint32_t config_index = desired_config_acquired_and_ready & 3;
+    *paint_config_out = guest_output_paint_config_mailbox_[config_index];
+  }
+
   // Acquire the up-to-date ready guest image (may be new, in this case the last
   // acquired one will be released, or still the same or no refresh has happened
   // since the last consumption).
@@ -1278,7 +1402,27 @@ Presenter::PaintResult Presenter::PaintAndPresent(bool execute_ui_drawers) {
   assert_false(execute_ui_drawers && !is_in_ui_thread_paint_);
   assert_true(surface_paint_connection_state_ ==
               SurfacePaintConnectionState::kConnectedPaintable);
-  PaintResult result = PaintAndPresentImpl(execute_ui_drawers);
+  PaintResult result;
+  {
+    xe::counters::ScopedTimer present_timer(present_time_counter);
+    result = PaintAndPresentImpl(execute_ui_drawers);
+  }
+  if (result == PaintResult::kPresented ||
+      result == PaintResult::kPresentedSuboptimal) {
+    // The image that has just been painted is still the acquired one, unless a
+    // capture has consumed a newer image since then, which is rare enough to
+    // be ignored in the telemetry.
+    uint64_t refresh_host_tick;
+    {
+      std::lock_guard<std::mutex> consumer_lock(
+          guest_output_mailbox_consumer_mutex_);
+      uint32_t acquired = guest_output_mailbox_acquired_and_ready_.load(
+                              std::memory_order_relaxed) &
+                          3;
+      refresh_host_tick = guest_output_properties_[acquired].refresh_host_tick;
+    }
+    AddFramePacingLatencySample(refresh_host_tick);
+  }
   switch (result) {
     case PaintResult::kPresented:
       surface_paint_connection_was_optimal_at_successful_paint_ = true;
@@ -1303,6 +1447,70 @@ Presenter::PaintResult Presenter::PaintAndPresent(bool execute_ui_drawers) {
   return result;
 }
 
+uint32_t Presenter::FramePacingHistory::CopyOrdered(
+    std::array<float, kFramePacingHistoryLength>& values_out) const {
+  uint32_t first = (next + kFramePacingHistoryLength - count) %
+                   kFramePacingHistoryLength;
+  for (uint32_t i = 0; i < count; ++i) {
+    values_out[i] = values_ms[(first + i) % kFramePacingHistoryLength];
+  }
+  return count;
+}
+
+void Presenter::AddFramePacingLatencySample(uint64_t refresh_host_tick) {
+  // Only measure the first present of each image, not UI repaints.
+  if (!refresh_host_tick ||
+      refresh_host_tick == frame_pacing_last_presented_refresh_host_tick_) {
+    return;
+  }
+  frame_pacing_last_presented_refresh_host_tick_ = refresh_host_tick;
+  uint64_t present_host_tick = Clock::QueryHostTickCount();
+  float latency_ms =
+      float(double(present_host_tick - refresh_host_tick) * 1000.0 /
+            double(Clock::QueryHostTickFrequency()));
+  std::lock_guard<std::mutex> frame_pacing_lock(frame_pacing_mutex_);
+  frame_pacing_latencies_.Add(latency_ms);
+}
+
+void Presenter::GetFramePacingStats(FramePacingStats& stats_out) const {
+  {
+    std::lock_guard<std::mutex> frame_pacing_lock(frame_pacing_mutex_);
+    stats_out.frame_time_count =
+        frame_pacing_frame_times_.CopyOrdered(stats_out.frame_times_ms);
+    stats_out.latency_count =
+        frame_pacing_latencies_.CopyOrdered(stats_out.latencies_ms);
+  }
+  double frame_time_sum = 0.0;
+  for (uint32_t i = 0; i < stats_out.frame_time_count; ++i) {
+    frame_time_sum += stats_out.frame_times_ms[i];
+  }
+  double frame_time_mean =
+      stats_out.frame_time_count
+          ? frame_time_sum / double(stats_out.frame_time_count)
+          : 0.0;
+  double frame_time_variance = 0.0;
+  for (uint32_t i = 0; i < stats_out.frame_time_count; ++i) {
+    double deviation = stats_out.frame_times_ms[i] - frame_time_mean;
+    frame_time_variance += deviation * deviation;
+  }
+  if (stats_out.frame_time_count) {
+    frame_time_variance /= double(stats_out.frame_time_count);
+  }
+  stats_out.frame_time_mean_ms = float(frame_time_mean);
+  stats_out.frame_time_std_dev_ms = float(std::sqrt(frame_time_variance));
+  double latency_sum = 0.0;
+  float latency_max = 0.0f;
+  for (uint32_t i = 0; i < stats_out.latency_count; ++i) {
+    latency_sum += stats_out.latencies_ms[i];
+    latency_max = std::max(latency_max, stats_out.latencies_ms[i]);
+  }
+  stats_out.latency_mean_ms =
+      stats_out.latency_count
+          ? float(latency_sum / double(stats_out.latency_count))
+          : 0.0f;
+  stats_out.latency_max_ms = latency_max;
+}
+
 void Presenter::HandleUIDrawersChangeFromUIThread(bool drawers_were_empty) {
   if (is_in_ui_thread_paint_) {
     // Defer the refresh so no dangerous lifecycle-related changes happen during
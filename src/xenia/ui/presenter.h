@@ -44,7 +44,9 @@
 #endif  // XE_PLATFORM
 
 // For implementation use.
+DECLARE_bool(present_low_latency);
 DECLARE_bool(present_render_pass_clear);
+DECLARE_bool(present_gpu_timing);
 
 namespace xe {
 namespace ui {
@@ -335,6 +337,24 @@ class Presenter {
   // Requests (re)painting with the UI if there's UI to draw.
   void RequestUIPaintFromUIThread();
 
+  static constexpr uint32_t kFramePacingHistoryLength = 120;
+  struct FramePacingStats {
+    // Oldest first, in milliseconds. Frame times are the intervals between the
+    // guest output refreshes, latencies are from the refresh of an image to
+    // the return from the host present call for it (not until the image is
+    // actually visible on the display).
+    std::array<float, kFramePacingHistoryLength> frame_times_ms;
+    std::array<float, kFramePacingHistoryLength> latencies_ms;
+    uint32_t frame_time_count;
+    uint32_t latency_count;
+    float frame_time_mean_ms;
+    float frame_time_std_dev_ms;
+    float latency_mean_ms;
+    float latency_max_ms;
+  };
+  // Callable from any thread.
+  void GetFramePacingStats(FramePacingStats& stats_out) const;
+
  protected:
   enum class PaintResult {
     kPresented,
@@ -368,6 +388,8 @@ class Presenter {
     uint32_t display_aspect_ratio_x;
     uint32_t display_aspect_ratio_y;
     bool is_8bpc;
+    // Host tick count at the refresh of the image, for frame pacing telemetry.
+    uint64_t refresh_host_tick;
 
     GuestOutputProperties() { SetToInactive(); }
 
@@ -382,6 +404,7 @@ class Presenter {
       display_aspect_ratio_x = 0;
       display_aspect_ratio_y = 0;
       is_8bpc = false;
+      refresh_host_tick = 0;
     }
   };
 
@@ -417,6 +440,15 @@ class Presenter {
     };
   }
 
+  // For the names of the GPU time counters of the effects.
+  static const char* GetGuestOutputPaintEffectName(
+      GuestOutputPaintEffect effect);
+  // Adds the GPU time of a pass of the effect measured by the implementation
+  // to the "ui/guest_output_gpu_us/<effect>" counter, and counts the pass in
+  // "ui/guest_output_passes/<effect>".
+  static void AddGuestOutputPaintEffectGpuTime(GuestOutputPaintEffect effect,
+                                               uint64_t microseconds);
+
   static constexpr bool CanGuestOutputPaintEffectBeFinal(
       GuestOutputPaintEffect effect) {
     switch (effect) {
@@ -915,9 +947,19 @@ class Presenter {
   // repaint request anyway.
   std::atomic<bool> ui_thread_paint_requested_{false};
 
-  std::mutex guest_output_paint_config_mutex_;
-  // UI thread: writable, guest output thread: read-only.
+  // Accessible only by the UI thread.
   GuestOutputPaintConfig guest_output_paint_config_;
+  // Copies of guest_output_paint_config_ passed to the consumers of the guest
+  // output through a mailbox like the guest output images, with the UI thread
+  // as the producer, so changing the configuration in the UI thread and
+  // painting in the guest output thread never wait for each other. The bits of
+  // the "acquired" and the "ready" index are the same as in
+  // guest_output_mailbox_acquired_and_ready_, and the configuration is
+  // acquired with guest_output_mailbox_consumer_mutex_ held.
+  std::array<GuestOutputPaintConfig, 3> guest_output_paint_config_mailbox_;
+  std::atomic<uint32_t> guest_output_paint_config_acquired_and_ready_{0};
+  // Accessible only by the UI thread.
+  uint32_t guest_output_paint_config_writable_ = 1;
 
   // Single-producer-multiple-consumers (lock-free SPSC + consumer lock) mailbox
   // for presenting of the most up-to-date guest output image without long
@@ -960,6 +1002,29 @@ class Presenter {
   // rather than being blank.
   bool guest_output_active_last_refresh_ = false;
 
+  struct FramePacingHistory {
+    std::array<float, kFramePacingHistoryLength> values_ms;
+    uint32_t next = 0;
+    uint32_t count = 0;
+
+    void Add(float value_ms) {
+      values_ms[next] = value_ms;
+      next = (next + 1) % kFramePacingHistoryLength;
+      count = std::min(count + 1, kFramePacingHistoryLength);
+    }
+    // Returns the number of values written, oldest first.
+    uint32_t CopyOrdered(
+        std::array<float, kFramePacingHistoryLength>& values_out) const;
+  };
+  void AddFramePacingLatencySample(uint64_t refresh_host_tick);
+  // Accessible only by refreshing.
+  uint64_t frame_pacing_last_refresh_host_tick_ = 0;
+  // Accessible only by painting.
+  uint64_t frame_pacing_last_presented_refresh_host_tick_ = 0;
+  mutable std::mutex frame_pacing_mutex_;
+  FramePacingHistory frame_pacing_frame_times_;
+  FramePacingHistory frame_pacing_latencies_;
+
   // Ordered by the Z order, and then by the time of addition.
   // Note: All the iteration logic involving this Z ordering must be the same as
   // in input handling (in the input listeners in the Window), but in reverse.
@@ -63,6 +63,19 @@ bool SpirvToolsContext::Initialize(unsigned int spirv_version) {
     Shutdown();
     return false;
   }
+  if (!LoadLibraryFunction(fn_spvOptimizerCreate_, "spvOptimizerCreate") ||
+      !LoadLibraryFunction(fn_spvOptimizerDestroy_, "spvOptimizerDestroy") ||
+      !LoadLibraryFunction(fn_spvOptimizerRegisterPerformancePasses_,
+                           "spvOptimizerRegisterPerformancePasses") ||
+      !LoadLibraryFunction(fn_spvOptimizerRun_, "spvOptimizerRun") ||
+      !LoadLibraryFunction(fn_spvOptimizerOptionsCreate_,
+                           "spvOptimizerOptionsCreate") ||
+      !LoadLibraryFunction(fn_spvOptimizerOptionsDestroy_,
+                           "spvOptimizerOptionsDestroy") ||
+      !LoadLibraryFunction(fn_spvBinaryDestroy_, "spvBinaryDestroy")) {
+    XELOGW("SPIRV-Tools: The optimizer is not available in the library");
+    fn_spvOptimizerCreate_ = nullptr;
+  }
   spv_target_env target_env;
   if (spirv_version >= 0x10500) {
     target_env = SPV_ENV_VULKAN_1_2;
@@ -73,6 +86,7 @@ bool SpirvToolsContext::Initialize(unsigned int spirv_version) {
   } else {
     target_env = SPV_ENV_VULKAN_1_0;
   }
+  target_env_ = target_env;
   context_ = fn_spvContextCreate_(target_env);
   if (!context_) {
     XELOGE("SPIRV-Tools: Failed to create a Vulkan 1.0 context");
@@ -95,6 +109,7 @@ void SpirvToolsContext::Shutdown() {
 #endif
     library_ = nullptr;
   }
+  fn_spvOptimizerCreate_ = nullptr;
 }
 
 spv_result_t SpirvToolsContext::Validate(const uint32_t* words,
@@ -118,6 +133,34 @@ spv_result_t SpirvToolsContext::Validate(const uint32_t* words,
   return result;
 }
 
+spv_result_t SpirvToolsContext::Optimize(
+    const uint32_t* words, size_t num_words,
+    std::vector<uint32_t>& optimized_out) const {
+  optimized_out.clear();
+  if (!IsOptimizerAvailable()) {
+    return SPV_UNSUPPORTED;
+  }
+  spv_optimizer_t* optimizer = fn_spvOptimizerCreate_(target_env_);
+  if (!optimizer) {
+    return SPV_ERROR_OUT_OF_MEMORY;
+  }
+  fn_spvOptimizerRegisterPerformancePasses_(optimizer);
+  spv_optimizer_options options = fn_spvOptimizerOptionsCreate_();
+  spv_binary optimized = nullptr;
+  spv_result_t result =
+      fn_spvOptimizerRun_(optimizer, words, num_words, &optimized, options);
+  if (optimized) {
+    if (result == SPV_SUCCESS) {
+      optimized_out.assign(optimized->code,
+                           optimized->code + optimized->wordCount);
+    }
+    fn_spvBinaryDestroy_(optimized);
+  }
+  fn_spvOptimizerOptionsDestroy_(options);
+  fn_spvOptimizerDestroy_(optimizer);
+  return result;
+}
+
 }  // namespace vulkan
 }  // namespace ui
 }  // namespace xe
@@ -365,7 +365,7 @@ bool VulkanPresenter::CaptureGuestOutput(RawImage& image_out) {
     {
       VulkanSubmissionTracker::FenceAcquisition fence_acqusition(
           submission_tracker.AcquireFenceToAdvanceSubmission());
-      if (!fence_acqusition.fence()) {
+      if (!fence_acqusition.is_signal_available()) {
         XELOGE(
             "VulkanPresenter: Failed to acquire a fence for guest output "
             "capturing");
@@ -380,8 +380,8 @@ bool VulkanPresenter::CaptureGuestOutput(RawImage& image_out) {
         VulkanProvider::QueueAcquisition queue_acquisition(
             provider_.AcquireQueue(provider_.queue_family_graphics_compute(),
                                    0));
-        submit_result = dfn.vkQueueSubmit(
-            queue_acquisition.queue, 1, &submit_info, fence_acqusition.fence());
+        submit_result =
+            fence_acqusition.Submit(queue_acquisition.queue, 1, &submit_info);
       }
       if (submit_result != VK_SUCCESS) {
         XELOGE(
@@ -883,15 +883,14 @@ bool VulkanPresenter::RefreshGuestOutputImpl(
   // "Fence signal operations that are defined by vkQueueSubmit additionally
   //  include in the first synchronization scope all commands that occur earlier
   //  in submission order."
-  const VulkanProvider::DeviceFunctions& dfn = provider_.dfn();
   {
     VulkanSubmissionTracker::FenceAcquisition fence_acqusition(
         guest_output_image_refresher_submission_tracker_
             .AcquireFenceToAdvanceSubmission());
     VulkanProvider::QueueAcquisition queue_acquisition(
         provider_.AcquireQueue(provider_.queue_family_graphics_compute(), 0));
-    if (dfn.vkQueueSubmit(queue_acquisition.queue, 0, nullptr,
-                          fence_acqusition.fence()) != VK_SUCCESS) {
+    if (fence_acqusition.Submit(queue_acquisition.queue, 0, nullptr) !=
+        VK_SUCCESS) {
       fence_acqusition.SubmissionSucceededSignalFailed();
     }
   }
@@ -2031,12 +2030,12 @@ Presenter::PaintResult VulkanPresenter::PaintAndPresentImpl(
     {
       VulkanProvider::QueueAcquisition queue_acquisition(
           provider_.AcquireQueue(provider_.queue_family_graphics_compute(), 0));
-      submit_result = dfn.vkQueueSubmit(queue_acquisition.queue, 1,
-                                        &submit_info, fence_acqusition.fence());
-      if (ui_fence_acquisition.fence() != VK_NULL_HANDLE &&
+      submit_result =
+          fence_acqusition.Submit(queue_acquisition.queue, 1, &submit_info);
+      if (ui_fence_acquisition.is_signal_available() &&
           submit_result == VK_SUCCESS) {
-        if (dfn.vkQueueSubmit(queue_acquisition.queue, 0, nullptr,
-                              ui_fence_acquisition.fence()) != VK_SUCCESS) {
+        if (ui_fence_acquisition.Submit(queue_acquisition.queue, 0, nullptr) !=
+            VK_SUCCESS) {
           ui_fence_acquisition.SubmissionSucceededSignalFailed();
         }
       }
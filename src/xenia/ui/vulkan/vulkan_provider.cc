@@ -9,6 +9,7 @@
 
 #include "xenia/ui/vulkan/vulkan_provider.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cstddef>
 #include <cstring>
@@ -792,8 +793,10 @@ void VulkanProvider::TryCreateDevice() {
     device_info_.ext_1_2_VK_KHR_image_format_list = true;
     device_info_.ext_1_2_VK_KHR_shader_float_controls = true;
     device_info_.ext_1_2_VK_KHR_spirv_1_4 = true;
+    device_info_.ext_1_2_VK_KHR_timeline_semaphore = true;
   }
   if (properties.apiVersion >= VK_MAKE_API_VERSION(0, 1, 3, 0)) {
+    device_info_.ext_1_3_VK_KHR_dynamic_rendering = true;
     device_info_.ext_1_3_VK_EXT_shader_demote_to_helper_invocation = true;
     device_info_.ext_1_3_VK_KHR_maintenance4 = true;
   }
@@ -821,6 +824,8 @@ void VulkanProvider::TryCreateDevice() {
       EXTENSION(VK_KHR_portability_subset)
       EXTENSION(VK_EXT_memory_budget)
       EXTENSION(VK_EXT_fragment_shader_interlock)
+      EXTENSION(VK_KHR_pipeline_library)
+      EXTENSION(VK_EXT_graphics_pipeline_library)
       EXTENSION(VK_EXT_non_seamless_cube_map)
     } else {
       if (!std::strcmp(extension.extensionName, "VK_KHR_portability_subset")) {
@@ -862,6 +867,16 @@ void VulkanProvider::TryCreateDevice() {
 #undef EXTENSION
   }
 
+  if (device_info_.ext_VK_EXT_graphics_pipeline_library &&
+      !device_info_.ext_VK_KHR_pipeline_library) {
+    enabled_extensions.erase(std::find_if(
+        enabled_extensions.begin(), enabled_extensions.end(),
+        [](const char* name) {
+          return !std::strcmp(name, "VK_EXT_graphics_pipeline_library");
+        }));
+    device_info_.ext_VK_EXT_graphics_pipeline_library = false;
+  }
+
   if (is_surface_required_ && !device_info_.ext_VK_KHR_swapchain) {
     XELOGVK("Vulkan device '{}' doesn't support presentation",
             properties.deviceName);
@@ -1023,6 +1038,14 @@ void VulkanProvider::TryCreateDevice() {
   if (device_info_.ext_1_3_VK_EXT_shader_demote_to_helper_invocation) {
     FEATURES2_ADD_PROMOTED(ShaderDemoteToHelperInvocationFeatures, 3)
   }
+  FEATURES2_DECLARE(GraphicsPipelineLibraryFeaturesEXT,
+                    GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT)
+  PROPERTIES2_DECLARE(GraphicsPipelineLibraryPropertiesEXT,
+                      GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT)
+  if (device_info_.ext_VK_EXT_graphics_pipeline_library) {
+    FEATURES2_ADD(GraphicsPipelineLibraryFeaturesEXT)
+    PROPERTIES2_ADD(GraphicsPipelineLibraryPropertiesEXT)
+  }
   FEATURES2_DECLARE(NonSeamlessCubeMapFeaturesEXT,
                     NON_SEAMLESS_CUBE_MAP_FEATURES_EXT)
   if (device_info_.ext_VK_EXT_non_seamless_cube_map) {
@@ -1116,11 +1139,26 @@ void VulkanProvider::TryCreateDevice() {
     }
   }
 
+  if (device_info_.ext_1_2_VK_KHR_timeline_semaphore) {
+    EXTENSION_FEATURE_PROMOTED_AS_OPTIONAL(timelineSemaphore, 2)
+  }
+
+  if (device_info_.ext_1_3_VK_KHR_dynamic_rendering) {
+    EXTENSION_FEATURE_PROMOTED_AS_OPTIONAL(dynamicRendering, 3)
+  }
+
   if (device_info_.ext_1_3_VK_EXT_shader_demote_to_helper_invocation) {
     EXTENSION_FEATURE_PROMOTED(ShaderDemoteToHelperInvocationFeatures,
                                shaderDemoteToHelperInvocation, 3)
   }
 
+  if (device_info_.ext_VK_EXT_graphics_pipeline_library) {
+    EXTENSION_FEATURE(GraphicsPipelineLibraryFeaturesEXT,
+                      graphicsPipelineLibrary)
+    EXTENSION_PROPERTY(GraphicsPipelineLibraryPropertiesEXT,
+                       graphicsPipelineLibraryFastLinking)
+  }
+
   if (device_info_.ext_VK_EXT_non_seamless_cube_map) {
     EXTENSION_FEATURE(NonSeamlessCubeMapFeaturesEXT, nonSeamlessCubeMap)
   }
@@ -1337,8 +1375,12 @@ void VulkanProvider::TryCreateDevice() {
   if (properties.apiVersion >= VK_MAKE_API_VERSION(0, 1, 1, 0)) {
 #include "xenia/ui/vulkan/functions/device_khr_bind_memory2.inc"
 #include "xenia/ui/vulkan/functions/device_khr_get_memory_requirements2.inc"
+  }
+  if (properties.apiVersion >= VK_MAKE_API_VERSION(0, 1, 2, 0)) {
+#include "xenia/ui/vulkan/functions/device_khr_timeline_semaphore.inc"
   }
   if (properties.apiVersion >= VK_MAKE_API_VERSION(0, 1, 3, 0)) {
+#include "xenia/ui/vulkan/functions/device_khr_dynamic_rendering.inc"
 #include "xenia/ui/vulkan/functions/device_khr_maintenance4.inc"
   }
 #undef XE_UI_VULKAN_FUNCTION_PROMOTED
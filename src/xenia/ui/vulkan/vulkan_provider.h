@@ -135,6 +135,13 @@ class VulkanProvider : public GraphicsProvider {
 
     bool samplerMirrorClampToEdge;
 
+    // VK_KHR_dynamic_rendering (#45, Vulkan 1.3).
+    // Only used on Vulkan 1.3 to avoid enabling the extensions it depends on.
+
+    bool ext_1_3_VK_KHR_dynamic_rendering;
+
+    bool dynamicRendering;
+
     // VK_KHR_dedicated_allocation (#128, Vulkan 1.1).
 
     bool ext_1_1_VK_KHR_dedicated_allocation;
@@ -179,6 +186,13 @@ class VulkanProvider : public GraphicsProvider {
     bool shaderDenormFlushToZeroFloat32;
     bool shaderRoundingModeRTEFloat32;
 
+    // VK_KHR_timeline_semaphore (#208, Vulkan 1.2).
+    // Only used on Vulkan 1.2 to avoid enabling the extensions it depends on.
+
+    bool ext_1_2_VK_KHR_timeline_semaphore;
+
+    bool timelineSemaphore;
+
     // VK_KHR_spirv_1_4 (#237, Vulkan 1.2).
 
     bool ext_1_2_VK_KHR_spirv_1_4;
@@ -200,6 +214,18 @@ class VulkanProvider : public GraphicsProvider {
 
     bool shaderDemoteToHelperInvocation;
 
+    // VK_KHR_pipeline_library (#291).
+
+    bool ext_VK_KHR_pipeline_library;
+
+    // VK_EXT_graphics_pipeline_library (#321).
+    // Only enabled along with VK_KHR_pipeline_library, which it requires.
+
+    bool ext_VK_EXT_graphics_pipeline_library;
+
+    bool graphicsPipelineLibrary;
+    bool graphicsPipelineLibraryFastLinking;
+
     // VK_KHR_maintenance4 (#414, Vulkan 1.3).
 
     bool ext_1_3_VK_KHR_maintenance4;
@@ -328,9 +354,11 @@ class VulkanProvider : public GraphicsProvider {
   PFN_##core_name core_name;
 #include "xenia/ui/vulkan/functions/device_1_0.inc"
 #include "xenia/ui/vulkan/functions/device_khr_bind_memory2.inc"
+#include "xenia/ui/vulkan/functions/device_khr_dynamic_rendering.inc"
 #include "xenia/ui/vulkan/functions/device_khr_get_memory_requirements2.inc"
 #include "xenia/ui/vulkan/functions/device_khr_maintenance4.inc"
 #include "xenia/ui/vulkan/functions/device_khr_swapchain.inc"
+#include "xenia/ui/vulkan/functions/device_khr_timeline_semaphore.inc"
 #undef XE_UI_VULKAN_FUNCTION_PROMOTED
 #undef XE_UI_VULKAN_FUNCTION
   };
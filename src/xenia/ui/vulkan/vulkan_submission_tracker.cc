@@ -9,9 +9,12 @@
 
 #include "xenia/ui/vulkan/vulkan_submission_tracker.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/math.h"
 #include "xenia/ui/vulkan/vulkan_util.h"
 
 namespace xe {
@@ -34,6 +37,9 @@ VulkanSubmissionTracker::FenceAcquisition::~FenceAcquisition() {
           submission_tracker_->submission_current_, fence_);
     }
     submission_tracker_->fence_acquired_ = VK_NULL_HANDLE;
+  } else if (timeline_semaphore_ != VK_NULL_HANDLE && !signal_failed_) {
+    submission_tracker_->timeline_semaphore_signaled_ =
+        submission_tracker_->submission_current_;
   }
   ++submission_tracker_->submission_current_;
 }
@@ -52,6 +58,56 @@ void VulkanSubmissionTracker::Shutdown() {
   fences_pending_.clear();
   assert_true(fence_acquired_ == VK_NULL_HANDLE);
   util::DestroyAndNullHandle(dfn.vkDestroyFence, device, fence_acquired_);
+  util::DestroyAndNullHandle(dfn.vkDestroySemaphore, device,
+                             timeline_semaphore_);
+  timeline_semaphore_creation_attempted_ = false;
+}
+
+VkResult VulkanSubmissionTracker::FenceAcquisition::Submit(
+    VkQueue queue, uint32_t submit_count, const VkSubmitInfo* submits) {
+  assert_not_null(submission_tracker_);
+  const VulkanProvider::DeviceFunctions& dfn =
+      submission_tracker_->provider_.dfn();
+  if (timeline_semaphore_ == VK_NULL_HANDLE) {
+    return dfn.vkQueueSubmit(queue, submit_count, submits, fence_);
+  }
+  // Signal in a separate batch not to modify the pNext chains of the client's
+  // batches - a semaphore signal operation defined by vkQueueSubmit includes
+  // all the commands earlier in submission order in its first synchronization
+  // scope, like a fence signal.
+  uint64_t signal_value = submission_tracker_->submission_current_;
+  VkTimelineSemaphoreSubmitInfo timeline_semaphore_submit_info;
+  timeline_semaphore_submit_info.sType =
+      VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timeline_semaphore_submit_info.pNext = nullptr;
+  timeline_semaphore_submit_info.waitSemaphoreValueCount = 0;
+  timeline_semaphore_submit_info.pWaitSemaphoreValues = nullptr;
+  timeline_semaphore_submit_info.signalSemaphoreValueCount = 1;
+  timeline_semaphore_submit_info.pSignalSemaphoreValues = &signal_value;
+  VkSubmitInfo signal_submit;
+  signal_submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  signal_submit.pNext = &timeline_semaphore_submit_info;
+  signal_submit.waitSemaphoreCount = 0;
+  signal_submit.pWaitSemaphores = nullptr;
+  signal_submit.pWaitDstStageMask = nullptr;
+  signal_submit.commandBufferCount = 0;
+  signal_submit.pCommandBuffers = nullptr;
+  signal_submit.signalSemaphoreCount = 1;
+  signal_submit.pSignalSemaphores = &timeline_semaphore_;
+  if (!submit_count) {
+    return dfn.vkQueueSubmit(queue, 1, &signal_submit, VK_NULL_HANDLE);
+  }
+  if (submit_count == 1) {
+    VkSubmitInfo batches[] = {*submits, signal_submit};
+    return dfn.vkQueueSubmit(queue, uint32_t(xe::countof(batches)), batches,
+                             VK_NULL_HANDLE);
+  }
+  std::vector<VkSubmitInfo> batches;
+  batches.reserve(submit_count + 1);
+  batches.insert(batches.end(), submits, submits + submit_count);
+  batches.push_back(signal_submit);
+  return dfn.vkQueueSubmit(queue, uint32_t(batches.size()), batches.data(),
+                           VK_NULL_HANDLE);
 }
 
 void VulkanSubmissionTracker::FenceAcquisition::SubmissionFailedOrDropped() {
@@ -64,6 +120,7 @@ void VulkanSubmissionTracker::FenceAcquisition::SubmissionFailedOrDropped() {
   }
   submission_tracker_->fence_acquired_ = VK_NULL_HANDLE;
   fence_ = VK_NULL_HANDLE;
+  timeline_semaphore_ = VK_NULL_HANDLE;
   // No submission acquisition from now on, don't increment the current
   // submission index as well.
   submission_tracker_ = VK_NULL_HANDLE;
@@ -85,6 +142,15 @@ uint64_t VulkanSubmissionTracker::UpdateAndGetCompletedSubmission() {
       fences_pending_.pop_front();
     }
   }
+  if (timeline_semaphore_ != VK_NULL_HANDLE) {
+    uint64_t semaphore_value;
+    if (provider_.dfn().vkGetSemaphoreCounterValue(
+            provider_.device(), timeline_semaphore_, &semaphore_value) ==
+        VK_SUCCESS) {
+      submission_completed_on_gpu_ =
+          std::max(submission_completed_on_gpu_, semaphore_value);
+    }
+  }
   return submission_completed_on_gpu_;
 }
 
@@ -106,6 +172,30 @@ bool VulkanSubmissionTracker::AwaitSubmissionCompletion(
   // result in a true race condition, however, but waiting for the closest
   // successful signal is the best approximation - also retrying to signal in
   // this case.
+  if (timeline_semaphore_ != VK_NULL_HANDLE) {
+    // Only the submissions with a successful signal can be awaited, but all
+    // the preceding ones are covered by it.
+    uint64_t await_value =
+        std::min(submission_index, timeline_semaphore_signaled_);
+    if (await_value > UpdateAndGetCompletedSubmission()) {
+      VkSemaphoreWaitInfo semaphore_wait_info;
+      semaphore_wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+      semaphore_wait_info.pNext = nullptr;
+      semaphore_wait_info.flags = 0;
+      semaphore_wait_info.semaphoreCount = 1;
+      semaphore_wait_info.pSemaphores = &timeline_semaphore_;
+      semaphore_wait_info.pValues = &await_value;
+      if (provider_.dfn().vkWaitSemaphores(provider_.device(),
+                                           &semaphore_wait_info,
+                                           UINT64_MAX) == VK_SUCCESS) {
+        submission_completed_on_gpu_ =
+            std::max(submission_completed_on_gpu_, await_value);
+      } else {
+        UpdateAndGetCompletedSubmission();
+      }
+    }
+    return submission_completed_on_gpu_ >= submission_index;
+  }
   // Go from the most recent to wait only for one fence, which includes all the
   // preceding ones.
   // "Fence signal operations that are defined by vkQueueSubmit additionally
@@ -151,6 +241,32 @@ VulkanSubmissionTracker::AcquireFenceToAdvanceSubmission() {
   UpdateAndGetCompletedSubmission();
   const VulkanProvider::DeviceFunctions& dfn = provider_.dfn();
   VkDevice device = provider_.device();
+  if (!timeline_semaphore_creation_attempted_) {
+    timeline_semaphore_creation_attempted_ = true;
+    if (provider_.device_info().timelineSemaphore) {
+      // All the previous submissions have been awaited on shutdown if the
+      // semaphore is recreated.
+      VkSemaphoreTypeCreateInfo semaphore_type_create_info;
+      semaphore_type_create_info.sType =
+          VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+      semaphore_type_create_info.pNext = nullptr;
+      semaphore_type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+      semaphore_type_create_info.initialValue = submission_current_ - 1;
+      VkSemaphoreCreateInfo semaphore_create_info;
+      semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+      semaphore_create_info.pNext = &semaphore_type_create_info;
+      semaphore_create_info.flags = 0;
+      if (dfn.vkCreateSemaphore(device, &semaphore_create_info, nullptr,
+                                &timeline_semaphore_) == VK_SUCCESS) {
+        timeline_semaphore_signaled_ = submission_current_ - 1;
+      } else {
+        timeline_semaphore_ = VK_NULL_HANDLE;
+      }
+    }
+  }
+  if (timeline_semaphore_ != VK_NULL_HANDLE) {
+    return FenceAcquisition(*this, VK_NULL_HANDLE, timeline_semaphore_);
+  }
   if (!fences_reclaimed_.empty()) {
     VkFence reclaimed_fence = fences_reclaimed_.back();
     if (dfn.vkResetFences(device, 1, &reclaimed_fence) == VK_SUCCESS) {
@@ -166,7 +282,7 @@ VulkanSubmissionTracker::AcquireFenceToAdvanceSubmission() {
     // May fail, a null fence is handled in FenceAcquisition.
     dfn.vkCreateFence(device, &fence_create_info, nullptr, &fence_acquired_);
   }
-  return FenceAcquisition(*this, fence_acquired_);
+  return FenceAcquisition(*this, fence_acquired_, VK_NULL_HANDLE);
 }
 
 }  // namespace vulkan
@@ -24,6 +24,11 @@ namespace vulkan {
 // Fence wrapper, safely handling cases when the fence has not been initialized
 // yet or has already been shut down, and failed or dropped submissions.
 //
+// If timeline semaphores are supported, a single timeline semaphore with the
+// submission index as the value is signaled instead of a fence per submission,
+// so the completion can be queried without polling every pending fence, and
+// the submissions can be awaited on the GPU by other queues.
+//
 // The current submission index can be associated with the usage of objects to
 // release them when the GPU isn't potentially referencing them anymore, and
 // should be incremented only
@@ -41,9 +46,15 @@ class VulkanSubmissionTracker {
  public:
   class FenceAcquisition {
    public:
-    FenceAcquisition() : submission_tracker_(nullptr), fence_(VK_NULL_HANDLE) {}
-    FenceAcquisition(VulkanSubmissionTracker& submission_tracker, VkFence fence)
-        : submission_tracker_(&submission_tracker), fence_(fence) {}
+    FenceAcquisition()
+        : submission_tracker_(nullptr),
+          fence_(VK_NULL_HANDLE),
+          timeline_semaphore_(VK_NULL_HANDLE) {}
+    FenceAcquisition(VulkanSubmissionTracker& submission_tracker, VkFence fence,
+                     VkSemaphore timeline_semaphore)
+        : submission_tracker_(&submission_tracker),
+          fence_(fence),
+          timeline_semaphore_(timeline_semaphore) {}
     FenceAcquisition(const FenceAcquisition& fence_acquisition) = delete;
     FenceAcquisition& operator=(const FenceAcquisition& fence_acquisition) =
         delete;
@@ -58,12 +69,27 @@ class VulkanSubmissionTracker {
       fence_acquisition.submission_tracker_ = nullptr;
       fence_ = fence_acquisition.fence_;
       fence_acquisition.fence_ = VK_NULL_HANDLE;
+      timeline_semaphore_ = fence_acquisition.timeline_semaphore_;
+      fence_acquisition.timeline_semaphore_ = VK_NULL_HANDLE;
+      signal_failed_ = fence_acquisition.signal_failed_;
       return *this;
     }
     ~FenceAcquisition();
 
-    // In unsignaled state. May be null if failed to create or to reset a fence.
+    // In unsignaled state. May be null if failed to create or to reset a fence,
+    // or if the timeline semaphore is used instead.
     VkFence fence() { return fence_; }
+    // Whether Submit will signal the completion of the submission, either via
+    // the fence or the timeline semaphore.
+    bool is_signal_available() const {
+      return fence_ != VK_NULL_HANDLE || timeline_semaphore_ != VK_NULL_HANDLE;
+    }
+
+    // vkQueueSubmit with the signal of the submission completion. The signal is
+    // done after all the batches, and the submission may have no batches if
+    // only the signal is needed.
+    VkResult Submit(VkQueue queue, uint32_t submit_count,
+                    const VkSubmitInfo* submits);
 
     // Call if vkQueueSubmit has failed (or it was decided not to commit the
     // submission), and the submission index shouldn't be incremented by
@@ -84,6 +110,7 @@ class VulkanSubmissionTracker {
     // fence from now on.
     VulkanSubmissionTracker* submission_tracker_;
     VkFence fence_;
+    VkSemaphore timeline_semaphore_;
     bool signal_failed_ = false;
   };
 
@@ -126,6 +153,12 @@ class VulkanSubmissionTracker {
   std::deque<std::pair<uint64_t, VkFence>> fences_pending_;
   // Fences are reclaimed when awaiting or when refreshing the completed value.
   std::vector<VkFence> fences_reclaimed_;
+  // If timeline semaphores are supported, replaces the fences (created on the
+  // first acquisition, fences are used if failed to create it).
+  VkSemaphore timeline_semaphore_ = VK_NULL_HANDLE;
+  bool timeline_semaphore_creation_attempted_ = false;
+  // The last submission index with a successful timeline semaphore signal.
+  uint64_t timeline_semaphore_signaled_ = 0;
 };
 
 }  // namespace vulkan
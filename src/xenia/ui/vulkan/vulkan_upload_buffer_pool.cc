@@ -26,9 +26,12 @@ namespace vulkan {
 // try not to waste that padding.
 VulkanUploadBufferPool::VulkanUploadBufferPool(const VulkanProvider& provider,
                                                VkBufferUsageFlags usage,
-                                               size_t page_size)
-    : GraphicsUploadBufferPool(size_t(
-          util::GetMappableMemorySize(provider, VkDeviceSize(page_size)))),
+                                               size_t page_size,
+                                               const char* metrics_name)
+    : GraphicsUploadBufferPool(
+          size_t(
+              util::GetMappableMemorySize(provider, VkDeviceSize(page_size))),
+          metrics_name),
       provider_(provider),
       usage_(usage) {}
 
@@ -21,7 +21,8 @@ class VulkanUploadBufferPool : public GraphicsUploadBufferPool {
  public:
   VulkanUploadBufferPool(const VulkanProvider& provider,
                          VkBufferUsageFlags usage,
-                         size_t page_size = kDefaultPageSize);
+                         size_t page_size = kDefaultPageSize,
+                         const char* metrics_name = nullptr);
 
   uint8_t* Request(uint64_t submission_index, size_t size, size_t alignment,
                    VkBuffer& buffer_out, VkDeviceSize& offset_out);
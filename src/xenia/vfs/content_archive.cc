@@ -0,0 +1,423 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/content_archive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+#include <type_traits>
+
+#include "third_party/zstd/lib/zstd.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/xxhash.h"
+
+namespace xe {
+namespace vfs {
+
+namespace {
+
+constexpr uint32_t kContentArchiveMagic = 0x52414358;  // XCAR
+constexpr uint32_t kContentArchiveVersion = 1;
+constexpr int kContentArchiveZstdLevel = 3;
+
+struct ContentArchiveHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t index_offset;
+  uint64_t index_size;
+  uint64_t index_hash;
+};
+
+class IndexWriter {
+ public:
+  template <typename T>
+  void Write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    size_t offset = data_.size();
+    data_.resize(offset + sizeof(T));
+    std::memcpy(data_.data() + offset, &value, sizeof(T));
+  }
+  void WriteString(const std::string_view value) {
+    Write(uint32_t(value.size()));
+    data_.insert(data_.end(), value.cbegin(), value.cend());
+  }
+
+  const std::vector<uint8_t>& data() const { return data_; }
+
+ private:
+  std::vector<uint8_t> data_;
+};
+
+class IndexReader {
+ public:
+  explicit IndexReader(const std::vector<uint8_t>& data) : data_(data) {}
+
+  template <typename T>
+  bool Read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (data_.size() - position_ < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data_.data() + position_, sizeof(T));
+    position_ += sizeof(T);
+    return true;
+  }
+  bool ReadString(std::string& value) {
+    uint32_t length;
+    if (!Read(length) || data_.size() - position_ < length) {
+      return false;
+    }
+    value.assign(reinterpret_cast<const char*>(data_.data() + position_),
+                 length);
+    position_ += length;
+    return true;
+  }
+
+  bool at_end() const { return position_ == data_.size(); }
+
+ private:
+  const std::vector<uint8_t>& data_;
+  size_t position_ = 0;
+};
+
+bool ReadRecord(IndexReader& reader, size_t chunk_count,
+                const std::vector<ContentArchive::Chunk>& chunks,
+                ContentArchive::Record& record) {
+  uint32_t record_chunk_count;
+  if (!reader.ReadString(record.path) || !reader.Read(record.attributes) ||
+      !reader.Read(record.size) || !reader.Read(record.create_timestamp) ||
+      !reader.Read(record.access_timestamp) ||
+      !reader.Read(record.write_timestamp) ||
+      !reader.Read(record_chunk_count)) {
+    return false;
+  }
+  // All the chunks but the last one must be full for the offsets in the file
+  // to be mapped to the chunks directly.
+  if (record.size != 0 &&
+      record_chunk_count !=
+          (record.size + ContentArchive::kChunkSize - 1) /
+              ContentArchive::kChunkSize) {
+    return false;
+  }
+  if (record.size == 0 && record_chunk_count) {
+    return false;
+  }
+  record.chunks.resize(record_chunk_count);
+  uint64_t remaining_size = record.size;
+  for (uint32_t& chunk_index : record.chunks) {
+    if (!reader.Read(chunk_index) || chunk_index >= chunk_count) {
+      return false;
+    }
+    uint64_t expected_size =
+        std::min(remaining_size, uint64_t(ContentArchive::kChunkSize));
+    if (chunks[chunk_index].size != expected_size) {
+      return false;
+    }
+    remaining_size -= expected_size;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<ContentArchive> ContentArchive::Open(
+    const std::filesystem::path& path) {
+  std::error_code error;
+  uint64_t file_size = std::filesystem::file_size(path, error);
+  if (error) {
+    return nullptr;
+  }
+  auto file = xe::filesystem::FileHandle::OpenExisting(
+      path, xe::filesystem::FileAccess::kGenericRead);
+  if (!file) {
+    return nullptr;
+  }
+
+  ContentArchiveHeader header;
+  size_t bytes_read;
+  if (!file->Read(0, &header, sizeof(header), &bytes_read) ||
+      bytes_read != sizeof(header) || header.magic != kContentArchiveMagic ||
+      header.version != kContentArchiveVersion ||
+      header.index_offset < sizeof(header) ||
+      header.index_offset > file_size ||
+      header.index_size > file_size - header.index_offset) {
+    XELOGE("{} is not a valid content archive", path);
+    return nullptr;
+  }
+  std::vector<uint8_t> index(size_t(header.index_size));
+  if (!file->Read(size_t(header.index_offset), index.data(), index.size(),
+                  &bytes_read) ||
+      bytes_read != index.size() ||
+      XXH3_64bits(index.data(), index.size()) != header.index_hash) {
+    XELOGE("The index of the content archive {} is corrupted", path);
+    return nullptr;
+  }
+
+  auto archive = std::unique_ptr<ContentArchive>(new ContentArchive());
+  IndexReader reader(index);
+  uint32_t chunk_count;
+  bool valid = reader.Read(chunk_count);
+  if (valid) {
+    archive->chunks_.resize(chunk_count);
+  }
+  for (uint32_t i = 0; valid && i < chunk_count; ++i) {
+    Chunk& chunk = archive->chunks_[i];
+    valid = reader.Read(chunk) && chunk.size <= kChunkSize &&
+            chunk.stored_size <= chunk.size &&
+            chunk.offset >= sizeof(header) &&
+            chunk.offset <= header.index_offset &&
+            chunk.stored_size <= header.index_offset - chunk.offset;
+  }
+  uint32_t record_count;
+  valid = valid && reader.Read(record_count);
+  if (valid) {
+    archive->records_.resize(record_count);
+  }
+  for (uint32_t i = 0; valid && i < record_count; ++i) {
+    valid = ReadRecord(reader, chunk_count, archive->chunks_,
+                       archive->records_[i]);
+  }
+  if (!valid || !reader.at_end()) {
+    XELOGE("The index of the content archive {} is invalid", path);
+    return nullptr;
+  }
+
+  archive->path_ = path;
+  archive->file_ = std::move(file);
+  return archive;
+}
+
+bool ContentArchive::ReadChunk(uint32_t chunk_index, void* buffer) const {
+  const Chunk& chunk = chunks_[chunk_index];
+  size_t bytes_read;
+  if (chunk.stored_size == chunk.size) {
+    return file_->Read(size_t(chunk.offset), buffer, chunk.size,
+                       &bytes_read) &&
+           bytes_read == chunk.size;
+  }
+  std::vector<uint8_t> stored_data;
+  if (!ReadStoredChunk(chunk_index, stored_data)) {
+    return false;
+  }
+  size_t decompressed_size = ZSTD_decompress(
+      buffer, chunk.size, stored_data.data(), stored_data.size());
+  if (ZSTD_isError(decompressed_size) || decompressed_size != chunk.size) {
+    XELOGE("Failed to decompress chunk {} of the content archive {}",
+           chunk_index, path_);
+    return false;
+  }
+  return true;
+}
+
+bool ContentArchive::ReadStoredChunk(uint32_t chunk_index,
+                                     std::vector<uint8_t>& buffer) const {
+  const Chunk& chunk = chunks_[chunk_index];
+  buffer.resize(chunk.stored_size);
+  size_t bytes_read;
+  return file_->Read(size_t(chunk.offset), buffer.data(), buffer.size(),
+                     &bytes_read) &&
+         bytes_read == buffer.size();
+}
+
+ContentArchiveWriter::~ContentArchiveWriter() {
+  if (file_) {
+    fclose(file_);
+  }
+  if (!temp_path_.empty()) {
+    std::error_code error;
+    std::filesystem::remove(temp_path_, error);
+  }
+}
+
+bool ContentArchiveWriter::Begin(const std::filesystem::path& path) {
+  assert_null(file_);
+  path_ = path;
+  // Written to a temporary file first to never leave a partial archive.
+  temp_path_ = path;
+  temp_path_ += ".tmp";
+  xe::filesystem::CreateParentFolder(temp_path_);
+  file_ = xe::filesystem::OpenFile(temp_path_, "wb");
+  if (!file_) {
+    temp_path_.clear();
+    return false;
+  }
+  // The header is written once the index is.
+  ContentArchiveHeader header = {};
+  offset_ = 0;
+  return WriteData(&header, sizeof(header));
+}
+
+bool ContentArchiveWriter::AddDirectory(const ContentArchive::Record& record) {
+  auto& new_record = records_.emplace_back(record);
+  new_record.size = 0;
+  new_record.chunks.clear();
+  return true;
+}
+
+bool ContentArchiveWriter::AddFile(const ContentArchive::Record& record,
+                                   const void* data) {
+  ContentArchive::Record new_record = record;
+  new_record.chunks.clear();
+  auto data_bytes = static_cast<const uint8_t*>(data);
+  for (uint64_t offset = 0; offset < record.size;
+       offset += ContentArchive::kChunkSize) {
+    size_t chunk_size = size_t(
+        std::min(record.size - offset, uint64_t(ContentArchive::kChunkSize)));
+    uint32_t chunk_index = AddChunk(data_bytes + offset, chunk_size);
+    if (chunk_index == UINT32_MAX) {
+      return false;
+    }
+    new_record.chunks.push_back(chunk_index);
+  }
+  records_.push_back(std::move(new_record));
+  return true;
+}
+
+bool ContentArchiveWriter::AddArchivedFile(
+    const ContentArchive::Record& record, const ContentArchive& source) {
+  ContentArchive::Record new_record = record;
+  new_record.chunks.clear();
+  std::vector<uint8_t> stored_data;
+  for (uint32_t source_chunk_index : record.chunks) {
+    const ContentArchive::Chunk& chunk = source.chunks()[source_chunk_index];
+    uint32_t chunk_index =
+        FindChunk(chunk.hash_low, chunk.hash_high, chunk.size);
+    if (chunk_index == UINT32_MAX) {
+      if (!source.ReadStoredChunk(source_chunk_index, stored_data)) {
+        return false;
+      }
+      chunk_index = AddStoredChunk(chunk, stored_data);
+      if (chunk_index == UINT32_MAX) {
+        return false;
+      }
+    }
+    new_record.chunks.push_back(chunk_index);
+  }
+  records_.push_back(std::move(new_record));
+  return true;
+}
+
+bool ContentArchiveWriter::Finish() {
+  if (!file_) {
+    return false;
+  }
+  IndexWriter index;
+  index.Write(uint32_t(chunks_.size()));
+  for (const ContentArchive::Chunk& chunk : chunks_) {
+    index.Write(chunk);
+  }
+  index.Write(uint32_t(records_.size()));
+  for (const ContentArchive::Record& record : records_) {
+    index.WriteString(record.path);
+    index.Write(record.attributes);
+    index.Write(record.size);
+    index.Write(record.create_timestamp);
+    index.Write(record.access_timestamp);
+    index.Write(record.write_timestamp);
+    index.Write(uint32_t(record.chunks.size()));
+    for (uint32_t chunk_index : record.chunks) {
+      index.Write(chunk_index);
+    }
+  }
+
+  ContentArchiveHeader header;
+  header.magic = kContentArchiveMagic;
+  header.version = kContentArchiveVersion;
+  header.index_offset = offset_;
+  header.index_size = index.data().size();
+  header.index_hash = XXH3_64bits(index.data().data(), index.data().size());
+  bool written = WriteData(index.data().data(), index.data().size()) &&
+                 xe::filesystem::Seek(file_, 0, SEEK_SET) &&
+                 fwrite(&header, sizeof(header), 1, file_) == 1;
+  written = !fclose(file_) && written;
+  file_ = nullptr;
+  if (!written) {
+    XELOGE("Failed to write the content archive {}", temp_path_);
+  }
+  finished_ = written;
+  return written;
+}
+
+bool ContentArchiveWriter::Commit() {
+  if (!finished_) {
+    return false;
+  }
+  std::error_code error;
+  std::filesystem::rename(temp_path_, path_, error);
+  if (error) {
+    XELOGE("Failed to replace the content archive {}", path_);
+    return false;
+  }
+  temp_path_.clear();
+  return true;
+}
+
+uint32_t ContentArchiveWriter::AddChunk(const void* data, size_t size) {
+  XXH128_hash_t hash = XXH3_128bits(data, size);
+  uint32_t chunk_index = FindChunk(hash.low64, hash.high64, uint32_t(size));
+  if (chunk_index != UINT32_MAX) {
+    return chunk_index;
+  }
+  ContentArchive::Chunk chunk;
+  chunk.size = uint32_t(size);
+  chunk.hash_low = hash.low64;
+  chunk.hash_high = hash.high64;
+  compress_buffer_.resize(ZSTD_compressBound(size));
+  size_t compressed_size =
+      ZSTD_compress(compress_buffer_.data(), compress_buffer_.size(), data,
+                    size, kContentArchiveZstdLevel);
+  if (!ZSTD_isError(compressed_size) && compressed_size < size) {
+    compress_buffer_.resize(compressed_size);
+  } else {
+    // Not compressible, stored as is.
+    compress_buffer_.assign(static_cast<const uint8_t*>(data),
+                            static_cast<const uint8_t*>(data) + size);
+  }
+  chunk.stored_size = uint32_t(compress_buffer_.size());
+  return AddStoredChunk(chunk, compress_buffer_);
+}
+
+uint32_t ContentArchiveWriter::AddStoredChunk(
+    const ContentArchive::Chunk& chunk,
+    const std::vector<uint8_t>& stored_data) {
+  ContentArchive::Chunk new_chunk = chunk;
+  new_chunk.offset = offset_;
+  if (!WriteData(stored_data.data(), stored_data.size())) {
+    return UINT32_MAX;
+  }
+  uint32_t chunk_index = uint32_t(chunks_.size());
+  chunks_.push_back(new_chunk);
+  chunk_indices_.emplace(new_chunk.hash_low, chunk_index);
+  return chunk_index;
+}
+
+uint32_t ContentArchiveWriter::FindChunk(uint64_t hash_low, uint64_t hash_high,
+                                         uint32_t size) const {
+  auto range = chunk_indices_.equal_range(hash_low);
+  for (auto it = range.first; it != range.second; ++it) {
+    const ContentArchive::Chunk& chunk = chunks_[it->second];
+    if (chunk.hash_high == hash_high && chunk.size == size) {
+      return it->second;
+    }
+  }
+  return UINT32_MAX;
+}
+
+bool ContentArchiveWriter::WriteData(const void* data, size_t size) {
+  if (!file_ || (size && fwrite(data, 1, size, file_) != size)) {
+    return false;
+  }
+  offset_ += size;
+  return true;
+}
+
+}  // namespace vfs
+}  // namespace xe
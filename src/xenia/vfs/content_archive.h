@@ -0,0 +1,137 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_CONTENT_ARCHIVE_H_
+#define XENIA_VFS_CONTENT_ARCHIVE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "xenia/base/filesystem.h"
+
+namespace xe {
+namespace vfs {
+
+// Content package stored as a single host file. The data of the files is split
+// into chunks of a fixed size, compressed with zstd, and every distinct chunk
+// is stored once however many times it appears in the files. The chunks are
+// followed by the index of the entries, which lists the chunks of each file,
+// so any part of a file can be read by decompressing only the chunks it spans.
+class ContentArchive {
+ public:
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  struct Chunk {
+    uint64_t offset;
+    // Equal to the size if the chunk is stored uncompressed.
+    uint32_t stored_size;
+    uint32_t size;
+    uint64_t hash_low;
+    uint64_t hash_high;
+  };
+
+  struct Record {
+    // Relative to the root of the package, with \ separators. Directories are
+    // listed before their children.
+    std::string path;
+    uint32_t attributes;
+    uint64_t size;
+    uint64_t create_timestamp;
+    uint64_t access_timestamp;
+    uint64_t write_timestamp;
+    // Indices in chunks(), all of kChunkSize bytes except the last one.
+    std::vector<uint32_t> chunks;
+  };
+
+  // Returns nullptr if the file is not a valid archive.
+  static std::unique_ptr<ContentArchive> Open(
+      const std::filesystem::path& path);
+
+  const std::filesystem::path& path() const { return path_; }
+  const std::vector<Chunk>& chunks() const { return chunks_; }
+  const std::vector<Record>& records() const { return records_; }
+
+  // Decompresses the chunk into the buffer, which must be large enough for its
+  // size. May be called from multiple threads.
+  bool ReadChunk(uint32_t chunk_index, void* buffer) const;
+  // Reads the chunk as it's stored, to copy it to another archive.
+  bool ReadStoredChunk(uint32_t chunk_index,
+                       std::vector<uint8_t>& buffer) const;
+
+ private:
+  ContentArchive() = default;
+
+  std::filesystem::path path_;
+  std::unique_ptr<xe::filesystem::FileHandle> file_;
+  std::vector<Chunk> chunks_;
+  std::vector<Record> records_;
+};
+
+// Writes a new archive to a temporary file, which replaces the file at the path
+// only once it's complete and committed.
+class ContentArchiveWriter {
+ public:
+  ContentArchiveWriter() = default;
+  ContentArchiveWriter(const ContentArchiveWriter&) = delete;
+  ContentArchiveWriter& operator=(const ContentArchiveWriter&) = delete;
+  // Removes the temporary file if the archive hasn't been committed.
+  ~ContentArchiveWriter();
+
+  bool Begin(const std::filesystem::path& path);
+
+  // The chunks of the record are ignored, and replaced by the ones the data is
+  // stored in.
+  bool AddDirectory(const ContentArchive::Record& record);
+  bool AddFile(const ContentArchive::Record& record, const void* data);
+  // Copies the chunks of a file from another archive without recompressing
+  // them.
+  bool AddArchivedFile(const ContentArchive::Record& record,
+                       const ContentArchive& source);
+
+  // Writes the index and closes the temporary file.
+  bool Finish();
+  // Replaces the file at the path with the finished archive. On Windows, the
+  // file must not be open.
+  bool Commit();
+
+  // With the chunks they have been stored in, in the order they were added.
+  const std::vector<ContentArchive::Record>& records() const {
+    return records_;
+  }
+
+ private:
+  // Returns UINT32_MAX on failure.
+  uint32_t AddChunk(const void* data, size_t size);
+  uint32_t AddStoredChunk(const ContentArchive::Chunk& chunk,
+                          const std::vector<uint8_t>& stored_data);
+  uint32_t FindChunk(uint64_t hash_low, uint64_t hash_high,
+                     uint32_t size) const;
+  bool WriteData(const void* data, size_t size);
+
+  std::filesystem::path path_;
+  std::filesystem::path temp_path_;
+  FILE* file_ = nullptr;
+  uint64_t offset_ = 0;
+  bool finished_ = false;
+  std::vector<ContentArchive::Chunk> chunks_;
+  std::vector<ContentArchive::Record> records_;
+  // Keyed by the low half of the hash.
+  std::unordered_multimap<uint64_t, uint32_t> chunk_indices_;
+  std::vector<uint8_t> compress_buffer_;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_CONTENT_ARCHIVE_H_
@@ -10,6 +10,7 @@
 #include "xenia/vfs/device.h"
 
 #include "xenia/base/logging.h"
+#include "xenia/base/utf8.h"
 
 namespace xe {
 namespace vfs {
@@ -17,5 +18,38 @@ namespace vfs {
 Device::Device(const std::string_view mount_path) : mount_path_(mount_path) {}
 Device::~Device() = default;
 
+void Device::BuildPathIndex(Entry* root_entry) {
+  path_index_.clear();
+  AddToPathIndex(root_entry, std::string());
+}
+
+Entry* Device::LookUpPathIndex(const std::string_view path) const {
+  auto it = path_index_.find(GetPathIndexKey(path));
+  return it != path_index_.cend() ? it->second : nullptr;
+}
+
+std::string Device::GetPathIndexKey(const std::string_view path) {
+  // Same as the components Entry::ResolvePath walks, compared the same way as
+  // in Entry::GetChild.
+  std::string key;
+  for (const std::string_view part : xe::utf8::split_path(path)) {
+    if (!key.empty()) {
+      key.push_back('\\');
+    }
+    key += xe::utf8::lower_ascii(part);
+  }
+  return key;
+}
+
+void Device::AddToPathIndex(Entry* entry, const std::string& key) {
+  // With duplicate names, the first child is found, like in Entry::GetChild.
+  path_index_.emplace(key, entry);
+  for (const auto& child : entry->children()) {
+    std::string child_key = xe::utf8::lower_ascii(child->name());
+    AddToPathIndex(child.get(),
+                   key.empty() ? child_key : key + '\\' + child_key);
+  }
+}
+
 }  // namespace vfs
 }  // namespace xe
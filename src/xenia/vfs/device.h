@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "xenia/base/mutex.h"
 #include "xenia/base/string_buffer.h"
@@ -31,6 +32,9 @@ class Device {
   virtual bool is_read_only() const { return true; }
 
   virtual void Dump(StringBuffer* string_buffer) = 0;
+  // Guards the entry trees of the device, held by the entries when accessing
+  // their children.
+  xe::subsystem_critical_region& critical_region() { return critical_region_; }
   virtual Entry* ResolvePath(const std::string_view path) = 0;
 
   virtual const std::string& name() const = 0;
@@ -43,8 +47,22 @@ class Device {
   virtual uint32_t bytes_per_sector() const = 0;
 
  protected:
-  xe::global_critical_region global_critical_region_;
+  // Indexes all the entries under the root by their full paths, for devices
+  // whose entry tree never changes after initialization. Must be called at
+  // the end of initialization, lookups are then lock-free.
+  void BuildPathIndex(Entry* root_entry);
+  // Case-insensitive, returns nullptr if the path is not in the index.
+  Entry* LookUpPathIndex(const std::string_view path) const;
+
+  xe::subsystem_critical_region critical_region_;
   std::string mount_path_;
+
+ private:
+  static std::string GetPathIndexKey(const std::string_view path);
+  void AddToPathIndex(Entry* entry, const std::string& key);
+
+  // Keyed by the path components lowercased and joined with \.
+  std::unordered_map<std::string, Entry*> path_index_;
 };
 
 }  // namespace vfs
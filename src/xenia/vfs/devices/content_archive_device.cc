@@ -0,0 +1,166 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/devices/content_archive_device.h"
+
+#include <mutex>
+
+#include "xenia/base/logging.h"
+#include "xenia/base/math.h"
+#include "xenia/base/string.h"
+#include "xenia/vfs/devices/content_archive_entry.h"
+
+namespace xe {
+namespace vfs {
+
+ContentArchiveDevice::ContentArchiveDevice(
+    const std::string_view mount_path,
+    const std::filesystem::path& archive_path)
+    : Device(mount_path), name_("STFS"), archive_path_(archive_path) {}
+
+ContentArchiveDevice::~ContentArchiveDevice() {
+  if (root_entry_) {
+    Flush();
+  }
+}
+
+bool ContentArchiveDevice::Initialize() {
+  auto root_entry = std::make_unique<ContentArchiveEntry>(this, nullptr, "");
+  root_entry->attributes_ = kFileAttributeDirectory;
+  root_entry->data_loaded_ = true;
+
+  if (!std::filesystem::exists(archive_path_)) {
+    // New package, written right away for it to exist from now on.
+    root_entry_ = std::move(root_entry);
+    dirty_ = true;
+    return Flush();
+  }
+
+  std::shared_ptr<ContentArchive> archive =
+      ContentArchive::Open(archive_path_);
+  if (!archive) {
+    return false;
+  }
+  for (const ContentArchive::Record& record : archive->records()) {
+    auto parent = static_cast<ContentArchiveEntry*>(root_entry->ResolvePath(
+        xe::utf8::find_base_guest_path(record.path)));
+    if (!parent || !(parent->attributes() & kFileAttributeDirectory)) {
+      XELOGE("Content archive {} has no parent directory for {}",
+             archive_path_, record.path);
+      return false;
+    }
+    auto entry = ContentArchiveEntry::Create(
+        this, parent, xe::utf8::find_name_from_guest_path(record.path),
+        record.attributes);
+    entry->create_timestamp_ = record.create_timestamp;
+    entry->access_timestamp_ = record.access_timestamp;
+    entry->write_timestamp_ = record.write_timestamp;
+    if (!(record.attributes & kFileAttributeDirectory)) {
+      entry->size_ = size_t(record.size);
+      entry->allocation_size_ =
+          xe::round_up(entry->size_, size_t(bytes_per_sector()));
+      entry->SetArchivedData(archive, record.chunks);
+    }
+    parent->children_.push_back(std::move(entry));
+  }
+  root_entry_ = std::move(root_entry);
+  return true;
+}
+
+void ContentArchiveDevice::Dump(StringBuffer* string_buffer) {
+  auto lock = critical_region_.Acquire();
+  root_entry_->Dump(string_buffer, 0);
+}
+
+Entry* ContentArchiveDevice::ResolvePath(const std::string_view path) {
+  // The filesystem will have stripped our prefix off already, so the path will
+  // be in the form:
+  // some\PATH.foo
+  XELOGFS("ContentArchiveDevice::ResolvePath({})", path);
+  return root_entry_->ResolvePath(path);
+}
+
+bool ContentArchiveDevice::Flush() {
+  auto lock = critical_region_.Acquire();
+  if (!dirty_.exchange(false)) {
+    return true;
+  }
+
+  std::vector<std::pair<ContentArchiveEntry*, std::string>> entries;
+  CollectEntries(root_entry_.get(), "", entries);
+  // The data of the files must not change until they refer to the new archive.
+  std::vector<std::unique_lock<std::mutex>> data_locks;
+  data_locks.reserve(entries.size());
+  for (const auto& [entry, path] : entries) {
+    data_locks.emplace_back(entry->data_mutex_);
+  }
+
+  ContentArchiveWriter writer;
+  bool written = writer.Begin(archive_path_);
+  for (const auto& [entry, path] : entries) {
+    if (!written) {
+      break;
+    }
+    ContentArchive::Record record = entry->GetRecord(path);
+    if (entry->attributes() & kFileAttributeDirectory) {
+      written = writer.AddDirectory(record);
+    } else if (entry->data_loaded_) {
+      written = writer.AddFile(record, entry->data_.data());
+    } else {
+      written = writer.AddArchivedFile(record, *entry->archive_);
+    }
+  }
+  written = written && writer.Finish();
+  if (!written) {
+    dirty_ = true;
+    return false;
+  }
+
+  // The archive being replaced is closed first, as required on Windows.
+  for (const auto& [entry, path] : entries) {
+    entry->archive_.reset();
+  }
+  bool committed = writer.Commit();
+  // Either the new archive or the previous one if it couldn't be replaced.
+  std::shared_ptr<ContentArchive> archive =
+      ContentArchive::Open(archive_path_);
+  if (committed && archive) {
+    const auto& records = writer.records();
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (!(entries[i].first->attributes() & kFileAttributeDirectory)) {
+        entries[i].first->SetArchivedData(archive, records[i].chunks);
+      }
+    }
+    return true;
+  }
+  XELOGE("Failed to replace the content archive {}", archive_path_);
+  for (const auto& [entry, path] : entries) {
+    if (!entry->data_loaded_) {
+      entry->archive_ = archive;
+    }
+  }
+  dirty_ = true;
+  return false;
+}
+
+void ContentArchiveDevice::CollectEntries(
+    Entry* parent_entry, const std::string& parent_path,
+    std::vector<std::pair<ContentArchiveEntry*, std::string>>& entries) {
+  for (const auto& child : parent_entry->children()) {
+    auto entry = static_cast<ContentArchiveEntry*>(child.get());
+    std::string path = xe::utf8::join_guest_paths(parent_path, entry->name());
+    entries.emplace_back(entry, path);
+    if (entry->attributes() & kFileAttributeDirectory) {
+      CollectEntries(entry, path, entries);
+    }
+  }
+}
+
+}  // namespace vfs
+}  // namespace xe
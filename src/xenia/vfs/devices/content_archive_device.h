@@ -0,0 +1,78 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_DEVICES_CONTENT_ARCHIVE_DEVICE_H_
+#define XENIA_VFS_DEVICES_CONTENT_ARCHIVE_DEVICE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xenia/vfs/content_archive.h"
+#include "xenia/vfs/device.h"
+
+namespace xe {
+namespace vfs {
+
+class ContentArchiveEntry;
+
+// Writable content package stored in a ContentArchive. The files are read from
+// the archive until they are written to, when they are loaded in memory, and
+// the archive is written again with the changes by Flush, reusing the stored
+// chunks of the unchanged files.
+class ContentArchiveDevice : public Device {
+ public:
+  ContentArchiveDevice(const std::string_view mount_path,
+                       const std::filesystem::path& archive_path);
+  // Flushes the changes.
+  ~ContentArchiveDevice() override;
+
+  // Creates an empty archive if there's none at the path.
+  bool Initialize() override;
+  void Dump(StringBuffer* string_buffer) override;
+  Entry* ResolvePath(const std::string_view path) override;
+
+  bool is_read_only() const override { return false; }
+
+  const std::string& name() const override { return name_; }
+  uint32_t attributes() const override { return 0; }
+  uint32_t component_name_max_length() const override { return 255; }
+
+  uint32_t total_allocation_units() const override { return 128 * 1024; }
+  uint32_t available_allocation_units() const override { return 128 * 1024; }
+  uint32_t sectors_per_allocation_unit() const override { return 1; }
+  uint32_t bytes_per_sector() const override { return 0x200; }
+
+  const std::filesystem::path& archive_path() const { return archive_path_; }
+
+  // Writes the archive again if anything has changed since the last time.
+  bool Flush();
+
+ private:
+  friend class ContentArchiveEntry;
+
+  void MarkDirty() { dirty_ = true; }
+
+  // Lists the entries under the parent with their paths, parents first.
+  static void CollectEntries(
+      Entry* parent_entry, const std::string& parent_path,
+      std::vector<std::pair<ContentArchiveEntry*, std::string>>& entries);
+
+  std::string name_;
+  std::filesystem::path archive_path_;
+  std::unique_ptr<Entry> root_entry_;
+  std::atomic<bool> dirty_ = false;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_DEVICES_CONTENT_ARCHIVE_DEVICE_H_
@@ -0,0 +1,228 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/devices/content_archive_entry.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/math.h"
+#include "xenia/base/string.h"
+#include "xenia/vfs/devices/content_archive_device.h"
+#include "xenia/vfs/devices/content_archive_file.h"
+
+namespace xe {
+namespace vfs {
+
+ContentArchiveEntry::ContentArchiveEntry(Device* device, Entry* parent,
+                                         const std::string_view path)
+    : Entry(device, parent, path) {}
+
+ContentArchiveEntry::~ContentArchiveEntry() = default;
+
+std::unique_ptr<ContentArchiveEntry> ContentArchiveEntry::Create(
+    Device* device, Entry* parent, const std::string_view name,
+    uint32_t attributes) {
+  auto path = xe::utf8::join_guest_paths(parent->path(), name);
+  auto entry = std::make_unique<ContentArchiveEntry>(device, parent, path);
+  entry->attributes_ = attributes;
+  entry->data_loaded_ = true;
+  return entry;
+}
+
+X_STATUS ContentArchiveEntry::Open(uint32_t desired_access, File** out_file) {
+  *out_file = new ContentArchiveFile(desired_access, this);
+  return X_STATUS_SUCCESS;
+}
+
+bool ContentArchiveEntry::SetAttributes(uint64_t attributes) {
+  // Only the attributes that can be set on host files.
+  attributes_ = (attributes_ & ~uint32_t(kFileAttributeReadOnly)) |
+                (uint32_t(attributes) & kFileAttributeReadOnly);
+  archive_device()->MarkDirty();
+  return true;
+}
+
+bool ContentArchiveEntry::SetCreateTimestamp(uint64_t timestamp) {
+  create_timestamp_ = timestamp;
+  archive_device()->MarkDirty();
+  return true;
+}
+
+bool ContentArchiveEntry::SetAccessTimestamp(uint64_t timestamp) {
+  access_timestamp_ = timestamp;
+  archive_device()->MarkDirty();
+  return true;
+}
+
+bool ContentArchiveEntry::SetWriteTimestamp(uint64_t timestamp) {
+  write_timestamp_ = timestamp;
+  archive_device()->MarkDirty();
+  return true;
+}
+
+X_STATUS ContentArchiveEntry::ReadData(void* buffer, size_t buffer_length,
+                                       size_t byte_offset,
+                                       size_t* out_bytes_read) {
+  std::lock_guard<std::mutex> lock(data_mutex_);
+  if (byte_offset >= size_) {
+    return X_STATUS_END_OF_FILE;
+  }
+  size_t length = std::min(buffer_length, size_ - byte_offset);
+  auto buffer_bytes = static_cast<uint8_t*>(buffer);
+  if (data_loaded_) {
+    std::memcpy(buffer_bytes, data_.data() + byte_offset, length);
+    *out_bytes_read = length;
+    return X_STATUS_SUCCESS;
+  }
+  if (!archive_) {
+    return X_STATUS_UNSUCCESSFUL;
+  }
+  size_t offset = byte_offset;
+  size_t end = byte_offset + length;
+  while (offset < end) {
+    uint32_t chunk_index = chunks_[offset / ContentArchive::kChunkSize];
+    size_t chunk_offset = offset % ContentArchive::kChunkSize;
+    size_t chunk_size = archive_->chunks()[chunk_index].size;
+    size_t copy_length = std::min(chunk_size - chunk_offset, end - offset);
+    uint8_t* dest = buffer_bytes + (offset - byte_offset);
+    if (copy_length == chunk_size) {
+      // Whole chunk, decompressed directly into the buffer.
+      if (!archive_->ReadChunk(chunk_index, dest)) {
+        return X_STATUS_UNSUCCESSFUL;
+      }
+    } else {
+      if (cached_chunk_index_ != chunk_index) {
+        cached_chunk_.resize(chunk_size);
+        cached_chunk_index_ = UINT32_MAX;
+        if (!archive_->ReadChunk(chunk_index, cached_chunk_.data())) {
+          return X_STATUS_UNSUCCESSFUL;
+        }
+        cached_chunk_index_ = chunk_index;
+      }
+      std::memcpy(dest, cached_chunk_.data() + chunk_offset, copy_length);
+    }
+    offset += copy_length;
+  }
+  *out_bytes_read = length;
+  return X_STATUS_SUCCESS;
+}
+
+X_STATUS ContentArchiveEntry::WriteData(const void* buffer,
+                                        size_t buffer_length,
+                                        size_t byte_offset,
+                                        size_t* out_bytes_written) {
+  std::lock_guard<std::mutex> lock(data_mutex_);
+  if (!LoadData()) {
+    return X_STATUS_UNSUCCESSFUL;
+  }
+  if (byte_offset + buffer_length > data_.size()) {
+    data_.resize(byte_offset + buffer_length);
+  }
+  std::memcpy(data_.data() + byte_offset, buffer, buffer_length);
+  *out_bytes_written = buffer_length;
+  OnDataWritten();
+  return X_STATUS_SUCCESS;
+}
+
+X_STATUS ContentArchiveEntry::SetDataLength(size_t length) {
+  std::lock_guard<std::mutex> lock(data_mutex_);
+  if (!LoadData()) {
+    return X_STATUS_UNSUCCESSFUL;
+  }
+  data_.resize(length);
+  OnDataWritten();
+  return X_STATUS_SUCCESS;
+}
+
+std::unique_ptr<Entry> ContentArchiveEntry::CreateEntryInternal(
+    const std::string_view name, uint32_t attributes) {
+  auto entry = Create(device_, this, name,
+                      (attributes & kFileAttributeDirectory)
+                          ? uint32_t(kFileAttributeDirectory)
+                          : uint32_t(kFileAttributeNormal));
+  uint64_t timestamp = Clock::QueryHostSystemTime();
+  entry->create_timestamp_ = timestamp;
+  entry->access_timestamp_ = timestamp;
+  entry->write_timestamp_ = timestamp;
+  archive_device()->MarkDirty();
+  return entry;
+}
+
+bool ContentArchiveEntry::DeleteEntryInternal(Entry* entry) {
+  archive_device()->MarkDirty();
+  return true;
+}
+
+void ContentArchiveEntry::RenameEntryInternal(
+    const std::filesystem::path file_path) {
+  archive_device()->MarkDirty();
+}
+
+ContentArchiveDevice* ContentArchiveEntry::archive_device() const {
+  return static_cast<ContentArchiveDevice*>(device_);
+}
+
+ContentArchive::Record ContentArchiveEntry::GetRecord(
+    const std::string_view path) const {
+  ContentArchive::Record record;
+  record.path = path;
+  record.attributes = attributes_;
+  record.size = size_;
+  record.create_timestamp = create_timestamp_;
+  record.access_timestamp = access_timestamp_;
+  record.write_timestamp = write_timestamp_;
+  record.chunks = chunks_;
+  return record;
+}
+
+void ContentArchiveEntry::SetArchivedData(
+    std::shared_ptr<ContentArchive> archive,
+    const std::vector<uint32_t>& chunks) {
+  archive_ = std::move(archive);
+  chunks_ = chunks;
+  data_loaded_ = false;
+  data_.clear();
+  data_.shrink_to_fit();
+  cached_chunk_index_ = UINT32_MAX;
+}
+
+bool ContentArchiveEntry::LoadData() {
+  if (data_loaded_) {
+    return true;
+  }
+  if (!archive_) {
+    return false;
+  }
+  data_.resize(size_);
+  size_t offset = 0;
+  for (uint32_t chunk_index : chunks_) {
+    if (!archive_->ReadChunk(chunk_index, data_.data() + offset)) {
+      data_.clear();
+      return false;
+    }
+    offset += archive_->chunks()[chunk_index].size;
+  }
+  archive_.reset();
+  chunks_.clear();
+  data_loaded_ = true;
+  cached_chunk_index_ = UINT32_MAX;
+  return true;
+}
+
+void ContentArchiveEntry::OnDataWritten() {
+  size_ = data_.size();
+  allocation_size_ = xe::round_up(size_, device_->bytes_per_sector());
+  write_timestamp_ = Clock::QueryHostSystemTime();
+  archive_device()->MarkDirty();
+}
+
+}  // namespace vfs
+}  // namespace xe
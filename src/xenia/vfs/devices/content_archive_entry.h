@@ -0,0 +1,81 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_DEVICES_CONTENT_ARCHIVE_ENTRY_H_
+#define XENIA_VFS_DEVICES_CONTENT_ARCHIVE_ENTRY_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xenia/vfs/content_archive.h"
+#include "xenia/vfs/entry.h"
+
+namespace xe {
+namespace vfs {
+
+class ContentArchiveDevice;
+
+class ContentArchiveEntry : public Entry {
+ public:
+  ContentArchiveEntry(Device* device, Entry* parent,
+                      const std::string_view path);
+  ~ContentArchiveEntry() override;
+
+  static std::unique_ptr<ContentArchiveEntry> Create(
+      Device* device, Entry* parent, const std::string_view name,
+      uint32_t attributes);
+
+  X_STATUS Open(uint32_t desired_access, File** out_file) override;
+
+  bool SetAttributes(uint64_t attributes) override;
+  bool SetCreateTimestamp(uint64_t timestamp) override;
+  bool SetAccessTimestamp(uint64_t timestamp) override;
+  bool SetWriteTimestamp(uint64_t timestamp) override;
+
+  X_STATUS ReadData(void* buffer, size_t buffer_length, size_t byte_offset,
+                    size_t* out_bytes_read);
+  X_STATUS WriteData(const void* buffer, size_t buffer_length,
+                     size_t byte_offset, size_t* out_bytes_written);
+  X_STATUS SetDataLength(size_t length);
+
+ private:
+  friend class ContentArchiveDevice;
+
+  std::unique_ptr<Entry> CreateEntryInternal(const std::string_view name,
+                                             uint32_t attributes) override;
+  bool DeleteEntryInternal(Entry* entry) override;
+  void RenameEntryInternal(const std::filesystem::path file_path) override;
+
+  ContentArchiveDevice* archive_device() const;
+  ContentArchive::Record GetRecord(const std::string_view path) const;
+  // Must be called with the data mutex locked.
+  void SetArchivedData(std::shared_ptr<ContentArchive> archive,
+                       const std::vector<uint32_t>& chunks);
+  // Loads the data from the archive, to modify it. Must be called with the
+  // data mutex locked.
+  bool LoadData();
+  void OnDataWritten();
+
+  std::mutex data_mutex_;
+  // The chunks in the archive, until the data is loaded.
+  std::shared_ptr<ContentArchive> archive_;
+  std::vector<uint32_t> chunks_;
+  bool data_loaded_ = false;
+  std::vector<uint8_t> data_;
+  // The last chunk partially read, as reads are usually sequential.
+  uint32_t cached_chunk_index_ = UINT32_MAX;
+  std::vector<uint8_t> cached_chunk_;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_DEVICES_CONTENT_ARCHIVE_ENTRY_H_
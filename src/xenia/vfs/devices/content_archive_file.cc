@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/devices/content_archive_file.h"
+
+#include "xenia/vfs/devices/content_archive_device.h"
+#include "xenia/vfs/devices/content_archive_entry.h"
+
+namespace xe {
+namespace vfs {
+
+ContentArchiveFile::ContentArchiveFile(uint32_t file_access,
+                                       ContentArchiveEntry* entry)
+    : File(file_access, entry) {}
+
+ContentArchiveFile::~ContentArchiveFile() = default;
+
+void ContentArchiveFile::Destroy() {
+  auto device = static_cast<ContentArchiveDevice*>(entry_->device());
+  if (entry_->delete_on_close()) {
+    entry()->Delete();
+  }
+  device->Flush();
+  delete this;
+}
+
+X_STATUS ContentArchiveFile::ReadSync(void* buffer, size_t buffer_length,
+                                      size_t byte_offset,
+                                      size_t* out_bytes_read) {
+  if (!(file_access_ &
+        (FileAccess::kGenericRead | FileAccess::kFileReadData))) {
+    return X_STATUS_ACCESS_DENIED;
+  }
+  return static_cast<ContentArchiveEntry*>(entry_)->ReadData(
+      buffer, buffer_length, byte_offset, out_bytes_read);
+}
+
+X_STATUS ContentArchiveFile::WriteSync(const void* buffer,
+                                       size_t buffer_length,
+                                       size_t byte_offset,
+                                       size_t* out_bytes_written) {
+  if (!(file_access_ & (FileAccess::kGenericWrite | FileAccess::kFileWriteData |
+                        FileAccess::kFileAppendData))) {
+    return X_STATUS_ACCESS_DENIED;
+  }
+  return static_cast<ContentArchiveEntry*>(entry_)->WriteData(
+      buffer, buffer_length, byte_offset, out_bytes_written);
+}
+
+X_STATUS ContentArchiveFile::SetLength(size_t length) {
+  if (!(file_access_ &
+        (FileAccess::kGenericWrite | FileAccess::kFileWriteData))) {
+    return X_STATUS_ACCESS_DENIED;
+  }
+  return static_cast<ContentArchiveEntry*>(entry_)->SetDataLength(length);
+}
+
+}  // namespace vfs
+}  // namespace xe
@@ -0,0 +1,38 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_DEVICES_CONTENT_ARCHIVE_FILE_H_
+#define XENIA_VFS_DEVICES_CONTENT_ARCHIVE_FILE_H_
+
+#include "xenia/vfs/file.h"
+
+namespace xe {
+namespace vfs {
+
+class ContentArchiveEntry;
+
+class ContentArchiveFile : public File {
+ public:
+  ContentArchiveFile(uint32_t file_access, ContentArchiveEntry* entry);
+  ~ContentArchiveFile() override;
+
+  // Flushes the changes to the archive.
+  void Destroy() override;
+
+  X_STATUS ReadSync(void* buffer, size_t buffer_length, size_t byte_offset,
+                    size_t* out_bytes_read) override;
+  X_STATUS WriteSync(const void* buffer, size_t buffer_length,
+                     size_t byte_offset, size_t* out_bytes_written) override;
+  X_STATUS SetLength(size_t length) override;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_DEVICES_CONTENT_ARCHIVE_FILE_H_
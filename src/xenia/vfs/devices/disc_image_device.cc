@@ -9,10 +9,13 @@
 
 #include "xenia/vfs/devices/disc_image_device.h"
 
+#include <algorithm>
+
 #include "xenia/base/literals.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/vfs/devices/disc_image_entry.h"
+#include "xenia/vfs/metadata_snapshot.h"
 
 namespace xe {
 namespace vfs {
@@ -46,17 +49,32 @@ bool DiscImageDevice::Initialize() {
     return false;
   }
 
-  result = ReadAllEntries(&state, state.ptr + state.root_offset);
-  if (result != Error::kSuccess) {
-    XELOGE("Failed to read all GDFX entries: {}", static_cast<int32_t>(result));
-    return false;
+  // The volume descriptor, with the location of the root directory.
+  size_t volume_descriptor_offset = state.game_offset + (32 * kXESectorSize);
+  const uint8_t* volume_descriptor = state.ptr + volume_descriptor_offset;
+  size_t volume_descriptor_size =
+      std::min(kXESectorSize, state.size - volume_descriptor_offset);
+
+  if (!LoadMetadataSnapshot(volume_descriptor, volume_descriptor_size)) {
+    result = ReadAllEntries(&state, state.ptr + state.root_offset);
+    if (result != Error::kSuccess) {
+      XELOGE("Failed to read all GDFX entries: {}",
+             static_cast<int32_t>(result));
+      return false;
+    }
+    MetadataSnapshotWriter snapshot_writer;
+    static_cast<const DiscImageEntry*>(root_entry_.get())
+        ->WriteSnapshot(snapshot_writer);
+    snapshot_writer.Save(host_path_, volume_descriptor,
+                         volume_descriptor_size);
   }
 
+  BuildPathIndex(root_entry_.get());
   return true;
 }
 
 void DiscImageDevice::Dump(StringBuffer* string_buffer) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   root_entry_->Dump(string_buffer, 0);
 }
 
@@ -65,7 +83,26 @@ Entry* DiscImageDevice::ResolvePath(const std::string_view path) {
   // be in the form:
   // some\PATH.foo
   XELOGFS("DiscImageDevice::ResolvePath({})", path);
-  return root_entry_->ResolvePath(path);
+  return LookUpPathIndex(path);
+}
+
+bool DiscImageDevice::LoadMetadataSnapshot(const void* volume_descriptor,
+                                           size_t volume_descriptor_size) {
+  MetadataSnapshotReader snapshot_reader;
+  if (!snapshot_reader.Load(host_path_, volume_descriptor,
+                            volume_descriptor_size)) {
+    return false;
+  }
+  auto root_entry =
+      std::make_unique<DiscImageEntry>(this, nullptr, "", mmap_.get());
+  if (!root_entry->ReadSnapshot(snapshot_reader) ||
+      !snapshot_reader.at_end()) {
+    XELOGW("Discarding the invalid metadata snapshot of {}", host_path_);
+    return false;
+  }
+  root_entry_ = std::move(root_entry);
+  XELOGI("Loaded the GDFX entries from the metadata snapshot");
+  return true;
 }
 
 DiscImageDevice::Error DiscImageDevice::Verify(ParseState* state) {
@@ -68,6 +68,9 @@ class DiscImageDevice : public Device {
     size_t root_size;    // Size (bytes) of root.
   } ParseState;
 
+  // Returns false if there's no up-to-date snapshot for the image.
+  bool LoadMetadataSnapshot(const void* volume_descriptor,
+                            size_t volume_descriptor_size);
   Error Verify(ParseState* state);
   bool VerifyMagic(ParseState* state, size_t offset);
   Error ReadAllEntries(ParseState* state, const uint8_t* root_buffer);
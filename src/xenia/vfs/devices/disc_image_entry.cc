@@ -13,6 +13,7 @@
 
 #include "xenia/base/math.h"
 #include "xenia/vfs/devices/disc_image_file.h"
+#include "xenia/vfs/metadata_snapshot.h"
 
 namespace xe {
 namespace vfs {
@@ -51,5 +52,39 @@ std::unique_ptr<MappedMemory> DiscImageEntry::OpenMapped(
   return mmap_->Slice(real_offset, real_length);
 }
 
+void DiscImageEntry::WriteSnapshot(MetadataSnapshotWriter& writer) const {
+  WriteSnapshotMetadata(writer);
+  writer.Write(uint64_t(data_offset_));
+  writer.Write(uint64_t(data_size_));
+  writer.Write(uint32_t(children_.size()));
+  for (const auto& child : children_) {
+    writer.WriteString(child->name());
+    static_cast<const DiscImageEntry*>(child.get())->WriteSnapshot(writer);
+  }
+}
+
+bool DiscImageEntry::ReadSnapshot(MetadataSnapshotReader& reader) {
+  uint64_t data_offset, data_size;
+  uint32_t child_count;
+  if (!ReadSnapshotMetadata(reader) || !reader.Read(data_offset) ||
+      !reader.Read(data_size) || !reader.Read(child_count)) {
+    return false;
+  }
+  data_offset_ = size_t(data_offset);
+  data_size_ = size_t(data_size);
+  for (uint32_t i = 0; i < child_count; ++i) {
+    std::string name;
+    if (!reader.ReadString(name)) {
+      return false;
+    }
+    auto child = Create(device_, this, name, mmap_);
+    if (!child->ReadSnapshot(reader)) {
+      return false;
+    }
+    children_.emplace_back(std::move(child));
+  }
+  return true;
+}
+
 }  // namespace vfs
 }  // namespace xe
@@ -37,6 +37,10 @@ class DiscImageEntry : public Entry {
 
   X_STATUS Open(uint32_t desired_access, File** out_file) override;
 
+  // The entry with all its descendants.
+  void WriteSnapshot(MetadataSnapshotWriter& writer) const;
+  bool ReadSnapshot(MetadataSnapshotReader& reader);
+
   bool can_map() const override { return true; }
   std::unique_ptr<MappedMemory> OpenMapped(MappedMemory::Mode mode,
                                            size_t offset,
@@ -43,30 +43,50 @@ bool DiscZarchiveDevice::Initialize() {
   root_entry->absolute_path_ = root_path;
   root_entry_ = std::unique_ptr<Entry>(root_entry);
 
-  return ReadAllEntries("", root_entry, nullptr);
+  if (!ReadAllEntries("", root_entry, nullptr)) {
+    return false;
+  }
+  BuildPathIndex(root_entry);
+  return true;
 }
 
 void DiscZarchiveDevice::Dump(StringBuffer* string_buffer) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   root_entry_->Dump(string_buffer, 0);
 }
 
+std::unique_ptr<ZArchiveReader> DiscZarchiveDevice::AcquireReader() {
+  {
+    std::lock_guard<std::mutex> lock(idle_readers_mutex_);
+    if (!idle_readers_.empty()) {
+      std::unique_ptr<ZArchiveReader> reader = std::move(idle_readers_.back());
+      idle_readers_.pop_back();
+      return reader;
+    }
+  }
+  std::unique_ptr<ZArchiveReader> reader(
+      ZArchiveReader::OpenFromFile(host_path_));
+  if (!reader) {
+    XELOGE("Disc ZArchive could not be opened for reading");
+  }
+  return reader;
+}
+
+void DiscZarchiveDevice::ReleaseReader(std::unique_ptr<ZArchiveReader> reader) {
+  std::lock_guard<std::mutex> lock(idle_readers_mutex_);
+  // Every reader keeps its own cache of decompressed blocks, don't keep more
+  // of them than there are usually concurrent reads.
+  if (idle_readers_.size() < kMaxIdleReaderCount) {
+    idle_readers_.push_back(std::move(reader));
+  }
+}
+
 Entry* DiscZarchiveDevice::ResolvePath(const std::string_view path) {
   // The filesystem will have stripped our prefix off already, so the path will
   // be in the form:
   // some\PATH.foo
   XELOGFS("DiscZarchiveDevice::ResolvePath({})", path);
-
-  if (!reader_) {
-    return nullptr;
-  }
-
-  const ZArchiveNodeHandle handle = reader_->LookUp(path);
-  if (handle == ZARCHIVE_INVALID_NODE) {
-    return nullptr;
-  }
-
-  return root_entry_->ResolvePath(path);
+  return LookUpPathIndex(path);
 }
 
 bool DiscZarchiveDevice::ReadAllEntries(const std::string& path,
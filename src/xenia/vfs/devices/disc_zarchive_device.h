@@ -11,7 +11,9 @@
 #define XENIA_VFS_DEVICES_DISC_ZARCHIVE_DEVICE_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "xenia/base/mapped_memory.h"
 #include "xenia/vfs/device.h"
@@ -47,8 +49,17 @@ class DiscZarchiveDevice : public Device {
   uint32_t sectors_per_allocation_unit() const override { return 1; }
   uint32_t bytes_per_sector() const override { return 0x200; }
 
+  // For the metadata, not for reading file data, which must go through
+  // AcquireReader.
   ZArchiveReader* reader() const { return reader_.get(); }
 
+  // A ZArchiveReader serializes all reads internally, so each concurrent read
+  // of file data uses a reader of its own, opened for the same archive (with
+  // the same node handles), and released for reuse when done. Returns nullptr
+  // if the archive couldn't be opened again.
+  std::unique_ptr<ZArchiveReader> AcquireReader();
+  void ReleaseReader(std::unique_ptr<ZArchiveReader> reader);
+
  private:
   bool ReadAllEntries(const std::string& path, DiscZarchiveEntry* node,
                       DiscZarchiveEntry* parent);
@@ -57,6 +68,10 @@ class DiscZarchiveDevice : public Device {
   std::filesystem::path host_path_;
   std::unique_ptr<Entry> root_entry_;
   std::unique_ptr<ZArchiveReader> reader_;
+
+  static constexpr size_t kMaxIdleReaderCount = 8;
+  std::mutex idle_readers_mutex_;
+  std::vector<std::unique_ptr<ZArchiveReader>> idle_readers_;
 };
 
 }  // namespace vfs
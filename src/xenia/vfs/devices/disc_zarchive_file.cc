@@ -10,7 +10,9 @@
 #include "xenia/vfs/devices/disc_zarchive_file.h"
 
 #include <algorithm>
+#include <memory>
 
+#include "xenia/base/task_scheduler.h"
 #include "xenia/vfs/devices/disc_zarchive_device.h"
 #include "xenia/vfs/devices/disc_zarchive_entry.h"
 
@@ -31,15 +33,63 @@ X_STATUS DiscZarchiveFile::ReadSync(void* buffer, size_t buffer_length,
   if (byte_offset >= entry_->size()) {
     return X_STATUS_END_OF_FILE;
   }
-  const uint64_t bytes_read =
-      ((DiscZarchiveDevice*)entry_->device_)
-          ->reader()
-          ->ReadFromFile(entry_->handle_, byte_offset, buffer_length, buffer);
   const size_t real_length =
       std::min(buffer_length, entry_->data_size() - byte_offset);
+
+  // Each part of the read decompresses its blocks in a task and with a reader
+  // of its own, so reads spanning many blocks are split into parts of whole
+  // blocks.
+  constexpr size_t kBlockSize = _ZARCHIVE::COMPRESSED_BLOCK_SIZE;
+  const size_t first_block = byte_offset / kBlockSize;
+  const size_t block_count =
+      (byte_offset + real_length + kBlockSize - 1) / kBlockSize - first_block;
+  const size_t part_count =
+      std::clamp(block_count / kParallelReadMinBlocksPerPart, size_t(1),
+                 kParallelReadMaxPartCount);
+  const size_t blocks_per_part = (block_count + part_count - 1) / part_count;
+  auto read_part = [&](size_t part) {
+    size_t part_start = std::max(
+        byte_offset, (first_block + part * blocks_per_part) * kBlockSize);
+    size_t part_end =
+        std::min(byte_offset + real_length,
+                 (first_block + (part + 1) * blocks_per_part) * kBlockSize);
+    if (part_start >= part_end) {
+      return true;
+    }
+    return ReadPart(static_cast<uint8_t*>(buffer) + (part_start - byte_offset),
+                    part_start, part_end - part_start);
+  };
+  bool succeeded = true;
+  if (part_count > 1) {
+    std::unique_ptr<bool[]> parts_succeeded(new bool[part_count]);
+    xe::threading::TaskScheduler::Get().ParallelFor(
+        uint32_t(part_count),
+        [&](uint32_t part) { parts_succeeded[part] = read_part(part); });
+    for (size_t i = 0; i < part_count; ++i) {
+      succeeded &= parts_succeeded[i];
+    }
+  } else {
+    succeeded = read_part(0);
+  }
+  if (!succeeded) {
+    return X_STATUS_UNSUCCESSFUL;
+  }
   *out_bytes_read = real_length;
   return X_STATUS_SUCCESS;
 }
 
+bool DiscZarchiveFile::ReadPart(void* buffer, size_t byte_offset,
+                                size_t length) {
+  auto device = static_cast<DiscZarchiveDevice*>(entry_->device_);
+  std::unique_ptr<ZArchiveReader> reader = device->AcquireReader();
+  if (!reader) {
+    return false;
+  }
+  const uint64_t bytes_read =
+      reader->ReadFromFile(entry_->handle_, byte_offset, length, buffer);
+  device->ReleaseReader(std::move(reader));
+  return bytes_read == length;
+}
+
 }  // namespace vfs
 }  // namespace xe
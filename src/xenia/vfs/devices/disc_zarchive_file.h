@@ -32,7 +32,17 @@ class DiscZarchiveFile : public File {
   }
   X_STATUS SetLength(size_t length) override { return X_STATUS_ACCESS_DENIED; }
 
+  // Reads decompress whole blocks.
+  bool use_read_cache() const override { return true; }
+
  private:
+  // Reads spanning at least twice this many compressed blocks are split into
+  // parts read in parallel.
+  static constexpr size_t kParallelReadMinBlocksPerPart = 2;
+  static constexpr size_t kParallelReadMaxPartCount = 4;
+
+  bool ReadPart(void* buffer, size_t byte_offset, size_t length);
+
   DiscZarchiveEntry* entry_;
 };
 
@@ -71,6 +71,9 @@ X_STATUS HostPathEntry::Open(uint32_t desired_access, File** out_file) {
 std::unique_ptr<MappedMemory> HostPathEntry::OpenMapped(MappedMemory::Mode mode,
                                                         size_t offset,
                                                         size_t length) {
+  if (mode != MappedMemory::Mode::kRead) {
+    InvalidateInfo();
+  }
   return MappedMemory::Open(host_path_, mode, offset, length);
 }
 
@@ -121,6 +124,9 @@ void HostPathEntry::RenameEntryInternal(const std::filesystem::path file_path) {
 }
 
 void HostPathEntry::update() {
+  if (!info_stale_.exchange(false, std::memory_order_relaxed)) {
+    return;
+  }
   auto file_info = xe::filesystem::GetInfo(host_path_);
   if (!file_info) {
     return;
@@ -10,6 +10,7 @@
 #ifndef XENIA_VFS_DEVICES_HOST_PATH_ENTRY_H_
 #define XENIA_VFS_DEVICES_HOST_PATH_ENTRY_H_
 
+#include <atomic>
 #include <string>
 
 #include "xenia/base/filesystem.h"
@@ -38,7 +39,10 @@ class HostPathEntry : public Entry {
   std::unique_ptr<MappedMemory> OpenMapped(MappedMemory::Mode mode,
                                            size_t offset,
                                            size_t length) override;
+  // Only queries the host if the file may have changed since the last time,
+  // which is when it has been written through a file of the entry.
   void update() override;
+  void InvalidateInfo() { info_stale_ = true; }
 
   bool SetAttributes(uint64_t attributes) override;
   bool SetCreateTimestamp(uint64_t timestamp) override;
@@ -54,6 +58,7 @@ class HostPathEntry : public Entry {
   void RenameEntryInternal(const std::filesystem::path file_path) override;
 
   std::filesystem::path host_path_;
+  std::atomic<bool> info_stale_ = false;
 };
 
 }  // namespace vfs
@@ -52,6 +52,7 @@ X_STATUS HostPathFile::WriteSync(const void* buffer, size_t buffer_length,
 
   if (file_handle_->Write(byte_offset, buffer, buffer_length,
                           out_bytes_written)) {
+    static_cast<HostPathEntry*>(entry_)->InvalidateInfo();
     return X_STATUS_SUCCESS;
   } else {
     return X_STATUS_END_OF_FILE;
@@ -65,6 +66,7 @@ X_STATUS HostPathFile::SetLength(size_t length) {
   }
 
   if (file_handle_->SetLength(length)) {
+    static_cast<HostPathEntry*>(entry_)->InvalidateInfo();
     return X_STATUS_SUCCESS;
   } else {
     return X_STATUS_END_OF_FILE;
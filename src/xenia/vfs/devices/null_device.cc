@@ -38,7 +38,7 @@ bool NullDevice::Initialize() {
 }
 
 void NullDevice::Dump(StringBuffer* string_buffer) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   root_entry_->Dump(string_buffer, 0);
 }
 
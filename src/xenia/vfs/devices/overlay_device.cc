@@ -0,0 +1,96 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/devices/overlay_device.h"
+
+#include <unordered_map>
+
+#include "xenia/base/logging.h"
+#include "xenia/base/utf8.h"
+#include "xenia/vfs/devices/overlay_entry.h"
+
+namespace xe {
+namespace vfs {
+
+OverlayDevice::OverlayDevice(const std::string_view mount_path,
+                             std::vector<std::unique_ptr<Device>> layers)
+    : Device(mount_path), layers_(std::move(layers)) {}
+
+OverlayDevice::~OverlayDevice() = default;
+
+bool OverlayDevice::Initialize() {
+  if (layers_.empty()) {
+    return false;
+  }
+  std::vector<Entry*> layer_roots;
+  for (auto& layer : layers_) {
+    Entry* layer_root = nullptr;
+    if (layer->Initialize()) {
+      layer_root = layer->ResolvePath("");
+    }
+    if (!layer_root) {
+      XELOGE("Failed to initialize an overlay layer");
+      return false;
+    }
+    layer_roots.push_back(layer_root);
+  }
+
+  auto root_entry =
+      std::make_unique<OverlayEntry>(this, nullptr, "", layer_roots.back());
+  for (Entry* layer_root : layer_roots) {
+    MergeChildren(root_entry.get(), layer_root);
+  }
+  root_entry_ = std::move(root_entry);
+  BuildPathIndex(root_entry_.get());
+  return true;
+}
+
+void OverlayDevice::Dump(StringBuffer* string_buffer) {
+  auto lock = critical_region_.Acquire();
+  root_entry_->Dump(string_buffer, 0);
+}
+
+Entry* OverlayDevice::ResolvePath(const std::string_view path) {
+  // The filesystem will have stripped our prefix off already, so the path will
+  // be in the form:
+  // some\PATH.foo
+  XELOGFS("OverlayDevice::ResolvePath({})", path);
+  return LookUpPathIndex(path);
+}
+
+void OverlayDevice::MergeChildren(OverlayEntry* overlay_entry,
+                                  Entry* layer_entry) {
+  // Compared the same way as in Entry::GetChild.
+  std::unordered_map<std::string, OverlayEntry*> children;
+  for (const auto& child : overlay_entry->children_) {
+    children.emplace(xe::utf8::lower_ascii(child->name()),
+                     static_cast<OverlayEntry*>(child.get()));
+  }
+  for (const auto& layer_child : layer_entry->children()) {
+    bool is_directory = layer_child->attributes() & kFileAttributeDirectory;
+    auto it = children.find(xe::utf8::lower_ascii(layer_child->name()));
+    if (it != children.end()) {
+      // Hidden by an upper layer, unless both are directories.
+      if (is_directory &&
+          (it->second->attributes() & kFileAttributeDirectory)) {
+        MergeChildren(it->second, layer_child.get());
+      }
+      continue;
+    }
+    auto child = OverlayEntry::Create(this, overlay_entry, layer_child->name(),
+                                      layer_child.get());
+    if (is_directory) {
+      MergeChildren(child.get(), layer_child.get());
+    }
+    overlay_entry->children_.emplace_back(std::move(child));
+  }
+}
+
+}  // namespace vfs
+}  // namespace xe
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_DEVICES_OVERLAY_DEVICE_H_
+#define XENIA_VFS_DEVICES_OVERLAY_DEVICE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xenia/vfs/device.h"
+
+namespace xe {
+namespace vfs {
+
+class OverlayEntry;
+
+// Read-only union of the entries of multiple devices, in which the entries of
+// each layer hide the files with the same paths in the layers below it, and
+// the directories are merged. The union is built once at initialization, so
+// paths resolve with a single lookup regardless of the number of layers.
+class OverlayDevice : public Device {
+ public:
+  // The layers are initialized by Initialize, from the top one.
+  OverlayDevice(const std::string_view mount_path,
+                std::vector<std::unique_ptr<Device>> layers);
+  ~OverlayDevice() override;
+
+  bool Initialize() override;
+  void Dump(StringBuffer* string_buffer) override;
+  Entry* ResolvePath(const std::string_view path) override;
+
+  // The volume information is the one of the bottom layer, usually the title.
+  const std::string& name() const override { return base_layer()->name(); }
+  uint32_t attributes() const override { return base_layer()->attributes(); }
+  uint32_t component_name_max_length() const override {
+    return base_layer()->component_name_max_length();
+  }
+
+  uint32_t total_allocation_units() const override {
+    return base_layer()->total_allocation_units();
+  }
+  uint32_t available_allocation_units() const override { return 0; }
+  uint32_t sectors_per_allocation_unit() const override {
+    return base_layer()->sectors_per_allocation_unit();
+  }
+  uint32_t bytes_per_sector() const override {
+    return base_layer()->bytes_per_sector();
+  }
+
+ private:
+  Device* base_layer() const { return layers_.back().get(); }
+
+  // Adds the children of the layer entry not hidden by the upper layers.
+  void MergeChildren(OverlayEntry* overlay_entry, Entry* layer_entry);
+
+  // From the top one.
+  std::vector<std::unique_ptr<Device>> layers_;
+  // Destroyed before the layers whose entries it refers to.
+  std::unique_ptr<Entry> root_entry_;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_DEVICES_OVERLAY_DEVICE_H_
@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/devices/overlay_entry.h"
+
+#include "xenia/base/logging.h"
+#include "xenia/base/string.h"
+#include "xenia/vfs/devices/overlay_file.h"
+
+namespace xe {
+namespace vfs {
+
+OverlayEntry::OverlayEntry(Device* device, Entry* parent,
+                           const std::string_view path, Entry* layer_entry)
+    : Entry(device, parent, path), layer_entry_(layer_entry) {
+  attributes_ = layer_entry->attributes() | kFileAttributeReadOnly;
+  size_ = layer_entry->size();
+  allocation_size_ = layer_entry->allocation_size();
+  create_timestamp_ = layer_entry->create_timestamp();
+  access_timestamp_ = layer_entry->access_timestamp();
+  write_timestamp_ = layer_entry->write_timestamp();
+}
+
+OverlayEntry::~OverlayEntry() = default;
+
+std::unique_ptr<OverlayEntry> OverlayEntry::Create(Device* device,
+                                                   Entry* parent,
+                                                   const std::string_view name,
+                                                   Entry* layer_entry) {
+  auto path = xe::utf8::join_guest_paths(parent->path(), name);
+  return std::make_unique<OverlayEntry>(device, parent, path, layer_entry);
+}
+
+X_STATUS OverlayEntry::Open(uint32_t desired_access, File** out_file) {
+  if (desired_access &
+      (FileAccess::kFileWriteData | FileAccess::kFileAppendData)) {
+    XELOGE("Attempting to open file for write access on read-only device");
+    return X_STATUS_ACCESS_DENIED;
+  }
+  File* layer_file = nullptr;
+  X_STATUS result = layer_entry_->Open(desired_access, &layer_file);
+  if (XFAILED(result)) {
+    return result;
+  }
+  *out_file = new OverlayFile(desired_access, this, layer_file);
+  return X_STATUS_SUCCESS;
+}
+
+std::unique_ptr<MappedMemory> OverlayEntry::OpenMapped(MappedMemory::Mode mode,
+                                                       size_t offset,
+                                                       size_t length) {
+  if (mode != MappedMemory::Mode::kRead) {
+    return nullptr;
+  }
+  return layer_entry_->OpenMapped(mode, offset, length);
+}
+
+}  // namespace vfs
+}  // namespace xe
@@ -0,0 +1,52 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_DEVICES_OVERLAY_ENTRY_H_
+#define XENIA_VFS_DEVICES_OVERLAY_ENTRY_H_
+
+#include <memory>
+#include <string>
+
+#include "xenia/vfs/entry.h"
+
+namespace xe {
+namespace vfs {
+
+class OverlayDevice;
+
+class OverlayEntry : public Entry {
+ public:
+  OverlayEntry(Device* device, Entry* parent, const std::string_view path,
+               Entry* layer_entry);
+  ~OverlayEntry() override;
+
+  static std::unique_ptr<OverlayEntry> Create(Device* device, Entry* parent,
+                                              const std::string_view name,
+                                              Entry* layer_entry);
+
+  // The entry of the topmost layer containing the path.
+  Entry* layer_entry() const { return layer_entry_; }
+
+  X_STATUS Open(uint32_t desired_access, File** out_file) override;
+
+  bool can_map() const override { return layer_entry_->can_map(); }
+  std::unique_ptr<MappedMemory> OpenMapped(MappedMemory::Mode mode,
+                                           size_t offset,
+                                           size_t length) override;
+
+ private:
+  friend class OverlayDevice;
+
+  Entry* layer_entry_;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_DEVICES_OVERLAY_ENTRY_H_
@@ -0,0 +1,35 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/devices/overlay_file.h"
+
+#include "xenia/vfs/devices/overlay_entry.h"
+
+namespace xe {
+namespace vfs {
+
+OverlayFile::OverlayFile(uint32_t file_access, OverlayEntry* entry,
+                         File* layer_file)
+    : File(file_access, entry), layer_file_(layer_file) {}
+
+OverlayFile::~OverlayFile() = default;
+
+void OverlayFile::Destroy() {
+  layer_file_->Destroy();
+  delete this;
+}
+
+X_STATUS OverlayFile::ReadSync(void* buffer, size_t buffer_length,
+                               size_t byte_offset, size_t* out_bytes_read) {
+  return layer_file_->ReadSync(buffer, buffer_length, byte_offset,
+                               out_bytes_read);
+}
+
+}  // namespace vfs
+}  // namespace xe
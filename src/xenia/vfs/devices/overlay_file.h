@@ -0,0 +1,49 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_DEVICES_OVERLAY_FILE_H_
+#define XENIA_VFS_DEVICES_OVERLAY_FILE_H_
+
+#include "xenia/vfs/file.h"
+
+namespace xe {
+namespace vfs {
+
+class OverlayEntry;
+
+// Reads the file of the layer, keeping the overlay entry as the entry of the
+// file, so caches keyed by the entries belong to the overlay device.
+class OverlayFile : public File {
+ public:
+  // Takes the ownership of the file of the layer.
+  OverlayFile(uint32_t file_access, OverlayEntry* entry, File* layer_file);
+  ~OverlayFile() override;
+
+  void Destroy() override;
+
+  X_STATUS ReadSync(void* buffer, size_t buffer_length, size_t byte_offset,
+                    size_t* out_bytes_read) override;
+  X_STATUS WriteSync(const void* buffer, size_t buffer_length,
+                     size_t byte_offset, size_t* out_bytes_written) override {
+    return X_STATUS_ACCESS_DENIED;
+  }
+  X_STATUS SetLength(size_t length) override { return X_STATUS_ACCESS_DENIED; }
+
+  bool use_read_cache() const override {
+    return layer_file_->use_read_cache();
+  }
+
+ private:
+  File* layer_file_;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_DEVICES_OVERLAY_FILE_H_
@@ -9,8 +9,10 @@
 
 #include "xenia/vfs/devices/xcontent_container_device.h"
 #include "xenia/base/logging.h"
+#include "xenia/vfs/devices/xcontent_container_entry.h"
 #include "xenia/vfs/devices/xcontent_devices/stfs_container_device.h"
 #include "xenia/vfs/devices/xcontent_devices/svod_container_device.h"
+#include "xenia/vfs/metadata_snapshot.h"
 
 namespace xe {
 namespace vfs {
@@ -104,7 +106,37 @@ bool XContentContainerDevice::Initialize() {
     return false;
   }
 
-  return Read() == Result::kSuccess;
+  if (!LoadMetadataSnapshot()) {
+    if (Read() != Result::kSuccess) {
+      return false;
+    }
+    MetadataSnapshotWriter snapshot_writer;
+    static_cast<const XContentContainerEntry*>(root_entry_.get())
+        ->WriteSnapshot(snapshot_writer);
+    snapshot_writer.Save(host_path_, header_.get(),
+                         sizeof(XContentContainerHeader));
+  }
+  BuildPathIndex(root_entry_.get());
+  return true;
+}
+
+bool XContentContainerDevice::LoadMetadataSnapshot() {
+  // The header has the hashes of the tables of the package.
+  MetadataSnapshotReader snapshot_reader;
+  if (!snapshot_reader.Load(host_path_, header_.get(),
+                            sizeof(XContentContainerHeader))) {
+    return false;
+  }
+  auto root_entry =
+      std::make_unique<XContentContainerEntry>(this, nullptr, "", &files_);
+  if (!root_entry->ReadSnapshot(snapshot_reader) ||
+      !snapshot_reader.at_end()) {
+    XELOGW("Discarding the invalid metadata snapshot of {}", host_path_);
+    return false;
+  }
+  root_entry_ = std::move(root_entry);
+  XELOGI("Loaded the XContent entries from the metadata snapshot");
+  return true;
 }
 
 XContentContainerHeader* XContentContainerDevice::ReadContainerHeader(
@@ -122,19 +154,33 @@ Entry* XContentContainerDevice::ResolvePath(const std::string_view path) {
   // be in the form:
   // some\PATH.foo
   XELOGFS("StfsContainerDevice::ResolvePath({})", path);
-  return root_entry_->ResolvePath(path);
+  return LookUpPathIndex(path);
 }
 
 void XContentContainerDevice::Dump(StringBuffer* string_buffer) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   root_entry_->Dump(string_buffer, 0);
 }
 
+bool XContentContainerDevice::AddHostFile(size_t file_index, FILE* file,
+                                          const std::filesystem::path& path) {
+  files_.emplace(file_index, file);
+  auto read_handle = xe::filesystem::FileHandle::OpenExisting(
+      path, xe::filesystem::FileAccess::kFileReadData);
+  if (!read_handle) {
+    XELOGE("Failed to open XContent file {} for reading.", path);
+    return false;
+  }
+  read_handles_.emplace(file_index, std::move(read_handle));
+  return true;
+}
+
 void XContentContainerDevice::CloseFiles() {
   for (auto& file : files_) {
     fclose(file.second);
   }
   files_.clear();
+  read_handles_.clear();
   files_total_size_ = 0;
 }
 
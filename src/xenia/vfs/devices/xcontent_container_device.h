@@ -55,6 +55,13 @@ class XContentContainerDevice : public Device {
 
   uint64_t xuid() const { return header_->content_metadata.profile_id; }
 
+  // For the positional reads of the file data, which, unlike the FILE
+  // handles, can be done from multiple threads at once.
+  xe::filesystem::FileHandle* GetReadHandle(size_t file_index) const {
+    auto it = read_handles_.find(file_index);
+    return it != read_handles_.end() ? it->second.get() : nullptr;
+  }
+
   uint32_t title_id() const {
     return header_->content_metadata.execution_info.title_id;
   }
@@ -87,6 +94,8 @@ class XContentContainerDevice : public Device {
   };
 
   virtual Result Read() = 0;
+  // Returns false if there's no up-to-date snapshot for the package.
+  bool LoadMetadataSnapshot();
   // Load all host files. Usually STFS is only 1 file, meanwhile SVOD is usually
   // multiple file.
   virtual Result LoadHostFiles(FILE* header_file) = 0;
@@ -94,6 +103,10 @@ class XContentContainerDevice : public Device {
   virtual void SetupContainer() {};
 
   Entry* ResolvePath(const std::string_view path) override;
+  // Takes the ownership of the file, which is used for parsing the container,
+  // and opens the file again for reading the data of the entries.
+  bool AddHostFile(size_t file_index, FILE* file,
+                   const std::filesystem::path& path);
   void CloseFiles();
   void Dump(StringBuffer* string_buffer) override;
   Result ReadHeaderAndVerify(FILE* header_file);
@@ -114,6 +127,7 @@ class XContentContainerDevice : public Device {
   std::filesystem::path host_path_;
 
   std::map<size_t, FILE*> files_;
+  std::map<size_t, std::unique_ptr<xe::filesystem::FileHandle>> read_handles_;
   size_t files_total_size_;
   std::unique_ptr<Entry> root_entry_;
   std::unique_ptr<XContentContainerHeader> header_;
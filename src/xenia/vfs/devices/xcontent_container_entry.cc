@@ -9,7 +9,9 @@
 
 #include "xenia/vfs/devices/xcontent_container_entry.h"
 #include "xenia/vfs/devices/xcontent_container_file.h"
+#include "xenia/vfs/metadata_snapshot.h"
 
+#include <algorithm>
 #include <map>
 
 namespace xe {
@@ -42,5 +44,88 @@ X_STATUS XContentContainerEntry::Open(uint32_t desired_access,
   return X_STATUS_SUCCESS;
 }
 
+void XContentContainerEntry::AppendBlock(size_t file, size_t offset,
+                                         size_t length) {
+  if (!block_list_.empty()) {
+    BlockRecord& last_record = block_list_.back();
+    if (last_record.file == file &&
+        last_record.offset + last_record.length == offset) {
+      last_record.length += length;
+      return;
+    }
+  }
+  size_t entry_offset = 0;
+  if (!block_list_.empty()) {
+    entry_offset = block_list_.back().entry_offset + block_list_.back().length;
+  }
+  block_list_.push_back({file, offset, length, entry_offset});
+}
+
+const XContentContainerEntry::BlockRecord&
+XContentContainerEntry::FindBlockRecord(size_t entry_offset) const {
+  auto it = std::upper_bound(block_list_.cbegin(), block_list_.cend(),
+                             entry_offset,
+                             [](size_t offset, const BlockRecord& record) {
+                               return offset < record.entry_offset;
+                             });
+  return *std::prev(it);
+}
+
+void XContentContainerEntry::WriteSnapshot(
+    MetadataSnapshotWriter& writer) const {
+  WriteSnapshotMetadata(writer);
+  writer.Write(uint64_t(data_offset_));
+  writer.Write(uint64_t(data_size_));
+  writer.Write(uint64_t(block_));
+  writer.Write(uint32_t(block_list_.size()));
+  for (const BlockRecord& record : block_list_) {
+    writer.Write(uint64_t(record.file));
+    writer.Write(uint64_t(record.offset));
+    writer.Write(uint64_t(record.length));
+  }
+  writer.Write(uint32_t(children_.size()));
+  for (const auto& child : children_) {
+    writer.WriteString(child->name());
+    static_cast<const XContentContainerEntry*>(child.get())
+        ->WriteSnapshot(writer);
+  }
+}
+
+bool XContentContainerEntry::ReadSnapshot(MetadataSnapshotReader& reader) {
+  uint64_t data_offset, data_size, block;
+  uint32_t block_record_count;
+  if (!ReadSnapshotMetadata(reader) || !reader.Read(data_offset) ||
+      !reader.Read(data_size) || !reader.Read(block) ||
+      !reader.Read(block_record_count)) {
+    return false;
+  }
+  data_offset_ = size_t(data_offset);
+  data_size_ = size_t(data_size);
+  block_ = size_t(block);
+  for (uint32_t i = 0; i < block_record_count; ++i) {
+    uint64_t file, offset, length;
+    if (!reader.Read(file) || !reader.Read(offset) || !reader.Read(length)) {
+      return false;
+    }
+    AppendBlock(size_t(file), size_t(offset), size_t(length));
+  }
+  uint32_t child_count;
+  if (!reader.Read(child_count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < child_count; ++i) {
+    std::string name;
+    if (!reader.ReadString(name)) {
+      return false;
+    }
+    auto child = Create(device_, this, name, files_);
+    if (!child->ReadSnapshot(reader)) {
+      return false;
+    }
+    children_.emplace_back(std::move(child));
+  }
+  return true;
+}
+
 }  // namespace vfs
 }  // namespace xe
\ No newline at end of file
@@ -40,17 +40,31 @@ class XContentContainerEntry : public Entry {
 
   X_STATUS Open(uint32_t desired_access, File** out_file) override;
 
+  // Physically contiguous runs of the blocks of the entry data.
   struct BlockRecord {
     size_t file;
     size_t offset;
     size_t length;
+    // Offset within the entry data, for binary searching.
+    size_t entry_offset;
   };
   const std::vector<BlockRecord>& block_list() const { return block_list_; }
+  // Returns the record containing the offset within the entry data, which must
+  // be below the total length of the records.
+  const BlockRecord& FindBlockRecord(size_t entry_offset) const;
+
+  // The entry with all its descendants.
+  void WriteSnapshot(MetadataSnapshotWriter& writer) const;
+  bool ReadSnapshot(MetadataSnapshotReader& reader);
 
  private:
   friend class StfsContainerDevice;
   friend class SvodContainerDevice;
 
+  // Appends the block to the data, merging it with the last record if it's
+  // physically after it.
+  void AppendBlock(size_t file, size_t offset, size_t length);
+
   MultiFileHandles* files_;
   size_t data_offset_;
   size_t data_size_;
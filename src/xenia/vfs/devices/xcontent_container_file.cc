@@ -10,7 +10,9 @@
 #include <algorithm>
 #include <cmath>
 
+#include "xenia/base/filesystem.h"
 #include "xenia/base/math.h"
+#include "xenia/vfs/devices/xcontent_container_device.h"
 #include "xenia/vfs/devices/xcontent_container_entry.h"
 #include "xenia/vfs/devices/xcontent_container_file.h"
 
@@ -32,36 +34,40 @@ X_STATUS XContentContainerFile::ReadSync(void* buffer, size_t buffer_length,
     return X_STATUS_END_OF_FILE;
   }
 
-  size_t src_offset = 0;
-  uint8_t* p = reinterpret_cast<uint8_t*>(buffer);
-  size_t remaining_length =
-      std::min(buffer_length, entry_->size() - byte_offset);
-
+  const auto& block_list = entry_->block_list();
+  size_t data_length = 0;
+  if (!block_list.empty()) {
+    data_length = block_list.back().entry_offset + block_list.back().length;
+  }
   *out_bytes_read = 0;
-  for (size_t i = 0; i < entry_->block_list().size(); i++) {
-    auto& record = entry_->block_list()[i];
-    if (src_offset + record.length <= byte_offset) {
-      // Doesn't begin in this region. Skip it.
-      src_offset += record.length;
-      continue;
-    }
-
-    size_t read_offset =
-        (byte_offset > src_offset) ? byte_offset - src_offset : 0;
-    size_t read_length =
-        std::min(record.length - read_offset, remaining_length);
-
-    auto& file = entry_->files()->at(record.file);
-    xe::filesystem::Seek(file, record.offset + read_offset, SEEK_SET);
-    auto num_read = fread(p, 1, read_length, file);
+  if (byte_offset >= data_length) {
+    // The block chain is shorter than the entry size.
+    return X_STATUS_SUCCESS;
+  }
 
+  auto device = static_cast<XContentContainerDevice*>(entry_->device());
+  uint8_t* p = reinterpret_cast<uint8_t*>(buffer);
+  size_t remaining_length = std::min(
+      std::min(buffer_length, entry_->size() - byte_offset),
+      data_length - byte_offset);
+  // Positional reads of whole physically contiguous runs of blocks, without
+  // seeking, so concurrent reads don't interfere with each other.
+  auto record = &entry_->FindBlockRecord(byte_offset);
+  size_t read_offset = byte_offset - record->entry_offset;
+  while (remaining_length) {
+    size_t read_length = std::min(record->length - read_offset,
+                                  remaining_length);
+    xe::filesystem::FileHandle* file = device->GetReadHandle(record->file);
+    size_t num_read = 0;
+    if (!file ||
+        !file->Read(record->offset + read_offset, p, read_length, &num_read)) {
+      break;
+    }
     *out_bytes_read += num_read;
     p += num_read;
-    src_offset += record.length;
     remaining_length -= read_length;
-    if (remaining_length == 0) {
-      break;
-    }
+    read_offset = 0;
+    ++record;
   }
 
   return X_STATUS_SUCCESS;
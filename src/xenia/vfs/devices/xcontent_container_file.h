@@ -34,6 +34,9 @@ class XContentContainerFile : public File {
   }
   X_STATUS SetLength(size_t length) override { return X_STATUS_ACCESS_DENIED; }
 
+  // Reads may be split across scattered blocks of a large package.
+  bool use_read_cache() const override { return true; }
+
  private:
   XContentContainerEntry* entry_;
 };
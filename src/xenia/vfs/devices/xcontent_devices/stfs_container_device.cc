@@ -46,7 +46,9 @@ XContentContainerDevice::Result StfsContainerDevice::LoadHostFiles(
     XELOGW("STFS container is not a single file. Loading might fail!");
   }
 
-  files_.emplace(std::make_pair(0, header_file));
+  if (!AddHostFile(0, header_file, host_path_)) {
+    return Result::kReadError;
+  }
   return Result::kSuccess;
 }
 
@@ -143,11 +145,13 @@ std::unique_ptr<XContentContainerEntry> StfsContainerDevice::ReadEntry(
   if (entry->attributes() & X_FILE_ATTRIBUTE_NORMAL) {
     uint32_t block_index = dir_entry->start_block_number();
     size_t remaining_size = dir_entry->length;
+    size_t block_count = 0;
     while (remaining_size && block_index != kEndOfChain) {
       size_t block_size =
           std::min(static_cast<size_t>(kBlockSize), remaining_size);
       size_t offset = BlockToOffset(block_index);
-      entry->block_list_.push_back({0, offset, block_size});
+      entry->AppendBlock(0, offset, block_size);
+      ++block_count;
       remaining_size -= block_size;
       auto block_hash = GetBlockHash(block_index);
       block_index = block_hash->level0_next_block();
@@ -165,11 +169,11 @@ std::unique_ptr<XContentContainerEntry> StfsContainerDevice::ReadEntry(
 
     // Check that the number of blocks retrieved from hash entries matches
     // the block count read from the file entry
-    if (entry->block_list_.size() != dir_entry->allocated_data_blocks()) {
+    if (block_count != dir_entry->allocated_data_blocks()) {
       XELOGW(
           "STFS failed to read correct block-chain for entry {}, read {} "
           "blocks, expected {}",
-          entry->name_, entry->block_list_.size(),
+          entry->name_, block_count,
           dir_entry->allocated_data_blocks());
       assert_always();
     }
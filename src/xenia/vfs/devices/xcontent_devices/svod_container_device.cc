@@ -65,7 +65,10 @@ SvodContainerDevice::Result SvodContainerDevice::LoadHostFiles(
     xe::filesystem::Seek(file, 0L, SEEK_END);
     files_total_size_ += xe::filesystem::Tell(file);
     // no need to seek back, any reads from this file will seek first anyway
-    files_.emplace(std::make_pair(i, file));
+    if (!AddHostFile(i, file, path)) {
+      CloseFiles();
+      return Result::kReadError;
+    }
   }
   XELOGI("SVOD successfully mapped {} files.", fragment_files.size());
   return Result::kSuccess;
@@ -209,8 +212,6 @@ SvodContainerDevice::Result SvodContainerDevice::ReadEntry(
       uint32_t block_index = dir_entry.data_block;
       size_t remaining_size = xe::round_up(dir_entry.length, 0x800);
 
-      size_t last_record = -1;
-      size_t last_offset = -1;
       while (remaining_size) {
         const size_t BLOCK_SIZE = 0x800;
 
@@ -220,16 +221,8 @@ SvodContainerDevice::Result SvodContainerDevice::ReadEntry(
         block_index++;
         remaining_size -= BLOCK_SIZE;
 
-        if (offset - last_offset == BLOCK_SIZE) {
-          // Consecutive, so append to last entry.
-          entry->block_list_[last_record].length += BLOCK_SIZE;
-          last_offset = offset;
-          continue;
-        }
-
-        entry->block_list_.push_back({file_index, offset, BLOCK_SIZE});
-        last_record = entry->block_list_.size() - 1;
-        last_offset = offset;
+        // Consecutive blocks are merged into one record.
+        entry->AppendBlock(file_index, offset, BLOCK_SIZE);
       }
     }
   }
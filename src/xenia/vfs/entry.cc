@@ -12,6 +12,7 @@
 #include "xenia/base/filesystem.h"
 #include "xenia/base/string.h"
 #include "xenia/vfs/device.h"
+#include "xenia/vfs/metadata_snapshot.h"
 
 namespace xe {
 namespace vfs {
@@ -48,7 +49,7 @@ void Entry::Dump(xe::StringBuffer* string_buffer, int indent) {
 bool Entry::is_read_only() const { return device_->is_read_only(); }
 
 Entry* Entry::GetChild(const std::string_view name) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = device_->critical_region().Acquire();
   auto it = std::find_if(children_.cbegin(), children_.cend(),
                          [&](const auto& child) {
                            return xe::utf8::equal_case(child->name(), name);
@@ -74,7 +75,7 @@ Entry* Entry::ResolvePath(const std::string_view path) {
 
 Entry* Entry::IterateChildren(const xe::filesystem::WildcardEngine& engine,
                               size_t* current_index) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = device_->critical_region().Acquire();
   while (*current_index < children_.size()) {
     auto& child = children_[*current_index];
     *current_index = *current_index + 1;
@@ -86,7 +87,7 @@ Entry* Entry::IterateChildren(const xe::filesystem::WildcardEngine& engine,
 }
 
 Entry* Entry::CreateEntry(const std::string_view name, uint32_t attributes) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = device_->critical_region().Acquire();
   if (is_read_only()) {
     return nullptr;
   }
@@ -105,7 +106,7 @@ Entry* Entry::CreateEntry(const std::string_view name, uint32_t attributes) {
 }
 
 bool Entry::Delete(Entry* entry) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = device_->critical_region().Acquire();
   if (is_read_only()) {
     return false;
   }
@@ -134,7 +135,33 @@ void Entry::Touch() {
   // TODO(benvanik): update timestamps.
 }
 
+void Entry::WriteSnapshotMetadata(MetadataSnapshotWriter& writer) const {
+  writer.Write(attributes_);
+  writer.Write(uint64_t(size_));
+  writer.Write(uint64_t(allocation_size_));
+  writer.Write(create_timestamp_);
+  writer.Write(access_timestamp_);
+  writer.Write(write_timestamp_);
+}
+
+bool Entry::ReadSnapshotMetadata(MetadataSnapshotReader& reader) {
+  uint64_t size, allocation_size;
+  if (!reader.Read(attributes_) || !reader.Read(size) ||
+      !reader.Read(allocation_size) || !reader.Read(create_timestamp_) ||
+      !reader.Read(access_timestamp_) || !reader.Read(write_timestamp_)) {
+    return false;
+  }
+  size_ = size_t(size);
+  allocation_size_ = size_t(allocation_size);
+  return true;
+}
+
 void Entry::Rename(const std::filesystem::path file_path) {
+  // Entries of read-only devices may be indexed by their paths.
+  if (is_read_only()) {
+    return;
+  }
+
   std::vector<std::string_view> splitted_path =
       xe::utf8::split_path(xe::path_to_utf8(file_path));
 
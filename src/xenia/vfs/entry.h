@@ -33,6 +33,8 @@ namespace vfs {
 
 class Device;
 class File;
+class MetadataSnapshotReader;
+class MetadataSnapshotWriter;
 
 // Matches https://source.winehq.org/source/include/winternl.h#1591.
 enum class FileAction {
@@ -143,7 +145,11 @@ class Entry {
   virtual bool DeleteEntryInternal(Entry* entry) { return false; }
   virtual void RenameEntryInternal(const std::filesystem::path file_path) {}
 
-  xe::global_critical_region global_critical_region_;
+  // The metadata common to all entries in a metadata snapshot, which the
+  // entries of each device follow with their own.
+  void WriteSnapshotMetadata(MetadataSnapshotWriter& writer) const;
+  bool ReadSnapshotMetadata(MetadataSnapshotReader& reader);
+
   Device* device_;
   Entry* parent_;
   std::string path_;
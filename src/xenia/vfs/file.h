@@ -45,6 +45,10 @@ class File {
   }
 
   virtual X_STATUS SetLength(size_t length) { return X_STATUS_NOT_IMPLEMENTED; }
+
+  // Whether reading is expensive enough, for instance because the data needs
+  // to be decompressed, for it to be cached by the ReadCache.
+  virtual bool use_read_cache() const { return false; }
   virtual X_STATUS Rename(const std::filesystem::path file_path) {
     return X_STATUS_NOT_IMPLEMENTED;
   }
@@ -58,6 +62,11 @@ class File {
   // xe::filesystem::FileAccess
   uint32_t file_access_ = 0;
   Entry* entry_ = nullptr;
+
+ private:
+  friend class ReadCache;
+  // Where the next read starts if the file is read sequentially.
+  size_t read_cache_next_offset_ = 0;
 };
 
 }  // namespace vfs
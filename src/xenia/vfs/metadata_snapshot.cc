@@ -0,0 +1,182 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/metadata_snapshot.h"
+
+#include <system_error>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/xxhash.h"
+
+DEFINE_bool(vfs_metadata_snapshots, true,
+            "Store the directory trees of disc images and content packages in "
+            "the cache to mount them faster the next time.",
+            "Storage");
+
+namespace xe {
+namespace vfs {
+
+namespace {
+
+constexpr uint32_t kMetadataSnapshotMagic = 0x534D4658;  // XFMS
+// Increment to invalidate all the snapshots when the format of the data of
+// any device changes.
+constexpr uint32_t kMetadataSnapshotVersion = 1;
+
+struct MetadataSnapshotHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t image_size;
+  uint64_t image_write_time;
+  uint64_t image_header_hash;
+  uint64_t data_size;
+  uint64_t data_hash;
+};
+
+std::filesystem::path metadata_snapshot_root;
+
+struct ImageState {
+  uint64_t size;
+  uint64_t write_time;
+};
+
+bool GetImageState(const std::filesystem::path& image_path,
+                   ImageState& state_out) {
+  std::error_code error;
+  uint64_t size = std::filesystem::file_size(image_path, error);
+  if (error) {
+    return false;
+  }
+  auto write_time = std::filesystem::last_write_time(image_path, error);
+  if (error) {
+    return false;
+  }
+  state_out.size = size;
+  state_out.write_time = uint64_t(write_time.time_since_epoch().count());
+  return true;
+}
+
+std::filesystem::path GetMetadataSnapshotPath(
+    const std::filesystem::path& image_path) {
+  if (!cvars::vfs_metadata_snapshots || metadata_snapshot_root.empty()) {
+    return std::filesystem::path();
+  }
+  std::error_code error;
+  std::filesystem::path absolute_path =
+      std::filesystem::absolute(image_path, error);
+  std::string path_utf8 =
+      xe::path_to_utf8(error ? image_path : absolute_path);
+  return metadata_snapshot_root /
+         fmt::format("{:016X}.bin", XXH3_64bits(path_utf8.data(),
+                                                path_utf8.size()));
+}
+
+}  // namespace
+
+void SetMetadataSnapshotRoot(const std::filesystem::path& root) {
+  metadata_snapshot_root = root;
+}
+
+void MetadataSnapshotWriter::WriteString(const std::string_view value) {
+  Write(uint32_t(value.size()));
+  data_.insert(data_.end(), value.cbegin(), value.cend());
+}
+
+bool MetadataSnapshotWriter::Save(const std::filesystem::path& image_path,
+                                  const void* header,
+                                  size_t header_size) const {
+  std::filesystem::path snapshot_path = GetMetadataSnapshotPath(image_path);
+  ImageState image_state;
+  if (snapshot_path.empty() || !GetImageState(image_path, image_state)) {
+    return false;
+  }
+  MetadataSnapshotHeader snapshot_header;
+  snapshot_header.magic = kMetadataSnapshotMagic;
+  snapshot_header.version = kMetadataSnapshotVersion;
+  snapshot_header.image_size = image_state.size;
+  snapshot_header.image_write_time = image_state.write_time;
+  snapshot_header.image_header_hash = XXH3_64bits(header, header_size);
+  snapshot_header.data_size = data_.size();
+  snapshot_header.data_hash = XXH3_64bits(data_.data(), data_.size());
+
+  // Written to a temporary file first to never leave a partial snapshot.
+  std::filesystem::path temp_path = snapshot_path;
+  temp_path += ".tmp";
+  xe::filesystem::CreateParentFolder(temp_path);
+  FILE* file = xe::filesystem::OpenFile(temp_path, "wb");
+  if (!file) {
+    return false;
+  }
+  bool written =
+      fwrite(&snapshot_header, sizeof(snapshot_header), 1, file) == 1 &&
+      fwrite(data_.data(), 1, data_.size(), file) == data_.size();
+  fclose(file);
+  std::error_code error;
+  if (written) {
+    std::filesystem::rename(temp_path, snapshot_path, error);
+  }
+  if (!written || error) {
+    std::filesystem::remove(temp_path, error);
+    XELOGW("Failed to write the metadata snapshot of {}", image_path);
+    return false;
+  }
+  return true;
+}
+
+bool MetadataSnapshotReader::Load(const std::filesystem::path& image_path,
+                                  const void* header, size_t header_size) {
+  data_.clear();
+  position_ = 0;
+  std::filesystem::path snapshot_path = GetMetadataSnapshotPath(image_path);
+  ImageState image_state;
+  if (snapshot_path.empty() || !GetImageState(image_path, image_state)) {
+    return false;
+  }
+  FILE* file = xe::filesystem::OpenFile(snapshot_path, "rb");
+  if (!file) {
+    return false;
+  }
+  MetadataSnapshotHeader snapshot_header;
+  bool loaded =
+      fread(&snapshot_header, sizeof(snapshot_header), 1, file) == 1 &&
+      snapshot_header.magic == kMetadataSnapshotMagic &&
+      snapshot_header.version == kMetadataSnapshotVersion &&
+      snapshot_header.image_size == image_state.size &&
+      snapshot_header.image_write_time == image_state.write_time &&
+      snapshot_header.image_header_hash == XXH3_64bits(header, header_size) &&
+      snapshot_header.data_size <= image_state.size;
+  if (loaded) {
+    data_.resize(size_t(snapshot_header.data_size));
+    loaded = fread(data_.data(), 1, data_.size(), file) == data_.size() &&
+             snapshot_header.data_hash ==
+                 XXH3_64bits(data_.data(), data_.size());
+  }
+  fclose(file);
+  if (!loaded) {
+    data_.clear();
+  }
+  return loaded;
+}
+
+bool MetadataSnapshotReader::ReadString(std::string& value) {
+  uint32_t length;
+  if (!Read(length) || data_.size() - position_ < length) {
+    return false;
+  }
+  value.assign(reinterpret_cast<const char*>(data_.data() + position_),
+               length);
+  position_ += length;
+  return true;
+}
+
+}  // namespace vfs
+}  // namespace xe
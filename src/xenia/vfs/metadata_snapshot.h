@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_METADATA_SNAPSHOT_H_
+#define XENIA_VFS_METADATA_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace xe {
+namespace vfs {
+
+// Snapshots of the entry trees of read-only images, stored in the cache, so
+// mounting an image again rebuilds the tree in one pass over the snapshot
+// instead of parsing the directories of the image.
+//
+// A snapshot is stored per image path, and is only used if the size and the
+// modification time of the image, and the hash of its header (which covers
+// the directories, or their hashes) are the same as when it was written.
+
+// Snapshots are not used until the root is set.
+void SetMetadataSnapshotRoot(const std::filesystem::path& root);
+
+class MetadataSnapshotWriter {
+ public:
+  template <typename T>
+  void Write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    size_t offset = data_.size();
+    data_.resize(offset + sizeof(T));
+    std::memcpy(data_.data() + offset, &value, sizeof(T));
+  }
+  void WriteString(const std::string_view value);
+
+  // Returns false if snapshots are disabled or writing has failed.
+  bool Save(const std::filesystem::path& image_path, const void* header,
+            size_t header_size) const;
+
+ private:
+  std::vector<uint8_t> data_;
+};
+
+class MetadataSnapshotReader {
+ public:
+  // Returns false if there's no up-to-date snapshot for the image.
+  bool Load(const std::filesystem::path& image_path, const void* header,
+            size_t header_size);
+
+  // Return false if reading past the end of the snapshot.
+  template <typename T>
+  bool Read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (data_.size() - position_ < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data_.data() + position_, sizeof(T));
+    position_ += sizeof(T);
+    return true;
+  }
+  bool ReadString(std::string& value);
+
+  bool at_end() const { return position_ == data_.size(); }
+
+ private:
+  std::vector<uint8_t> data_;
+  size_t position_ = 0;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_METADATA_SNAPSHOT_H_
@@ -0,0 +1,260 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/read_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/vfs/device.h"
+#include "xenia/vfs/entry.h"
+
+DEFINE_uint32(vfs_read_cache_size_mb, 64,
+              "Maximum size of the cache of data read from the files in "
+              "compressed disc images and content packages, in megabytes, or 0 "
+              "to disable the cache and reading ahead.",
+              "Storage");
+
+namespace xe {
+namespace vfs {
+
+ReadCache::ReadCache() = default;
+
+ReadCache::~ReadCache() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  read_ahead_task_group_.Wait();
+}
+
+X_STATUS ReadCache::Read(File* file, void* buffer, size_t buffer_length,
+                         size_t byte_offset, size_t* out_bytes_read) {
+  size_t capacity = size_t(cvars::vfs_read_cache_size_mb) * 1024 * 1024;
+  if (!capacity || !file->use_read_cache()) {
+    return file->ReadSync(buffer, buffer_length, byte_offset, out_bytes_read);
+  }
+  Entry* entry = file->entry();
+  size_t entry_size = entry->size();
+  if (byte_offset >= entry_size) {
+    return X_STATUS_END_OF_FILE;
+  }
+  size_t length = std::min(buffer_length, entry_size - byte_offset);
+  size_t first_index = byte_offset / kBlockSize;
+  size_t end_index = (byte_offset + length + kBlockSize - 1) / kBlockSize;
+
+  *out_bytes_read = 0;
+  uint8_t* p = static_cast<uint8_t*>(buffer);
+  size_t index = first_index;
+  while (index < end_index) {
+    size_t block_offset = index * kBlockSize;
+    size_t copy_offset = std::max(byte_offset, block_offset) - block_offset;
+    size_t copy_length =
+        std::min(byte_offset + length, block_offset + kBlockSize) -
+        block_offset - copy_offset;
+    size_t copied_length = 0;
+    size_t miss_end_index = index;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = block_map_.find({entry, index});
+      if (it != block_map_.end()) {
+        blocks_.splice(blocks_.begin(), blocks_, it->second);
+        const std::vector<uint8_t>& data = it->second->data;
+        if (copy_offset < data.size()) {
+          copied_length = std::min(copy_length, data.size() - copy_offset);
+          std::memcpy(p, data.data() + copy_offset, copied_length);
+        }
+        p += copied_length;
+        *out_bytes_read += copied_length;
+        if (copied_length < copy_length) {
+          break;
+        }
+        ++index;
+        continue;
+      }
+      // Read all the consecutive missing blocks at once, so the file may read
+      // them more efficiently, like decompressing them in parallel.
+      do {
+        ++miss_end_index;
+      } while (miss_end_index < end_index &&
+               block_map_.find({entry, miss_end_index}) == block_map_.end());
+    }
+    // Not locked while reading, a block being read on multiple threads at once
+    // is only read multiple times.
+    std::vector<uint8_t> data;
+    if (!ReadBlocks(file, index, miss_end_index - index, data)) {
+      return *out_bytes_read ? X_STATUS_SUCCESS : X_STATUS_UNSUCCESSFUL;
+    }
+    size_t run_copy_length =
+        std::min(byte_offset + length, miss_end_index * kBlockSize) -
+        block_offset - copy_offset;
+    if (copy_offset < data.size()) {
+      copied_length = std::min(run_copy_length, data.size() - copy_offset);
+      std::memcpy(p, data.data() + copy_offset, copied_length);
+    }
+    p += copied_length;
+    *out_bytes_read += copied_length;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < miss_end_index - index; ++i) {
+        size_t data_offset = i * kBlockSize;
+        if (data_offset >= data.size()) {
+          break;
+        }
+        auto block_begin = data.cbegin() + data_offset;
+        auto block_end =
+            block_begin + std::min(kBlockSize, data.size() - data_offset);
+        InsertBlock({entry, index + i},
+                    std::vector<uint8_t>(block_begin, block_end));
+      }
+    }
+    if (copied_length < run_copy_length) {
+      break;
+    }
+    index = miss_end_index;
+  }
+
+  // Read ahead if this read has started where the previous one has ended.
+  bool read_ahead = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool sequential = byte_offset == file->read_cache_next_offset_;
+    file->read_cache_next_offset_ = byte_offset + *out_bytes_read;
+    if (sequential) {
+      size_t entry_block_count = (entry_size + kBlockSize - 1) / kBlockSize;
+      size_t read_ahead_end_index =
+          std::min(end_index + kReadAheadBlockCount, entry_block_count);
+      for (size_t index = end_index; index < read_ahead_end_index; ++index) {
+        BlockKey key = {entry, index};
+        if (block_map_.find(key) != block_map_.end() ||
+            std::find(read_ahead_queue_.cbegin(), read_ahead_queue_.cend(),
+                      key) != read_ahead_queue_.cend()) {
+          continue;
+        }
+        read_ahead_queue_.push_back(key);
+        read_ahead = true;
+      }
+    }
+    if (read_ahead && !read_ahead_scheduled_) {
+      read_ahead_scheduled_ = true;
+    } else {
+      read_ahead = false;
+    }
+  }
+  if (read_ahead) {
+    read_ahead_task_group_.Submit([this]() { ReadAhead(); },
+                                  xe::threading::TaskPriority::kBackground);
+  }
+  return X_STATUS_SUCCESS;
+}
+
+void ReadCache::InvalidateDevice(const Device* device) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  read_ahead_queue_.erase(
+      std::remove_if(read_ahead_queue_.begin(), read_ahead_queue_.end(),
+                     [device](const BlockKey& key) {
+                       return key.entry->device() == device;
+                     }),
+      read_ahead_queue_.end());
+  read_ahead_done_cond_.wait(lock, [this, device]() {
+    return !read_ahead_entry_ || read_ahead_entry_->device() != device;
+  });
+  for (auto it = blocks_.begin(); it != blocks_.end();) {
+    if (it->key.entry->device() == device) {
+      cached_bytes_ -= it->data.size();
+      block_map_.erase(it->key);
+      it = blocks_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ReadCache::Clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  read_ahead_queue_.clear();
+  read_ahead_done_cond_.wait(lock, [this]() { return !read_ahead_entry_; });
+  blocks_.clear();
+  block_map_.clear();
+  cached_bytes_ = 0;
+}
+
+bool ReadCache::ReadBlocks(File* file, size_t first_index, size_t count,
+                           std::vector<uint8_t>& data) {
+  size_t block_offset = first_index * kBlockSize;
+  data.resize(
+      std::min(count * kBlockSize, file->entry()->size() - block_offset));
+  size_t bytes_read = 0;
+  if (XFAILED(file->ReadSync(data.data(), data.size(), block_offset,
+                             &bytes_read))) {
+    return false;
+  }
+  data.resize(bytes_read);
+  return true;
+}
+
+void ReadCache::InsertBlock(const BlockKey& key, std::vector<uint8_t>&& data) {
+  if (block_map_.find(key) != block_map_.end()) {
+    // Read by another thread at the same time.
+    return;
+  }
+  cached_bytes_ += data.size();
+  blocks_.push_front({key, std::move(data)});
+  block_map_.emplace(key, blocks_.begin());
+  EvictBlocks();
+}
+
+void ReadCache::EvictBlocks() {
+  size_t capacity = size_t(cvars::vfs_read_cache_size_mb) * 1024 * 1024;
+  while (cached_bytes_ > capacity && !blocks_.empty()) {
+    cached_bytes_ -= blocks_.back().data.size();
+    block_map_.erase(blocks_.back().key);
+    blocks_.pop_back();
+  }
+}
+
+void ReadCache::ReadAhead() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (shutting_down_ || read_ahead_queue_.empty()) {
+      read_ahead_scheduled_ = false;
+      break;
+    }
+    BlockKey key = read_ahead_queue_.front();
+    read_ahead_queue_.pop_front();
+    if (block_map_.find(key) != block_map_.end()) {
+      continue;
+    }
+    read_ahead_entry_ = key.entry;
+    lock.unlock();
+
+    // A file of its own, as the one of the guest may be closed at any time.
+    std::vector<uint8_t> data;
+    bool read = false;
+    File* file = nullptr;
+    if (XSUCCEEDED(key.entry->Open(xe::filesystem::FileAccess::kFileReadData,
+                                   &file)) &&
+        file) {
+      read = ReadBlocks(file, key.index, 1, data);
+      file->Destroy();
+    }
+
+    lock.lock();
+    read_ahead_entry_ = nullptr;
+    if (read) {
+      InsertBlock(key, std::move(data));
+    }
+    read_ahead_done_cond_.notify_all();
+  }
+}
+
+}  // namespace vfs
+}  // namespace xe
@@ -0,0 +1,109 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_READ_CACHE_H_
+#define XENIA_VFS_READ_CACHE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "xenia/base/task_scheduler.h"
+#include "xenia/vfs/file.h"
+#include "xenia/xbox.h"
+
+namespace xe {
+namespace vfs {
+
+class Device;
+class Entry;
+
+// Device-agnostic cache of file data, for the files whose reads are expensive
+// (File::use_read_cache), such as ones in compressed archives where every read
+// may decompress a whole block again. Keeps a bounded LRU of fixed-size blocks
+// of the entry data, and reads the blocks after sequential reads ahead of time
+// in a background task.
+class ReadCache {
+ public:
+  static constexpr size_t kBlockSize = 64 * 1024;
+  // Blocks read ahead of sequential reads.
+  static constexpr size_t kReadAheadBlockCount = 4;
+
+  ReadCache();
+  ReadCache(const ReadCache& read_cache) = delete;
+  ReadCache& operator=(const ReadCache& read_cache) = delete;
+  ~ReadCache();
+
+  // Same as File::ReadSync, going through the cache if the file uses it.
+  X_STATUS Read(File* file, void* buffer, size_t buffer_length,
+                size_t byte_offset, size_t* out_bytes_read);
+
+  // Drops the blocks of the entries of the device and waits for its reads
+  // ahead to finish, must be called before destroying the device.
+  void InvalidateDevice(const Device* device);
+  void Clear();
+
+ private:
+  struct BlockKey {
+    Entry* entry;
+    size_t index;
+    bool operator==(const BlockKey& key) const {
+      return entry == key.entry && index == key.index;
+    }
+  };
+  struct BlockKeyHasher {
+    size_t operator()(const BlockKey& key) const {
+      return std::hash<const void*>()(key.entry) ^ (key.index * 0x9E3779B9u);
+    }
+  };
+  struct Block {
+    BlockKey key;
+    // Shorter than kBlockSize at the end of the entry.
+    std::vector<uint8_t> data;
+  };
+
+  // Reads consecutive blocks from the file, returns false if reading has
+  // failed.
+  static bool ReadBlocks(File* file, size_t first_index, size_t count,
+                         std::vector<uint8_t>& data);
+  // Must be called with the mutex locked.
+  void InsertBlock(const BlockKey& key, std::vector<uint8_t>&& data);
+  void EvictBlocks();
+
+  // Reads the queued blocks until the queue is empty.
+  void ReadAhead();
+
+  std::mutex mutex_;
+  // From the most recently used.
+  std::list<Block> blocks_;
+  std::unordered_map<BlockKey, std::list<Block>::iterator, BlockKeyHasher>
+      block_map_;
+  size_t cached_bytes_ = 0;
+
+  std::deque<BlockKey> read_ahead_queue_;
+  // Whether the read ahead task has been submitted and is still going to take
+  // the new blocks from the queue.
+  bool read_ahead_scheduled_ = false;
+  // The entry the read ahead task is reading from outside the lock.
+  Entry* read_ahead_entry_ = nullptr;
+  std::condition_variable read_ahead_done_cond_;
+  bool shutting_down_ = false;
+  xe::threading::TaskGroup read_ahead_task_group_;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_READ_CACHE_H_
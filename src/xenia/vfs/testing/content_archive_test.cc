@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/content_archive.h"
+
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+#include "xenia/vfs/entry.h"
+
+namespace xe::vfs::test {
+
+namespace {
+
+ContentArchive::Record MakeRecord(const char* path, uint32_t attributes,
+                                  uint64_t size) {
+  ContentArchive::Record record = {};
+  record.path = path;
+  record.attributes = attributes;
+  record.size = size;
+  record.write_timestamp = 132993639580000000;
+  return record;
+}
+
+std::vector<uint8_t> ReadFile(const ContentArchive& archive,
+                              const ContentArchive::Record& record) {
+  std::vector<uint8_t> data(size_t(record.size));
+  size_t offset = 0;
+  for (uint32_t chunk_index : record.chunks) {
+    REQUIRE(archive.ReadChunk(chunk_index, data.data() + offset));
+    offset += archive.chunks()[chunk_index].size;
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST_CASE("Content archive round trip", "[content_archive]") {
+  auto path = std::filesystem::temp_directory_path() /
+              "xenia_content_archive_test.xcar";
+
+  // Two and a half chunks, the first two equal.
+  std::vector<uint8_t> data(ContentArchive::kChunkSize * 5 / 2);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = uint8_t(i % ContentArchive::kChunkSize % 251);
+  }
+  data.back() = 0xFF;
+
+  {
+    ContentArchiveWriter writer;
+    REQUIRE(writer.Begin(path));
+    REQUIRE(writer.AddDirectory(
+        MakeRecord("saves", kFileAttributeDirectory, 0)));
+    REQUIRE(writer.AddFile(
+        MakeRecord("saves\\a.bin", kFileAttributeNormal, data.size()),
+        data.data()));
+    REQUIRE(writer.AddFile(
+        MakeRecord("saves\\b.bin", kFileAttributeNormal, data.size()),
+        data.data()));
+    REQUIRE(writer.AddFile(MakeRecord("empty.bin", kFileAttributeNormal, 0),
+                           nullptr));
+    REQUIRE(writer.Finish());
+    REQUIRE(writer.Commit());
+  }
+
+  auto archive = ContentArchive::Open(path);
+  REQUIRE(archive);
+  // The chunks shared by the files and within them are stored once.
+  REQUIRE(archive->chunks().size() == 2);
+  REQUIRE(archive->records().size() == 4);
+  REQUIRE(archive->records()[0].path == "saves");
+  REQUIRE(archive->records()[1].chunks == archive->records()[2].chunks);
+  REQUIRE(archive->records()[1].write_timestamp == 132993639580000000);
+  REQUIRE(ReadFile(*archive, archive->records()[1]) == data);
+  REQUIRE(ReadFile(*archive, archive->records()[2]) == data);
+  REQUIRE(archive->records()[3].size == 0);
+  REQUIRE(archive->records()[3].chunks.empty());
+
+  SECTION("Copying archived files keeps the stored chunks") {
+    auto copy_path = std::filesystem::temp_directory_path() /
+                     "xenia_content_archive_test_copy.xcar";
+    {
+      ContentArchiveWriter writer;
+      REQUIRE(writer.Begin(copy_path));
+      REQUIRE(writer.AddDirectory(archive->records()[0]));
+      REQUIRE(writer.AddArchivedFile(archive->records()[2], *archive));
+      REQUIRE(writer.Finish());
+      REQUIRE(writer.Commit());
+    }
+    auto copy = ContentArchive::Open(copy_path);
+    REQUIRE(copy);
+    REQUIRE(copy->chunks().size() == 2);
+    REQUIRE(copy->records().size() == 2);
+    REQUIRE(ReadFile(*copy, copy->records()[1]) == data);
+    copy.reset();
+    std::filesystem::remove(copy_path);
+  }
+
+  archive.reset();
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Content archive not committed", "[content_archive]") {
+  auto path = std::filesystem::temp_directory_path() /
+              "xenia_content_archive_test_uncommitted.xcar";
+  {
+    ContentArchiveWriter writer;
+    REQUIRE(writer.Begin(path));
+    REQUIRE(writer.Finish());
+  }
+  REQUIRE_FALSE(std::filesystem::exists(path));
+  REQUIRE_FALSE(ContentArchive::Open(path));
+}
+
+}  // namespace xe::vfs::test
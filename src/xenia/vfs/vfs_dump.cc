@@ -7,16 +7,21 @@
  ******************************************************************************
  */
 
-#include <queue>
+#include <algorithm>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "xenia/base/console_app_main.h"
 #include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
 #include "xenia/base/literals.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
+#include "xenia/base/utf8.h"
 
+#include "xenia/vfs/devices/disc_image_device.h"
+#include "xenia/vfs/devices/disc_zarchive_device.h"
 #include "xenia/vfs/devices/xcontent_container_device.h"
 #include "xenia/vfs/file.h"
 #include "xenia/vfs/virtual_file_system.h"
@@ -30,6 +35,11 @@ DEFINE_transient_path(source, "", "Specifies the file to dump from.",
 DEFINE_transient_path(dump_path, "",
                       "Specifies the directory to dump files to.", "General");
 
+DEFINE_uint32(dump_threads, 0,
+              "Number of threads to extract the files on, or 0 for one per "
+              "hardware thread.",
+              "General");
+
 int vfs_dump_main(const std::vector<std::string>& args) {
   if (cvars::source.empty() || cvars::dump_path.empty()) {
     XELOGE("Usage: {} [source] [dump_path]", args[0]);
@@ -39,12 +49,27 @@ int vfs_dump_main(const std::vector<std::string>& args) {
   std::filesystem::path base_path = cvars::dump_path;
   std::unique_ptr<vfs::Device> device =
       vfs::XContentContainerDevice::CreateContentDevice("", cvars::source);
+  if (!device) {
+    // Not a content package, a disc image.
+    if (xe::utf8::lower_ascii(xe::path_to_utf8(cvars::source.extension())) ==
+        ".zar") {
+      device = std::make_unique<DiscZarchiveDevice>("", cvars::source);
+    } else {
+      device = std::make_unique<DiscImageDevice>("", cvars::source);
+    }
+  }
 
   if (!device->Initialize()) {
     XELOGE("Failed to initialize device");
     return 1;
   }
-  return VirtualFileSystem::ExtractContentFiles(device.get(), base_path);
+
+  uint32_t thread_count = cvars::dump_threads;
+  if (!thread_count) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  return VirtualFileSystem::ExtractContentFiles(device.get(), base_path,
+                                                thread_count);
 }
 
 }  // namespace vfs
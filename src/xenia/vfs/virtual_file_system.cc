@@ -11,6 +11,13 @@
 #include "xenia/kernel/xam/content_manager.h"
 #include "xenia/vfs/devices/xcontent_container_device.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <thread>
+
 #include "devices/host_path_entry.h"
 #include "xenia/base/literals.h"
 #include "xenia/base/logging.h"
@@ -31,21 +38,23 @@ VirtualFileSystem::~VirtualFileSystem() {
 }
 
 void VirtualFileSystem::Clear() {
+  read_cache_.Clear();
   devices_.clear();
   symlinks_.clear();
 }
 
 bool VirtualFileSystem::RegisterDevice(std::unique_ptr<Device> device) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   devices_.emplace_back(std::move(device));
   return true;
 }
 
 bool VirtualFileSystem::UnregisterDevice(const std::string_view path) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   for (auto it = devices_.begin(); it != devices_.end(); ++it) {
     if ((*it)->mount_path() == path) {
       XELOGD("Unregistered device: {}", (*it)->mount_path());
+      read_cache_.InvalidateDevice(it->get());
       devices_.erase(it);
       return true;
     }
@@ -55,7 +64,7 @@ bool VirtualFileSystem::UnregisterDevice(const std::string_view path) {
 
 bool VirtualFileSystem::RegisterSymbolicLink(const std::string_view path,
                                              const std::string_view target) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   symlinks_.insert({std::string(path), std::string(target)});
   XELOGD("Registered symbolic link: {} => {}", path, target);
 
@@ -63,7 +72,7 @@ bool VirtualFileSystem::RegisterSymbolicLink(const std::string_view path,
 }
 
 bool VirtualFileSystem::UnregisterSymbolicLink(const std::string_view path) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
   auto it = std::find_if(
       symlinks_.cbegin(), symlinks_.cend(),
       [&](const auto& s) { return xe::utf8::equal_case(path, s.first); });
@@ -110,7 +119,7 @@ bool VirtualFileSystem::ResolveSymbolicLink(const std::string_view path,
 }
 
 Entry* VirtualFileSystem::ResolvePath(const std::string_view path) {
-  auto global_lock = global_critical_region_.Acquire();
+  auto lock = critical_region_.Acquire();
 
   // Resolve relative paths
   auto normalized_path(xe::utf8::canonicalize_guest_path(path));
@@ -336,10 +345,6 @@ X_STATUS VirtualFileSystem::OpenFile(Entry* root_entry,
 X_STATUS VirtualFileSystem::ExtractContentFile(Entry* entry,
                                                std::filesystem::path base_path,
                                                bool extract_to_root) {
-  // Allocate a buffer when needed.
-  size_t buffer_size = 0;
-  uint8_t* buffer = nullptr;
-
   XELOGI("Extracting file: {}", entry->path());
 
   auto dest_name = base_path / xe::to_path(entry->path());
@@ -370,39 +375,51 @@ X_STATUS VirtualFileSystem::ExtractContentFile(Entry* entry,
   }
 
   if (entry->can_map()) {
+    // Written straight from the mapping of the image.
     auto map = entry->OpenMapped(xe::MappedMemory::Mode::kRead);
-    fwrite(map->data(), map->size(), 1, file);
-    map->Close();
+    if (!map ||
+        (map->size() && fwrite(map->data(), map->size(), 1, file) != 1)) {
+      result = X_STATUS_UNSUCCESSFUL;
+    }
+    if (map) {
+      map->Close();
+    }
   } else {
-    // Can't map the file into memory. Read it into a temporary buffer.
-    if (!buffer || entry->size() > buffer_size) {
-      // Resize the buffer.
-      if (buffer) {
-        delete[] buffer;
+    // Can't map the file into memory. Stream it through a buffer.
+    constexpr size_t kBufferSize = 8_MiB;
+    auto buffer = std::make_unique<uint8_t[]>(
+        std::min(kBufferSize, std::max(entry->size(), size_t(1))));
+    size_t offset = 0;
+    while (offset < entry->size()) {
+      size_t bytes_read = 0;
+      result = in_file->ReadSync(buffer.get(),
+                                 std::min(kBufferSize, entry->size() - offset),
+                                 offset, &bytes_read);
+      if (XFAILED(result) || !bytes_read) {
+        break;
       }
-
-      // Allocate a buffer rounded up to the nearest 512MB.
-      buffer_size = xe::round_up(entry->size(), 512_MiB);
-      buffer = new uint8_t[buffer_size];
+      if (fwrite(buffer.get(), bytes_read, 1, file) != 1) {
+        result = X_STATUS_UNSUCCESSFUL;
+        break;
+      }
+      offset += bytes_read;
     }
-
-    size_t bytes_read = 0;
-    in_file->ReadSync(buffer, entry->size(), 0, &bytes_read);
-    fwrite(buffer, bytes_read, 1, file);
   }
 
   fclose(file);
   in_file->Destroy();
-
-  if (buffer) {
-    delete[] buffer;
-  }
-  return 0;
+  return XFAILED(result) ? result : 0;
 }
 
-X_STATUS VirtualFileSystem::ExtractContentFiles(
-    Device* device, std::filesystem::path base_path) {
-  // Run through all the files, breadth-first style.
+X_STATUS VirtualFileSystem::ExtractContentFiles(Device* device,
+                                                std::filesystem::path base_path,
+                                                uint32_t thread_count) {
+  auto start_time = std::chrono::steady_clock::now();
+
+  // Run through all the files, breadth-first style, so the directories are
+  // created before what they contain.
+  std::vector<vfs::Entry*> files;
+  uint64_t total_size = 0;
   std::queue<vfs::Entry*> queue;
   auto root = device->ResolvePath("/");
   queue.push(root);
@@ -414,8 +431,49 @@ X_STATUS VirtualFileSystem::ExtractContentFiles(
       queue.push(entry.get());
     }
 
-    ExtractContentFile(entry, base_path);
+    bool is_directory = entry->attributes() & kFileAttributeDirectory;
+    if (!is_directory) {
+      total_size += entry->size();
+    }
+    if (thread_count > 1 && !is_directory) {
+      files.push_back(entry);
+    } else {
+      ExtractContentFile(entry, base_path);
+    }
+  }
+
+  if (!files.empty()) {
+    // The largest first, so the threads finish at about the same time.
+    std::stable_sort(files.begin(), files.end(),
+                     [](const Entry* a, const Entry* b) {
+                       return a->size() > b->size();
+                     });
+    std::atomic<size_t> next_file_index{0};
+    auto extract_files = [&]() {
+      size_t file_index;
+      while ((file_index = next_file_index.fetch_add(
+                  1, std::memory_order_relaxed)) < files.size()) {
+        ExtractContentFile(files[file_index], base_path);
+      }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < std::min(size_t(thread_count), files.size());
+         ++i) {
+      threads.emplace_back(extract_files);
+    }
+    extract_files();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
   }
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start_time)
+                       .count();
+  double mib = double(total_size) / double(1_MiB);
+  XELOGI("Extracted {:.1f} MiB in {:.2f} s ({:.1f} MiB/s) with {} thread(s)",
+         mib, seconds, seconds > 0.0 ? mib / seconds : 0.0,
+         std::max(thread_count, uint32_t(1)));
   return X_STATUS_SUCCESS;
 }
 
@@ -19,6 +19,7 @@
 #include "xenia/vfs/device.h"
 #include "xenia/vfs/entry.h"
 #include "xenia/vfs/file.h"
+#include "xenia/vfs/read_cache.h"
 
 namespace xe {
 namespace vfs {
@@ -40,6 +41,8 @@ class VirtualFileSystem {
 
   Entry* ResolvePath(const std::string_view path);
 
+  ReadCache& read_cache() { return read_cache_; }
+
   Entry* CreatePath(const std::string_view path, uint32_t attributes);
   bool DeletePath(const std::string_view path);
 
@@ -52,15 +55,22 @@ class VirtualFileSystem {
   static X_STATUS ExtractContentFile(Entry* entry,
                                      std::filesystem::path base_path,
                                      bool extract_to_root = false);
+  // Extracts the files on the given number of threads, which the device must
+  // support reading from concurrently.
   static X_STATUS ExtractContentFiles(Device* device,
-                                      std::filesystem::path base_path);
+                                      std::filesystem::path base_path,
+                                      uint32_t thread_count = 1);
   static void ExtractContentHeader(Device* device,
                                    std::filesystem::path base_path);
 
  private:
-  xe::global_critical_region global_critical_region_;
+  // May be held when acquiring the regions of the devices, not the other
+  // way around.
+  xe::subsystem_critical_region critical_region_;
   std::vector<std::unique_ptr<Device>> devices_;
   std::unordered_map<std::string, std::string> symlinks_;
+  // Destroyed before the devices, so it's not reading ahead from them.
+  ReadCache read_cache_;
 
   bool ResolveSymbolicLink(const std::string_view path, std::string& result);
 };